@@ -0,0 +1,95 @@
+/**
+ * @file FreeRTOSConfig.h
+ * @brief FreeRTOS kernel configuration for the RTOS scheduler backend.
+ *
+ * Only used when the firmware is built with APP_SCHEDULER_BACKEND=2 (see
+ * tools/build_firmware.sh, FREERTOS_DIR). Every kernel object is allocated
+ * statically by app_task_manager.c; there is no heap and no timer task.
+ *
+ * The kernel shares SysTick with the HAL: stm32f4xx_it.c calls the port's
+ * tick handler after HAL_IncTick(), and the tick steps taken after a
+ * tickless sleep are added to the HAL tick as well, so HAL_GetTick() and
+ * the task release times stay on one clock.
+ */
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#if defined(__GNUC__) && !defined(__ASSEMBLER__)
+#include <stdint.h>
+extern uint32_t          SystemCoreClock;
+extern volatile uint32_t uwTick;
+void Error_Handler(void);
+#endif
+
+/* Scheduler ----------------------------------------------------------------*/
+#define configUSE_PREEMPTION                     1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION  1
+#define configUSE_TICKLESS_IDLE                  1
+#define configCPU_CLOCK_HZ                       (SystemCoreClock)
+#define configTICK_RATE_HZ                       ((TickType_t)1000)
+#define configMAX_PRIORITIES                     (7)
+#define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
+#define configMAX_TASK_NAME_LEN                  (16)
+#define configUSE_16_BIT_TICKS                   0
+#define configIDLE_SHOULD_YIELD                  1
+#define configUSE_TASK_NOTIFICATIONS             1
+#define configUSE_NEWLIB_REENTRANT               1
+
+/* Memory: everything is static (app_task_manager.c) ------------------------*/
+#define configSUPPORT_STATIC_ALLOCATION          1
+#define configSUPPORT_DYNAMIC_ALLOCATION         0
+
+/* Hooks and optional features ----------------------------------------------*/
+#define configUSE_IDLE_HOOK                      0
+#define configUSE_TICK_HOOK                      0
+#define configUSE_MALLOC_FAILED_HOOK             0
+#define configCHECK_FOR_STACK_OVERFLOW           0
+#define configUSE_TIMERS                         0
+#define configUSE_MUTEXES                        0
+#define configUSE_RECURSIVE_MUTEXES              0
+#define configUSE_COUNTING_SEMAPHORES            0
+#define configUSE_CO_ROUTINES                    0
+#define configQUEUE_REGISTRY_SIZE                0
+
+#define INCLUDE_vTaskDelay                       1
+#define INCLUDE_vTaskDelayUntil                  1
+#define INCLUDE_xTaskGetSchedulerState           1
+#define INCLUDE_vTaskPrioritySet                 0
+#define INCLUDE_vTaskDelete                      1
+#define INCLUDE_vTaskSuspend                     1
+#define INCLUDE_xTaskAbortDelay                  1
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
+
+/* Interrupt priorities (4 bits on the STM32F4) -----------------------------*/
+#define configPRIO_BITS                          4
+
+/* SysTick and PendSV run at the lowest priority. */
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY        15
+
+/* Interrupts at numerically lower (higher) priorities than this never call
+ * the kernel and are never masked by it. The board's drivers all run at 0;
+ * only the event bridge (SPDIF_RX_IRQHandler) runs at this level.
+ */
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY   5
+
+#define configKERNEL_INTERRUPT_PRIORITY \
+    (configLIBRARY_LOWEST_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+#define configMAX_SYSCALL_INTERRUPT_PRIORITY \
+    (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY << (8 - configPRIO_BITS))
+
+/* Checks and tick bookkeeping ----------------------------------------------*/
+#define configASSERT(x)                                 \
+    do                                                  \
+    {                                                   \
+        if ((x) == 0)                                   \
+        {                                               \
+            taskDISABLE_INTERRUPTS();                   \
+            Error_Handler();                            \
+        }                                               \
+    } while (0)
+
+/* Ticks skipped in tickless idle also advance the HAL tick. */
+#define traceINCREASE_TICK_COUNT(ticks)  (uwTick += (uint32_t)(ticks))
+
+#endif /* FREERTOS_CONFIG_H */
@@ -55,7 +55,31 @@ void SVC_Handler(void);
 void DebugMon_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void DMA1_Stream5_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void USART2_IRQHandler(void);
+void EXTI3_IRQHandler(void);
+void EXTI15_10_IRQHandler(void);
+void RTC_WKUP_IRQHandler(void);
+void FLASH_IRQHandler(void);
+void TIM3_IRQHandler(void);
+void TIM5_IRQHandler(void);
+void DMA2_Stream0_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void DMA1_Stream7_IRQHandler(void);
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream4_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void OTG_FS_IRQHandler(void);
+void USART1_IRQHandler(void);
+void DMA2_Stream7_IRQHandler(void);
+void USART6_IRQHandler(void);
+void DMA2_Stream6_IRQHandler(void);
+void DMA2_Stream1_IRQHandler(void);
+void FMPI2C1_EV_IRQHandler(void);
+void FMPI2C1_ER_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -24,6 +24,16 @@
 #include "log.h"
 #include "app_main.h"
 #include "cli.h"
+#include "uart_tx.h"
+#include "telemetry_uart.h"
+#include "mem_map.h"
+#include "crash_log.h"
+#include "time_base.h"
+#include "app_config.h"
+#include "app_bench.h"
+#include "boot_time.h"
+#include "power_standby.h"
+#include "irq_plan.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -43,16 +53,22 @@
 
 /* Private variables ---------------------------------------------------------*/
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* USER CODE BEGIN PV */
+UART_HandleTypeDef huart1;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_USART2_UART_Init(void);
 /* USER CODE BEGIN PFP */
+static void MX_USART1_UART_Init(void);
 
 /* USER CODE END PFP */
 
@@ -69,6 +85,8 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
+  BootTime_Start();
+  MemMap_PaintStack();
 
   /* USER CODE END 1 */
 
@@ -78,24 +96,58 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-
+  BootTime_Mark(BOOT_PHASE_HAL);
   /* USER CODE END Init */
 
   /* Configure the system clock */
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  BootTime_Mark(BOOT_PHASE_CLOCK);
 
+  /* A STANDBY duty cycle wakeup samples and goes back to STANDBY in here;
+   * only a full boot gets past it.
+   */
+  (void)PowerStandby_Boot(App_StandbySample);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_USART2_UART_Init();
   /* USER CODE BEGIN 2 */
-  Log_Init(&huart2);
-  CLI_Init(&huart2);
+  BootTime_Mark(BOOT_PHASE_PERIPH);
+  CrashLog_Init();
+  bool resume = BootTime_DetectResume() && (BOOT_FAST_RESUME_ENABLE != 0);
+  Time_Init();
+  UartTx_Init(&huart2);
+  Log_Init(UartTx_GetStream(UART_TX_STREAM_LOG));
+  CLI_Init(&huart2, UartTx_GetStream(UART_TX_STREAM_CLI));
+  IrqPlan_Init();
+  if (TELEMETRY_UART_ENABLE != 0)
+  {
+    MX_USART1_UART_Init();
+    TelemetryUart_Init(&huart1);
+  }
+  BootTime_Mark(BOOT_PHASE_CONSOLE);
 
-  LOG_INFO("=== Smart Sensor Hub startup ===");
+  /* USB, the banner and the other non-critical modules follow the first
+   * sample (App_MainInit()).
+   */
+  if (!resume)
+  {
+    LOG_INFO("=== Smart Sensor Hub startup ===");
+  }
+  if (CrashLog_IsHeld())
+  {
+    LOG_WARN("Crash trace from an earlier boot held; 'crash' shows it");
+  }
+#if (APP_BENCH_ENABLE != 0)
+  if (!resume)
+  {
+    AppBench_Run();
+  }
+#endif
   App_MainInit();
   /* USER CODE END 2 */
 
@@ -185,6 +237,25 @@ static void MX_USART2_UART_Init(void)
 
 }
 
+/**
+  * Enable DMA controller clock
+  */
+static void MX_DMA_Init(void)
+{
+
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  /* DMA1_Stream5_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream5_IRQn);
+  /* DMA1_Stream6_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+}
+
 /**
   * @brief GPIO Initialization Function
   * @param None
@@ -224,6 +295,27 @@ static void MX_GPIO_Init(void)
 
 /* USER CODE BEGIN 4 */
 
+/**
+  * @brief USART1 Initialization Function (telemetry UART, TX only)
+  * @param None
+  * @retval None
+  */
+static void MX_USART1_UART_Init(void)
+{
+  huart1.Instance = USART1;
+  huart1.Init.BaudRate = TELEMETRY_UART_BAUD_DEFAULT;
+  huart1.Init.WordLength = UART_WORDLENGTH_8B;
+  huart1.Init.StopBits = UART_STOPBITS_1;
+  huart1.Init.Parity = UART_PARITY_NONE;
+  huart1.Init.Mode = UART_MODE_TX;
+  huart1.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart1.Init.OverSampling = UART_OVERSAMPLING_16;
+  if (HAL_UART_Init(&huart1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
 /* USER CODE END 4 */
 
 /**
@@ -235,6 +327,9 @@ void Error_Handler(void)
   /* USER CODE BEGIN Error_Handler_Debug */
   /* User can add his own implementation to report the HAL error return state */
   __disable_irq();
+  CrashLog_RecordError(CRASH_LOG_FAULT_ERROR, (uint32_t)(uintptr_t)__builtin_return_address(0), 0U, 0U);
+  /* Push out whatever is still queued so the last log lines are visible. */
+  Log_Flush();
   while (1)
   {
   }
@@ -254,6 +349,8 @@ void assert_failed(uint8_t *file, uint32_t line)
   /* USER CODE BEGIN 6 */
   /* User can add his own implementation to report the file name and line number,
      ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
+  CrashLog_RecordError(CRASH_LOG_FAULT_ASSERT, (uint32_t)(uintptr_t)__builtin_return_address(0),
+                       line, (uint32_t)(uintptr_t)file);
   /* USER CODE END 6 */
 }
 #endif /* USE_FULL_ASSERT */
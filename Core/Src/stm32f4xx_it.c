@@ -22,6 +22,25 @@
 #include "stm32f4xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "app_config.h"
+#include "app_task_manager.h"
+#include "crash_log.h"
+#include "i2c_bus_hw.h"
+#include "irq_plan.h"
+#include "power_manager.h"
+#include "power_rtc.h"
+#include "ramfunc.h"
+#include "sensor_adc.h"
+#include "sensor_sync.h"
+#include "spi_bus_hw.h"
+#include "time_base.h"
+#include "trace.h"
+#include "uplink_hw.h"
+#include "usb_cdc_hw.h"
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -46,6 +65,23 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
+/* Frequent, short handlers run from SRAM (ramfunc.h). The attribute is on
+ * a redeclaration so that code generation keeps it. */
+RAMFUNC void SysTick_Handler(void);
+RAMFUNC void DMA1_Stream5_IRQHandler(void);
+RAMFUNC void DMA1_Stream6_IRQHandler(void);
+#if defined(__arm__)
+/* No prologue, so the entry code below sees the stack as the fault left it. */
+__attribute__((naked)) void HardFault_Handler(void);
+#endif
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+/* The kernel's port owns these two; branch to it with LR (EXC_RETURN) intact. */
+__attribute__((naked)) void SVC_Handler(void);
+__attribute__((naked)) void PendSV_Handler(void);
+void vPortSVCHandler(void);
+void xPortPendSVHandler(void);
+void xPortSysTickHandler(void);
+#endif
 
 /* USER CODE END PFP */
 
@@ -55,8 +91,13 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+extern UART_HandleTypeDef huart2;
 
 /* USER CODE BEGIN EV */
+extern DMA_HandleTypeDef hdma_usart1_tx;
+extern UART_HandleTypeDef huart1;
 
 /* USER CODE END EV */
 
@@ -84,7 +125,17 @@ void NMI_Handler(void)
 void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+#if defined(__arm__)
+  /* Hand the exception frame (MSP or PSP, per EXC_RETURN) to the crash trace. */
+  __ASM volatile(
+      "tst   lr, #4               \n"
+      "ite   eq                   \n"
+      "mrseq r0, msp              \n"
+      "mrsne r0, psp              \n"
+      "b     CrashLog_FaultEntry  \n");
+#else
+  CrashLog_FaultEntry(NULL);
+#endif
   /* USER CODE END HardFault_IRQn 0 */
   while (1)
   {
@@ -144,7 +195,9 @@ void UsageFault_Handler(void)
 void SVC_Handler(void)
 {
   /* USER CODE BEGIN SVCall_IRQn 0 */
-
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+  __ASM volatile("b vPortSVCHandler \n");
+#endif
   /* USER CODE END SVCall_IRQn 0 */
   /* USER CODE BEGIN SVCall_IRQn 1 */
 
@@ -170,7 +223,9 @@ void DebugMon_Handler(void)
 void PendSV_Handler(void)
 {
   /* USER CODE BEGIN PendSV_IRQn 0 */
-
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+  __ASM volatile("b xPortPendSVHandler \n");
+#endif
   /* USER CODE END PendSV_IRQn 0 */
   /* USER CODE BEGIN PendSV_IRQn 1 */
 
@@ -183,11 +238,20 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER_AGE(SYSTICK, IrqPlan_SysTickAge());
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+  AppTaskManager_WatchdogTick();
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+  if (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)
+  {
+    xPortSysTickHandler();
+  }
+#endif
+  IRQ_LATENCY_EXIT(SYSTICK);
+  TRACE_ISR_EXIT();
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -198,6 +262,368 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f4xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles DMA1 stream5 global interrupt.
+  */
+void DMA1_Stream5_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream5_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(CONSOLE_DMA_RX);
+  /* USER CODE END DMA1_Stream5_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart2_rx);
+  /* USER CODE BEGIN DMA1_Stream5_IRQn 1 */
+  IRQ_LATENCY_EXIT(CONSOLE_DMA_RX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream5_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream6 global interrupt.
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(CONSOLE_DMA_TX);
+  /* USER CODE END DMA1_Stream6_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+  /* USER CODE BEGIN DMA1_Stream6_IRQn 1 */
+  IRQ_LATENCY_EXIT(CONSOLE_DMA_TX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream6_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USART2 global interrupt.
+  */
+void USART2_IRQHandler(void)
+{
+  /* USER CODE BEGIN USART2_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(CONSOLE_UART);
+  /* USER CODE END USART2_IRQn 0 */
+  HAL_UART_IRQHandler(&huart2);
+  /* USER CODE BEGIN USART2_IRQn 1 */
+  IRQ_LATENCY_EXIT(CONSOLE_UART);
+  TRACE_ISR_EXIT();
+  /* USER CODE END USART2_IRQn 1 */
+}
+
+/**
+  * @brief This function handles EXTI line3 interrupt.
+  */
+void EXTI3_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI3_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(UART_WAKE);
+  PowerManager_UartWakeIrqHandler();
+  /* USER CODE END EXTI3_IRQn 0 */
+  /* USER CODE BEGIN EXTI3_IRQn 1 */
+  IRQ_LATENCY_EXIT(UART_WAKE);
+  TRACE_ISR_EXIT();
+  /* USER CODE END EXTI3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles EXTI line[15:10] interrupts.
+  */
+void EXTI15_10_IRQHandler(void)
+{
+  /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(BUTTON);
+  /* USER CODE END EXTI15_10_IRQn 0 */
+  HAL_GPIO_EXTI_IRQHandler(B1_Pin);
+  /* USER CODE BEGIN EXTI15_10_IRQn 1 */
+  IRQ_LATENCY_EXIT(BUTTON);
+  TRACE_ISR_EXIT();
+  /* USER CODE END EXTI15_10_IRQn 1 */
+}
+
+/**
+  * @brief This function handles RTC wake-up interrupt through EXTI line 22.
+  */
+void RTC_WKUP_IRQHandler(void)
+{
+  /* USER CODE BEGIN RTC_WKUP_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(RTC_WAKEUP);
+  PowerRtc_WakeupIrqHandler();
+  /* USER CODE END RTC_WKUP_IRQn 0 */
+  /* USER CODE BEGIN RTC_WKUP_IRQn 1 */
+  IRQ_LATENCY_EXIT(RTC_WAKEUP);
+  TRACE_ISR_EXIT();
+  /* USER CODE END RTC_WKUP_IRQn 1 */
+}
+
+/**
+  * @brief This function handles Flash global interrupt.
+  */
+void FLASH_IRQHandler(void)
+{
+  /* USER CODE BEGIN FLASH_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(FLASH);
+  /* USER CODE END FLASH_IRQn 0 */
+  HAL_FLASH_IRQHandler();
+  /* USER CODE BEGIN FLASH_IRQn 1 */
+  IRQ_LATENCY_EXIT(FLASH);
+  TRACE_ISR_EXIT();
+  /* USER CODE END FLASH_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM5 global interrupt.
+  */
+void TIM5_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM5_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER_AGE(TIME_BASE, TIM5->CNT);
+  Time_IrqHandler();
+  /* USER CODE END TIM5_IRQn 0 */
+  /* USER CODE BEGIN TIM5_IRQn 1 */
+  IRQ_LATENCY_EXIT(TIME_BASE);
+  TRACE_ISR_EXIT();
+  /* USER CODE END TIM5_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM3 global interrupt.
+  */
+void TIM3_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM3_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER_AGE(SYNC_TIMER, TIM3->CNT);
+  SensorSync_TimerIrqHandler();
+  /* USER CODE END TIM3_IRQn 0 */
+  /* USER CODE BEGIN TIM3_IRQn 1 */
+  IRQ_LATENCY_EXIT(SYNC_TIMER);
+  TRACE_ISR_EXIT();
+  /* USER CODE END TIM3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt.
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(ADC_DMA);
+  SensorAdc_DmaIrqHandler();
+  /* USER CODE END DMA2_Stream0_IRQn 0 */
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 1 */
+  IRQ_LATENCY_EXIT(ADC_DMA);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA2_Stream0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt.
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(I2C_DMA_RX);
+  I2cBusHw_DmaRxIrqHandler();
+  /* USER CODE END DMA1_Stream0_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Stream0_IRQn 1 */
+  IRQ_LATENCY_EXIT(I2C_DMA_RX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream0_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C1 event interrupt.
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_EV_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(I2C_EV);
+  I2cBusHw_EvIrqHandler();
+  /* USER CODE END I2C1_EV_IRQn 0 */
+  /* USER CODE BEGIN I2C1_EV_IRQn 1 */
+  IRQ_LATENCY_EXIT(I2C_EV);
+  TRACE_ISR_EXIT();
+  /* USER CODE END I2C1_EV_IRQn 1 */
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_ER_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(I2C_ER);
+  I2cBusHw_ErIrqHandler();
+  /* USER CODE END I2C1_ER_IRQn 0 */
+  /* USER CODE BEGIN I2C1_ER_IRQn 1 */
+  IRQ_LATENCY_EXIT(I2C_ER);
+  TRACE_ISR_EXIT();
+  /* USER CODE END I2C1_ER_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream7 global interrupt.
+  */
+void DMA1_Stream7_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream7_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(I2C_DMA_TX);
+  I2cBusHw_DmaTxIrqHandler();
+  /* USER CODE END DMA1_Stream7_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Stream7_IRQn 1 */
+  IRQ_LATENCY_EXIT(I2C_DMA_TX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream7_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream3 global interrupt.
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(SPI_DMA_RX);
+  SpiBusHw_DmaRxIrqHandler();
+  /* USER CODE END DMA1_Stream3_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 1 */
+  IRQ_LATENCY_EXIT(SPI_DMA_RX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA1 stream4 global interrupt.
+  */
+void DMA1_Stream4_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 0 */
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(SPI_DMA_TX);
+  SpiBusHw_DmaTxIrqHandler();
+  /* USER CODE END DMA1_Stream4_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Stream4_IRQn 1 */
+  IRQ_LATENCY_EXIT(SPI_DMA_TX);
+  TRACE_ISR_EXIT();
+  /* USER CODE END DMA1_Stream4_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles USB On The Go FS global interrupt.
+  */
+void OTG_FS_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(USB);
+  UsbCdcHw_IrqHandler();
+  IRQ_LATENCY_EXIT(USB);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles USART1 global interrupt (telemetry UART).
+  */
+void USART1_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(TELEM_UART);
+  HAL_UART_IRQHandler(&huart1);
+  IRQ_LATENCY_EXIT(TELEM_UART);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA2 stream7 global interrupt (USART1 TX).
+  */
+void DMA2_Stream7_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(TELEM_DMA_TX);
+  HAL_DMA_IRQHandler(&hdma_usart1_tx);
+  IRQ_LATENCY_EXIT(TELEM_DMA_TX);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles USART6 global interrupt (uplink modem).
+  */
+void USART6_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(UPLINK_UART);
+  UplinkHw_UartIrqHandler();
+  IRQ_LATENCY_EXIT(UPLINK_UART);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA2 stream6 global interrupt (USART6 TX).
+  */
+void DMA2_Stream6_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(UPLINK_DMA_TX);
+  UplinkHw_DmaTxIrqHandler();
+  IRQ_LATENCY_EXIT(UPLINK_DMA_TX);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA2 stream1 global interrupt (USART6 RX).
+  */
+void DMA2_Stream1_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  IRQ_LATENCY_ENTER(UPLINK_DMA_RX);
+  UplinkHw_DmaRxIrqHandler();
+  IRQ_LATENCY_EXIT(UPLINK_DMA_RX);
+  TRACE_ISR_EXIT();
+}
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+/**
+  * @brief SPDIF-RX is not used on this board; its vector carries the posted
+  *        events into the kernel (AppTaskManager_PostEvent()).
+  */
+void SPDIF_RX_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  AppTaskManager_EventIrqHandler();
+  TRACE_ISR_EXIT();
+}
+#else
+/**
+  * @brief FMPI2C1 is not used on this board; its event vector runs the
+  *        event tasks of preemption level 1 (AppTaskManager_PostEvent()).
+  */
+void FMPI2C1_EV_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  AppTaskManager_LevelIrqHandler(1U);
+  TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief FMPI2C1 error vector: the event tasks of preemption level 2.
+  */
+void FMPI2C1_ER_IRQHandler(void)
+{
+  TRACE_ISR_ENTER();
+  AppTaskManager_LevelIrqHandler(2U);
+  TRACE_ISR_EXIT();
+}
+#endif
+
 /* USER CODE END 1 */
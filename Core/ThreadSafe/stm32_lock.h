@@ -45,6 +45,17 @@
   *    <b>NOTE:</b> Thread-safety dependent functions will enter an infinity loop
   *    if used in interrupt context.
   *
+  * 6. Allow lock usage from interrupts below a priority threshold.
+  *    This implementation will ensure thread-safety by raising BASEPRI to
+  *    <tt>\STM32_LOCK_BASEPRI_PRIORITY</tt> during e.g. calls to malloc, so
+  *    only interrupts with that or a lower priority are held off.
+  *    <br>
+  *    <b>NOTE:</b> Interrupts with a higher priority are not disabled. They
+  *    must not use thread-safety dependent functions (malloc, float
+  *    formatting, the memory pools). BASEPRI masks by preemption priority,
+  *    so with no preemption priority bits (NVIC_PRIORITYGROUP_0) this
+  *    behaves as strategy 2.
+  *
   ******************************************************************************
   * @attention
   *
@@ -364,6 +375,96 @@ static inline void stm32_lock_release(LockingData_t *lock)
   xTaskResumeAll();
 }
 
+#elif STM32_THREAD_SAFE_STRATEGY == 6
+/*
+ * Allow lock usage from interrupts below a priority threshold.
+ */
+
+/* Private defines ---------------------------------------------------------*/
+#ifndef STM32_LOCK_BASEPRI_PRIORITY
+#define STM32_LOCK_BASEPRI_PRIORITY 1 /**< Mask this and lower priorities */
+#endif /* STM32_LOCK_BASEPRI_PRIORITY */
+
+#ifdef __NVIC_PRIO_BITS
+#define STM32_LOCK_PRIO_BITS __NVIC_PRIO_BITS /**< Implemented priority bits */
+#else
+#define STM32_LOCK_PRIO_BITS 4 /**< STM32F4 implements 4 priority bits */
+#endif /* __NVIC_PRIO_BITS */
+
+#if (STM32_LOCK_BASEPRI_PRIORITY < 1) || (STM32_LOCK_BASEPRI_PRIORITY >= (1 << STM32_LOCK_PRIO_BITS))
+#error STM32_LOCK_BASEPRI_PRIORITY must be 1 to the lowest implemented priority
+#endif /* STM32_LOCK_BASEPRI_PRIORITY */
+
+/** BASEPRI value of the threshold priority */
+#define STM32_LOCK_BASEPRI_VALUE \
+  ((uint32_t)STM32_LOCK_BASEPRI_PRIORITY << (8 - STM32_LOCK_PRIO_BITS))
+
+/** Initialize members in instance of <code>LockingData_t</code> structure */
+#define LOCKING_DATA_INIT { 0, 0 }
+
+/* Private typedef ---------------------------------------------------------*/
+typedef struct
+{
+  uint8_t basepri; /**< Backup of BASEPRI at nesting level 0 */
+  uint8_t counter; /**< Nesting level */
+} LockingData_t;
+
+/* Private functions -------------------------------------------------------*/
+
+/**
+  * @brief Initialize STM32 lock
+  * @param lock The lock to init
+  */
+static inline void stm32_lock_init(LockingData_t *lock)
+{
+  STM32_LOCK_BLOCK_IF_NULL_ARGUMENT(lock);
+  lock->basepri = 0;
+  lock->counter = 0;
+}
+
+/**
+  * @brief Acquire STM32 lock
+  * @param lock The lock to acquire
+  */
+static inline void stm32_lock_acquire(LockingData_t *lock)
+{
+  uint8_t basepri = (uint8_t)__get_BASEPRI();
+  __set_BASEPRI_MAX(STM32_LOCK_BASEPRI_VALUE); /* Never lowers the mask */
+  __DSB();
+  __ISB();
+  STM32_LOCK_BLOCK_IF_NULL_ARGUMENT(lock);
+  if (lock->counter == 0)
+  {
+    lock->basepri = basepri;
+  }
+  else if (lock->counter == UINT8_MAX)
+  {
+    STM32_LOCK_BLOCK();
+  }
+  lock->counter++;
+}
+
+/**
+  * @brief Release STM32 lock
+  * @param lock The lock to release
+  */
+static inline void stm32_lock_release(LockingData_t *lock)
+{
+  STM32_LOCK_BLOCK_IF_NULL_ARGUMENT(lock);
+  if (lock->counter == 0)
+  {
+    STM32_LOCK_BLOCK();
+  }
+  lock->counter--;
+  if (lock->counter == 0)
+  {
+    __set_BASEPRI(lock->basepri);
+  }
+}
+
+#undef STM32_LOCK_BASEPRI_VALUE
+#undef STM32_LOCK_PRIO_BITS
+
 #else
 #error Invalid STM32_THREAD_SAFE_STRATEGY specified
 #endif /* STM32_THREAD_SAFE_STRATEGY */
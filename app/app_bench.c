@@ -0,0 +1,1002 @@
+/**
+ * @file app_bench.c
+ * @brief Boot-time microbenchmark suite implementation.
+ *
+ * Each case runs @ref APP_BENCH_ITERATIONS times. Transmission is held
+ * (UartTx_Hold()) while the cases run and the ring is emptied before
+ * every sample, so a case that prints always finds room and nothing it
+ * writes reaches the UART. Timed output paths therefore include the copy
+ * into the ring but not the DMA start, as when the UART is already busy.
+ * Result rows are sent with the hold released.
+ *
+ * @ingroup app_bench
+ */
+
+#include "app_bench.h"
+#include "app_config.h"
+#include "app_task_manager.h"
+#include "cli.h"
+#include "crc32.h"
+#include "cycle_counter.h"
+#include "dsp_kernels.h"
+#include "log.h"
+#include "mem_pool.h"
+#include "ramfunc.h"
+#include "sample_block.h"
+#include "sample_ring.h"
+#include "sensor_calib.h"
+#include "sensor_filter.h"
+#include "sensor_if.h"
+#include "spi_bus.h"
+#include "stm32_lock.h"
+#include "uart_tx.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Tasks registered for the largest scheduler case. */
+#define APP_BENCH_MAX_TASKS   (8U)
+
+/** @brief Longest CLI line used by a dispatch case. */
+#define APP_BENCH_LINE_SIZE   (32U)
+
+/** @brief Devices in the SPI frame case. */
+#define APP_BENCH_SPI_DEVICES (4U)
+
+/** @brief Bytes per SPI segment: a read command and three 16-bit axes. */
+#define APP_BENCH_SPI_LENGTH  (7U)
+
+/** @brief Samples in the block cases (one full block). */
+#define APP_BENCH_BLOCK_SIZE  (SAMPLE_BLOCK_MAX)
+
+/** @brief FIR length and decimation factor of the dsp.fir cases. */
+#define APP_BENCH_FIR_TAPS    (16U)
+#define APP_BENCH_FIR_FACTOR  (4U)
+
+/** @brief Biquad stages of the dsp.biquad cases. */
+#define APP_BENCH_BIQUAD_STAGES (2U)
+
+/** @brief Sensor ID configured for the dsp.filter cases (not registered). */
+#define APP_BENCH_FILTER_ID   (250U)
+
+/** @brief Sensor ID calibrated for the dsp.calib cases (not registered). */
+#define APP_BENCH_CALIB_ID    (251U)
+
+/** @brief Longest buffer of the crc cases (a flash log page without its CRC). */
+#define APP_BENCH_CRC_SIZE    (252U)
+
+/** @brief Block size of the lock.pool and lock.malloc cases (a log record). */
+#define APP_BENCH_ALLOC_SIZE  (32U)
+
+/**
+ * @brief Accumulated timings of one case.
+ */
+typedef struct
+{
+    uint32_t count;  /**< Samples taken.            */
+    uint32_t min;    /**< Shortest sample (ticks).  */
+    uint32_t max;    /**< Longest sample (ticks).   */
+    uint64_t total;  /**< Sum of all samples.       */
+} AppBenchResult_t;
+
+/**
+ * @brief Command lines timed through CLI_ExecuteLine().
+ *
+ * Only commands without side effects on the running system; "log" without
+ * arguments prints its usage text and "nosuch" takes the unknown-command
+ * path.
+ */
+static const char *const s_cliLines[] =
+{
+    "help",
+    "status",
+    "sensors",
+    "tasks",
+    "pools",
+    "mem",
+    "log",
+    "nosuch"
+};
+
+/**
+ * @brief Descriptors of the scheduler cases.
+ */
+static AppTaskDescriptor_t s_benchTasks[APP_BENCH_MAX_TASKS];
+
+/** @brief Devices, buffers and frame of the SPI cases (the "spi test" set). */
+static const SpiBusDevice_t s_spiDevice[APP_BENCH_SPI_DEVICES] =
+{
+    { GPIO_PIN_12, 3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_1,  3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_2,  3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_10, 3U, SPI_BUS_TEST_HZ }
+};
+static const uint8_t   s_spiTx[APP_BENCH_SPI_LENGTH] = { 0xA8U, 0U, 0U, 0U, 0U, 0U, 0U };
+static uint8_t         s_spiRx[APP_BENCH_SPI_DEVICES][APP_BENCH_SPI_LENGTH];
+static SpiBusSegment_t s_spiSegment[APP_BENCH_SPI_DEVICES];
+static SpiBusFrame_t   s_spiFrame;
+
+/** @brief Samples, block and float row of the block cases. */
+static SensorSample_t s_blockSamples[APP_BENCH_BLOCK_SIZE];
+static SampleBlock_t  s_block;
+static float          s_blockValues[APP_BENCH_BLOCK_SIZE];
+
+/**
+ * @brief Low-pass FIR for the decimation cases (Hann-shaped, unity gain),
+ *        q15; the float copy is derived from it.
+ */
+static const int16_t s_firQ15[APP_BENCH_FIR_TAPS] =
+{
+    136, 521, 1101, 1790, 2479, 3057, 3432, 3548,
+    3548, 3432, 3057, 2479, 1790, 1101, 521, 136
+};
+static float   s_firF32[APP_BENCH_FIR_TAPS];
+static int16_t s_firStateQ15[2U * APP_BENCH_FIR_TAPS];
+static float   s_firStateF32[2U * APP_BENCH_FIR_TAPS];
+
+/**
+ * @brief Two Butterworth low-pass sections at fs/10: q14 (postShift 1)
+ *        {b0, 0, b1, b2, a1, a2} and float {b0, b1, b2, a1, a2}.
+ */
+static const int16_t s_biquadQ15[6U * APP_BENCH_BIQUAD_STAGES] =
+{
+    1106, 0, 2210, 1106, 18727, -6763,
+    1106, 0, 2210, 1106, 18727, -6763
+};
+static const float s_biquadF32[5U * APP_BENCH_BIQUAD_STAGES] =
+{
+    0.0675f, 0.1349f, 0.0675f, 1.1430f, -0.4128f,
+    0.0675f, 0.1349f, 0.0675f, 1.1430f, -0.4128f
+};
+
+/** @brief Input and output rows of the kernel cases. */
+static int16_t s_dspInQ15[APP_BENCH_BLOCK_SIZE];
+static int16_t s_dspOutQ15[APP_BENCH_BLOCK_SIZE];
+static float   s_dspOutF32[APP_BENCH_BLOCK_SIZE];
+
+/** @brief rfft case window (the longest spectrum window). */
+static float   s_rfftData[DSP_RFFT_MAX_POINTS];
+
+/** @brief crc case input. */
+static uint8_t s_crcData[APP_BENCH_CRC_SIZE];
+
+/**
+ * @brief Cost of an empty measurement, subtracted from every sample.
+ */
+static uint32_t s_overhead = 0U;
+
+/**
+ * @brief Reset @p result before a case.
+ */
+static void AppBench_Begin(AppBenchResult_t *result);
+
+/**
+ * @brief Discard pending console output and read the clock.
+ *
+ * @return Start time of the sample.
+ */
+static uint32_t AppBench_Start(void);
+
+/**
+ * @brief Fold one sample, started at @p start, into @p result.
+ */
+static void AppBench_Stop(AppBenchResult_t *result, uint32_t start);
+
+/**
+ * @brief Print one result row.
+ *
+ * @param group Case group (e.g. "log").
+ * @param name  Case name within the group.
+ * @param index Appended as ".<index>" unless 0.
+ */
+static void AppBench_Report(const char *group, const char *name, uint32_t index,
+                            const AppBenchResult_t *result);
+
+/**
+ * @brief Clock read overhead.
+ */
+static void AppBench_Calibrate(void);
+
+/**
+ * @brief Log_Print() per level, plus filtered, collapsed and disabled calls.
+ */
+static void AppBench_Log(void);
+
+/**
+ * @brief CLI_ExecuteLine() for each line in @ref s_cliLines.
+ */
+static void AppBench_Cli(void);
+
+/**
+ * @brief Blocking read of the simulated temperature sensor.
+ */
+static void AppBench_Sensor(void);
+
+/**
+ * @brief Sample block cases: gather/scatter and float conversion of a
+ *        full block of 3-channel int16 samples.
+ */
+static void AppBench_Block(void);
+
+/**
+ * @brief Fill the block cases' samples: a ramp on 3 channels, 1 ms apart.
+ */
+static void AppBench_BlockFill(SensorFormat_t format, uint8_t sensorId);
+
+/**
+ * @brief Sample ring readers: draining a full block of samples by copy
+ *        (SampleRing_Pop()) against in place (SampleRing_Claim()), and in
+ *        place as a broadcast reader.
+ */
+static void AppBench_Ring(void);
+
+/**
+ * @brief q15 against float: FIR decimation and biquad kernels on one
+ *        block row, and the filter stage (average + IIR) on a full block
+ *        of int16 and of int32 samples.
+ */
+static void AppBench_Dsp(void);
+
+/**
+ * @brief CRC-32 of a short frame and of a flash log page: table code
+ *        (Crc32_Update()) against Crc32_Compute() with the CRC unit.
+ */
+static void AppBench_Crc(void);
+
+/**
+ * @brief Cost of the STM32_THREAD_SAFE_STRATEGY lock: a bare and a nested
+ *        acquire/release, and the allocations serialized by it.
+ */
+static void AppBench_Lock(void);
+
+/**
+ * @brief AppTaskManager_RunOnce() per pass with 1..APP_BENCH_MAX_TASKS tasks.
+ */
+static void AppBench_Scheduler(void);
+
+/**
+ * @brief SPI bus cases: queueing a four-device frame and the whole frame.
+ */
+static void AppBench_Spi(void);
+
+/**
+ * @brief Wait until the SPI frame case's frame is back.
+ */
+static void AppBench_SpiWait(void);
+
+/**
+ * @brief Empty task body for the scheduler cases.
+ */
+static void AppBench_TaskNop(void);
+
+/* ------------------------------------------------------------------------- */
+
+void AppBench_Run(void)
+{
+    bool       logEnabled = Log_IsEnabled();
+    LogLevel_t logLevel   = Log_GetLevel();
+
+    UartTx_Flush();
+    CycleCounter_Init();
+
+    CLI_Print("\r\n#bench,v1,clock_hz=%lu,iterations=%u,backend=%s,log=%s,ramfunc=%u,lock=%u\r\n",
+              (unsigned long)AppBench_ClockHz(),
+              (unsigned)APP_BENCH_ITERATIONS,
+              (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP) ? "heap" : "linear",
+              (LOG_BINARY_MODE != 0) ? "binary" : "text",
+              (unsigned)RAMFUNC_ENABLE,
+              (unsigned)STM32_THREAD_SAFE_STRATEGY);
+    UartTx_Flush();
+    UartTx_Hold(true);
+
+    AppBench_Calibrate();
+    AppBench_Log();
+    AppBench_Sensor();
+    AppBench_Block();
+    AppBench_Ring();
+    AppBench_Dsp();
+    AppBench_Crc();
+    AppBench_Lock();
+    AppBench_Spi();
+
+    /* Registration messages are not part of any case. */
+    Log_Enable(false);
+    AppBench_Scheduler();
+    AppBench_Cli();
+
+    Log_SetLevel(logLevel);
+    Log_Enable(logEnabled);
+
+    CLI_Print("#bench,end\r\n");
+    UartTx_Flush();
+}
+
+__attribute__((weak)) uint32_t AppBench_ClockNow(void)
+{
+    return CycleCounter_Now();
+}
+
+__attribute__((weak)) uint32_t AppBench_ClockHz(void)
+{
+    return SystemCoreClock;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void AppBench_Begin(AppBenchResult_t *result)
+{
+    result->count = 0U;
+    result->min   = UINT32_MAX;
+    result->max   = 0U;
+    result->total = 0U;
+}
+
+static uint32_t AppBench_Start(void)
+{
+    UartTx_DiscardPending();
+
+    return AppBench_ClockNow();
+}
+
+static void AppBench_Stop(AppBenchResult_t *result, uint32_t start)
+{
+    uint32_t ticks = AppBench_ClockNow() - start;
+
+    ticks = (ticks > s_overhead) ? (ticks - s_overhead) : 0U;
+
+    result->count++;
+    result->total += ticks;
+    if (ticks < result->min)
+    {
+        result->min = ticks;
+    }
+    if (ticks > result->max)
+    {
+        result->max = ticks;
+    }
+}
+
+static void AppBench_Report(const char *group, const char *name, uint32_t index,
+                            const AppBenchResult_t *result)
+{
+    uint32_t avg = (result->count > 0U) ? (uint32_t)(result->total / result->count) : 0U;
+    uint32_t min = (result->count > 0U) ? result->min : 0U;
+
+    UartTx_DiscardPending();
+
+    if (index != 0U)
+    {
+        CLI_Print("bench,%s.%s.%lu,%lu,%lu,%lu,%lu\r\n", group, name, (unsigned long)index,
+                  (unsigned long)result->count, (unsigned long)min,
+                  (unsigned long)avg, (unsigned long)result->max);
+    }
+    else
+    {
+        CLI_Print("bench,%s.%s,%lu,%lu,%lu,%lu\r\n", group, name,
+                  (unsigned long)result->count, (unsigned long)min,
+                  (unsigned long)avg, (unsigned long)result->max);
+    }
+    UartTx_Flush();
+    UartTx_Hold(true);
+}
+
+static void AppBench_Calibrate(void)
+{
+    AppBenchResult_t result;
+    AppBench_Begin(&result);
+
+    s_overhead = 0U;
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        AppBench_Stop(&result, start);
+    }
+
+    AppBench_Report("clock", "overhead", 0U, &result);
+    s_overhead = result.min;
+}
+
+static void AppBench_Log(void)
+{
+    AppBenchResult_t result;
+    bool             limited = Log_IsRateLimited();
+
+    /* Every case but warn_repeat measures lines that are printed. */
+    Log_SetRateLimit(false);
+    Log_SetLevel(LOG_LEVEL_INFO);
+    Log_Enable(true);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_DEBUG("bench sample %lu", (unsigned long)i);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "debug_filtered", 0U, &result);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_INFO("bench sample %lu", (unsigned long)i);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "info", 0U, &result);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_WARN("bench sample %lu", (unsigned long)i);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "warn", 0U, &result);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_ERROR("bench sample %lu", (unsigned long)i);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "error", 0U, &result);
+
+    /* The line App_TaskSampleLog() prints for every reported sample. */
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        float value = 21.5f + (0.01f * (float)i);
+
+        uint32_t start = AppBench_Start();
+        LOG_INFO("SensorSample: %s value=%.2f (raw %.2f), timestamp=%lu ms, mode=%d",
+                 "SimTemp", value, value, (unsigned long)i, 0);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "info_sample", 0U, &result);
+
+    /* A failing call site: the same warning every time, collapsed after
+     * the first one by the rate limiter.
+     */
+    Log_SetRateLimit(true);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_WARN("bench sensor read failed");
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "warn_repeat", 0U, &result);
+    Log_SetRateLimit(limited);
+
+    Log_Enable(false);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        LOG_ERROR("bench sample %lu", (unsigned long)i);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("log", "disabled", 0U, &result);
+}
+
+static void AppBench_Cli(void)
+{
+    char line[APP_BENCH_LINE_SIZE];
+
+    for (uint32_t c = 0U; c < (sizeof(s_cliLines) / sizeof(s_cliLines[0])); ++c)
+    {
+        AppBenchResult_t result;
+        AppBench_Begin(&result);
+
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            /* Tokenizing modifies the line: copy it outside the timing. */
+            (void)strncpy(line, s_cliLines[c], sizeof(line) - 1U);
+            line[sizeof(line) - 1U] = '\0';
+
+            uint32_t start = AppBench_Start();
+            CLI_ExecuteLine(line);
+            AppBench_Stop(&result, start);
+        }
+
+        AppBench_Report("cli", s_cliLines[c], 0U, &result);
+    }
+}
+
+static void AppBench_Sensor(void)
+{
+    const SensorIF_t *sensor = Sensor_GetInterface();
+    SensorData_t      data;
+    AppBenchResult_t  result;
+
+    if ((sensor == NULL) || (sensor->read == NULL) ||
+        ((sensor->init != NULL) && !sensor->init()))
+    {
+        return;
+    }
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)sensor->read(&data);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("sensor", "simtemp_read", 0U, &result);
+}
+
+static void AppBench_Block(void)
+{
+    AppBenchResult_t result;
+
+    AppBench_BlockFill(SENSOR_FORMAT_S16, 1U);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)SampleBlock_Gather(&s_block, s_blockSamples, APP_BENCH_BLOCK_SIZE);
+        SampleBlock_Scatter(&s_block, s_blockSamples);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("block", "gather_scatter", 0U, &result);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        SampleBlock_ToFloat(&s_block, 0U, s_blockValues);
+        SampleBlock_FromFloat(&s_block, 0U, s_blockValues);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("block", "float_row", 0U, &result);
+}
+
+static void AppBench_Ring(void)
+{
+    static SampleRingReader_t reader;
+    AppBenchResult_t  result;
+    SensorSample_t    sample;
+    volatile uint32_t sink = 0U;
+
+    AppBench_BlockFill(SENSOR_FORMAT_S16, 1U);
+
+    /* The application has not started: the ring is the suite's own. */
+    SampleRing_Init();
+    SampleRing_AddReader(&reader, "bench");
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        for (uint32_t n = 0U; n < APP_BENCH_BLOCK_SIZE; ++n)
+        {
+            (void)SampleRing_Push(&s_blockSamples[n]);
+        }
+
+        uint32_t start = AppBench_Start();
+        while (SampleRing_Pop(&reader, &sample))
+        {
+            sink += sample.timestamp;
+        }
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("ring", "pop", 0U, &result);
+
+    /* In place, as a reader the producer waits for and as a broadcast one. */
+    for (uint32_t b = 0U; b < 2U; ++b)
+    {
+        if (b != 0U)
+        {
+            SampleRing_Init();
+            SampleRing_AddBroadcastReader(&reader, "bench");
+        }
+
+        AppBench_Begin(&result);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            for (uint32_t n = 0U; n < APP_BENCH_BLOCK_SIZE; ++n)
+            {
+                (void)SampleRing_Push(&s_blockSamples[n]);
+            }
+
+            uint32_t start = AppBench_Start();
+            const SensorSample_t *span;
+            uint32_t count;
+            while ((count = SampleRing_Claim(&reader, &span)) != 0U)
+            {
+                for (uint32_t n = 0U; n < count; ++n)
+                {
+                    sink += span[n].timestamp;
+                }
+                (void)SampleRing_Release(&reader, count);
+            }
+            AppBench_Stop(&result, start);
+        }
+        AppBench_Report("ring", (b != 0U) ? "broadcast" : "claim", 0U, &result);
+    }
+
+    SampleRing_Init();
+    (void)sink;
+}
+
+static void AppBench_BlockFill(SensorFormat_t format, uint8_t sensorId)
+{
+    for (uint32_t n = 0U; n < APP_BENCH_BLOCK_SIZE; ++n)
+    {
+        SensorSample_t *sample = &s_blockSamples[n];
+
+        sample->sensorId = sensorId;
+        SensorData_Init(sample, format, 3U, -2);
+        sample->timestamp = n;
+        for (uint32_t c = 0U; c < 3U; ++c)
+        {
+            SensorData_SetRaw(sample, c, (int32_t)((n * 37U) + c));
+        }
+    }
+}
+
+static void AppBench_Dsp(void)
+{
+    DspFirDecimateQ15_t firQ15;
+    DspFirDecimateF32_t firF32;
+    DspBiquadQ15_t      biquadQ15;
+    DspBiquadF32_t      biquadF32;
+    DspRfftF32_t        rfft;
+    AppBenchResult_t    result;
+
+    for (uint32_t k = 0U; k < APP_BENCH_FIR_TAPS; ++k)
+    {
+        s_firF32[k] = (float)s_firQ15[k] / 32768.0f;
+    }
+    for (uint32_t n = 0U; n < APP_BENCH_BLOCK_SIZE; ++n)
+    {
+        s_dspInQ15[n]    = (int16_t)((n * 977U) & 0x3FFFU);
+        s_blockValues[n] = (float)s_dspInQ15[n] / 32768.0f;
+    }
+
+    (void)Dsp_FirDecimateInitQ15(&firQ15, s_firQ15, APP_BENCH_FIR_TAPS, APP_BENCH_FIR_FACTOR,
+                                 s_firStateQ15);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)Dsp_FirDecimateQ15(&firQ15, s_dspInQ15, s_dspOutQ15, APP_BENCH_BLOCK_SIZE);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "fir_q15", 0U, &result);
+
+    (void)Dsp_FirDecimateInitF32(&firF32, s_firF32, APP_BENCH_FIR_TAPS, APP_BENCH_FIR_FACTOR,
+                                 s_firStateF32);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)Dsp_FirDecimateF32(&firF32, s_blockValues, s_dspOutF32, APP_BENCH_BLOCK_SIZE);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "fir_f32", 0U, &result);
+
+    (void)Dsp_BiquadInitQ15(&biquadQ15, APP_BENCH_BIQUAD_STAGES, s_biquadQ15, 1U);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        Dsp_BiquadQ15(&biquadQ15, s_dspInQ15, s_dspOutQ15, APP_BENCH_BLOCK_SIZE);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "biquad_q15", 0U, &result);
+
+    (void)Dsp_BiquadInitF32(&biquadF32, APP_BENCH_BIQUAD_STAGES, s_biquadF32);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        Dsp_BiquadF32(&biquadF32, s_blockValues, s_dspOutF32, APP_BENCH_BLOCK_SIZE);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "biquad_f32", 0U, &result);
+
+    /* One spectrum window: Hann window and the transform, refilled each time. */
+    (void)Dsp_RfftInitF32(&rfft, DSP_RFFT_MAX_POINTS);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        for (uint32_t n = 0U; n < DSP_RFFT_MAX_POINTS; ++n)
+        {
+            s_rfftData[n] = s_blockValues[n % APP_BENCH_BLOCK_SIZE];
+        }
+
+        uint32_t start = AppBench_Start();
+        Dsp_WindowHannF32(&rfft, s_rfftData);
+        Dsp_RfftF32(&rfft, s_rfftData);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "rfft_f32", 0U, &result);
+
+    /* Filter stage: int16 samples take the q15 path, int32 the float one. */
+    const SensorFilterConfig_t chain = { .medianWindow = 0U, .averageWindow = 8U, .iirAlpha = 0.25f };
+    const SensorFilterConfig_t off   = { 0 };
+    static const struct
+    {
+        SensorFormat_t format;
+        const char    *name;
+    } s_filterCases[] =
+    {
+        { SENSOR_FORMAT_S16, "filter_q15" },
+        { SENSOR_FORMAT_S32, "filter_f32" }
+    };
+
+    for (uint32_t c = 0U; c < (sizeof(s_filterCases) / sizeof(s_filterCases[0])); ++c)
+    {
+        AppBench_BlockFill(s_filterCases[c].format, APP_BENCH_FILTER_ID);
+        if (!SensorFilter_Configure(APP_BENCH_FILTER_ID, &chain))
+        {
+            return;
+        }
+
+        AppBench_Begin(&result);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            uint32_t start = AppBench_Start();
+            SensorFilter_ProcessSamples(s_blockSamples, APP_BENCH_BLOCK_SIZE);
+            AppBench_Stop(&result, start);
+        }
+        AppBench_Report("dsp", s_filterCases[c].name, 0U, &result);
+    }
+
+    (void)SensorFilter_Configure(APP_BENCH_FILTER_ID, &off);
+
+    /* Calibration stage: a cubic by table lookup, against evaluating it per
+     * sample in float, on one block row. The block is refilled untimed: a
+     * correction is not idempotent.
+     */
+    SensorCalibConfig_t curve;
+    SensorCalib_Identity(&curve);
+    curve.coeff[0] = 0.25f;
+    curve.coeff[2] = 2e-3f;
+    curve.coeff[3] = -1e-4f;
+    curve.hi       = 12.0f;
+
+    static const struct
+    {
+        SensorFormat_t format;
+        const char    *name;
+    } s_calibCases[] =
+    {
+        { SENSOR_FORMAT_S16, "calib_s16" },
+        { SENSOR_FORMAT_S32, "calib_s32" }
+    };
+
+    if (!SensorCalib_Configure(APP_BENCH_CALIB_ID, &curve))
+    {
+        return;
+    }
+
+    for (uint32_t c = 0U; c < (sizeof(s_calibCases) / sizeof(s_calibCases[0])); ++c)
+    {
+        AppBench_Begin(&result);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            AppBench_BlockFill(s_calibCases[c].format, APP_BENCH_CALIB_ID);
+            (void)SampleBlock_Gather(&s_block, s_blockSamples, APP_BENCH_BLOCK_SIZE);
+
+            uint32_t start = AppBench_Start();
+            SensorCalib_ProcessBlock(&s_block);
+            AppBench_Stop(&result, start);
+        }
+        AppBench_Report("dsp", s_calibCases[c].name, 0U, &result);
+    }
+
+    AppBench_BlockFill(SENSOR_FORMAT_S16, APP_BENCH_CALIB_ID);
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        (void)SampleBlock_Gather(&s_block, s_blockSamples, APP_BENCH_BLOCK_SIZE);
+
+        uint32_t start = AppBench_Start();
+        SampleBlock_ToFloat(&s_block, 0U, s_blockValues);
+        for (uint32_t n = 0U; n < APP_BENCH_BLOCK_SIZE; ++n)
+        {
+            float x = s_blockValues[n];
+            s_blockValues[n] = ((((curve.coeff[3] * x) + curve.coeff[2]) * x + curve.coeff[1]) * x) +
+                               curve.coeff[0];
+        }
+        SampleBlock_FromFloat(&s_block, 0U, s_blockValues);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("dsp", "calib_poly_f32", 0U, &result);
+
+    (void)SensorCalib_Configure(APP_BENCH_CALIB_ID, NULL);
+}
+
+static void AppBench_Crc(void)
+{
+    static const uint32_t sizes[] = { 32U, APP_BENCH_CRC_SIZE };
+    AppBenchResult_t result;
+    volatile uint32_t sink;
+
+    for (uint32_t i = 0U; i < APP_BENCH_CRC_SIZE; ++i)
+    {
+        s_crcData[i] = (uint8_t)((i * 97U) + 13U);
+    }
+
+    for (uint32_t s = 0U; s < (sizeof(sizes) / sizeof(sizes[0])); ++s)
+    {
+        AppBench_Begin(&result);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            uint32_t start = AppBench_Start();
+            sink = Crc32_Update(CRC32_INIT, s_crcData, sizes[s]);
+            AppBench_Stop(&result, start);
+        }
+        AppBench_Report("crc", "table", sizes[s], &result);
+
+        AppBench_Begin(&result);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            uint32_t start = AppBench_Start();
+            sink = Crc32_Compute(s_crcData, sizes[s]);
+            AppBench_Stop(&result, start);
+        }
+        AppBench_Report("crc", "compute", sizes[s], &result);
+    }
+    (void)sink;
+}
+
+static void AppBench_Lock(void)
+{
+    static LockingData_t lock = LOCKING_DATA_INIT;
+    AppBenchResult_t     result;
+    void *volatile       block;   /* keeps the pair from being folded away */
+
+    stm32_lock_init(&lock);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        stm32_lock_acquire(&lock);
+        stm32_lock_release(&lock);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("lock", "acquire_release", 0U, &result);
+
+    /* As when a locked allocation runs inside a locked stdio call. */
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        stm32_lock_acquire(&lock);
+        stm32_lock_acquire(&lock);
+        stm32_lock_release(&lock);
+        stm32_lock_release(&lock);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("lock", "nested", 0U, &result);
+
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        MemPool_Free(MemPool_Alloc(APP_BENCH_ALLOC_SIZE));
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("lock", "pool", 0U, &result);
+
+    /* newlib's malloc lock around the pools, or the host allocator. */
+    AppBench_Begin(&result);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        block = malloc(APP_BENCH_ALLOC_SIZE);
+        free(block);
+        AppBench_Stop(&result, start);
+    }
+    AppBench_Report("lock", "malloc", 0U, &result);
+}
+
+static void AppBench_Scheduler(void)
+{
+    for (uint32_t n = 1U; n <= APP_BENCH_MAX_TASKS; ++n)
+    {
+        AppBenchResult_t idle;
+        AppBenchResult_t due;
+
+        /* n tasks that are never due during the case. */
+        AppTaskManager_Init();
+        (void)memset(s_benchTasks, 0, sizeof(s_benchTasks));
+        for (uint32_t t = 0U; t < n; ++t)
+        {
+            s_benchTasks[t].name      = "Bench";
+            s_benchTasks[t].function  = AppBench_TaskNop;
+            s_benchTasks[t].period_ms = 60000U + t;
+            (void)AppTaskManager_RegisterTask(&s_benchTasks[t]);
+        }
+
+        AppBench_Begin(&idle);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            uint32_t start = AppBench_Start();
+            AppTaskManager_RunOnce();
+            AppBench_Stop(&idle, start);
+        }
+        AppBench_Report("sched", "idle", n, &idle);
+
+        /* Same set with one task due on every pass (period 0). */
+        AppTaskManager_Init();
+        s_benchTasks[0].period_ms = 0U;
+        for (uint32_t t = 0U; t < n; ++t)
+        {
+            (void)AppTaskManager_RegisterTask(&s_benchTasks[t]);
+        }
+
+        AppBench_Begin(&due);
+        for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+        {
+            uint32_t start = AppBench_Start();
+            AppTaskManager_RunOnce();
+            AppBench_Stop(&due, start);
+        }
+        AppBench_Report("sched", "one_due", n, &due);
+    }
+
+    AppTaskManager_Init();
+}
+
+static void AppBench_Spi(void)
+{
+    AppBenchResult_t submit;
+    AppBenchResult_t frame;
+
+    SpiBus_Init();
+    for (uint32_t d = 0U; d < APP_BENCH_SPI_DEVICES; ++d)
+    {
+        SpiBus_InitDevice(&s_spiDevice[d]);
+        s_spiSegment[d].device = &s_spiDevice[d];
+        s_spiSegment[d].tx     = s_spiTx;
+        s_spiSegment[d].rx     = s_spiRx[d];
+        s_spiSegment[d].length = APP_BENCH_SPI_LENGTH;
+    }
+
+    (void)memset(&s_spiFrame, 0, sizeof(s_spiFrame));
+    s_spiFrame.segments = s_spiSegment;
+    s_spiFrame.count    = APP_BENCH_SPI_DEVICES;
+
+    /* CPU cost of queueing a frame on an idle bus (starts the first segment). */
+    AppBench_Begin(&submit);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)SpiBus_Submit(&s_spiFrame);
+        AppBench_Stop(&submit, start);
+        AppBench_SpiWait();
+    }
+    AppBench_Report("spi", "submit", 0U, &submit);
+
+    /* Submit to callback: wire time of four segments plus the chaining. */
+    AppBench_Begin(&frame);
+    for (uint32_t i = 0U; i < APP_BENCH_ITERATIONS; ++i)
+    {
+        uint32_t start = AppBench_Start();
+        (void)SpiBus_Submit(&s_spiFrame);
+        AppBench_SpiWait();
+        AppBench_Stop(&frame, start);
+    }
+    AppBench_Report("spi", "frame4", 0U, &frame);
+}
+
+static void AppBench_SpiWait(void)
+{
+    while (s_spiFrame.state != SPI_BUS_FRAME_DONE)
+    {
+        SpiBus_Service(HAL_GetTick());
+    }
+}
+
+static void AppBench_TaskNop(void)
+{
+    __NOP();
+}
@@ -0,0 +1,80 @@
+/**
+ * @file app_bench.h
+ * @brief Boot-time microbenchmark suite for the Smart Sensor Hub.
+ *
+ * Built into every image but only run when @ref APP_BENCH_ENABLE is set:
+ * main() then calls AppBench_Run() after the console is up and before
+ * App_MainInit(). The suite times the hot paths that optimizations are
+ * aimed at and prints one CSV row per case:
+ *
+ * @code
+ * #bench,v1,clock_hz=180000000,iterations=64,backend=heap,log=text,ramfunc=1,lock=2
+ * bench,<case>,<iterations>,<min>,<avg>,<max>
+ * ...
+ * #bench,end
+ * @endcode
+ *
+ * Times are in ticks of the benchmark clock (clock_hz): DWT cycles on the
+ * MCU, nanoseconds in the host simulation. The cost of reading the clock
+ * is measured first and subtracted. Interrupts stay enabled, so max can
+ * include an interrupt; compare min and avg between builds.
+ *
+ * tools/bench_compare.py compares two captures.
+ *
+ * @ingroup app
+ */
+
+#ifndef APP_BENCH_H
+#define APP_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @defgroup app_bench Benchmark Suite
+ * @brief Timed runs of logging, CLI dispatch, sensor read, SPI bus and
+ *        scheduler.
+ * @ingroup app
+ * @{
+ */
+
+/**
+ * @brief Run every benchmark case and print the results.
+ *
+ * Leaves the task manager empty (it is used for the scheduler cases), so
+ * App_MainInit() must run afterwards. Log output produced by the cases is
+ * discarded from the TX ring and never reaches the UART.
+ *
+ * @return None.
+ */
+void AppBench_Run(void);
+
+/**
+ * @brief Read the benchmark clock.
+ *
+ * Weak; defaults to the DWT cycle counter. The host simulation, where
+ * firmware code takes no simulated time, overrides it with a host clock.
+ *
+ * @return Free-running tick count (wraps at 32 bits).
+ */
+uint32_t AppBench_ClockNow(void);
+
+/**
+ * @brief Frequency of the benchmark clock.
+ *
+ * Weak, like AppBench_ClockNow(); defaults to SystemCoreClock.
+ *
+ * @return Ticks per second.
+ */
+uint32_t AppBench_ClockHz(void);
+
+/** @} */ /* end of app_bench group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_BENCH_H */
@@ -19,6 +19,14 @@
 /**
  * @name Sensor sampling periods per power mode
  * @brief Logical sampling intervals that depend on the current power mode.
+ *
+ * These are the per-mode periods of the on-board simulated temperature
+ * sensor. Every sensor in the registry carries its own table.
+ *
+ * For sensors with a hardware FIFO (readBatch() in @ref SensorIF_t) the
+ * period is the FIFO watermark interval: the sensor keeps sampling at its
+ * own output data rate and the hub wakes once per period to drain it. The
+ * simulated sensor samples at 1 Hz into a 32-entry FIFO.
  * @{
  */
 
@@ -38,7 +46,1173 @@
  */
 #define SENSOR_PERIOD_STOP_MS     (0U)       /**< 0 => no sampling in STOP.  */
 
+/**
+ * @brief Shortest period of the sensor sampling task (ms).
+ *
+ * The task re-arms itself for the next due sensor; this bounds how often
+ * it can run when several sensors have short, unaligned periods.
+ */
+#define SENSOR_SERVICE_MIN_PERIOD_MS   (10U)
+
+/**
+ * @brief Sensor sampling task period while an asynchronous read is pending (ms).
+ *
+ * Short, so a completed bus transfer is picked up promptly.
+ */
+#define SENSOR_SERVICE_POLL_PERIOD_MS  (1U)
+
+/**
+ * @brief Longest period of the sensor sampling task (ms).
+ *
+ * Only a backstop: the task sleeps until the next sensor is due, and a
+ * power mode change, a configuration change or a new sensor re-arms it
+ * through the registry's schedule hook. Keeps the release within the
+ * wrap-safe half of the tick range for very long sample periods; with
+ * nothing to sample the task is disabled instead.
+ */
+#define SENSOR_SERVICE_MAX_PERIOD_MS   (3600000U)
+
+/**
+ * @brief Run-time budget of the sensor sampling task (us).
+ *
+ * Runs above it are counted as budget overruns (`tasks`, column bovr).
+ * Sized for the simulated sensor plus a 32-entry FIFO drain.
+ */
+#define SENSOR_SERVICE_BUDGET_US       (500U)
+
+/**
+ * @brief Period of the task that drains the sample ring into the log (ms).
+ *
+ * Together with SAMPLE_RING_SIZE this bounds how many samples may arrive
+ * between two drains before the ring overruns.
+ */
+#define SAMPLE_LOG_PERIOD_MS           (50U)
+
+/**
+ * @brief Samples taken from the ring per filter block.
+ */
+#define SAMPLE_LOG_BLOCK_SIZE          (16U)
+
+/**
+ * @brief Default filter chain of the simulated temperature sensor.
+ *
+ * See sensor_filter.h; 0 disables a stage. Changeable with `filter`.
+ */
+#ifndef SIMTEMP_FILTER_MEDIAN_WINDOW
+#define SIMTEMP_FILTER_MEDIAN_WINDOW   (3U)
+#endif
+#ifndef SIMTEMP_FILTER_AVERAGE_WINDOW
+#define SIMTEMP_FILTER_AVERAGE_WINDOW  (0U)
+#endif
+#ifndef SIMTEMP_FILTER_IIR_ALPHA
+#define SIMTEMP_FILTER_IIR_ALPHA       (0.0f)
+#endif
+
+/**
+ * @brief Report-by-exception settings of the simulated temperature sensor.
+ *
+ * A filtered sample is only logged when it moved by more than
+ * SIMTEMP_DEADBAND (°C) since the last logged one, or after
+ * SIMTEMP_MAX_SILENCE_MS without a report. Changeable with `deadband`.
+ */
+#ifndef SIMTEMP_DEADBAND
+#define SIMTEMP_DEADBAND               (0.1f)
+#endif
+#ifndef SIMTEMP_MAX_SILENCE_MS
+#define SIMTEMP_MAX_SILENCE_MS         (60000U)
+#endif
+
 /** @} */ /* end of Sensor sampling periods group */
+
+/**
+ * @name Synthetic sensor farm
+ * @{
+ */
+
+/**
+ * @brief Number of farm channels registered at boot.
+ *
+ * The farm is a load generator; scale it at runtime with `farm <n>`.
+ */
+#ifndef SENSOR_FARM_DEFAULT_COUNT
+#define SENSOR_FARM_DEFAULT_COUNT      (0U)
+#endif
+
+/** @} */ /* end of Synthetic sensor farm group */
+
+/**
+ * @name ADC sensors
+ * @{
+ */
+
+/** @brief Register the on-chip ADC channels (1) or leave ADC1 unused (0). */
+#ifndef SENSOR_ADC_ENABLE
+#define SENSOR_ADC_ENABLE              (1)
+#endif
+
+/** @brief Scan (trigger) rate of the ADC channels in Hz. Must divide 1 MHz. */
+#ifndef SENSOR_ADC_SCAN_HZ
+#define SENSOR_ADC_SCAN_HZ             (1000U)
+#endif
+
+/**
+ * @brief Scans summed into one sample in ACTIVE mode (multiple of 16).
+ *
+ * 256 scans add 4 bits of resolution and give one sample every 256 ms at
+ * the default scan rate.
+ */
+#ifndef SENSOR_ADC_OVERSAMPLE
+#define SENSOR_ADC_OVERSAMPLE          (256U)
+#endif
+
+/**
+ * @brief Scans summed into one sample in IDLE mode (multiple of 16).
+ *
+ * The scan rate stays the same, so a lower output rate costs nothing in
+ * fidelity: every conversion still contributes. 1024 scans: one sample
+ * every 1.024 s.
+ */
+#ifndef SENSOR_ADC_OVERSAMPLE_IDLE
+#define SENSOR_ADC_OVERSAMPLE_IDLE     (1024U)
+#endif
+
+/** @brief Registry drain period of the ADC channels in ACTIVE mode. */
+#ifndef SENSOR_ADC_PERIOD_ACTIVE_MS
+#define SENSOR_ADC_PERIOD_ACTIVE_MS    (1000U)
+#endif
+
+/**
+ * @brief Registry drain period in IDLE mode.
+ *
+ * Conversions keep running; samples beyond the FIFO depth are dropped.
+ * The ADC is stopped in SLEEP and STOP.
+ */
+#ifndef SENSOR_ADC_PERIOD_IDLE_MS
+#define SENSOR_ADC_PERIOD_IDLE_MS      (5000U)
+#endif
+
+/** @} */ /* end of ADC sensors group */
+
+/**
+ * @name Sensor discovery
+ * @{
+ */
+
+/** @brief Probe the known I2C/SPI parts at boot (1) or leave the buses to the drivers (0). */
+#ifndef SENSOR_DISCOVERY_ENABLE
+#define SENSOR_DISCOVERY_ENABLE        (1)
+#endif
+
+/** @brief Sampling period of a discovered part in ACTIVE mode (ms). */
+#ifndef SENSOR_DISCOVERY_PERIOD_ACTIVE_MS
+#define SENSOR_DISCOVERY_PERIOD_ACTIVE_MS (100U)
+#endif
+
+/** @brief Sampling period in IDLE mode (ms); not sampled in SLEEP and STOP. */
+#ifndef SENSOR_DISCOVERY_PERIOD_IDLE_MS
+#define SENSOR_DISCOVERY_PERIOD_IDLE_MS   (1000U)
+#endif
+
+/** @} */ /* end of Sensor discovery group */
+
+/**
+ * @name Synchronous acquisition
+ * @{
+ */
+
+/** @brief Sync group frame rate in ACTIVE mode (Hz, must divide 10000). */
+#ifndef SENSOR_SYNC_HZ_ACTIVE
+#define SENSOR_SYNC_HZ_ACTIVE          (10U)
+#endif
+
+/** @brief Sync group frame rate in IDLE mode (Hz); the group stops in SLEEP and STOP. */
+#ifndef SENSOR_SYNC_HZ_IDLE
+#define SENSOR_SYNC_HZ_IDLE            (1U)
+#endif
+
+/** @} */ /* end of Synchronous acquisition group */
+
+/**
+ * @name I2C bus
+ * @brief Shared I2C1 bus (PB8 SCL, PB9 SDA), see i2c_bus.h.
+ * @{
+ */
+
+/** @brief SCL frequency (Hz); above 100 kHz the controller runs in fast mode. */
+#ifndef I2C_BUS_SPEED_HZ
+#define I2C_BUS_SPEED_HZ               (400000U)
+#endif
+
+/** @brief A transaction still running after this long is aborted (ms). */
+#ifndef I2C_BUS_TIMEOUT_MS
+#define I2C_BUS_TIMEOUT_MS             (20U)
+#endif
+
+/** @} */ /* end of I2C bus group */
+
+/**
+ * @name SPI bus
+ * @brief Shared SPI2 bus (PB13 SCK, PB14 MISO, PB15 MOSI), see spi_bus.h.
+ * @{
+ */
+
+/** @brief A frame still running after this long is aborted (ms). */
+#ifndef SPI_BUS_TIMEOUT_MS
+#define SPI_BUS_TIMEOUT_MS             (5U)
+#endif
+
+/** @brief SCK limit of the "spi test" devices (Hz). */
+#ifndef SPI_BUS_TEST_HZ
+#define SPI_BUS_TEST_HZ                (10000000U)
+#endif
+
+/** @} */ /* end of SPI bus group */
+
+/**
+ * @name Console UART
+ * @{
+ */
+
+/**
+ * @brief Console baud rate after boot (the `baud` setting's default).
+ *
+ * The ST-LINK virtual COM port follows up to about 2 Mbaud.
+ */
+#ifndef CONSOLE_BAUD_DEFAULT
+#define CONSOLE_BAUD_DEFAULT           (115200U)
+#endif
+
+/**
+ * @brief Largest relative baud rate error accepted, in parts per thousand.
+ *
+ * The receiver tolerates roughly 3-4 % in total, shared by both ends.
+ */
+#ifndef CONSOLE_BAUD_TOLERANCE_PPT
+#define CONSOLE_BAUD_TOLERANCE_PPT     (20U)
+#endif
+
+/** @} */ /* end of Console UART group */
+
+/**
+ * @name USB console
+ * @brief CDC-ACM port on USB OTG FS (usb_cdc.h).
+ * @{
+ */
+
+/**
+ * @brief Bring up the USB device (1) or leave OTG FS unused (0).
+ *
+ * The Nucleo-64 has no USB device connector: PA11 (D-) and PA12 (D+) are
+ * on the morpho header and need a breakout. The 48 MHz clock comes from
+ * PLLSAI fed by HSE, so HSE stays on in every clock profile.
+ */
+#ifndef USB_CDC_ENABLE
+#define USB_CDC_ENABLE                 (0)
+#endif
+
+/** @brief USB vendor ID (ST). */
+#ifndef USB_CDC_VID
+#define USB_CDC_VID                    (0x0483U)
+#endif
+
+/** @brief USB product ID (ST virtual COM port). */
+#ifndef USB_CDC_PID
+#define USB_CDC_PID                    (0x5740U)
+#endif
+
+/**
+ * @brief Time a bulk IN transfer may wait for the host before it is
+ *        dropped and output falls back to the UART.
+ */
+#ifndef USB_CDC_TX_TIMEOUT_MS
+#define USB_CDC_TX_TIMEOUT_MS          (100U)
+#endif
+
+/** @} */ /* end of USB console group */
+
+/**
+ * @name Telemetry
+ * @{
+ */
+
+/**
+ * @brief Send samples as binary telemetry frames from boot (1) or as log
+ *        lines until `telem on` (0).
+ */
+#ifndef TELEMETRY_ENABLE_DEFAULT
+#define TELEMETRY_ENABLE_DEFAULT       (0)
+#endif
+
+/**
+ * @brief Default interval (ms) of the metrics export while telemetry is on
+ *        (`metrics_period` setting, 0 = off).
+ */
+#ifndef METRICS_TELEMETRY_MS
+#define METRICS_TELEMETRY_MS           (5000U)
+#endif
+
+/**
+ * @brief Send telemetry on its own UART (1) or on the console (0).
+ *
+ * USART1 TX on PA9 (D8 on the Arduino header) with DMA2 Stream7, for a
+ * second USB-serial adapter; the console keeps the CLI and the log.
+ */
+#ifndef TELEMETRY_UART_ENABLE
+#define TELEMETRY_UART_ENABLE          (0)
+#endif
+
+/**
+ * @brief Telemetry UART baud rate after boot (the `telem_baud` setting's
+ *        default). USART1 runs on APB2, up to PCLK2 / 16.
+ */
+#ifndef TELEMETRY_UART_BAUD_DEFAULT
+#define TELEMETRY_UART_BAUD_DEFAULT    (921600U)
+#endif
+
+/** @} */ /* end of Telemetry group */
+
+/**
+ * @name Flash sample log
+ * @{
+ */
+
+/**
+ * @brief Store reported samples in the on-chip flash log from boot (1),
+ *        or only after `flashlog on` (0).
+ */
+#ifndef FLASH_LOG_ENABLE_DEFAULT
+#define FLASH_LOG_ENABLE_DEFAULT       (1)
+#endif
+
+/** @brief Period of the FlashLog task (page programming, erase, dump). */
+#define FLASH_LOG_SERVICE_PERIOD_MS    (100U)
+
+/** @brief Period of the FlashLog task in STOP, where nothing new is logged (ms). */
+#define FLASH_LOG_SERVICE_PERIOD_STOP_MS (1000U)
+
+/** @} */ /* end of Flash sample log group */
+
+/**
+ * @name Sample archive
+ * @brief External SPI NOR flash on the SPI bus (sample_archive.h).
+ * @{
+ */
+
+/**
+ * @brief Archive reported samples from boot (1), or only after
+ *        `archive on` (0). Without a device nothing is stored either way.
+ */
+#ifndef SAMPLE_ARCHIVE_ENABLE_DEFAULT
+#define SAMPLE_ARCHIVE_ENABLE_DEFAULT  (1)
+#endif
+
+/** @brief GPIOB pin number of the chip select (PB6, Arduino D10). */
+#ifndef SAMPLE_ARCHIVE_CS_PIN
+#define SAMPLE_ARCHIVE_CS_PIN          (6U)
+#endif
+
+/** @brief SCK limit of the NOR flash (Hz); plain reads allow 50 MHz. */
+#ifndef SAMPLE_ARCHIVE_SPI_HZ
+#define SAMPLE_ARCHIVE_SPI_HZ          (25000000U)
+#endif
+
+/** @brief Segments per group, each indexed by one block (power of two, max 8). */
+#ifndef SAMPLE_ARCHIVE_INDEX_SEGMENTS
+#define SAMPLE_ARCHIVE_INDEX_SEGMENTS  (8U)
+#endif
+
+/** @brief Sealed blocks that start a write burst. */
+#ifndef SAMPLE_ARCHIVE_BURST_BLOCKS
+#define SAMPLE_ARCHIVE_BURST_BLOCKS    (4U)
+#endif
+
+/**
+ * @brief Longest time an added sample waits in RAM before a burst writes
+ *        it (ms); bounds the data a reset loses at low sample rates.
+ */
+#ifndef SAMPLE_ARCHIVE_MAX_AGE_MS
+#define SAMPLE_ARCHIVE_MAX_AGE_MS      (300000U)
+#endif
+
+/** @} */ /* end of Sample archive group */
+
+/**
+ * @name Network uplink
+ * @brief Modem on USART6 that forwards sample batches (uplink.h).
+ * @{
+ */
+
+/**
+ * @brief Collect and send samples from boot (1), or only after
+ *        `uplink on` (0). Set on hubs that have a modem fitted.
+ */
+#ifndef UPLINK_ENABLE_DEFAULT
+#define UPLINK_ENABLE_DEFAULT          (0)
+#endif
+
+/** @brief Modem UART baud rate. */
+#ifndef UPLINK_BAUD
+#define UPLINK_BAUD                    (115200U)
+#endif
+
+/** @brief GPIOC pin number of the modem supply switch (PC8, high = on). */
+#ifndef UPLINK_POWER_PIN
+#define UPLINK_POWER_PIN               (8U)
+#endif
+
+/** @brief Burst interval in ACTIVE and IDLE (ms). */
+#ifndef UPLINK_INTERVAL_MS
+#define UPLINK_INTERVAL_MS             (60000U)
+#endif
+
+/** @brief Burst interval in SLEEP and STOP (ms). */
+#ifndef UPLINK_LOW_POWER_INTERVAL_MS
+#define UPLINK_LOW_POWER_INTERVAL_MS   (600000U)
+#endif
+
+/** @brief Sealed batches that start a burst before the interval ends. */
+#ifndef UPLINK_BURST_BATCHES
+#define UPLINK_BURST_BATCHES           (6U)
+#endif
+
+/** @brief Longest wait for the modem to answer after power-on (ms). */
+#ifndef UPLINK_JOIN_TIMEOUT_MS
+#define UPLINK_JOIN_TIMEOUT_MS         (15000U)
+#endif
+
+/** @brief Wait for an acknowledgement before resending (ms). */
+#ifndef UPLINK_ACK_TIMEOUT_MS
+#define UPLINK_ACK_TIMEOUT_MS          (2000U)
+#endif
+
+/** @brief Resends per burst without progress before it gives up. */
+#ifndef UPLINK_RETRIES
+#define UPLINK_RETRIES                 (3U)
+#endif
+
+/** @} */ /* end of Network uplink group */
+
+/**
+ * @name Firmware update
+ * @brief Image transfer into the inactive slot, see fw_update.h.
+ * @{
+ */
+
+/** @brief A transfer without a frame for this long is aborted (ms). */
+#ifndef FW_UPDATE_RX_TIMEOUT_MS
+#define FW_UPDATE_RX_TIMEOUT_MS        (10000U)
+#endif
+
+/**
+ * @brief Uptime after which a new image confirms itself (ms).
+ *
+ * A reset before that (watchdog, crash) makes the bootloader go back to
+ * the previous image.
+ */
+#ifndef FW_UPDATE_CONFIRM_MS
+#define FW_UPDATE_CONFIRM_MS           (60000U)
+#endif
+
+/** @} */ /* end of Firmware update group */
+
+/**
+ * @name Event trace
+ * @brief Used when the image is built with TRACE_ENABLE=1 (trace.h).
+ * @{
+ */
+
+/** @brief Period of the Trace task that streams recorded events. */
+#define TRACE_SERVICE_PERIOD_MS        (10U)
+
+/** @} */ /* end of Event trace group */
+
+/**
+ * @name Scheduler configuration
+ * @brief Selection of the task manager core.
+ * @{
+ */
+
+/** @brief Scan every descriptor on each pass (original behavior). */
+#define APP_SCHEDULER_BACKEND_LINEAR   (0)
+
+/** @brief Keep tasks in a deadline-ordered binary min-heap. */
+#define APP_SCHEDULER_BACKEND_HEAP     (1)
+
+/**
+ * @brief Run every descriptor as its own FreeRTOS task.
+ *
+ * Needs the FreeRTOS kernel (not part of this repository) in the build,
+ * with STM32_THREAD_SAFE_STRATEGY=4; select it on the command line
+ * (-DAPP_SCHEDULER_BACKEND=2) so that every file sees the same choice.
+ * See tools/build_firmware.sh (FREERTOS_DIR).
+ */
+#define APP_SCHEDULER_BACKEND_RTOS     (2)
+
+/**
+ * @brief Scheduler core used by the task manager.
+ *
+ * The heap backend finds the next due task in O(1) and re-sorts a task in
+ * O(log n) after it runs, so a pass with nothing due costs one compare
+ * regardless of how many tasks are registered.
+ */
+#ifndef APP_SCHEDULER_BACKEND
+#define APP_SCHEDULER_BACKEND          APP_SCHEDULER_BACKEND_HEAP
+#endif
+
+/**
+ * @brief Periodic task slots.
+ *
+ * A compile-time pool: registering takes a slot, unregistering frees it.
+ * Disabled tasks keep their slot but are not looked at by a pass. With
+ * the RTOS backend each slot also reserves a TCB and a stack.
+ */
+#ifndef APP_MAX_TASKS
+#define APP_MAX_TASKS                  (8U)
+#endif
+
+/** @brief Event task slots (at most 32: one notification bit each). */
+#ifndef APP_MAX_EVENT_TASKS
+#define APP_MAX_EVENT_TASKS            (8U)
+#endif
+
+/** @brief Coroutines that can be running at once (app_coroutine.h). */
+#ifndef APP_COROUTINE_MAX
+#define APP_COROUTINE_MAX              (4U)
+#endif
+
+/** @brief Deferred work queue slots (app_work_queue.h); a power of two. */
+#ifndef APP_WORK_QUEUE_SIZE
+#define APP_WORK_QUEUE_SIZE            (16U)
+#endif
+
+/**
+ * @brief Preemption levels above the scheduler pass (0 to 2).
+ *
+ * An event task of level n runs from a software-pended interrupt of that
+ * level, preempting the pass and every lower level; 0 runs every event
+ * task in the pass. Not used by the RTOS backend.
+ */
+#ifndef APP_PREEMPT_LEVELS
+#define APP_PREEMPT_LEVELS             (2U)
+#endif
+
+/**
+ * @brief NVIC preemption priority of level 1; level n runs at this minus
+ *        (n - 1). The driver interrupts (irq_plan.h, 0 to 6) stay above
+ *        all levels.
+ */
+#ifndef APP_PREEMPT_PRIORITY
+#define APP_PREEMPT_PRIORITY           (15U)
+#endif
+
+/** @brief Stack per task with the RTOS backend, in 32-bit words. */
+#ifndef APP_RTOS_STACK_WORDS
+#define APP_RTOS_STACK_WORDS           (384U)
+#endif
+
+/**
+ * @brief FreeRTOS priority of @ref APP_TASK_PRIORITY_LOW tasks.
+ *
+ * NORMAL and HIGH tasks run one and two levels above it, event tasks
+ * three levels above.
+ */
+#define APP_RTOS_PRIORITY_BASE         (1U)
+
+/**
+ * @brief Sleep the core between scheduler deadlines.
+ *
+ * When enabled, App_MainLoop() asks the task manager how long it is until
+ * the next task is due and calls PowerManager_IdleFor() with that budget.
+ * Set to 0 to keep the original busy-polling main loop (e.g. when
+ * measuring scheduler overhead).
+ */
+#ifndef APP_TICKLESS_IDLE_ENABLE
+#define APP_TICKLESS_IDLE_ENABLE       (1)
+#endif
+
+/**
+ * @brief CPU time one scheduler pass may use before lower-priority due
+ *        tasks are deferred (microseconds, 0 = never defer).
+ *
+ * The scheduler is run-to-completion, so a high-priority task can still
+ * be delayed by the one task that is running; the budget bounds how many
+ * more run ahead of it.
+ */
+#ifndef APP_SCHEDULER_PASS_BUDGET_US
+#define APP_SCHEDULER_PASS_BUDGET_US   (2000U)
+#endif
+
+/**
+ * @brief Most periods an @ref APP_TASK_POLICY_CATCH_UP task may fall
+ *        behind before older releases are dropped as with SKIP.
+ */
+#ifndef APP_SCHEDULER_CATCHUP_LIMIT
+#define APP_SCHEDULER_CATCHUP_LIMIT    (4U)
+#endif
+
+/**
+ * @brief Length of one CPU load window (ms, 1 to 60000); `status` and the
+ *        metrics report the last one, the average and the peak.
+ */
+#ifndef APP_LOAD_WINDOW_MS
+#define APP_LOAD_WINDOW_MS             (1000U)
+#endif
+
+/** @brief Windows averaged for the mean CPU load (the sliding window). */
+#ifndef APP_LOAD_WINDOWS
+#define APP_LOAD_WINDOWS               (10U)
+#endif
+
+/**
+ * @brief Schedulability check of the task set: 0 off, 1 log a warning,
+ *        2 also refuse the registration that makes it infeasible.
+ *
+ * Checked when a task is registered (with its budget; the run times
+ * measured so far for the others) and again once per load window with
+ * the measured run times; `tasks sched` prints the analysis.
+ */
+#ifndef APP_SCHED_CHECK
+#define APP_SCHED_CHECK                (1)
+#endif
+
+/** @} */ /* end of Scheduler configuration group */
+
+/**
+ * @name Watchdog supervision
+ * @brief Independent watchdog refreshed by the task manager.
+ *
+ * The IWDG is refreshed only while every supervised task (descriptor
+ * watchdog_ms != 0) has started within that slack of its release. Once
+ * started it cannot be stopped and keeps counting in STOP mode, so idle
+ * sleeps end in time for a refresh (see AppTaskManager_StartWatchdog()).
+ * @{
+ */
+
+/** @brief Start the IWDG at the end of App_Init(). */
+#ifndef WATCHDOG_ENABLE
+#define WATCHDOG_ENABLE                (1)
+#endif
+
+/**
+ * @brief IWDG timeout in ms at the nominal LSI frequency.
+ *
+ * The LSI may run up to ~45 % fast, so the real timeout can be a third
+ * shorter. Keep it above the longest blocking operation (a full flash log
+ * erase takes up to ~4 s).
+ */
+#ifndef WATCHDOG_TIMEOUT_MS
+#define WATCHDOG_TIMEOUT_MS            (8000U)
+#endif
+
+/**
+ * @brief A task or event task running longer than this is recorded in the
+ *        crash trace as the watchdog offender, ahead of the reset.
+ */
+#ifndef WATCHDOG_STALL_MS
+#define WATCHDOG_STALL_MS              (WATCHDOG_TIMEOUT_MS / 2U)
+#endif
+
+/** @brief Liveness slack of the application's supervised tasks (ms). */
+#ifndef WATCHDOG_TASK_SLACK_MS
+#define WATCHDOG_TASK_SLACK_MS         (2000U)
+#endif
+
+/** @} */ /* end of Watchdog supervision group */
+
+/**
+ * @name Boot sequence
+ * @brief What runs before and after the first sample (see boot_time.h).
+ * @{
+ */
+
+/**
+ * @brief Defer modules the first sample does not need.
+ *
+ * When 1, USB, the I2C/SPI buses, the farm, ADC and sync sensors and the
+ * CLI banner are initialized by the Init event task, posted by the first
+ * run of the sampling task. When 0 they are initialized inline by
+ * App_MainInit().
+ */
+#ifndef BOOT_DEFER_INIT_ENABLE
+#define BOOT_DEFER_INIT_ENABLE         (1)
+#endif
+
+/**
+ * @brief Skip the banner and startup lines when the boot is a resume
+ *        (software or watchdog reset, STANDBY wakeup).
+ */
+#ifndef BOOT_FAST_RESUME_ENABLE
+#define BOOT_FAST_RESUME_ENABLE        (1)
+#endif
+
+/** @} */ /* end of Boot sequence group */
+
+/**
+ * @name STANDBY duty cycle
+ * @brief Sample-and-sleep in STANDBY at long periods (see power_standby.h).
+ * @{
+ */
+
+/** @brief Default of the `standby` setting: enter the duty cycle by itself. */
+#ifndef POWER_STANDBY_ENABLE_DEFAULT
+#define POWER_STANDBY_ENABLE_DEFAULT   (0)
+#endif
+
+/**
+ * @brief Shortest sample period the duty cycle is entered for (ms).
+ *
+ * Below this, STOP between samples costs less than a wakeup boot.
+ */
+#ifndef POWER_STANDBY_MIN_PERIOD_MS
+#define POWER_STANDBY_MIN_PERIOD_MS    (30000U)
+#endif
+
+/**
+ * @brief Time a full boot stays up before the duty cycle may resume (ms).
+ *
+ * Leaves the replayed samples time to reach telemetry and the flash log.
+ */
+#ifndef POWER_STANDBY_MIN_AWAKE_MS
+#define POWER_STANDBY_MIN_AWAKE_MS     (2000U)
+#endif
+
+/** @} */ /* end of STANDBY duty cycle group */
+
+/**
+ * @name Benchmark build
+ * @brief Boot-time microbenchmark suite (see app_bench.h).
+ * @{
+ */
+
+/**
+ * @brief Run AppBench_Run() once at boot, before App_MainInit().
+ *
+ * The numbers are only meaningful with the optimization level and clock
+ * profile of the build being measured.
+ */
+#ifndef APP_BENCH_ENABLE
+#define APP_BENCH_ENABLE               (0)
+#endif
+
+/** @brief Samples taken per benchmark case. */
+#ifndef APP_BENCH_ITERATIONS
+#define APP_BENCH_ITERATIONS           (64U)
+#endif
+
+/** @} */ /* end of Benchmark build group */
+
+/**
+ * @name Application events
+ * @brief Event bits posted from interrupts with AppTaskManager_PostEvent().
+ * @{
+ */
+
+/** @brief User button B1 pressed (EXTI line 13). */
+#define APP_EVENT_BUTTON               (1UL << 0)
+
+/** @brief CLI bytes received (UART RX DMA / IDLE line). */
+#define APP_EVENT_CLI_RX               (1UL << 1)
+
+/** @brief Sync group frame queued (TIM3 update). */
+#define APP_EVENT_SENSOR_SYNC          (1UL << 2)
+
+/** @brief Sensor alarm raised or cleared (acquisition path). */
+#define APP_EVENT_SENSOR_ALARM         (1UL << 3)
+
+/** @brief Deferred initialization due (first sampling run). */
+#define APP_EVENT_DEFERRED_INIT        (1UL << 4)
+
+/** @brief A coroutine was signalled (AppCoroutine_Signal()). */
+#define APP_EVENT_COROUTINE            (1UL << 5)
+
+/** @brief Deferred work posted (AppWorkQueue_Post()). */
+#define APP_EVENT_WORK                 (1UL << 6)
+
+/** @brief Presses closer together than this are treated as contact bounce. */
+#ifndef APP_BUTTON_DEBOUNCE_MS
+#define APP_BUTTON_DEBOUNCE_MS         (50U)
+#endif
+
+/** @} */ /* end of Application events group */
+
+/**
+ * @name Low-power configuration
+ * @brief Wake sources and thresholds used when the MCU enters STOP.
+ *
+ * In ACTIVE, IDLE and SLEEP the core waits in SLEEP (WFI) between task
+ * deadlines and any enabled interrupt wakes it. In POWER_MODE_STOP the
+ * clocks are stopped, so only the sources listed here can wake the MCU.
+ * @{
+ */
+
+/** @brief Wake on the B1 user button (EXTI line 13). */
+#define POWER_WAKE_SRC_BUTTON      (1U << 0)
+
+/** @brief Wake on the RTC wakeup timer at the next task deadline. */
+#define POWER_WAKE_SRC_RTC         (1U << 1)
+
+/** @brief Wake on a falling edge of the USART2 RX pin (EXTI line 3). */
+#define POWER_WAKE_SRC_UART        (1U << 2)
+
+/**
+ * @brief Wake sources armed while in POWER_MODE_STOP.
+ *
+ * Without @ref POWER_WAKE_SRC_RTC the scheduler stalls in STOP until an
+ * external event occurs.
+ */
+#ifndef POWER_STOP_WAKE_SOURCES
+#define POWER_STOP_WAKE_SOURCES    (POWER_WAKE_SRC_BUTTON | POWER_WAKE_SRC_RTC | POWER_WAKE_SRC_UART)
+#endif
+
+/**
+ * @brief Shortest idle period (ms) worth entering STOP for.
+ *
+ * Below this the core uses SLEEP instead, because the STOP wake-up and
+ * clock restore cost more than they save. Tune with the wake latency
+ * reported by the 'status' command.
+ */
+#ifndef POWER_STOP_MIN_IDLE_MS
+#define POWER_STOP_MIN_IDLE_MS     (5U)
+#endif
+
+/**
+ * @brief Choose the idle state per idle period in every power mode (1).
+ *
+ * The idle governor (PowerManager_SelectIdleState()) compares each idle
+ * period with the measured entry and exit cost of SLEEP, STOP on the main
+ * regulator and STOP on the low-power regulator, and uses the one that
+ * draws the least charge. With 1 STOP is used in any power mode while no
+ * peripheral that stops in STOP is in use; with 0 only in
+ * POWER_MODE_STOP, and then only its low-power variant.
+ */
+#ifndef POWER_IDLE_GOVERNOR
+#define POWER_IDLE_GOVERNOR            (1)
+#endif
+
+/**
+ * @brief Estimated entry and exit time (us) of STOP on the main regulator.
+ *
+ * Used by the idle governor until the state has been measured once.
+ */
+#ifndef POWER_IDLE_STOP_MAIN_US
+#define POWER_IDLE_STOP_MAIN_US        (30U)
+#endif
+
+/**
+ * @brief Estimated entry and exit time (us) of STOP on the low-power
+ *        regulator, with the flash powered down.
+ *
+ * Used by the idle governor until the state has been measured once.
+ */
+#ifndef POWER_IDLE_STOP_LP_US
+#define POWER_IDLE_STOP_LP_US          (150U)
+#endif
+
+/**
+ * @brief Estimated cost (us at the HSI run current) of one STANDBY duty
+ *        cycle wakeup: reset, clock setup, one sample, back to STANDBY.
+ *
+ * Not measured; the idle governor weighs the STANDBY duty cycle with it.
+ */
+#ifndef POWER_IDLE_STANDBY_US
+#define POWER_IDLE_STANDBY_US          (20000U)
+#endif
+
+/**
+ * @brief Time (ms) after console input during which STOP is not entered.
+ *
+ * The character that wakes the MCU from STOP is lost, because the USART
+ * runs without a clock until the wake-up. While an operator is typing
+ * the core therefore waits in SLEEP, where the console receives with
+ * DMA as usual; STOP resumes once the console has been quiet this long.
+ */
+#ifndef POWER_CONSOLE_HOLD_MS
+#define POWER_CONSOLE_HOLD_MS      (10000U)
+#endif
+
+/**
+ * @brief Use the low-power regulator in the deep STOP state (1) or keep
+ *        the main one (0).
+ *
+ * The low-power regulator lowers STOP current but lengthens wake-up. The
+ * shallow STOP state always keeps the main regulator.
+ */
+#ifndef POWER_STOP_LOW_POWER_REGULATOR
+#define POWER_STOP_LOW_POWER_REGULATOR   (1)
+#endif
+
+/**
+ * @brief Power down the flash in the deep STOP state (1) or keep it on (0).
+ *
+ * Saves further current at the cost of extra wake-up time, which the idle
+ * governor weighs; the shallow STOP state keeps the flash on.
+ */
+#ifndef POWER_STOP_FLASH_POWER_DOWN
+#define POWER_STOP_FLASH_POWER_DOWN      (1)
+#endif
+
+/** @} */ /* end of Low-power configuration group */
+
+/**
+ * @name Adaptive power policy
+ * @brief Automatic ACTIVE -> IDLE -> SLEEP step-down on inactivity.
+ *
+ * Activity is CLI input, a button press, or a sensor value leaving its
+ * deadband. The policy never steps down to POWER_MODE_STOP on its own
+ * (the idle governor still uses STOP between deadlines); an explicit
+ * 'pmode' request turns it off until 'pmode auto'.
+ * @{
+ */
+
+/** @brief Start with the adaptive policy enabled (1) or disabled (0). */
+#ifndef POWER_AUTO_POLICY_DEFAULT
+#define POWER_AUTO_POLICY_DEFAULT          (1)
+#endif
+
+/** @brief Inactivity (ms) after which ACTIVE steps down to IDLE. */
+#ifndef POWER_AUTO_IDLE_AFTER_MS
+#define POWER_AUTO_IDLE_AFTER_MS           (30000U)
+#endif
+
+/** @brief Inactivity (ms) after which IDLE steps down to SLEEP. */
+#ifndef POWER_AUTO_SLEEP_AFTER_MS
+#define POWER_AUTO_SLEEP_AFTER_MS          (120000U)
+#endif
+
+/**
+ * @brief Minimum time (ms) in a mode before the policy steps down again.
+ *
+ * Together with the wake count below this is the hysteresis that keeps
+ * the policy from toggling between neighbouring modes.
+ */
+#ifndef POWER_AUTO_MIN_DWELL_MS
+#define POWER_AUTO_MIN_DWELL_MS            (10000U)
+#endif
+
+/**
+ * @brief Out-of-deadband sensor samples that wake IDLE/SLEEP to ACTIVE.
+ *
+ * Counted within @ref POWER_AUTO_SENSOR_WAKE_WINDOW_MS. A single change
+ * only restarts the inactivity timer. CLI input and the button always
+ * wake at once.
+ */
+#ifndef POWER_AUTO_SENSOR_WAKE_COUNT
+#define POWER_AUTO_SENSOR_WAKE_COUNT       (3U)
+#endif
+
+/** @brief Window (ms) for @ref POWER_AUTO_SENSOR_WAKE_COUNT. */
+#ifndef POWER_AUTO_SENSOR_WAKE_WINDOW_MS
+#define POWER_AUTO_SENSOR_WAKE_WINDOW_MS   (60000U)
+#endif
+
+/** @} */ /* end of Adaptive power policy group */
+
+/**
+ * @name Clock profile per power mode
+ * @brief System clock profile (see clock_profile.h) applied on each mode change.
+ *
+ * STOP always wakes on HSI; using LOW_POWER for the sleepy modes avoids a
+ * PLL relock on every wake-up.
+ * @{
+ */
+
+/** @brief Clock profile in POWER_MODE_ACTIVE. */
+#ifndef POWER_CLOCK_PROFILE_ACTIVE
+#define POWER_CLOCK_PROFILE_ACTIVE   CLOCK_PROFILE_MAX
+#endif
+
+/** @brief Clock profile in POWER_MODE_IDLE. */
+#ifndef POWER_CLOCK_PROFILE_IDLE
+#define POWER_CLOCK_PROFILE_IDLE     CLOCK_PROFILE_BALANCED
+#endif
+
+/** @brief Clock profile in POWER_MODE_SLEEP. */
+#ifndef POWER_CLOCK_PROFILE_SLEEP
+#define POWER_CLOCK_PROFILE_SLEEP    CLOCK_PROFILE_LOW_POWER
+#endif
+
+/** @brief Clock profile in POWER_MODE_STOP. */
+#ifndef POWER_CLOCK_PROFILE_STOP
+#define POWER_CLOCK_PROFILE_STOP     CLOCK_PROFILE_LOW_POWER
+#endif
+
+/** @} */ /* end of Clock profile per power mode group */
+
+/**
+ * @name Energy model
+ * @brief MCU supply current per state, for the charge estimate (power_energy.h).
+ *
+ * Defaults are typical STM32F446 figures at 3.3 V and 25 C with the
+ * peripherals this firmware uses; measure the board in each state and
+ * override them for real battery estimates.
+ * @{
+ */
+
+/** @brief Run current (uA) on CLOCK_PROFILE_LOW_POWER (16 MHz HSI). */
+#ifndef POWER_ENERGY_RUN_UA_LOW_POWER
+#define POWER_ENERGY_RUN_UA_LOW_POWER     (4500U)
+#endif
+
+/** @brief Run current (uA) on CLOCK_PROFILE_BALANCED (84 MHz, scale 3). */
+#ifndef POWER_ENERGY_RUN_UA_BALANCED
+#define POWER_ENERGY_RUN_UA_BALANCED      (17000U)
+#endif
+
+/** @brief Run current (uA) on CLOCK_PROFILE_MAX (180 MHz, over-drive). */
+#ifndef POWER_ENERGY_RUN_UA_MAX
+#define POWER_ENERGY_RUN_UA_MAX           (40000U)
+#endif
+
+/** @brief SLEEP (WFI) current (uA) on CLOCK_PROFILE_LOW_POWER. */
+#ifndef POWER_ENERGY_SLEEP_UA_LOW_POWER
+#define POWER_ENERGY_SLEEP_UA_LOW_POWER   (1200U)
+#endif
+
+/** @brief SLEEP (WFI) current (uA) on CLOCK_PROFILE_BALANCED. */
+#ifndef POWER_ENERGY_SLEEP_UA_BALANCED
+#define POWER_ENERGY_SLEEP_UA_BALANCED    (4000U)
+#endif
+
+/** @brief SLEEP (WFI) current (uA) on CLOCK_PROFILE_MAX. */
+#ifndef POWER_ENERGY_SLEEP_UA_MAX
+#define POWER_ENERGY_SLEEP_UA_MAX         (10000U)
+#endif
+
+/** @brief STOP current (uA) with the configured regulator and flash settings. */
+#ifndef POWER_ENERGY_STOP_UA
+#define POWER_ENERGY_STOP_UA              (250U)
+#endif
+
+/** @brief STOP current (uA) on the main regulator with the flash on. */
+#ifndef POWER_ENERGY_STOP_MAIN_UA
+#define POWER_ENERGY_STOP_MAIN_UA         (450U)
+#endif
+
+/** @brief STANDBY current (uA) with the RTC and the backup SRAM on. */
+#ifndef POWER_ENERGY_STANDBY_UA
+#define POWER_ENERGY_STANDBY_UA           (5U)
+#endif
+
+/** @brief Battery capacity (mAh) for the battery life estimate; 0 = none. */
+#ifndef POWER_ENERGY_BATTERY_MAH
+#define POWER_ENERGY_BATTERY_MAH          (2000U)
+#endif
+
+/** @brief Interval (ms) of the energy telemetry frame while telemetry is on. */
+#ifndef POWER_ENERGY_TELEMETRY_MS
+#define POWER_ENERGY_TELEMETRY_MS         (10000U)
+#endif
+
+/** @} */ /* end of Energy model group */
+
+/**
+ * @name Load shedding
+ * @brief When the outputs fall behind acquisition (app_load_shed.h).
+ *
+ * Pressure is the fullest of the sample ring, the console TX ring and
+ * the flash log page queue, in percent; any dropped sample, byte, line,
+ * frame or page since the last evaluation counts as full.
+ * @{
+ */
+
+/** @brief Start with load shedding enabled (`shed on|off`). */
+#ifndef LOAD_SHED_ENABLE
+#define LOAD_SHED_ENABLE                  (1)
+#endif
+
+/** @brief Interval (ms) between evaluations of the pressure. */
+#ifndef LOAD_SHED_EVAL_MS
+#define LOAD_SHED_EVAL_MS                 (250U)
+#endif
+
+/** @brief Pressure (%) at or above which the next level is entered. */
+#ifndef LOAD_SHED_HIGH_PCT
+#define LOAD_SHED_HIGH_PCT                (75U)
+#endif
+
+/** @brief Pressure (%) below which the hub counts as calm. */
+#ifndef LOAD_SHED_LOW_PCT
+#define LOAD_SHED_LOW_PCT                 (25U)
+#endif
+
+/** @brief Shortest time (ms) at a level before the next one is entered. */
+#ifndef LOAD_SHED_HOLD_MS
+#define LOAD_SHED_HOLD_MS                 (1000U)
+#endif
+
+/** @brief Calm time (ms) before one level is given back. */
+#ifndef LOAD_SHED_CALM_MS
+#define LOAD_SHED_CALM_MS                 (5000U)
+#endif
+
+/** @brief Statistics window (ms) non-critical sensors are aggregated into. */
+#ifndef LOAD_SHED_AGGREGATE_MS
+#define LOAD_SHED_AGGREGATE_MS            (10000U)
+#endif
+
+/** @brief One in this many samples of a non-critical sensor is kept. */
+#ifndef LOAD_SHED_DECIMATE_FACTOR
+#define LOAD_SHED_DECIMATE_FACTOR         (4U)
+#endif
+
+/** @} */ /* end of Load shedding group */
+
+/**
+ * @name Self-test
+ * @brief Sustained-load run and its pass/fail targets (app_selftest.h).
+ *
+ * The run adds the synthetic sensor farm at its configured rates,
+ * @ref SELFTEST_LOG_LINES_PER_S log lines of its own and telemetry of
+ * every sample; the targets are checked over the run.
+ * @{
+ */
+
+/** @brief Run length (s) of `selftest` without an argument. */
+#ifndef SELFTEST_DEFAULT_S
+#define SELFTEST_DEFAULT_S                (10U)
+#endif
+
+/** @brief Longest run (s) accepted. */
+#ifndef SELFTEST_MAX_S
+#define SELFTEST_MAX_S                    (600U)
+#endif
+
+/** @brief Farm channels run (at most SENSOR_FARM_MAX_CHANNELS). */
+#ifndef SELFTEST_FARM_CHANNELS
+#define SELFTEST_FARM_CHANNELS            (24U)
+#endif
+
+/** @brief Extra log lines per second, at INFO so no build compiles them out. */
+#ifndef SELFTEST_LOG_LINES_PER_S
+#define SELFTEST_LOG_LINES_PER_S          (40U)
+#endif
+
+/** @brief Samples through the ring, in % of the configured rates, to pass. */
+#ifndef SELFTEST_MIN_THROUGHPUT_PCT
+#define SELFTEST_MIN_THROUGHPUT_PCT       (98U)
+#endif
+
+/** @brief Largest start delay (us) of a periodic task that passes. */
+#ifndef SELFTEST_MAX_LATE_US
+#define SELFTEST_MAX_LATE_US              (20000U)
+#endif
+
+/** @brief Sample ring high-water mark (% of capacity) that passes. */
+#ifndef SELFTEST_MAX_RING_PCT
+#define SELFTEST_MAX_RING_PCT             (50U)
+#endif
+
+/** @brief Busiest CPU load window (%) that passes. */
+#ifndef SELFTEST_MAX_CPU_PCT
+#define SELFTEST_MAX_CPU_PCT              (70U)
+#endif
+
+/** @brief Longest wait (ms) for the console to drain before the report. */
+#ifndef SELFTEST_DRAIN_MS
+#define SELFTEST_DRAIN_MS                 (2000U)
+#endif
+
+/** @} */ /* end of Self-test group */
 /** @} */ /* end of app_config group */
 
 #endif /* APP_CONFIG_H_ */
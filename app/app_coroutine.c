@@ -0,0 +1,221 @@
+/**
+ * @file app_coroutine.c
+ * @brief Stackless coroutine runner implementation.
+ *
+ * Started coroutines sit in a compile-time table of
+ * @ref APP_COROUTINE_MAX slots, in start order. The Coroutines task uses
+ * @ref APP_TASK_POLICY_RELATIVE and, like the sampling task, re-arms
+ * itself: each run resumes every coroutine whose wait is over and then
+ * sets its own period to the time until the earliest remaining wakeup. A
+ * signal or a start brings the next run forward to now.
+ *
+ * A signal only sets the descriptor flag and posts the event bit, so it
+ * is safe from interrupts of any priority. The flag is cleared just before
+ * the coroutine resumes from its signal wait; a signal posted while it
+ * runs is kept for its next wait.
+ *
+ * @ingroup scheduler
+ */
+
+#include "app_coroutine.h"
+#include "app_config.h"
+#include "app_task_manager.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+
+/** @brief Started coroutines, in start order. */
+static AppCoroutine_t *s_running[APP_COROUTINE_MAX] = {0};
+
+/** @brief Number of entries in @ref s_running. */
+static uint32_t s_runningCount = 0U;
+
+/**
+ * @brief Resume the coroutines whose wait is over and re-arm.
+ */
+static void AppCoroutine_Task(void);
+
+/**
+ * @brief Event task: a coroutine was signalled.
+ */
+static void AppCoroutine_OnSignal(uint32_t events);
+
+/**
+ * @brief Run the Coroutines task on the next scheduler pass.
+ */
+static void AppCoroutine_Wake(void);
+
+/**
+ * @brief Milliseconds until @p co is due to resume, or
+ *        @ref APP_TASK_NO_DEADLINE if only a signal resumes it.
+ */
+static uint32_t AppCoroutine_WaitMs(const AppCoroutine_t *co, uint32_t now_ms);
+
+/** @brief Runs every started coroutine; re-arms and disables itself. */
+static AppTaskDescriptor_t s_coroutineTask =
+{
+    .name      = "Coroutines",
+    .function  = AppCoroutine_Task,
+    .period_ms = 0U,
+    .priority  = APP_TASK_PRIORITY_NORMAL,
+    .policy    = APP_TASK_POLICY_RELATIVE
+};
+
+/** @brief Brings the Coroutines task forward on a signal. */
+static AppEventTask_t s_wakeEventTask =
+{
+    .name    = "CoWake",
+    .handler = AppCoroutine_OnSignal,
+    .events  = APP_EVENT_COROUTINE
+};
+
+/* ------------------------------------------------------------------------- */
+
+void AppCoroutine_Init(void)
+{
+    for (uint32_t i = 0U; i < s_runningCount; ++i)
+    {
+        s_running[i]->running = false;
+        s_running[i]         = NULL;
+    }
+    s_runningCount = 0U;
+
+    (void)AppTaskManager_RegisterTask(&s_coroutineTask);
+    AppTaskManager_SetEnabled(&s_coroutineTask, false);
+    (void)AppTaskManager_RegisterEventTask(&s_wakeEventTask);
+}
+
+bool AppCoroutine_Start(AppCoroutine_t *co)
+{
+    if ((co == NULL) || (co->function == NULL) || co->running)
+    {
+        return false;
+    }
+
+    if (s_runningCount >= APP_COROUTINE_MAX)
+    {
+        LOG_WARN("Coroutine table is full, cannot start '%s'", co->name);
+        return false;
+    }
+
+    co->line      = 0U;
+    co->wait      = APP_CO_WAIT_NONE;
+    co->wake_ms   = 0U;
+    co->timed     = false;
+    co->signalled = false;
+    co->running   = true;
+
+    s_running[s_runningCount++] = co;
+    AppCoroutine_Wake();
+    return true;
+}
+
+void AppCoroutine_Signal(AppCoroutine_t *co)
+{
+    if (co == NULL)
+    {
+        return;
+    }
+
+    co->signalled = true;
+    AppTaskManager_PostEvent(APP_EVENT_COROUTINE);
+}
+
+bool AppCoroutine_IsRunning(const AppCoroutine_t *co)
+{
+    return (co != NULL) && co->running;
+}
+
+void AppCoroutine_Suspend(AppCoroutine_t *co, AppCoWait_t wait, uint32_t ms, uint32_t line)
+{
+    co->line    = line;
+    co->wait    = wait;
+    co->wake_ms = HAL_GetTick() + ms;
+    co->timed   = (wait == APP_CO_WAIT_DELAY) || (ms != 0U);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Internal Helper Functions                                                 */
+/* ------------------------------------------------------------------------- */
+
+static void AppCoroutine_Task(void)
+{
+    uint32_t now_ms  = HAL_GetTick();
+    uint32_t wait_ms = APP_TASK_NO_DEADLINE;
+    uint32_t i       = 0U;
+
+    /* A coroutine started by one that runs here is appended and runs in
+     * this pass as well.
+     */
+    while (i < s_runningCount)
+    {
+        AppCoroutine_t *co = s_running[i];
+
+        if (AppCoroutine_WaitMs(co, now_ms) == 0U)
+        {
+            if (co->wait == APP_CO_WAIT_SIGNAL)
+            {
+                co->signalled = false;
+            }
+
+            if (co->function(co) == APP_CO_DONE)
+            {
+                co->running = false;
+                s_runningCount--;
+                for (uint32_t j = i; j < s_runningCount; ++j)
+                {
+                    s_running[j] = s_running[j + 1U];
+                }
+                s_running[s_runningCount] = NULL;
+                continue;
+            }
+        }
+
+        uint32_t co_ms = AppCoroutine_WaitMs(co, now_ms);
+        if (co_ms < wait_ms)
+        {
+            wait_ms = co_ms;
+        }
+        i++;
+    }
+
+    if (wait_ms == APP_TASK_NO_DEADLINE)
+    {
+        /* Only signals are awaited: nothing for a pass to do until one. */
+        AppTaskManager_SetEnabled(&s_coroutineTask, false);
+    }
+    else
+    {
+        AppTaskManager_SetPeriod(&s_coroutineTask, wait_ms);
+    }
+}
+
+static void AppCoroutine_OnSignal(uint32_t events)
+{
+    (void)events;
+
+    AppCoroutine_Wake();
+}
+
+static void AppCoroutine_Wake(void)
+{
+    AppTaskManager_SetEnabled(&s_coroutineTask, true);
+    AppTaskManager_Reschedule(&s_coroutineTask, HAL_GetTick());
+}
+
+static uint32_t AppCoroutine_WaitMs(const AppCoroutine_t *co, uint32_t now_ms)
+{
+    if ((co->wait == APP_CO_WAIT_NONE) ||
+        ((co->wait == APP_CO_WAIT_SIGNAL) && co->signalled))
+    {
+        return 0U;
+    }
+
+    if (!co->timed)
+    {
+        return APP_TASK_NO_DEADLINE;
+    }
+
+    int32_t left = (int32_t)(co->wake_ms - now_ms);
+    return (left > 0) ? (uint32_t)left : 0U;
+}
@@ -0,0 +1,225 @@
+/**
+ * @file app_coroutine.h
+ * @brief Stackless coroutines for multi-step sequences run by the scheduler.
+ *
+ * A coroutine is a function that returns wherever it has to wait and
+ * continues there on its next call, in the style of protothreads: the
+ * resume point is a line number kept in its descriptor, and the APP_CO_*
+ * macros expand to a switch over it. A sequence such as "submit a
+ * transfer, wait for the DMA completion, check the result, wait 10 ms,
+ * submit the next one" is written top to bottom instead of as a state
+ * machine, costs no stack of its own while it waits, and lets the
+ * scheduler run the other tasks in the meantime.
+ *
+ * Every started coroutine is run by one periodic task, "Coroutines". After
+ * each pass it sets its own period to the earliest wakeup and disables
+ * itself while every coroutine waits for a signal without a timeout, so
+ * waiting coroutines cost no scheduler passes. A completion interrupt
+ * calls AppCoroutine_Signal(), which posts @ref APP_EVENT_COROUTINE; the
+ * "CoWake" event task brings the Coroutines task forward, and the
+ * coroutine resumes on the next scheduler pass.
+ *
+ * @code
+ * static AppCoResult_t Driver_Probe(AppCoroutine_t *co)
+ * {
+ *     APP_CO_BEGIN(co);
+ *     (void)I2cBus_Submit(&s_xfer);               // done callback signals co
+ *     while (s_xfer.state != I2C_BUS_XFER_DONE)
+ *     {
+ *         APP_CO_WAIT_SIGNAL(co, 0U);
+ *     }
+ *     APP_CO_DELAY(co, 10U);
+ *     ...
+ *     APP_CO_END(co);
+ * }
+ * @endcode
+ *
+ * As with any protothread, local variables do not survive a wait (keep
+ * state in statics or behind @c context), a wait may not sit inside a
+ * switch statement of the coroutine's own, and a source line holds at
+ * most one wait.
+ *
+ * @ingroup scheduler
+ */
+
+#ifndef APP_COROUTINE_H
+#define APP_COROUTINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @addtogroup scheduler
+ * @{
+ */
+
+/**
+ * @brief What a coroutine function returns.
+ */
+typedef enum
+{
+    APP_CO_WAITING = 0U, /**< Suspended at a wait; call again when it is over. */
+    APP_CO_DONE          /**< Ran to the end (or APP_CO_EXIT()).               */
+} AppCoResult_t;
+
+/**
+ * @brief What a suspended coroutine waits for.
+ */
+typedef enum
+{
+    APP_CO_WAIT_NONE = 0U, /**< Nothing: resumes on the next pass (yield). */
+    APP_CO_WAIT_DELAY,     /**< Its wake time.                             */
+    APP_CO_WAIT_SIGNAL     /**< AppCoroutine_Signal(), or the timeout.     */
+} AppCoWait_t;
+
+struct AppCoroutine;
+
+/**
+ * @brief Coroutine function.
+ *
+ * Runs in the Coroutines task. Starts with APP_CO_BEGIN() and ends with
+ * APP_CO_END().
+ *
+ * @param co Its descriptor.
+ *
+ * @return APP_CO_WAITING while suspended, APP_CO_DONE when finished.
+ */
+typedef AppCoResult_t (*AppCoroutineFn_t)(struct AppCoroutine *co);
+
+/**
+ * @brief Descriptor of one coroutine.
+ *
+ * Lives in static storage, like the task descriptors. Only @c name,
+ * @c function and @c context are set by the owner.
+ */
+typedef struct AppCoroutine
+{
+    const char       *name;      /**< Human-readable name.                    */
+    AppCoroutineFn_t  function;  /**< Coroutine function.                     */
+    void             *context;   /**< For the function.                       */
+    uint32_t          line;      /**< Resume point (managed by the macros).   */
+    AppCoWait_t       wait;      /**< Wait it is suspended in (managed).      */
+    uint32_t          wake_ms;   /**< End of the delay or timeout (managed).  */
+    bool              timed;     /**< Signal wait has a timeout (managed).    */
+    volatile bool     signalled; /**< Signal not yet consumed (managed).      */
+    bool              running;   /**< Started and not done (managed).         */
+} AppCoroutine_t;
+
+/**
+ * @brief Open the body of a coroutine function.
+ */
+#define APP_CO_BEGIN(co)    switch ((co)->line) { case 0U:
+
+/**
+ * @brief Close the body of a coroutine function: it is done.
+ */
+#define APP_CO_END(co)      } (co)->line = 0U; return APP_CO_DONE
+
+/**
+ * @brief Finish the coroutine here.
+ */
+#define APP_CO_EXIT(co)     do { (co)->line = 0U; return APP_CO_DONE; } while (0)
+
+/** @brief Suspend with @p how for @p ms and resume right after. */
+#define APP_CO_SUSPEND_(co, how, ms)                                          \
+    do                                                                        \
+    {                                                                         \
+        AppCoroutine_Suspend((co), (how), (ms), (uint32_t)__LINE__);          \
+        return APP_CO_WAITING;                                                \
+        case __LINE__:;                                                       \
+    } while (0)
+
+/**
+ * @brief Let the other tasks run; resume on the next scheduler pass.
+ */
+#define APP_CO_YIELD(co)            APP_CO_SUSPEND_((co), APP_CO_WAIT_NONE, 0U)
+
+/**
+ * @brief Wait @p ms milliseconds.
+ */
+#define APP_CO_DELAY(co, ms)        APP_CO_SUSPEND_((co), APP_CO_WAIT_DELAY, (ms))
+
+/**
+ * @brief Wait for AppCoroutine_Signal(), or at most @p timeout_ms
+ *        (0 = no timeout).
+ *
+ * A signal posted since the last signal wait ended ends this one at once,
+ * so a completion that fires before the coroutine has suspended is not
+ * lost. Re-check what was waited for after the wait.
+ */
+#define APP_CO_WAIT_SIGNAL(co, timeout_ms)                                    \
+    APP_CO_SUSPEND_((co), APP_CO_WAIT_SIGNAL, (timeout_ms))
+
+/**
+ * @brief Wait until @p cond holds, testing it every @p poll_ms.
+ *
+ * For conditions nothing signals; completions should signal instead.
+ */
+#define APP_CO_WAIT_UNTIL(co, cond, poll_ms)                                  \
+    while (!(cond)) { APP_CO_SUSPEND_((co), APP_CO_WAIT_DELAY, (poll_ms)); }
+
+/**
+ * @brief Register the Coroutines task and the CoWake event task.
+ *
+ * Call once after AppTaskManager_Init(). The Coroutines task stays
+ * disabled until a coroutine is started.
+ *
+ * @return None.
+ */
+void AppCoroutine_Init(void);
+
+/**
+ * @brief Start a coroutine from its beginning.
+ *
+ * The first step runs on the next scheduler pass. Task context only.
+ *
+ * @param co Descriptor with @c function set.
+ *
+ * @return false if @p co is invalid or still running, or every one of
+ *         the @ref APP_COROUTINE_MAX slots is taken.
+ */
+bool AppCoroutine_Start(AppCoroutine_t *co);
+
+/**
+ * @brief Wake a coroutine from APP_CO_WAIT_SIGNAL().
+ *
+ * Safe from any context, including completion interrupts.
+ *
+ * @param co Coroutine; ignored if NULL.
+ *
+ * @return None.
+ */
+void AppCoroutine_Signal(AppCoroutine_t *co);
+
+/**
+ * @brief Whether a coroutine has been started and is not done.
+ *
+ * @param co Coroutine.
+ *
+ * @return true while it runs.
+ */
+bool AppCoroutine_IsRunning(const AppCoroutine_t *co);
+
+/**
+ * @brief Record a wait; used by the APP_CO_* macros.
+ *
+ * @param co   Coroutine.
+ * @param wait What it waits for.
+ * @param ms   Delay, or signal timeout (0 = none).
+ * @param line Resume point.
+ *
+ * @return None.
+ */
+void AppCoroutine_Suspend(AppCoroutine_t *co, AppCoWait_t wait, uint32_t ms, uint32_t line);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_COROUTINE_H */
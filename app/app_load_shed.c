@@ -0,0 +1,385 @@
+/**
+ * @file app_load_shed.c
+ * @brief Load-shedding policy implementation.
+ *
+ * The pressure inputs are the counters the outputs already keep: the
+ * occupancy of the sample ring, the console TX ring and the flash log
+ * queue, and the sum of every loss counter (ring overruns, TX bytes, log
+ * lines, telemetry frames, flash pages). A change of the sum since the
+ * last evaluation means something was lost and counts as 100%.
+ *
+ * The sensors put on statistics windows are remembered, so relaxing
+ * removes only those, and only while their window is still the one set
+ * here (a `stats` command in between wins). Sensors registered while
+ * aggregating are picked up on the next evaluation.
+ *
+ * @ingroup app
+ */
+
+#include "app_load_shed.h"
+#include "app_config.h"
+#include "cli.h"
+#include "flash_log.h"
+#include "log.h"
+#include "metrics.h"
+#include "sample_ring.h"
+#include "sensor_spectrum.h"
+#include "sensor_stats.h"
+#include "telemetry.h"
+#include "uart_tx.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Policy enabled. */
+static bool s_enabled = (LOAD_SHED_ENABLE != 0);
+
+/** @brief Current level (published as a metric). */
+static volatile uint32_t s_level = (uint32_t)APP_LOAD_SHED_NONE;
+
+/** @brief Counters published as metrics. */
+static volatile uint32_t s_pressure    = 0U; /**< Pressure (%) last evaluated.  */
+static volatile uint32_t s_escalations = 0U; /**< Levels entered.               */
+static volatile uint32_t s_decimated   = 0U; /**< Samples left out of the ring. */
+static volatile uint32_t s_aggregated  = 0U; /**< Entries in @ref s_aggIds.     */
+
+/** @brief Sensors given a statistics window by this policy. */
+static uint8_t s_aggIds[SENSOR_STATS_MAX_SENSORS];
+
+/** @brief Tick of the last evaluation. */
+static uint32_t s_lastEval_ms = 0U;
+
+/** @brief Tick of the last level change. */
+static uint32_t s_since_ms = 0U;
+
+/** @brief Tick since which the pressure is below @ref LOAD_SHED_LOW_PCT. */
+static uint32_t s_calm_ms = 0U;
+
+/** @brief The pressure was below @ref LOAD_SHED_LOW_PCT at the last evaluation. */
+static bool s_calm = false;
+
+/** @brief Sum of the loss counters at the last evaluation. */
+static uint32_t s_lost = 0U;
+
+/**
+ * @brief Current pressure in percent, 100 if anything was lost.
+ */
+static uint32_t AppLoadShed_Measure(void);
+
+/**
+ * @brief Sum of every loss counter of the outputs (wraps).
+ */
+static uint32_t AppLoadShed_LostCount(void);
+
+/**
+ * @brief Enter @p level: apply or undo what changes between the levels.
+ */
+static void AppLoadShed_SetLevel(AppLoadShedLevel_t level, uint32_t now_ms);
+
+/**
+ * @brief Give every non-critical sensor without a window of its own a
+ *        statistics window, while slots are free.
+ */
+static void AppLoadShed_Aggregate(void);
+
+/**
+ * @brief Remove the statistics windows set by AppLoadShed_Aggregate().
+ */
+static void AppLoadShed_Release(void);
+
+/**
+ * @brief CLI command "shed": show the state, switch the policy, mark
+ *        sensors critical.
+ */
+static void AppLoadShed_CmdShed(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void AppLoadShed_Init(void)
+{
+    s_level       = (uint32_t)APP_LOAD_SHED_NONE;
+    s_pressure    = 0U;
+    s_escalations = 0U;
+    s_decimated   = 0U;
+    s_aggregated  = 0U;
+    s_lastEval_ms = 0U;
+    s_since_ms    = 0U;
+    s_calm        = false;
+    s_lost        = AppLoadShed_LostCount();
+
+    Metrics_Publish(METRIC_SHED_LEVEL, &s_level);
+    Metrics_Publish(METRIC_SHED_PRESSURE_PCT, &s_pressure);
+    Metrics_Publish(METRIC_SHED_ESCALATIONS, &s_escalations);
+    Metrics_Publish(METRIC_SHED_DECIMATED, &s_decimated);
+    Metrics_Publish(METRIC_SHED_AGGREGATED, &s_aggregated);
+
+    (void)CLI_RegisterCommand("shed", AppLoadShed_CmdShed,
+                              "[on|off | critical <id> on|off] - Load shedding state and policy");
+}
+
+void AppLoadShed_Service(uint32_t now_ms)
+{
+    if ((now_ms - s_lastEval_ms) < LOAD_SHED_EVAL_MS)
+    {
+        return;
+    }
+    s_lastEval_ms = now_ms;
+
+    uint32_t pressure = AppLoadShed_Measure();
+    s_pressure = pressure;
+
+    if (!s_enabled)
+    {
+        return;
+    }
+
+    AppLoadShedLevel_t level = (AppLoadShedLevel_t)s_level;
+
+    if (pressure < LOAD_SHED_LOW_PCT)
+    {
+        if (!s_calm)
+        {
+            s_calm    = true;
+            s_calm_ms = now_ms;
+        }
+    }
+    else
+    {
+        s_calm = false;
+    }
+
+    if ((pressure >= LOAD_SHED_HIGH_PCT) && (level < APP_LOAD_SHED_DECIMATE) &&
+        ((level == APP_LOAD_SHED_NONE) || ((now_ms - s_since_ms) >= LOAD_SHED_HOLD_MS)))
+    {
+        s_escalations++;
+        AppLoadShed_SetLevel((AppLoadShedLevel_t)(level + 1U), now_ms);
+        LOG_WARN("LoadShed: pressure %lu%%, shedding %s",
+                 (unsigned long)pressure, AppLoadShed_LevelName((AppLoadShedLevel_t)s_level));
+    }
+    else if (s_calm && (level > APP_LOAD_SHED_NONE) && ((now_ms - s_calm_ms) >= LOAD_SHED_CALM_MS))
+    {
+        AppLoadShed_SetLevel((AppLoadShedLevel_t)(level - 1U), now_ms);
+        LOG_WARN("LoadShed: calm, back to %s", AppLoadShed_LevelName((AppLoadShedLevel_t)s_level));
+    }
+    else if (level >= APP_LOAD_SHED_AGGREGATE)
+    {
+        AppLoadShed_Aggregate();
+    }
+}
+
+void AppLoadShed_SetEnabled(bool enable)
+{
+    s_enabled = enable;
+    if (!enable && (s_level != (uint32_t)APP_LOAD_SHED_NONE))
+    {
+        AppLoadShed_SetLevel(APP_LOAD_SHED_NONE, s_lastEval_ms);
+        LOG_WARN("LoadShed: disabled, nothing shed");
+    }
+}
+
+bool AppLoadShed_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+bool AppLoadShed_Drop(const SensorEntry_t *entry)
+{
+    if ((s_level < (uint32_t)APP_LOAD_SHED_DECIMATE) || (entry == NULL) || entry->critical ||
+        ((entry->readCount % LOAD_SHED_DECIMATE_FACTOR) == 0U))
+    {
+        return false;
+    }
+
+    s_decimated++;
+    return true;
+}
+
+void AppLoadShed_GetStats(AppLoadShedStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->level       = (AppLoadShedLevel_t)s_level;
+    stats->pressure    = s_pressure;
+    stats->escalations = s_escalations;
+    stats->decimated   = s_decimated;
+    stats->aggregated  = s_aggregated;
+    stats->since_ms    = s_since_ms;
+}
+
+const char *AppLoadShed_LevelName(AppLoadShedLevel_t level)
+{
+    static const char *const names[APP_LOAD_SHED_LEVEL_COUNT] =
+    {
+        "none", "logs", "aggregate", "decimate"
+    };
+
+    return (level < APP_LOAD_SHED_LEVEL_COUNT) ? names[level] : "?";
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t AppLoadShed_Measure(void)
+{
+    uint32_t lost = AppLoadShed_LostCount();
+
+    if (lost != s_lost)
+    {
+        s_lost = lost;
+        return 100U;
+    }
+
+    SampleRingStats_t ring;
+    SampleRing_GetStats(&ring);
+
+    uint32_t pressure = (ring.capacity != 0U) ? ((ring.count * 100U) / ring.capacity) : 0U;
+
+    uint32_t tx = (uint32_t)((UartTx_GetPending() * 100U) / UART_TX_BUFFER_SIZE);
+    if (tx > pressure)
+    {
+        pressure = tx;
+    }
+
+    if (FlashLog_IsEnabled())
+    {
+        FlashLogStats_t flash;
+        FlashLog_GetStats(&flash);
+
+        uint32_t queued = (flash.pagesQueued * 100U) / FLASH_LOG_QUEUE_PAGES;
+        if (queued > pressure)
+        {
+            pressure = queued;
+        }
+    }
+
+    return (pressure > 100U) ? 100U : pressure;
+}
+
+static uint32_t AppLoadShed_LostCount(void)
+{
+    SampleRingStats_t ring;
+    FlashLogStats_t   flash;
+    TelemetryStats_t  telemetry;
+
+    SampleRing_GetStats(&ring);
+    FlashLog_GetStats(&flash);
+    Telemetry_GetStats(&telemetry);
+
+    return ring.overruns + UartTx_GetDroppedBytes() + Log_GetDroppedCount() +
+           telemetry.droppedFrames + flash.pagesDropped;
+}
+
+static void AppLoadShed_SetLevel(AppLoadShedLevel_t level, uint32_t now_ms)
+{
+    Log_SetFloor((level >= APP_LOAD_SHED_LOGS) ? LOG_LEVEL_INFO : LOG_LEVEL_DEBUG);
+
+    if (level >= APP_LOAD_SHED_AGGREGATE)
+    {
+        AppLoadShed_Aggregate();
+    }
+    else
+    {
+        AppLoadShed_Release();
+    }
+
+    s_level    = (uint32_t)level;
+    s_since_ms = now_ms;
+    s_calm     = false;
+}
+
+static void AppLoadShed_Aggregate(void)
+{
+    const SensorStatsConfig_t window = { .window_ms = LOAD_SHED_AGGREGATE_MS, .percentile = 0U };
+    uint32_t count = SensorRegistry_GetCount();
+
+    for (uint32_t i = 0U; (i < count) && (s_aggregated < SENSOR_STATS_MAX_SENSORS); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+
+        /* keepIds entries report under other IDs than their own. */
+        if ((entry == NULL) || entry->critical || entry->keepIds ||
+            SensorStats_Get(entry->id, NULL, NULL) || SensorSpectrum_IsConfigured(entry->id))
+        {
+            continue;
+        }
+
+        if (SensorStats_Configure(entry->id, &window))
+        {
+            s_aggIds[s_aggregated] = entry->id;
+            s_aggregated++;
+        }
+    }
+}
+
+static void AppLoadShed_Release(void)
+{
+    const SensorStatsConfig_t off = { .window_ms = 0U, .percentile = 0U };
+
+    for (uint32_t i = 0U; i < s_aggregated; ++i)
+    {
+        SensorStatsConfig_t config;
+
+        if (SensorStats_Get(s_aggIds[i], &config, NULL) &&
+            (config.window_ms == LOAD_SHED_AGGREGATE_MS) && (config.percentile == 0U))
+        {
+            (void)SensorStats_Configure(s_aggIds[i], &off);
+        }
+    }
+
+    s_aggregated = 0U;
+}
+
+static void AppLoadShed_CmdShed(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && ((strcmp(argv[1], "on") == 0) || (strcmp(argv[1], "off") == 0)))
+    {
+        AppLoadShed_SetEnabled(strcmp(argv[1], "on") == 0);
+    }
+    else if ((argc == 4U) && (strcmp(argv[1], "critical") == 0) &&
+             ((strcmp(argv[3], "on") == 0) || (strcmp(argv[3], "off") == 0)))
+    {
+        char         *end = NULL;
+        unsigned long id  = strtoul(argv[2], &end, 10);
+
+        if ((*end != '\0') || (end == argv[2]) || (id > 0xFFUL) ||
+            !SensorRegistry_SetCritical((uint8_t)id, strcmp(argv[3], "on") == 0))
+        {
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[2]);
+            return;
+        }
+    }
+    else if (argc > 1U)
+    {
+        CLI_PrintError("\r\nUsage: shed [on|off | critical <id> on|off]\r\n");
+        return;
+    }
+
+    AppLoadShedStats_t stats;
+    AppLoadShed_GetStats(&stats);
+
+    CLI_Print("\r\nLoad shedding %s: level %s for %lu ms, pressure %lu%%\r\n",
+              s_enabled ? "ON" : "OFF",
+              AppLoadShed_LevelName(stats.level),
+              (unsigned long)(HAL_GetTick() - stats.since_ms),
+              (unsigned long)stats.pressure);
+    CLI_Print("  escalations %lu, decimated %lu, aggregated %lu\r\n",
+              (unsigned long)stats.escalations,
+              (unsigned long)stats.decimated,
+              (unsigned long)stats.aggregated);
+    CLI_Print("  critical:");
+
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+
+        if (entry->critical)
+        {
+            CLI_Print(" %u(%s)", (unsigned)entry->id, entry->name);
+        }
+    }
+    CLI_Print("\r\n");
+}
@@ -0,0 +1,155 @@
+/**
+ * @file app_load_shed.h
+ * @brief Backpressure from the outputs and the load-shedding policy.
+ *
+ * Acquisition never waits for an output: samples go into the sample
+ * ring, log lines and telemetry frames into the console TX ring, sealed
+ * pages into the flash log queue, and whatever finds no room is dropped
+ * and counted. When the outputs fall behind for good, that loss would
+ * hit every sensor at random. This policy sheds load in a fixed order
+ * instead, so alarms and critical sensors keep their data:
+ *
+ *     NONE       everything goes out
+ *     LOGS       DEBUG lines are dropped at the call site (Log_SetFloor())
+ *     AGGREGATE  non-critical sensors go out as statistics windows of
+ *                @ref LOAD_SHED_AGGREGATE_MS (sensor_stats.h) instead of
+ *                sample by sample, on telemetry and every other output
+ *     DECIMATE   one in @ref LOAD_SHED_DECIMATE_FACTOR samples of a
+ *                non-critical sensor goes into the sample ring
+ *
+ * Each level keeps the ones below it. Alarms always see every sample:
+ * they are evaluated before decimation, and a sample that raises or
+ * clears an alarm is kept. Board sensors are critical; others can be
+ * marked with SensorRegistry_SetCritical() (`shed critical`).
+ *
+ * AppLoadShed_Service() evaluates the pressure every
+ * @ref LOAD_SHED_EVAL_MS: the fullest of the sample ring, the console TX
+ * ring and the flash log queue, or 100% when anything was dropped since
+ * the last evaluation. At @ref LOAD_SHED_HIGH_PCT or above the next level
+ * is entered, at most once per @ref LOAD_SHED_HOLD_MS so each level has
+ * time to work; after @ref LOAD_SHED_CALM_MS below @ref LOAD_SHED_LOW_PCT
+ * one level is given back. Every change is logged as a warning and the
+ * level, the pressure, the escalations, the decimated samples and the
+ * aggregated sensors are metrics (shed_*).
+ *
+ * @ingroup app
+ */
+
+#ifndef APP_LOAD_SHED_H
+#define APP_LOAD_SHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_registry.h"
+
+/**
+ * @defgroup app_load_shed Load Shedding
+ * @brief Drop logs, aggregate and decimate in order when output lags.
+ * @ingroup app
+ * @{
+ */
+
+/**
+ * @brief Shedding levels, in the order they are entered.
+ */
+typedef enum
+{
+    APP_LOAD_SHED_NONE = 0U, /**< Nothing shed.                               */
+    APP_LOAD_SHED_LOGS,      /**< DEBUG log lines dropped.                    */
+    APP_LOAD_SHED_AGGREGATE, /**< Non-critical sensors sent as statistics.    */
+    APP_LOAD_SHED_DECIMATE,  /**< Non-critical sensors decimated at the ring. */
+    APP_LOAD_SHED_LEVEL_COUNT
+} AppLoadShedLevel_t;
+
+/**
+ * @brief State and counters of the policy.
+ */
+typedef struct
+{
+    AppLoadShedLevel_t level;       /**< Current level.                          */
+    uint32_t           pressure;    /**< Pressure (%) at the last evaluation.    */
+    uint32_t           escalations; /**< Levels entered since startup.           */
+    uint32_t           decimated;   /**< Samples left out of the sample ring.    */
+    uint32_t           aggregated;  /**< Sensors given a statistics window.      */
+    uint32_t           since_ms;    /**< Tick of the last level change.          */
+} AppLoadShedStats_t;
+
+/**
+ * @brief Reset the policy to NONE and publish the metrics.
+ *
+ * @return None.
+ */
+void AppLoadShed_Init(void);
+
+/**
+ * @brief Evaluate the pressure and change the level if due.
+ *
+ * Call periodically from task context; returns at once between
+ * evaluations.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void AppLoadShed_Service(uint32_t now_ms);
+
+/**
+ * @brief Enable or disable the policy.
+ *
+ * Disabling gives back every level at once.
+ *
+ * @param enable New setting.
+ *
+ * @return None.
+ */
+void AppLoadShed_SetEnabled(bool enable);
+
+/**
+ * @brief Whether the policy is enabled.
+ *
+ * @return true if enabled.
+ */
+bool AppLoadShed_IsEnabled(void);
+
+/**
+ * @brief Whether a sample of @p entry is left out of the sample ring.
+ *
+ * Counts the sample when it is. Called by the single sample producer,
+ * after the alarms have seen the sample.
+ *
+ * @param entry Sensor that produced the sample.
+ *
+ * @return true while decimating and @p entry is not critical, for all
+ *         but one in @ref LOAD_SHED_DECIMATE_FACTOR of its samples.
+ */
+bool AppLoadShed_Drop(const SensorEntry_t *entry);
+
+/**
+ * @brief Snapshot the state and counters.
+ *
+ * @param[out] stats Receives them.
+ *
+ * @return None.
+ */
+void AppLoadShed_GetStats(AppLoadShedStats_t *stats);
+
+/**
+ * @brief Name of a level.
+ *
+ * @param level Level.
+ *
+ * @return "none", "logs", "aggregate", "decimate" or "?".
+ */
+const char *AppLoadShed_LevelName(AppLoadShedLevel_t level);
+
+/** @} */ /* end of app_load_shed group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_LOAD_SHED_H */
@@ -15,32 +15,133 @@
  */
 
 #include "app_main.h"
+#include "main.h"
 #include "app_task_manager.h"
+#include "app_coroutine.h"
+#include "app_work_queue.h"
+#include "app_load_shed.h"
+#include "app_selftest.h"
 #include "log.h"
 #include "stm32f4xx_hal.h"
 #include "sensor_if.h"
+#include "sensor_sim_temp.h"
+#include "app_sensors.h"
+#include "sensor_registry.h"
+#include "sample_ring.h"
+#include "sensor_farm.h"
+#include "sensor_replay.h"
+#include "sensor_adc.h"
+#include "sensor_sync.h"
+#include "sensor_discovery.h"
+#include "sensor_calib.h"
+#include "sensor_filter.h"
+#include "sensor_deadband.h"
+#include "sensor_stats.h"
+#include "sensor_spectrum.h"
+#include "sensor_alarm.h"
+#include "telemetry.h"
+#include "metrics.h"
+#include "trace.h"
+#include "hil_probe.h"
+#include "flash_log.h"
+#include "sample_archive.h"
+#include "uplink.h"
+#include "fw_update.h"
 #include "power_manager.h"
+#include "power_energy.h"
+#include "power_standby.h"
+#include "periph_power.h"
+#include "status_led.h"
+#include "crash_log.h"
 #include "cli.h"
+#include "uart_tx.h"
+#include "telemetry_uart.h"
+#include "i2c_bus.h"
+#include "spi_bus.h"
+#include "config_store.h"
+#include "usb_cdc.h"
+#include "boot_time.h"
+#include "time_base.h"
 #include "app_config.h"
+#include <stdlib.h>
+#include <string.h>
 
 /* ------------------------------------------------------------------------- */
 /* Forward declarations                                                      */
 /* ------------------------------------------------------------------------- */
 
 /**
- * @brief Periodic heartbeat task that toggles the LED and logs a message.
+ * @brief Periodic task that services every registered sensor.
+ *
+ * All sensors that are due in the current power mode are read in one
+ * pass, earliest deadline first; FIFO sensors deliver their whole batch. The task then re-arms itself for the
+ * next due sensor, so its effective period follows the per-sensor,
+ * per-mode periods in the registry.
  */
-static void App_TaskHeartbeat(void);
+static void App_TaskSensorSample(void);
 
 /**
- * @brief Periodic task that samples the active sensor and logs the result.
+ * @brief Read the due board sensors (app_sensors.h) by direct driver calls.
  *
- * This task retrieves the currently selected sensor interface (simulated in
- * Phase 2), performs a measurement, and logs the structured data including
- * timestamp and sensor value. It runs at an effective interval determined
- * by both its scheduler period and the current power mode.
+ * @param mode   Current power mode.
+ * @param now_ms Current tick.
  */
-static void App_TaskSensorSample(void);
+static void App_ServiceBoardSensors(PowerMode_t mode, uint32_t now_ms);
+
+/**
+ * @brief Record a board sensor reading (NULL: failed) and pass it on.
+ */
+static void App_DeliverBoardSample(SensorEntry_t *entry, const SensorData_t *data);
+
+/**
+ * @brief Record and pass on @p count readings of a board sensor's FIFO.
+ */
+static void App_DeliverBoardBatch(SensorEntry_t *entry, const SensorData_t *batch, size_t count);
+
+/**
+ * @brief Queue one sensor reading in the sample ring.
+ *
+ * @param entry Sensor that produced the reading.
+ * @param data  The reading.
+ */
+static void App_OnSensorSample(const SensorEntry_t *entry, const SensorData_t *data);
+
+/**
+ * @brief Queue a sample buffered in STANDBY (PowerStandby_Replay()).
+ *
+ * Such samples are never decimated.
+ */
+static void App_AcceptSample(const SensorData_t *data);
+
+/**
+ * @brief Evaluate alarms on a sample and queue it in the sample ring.
+ *
+ * The tail of App_OnSensorSample(). While the load-shedding policy
+ * decimates, samples of a non-critical @p entry that raise or clear no
+ * alarm may be left out (AppLoadShed_Drop()).
+ *
+ * @param entry Sensor that produced the reading, NULL for a replayed one.
+ * @param data  The reading.
+ */
+static void App_QueueSample(const SensorEntry_t *entry, const SensorData_t *data);
+
+/**
+ * @brief Periodic consumer that drains the sample ring, filters and logs readings.
+ */
+static void App_TaskSampleLog(void);
+
+/**
+ * @brief Output one closed statistics window.
+ *
+ * @param summary The window's summary.
+ */
+static void App_OnStatsSummary(const SensorStatsSummary_t *summary);
+static void App_OnSpectrum(const SensorSpectrumSummary_t *summary);
+
+/**
+ * @brief Periodic flash log service (page programming, erases, dumps).
+ */
+static void App_TaskFlashLog(void);
 
 /**
  * @brief Periodic task that updates the power manager.
@@ -52,46 +153,217 @@ static void App_TaskSensorSample(void);
 static void App_TaskPowerManager(void);
 
 /**
- * @brief Periodic wrapper around CLI processing.
+ * @brief Enter the STANDBY duty cycle when the `standby` setting allows.
  *
- * This task periodically invokes CLI_Process() to handle incoming UART
- * characters and dispatch CLI commands. It is scheduled at a relatively
- * high rate to keep the UI responsive.
+ * Only when the idle governor picks STANDBY over SLEEP and STOP for the
+ * sample period of the current mode, i.e. when the wakeup through reset
+ * costs less than it saves.
+ */
+static void App_ServiceStandby(void);
+
+/**
+ * @brief Metrics exporter task.
+ */
+static void App_TaskMetrics(void);
+
+/**
+ * @brief Add the timing series of one task to the metrics export.
+ *
+ * @param id      Task label id.
+ * @param stats   Task statistics.
+ * @param late_us Largest start delay (release or post to run).
+ */
+static void App_AddTaskSeries(uint8_t id, const AppTaskStats_t *stats, uint32_t late_us);
+
+/**
+ * @brief Event-driven wrapper around CLI processing.
+ *
+ * Runs on the scheduler pass after the UART interrupt queued new bytes,
+ * so characters are echoed and commands dispatched without waiting for
+ * a polling period.
+ *
+ * @param events Pending event bits (@ref APP_EVENT_CLI_RX).
+ */
+static void App_EventCli(uint32_t events);
+
+/**
+ * @brief Handle a (debounced) press of the user button B1.
+ *
+ * @param events Pending event bits (@ref APP_EVENT_BUTTON).
+ */
+static void App_EventButton(uint32_t events);
+
+/**
+ * @brief Deliver the frames of the synchronous sensor group.
+ *
+ * @param events Pending event bits (@ref APP_EVENT_SENSOR_SYNC).
+ */
+static void App_EventSensorSync(uint32_t events);
+
+/**
+ * @brief Report queued sensor alarm events and wake for raised alarms.
+ *
+ * @param events Pending event bits (@ref APP_EVENT_SENSOR_ALARM).
+ */
+static void App_EventSensorAlarm(uint32_t events);
+
+/**
+ * @brief Run the deferred part of the initialization.
+ *
+ * @param events Pending event bits (@ref APP_EVENT_DEFERRED_INIT).
+ */
+static void App_EventDeferredInit(uint32_t events);
+
+/**
+ * @brief Initialize the modules the first sample does not need.
+ */
+static void App_InitDeferred(void);
+
+/**
+ * @brief CLI receive hook (interrupt context): post @ref APP_EVENT_CLI_RX.
+ */
+static void App_OnCliRx(void);
+
+/**
+ * @brief Sync frame hook (interrupt context): post @ref APP_EVENT_SENSOR_SYNC.
+ */
+static void App_OnSyncFrame(void);
+
+/**
+ * @brief Apply the runtime configuration to the modules it controls.
+ */
+static void App_ApplyConfig(void);
+
+/**
+ * @brief Copy the live log, telemetry and flash log state into the configuration.
+ */
+static void App_CaptureConfig(void);
+
+/**
+ * @brief Publish the sample period of the current power mode.
+ */
+static void App_PublishPeriod(void);
+
+/**
+ * @brief Registry schedule hook: run the sampling task on the next pass,
+ *        which re-arms it for the new deadlines.
+ */
+static void App_OnSensorSchedule(void);
+
+/**
+ * @brief CLI handler: "config [defaults]".
+ */
+static void App_CmdConfig(uint32_t argc, char *argv[]);
+
+/**
+ * @brief CLI handler: "set <key> <value>".
+ */
+static void App_CmdSet(uint32_t argc, char *argv[]);
+
+/**
+ * @brief CLI handler: "save".
+ */
+static void App_CmdSave(uint32_t argc, char *argv[]);
+
+/**
+ * @brief Set the board sensors' filters and deadbands and the power
+ *        policy of profile @p index (the part not kept in the base
+ *        settings).
+ */
+static void App_ApplyProfileStages(uint32_t index);
+
+/**
+ * @brief Work item: switch to the profile in @p context, at a task
+ *        boundary.
  */
-static void App_TaskCli(void);
+static void App_WorkProfile(void *context);
+
+/**
+ * @brief Copy the live settings into profile @p index.
+ */
+static void App_CaptureProfile(uint32_t index);
+
+/**
+ * @brief CLI handler: "profile [<name> | save <name>]".
+ */
+static void App_CmdProfile(uint32_t argc, char *argv[]);
 
 /* ------------------------------------------------------------------------- */
 /* Task descriptors                                                          */
 /* ------------------------------------------------------------------------- */
 
+_Static_assert(POWER_MODE_COUNT <= APP_TASK_MAX_MODES, "power modes index the task sets");
+_Static_assert(POWER_MODE_COUNT <= LOG_MAX_MODES, "power modes index the log settings");
+
 /**
- * @brief Descriptor for the heartbeat task.
+ * @brief Task descriptor for the Sensor Sampling task.
  *
- * This task toggles the on-board LED and logs a message at
- * a fixed period, demonstrating that the scheduler and logging
- * are functioning correctly.
+ * The period is rewritten by App_TaskSensorSample() after every run to
+ * match the next sensor deadline, within the SENSOR_SERVICE_* bounds
+ * from @ref app_config. The sensor deadlines themselves are drift-free
+ * (see SensorRegistry_Service()), so the task re-arms relative to its
+ * start. It starts with period 0: the first run, and with it the first
+ * sample, is on the first scheduler pass. Anything that moves a deadline
+ * earlier (a mode change, new periods, a new sensor) re-arms it for the
+ * next pass through App_OnSensorSchedule().
  */
-static AppTaskDescriptor_t s_heartbeatTask =
+static AppTaskDescriptor_t s_sensorTask =
 {
-    .name       = "Heartbeat",
-    .function   = App_TaskHeartbeat,
-    .period_ms  = 500U,
-    .lastRun_ms = 0U
+    .name       = "SensorSample",               /**< Human-readable task name.     */
+    .function   = App_TaskSensorSample,         /**< Task entry function.          */
+    .period_ms  = 0U,                           /**< Re-armed after each run.      */
+    .lastRun_ms = 0U,                           /**< Populated at task registration. */
+    .priority   = APP_TASK_PRIORITY_HIGH,       /**< Runs first, never deferred.   */
+    .policy     = APP_TASK_POLICY_RELATIVE,     /**< Phase is kept by the registry. */
+    .budget_us  = SENSOR_SERVICE_BUDGET_US,     /**< Expected worst case.          */
+    .watchdog_ms = WATCHDOG_TASK_SLACK_MS       /**< Supervised by the watchdog.   */
 };
 
 /**
- * @brief Task descriptor for the Sensor Sampling task.
+ * @brief Task descriptor for the sample ring consumer.
  *
- * This task periodically considers sampling the sensor, but the actual
- * sampling interval is power-aware and controlled by App_TaskSensorSample()
- * using the periods defined in @ref app_config.
+ * Nothing samples in STOP, so the task is left out of that mode and a
+ * STOP window is not cut to its period. Samples still queued when STOP
+ * is entered are drained on the first run after it.
  */
-static AppTaskDescriptor_t s_sensorTask =
+static AppTaskDescriptor_t s_sampleLogTask =
+{
+    .name       = "SampleLog",
+    .function   = App_TaskSampleLog,
+    .period_ms  = SAMPLE_LOG_PERIOD_MS,
+    .lastRun_ms = 0U,
+    .priority   = APP_TASK_PRIORITY_NORMAL,
+    .budget_us  = 0U,
+    .modes      = APP_TASK_MODE(POWER_MODE_ACTIVE) | APP_TASK_MODE(POWER_MODE_IDLE) |
+                  APP_TASK_MODE(POWER_MODE_SLEEP)
+};
+
+/**
+ * @brief Period of the FlashLog task per power mode.
+ *
+ * In STOP only pages queued before it, a dump or an erase are left to
+ * finish; they may take longer, the STOP windows in between do not.
+ */
+static const uint32_t s_flashLogPeriod_ms[POWER_MODE_COUNT] =
+{
+    [POWER_MODE_ACTIVE] = FLASH_LOG_SERVICE_PERIOD_MS,
+    [POWER_MODE_IDLE]   = FLASH_LOG_SERVICE_PERIOD_MS,
+    [POWER_MODE_SLEEP]  = FLASH_LOG_SERVICE_PERIOD_MS,
+    [POWER_MODE_STOP]   = FLASH_LOG_SERVICE_PERIOD_STOP_MS
+};
+
+/**
+ * @brief Task descriptor for the flash log service.
+ */
+static AppTaskDescriptor_t s_flashLogTask =
 {
-    .name       = "SensorSample",        /**< Human-readable task name.         */
-    .function   = App_TaskSensorSample,  /**< Task entry function.              */
-    .period_ms  = 1000U,                 /**< Scheduler tick for this task.     */
-    .lastRun_ms = 0U                     /**< Populated at task registration.   */
+    .name          = "FlashLog",
+    .function      = App_TaskFlashLog,
+    .period_ms     = FLASH_LOG_SERVICE_PERIOD_MS,
+    .lastRun_ms    = 0U,
+    .priority      = APP_TASK_PRIORITY_LOW,
+    .budget_us     = 0U,
+    .modePeriod_ms = s_flashLogPeriod_ms
 };
 
 /**
@@ -105,169 +377,1532 @@ static AppTaskDescriptor_t s_powerTask =
     .name       = "PowerManager",        /**< Human-readable task name. */
     .function   = App_TaskPowerManager,  /**< Task entry function.      */
     .period_ms  = 500U,                  /**< Execute every 500 ms.     */
-    .lastRun_ms = 0U
+    .lastRun_ms = 0U,
+    .priority   = APP_TASK_PRIORITY_NORMAL,  /**< Deferrable.               */
+    .budget_us  = 0U,
+    .watchdog_ms = WATCHDOG_TASK_SLACK_MS    /**< Supervised by the watchdog. */
+};
+
+/**
+ * @brief Task descriptor for the metrics exporter.
+ *
+ * The period is the `metrics_period` setting, applied by App_ApplyConfig().
+ */
+static AppTaskDescriptor_t s_metricsTask =
+{
+    .name       = "Metrics",
+    .function   = App_TaskMetrics,
+    .period_ms  = METRICS_TELEMETRY_MS,
+    .lastRun_ms = 0U,
+    .priority   = APP_TASK_PRIORITY_LOW,
+    .budget_us  = 0U
+};
+
+#if (TRACE_ENABLE != 0)
+/**
+ * @brief Task descriptor for the event trace drain.
+ */
+static AppTaskDescriptor_t s_traceTask =
+{
+    .name       = "Trace",
+    .function   = Trace_Service,
+    .period_ms  = TRACE_SERVICE_PERIOD_MS,
+    .lastRun_ms = 0U,
+    .priority   = APP_TASK_PRIORITY_LOW,
+    .budget_us  = 0U
+};
+#endif
+
+/**
+ * @brief Event task for CLI processing.
+ */
+static AppEventTask_t s_cliEventTask =
+{
+    .name    = "CLI",
+    .handler = App_EventCli,
+    .events  = APP_EVENT_CLI_RX
+};
+
+/**
+ * @brief Event task for the user button.
+ */
+static AppEventTask_t s_buttonEventTask =
+{
+    .name    = "Button",
+    .handler = App_EventButton,
+    .events  = APP_EVENT_BUTTON
+};
+
+/**
+ * @brief Event task for the synchronous sensor group.
+ *
+ * At preemption level 1, so the frames of a sync timer tick reach the
+ * ring while a long CLI command or flash write holds the pass.
+ */
+static AppEventTask_t s_syncEventTask =
+{
+    .name    = "SensorSync",
+    .handler = App_EventSensorSync,
+    .events  = APP_EVENT_SENSOR_SYNC,
+    .level   = 1U
+};
+
+/**
+ * @brief Event task for sensor alarms.
+ */
+static AppEventTask_t s_alarmEventTask =
+{
+    .name    = "SensorAlarm",
+    .handler = App_EventSensorAlarm,
+    .events  = APP_EVENT_SENSOR_ALARM
 };
 
 /**
- * @brief Task descriptor for the CLI processing task.
+ * @brief Event task for the deferred initialization.
  */
-static AppTaskDescriptor_t s_cliTask =
+static AppEventTask_t s_initEventTask =
 {
-    .name       = "CLI",
-    .function   = App_TaskCli,
-    .period_ms  = 20U,
-    .lastRun_ms = 0U
+    .name    = "Init",
+    .handler = App_EventDeferredInit,
+    .events  = APP_EVENT_DEFERRED_INIT
 };
 
+/** @brief App_InitDeferred() still has to run. */
+static bool s_initDeferred = false;
+
+/** @brief HAL tick at App_MainInit(); not 0 after a STANDBY duty cycle. */
+static uint32_t s_bootTick_ms = 0U;
+
+/** @brief Power mode the sensor deadlines are set for. */
+static PowerMode_t s_sampleMode = POWER_MODE_ACTIVE;
+
+/** @brief Sample ring reader of the sample log task (copies: the filters modify samples). */
+static SampleRingReader_t s_sampleLogReader;
+
+/* ------------------------------------------------------------------------- */
+/* Sensor registrations                                                      */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Registry entries of the board sensors (app_sensors.h).
+ *
+ * Use the table periods until App_MainInit() applies the stored
+ * configuration; the interface pointers, filled in by App_MainInit(),
+ * serve the registry's generic paths (init, sync group), not sampling.
+ */
+#define APP_SENSOR_ENTRY(var, id_, name_, driver, style, stages, active, idle, sleep, stop)   \
+    static SensorEntry_t s_##var##Sensor =                                                  \
+    {                                                                                       \
+        .id        = (id_),                                                                 \
+        .name      = (name_),                                                               \
+        .iface     = NULL,                                                                  \
+        .period_ms =                                                                        \
+        {                                                                                   \
+            [POWER_MODE_ACTIVE] = (active),                                                 \
+            [POWER_MODE_IDLE]   = (idle),                                                   \
+            [POWER_MODE_SLEEP]  = (sleep),                                                  \
+            [POWER_MODE_STOP]   = (stop)                                                    \
+        },                                                                                  \
+        .direct    = true,                                                                  \
+        .critical  = true                                                                   \
+    };
+APP_BOARD_SENSORS(APP_SENSOR_ENTRY)
+#undef APP_SENSOR_ENTRY
+
+/**
+ * @brief Default filter chain and report-by-exception settings of each
+ *        board sensor.
+ */
+#define APP_SENSOR_STAGES(var, id, name, driver, style, stages, ...)                         \
+    static const SensorFilterConfig_t s_##var##Filter =                                     \
+    {                                                                                       \
+        .medianWindow  = stages##_FILTER_MEDIAN_WINDOW,                                     \
+        .averageWindow = stages##_FILTER_AVERAGE_WINDOW,                                    \
+        .iirAlpha      = stages##_FILTER_IIR_ALPHA                                          \
+    };                                                                                      \
+    static const SensorDeadbandConfig_t s_##var##Deadband =                                 \
+    {                                                                                       \
+        .deadband      = stages##_DEADBAND,                                                 \
+        .maxSilence_ms = stages##_MAX_SILENCE_MS                                            \
+    };
+APP_BOARD_SENSORS(APP_SENSOR_STAGES)
+#undef APP_SENSOR_STAGES
+
+/**
+ * @brief Acquisition of one due board sensor, by read style.
+ *
+ * BATCH drains the FIFO in chunks as SensorRegistry_Service() does; READ
+ * takes one reading. Each expands to direct calls of the driver.
+ */
+#define APP_SENSOR_READ_BATCH(var, id, driver)                                               \
+    do                                                                                      \
+    {                                                                                       \
+        SensorData_t batch[SENSOR_REGISTRY_BATCH_MAX];                                      \
+        uint32_t     chunk = 0U;                                                            \
+        size_t       count;                                                                 \
+        do                                                                                  \
+        {                                                                                   \
+            count = driver##_ReadBatch(batch, SENSOR_REGISTRY_BATCH_MAX);                   \
+            App_DeliverBoardBatch(&s_##var##Sensor, batch, count);                          \
+        } while ((count == SENSOR_REGISTRY_BATCH_MAX) && (++chunk < SENSOR_REGISTRY_BATCH_CHUNKS)); \
+        TRACE_SENSOR_DONE((id), true);                                                      \
+    } while (0)
+
+#define APP_SENSOR_READ_READ(var, id, driver)                                                \
+    do                                                                                      \
+    {                                                                                       \
+        SensorData_t data;                                                                  \
+        bool         ok = driver##_Read(&data);                                             \
+        TRACE_SENSOR_DONE((id), ok);                                                        \
+        App_DeliverBoardSample(&s_##var##Sensor, ok ? &data : NULL);                        \
+    } while (0)
+
 /* ------------------------------------------------------------------------- */
 /* Public API                                                                */
 /* ------------------------------------------------------------------------- */
 
 void App_MainInit(void)
 {
-    LOG_INFO("Application initialization started");
+    /* A resume goes straight to sampling; the person at the console, if
+     * any, saw these lines on the cold boot.
+     */
+    bool quiet = (BOOT_FAST_RESUME_ENABLE != 0) && BootTime_IsResume();
+
+    s_bootTick_ms = HAL_GetTick();
+
+    if (!quiet)
+    {
+        LOG_INFO("Application initialization started");
+    }
+
+    /* Load the stored settings before the modules they control start. */
+    Config_Init();
+
+#if (TRACE_ENABLE != 0)
+    /* Before any task or sensor registers, so every one gets a name. */
+    Trace_Init();
+#endif
 
     /* Initialize task manager and register tasks. */
     AppTaskManager_Init();
 
+    Metrics_PublishGauge(METRIC_UPTIME_MS, HAL_GetTick);
+    Metrics_Publish(METRIC_CLOCK_HZ, &SystemCoreClock);
+
     /* Initialize power manager. */
     PowerManager_Init();
 
-    /* Initialize the active sensor interface. */
-    const SensorIF_t *sensorIF = Sensor_GetInterface();
-    if (!sensorIF->init())
+    /* LD2 blinks from TIM8 through PA5 in every mode but STOP. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOA);
+    StatusLed_Init();
+
+    /* Register (and initialize) all sensors. */
+    SampleRing_Init();
+    SampleRing_AddReader(&s_sampleLogReader, "SampleLog");
+    SensorRegistry_Init();
+    SensorCalib_Init();
+    SensorFilter_Init();
+    SensorDeadband_Init();
+#define APP_SENSOR_REGISTER(var, id, name, driver, ...)                  \
+    s_##var##Sensor.iface = driver##_GetInterface();                    \
+    (void)SensorRegistry_Register(&s_##var##Sensor);                    \
+    (void)SensorFilter_Configure((id), &s_##var##Filter);               \
+    (void)SensorDeadband_Configure((id), &s_##var##Deadband);
+    APP_BOARD_SENSORS(APP_SENSOR_REGISTER)
+#undef APP_SENSOR_REGISTER
+    SensorStats_Init();
+    SensorSpectrum_Init();
+    SensorAlarm_Init();
+    Telemetry_Init(TelemetryUart_IsActive() ? TelemetryUart_GetStream()
+                                            : UartTx_GetStream(UART_TX_STREAM_TELEMETRY));
+    FlashLog_Init();
+    AppLoadShed_Init();
+    AppSelfTest_Init();
+    App_ApplyConfig();
+    if (Config_Get()->profile != 0U)
+    {
+        App_ApplyProfileStages(Config_Get()->profile - 1U);
+    }
+#define APP_SENSOR_DUE_NOW(var, ...)                                                         \
+    (void)SensorRegistry_SetDueNow(s_##var##Sensor.id, PowerManager_GetCurrentMode(), HAL_GetTick());
+    APP_BOARD_SENSORS(APP_SENSOR_DUE_NOW)
+#undef APP_SENSOR_DUE_NOW
+
+    /* After a duty cycle: queue what was sampled in STANDBY, keep the
+     * waveform phase, and pick up where the duty cycle left off.
+     */
+    PowerStandby_Init();
+    (void)PowerStandby_Replay(App_AcceptSample);
+    switch (PowerStandby_GetBootReason())
     {
-        LOG_ERROR("Sensor initialization failed");
+        case POWER_STANDBY_BOOT_FULL:
+            SensorSimTemp_SetStartTime(0U);
+            PowerManager_RequestMode(PowerStandby_GetMode());
+            break;
+        case POWER_STANDBY_BOOT_BUTTON:
+            SensorSimTemp_SetStartTime(0U);
+            PowerManager_NotifyActivity(POWER_ACTIVITY_BUTTON);
+            break;
+        default:
+            break;
     }
 
-    /* Register periodic tasks with the scheduler. */
-    (void)AppTaskManager_RegisterTask(&s_heartbeatTask);
+    /* Register periodic tasks with the scheduler, in the task set of the
+     * current mode.
+     */
+    AppTaskManager_SetMode((uint32_t)PowerManager_GetCurrentMode());
+
+    /* The low-power modes keep DEBUG and INFO lines for the next wake-up. */
+    Log_SetModeDefer((uint32_t)POWER_MODE_SLEEP, true);
+    Log_SetModeDefer((uint32_t)POWER_MODE_STOP, true);
+    Log_SetMode((uint32_t)PowerManager_GetCurrentMode());
     (void)AppTaskManager_RegisterTask(&s_sensorTask);
+    s_sampleMode = PowerManager_GetCurrentMode();
+    SensorRegistry_SetScheduleHook(App_OnSensorSchedule);
+    (void)AppTaskManager_RegisterTask(&s_sampleLogTask);
+    (void)AppTaskManager_RegisterTask(&s_flashLogTask);
     (void)AppTaskManager_RegisterTask(&s_powerTask);
-    (void)AppTaskManager_RegisterTask(&s_cliTask);
+    (void)AppTaskManager_RegisterTask(&s_metricsTask);
+#if (TRACE_ENABLE != 0)
+    (void)AppTaskManager_RegisterTask(&s_traceTask);
+#endif
+
+    /* Register interrupt-driven tasks and their event sources. */
+    (void)AppTaskManager_RegisterEventTask(&s_cliEventTask);
+    (void)AppTaskManager_RegisterEventTask(&s_buttonEventTask);
+    (void)AppTaskManager_RegisterEventTask(&s_syncEventTask);
+    (void)AppTaskManager_RegisterEventTask(&s_alarmEventTask);
+    (void)AppTaskManager_RegisterEventTask(&s_initEventTask);
+    AppCoroutine_Init();
+    AppWorkQueue_Init();
+    CLI_SetRxHook(App_OnCliRx);
+    if (CLI_IsInputPending())
+    {
+        AppTaskManager_PostEvent(APP_EVENT_CLI_RX);
+    }
+
+    (void)CLI_RegisterCommand("config", App_CmdConfig,
+                              "[defaults] - Show settings / restore defaults");
+    (void)CLI_RegisterCommand("save", App_CmdSave,
+                              "- Store the current settings in flash");
+    (void)CLI_RegisterCommand("set", App_CmdSet,
+                              "<key> <value> - Change a setting (see 'config')");
+    (void)CLI_RegisterCommand("profile", App_CmdProfile,
+                              "[<name> | save <name>] - Sampling profiles (diag, prod)");
+
+    /* Last: from here on the scheduler has to keep the watchdog refreshed. */
+    if (WATCHDOG_ENABLE != 0)
+    {
+        (void)AppTaskManager_StartWatchdog(WATCHDOG_TIMEOUT_MS);
+    }
 
-    LOG_INFO("Application initialization completed");
+    BootTime_Mark(BOOT_PHASE_APP);
+
+    /* Normally the first sampling run posts the rest (App_TaskSensorSample()). */
+    s_initDeferred = true;
+    if (BOOT_DEFER_INIT_ENABLE == 0)
+    {
+        App_InitDeferred();
+    }
+
+    if (!quiet)
+    {
+        LOG_INFO("Application initialization completed");
+    }
 }
 
 void App_MainLoop(void)
 {
     /* Run scheduler once to process any ready tasks. */
     AppTaskManager_RunOnce();
-}
 
-/* ------------------------------------------------------------------------- */
-/* Task implementations                                                      */
-/* ------------------------------------------------------------------------- */
+#if (APP_TICKLESS_IDLE_ENABLE != 0)
+    /* Sleep until the next deadline or interrupt. The pending-event check
+     * is done with interrupts masked: an event posted after it leaves its
+     * interrupt pending, which ends the WFI at once.
+     */
+    uint32_t idle_us = 0U;
+
+    __disable_irq();
+    if (!AppTaskManager_HasPendingEvents())
+    {
+        uint32_t start_us = Time_NowUs32();
+        (void)PowerManager_IdleFor(AppTaskManager_GetTimeUntilNextDeadline());
+        idle_us = Time_NowUs32() - start_us;
+    }
+    __enable_irq();
+
+    /* After the wake-up interrupts have run, which are load. */
+    AppTaskManager_AddIdle(idle_us);
+#endif
+}
 
-static void App_TaskHeartbeat(void)
+bool App_StandbySample(SensorData_t *data)
 {
-    /* This assumes the on-board LED is connected to GPIOA Pin 5 (Nucleo-64). */
-    HAL_GPIO_TogglePin(GPIOA, GPIO_PIN_5);
+    if (!SensorSimTemp_Init())
+    {
+        return false;
+    }
+    /* The HAL tick carries on across STANDBY; so does the waveform. */
+    SensorSimTemp_SetStartTime(0U);
 
-    LOG_INFO("Heartbeat task toggled LED");
+    if (!SensorSimTemp_Read(data))
+    {
+        return false;
+    }
+    data->sensorId = s_simTempSensor.id;
+    return true;
 }
 
+/* ------------------------------------------------------------------------- */
+/* Task implementations                                                      */
+/* ------------------------------------------------------------------------- */
+
 /**
  * @brief Executes one sensor sampling cycle.
  *
- * This task uses the currently active sensor interface (simulated for Phase 2)
- * to retrieve a measurement. Upon success, the function logs the result using
- * the global logging subsystem. Each sample includes the measured value and
- * the timestamp (in milliseconds) when the reading was taken.
- *
- * The effective sampling rate is power-aware and is derived from the
- * SENSOR_PERIOD_* constants defined in @ref app_config.
+ * Reads (or starts reading) every registered sensor that is due in the
+ * current power mode and collects finished asynchronous reads, then sets
+ * this task's period to the time until the next sensor is due, or to a
+ * short poll interval while a read is in flight. With no sensor to sample
+ * in the mode (STOP) the task disables itself.
+ * The scheduler owns the period; nothing else polls for the next sample.
  */
 static void App_TaskSensorSample(void)
 {
-    static uint32_t lastSampleTick_ms = 0U;
+    PowerMode_t mode = PowerManager_GetCurrentMode();
+
+    App_ServiceBoardSensors(mode, HAL_GetTick());
+    (void)SensorRegistry_Service(mode, HAL_GetTick(), App_OnSensorSample);
+    I2cBus_Service(HAL_GetTick());
+    SpiBus_Service(HAL_GetTick());
 
-    const SensorIF_t *sensorIF = Sensor_GetInterface();
-    if (sensorIF == NULL)
+    bool     discovering = SensorDiscovery_Service();
+    uint32_t wait_ms     = SensorRegistry_GetTimeUntilNextDue(mode, HAL_GetTick());
+
+    if (SensorRegistry_HasPendingReads() || discovering)
     {
-        LOG_ERROR("SensorSample: Sensor interface is NULL");
-        return;
+        /* Come back soon to collect the asynchronous result. */
+        wait_ms = SENSOR_SERVICE_POLL_PERIOD_MS;
+    }
+    else if (wait_ms == SENSOR_REGISTRY_NO_DEADLINE)
+    {
+        /* Nothing to sample in this mode: out of the scheduler until the
+         * schedule hook brings the task back.
+         */
+        LOG_DEBUG("SensorSample: sampling disabled in current power mode (%d)", (int)mode);
+        AppTaskManager_SetEnabled(&s_sensorTask, false);
+        wait_ms = SENSOR_SERVICE_MAX_PERIOD_MS;
+    }
+    else if (wait_ms < SENSOR_SERVICE_MIN_PERIOD_MS)
+    {
+        wait_ms = SENSOR_SERVICE_MIN_PERIOD_MS;
+    }
+    else if (wait_ms > SENSOR_SERVICE_MAX_PERIOD_MS)
+    {
+        wait_ms = SENSOR_SERVICE_MAX_PERIOD_MS;
     }
 
-    /* Determine desired sampling period based on power mode. */
-    PowerMode_t mode = PowerManager_GetCurrentMode();
-    uint32_t now_ms  = HAL_GetTick();
-    uint32_t period_ms = 0U;
+    AppTaskManager_SetPeriod(&s_sensorTask, wait_ms);
 
-    switch (mode)
+    if (s_initDeferred)
     {
-        case POWER_MODE_ACTIVE:
-            period_ms = SENSOR_PERIOD_ACTIVE_MS;
-            break;
+        AppTaskManager_PostEvent(APP_EVENT_DEFERRED_INIT);
+    }
+}
 
-        case POWER_MODE_IDLE:
-            period_ms = SENSOR_PERIOD_IDLE_MS;
-            break;
+static void App_ServiceBoardSensors(PowerMode_t mode, uint32_t now_ms)
+{
+#define APP_SENSOR_SERVICE(var, id, name, driver, style, ...)                               \
+    if (SensorRegistry_TakeDue(&s_##var##Sensor, mode, now_ms))                             \
+    {                                                                                       \
+        TRACE_SENSOR_START(id);                                                             \
+        APP_SENSOR_READ_##style(var, (id), driver);                                         \
+    }
+    APP_BOARD_SENSORS(APP_SENSOR_SERVICE)
+#undef APP_SENSOR_SERVICE
+}
 
-        case POWER_MODE_SLEEP:
-            period_ms = SENSOR_PERIOD_SLEEP_MS;
-            break;
+static void App_DeliverBoardSample(SensorEntry_t *entry, const SensorData_t *data)
+{
+    const SensorData_t *stored = SensorRegistry_Record(entry, data);
 
-        case POWER_MODE_STOP:
-        default:
-            period_ms = SENSOR_PERIOD_STOP_MS;
-            break;
+    if (stored != NULL)
+    {
+        App_OnSensorSample(entry, stored);
     }
+}
 
-    /* If period is 0, sampling is disabled in this mode. */
-    if (period_ms == 0U)
+static void App_DeliverBoardBatch(SensorEntry_t *entry, const SensorData_t *batch, size_t count)
+{
+    if (count > SENSOR_REGISTRY_BATCH_MAX)
     {
-        LOG_DEBUG("SensorSample: sampling disabled in current power mode (%d)", (int)mode);
+        (void)SensorRegistry_Record(entry, NULL);
         return;
     }
 
-    /* Check if it's time to sample again. */
-    if ((now_ms - lastSampleTick_ms) < period_ms)
+    for (size_t i = 0U; i < count; ++i)
     {
-        /* Not yet time to sample; exit early. */
-        return;
+        App_DeliverBoardSample(entry, &batch[i]);
     }
+}
+
+static void App_OnSensorSample(const SensorEntry_t *entry, const SensorData_t *data)
+{
+    BootTime_Mark(BOOT_PHASE_FIRST_SAMPLE);
+    App_QueueSample(entry, data);
+}
 
-    lastSampleTick_ms = now_ms;
+static void App_AcceptSample(const SensorData_t *data)
+{
+    App_QueueSample(NULL, data);
+}
+
+static void App_QueueSample(const SensorEntry_t *entry, const SensorData_t *data)
+{
+    HIL_PROBE_MARK(SAMPLE);
 
-    /* Perform the actual sensor read. */
-    SensorData_t data;
-    if (sensorIF->read(&data))
+    /* Sampled and sync readings both come here, the latter from
+     * preemption level 1: the ring and the alarm queue have one producer.
+     */
+    uint32_t key = AppTaskManager_Lock();
+
+    /* Alarms see the sample as acquired, before the ring and the filters. */
+    bool alarm = SensorAlarm_Evaluate(data);
+
+    /* A full ring is counted in the ring statistics (see "status"). */
+    if (alarm || !AppLoadShed_Drop(entry))
     {
-        LOG_INFO("SensorSample: value=%.2f C, timestamp=%lu ms, mode=%d",
-                 data.value,
-                 (unsigned long)data.timestamp,
-                 (int)mode);
+        (void)SampleRing_Push(data);
     }
-    else
+
+    AppTaskManager_Unlock(key);
+
+    if (alarm)
     {
-        LOG_WARN("SensorSample: read failed (mode=%d)", (int)mode);
+        AppTaskManager_PostEvent(APP_EVENT_SENSOR_ALARM);
     }
 }
 
+/**
+ * @brief Drain the sample ring through the filter stage into the log.
+ *
+ * Runs at its own rate, independent of acquisition. Samples are taken
+ * from the ring in blocks so the filters see whole runs (e.g. a FIFO
+ * batch) at once. Sensors with a spectrum or a statistics window are
+ * aggregated and output once per window (see App_OnSpectrum() and
+ * App_OnStatsSummary()). Of the others, only
+ * samples that pass the deadband gate are output: to the flash log when
+ * it is on, and as binary telemetry records when telemetry is on or as
+ * log lines otherwise.
+ *
+ * The load-shedding policy is evaluated first, while the ring still
+ * holds the backlog of the last period.
+ */
+static void App_TaskSampleLog(void)
+{
+    SensorSample_t block[SAMPLE_LOG_BLOCK_SIZE];
+    float          raw[SAMPLE_LOG_BLOCK_SIZE];
+    size_t         count;
+
+    AppLoadShed_Service(HAL_GetTick());
+    AppSelfTest_Service(HAL_GetTick());
+
+    do
+    {
+        count = 0U;
+        while ((count < SAMPLE_LOG_BLOCK_SIZE) && SampleRing_Pop(&s_sampleLogReader, &block[count]))
+        {
+            raw[count] = SensorData_GetFloat(&block[count], 0U);
+            count++;
+        }
+
+        SensorCalib_ProcessSamples(block, count);
+        SensorFilter_ProcessSamples(block, count);
+        SensorSpectrum_ProcessSamples(block, count, App_OnSpectrum);
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            if (SensorSpectrum_IsConfigured(block[i].sensorId))
+            {
+                continue;
+            }
+
+            /* The window sees every filtered sample; the deadband is for outputs. */
+            if (SensorStats_Add(&block[i], App_OnStatsSummary))
+            {
+                continue;
+            }
+
+            SensorDeadbandResult_t gate = SensorDeadband_Check(block[i].sensorId, &block[i]);
+            if (gate == SENSOR_DEADBAND_SUPPRESS)
+            {
+                continue;
+            }
+
+            /* Only real changes count as activity, not max-silence refreshes. */
+            if (gate == SENSOR_DEADBAND_CHANGED)
+            {
+                PowerManager_NotifyActivity(POWER_ACTIVITY_SENSOR);
+            }
+
+            (void)FlashLog_AddSample(&block[i]);
+            (void)SampleArchive_AddSample(&block[i]);
+            (void)Uplink_AddSample(&block[i]);
+
+            if (Telemetry_AddSample(&block[i]))
+            {
+                continue;
+            }
+
+            const SensorEntry_t *entry = SensorRegistry_Find(block[i].sensorId);
+
+            LOG_INFO("SensorSample: %s value=%.2f (raw %.2f), timestamp=%lu ms, mode=%d",
+                     (entry != NULL) ? entry->name : "?",
+                     SensorData_GetFloat(&block[i], 0U),
+                     raw[i],
+                     (unsigned long)block[i].timestamp,
+                     (int)PowerManager_GetCurrentMode());
+        }
+    } while (count == SAMPLE_LOG_BLOCK_SIZE);
+
+    SensorStats_Service(HAL_GetTick(), App_OnStatsSummary);
+    Telemetry_Flush();
+}
+
+/**
+ * @brief Output a statistics window.
+ *
+ * Telemetry carries the full summary as a @ref SENSOR_STATS_FRAME_TYPE
+ * frame. The flash log only stores samples, so the window is logged as
+ * one sample at the window start holding mean, min and max (as many as
+ * fit in SENSOR_MAX_CHANNELS).
+ */
+static void App_OnStatsSummary(const SensorStatsSummary_t *summary)
+{
+    const float  values[3] = { summary->mean, summary->min, summary->max };
+    uint32_t     channels  = (SENSOR_MAX_CHANNELS < 3U) ? SENSOR_MAX_CHANNELS : 3U;
+    SensorData_t sample    = { .sensorId = summary->sensorId };
+
+    SensorData_Init(&sample, SENSOR_FORMAT_S32, channels, summary->scaleExp);
+    for (uint32_t c = 0U; c < channels; ++c)
+    {
+        SensorData_SetFloat(&sample, c, values[c]);
+    }
+    sample.timestamp = summary->start_ms;
+    sample.quality  |= summary->quality;
+    (void)FlashLog_AddSample(&sample);
+    (void)SampleArchive_AddSample(&sample);
+    (void)Uplink_AddSample(&sample);
+
+    if (Telemetry_IsEnabled())
+    {
+        uint8_t record[SENSOR_STATS_RECORD_SIZE];
+        size_t  len = SensorStats_Encode(summary, record);
+
+        (void)Telemetry_SendFrame(SENSOR_STATS_FRAME_TYPE, 1U, summary->start_ms, record, len);
+        return;
+    }
+
+    const SensorEntry_t *entry = SensorRegistry_Find(summary->sensorId);
+
+    LOG_INFO("SensorStats: %s n=%lu min=%.2f max=%.2f mean=%.2f sd=%.3f p%u=%.2f, start=%lu ms",
+             (entry != NULL) ? entry->name : "?",
+             (unsigned long)summary->count,
+             (double)summary->min,
+             (double)summary->max,
+             (double)summary->mean,
+             (double)summary->stddev,
+             (unsigned)summary->percentile,
+             (double)summary->pctValue,
+             (unsigned long)summary->start_ms);
+}
+
+/**
+ * @brief Output a spectrum window.
+ *
+ * Telemetry carries the full record as a @ref SENSOR_SPECTRUM_FRAME_TYPE
+ * frame. The flash log, archive and uplink get one sample at the first
+ * sample's time holding the RMS and the peak amplitude.
+ */
+static void App_OnSpectrum(const SensorSpectrumSummary_t *summary)
+{
+    const float  values[2] = { summary->rms, summary->peak };
+    uint32_t     channels  = (SENSOR_MAX_CHANNELS < 2U) ? SENSOR_MAX_CHANNELS : 2U;
+    SensorData_t sample    = { .sensorId = summary->sensorId };
+
+    SensorData_Init(&sample, SENSOR_FORMAT_S32, channels, summary->scaleExp);
+    for (uint32_t c = 0U; c < channels; ++c)
+    {
+        SensorData_SetFloat(&sample, c, values[c]);
+    }
+    sample.timestamp = summary->start_ms;
+    sample.quality  |= summary->quality;
+    (void)FlashLog_AddSample(&sample);
+    (void)SampleArchive_AddSample(&sample);
+    (void)Uplink_AddSample(&sample);
+
+    if (Telemetry_IsEnabled())
+    {
+        uint8_t record[SENSOR_SPECTRUM_RECORD_MAX];
+        size_t  len = SensorSpectrum_Encode(summary, record);
+
+        (void)Telemetry_SendFrame(SENSOR_SPECTRUM_FRAME_TYPE, 1U, summary->start_ms, record, len);
+        return;
+    }
+
+    const SensorEntry_t *entry = SensorRegistry_Find(summary->sensorId);
+
+    LOG_INFO("SensorSpectrum: %s n=%u rms=%.3f peak=%.3f at %.2f Hz, %lu cycles, start=%lu ms",
+             (entry != NULL) ? entry->name : "?",
+             (unsigned)summary->points,
+             (double)summary->rms,
+             (double)summary->peak,
+             (double)summary->peakHz,
+             (unsigned long)summary->cycles,
+             (unsigned long)summary->start_ms);
+}
+
+/**
+ * @brief Program queued flash log pages, stream dumps and run the
+ *        firmware slot erase.
+ */
+static void App_TaskFlashLog(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    FlashLog_Service(now);
+    FwUpdate_Service(now);
+}
+
 /**
  * @brief Periodically service the power manager.
  *
  * This function is invoked by the Task Manager at a fixed period.
- * In Phase 3/4 it simply delegates to PowerManager_Update(), which
- * logs state transitions and maintains an idle cycle count.
- *
- * Future phases may extend this to adjust sensor sampling rates,
- * trigger low-power entry, or expose power statistics via the CLI.
+ * Delegates to PowerManager_Update(), which runs the adaptive power
+ * policy and applies mode changes. A new mode moves the sensor deadlines
+ * once, here, swaps in the task set of the mode, and its sample period is
+ * published as
+ * @ref METRIC_SAMPLE_PERIOD_MS; App_TaskSensorSample() only ever reads
+ * the period tables. Also starts or stops the ADC scan and the sync group
+ * trigger for the mode, sets the status LED pattern, sends the energy
+ * telemetry and services the log.
  */
 static void App_TaskPowerManager(void)
 {
     PowerManager_Update();
+
+    PowerMode_t mode = PowerManager_GetCurrentMode();
+    if (mode != s_sampleMode)
+    {
+        SensorRegistry_ChangeMode(s_sampleMode, mode, HAL_GetTick());
+        AppTaskManager_SetMode((uint32_t)mode);
+        Log_SetMode((uint32_t)mode);
+        s_sampleMode = mode;
+        App_PublishPeriod();
+    }
+
+    SensorAdc_ApplyMode(mode);
+    SensorSync_ApplyMode(mode);
+    StatusLed_Update(mode,
+                     ((Metrics_Get(METRIC_SENSORS_QUARANTINED) != 0U) ? STATUS_LED_FAULT_SENSOR : 0U) |
+                     (CrashLog_IsHeld() ? STATUS_LED_FAULT_CRASH : 0U));
+
+    /* Report repeats and rate-limited lines of call sites gone quiet. */
+    Log_Service();
+    PowerEnergy_Service(HAL_GetTick());
+    App_ServiceStandby();
+}
+
+/**
+ * @brief Start the duty cycle once nothing is left to send.
+ *
+ * Only in a mode whose sample period is at least
+ * @ref POWER_STANDBY_MIN_PERIOD_MS, while the console is not in use,
+ * and once the sample ring, the flash log and the console output have
+ * drained. Runs from the power manager task, so a mode change made by
+ * the adaptive policy is seen on the same pass.
+ */
+static void App_ServiceStandby(void)
+{
+    PowerMode_t  mode   = PowerManager_GetCurrentMode();
+    uint32_t     period = s_simTempSensor.period_ms[mode];
+    PowerStats_t power;
+
+    if ((Config_Get()->standbyEnabled == 0U) || (period < POWER_STANDBY_MIN_PERIOD_MS) ||
+        s_initDeferred || ((HAL_GetTick() - s_bootTick_ms) < POWER_STANDBY_MIN_AWAKE_MS))
+    {
+        return;
+    }
+
+    uint32_t states = POWER_IDLE_ALLOW(POWER_IDLE_STOP_MAIN) | POWER_IDLE_ALLOW(POWER_IDLE_STOP_LP) |
+                      POWER_IDLE_ALLOW(POWER_IDLE_STANDBY);
+    if (PowerManager_SelectIdleState(period, states) != POWER_IDLE_STANDBY)
+    {
+        return;
+    }
+
+    PowerManager_GetStats(&power);
+    if ((power.consoleHold_ms != 0U) || (SampleRing_GetCount() != 0U) || !UartTx_IsIdle() ||
+        !TelemetryUart_IsIdle() || FlashLog_IsDumping() || FlashLog_IsErasing() ||
+        !FwUpdate_IsIdle())
+    {
+        return;
+    }
+
+    /* Seal the open flash log page and wait for it to be programmed. */
+    FlashLogStats_t flash;
+    FlashLog_Flush();
+    FlashLog_GetStats(&flash);
+    if (flash.pagesQueued != 0U)
+    {
+        return;
+    }
+
+    /* Likewise the archive: its RAM blocks do not survive STANDBY. */
+    SampleArchive_Flush();
+    if (!SampleArchive_IsIdle())
+    {
+        return;
+    }
+
+    /* Let a running uplink burst finish; batches it could not send are
+     * lost, the flash log and the archive still hold the samples. */
+    if (!Uplink_IsIdle())
+    {
+        return;
+    }
+
+    PowerStandby_Start(period, mode);
 }
 
 /**
- * @brief Periodic wrapper around CLI processing.
+ * @brief Export the metrics as telemetry.
  *
- * This task keeps the UART-based CLI responsive by polling CLI_Process()
- * at a fixed rate. The CLI in turn handles user commands such as
- * power mode changes, logging controls, and status queries.
+ * Runs every `metrics_period` ms (see App_ApplyConfig()) and sends the
+ * metrics snapshot, then per-task timings, per-sensor read and error
+ * counts and the power residency as labelled series; names are sent with
+ * every export so a host can start decoding at any frame.
  */
-static void App_TaskCli(void)
+static void App_TaskMetrics(void)
 {
+    if (!Telemetry_IsEnabled() || (Config_Get()->metricsPeriod_ms == 0U))
+    {
+        return;
+    }
+
+    if (!Metrics_BeginExport(HAL_GetTick()))
+    {
+        /* TX ring full: skip this export rather than send half of it. */
+        return;
+    }
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        Metrics_AddLabel(METRICS_LABEL_TASK, (uint8_t)i, AppTaskManager_GetTask(i)->name);
+    }
+    for (uint32_t i = 0U; i < AppTaskManager_GetEventTaskCount(); ++i)
+    {
+        Metrics_AddLabel(METRICS_LABEL_TASK, (uint8_t)(METRICS_EVENT_TASK_ID | i),
+                         AppTaskManager_GetEventTask(i)->name);
+    }
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+        Metrics_AddLabel(METRICS_LABEL_SENSOR, entry->id, entry->name);
+    }
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        const AppTaskDescriptor_t *task = AppTaskManager_GetTask(i);
+        App_AddTaskSeries((uint8_t)i, &task->stats, task->stats.maxLate_us);
+    }
+    for (uint32_t i = 0U; i < AppTaskManager_GetEventTaskCount(); ++i)
+    {
+        const AppEventTask_t *task = AppTaskManager_GetEventTask(i);
+        App_AddTaskSeries((uint8_t)(METRICS_EVENT_TASK_ID | i), &task->stats,
+                          task->maxLatency_us);
+    }
+
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+        Metrics_AddSeries(METRICS_SERIES_SENSOR_READS, entry->id, entry->readCount);
+        Metrics_AddSeries(METRICS_SERIES_SENSOR_ERRORS, entry->id, entry->errorCount);
+        Metrics_AddSeries(METRICS_SERIES_SENSOR_HEALTH, entry->id, entry->health);
+        Metrics_AddSeries(METRICS_SERIES_SENSOR_RECOVERIES, entry->id, entry->recoveries);
+    }
+
+    PowerEnergyTotals_t totals;
+    PowerEnergy_GetTotals(&totals);
+
+    uint64_t run_us   = 0U;
+    uint64_t sleep_us = 0U;
+    for (uint32_t p = 0U; p < CLOCK_PROFILE_COUNT; ++p)
+    {
+        run_us   += totals.profileRun[p].time_us;
+        sleep_us += totals.profileSleep[p].time_us;
+    }
+
+    for (uint32_t m = 0U; m < POWER_MODE_COUNT; ++m)
+    {
+        Metrics_AddSeries(METRICS_SERIES_MODE_TIME_MS, (uint8_t)m,
+                          (uint32_t)(totals.mode[m].time_us / 1000U));
+        Metrics_AddSeries(METRICS_SERIES_MODE_CHARGE_UAH, (uint8_t)m,
+                          (uint32_t)(totals.mode[m].charge_uAus / POWER_ENERGY_UAUS_PER_UAH));
+    }
+    Metrics_AddSeries(METRICS_SERIES_STATE_TIME_MS, (uint8_t)POWER_ENERGY_RUN,
+                      (uint32_t)(run_us / 1000U));
+    Metrics_AddSeries(METRICS_SERIES_STATE_TIME_MS, (uint8_t)POWER_ENERGY_SLEEP,
+                      (uint32_t)(sleep_us / 1000U));
+    Metrics_AddSeries(METRICS_SERIES_STATE_TIME_MS, (uint8_t)POWER_ENERGY_STOP,
+                      (uint32_t)(totals.stop.time_us / 1000U));
+
+    Metrics_EndExport();
+}
+
+/**
+ * @brief Consume received CLI input.
+ *
+ * The CLI in turn handles user commands such as power mode changes,
+ * logging controls, and status queries.
+ */
+static void App_EventCli(uint32_t events)
+{
+    (void)events;
+
+    /* The event also comes for prompt redraws, which are not user activity. */
+    if (CLI_IsInputPending())
+    {
+        PowerManager_NotifyActivity(POWER_ACTIVITY_CLI);
+    }
     CLI_Process();
 }
+
+/**
+ * @brief Return to ACTIVE mode on a button press.
+ *
+ * EXTI line 13 also wakes the core from SLEEP and STOP, so the press is
+ * handled on the first scheduler pass after the wake-up.
+ */
+static void App_EventButton(uint32_t events)
+{
+    static uint32_t s_lastPress_ms = 0U;
+
+    (void)events;
+
+    uint32_t now_ms = HAL_GetTick();
+    if ((now_ms - s_lastPress_ms) < APP_BUTTON_DEBOUNCE_MS)
+    {
+        return;
+    }
+    s_lastPress_ms = now_ms;
+
+    LOG_INFO("Button pressed, requesting ACTIVE mode");
+    PowerManager_NotifyActivity(POWER_ACTIVITY_BUTTON);
+    PowerManager_RequestMode(POWER_MODE_ACTIVE);
+}
+
+static void App_EventSensorSync(uint32_t events)
+{
+    (void)events;
+
+    (void)SensorSync_Drain(App_OnSensorSample);
+}
+
+static void App_EventSensorAlarm(uint32_t events)
+{
+    SensorAlarmEvent_t event;
+
+    (void)events;
+
+    while (SensorAlarm_PopEvent(&event))
+    {
+        const SensorEntry_t *entry = SensorRegistry_Find(event.sensorId);
+        const char          *name  = (entry != NULL) ? entry->name : "?";
+
+        if (!event.raised)
+        {
+            LOG_INFO("Alarm %u cleared: %s %s, value=%.3f, timestamp=%lu ms",
+                     (unsigned)event.rule, name, SensorAlarm_KindName(event.kind),
+                     (double)event.value, (unsigned long)event.timestamp);
+            continue;
+        }
+
+        LOG_WARN("Alarm %u raised: %s %s, value=%.3f threshold=%.3f, timestamp=%lu ms",
+                 (unsigned)event.rule, name, SensorAlarm_KindName(event.kind),
+                 (double)event.value, (double)event.threshold,
+                 (unsigned long)event.timestamp);
+
+        if (event.wake)
+        {
+            PowerManager_NotifyActivity(POWER_ACTIVITY_ALARM);
+            PowerManager_RequestMode(POWER_MODE_ACTIVE);
+        }
+    }
+}
+
+static void App_EventDeferredInit(uint32_t events)
+{
+    (void)events;
+
+    if (s_initDeferred)
+    {
+        App_InitDeferred();
+    }
+}
+
+static void App_InitDeferred(void)
+{
+    s_initDeferred = false;
+
+    UsbCdc_Init();
+    I2cBus_Init();
+    SpiBus_Init();
+    SensorDiscovery_Start();
+    SampleArchive_Init();
+    Uplink_Init();
+    FwUpdate_Init();
+    SensorFarm_Init();
+    (void)SensorFarm_SetCount(SENSOR_FARM_DEFAULT_COUNT);
+    SensorReplay_Init();
+#if (HIL_PROBE_ENABLE != 0)
+    HilProbe_Init();
+#endif
+    SensorAdc_Init();
+    SensorSync_Init();
+    SensorSync_SetFrameHook(App_OnSyncFrame);
+
+    if ((BOOT_FAST_RESUME_ENABLE == 0) || !BootTime_IsResume())
+    {
+        CLI_PrintBanner();
+    }
+
+    BootTime_Mark(BOOT_PHASE_READY);
+}
+
+static void App_OnCliRx(void)
+{
+    AppTaskManager_PostEvent(APP_EVENT_CLI_RX);
+}
+
+static void App_OnSyncFrame(void)
+{
+    AppTaskManager_PostEvent(APP_EVENT_SENSOR_SYNC);
+}
+
+/**
+ * @brief EXTI callback (overrides the weak HAL definition).
+ *
+ * @param GPIO_Pin Pin whose EXTI line fired.
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    if (GPIO_Pin == B1_Pin)
+    {
+        AppTaskManager_PostEvent(APP_EVENT_BUTTON);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Runtime configuration                                                     */
+/* ------------------------------------------------------------------------- */
+
+/** @brief Config keys of one stored alarm rule. */
+#define APP_ALARM_KEY(key, member, def, min, max)   #key,
+
+/**
+ * @brief Config keys of the stored alarm rules: rule, threshold, hysteresis.
+ */
+static const char *const s_alarmKeys[CONFIG_ALARM_RULES][3] =
+{
+    { CONFIG_ALARM_FIELDS(APP_ALARM_KEY, 0) },
+    { CONFIG_ALARM_FIELDS(APP_ALARM_KEY, 1) },
+    { CONFIG_ALARM_FIELDS(APP_ALARM_KEY, 2) },
+    { CONFIG_ALARM_FIELDS(APP_ALARM_KEY, 3) }
+};
+
+#undef APP_ALARM_KEY
+
+/** @brief Config keys of one stored calibration. */
+#define APP_CALIB_KEY(key, member, def, min, max)   #key,
+
+/**
+ * @brief Config keys of the stored calibrations: sensor, c0 to c3, span.
+ */
+static const char *const s_calibKeys[CONFIG_CALIB_SLOTS][7] =
+{
+    { CONFIG_CALIB_FIELDS(APP_CALIB_KEY, 0) },
+    { CONFIG_CALIB_FIELDS(APP_CALIB_KEY, 1) }
+};
+
+#undef APP_CALIB_KEY
+
+/** @brief Config keys of one stored profile. */
+#define APP_PROFILE_KEY(key, member, def, min, max)   #key,
+
+/** @brief Fields per profile (CONFIG_PROFILE_FIELDS). */
+#define APP_PROFILE_FIELDS   (9U)
+
+/**
+ * @brief Config keys of the stored profiles: periods, filter, deadband,
+ *        silence, log, power, telemetry.
+ */
+static const char *const s_profileKeys[CONFIG_PROFILES][APP_PROFILE_FIELDS] =
+{
+    { CONFIG_PROFILE_FIELDS(APP_PROFILE_KEY, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0) },
+    { CONFIG_PROFILE_FIELDS(APP_PROFILE_KEY, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0) }
+};
+
+#undef APP_PROFILE_KEY
+
+/** @brief Profile names, indexed like the stored profiles. */
+static const char *const s_profileNames[CONFIG_PROFILES] = { "diag", "prod" };
+
+/** @brief Base settings a profile sets: period_active, _idle, _sleep. */
+static const char *const s_profilePeriodKeys[3] = { "period_active", "period_idle", "period_sleep" };
+
+_Static_assert(CONFIG_ALARM_RULES <= SENSOR_ALARM_MAX_RULES, "stored alarm rules must fit");
+_Static_assert(CONFIG_CALIB_SLOTS <= SENSOR_CALIB_MAX_SENSORS, "stored calibrations must fit");
+_Static_assert(SENSOR_CALIB_TERMS == 4U, "calibN_c0 to calibN_c3");
+
+static void App_ApplyConfig(void)
+{
+    const ConfigData_t *cfg = Config_Get();
+
+    s_simTempSensor.period_ms[POWER_MODE_ACTIVE] = cfg->periodActive_ms;
+    s_simTempSensor.period_ms[POWER_MODE_IDLE]   = cfg->periodIdle_ms;
+    s_simTempSensor.period_ms[POWER_MODE_SLEEP]  = cfg->periodSleep_ms;
+    App_PublishPeriod();
+    App_OnSensorSchedule();
+
+    /* Off (0) keeps the default period; the task then returns at once. */
+    AppTaskManager_SetPeriod(&s_metricsTask, (cfg->metricsPeriod_ms != 0U) ?
+                                             cfg->metricsPeriod_ms : METRICS_TELEMETRY_MS);
+
+    Log_SetLevel((LogLevel_t)cfg->logLevel);
+    Log_Enable(cfg->logEnabled != 0U);
+    Log_SetBudget(cfg->logBudget);
+    Telemetry_SetFormat((TelemetryFormat_t)cfg->telemetryFormat);
+    Telemetry_SetEnabled(cfg->telemetryEnabled != 0U);
+    FlashLog_SetEnabled(cfg->flashLogEnabled != 0U);
+
+    bool over8 = false;
+    if ((UartTx_GetBaudRate(&over8) != cfg->consoleBaud) || (over8 != (cfg->consoleOver8 != 0U)))
+    {
+        if (!UartTx_SetBaudRate(cfg->consoleBaud, cfg->consoleOver8 != 0U))
+        {
+            LOG_WARN("Console: %lu baud not reachable, staying at %lu",
+                     (unsigned long)cfg->consoleBaud, (unsigned long)UartTx_GetBaudRate(NULL));
+        }
+    }
+
+    if (TelemetryUart_IsActive() && (TelemetryUart_GetBaudRate() != cfg->telemetryBaud) &&
+        !TelemetryUart_SetBaudRate(cfg->telemetryBaud))
+    {
+        LOG_WARN("Telemetry UART: %lu baud not reachable, staying at %lu",
+                 (unsigned long)cfg->telemetryBaud, (unsigned long)TelemetryUart_GetBaudRate());
+    }
+
+    for (uint32_t i = 0U; i < CONFIG_ALARM_RULES; ++i)
+    {
+        uint32_t          packed = 0U;
+        uint32_t          bits[2] = { 0U, 0U };
+        SensorAlarmRule_t rule;
+        SensorAlarmRule_t current;
+
+        (void)Config_GetValue(s_alarmKeys[i][0], &packed);
+        (void)Config_GetValue(s_alarmKeys[i][1], &bits[0]);
+        (void)Config_GetValue(s_alarmKeys[i][2], &bits[1]);
+
+        rule.sensorId = (uint8_t)(packed & 0xFFU);
+        rule.kind     = (uint8_t)((packed >> 8) & 0xFFU);
+        rule.wake     = ((packed >> 16) & 1U) != 0U;
+        memcpy(&rule.threshold, &bits[0], sizeof(rule.threshold));
+        memcpy(&rule.hysteresis, &bits[1], sizeof(rule.hysteresis));
+
+        bool present = SensorAlarm_GetRule(i, &current, NULL);
+
+        /* Unchanged rules keep their state, so 'set' does not re-raise alarms. */
+        if (present && (packed != 0U) && (current.sensorId == rule.sensorId) &&
+            (current.kind == rule.kind) && (current.wake == rule.wake) &&
+            (memcmp(&current.threshold, &rule.threshold, sizeof(float)) == 0) &&
+            (memcmp(&current.hysteresis, &rule.hysteresis, sizeof(float)) == 0))
+        {
+            continue;
+        }
+
+        if ((packed == 0U) || !SensorAlarm_SetRule(i, &rule))
+        {
+            rule.kind = (uint8_t)SENSOR_ALARM_NONE;
+            (void)SensorAlarm_SetRule(i, &rule);
+        }
+    }
+
+    for (uint32_t i = 0U; i < CONFIG_CALIB_SLOTS; ++i)
+    {
+        uint32_t            packed = 0U;
+        uint32_t            bits[6] = { 0U };
+        SensorCalibConfig_t calib;
+
+        (void)Config_GetValue(s_calibKeys[i][0], &packed);
+        for (uint32_t k = 0U; k < 6U; ++k)
+        {
+            (void)Config_GetValue(s_calibKeys[i][k + 1U], &bits[k]);
+        }
+
+        calib.channel = (uint8_t)((packed >> 8) & 0xFFU);
+        memcpy(calib.coeff, &bits[0], sizeof(calib.coeff));
+        memcpy(&calib.lo, &bits[4], sizeof(calib.lo));
+        memcpy(&calib.hi, &bits[5], sizeof(calib.hi));
+
+        /* Points are kept when the slot already holds this sensor and channel. */
+        if ((packed == 0U) ||
+            !SensorCalib_ConfigureSlot(i, (uint8_t)(packed & 0xFFU), &calib))
+        {
+            (void)SensorCalib_ConfigureSlot(i, 0U, NULL);
+        }
+    }
+}
+
+static void App_AddTaskSeries(uint8_t id, const AppTaskStats_t *stats, uint32_t late_us)
+{
+    Metrics_AddSeries(METRICS_SERIES_TASK_RUNS, id, stats->runCount);
+    Metrics_AddSeries(METRICS_SERIES_TASK_MAX_RUN_US, id, stats->maxRun_us);
+    Metrics_AddSeries(METRICS_SERIES_TASK_MAX_LATE_US, id, late_us);
+    Metrics_AddSeries(METRICS_SERIES_TASK_OVERRUNS, id, stats->overruns);
+    Metrics_AddSeries(METRICS_SERIES_TASK_BUDGET_OVERRUNS, id, stats->budgetOverruns);
+    Metrics_AddSeries(METRICS_SERIES_TASK_LOAD, id, stats->sharePermille);
+}
+
+static void App_PublishPeriod(void)
+{
+    Metrics_Set(METRIC_SAMPLE_PERIOD_MS,
+                s_simTempSensor.period_ms[PowerManager_GetCurrentMode()]);
+}
+
+static void App_OnSensorSchedule(void)
+{
+    AppTaskManager_SetEnabled(&s_sensorTask, true);
+    AppTaskManager_Reschedule(&s_sensorTask, HAL_GetTick());
+}
+
+static void App_CaptureConfig(void)
+{
+    (void)Config_Set("log_enable", Log_IsEnabled() ? 1U : 0U);
+    (void)Config_Set("log_level", (uint32_t)Log_GetLevel());
+    (void)Config_Set("telem", Telemetry_IsEnabled() ? 1U : 0U);
+    (void)Config_Set("telem_format", (uint32_t)Telemetry_GetFormat());
+    (void)Config_Set("flashlog", FlashLog_IsEnabled() ? 1U : 0U);
+
+    bool over8 = false;
+    (void)Config_Set("baud", UartTx_GetBaudRate(&over8));
+    (void)Config_Set("baud_over8", over8 ? 1U : 0U);
+    if (TelemetryUart_IsActive())
+    {
+        (void)Config_Set("telem_baud", TelemetryUart_GetBaudRate());
+    }
+
+    for (uint32_t i = 0U; i < CONFIG_ALARM_RULES; ++i)
+    {
+        SensorAlarmRule_t rule;
+        uint32_t          packed  = 0U;
+        uint32_t          bits[2] = { 0U, 0U };
+
+        if (SensorAlarm_GetRule(i, &rule, NULL))
+        {
+            packed = (uint32_t)rule.sensorId | ((uint32_t)rule.kind << 8) |
+                     (rule.wake ? 0x10000U : 0U);
+            memcpy(&bits[0], &rule.threshold, sizeof(bits[0]));
+            memcpy(&bits[1], &rule.hysteresis, sizeof(bits[1]));
+        }
+
+        (void)Config_Set(s_alarmKeys[i][0], packed);
+        (void)Config_Set(s_alarmKeys[i][1], bits[0]);
+        (void)Config_Set(s_alarmKeys[i][2], bits[1]);
+    }
+
+    for (uint32_t i = 0U; i < CONFIG_CALIB_SLOTS; ++i)
+    {
+        SensorCalibConfig_t calib;
+        uint8_t             sensorId = 0U;
+        uint32_t            packed   = 0U;
+        uint32_t            bits[6]  = { 0U };
+
+        if (SensorCalib_GetSlot(i, &sensorId, &calib, NULL))
+        {
+            packed = (uint32_t)sensorId | ((uint32_t)calib.channel << 8) | 0x10000U;
+            memcpy(&bits[0], calib.coeff, sizeof(calib.coeff));
+            memcpy(&bits[4], &calib.lo, sizeof(bits[4]));
+            memcpy(&bits[5], &calib.hi, sizeof(bits[5]));
+        }
+
+        (void)Config_Set(s_calibKeys[i][0], packed);
+        for (uint32_t k = 0U; k < 6U; ++k)
+        {
+            (void)Config_Set(s_calibKeys[i][k + 1U], bits[k]);
+        }
+    }
+}
+
+static void App_CmdConfig(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "defaults") == 0))
+    {
+        Config_ResetDefaults();
+        App_ApplyConfig();
+        CLI_Print("\r\nDefaults restored (use 'save' to store them).\r\n");
+        return;
+    }
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: config [defaults]\r\n");
+        return;
+    }
+
+    ConfigInfo_t info;
+    Config_GetInfo(&info);
+
+    App_CaptureConfig();
+
+    CLI_Print("\r\nSettings (%s):\r\n", info.fromFlash ? "flash" : "defaults");
+
+    const char *key;
+    uint32_t    value;
+    for (uint32_t i = 0U; Config_GetField(i, &key, &value); ++i)
+    {
+        CLI_Print("  %-13s %lu\r\n", key, (unsigned long)value);
+    }
+
+    CLI_Print("Store: record %lu, sector %lu, %lu/%lu slots used\r\n",
+              (unsigned long)info.seq, (unsigned long)info.sector,
+              (unsigned long)info.slotsUsed, (unsigned long)info.slotsTotal);
+}
+
+static void App_CmdSet(uint32_t argc, char *argv[])
+{
+    char         *end   = NULL;
+    unsigned long value = 0UL;
+
+    if (argc == 3U)
+    {
+        value = strtoul(argv[2], &end, 10);
+    }
+
+    if ((end == NULL) || (end == argv[2]) || (*end != '\0'))
+    {
+        CLI_PrintError("\r\nUsage: set <key> <value>\r\n");
+        return;
+    }
+
+    /* Pick up changes made with 'log' / 'telem' / 'flashlog' first. */
+    App_CaptureConfig();
+
+    if (!Config_Set(argv[1], (uint32_t)value))
+    {
+        CLI_PrintError("\r\nUnknown key or value out of range: %s %lu\r\n", argv[1], value);
+        return;
+    }
+
+    App_ApplyConfig();
+    CLI_Print("\r\n%s = %lu\r\n", argv[1], value);
+}
+
+static void App_CmdSave(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    App_CaptureConfig();
+
+    switch (Config_Save())
+    {
+        case CONFIG_SAVE_OK:
+        {
+            ConfigInfo_t info;
+            Config_GetInfo(&info);
+            CLI_Print("\r\nSettings saved (record %lu).\r\n", (unsigned long)info.seq);
+            break;
+        }
+        case CONFIG_SAVE_UNCHANGED:
+            CLI_Print("\r\nSettings unchanged, nothing to save.\r\n");
+            break;
+        case CONFIG_SAVE_BUSY:
+            CLI_PrintError("\r\nFlash busy (sector erase running), try again.\r\n");
+            break;
+        default:
+            CLI_PrintError("\r\nSave failed.\r\n");
+            break;
+    }
+}
+
+static void App_ApplyProfileStages(uint32_t index)
+{
+    uint32_t v[APP_PROFILE_FIELDS];
+
+    for (uint32_t k = 0U; k < APP_PROFILE_FIELDS; ++k)
+    {
+        (void)Config_GetValue(s_profileKeys[index][k], &v[k]);
+    }
+
+    const SensorFilterConfig_t filter =
+    {
+        .medianWindow  = (uint8_t)(v[3] & 0xFFU),
+        .averageWindow = (uint8_t)((v[3] >> 8) & 0xFFU),
+        .iirAlpha      = (float)(v[3] >> 16) / 1000.0f
+    };
+    const SensorDeadbandConfig_t deadband =
+    {
+        .deadband      = (float)v[4] / 1000.0f,
+        .maxSilence_ms = v[5]
+    };
+
+#define APP_SENSOR_PROFILE(var, id, ...)                                                     \
+    if (!SensorFilter_Configure((id), &filter) || !SensorDeadband_Configure((id), &deadband)) \
+    {                                                                                       \
+        LOG_WARN("Profile %s: stages of sensor %u rejected", s_profileNames[index], (unsigned)(id)); \
+    }
+    APP_BOARD_SENSORS(APP_SENSOR_PROFILE)
+#undef APP_SENSOR_PROFILE
+
+    bool adaptive = ((v[7] & 1U) != 0U);
+
+    PowerManager_SetAutoPolicy(adaptive);
+    if (!adaptive)
+    {
+        /* A manual profile samples at its full rate. */
+        PowerManager_RequestMode(POWER_MODE_ACTIVE);
+    }
+}
+
+static void App_WorkProfile(void *context)
+{
+    uint32_t index = (uint32_t)(uintptr_t)context;
+    uint32_t v[APP_PROFILE_FIELDS];
+
+    for (uint32_t k = 0U; k < APP_PROFILE_FIELDS; ++k)
+    {
+        (void)Config_GetValue(s_profileKeys[index][k], &v[k]);
+    }
+
+    /* Every setting in one go between two tasks: the sampling task sees
+     * either the old profile or the new one, and the registry keeps each
+     * sensor's phase, so no sample is lost or doubled.
+     */
+    App_CaptureConfig();
+    for (uint32_t k = 0U; k < 3U; ++k)
+    {
+        (void)Config_Set(s_profilePeriodKeys[k], v[k]);
+    }
+    (void)Config_Set("log_level", v[6] & 0xFFU);
+    (void)Config_Set("log_enable", (v[6] >> 8) & 1U);
+    (void)Config_Set("standby", (v[7] >> 1) & 1U);
+    (void)Config_Set("telem_format", v[8] & 0xFFU);
+    (void)Config_Set("telem", (v[8] >> 8) & 1U);
+    (void)Config_Set("profile", index + 1U);
+
+    App_ApplyConfig();
+    App_ApplyProfileStages(index);
+
+    LOG_INFO("Profile %s active", s_profileNames[index]);
+}
+
+static void App_CaptureProfile(uint32_t index)
+{
+    const ConfigData_t    *cfg = Config_Get();
+    SensorFilterConfig_t   filter;
+    SensorDeadbandConfig_t deadband = { 0.0f, 0U };
+    uint8_t                id = s_simTempSensor.id;
+
+    App_CaptureConfig();
+    (void)SensorFilter_GetConfig(id, &filter);
+    (void)SensorDeadband_Get(id, &deadband, NULL);
+
+    const uint32_t v[APP_PROFILE_FIELDS] =
+    {
+        cfg->periodActive_ms,
+        cfg->periodIdle_ms,
+        cfg->periodSleep_ms,
+        CONFIG_PROFILE_FILTER(filter.medianWindow, filter.averageWindow, filter.iirAlpha),
+        (uint32_t)((deadband.deadband * 1000.0f) + 0.5f),
+        deadband.maxSilence_ms,
+        cfg->logLevel | (cfg->logEnabled << 8),
+        (PowerManager_IsAutoPolicy() ? 1U : 0U) | (cfg->standbyEnabled << 1),
+        cfg->telemetryFormat | (cfg->telemetryEnabled << 8)
+    };
+
+    for (uint32_t k = 0U; k < APP_PROFILE_FIELDS; ++k)
+    {
+        (void)Config_Set(s_profileKeys[index][k], v[k]);
+    }
+}
+
+static void App_CmdProfile(uint32_t argc, char *argv[])
+{
+    static const char *const s_levelNames[]  = { "debug", "info", "warn", "error" };
+    static const char *const s_formatNames[] = { "f32", "i16", "delta", "xor", "raw" };
+
+    const char *name  = (argc == 2U) ? argv[1] : ((argc == 3U) ? argv[2] : NULL);
+    uint32_t    index = CONFIG_PROFILES;
+
+    for (uint32_t i = 0U; (name != NULL) && (i < CONFIG_PROFILES); ++i)
+    {
+        if (strcmp(name, s_profileNames[i]) == 0)
+        {
+            index = i;
+        }
+    }
+
+    if ((argc == 2U) && (index < CONFIG_PROFILES))
+    {
+        if (!AppWorkQueue_Post(App_WorkProfile, (void *)(uintptr_t)index))
+        {
+            CLI_PrintError("\r\nWork queue full, try again.\r\n");
+            return;
+        }
+        CLI_Print("\r\nSwitching to profile %s ('save' keeps it across resets).\r\n", name);
+        return;
+    }
+
+    if ((argc == 3U) && (strcmp(argv[1], "save") == 0) && (index < CONFIG_PROFILES))
+    {
+        App_CaptureProfile(index);
+        CLI_Print("\r\nProfile %s = current settings ('save' to store).\r\n", name);
+        return;
+    }
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: profile [diag|prod | save diag|prod]\r\n");
+        return;
+    }
+
+    uint32_t active = Config_Get()->profile;
+
+    CLI_Print("\r\nProfiles (active: %s)\r\n", (active != 0U) ? s_profileNames[active - 1U] : "none");
+    CLI_Print("  name  periods (ms)       median avg iir    deadband silence log   power    telem\r\n");
+
+    for (uint32_t i = 0U; i < CONFIG_PROFILES; ++i)
+    {
+        uint32_t v[APP_PROFILE_FIELDS];
+
+        for (uint32_t k = 0U; k < APP_PROFILE_FIELDS; ++k)
+        {
+            (void)Config_GetValue(s_profileKeys[i][k], &v[k]);
+        }
+
+        uint32_t level  = v[6] & 0xFFU;
+        uint32_t format = v[8] & 0xFFU;
+
+        CLI_Print("%c %-5s %5lu/%5lu/%6lu %6lu %3lu %5.3f %8.3f %7lu %-5s %-8s %s\r\n",
+                  ((i + 1U) == active) ? '*' : ' ', s_profileNames[i],
+                  (unsigned long)v[0], (unsigned long)v[1], (unsigned long)v[2],
+                  (unsigned long)(v[3] & 0xFFU), (unsigned long)((v[3] >> 8) & 0xFFU),
+                  (double)((float)(v[3] >> 16) / 1000.0f), (double)((float)v[4] / 1000.0f),
+                  (unsigned long)v[5],
+                  (((v[6] >> 8) & 1U) == 0U) ? "off" : ((level < 4U) ? s_levelNames[level] : "?"),
+                  ((v[7] & 1U) != 0U) ? (((v[7] & 2U) != 0U) ? "auto+stb" : "auto") : "manual",
+                  (((v[8] >> 8) & 1U) == 0U) ? "off" : ((format < 5U) ? s_formatNames[format] : "?"));
+    }
+}
@@ -11,6 +11,9 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
+#include "sensor_if.h"
+
 /**
  * @defgroup app Application Core
  * @brief High-level application control for the Smart Sensor Hub.
@@ -43,6 +46,19 @@ void App_MainInit(void);
  */
 void App_MainLoop(void);
 
+/**
+ * @brief Take the sample of a STANDBY duty cycle wakeup.
+ *
+ * The @ref PowerStandbySampleFn_t passed to PowerStandby_Boot() by
+ * main(): reads the primary sensor once, before anything else of the
+ * application has been initialized.
+ *
+ * @param[out] data Sample.
+ *
+ * @return false if the sensor could not be read.
+ */
+bool App_StandbySample(SensorData_t *data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,468 @@
+/**
+ * @file app_selftest.c
+ * @brief Sustained-load self-test implementation.
+ *
+ * Nothing here measures on its own: the run sets up the load, clears the
+ * task statistics and the ring high-water mark, and reads back what the
+ * task manager, the sample ring and the metrics registry counted. Only
+ * the console TX ring has no high-water mark; it is sampled on every
+ * service call.
+ *
+ * The run's own log lines are paced from the elapsed time, so a late
+ * service call catches up (up to @ref SELFTEST_LOG_BURST at once) instead
+ * of lowering the rate.
+ *
+ * @ingroup app
+ */
+
+#include "app_selftest.h"
+#include "app_config.h"
+#include "app_load_shed.h"
+#include "app_task_manager.h"
+#include "cli.h"
+#include "log.h"
+#include "metrics.h"
+#include "power_manager.h"
+#include "sample_ring.h"
+#include "sensor_farm.h"
+#include "sensor_registry.h"
+#include "telemetry.h"
+#include "uart_tx.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Most of the run's own log lines written by one service call. */
+#define SELFTEST_LOG_BURST   (8U)
+
+/**
+ * @brief Phases of a run.
+ */
+typedef enum
+{
+    SELFTEST_PHASE_IDLE = 0U, /**< No run.                                */
+    SELFTEST_PHASE_RUN,       /**< Under load.                            */
+    SELFTEST_PHASE_DRAIN      /**< Load removed, waiting for the console. */
+} SelfTestPhase_t;
+
+/**
+ * @brief Settings the run changes, restored at its end.
+ */
+typedef struct
+{
+    uint32_t    farmCount;  /**< Active farm channels.  */
+    bool        telemetry;  /**< Telemetry on.          */
+    bool        shed;       /**< Load shedding on.      */
+    bool        autoPolicy; /**< Adaptive power policy. */
+    PowerMode_t mode;       /**< Mode, if manual.       */
+} SelfTestSaved_t;
+
+/** @brief Phase of the run. */
+static SelfTestPhase_t s_phase = SELFTEST_PHASE_IDLE;
+
+/** @brief Outcome (AppSelfTestOutcome_t), published as a metric. */
+static volatile uint32_t s_outcome = (uint32_t)APP_SELFTEST_NONE;
+
+/** @brief Settings to restore. */
+static SelfTestSaved_t s_saved;
+
+/** @brief Measurements of the run in progress or the last one. */
+static AppSelfTestResult_t s_result;
+
+/** @brief Metrics at the start of the run. */
+static uint32_t s_startMetrics[METRIC_COUNT];
+
+/** @brief Tick of the start, and of the end of the load. */
+static uint32_t s_start_ms = 0U;
+static uint32_t s_end_ms   = 0U;
+
+/** @brief Requested run length. */
+static uint32_t s_duration_ms = 0U;
+
+/** @brief Samples due per 1000 s at the configured rates. */
+static uint32_t s_rate_mHz = 0U;
+
+/** @brief A run was reported. */
+static bool s_reported = false;
+
+/**
+ * @brief Sum of the ACTIVE sample rates of the scheduled sensors, in
+ *        samples per 1000 s.
+ */
+static uint32_t AppSelfTest_ConfiguredRate(void);
+
+/**
+ * @brief Write the log lines due by @p now_ms.
+ */
+static void AppSelfTest_Log(uint32_t now_ms);
+
+/**
+ * @brief Take the measurements and give back the settings.
+ */
+static void AppSelfTest_Finish(uint32_t now_ms);
+
+/**
+ * @brief Check the measurements against the targets.
+ */
+static void AppSelfTest_Evaluate(AppSelfTestResult_t *result);
+
+/**
+ * @brief Print the report of the last run.
+ */
+static void AppSelfTest_Report(void);
+
+/**
+ * @brief Percentage of @p part in @p whole, 0 for an empty whole.
+ */
+static uint32_t AppSelfTest_Percent(uint32_t part, uint32_t whole);
+
+/**
+ * @brief CLI command "selftest": start, stop or show a run.
+ */
+static void AppSelfTest_CmdSelfTest(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void AppSelfTest_Init(void)
+{
+    s_phase    = SELFTEST_PHASE_IDLE;
+    s_outcome  = (uint32_t)APP_SELFTEST_NONE;
+    s_reported = false;
+
+    Metrics_Publish(METRIC_SELFTEST_RESULT, &s_outcome);
+
+    (void)CLI_RegisterCommand("selftest", AppSelfTest_CmdSelfTest,
+                              "[<s> | stop | last] - Run at full load and check the targets");
+}
+
+bool AppSelfTest_Start(uint32_t seconds)
+{
+    if ((s_phase != SELFTEST_PHASE_IDLE) || (seconds == 0U) || (seconds > SELFTEST_MAX_S))
+    {
+        return false;
+    }
+
+    s_saved.farmCount  = SensorFarm_GetCount();
+    s_saved.telemetry  = Telemetry_IsEnabled();
+    s_saved.shed       = AppLoadShed_IsEnabled();
+    s_saved.autoPolicy = PowerManager_IsAutoPolicy();
+    s_saved.mode       = PowerManager_GetCurrentMode();
+
+    /* Shedding would take the load away that is to be proven. */
+    AppLoadShed_SetEnabled(false);
+    PowerManager_SetAutoPolicy(false);
+    PowerManager_RequestMode(POWER_MODE_ACTIVE);
+
+    (void)memset(&s_result, 0, sizeof(s_result));
+    s_result.channels = SensorFarm_SetCount(SELFTEST_FARM_CHANNELS);
+
+    Telemetry_SetEnabled(true);
+
+    s_rate_mHz    = AppSelfTest_ConfiguredRate();
+    s_duration_ms = seconds * 1000U;
+
+    uint32_t key = AppTaskManager_Lock();
+    AppTaskManager_ResetStats();
+    SampleRing_ResetHighWater();
+    AppTaskManager_Unlock(key);
+
+    Metrics_Snapshot(s_startMetrics);
+    s_start_ms = HAL_GetTick();
+    s_phase    = SELFTEST_PHASE_RUN;
+    s_outcome  = (uint32_t)APP_SELFTEST_RUNNING;
+    return true;
+}
+
+void AppSelfTest_Stop(void)
+{
+    if (s_phase == SELFTEST_PHASE_RUN)
+    {
+        AppSelfTest_Finish(HAL_GetTick());
+    }
+}
+
+void AppSelfTest_Service(uint32_t now_ms)
+{
+    if (s_phase == SELFTEST_PHASE_RUN)
+    {
+        size_t pending = UartTx_GetPending();
+        if (pending > s_result.txHighWater)
+        {
+            s_result.txHighWater = (uint32_t)pending;
+        }
+
+        if ((now_ms - s_start_ms) >= s_duration_ms)
+        {
+            AppSelfTest_Finish(now_ms);
+        }
+        else
+        {
+            AppSelfTest_Log(now_ms);
+        }
+    }
+    else if ((s_phase == SELFTEST_PHASE_DRAIN) &&
+             (UartTx_IsIdle() || ((now_ms - s_end_ms) >= SELFTEST_DRAIN_MS)))
+    {
+        s_phase    = SELFTEST_PHASE_IDLE;
+        s_reported = true;
+        AppSelfTest_Report();
+        CLI_OnExternalOutput();
+    }
+}
+
+bool AppSelfTest_IsRunning(void)
+{
+    return s_phase != SELFTEST_PHASE_IDLE;
+}
+
+bool AppSelfTest_GetResult(AppSelfTestResult_t *result)
+{
+    if ((result == NULL) || !s_reported)
+    {
+        return false;
+    }
+
+    *result = s_result;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t AppSelfTest_ConfiguredRate(void)
+{
+    uint32_t rate  = 0U;
+    uint32_t count = SensorRegistry_GetCount();
+
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+
+        /* Direct sensors are read at their caller's rate, not a period. */
+        if ((entry != NULL) && !entry->direct && (entry->period_ms[POWER_MODE_ACTIVE] != 0U))
+        {
+            rate += 1000000U / entry->period_ms[POWER_MODE_ACTIVE];
+        }
+    }
+
+    return rate;
+}
+
+static void AppSelfTest_Log(uint32_t now_ms)
+{
+    uint32_t due = (uint32_t)(((uint64_t)(now_ms - s_start_ms) * SELFTEST_LOG_LINES_PER_S) / 1000U);
+
+    for (uint32_t n = 0U; (s_result.logLines < due) && (n < SELFTEST_LOG_BURST); ++n)
+    {
+        s_result.logLines++;
+        LOG_INFO("SelfTest: load line %lu, ring %lu, tx %lu",
+                 (unsigned long)s_result.logLines,
+                 (unsigned long)SampleRing_GetCount(),
+                 (unsigned long)UartTx_GetPending());
+    }
+}
+
+static void AppSelfTest_Finish(uint32_t now_ms)
+{
+    static uint32_t s_endMetrics[METRIC_COUNT];
+
+    AppSelfTestResult_t *result = &s_result;
+    SampleRingStats_t    ring;
+    AppLoadStats_t       load;
+
+    Metrics_Snapshot(s_endMetrics);
+    SampleRing_GetStats(&ring);
+    AppTaskManager_GetLoad(&load);
+
+    result->duration_ms     = now_ms - s_start_ms;
+    result->samples         = s_endMetrics[METRIC_RING_PUSHED] - s_startMetrics[METRIC_RING_PUSHED];
+    result->expected        = (uint32_t)(((uint64_t)s_rate_mHz * result->duration_ms) / 1000000U);
+    result->ringHighWater   = ring.highWater;
+    result->ringCapacity    = ring.capacity;
+    result->cpuPeakPermille = load.peakPermille;
+    result->cpuAvgPermille  = load.avgPermille;
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        const AppTaskDescriptor_t *task = AppTaskManager_GetTask(i);
+
+        /* Self-timed tasks (period 0) have no release to be late for. */
+        if ((task != NULL) && (task->period_ms != 0U) && (task->stats.runCount != 0U) &&
+            (task->stats.maxLate_us >= result->maxLate_us))
+        {
+            result->maxLate_us = task->stats.maxLate_us;
+            result->lateTask   = task->name;
+        }
+    }
+
+    result->missTask = NULL;
+    (void)AppTaskManager_CheckSchedule(&result->utilPermille, &result->missTask);
+
+#define SELFTEST_DELTA(id)   (s_endMetrics[METRIC_##id] - s_startMetrics[METRIC_##id])
+    result->ringOverruns = SELFTEST_DELTA(RING_OVERRUNS);
+    result->txDropped    = SELFTEST_DELTA(UART_DROP_CLI) + SELFTEST_DELTA(UART_DROP_TELEM) +
+                           SELFTEST_DELTA(UART_DROP_LOG);
+    result->logDropped   = SELFTEST_DELTA(LOG_DROPPED);
+    result->telemDropped = SELFTEST_DELTA(TELEM_DROPPED);
+    result->workDropped  = SELFTEST_DELTA(WORK_DROPPED);
+#undef SELFTEST_DELTA
+
+    AppSelfTest_Evaluate(result);
+
+    (void)SensorFarm_SetCount(s_saved.farmCount);
+    Telemetry_SetEnabled(s_saved.telemetry);
+    AppLoadShed_SetEnabled(s_saved.shed);
+    if (s_saved.autoPolicy)
+    {
+        PowerManager_SetAutoPolicy(true);
+    }
+    else
+    {
+        PowerManager_RequestMode(s_saved.mode);
+    }
+
+    s_end_ms  = now_ms;
+    s_phase   = SELFTEST_PHASE_DRAIN;
+    s_outcome = (uint32_t)((result->failed == 0U) ? APP_SELFTEST_PASS : APP_SELFTEST_FAIL);
+}
+
+static void AppSelfTest_Evaluate(AppSelfTestResult_t *result)
+{
+    uint32_t failed = 0U;
+
+    if (AppSelfTest_Percent(result->samples, result->expected) < SELFTEST_MIN_THROUGHPUT_PCT)
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_THROUGHPUT;
+    }
+    if (result->maxLate_us > SELFTEST_MAX_LATE_US)
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_LATENESS;
+    }
+    if (AppSelfTest_Percent(result->ringHighWater, result->ringCapacity) > SELFTEST_MAX_RING_PCT)
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_RING;
+    }
+    if (result->cpuPeakPermille > (SELFTEST_MAX_CPU_PCT * 10U))
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_CPU;
+    }
+    if (result->missTask != NULL)
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_SCHEDULE;
+    }
+    if ((result->ringOverruns + result->txDropped + result->logDropped +
+         result->telemDropped + result->workDropped) != 0U)
+    {
+        failed |= 1UL << APP_SELFTEST_CHECK_DROPPED;
+    }
+
+    result->failed = failed;
+}
+
+static void AppSelfTest_Report(void)
+{
+    const AppSelfTestResult_t *r = &s_result;
+
+#define SELFTEST_VERDICT(check)   (((r->failed & (1UL << (check))) != 0U) ? "FAIL" : "pass")
+    CLI_Print("\r\nSelf-test: %lu ms, %lu farm channels, %lu log lines, telemetry %s\r\n",
+              (unsigned long)r->duration_ms,
+              (unsigned long)r->channels,
+              (unsigned long)r->logLines,
+              Telemetry_GetFormatName(Telemetry_GetFormat()));
+    CLI_Print("  throughput %lu/%lu samples (%lu%%, >= %u%%)  %s\r\n",
+              (unsigned long)r->samples,
+              (unsigned long)r->expected,
+              (unsigned long)AppSelfTest_Percent(r->samples, r->expected),
+              (unsigned)SELFTEST_MIN_THROUGHPUT_PCT,
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_THROUGHPUT));
+    CLI_Print("  lateness   max %lu us (%s, <= %u us)  %s\r\n",
+              (unsigned long)r->maxLate_us,
+              (r->lateTask != NULL) ? r->lateTask : "-",
+              (unsigned)SELFTEST_MAX_LATE_US,
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_LATENESS));
+    CLI_Print("  ring       high-water %lu/%lu (%lu%%, <= %u%%), tx %lu/%lu bytes  %s\r\n",
+              (unsigned long)r->ringHighWater,
+              (unsigned long)r->ringCapacity,
+              (unsigned long)AppSelfTest_Percent(r->ringHighWater, r->ringCapacity),
+              (unsigned)SELFTEST_MAX_RING_PCT,
+              (unsigned long)r->txHighWater,
+              (unsigned long)UART_TX_BUFFER_SIZE,
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_RING));
+    CLI_Print("  cpu        peak %lu.%lu%%, avg %lu.%lu%% (<= %u%%)  %s\r\n",
+              (unsigned long)(r->cpuPeakPermille / 10U), (unsigned long)(r->cpuPeakPermille % 10U),
+              (unsigned long)(r->cpuAvgPermille / 10U), (unsigned long)(r->cpuAvgPermille % 10U),
+              (unsigned)SELFTEST_MAX_CPU_PCT,
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_CPU));
+    CLI_Print("  schedule   util %lu.%lu%%%s%s  %s\r\n",
+              (unsigned long)(r->utilPermille / 10U), (unsigned long)(r->utilPermille % 10U),
+              (r->missTask != NULL) ? ", misses " : "",
+              (r->missTask != NULL) ? r->missTask : "",
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_SCHEDULE));
+    CLI_Print("  dropped    ring %lu, tx %lu bytes, log %lu, telem %lu, work %lu  %s\r\n",
+              (unsigned long)r->ringOverruns,
+              (unsigned long)r->txDropped,
+              (unsigned long)r->logDropped,
+              (unsigned long)r->telemDropped,
+              (unsigned long)r->workDropped,
+              SELFTEST_VERDICT(APP_SELFTEST_CHECK_DROPPED));
+    CLI_Print("Self-test %s\r\n", (r->failed == 0U) ? "PASS" : "FAIL");
+#undef SELFTEST_VERDICT
+}
+
+static uint32_t AppSelfTest_Percent(uint32_t part, uint32_t whole)
+{
+    return (whole != 0U) ? (uint32_t)(((uint64_t)part * 100U) / whole) : 0U;
+}
+
+static void AppSelfTest_CmdSelfTest(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "stop") == 0))
+    {
+        if (s_phase != SELFTEST_PHASE_RUN)
+        {
+            CLI_PrintError("\r\nNo self-test running\r\n");
+            return;
+        }
+        AppSelfTest_Stop();
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "last") == 0))
+    {
+        if (!s_reported || (s_phase != SELFTEST_PHASE_IDLE))
+        {
+            CLI_PrintError("\r\nNo self-test reported yet\r\n");
+            return;
+        }
+        AppSelfTest_Report();
+        return;
+    }
+
+    unsigned long seconds = SELFTEST_DEFAULT_S;
+
+    if (argc == 2U)
+    {
+        char *end = NULL;
+
+        seconds = strtoul(argv[1], &end, 10);
+        if ((end == argv[1]) || (*end != '\0'))
+        {
+            seconds = 0UL;
+        }
+    }
+
+    if ((argc > 2U) || (seconds == 0UL) || (seconds > SELFTEST_MAX_S))
+    {
+        CLI_PrintError("\r\nUsage: selftest [<1..%u s> | stop | last]\r\n", (unsigned)SELFTEST_MAX_S);
+        return;
+    }
+
+    if (!AppSelfTest_Start((uint32_t)seconds))
+    {
+        CLI_PrintError("\r\nSelf-test already running\r\n");
+        return;
+    }
+
+    CLI_Print("\r\nSelf-test: %lu s at full load, report follows\r\n", seconds);
+}
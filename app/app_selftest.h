@@ -0,0 +1,160 @@
+/**
+ * @file app_selftest.h
+ * @brief Sustained-load self-test: can the hub keep up with this setup?
+ *
+ * `selftest [<seconds>]` runs the current configuration under the
+ * heaviest load it is meant to carry and checks it against the targets
+ * of app_config.h:
+ *
+ *     load       @ref SELFTEST_FARM_CHANNELS farm sensors at their
+ *                configured rates, ACTIVE mode,
+ *                @ref SELFTEST_LOG_LINES_PER_S INFO lines of its own on
+ *                top of the configured logging, and telemetry of every
+ *                sample; load shedding is off
+ *     throughput samples into the sample ring against the sum of the
+ *                ACTIVE rates of the registered sensors
+ *     lateness   largest start delay of a periodic task (task profiling)
+ *     ring       sample ring high-water mark; the console TX ring is
+ *                sampled too, and reported
+ *     CPU        busiest and average load window (AppTaskManager_GetLoad())
+ *     schedule   AppTaskManager_CheckSchedule() on the measured run times
+ *     dropped    ring overruns, console bytes, log lines, telemetry frames
+ *                and work items lost during the run (metrics.h)
+ *
+ * The task statistics and the ring high-water mark are reset at the
+ * start; the loss counters are taken from metrics snapshots at the start
+ * and the end. Afterwards the farm, telemetry, load shedding and the
+ * power policy are restored, and once the console has drained the
+ * report is printed, one line per check and `Self-test PASS` or
+ * `Self-test FAIL` last. The outcome is also the selftest_result metric.
+ *
+ * @ingroup app
+ */
+
+#ifndef APP_SELFTEST_H
+#define APP_SELFTEST_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup app_selftest Self-Test
+ * @brief Timed run at full load with pass/fail against targets.
+ * @ingroup app
+ * @{
+ */
+
+/**
+ * @brief Checks, as bits of AppSelfTestResult_t::failed.
+ */
+typedef enum
+{
+    APP_SELFTEST_CHECK_THROUGHPUT = 0U, /**< Samples below the configured rates. */
+    APP_SELFTEST_CHECK_LATENESS,        /**< A periodic task started late.       */
+    APP_SELFTEST_CHECK_RING,            /**< Sample ring filled up.              */
+    APP_SELFTEST_CHECK_CPU,             /**< CPU load too high.                  */
+    APP_SELFTEST_CHECK_SCHEDULE,        /**< Task set not schedulable.           */
+    APP_SELFTEST_CHECK_DROPPED,         /**< Something was lost.                 */
+    APP_SELFTEST_CHECK_COUNT
+} AppSelfTestCheck_t;
+
+/**
+ * @brief Value of the selftest_result metric.
+ */
+typedef enum
+{
+    APP_SELFTEST_NONE = 0U, /**< Never run.       */
+    APP_SELFTEST_RUNNING,   /**< Run in progress. */
+    APP_SELFTEST_PASS,      /**< Last run passed. */
+    APP_SELFTEST_FAIL       /**< Last run failed. */
+} AppSelfTestOutcome_t;
+
+/**
+ * @brief Measurements of the last run.
+ */
+typedef struct
+{
+    uint32_t    duration_ms;     /**< Length of the run.                          */
+    uint32_t    channels;        /**< Farm channels run.                          */
+    uint32_t    samples;         /**< Samples pushed into the sample ring.        */
+    uint32_t    expected;        /**< Samples due at the configured rates.        */
+    uint32_t    maxLate_us;      /**< Largest start delay of a periodic task.     */
+    const char *lateTask;        /**< Task with that delay, or NULL.              */
+    uint32_t    ringHighWater;   /**< Sample ring high-water mark.                */
+    uint32_t    ringCapacity;    /**< Sample ring size.                           */
+    uint32_t    txHighWater;     /**< Most console TX bytes pending (sampled).    */
+    uint32_t    cpuPeakPermille; /**< Busiest load window.                        */
+    uint32_t    cpuAvgPermille;  /**< Average of the last load windows.           */
+    uint32_t    utilPermille;    /**< Utilization from the schedule analysis.     */
+    const char *missTask;        /**< First task missing its period, or NULL.     */
+    uint32_t    logLines;        /**< Lines the run logged itself.                */
+    uint32_t    ringOverruns;    /**< Samples lost to a full sample ring.         */
+    uint32_t    txDropped;       /**< Console bytes dropped (all writers).        */
+    uint32_t    logDropped;      /**< Log lines dropped.                          */
+    uint32_t    telemDropped;    /**< Telemetry frames dropped.                   */
+    uint32_t    workDropped;     /**< Work items the queue refused.               */
+    uint32_t    failed;          /**< Bit per failed @ref AppSelfTestCheck_t.     */
+} AppSelfTestResult_t;
+
+/**
+ * @brief Publish the metric and register the `selftest` command.
+ *
+ * @return None.
+ */
+void AppSelfTest_Init(void);
+
+/**
+ * @brief Start a run.
+ *
+ * @param seconds Length, 1..@ref SELFTEST_MAX_S.
+ *
+ * @return false if a run is in progress or @p seconds is out of range.
+ */
+bool AppSelfTest_Start(uint32_t seconds);
+
+/**
+ * @brief End the run in progress now; it is reported as usual.
+ *
+ * @return None.
+ */
+void AppSelfTest_Stop(void);
+
+/**
+ * @brief Add the run's own log lines, end it when due and report it.
+ *
+ * Call periodically from task context (the sample log task); returns
+ * at once when no run is in progress.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void AppSelfTest_Service(uint32_t now_ms);
+
+/**
+ * @brief Whether a run is in progress (or waiting to be reported).
+ *
+ * @return true until the report is printed.
+ */
+bool AppSelfTest_IsRunning(void);
+
+/**
+ * @brief Get the measurements of the last reported run.
+ *
+ * @param[out] result Receives them.
+ *
+ * @return false if no run was reported yet.
+ */
+bool AppSelfTest_GetResult(AppSelfTestResult_t *result);
+
+/** @} */ /* end of app_selftest group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_SELFTEST_H */
@@ -0,0 +1,52 @@
+/**
+ * @file app_sensors.h
+ * @brief Board sensor table: the fixed sensors, their pipeline and periods.
+ *
+ * One row per sensor that is always on the board. app_main.c expands the
+ * table into the registry entries, the filter and deadband stage settings,
+ * the registration code and the acquisition dispatch. The dispatch calls
+ * each driver by name, so a reading reaches the sample ring without a
+ * SensorIF_t call or a sample callback in between. Sensors added at
+ * runtime (ADC inputs, the farm) are still read through their interface
+ * by SensorRegistry_Service().
+ *
+ * Columns of X(var, id, name, driver, style, stages, active, idle, sleep,
+ * stop):
+ * - @c var:    C name stem; the entry is `s_<var>Sensor`
+ * - @c id, @c name: registry ID and name
+ * - @c driver: function prefix; the driver provides `<driver>_GetInterface()`
+ *   and either `<driver>_Read()` (style READ) or `<driver>_ReadBatch()`
+ *   (style BATCH, drained like a FIFO)
+ * - @c stages: prefix of the pipeline defaults in app_config.h:
+ *   `<stages>_FILTER_MEDIAN_WINDOW`, `_FILTER_AVERAGE_WINDOW`,
+ *   `_FILTER_IIR_ALPHA`, `_DEADBAND` and `_MAX_SILENCE_MS`
+ * - @c active ... @c stop: period per power mode in ms, 0 = not sampled;
+ *   the stored configuration (`set period_*`) replaces them at boot
+ *
+ * @ingroup app
+ */
+
+#ifndef APP_SENSORS_H
+#define APP_SENSORS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "app_config.h"
+#include "sensor_sim_temp.h"
+
+/**
+ * @brief The board sensors: X(var, id, name, driver, style, stages,
+ *        active, idle, sleep, stop).
+ */
+#define APP_BOARD_SENSORS(X)                                                     \
+    X(simTemp, 0U, "SimTemp", SensorSimTemp, BATCH, SIMTEMP,                     \
+      SENSOR_PERIOD_ACTIVE_MS, SENSOR_PERIOD_IDLE_MS, SENSOR_PERIOD_SLEEP_MS,    \
+      SENSOR_PERIOD_STOP_MS)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_SENSORS_H */
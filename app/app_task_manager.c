@@ -1,41 +1,599 @@
 /**
  * @file app_task_manager.c
  * @brief Cooperative task manager implementation.
+ *
+ * Two interchangeable scheduler cores are provided, selected with
+ * @ref APP_SCHEDULER_BACKEND:
+ * - Linear: scans every descriptor on each pass.
+ * - Heap: keeps descriptors in a binary min-heap keyed by the next
+ *   deadline (lastRun_ms + period_ms). The root is always the next task
+ *   to become due, so an idle pass is a single comparison.
+ *
+ * All deadline comparisons use signed differences so that they remain
+ * correct across the 32-bit millisecond tick wrap (~49.7 days).
+ *
+ * Every task function call is bracketed by DWT cycle counter reads and
+ * the result is folded into the descriptor's @ref AppTaskStats_t.
+ *
+ * Posted events are a bitmask updated with interrupts masked for a few
+ * instructions. The time of the first post since the last dispatch is
+ * kept, so the reported event latency is an upper bound for every bit
+ * handled in that pass. Latencies, run times and the pass budget use the
+ * microsecond time base, which, unlike CYCCNT, keeps counting while the
+ * core sleeps and does not depend on the clock profile.
+ *
+ * The scheduler pass (RunOnce and the helpers it calls on every pass) is
+ * marked @ref RAMFUNC and runs from SRAM.
+ *
+ * Event tasks with a preemption level are run from an otherwise unused
+ * vector per level, pended by the post, at a priority below every driver
+ * interrupt and above the pass (NVIC grouping 4: all priority bits
+ * preempt). The bits of a level are kept apart from the pass's, with
+ * their own first-post time; each level interrupt takes its bits like a
+ * pass does and runs its tasks to completion on the interrupted stack,
+ * in the style of a run-to-completion kernel (SST), so no task needs a
+ * stack of its own. AppTaskManager_Lock() masks the levels with BASEPRI.
+ *
+ * With @ref APP_SCHEDULER_BACKEND_RTOS every descriptor becomes a FreeRTOS
+ * task instead. A periodic task blocks until the release time kept in its
+ * descriptor, so the release policies, the self re-arming period and the
+ * statistics work as above; the kernel provides preemption by priority
+ * and tickless idle. Event tasks block on a task notification. Posts from
+ * interrupts of any priority only set the pending bits and pend an
+ * otherwise unused vector at a kernel-safe priority, whose handler
+ * (AppTaskManager_EventIrqHandler()) notifies the event tasks.
+ *
+ * The CPU load is kept over windows of APP_LOAD_WINDOW_MS on the time
+ * base: what the window did not spend idle (in PowerManager_IdleFor(),
+ * reported with AppTaskManager_AddIdle(), or in a pass that ran nothing)
+ * is load, interrupts included. Each task's run time in the window gives
+ * its share; a task preempted by a level task is charged for it too. The
+ * RTOS backend has no idle path here, so its load is the tasks' run time,
+ * with the windows closed from the tick.
+ *
+ * The schedulability analysis is the classic response-time analysis for
+ * non-preemptive fixed priorities, with equal priorities counted as
+ * higher (the order among them is by deadline) and the measured or
+ * budgeted WCET per task. With the RTOS backend, where the kernel
+ * preempts, it is pessimistic.
+ *
+ * Every run is also bracketed by TRACE_TASK_BEGIN/END (trace.h). Periodic
+ * tasks get the lowest free slot as their trace id (it also picks the
+ * kernel objects with the RTOS backend), event tasks ids from
+ * APP_MAX_TASKS on.
+ *
+ * Disabled tasks and tasks that do not run in the current power mode
+ * (AppTaskManager_SetMode()) are only in the registration list, not in
+ * the set a pass looks at; a pass skips and drops any task that a task
+ * run earlier in the same pass took out of the set.
+ *
+ * Watchdog supervision runs at the end of every cooperative pass, when no
+ * task is running; with the RTOS backend it runs from the tick instead.
+ * The name and start tick of the run in progress (with the RTOS backend,
+ * the one started last) let the tick name a task that never returns.
+ *
  * @ingroup scheduler
  */
 
 #include "app_task_manager.h"
+#include "app_config.h"
 #include "stm32f4xx_hal.h"
 #include "log.h"
+#include "cycle_counter.h"
+#include "ramfunc.h"
+#include "time_base.h"
+#include "cli.h"
+#include "crash_log.h"
+#include "metrics.h"
+#include "trace.h"
+#include "watchdog_hw.h"
+#include <string.h>
+#include <strings.h>
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+#include "FreeRTOS.h"
+#include "task.h"
+#include "main.h"
+#endif
+
+_Static_assert(APP_MAX_TASKS <= METRICS_EVENT_TASK_ID, "task ids must leave the event task flag clear");
+_Static_assert(APP_MAX_EVENT_TASKS <= 32U, "one notification bit per event task");
+_Static_assert((APP_LOAD_WINDOW_MS > 0U) && (APP_LOAD_WINDOW_MS <= 60000U) && (APP_LOAD_WINDOWS > 0U),
+               "load windows must fit the 32-bit time base");
+
+/** @brief Length of one load window (us). */
+#define APP_LOAD_WINDOW_US    (APP_LOAD_WINDOW_MS * 1000U)
 
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
 /**
- * @brief Maximum number of tasks that can be registered.
+ * @brief Vector pended by AppTaskManager_PostEvent(); SPDIF-RX is unused
+ *        on this board (stm32f4xx_it.c routes it to the handler).
  */
-#define APP_MAX_TASKS   (8U)
+#define APP_RTOS_EVENT_IRQn   (SPDIF_RX_IRQn)
+#endif
 
 /**
- * @brief Static array of pointers to registered tasks.
+ * @brief Preemption levels in use: none with the RTOS backend, whose
+ *        kernel preempts instead.
+ */
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+#define APP_LEVELS            (0U)
+#else
+#define APP_LEVELS            (APP_PREEMPT_LEVELS)
+#endif
+
+_Static_assert(APP_PREEMPT_LEVELS <= 2U, "one spare vector per preemption level");
+
+#if (APP_LEVELS > 0U)
+_Static_assert((APP_PREEMPT_PRIORITY < (1U << __NVIC_PRIO_BITS)) &&
+               (APP_PREEMPT_PRIORITY >= APP_LEVELS),
+               "every level needs a priority below the drivers' 0");
+
+/**
+ * @brief BASEPRI that masks every level (the priority of the highest).
+ */
+#define APP_LEVEL_BASEPRI     ((APP_PREEMPT_PRIORITY - (APP_LEVELS - 1U)) << (8U - __NVIC_PRIO_BITS))
+
+/**
+ * @brief Vector of each level; FMPI2C1 is unused on this board
+ *        (stm32f4xx_it.c routes both of its vectors to the handler).
+ */
+static const IRQn_Type s_levelIrqs[2] = { FMPI2C1_EV_IRQn, FMPI2C1_ER_IRQn };
+
+/** @brief Event bits owned by the tasks of each level. */
+static uint32_t s_levelEvents[APP_LEVELS];
+
+/** @brief Every level's bits: the ones a pass does not take. */
+static uint32_t s_preemptEvents = 0U;
+
+/** @brief Posted bits of each level not yet taken by its interrupt. */
+static volatile uint32_t s_levelPending[APP_LEVELS];
+
+/** @brief Time base at the first post of each level since it last ran. */
+static volatile uint32_t s_levelPost_us[APP_LEVELS];
+#endif
+
+/**
+ * @brief The active tasks (enabled and in the current mode): what a
+ *        scheduler pass looks at.
  *
  * Each entry points to an @ref AppTaskDescriptor_t instance that
  * is managed by the application. Unused slots are set to NULL.
+ * With the heap backend the array is kept in heap order. Not used by the
+ * RTOS backend, where the kernel holds the tasks.
  */
 static AppTaskDescriptor_t *s_tasks[APP_MAX_TASKS] = {0};
 
 /**
- * @brief Number of tasks currently registered.
+ * @brief Number of entries in @ref s_tasks.
  */
 static uint32_t s_taskCount = 0U;
 
+/**
+ * @brief Registered tasks in registration order, for reporting.
+ *
+ * Unlike @ref s_tasks this includes disabled tasks and the tasks popped
+ * for the pass in progress, so a task reporting on all tasks also sees
+ * itself.
+ */
+static AppTaskDescriptor_t *s_registered[APP_MAX_TASKS] = {0};
+
+/**
+ * @brief Number of entries in @ref s_registered.
+ */
+static uint32_t s_registeredCount = 0U;
+
+/**
+ * @brief Registered event tasks, in registration order.
+ */
+static AppEventTask_t *s_eventTasks[APP_MAX_EVENT_TASKS] = {0};
+
+/**
+ * @brief Number of event tasks currently registered.
+ */
+static uint32_t s_eventTaskCount = 0U;
+
+/**
+ * @brief Mode index set by AppTaskManager_SetMode().
+ */
+static uint32_t s_mode = 0U;
+
+/**
+ * @brief Event bits posted since the last dispatch.
+ */
+static volatile uint32_t s_pendingEvents = 0U;
+
+/**
+ * @brief Time (us) of the first post since the last dispatch.
+ */
+static volatile uint32_t s_firstPost_us = 0U;
+
+/**
+ * @brief Watchdog supervision state (AppTaskManager_StartWatchdog()).
+ */
+static bool     s_wdgRunning    = false;
+static uint32_t s_wdgTimeout_ms = 0U;
+static uint32_t s_wdgRefresh_ms = 0U;   /**< Tick of the last refresh.            */
+static uint32_t s_wdgWithheld   = 0U;   /**< Passes that withheld the refresh.    */
+
+/**
+ * @brief A watchdog offender is recorded in the crash trace.
+ */
+static volatile bool s_wdgRecorded = false;
+
+/**
+ * @brief Name of the task or event task running now (NULL: none).
+ */
+static const char *volatile s_running = NULL;
+
+/**
+ * @brief Tick at which @ref s_running started.
+ */
+static volatile uint32_t s_runStart_ms = 0U;
+
+/**
+ * @brief Start of the current load window (time base, us).
+ */
+static uint32_t s_loadStart_us = 0U;
+
+/**
+ * @brief Idle time in the current load window (us).
+ */
+static uint32_t s_loadIdle_us = 0U;
+
+/**
+ * @brief Load of the last windows (permille), by window number.
+ */
+static uint16_t s_loadHistory[APP_LOAD_WINDOWS];
+
+/**
+ * @brief Load figures; published as metrics.
+ */
+static AppLoadStats_t s_load = {0};
+
+/**
+ * @brief A task ran in the current pass.
+ */
+static volatile bool s_passRan = false;
+
+/**
+ * @brief The last schedulability check passed (warn once per failure).
+ */
+static bool s_schedOk = true;
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+/**
+ * @brief Kernel objects of the periodic tasks, by registration slot.
+ */
+static StaticTask_t s_taskTcbs[APP_MAX_TASKS];
+static StackType_t  s_taskStacks[APP_MAX_TASKS][APP_RTOS_STACK_WORDS];
+static TaskHandle_t s_taskHandles[APP_MAX_TASKS];   /**< NULL = slot free. */
+
+/**
+ * @brief Kernel objects of the event tasks, by registration slot.
+ */
+static StaticTask_t s_eventTcbs[APP_MAX_EVENT_TASKS];
+static StackType_t  s_eventStacks[APP_MAX_EVENT_TASKS][APP_RTOS_STACK_WORDS];
+static TaskHandle_t s_eventHandles[APP_MAX_EVENT_TASKS];
+
+/**
+ * @brief Time (us) of the first post each event task has not yet seen.
+ */
+static volatile uint32_t s_eventPost_us[APP_MAX_EVENT_TASKS];
+
+/**
+ * @brief Event tasks with a notification outstanding (bit per slot).
+ */
+static volatile uint32_t s_eventNotified = 0U;
+#endif
+
+/**
+ * @brief Absolute tick at which a task becomes due.
+ *
+ * @param task Task descriptor.
+ * @return Deadline in HAL ticks (may wrap).
+ */
+static inline uint32_t AppTaskManager_Deadline(const AppTaskDescriptor_t *task)
+{
+    return task->lastRun_ms + task->period_ms;
+}
+
+/**
+ * @brief Wrap-safe "a is earlier than b" for tick values.
+ */
+static inline bool AppTaskManager_IsBefore(uint32_t a, uint32_t b)
+{
+    return ((int32_t)(a - b) < 0);
+}
+
+/**
+ * @brief Whether @p task runs in @p mode.
+ */
+static inline bool AppTaskManager_InMode(const AppTaskDescriptor_t *task, uint32_t mode)
+{
+    return (task->modes == 0U) || ((task->modes & APP_TASK_MODE(mode)) != 0U);
+}
+
+/**
+ * @brief Run one task and update its bookkeeping.
+ *
+ * @param task   Task to run.
+ * @param now_ms Current tick.
+ */
+static void AppTaskManager_Execute(AppTaskDescriptor_t *task, uint32_t now_ms);
+
+/**
+ * @brief Set the release time of the run that follows, per task policy.
+ *
+ * @param task       Task about to run.
+ * @param release_ms Release time of this run.
+ * @param now_ms     Tick the pass started at.
+ */
+static void AppTaskManager_Rearm(AppTaskDescriptor_t *task, uint32_t release_ms, uint32_t now_ms);
+
+/**
+ * @brief Microseconds elapsed since the tick @p release_ms began.
+ *
+ * Uses the SysTick count within the current tick for sub-ms resolution.
+ */
+static uint32_t AppTaskManager_LatenessUs(uint32_t release_ms);
+
+/**
+ * @brief Fold one start delay into the lateness statistics.
+ *
+ * Must be called before the run is added to stats->runCount.
+ */
+static void AppTaskManager_RecordLateness(AppTaskStats_t *stats, uint32_t late_us);
+
+/**
+ * @brief Run one event task for the bits it matched.
+ *
+ * @param task    Event task.
+ * @param matched Posted bits the task subscribed to.
+ * @param post_us Time of the first post among them.
+ */
+static void AppTaskManager_RunEvent(AppEventTask_t *task, uint32_t matched, uint32_t post_us);
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+/**
+ * @brief Run the due tasks of one pass in priority order.
+ *
+ * Applies the pass budget; with the heap backend every task is pushed
+ * back afterwards.
+ *
+ * @param due    Tasks that are due; reordered in place.
+ * @param count  Number of entries in @p due.
+ * @param now_ms Tick the pass started at.
+ */
+static RAMFUNC void AppTaskManager_RunDue(AppTaskDescriptor_t *due[], uint32_t count, uint32_t now_ms);
+
+/**
+ * @brief Whether @p a should run before @p b in the same pass.
+ */
+static bool AppTaskManager_RunsBefore(const AppTaskDescriptor_t *a, const AppTaskDescriptor_t *b);
+
+/**
+ * @brief Run the event tasks whose events are pending.
+ */
+static RAMFUNC void AppTaskManager_DispatchEvents(void);
+#else
+/**
+ * @brief Body of the FreeRTOS task of a periodic descriptor.
+ *
+ * @param arg The @ref AppTaskDescriptor_t.
+ */
+static void AppTaskManager_TaskEntry(void *arg);
+
+/**
+ * @brief Body of the FreeRTOS task of an event task.
+ *
+ * @param arg Registration slot of the event task.
+ */
+static void AppTaskManager_EventTaskEntry(void *arg);
+#endif
+
+/**
+ * @brief Refresh the watchdog if every supervised task is on time, else
+ *        record the latest one.
+ *
+ * @param now_ms Current tick.
+ */
+static RAMFUNC void AppTaskManager_Supervise(uint32_t now_ms);
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+/**
+ * @brief Limit an idle budget to the time until the next refresh is due.
+ */
+static uint32_t AppTaskManager_WatchdogBound(uint32_t wait_ms);
+#endif
+
+/**
+ * @brief Fold one run of @p cycles (@p us microseconds) into @p stats.
+ */
+static void AppTaskManager_UpdateStats(AppTaskStats_t *stats, uint32_t cycles, uint32_t us);
+
+/**
+ * @brief Close the load windows that ended by @p now_us, with @p idle_us
+ *        of idle time that ended at @p now_us.
+ */
+static RAMFUNC void AppTaskManager_AdvanceLoad(uint32_t now_us, uint32_t idle_us);
+
+/**
+ * @brief Record the load and task shares of the window that just ended.
+ */
+static void AppTaskManager_CloseWindow(void);
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+/**
+ * @brief Move the entry at @p index up until the heap property holds.
+ */
+static void AppTaskManager_SiftUp(uint32_t index);
+
+/**
+ * @brief Move the entry at @p index down until the heap property holds.
+ */
+static RAMFUNC void AppTaskManager_SiftDown(uint32_t index);
+
+/**
+ * @brief Insert a task into the heap.
+ */
+static void AppTaskManager_HeapPush(AppTaskDescriptor_t *task);
+
+/**
+ * @brief Remove and return the task with the earliest deadline.
+ *
+ * The heap must not be empty.
+ */
+static RAMFUNC AppTaskDescriptor_t *AppTaskManager_HeapPop(void);
+
+/**
+ * @brief Restore the heap property after the deadline of the entry at
+ *        @p index changed either way.
+ */
+static void AppTaskManager_HeapFix(uint32_t index);
+#endif
+
+/**
+ * @brief Re-key a registered task after its release time changed.
+ */
+static void AppTaskManager_Requeue(AppTaskDescriptor_t *task);
+
+/**
+ * @brief Put a registered task into or take it out of the set a pass
+ *        looks at; a task that goes in is re-armed one period from now.
+ */
+static void AppTaskManager_SetActive(AppTaskDescriptor_t *task, bool active);
+
+/**
+ * @brief Position of @p task in @ref s_registered, or s_registeredCount.
+ */
+static uint32_t AppTaskManager_IndexOf(const AppTaskDescriptor_t *task);
+
+/**
+ * @brief Lowest trace id (and slot) no registered task uses.
+ */
+static uint8_t AppTaskManager_FreeId(void);
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+/**
+ * @brief Take an active task out of @ref s_tasks.
+ */
+static void AppTaskManager_Dequeue(const AppTaskDescriptor_t *task);
+#endif
+
+/**
+ * @brief CLI "tasks [reset | jitter | sched | hist <name> | on <name> | off <name>]" handler.
+ */
+static void AppTaskManager_CmdTasks(uint32_t argc, char *argv[]);
+
+/**
+ * @brief Print the lateness summary of every periodic task.
+ */
+static void AppTaskManager_PrintJitter(void);
+
+/**
+ * @brief Print the lateness histogram of the task called @p name.
+ */
+static void AppTaskManager_PrintHistogram(const char *name);
+
+/**
+ * @brief Registered task called @p name (any case), or NULL.
+ */
+static AppTaskDescriptor_t *AppTaskManager_FindByName(const char *name);
+
+/**
+ * @brief WCET of a task for the analysis (us): the longer of its longest
+ *        measured run and its budget, 0 if neither is known.
+ */
+static uint32_t AppTaskManager_Wcet(const AppTaskDescriptor_t *task);
+
+/**
+ * @brief Worst-case response time of @p set[@p index] (us), or
+ *        APP_TASK_NO_DEADLINE if it exceeds the task's period.
+ *
+ * @param once_us Run time that can hold the task off once (event and
+ *                self-timed tasks).
+ */
+static uint32_t AppTaskManager_ResponseUs(const AppTaskDescriptor_t *const set[], uint32_t count,
+                                          uint32_t index, uint32_t once_us);
+
+/**
+ * @brief Analyse the tasks of the current mode, plus @p extra if not NULL
+ *        (a task about to be registered); print the table if @p print.
+ *
+ * @return Whether the set is schedulable (see AppTaskManager_CheckSchedule()).
+ */
+static bool AppTaskManager_Analyse(const AppTaskDescriptor_t *extra, bool print,
+                                   uint32_t *util_permille, const char **miss);
+
+/* ------------------------------------------------------------------------- */
+
 void AppTaskManager_Init(void)
 {
     /* Clear all task entries. */
     for (uint32_t i = 0U; i < APP_MAX_TASKS; ++i)
     {
-        s_tasks[i] = NULL;
+        s_tasks[i]      = NULL;
+        s_registered[i] = NULL;
+    }
+    s_taskCount       = 0U;
+    s_registeredCount = 0U;
+
+    for (uint32_t i = 0U; i < APP_MAX_EVENT_TASKS; ++i)
+    {
+        s_eventTasks[i] = NULL;
+    }
+    s_eventTaskCount = 0U;
+    s_pendingEvents  = 0U;
+    s_mode           = 0U;
+
+    CycleCounter_Init();
+
+    s_loadStart_us = Time_NowUs32();
+    s_loadIdle_us  = 0U;
+    s_load         = (AppLoadStats_t){0};
+    Metrics_Publish(METRIC_CPU_LOAD, &s_load.lastPermille);
+    Metrics_Publish(METRIC_CPU_LOAD_AVG, &s_load.avgPermille);
+    Metrics_Publish(METRIC_CPU_LOAD_PEAK, &s_load.peakPermille);
+
+#if (APP_LEVELS > 0U)
+    /* The levels need preemption bits. Every driver interrupt is above
+     * them in the priority plan (irq_plan.h), so they are not affected.
+     */
+    HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+
+    s_preemptEvents = 0U;
+    for (uint32_t l = 0U; l < APP_LEVELS; ++l)
+    {
+        s_levelEvents[l]  = 0U;
+        s_levelPending[l] = 0U;
+        HAL_NVIC_SetPriority(s_levelIrqs[l], APP_PREEMPT_PRIORITY - l, 0U);
+        HAL_NVIC_EnableIRQ(s_levelIrqs[l]);
     }
-    s_taskCount = 0U;
+#endif
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    /* The kernel needs every priority bit preemptive and SysTick at the
+     * lowest priority; HAL_InitTick() keeps that across clock changes.
+     */
+    HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+    (void)HAL_InitTick(configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+
+    s_eventNotified = 0U;
+    HAL_NVIC_SetPriority(APP_RTOS_EVENT_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY, 0U);
+    HAL_NVIC_EnableIRQ(APP_RTOS_EVENT_IRQn);
+#endif
+
+    (void)CLI_RegisterCommand("tasks", AppTaskManager_CmdTasks,
+                              "[reset] - Show / clear per-task timing statistics\n"
+                              "jitter | hist <name> - Release lateness per task\n"
+                              "sched - Worst-case response times\n"
+                              "on | off <name> - Resume / pause a task");
 
-    LOG_INFO("Task Manager initialized (max tasks = %lu)", (unsigned long)APP_MAX_TASKS);
+    LOG_INFO("Task Manager initialized (max tasks = %lu, backend = %s)",
+             (unsigned long)APP_MAX_TASKS,
+             (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP) ? "heap" :
+             (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS) ? "rtos" : "linear");
 }
 
 int AppTaskManager_RegisterTask(AppTaskDescriptor_t *task)
@@ -46,15 +604,56 @@ int AppTaskManager_RegisterTask(AppTaskDescriptor_t *task)
         return -1;
     }
 
-    if (s_taskCount >= APP_MAX_TASKS)
+    if (s_registeredCount >= APP_MAX_TASKS)
     {
         LOG_WARN("Task list is full, cannot register task '%s'", task->name);
         return -2;
     }
 
+    if (AppTaskManager_IndexOf(task) < s_registeredCount)
+    {
+        LOG_WARN("Task '%s' is already registered", task->name);
+        return -3;
+    }
+
     task->lastRun_ms = HAL_GetTick();
-    s_tasks[s_taskCount] = task;
-    s_taskCount++;
+    task->traceId    = AppTaskManager_FreeId();
+    task->enabled    = true;
+    task->active     = false;
+    if (task->modePeriod_ms != NULL)
+    {
+        task->period_ms = task->modePeriod_ms[s_mode];
+    }
+
+#if (APP_SCHED_CHECK != 0)
+    uint32_t    util = 0U;
+    const char *miss = NULL;
+
+    if (!AppTaskManager_Analyse(task, false, &util, &miss))
+    {
+        LOG_WARN("Task '%s': set not schedulable (utilization %lu permille, '%s' late)",
+                 task->name, (unsigned long)util, (miss != NULL) ? miss : "-");
+        if (APP_SCHED_CHECK == 2)
+        {
+            return -4;
+        }
+    }
+#endif
+
+    s_registered[s_registeredCount++] = task;
+    (void)memset(&task->stats, 0, sizeof(task->stats));
+    TRACE_NAME(TRACE_NAME_TASK, task->traceId, task->name);
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    /* LOW/NORMAL/HIGH map onto three consecutive kernel priorities. The
+     * task parks at once if it does not run in the current mode.
+     */
+    s_taskHandles[task->traceId] =
+        xTaskCreateStatic(AppTaskManager_TaskEntry, task->name, APP_RTOS_STACK_WORDS, task,
+                          APP_RTOS_PRIORITY_BASE + (UBaseType_t)task->priority,
+                          s_taskStacks[task->traceId], &s_taskTcbs[task->traceId]);
+#endif
+    AppTaskManager_SetActive(task, AppTaskManager_InMode(task, s_mode));
 
     LOG_INFO("Registered task '%s' with period %lu ms",
              task->name,
@@ -63,27 +662,1678 @@ int AppTaskManager_RegisterTask(AppTaskDescriptor_t *task)
     return 0;
 }
 
-void AppTaskManager_RunOnce(void)
+int AppTaskManager_UnregisterTask(AppTaskDescriptor_t *task)
 {
-    uint32_t now_ms = HAL_GetTick();
+    uint32_t index = AppTaskManager_IndexOf(task);
 
-    for (uint32_t i = 0U; i < s_taskCount; ++i)
+    if (index >= s_registeredCount)
     {
-        AppTaskDescriptor_t *task = s_tasks[i];
-        if (task == NULL)
-        {
-            continue;
-        }
-
-        uint32_t elapsed = now_ms - task->lastRun_ms;
-        if (elapsed >= task->period_ms)
+        return -1;
+    }
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    TaskHandle_t handle = s_taskHandles[task->traceId];
+    if (task->active || (handle == xTaskGetCurrentTaskHandle()))
+    {
+        return -2;
+    }
+
+    /* Not the caller, so the static TCB and stack are free on return. */
+    vTaskDelete(handle);
+    s_taskHandles[task->traceId] = NULL;
+#else
+    if (task->active)
+    {
+        AppTaskManager_Dequeue(task);
+    }
+#endif
+
+    task->enabled = false;
+    task->active  = false;
+    for (uint32_t i = index + 1U; i < s_registeredCount; ++i)
+    {
+        s_registered[i - 1U] = s_registered[i];
+    }
+    s_registeredCount--;
+    s_registered[s_registeredCount] = NULL;
+
+    LOG_INFO("Unregistered task '%s'", task->name);
+    return 0;
+}
+
+void AppTaskManager_SetEnabled(AppTaskDescriptor_t *task, bool enabled)
+{
+    if (AppTaskManager_IndexOf(task) >= s_registeredCount)
+    {
+        return;
+    }
+
+    task->enabled = enabled;
+    AppTaskManager_SetActive(task, enabled && AppTaskManager_InMode(task, s_mode));
+}
+
+void AppTaskManager_SetMode(uint32_t mode)
+{
+    if ((mode >= APP_TASK_MAX_MODES) || (mode == s_mode))
+    {
+        return;
+    }
+
+    s_mode = mode;
+
+    /* One pass over the slots with no scheduler pass in between: the next
+     * pass sees the whole set of the new mode.
+     */
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        AppTaskDescriptor_t *task   = s_registered[i];
+        bool                 active = task->enabled && AppTaskManager_InMode(task, mode);
+
+        if ((task->modePeriod_ms != NULL) && (task->modePeriod_ms[mode] != task->period_ms))
+        {
+            /* As AppTaskManager_SetPeriod(): counted from the last release. */
+            task->period_ms = task->modePeriod_ms[mode];
+            if (active && task->active)
+            {
+                AppTaskManager_Requeue(task);
+            }
+        }
+
+        AppTaskManager_SetActive(task, active);
+    }
+}
+
+int AppTaskManager_RegisterEventTask(AppEventTask_t *task)
+{
+    if ((task == NULL) || (task->handler == NULL))
+    {
+        LOG_ERROR("Attempted to register an invalid event task");
+        return -1;
+    }
+
+    if (s_eventTaskCount >= APP_MAX_EVENT_TASKS)
+    {
+        LOG_WARN("Event task list is full, cannot register task '%s'", task->name);
+        return -2;
+    }
+
+    if (task->level > APP_PREEMPT_LEVELS)
+    {
+        LOG_ERROR("Event task '%s': no preemption level %u", task->name, (unsigned)task->level);
+        return -3;
+    }
+
+#if (APP_LEVELS > 0U)
+    uint32_t owned = 0U;   /* bits of the tasks of other levels */
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        if (s_eventTasks[i]->level != task->level)
+        {
+            owned |= s_eventTasks[i]->events;
+        }
+    }
+
+    if ((owned & task->events) != 0U)
+    {
+        LOG_ERROR("Event task '%s': events 0x%08lX belong to another level",
+                  task->name, (unsigned long)(owned & task->events));
+        return -3;
+    }
+
+    if (task->level > 0U)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        s_levelEvents[task->level - 1U] |= task->events;
+        s_preemptEvents                 |= task->events;
+        __set_PRIMASK(primask);
+    }
+#endif
+
+    task->maxLatency_us = 0U;
+    task->traceId       = (uint8_t)(APP_MAX_TASKS + s_eventTaskCount);
+    (void)memset(&task->stats, 0, sizeof(task->stats));
+    TRACE_NAME(TRACE_NAME_TASK, task->traceId, task->name);
+
+    s_eventTasks[s_eventTaskCount] = task;
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    s_eventHandles[s_eventTaskCount] =
+        xTaskCreateStatic(AppTaskManager_EventTaskEntry, task->name, APP_RTOS_STACK_WORDS,
+                          (void *)(uintptr_t)s_eventTaskCount,
+                          APP_RTOS_PRIORITY_BASE + (UBaseType_t)APP_TASK_PRIORITY_HIGH + 1U,
+                          s_eventStacks[s_eventTaskCount], &s_eventTcbs[s_eventTaskCount]);
+#endif
+    s_eventTaskCount++;
+
+    LOG_INFO("Registered event task '%s' (events 0x%08lX, level %u)",
+             task->name,
+             (unsigned long)task->events,
+             (unsigned)task->level);
+
+    return 0;
+}
+
+void AppTaskManager_PostEvent(uint32_t events)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+#if (APP_LEVELS > 0U)
+    uint32_t pend = 0U;   /* levels to pend */
+    for (uint32_t l = 0U; l < APP_LEVELS; ++l)
+    {
+        uint32_t bits = events & s_levelEvents[l];
+        if (bits != 0U)
+        {
+            if (s_levelPending[l] == 0U)
+            {
+                s_levelPost_us[l] = Time_NowUs32();
+            }
+            s_levelPending[l] |= bits;
+            pend              |= (1UL << l);
+        }
+    }
+    events &= ~s_preemptEvents;
+#endif
+
+    if (events != 0U)
+    {
+        if (s_pendingEvents == 0U)
+        {
+            s_firstPost_us = Time_NowUs32();
+        }
+        s_pendingEvents |= events;
+    }
+
+    __set_PRIMASK(primask);
+
+#if (APP_LEVELS > 0U)
+    for (uint32_t l = 0U; l < APP_LEVELS; ++l)
+    {
+        if ((pend & (1UL << l)) != 0U)
+        {
+            HAL_NVIC_SetPendingIRQ(s_levelIrqs[l]);
+        }
+    }
+#endif
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    /* The caller may run above the kernel's syscall priority. */
+    HAL_NVIC_SetPendingIRQ(APP_RTOS_EVENT_IRQn);
+#endif
+}
+
+bool AppTaskManager_HasPendingEvents(void)
+{
+    return (s_pendingEvents != 0U);
+}
+
+void AppTaskManager_LevelIrqHandler(uint32_t level)
+{
+#if (APP_LEVELS > 0U)
+    if ((level == 0U) || (level > APP_LEVELS))
+    {
+        return;
+    }
+
+    __disable_irq();
+    uint32_t events  = s_levelPending[level - 1U];
+    uint32_t post_us = s_levelPost_us[level - 1U];
+    s_levelPending[level - 1U] = 0U;
+    __enable_irq();
+
+    /* The preempted run goes on when this returns: keep its name and
+     * start for the stall check and the crash log.
+     */
+    const char *preempted = s_running;
+    uint32_t    start_ms  = s_runStart_ms;
+
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        AppEventTask_t *task    = s_eventTasks[i];
+        uint32_t        matched = events & task->events;
+        if ((task->level == level) && (matched != 0U))
+        {
+            AppTaskManager_RunEvent(task, matched, post_us);
+        }
+    }
+
+    s_runStart_ms = start_ms;
+    s_running     = preempted;
+    if (preempted != NULL)
+    {
+        CrashLog_RecordTask(preempted);
+    }
+#else
+    (void)level;
+#endif
+}
+
+uint32_t AppTaskManager_Lock(void)
+{
+#if (APP_LEVELS > 0U)
+    uint32_t key = __get_BASEPRI();
+    __set_BASEPRI_MAX(APP_LEVEL_BASEPRI);
+    return key;
+#elif (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)
+    {
+        return 0U;
+    }
+    vTaskSuspendAll();
+    return 1U;
+#else
+    return 0U;
+#endif
+}
+
+void AppTaskManager_Unlock(uint32_t key)
+{
+#if (APP_LEVELS > 0U)
+    __set_BASEPRI(key);
+#elif (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    if (key != 0U)
+    {
+        (void)xTaskResumeAll();
+    }
+#else
+    (void)key;
+#endif
+}
+
+void AppTaskManager_Reschedule(AppTaskDescriptor_t *task, uint32_t release_ms)
+{
+    if (task == NULL)
+    {
+        return;
+    }
+
+    task->lastRun_ms = release_ms - task->period_ms;
+    AppTaskManager_Requeue(task);
+}
+
+void AppTaskManager_SetPeriod(AppTaskDescriptor_t *task, uint32_t period_ms)
+{
+    if ((task == NULL) || (task->period_ms == period_ms))
+    {
+        return;
+    }
+
+    task->period_ms = period_ms;
+    AppTaskManager_Requeue(task);
+}
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+
+RAMFUNC void AppTaskManager_RunOnce(void)
+{
+    uint32_t pass_us = Time_NowUs32();
+
+    AppTaskManager_AdvanceLoad(pass_us, 0U);
+    s_passRan = false;
+
+    AppTaskManager_DispatchEvents();
+
+    uint32_t now_ms = HAL_GetTick();
+
+    /* Pop every task that is due, earliest deadline first. Popping them
+     * all before running any guarantees each task runs at most once per
+     * pass, even one with a zero period.
+     */
+    AppTaskDescriptor_t *due[APP_MAX_TASKS];
+    uint32_t dueCount = 0U;
+
+    while ((s_taskCount > 0U) &&
+           !AppTaskManager_IsBefore(now_ms, AppTaskManager_Deadline(s_tasks[0])))
+    {
+        due[dueCount++] = AppTaskManager_HeapPop();
+    }
+
+    AppTaskManager_RunDue(due, dueCount, now_ms);
+    AppTaskManager_Supervise(HAL_GetTick());
+
+    if (!s_passRan)
+    {
+        /* A pass that found nothing to do is polling: idle. */
+        uint32_t end_us = Time_NowUs32();
+        AppTaskManager_AdvanceLoad(end_us, end_us - pass_us);
+    }
+}
+
+uint32_t AppTaskManager_GetTimeUntilNextDeadline(void)
+{
+    if (s_pendingEvents != 0U)
+    {
+        return 0U;
+    }
+
+    if (s_taskCount == 0U)
+    {
+        return APP_TASK_NO_DEADLINE;
+    }
+
+    uint32_t now_ms   = HAL_GetTick();
+    uint32_t deadline = AppTaskManager_Deadline(s_tasks[0]);
+
+    return AppTaskManager_WatchdogBound(AppTaskManager_IsBefore(now_ms, deadline) ?
+                                        (deadline - now_ms) : 0U);
+}
+
+#elif (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+
+void AppTaskManager_RunOnce(void)
+{
+    /* First call from the main loop: the kernel takes over for good. */
+    vTaskStartScheduler();
+
+    /* Only reached if the idle task could not be created. */
+    Error_Handler();
+}
+
+uint32_t AppTaskManager_GetTimeUntilNextDeadline(void)
+{
+    /* Idle time is the kernel's business (configUSE_TICKLESS_IDLE). */
+    return APP_TASK_NO_DEADLINE;
+}
+
+void AppTaskManager_EventIrqHandler(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    __disable_irq();
+    uint32_t events  = s_pendingEvents;
+    uint32_t post_us = s_firstPost_us;
+    s_pendingEvents = 0U;
+    __enable_irq();
+
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        uint32_t matched = events & s_eventTasks[i]->events;
+        if (matched == 0U)
+        {
+            continue;
+        }
+
+        /* Keep the oldest post the task has not picked up yet. */
+        if ((s_eventNotified & (1UL << i)) == 0U)
+        {
+            s_eventPost_us[i] = post_us;
+            s_eventNotified  |= (1UL << i);
+        }
+
+        (void)xTaskNotifyFromISR(s_eventHandles[i], matched, eSetBits, &woken);
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * @brief Static memory of the kernel's idle task (configSUPPORT_STATIC_ALLOCATION).
+ */
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack, uint32_t *words)
+{
+    static StaticTask_t s_idleTcb;
+    static StackType_t  s_idleStack[configMINIMAL_STACK_SIZE];
+
+    *tcb   = &s_idleTcb;
+    *stack = s_idleStack;
+    *words = configMINIMAL_STACK_SIZE;
+}
+
+#else /* APP_SCHEDULER_BACKEND_LINEAR */
+
+RAMFUNC void AppTaskManager_RunOnce(void)
+{
+    uint32_t pass_us = Time_NowUs32();
+
+    AppTaskManager_AdvanceLoad(pass_us, 0U);
+    s_passRan = false;
+
+    AppTaskManager_DispatchEvents();
+
+    uint32_t now_ms = HAL_GetTick();
+
+    AppTaskDescriptor_t *due[APP_MAX_TASKS];
+    uint32_t dueCount = 0U;
+
+    for (uint32_t i = 0U; i < s_taskCount; ++i)
+    {
+        AppTaskDescriptor_t *task = s_tasks[i];
+        if (task == NULL)
+        {
+            continue;
+        }
+
+        if (!AppTaskManager_IsBefore(now_ms, AppTaskManager_Deadline(task)))
+        {
+            due[dueCount++] = task;
+        }
+    }
+
+    AppTaskManager_RunDue(due, dueCount, now_ms);
+    AppTaskManager_Supervise(HAL_GetTick());
+
+    if (!s_passRan)
+    {
+        /* A pass that found nothing to do is polling: idle. */
+        uint32_t end_us = Time_NowUs32();
+        AppTaskManager_AdvanceLoad(end_us, end_us - pass_us);
+    }
+}
+
+uint32_t AppTaskManager_GetTimeUntilNextDeadline(void)
+{
+    if (s_pendingEvents != 0U)
+    {
+        return 0U;
+    }
+
+    uint32_t now_ms  = HAL_GetTick();
+    uint32_t minWait = APP_TASK_NO_DEADLINE;
+
+    for (uint32_t i = 0U; i < s_taskCount; ++i)
+    {
+        uint32_t deadline = AppTaskManager_Deadline(s_tasks[i]);
+        uint32_t wait = AppTaskManager_IsBefore(now_ms, deadline) ? (deadline - now_ms) : 0U;
+        if (wait < minWait)
+        {
+            minWait = wait;
+        }
+    }
+
+    return AppTaskManager_WatchdogBound(minWait);
+}
+
+#endif /* APP_SCHEDULER_BACKEND */
+
+uint32_t AppTaskManager_GetTaskCount(void)
+{
+    return s_registeredCount;
+}
+
+const AppTaskDescriptor_t *AppTaskManager_GetTask(uint32_t index)
+{
+    if (index >= s_registeredCount)
+    {
+        return NULL;
+    }
+
+    return s_registered[index];
+}
+
+uint32_t AppTaskManager_GetEventTaskCount(void)
+{
+    return s_eventTaskCount;
+}
+
+const AppEventTask_t *AppTaskManager_GetEventTask(uint32_t index)
+{
+    if (index >= s_eventTaskCount)
+    {
+        return NULL;
+    }
+
+    return s_eventTasks[index];
+}
+
+uint32_t AppTaskManager_GetLatenessPercentile(const AppTaskStats_t *stats, uint32_t permille)
+{
+    uint32_t total = 0U;
+    for (uint32_t i = 0U; i < APP_TASK_LATENESS_BUCKETS; ++i)
+    {
+        total += stats->lateHist[i];
+    }
+
+    if (total == 0U)
+    {
+        return 0U;
+    }
+
+    /* Smallest bucket whose cumulative count reaches the rank. */
+    uint64_t rank = (((uint64_t)total * permille) + 999U) / 1000U;
+    uint32_t seen = 0U;
+
+    for (uint32_t i = 0U; i < (APP_TASK_LATENESS_BUCKETS - 1U); ++i)
+    {
+        seen += stats->lateHist[i];
+        if (seen >= rank)
+        {
+            uint32_t edge = 1UL << (i + 6U);
+            return (edge < stats->maxLate_us) ? edge : stats->maxLate_us;
+        }
+    }
+
+    return stats->maxLate_us;
+}
+
+void AppTaskManager_ResetStats(void)
+{
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        (void)memset(&s_registered[i]->stats, 0, sizeof(s_registered[i]->stats));
+    }
+
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        s_eventTasks[i]->maxLatency_us = 0U;
+        (void)memset(&s_eventTasks[i]->stats, 0, sizeof(s_eventTasks[i]->stats));
+    }
+
+    s_load.peakPermille = s_load.lastPermille;
+}
+
+void AppTaskManager_AddIdle(uint32_t idle_us)
+{
+    AppTaskManager_AdvanceLoad(Time_NowUs32(), idle_us);
+}
+
+void AppTaskManager_GetLoad(AppLoadStats_t *load)
+{
+    if (load != NULL)
+    {
+        *load = s_load;
+    }
+}
+
+bool AppTaskManager_CheckSchedule(uint32_t *util_permille, const char **miss)
+{
+    return AppTaskManager_Analyse(NULL, false, util_permille, miss);
+}
+
+uint32_t AppTaskManager_StartWatchdog(uint32_t timeout_ms)
+{
+    s_wdgTimeout_ms = WatchdogHw_Start(timeout_ms);
+    s_wdgRefresh_ms = HAL_GetTick();
+    s_wdgRunning    = true;
+
+    Metrics_Set(METRIC_WDG_TIMEOUT_MS, s_wdgTimeout_ms);
+    Metrics_Publish(METRIC_WDG_WITHHELD, &s_wdgWithheld);
+
+    LOG_INFO("Watchdog started (timeout %lu ms)", (unsigned long)s_wdgTimeout_ms);
+
+    return s_wdgTimeout_ms;
+}
+
+RAMFUNC void AppTaskManager_WatchdogTick(void)
+{
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    AppTaskManager_AdvanceLoad(Time_NowUs32(), 0U);
+#endif
+
+    if (!s_wdgRunning)
+    {
+        return;
+    }
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    AppTaskManager_Supervise(HAL_GetTick());
+#else
+    /* A pass that never ends never refreshes; name the task holding it. */
+    const char *name   = s_running;
+    uint32_t    run_ms = HAL_GetTick() - s_runStart_ms;
+
+    if ((name != NULL) && !s_wdgRecorded && (run_ms > WATCHDOG_STALL_MS))
+    {
+        CrashLog_RecordWatchdog(name, run_ms);
+        s_wdgRecorded = true;
+    }
+#endif
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void AppTaskManager_CmdTasks(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "reset") == 0))
+    {
+        AppTaskManager_ResetStats();
+        CLI_Print("\r\nTask statistics cleared.\r\n");
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "jitter") == 0))
+    {
+        AppTaskManager_PrintJitter();
+        return;
+    }
+
+    if ((argc == 3U) && ((strcmp(argv[1], "on") == 0) || (strcmp(argv[1], "off") == 0)))
+    {
+        AppTaskDescriptor_t *task = AppTaskManager_FindByName(argv[2]);
+        if (task == NULL)
+        {
+            CLI_Print("\r\nNo task named '%s'.\r\n", argv[2]);
+            return;
+        }
+
+        AppTaskManager_SetEnabled(task, (argv[1][1] == 'n'));
+        CLI_Print("\r\nTask '%s' %s.\r\n", task->name, task->enabled ? "enabled" : "disabled");
+        return;
+    }
+
+    if ((argc == 3U) && (strcmp(argv[1], "hist") == 0))
+    {
+        AppTaskManager_PrintHistogram(argv[2]);
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "sched") == 0))
+    {
+        (void)AppTaskManager_Analyse(NULL, true, NULL, NULL);
+        return;
+    }
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: tasks [reset | jitter | sched | hist <name> | on <name> | off <name>]\r\n");
+        return;
+    }
+
+    CLI_Print("\r\nTasks (cycles @ %lu MHz, - = disabled, . = not in this mode):\r\n",
+              (unsigned long)(SystemCoreClock / 1000000U));
+    CLI_Print("  %-14s %7s %4s %8s %9s %9s %9s %8s %6s %6s %6s %6s\r\n",
+              " name", "period", "prio", "runs", "min", "avg", "max", "max_us",
+              "budget", "ovr", "bovr", "defer");
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        const AppTaskDescriptor_t *task = s_registered[i];
+        const AppTaskStats_t      *st   = &task->stats;
+        uint32_t avg = (st->runCount > 0U) ? (uint32_t)(st->totalCycles / st->runCount) : 0U;
+
+        CLI_Print("  %c%-13s %7lu %4u %8lu %9lu %9lu %9lu %8lu %6lu %6lu %6lu %6lu\r\n",
+                  !task->enabled ? '-' : (task->active ? ' ' : '.'),
+                  task->name,
+                  (unsigned long)task->period_ms,
+                  (unsigned)task->priority,
+                  (unsigned long)st->runCount,
+                  (unsigned long)((st->runCount > 0U) ? st->minCycles : 0U),
+                  (unsigned long)avg,
+                  (unsigned long)st->maxCycles,
+                  (unsigned long)st->maxRun_us,
+                  (unsigned long)task->budget_us,
+                  (unsigned long)st->overruns,
+                  (unsigned long)st->budgetOverruns,
+                  (unsigned long)st->deferrals);
+    }
+
+    if (s_eventTaskCount == 0U)
+    {
+        return;
+    }
+
+    CLI_Print("Event tasks:\r\n");
+    CLI_Print("  %-14s %10s %3s %8s %9s %8s %8s\r\n",
+              "name", "events", "lvl", "runs", "max", "max_us", "lat_us");
+
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        const AppEventTask_t *task = s_eventTasks[i];
+        const AppTaskStats_t *st   = &task->stats;
+
+        CLI_Print("  %-14s 0x%08lX %3u %8lu %9lu %8lu %8lu\r\n",
+                  task->name,
+                  (unsigned long)task->events,
+                  (unsigned)task->level,
+                  (unsigned long)st->runCount,
+                  (unsigned long)st->maxCycles,
+                  (unsigned long)st->maxRun_us,
+                  (unsigned long)task->maxLatency_us);
+    }
+}
+
+static void AppTaskManager_PrintJitter(void)
+{
+    static const char *const s_policyNames[] = { "skip", "catchup", "relative" };
+
+    CLI_Print("\r\nRelease lateness (us):\r\n");
+    CLI_Print("  %-14s %-8s %8s %7s %8s %8s %8s %8s\r\n",
+              "name", "policy", "runs", "skipped", "min", "p50", "p99", "max");
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        const AppTaskDescriptor_t *task = s_registered[i];
+        const AppTaskStats_t      *st   = &task->stats;
+
+        CLI_Print("  %-14s %-8s %8lu %7lu %8lu %8lu %8lu %8lu\r\n",
+                  task->name,
+                  s_policyNames[task->policy],
+                  (unsigned long)st->runCount,
+                  (unsigned long)st->skipped,
+                  (unsigned long)((st->runCount > 0U) ? st->minLate_us : 0U),
+                  (unsigned long)AppTaskManager_GetLatenessPercentile(st, 500U),
+                  (unsigned long)AppTaskManager_GetLatenessPercentile(st, 990U),
+                  (unsigned long)st->maxLate_us);
+    }
+}
+
+static void AppTaskManager_PrintHistogram(const char *name)
+{
+    const AppTaskDescriptor_t *task = AppTaskManager_FindByName(name);
+
+    if (task == NULL)
+    {
+        CLI_Print("\r\nNo task named '%s'.\r\n", name);
+        return;
+    }
+
+    CLI_Print("\r\n%s release lateness:\r\n", task->name);
+
+    for (uint32_t i = 0U; i < APP_TASK_LATENESS_BUCKETS; ++i)
+    {
+        uint32_t count = task->stats.lateHist[i];
+        if (count == 0U)
+        {
+            continue;
+        }
+
+        uint32_t low = (i == 0U) ? 0U : (1UL << (i + 5U));
+        if (i == (APP_TASK_LATENESS_BUCKETS - 1U))
+        {
+            CLI_Print("  >= %7lu us   %lu\r\n", (unsigned long)low, (unsigned long)count);
+        }
+        else
+        {
+            CLI_Print("  %7lu-%-7lu us %lu\r\n", (unsigned long)low,
+                      (unsigned long)((1UL << (i + 6U)) - 1U), (unsigned long)count);
+        }
+    }
+}
+
+static void AppTaskManager_Requeue(AppTaskDescriptor_t *task)
+{
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    if (task->active)
+    {
+        (void)xTaskAbortDelay(s_taskHandles[task->traceId]);
+    }
+#else
+    /* A task taken out for the pass in progress is not in the list; it
+     * goes back in after the pass with the values set by the caller or by
+     * its run. An inactive task is re-armed when it becomes active.
+     */
+    for (uint32_t i = 0U; i < s_taskCount; ++i)
+    {
+        if (s_tasks[i] == task)
+        {
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+            AppTaskManager_HeapFix(i);
+#endif
+            break;
+        }
+    }
+#endif
+}
+
+static void AppTaskManager_SetActive(AppTaskDescriptor_t *task, bool active)
+{
+    if (task->active == active)
+    {
+        return;
+    }
+
+    task->active = active;
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    if (active)
+    {
+        task->lastRun_ms = HAL_GetTick();
+        (void)xTaskNotifyGive(s_taskHandles[task->traceId]);
+    }
+    else
+    {
+        /* Stop waiting for the release; the task parks instead. */
+        (void)xTaskAbortDelay(s_taskHandles[task->traceId]);
+    }
+#else
+    if (active)
+    {
+        task->lastRun_ms = HAL_GetTick();
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+        AppTaskManager_HeapPush(task);
+#else
+        s_tasks[s_taskCount] = task;
+        s_taskCount++;
+#endif
+    }
+    else
+    {
+        AppTaskManager_Dequeue(task);
+    }
+#endif
+}
+
+static uint32_t AppTaskManager_IndexOf(const AppTaskDescriptor_t *task)
+{
+    uint32_t index = 0U;
+
+    while ((index < s_registeredCount) && (s_registered[index] != task))
+    {
+        index++;
+    }
+
+    return index;
+}
+
+static uint8_t AppTaskManager_FreeId(void)
+{
+    uint8_t id = 0U;
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        /* Any task holding id restarts the search one higher. */
+        if (s_registered[i]->traceId == id)
+        {
+            id++;
+            i = UINT32_MAX;
+        }
+    }
+
+    return id;
+}
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+
+static void AppTaskManager_Dequeue(const AppTaskDescriptor_t *task)
+{
+    for (uint32_t i = 0U; i < s_taskCount; ++i)
+    {
+        if (s_tasks[i] != task)
+        {
+            continue;
+        }
+
+        s_taskCount--;
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+        s_tasks[i]           = s_tasks[s_taskCount];
+        s_tasks[s_taskCount] = NULL;
+        if (i < s_taskCount)
+        {
+            AppTaskManager_HeapFix(i);
+        }
+#else
+        for (uint32_t j = i; j < s_taskCount; ++j)
+        {
+            s_tasks[j] = s_tasks[j + 1U];
+        }
+        s_tasks[s_taskCount] = NULL;
+#endif
+        return;
+    }
+
+    /* Not found: taken out for the pass in progress. RunDue() leaves it
+     * out once it sees the task disabled.
+     */
+}
+
+#endif
+
+static AppTaskDescriptor_t *AppTaskManager_FindByName(const char *name)
+{
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        /* The CLI lower-cases its input. */
+        if (strcasecmp(s_registered[i]->name, name) == 0)
+        {
+            return s_registered[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void AppTaskManager_Execute(AppTaskDescriptor_t *task, uint32_t now_ms)
+{
+    LOG_DEBUG("Running task '%s' (elapsed: %lu ms)",
+              task->name,
+              (unsigned long)(now_ms - task->lastRun_ms));
+
+    /* The release time is when the task became due, not when it started. */
+    uint32_t release_ms = AppTaskManager_Deadline(task);
+
+    AppTaskManager_RecordLateness(&task->stats, AppTaskManager_LatenessUs(release_ms));
+    AppTaskManager_Rearm(task, release_ms, now_ms);
+
+    CrashLog_RecordTask(task->name);
+    s_runStart_ms = HAL_GetTick();
+    s_running     = task->name;
+
+    uint32_t start_us = Time_NowUs32();
+    uint32_t start    = CycleCounter_Now();
+    TRACE_TASK_BEGIN(task->traceId);
+    task->function();
+    TRACE_TASK_END(task->traceId);
+    uint32_t cycles = CycleCounter_Now() - start;
+    uint32_t run_us = Time_NowUs32() - start_us;
+    s_running = NULL;
+    s_passRan = true;
+
+    AppTaskManager_UpdateStats(&task->stats, cycles, run_us);
+
+    /* Overrun: finished after the next release (implicit deadline). */
+    if ((task->period_ms > 0U) && ((HAL_GetTick() - release_ms) > task->period_ms))
+    {
+        task->stats.overruns++;
+    }
+
+    if ((task->budget_us > 0U) && (run_us > task->budget_us))
+    {
+        task->stats.budgetOverruns++;
+    }
+}
+
+static void AppTaskManager_Rearm(AppTaskDescriptor_t *task, uint32_t release_ms, uint32_t now_ms)
+{
+    uint32_t period = task->period_ms;
+
+    if ((period == 0U) || (task->policy == APP_TASK_POLICY_RELATIVE))
+    {
+        task->lastRun_ms = now_ms;
+        return;
+    }
+
+    /* Whole periods between this release and now: releases that are
+     * already due again.
+     */
+    uint32_t behind = (now_ms - release_ms) / period;
+
+    if (task->policy == APP_TASK_POLICY_CATCH_UP)
+    {
+        if (behind <= APP_SCHEDULER_CATCHUP_LIMIT)
+        {
+            task->lastRun_ms = release_ms;
+            return;
+        }
+
+        /* Too far behind: keep the newest releases, drop the rest. */
+        behind -= APP_SCHEDULER_CATCHUP_LIMIT;
+    }
+
+    task->stats.skipped += behind;
+    task->lastRun_ms     = release_ms + (behind * period);
+}
+
+static uint32_t AppTaskManager_LatenessUs(uint32_t release_ms)
+{
+    uint32_t tick;
+    uint32_t val;
+
+    /* A tick between the two reads makes VAL belong to the next one. */
+    do
+    {
+        tick = HAL_GetTick();
+        val  = SysTick->VAL;
+    } while (tick != HAL_GetTick());
+
+    uint32_t load = SysTick->LOAD + 1U;
+    uint32_t frac = ((load - 1U - val) * 1000U) / load;
+
+    return ((tick - release_ms) * 1000U) + frac;
+}
+
+static void AppTaskManager_RecordLateness(AppTaskStats_t *stats, uint32_t late_us)
+{
+    if ((stats->runCount == 0U) || (late_us < stats->minLate_us))
+    {
+        stats->minLate_us = late_us;
+    }
+    if (late_us > stats->maxLate_us)
+    {
+        stats->maxLate_us = late_us;
+    }
+
+    uint32_t bucket = 0U;
+    if (late_us >= 64U)
+    {
+        bucket = (31U - __CLZ(late_us)) - 5U;
+        if (bucket >= APP_TASK_LATENESS_BUCKETS)
+        {
+            bucket = APP_TASK_LATENESS_BUCKETS - 1U;
+        }
+    }
+    stats->lateHist[bucket]++;
+}
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+
+static RAMFUNC void AppTaskManager_RunDue(AppTaskDescriptor_t *due[], uint32_t count, uint32_t now_ms)
+{
+    /* Insertion sort: at most APP_MAX_TASKS entries, usually one or two. */
+    for (uint32_t i = 1U; i < count; ++i)
+    {
+        AppTaskDescriptor_t *task = due[i];
+        uint32_t             j    = i;
+
+        while ((j > 0U) && AppTaskManager_RunsBefore(task, due[j - 1U]))
+        {
+            due[j] = due[j - 1U];
+            j--;
+        }
+        due[j] = task;
+    }
+
+    uint32_t passStart_us = Time_NowUs32();
+    bool     overBudget   = false;
+
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        AppTaskDescriptor_t *task = due[i];
+
+        if (!task->active)
+        {
+            /* Disabled, out of the mode or removed by a task that ran
+             * earlier in the pass.
+             */
+            continue;
+        }
+
+        if (AppTaskManager_IsBefore(now_ms, AppTaskManager_Deadline(task)))
+        {
+            /* No longer due: re-armed by a task that ran earlier in the
+             * pass (a new period or mode).
+             */
+        }
+        else if (overBudget && (task->priority < APP_TASK_PRIORITY_HIGH))
+        {
+            /* Still due: it runs on the next pass, after any new events. */
+            task->stats.deferrals++;
+        }
+        else
+        {
+            AppTaskManager_Execute(task, now_ms);
+
+            overBudget = (APP_SCHEDULER_PASS_BUDGET_US > 0U) &&
+                         ((Time_NowUs32() - passStart_us) > APP_SCHEDULER_PASS_BUDGET_US);
+        }
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+        /* Unless the run disabled or removed the task itself. */
+        if (task->active)
+        {
+            AppTaskManager_HeapPush(task);
+        }
+#endif
+    }
+}
+
+static bool AppTaskManager_RunsBefore(const AppTaskDescriptor_t *a, const AppTaskDescriptor_t *b)
+{
+    if (a->priority != b->priority)
+    {
+        return (a->priority > b->priority);
+    }
+
+    return AppTaskManager_IsBefore(AppTaskManager_Deadline(a), AppTaskManager_Deadline(b));
+}
+
+static RAMFUNC void AppTaskManager_DispatchEvents(void)
+{
+    if (s_pendingEvents == 0U)
+    {
+        return;
+    }
+
+    /* Take the posted bits; posts from here on go to the next pass. */
+    __disable_irq();
+    uint32_t events     = s_pendingEvents;
+    uint32_t post_us    = s_firstPost_us;
+    s_pendingEvents = 0U;
+    __enable_irq();
+
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        AppEventTask_t *task    = s_eventTasks[i];
+        uint32_t        matched = events & task->events;
+        if (matched != 0U)
+        {
+            AppTaskManager_RunEvent(task, matched, post_us);
+        }
+    }
+}
+
+#else /* APP_SCHEDULER_BACKEND_RTOS */
+
+static void AppTaskManager_TaskEntry(void *arg)
+{
+    AppTaskDescriptor_t *task = (AppTaskDescriptor_t *)arg;
+
+    for (;;)
+    {
+        if (!task->active)
+        {
+            /* Parked until AppTaskManager_SetEnabled() or _SetMode() give
+             * the notification; one given early is not lost.
+             */
+            (void)ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        /* The release time is absolute and already follows the task's
+         * policy (Rearm), so a relative delay to it does not drift.
+         */
+        uint32_t now_ms   = HAL_GetTick();
+        uint32_t deadline = AppTaskManager_Deadline(task);
+        while (task->active && AppTaskManager_IsBefore(now_ms, deadline))
+        {
+            /* Cut short by AppTaskManager_Reschedule() or by leaving the set. */
+            vTaskDelay(pdMS_TO_TICKS(deadline - now_ms));
+            now_ms   = HAL_GetTick();
+            deadline = AppTaskManager_Deadline(task);
+        }
+
+        if (task->active)
+        {
+            AppTaskManager_Execute(task, HAL_GetTick());
+        }
+    }
+}
+
+static void AppTaskManager_EventTaskEntry(void *arg)
+{
+    uint32_t        slot = (uint32_t)(uintptr_t)arg;
+    AppEventTask_t *task = s_eventTasks[slot];
+
+    for (;;)
+    {
+        uint32_t matched = 0U;
+        (void)xTaskNotifyWait(0U, UINT32_MAX, &matched, portMAX_DELAY);
+
+        taskENTER_CRITICAL();
+        uint32_t post_us = s_eventPost_us[slot];
+        s_eventNotified &= ~(1UL << slot);
+        taskEXIT_CRITICAL();
+
+        AppTaskManager_RunEvent(task, matched, post_us);
+    }
+}
+
+#endif /* APP_SCHEDULER_BACKEND */
+
+static void AppTaskManager_RunEvent(AppEventTask_t *task, uint32_t matched, uint32_t post_us)
+{
+    CrashLog_RecordTask(task->name);
+    s_runStart_ms = HAL_GetTick();
+    s_running     = task->name;
+
+    uint32_t start_us = Time_NowUs32();
+    uint32_t start    = CycleCounter_Now();
+    uint32_t latency  = start_us - post_us;
+    if (latency > task->maxLatency_us)
+    {
+        task->maxLatency_us = latency;
+    }
+
+    TRACE_TASK_BEGIN(task->traceId);
+    task->handler(matched);
+    TRACE_TASK_END(task->traceId);
+    s_running = NULL;
+    s_passRan = true;
+
+    AppTaskManager_UpdateStats(&task->stats, CycleCounter_Now() - start,
+                               Time_NowUs32() - start_us);
+}
+
+static RAMFUNC void AppTaskManager_Supervise(uint32_t now_ms)
+{
+    if (!s_wdgRunning)
+    {
+        return;
+    }
+
+    const char *offender = NULL;
+    uint32_t    worst_ms = 0U;
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        const AppTaskDescriptor_t *task     = s_registered[i];
+        uint32_t                   deadline = AppTaskManager_Deadline(task);
+
+        /* Not due yet (however long the core slept) is on time. */
+        if ((task->watchdog_ms == 0U) || !task->active ||
+            AppTaskManager_IsBefore(now_ms, deadline))
+        {
+            continue;
+        }
+
+        uint32_t late_ms = now_ms - deadline;
+        if ((late_ms > task->watchdog_ms) && (late_ms >= worst_ms))
+        {
+            offender = task->name;
+            worst_ms = late_ms;
+        }
+    }
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    /* Tasks run concurrently here: one that never returns is also late. */
+    const char *name   = s_running;
+    uint32_t    run_ms = now_ms - s_runStart_ms;
+    if ((name != NULL) && (run_ms > WATCHDOG_STALL_MS) && (run_ms >= worst_ms))
+    {
+        offender = name;
+        worst_ms = run_ms;
+    }
+#endif
+
+    if (offender == NULL)
+    {
+        WatchdogHw_Refresh();
+        s_wdgRefresh_ms = now_ms;
+
+        if (s_wdgRecorded)
+        {
+            CrashLog_RecordWatchdog(NULL, 0U);
+            s_wdgRecorded = false;
+        }
+        return;
+    }
+
+    s_wdgWithheld++;
+    CrashLog_RecordWatchdog(offender, worst_ms);
+    s_wdgRecorded = true;
+}
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+
+static uint32_t AppTaskManager_WatchdogBound(uint32_t wait_ms)
+{
+    if (!s_wdgRunning)
+    {
+        return wait_ms;
+    }
+
+    /* Wake for the refresh half-way through the timeout: the IWDG keeps
+     * counting in STOP.
+     */
+    uint32_t now_ms = HAL_GetTick();
+    uint32_t due_ms = s_wdgRefresh_ms + (s_wdgTimeout_ms / 2U);
+    uint32_t left   = AppTaskManager_IsBefore(now_ms, due_ms) ? (due_ms - now_ms) : 0U;
+
+    return (left < wait_ms) ? left : wait_ms;
+}
+
+#endif
+
+static void AppTaskManager_UpdateStats(AppTaskStats_t *stats, uint32_t cycles, uint32_t us)
+{
+    if (us > stats->maxRun_us)
+    {
+        stats->maxRun_us = us;
+    }
+    if ((stats->runCount == 0U) || (cycles < stats->minCycles))
+    {
+        stats->minCycles = cycles;
+    }
+    if (cycles > stats->maxCycles)
+    {
+        stats->maxCycles = cycles;
+    }
+    stats->lastCycles   = cycles;
+    stats->totalCycles += cycles;
+    stats->window_us   += us;
+    stats->runCount++;
+}
+
+static RAMFUNC void AppTaskManager_AdvanceLoad(uint32_t now_us, uint32_t idle_us)
+{
+    uint32_t idleFrom_us = now_us - idle_us;
+
+    /* A sleep longer than the history only leaves idle windows behind. */
+    uint32_t behind = (now_us - s_loadStart_us) / APP_LOAD_WINDOW_US;
+    if (behind > (APP_LOAD_WINDOWS + 1U))
+    {
+        uint32_t skip = behind - (APP_LOAD_WINDOWS + 1U);
+        s_loadStart_us += skip * APP_LOAD_WINDOW_US;
+        s_load.windows += skip;
+        s_loadIdle_us   = 0U;
+    }
+
+    while ((now_us - s_loadStart_us) >= APP_LOAD_WINDOW_US)
+    {
+        uint32_t end_us = s_loadStart_us + APP_LOAD_WINDOW_US;
+
+        if ((idle_us != 0U) && ((int32_t)(end_us - idleFrom_us) > 0))
+        {
+            uint32_t from_us = ((int32_t)(idleFrom_us - s_loadStart_us) > 0) ? idleFrom_us : s_loadStart_us;
+            s_loadIdle_us += end_us - from_us;
+        }
+
+        AppTaskManager_CloseWindow();
+        s_loadStart_us = end_us;
+    }
+
+    if (idle_us != 0U)
+    {
+        uint32_t from_us = ((int32_t)(idleFrom_us - s_loadStart_us) > 0) ? idleFrom_us : s_loadStart_us;
+        s_loadIdle_us += now_us - from_us;
+    }
+}
+
+static void AppTaskManager_CloseWindow(void)
+{
+    uint32_t taskBusy_us = 0U;
+
+#if (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+    /* The RTOS backend closes windows from the tick, which no task preempts. */
+    uint32_t key = AppTaskManager_Lock();
+#endif
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        AppTaskStats_t *stats = &s_registered[i]->stats;
+
+        stats->sharePermille = (uint32_t)(((uint64_t)stats->window_us * 1000U) / APP_LOAD_WINDOW_US);
+        taskBusy_us         += stats->window_us;
+        stats->window_us     = 0U;
+    }
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        AppTaskStats_t *stats = &s_eventTasks[i]->stats;
+
+        stats->sharePermille = (uint32_t)(((uint64_t)stats->window_us * 1000U) / APP_LOAD_WINDOW_US);
+        taskBusy_us         += stats->window_us;
+        stats->window_us     = 0U;
+    }
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_RTOS)
+    uint32_t busy_us = taskBusy_us;
+#else
+    AppTaskManager_Unlock(key);
+    (void)taskBusy_us;
+    uint32_t busy_us = (s_loadIdle_us < APP_LOAD_WINDOW_US) ? (APP_LOAD_WINDOW_US - s_loadIdle_us) : 0U;
+#endif
+
+    uint32_t permille = (uint32_t)(((uint64_t)busy_us * 1000U) / APP_LOAD_WINDOW_US);
+    if (permille > 1000U)
+    {
+        permille = 1000U;
+    }
+
+    s_loadHistory[s_load.windows % APP_LOAD_WINDOWS] = (uint16_t)permille;
+    s_load.windows++;
+
+    uint32_t count = (s_load.windows < APP_LOAD_WINDOWS) ? s_load.windows : APP_LOAD_WINDOWS;
+    uint32_t sum   = 0U;
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        sum += s_loadHistory[i];
+    }
+
+    s_load.lastPermille = permille;
+    s_load.avgPermille  = sum / count;
+    if (permille > s_load.peakPermille)
+    {
+        s_load.peakPermille = permille;
+    }
+    s_loadIdle_us = 0U;
+
+#if (APP_SCHED_CHECK != 0) && (APP_SCHEDULER_BACKEND != APP_SCHEDULER_BACKEND_RTOS)
+    /* Measured run times can outgrow the budgets the set was admitted with. */
+    uint32_t    util = 0U;
+    const char *miss = NULL;
+    bool        ok   = AppTaskManager_Analyse(NULL, false, &util, &miss);
+
+    if (!ok && s_schedOk)
+    {
+        LOG_WARN("Task set not schedulable (utilization %lu permille, '%s' late)",
+                 (unsigned long)util, (miss != NULL) ? miss : "-");
+    }
+    s_schedOk = ok;
+#endif
+}
+
+static uint32_t AppTaskManager_Wcet(const AppTaskDescriptor_t *task)
+{
+    return (task->stats.maxRun_us > task->budget_us) ? task->stats.maxRun_us : task->budget_us;
+}
+
+static uint32_t AppTaskManager_ResponseUs(const AppTaskDescriptor_t *const set[], uint32_t count,
+                                          uint32_t index, uint32_t once_us)
+{
+    const AppTaskDescriptor_t *task  = set[index];
+    uint64_t                   wcet  = AppTaskManager_Wcet(task);
+    uint64_t                   limit = (uint64_t)task->period_ms * 1000U;
+    uint32_t                   lower = 0U;
+
+    /* Blocking: the longest lower-priority run that may have just started. */
+    for (uint32_t j = 0U; j < count; ++j)
+    {
+        if ((j != index) && (set[j]->period_ms != 0U) && (set[j]->priority < task->priority) &&
+            (AppTaskManager_Wcet(set[j]) > lower))
+        {
+            lower = AppTaskManager_Wcet(set[j]);
+        }
+    }
+
+    /* Start time: blocking plus every release of the others ahead of it
+     * (w = B + sum((floor(w / T) + 1) * C)), iterated to the fixed point.
+     */
+    uint64_t block = (uint64_t)once_us + lower;
+    uint64_t start = block;
+
+    for (;;)
+    {
+        uint64_t next = block;
+
+        for (uint32_t j = 0U; j < count; ++j)
+        {
+            if ((j != index) && (set[j]->period_ms != 0U) && (set[j]->priority >= task->priority))
+            {
+                uint64_t period = (uint64_t)set[j]->period_ms * 1000U;
+                next += ((start / period) + 1U) * AppTaskManager_Wcet(set[j]);
+            }
+        }
+
+        if ((next + wcet) > limit)
+        {
+            return APP_TASK_NO_DEADLINE;
+        }
+        if (next == start)
+        {
+            return (uint32_t)(start + wcet);
+        }
+        start = next;
+    }
+}
+
+static bool AppTaskManager_Analyse(const AppTaskDescriptor_t *extra, bool print,
+                                   uint32_t *util_permille, const char **miss)
+{
+    const AppTaskDescriptor_t *set[APP_MAX_TASKS + 1U];
+    uint32_t                   count = 0U;
+
+    for (uint32_t i = 0U; i < s_registeredCount; ++i)
+    {
+        if (s_registered[i]->enabled && AppTaskManager_InMode(s_registered[i], s_mode))
+        {
+            set[count++] = s_registered[i];
+        }
+    }
+    if ((extra != NULL) && AppTaskManager_InMode(extra, s_mode))
+    {
+        set[count++] = extra;
+    }
+
+    /* Level-0 event tasks run ahead of every pass; self-timed tasks at a
+     * rate the scheduler does not know. Each is counted once.
+     */
+    uint32_t once_us = 0U;
+    for (uint32_t i = 0U; i < s_eventTaskCount; ++i)
+    {
+        if (s_eventTasks[i]->level == 0U)
+        {
+            once_us += s_eventTasks[i]->stats.maxRun_us;
+        }
+    }
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        if (set[i]->period_ms == 0U)
+        {
+            once_us += AppTaskManager_Wcet(set[i]);
+        }
+    }
+
+    if (print)
+    {
+        CLI_Print("\r\nSchedulability (mode %lu; WCET = max(measured, budget), us):\r\n",
+                  (unsigned long)s_mode);
+        CLI_Print("  %-14s %7s %4s %8s %9s %5s\r\n", "name", "period", "prio", "wcet",
+                  "response", "util");
+    }
+
+    uint32_t    util  = 0U;
+    const char *late  = NULL;
+
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        const AppTaskDescriptor_t *task = set[i];
+        uint32_t                   wcet = AppTaskManager_Wcet(task);
+
+        if (task->period_ms == 0U)
+        {
+            if (print)
+            {
+                CLI_Print("  %-14s %7s %4u %8lu %9s %5s\r\n", task->name, "self",
+                          (unsigned)task->priority, (unsigned long)wcet, "-", "-");
+            }
+            continue;
+        }
+
+        /* us per ms is permille; rounded up. */
+        uint32_t share = (wcet + task->period_ms - 1U) / task->period_ms;
+        uint32_t resp  = AppTaskManager_ResponseUs(set, count, i, once_us);
+
+        util += share;
+        if ((resp == APP_TASK_NO_DEADLINE) && (late == NULL))
+        {
+            late = task->name;
+        }
+
+        if (print)
+        {
+            if (resp == APP_TASK_NO_DEADLINE)
+            {
+                CLI_Print("  %-14s %7lu %4u %8lu %9s %5lu\r\n", task->name,
+                          (unsigned long)task->period_ms, (unsigned)task->priority,
+                          (unsigned long)wcet, "LATE", (unsigned long)share);
+            }
+            else
+            {
+                CLI_Print("  %-14s %7lu %4u %8lu %9lu %5lu\r\n", task->name,
+                          (unsigned long)task->period_ms, (unsigned)task->priority,
+                          (unsigned long)wcet, (unsigned long)resp, (unsigned long)share);
+            }
+        }
+    }
+
+    bool ok = (late == NULL) && (util <= 1000U);
+
+    if (print)
+    {
+        CLI_Print("  Blocking once: %lu us (event and self-timed tasks)\r\n",
+                  (unsigned long)once_us);
+        CLI_Print("  Utilization: %lu permille; %s\r\n", (unsigned long)util,
+                  ok ? "schedulable" : "NOT schedulable");
+    }
+
+    if (util_permille != NULL)
+    {
+        *util_permille = util;
+    }
+    if (miss != NULL)
+    {
+        *miss = late;
+    }
+    return ok;
+}
+
+#if (APP_SCHEDULER_BACKEND == APP_SCHEDULER_BACKEND_HEAP)
+
+static void AppTaskManager_SiftUp(uint32_t index)
+{
+    AppTaskDescriptor_t *task     = s_tasks[index];
+    uint32_t             deadline = AppTaskManager_Deadline(task);
+
+    while (index > 0U)
+    {
+        uint32_t parent = (index - 1U) / 2U;
+        if (!AppTaskManager_IsBefore(deadline, AppTaskManager_Deadline(s_tasks[parent])))
+        {
+            break;
+        }
+
+        s_tasks[index] = s_tasks[parent];
+        index = parent;
+    }
+
+    s_tasks[index] = task;
+}
+
+static RAMFUNC void AppTaskManager_SiftDown(uint32_t index)
+{
+    AppTaskDescriptor_t *task     = s_tasks[index];
+    uint32_t             deadline = AppTaskManager_Deadline(task);
+
+    for (;;)
+    {
+        uint32_t child = (2U * index) + 1U;
+        if (child >= s_taskCount)
+        {
+            break;
+        }
+
+        /* Pick the earlier of the two children. */
+        if (((child + 1U) < s_taskCount) &&
+            AppTaskManager_IsBefore(AppTaskManager_Deadline(s_tasks[child + 1U]),
+                                    AppTaskManager_Deadline(s_tasks[child])))
         {
-            LOG_DEBUG("Running task '%s' (elapsed: %lu ms)",
-                      task->name,
-                      (unsigned long)elapsed);
+            child++;
+        }
 
-            task->lastRun_ms = now_ms;
-            task->function();
+        if (!AppTaskManager_IsBefore(AppTaskManager_Deadline(s_tasks[child]), deadline))
+        {
+            break;
         }
+
+        s_tasks[index] = s_tasks[child];
+        index = child;
+    }
+
+    s_tasks[index] = task;
+}
+
+static void AppTaskManager_HeapFix(uint32_t index)
+{
+    AppTaskDescriptor_t *task = s_tasks[index];
+
+    AppTaskManager_SiftUp(index);
+    if (s_tasks[index] == task)
+    {
+        AppTaskManager_SiftDown(index);
+    }
+}
+
+static void AppTaskManager_HeapPush(AppTaskDescriptor_t *task)
+{
+    s_tasks[s_taskCount] = task;
+    s_taskCount++;
+    AppTaskManager_SiftUp(s_taskCount - 1U);
+}
+
+static RAMFUNC AppTaskDescriptor_t *AppTaskManager_HeapPop(void)
+{
+    AppTaskDescriptor_t *root = s_tasks[0];
+
+    s_taskCount--;
+    if (s_taskCount > 0U)
+    {
+        s_tasks[0] = s_tasks[s_taskCount];
+        AppTaskManager_SiftDown(0U);
     }
+    s_tasks[s_taskCount] = NULL;
+
+    return root;
 }
+
+#endif /* APP_SCHEDULER_BACKEND_HEAP */
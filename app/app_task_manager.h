@@ -4,9 +4,24 @@
  *
  * This module implements a simple tick-based scheduler that
  * periodically calls registered tasks based on their configured
- * execution period. It is intended as a stepping stone toward
+ * execution period. Tasks are kept ordered by their next deadline
+ * (see @ref APP_SCHEDULER_BACKEND), so finding the next due task
+ * does not depend on the number of registered tasks. Each run is timed
+ * with the DWT cycle counter. It is intended as a stepping stone toward
  * a full RTOS-based design in later phases.
  *
+ * Besides periodic tasks, event tasks are run on the next scheduler pass
+ * after an interrupt posts one of their event bits, so reactive work does
+ * not wait for a polling period. An event task can instead be given a
+ * preemption level (@ref APP_PREEMPT_LEVELS): it then runs to completion
+ * from a software-pended interrupt of that level as soon as its bit is
+ * posted, preempting the pass and lower levels, but not the drivers.
+ *
+ * Once AppTaskManager_StartWatchdog() has been called, the task manager
+ * also supervises the independent watchdog: it is refreshed only while
+ * every task with a watchdog slack has started within that slack of its
+ * release.
+ *
  * @ingroup scheduler
  */
 
@@ -18,6 +33,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * @defgroup scheduler Cooperative Task Scheduler
@@ -26,11 +42,110 @@ extern "C" {
  * @{
  */
 
+/**
+ * @brief Returned by AppTaskManager_GetTimeUntilNextDeadline() when no
+ *        task is registered.
+ */
+#define APP_TASK_NO_DEADLINE   (0xFFFFFFFFU)
+
+/**
+ * @brief Mode indices AppTaskManager_SetMode() accepts.
+ *
+ * The application numbers its modes; here it uses PowerMode_t.
+ */
+#define APP_TASK_MAX_MODES     (8U)
+
+/**
+ * @brief Bit of mode index @p mode in @ref AppTaskDescriptor_t::modes.
+ */
+#define APP_TASK_MODE(mode)    ((uint8_t)(1U << (mode)))
+
 /**
  * @brief Function pointer type for a scheduled task.
  */
 typedef void (*AppTaskFunction_t)(void);
 
+/**
+ * @brief Task priority; when several tasks are due in one pass the highest
+ *        runs first.
+ *
+ * Tasks of equal priority run earliest deadline first. Zero-initialized
+ * descriptors get @ref APP_TASK_PRIORITY_LOW.
+ */
+typedef enum
+{
+    APP_TASK_PRIORITY_LOW = 0U,  /**< Housekeeping (heartbeat, flash log).  */
+    APP_TASK_PRIORITY_NORMAL,    /**< Regular processing.                   */
+    APP_TASK_PRIORITY_HIGH       /**< Acquisition; never deferred.          */
+} AppTaskPriority_t;
+
+/**
+ * @brief What happens to the release time after a run.
+ *
+ * Release times are absolute: for the first two policies the next one is
+ * the previous one plus the period, however late the run started, so the
+ * task phase does not drift.
+ */
+typedef enum
+{
+    APP_TASK_POLICY_SKIP = 0U,  /**< Releases missed entirely are dropped (counted). */
+    APP_TASK_POLICY_CATCH_UP,   /**< Missed releases run back-to-back, at most
+                                     @ref APP_SCHEDULER_CATCHUP_LIMIT behind. */
+    APP_TASK_POLICY_RELATIVE    /**< Next release = start + period, for tasks that
+                                     re-arm themselves.                     */
+} AppTaskPolicy_t;
+
+/**
+ * @brief Number of buckets in the lateness histogram.
+ *
+ * Bucket 0 counts starts less than 64 us after the release; bucket i
+ * counts [2^(i+5), 2^(i+6)) us; the last bucket is open-ended (> 0.5 s).
+ */
+#define APP_TASK_LATENESS_BUCKETS   (16U)
+
+/**
+ * @brief Run-time statistics collected for each task.
+ *
+ * Maintained by the task manager; zero-initialize when declaring a
+ * descriptor. Cycle counts are DWT CYCCNT deltas around the task function
+ * and therefore depend on the clock profile in use when they were taken;
+ * maxRun_us comes from the microsecond time base (time_base.h) and does
+ * not.
+ */
+typedef struct
+{
+    uint32_t runCount;     /**< Number of completed runs.                          */
+    uint32_t minCycles;    /**< Shortest run (valid once runCount > 0).            */
+    uint32_t maxCycles;    /**< Longest run.                                       */
+    uint64_t totalCycles;  /**< Sum of all runs, for the average.                  */
+    uint32_t lastCycles;   /**< Most recent run.                                   */
+    uint32_t maxRun_us;    /**< Longest run in us (time base, clock independent).  */
+    uint32_t overruns;     /**< Runs that finished after their next release time. */
+    uint32_t budgetOverruns; /**< Runs that took longer than the task budget.      */
+    uint32_t deferrals;    /**< Passes in which the task was due but deferred.    */
+    uint32_t skipped;      /**< Releases dropped by @ref APP_TASK_POLICY_SKIP.    */
+    uint32_t minLate_us;   /**< Smallest start delay after the release.           */
+    uint32_t maxLate_us;   /**< Largest start delay after the release.            */
+    uint32_t lateHist[APP_TASK_LATENESS_BUCKETS]; /**< Start delay histogram.     */
+    uint32_t window_us;    /**< Run time in the current load window.              */
+    uint32_t sharePermille; /**< Share of the last load window (1/1000).         */
+} AppTaskStats_t;
+
+/**
+ * @brief CPU load over windows of @ref APP_LOAD_WINDOW_MS.
+ *
+ * The load of a window is the time not spent idle (see
+ * AppTaskManager_AddIdle()), in 1/1000 of the window: tasks, interrupts
+ * and the scheduler itself.
+ */
+typedef struct
+{
+    uint32_t lastPermille;  /**< Last complete window.                           */
+    uint32_t avgPermille;   /**< Average of the last @ref APP_LOAD_WINDOWS windows. */
+    uint32_t peakPermille;  /**< Busiest window since boot or the last reset.    */
+    uint32_t windows;       /**< Windows completed.                              */
+} AppLoadStats_t;
+
 /**
  * @brief Descriptor for a single scheduled task.
  *
@@ -44,10 +159,51 @@ typedef struct
 {
     const char        *name;       /**< Human-readable task name.          */
     AppTaskFunction_t  function;   /**< Pointer to the task function.      */
-    uint32_t           period_ms;  /**< Period of execution in milliseconds. */
-    uint32_t           lastRun_ms; /**< Last time the task was executed.   */
+    uint32_t           period_ms;  /**< Period in ms; AppTaskManager_SetPeriod() once registered. */
+    uint32_t           lastRun_ms; /**< Release time of the last run.      */
+    AppTaskPriority_t  priority;   /**< Order among tasks due in one pass. */
+    AppTaskPolicy_t    policy;     /**< Release time policy.               */
+    uint32_t           budget_us;  /**< Expected worst-case run time, 0 = none. */
+    uint32_t           watchdog_ms; /**< Liveness slack after the release, 0 = not supervised. */
+    uint8_t            modes;      /**< APP_TASK_MODE() bits it runs in, 0 = all. */
+    const uint32_t    *modePeriod_ms; /**< Period per mode index, NULL = period_ms in all. */
+    uint8_t            traceId;    /**< Event trace id and slot (managed internally). */
+    bool               enabled;    /**< Not paused (managed internally).   */
+    bool               active;     /**< Enabled and in the mode (managed internally). */
+    AppTaskStats_t     stats;      /**< Profiling data (managed internally). */
 } AppTaskDescriptor_t;
 
+/**
+ * @brief Event task function; receives the posted bits it subscribed to.
+ */
+typedef void (*AppEventHandler_t)(uint32_t events);
+
+/**
+ * @brief Descriptor for an event-triggered task.
+ *
+ * The handler runs once per scheduler pass in which at least one of
+ * @c events was posted. Like @ref AppTaskDescriptor_t, instances live in
+ * static storage.
+ *
+ * With a @c level of 1 to @ref APP_PREEMPT_LEVELS the handler runs from
+ * the interrupt of that level instead, right after the post (once per
+ * interrupt, with the bits posted since the last run), in the order of
+ * registration among the tasks of its level. It preempts the task that
+ * is running, so what it shares with task context is guarded with
+ * AppTaskManager_Lock(). The RTOS backend runs every event task in its
+ * own kernel task and ignores the level.
+ */
+typedef struct
+{
+    const char        *name;             /**< Human-readable task name.              */
+    AppEventHandler_t  handler;          /**< Called with the pending subscribed bits. */
+    uint32_t           events;           /**< Event bits that trigger the task.      */
+    uint8_t            level;            /**< Preemption level, 0 = scheduler pass.  */
+    uint32_t           maxLatency_us;    /**< Longest post-to-run delay (managed).   */
+    uint8_t            traceId;          /**< Event trace id (managed internally).   */
+    AppTaskStats_t     stats;            /**< Profiling data (managed internally).   */
+} AppEventTask_t;
+
 /**
  * @brief Initializes the task manager.
  *
@@ -70,22 +226,343 @@ void AppTaskManager_Init(void);
  *             valid (in static or global storage) for the lifetime
  *             of the application.
  *
- * @return 0 on success, non-zero if the task list is full or the task
- *         pointer is invalid.
+ * The task is enabled and, if it runs in the current mode (see
+ * AppTaskManager_SetMode()), first due one period after registration.
+ *
+ * With @ref APP_SCHED_CHECK the task set is checked first (see
+ * AppTaskManager_CheckSchedule()).
+ *
+ * @return 0 on success, -1 if the task pointer is invalid, -2 if all
+ *         @ref APP_MAX_TASKS slots are taken, -3 if the task is already
+ *         registered, -4 if the set would not be schedulable with it
+ *         (@ref APP_SCHED_CHECK 2).
  */
 int AppTaskManager_RegisterTask(AppTaskDescriptor_t *task);
 
+/**
+ * @brief Remove a task from the scheduler and free its slot.
+ *
+ * May be called from any task, including the one being removed (it is
+ * not run again). With the RTOS backend the kernel task is deleted, so
+ * the task must be parked first (disabled, or not in the current mode)
+ * and must not be the caller.
+ *
+ * @param task Registered task descriptor.
+ *
+ * @return 0 on success, -1 if the task is not registered, -2 if the
+ *         RTOS backend cannot delete it now.
+ */
+int AppTaskManager_UnregisterTask(AppTaskDescriptor_t *task);
+
+/**
+ * @brief Pause or resume a registered task.
+ *
+ * A disabled task is taken out of the set the scheduler looks at, so it
+ * costs nothing per pass, and is not supervised by the watchdog; it is
+ * still listed by `tasks`. Enabling re-arms it one period from now, as
+ * registration does; a task enabled outside its modes waits for one of
+ * them. With the RTOS backend a disabled task parks before its next
+ * release. Task context only.
+ *
+ * @param task    Registered task descriptor.
+ * @param enabled true to schedule the task, false to pause it.
+ *
+ * @return None.
+ */
+void AppTaskManager_SetEnabled(AppTaskDescriptor_t *task, bool enabled);
+
+/**
+ * @brief Switch the task set to another mode.
+ *
+ * Every registered task whose @c modes leave out @p mode is taken out of
+ * the scheduler, as if disabled, and every enabled task that runs in it
+ * is put back, first due one period later. Tasks with a @c modePeriod_ms
+ * table take the period of @p mode, counted from their last release. The
+ * whole set changes in this call, before the next scheduler pass. Tasks
+ * registered later start in the mode set last (0 until the first call).
+ * Task context only.
+ *
+ * @param mode Mode index, below @ref APP_TASK_MAX_MODES.
+ *
+ * @return None.
+ */
+void AppTaskManager_SetMode(uint32_t mode);
+
+/**
+ * @brief Registers an event-triggered task.
+ *
+ * @param task Pointer to an event task descriptor in static storage.
+ *
+ * An event bit belongs to one level: the tasks subscribed to it must all
+ * have the same @c level.
+ *
+ * @return 0 on success, -1 if the pointer is invalid, -2 if the list is
+ *         full, -3 if the level does not exist or one of the bits belongs
+ *         to a task of another level.
+ */
+int AppTaskManager_RegisterEventTask(AppEventTask_t *task);
+
+/**
+ * @brief Post event bits; safe from interrupt handlers.
+ *
+ * Bits posted again before the scheduler runs are merged. The main loop
+ * does not enter idle while an event is pending. Bits of a preemption
+ * level pend its interrupt, which runs as soon as the caller's priority,
+ * and AppTaskManager_Lock(), allow.
+ *
+ * @param events Event bits (see @ref app_config).
+ *
+ * @return None.
+ */
+void AppTaskManager_PostEvent(uint32_t events);
+
+/**
+ * @brief Whether any posted event is waiting for the scheduler.
+ *
+ * @return true if AppTaskManager_RunOnce() has events to dispatch.
+ */
+bool AppTaskManager_HasPendingEvents(void);
+
 /**
  * @brief Executes any tasks that are due to run.
  *
- * This function should be called frequently from the main loop. It
- * checks each registered task and executes it if its period has
- * elapsed since the last run.
+ * This function should be called frequently from the main loop. It first
+ * runs the event tasks whose events were posted, then every task whose
+ * period has elapsed since its last run, highest priority first and
+ * earliest deadline first within a priority. Each task runs at most once
+ * per call.
+ *
+ * Once the pass has used @ref APP_SCHEDULER_PASS_BUDGET_US, the remaining
+ * due tasks below @ref APP_TASK_PRIORITY_HIGH are deferred to the next
+ * pass, so events and newly due high-priority tasks get in between.
+ *
+ * With @ref APP_SCHEDULER_BACKEND_RTOS the first call starts the kernel
+ * and does not return.
  *
  * @return None.
  */
 void AppTaskManager_RunOnce(void);
 
+/**
+ * @brief Move the next release of a registered periodic task.
+ *
+ * For a task whose next release depends on state outside the scheduler:
+ * the owner calls this when that state changes, so the task does not have
+ * to poll for it. A release in the past makes the task due on the next
+ * pass. With the RTOS backend a task waiting for its release is woken to
+ * wait for the new one. Task context only.
+ *
+ * @param task       Registered task descriptor.
+ * @param release_ms New release time (HAL tick).
+ *
+ * @return None.
+ */
+void AppTaskManager_Reschedule(AppTaskDescriptor_t *task, uint32_t release_ms);
+
+/**
+ * @brief Change the period of a registered periodic task.
+ *
+ * The next release becomes one new period after the last one. Safe on a
+ * task that is due or running: a task may set its own period from its
+ * function. Task context only.
+ *
+ * @param task      Registered task descriptor.
+ * @param period_ms New period (ms).
+ *
+ * @return None.
+ */
+void AppTaskManager_SetPeriod(AppTaskDescriptor_t *task, uint32_t period_ms);
+
+/**
+ * @brief Hand posted events to the event tasks (RTOS backend only).
+ *
+ * Called from the interrupt AppTaskManager_PostEvent() pends, which runs
+ * at configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY.
+ *
+ * @return None.
+ */
+void AppTaskManager_EventIrqHandler(void);
+
+/**
+ * @brief Run the event tasks of preemption level @p level.
+ *
+ * Called from the interrupt of that level (stm32f4xx_it.c); levels that
+ * are not configured are ignored.
+ *
+ * @param level Preemption level, 1 to @ref APP_PREEMPT_LEVELS.
+ *
+ * @return None.
+ */
+void AppTaskManager_LevelIrqHandler(uint32_t level);
+
+/**
+ * @brief Keep every preemption level from running until
+ *        AppTaskManager_Unlock().
+ *
+ * Raises BASEPRI to the priority of the highest level, so the driver
+ * interrupts still run; nests, and may be taken from a level handler.
+ * With the RTOS backend it suspends the kernel scheduler instead (a no-op
+ * before the kernel starts). For short sections of task context that
+ * share data with a preempting event task.
+ *
+ * @return Key for AppTaskManager_Unlock().
+ */
+uint32_t AppTaskManager_Lock(void);
+
+/**
+ * @brief End a section started with AppTaskManager_Lock().
+ *
+ * Levels posted meanwhile run here.
+ *
+ * @param key Value returned by the matching AppTaskManager_Lock().
+ *
+ * @return None.
+ */
+void AppTaskManager_Unlock(uint32_t key);
+
+/**
+ * @brief Time remaining until the earliest task deadline.
+ *
+ * Lets the main loop sleep instead of spinning on AppTaskManager_RunOnce().
+ *
+ * @return Milliseconds until the next task is due, 0 if a task is already
+ *         due or an event is pending, or @ref APP_TASK_NO_DEADLINE if no
+ *         task is registered. While the watchdog runs, at most the time
+ *         until its next refresh is due.
+ */
+uint32_t AppTaskManager_GetTimeUntilNextDeadline(void);
+
+/**
+ * @brief Start the independent watchdog under task manager supervision.
+ *
+ * From then on, every scheduler pass refreshes the IWDG if no supervised
+ * task (watchdog_ms != 0) is more than its slack past its release; a task
+ * that is not due is never late, so sleeping does not count against it.
+ * Otherwise the refresh is withheld and the latest offender is recorded
+ * in the crash trace, so it is named after the reset. A task or event task
+ * that runs for longer than @ref WATCHDOG_STALL_MS is recorded as well,
+ * from AppTaskManager_WatchdogTick().
+ *
+ * The IWDG keeps counting in STOP, so AppTaskManager_GetTimeUntilNextDeadline()
+ * is limited to half the timeout after the last refresh: idle sleeps end
+ * in time for the next one.
+ *
+ * @param timeout_ms Watchdog timeout.
+ *
+ * @return Programmed timeout in ms.
+ */
+uint32_t AppTaskManager_StartWatchdog(uint32_t timeout_ms);
+
+/**
+ * @brief Watchdog stall check; called from SysTick_Handler().
+ *
+ * Records the running task once it has run for @ref WATCHDOG_STALL_MS.
+ * With @ref APP_SCHEDULER_BACKEND_RTOS, where there is no scheduler pass,
+ * it also does the supervised refresh.
+ *
+ * @return None.
+ */
+void AppTaskManager_WatchdogTick(void);
+
+/**
+ * @brief Number of registered tasks.
+ *
+ * @return Task count.
+ */
+uint32_t AppTaskManager_GetTaskCount(void);
+
+/**
+ * @brief Access a registered task by index, e.g. for reporting.
+ *
+ * Tasks are in registration order, including those running in the
+ * current scheduler pass.
+ *
+ * @param index Index in the range [0, AppTaskManager_GetTaskCount()).
+ *
+ * @return Task descriptor, or NULL if @p index is out of range.
+ */
+const AppTaskDescriptor_t *AppTaskManager_GetTask(uint32_t index);
+
+/**
+ * @brief Number of registered event tasks.
+ *
+ * @return Event task count.
+ */
+uint32_t AppTaskManager_GetEventTaskCount(void);
+
+/**
+ * @brief Access a registered event task by index.
+ *
+ * @param index Index in the range [0, AppTaskManager_GetEventTaskCount()).
+ *
+ * @return Event task descriptor, or NULL if @p index is out of range.
+ */
+const AppEventTask_t *AppTaskManager_GetEventTask(uint32_t index);
+
+/**
+ * @brief Lateness percentile from a task's histogram.
+ *
+ * @param stats    Task statistics.
+ * @param permille Percentile in 1/1000 (e.g. 990 for p99).
+ *
+ * @return Upper edge of the bucket holding the percentile in us (an upper
+ *         bound, capped at maxLate_us), 0 if the task never ran.
+ */
+uint32_t AppTaskManager_GetLatenessPercentile(const AppTaskStats_t *stats, uint32_t permille);
+
+/**
+ * @brief Clear the statistics of all registered tasks.
+ *
+ * @return None.
+ */
+void AppTaskManager_ResetStats(void);
+
+/**
+ * @brief Account idle time that ended now, for the CPU load.
+ *
+ * Called by the main loop with the time it spent in
+ * PowerManager_IdleFor(); passes that run no task are counted as idle by
+ * the task manager itself, so a busy-polling main loop is measured too.
+ * Idle time spanning window boundaries is split over the windows.
+ *
+ * @param idle_us Idle time in us (time base).
+ *
+ * @return None.
+ */
+void AppTaskManager_AddIdle(uint32_t idle_us);
+
+/**
+ * @brief Get the CPU load figures.
+ *
+ * Per-task shares of the last window are in AppTaskStats_t::sharePermille.
+ *
+ * @param[out] load Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void AppTaskManager_GetLoad(AppLoadStats_t *load);
+
+/**
+ * @brief Worst-case response-time analysis of the tasks of the current
+ *        mode.
+ *
+ * Each task's worst-case run time (WCET) is the larger of its longest
+ * measured run and its budget_us. Tasks run to completion, so a task
+ * waits for at most one lower-priority run already in progress, one run
+ * of each level-0 event task and of each self-timed task (period 0,
+ * whose rate the scheduler does not know), and every release of a task
+ * of its own or higher priority until it starts. The set is schedulable
+ * if the total utilization is at most 100 % and every periodic task
+ * finishes within its period. Preemption levels are not counted.
+ *
+ * @param[out] util_permille Total utilization in 1/1000 (may be NULL).
+ * @param[out] miss          First task that misses its period, or NULL
+ *                           (may be NULL).
+ *
+ * @return Whether the set is schedulable.
+ */
+bool AppTaskManager_CheckSchedule(uint32_t *util_permille, const char **miss);
+
 /** @} */ /* end of scheduler group */
 
 #ifdef __cplusplus
@@ -0,0 +1,218 @@
+/**
+ * @file app_work_queue.c
+ * @brief Deferred work queue implementation.
+ *
+ * A bounded multi-producer, single-consumer ring in the style of a
+ * sequence-numbered (Vyukov) queue. Slot i of position p is free for a
+ * producer while its sequence number equals p and holds a published item
+ * once it equals p + 1; the consumer frees it for the position one lap
+ * later by setting it to p + @ref APP_WORK_QUEUE_SIZE.
+ *
+ * - Producers claim position @ref s_tail with LDREX/STREX. An exception
+ *   clears the exclusive monitor, so a producer preempted between the two
+ *   retries with the next position; no context has to mask interrupts.
+ * - The item is written, then published with a barrier and the sequence
+ *   store; only then is @ref APP_EVENT_WORK posted.
+ * - The consumer runs in task context, below every interrupt, so when it
+ *   runs every claim made from an interrupt has been published. It stops
+ *   at the first unpublished slot; the post that publishes it wakes the
+ *   consumer again.
+ *
+ * A slot is freed before its function runs, so a function can post again.
+ * One drain runs at most one lap of items, so a function that always
+ * re-posts cannot hold the pass; the rest waits for the next pass.
+ *
+ * @ingroup scheduler
+ */
+
+#include "app_work_queue.h"
+#include "app_config.h"
+#include "app_task_manager.h"
+#include "metrics.h"
+#include "time_base.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+
+_Static_assert((APP_WORK_QUEUE_SIZE & (APP_WORK_QUEUE_SIZE - 1U)) == 0U,
+               "APP_WORK_QUEUE_SIZE must be a power of two");
+
+/**
+ * @brief One queue slot.
+ */
+typedef struct
+{
+    AppWorkFn_t       fn;      /**< Function of the item.                      */
+    void             *context; /**< Its argument.                              */
+    uint32_t          post_us; /**< Time base at the post.                     */
+    volatile uint32_t seq;     /**< Position it is free for, or published + 1. */
+} AppWorkSlot_t;
+
+/** @brief The ring. */
+static AppWorkSlot_t s_slots[APP_WORK_QUEUE_SIZE];
+
+/** @brief Next position a producer claims. */
+static volatile uint32_t s_tail = 0U;
+
+/** @brief Next position the consumer runs. */
+static volatile uint32_t s_head = 0U;
+
+/** @brief Counters published as metrics. */
+static volatile uint32_t s_posted       = 0U; /**< Items queued.                 */
+static volatile uint32_t s_dropped      = 0U; /**< Posts to a full queue.        */
+static volatile uint32_t s_depthMax     = 0U; /**< Most items queued at once.    */
+static volatile uint32_t s_latencyMax_us = 0U; /**< Longest post-to-run delay.  */
+
+/**
+ * @brief Event task: run the queued items.
+ */
+static void AppWorkQueue_Drain(uint32_t events);
+
+/**
+ * @brief Raise @p counter to at least @p value (LDREX/STREX; any context).
+ */
+static void AppWorkQueue_Raise(volatile uint32_t *counter, uint32_t value);
+
+/**
+ * @brief Add one to @p counter (LDREX/STREX; any context).
+ */
+static void AppWorkQueue_Count(volatile uint32_t *counter);
+
+/** @brief Runs the deferred work. */
+static AppEventTask_t s_workEventTask =
+{
+    .name    = "Work",
+    .handler = AppWorkQueue_Drain,
+    .events  = APP_EVENT_WORK
+};
+
+/* ------------------------------------------------------------------------- */
+
+void AppWorkQueue_Init(void)
+{
+    for (uint32_t i = 0U; i < APP_WORK_QUEUE_SIZE; ++i)
+    {
+        s_slots[i].fn      = NULL;
+        s_slots[i].context = NULL;
+        s_slots[i].seq     = i;
+    }
+    s_tail          = 0U;
+    s_head          = 0U;
+    s_posted        = 0U;
+    s_dropped       = 0U;
+    s_depthMax      = 0U;
+    s_latencyMax_us = 0U;
+
+    Metrics_Publish(METRIC_WORK_POSTED, &s_posted);
+    Metrics_Publish(METRIC_WORK_DROPPED, &s_dropped);
+    Metrics_Publish(METRIC_WORK_DEPTH_MAX, &s_depthMax);
+    Metrics_Publish(METRIC_WORK_LATENCY_MAX_US, &s_latencyMax_us);
+
+    (void)AppTaskManager_RegisterEventTask(&s_workEventTask);
+}
+
+bool AppWorkQueue_Post(AppWorkFn_t fn, void *context)
+{
+    if (fn == NULL)
+    {
+        return false;
+    }
+
+    AppWorkSlot_t *slot = NULL;
+    uint32_t       pos  = 0U;
+
+    for (;;)
+    {
+        pos  = __LDREXW(&s_tail);
+        slot = &s_slots[pos & (APP_WORK_QUEUE_SIZE - 1U)];
+
+        if (slot->seq != pos)
+        {
+            /* Not yet freed by the consumer: the ring is full. */
+            __CLREX();
+            AppWorkQueue_Count(&s_dropped);
+            return false;
+        }
+
+        if (__STREXW(pos + 1U, &s_tail) == 0U)
+        {
+            break;
+        }
+    }
+
+    slot->fn      = fn;
+    slot->context = context;
+    slot->post_us = Time_NowUs32();
+    __DMB();
+    slot->seq = pos + 1U;
+
+    AppWorkQueue_Count(&s_posted);
+    AppWorkQueue_Raise(&s_depthMax, (pos + 1U) - s_head);
+    AppTaskManager_PostEvent(APP_EVENT_WORK);
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Internal Helper Functions                                                 */
+/* ------------------------------------------------------------------------- */
+
+static void AppWorkQueue_Drain(uint32_t events)
+{
+    (void)events;
+
+    for (uint32_t n = 0U; n < APP_WORK_QUEUE_SIZE; ++n)
+    {
+        uint32_t       pos  = s_head;
+        AppWorkSlot_t *slot = &s_slots[pos & (APP_WORK_QUEUE_SIZE - 1U)];
+
+        if (slot->seq != (pos + 1U))
+        {
+            return;
+        }
+        __DMB();
+
+        AppWorkFn_t fn      = slot->fn;
+        void       *context = slot->context;
+        uint32_t    late_us = Time_NowUs32() - slot->post_us;
+
+        /* Free the slot first, so the function may post again. */
+        __DMB();
+        slot->seq = pos + APP_WORK_QUEUE_SIZE;
+        s_head    = pos + 1U;
+
+        if (late_us > s_latencyMax_us)
+        {
+            s_latencyMax_us = late_us;
+        }
+
+        fn(context);
+    }
+
+    /* A full lap ran: leave what is left for the next pass. */
+    if (s_slots[s_head & (APP_WORK_QUEUE_SIZE - 1U)].seq == (s_head + 1U))
+    {
+        AppTaskManager_PostEvent(APP_EVENT_WORK);
+    }
+}
+
+static void AppWorkQueue_Raise(volatile uint32_t *counter, uint32_t value)
+{
+    uint32_t current;
+    do
+    {
+        current = __LDREXW(counter);
+        if (current >= value)
+        {
+            __CLREX();
+            return;
+        }
+    } while (__STREXW(value, counter) != 0U);
+}
+
+static void AppWorkQueue_Count(volatile uint32_t *counter)
+{
+    uint32_t count;
+    do
+    {
+        count = __LDREXW(counter);
+    } while (__STREXW(count + 1U, counter) != 0U);
+}
@@ -0,0 +1,75 @@
+/**
+ * @file app_work_queue.h
+ * @brief Deferred work queue: interrupt bottom halves run by the scheduler.
+ *
+ * An interrupt handler that has more to do than acknowledge its source
+ * posts a (function, context) item with AppWorkQueue_Post() and returns;
+ * the "Work" event task runs the items in post order on the next
+ * scheduler pass, before any periodic task (with the RTOS backend, above
+ * every periodic task). Posting is lock-free: producers claim a slot of a
+ * fixed ring with one LDREX/STREX pair and publish it with a sequence
+ * number, so any number of interrupts at any priority can post while the
+ * single consumer drains, and no interrupt is ever masked. An item costs a
+ * slot and no allocation; with every slot taken the post fails and is
+ * counted.
+ *
+ * The queue depth seen by producers, the worst post-to-run latency and
+ * the drops are published as metrics and shown by `status`.
+ *
+ * @ingroup scheduler
+ */
+
+#ifndef APP_WORK_QUEUE_H
+#define APP_WORK_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @addtogroup scheduler
+ * @{
+ */
+
+/**
+ * @brief Deferred work function; runs in task context.
+ *
+ * @param context The pointer given to AppWorkQueue_Post().
+ */
+typedef void (*AppWorkFn_t)(void *context);
+
+/**
+ * @brief Empty the queue, publish its metrics and register the "Work"
+ *        event task.
+ *
+ * Call once after AppTaskManager_Init().
+ *
+ * @return None.
+ */
+void AppWorkQueue_Init(void);
+
+/**
+ * @brief Queue @p fn to run with @p context in task context.
+ *
+ * Lock-free and safe from any context; takes a few dozen cycles and never
+ * waits. Items run in the order their slots were claimed. An item may
+ * post again from its function; it runs on a later pass.
+ *
+ * @param fn      Function; NULL is rejected.
+ * @param context Passed to @p fn.
+ *
+ * @return false if @p fn is NULL or all @ref APP_WORK_QUEUE_SIZE slots are
+ *         taken (counted as a drop).
+ */
+bool AppWorkQueue_Post(AppWorkFn_t fn, void *context);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_WORK_QUEUE_H */
@@ -0,0 +1,237 @@
+/**
+ * @file boot_main.c
+ * @brief Bootloader: picks the image slot to start and jumps to it.
+ *
+ * Runs from sector 0 (STM32F446RETX_BOOT.ld) on the reset clock (HSI,
+ * 16 MHz, no flash wait states), register-level and without the HAL, the
+ * C library or initialized data: it reads the slot headers, checks the
+ * image it chose against its CRC with the CRC unit, programs the header
+ * marks of fw_update.h and hands the core to the image with its vector
+ * table, stack pointer and reset handler. The image's SystemInit() leaves
+ * VTOR as set here.
+ *
+ * Choice, in this order:
+ *  - an image with the trial mark but no confirmation did not stay up:
+ *    it is rejected
+ *  - of the valid, not rejected images, the one with the highest sequence
+ *    number (wrapping compare, like FwUpdate_Init()) whose CRC matches;
+ *    one that does not match is rejected
+ *  - slot A without a header (an image flashed with the ST-LINK), if its
+ *    first vector is a plausible stack pointer
+ *
+ * The chosen image gets its trial mark before the jump unless it already
+ * has one. With nothing to start, the core waits in a low-power loop.
+ *
+ * @ingroup boot
+ */
+
+#include "fw_update.h"
+#include "stm32f4xx.h"
+#include <stddef.h>
+
+/** @brief Bits of a plausible initial stack pointer (SRAM, 128 KB). */
+#define BOOT_SP_MASK    (0xFFFE0000U)
+#define BOOT_SP_SRAM    (0x20000000U)
+
+/** @brief FLASH_KEYR unlock sequence. */
+#define BOOT_FLASH_KEY1 (0x45670123U)
+#define BOOT_FLASH_KEY2 (0xCDEF89ABU)
+
+/** @brief End of the bootloader stack (top of SRAM). */
+extern uint32_t _estack;
+
+/**
+ * @brief Reset handler: choose an image and start it.
+ */
+void Boot_Reset(void);
+
+/**
+ * @brief Default handler: park the core.
+ */
+static void Boot_Fault(void);
+
+/**
+ * @brief Program one header word to @ref FW_UPDATE_MARK (if still erased).
+ */
+static void Boot_Mark(const volatile uint32_t *word);
+
+/**
+ * @brief CRC-32/MPEG-2 of the @p size image bytes of a slot (CRC unit).
+ */
+static uint32_t Boot_ImageCrc(FwUpdateSlot_t slot, uint32_t size);
+
+/**
+ * @brief Whether a slot's first vectors are a stack pointer and a reset
+ *        handler inside the slot.
+ */
+static bool Boot_VectorsPlausible(FwUpdateSlot_t slot);
+
+/**
+ * @brief Start the image of a slot.
+ */
+static void Boot_Jump(FwUpdateSlot_t slot) __attribute__((noreturn));
+
+/** @brief Core vectors only: the bootloader enables no interrupt. */
+__attribute__((section(".isr_vector"), used))
+static const uintptr_t s_vectors[16] = {
+    (uintptr_t)&_estack,     /* Initial stack pointer */
+    (uintptr_t)Boot_Reset,   /* Reset                 */
+    (uintptr_t)Boot_Fault,   /* NMI                   */
+    (uintptr_t)Boot_Fault,   /* Hard fault            */
+    (uintptr_t)Boot_Fault,   /* Memory management     */
+    (uintptr_t)Boot_Fault,   /* Bus fault             */
+    (uintptr_t)Boot_Fault,   /* Usage fault           */
+    0U, 0U, 0U, 0U,          /* Reserved              */
+    (uintptr_t)Boot_Fault,   /* SVCall                */
+    (uintptr_t)Boot_Fault,   /* Debug monitor         */
+    0U,                      /* Reserved              */
+    (uintptr_t)Boot_Fault,   /* PendSV                */
+    (uintptr_t)Boot_Fault,   /* SysTick               */
+};
+
+/* ------------------------------------------------------------------------- */
+
+void Boot_Reset(void)
+{
+    for (;;)
+    {
+        bool found = false;
+        FwUpdateSlot_t best = FW_UPDATE_SLOT_A;
+        uint32_t bestSeq = 0U;
+
+        for (uint32_t i = 0U; i < FW_UPDATE_SLOT_COUNT; ++i)
+        {
+            FwUpdateSlot_t slot = (FwUpdateSlot_t)i;
+            const FwUpdateHeader_t *header = FwUpdate_Header(slot);
+
+            if (!FwUpdate_HeaderValid(header))
+            {
+                continue;
+            }
+
+            /* Started before and never confirmed: it did not stay up. */
+            if ((header->trial == FW_UPDATE_MARK) && (header->confirmed == FW_UPDATE_ERASED))
+            {
+                Boot_Mark(&header->rejected);
+                continue;
+            }
+
+            if (!found || ((int32_t)(header->seq - bestSeq) > 0))
+            {
+                best    = slot;
+                bestSeq = header->seq;
+                found   = true;
+            }
+        }
+
+        if (!found)
+        {
+            break;
+        }
+
+        const FwUpdateHeader_t *header = FwUpdate_Header(best);
+
+        if (!Boot_VectorsPlausible(best) || (Boot_ImageCrc(best, header->size) != header->crc))
+        {
+            /* Choose again without it. */
+            Boot_Mark(&header->rejected);
+            continue;
+        }
+
+        if (header->trial == FW_UPDATE_ERASED)
+        {
+            Boot_Mark(&header->trial);
+        }
+
+        Boot_Jump(best);
+    }
+
+    /* No header anywhere usable: an image flashed into slot A directly. */
+    if ((FwUpdate_Header(FW_UPDATE_SLOT_A)->magic == FW_UPDATE_ERASED) &&
+        Boot_VectorsPlausible(FW_UPDATE_SLOT_A))
+    {
+        Boot_Jump(FW_UPDATE_SLOT_A);
+    }
+
+    Boot_Fault();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void Boot_Fault(void)
+{
+    for (;;)
+    {
+        __WFI();
+    }
+}
+
+static void Boot_Mark(const volatile uint32_t *word)
+{
+    if (*word != FW_UPDATE_ERASED)
+    {
+        return;
+    }
+
+    while ((FLASH->SR & FLASH_SR_BSY) != 0U)
+    {
+    }
+
+    FLASH->KEYR = BOOT_FLASH_KEY1;
+    FLASH->KEYR = BOOT_FLASH_KEY2;
+    FLASH->SR   = FLASH_SR_PGSERR | FLASH_SR_PGPERR | FLASH_SR_PGAERR | FLASH_SR_WRPERR;
+    FLASH->CR   = FLASH_CR_PSIZE_1 | FLASH_CR_PG;
+
+    *(volatile uint32_t *)(uintptr_t)word = FW_UPDATE_MARK;
+    __DSB();
+
+    while ((FLASH->SR & FLASH_SR_BSY) != 0U)
+    {
+    }
+
+    FLASH->CR = FLASH_CR_LOCK;
+}
+
+static uint32_t Boot_ImageCrc(FwUpdateSlot_t slot, uint32_t size)
+{
+    const uint32_t *image = (const uint32_t *)(uintptr_t)(FwUpdate_SlotBase(slot) + FW_UPDATE_HEADER_SIZE);
+
+    RCC->AHB1ENR |= RCC_AHB1ENR_CRCEN;
+    (void)RCC->AHB1ENR;
+    CRC->CR = CRC_CR_RESET;
+
+    /* Same byte order as Crc32Hw_Compute(): the first byte on top. */
+    for (uint32_t i = 0U; i < (size / 4U); ++i)
+    {
+        CRC->DR = __REV(image[i]);
+    }
+
+    uint32_t crc = CRC->DR;
+    RCC->AHB1ENR &= ~RCC_AHB1ENR_CRCEN;
+    return crc;
+}
+
+static bool Boot_VectorsPlausible(FwUpdateSlot_t slot)
+{
+    const uint32_t *vectors = (const uint32_t *)(uintptr_t)(FwUpdate_SlotBase(slot) + FW_UPDATE_HEADER_SIZE);
+    uint32_t end = FwUpdate_SlotBase(slot) + FW_UPDATE_SLOT_SIZE;
+
+    return ((vectors[0] & BOOT_SP_MASK) == BOOT_SP_SRAM) &&
+           (vectors[1] > (uint32_t)(uintptr_t)vectors) && (vectors[1] < end);
+}
+
+static void Boot_Jump(FwUpdateSlot_t slot)
+{
+    const uint32_t *vectors = (const uint32_t *)(uintptr_t)(FwUpdate_SlotBase(slot) + FW_UPDATE_HEADER_SIZE);
+
+    SCB->VTOR = (uint32_t)(uintptr_t)vectors;
+    __DSB();
+    __set_MSP(vectors[0]);
+    ((void (*)(void))(uintptr_t)vectors[1])();
+
+    for (;;)
+    {
+    }
+}
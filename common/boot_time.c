@@ -0,0 +1,122 @@
+/**
+ * @file boot_time.c
+ * @brief Boot-phase timestamps.
+ *
+ * Every mark converts the cycles since the previous mark at the clock
+ * that is running now and adds them to a running total, so no phase is
+ * converted with a clock it did not run at. CYCCNT wraps after 268 s at
+ * 16 MHz, far beyond the last mark.
+ *
+ * @ingroup boot_time
+ */
+
+#include "boot_time.h"
+#include "cycle_counter.h"
+#include "crash_log.h"
+#include "metrics.h"
+#include "cli.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Reset causes that make a boot a resume. */
+#define BOOT_TIME_RESUME_FLAGS  (RCC_CSR_SFTRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF | \
+                                 RCC_CSR_LPWRRSTF)
+
+/** @brief Microseconds from main() to the end of each phase, 0 = not yet. */
+static uint32_t s_phaseUs[BOOT_PHASE_COUNT];
+
+/** @brief Cycle counter at the latest mark. */
+static uint32_t s_lastCycles = 0U;
+
+/** @brief Microseconds from main() to the latest mark. */
+static uint32_t s_lastUs = 0U;
+
+/** @brief 1 if this boot is a resume (a metric, hence not a bool). */
+static uint32_t s_resume = 0U;
+
+/** @brief Phase names, in BootPhase_t order. */
+static const char *const s_phaseNames[BOOT_PHASE_COUNT] =
+{
+#define BOOT_PHASE_NAME(id, name)   name,
+    BOOT_PHASE_LIST(BOOT_PHASE_NAME)
+#undef BOOT_PHASE_NAME
+};
+
+/* ------------------------------------------------------------------------- */
+
+void BootTime_Start(void)
+{
+    CycleCounter_Init();
+    DWT->CYCCNT = 0U;
+
+    s_lastCycles = 0U;
+    s_lastUs     = 0U;
+    for (uint32_t i = 0U; i < (uint32_t)BOOT_PHASE_COUNT; ++i)
+    {
+        s_phaseUs[i] = 0U;
+    }
+
+    Metrics_Publish(METRIC_BOOT_FIRST_SAMPLE_US, &s_phaseUs[BOOT_PHASE_FIRST_SAMPLE]);
+    Metrics_Publish(METRIC_BOOT_READY_US, &s_phaseUs[BOOT_PHASE_READY]);
+    Metrics_Publish(METRIC_BOOT_RESUME, &s_resume);
+}
+
+void BootTime_Mark(BootPhase_t phase)
+{
+    if (((uint32_t)phase >= (uint32_t)BOOT_PHASE_COUNT) || (s_phaseUs[phase] != 0U))
+    {
+        return;
+    }
+
+    uint32_t now = CycleCounter_Now();
+
+    s_lastUs     += CycleCounter_ToUs(now - s_lastCycles);
+    s_lastCycles  = now;
+
+    /* 0 means "not marked"; a phase that took no measurable time shows 1 us. */
+    s_phaseUs[phase] = (s_lastUs != 0U) ? s_lastUs : 1U;
+}
+
+bool BootTime_DetectResume(void)
+{
+    bool resume = ((CrashLog_GetResetFlags() & BOOT_TIME_RESUME_FLAGS) != 0U);
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    if ((PWR->CSR & PWR_CSR_SBF) != 0U)
+    {
+        resume   = true;
+        PWR->CR |= PWR_CR_CSBF;
+    }
+
+    s_resume = resume ? 1U : 0U;
+    return resume;
+}
+
+bool BootTime_IsResume(void)
+{
+    return (s_resume != 0U);
+}
+
+uint32_t BootTime_GetUs(BootPhase_t phase)
+{
+    return ((uint32_t)phase < (uint32_t)BOOT_PHASE_COUNT) ? s_phaseUs[phase] : 0U;
+}
+
+void BootTime_Print(void)
+{
+    uint32_t previous = 0U;
+
+    CLI_Print("\r\nBoot (%s), times since main():\r\n", (s_resume != 0U) ? "resume" : "cold");
+
+    for (uint32_t i = 0U; i < (uint32_t)BOOT_PHASE_COUNT; ++i)
+    {
+        if (s_phaseUs[i] == 0U)
+        {
+            CLI_Print("  %-18s pending\r\n", s_phaseNames[i]);
+            continue;
+        }
+
+        CLI_Print("  %-18s %8lu us  (+%lu us)\r\n", s_phaseNames[i],
+                  (unsigned long)s_phaseUs[i], (unsigned long)(s_phaseUs[i] - previous));
+        previous = s_phaseUs[i];
+    }
+}
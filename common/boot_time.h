@@ -0,0 +1,126 @@
+/**
+ * @file boot_time.h
+ * @brief Boot-phase timestamps and the cold boot / resume decision.
+ *
+ * main() zeroes the DWT cycle counter on entry and marks the end of each
+ * boot phase; the time of a phase is converted with the core clock that
+ * ran it, so a clock change during boot does not skew earlier phases.
+ * Times count from main(): the reset handler (data/bss init) runs before
+ * the counter is started. The first sample, the end of the deferred
+ * initialization and the end of sensor discovery are marked by the
+ * application. `boot` prints the
+ * phases; the first-sample and ready times are also metrics.
+ *
+ * A boot is a resume when the reset was not caused by power-up, brown-out
+ * or the reset pin alone: a software or watchdog reset, or a wakeup from
+ * STANDBY. The application then skips what only a person at the console
+ * needs (banner, startup lines).
+ *
+ * @ingroup common
+ */
+
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup boot_time Boot Time
+ * @brief Boot-phase timestamps.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Boot phases, in boot order: X(id, name).
+ *
+ * Each is marked when the phase ends.
+ */
+#define BOOT_PHASE_LIST(X)                  \
+    X(HAL,          "HAL init")             \
+    X(CLOCK,        "clock config")         \
+    X(PERIPH,       "GPIO/DMA/UART")        \
+    X(CONSOLE,      "console")              \
+    X(APP,          "application init")     \
+    X(FIRST_SAMPLE, "first sample")         \
+    X(READY,        "deferred init")        \
+    X(DISCOVERY,    "sensor discovery")
+
+/**
+ * @brief Boot phase identifiers.
+ */
+typedef enum
+{
+#define BOOT_PHASE_ENUM(id, name)   BOOT_PHASE_##id,
+    BOOT_PHASE_LIST(BOOT_PHASE_ENUM)
+#undef BOOT_PHASE_ENUM
+    BOOT_PHASE_COUNT
+} BootPhase_t;
+
+/**
+ * @brief Start timing the boot: zero and enable the cycle counter.
+ *
+ * First statement of main(); touches only the DWT and the metrics
+ * registry.
+ *
+ * @return None.
+ */
+void BootTime_Start(void);
+
+/**
+ * @brief Mark the end of a boot phase.
+ *
+ * Only the first mark of each phase counts, so callers on a hot path
+ * (the sample hook) need no flag of their own.
+ *
+ * @param phase Phase that just ended.
+ *
+ * @return None.
+ */
+void BootTime_Mark(BootPhase_t phase);
+
+/**
+ * @brief Decide whether this boot is a resume.
+ *
+ * Call after CrashLog_Init(), which owns the RCC reset flags. Also clears
+ * the PWR standby flag.
+ *
+ * @return true for a resume, false for a cold boot.
+ */
+bool BootTime_DetectResume(void);
+
+/**
+ * @brief Result of BootTime_DetectResume().
+ *
+ * @return true if this boot is a resume.
+ */
+bool BootTime_IsResume(void);
+
+/**
+ * @brief Time from main() to the end of a phase.
+ *
+ * @param phase Phase.
+ *
+ * @return Microseconds, or 0 if the phase has not ended yet.
+ */
+uint32_t BootTime_GetUs(BootPhase_t phase);
+
+/**
+ * @brief Print the phases via the CLI (`boot`).
+ *
+ * @return None.
+ */
+void BootTime_Print(void);
+
+/** @} */ /* end of boot_time group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_TIME_H */
@@ -11,12 +11,37 @@
 
 #include "cli.h"
 #include "log.h"
+#include "uart_tx.h"
+#include "telemetry_uart.h"
+#include "usb_cdc.h"
 #include "power_manager.h"
+#include "clock_profile.h"
+#include "sensor_registry.h"
+#include "sensor_farm.h"
+#include "sensor_replay.h"
+#include "sensor_calib.h"
+#include "sensor_filter.h"
+#include "sensor_deadband.h"
+#include "sensor_stats.h"
+#include "sensor_spectrum.h"
+#include "sensor_alarm.h"
+#include "telemetry.h"
+#include "flash_log.h"
+#include "mem_pool.h"
+#include "mem_map.h"
+#include "crash_log.h"
+#include "boot_time.h"
+#include "time_base.h"
+#include "cycle_counter.h"
+#include "fmt.h"
+#include "metrics.h"
+#include "hil_probe.h"
+#include "app_task_manager.h"
 #include "app_config.h"
 
 #include <string.h>
 #include <stdarg.h>
-#include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
 
 /**
@@ -25,10 +50,115 @@
 #define CLI_MAX_LINE_LENGTH   (64U)
 
 /**
- * @brief UART handle used by the CLI.
+ * @brief Command lines kept for recall with the up and down arrows.
+ */
+#define CLI_HISTORY_DEPTH     (8U)
+
+/**
+ * @brief Echo bytes collected before they go to the TX ring in one write.
+ */
+#define CLI_ECHO_SIZE         (64U)
+
+/**
+ * @brief Input gap (ms) after which a script run by `batch` is closed.
+ *
+ * Checked when the next byte arrives, so a host that went away leaves
+ * the console to whoever types next.
+ */
+#define CLI_BATCH_TIMEOUT_MS  (2000U)
+
+/**
+ * @brief Size of the circular DMA receive buffer (bytes).
+ *
+ * The DMA half-transfer, transfer-complete and IDLE-line events each move
+ * at most half of this buffer into the software ring, so the interrupt
+ * only has to run once every 32 byte times (~2.8 ms at 115200 baud).
+ */
+#define CLI_RX_DMA_SIZE       (64U)
+
+/**
+ * @brief Size of the software receive ring (bytes, power of two).
+ *
+ * Holds a large paste until the CLI task gets to run.
+ */
+#define CLI_RX_RING_SIZE      (512U)
+
+/**
+ * @brief Free TX space (bytes) a command line waits for before it runs.
+ *
+ * Room for the longest regular response (`power`, `tasks`); the line
+ * stays in the RX ring until the stream reports the room
+ * (Stream_NotifyWritable()). Other writers leave at least
+ * @ref UART_TX_RESERVE_CLI_BUSY while a line waits, so it is reached even
+ * under a log flood.
+ */
+#define CLI_TX_SPACE          (1536U)
+
+#if (CLI_TX_SPACE > UART_TX_RESERVE_CLI_BUSY)
+#error "CLI_TX_SPACE must not exceed UART_TX_RESERVE_CLI_BUSY"
+#endif
+
+/**
+ * @brief UART handle the CLI receives from.
  */
 static UART_HandleTypeDef *s_cliUart = NULL;
 
+/**
+ * @brief Stream the CLI writes to (NULL: output is discarded).
+ */
+static const Stream_t *s_out = NULL;
+
+/**
+ * @brief Circular DMA target for USART2 RX.
+ */
+static uint8_t s_rxDmaBuffer[CLI_RX_DMA_SIZE];
+
+/**
+ * @brief Position in @ref s_rxDmaBuffer up to which data was consumed.
+ */
+static uint32_t s_rxDmaReadPos = 0U;
+
+/**
+ * @brief Software ring filled from the RX event interrupt.
+ */
+static uint8_t s_rxRing[CLI_RX_RING_SIZE];
+
+/** @brief Free-running ring write index (interrupt side). */
+static volatile uint32_t s_rxHead = 0U;
+
+/** @brief Free-running ring read index (task side). */
+static volatile uint32_t s_rxTail = 0U;
+
+/** @brief Bytes lost because the software ring was full. */
+static volatile uint32_t s_rxOverflows = 0U;
+
+/** @brief Receive errors counted by HAL_UART_ErrorCallback(). */
+static CLI_UartErrors_t s_uartErrors;
+
+/** @brief Set by CLI_OnUartWake() until the next receive event. */
+static volatile bool s_wakeCheck = false;
+
+/** @brief DMA write position when the MCU woke on UART RX. */
+static uint32_t s_wakeRxPos = 0U;
+
+/** @brief Time (Time_NowUs32()) the clocks were back after the wake. */
+static uint32_t s_wake_us = 0U;
+
+/** @brief Duration of one character (10 bits) at the CLI baud rate (us). */
+static uint32_t s_charTime_us = 0U;
+
+/** @brief Garbled wake characters dropped. */
+static volatile uint32_t s_wakeDrops = 0U;
+
+/** @brief Called from the RX interrupt after new bytes were queued. */
+static volatile CLI_RxHook_t s_rxHook = NULL;
+
+/** @brief Consumer of raw input, or NULL for the line editor. */
+static CLI_InputHandler_t s_inputHandler = NULL;
+
+/** @brief Other output overwrote the prompt since it was last drawn. */
+static volatile bool s_promptDirty = false;
+
 /**
  * @brief Line buffer for accumulating user input.
  */
@@ -39,6 +169,93 @@ static char s_lineBuffer[CLI_MAX_LINE_LENGTH];
  */
 static uint32_t s_lineIndex = 0U;
 
+/**
+ * @brief Cursor position in the line (0 to @ref s_lineIndex).
+ */
+static uint32_t s_lineCursor = 0U;
+
+/**
+ * @brief State of the VT100 key sequence parser.
+ */
+typedef enum
+{
+    CLI_ESC_NONE = 0U, /**< Plain input.                       */
+    CLI_ESC_START,     /**< ESC received.                      */
+    CLI_ESC_CSI,       /**< ESC [ received, digits may follow. */
+    CLI_ESC_SS3        /**< ESC O received.                    */
+} CLI_EscState_t;
+
+/** @brief Key sequence parser state and its numeric parameter. */
+static CLI_EscState_t s_escState = CLI_ESC_NONE;
+static uint32_t       s_escParam = 0U;
+
+/**
+ * @brief Recent command lines, a ring of NUL-terminated entries.
+ */
+static char s_history[CLI_HISTORY_DEPTH][CLI_MAX_LINE_LENGTH];
+
+/** @brief Entries stored, and the slot the next one goes to. */
+static uint32_t s_historyCount = 0U;
+static uint32_t s_historyNext  = 0U;
+
+/** @brief Entry shown: 0 for the line being typed, n for the n-th newest. */
+static uint32_t s_historyBrowse = 0U;
+
+/** @brief The line being typed, kept while browsing the history. */
+static char     s_historyDraft[CLI_MAX_LINE_LENGTH];
+static uint32_t s_historyDraftLength = 0U;
+
+/**
+ * @brief Echo and editing output of the current CLI_Process() pass.
+ */
+static char     s_echo[CLI_ECHO_SIZE];
+static uint32_t s_echoLength = 0U;
+
+/**
+ * @brief Output still to come (CLI_Continue()), or NULL.
+ *
+ * While set, input stays in the RX ring and the prompt waits.
+ */
+static CLI_MoreFn_t s_more = NULL;
+
+/** @brief The prompt is due once @ref s_more is done. */
+static bool s_morePrompt = false;
+
+/**
+ * @brief Position of a `help` listing in progress.
+ *
+ * Kept by name, not table index: CLI_RegisterCommand() may insert
+ * commands while the listing waits for the TX ring.
+ */
+typedef struct
+{
+    const char *last; /**< Command being or last listed, NULL before the first. */
+    const char *text; /**< Its next help line, NULL once it is complete.        */
+} CLI_HelpCursor_t;
+
+static CLI_HelpCursor_t s_help;
+
+/**
+ * @brief State of a script run by `batch`.
+ */
+typedef struct
+{
+    bool     active;     /**< Lines are executed as a script.              */
+    bool     quiet;      /**< A script command runs: its output is dropped. */
+    bool     lineFailed; /**< The current command reported an error.        */
+    bool     overlong;   /**< The current line did not fit the buffer.      */
+    bool     lastCr;     /**< The previous byte ended a line with CR.       */
+    uint32_t line;       /**< Script line number of the current line.       */
+    uint32_t commands;   /**< Commands executed.                           */
+    uint32_t failed;     /**< Commands that reported an error.             */
+    uint32_t overflows;  /**< RX ring overflow count at the start.          */
+    uint32_t start_us;   /**< Time_NowUs32() at the start.                   */
+    uint32_t last_us;    /**< Time_NowUs32() after the last command.         */
+    uint32_t input_ms;   /**< HAL tick of the last received byte.           */
+} CLI_Batch_t;
+
+static CLI_Batch_t s_batch;
+
 /**
  * @brief Track whether task logging is currently paused via CLI.
  */
@@ -60,7 +277,7 @@ static LogLevel_t s_prevLogLevel   = LOG_LEVEL_INFO;
 static void CLI_HandleLine(char *line);
 
 /**
- * @brief Send a null-terminated string over the CLI UART.
+ * @brief Queue a null-terminated string on the shared UART TX ring.
  *
  * @param str Pointer to a null-terminated string.
  */
@@ -75,352 +292,2794 @@ static void CLI_SendString(const char *str);
 static void CLI_PrintPrompt(void);
 
 /**
- * @brief Convert a string to lower case in-place.
+ * @brief Redraw the prompt and the partial command after other output.
+ */
+static void CLI_RedrawPrompt(void);
+
+/**
+ * @brief Start (or restart) circular DMA reception with IDLE detection.
+ */
+static void CLI_StartReception(void);
+
+/**
+ * @brief Drop the remainder of the character that woke the MCU, if the
+ *        first byte received since the wake can only be that.
+ *
+ * Called from the first receive event after CLI_OnUartWake(). The bytes
+ * arrived back to back before the event (plus one idle character for an
+ * IDLE-line event), which dates the first one. The garbled byte ends
+ * within one character time of the wake; a character sent after the wake
+ * character ends at least two character times after the wake edge.
+ *
+ * @param writePos Current DMA write position.
+ * @param idle     The event is an IDLE-line event.
+ */
+static void CLI_DropWakeByte(uint32_t writePos, bool idle);
+
+/**
+ * @brief Process one received character (echo, editing, dispatch).
+ *
+ * @param ch Received byte.
+ */
+static void CLI_HandleChar(uint8_t ch);
+
+/**
+ * @brief Whether the TX stream has room for a response.
+ *
+ * If not, asks the stream to call CLI_OnTxSpace() once it has.
+ *
+ * @return true if the next line may run (also when the stream cannot
+ *         notify, so input is never stuck).
+ */
+static bool CLI_HasTxSpace(void);
+
+/**
+ * @brief The TX stream has room again: schedule CLI_Process() (any context).
+ */
+static void CLI_OnTxSpace(void);
+
+/**
+ * @brief Run @ref s_more as far as the TX stream has room.
+ *
+ * @return true if the output is complete (the prompt is then printed if
+ *         it was held back).
+ */
+static bool CLI_RunMore(void);
+
+/**
+ * @brief Write the `help` lines from @ref s_help on (a CLI_MoreFn_t).
+ */
+static bool CLI_HelpMore(void);
+
+/**
+ * @brief Make received bytes up to @p head visible and notify the hook.
+ */
+static void CLI_PublishRx(uint32_t head);
+
+/**
+ * @brief Handle the final byte of a VT100 key sequence.
+ *
+ * @param final Final byte ('A' to 'D', 'H', 'F' or '~').
+ * @param param Numeric parameter of a CSI sequence (0 if none).
+ */
+static void CLI_HandleKey(uint8_t final, uint32_t param);
+
+/**
+ * @brief Insert a printable character at the cursor.
+ */
+static void CLI_InsertChar(char ch);
+
+/**
+ * @brief Remove the character before (@p before) or under the cursor.
+ */
+static void CLI_DeleteChar(bool before);
+
+/**
+ * @brief Move the cursor to @p position within the line.
+ */
+static void CLI_MoveCursor(uint32_t position);
+
+/**
+ * @brief Show an older (@p older) or newer history entry in the line.
+ */
+static void CLI_HistoryRecall(bool older);
+
+/**
+ * @brief Store a line as the newest history entry (unless it repeats it).
+ */
+static void CLI_HistoryAdd(const char *line, uint32_t length);
+
+/**
+ * @brief Replace the line being edited, redrawing only what differs.
+ */
+static void CLI_ReplaceLine(const char *line, uint32_t length);
+
+/**
+ * @brief Process one byte of a script run by `batch` (no echo or editing).
+ */
+static void CLI_BatchChar(uint8_t ch);
+
+/**
+ * @brief Execute one script line, or end the script at `end`.
+ */
+static void CLI_BatchLine(char *line);
+
+/**
+ * @brief End the script and send its summary line.
+ *
+ * @param kind "done", "abort" or "timeout".
+ */
+static void CLI_BatchEnd(const char *kind);
+
+/**
+ * @brief Format output and queue it; CLI_Print() and CLI_PrintError().
+ *
+ * @param error The output reports a failed command.
+ */
+static void CLI_VPrint(bool error, const char *fmt, va_list args);
+
+/**
+ * @brief Collect echo output; it reaches the TX ring at CLI_EchoFlush().
+ */
+static void CLI_Echo(const char *data, uint32_t length);
+
+/**
+ * @brief Collect a cursor motion of @p delta columns (left if negative).
+ */
+static void CLI_EchoMove(int32_t delta);
+
+/**
+ * @brief Queue the collected echo output on the TX ring in one write.
+ */
+static void CLI_EchoFlush(void);
+
+/**
+ * @brief Split a line into lower-cased, whitespace-separated tokens in-place.
+ *
+ * @param line    Modifiable null-terminated input line.
+ * @param argv    Receives pointers to the tokens.
+ * @param maxArgs Capacity of @p argv.
+ *
+ * @return Number of tokens, or maxArgs + 1 if there were more.
+ */
+static inline uint32_t CLI_Tokenize(char *line, char *argv[], uint32_t maxArgs);
+
+/**
+ * @brief Binary search of the command table.
+ *
+ * @param name       Command name.
+ * @param[out] found Set to whether @p name is registered.
+ *
+ * @return Index of the command, or the index where it would be inserted.
+ */
+static int32_t CLI_FindCommand(const char *name, bool *found);
+
+/**
+ * @brief "log mode" subcommand: per-power-mode level and deferral.
+ */
+static void CLI_LogMode(uint32_t argc, char *argv[]);
+
+/**
+ * @brief `status` line with each task's share of the last load window.
+ *
+ * @param load_pm Load of the window (permille); what the tasks do not
+ *                account for is shown as "other".
+ */
+static void CLI_PrintTaskShares(uint32_t load_pm);
+
+/**
+ * @brief Parse a whole argument as a float.
+ *
+ * @param arg        Argument.
+ * @param[out] value Receives the value.
+ *
+ * @return false if @p arg is not a number.
+ */
+static bool CLI_ParseFloat(const char *arg, float *value);
+
+/**
+ * @brief Parse a whole argument as the id of a registered sensor.
+ *
+ * @param arg     Argument.
+ * @param[out] id Receives the id.
+ *
+ * @return false if @p arg is not a number or no sensor has that id.
+ */
+static bool CLI_ParseSensorId(const char *arg, uint8_t *id);
+
+/**
+ * @brief "calib" subcommands of one sensor.
+ *
+ * @return false on a usage error.
+ */
+static bool CLI_CalibSensor(uint8_t sensorId, uint32_t argc, char *argv[]);
+
+/* Built-in command handlers (see s_builtinCommands). */
+static void CLI_CmdHelp(uint32_t argc, char *argv[]);
+static void CLI_CmdLog(uint32_t argc, char *argv[]);
+static void CLI_CmdPmode(uint32_t argc, char *argv[]);
+static void CLI_CmdStatus(uint32_t argc, char *argv[]);
+static void CLI_CmdBaud(uint32_t argc, char *argv[]);
+static void CLI_CmdSensors(uint32_t argc, char *argv[]);
+static void CLI_CmdFarm(uint32_t argc, char *argv[]);
+static void CLI_CmdReplay(uint32_t argc, char *argv[]);
+static void CLI_CmdCalib(uint32_t argc, char *argv[]);
+static void CLI_CmdFilter(uint32_t argc, char *argv[]);
+static void CLI_CmdDeadband(uint32_t argc, char *argv[]);
+static void CLI_CmdStats(uint32_t argc, char *argv[]);
+static void CLI_CmdSpectrum(uint32_t argc, char *argv[]);
+static void CLI_CmdAlarm(uint32_t argc, char *argv[]);
+static void CLI_CmdTelem(uint32_t argc, char *argv[]);
+static void CLI_CmdFlashLog(uint32_t argc, char *argv[]);
+static void CLI_CmdDump(uint32_t argc, char *argv[]);
+static void CLI_CmdPools(uint32_t argc, char *argv[]);
+static void CLI_CmdMem(uint32_t argc, char *argv[]);
+static void CLI_CmdCrash(uint32_t argc, char *argv[]);
+static void CLI_CmdBoot(uint32_t argc, char *argv[]);
+static void CLI_CmdBatch(uint32_t argc, char *argv[]);
+
+/**
+ * @brief Commands owned by the CLI module, registered by CLI_Init().
+ */
+static const CLI_Command_t s_builtinCommands[] =
+{
+    { "help",     CLI_CmdHelp,     "- Show this help text" },
+    { "log",      CLI_CmdLog,      "off|error|warn|info|debug - Set task log level\n"
+                                   "pause|resume - Pause / restore task logging\n"
+                                   "limit on|off - Per-call-site rate limit\n"
+                                   "mode [<pmode> <level>|default|defer|live] - Per-mode logging\n"
+                                   "budget [<bytes/s>] - Log output budget (0 = off)" },
+    { "pmode",    CLI_CmdPmode,    "active|idle|sleep|stop|auto - Request a power mode" },
+    { "status",   CLI_CmdStatus,   "- Show logging and power status" },
+    { "baud",     CLI_CmdBaud,     "[<rate> [8|16]] - Console baud rate, oversampling, RX errors" },
+    { "sensors",  CLI_CmdSensors,  "- List registered sensors" },
+    { "farm",     CLI_CmdFarm,     "[<n>] - Show / run n synthetic sensors (0 = off)\n"
+                                   "fail <pm> | spike <pm> <us> - Inject farm faults" },
+    { "replay",   CLI_CmdReplay,   "[flash|file|link [fast] | stop] - Replay recorded samples\n"
+                                   "push <id> <ms> <v> [<id> <ms> <v>] | end - Link samples" },
+    { "calib",    CLI_CmdCalib,    "[<id> poly <c0> <c1> [c2] [c3] | span <lo> <hi> | chan <n>] - Calibration\n"
+                                   "<id> point <true>|clear | fit [<degree>] | off - Reference points" },
+    { "filter",   CLI_CmdFilter,   "[<id> median|avg <n> | iir <a> | off] - Sensor filters" },
+    { "deadband", CLI_CmdDeadband, "[<id> <delta> [silence_ms] | <id> off] - Report by exception" },
+    { "stats",    CLI_CmdStats,    "[<id> <window_s> [p<n>] | <id> off] - Windowed summaries" },
+    { "spectrum", CLI_CmdSpectrum, "[<id> <points> [<bands>] | <id> off] - RMS, peak and band energies" },
+    { "alarm",    CLI_CmdAlarm,    "[<id> high|low|rate <thr> [hyst] [wake] | del <n>] - Alarm rules" },
+    { "telem",    CLI_CmdTelem,    "[on|off|f32|i16|delta|xor|raw] - Binary telemetry\n"
+                                   "baud <rate> - Telemetry UART baud rate" },
+    { "flashlog", CLI_CmdFlashLog, "[on|off|flush|erase] - Flash sample log" },
+    { "dump",     CLI_CmdDump,     "- Stream the flash log as telemetry" },
+    { "pools",    CLI_CmdPools,    "- Show memory pool usage" },
+    { "mem",      CLI_CmdMem,      "- Show RAM usage and stack high-water mark" },
+    { "crash",    CLI_CmdCrash,    "[all|clear] - Show / discard the trace kept across reset" },
+    { "boot",     CLI_CmdBoot,     "- Show boot phase times" },
+    { "batch",    CLI_CmdBatch,    "- Run the lines that follow, up to 'end', as a script" },
+};
+
+/**
+ * @brief One counter line of the `status` output.
  *
- * @param str Pointer to a modifiable null-terminated string.
+ * @c fmt takes one unsigned long per entry of @c ids; trailing unused ids
+ * are passed too and ignored by the format.
+ */
+typedef struct
+{
+    const char *fmt;    /**< Line format.                */
+    uint8_t     ids[4]; /**< MetricId_t of the arguments. */
+} CLI_StatusLine_t;
+
+/**
+ * @brief Counter lines of `status`, all rendered from one metrics snapshot.
+ */
+static const CLI_StatusLine_t s_statusLines[] =
+{
+    { "  Sensor sample period: %lu ms\r\n",
+      { METRIC_SAMPLE_PERIOD_MS } },
+    { "  Log lines dropped: %lu, held back: %lu\r\n",
+      { METRIC_LOG_DROPPED, METRIC_LOG_HELD } },
+    { "  UART TX dropped: cli %lu, telemetry %lu, log %lu bytes\r\n",
+      { METRIC_UART_DROP_CLI, METRIC_UART_DROP_TELEM, METRIC_UART_DROP_LOG } },
+    { "  Telemetry: %lu frames, %lu bytes, %lu dropped\r\n",
+      { METRIC_TELEM_FRAMES, METRIC_TELEM_BYTES, METRIC_TELEM_DROPPED } },
+    { "  Sample ring: %lu/%lu queued, high-water %lu, overruns %lu\r\n",
+      { METRIC_RING_COUNT, METRIC_RING_CAPACITY, METRIC_RING_HIGH_WATER,
+        METRIC_RING_OVERRUNS } },
+    { "  Idle entries: %lu (tickless %lu, early wake %lu)\r\n",
+      { METRIC_IDLE_ENTRIES, METRIC_TICKLESS_ENTRIES, METRIC_EARLY_WAKEUPS } },
+    { "  Time asleep: %lu ms of %lu ms\r\n",
+      { METRIC_SLEEP_MS, METRIC_UPTIME_MS } },
+    { "  STOP entries: %lu, time in STOP: %lu ms\r\n",
+      { METRIC_STOP_ENTRIES, METRIC_STOP_MS } },
+    { "  Wake latency: last %lu us, max %lu us (source 0x%02lx)\r\n",
+      { METRIC_WAKE_LATENCY_US, METRIC_WAKE_LATENCY_MAX_US, METRIC_WAKE_SOURCE } },
+    { "  UART wakes: %lu (wake bytes dropped %lu), STOP held off %lu ms\r\n",
+      { METRIC_UART_WAKES, METRIC_WAKE_DROPS, METRIC_CONSOLE_HOLD_MS } },
+    { "  Watchdog: timeout %lu ms (0: off), refresh withheld %lu times\r\n",
+      { METRIC_WDG_TIMEOUT_MS, METRIC_WDG_WITHHELD } },
+    { "  Boot: first sample %lu us, ready %lu us after main() (resume %lu)\r\n",
+      { METRIC_BOOT_FIRST_SAMPLE_US, METRIC_BOOT_READY_US, METRIC_BOOT_RESUME } },
+    { "  Standby: %lu wakeups before this boot, %lu samples replayed\r\n",
+      { METRIC_STANDBY_WAKEUPS, METRIC_STANDBY_REPLAYED } },
+    { "  Deferred work: %lu posted, %lu dropped, depth max %lu, latency max %lu us\r\n",
+      { METRIC_WORK_POSTED, METRIC_WORK_DROPPED, METRIC_WORK_DEPTH_MAX,
+        METRIC_WORK_LATENCY_MAX_US } },
+    { "  Log deferral: %lu lines deferred, %lu bytes waiting, %lu over budget\r\n",
+      { METRIC_LOG_DEFERRED, METRIC_LOG_DEFER_BYTES, METRIC_LOG_OVER_BUDGET } },
+    { "  Sensor faults: %lu retries, %lu quarantined (%lu now)\r\n",
+      { METRIC_SENSOR_RETRIES, METRIC_SENSOR_QUARANTINES, METRIC_SENSORS_QUARANTINED } },
+    { "  CPU load: %lu permille last window, %lu average, %lu peak\r\n",
+      { METRIC_CPU_LOAD, METRIC_CPU_LOAD_AVG, METRIC_CPU_LOAD_PEAK } },
+};
+
+/**
+ * @brief Registered commands, sorted by name.
+ */
+static CLI_Command_t s_commands[CLI_MAX_COMMANDS];
+
+/**
+ * @brief Number of entries in @ref s_commands.
  */
-static void CLI_ToLower(char *str);
+static uint32_t s_commandCount = 0U;
+
+/* ------------------------------------------------------------------------- */
+
+void CLI_Init(UART_HandleTypeDef *huart, const Stream_t *out)
+{
+    s_cliUart       = huart;
+    s_out           = out;
+    s_lineIndex     = 0U;
+    s_lineCursor    = 0U;
+    s_escState      = CLI_ESC_NONE;
+    s_historyCount  = 0U;
+    s_historyNext   = 0U;
+    s_historyBrowse = 0U;
+    s_echoLength    = 0U;
+    memset(s_lineBuffer, 0, sizeof(s_lineBuffer));
+    memset(&s_batch, 0, sizeof(s_batch));
+
+    s_rxHead      = 0U;
+    s_rxTail      = 0U;
+    s_rxOverflows = 0U;
+    memset(&s_uartErrors, 0, sizeof(s_uartErrors));
+    CLI_StartReception();
+
+    Metrics_Publish(METRIC_WAKE_DROPS, &s_wakeDrops);
+
+    for (uint32_t i = 0U; i < (sizeof(s_builtinCommands) / sizeof(s_builtinCommands[0])); ++i)
+    {
+        (void)CLI_RegisterCommand(s_builtinCommands[i].name,
+                                  s_builtinCommands[i].handler,
+                                  s_builtinCommands[i].help);
+    }
+
+}
+
+void CLI_PrintBanner(void)
+{
+    CLI_SendString("\r\nSmart Sensor Hub CLI ready.\r\n");
+    CLI_SendString("Type 'help' for a list of commands.\r\n");
+    CLI_PrintPrompt();
+}
+
+void CLI_Process(void)
+{
+    if ((s_cliUart == NULL) || (s_out == NULL))
+    {
+        return;
+    }
+
+    /* Output of the last command comes first. */
+    if ((s_more != NULL) && !CLI_RunMore())
+    {
+        UartTx_SetCliBusy(true);
+        return;
+    }
+
+    /* Drain everything the RX interrupt has collected since last time. */
+    uint32_t head = s_rxHead;
+    __DMB();
+
+    bool waiting = false;
+
+    while (s_rxTail != head)
+    {
+        uint8_t ch = s_rxRing[s_rxTail & (CLI_RX_RING_SIZE - 1U)];
+
+        /* A line ends: its response takes precedence over logs and
+         * telemetry until this pass has queued it, and it only runs once
+         * the TX ring has room for it. Until then it stays in the RX ring,
+         * and so does everything after a command whose output is still to
+         * come (not even the echo goes between).
+         */
+        if (s_inputHandler == NULL)
+        {
+            bool lineEnd = (ch == '\r') || (ch == '\n');
+
+            if (lineEnd)
+            {
+                UartTx_SetCliBusy(true);
+            }
+            if ((s_more != NULL) || (lineEnd && !CLI_HasTxSpace()))
+            {
+                waiting = true;
+                break;
+            }
+        }
+        s_rxTail++;
+
+        /* The handler may remove itself: check it for every byte. */
+        if (s_inputHandler != NULL)
+        {
+            s_inputHandler(ch);
+        }
+        else
+        {
+            CLI_HandleChar(ch);
+        }
+    }
+
+    CLI_EchoFlush();
+
+    if (s_promptDirty && (s_inputHandler == NULL) && !s_batch.active && (s_more == NULL))
+    {
+        CLI_RedrawPrompt();
+    }
+
+    UartTx_SetCliBusy(waiting || (s_more != NULL));
+}
+
+void CLI_ExecuteLine(char *line)
+{
+    HIL_PROBE_MARK(CLI_BEGIN);
+    CLI_HandleLine(line);
+    HIL_PROBE_MARK(CLI_END);
+
+    /* Nobody waits for the rest of a long listing here. */
+    s_more       = NULL;
+    s_morePrompt = false;
+}
+
+void CLI_SetRxHook(CLI_RxHook_t hook)
+{
+    s_rxHook = hook;
+}
+
+void CLI_SetInputHandler(CLI_InputHandler_t handler)
+{
+    s_inputHandler = handler;
+}
+
+bool CLI_IsInputPending(void)
+{
+    return (s_rxTail != s_rxHead);
+}
+
+uint32_t CLI_GetRxOverflowCount(void)
+{
+    return s_rxOverflows;
+}
+
+void CLI_GetUartErrors(CLI_UartErrors_t *errors)
+{
+    if (errors != NULL)
+    {
+        *errors = s_uartErrors;
+    }
+}
+
+void CLI_OnUartWake(void)
+{
+    if ((s_cliUart == NULL) || (s_cliUart->hdmarx == NULL))
+    {
+        return;
+    }
+
+    /* A framing or noise error on the garbled character aborts the DMA. */
+    if (s_cliUart->RxState != HAL_UART_STATE_BUSY_RX)
+    {
+        CLI_StartReception();
+    }
+
+    s_wakeRxPos   = (CLI_RX_DMA_SIZE - s_cliUart->hdmarx->Instance->NDTR) % CLI_RX_DMA_SIZE;
+    s_wake_us     = Time_NowUs32();
+    s_charTime_us = 10000000U / s_cliUart->Init.BaudRate;
+    s_wakeCheck   = true;
+}
+
+uint32_t CLI_GetWakeDropCount(void)
+{
+    return s_wakeDrops;
+}
+
+void CLI_Receive(const uint8_t *data, size_t len)
+{
+    uint32_t head = s_rxHead;
+
+    for (size_t i = 0U; i < len; ++i)
+    {
+        if ((head - s_rxTail) < CLI_RX_RING_SIZE)
+        {
+            s_rxRing[head & (CLI_RX_RING_SIZE - 1U)] = data[i];
+            head++;
+        }
+        else
+        {
+            s_rxOverflows++;
+        }
+    }
+
+    CLI_PublishRx(head);
+}
+
+/**
+ * @brief Copy newly received DMA bytes into the software ring.
+ *
+ * Overrides the weak HAL callback. Called on DMA half/full transfer and on
+ * UART IDLE line; @p Size is the DMA write position inside the buffer.
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if ((huart != s_cliUart) || (Size > CLI_RX_DMA_SIZE))
+    {
+        return;
+    }
+
+    /* Size equals the buffer length on transfer-complete: that is position 0. */
+    uint32_t writePos = (uint32_t)Size % CLI_RX_DMA_SIZE;
+    uint32_t head     = s_rxHead;
+
+    if (s_wakeCheck)
+    {
+        s_wakeCheck = false;
+        CLI_DropWakeByte(writePos,
+                         HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE);
+    }
+
+    while (s_rxDmaReadPos != writePos)
+    {
+        if ((head - s_rxTail) < CLI_RX_RING_SIZE)
+        {
+            s_rxRing[head & (CLI_RX_RING_SIZE - 1U)] = s_rxDmaBuffer[s_rxDmaReadPos];
+            head++;
+        }
+        else
+        {
+            s_rxOverflows++;
+        }
+
+        s_rxDmaReadPos++;
+        if (s_rxDmaReadPos >= CLI_RX_DMA_SIZE)
+        {
+            s_rxDmaReadPos = 0U;
+        }
+    }
+
+    CLI_PublishRx(head);
+}
+
+/**
+ * @brief Count a UART error and restart reception (e.g. after an overrun).
+ *
+ * The HAL aborts the DMA transfer on errors; overrides the weak callback.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart == s_cliUart)
+    {
+        uint32_t code = huart->ErrorCode;
+
+        s_uartErrors.framing += ((code & HAL_UART_ERROR_FE) != 0U) ? 1U : 0U;
+        s_uartErrors.overrun += ((code & HAL_UART_ERROR_ORE) != 0U) ? 1U : 0U;
+        s_uartErrors.noise   += ((code & HAL_UART_ERROR_NE) != 0U) ? 1U : 0U;
+        s_uartErrors.parity  += ((code & HAL_UART_ERROR_PE) != 0U) ? 1U : 0U;
+
+        CLI_StartReception();
+    }
+}
+
+bool CLI_RegisterCommand(const char *name, CLI_CommandHandler_t handler, const char *help)
+{
+    if ((name == NULL) || (name[0] == '\0') || (handler == NULL) ||
+        (s_commandCount >= CLI_MAX_COMMANDS))
+    {
+        return false;
+    }
+
+    bool    found = false;
+    int32_t index = CLI_FindCommand(name, &found);
+    if (found)
+    {
+        return false;
+    }
+
+    memmove(&s_commands[index + 1], &s_commands[index],
+            (s_commandCount - (uint32_t)index) * sizeof(s_commands[0]));
+
+    s_commands[index].name    = name;
+    s_commands[index].handler = handler;
+    s_commands[index].help    = (help != NULL) ? help : "";
+    s_commandCount++;
+
+    return true;
+}
+
+void CLI_Print(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    CLI_VPrint(false, fmt, args);
+    va_end(args);
+}
+
+void CLI_PrintError(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    CLI_VPrint(true, fmt, args);
+    va_end(args);
+}
+
+void CLI_PrintConst(const char *text)
+{
+    if ((s_out == NULL) || (text == NULL) || s_batch.quiet)
+    {
+        return;
+    }
+
+    const StreamSegment_t segment = { text, strlen(text), true };
+
+    (void)Stream_WriteSegments(s_out, &segment, 1U);
+}
+
+void CLI_Continue(CLI_MoreFn_t more)
+{
+    s_more = more;
+    (void)CLI_RunMore();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void CLI_SendString(const char *str)
+{
+    if ((s_out == NULL) || (str == NULL))
+    {
+        return;
+    }
+
+    (void)Stream_Write(s_out, str, strlen(str));
+}
+
+static void CLI_VPrint(bool error, const char *fmt, va_list args)
+{
+    if ((s_out == NULL) || (s_batch.quiet && (!error || s_batch.lineFailed)))
+    {
+        return;
+    }
+
+    char buffer[128];
+    int  len = Fmt_VFormat(buffer, sizeof(buffer), fmt, args);
+
+    if (len <= 0)
+    {
+        return;
+    }
+
+    /* Output longer than the buffer is cut, as with vsnprintf(). */
+    if ((size_t)len >= sizeof(buffer))
+    {
+        len = (int)(sizeof(buffer) - 1U);
+    }
+
+    if (!s_batch.quiet)
+    {
+        (void)Stream_Write(s_out, buffer, (size_t)len);
+        return;
+    }
+
+    /* In a script, the first line of the first error of a command is
+     * reported with the script line number; everything else is dropped.
+     */
+    char *text = buffer;
+    while ((*text == '\r') || (*text == '\n') || (*text == ' '))
+    {
+        text++;
+    }
+    text[strcspn(text, "\r\n")] = '\0';
+
+    char report[160];
+    len = Fmt_Format(report, sizeof(report), "#batch,fail,line=%lu,%s\r\n",
+                     (unsigned long)s_batch.line, text);
+    if ((len > 0) && ((size_t)len < sizeof(report)))
+    {
+        (void)Stream_Write(s_out, report, (size_t)len);
+    }
+    s_batch.lineFailed = true;
+}
+
+static void CLI_BatchChar(uint8_t ch)
+{
+    bool lastCr = s_batch.lastCr;
+
+    s_batch.lastCr   = (ch == '\r');
+    s_batch.input_ms = HAL_GetTick();
+
+    if ((ch == '\r') || (ch == '\n'))
+    {
+        /* CR LF ends one line, not two: line numbers match the script. */
+        if ((ch == '\n') && lastCr)
+        {
+            return;
+        }
+
+        s_lineBuffer[s_lineIndex] = '\0';
+        s_batch.line++;
+        CLI_BatchLine(s_lineBuffer);
+        s_lineIndex        = 0U;
+        s_batch.overlong   = false;
+    }
+    else if (ch == 0x03U)
+    {
+        /* Ctrl-C */
+        s_lineIndex = 0U;
+        CLI_BatchEnd("abort");
+    }
+    else if (((ch >= 32U) && (ch < 127U)) || (ch == '\t'))
+    {
+        if (s_lineIndex < (CLI_MAX_LINE_LENGTH - 1U))
+        {
+            s_lineBuffer[s_lineIndex++] = (char)ch;
+        }
+        else
+        {
+            s_batch.overlong = true;
+        }
+    }
+    else
+    {
+        /* Ignore other control characters. */
+    }
+}
+
+static void CLI_BatchLine(char *line)
+{
+    line += strspn(line, " \t");
+
+    /* Blank lines and comments. */
+    if ((line[0] == '\0') || (line[0] == '#'))
+    {
+        return;
+    }
+
+    size_t length = strcspn(line, " \t");
+    if ((length == 3U) && (strncmp(line, "end", 3U) == 0) && (line[3U + strspn(&line[3], " \t")] == '\0'))
+    {
+        CLI_BatchEnd("done");
+        return;
+    }
+
+    s_batch.quiet      = true;
+    s_batch.lineFailed = false;
+
+    if (s_batch.overlong)
+    {
+        CLI_PrintError("Line too long (max %u).", (unsigned)(CLI_MAX_LINE_LENGTH - 1U));
+    }
+    else
+    {
+        HIL_PROBE_MARK(CLI_BEGIN);
+        CLI_HandleLine(line);
+        HIL_PROBE_MARK(CLI_END);
+    }
+
+    s_batch.quiet = false;
+    s_batch.commands++;
+    s_batch.failed  += s_batch.lineFailed ? 1U : 0U;
+    s_batch.last_us  = Time_NowUs32();
+}
+
+static void CLI_BatchEnd(const char *kind)
+{
+    s_batch.active = false;
+    CLI_SendString("#batch,");
+    CLI_Print("%s,commands=%lu,failed=%lu,lost=%lu,us=%lu\r\n", kind,
+              (unsigned long)s_batch.commands, (unsigned long)s_batch.failed,
+              (unsigned long)(s_rxOverflows - s_batch.overflows),
+              (unsigned long)(s_batch.last_us - s_batch.start_us));
+    CLI_PrintPrompt();
+}
+
+static void CLI_StartReception(void)
+{
+    /* The DMA stream is circular, so a single call keeps reception running;
+     * half-transfer events stay enabled to bound the interrupt interval.
+     */
+    s_rxDmaReadPos = 0U;
+    (void)HAL_UARTEx_ReceiveToIdle_DMA(s_cliUart, s_rxDmaBuffer, CLI_RX_DMA_SIZE);
+}
+
+static void CLI_DropWakeByte(uint32_t writePos, bool idle)
+{
+    if ((s_rxDmaReadPos != s_wakeRxPos) || (writePos == s_rxDmaReadPos))
+    {
+        return;
+    }
+
+    uint32_t count = (writePos + CLI_RX_DMA_SIZE - s_rxDmaReadPos) % CLI_RX_DMA_SIZE;
+
+    /* Time from the wake to the end of the first byte. */
+    uint32_t after    = (idle ? count : (count - 1U)) * s_charTime_us;
+    uint32_t since_us = Time_NowUs32() - s_wake_us;
+    uint32_t firstEnd = (since_us > after) ? (since_us - after) : 0U;
+
+    if (firstEnd <= (s_charTime_us + (s_charTime_us / 2U)))
+    {
+        s_rxDmaReadPos = (s_rxDmaReadPos + 1U) % CLI_RX_DMA_SIZE;
+        s_wakeDrops++;
+    }
+}
+
+static bool CLI_HasTxSpace(void)
+{
+    if (Stream_GetWritable(s_out) >= CLI_TX_SPACE)
+    {
+        return true;
+    }
+
+    /* Room freed meanwhile calls the hook at once; the line runs then. */
+    return !Stream_NotifyWritable(s_out, CLI_TX_SPACE, CLI_OnTxSpace);
+}
+
+static void CLI_OnTxSpace(void)
+{
+    CLI_RxHook_t hook = s_rxHook;
+    if (hook != NULL)
+    {
+        hook();
+    }
+}
+
+static void CLI_PublishRx(uint32_t head)
+{
+    /* Publish the bytes before the new head becomes visible to the task. */
+    __DMB();
+    s_rxHead = head;
+
+    CLI_RxHook_t hook = s_rxHook;
+    if ((hook != NULL) && (head != s_rxTail))
+    {
+        hook();
+    }
+}
+
+static bool CLI_RunMore(void)
+{
+    while (!s_more())
+    {
+        if (!CLI_HasTxSpace())
+        {
+            /* CLI_OnTxSpace() brings CLI_Process() back. */
+            return false;
+        }
+        if (Stream_GetWritable(s_out) < CLI_TX_SPACE)
+        {
+            /* The stream cannot notify: the rest is cut short. */
+            break;
+        }
+    }
+
+    s_more = NULL;
+    if (s_morePrompt)
+    {
+        s_morePrompt = false;
+        CLI_PrintPrompt();
+    }
+    return true;
+}
+
+static void CLI_HandleChar(uint8_t ch)
+{
+    if (s_batch.active)
+    {
+        if ((HAL_GetTick() - s_batch.input_ms) < CLI_BATCH_TIMEOUT_MS)
+        {
+            CLI_BatchChar(ch);
+            return;
+        }
+
+        /* The sender went quiet: this byte starts an ordinary line. */
+        s_lineIndex    = 0U;
+        s_batch.lastCr = false;
+        CLI_BatchEnd("timeout");
+    }
+
+    /* The LF of the CR LF that ended a script is not an empty line. */
+    if (s_batch.lastCr)
+    {
+        s_batch.lastCr = false;
+        if (ch == '\n')
+        {
+            return;
+        }
+    }
+
+    if (s_escState == CLI_ESC_START)
+    {
+        s_escState = (ch == '[') ? CLI_ESC_CSI : ((ch == 'O') ? CLI_ESC_SS3 : CLI_ESC_NONE);
+        s_escParam = 0U;
+        return;
+    }
+
+    if (s_escState == CLI_ESC_CSI)
+    {
+        if ((ch >= '0') && (ch <= '9'))
+        {
+            s_escParam = (s_escParam < 100U) ? ((s_escParam * 10U) + (ch - '0')) : s_escParam;
+            return;
+        }
+        s_escState = CLI_ESC_NONE;
+        CLI_HandleKey(ch, s_escParam);
+        return;
+    }
+
+    if (s_escState == CLI_ESC_SS3)
+    {
+        s_escState = CLI_ESC_NONE;
+        CLI_HandleKey(ch, 0U);
+        return;
+    }
+
+    if ((ch == '\r') || (ch == '\n'))
+    {
+        if (s_lineIndex > 0U)
+        {
+            s_lineBuffer[s_lineIndex] = '\0';
+            CLI_HistoryAdd(s_lineBuffer, s_lineIndex);
+            CLI_Echo("\r\n", 2U);
+
+            /* The echo goes out before anything the command prints. */
+            CLI_EchoFlush();
+            HIL_PROBE_MARK(CLI_BEGIN);
+            CLI_HandleLine(s_lineBuffer);
+            HIL_PROBE_MARK(CLI_END);
+            s_lineIndex  = 0U;
+            s_lineCursor = 0U;
+            memset(s_lineBuffer, 0, sizeof(s_lineBuffer));
+        }
+        s_historyBrowse = 0U;
+
+        /* A script started by `batch` prints its summary instead. */
+        if (!s_batch.active)
+        {
+            CLI_PrintPrompt();
+        }
+        else
+        {
+            s_batch.lastCr = (ch == '\r');
+        }
+    }
+    else if (ch == 0x1BU)
+    {
+        s_escState = CLI_ESC_START;
+    }
+    else if ((ch == '\b') || (ch == 0x7FU))
+    {
+        CLI_DeleteChar(true);
+    }
+    else if ((ch >= 32U) && (ch < 127U))
+    {
+        CLI_InsertChar((char)ch);
+    }
+    else
+    {
+        /* Ignore non-printable control characters. */
+    }
+}
+
+static void CLI_HandleKey(uint8_t final, uint32_t param)
+{
+    switch (final)
+    {
+        case 'A':
+            CLI_HistoryRecall(true);
+            break;
+
+        case 'B':
+            CLI_HistoryRecall(false);
+            break;
+
+        case 'C':
+            CLI_MoveCursor((s_lineCursor < s_lineIndex) ? (s_lineCursor + 1U) : s_lineCursor);
+            break;
+
+        case 'D':
+            CLI_MoveCursor((s_lineCursor > 0U) ? (s_lineCursor - 1U) : 0U);
+            break;
+
+        case 'H':
+            CLI_MoveCursor(0U);
+            break;
+
+        case 'F':
+            CLI_MoveCursor(s_lineIndex);
+            break;
+
+        case '~':
+            /* ESC [ 1~ / 7~ Home, 4~ / 8~ End, 3~ Delete */
+            if ((param == 1U) || (param == 7U))
+            {
+                CLI_MoveCursor(0U);
+            }
+            else if ((param == 4U) || (param == 8U))
+            {
+                CLI_MoveCursor(s_lineIndex);
+            }
+            else if (param == 3U)
+            {
+                CLI_DeleteChar(false);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void CLI_InsertChar(char ch)
+{
+    if (s_lineIndex >= (CLI_MAX_LINE_LENGTH - 1U))
+    {
+        return;
+    }
+
+    uint32_t tail = s_lineIndex - s_lineCursor;
+
+    memmove(&s_lineBuffer[s_lineCursor + 1U], &s_lineBuffer[s_lineCursor], tail);
+    s_lineBuffer[s_lineCursor] = ch;
+    s_lineIndex++;
+
+    /* The new character and the rest of the line, then back to the cursor. */
+    CLI_Echo(&s_lineBuffer[s_lineCursor], tail + 1U);
+    s_lineCursor++;
+    CLI_EchoMove(-(int32_t)tail);
+}
+
+static void CLI_DeleteChar(bool before)
+{
+    if (before)
+    {
+        if (s_lineCursor == 0U)
+        {
+            return;
+        }
+        s_lineCursor--;
+        CLI_Echo("\b", 1U);
+    }
+    else if (s_lineCursor == s_lineIndex)
+    {
+        return;
+    }
+
+    uint32_t tail = s_lineIndex - s_lineCursor - 1U;
+
+    memmove(&s_lineBuffer[s_lineCursor], &s_lineBuffer[s_lineCursor + 1U], tail);
+    s_lineIndex--;
+    s_lineBuffer[s_lineIndex] = '\0';
+
+    /* Shift the rest of the line left over the removed character. */
+    CLI_Echo(&s_lineBuffer[s_lineCursor], tail);
+    CLI_Echo(" ", 1U);
+    CLI_EchoMove(-(int32_t)(tail + 1U));
+}
+
+static void CLI_MoveCursor(uint32_t position)
+{
+    CLI_EchoMove((int32_t)position - (int32_t)s_lineCursor);
+    s_lineCursor = position;
+}
+
+static void CLI_HistoryRecall(bool older)
+{
+    uint32_t browse = s_historyBrowse;
+
+    if (older)
+    {
+        if (browse >= s_historyCount)
+        {
+            return;
+        }
+        browse++;
+    }
+    else
+    {
+        if (browse == 0U)
+        {
+            return;
+        }
+        browse--;
+    }
+
+    /* Leaving the line being typed: keep it for the way back. */
+    if (s_historyBrowse == 0U)
+    {
+        memcpy(s_historyDraft, s_lineBuffer, s_lineIndex);
+        s_historyDraftLength = s_lineIndex;
+    }
+    s_historyBrowse = browse;
+
+    if (browse == 0U)
+    {
+        CLI_ReplaceLine(s_historyDraft, s_historyDraftLength);
+        return;
+    }
+
+    const char *entry = s_history[(s_historyNext + CLI_HISTORY_DEPTH - browse) % CLI_HISTORY_DEPTH];
+    CLI_ReplaceLine(entry, (uint32_t)strlen(entry));
+}
+
+static void CLI_HistoryAdd(const char *line, uint32_t length)
+{
+    const char *newest = s_history[(s_historyNext + CLI_HISTORY_DEPTH - 1U) % CLI_HISTORY_DEPTH];
+
+    if ((s_historyCount > 0U) && (strcmp(newest, line) == 0))
+    {
+        return;
+    }
+
+    memcpy(s_history[s_historyNext], line, length + 1U);
+    s_historyNext = (s_historyNext + 1U) % CLI_HISTORY_DEPTH;
+    if (s_historyCount < CLI_HISTORY_DEPTH)
+    {
+        s_historyCount++;
+    }
+}
+
+static void CLI_ReplaceLine(const char *line, uint32_t length)
+{
+    uint32_t same = 0U;
+
+    while ((same < length) && (same < s_lineIndex) && (line[same] == s_lineBuffer[same]))
+    {
+        same++;
+    }
+
+    /* Keep the common start; write the rest and clear what is left over. */
+    CLI_MoveCursor(same);
+    CLI_Echo(&line[same], length - same);
+    if (s_lineIndex > length)
+    {
+        CLI_Echo("\x1b[K", 3U);
+    }
+
+    memmove(s_lineBuffer, line, length);
+    s_lineBuffer[length] = '\0';
+    s_lineIndex  = length;
+    s_lineCursor = length;
+}
+
+static void CLI_Echo(const char *data, uint32_t length)
+{
+    while (length > 0U)
+    {
+        if (s_echoLength == CLI_ECHO_SIZE)
+        {
+            CLI_EchoFlush();
+        }
+
+        uint32_t chunk = CLI_ECHO_SIZE - s_echoLength;
+        chunk = (length < chunk) ? length : chunk;
+
+        memcpy(&s_echo[s_echoLength], data, chunk);
+        s_echoLength += chunk;
+        data         += chunk;
+        length       -= chunk;
+    }
+}
+
+static void CLI_EchoMove(int32_t delta)
+{
+    if (delta == 0)
+    {
+        return;
+    }
+
+    uint32_t count = (uint32_t)((delta < 0) ? -delta : delta);
+    char     seq[6];
+    uint32_t n = 0U;
+
+    /* ESC [ <count> C|D, the count left out for one column (lines < 100). */
+    seq[n++] = '\x1b';
+    seq[n++] = '[';
+    if (count >= 10U)
+    {
+        seq[n++] = (char)('0' + ((count / 10U) % 10U));
+    }
+    if (count > 1U)
+    {
+        seq[n++] = (char)('0' + (count % 10U));
+    }
+    seq[n++] = (delta < 0) ? 'D' : 'C';
+
+    CLI_Echo(seq, n);
+}
+
+static void CLI_EchoFlush(void)
+{
+    if ((s_echoLength > 0U) && (s_out != NULL))
+    {
+        (void)Stream_Write(s_out, s_echo, s_echoLength);
+        s_echoLength = 0U;
+    }
+}
+
+static void CLI_PrintPrompt(void)
+{
+    if (s_more != NULL)
+    {
+        s_morePrompt = true;
+        return;
+    }
+
+    s_promptDirty = false;
+    CLI_EchoFlush();
+    CLI_SendString("\r\n> ");
+}
+
+static void CLI_RedrawPrompt(void)
+{
+    s_promptDirty = false;
+
+    /* The other output ended its last line, so this one is blank: prompt,
+     * partial command and cursor position go out as one write, so no log
+     * line splits them.
+     */
+    CLI_Echo("\r> ", 3U);
+    CLI_Echo(s_lineBuffer, s_lineIndex);
+    CLI_EchoMove(-(int32_t)(s_lineIndex - s_lineCursor));
+    CLI_EchoFlush();
+}
+
+static inline uint32_t CLI_Tokenize(char *line, char *argv[], uint32_t maxArgs)
+{
+    uint32_t argc = 0U;
+    char    *p    = line;
+
+    for (;;)
+    {
+        while ((*p == ' ') || (*p == '\t'))
+        {
+            p++;
+        }
+        if (*p == '\0')
+        {
+            break;
+        }
+
+        if (argc == maxArgs)
+        {
+            return maxArgs + 1U;
+        }
+        argv[argc++] = p;
+
+        /* Lower-case the token in the same pass that finds its end. */
+        while ((*p != '\0') && (*p != ' ') && (*p != '\t'))
+        {
+            if ((*p >= 'A') && (*p <= 'Z'))
+            {
+                *p = (char)(*p - 'A' + 'a');
+            }
+            p++;
+        }
+
+        if (*p != '\0')
+        {
+            *p++ = '\0';
+        }
+    }
+
+    return argc;
+}
+
+static int32_t CLI_FindCommand(const char *name, bool *found)
+{
+    int32_t lo = 0;
+    int32_t hi = (int32_t)s_commandCount - 1;
+
+    while (lo <= hi)
+    {
+        int32_t mid = lo + ((hi - lo) / 2);
+        int     cmp = strcmp(name, s_commands[mid].name);
+
+        if (cmp == 0)
+        {
+            *found = true;
+            return mid;
+        }
+        if (cmp < 0)
+        {
+            hi = mid - 1;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+
+    *found = false;
+    return lo;
+}
+
+static void CLI_HandleLine(char *line)
+{
+    if (line == NULL)
+    {
+        return;
+    }
+
+    char    *argv[CLI_MAX_ARGS];
+    uint32_t argc = CLI_Tokenize(line, argv, CLI_MAX_ARGS);
+
+    if (argc == 0U)
+    {
+        return;
+    }
+
+    if (argc > CLI_MAX_ARGS)
+    {
+        CLI_PrintError("\r\nToo many arguments (max %u).\r\n", (unsigned)(CLI_MAX_ARGS - 1U));
+        return;
+    }
+
+    bool    found = false;
+    int32_t index = CLI_FindCommand(argv[0], &found);
+
+    if (!found)
+    {
+        CLI_PrintError("\r\nUnknown command '%s'. Type 'help'.\r\n", argv[0]);
+        return;
+    }
+
+    s_commands[index].handler(argc, argv);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Built-in Command Handlers                        */
+/* ------------------------------------------------------------------------- */
+
+static void CLI_CmdHelp(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    if (s_batch.quiet)
+    {
+        return;
+    }
+
+    CLI_PrintConst("\r\nAvailable commands:\r\n");
+
+    /* Longer than the TX ring: listed as far as it has room, the rest
+     * follows as it drains.
+     */
+    s_help.last = NULL;
+    s_help.text = NULL;
+    CLI_Continue(CLI_HelpMore);
+}
+
+static bool CLI_HelpMore(void)
+{
+    uint32_t index = 0U;
+
+    if (s_help.last != NULL)
+    {
+        bool    found = false;
+        int32_t at    = CLI_FindCommand(s_help.last, &found);
+
+        index = (uint32_t)at + ((found && (s_help.text == NULL)) ? 1U : 0U);
+    }
+
+    while (index < s_commandCount)
+    {
+        const CLI_Command_t *cmd  = &s_commands[index];
+        const char          *text = (s_help.text != NULL) ? s_help.text : cmd->help;
+        const char          *name = (s_help.text != NULL) ? "" : cmd->name;
+
+        /* One output line per '\n'-separated help line; name on the first.
+         * Only the name column is formatted; the help text is sent from
+         * the command table, and the line goes out as one write.
+         */
+        const char *eol = strchr(text, '\n');
+        size_t      len = (eol != NULL) ? (size_t)(eol - text) : strlen(text);
+        char        prefix[16];
+        int         plen = Fmt_Format(prefix, sizeof(prefix), "  %-9s ", name);
+
+        if ((plen < 0) || ((size_t)plen >= sizeof(prefix)))
+        {
+            plen = (int)strlen(prefix);
+        }
+
+        /* Room for the whole line, in case the text has to be copied
+         * because no reference slot is free.
+         */
+        if (Stream_GetWritable(s_out) < ((size_t)plen + len + 2U))
+        {
+            return false;
+        }
+
+        const StreamSegment_t line[] =
+        {
+            { prefix, (size_t)plen, false },
+            { text,   len,          true  },
+            { "\r\n", 2U,           false },
+        };
+
+        (void)Stream_WriteSegments(s_out, line, sizeof(line) / sizeof(line[0]));
+
+        s_help.last = cmd->name;
+        if (eol != NULL)
+        {
+            s_help.text = eol + 1;
+        }
+        else
+        {
+            s_help.text = NULL;
+            index++;
+        }
+    }
+
+    return true;
+}
+
+static void CLI_CmdLog(uint32_t argc, char *argv[])
+{
+    const char *arg = (argc > 1U) ? argv[1] : "";
+
+    if (strcmp(arg, "off") == 0)
+    {
+        Log_Enable(false);
+        s_logPaused = false; /* explicit off overrides pause logic */
+        CLI_Print("\r\nTask logging disabled.\r\n");
+    }
+    else if (strcmp(arg, "error") == 0)
+    {
+        Log_SetLevel(LOG_LEVEL_ERROR);
+        Log_Enable(true);
+        s_logPaused = false;
+        CLI_Print("\r\nTask logging enabled, level=ERROR.\r\n");
+    }
+    else if (strcmp(arg, "warn") == 0)
+    {
+        Log_SetLevel(LOG_LEVEL_WARN);
+        Log_Enable(true);
+        s_logPaused = false;
+        CLI_Print("\r\nTask logging enabled, level=WARN.\r\n");
+    }
+    else if (strcmp(arg, "info") == 0)
+    {
+        Log_SetLevel(LOG_LEVEL_INFO);
+        Log_Enable(true);
+        s_logPaused = false;
+        CLI_Print("\r\nTask logging enabled, level=INFO.\r\n");
+    }
+    else if (strcmp(arg, "debug") == 0)
+    {
+        Log_SetLevel(LOG_LEVEL_DEBUG);
+        Log_Enable(true);
+        s_logPaused = false;
+        CLI_Print("\r\nTask logging enabled, level=DEBUG.\r\n");
+    }
+    else if (strcmp(arg, "pause") == 0)
+    {
+        if (!s_logPaused)
+        {
+            s_prevLogEnabled = Log_IsEnabled();
+            s_prevLogLevel   = Log_GetLevel();
+            Log_Enable(false);
+            s_logPaused = true;
+            CLI_Print("\r\nTask logging paused. Use 'log resume' to restore.\r\n");
+        }
+        else
+        {
+            CLI_Print("\r\nTask logging is already paused.\r\n");
+        }
+    }
+    else if (strcmp(arg, "resume") == 0)
+    {
+        if (s_logPaused)
+        {
+            Log_SetLevel(s_prevLogLevel);
+            Log_Enable(s_prevLogEnabled);
+            s_logPaused = false;
+            CLI_Print("\r\nTask logging resumed.\r\n");
+        }
+        else
+        {
+            CLI_Print("\r\nTask logging is not paused.\r\n");
+        }
+    }
+    else if (strcmp(arg, "limit") == 0)
+    {
+        const char *state = (argc > 2U) ? argv[2] : "";
+
+        if (strcmp(state, "on") == 0)
+        {
+            Log_SetRateLimit(true);
+        }
+        else if (strcmp(state, "off") == 0)
+        {
+            Log_SetRateLimit(false);
+        }
+        else if (argc > 2U)
+        {
+            CLI_PrintError("\r\nUsage: log limit [on|off]\r\n");
+            return;
+        }
+
+        CLI_Print("\r\nLog rate limit: %s (%lu lines held back).\r\n",
+                  Log_IsRateLimited() ? "ON" : "OFF",
+                  (unsigned long)Log_GetHeldCount());
+    }
+    else if (strcmp(arg, "mode") == 0)
+    {
+        CLI_LogMode(argc, argv);
+    }
+    else if (strcmp(arg, "budget") == 0)
+    {
+        if (argc > 2U)
+        {
+            char         *end    = NULL;
+            unsigned long budget = strtoul(argv[2], &end, 10);
+
+            if ((argc > 3U) || (*end != '\0') || (end == argv[2]))
+            {
+                CLI_PrintError("\r\nUsage: log budget [<bytes/s>] (0 = off)\r\n");
+                return;
+            }
+            Log_SetBudget((uint32_t)budget);
+        }
+
+        CLI_Print("\r\nLog budget: %lu bytes/s (0 = off), %lu bytes waiting.\r\n",
+                  (unsigned long)Log_GetBudget(), (unsigned long)Log_GetDeferredBytes());
+    }
+    else
+    {
+        CLI_PrintError("\r\nUnknown log option '%s'. Type 'help'.\r\n", arg);
+    }
+}
+
+static void CLI_LogMode(uint32_t argc, char *argv[])
+{
+    static const char *const s_modeNames[POWER_MODE_COUNT] = { "active", "idle", "sleep", "stop" };
+    static const char *const s_levelNames[]                = { "debug", "info", "warn", "error" };
+
+    if (argc == 4U)
+    {
+        uint32_t mode = 0U;
+        while ((mode < (uint32_t)POWER_MODE_COUNT) && (strcmp(argv[2], s_modeNames[mode]) != 0))
+        {
+            mode++;
+        }
+
+        uint32_t level = 0U;
+        while ((level < (sizeof(s_levelNames) / sizeof(s_levelNames[0]))) &&
+               (strcmp(argv[3], s_levelNames[level]) != 0))
+        {
+            level++;
+        }
+
+        if (mode == (uint32_t)POWER_MODE_COUNT)
+        {
+            argc = 0U;
+        }
+        else if (level < (sizeof(s_levelNames) / sizeof(s_levelNames[0])))
+        {
+            Log_SetModeLevel(mode, (uint8_t)level);
+        }
+        else if (strcmp(argv[3], "off") == 0)
+        {
+            Log_SetModeLevel(mode, LOG_MODE_LEVEL_OFF);
+        }
+        else if (strcmp(argv[3], "default") == 0)
+        {
+            Log_SetModeLevel(mode, LOG_MODE_LEVEL_DEFAULT);
+        }
+        else if ((strcmp(argv[3], "defer") == 0) || (strcmp(argv[3], "live") == 0))
+        {
+            Log_SetModeDefer(mode, argv[3][0] == 'd');
+        }
+        else
+        {
+            argc = 0U;
+        }
+    }
+
+    if ((argc != 2U) && (argc != 4U))
+    {
+        CLI_PrintError("\r\nUsage: log mode [active|idle|sleep|stop "
+                       "off|error|warn|info|debug|default|defer|live]\r\n");
+        return;
+    }
+
+    CLI_Print("\r\nLog by power mode (level %s, %lu bytes waiting):\r\n",
+              s_levelNames[Log_GetLevel()], (unsigned long)Log_GetDeferredBytes());
+
+    for (uint32_t mode = 0U; mode < (uint32_t)POWER_MODE_COUNT; ++mode)
+    {
+        uint8_t level = Log_GetModeLevel(mode);
+
+        CLI_Print("  %-6s %-7s %s\r\n", s_modeNames[mode],
+                  (level == LOG_MODE_LEVEL_DEFAULT) ? "default" :
+                  (level == LOG_MODE_LEVEL_OFF)     ? "off"     : s_levelNames[level],
+                  Log_GetModeDefer(mode) ? "defer" : "live");
+    }
+}
+
+static void CLI_CmdPmode(uint32_t argc, char *argv[])
+{
+    const char *arg = (argc > 1U) ? argv[1] : "";
+
+    if (strcmp(arg, "auto") == 0)
+    {
+        PowerManager_SetAutoPolicy(true);
+        CLI_Print("\r\nAdaptive power policy enabled\r\n");
+        return;
+    }
+
+    PowerMode_t requested = POWER_MODE_ACTIVE;
+    bool valid = true;
+
+    if (strcmp(arg, "active") == 0)
+    {
+        requested = POWER_MODE_ACTIVE;
+    }
+    else if (strcmp(arg, "idle") == 0)
+    {
+        requested = POWER_MODE_IDLE;
+    }
+    else if (strcmp(arg, "sleep") == 0)
+    {
+        requested = POWER_MODE_SLEEP;
+    }
+    else if (strcmp(arg, "stop") == 0)
+    {
+        requested = POWER_MODE_STOP;
+    }
+    else
+    {
+        valid = false;
+    }
+
+    if (valid)
+    {
+        /* An explicit mode is a manual override of the adaptive policy. */
+        PowerManager_SetAutoPolicy(false);
+        PowerManager_RequestMode(requested);
+        CLI_Print("\r\nRequested power mode change: %s (policy manual)\r\n", arg);
+    }
+    else
+    {
+        CLI_PrintError("\r\nUnknown power mode '%s'. Type 'help'.\r\n", arg);
+    }
+}
+
+static void CLI_CmdStatus(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    static uint32_t s_metrics[METRIC_COUNT];
+
+    PowerMode_t mode   = PowerManager_GetCurrentMode();
+    LogLevel_t  level  = Log_GetLevel();
+    bool        enable = Log_IsEnabled();
+
+    Metrics_Snapshot(s_metrics);
+
+    CLI_PrintConst("\r\nStatus:\r\n");
+    CLI_Print("  Task logging: %s\r\n", enable ? "ENABLED" : "DISABLED");
+    CLI_Print("  LogLevel: %d (0=DEBUG,1=INFO,2=WARN,3=ERROR)\r\n", (int)level);
+    CLI_Print("  PowerMode: %d (0=ACTIVE,1=IDLE,2=SLEEP,3=STOP)\r\n", (int)mode);
+    CLI_Print("  Clock: %s (%lu MHz)\r\n",
+              ClockProfile_GetName(ClockProfile_GetCurrent()),
+              (unsigned long)(s_metrics[METRIC_CLOCK_HZ] / 1000000U));
+
+    for (uint32_t i = 0U; i < (sizeof(s_statusLines) / sizeof(s_statusLines[0])); ++i)
+    {
+        const uint8_t *ids = s_statusLines[i].ids;
+
+        CLI_Print(s_statusLines[i].fmt,
+                  (unsigned long)s_metrics[ids[0]], (unsigned long)s_metrics[ids[1]],
+                  (unsigned long)s_metrics[ids[2]], (unsigned long)s_metrics[ids[3]]);
+    }
+
+    CLI_PrintTaskShares(s_metrics[METRIC_CPU_LOAD]);
+
+    if (USB_CDC_ENABLE != 0)
+    {
+        UsbCdcStats_t usb;
+        UsbCdc_GetStats(&usb);
+        CLI_Print("  USB: %s%s%s%s, tx %lu rx %lu bytes, to UART %lu\r\n",
+                  UsbCdc_StateName(usb.state),
+                  usb.dtr ? " open" : "",
+                  usb.suspended ? " suspended" : "",
+                  usb.stalled ? " not reading" : "",
+                  (unsigned long)s_metrics[METRIC_USB_TX_BYTES],
+                  (unsigned long)s_metrics[METRIC_USB_RX_BYTES],
+                  (unsigned long)s_metrics[METRIC_USB_TX_TO_UART]);
+    }
+
+    CLI_Print("  Power policy: %s, inactive %lu ms (step-downs %lu, wake-ups %lu)\r\n",
+              PowerManager_IsAutoPolicy() ? "AUTO" : "MANUAL",
+              (unsigned long)s_metrics[METRIC_INACTIVE_MS],
+              (unsigned long)s_metrics[METRIC_AUTO_STEP_DOWNS],
+              (unsigned long)s_metrics[METRIC_AUTO_WAKEUPS]);
+}
+
+static void CLI_PrintTaskShares(uint32_t load_pm)
+{
+    uint32_t tasks_pm = 0U;
+
+    CLI_PrintConst("  Task share (permille):");
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        const AppTaskDescriptor_t *task = AppTaskManager_GetTask(i);
+
+        if (task->stats.sharePermille != 0U)
+        {
+            CLI_Print(" %s %lu", task->name, (unsigned long)task->stats.sharePermille);
+            tasks_pm += task->stats.sharePermille;
+        }
+    }
+    for (uint32_t i = 0U; i < AppTaskManager_GetEventTaskCount(); ++i)
+    {
+        const AppEventTask_t *task = AppTaskManager_GetEventTask(i);
+
+        if (task->stats.sharePermille != 0U)
+        {
+            CLI_Print(" %s %lu", task->name, (unsigned long)task->stats.sharePermille);
+            tasks_pm += task->stats.sharePermille;
+        }
+    }
+
+    CLI_Print(" other %lu\r\n", (unsigned long)((load_pm > tasks_pm) ? (load_pm - tasks_pm) : 0U));
+}
+
+static bool CLI_ParseFloat(const char *arg, float *value)
+{
+    char *end = NULL;
+
+    *value = strtof(arg, &end);
+    return (end != arg) && (*end == '\0');
+}
+
+static bool CLI_ParseSensorId(const char *arg, uint8_t *id)
+{
+    char         *end   = NULL;
+    unsigned long value = strtoul(arg, &end, 10);
+
+    *id = (uint8_t)value;
+    return (end != arg) && (*end == '\0') && (value <= 0xFFUL) && (SensorRegistry_Find(*id) != NULL);
+}
+
+static bool CLI_CalibSensor(uint8_t sensorId, uint32_t argc, char *argv[])
+{
+    SensorCalibConfig_t cfg;
+    bool                known = SensorCalib_GetConfig(sensorId, &cfg);
+
+    if ((argc == 3U) && (strcmp(argv[2], "off") == 0))
+    {
+        return SensorCalib_Configure(sensorId, NULL);
+    }
+
+    if ((argc >= 5U) && (argc <= 7U) && (strcmp(argv[2], "poly") == 0))
+    {
+        for (uint32_t j = 0U; j < SENSOR_CALIB_TERMS; ++j)
+        {
+            cfg.coeff[j] = 0.0f;
+            if (((3U + j) < argc) && !CLI_ParseFloat(argv[3U + j], &cfg.coeff[j]))
+            {
+                return false;
+            }
+        }
+        return SensorCalib_Configure(sensorId, &cfg);
+    }
+
+    if ((argc == 5U) && (strcmp(argv[2], "span") == 0))
+    {
+        return CLI_ParseFloat(argv[3], &cfg.lo) && CLI_ParseFloat(argv[4], &cfg.hi) &&
+               SensorCalib_Configure(sensorId, &cfg);
+    }
+
+    if ((argc == 4U) && (strcmp(argv[2], "chan") == 0))
+    {
+        cfg.channel = (uint8_t)strtoul(argv[3], NULL, 10);
+        return SensorCalib_Configure(sensorId, &cfg);
+    }
+
+    if ((argc == 4U) && (strcmp(argv[2], "point") == 0))
+    {
+        if (strcmp(argv[3], "clear") == 0)
+        {
+            SensorCalib_ClearPoints(sensorId);
+            return true;
+        }
+
+        /* The registry keeps the last reading as acquired, before any stage. */
+        const SensorEntry_t *entry = SensorRegistry_Find(sensorId);
+        float                reference;
+
+        if (!CLI_ParseFloat(argv[3], &reference))
+        {
+            return false;
+        }
+        if ((entry == NULL) || (entry->readCount == 0U) ||
+            (cfg.channel >= SensorData_GetChannels(&entry->last)))
+        {
+            CLI_Print("\r\nNo reading of sensor %u channel %u yet\r\n",
+                      (unsigned)sensorId, (unsigned)cfg.channel);
+            return true;
+        }
+        if (!SensorCalib_AddPoint(sensorId, SensorData_GetFloat(&entry->last, cfg.channel), reference))
+        {
+            CLI_PrintError("\r\nPoint not added (%u points at most, or no free slot)\r\n",
+                           (unsigned)SENSOR_CALIB_MAX_POINTS);
+        }
+        return true;
+    }
+
+    if (((argc == 3U) || (argc == 4U)) && (strcmp(argv[2], "fit") == 0))
+    {
+        uint32_t degree = (argc == 4U) ? (uint32_t)strtoul(argv[3], NULL, 10) : 1U;
+
+        if (!known || !SensorCalib_Fit(sensorId, degree))
+        {
+            CLI_PrintError("\r\nFit failed: degree %lu needs %lu distinct points\r\n",
+                           (unsigned long)degree, (unsigned long)(degree + 1U));
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static void CLI_CmdBaud(uint32_t argc, char *argv[])
+{
+    if (argc > 1U)
+    {
+        char         *end   = NULL;
+        unsigned long baud  = strtoul(argv[1], &end, 10);
+        bool          over8 = false;
+        bool          ok    = (end != argv[1]) && (*end == '\0') && (baud > 0UL) && (argc <= 3U);
+
+        (void)UartTx_GetBaudRate(&over8);
+
+        if (ok && (argc == 3U))
+        {
+            ok    = (strcmp(argv[2], "8") == 0) || (strcmp(argv[2], "16") == 0);
+            over8 = (strcmp(argv[2], "8") == 0);
+        }
+
+        if (!ok)
+        {
+            CLI_PrintError("\r\nUsage: baud [<rate> [8|16]]\r\n");
+            return;
+        }
+
+        /* This line still goes out at the old rate. */
+        CLI_Print("\r\nSwitching to %lu baud (oversampling %u)...\r\n", baud, over8 ? 8U : 16U);
+
+        if (!UartTx_SetBaudRate((uint32_t)baud, over8))
+        {
+            CLI_Print("Not reachable at %lu MHz within %u.%u %%.\r\n",
+                      (unsigned long)(SystemCoreClock / 1000000U),
+                      (unsigned)(CONSOLE_BAUD_TOLERANCE_PPT / 10U),
+                      (unsigned)(CONSOLE_BAUD_TOLERANCE_PPT % 10U));
+            return;
+        }
+    }
+
+    CLI_UartErrors_t errors;
+    CLI_GetUartErrors(&errors);
+
+    bool     over8  = false;
+    uint32_t baud   = UartTx_GetBaudRate(&over8);
+    uint32_t actual = UartTx_GetActualBaud();
+    int32_t  ppt    = (baud != 0U) ? (int32_t)((((int64_t)actual - (int64_t)baud) * 1000) / (int64_t)baud) : 0;
+
+    /* A slower clock profile may not reach the rate set at full speed. */
+    bool off = ((ppt < 0) ? (uint32_t)-ppt : (uint32_t)ppt) > CONSOLE_BAUD_TOLERANCE_PPT;
+
+    CLI_Print("\r\nConsole: %lu baud (actual %lu, %+ld ppt%s), oversampling %u\r\n",
+              (unsigned long)baud, (unsigned long)actual, (long)ppt,
+              off ? ", out of tolerance" : "", over8 ? 8U : 16U);
+    CLI_Print("  RX errors: framing %lu, overrun %lu, noise %lu, parity %lu; RX ring full %lu\r\n",
+              (unsigned long)errors.framing, (unsigned long)errors.overrun,
+              (unsigned long)errors.noise, (unsigned long)errors.parity,
+              (unsigned long)s_rxOverflows);
+}
+
+static void CLI_CmdSensors(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    PowerMode_t mode = PowerManager_GetCurrentMode();
+
+    CLI_Print("\r\nSensors (%lu registered):\r\n",
+              (unsigned long)SensorRegistry_GetCount());
+    CLI_Print("  %3s %-12s %-5s %8s %8s %6s %6s %10s\r\n",
+              "id", "name", "state", "period", "reads", "errs", "health", "last");
+
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+        const char          *state;
+
+        if (!entry->ready)
+        {
+            state = "fail";
+        }
+        else if (entry->quarantined)
+        {
+            state = "quar";
+        }
+        else
+        {
+            state = entry->synced ? "sync" : "ok";
+        }
+
+        CLI_Print("  %3u %-12s %-5s %8lu %8lu %6lu %5lu%% %10.2f\r\n",
+                  (unsigned)entry->id,
+                  entry->name,
+                  state,
+                  (unsigned long)entry->period_ms[mode],
+                  (unsigned long)entry->readCount,
+                  (unsigned long)entry->errorCount,
+                  (unsigned long)((entry->health * 100U) / SENSOR_REGISTRY_HEALTH_MAX),
+                  (double)SensorData_GetFloat(&entry->last, 0U));
+    }
+}
+
+static void CLI_CmdFarm(uint32_t argc, char *argv[])
+{
+    SensorFarmFaults_t faults;
+    SensorFarm_GetFaults(&faults);
+
+    if ((argc == 3U) && (strcmp(argv[1], "fail") == 0))
+    {
+        faults.failPermille = (uint32_t)strtoul(argv[2], NULL, 10);
+        SensorFarm_SetFaults(&faults);
+    }
+    else if ((argc == 4U) && (strcmp(argv[1], "spike") == 0))
+    {
+        faults.spikePermille = (uint32_t)strtoul(argv[2], NULL, 10);
+        faults.spike_us      = (uint32_t)strtoul(argv[3], NULL, 10);
+        SensorFarm_SetFaults(&faults);
+    }
+    else if (argc == 2U)
+    {
+        char         *end   = NULL;
+        unsigned long count = strtoul(argv[1], &end, 10);
+        if ((end == argv[1]) || (*end != '\0'))
+        {
+            CLI_PrintError("\r\nUsage: farm [<n> | fail <pm> | spike <pm> <us>]\r\n");
+            return;
+        }
+        (void)SensorFarm_SetCount((uint32_t)count);
+    }
+    else if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: farm [<n> | fail <pm> | spike <pm> <us>]\r\n");
+        return;
+    }
+
+    SensorFarmStats_t stats;
+    SensorFarm_GetFaults(&faults);
+    SensorFarm_GetStats(&stats);
+
+    CLI_Print("\r\nSensor farm: %lu/%lu channels\r\n",
+              (unsigned long)SensorFarm_GetCount(),
+              (unsigned long)SENSOR_FARM_MAX_CHANNELS);
+    CLI_Print("  Faults: fail %lu/1000, spike %lu/1000 x %lu us\r\n",
+              (unsigned long)faults.failPermille,
+              (unsigned long)faults.spikePermille,
+              (unsigned long)faults.spike_us);
+    CLI_Print("  Reads: %lu (injected fails %lu, spikes %lu)\r\n",
+              (unsigned long)stats.reads,
+              (unsigned long)stats.injectedFails,
+              (unsigned long)stats.injectedSpikes);
+}
+
+static void CLI_CmdReplay(uint32_t argc, char *argv[])
+{
+    static const char *const sourceNames[SENSOR_REPLAY_SOURCE_COUNT] = { "flash", "file", "link" };
+
+    if ((argc >= 2U) && (strcmp(argv[1], "push") == 0))
+    {
+        uint32_t accepted = 0U;
+
+        /* Kept terse: this is the host tool's flow control, one per line. */
+        for (uint32_t i = 2U; (i + 2U) < argc; i += 3U)
+        {
+            SensorData_t data;
+
+            SensorData_Init(&data, SENSOR_FORMAT_S32, 1U, -3);
+            SensorData_SetFloat(&data, 0U, strtof(argv[i + 2U], NULL));
+            data.sensorId  = (uint8_t)strtoul(argv[i], NULL, 10);
+            data.timestamp = (uint32_t)strtoul(argv[i + 1U], NULL, 10);
+
+            if (!SensorReplay_Push(&data))
+            {
+                break;
+            }
+            accepted++;
+        }
+
+        CLI_Print("\r\n#replay,ack,n=%lu,free=%lu\r\n", (unsigned long)accepted,
+                  (unsigned long)SensorReplay_GetLinkFree());
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "end") == 0))
+    {
+        SensorReplay_EndPush();
+    }
+    else if ((argc == 2U) && (strcmp(argv[1], "stop") == 0))
+    {
+        SensorReplay_Stop();
+    }
+    else if ((argc == 2U) || (argc == 3U))
+    {
+        uint32_t source = 0U;
+
+        while ((source < (uint32_t)SENSOR_REPLAY_SOURCE_COUNT) &&
+               (strcmp(argv[1], sourceNames[source]) != 0))
+        {
+            source++;
+        }
+
+        bool fast = (argc == 3U) && (strcmp(argv[2], "fast") == 0);
+        if ((source == (uint32_t)SENSOR_REPLAY_SOURCE_COUNT) || ((argc == 3U) && !fast))
+        {
+            CLI_PrintError("\r\nUsage: replay [flash|file|link [fast] | stop | push ... | end]\r\n");
+            return;
+        }
+
+        if (!SensorReplay_Start((SensorReplaySource_t)source,
+                                fast ? SENSOR_REPLAY_FAST : SENSOR_REPLAY_TIMED))
+        {
+            CLI_PrintError("\r\nCannot replay from %s (no source, flash log on, or registry full).\r\n",
+                           sourceNames[source]);
+            return;
+        }
+    }
+    else if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: replay [flash|file|link [fast] | stop | push ... | end]\r\n");
+        return;
+    }
+
+    SensorReplayStats_t stats;
+    SensorReplay_GetStats(&stats);
+
+    uint32_t elapsed_ms = stats.end_ms - stats.start_ms;
+    uint32_t rate       = (elapsed_ms != 0U) ? (uint32_t)(((uint64_t)stats.samples * 1000U) / elapsed_ms) : 0U;
+
+    CLI_Print("\r\nReplay: %s, %s, %s\r\n",
+              stats.active ? (stats.done ? "done" : "running") : "stopped",
+              sourceNames[stats.source], (stats.pace == SENSOR_REPLAY_FAST) ? "fast" : "timed");
+    CLI_Print("  Samples: %lu in %lu ms (%lu/s), %lu queued\r\n",
+              (unsigned long)stats.samples, (unsigned long)elapsed_ms,
+              (unsigned long)rate, (unsigned long)stats.queued);
+}
+
+static void CLI_CmdCalib(uint32_t argc, char *argv[])
+{
+    if (argc > 1U)
+    {
+        uint8_t id;
+
+        if (!CLI_ParseSensorId(argv[1], &id))
+        {
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
+        }
+
+        if ((argc < 3U) || !CLI_CalibSensor(id, argc, argv))
+        {
+            CLI_PrintError("\r\nUsage: calib <id> poly <c0> <c1> [c2] [c3] | span <lo> <hi> | chan <n>\r\n"
+                           "       calib <id> point <true>|clear | fit [<degree>] | off\r\n");
+            return;
+        }
+    }
+
+    CLI_Print("\r\nCalibrations (c0 + c1 x + c2 x^2 + c3 x^3, x = raw reading):\r\n");
+    CLI_Print("  %3s %-12s %2s %-19s %9s %7s %6s\r\n",
+              "id", "name", "ch", "span", "corrected", "clipped", "builds");
+
+    for (uint32_t i = 0U; i < SENSOR_CALIB_MAX_SENSORS; ++i)
+    {
+        SensorCalibConfig_t cfg;
+        SensorCalibStats_t  stats;
+        uint8_t             id = 0U;
+
+        if (!SensorCalib_GetSlot(i, &id, &cfg, &stats))
+        {
+            continue;
+        }
+
+        const SensorEntry_t *entry = SensorRegistry_Find(id);
+        char                 span[24];
+
+        if (cfg.lo == cfg.hi)
+        {
+            (void)Fmt_Format(span, sizeof(span), "full");
+        }
+        else
+        {
+            (void)Fmt_Format(span, sizeof(span), "%.3f..%.3f", (double)cfg.lo, (double)cfg.hi);
+        }
+
+        CLI_Print("  %3u %-12s %2u %-19s %9lu %7lu %6lu\r\n", (unsigned)id,
+                  (entry != NULL) ? entry->name : "?", (unsigned)cfg.channel, span,
+                  (unsigned long)stats.corrected, (unsigned long)stats.clipped,
+                  (unsigned long)stats.builds);
+        CLI_Print("      c0 %.6f c1 %.6f c2 %.9f c3 %.9f\r\n", (double)cfg.coeff[0],
+                  (double)cfg.coeff[1], (double)cfg.coeff[2], (double)cfg.coeff[3]);
+
+        float raw;
+        float reference;
+        for (uint32_t p = 0U; SensorCalib_GetPoint(id, p, &raw, &reference); ++p)
+        {
+            float fitted = cfg.coeff[SENSOR_CALIB_TERMS - 1U];
+
+            for (uint32_t j = SENSOR_CALIB_TERMS - 1U; j > 0U; --j)
+            {
+                fitted = (fitted * raw) + cfg.coeff[j - 1U];
+            }
+            CLI_Print("      point %lu: raw %.3f true %.3f (fit %+.3f)\r\n", (unsigned long)p,
+                      (double)raw, (double)reference, (double)(fitted - reference));
+        }
+    }
+}
+
+static void CLI_CmdFilter(uint32_t argc, char *argv[])
+{
+    if (argc > 1U)
+    {
+        char                *end    = NULL;
+        unsigned long        window = 0UL;
+        uint8_t              id;
+        SensorFilterConfig_t cfg;
+
+        if (!CLI_ParseSensorId(argv[1], &id))
+        {
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
+        }
+
+        (void)SensorFilter_GetConfig(id, &cfg);
+
+        bool ok = true;
+        if ((argc == 4U) && ((strcmp(argv[2], "median") == 0) || (strcmp(argv[2], "avg") == 0)))
+        {
+            window = strtoul(argv[3], &end, 10);
+            ok     = (*end == '\0') && (end != argv[3]) && (window <= 0xFFUL);
+        }
+
+        if ((argc == 3U) && (strcmp(argv[2], "off") == 0))
+        {
+            memset(&cfg, 0, sizeof(cfg));
+        }
+        else if (ok && (argc == 4U) && (strcmp(argv[2], "median") == 0))
+        {
+            cfg.medianWindow = (uint8_t)window;
+        }
+        else if (ok && (argc == 4U) && (strcmp(argv[2], "avg") == 0))
+        {
+            cfg.averageWindow = (uint8_t)window;
+        }
+        else if ((argc == 4U) && (strcmp(argv[2], "iir") == 0))
+        {
+            ok = CLI_ParseFloat(argv[3], &cfg.iirAlpha);
+        }
+        else
+        {
+            ok = false;
+        }
 
-/**
- * @brief Trim leading and trailing whitespace from a string in-place.
- *
- * @param str Pointer to a modifiable null-terminated string.
- */
-static void CLI_Trim(char *str);
+        if (!ok || !SensorFilter_Configure(id, &cfg))
+        {
+            CLI_PrintError("\r\nUsage: filter <id> median <odd n<=%u> | avg <n<=%u> | iir <0..1> | off\r\n",
+                           (unsigned)SENSOR_FILTER_MEDIAN_MAX,
+                           (unsigned)SENSOR_FILTER_AVERAGE_MAX);
+            return;
+        }
+    }
 
-/* ------------------------------------------------------------------------- */
+    CLI_Print("\r\nFilters:\r\n");
+    CLI_Print("  %3s %-12s %6s %4s %6s\r\n", "id", "name", "median", "avg", "iir");
 
-void CLI_Init(UART_HandleTypeDef *huart)
-{
-    s_cliUart   = huart;
-    s_lineIndex = 0U;
-    memset(s_lineBuffer, 0, sizeof(s_lineBuffer));
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+        SensorFilterConfig_t cfg;
 
-    CLI_SendString("\r\nSmart Sensor Hub CLI ready.\r\n");
-    CLI_SendString("Type 'help' for a list of commands.\r\n");
-    CLI_PrintPrompt();
+        if (SensorFilter_GetConfig(entry->id, &cfg))
+        {
+            CLI_Print("  %3u %-12s %6u %4u %6.3f\r\n",
+                      (unsigned)entry->id,
+                      entry->name,
+                      (unsigned)cfg.medianWindow,
+                      (unsigned)cfg.averageWindow,
+                      (double)cfg.iirAlpha);
+        }
+    }
 }
 
-void CLI_Process(void)
+static void CLI_CmdDeadband(uint32_t argc, char *argv[])
 {
-    if (s_cliUart == NULL)
+    if (argc > 1U)
     {
-        return;
-    }
-
-    uint8_t ch;
+        SensorDeadbandConfig_t cfg = {0};
+        bool                   ok  = true;
+        uint8_t                id;
 
-    /* Poll for all available characters (non-blocking). */
-    while (HAL_UART_Receive(s_cliUart, &ch, 1U, 0U) == HAL_OK)
-    {
-        if ((ch == '\r') || (ch == '\n'))
+        if (!CLI_ParseSensorId(argv[1], &id))
         {
-            if (s_lineIndex > 0U)
-            {
-                s_lineBuffer[s_lineIndex] = '\0';
-                CLI_SendString("\r\n");
-                CLI_HandleLine(s_lineBuffer);
-                s_lineIndex = 0U;
-                memset(s_lineBuffer, 0, sizeof(s_lineBuffer));
-            }
-            CLI_PrintPrompt();
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
         }
-        else if ((ch == '\b') || (ch == 0x7FU))
+
+        if ((argc == 3U) && (strcmp(argv[2], "off") == 0))
         {
-            if (s_lineIndex > 0U)
-            {
-                s_lineIndex--;
-                s_lineBuffer[s_lineIndex] = '\0';
-                const char bsSeq[] = "\b \b";
-                CLI_SendString(bsSeq);
-            }
+            /* All zero: pass every sample. */
         }
-        else if ((ch >= 32U) && (ch < 127U))
+        else if ((argc == 3U) || (argc == 4U))
         {
-            if (s_lineIndex < (CLI_MAX_LINE_LENGTH - 1U))
+            ok = CLI_ParseFloat(argv[2], &cfg.deadband);
+            if (ok && (argc == 4U))
             {
-                s_lineBuffer[s_lineIndex++] = (char)ch;
-                (void)HAL_UART_Transmit(s_cliUart, &ch, 1U, HAL_MAX_DELAY);
+                char         *end     = NULL;
+                unsigned long silence = strtoul(argv[3], &end, 10);
+
+                ok = (*end == '\0') && (end != argv[3]);
+                cfg.maxSilence_ms = (uint32_t)silence;
             }
         }
         else
         {
-            /* Ignore non-printable control characters. */
+            ok = false;
+        }
+
+        if (!ok || !SensorDeadband_Configure(id, &cfg))
+        {
+            CLI_PrintError("\r\nUsage: deadband <id> <delta> [silence_ms] | deadband <id> off\r\n");
+            return;
+        }
+    }
+
+    CLI_Print("\r\nDeadband:\r\n");
+    CLI_Print("  %3s %-12s %8s %10s %9s %10s\r\n",
+              "id", "name", "delta", "silence", "reported", "suppressed");
+
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
+    {
+        const SensorEntry_t   *entry = SensorRegistry_GetByIndex(i);
+        SensorDeadbandConfig_t cfg;
+        SensorDeadbandStats_t  stats;
+
+        if (SensorDeadband_Get(entry->id, &cfg, &stats))
+        {
+            CLI_Print("  %3u %-12s %8.3f %10lu %9lu %10lu\r\n",
+                      (unsigned)entry->id,
+                      entry->name,
+                      (double)cfg.deadband,
+                      (unsigned long)cfg.maxSilence_ms,
+                      (unsigned long)stats.reported,
+                      (unsigned long)stats.suppressed);
         }
     }
 }
 
-void CLI_Print(const char *fmt, ...)
+static void CLI_CmdStats(uint32_t argc, char *argv[])
 {
-    if (s_cliUart == NULL)
+    if (argc > 1U)
     {
-        return;
-    }
+        char               *end = NULL;
+        SensorStatsConfig_t cfg = {0};
+        bool                ok  = true;
+        uint8_t             id;
 
-    char buffer[128];
+        if (!CLI_ParseSensorId(argv[1], &id))
+        {
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
+        }
 
-    va_list args;
-    va_start(args, fmt);
-    (void)vsnprintf(buffer, sizeof(buffer), fmt, args);
-    va_end(args);
+        if ((argc == 3U) && (strcmp(argv[2], "off") == 0))
+        {
+            /* Window 0: remove the configuration. */
+        }
+        else if ((argc == 3U) || (argc == 4U))
+        {
+            unsigned long window = strtoul(argv[2], &end, 10);
 
-    CLI_SendString(buffer);
-}
+            ok = (*end == '\0') && (end != argv[2]) && (window > 0UL) && (window <= 86400UL);
+            cfg.window_ms = (uint32_t)window * 1000U;
 
-/* ------------------------------------------------------------------------- */
-/*                          Internal Helper Functions                        */
-/* ------------------------------------------------------------------------- */
+            if (ok && (argc == 4U))
+            {
+                unsigned long pct = (argv[3][0] == 'p') ? strtoul(&argv[3][1], &end, 10) : 0UL;
 
-static void CLI_SendString(const char *str)
-{
-    if ((s_cliUart == NULL) || (str == NULL))
-    {
-        return;
-    }
+                ok = (argv[3][0] == 'p') && (*end == '\0') && (end != &argv[3][1]) &&
+                     (pct >= 1UL) && (pct <= 99UL);
+                cfg.percentile = (uint8_t)pct;
+            }
+        }
+        else
+        {
+            ok = false;
+        }
 
-    size_t len = strlen(str);
-    if (len > 0U)
-    {
-        (void)HAL_UART_Transmit(s_cliUart,
-                                (uint8_t *)str,
-                                (uint16_t)len,
-                                HAL_MAX_DELAY);
+        if (!ok || !SensorStats_Configure(id, &cfg))
+        {
+            CLI_PrintError("\r\nUsage: stats <id> <window_s> [p<1..99>] | stats <id> off\r\n");
+            return;
+        }
     }
-}
 
-static void CLI_PrintPrompt(void)
-{
-    CLI_SendString("\r\n> ");
-}
+    CLI_Print("\r\nStatistics:\r\n");
+    CLI_Print("  %3s %-12s %8s %4s %8s %8s\r\n",
+              "id", "name", "window", "pct", "windows", "samples");
 
-static void CLI_ToLower(char *str)
-{
-    if (str == NULL)
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
     {
-        return;
-    }
+        const SensorEntry_t *entry = SensorRegistry_GetByIndex(i);
+        SensorStatsConfig_t  cfg;
+        SensorStatsStats_t   stats;
 
-    for (char *p = str; *p != '\0'; ++p)
-    {
-        if ((*p >= 'A') && (*p <= 'Z'))
+        if (SensorStats_Get(entry->id, &cfg, &stats))
         {
-            *p = (char)(*p - 'A' + 'a');
+            CLI_Print("  %3u %-12s %7lus %4u %8lu %8lu\r\n",
+                      (unsigned)entry->id,
+                      entry->name,
+                      (unsigned long)(cfg.window_ms / 1000U),
+                      (unsigned)cfg.percentile,
+                      (unsigned long)stats.windows,
+                      (unsigned long)stats.samples);
         }
     }
 }
 
-static void CLI_Trim(char *str)
+static void CLI_CmdSpectrum(uint32_t argc, char *argv[])
 {
-    if (str == NULL)
+    if (argc > 1U)
     {
-        return;
-    }
+        char                  *end = NULL;
+        SensorSpectrumConfig_t cfg = {0};
+        bool                   ok  = true;
+        uint8_t                id;
 
-    char *start = str;
-    while ((*start == ' ') || (*start == '\t'))
-    {
-        start++;
-    }
+        if (!CLI_ParseSensorId(argv[1], &id))
+        {
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
+        }
 
-    char *end = start + strlen(start);
-    while ((end > start) && (((unsigned char)*(end - 1U) == ' ') ||
-                             ((unsigned char)*(end - 1U) == '\t')))
-    {
-        end--;
-    }
-    *end = '\0';
+        if ((argc == 3U) && (strcmp(argv[2], "off") == 0))
+        {
+            /* Length 0: remove the configuration. */
+        }
+        else if ((argc == 3U) || (argc == 4U))
+        {
+            unsigned long points = strtoul(argv[2], &end, 10);
+            unsigned long bands  = 4UL;
 
-    if (start != str)
-    {
-        memmove(str, start, (size_t)(end - start) + 1U);
-    }
-}
+            ok = (*end == '\0') && (end != argv[2]) && (points > 0UL) && (points <= 0xFFFFUL);
+            if (ok && (argc == 4U))
+            {
+                bands = strtoul(argv[3], &end, 10);
+                ok    = (*end == '\0') && (end != argv[3]) && (bands <= 0xFFUL);
+            }
+            cfg.points = (uint16_t)points;
+            cfg.bands  = (uint8_t)bands;
+        }
+        else
+        {
+            ok = false;
+        }
 
-static void CLI_HandleLine(char *line)
-{
-    if (line == NULL)
-    {
-        return;
+        if (!ok || !SensorSpectrum_Configure(id, &cfg))
+        {
+            CLI_PrintError("\r\nUsage: spectrum <id> <points 16..256, power of 2> [<bands 1..%u>] | "
+                           "spectrum <id> off\r\n", (unsigned)SENSOR_SPECTRUM_MAX_BANDS);
+            return;
+        }
     }
 
-    CLI_Trim(line);
-    CLI_ToLower(line);
+    CLI_Print("\r\nSpectrum:\r\n");
+    CLI_Print("  %3s %-12s %6s %5s %8s %8s %8s %8s %8s\r\n",
+              "id", "name", "points", "bands", "windows", "samples", "restarts", "last_us", "max_us");
 
-    if (strlen(line) == 0U)
+    for (uint32_t i = 0U; i < SensorRegistry_GetCount(); ++i)
     {
-        return;
-    }
+        const SensorEntry_t   *entry = SensorRegistry_GetByIndex(i);
+        SensorSpectrumConfig_t cfg;
+        SensorSpectrumStats_t  stats;
 
-    if (strcmp(line, "help") == 0)
-    {
-        CLI_Print("\r\nAvailable commands:\r\n");
-        CLI_Print("  help            - Show this help text\r\n");
-        CLI_Print("  log off         - Disable all task logging\r\n");
-        CLI_Print("  log error       - Task logs at ERROR level only\r\n");
-        CLI_Print("  log warn        - Task logs at WARN and above\r\n");
-        CLI_Print("  log info        - Task logs at INFO and above\r\n");
-        CLI_Print("  log debug       - Task logs at DEBUG and above\r\n");
-        CLI_Print("  log pause       - Temporarily pause all task logs\r\n");
-        CLI_Print("  log resume      - Resume task logs to previous state\r\n");
-        CLI_Print("  pmode active    - Request POWER_MODE_ACTIVE\r\n");
-        CLI_Print("  pmode idle      - Request POWER_MODE_IDLE\r\n");
-        CLI_Print("  pmode sleep     - Request POWER_MODE_SLEEP\r\n");
-        CLI_Print("  pmode stop      - Request POWER_MODE_STOP\r\n");
-        CLI_Print("  status          - Show logging and power status\r\n");
-        return;
+        if (SensorSpectrum_Get(entry->id, &cfg, &stats))
+        {
+            CLI_Print("  %3u %-12s %6u %5u %8lu %8lu %8lu %8lu %8lu\r\n",
+                      (unsigned)entry->id,
+                      entry->name,
+                      (unsigned)cfg.points,
+                      (unsigned)cfg.bands,
+                      (unsigned long)stats.windows,
+                      (unsigned long)stats.samples,
+                      (unsigned long)stats.restarts,
+                      (unsigned long)CycleCounter_ToUs(stats.lastCycles),
+                      (unsigned long)CycleCounter_ToUs(stats.maxCycles));
+        }
     }
+}
 
-    if (strncmp(line, "log ", 4) == 0)
+static void CLI_CmdAlarm(uint32_t argc, char *argv[])
+{
+    if ((argc == 3U) && (strcmp(argv[1], "del") == 0))
     {
-        char *arg = line + 4;
-        CLI_Trim(arg);
+        char             *end  = NULL;
+        unsigned long     n    = strtoul(argv[2], &end, 10);
+        SensorAlarmRule_t none = {0};
 
-        if (strcmp(arg, "off") == 0)
-        {
-            Log_Enable(false);
-            s_logPaused = false; /* explicit off overrides pause logic */
-            CLI_Print("\r\nTask logging disabled.\r\n");
-        }
-        else if (strcmp(arg, "error") == 0)
-        {
-            Log_SetLevel(LOG_LEVEL_ERROR);
-            Log_Enable(true);
-            s_logPaused = false;
-            CLI_Print("\r\nTask logging enabled, level=ERROR.\r\n");
-        }
-        else if (strcmp(arg, "warn") == 0)
-        {
-            Log_SetLevel(LOG_LEVEL_WARN);
-            Log_Enable(true);
-            s_logPaused = false;
-            CLI_Print("\r\nTask logging enabled, level=WARN.\r\n");
-        }
-        else if (strcmp(arg, "info") == 0)
+        if ((*end != '\0') || (end == argv[2]) || !SensorAlarm_GetRule((uint32_t)n, NULL, NULL) ||
+            !SensorAlarm_SetRule((uint32_t)n, &none))
         {
-            Log_SetLevel(LOG_LEVEL_INFO);
-            Log_Enable(true);
-            s_logPaused = false;
-            CLI_Print("\r\nTask logging enabled, level=INFO.\r\n");
+            CLI_Print("\r\nNo alarm rule %s\r\n", argv[2]);
+            return;
         }
-        else if (strcmp(arg, "debug") == 0)
+    }
+    else if (argc > 1U)
+    {
+        char             *end  = NULL;
+        SensorAlarmRule_t rule = {0};
+        bool              ok   = (argc >= 4U) && (argc <= 6U);
+
+        if (!CLI_ParseSensorId(argv[1], &rule.sensorId))
         {
-            Log_SetLevel(LOG_LEVEL_DEBUG);
-            Log_Enable(true);
-            s_logPaused = false;
-            CLI_Print("\r\nTask logging enabled, level=DEBUG.\r\n");
+            CLI_PrintError("\r\nNo sensor %s\r\n", argv[1]);
+            return;
         }
-        else if (strcmp(arg, "pause") == 0)
+
+        if (ok)
         {
-            if (!s_logPaused)
+            for (uint8_t k = (uint8_t)SENSOR_ALARM_HIGH; k < (uint8_t)SENSOR_ALARM_KIND_COUNT; ++k)
             {
-                s_prevLogEnabled = Log_IsEnabled();
-                s_prevLogLevel   = Log_GetLevel();
-                Log_Enable(false);
-                s_logPaused = true;
-                CLI_Print("\r\nTask logging paused. Use 'log resume' to restore.\r\n");
-            }
-            else
-            {
-                CLI_Print("\r\nTask logging is already paused.\r\n");
+                if (strcmp(argv[2], SensorAlarm_KindName(k)) == 0)
+                {
+                    rule.kind = k;
+                }
             }
+
+            rule.threshold = strtof(argv[3], &end);
+            ok = (rule.kind != (uint8_t)SENSOR_ALARM_NONE) && (end != argv[3]) && (*end == '\0');
         }
-        else if (strcmp(arg, "resume") == 0)
+
+        for (uint32_t a = 4U; ok && (a < argc); ++a)
         {
-            if (s_logPaused)
+            if (strcmp(argv[a], "wake") == 0)
             {
-                Log_SetLevel(s_prevLogLevel);
-                Log_Enable(s_prevLogEnabled);
-                s_logPaused = false;
-                CLI_Print("\r\nTask logging resumed.\r\n");
+                rule.wake = true;
             }
             else
             {
-                CLI_Print("\r\nTask logging is not paused.\r\n");
+                rule.hysteresis = strtof(argv[a], &end);
+                ok = (end != argv[a]) && (*end == '\0');
             }
         }
-        else
+
+        if (!ok)
         {
-            CLI_Print("\r\nUnknown log option '%s'. Type 'help'.\r\n", arg);
+            CLI_PrintError("\r\nUsage: alarm <id> high|low|rate <thr> [hyst] [wake] | alarm del <n>\r\n");
+            return;
         }
 
-        return;
+        if (SensorAlarm_AddRule(&rule) < 0)
+        {
+            CLI_PrintError("\r\nAlarm rule rejected (invalid or table full)\r\n");
+            return;
+        }
     }
 
-    if (strncmp(line, "pmode ", 6) == 0)
-    {
-        char *arg = line + 6;
-        CLI_Trim(arg);
+    CLI_Print("\r\nAlarm rules (%lu events dropped):\r\n",
+              (unsigned long)SensorAlarm_GetDroppedCount());
+    CLI_Print("  %2s %3s %-12s %-4s %9s %8s %4s %6s %6s %9s\r\n",
+              "n", "id", "name", "kind", "threshold", "hyst", "wake", "state", "raised", "value");
 
-        PowerMode_t requested = POWER_MODE_ACTIVE;
-        bool valid = true;
+    for (uint32_t i = 0U; i < SENSOR_ALARM_MAX_RULES; ++i)
+    {
+        SensorAlarmRule_t   rule;
+        SensorAlarmStatus_t status;
 
-        if (strcmp(arg, "active") == 0)
-        {
-            requested = POWER_MODE_ACTIVE;
-        }
-        else if (strcmp(arg, "idle") == 0)
-        {
-            requested = POWER_MODE_IDLE;
-        }
-        else if (strcmp(arg, "sleep") == 0)
+        if (SensorAlarm_GetRule(i, &rule, &status))
         {
-            requested = POWER_MODE_SLEEP;
+            const SensorEntry_t *entry = SensorRegistry_Find(rule.sensorId);
+
+            CLI_Print("  %2lu %3u %-12s %-4s %9.3f %8.3f %4s %6s %6lu %9.3f\r\n",
+                      (unsigned long)i,
+                      (unsigned)rule.sensorId,
+                      (entry != NULL) ? entry->name : "?",
+                      SensorAlarm_KindName(rule.kind),
+                      (double)rule.threshold,
+                      (double)rule.hysteresis,
+                      rule.wake ? "yes" : "no",
+                      status.active ? "RAISED" : "ok",
+                      (unsigned long)status.raised,
+                      (double)status.value);
         }
-        else if (strcmp(arg, "stop") == 0)
+    }
+}
+
+static void CLI_CmdTelem(uint32_t argc, char *argv[])
+{
+    const char *arg = (argc > 1U) ? argv[1] : "";
+
+    if (strcmp(arg, "on") == 0)
+    {
+        Telemetry_SetEnabled(true);
+    }
+    else if (strcmp(arg, "off") == 0)
+    {
+        Telemetry_SetEnabled(false);
+    }
+    else if (strcmp(arg, "f32") == 0)
+    {
+        Telemetry_SetFormat(TELEMETRY_FORMAT_F32);
+    }
+    else if (strcmp(arg, "i16") == 0)
+    {
+        Telemetry_SetFormat(TELEMETRY_FORMAT_I16);
+    }
+    else if (strcmp(arg, "delta") == 0)
+    {
+        Telemetry_SetFormat(TELEMETRY_FORMAT_DELTA);
+    }
+    else if (strcmp(arg, "xor") == 0)
+    {
+        Telemetry_SetFormat(TELEMETRY_FORMAT_XOR);
+    }
+    else if (strcmp(arg, "raw") == 0)
+    {
+        Telemetry_SetFormat(TELEMETRY_FORMAT_RAW);
+    }
+    else if ((strcmp(arg, "baud") == 0) && (argc == 3U))
+    {
+        char         *end  = NULL;
+        unsigned long baud = strtoul(argv[2], &end, 10);
+
+        if (!TelemetryUart_IsActive())
         {
-            requested = POWER_MODE_STOP;
+            CLI_Print("\r\nTelemetry shares the console (TELEMETRY_UART_ENABLE=0).\r\n");
+            return;
         }
-        else
+        if ((end == argv[2]) || (*end != '\0') || (baud == 0UL) ||
+            !TelemetryUart_SetBaudRate((uint32_t)baud))
         {
-            valid = false;
+            CLI_PrintError("\r\nTelemetry UART: %s baud not reachable at %lu MHz within %u.%u %%.\r\n",
+                           argv[2], (unsigned long)(HAL_RCC_GetPCLK2Freq() / 1000000U),
+                           (unsigned)(CONSOLE_BAUD_TOLERANCE_PPT / 10U),
+                           (unsigned)(CONSOLE_BAUD_TOLERANCE_PPT % 10U));
+            return;
         }
+    }
+    else if (arg[0] != '\0')
+    {
+        CLI_PrintError("\r\nUsage: telem [on | off | f32 | i16 | delta | xor | raw | baud <rate>]\r\n");
+        return;
+    }
 
-        if (valid)
-        {
-            PowerManager_RequestMode(requested);
-            CLI_Print("\r\nRequested power mode change: %s\r\n", arg);
-        }
-        else
+    TelemetryStats_t stats;
+    Telemetry_GetStats(&stats);
+
+    CLI_Print("\r\nTelemetry: %s, format %s\r\n",
+              Telemetry_IsEnabled() ? "ON" : "OFF",
+              Telemetry_GetFormatName(Telemetry_GetFormat()));
+    CLI_Print("  Frames: %lu (dropped %lu), records %lu, bytes %lu\r\n",
+              (unsigned long)stats.frames,
+              (unsigned long)stats.droppedFrames,
+              (unsigned long)stats.records,
+              (unsigned long)stats.bytes);
+
+    if (TelemetryUart_IsActive())
+    {
+        CLI_Print("  Port: USART1, %lu baud (actual %lu), %lu bytes dropped\r\n",
+                  (unsigned long)TelemetryUart_GetBaudRate(),
+                  (unsigned long)TelemetryUart_GetActualBaud(),
+                  (unsigned long)TelemetryUart_GetDroppedBytes());
+    }
+    else
+    {
+        CLI_Print("  Port: console\r\n");
+    }
+}
+
+static void CLI_CmdFlashLog(uint32_t argc, char *argv[])
+{
+    const char *args = (argc > 1U) ? argv[1] : "";
+
+    if (strcmp(args, "on") == 0)
+    {
+        FlashLog_SetEnabled(true);
+    }
+    else if (strcmp(args, "off") == 0)
+    {
+        FlashLog_SetEnabled(false);
+    }
+    else if (strcmp(args, "flush") == 0)
+    {
+        FlashLog_Flush();
+    }
+    else if (strcmp(args, "erase") == 0)
+    {
+        if (!FlashLog_EraseAll())
         {
-            CLI_Print("\r\nUnknown power mode '%s'. Type 'help'.\r\n", arg);
+            CLI_PrintError("\r\nFlash log erase failed.\r\n");
         }
+    }
+    else if (args[0] != '\0')
+    {
+        CLI_PrintError("\r\nUsage: flashlog [on | off | flush | erase]\r\n");
+        return;
+    }
+
+    FlashLogStats_t stats;
+    FlashLog_GetStats(&stats);
+
+    CLI_Print("\r\nFlash log: %s%s\r\n",
+              FlashLog_IsEnabled() ? "ON" : "OFF",
+              FlashLog_IsDumping() ? " (dumping)" : "");
+    CLI_Print("  Pages: %lu/%lu used, %lu queued, newest seq %lu\r\n",
+              (unsigned long)stats.pagesUsed,
+              (unsigned long)stats.pagesTotal,
+              (unsigned long)stats.pagesQueued,
+              (unsigned long)stats.newestSeq);
+    CLI_Print("  Since boot: %lu samples, %lu pages written, %lu dropped, %lu erases, %lu errors\r\n",
+              (unsigned long)stats.samples,
+              (unsigned long)stats.pagesWritten,
+              (unsigned long)stats.pagesDropped,
+              (unsigned long)stats.erases,
+              (unsigned long)stats.errors);
+}
+
+static void CLI_CmdDump(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    FlashLog_Flush();
+    uint32_t slots = FlashLog_StartDump();
+    if (slots == 0U)
+    {
+        CLI_PrintError("\r\nFlash log dump not started (busy or unavailable).\r\n");
+    }
+    else
+    {
+        CLI_Print("\r\nDumping flash log (%lu slots)...\r\n", (unsigned long)slots);
+    }
+}
+
+static void CLI_CmdPools(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    CLI_Print("\r\nMemory pools:\r\n");
+    CLI_Print("  %-7s %6s %6s %6s %6s %8s %6s %6s\r\n",
+              "class", "size", "blocks", "used", "peak", "allocs", "spills", "fails");
+
+    for (uint32_t i = 0U; i < (uint32_t)MEM_POOL_CLASS_COUNT; ++i)
+    {
+        MemPoolStats_t stats;
+        (void)MemPool_GetStats((MemPoolClass_t)i, &stats);
+
+        CLI_Print("  %-7s %6lu %6lu %6lu %6lu %8lu %6lu %6lu\r\n",
+                  stats.name,
+                  (unsigned long)stats.blockSize,
+                  (unsigned long)stats.blocks,
+                  (unsigned long)stats.inUse,
+                  (unsigned long)stats.highWater,
+                  (unsigned long)stats.allocs,
+                  (unsigned long)stats.spills,
+                  (unsigned long)stats.failures);
+    }
+}
+
+static void CLI_CmdMem(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
 
+    MemMapUsage_t usage;
+    MemMap_GetUsage(&usage);
+
+    uint32_t poolBytes = 0U;
+    for (uint32_t i = 0U; i < (uint32_t)MEM_POOL_CLASS_COUNT; ++i)
+    {
+        MemPoolStats_t stats;
+        (void)MemPool_GetStats((MemPoolClass_t)i, &stats);
+        poolBytes += stats.blockSize * stats.blocks;
+    }
+
+    CLI_Print("\r\nRAM: %lu bytes\r\n", (unsigned long)usage.ramTotal);
+    CLI_Print("  .ramfunc: %lu\r\n", (unsigned long)usage.ramfuncBytes);
+    CLI_Print("  .data: %lu\r\n", (unsigned long)usage.dataBytes);
+    CLI_Print("  .bss:  %lu (memory pools %lu)\r\n",
+              (unsigned long)usage.bssBytes, (unsigned long)poolBytes);
+    CLI_Print("  Heap:  %lu used, %lu reserved\r\n",
+              (unsigned long)usage.heapBytes, (unsigned long)usage.heapReserved);
+    CLI_Print("  Stack: %lu now, %lu peak, %lu reserved%s\r\n",
+              (unsigned long)usage.stackCurrent,
+              (unsigned long)usage.stackPeak,
+              (unsigned long)usage.stackReserved,
+              (usage.stackPeak > usage.stackReserved) ? " (OVER RESERVE)" : "");
+    CLI_Print("  Free:  %lu%s\r\n",
+              (unsigned long)usage.freeBytes,
+              usage.collided ? " (STACK REACHED HEAP)"
+                             : (usage.painted ? "" : " (stack not painted)"));
+}
+
+static void CLI_CmdCrash(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "clear") == 0))
+    {
+        CrashLog_Clear();
+        CLI_Print("\r\nCrash trace cleared; recording this boot.\r\n");
         return;
     }
 
-    if (strcmp(line, "status") == 0)
+    if ((argc > 2U) || ((argc == 2U) && (strcmp(argv[1], "all") != 0)))
     {
-        PowerMode_t mode   = PowerManager_GetCurrentMode();
-        LogLevel_t  level  = Log_GetLevel();
-        bool        enable = Log_IsEnabled();
+        CLI_PrintError("\r\nUsage: crash [all|clear]\r\n");
+        return;
+    }
 
-        uint32_t period_ms = 0U;
-        switch (mode)
-        {
-            case POWER_MODE_ACTIVE:
-                period_ms = SENSOR_PERIOD_ACTIVE_MS;
-                break;
-            case POWER_MODE_IDLE:
-                period_ms = SENSOR_PERIOD_IDLE_MS;
-                break;
-            case POWER_MODE_SLEEP:
-                period_ms = SENSOR_PERIOD_SLEEP_MS;
-                break;
-            case POWER_MODE_STOP:
-            default:
-                period_ms = SENSOR_PERIOD_STOP_MS;
-                break;
-        }
+    CrashLog_Print(argc == 2U);
+}
+
+static void CLI_CmdBoot(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    BootTime_Print();
+}
+
+static void CLI_CmdBatch(uint32_t argc, char *argv[])
+{
+    (void)argv;
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: batch\r\n");
+        return;
+    }
 
-        CLI_Print("\r\nStatus:\r\n");
-        CLI_Print("  Task logging: %s\r\n", enable ? "ENABLED" : "DISABLED");
-        CLI_Print("  LogLevel: %d (0=DEBUG,1=INFO,2=WARN,3=ERROR)\r\n", (int)level);
-        CLI_Print("  PowerMode: %d (0=ACTIVE,1=IDLE,2=SLEEP,3=STOP)\r\n", (int)mode);
-        CLI_Print("  Sensor sample period: %lu ms\r\n", (unsigned long)period_ms);
+    if (s_batch.active)
+    {
+        CLI_PrintError("\r\nA script is already running.\r\n");
         return;
     }
 
-    CLI_Print("\r\nUnknown command '%s'. Type 'help'.\r\n", line);
+    /* The script follows in the input: no prompt, no echo, and commands
+     * print nothing but their errors until the summary.
+     */
+    memset(&s_batch, 0, sizeof(s_batch));
+    s_batch.active    = true;
+    s_batch.overflows = s_rxOverflows;
+    s_batch.start_us  = Time_NowUs32();
+    s_batch.last_us   = s_batch.start_us;
+    s_batch.input_ms  = HAL_GetTick();
 }
 
 /**
@@ -436,14 +3095,17 @@ void CLI_OnExternalOutput(void)
         return;
     }
 
-    /* Move cursor to beginning and reprint prompt + partial command. */
-    CLI_SendString("\r> ");
-
-    if (s_lineIndex > 0U)
+    /* Redrawn by the next CLI_Process(); only the first line of a burst
+     * has to schedule it.
+     */
+    if (!s_promptDirty)
     {
-        (void)HAL_UART_Transmit(s_cliUart,
-                                (uint8_t *)s_lineBuffer,
-                                (uint16_t)s_lineIndex,
-                                HAL_MAX_DELAY);
+        s_promptDirty = true;
+
+        CLI_RxHook_t hook = s_rxHook;
+        if (hook != NULL)
+        {
+            hook();
+        }
     }
 }
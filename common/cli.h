@@ -16,6 +16,9 @@ extern "C" {
 #endif
 
 #include "stm32f4xx_hal.h"
+#include "stream.h"
+#include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @defgroup cli Command Line Interface
@@ -24,29 +27,214 @@ extern "C" {
  * @{
  */
 
+/**
+ * @brief Maximum number of registered commands.
+ */
+#define CLI_MAX_COMMANDS   (64U)
+
+/**
+ * @brief Maximum number of tokens in a command line, including the name.
+ */
+#define CLI_MAX_ARGS       (8U)
+
+/**
+ * @brief Command handler.
+ *
+ * @param argc Number of tokens, at least 1.
+ * @param argv Lower-cased tokens; argv[0] is the command name. The strings
+ *             may be modified but are only valid during the call.
+ */
+typedef void (*CLI_CommandHandler_t)(uint32_t argc, char *argv[]);
+
+/**
+ * @brief One command table entry.
+ */
+typedef struct
+{
+    const char          *name;    /**< Lower-case command name.                       */
+    CLI_CommandHandler_t handler; /**< Called with the tokenized line.                */
+    const char          *help;    /**< "args - description"; '\n' separates lines.    */
+} CLI_Command_t;
+
 /**
  * @brief Initialize the CLI module.
  *
- * Must be called once after the UART handle is configured. Prints a
- * welcome banner and prompt.
+ * Must be called once after the UART handle and the transport of @p out
+ * are configured. Prints nothing; the banner follows with
+ * CLI_PrintBanner() once the first sample has been taken.
  *
- * @param huart Pointer to the UART handle used for CLI I/O.
+ * @param huart UART handle the CLI receives from (RX DMA).
+ * @param out   Stream for CLI output, normally
+ *              UartTx_GetStream(UART_TX_STREAM_CLI).
  *
  * @return None.
  */
-void CLI_Init(UART_HandleTypeDef *huart);
+void CLI_Init(UART_HandleTypeDef *huart, const Stream_t *out);
 
 /**
- * @brief Periodic CLI processing function.
+ * @brief Print the welcome banner and the prompt.
  *
- * Should be called frequently (e.g. every 20 ms) from a scheduled task.
- * Polls the UART for incoming characters, builds command lines, and
- * executes commands when a full line is received.
+ * Queued in the TX ring like any other output; the caller does not wait
+ * for it to be sent.
+ *
+ * @return None.
+ */
+void CLI_PrintBanner(void);
+
+/**
+ * @brief Add a command to the CLI.
+ *
+ * The table is kept sorted, so lines are dispatched by binary search and
+ * `help` lists the commands alphabetically. Any module may register its
+ * own commands, before or after CLI_Init(). Call from thread mode.
+ *
+ * @param name    Lower-case command name (string must stay valid).
+ * @param handler Handler called with the tokenized line.
+ * @param help    Help text "args - description", or NULL.
+ *
+ * @return false if the table is full, the name is taken or invalid.
+ */
+bool CLI_RegisterCommand(const char *name, CLI_CommandHandler_t handler, const char *help);
+
+/**
+ * @brief CLI processing function.
+ *
+ * Should be called from a scheduled task, either periodically (e.g. every
+ * 20 ms) or when the receive hook (CLI_SetRxHook()) reports new input.
+ * Reception itself runs in the background (circular DMA plus UART
+ * IDLE-line interrupt into a software ring); this function consumes the
+ * buffered characters, echoes them, and executes commands when a full
+ * line has been received. It returns immediately when nothing arrived.
  *
  * @return None.
  */
 void CLI_Process(void);
 
+/**
+ * @brief Check whether received characters are waiting to be processed.
+ *
+ * Cheap enough to call from the scheduler or an idle hook to decide
+ * whether the CLI task needs to run.
+ *
+ * @return true if CLI_Process() has input to consume.
+ */
+bool CLI_IsInputPending(void);
+
+/**
+ * @brief Execute one command line as if it had been typed.
+ *
+ * Tokenizes @p line in place and dispatches it like a line received on
+ * the UART, without echo or prompt. Used by the benchmark suite to time
+ * command dispatch. Call from thread mode.
+ *
+ * @param line NUL-terminated command line; modified.
+ *
+ * @return None.
+ */
+void CLI_ExecuteLine(char *line);
+
+/**
+ * @brief Hook called when CLI_Process() has work: from the UART interrupt
+ *        when received bytes were added to the RX ring, and from
+ *        CLI_OnExternalOutput() when the prompt needs redrawing.
+ */
+typedef void (*CLI_RxHook_t)(void);
+
+/**
+ * @brief Install the receive hook, e.g. to post a scheduler event.
+ *
+ * The hook may run in interrupt context and must be short.
+ *
+ * @param hook Function to call, or NULL to remove it.
+ *
+ * @return None.
+ */
+void CLI_SetRxHook(CLI_RxHook_t hook);
+
+/**
+ * @brief Consumer of raw input (binary transfers).
+ */
+typedef void (*CLI_InputHandler_t)(uint8_t ch);
+
+/**
+ * @brief Divert received bytes from the line editor to a handler.
+ *
+ * While a handler is installed, CLI_Process() hands it every received
+ * byte instead of editing and executing lines: nothing is echoed and the
+ * prompt is not redrawn. Used for binary transfers over the console
+ * (UART or USB). The handler runs in thread mode and may print replies.
+ *
+ * @param handler Function to call, or NULL to return to the line editor.
+ *
+ * @return None.
+ */
+void CLI_SetInputHandler(CLI_InputHandler_t handler);
+
+/**
+ * @brief Number of received bytes lost because the RX ring was full.
+ *
+ * @return Overflow count since CLI_Init().
+ */
+uint32_t CLI_GetRxOverflowCount(void);
+
+/**
+ * @brief Receive errors reported by the console USART.
+ */
+typedef struct
+{
+    uint32_t framing; /**< Stop bit missing (FE): wrong rate or too fast.  */
+    uint32_t overrun; /**< Byte lost before the DMA read it (ORE).       */
+    uint32_t noise;   /**< Samples of one bit disagreed (NE).            */
+    uint32_t parity;  /**< Parity mismatch (PE).                         */
+} CLI_UartErrors_t;
+
+/**
+ * @brief Get the receive error counters.
+ *
+ * @param[out] errors Receives the counts since CLI_Init().
+ *
+ * @return None.
+ */
+void CLI_GetUartErrors(CLI_UartErrors_t *errors);
+
+/**
+ * @brief Prepare reception after the MCU woke from STOP on UART RX.
+ *
+ * The USART has no clock at the start bit of the character that wakes
+ * the MCU, so it either loses that character or resynchronizes on a
+ * later edge inside it and receives one garbage byte. The next receive
+ * event drops a byte that, by its timing, can only be that remainder;
+ * a byte the sender started after the wake is kept. Reception is
+ * restarted if a UART error had stopped it.
+ *
+ * Called by the power manager with interrupts masked, once the clocks
+ * are restored.
+ *
+ * @return None.
+ */
+void CLI_OnUartWake(void);
+
+/**
+ * @brief Number of garbled wake characters dropped.
+ *
+ * @return Count since CLI_Init().
+ */
+uint32_t CLI_GetWakeDropCount(void);
+
+/**
+ * @brief Feed input that arrived on another transport (USB CDC console).
+ *
+ * Bytes join the receive ring behind the UART input and are processed by
+ * CLI_Process() the same way. Call from the one interrupt that owns the
+ * transport; bytes that do not fit count as overflows.
+ *
+ * @param data Received bytes.
+ * @param len  Number of bytes.
+ *
+ * @return None.
+ */
+void CLI_Receive(const uint8_t *data, size_t len);
+
 /**
  * @brief Print a formatted message to the CLI UART.
  *
@@ -60,11 +248,69 @@ void CLI_Process(void);
  */
 void CLI_Print(const char *fmt, ...);
 
+/**
+ * @brief Print the message of a failed command (usage or value error).
+ *
+ * Printed like CLI_Print() at the prompt. In a script run by `batch`,
+ * where other command output is dropped, it marks the command as failed
+ * and its first line is reported as
+ * `#batch,fail,line=<n>,<message>`. Command handlers use it for every
+ * message that means the command did nothing.
+ *
+ * @param fmt printf-style format string.
+ * @param ... Arguments for the format string.
+ *
+ * @return None.
+ */
+void CLI_PrintError(const char *fmt, ...);
+
+/**
+ * @brief Send constant text to the CLI UART without formatting it.
+ *
+ * Text of @ref UART_TX_REF_MIN bytes or more is sent by reference, by DMA
+ * straight from where it is stored (flash for string literals), so it must
+ * not change until it has gone out; string literals and other const data
+ * always qualify. Shorter text is copied like CLI_Print() output.
+ *
+ * @param text NUL-terminated constant text.
+ *
+ * @return None.
+ */
+void CLI_PrintConst(const char *text);
+
+/**
+ * @brief Writes the next part of a command's output (CLI_Continue()).
+ *
+ * A call may write as much as a command line waits for room for
+ * (CLI_TX_SPACE in cli.c).
+ *
+ * @return true once the output is complete.
+ */
+typedef bool (*CLI_MoreFn_t)(void);
+
+/**
+ * @brief Finish a command's output in later CLI_Process() passes.
+ *
+ * For output longer than the TX ring. Calls @p more at once and again
+ * while the TX stream has room; what it cannot write yet follows each
+ * time the stream reports room (Stream_NotifyWritable()), before any
+ * further input or the prompt. Call it from a command handler, after
+ * the rest of its output.
+ *
+ * @param more Writes the next part, true when done.
+ *
+ * @return None.
+ */
+void CLI_Continue(CLI_MoreFn_t more);
+
 /**
  * @brief Called after asynchronous output (e.g. log line) to redraw prompt.
  *
  * Implemented in cli.c and invoked from log.c (weak hook) to maintain a
- * dashboard-like CLI where the input line stays clean at the bottom.
+ * dashboard-like CLI where the input line stays clean at the bottom. It
+ * only marks the prompt for redrawing and calls the receive hook once;
+ * the next CLI_Process() redraws it, so a burst of log lines costs one
+ * redraw instead of one per line.
  *
  * @return None.
  */
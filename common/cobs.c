@@ -0,0 +1,82 @@
+/**
+ * @file cobs.c
+ * @brief COBS encoder and decoder implementation.
+ *
+ * Single pass: each block starts with a code byte holding the distance to
+ * the next zero (or 0xFF for a full 254-byte run without one). The code
+ * byte position is reserved first and patched when the block ends. The
+ * decoder replaces each code byte but the last by a zero, except after a
+ * full 0xFF block.
+ *
+ * @ingroup cobs
+ */
+
+#include "cobs.h"
+
+/* ------------------------------------------------------------------------- */
+
+size_t Cobs_Encode(const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t  codePos = 0U;
+    size_t  outPos  = 1U;
+    uint8_t code    = 1U;
+
+    for (size_t i = 0U; i < len; ++i)
+    {
+        if (in[i] == 0U)
+        {
+            out[codePos] = code;
+            codePos      = outPos++;
+            code         = 1U;
+            continue;
+        }
+
+        out[outPos++] = in[i];
+        code++;
+
+        if (code == 0xFFU)
+        {
+            out[codePos] = code;
+            codePos      = outPos++;
+            code         = 1U;
+        }
+    }
+
+    out[codePos] = code;
+    return outPos;
+}
+
+size_t Cobs_Decode(const uint8_t *in, size_t len, uint8_t *out, size_t capacity)
+{
+    size_t inPos  = 0U;
+    size_t outPos = 0U;
+
+    while (inPos < len)
+    {
+        uint8_t code = in[inPos++];
+        if ((code == 0U) || ((inPos + code - 1U) > len))
+        {
+            return 0U;
+        }
+
+        for (uint8_t i = 1U; i < code; ++i)
+        {
+            if ((in[inPos] == 0U) || (outPos >= capacity))
+            {
+                return 0U;
+            }
+            out[outPos++] = in[inPos++];
+        }
+
+        if ((code != 0xFFU) && (inPos < len))
+        {
+            if (outPos >= capacity)
+            {
+                return 0U;
+            }
+            out[outPos++] = 0U;
+        }
+    }
+
+    return outPos;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file cobs.h
+ * @brief Consistent Overhead Byte Stuffing (COBS) encoder and decoder.
+ *
+ * COBS removes every 0x00 byte from a buffer at a cost of at most one
+ * extra byte per 254, so 0x00 can delimit frames on a byte stream that
+ * also carries text (text output never contains 0x00).
+ *
+ * @ingroup common
+ */
+
+#ifndef COBS_H
+#define COBS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @defgroup cobs COBS
+ * @brief Zero-free byte stuffing for framed links.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Worst-case encoded size of @p len input bytes.
+ */
+#define COBS_MAX_ENCODED_SIZE(len)   ((len) + ((len) / 254U) + 1U)
+
+/**
+ * @brief Encode a buffer.
+ *
+ * The output contains no 0x00 bytes and no trailing delimiter.
+ *
+ * @param in      Input bytes.
+ * @param len     Number of input bytes.
+ * @param[out] out Output buffer of at least COBS_MAX_ENCODED_SIZE(len) bytes.
+ *
+ * @return Number of bytes written to @p out.
+ */
+size_t Cobs_Encode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Decode a buffer (one frame, without its 0x00 delimiters).
+ *
+ * @param in       Encoded bytes.
+ * @param len      Number of encoded bytes.
+ * @param[out] out Output buffer; may be @p in (decoding never runs ahead).
+ * @param capacity Size of @p out.
+ *
+ * @return Number of bytes written to @p out, or 0 if @p in contains a
+ *         0x00, a code byte runs past its end or the result does not fit.
+ */
+size_t Cobs_Decode(const uint8_t *in, size_t len, uint8_t *out, size_t capacity);
+
+/** @} */ /* end of cobs group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COBS_H */
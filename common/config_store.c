@@ -0,0 +1,382 @@
+/**
+ * @file config_store.c
+ * @brief Persistent runtime configuration implementation.
+ *
+ * Slots of a sector are written strictly in order and a record is
+ * programmed front to back, so "magic word still erased" marks the first
+ * free slot and the used slots can be counted with a binary search. The
+ * newest record is the last CRC-valid one of the sector holding the
+ * higher sequence number.
+ *
+ * Sector erases use the blocking HAL call. The flash log owns the FLASH
+ * interrupt callbacks, so a save is refused while its interrupt-driven
+ * erase is running.
+ *
+ * @ingroup config_store
+ */
+
+#include "config_store.h"
+#include "flash_log.h"
+#include "crc32.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+#include <string.h>
+
+/** @brief First flash sector of the config region. */
+#define CONFIG_FIRST_SECTOR       (FLASH_SECTOR_1)
+
+/** @brief Number of config sectors. */
+#define CONFIG_SECTOR_COUNT       (2U)
+
+/** @brief Size of one config sector. */
+#define CONFIG_SECTOR_SIZE        (16U * 1024U)
+
+/** @brief Size of one record slot. */
+#define CONFIG_SLOT_SIZE          (256U)
+
+/** @brief Record slots per sector. */
+#define CONFIG_SLOTS_PER_SECTOR   (CONFIG_SECTOR_SIZE / CONFIG_SLOT_SIZE)
+
+/** @brief Record magic ("CFG1"). */
+#define CONFIG_MAGIC              (0x31474643U)
+
+/** @brief Content of an erased flash word. */
+#define CONFIG_ERASED             (0xFFFFFFFFU)
+
+/**
+ * @brief Record layout, identical in RAM and flash.
+ */
+typedef struct
+{
+    uint32_t     magic;   /**< @ref CONFIG_MAGIC.                */
+    uint16_t     version; /**< @ref CONFIG_VERSION.              */
+    uint16_t     size;    /**< sizeof(ConfigData_t).             */
+    uint32_t     seq;     /**< Record sequence number.           */
+    ConfigData_t data;    /**< Settings.                         */
+    uint32_t     crc;     /**< CRC-32 of all bytes above.        */
+} ConfigRecord_t;
+
+_Static_assert((sizeof(ConfigRecord_t) <= CONFIG_SLOT_SIZE) &&
+               ((sizeof(ConfigRecord_t) % 4U) == 0U), "config record layout");
+
+/**
+ * @brief Description of one setting.
+ */
+typedef struct
+{
+    const char *key;    /**< CLI name.                 */
+    size_t      offset; /**< Offset in ConfigData_t.   */
+    uint32_t    min;    /**< Smallest accepted value.  */
+    uint32_t    max;    /**< Largest accepted value.   */
+} ConfigField_t;
+
+/** @brief Field table generated from @ref CONFIG_FIELDS. */
+static const ConfigField_t s_fields[] =
+{
+#define CONFIG_FIELD_ENTRY(key, member, def, min, max)                        \
+    { #key, offsetof(ConfigData_t, member), (min), (max) },
+    CONFIG_FIELDS(CONFIG_FIELD_ENTRY)
+#undef CONFIG_FIELD_ENTRY
+};
+
+/** @brief Default settings generated from @ref CONFIG_FIELDS. */
+static const ConfigData_t s_defaults =
+{
+#define CONFIG_DEFAULT_ENTRY(key, member, def, min, max)   .member = (def),
+    CONFIG_FIELDS(CONFIG_DEFAULT_ENTRY)
+#undef CONFIG_DEFAULT_ENTRY
+};
+
+/* Start of the CONFIG region (linker script). */
+extern uint32_t _sconfig;
+
+/**
+ * @brief Settings in use.
+ */
+static ConfigData_t s_config;
+
+/**
+ * @brief Newest valid record in flash, or NULL.
+ */
+static const ConfigRecord_t *s_newest = NULL;
+
+/**
+ * @brief Store state reported by Config_GetInfo().
+ */
+static ConfigInfo_t s_info;
+
+/**
+ * @brief Address of a record slot.
+ */
+static inline const ConfigRecord_t *Config_Slot(uint32_t sector, uint32_t slot)
+{
+    const uint8_t *base = (const uint8_t *)&_sconfig;
+
+    return (const ConfigRecord_t *)&base[(sector * CONFIG_SECTOR_SIZE) + (slot * CONFIG_SLOT_SIZE)];
+}
+
+/**
+ * @brief Number of written slots at the start of @p sector.
+ */
+static uint32_t Config_CountSlots(uint32_t sector);
+
+/**
+ * @brief Whether a slot holds an intact record (any version).
+ */
+static bool Config_IsValid(const ConfigRecord_t *record);
+
+/**
+ * @brief Whether a whole sector is erased.
+ */
+static bool Config_IsSectorBlank(uint32_t sector);
+
+/* ------------------------------------------------------------------------- */
+
+void Config_Init(void)
+{
+    s_config = s_defaults;
+    s_newest = NULL;
+
+    memset(&s_info, 0, sizeof(s_info));
+    s_info.slotsTotal = CONFIG_SLOTS_PER_SECTOR;
+
+    for (uint32_t sector = 0U; sector < CONFIG_SECTOR_COUNT; ++sector)
+    {
+        uint32_t used = Config_CountSlots(sector);
+
+        /* Newest intact record of this sector; normally the last slot. */
+        for (uint32_t slot = used; slot > 0U; --slot)
+        {
+            const ConfigRecord_t *record = Config_Slot(sector, slot - 1U);
+            if (!Config_IsValid(record))
+            {
+                continue;
+            }
+
+            if ((s_newest == NULL) || ((int32_t)(record->seq - s_newest->seq) > 0))
+            {
+                s_newest         = record;
+                s_info.sector    = sector;
+                s_info.slotsUsed = used;
+                s_info.seq       = record->seq;
+            }
+            break;
+        }
+    }
+
+    if (s_newest == NULL)
+    {
+        LOG_INFO("Config: no saved settings, using defaults");
+        return;
+    }
+
+    if ((s_newest->version == CONFIG_VERSION) && (s_newest->size == sizeof(ConfigData_t)))
+    {
+        memcpy(&s_config, &s_newest->data, sizeof(s_config));
+        s_info.fromFlash = true;
+        LOG_INFO("Config: loaded record %lu", (unsigned long)s_newest->seq);
+    }
+    else
+    {
+        LOG_WARN("Config: record version %u not supported, using defaults",
+                 (unsigned)s_newest->version);
+    }
+}
+
+const ConfigData_t *Config_Get(void)
+{
+    return &s_config;
+}
+
+bool Config_Set(const char *key, uint32_t value)
+{
+    for (uint32_t i = 0U; i < (sizeof(s_fields) / sizeof(s_fields[0])); ++i)
+    {
+        const ConfigField_t *field = &s_fields[i];
+
+        if (strcmp(key, field->key) == 0)
+        {
+            if ((value < field->min) || (value > field->max))
+            {
+                return false;
+            }
+
+            uint8_t *base = (uint8_t *)&s_config;
+            memcpy(&base[field->offset], &value, sizeof(value));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Config_GetValue(const char *key, uint32_t *value)
+{
+    for (uint32_t i = 0U; i < (sizeof(s_fields) / sizeof(s_fields[0])); ++i)
+    {
+        if (strcmp(key, s_fields[i].key) == 0)
+        {
+            const uint8_t *base = (const uint8_t *)&s_config;
+            memcpy(value, &base[s_fields[i].offset], sizeof(*value));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t Config_GetFieldCount(void)
+{
+    return (uint32_t)(sizeof(s_fields) / sizeof(s_fields[0]));
+}
+
+bool Config_GetField(uint32_t index, const char **key, uint32_t *value)
+{
+    if (index >= Config_GetFieldCount())
+    {
+        return false;
+    }
+
+    const uint8_t *base = (const uint8_t *)&s_config;
+
+    *key = s_fields[index].key;
+    memcpy(value, &base[s_fields[index].offset], sizeof(*value));
+    return true;
+}
+
+void Config_ResetDefaults(void)
+{
+    s_config = s_defaults;
+}
+
+ConfigSaveResult_t Config_Save(void)
+{
+    /* A flash log or firmware slot erase holds the flash. */
+    if (FlashLog_IsErasing() || (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) != 0U))
+    {
+        return CONFIG_SAVE_BUSY;
+    }
+
+    if ((s_newest != NULL) && (s_newest->version == CONFIG_VERSION) &&
+        (memcmp(&s_newest->data, &s_config, sizeof(s_config)) == 0))
+    {
+        return CONFIG_SAVE_UNCHANGED;
+    }
+
+    ConfigRecord_t record =
+    {
+        .magic   = CONFIG_MAGIC,
+        .version = CONFIG_VERSION,
+        .size    = (uint16_t)sizeof(ConfigData_t),
+        .seq     = s_info.seq + 1U,
+        .data    = s_config
+    };
+    record.crc = Crc32_Compute(&record, offsetof(ConfigRecord_t, crc));
+
+    uint32_t sector = s_info.sector;
+    uint32_t slot   = s_info.slotsUsed;
+    bool     ok     = true;
+
+    (void)HAL_FLASH_Unlock();
+
+    if ((s_newest == NULL) || (slot >= CONFIG_SLOTS_PER_SECTOR))
+    {
+        /* Start the next sector; the old one keeps the previous record
+         * until this one is written.
+         */
+        sector = (s_newest == NULL) ? 0U : ((sector + 1U) % CONFIG_SECTOR_COUNT);
+        slot   = 0U;
+
+        if (!Config_IsSectorBlank(sector))
+        {
+            FLASH_EraseInitTypeDef erase =
+            {
+                .TypeErase    = FLASH_TYPEERASE_SECTORS,
+                .Sector       = CONFIG_FIRST_SECTOR + sector,
+                .NbSectors    = 1U,
+                .VoltageRange = FLASH_VOLTAGE_RANGE_3
+            };
+            uint32_t failedSector = 0U;
+
+            ok = (HAL_FLASHEx_Erase(&erase, &failedSector) == HAL_OK);
+        }
+    }
+
+    const ConfigRecord_t *target  = Config_Slot(sector, slot);
+    const uint32_t       *words   = (const uint32_t *)&record;
+    uint32_t              address = (uint32_t)(uintptr_t)target;
+
+    for (uint32_t i = 0U; ok && (i < (sizeof(record) / 4U)); ++i)
+    {
+        ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + (4U * i), words[i]) == HAL_OK);
+    }
+
+    (void)HAL_FLASH_Lock();
+
+    /* A failed write still uses up its slot. */
+    s_info.sector    = sector;
+    s_info.slotsUsed = slot + 1U;
+
+    if (!ok || !Config_IsValid(target))
+    {
+        return CONFIG_SAVE_ERROR;
+    }
+
+    s_newest    = target;
+    s_info.seq  = record.seq;
+
+    return CONFIG_SAVE_OK;
+}
+
+void Config_GetInfo(ConfigInfo_t *info)
+{
+    *info = s_info;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t Config_CountSlots(uint32_t sector)
+{
+    uint32_t lo = 0U;
+    uint32_t hi = CONFIG_SLOTS_PER_SECTOR;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + ((hi - lo) / 2U);
+
+        if (Config_Slot(sector, mid)->magic != CONFIG_ERASED)
+        {
+            lo = mid + 1U;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static bool Config_IsValid(const ConfigRecord_t *record)
+{
+    return (record->magic == CONFIG_MAGIC) &&
+           (record->crc == Crc32_Compute(record, offsetof(ConfigRecord_t, crc)));
+}
+
+static bool Config_IsSectorBlank(uint32_t sector)
+{
+    const uint32_t *word = (const uint32_t *)Config_Slot(sector, 0U);
+
+    for (uint32_t i = 0U; i < (CONFIG_SECTOR_SIZE / 4U); ++i)
+    {
+        if (word[i] != CONFIG_ERASED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
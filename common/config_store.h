@@ -0,0 +1,269 @@
+/**
+ * @file config_store.h
+ * @brief Persistent runtime configuration in on-chip flash.
+ *
+ * Settings that can be tuned in the field (sampling periods, log level,
+ * telemetry and flash log switches) are kept in one small structure that
+ * is saved as a versioned, CRC-protected record in flash sectors 1 and 2
+ * (the CONFIG region of the linker script).
+ *
+ * Records are appended to the active sector in 256-byte slots; when it
+ * is full the other sector is erased and used next, so a sector is erased
+ * once per 64 saves. At start-up the newest record is found by a binary
+ * search over the written slots and copied to RAM with one memcpy(), so
+ * boot time does not grow with the number of saves. A torn or corrupt
+ * record fails its CRC and the previous one is used.
+ *
+ * @ingroup common
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+
+/**
+ * @defgroup config_store Config Store
+ * @brief Versioned, CRC-protected settings in flash.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Bump whenever @ref CONFIG_FIELDS changes layout.
+ *
+ * Records of another version are ignored and the defaults are used.
+ */
+#define CONFIG_VERSION   (9U)
+
+/**
+ * @brief Fields of one stored alarm rule (see sensor_alarm.h).
+ *
+ * @c alarmN packs sensorId | kind << 8 | wake << 16 (0 = no rule);
+ * @c alarmN_thr and @c alarmN_hys are the IEEE-754 bits of the threshold
+ * and hysteresis. The application converts them; `alarm` is the command
+ * to edit rules.
+ */
+#define CONFIG_ALARM_FIELDS(X, n)                                                   \
+    X(alarm##n,       alarm##n##Rule,       0U, 0U, 0x1FFFFU)                       \
+    X(alarm##n##_thr, alarm##n##Threshold,  0U, 0U, 0xFFFFFFFFU)                    \
+    X(alarm##n##_hys, alarm##n##Hysteresis, 0U, 0U, 0xFFFFFFFFU)
+
+/**
+ * @brief Fields of one stored calibration (see sensor_calib.h).
+ *
+ * @c calibN packs sensorId | channel << 8 | 1 << 16 (0 = none);
+ * @c calibN_c0 to @c calibN_c3 are the IEEE-754 bits of the polynomial
+ * coefficients and @c calibN_lo / @c calibN_hi those of the table span.
+ * `calib` is the command to edit them.
+ */
+#define CONFIG_CALIB_FIELDS(X, n)                                                   \
+    X(calib##n,       calib##n##Sensor,     0U, 0U, 0x1FFFFU)                       \
+    X(calib##n##_c0,  calib##n##Coeff0,     0U, 0U, 0xFFFFFFFFU)                    \
+    X(calib##n##_c1,  calib##n##Coeff1,     0U, 0U, 0xFFFFFFFFU)                    \
+    X(calib##n##_c2,  calib##n##Coeff2,     0U, 0U, 0xFFFFFFFFU)                    \
+    X(calib##n##_c3,  calib##n##Coeff3,     0U, 0U, 0xFFFFFFFFU)                    \
+    X(calib##n##_lo,  calib##n##SpanLo,     0U, 0U, 0xFFFFFFFFU)                    \
+    X(calib##n##_hi,  calib##n##SpanHi,     0U, 0U, 0xFFFFFFFFU)
+
+/**
+ * @brief Fields of one stored sampling profile (see `profile`).
+ *
+ * @c profN_active, @c _idle and @c _sleep are the board sensor periods;
+ * @c profN_filter packs median window | average window << 8 | IIR alpha
+ * in thousandths << 16; @c profN_db is the deadband in thousandths of
+ * the sensor unit and @c profN_silence its longest silence. @c profN_log
+ * packs log level | enable << 8, @c profN_power the adaptive power
+ * policy | STANDBY duty cycle << 1, and @c profN_telem the telemetry
+ * format | enable << 8 (the built-in profiles leave telemetry off: it
+ * shares the console unless TELEMETRY_UART_ENABLE is set).
+ */
+#define CONFIG_PROFILE_FIELDS(X, n, active, idle, sleep, filter, db, silence, log, power, telem) \
+    X(prof##n##_active,  prof##n##Active_ms,  (active),  0U, 3600000U)               \
+    X(prof##n##_idle,    prof##n##Idle_ms,    (idle),    0U, 3600000U)               \
+    X(prof##n##_sleep,   prof##n##Sleep_ms,   (sleep),   0U, 3600000U)               \
+    X(prof##n##_filter,  prof##n##Filter,     (filter),  0U, 0x03E7FFFFU)            \
+    X(prof##n##_db,      prof##n##Deadband,   (db),      0U, 1000000000U)            \
+    X(prof##n##_silence, prof##n##Silence_ms, (silence), 0U, 3600000U)               \
+    X(prof##n##_log,     prof##n##Log,        (log),     0U, 0x103U)                 \
+    X(prof##n##_power,   prof##n##Power,      (power),   0U, 3U)                     \
+    X(prof##n##_telem,   prof##n##Telem,      (telem),   0U, 0x104U)
+
+/** @brief Pack a filter chain for @c profN_filter. */
+#define CONFIG_PROFILE_FILTER(median, average, alpha)                               \
+    ((uint32_t)(median) | ((uint32_t)(average) << 8) |                              \
+     ((uint32_t)(((alpha) * 1000.0f) + 0.5f) << 16))
+
+/**
+ * @brief Settings: X(key, member, default, min, max).
+ *
+ * Every field is a uint32_t. @c key is the name used by the CLI.
+ */
+#define CONFIG_FIELDS(X)                                                        \
+    X(period_active, periodActive_ms,  SENSOR_PERIOD_ACTIVE_MS,       0U, 3600000U) \
+    X(period_idle,   periodIdle_ms,    SENSOR_PERIOD_IDLE_MS,         0U, 3600000U) \
+    X(period_sleep,  periodSleep_ms,   SENSOR_PERIOD_SLEEP_MS,        0U, 3600000U) \
+    X(log_enable,    logEnabled,       0U,                            0U, 1U)       \
+    X(log_level,     logLevel,         1U,                            0U, 3U)       \
+    X(telem,         telemetryEnabled, (uint32_t)TELEMETRY_ENABLE_DEFAULT, 0U, 1U)  \
+    X(telem_format,  telemetryFormat,  0U,                            0U, 4U)       \
+    X(flashlog,      flashLogEnabled,  (uint32_t)FLASH_LOG_ENABLE_DEFAULT, 0U, 1U)  \
+    X(baud,          consoleBaud,      CONSOLE_BAUD_DEFAULT,       1200U, 11250000U) \
+    X(baud_over8,    consoleOver8,     0U,                            0U, 1U)       \
+    X(metrics_period, metricsPeriod_ms, METRICS_TELEMETRY_MS,         0U, 3600000U) \
+    X(standby,       standbyEnabled,   (uint32_t)POWER_STANDBY_ENABLE_DEFAULT, 0U, 1U) \
+    X(telem_baud,    telemetryBaud,    TELEMETRY_UART_BAUD_DEFAULT, 1200U, 11250000U) \
+    X(log_budget,    logBudget,        0U,                            0U, 1000000U) \
+    CONFIG_ALARM_FIELDS(X, 0)                                                   \
+    CONFIG_ALARM_FIELDS(X, 1)                                                   \
+    CONFIG_ALARM_FIELDS(X, 2)                                                   \
+    CONFIG_ALARM_FIELDS(X, 3)                                                   \
+    CONFIG_CALIB_FIELDS(X, 0)                                                   \
+    CONFIG_CALIB_FIELDS(X, 1)                                                   \
+    X(profile,       profile,          0U,                            0U, CONFIG_PROFILES) \
+    /* diag: 10 Hz, no filter or deadband, info log, manual power, raw telemetry format */ \
+    CONFIG_PROFILE_FIELDS(X, 0, 100U, 1000U, 5000U, 0U, 0U, 0U, 0x101U, 0U, 0x004U) \
+    /* prod: table periods and stages, warnings only, adaptive power, delta format */ \
+    CONFIG_PROFILE_FIELDS(X, 1, SENSOR_PERIOD_ACTIVE_MS, SENSOR_PERIOD_IDLE_MS,     \
+                          SENSOR_PERIOD_SLEEP_MS,                               \
+                          CONFIG_PROFILE_FILTER(SIMTEMP_FILTER_MEDIAN_WINDOW,   \
+                                                SIMTEMP_FILTER_AVERAGE_WINDOW,  \
+                                                SIMTEMP_FILTER_IIR_ALPHA),      \
+                          (uint32_t)((SIMTEMP_DEADBAND * 1000.0f) + 0.5f),      \
+                          SIMTEMP_MAX_SILENCE_MS, 0x102U,                       \
+                          1U | ((uint32_t)POWER_STANDBY_ENABLE_DEFAULT << 1), 0x002U)
+
+/** @brief Alarm rules stored (CONFIG_ALARM_FIELDS entries above). */
+#define CONFIG_ALARM_RULES   (4U)
+
+/** @brief Calibrations stored (CONFIG_CALIB_FIELDS entries above). */
+#define CONFIG_CALIB_SLOTS   (2U)
+
+/** @brief Sampling profiles stored (CONFIG_PROFILE_FIELDS entries above). */
+#define CONFIG_PROFILES      (2U)
+
+/**
+ * @brief Runtime configuration.
+ */
+typedef struct
+{
+#define CONFIG_MEMBER(key, member, def, min, max)   uint32_t member;
+    CONFIG_FIELDS(CONFIG_MEMBER)
+#undef CONFIG_MEMBER
+} ConfigData_t;
+
+/**
+ * @brief Result of Config_Save().
+ */
+typedef enum
+{
+    CONFIG_SAVE_OK = 0U,     /**< New record written.                  */
+    CONFIG_SAVE_UNCHANGED,   /**< Flash already holds these settings.  */
+    CONFIG_SAVE_BUSY,        /**< Flash busy (sector erase); retry.    */
+    CONFIG_SAVE_ERROR        /**< Erase or program failed.             */
+} ConfigSaveResult_t;
+
+/**
+ * @brief Config store state.
+ */
+typedef struct
+{
+    bool     fromFlash;  /**< Settings were loaded from a record. */
+    uint32_t seq;        /**< Sequence number of the newest record (0: none). */
+    uint32_t sector;     /**< Active sector (0 or 1 within the region).       */
+    uint32_t slotsUsed;  /**< Records in the active sector.                   */
+    uint32_t slotsTotal; /**< Record slots per sector.                        */
+} ConfigInfo_t;
+
+/**
+ * @brief Load the newest valid record, or the defaults if there is none.
+ *
+ * @return None.
+ */
+void Config_Init(void);
+
+/**
+ * @brief Current settings.
+ *
+ * @return Pointer to the RAM copy (never NULL).
+ */
+const ConfigData_t *Config_Get(void);
+
+/**
+ * @brief Change one setting in RAM.
+ *
+ * @param key   Field key (see @ref CONFIG_FIELDS).
+ * @param value New value.
+ *
+ * @return false if @p key is unknown or @p value is out of range.
+ */
+bool Config_Set(const char *key, uint32_t value);
+
+/**
+ * @brief Read one setting by key.
+ *
+ * @param key        Field key (see @ref CONFIG_FIELDS).
+ * @param[out] value Receives the value.
+ *
+ * @return false if @p key is unknown.
+ */
+bool Config_GetValue(const char *key, uint32_t *value);
+
+/**
+ * @brief Number of settings.
+ *
+ * @return Field count.
+ */
+uint32_t Config_GetFieldCount(void);
+
+/**
+ * @brief Describe one setting.
+ *
+ * @param index      Field index.
+ * @param[out] key   Receives the key.
+ * @param[out] value Receives the current value.
+ *
+ * @return false if @p index is out of range.
+ */
+bool Config_GetField(uint32_t index, const char **key, uint32_t *value);
+
+/**
+ * @brief Restore the defaults in RAM (flash is not touched).
+ *
+ * @return None.
+ */
+void Config_ResetDefaults(void);
+
+/**
+ * @brief Write the RAM settings to flash.
+ *
+ * Blocking: programming a record takes well under a millisecond; when a
+ * sector is full the other one is erased first (~0.5 s). Flash reads
+ * stall meanwhile. Call from thread mode.
+ *
+ * @return Result of the save.
+ */
+ConfigSaveResult_t Config_Save(void);
+
+/**
+ * @brief Snapshot the store state.
+ *
+ * @param[out] info Receives the state.
+ *
+ * @return None.
+ */
+void Config_GetInfo(ConfigInfo_t *info);
+
+/** @} */ /* end of config_store group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_STORE_H */
@@ -0,0 +1,560 @@
+/**
+ * @file crash_log.c
+ * @brief Crash trace in backup SRAM.
+ *
+ * Everything lives in one struct overlaid on BKPSRAM. Records are written
+ * in place with a running count per ring; the count modulo the ring size
+ * is the next slot. Writers mask interrupts only to claim a slot, so log
+ * lines from an ISR cannot tear a record written by the main loop.
+ *
+ * Whether the trace is held or recording is kept in RAM: it is decided
+ * once per boot by CrashLog_Init() and changed only by CrashLog_Clear().
+ *
+ * @ingroup crash_log
+ */
+
+#include "crash_log.h"
+#include "cli.h"
+#include "periph_power.h"
+#include "power_standby.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/** @brief "CRSH": the backup SRAM holds a trace. */
+#define CRASH_LOG_MAGIC           (0x48535243UL)
+
+/** @brief Layout version; bump when CrashLogRegion_t changes. */
+#define CRASH_LOG_VERSION         (2UL)
+
+/** @brief Task dispatches shown by `crash` without `all`. */
+#define CRASH_LOG_TASKS_SHOWN     (16U)
+
+/** @brief Record flag: data is a binary log payload (id, arguments). */
+#define CRASH_LOG_LINE_BINARY     (0x01U)
+
+/** @brief Backup SRAM size. */
+#define CRASH_LOG_BKPSRAM_SIZE    (4096U)
+
+/** @brief One log line. */
+typedef struct
+{
+    uint32_t time_ms;                    /**< HAL tick when recorded.        */
+    uint8_t  level;                      /**< LogLevel_t value.              */
+    uint8_t  flags;                      /**< CRASH_LOG_LINE_* flags.        */
+    uint8_t  len;                        /**< Bytes used in data.            */
+    uint8_t  reserved;
+    uint8_t  data[CRASH_LOG_LOG_BYTES];  /**< Text or binary payload.        */
+} CrashLogLine_t;
+
+/** @brief One task dispatch. */
+typedef struct
+{
+    uint32_t time_ms;                         /**< HAL tick at dispatch.     */
+    char     name[CRASH_LOG_TASK_NAME_BYTES]; /**< Not NUL-terminated if full. */
+} CrashLogTask_t;
+
+/** @brief Fault or error stop. */
+typedef struct
+{
+    uint32_t type;      /**< CrashLogFault_t.                                */
+    uint32_t time_ms;   /**< HAL tick at the stop.                           */
+    uint32_t r0;        /**< Stacked registers (HardFault) or arguments.     */
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t xpsr;
+    uint32_t cfsr;      /**< Configurable fault status.                      */
+    uint32_t hfsr;      /**< HardFault status.                               */
+    uint32_t mmfar;     /**< MemManage fault address.                        */
+    uint32_t bfar;      /**< BusFault address.                               */
+    char     task[CRASH_LOG_TASK_NAME_BYTES]; /**< Watchdog offender.        */
+} CrashLogFaultRecord_t;
+
+/** @brief Backup SRAM layout. */
+typedef struct
+{
+    uint32_t              magic;       /**< CRASH_LOG_MAGIC.                 */
+    uint32_t              version;     /**< CRASH_LOG_VERSION.               */
+    uint32_t              bootCount;   /**< Boots since the trace started.   */
+    uint32_t              resetFlags;  /**< RCC_CSR of the boot that started it. */
+    uint32_t              logCount;    /**< Log lines recorded in total.     */
+    uint32_t              taskCount;   /**< Dispatches recorded in total.    */
+    uint32_t              reserved[2];
+    CrashLogFaultRecord_t fault;
+    CrashLogLine_t        lines[CRASH_LOG_LOG_RECORDS];
+    CrashLogTask_t        tasks[CRASH_LOG_TASK_RECORDS];
+} CrashLogRegion_t;
+
+/* The top of backup SRAM holds the STANDBY duty cycle buffer. */
+_Static_assert(sizeof(CrashLogRegion_t) <= (CRASH_LOG_BKPSRAM_SIZE - POWER_STANDBY_BKPSRAM_BYTES),
+               "crash trace exceeds backup SRAM");
+
+/** @brief The trace, overlaid on backup SRAM. */
+static CrashLogRegion_t *const s_region = (CrashLogRegion_t *)BKPSRAM_BASE;
+
+/** @brief Recording is on (not held, CrashLog_Init() done). */
+static volatile bool s_armed = false;
+
+/** @brief Trace from an earlier boot is held. */
+static bool s_held = false;
+
+/** @brief Reset flags of this boot. */
+static uint32_t s_resetFlags = 0U;
+
+/**
+ * @brief Position of a CrashLog_Print() listing in progress.
+ *
+ * Recording goes on meanwhile: both counts are taken when the listing
+ * starts, and records overwritten before their turn are skipped.
+ */
+static struct
+{
+    bool     active;    /**< Listing in progress (cleared to cancel).  */
+    bool     tasks;     /**< Listing task dispatches (else log lines). */
+    bool     allTasks;  /**< Every dispatch kept, not the last 16.     */
+    uint32_t next;      /**< Next record (running count).              */
+    uint32_t end;       /**< Count after the last record shown.        */
+    uint32_t taskEnd;   /**< Task count when the listing started.      */
+    uint32_t skipped;   /**< Records of this section overwritten.      */
+} s_print;
+
+/**
+ * @brief Start a new trace for this boot and arm recording.
+ */
+static void CrashLog_Start(void);
+
+/**
+ * @brief Print the reset flags in @p flags as short names.
+ */
+static void CrashLog_PrintResetFlags(uint32_t flags);
+
+/**
+ * @brief Print the fault record, if any.
+ */
+static void CrashLog_PrintFault(const CrashLogFaultRecord_t *fault);
+
+/**
+ * @brief Print one log line.
+ */
+static void CrashLog_PrintLine(const CrashLogLine_t *line);
+
+/**
+ * @brief Print the next record from @ref s_print on (a CLI_MoreFn_t).
+ */
+static bool CrashLog_PrintMore(void);
+
+/* ------------------------------------------------------------------------- */
+
+void CrashLog_Init(void)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    PWR->CR |= PWR_CR_DBP;
+    /* Held for good: log lines are mirrored into backup SRAM as they go. */
+    PeriphPower_Acquire(PERIPH_POWER_BKPSRAM);
+
+#if (CRASH_LOG_BACKUP_REGULATOR != 0)
+    PWR->CSR |= PWR_CSR_BRE;
+#endif
+
+    s_resetFlags = RCC->CSR & (RCC_CSR_BORRSTF | RCC_CSR_PINRSTF | RCC_CSR_PORRSTF |
+                               RCC_CSR_SFTRSTF | RCC_CSR_IWDGRSTF | RCC_CSR_WWDGRSTF |
+                               RCC_CSR_LPWRRSTF);
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    if ((s_region->magic == CRASH_LOG_MAGIC) && (s_region->version == CRASH_LOG_VERSION))
+    {
+        /* Keep the first unexplained reset until someone has looked. */
+        s_region->bootCount++;
+        s_held  = true;
+        s_armed = false;
+        return;
+    }
+
+    CrashLog_Start();
+}
+
+void CrashLog_RecordLog(uint8_t level, bool binary, const void *data, size_t len)
+{
+    if (!s_armed)
+    {
+        return;
+    }
+
+    if (len > CRASH_LOG_LOG_BYTES)
+    {
+        len = CRASH_LOG_LOG_BYTES;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    CrashLogLine_t *line = &s_region->lines[s_region->logCount % CRASH_LOG_LOG_RECORDS];
+    s_region->logCount++;
+    __set_PRIMASK(primask);
+
+    line->time_ms = HAL_GetTick();
+    line->level   = level;
+    line->flags   = binary ? CRASH_LOG_LINE_BINARY : 0U;
+    line->len     = (uint8_t)len;
+    memcpy(line->data, data, len);
+}
+
+void CrashLog_RecordTask(const char *name)
+{
+    if (!s_armed)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    CrashLogTask_t *task = &s_region->tasks[s_region->taskCount % CRASH_LOG_TASK_RECORDS];
+    s_region->taskCount++;
+    __set_PRIMASK(primask);
+
+    task->time_ms = HAL_GetTick();
+    (void)strncpy(task->name, (name != NULL) ? name : "?", sizeof(task->name));
+}
+
+void CrashLog_RecordError(CrashLogFault_t type, uint32_t pc, uint32_t arg0, uint32_t arg1)
+{
+    if (!s_armed)
+    {
+        return;
+    }
+
+    CrashLogFaultRecord_t *fault = &s_region->fault;
+
+    memset(fault, 0, sizeof(*fault));
+    fault->type    = (uint32_t)type;
+    fault->time_ms = HAL_GetTick();
+    fault->pc      = pc;
+    fault->r0      = arg0;
+    fault->r1      = arg1;
+}
+
+void CrashLog_RecordWatchdog(const char *name, uint32_t overdue_ms)
+{
+    if (!s_armed)
+    {
+        return;
+    }
+
+    CrashLogFaultRecord_t *fault = &s_region->fault;
+    CrashLogFault_t        type  = (CrashLogFault_t)fault->type;
+
+    if ((type != CRASH_LOG_FAULT_NONE) && (type != CRASH_LOG_FAULT_WATCHDOG))
+    {
+        return;
+    }
+
+    memset(fault, 0, sizeof(*fault));
+    if (name != NULL)
+    {
+        fault->type    = (uint32_t)CRASH_LOG_FAULT_WATCHDOG;
+        fault->time_ms = HAL_GetTick();
+        fault->r0      = overdue_ms;
+        (void)strncpy(fault->task, name, sizeof(fault->task));
+    }
+}
+
+__attribute__((used)) void CrashLog_FaultEntry(const uint32_t *frame)
+{
+    if (s_armed)
+    {
+        CrashLogFaultRecord_t *fault = &s_region->fault;
+
+        memset(fault, 0, sizeof(*fault));
+        fault->type    = (uint32_t)CRASH_LOG_FAULT_HARD;
+        fault->time_ms = HAL_GetTick();
+        if (frame != NULL)
+        {
+            fault->r0   = frame[0];
+            fault->r1   = frame[1];
+            fault->r2   = frame[2];
+            fault->r3   = frame[3];
+            fault->r12  = frame[4];
+            fault->lr   = frame[5];
+            fault->pc   = frame[6];
+            fault->xpsr = frame[7];
+        }
+        fault->cfsr  = SCB->CFSR;
+        fault->hfsr  = SCB->HFSR;
+        fault->mmfar = SCB->MMFAR;
+        fault->bfar  = SCB->BFAR;
+    }
+
+#if (CRASH_LOG_RESET_ON_FAULT != 0)
+    /* With a debugger attached, stop here so the fault can be inspected. */
+    if ((CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk) == 0U)
+    {
+        NVIC_SystemReset();
+    }
+#endif
+
+    while (1)
+    {
+    }
+}
+
+bool CrashLog_IsHeld(void)
+{
+    return s_held;
+}
+
+uint32_t CrashLog_GetResetFlags(void)
+{
+    return s_resetFlags;
+}
+
+void CrashLog_PlannedReset(void)
+{
+    if (s_armed)
+    {
+        s_armed         = false;
+        s_region->magic = 0U;
+    }
+}
+
+void CrashLog_Clear(void)
+{
+    /* A listing in progress would print the cleared records. */
+    s_print.active = false;
+    CrashLog_Start();
+}
+
+void CrashLog_Print(bool allTasks)
+{
+    if (s_region->magic != CRASH_LOG_MAGIC)
+    {
+        CLI_Print("\r\nNo crash trace.\r\n");
+        return;
+    }
+
+    if (s_held)
+    {
+        CLI_Print("\r\nCrash trace held from an earlier boot (%lu boot(s) ago).\r\n",
+                  (unsigned long)s_region->bootCount);
+    }
+    else
+    {
+        CLI_Print("\r\nCrash trace of this boot (recording).\r\n");
+    }
+
+    CLI_Print("  Reset cause of this boot:");
+    CrashLog_PrintResetFlags(s_resetFlags);
+    CLI_Print("  Trace started after:");
+    CrashLog_PrintResetFlags(s_region->resetFlags);
+
+    CrashLog_PrintFault(&s_region->fault);
+
+    uint32_t count = s_region->logCount;
+    uint32_t shown = (count < CRASH_LOG_LOG_RECORDS) ? count : CRASH_LOG_LOG_RECORDS;
+
+    CLI_Print("  Log lines (last %lu of %lu):\r\n", (unsigned long)shown, (unsigned long)count);
+
+    /* Longer than the TX ring: one record at a time as it drains. */
+    s_print.active   = true;
+    s_print.tasks    = false;
+    s_print.allTasks = allTasks;
+    s_print.next     = count - shown;
+    s_print.end      = count;
+    s_print.taskEnd  = s_region->taskCount;
+    s_print.skipped  = 0U;
+    CLI_Continue(CrashLog_PrintMore);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void CrashLog_Start(void)
+{
+    s_armed = false;
+
+    memset(s_region, 0, sizeof(*s_region));
+    s_region->version    = CRASH_LOG_VERSION;
+    s_region->resetFlags = s_resetFlags;
+    s_region->magic      = CRASH_LOG_MAGIC;
+
+    s_held  = false;
+    s_armed = true;
+}
+
+static bool CrashLog_PrintMore(void)
+{
+    static const char *const levels[] = { "DBG", "INF", "WRN", "ERR" };
+
+    if (!s_print.active)
+    {
+        return true;
+    }
+
+    uint32_t records = s_print.tasks ? CRASH_LOG_TASK_RECORDS : CRASH_LOG_LOG_RECORDS;
+    uint32_t count   = s_print.tasks ? s_region->taskCount : s_region->logCount;
+
+    /* Records more than one ring behind the count have been written over. */
+    while ((s_print.next != s_print.end) && ((count - s_print.next) > records))
+    {
+        s_print.next++;
+        s_print.skipped++;
+    }
+
+    if (s_print.next != s_print.end)
+    {
+        uint32_t i = s_print.next++;
+
+        if (!s_print.tasks)
+        {
+            const CrashLogLine_t *line = &s_region->lines[i % CRASH_LOG_LOG_RECORDS];
+
+            CLI_Print("    [%8lu ms][%s] ", (unsigned long)line->time_ms,
+                      (line->level < (sizeof(levels) / sizeof(levels[0]))) ? levels[line->level] : "UNK");
+            CrashLog_PrintLine(line);
+        }
+        else
+        {
+            const CrashLogTask_t *task = &s_region->tasks[i % CRASH_LOG_TASK_RECORDS];
+
+            CLI_Print("    %8lu ms  %.*s\r\n", (unsigned long)task->time_ms,
+                      (int)CRASH_LOG_TASK_NAME_BYTES, task->name);
+        }
+        return false;
+    }
+
+    if (s_print.skipped != 0U)
+    {
+        CLI_Print("    (%lu overwritten while listing)\r\n", (unsigned long)s_print.skipped);
+        s_print.skipped = 0U;
+    }
+
+    if (!s_print.tasks)
+    {
+        uint32_t taskCount = s_print.taskEnd;
+        uint32_t shown     = (taskCount < CRASH_LOG_TASK_RECORDS) ? taskCount : CRASH_LOG_TASK_RECORDS;
+        if (!s_print.allTasks && (shown > CRASH_LOG_TASKS_SHOWN))
+        {
+            shown = CRASH_LOG_TASKS_SHOWN;
+        }
+        CLI_Print("  Task dispatches (last %lu of %lu):\r\n", (unsigned long)shown, (unsigned long)taskCount);
+
+        s_print.tasks = true;
+        s_print.next  = taskCount - shown;
+        s_print.end   = taskCount;
+        return false;
+    }
+
+    s_print.active = false;
+
+    if (s_held)
+    {
+        CLI_Print("Use 'crash clear' to discard it and record this boot.\r\n");
+    }
+    return true;
+}
+
+static void CrashLog_PrintResetFlags(uint32_t flags)
+{
+    static const struct
+    {
+        uint32_t    mask;
+        const char *name;
+    } names[] =
+    {
+        { RCC_CSR_LPWRRSTF, "low-power" },
+        { RCC_CSR_WWDGRSTF, "window-watchdog" },
+        { RCC_CSR_IWDGRSTF, "watchdog" },
+        { RCC_CSR_SFTRSTF,  "software" },
+        { RCC_CSR_PORRSTF,  "power-on" },
+        { RCC_CSR_PINRSTF,  "pin" },
+        { RCC_CSR_BORRSTF,  "brown-out" },
+    };
+
+    bool any = false;
+    for (uint32_t i = 0U; i < (sizeof(names) / sizeof(names[0])); ++i)
+    {
+        if ((flags & names[i].mask) != 0U)
+        {
+            CLI_Print(" %s", names[i].name);
+            any = true;
+        }
+    }
+
+    CLI_Print("%s\r\n", any ? "" : " none");
+}
+
+static void CrashLog_PrintFault(const CrashLogFaultRecord_t *fault)
+{
+    switch ((CrashLogFault_t)fault->type)
+    {
+        case CRASH_LOG_FAULT_HARD:
+            CLI_Print("  HardFault at %lu ms\r\n", (unsigned long)fault->time_ms);
+            CLI_Print("    pc 0x%08lX  lr 0x%08lX  xpsr 0x%08lX\r\n",
+                      (unsigned long)fault->pc, (unsigned long)fault->lr, (unsigned long)fault->xpsr);
+            CLI_Print("    r0 0x%08lX  r1 0x%08lX  r2 0x%08lX  r3 0x%08lX  r12 0x%08lX\r\n",
+                      (unsigned long)fault->r0, (unsigned long)fault->r1, (unsigned long)fault->r2,
+                      (unsigned long)fault->r3, (unsigned long)fault->r12);
+            CLI_Print("    CFSR 0x%08lX  HFSR 0x%08lX  MMFAR 0x%08lX  BFAR 0x%08lX\r\n",
+                      (unsigned long)fault->cfsr, (unsigned long)fault->hfsr,
+                      (unsigned long)fault->mmfar, (unsigned long)fault->bfar);
+            break;
+
+        case CRASH_LOG_FAULT_ERROR:
+            CLI_Print("  Error_Handler() at %lu ms, called from 0x%08lX\r\n",
+                      (unsigned long)fault->time_ms, (unsigned long)fault->pc);
+            break;
+
+        case CRASH_LOG_FAULT_ASSERT:
+            CLI_Print("  assert_failed() at %lu ms, line %lu, file at 0x%08lX\r\n",
+                      (unsigned long)fault->time_ms, (unsigned long)fault->r0,
+                      (unsigned long)fault->r1);
+            break;
+
+        case CRASH_LOG_FAULT_WATCHDOG:
+            CLI_Print("  Watchdog refresh withheld at %lu ms: task '%.*s' late or stuck for %lu ms\r\n",
+                      (unsigned long)fault->time_ms, (int)CRASH_LOG_TASK_NAME_BYTES,
+                      fault->task, (unsigned long)fault->r0);
+            break;
+
+        case CRASH_LOG_FAULT_NONE:
+        default:
+            CLI_Print("  No fault recorded (reset, watchdog or power loss).\r\n");
+            break;
+    }
+}
+
+static void CrashLog_PrintLine(const CrashLogLine_t *line)
+{
+    uint32_t len = (line->len <= CRASH_LOG_LOG_BYTES) ? line->len : CRASH_LOG_LOG_BYTES;
+
+    if ((line->flags & CRASH_LOG_LINE_BINARY) == 0U)
+    {
+        CLI_Print("%.*s\r\n", (int)len, (const char *)line->data);
+        return;
+    }
+
+    /* Binary payload: format string address, then the raw arguments. */
+    uint32_t id = 0U;
+    if (len >= sizeof(id))
+    {
+        memcpy(&id, line->data, sizeof(id));
+    }
+
+    if ((id >= FLASH_BASE) && (id < FLASH_END))
+    {
+        /* Same image: the format string is still in flash. */
+        CLI_Print("\"%.*s\"", (int)CRASH_LOG_LOG_BYTES, (const char *)(uintptr_t)id);
+    }
+    else
+    {
+        CLI_Print("id 0x%08lX", (unsigned long)id);
+    }
+
+    for (uint32_t i = sizeof(id); i < len; ++i)
+    {
+        CLI_Print("%s%02X", (i == sizeof(id)) ? " args " : "", (unsigned)line->data[i]);
+    }
+    CLI_Print("\r\n");
+}
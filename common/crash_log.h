@@ -0,0 +1,206 @@
+/**
+ * @file crash_log.h
+ * @brief Crash trace in battery-backed SRAM that survives a reset.
+ *
+ * The 4 KB backup SRAM holds a small header, a fault record and two
+ * rings: the last @ref CRASH_LOG_LOG_RECORDS log lines and the last
+ * @ref CRASH_LOG_TASK_RECORDS task dispatches. Recording is a bounded
+ * memcpy with interrupts masked for a few instructions; nothing is
+ * formatted until the trace is printed.
+ *
+ * The first valid trace found after a reset is held: CrashLog_Init()
+ * keeps it, recording stays off, and the `crash` command prints it
+ * together with the reset cause of the boot that found it. `crash clear`
+ * discards it and arms recording again. So the trace always describes the
+ * first unexplained reset since it was last cleared.
+ *
+ * HardFault_Handler (stm32f4xx_it.c) passes the stacked exception frame to
+ * CrashLog_FaultEntry(); Error_Handler() and assert_failed() call
+ * CrashLog_RecordError(). The task manager's watchdog supervision names
+ * the task that is about to let the IWDG expire with
+ * CrashLog_RecordWatchdog().
+ *
+ * @ingroup common
+ */
+
+#ifndef CRASH_LOG_H
+#define CRASH_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @defgroup crash_log Crash Trace
+ * @brief Log lines, task dispatches and fault registers kept across reset.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Number of log lines kept. */
+#ifndef CRASH_LOG_LOG_RECORDS
+#define CRASH_LOG_LOG_RECORDS     (32U)
+#endif
+
+/** @brief Characters (text mode) or payload bytes (binary mode) kept per line. */
+#define CRASH_LOG_LOG_BYTES       (40U)
+
+/** @brief Number of task dispatches kept. */
+#ifndef CRASH_LOG_TASK_RECORDS
+#define CRASH_LOG_TASK_RECORDS    (128U)
+#endif
+
+/** @brief Characters of the task name kept per dispatch. */
+#define CRASH_LOG_TASK_NAME_BYTES (12U)
+
+/**
+ * @brief Reset the MCU after a HardFault has been recorded.
+ *
+ * When 0, or while a debugger is attached, the handler spins instead.
+ */
+#ifndef CRASH_LOG_RESET_ON_FAULT
+#define CRASH_LOG_RESET_ON_FAULT  (1)
+#endif
+
+/**
+ * @brief Enable the backup regulator so the trace also survives VBAT-only
+ *        operation. Not needed to survive a reset with VDD present. The
+ *        STANDBY duty cycle turns it on regardless (power_standby.h).
+ */
+#ifndef CRASH_LOG_BACKUP_REGULATOR
+#define CRASH_LOG_BACKUP_REGULATOR (0)
+#endif
+
+/** @brief What ended the recorded run. */
+typedef enum
+{
+    CRASH_LOG_FAULT_NONE = 0,   /**< Nothing recorded (reset or power loss). */
+    CRASH_LOG_FAULT_HARD,       /**< HardFault; registers are valid.         */
+    CRASH_LOG_FAULT_ERROR,      /**< Error_Handler(); pc is the caller.      */
+    CRASH_LOG_FAULT_ASSERT,     /**< assert_failed(); r0 line, r1 file.      */
+    CRASH_LOG_FAULT_WATCHDOG    /**< Refresh withheld; task named, r0 ms overdue. */
+} CrashLogFault_t;
+
+/**
+ * @brief Map the backup SRAM and either hold the trace it contains or
+ *        start a new one.
+ *
+ * Call early in main(), after HAL_Init(). Reads (and clears) the RCC reset
+ * flags, so any other user of RCC->CSR reset flags must go through
+ * CrashLog_GetResetFlags().
+ *
+ * @return None.
+ */
+void CrashLog_Init(void);
+
+/**
+ * @brief Record one log line.
+ *
+ * @param level  Log level (LogLevel_t value).
+ * @param binary true when @p data is a binary log record payload.
+ * @param data   Message text (not NUL-terminated) or binary payload.
+ * @param len    Length of @p data; only the first CRASH_LOG_LOG_BYTES
+ *               bytes are kept.
+ * @return None.
+ */
+void CrashLog_RecordLog(uint8_t level, bool binary, const void *data, size_t len);
+
+/**
+ * @brief Record that a task is about to run.
+ *
+ * @param name Task name; the first CRASH_LOG_TASK_NAME_BYTES characters
+ *             are copied.
+ * @return None.
+ */
+void CrashLog_RecordTask(const char *name);
+
+/**
+ * @brief Record a software error stop.
+ *
+ * @param type CRASH_LOG_FAULT_ERROR or CRASH_LOG_FAULT_ASSERT.
+ * @param pc   Code address to report (e.g. the caller's return address).
+ * @param arg0 Extra value (assert: line number).
+ * @param arg1 Extra value (assert: file name pointer).
+ * @return None.
+ */
+void CrashLog_RecordError(CrashLogFault_t type, uint32_t pc, uint32_t arg0, uint32_t arg1);
+
+/**
+ * @brief Record the task the watchdog supervision holds responsible.
+ *
+ * Written while the IWDG is still counting, so the record is in place if
+ * it expires. Replaces an earlier watchdog record but no other fault.
+ *
+ * @param name       Offending task, or NULL to withdraw a watchdog record
+ *                   (the task recovered).
+ * @param overdue_ms How long the task has been late or running.
+ * @return None.
+ */
+void CrashLog_RecordWatchdog(const char *name, uint32_t overdue_ms);
+
+/**
+ * @brief HardFault entry: record the exception frame and fault status
+ *        registers, then reset (see @ref CRASH_LOG_RESET_ON_FAULT).
+ *
+ * Called from HardFault_Handler with the stack pointer that holds the
+ * exception frame (MSP or PSP, per EXC_RETURN). Never returns.
+ *
+ * @param frame Stacked r0-r3, r12, lr, pc, xPSR, or NULL if unknown.
+ * @return None.
+ */
+void CrashLog_FaultEntry(const uint32_t *frame) __attribute__((noreturn));
+
+/**
+ * @brief True if the backup SRAM holds a trace from an earlier boot.
+ *
+ * @return true while the trace is held (until CrashLog_Clear()).
+ */
+bool CrashLog_IsHeld(void);
+
+/**
+ * @brief RCC_CSR reset flags read by CrashLog_Init() for this boot.
+ *
+ * @return RCC_CSR value with the *RSTF bits of the last reset.
+ */
+uint32_t CrashLog_GetResetFlags(void);
+
+/**
+ * @brief The reset that follows is deliberate: drop this boot's trace.
+ *
+ * For resets that are not crashes (entering the STANDBY duty cycle), so
+ * the next boot does not hold the trace. A trace held from an earlier
+ * boot is kept.
+ *
+ * @return None.
+ */
+void CrashLog_PlannedReset(void);
+
+/**
+ * @brief Discard the trace held in backup SRAM and start recording.
+ *
+ * @return None.
+ */
+void CrashLog_Clear(void);
+
+/**
+ * @brief Print the trace (fault, log lines, task dispatches) via the CLI.
+ *
+ * The log lines and task dispatches follow one at a time as the TX
+ * stream drains (CLI_Continue()), so call it from a CLI command handler.
+ *
+ * @param allTasks Print every task dispatch kept instead of the last 16.
+ * @return None.
+ */
+void CrashLog_Print(bool allTasks);
+
+/** @} */ /* end of crash_log group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRASH_LOG_H */
@@ -0,0 +1,54 @@
+/**
+ * @file crc32.c
+ * @brief CRC-32/MPEG-2 implementation.
+ *
+ * Nibble-wise table lookup: 16 table entries (64 bytes of flash) and two
+ * lookups per byte, a good trade-off against the 1 KB byte table for the
+ * short buffers this firmware checksums. Longer buffers go to the CRC
+ * unit, which takes a word in about the time the table code takes a byte.
+ *
+ * @ingroup crc32
+ */
+
+#include "crc32.h"
+#include "crc32_hw.h"
+
+/**
+ * @brief CRC of each 4-bit value, MSB first.
+ */
+static const uint32_t s_crcTable[16] =
+{
+    0x00000000U, 0x04C11DB7U, 0x09823B6EU, 0x0D4326D9U,
+    0x130476DCU, 0x17C56B6BU, 0x1A864DB2U, 0x1E475005U,
+    0x2608EDB8U, 0x22C9F00FU, 0x2F8AD6D6U, 0x2B4BCB61U,
+    0x350C9B64U, 0x31CD86D3U, 0x3C8EA00AU, 0x384FBDBDU
+};
+
+/* ------------------------------------------------------------------------- */
+
+uint32_t Crc32_Update(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    for (size_t i = 0U; i < len; ++i)
+    {
+        crc ^= (uint32_t)bytes[i] << 24;
+        crc  = (crc << 4) ^ s_crcTable[crc >> 28];
+        crc  = (crc << 4) ^ s_crcTable[crc >> 28];
+    }
+
+    return crc;
+}
+
+uint32_t Crc32_Compute(const void *data, size_t len)
+{
+    size_t   words = len / 4U;
+    uint32_t crc;
+
+    if ((len < CRC32_HW_MIN_LEN) || !Crc32Hw_Compute(data, words, &crc))
+    {
+        return Crc32_Update(CRC32_INIT, data, len);
+    }
+
+    return Crc32_Update(crc, (const uint8_t *)data + (4U * words), len - (4U * words));
+}
@@ -0,0 +1,75 @@
+/**
+ * @file crc32.h
+ * @brief CRC-32/MPEG-2 checksum.
+ *
+ * Polynomial 0x04C11DB7, initial value 0xFFFFFFFF, no reflection, no
+ * final XOR. This is the algorithm of the STM32 CRC peripheral, and
+ * Crc32_Compute() hands the whole words of a buffer to it (crc32_hw.h).
+ * Used for telemetry and uplink frames, the config store, the flash log
+ * and the sample archive.
+ *
+ * @ingroup common
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @defgroup crc32 CRC-32
+ * @brief CRC-32/MPEG-2 over byte buffers.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Initial CRC value. */
+#define CRC32_INIT   (0xFFFFFFFFU)
+
+/**
+ * @brief Shortest buffer Crc32_Compute() gives to the CRC unit (bytes).
+ *
+ * Below this, claiming the unit and its clock costs more than the table
+ * code.
+ */
+#define CRC32_HW_MIN_LEN   (16U)
+
+/**
+ * @brief Continue a CRC over more bytes.
+ *
+ * Table code only: the CRC unit cannot start from a running value.
+ *
+ * @param crc  Running CRC (start with @ref CRC32_INIT).
+ * @param data Bytes to add.
+ * @param len  Number of bytes.
+ *
+ * @return Updated CRC.
+ */
+uint32_t Crc32_Update(uint32_t crc, const void *data, size_t len);
+
+/**
+ * @brief CRC of a complete buffer.
+ *
+ * Whole words go through the CRC unit from @ref CRC32_HW_MIN_LEN bytes on,
+ * unless another context is using it; the tail bytes through the table.
+ * Safe from any context.
+ *
+ * @param data Bytes.
+ * @param len  Number of bytes.
+ *
+ * @return CRC-32/MPEG-2 of @p data.
+ */
+uint32_t Crc32_Compute(const void *data, size_t len);
+
+/** @} */ /* end of crc32 group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32_H */
@@ -0,0 +1,50 @@
+/**
+ * @file crc32_hw.h
+ * @brief Hardware port of the CRC calculation unit.
+ *
+ * The F4 CRC unit computes CRC-32/MPEG-2 over 32-bit words written to its
+ * data register, most significant byte first, at one word per four AHB
+ * cycles. It has no input reversal and no programmable initial value:
+ * every computation starts from @ref CRC32_INIT after a reset of the unit,
+ * and crc32_hw.c byte-swaps each word so the result matches the byte-wise
+ * CRC of crc32.c over the same memory.
+ *
+ * The unit holds one running CRC. A computation interrupted by another
+ * context that wants the unit is not disturbed: the second caller is
+ * refused and falls back to the table code (Crc32_Compute() does this).
+ *
+ * The host simulation has its own port, a bit-wise model of the unit.
+ *
+ * @ingroup crc32
+ */
+
+#ifndef CRC32_HW_H
+#define CRC32_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief CRC of @p words whole words of bytes, in the CRC unit.
+ *
+ * @p data needs no alignment. Safe from any context.
+ *
+ * @param data      First byte.
+ * @param words     Number of 4-byte words.
+ * @param[out] crc  CRC-32/MPEG-2 of the 4 x @p words bytes.
+ *
+ * @return false if the unit is in use by an interrupted context; @p crc
+ *         is then not written.
+ */
+bool Crc32Hw_Compute(const void *data, size_t words, uint32_t *crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32_HW_H */
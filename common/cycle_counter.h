@@ -0,0 +1,71 @@
+/**
+ * @file cycle_counter.h
+ * @brief Cortex-M4 DWT cycle counter helpers.
+ *
+ * Thin inline wrappers around DWT->CYCCNT for profiling and latency
+ * measurement. The counter runs at HCLK and wraps every 2^32 cycles
+ * (~24 s at 180 MHz), so only differences of short intervals are
+ * meaningful. It does not count while the core is in STOP.
+ *
+ * @ingroup common
+ */
+
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/**
+ * @defgroup cycle_counter Cycle Counter
+ * @brief DWT CYCCNT access.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Enable the DWT cycle counter.
+ *
+ * Safe to call more than once; the counter is not reset.
+ *
+ * @return None.
+ */
+static inline void CycleCounter_Init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief Read the free-running cycle counter.
+ *
+ * @return Current CYCCNT value.
+ */
+static inline uint32_t CycleCounter_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief Convert a cycle count to microseconds at the current core clock.
+ *
+ * @param cycles Cycle count.
+ *
+ * @return Duration in microseconds.
+ */
+static inline uint32_t CycleCounter_ToUs(uint32_t cycles)
+{
+    return cycles / (SystemCoreClock / 1000000U);
+}
+
+/** @} */ /* end of cycle_counter group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CYCLE_COUNTER_H */
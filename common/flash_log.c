@@ -0,0 +1,689 @@
+/**
+ * @file flash_log.c
+ * @brief Flash sample log implementation.
+ *
+ * Page slots are numbered 0..N-1 across the log sectors; the write slot
+ * advances round-robin. Because a page is programmed front to back, a
+ * slot whose first word is still erased has never been written, and a
+ * page interrupted by a reset keeps its header but fails the CRC (it is
+ * skipped by the dump and only costs its slot).
+ *
+ * Before the first page of a sector is written, the sector is erased if
+ * it holds anything. The erase runs from the FLASH interrupt; the queue
+ * keeps filling meanwhile.
+ *
+ * @ingroup flash_log
+ */
+
+#include "flash_log.h"
+#include "sample_codec.h"
+#include "telemetry.h"
+#include "crc32.h"
+#include "log.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/** @brief First flash sector of the log region. */
+#define FLASH_LOG_FIRST_SECTOR      (FLASH_SECTOR_3)
+
+/** @brief Number of log sectors. */
+#define FLASH_LOG_SECTOR_COUNT      (1U)
+
+/** @brief Size of one log sector. */
+#define FLASH_LOG_SECTOR_SIZE       (16U * 1024U)
+
+/** @brief Page slots per sector. */
+#define FLASH_LOG_SLOTS_PER_SECTOR  (FLASH_LOG_SECTOR_SIZE / FLASH_LOG_PAGE_SIZE)
+
+/** @brief Page slots in the log. */
+#define FLASH_LOG_SLOT_COUNT        (FLASH_LOG_SLOTS_PER_SECTOR * FLASH_LOG_SECTOR_COUNT)
+
+/** @brief Header and CRC bytes of a page. */
+#define FLASH_LOG_OVERHEAD          (20U)
+
+/** @brief Payload bytes of a page. */
+#define FLASH_LOG_PAYLOAD_SIZE      (FLASH_LOG_PAGE_SIZE - FLASH_LOG_OVERHEAD)
+
+/** @brief Page magic ("FLG1"). */
+#define FLASH_LOG_MAGIC             (0x31474C46U)
+
+/** @brief Content of an erased flash word. */
+#define FLASH_LOG_ERASED            (0xFFFFFFFFU)
+
+/**
+ * @brief Page layout, identical in RAM and flash.
+ */
+typedef struct
+{
+    uint32_t magic;                           /**< @ref FLASH_LOG_MAGIC.         */
+    uint32_t seq;                             /**< Page sequence number.         */
+    uint32_t base_ms;                         /**< Batch base timestamp.         */
+    uint8_t  mode;                            /**< SampleCodecMode_t.            */
+    uint8_t  count;                           /**< Samples in the batch.         */
+    uint16_t length;                          /**< Payload bytes used.           */
+    uint8_t  payload[FLASH_LOG_PAYLOAD_SIZE]; /**< Encoded batch, 0xFF padded.   */
+    uint32_t crc;                             /**< CRC-32 of all bytes above.    */
+} FlashLogPage_t;
+
+_Static_assert(sizeof(FlashLogPage_t) == FLASH_LOG_PAGE_SIZE, "flash log page layout");
+
+/**
+ * @brief State of the background sector erase.
+ */
+typedef enum
+{
+    FLASH_LOG_ERASE_IDLE = 0U, /**< No erase running.          */
+    FLASH_LOG_ERASE_BUSY,      /**< Erase started.             */
+    FLASH_LOG_ERASE_DONE,      /**< Erase finished (ISR).      */
+    FLASH_LOG_ERASE_FAILED     /**< Erase reported an error.   */
+} FlashLogEraseState_t;
+
+/** @brief Start of the FLASHLOG region (linker script). */
+extern uint8_t _sflash_log[];
+
+/** @brief End of the FLASHLOG region (linker script). */
+extern uint8_t _eflash_log[];
+
+/**
+ * @brief Page under construction.
+ */
+static FlashLogPage_t s_build;
+
+/**
+ * @brief Encoder writing into @ref s_build.
+ */
+static SampleCodec_t s_codec;
+
+/**
+ * @brief Whether @ref s_build holds samples.
+ */
+static bool s_buildActive = false;
+
+/**
+ * @brief Tick of the first sample in @ref s_build.
+ */
+static uint32_t s_buildStart_ms = 0U;
+
+/**
+ * @brief Sealed pages waiting to be programmed.
+ */
+static FlashLogPage_t s_queue[FLASH_LOG_QUEUE_PAGES];
+
+/**
+ * @brief Index of the oldest queued page.
+ */
+static uint32_t s_queueHead = 0U;
+
+/**
+ * @brief Number of queued pages.
+ */
+static uint32_t s_queueCount = 0U;
+
+/**
+ * @brief Slot the next page is programmed into.
+ */
+static uint32_t s_writeSlot = 0U;
+
+/**
+ * @brief Sequence number of the next sealed page.
+ */
+static uint32_t s_nextSeq = 1U;
+
+/**
+ * @brief Sectors holding foreign data (bit per log sector).
+ */
+static uint32_t s_dirtySectors = 0U;
+
+/**
+ * @brief Background erase state (written by the FLASH interrupt).
+ */
+static volatile FlashLogEraseState_t s_eraseState = FLASH_LOG_ERASE_IDLE;
+
+/**
+ * @brief Pages that the running erase removes.
+ */
+static uint32_t s_erasePages = 0U;
+
+/**
+ * @brief Dump in progress.
+ */
+static bool s_dumping = false;
+
+/**
+ * @brief Next slot to dump.
+ */
+static uint32_t s_dumpSlot = 0U;
+
+/**
+ * @brief Slots left to dump.
+ */
+static uint32_t s_dumpRemaining = 0U;
+
+/**
+ * @brief Region matches the expected layout.
+ */
+static bool s_ready = false;
+
+/**
+ * @brief Logging on/off.
+ */
+static bool s_enabled = false;
+
+/**
+ * @brief Counters.
+ */
+static FlashLogStats_t s_stats = {0};
+
+/**
+ * @brief Page stored in @p slot.
+ */
+static inline const FlashLogPage_t *FlashLog_Slot(uint32_t slot)
+{
+    return (const FlashLogPage_t *)&_sflash_log[slot * FLASH_LOG_PAGE_SIZE];
+}
+
+/**
+ * @brief Log sector containing @p slot.
+ */
+static inline uint32_t FlashLog_SectorOf(uint32_t slot)
+{
+    return slot / FLASH_LOG_SLOTS_PER_SECTOR;
+}
+
+/**
+ * @brief Whether @p page is complete and intact.
+ */
+static bool FlashLog_IsValid(const FlashLogPage_t *page);
+
+/**
+ * @brief Whether @p len bytes at @p data are all erased.
+ */
+static bool FlashLog_IsBlank(const void *data, size_t len);
+
+/**
+ * @brief Move the RAM page to the program queue.
+ */
+static void FlashLog_Seal(void);
+
+/**
+ * @brief Start the background erase of log sector @p sector.
+ */
+static void FlashLog_StartErase(uint32_t sector);
+
+/**
+ * @brief Finish a background erase once the interrupt has reported.
+ */
+static void FlashLog_CompleteErase(void);
+
+/**
+ * @brief Program the oldest queued page (erasing its sector first if needed).
+ */
+static void FlashLog_WriteQueued(void);
+
+/**
+ * @brief Send stored pages while the UART TX ring has room.
+ */
+static void FlashLog_ServiceDump(void);
+
+/* ------------------------------------------------------------------------- */
+
+void FlashLog_Init(void)
+{
+    s_buildActive  = false;
+    s_queueHead    = 0U;
+    s_queueCount   = 0U;
+    s_writeSlot    = 0U;
+    s_nextSeq      = 1U;
+    s_dirtySectors = 0U;
+    s_eraseState   = FLASH_LOG_ERASE_IDLE;
+    s_dumping      = false;
+    s_enabled      = false;
+    s_stats        = (FlashLogStats_t){0};
+
+    s_ready = ((size_t)(_eflash_log - _sflash_log) == (FLASH_LOG_SLOT_COUNT * FLASH_LOG_PAGE_SIZE));
+    if (!s_ready)
+    {
+        LOG_ERROR("FlashLog: linker region does not match the log layout");
+        return;
+    }
+
+    s_stats.pagesTotal = FLASH_LOG_SLOT_COUNT;
+
+    /* Headers only: the CRC is checked when a page is dumped. */
+    uint32_t newestSlot = FLASH_LOG_SLOT_COUNT;
+
+    for (uint32_t slot = 0U; slot < FLASH_LOG_SLOT_COUNT; ++slot)
+    {
+        const FlashLogPage_t *page = FlashLog_Slot(slot);
+
+        if (page->magic == FLASH_LOG_MAGIC)
+        {
+            s_stats.pagesUsed++;
+            if ((newestSlot == FLASH_LOG_SLOT_COUNT) ||
+                ((int32_t)(page->seq - s_stats.newestSeq) > 0))
+            {
+                newestSlot        = slot;
+                s_stats.newestSeq  = page->seq;
+            }
+        }
+        else if (!FlashLog_IsBlank(page, FLASH_LOG_PAGE_SIZE))
+        {
+            s_dirtySectors |= (1UL << FlashLog_SectorOf(slot));
+        }
+    }
+
+    if (newestSlot < FLASH_LOG_SLOT_COUNT)
+    {
+        s_nextSeq   = s_stats.newestSeq + 1U;
+        s_writeSlot = (newestSlot + 1U) % FLASH_LOG_SLOT_COUNT;
+    }
+
+    HAL_NVIC_SetPriority(FLASH_IRQn, IRQ_PRIO_FLASH, 0U);
+    HAL_NVIC_EnableIRQ(FLASH_IRQn);
+
+    LOG_INFO("FlashLog: %lu/%lu pages used, next slot %lu",
+             (unsigned long)s_stats.pagesUsed, (unsigned long)FLASH_LOG_SLOT_COUNT,
+             (unsigned long)s_writeSlot);
+}
+
+void FlashLog_SetEnabled(bool enable)
+{
+    if (!enable)
+    {
+        FlashLog_Flush();
+    }
+
+    s_enabled = enable && s_ready;
+}
+
+bool FlashLog_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+bool FlashLog_AddSample(const SensorSample_t *sample)
+{
+    if (!s_enabled || (sample == NULL))
+    {
+        return false;
+    }
+
+    if (!s_buildActive)
+    {
+        SampleCodec_Begin(&s_codec, SAMPLE_CODEC_DELTA, sample->timestamp,
+                          s_build.payload, sizeof(s_build.payload));
+        s_build.base_ms = sample->timestamp;
+        s_buildStart_ms = HAL_GetTick();
+        s_buildActive   = true;
+    }
+
+    if (!SampleCodec_Add(&s_codec, sample))
+    {
+        FlashLog_Seal();
+        return FlashLog_AddSample(sample);
+    }
+
+    s_stats.samples++;
+
+    if (s_codec.count >= 0xFFU)
+    {
+        FlashLog_Seal();
+    }
+
+    return true;
+}
+
+void FlashLog_Flush(void)
+{
+    if (s_buildActive)
+    {
+        FlashLog_Seal();
+    }
+}
+
+void FlashLog_Service(uint32_t now_ms)
+{
+    if (!s_ready)
+    {
+        return;
+    }
+
+    if (s_eraseState != FLASH_LOG_ERASE_IDLE)
+    {
+        FlashLog_CompleteErase();
+        return;
+    }
+
+    if (s_buildActive && ((now_ms - s_buildStart_ms) >= FLASH_LOG_MAX_PAGE_AGE_MS))
+    {
+        FlashLog_Seal();
+    }
+
+    if (s_dumping)
+    {
+        FlashLog_ServiceDump();
+        return;
+    }
+
+    /* A firmware update erasing its slot: the queue keeps filling. */
+    if ((s_queueCount > 0U) && (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) == 0U))
+    {
+        FlashLog_WriteQueued();
+    }
+}
+
+uint32_t FlashLog_StartDump(void)
+{
+    if (!s_ready || s_dumping)
+    {
+        return 0U;
+    }
+
+    /* The slot after the write position holds the oldest page (or is blank). */
+    s_dumpSlot      = s_writeSlot;
+    s_dumpRemaining = FLASH_LOG_SLOT_COUNT;
+    s_dumping       = true;
+
+    return s_dumpRemaining;
+}
+
+void FlashLog_BeginRead(FlashLogReader_t *reader)
+{
+    /* Oldest first, as in the dump. */
+    reader->slot      = s_writeSlot;
+    reader->remaining = s_ready ? FLASH_LOG_SLOT_COUNT : 0U;
+    reader->inPage    = false;
+}
+
+bool FlashLog_Read(FlashLogReader_t *reader, SampleCodecRecord_t *record)
+{
+    for (;;)
+    {
+        if (reader->inPage && SampleCodec_Read(&reader->codec, record))
+        {
+            return true;
+        }
+        reader->inPage = false;
+
+        if (reader->remaining == 0U)
+        {
+            return false;
+        }
+
+        const FlashLogPage_t *page = FlashLog_Slot(reader->slot);
+
+        reader->slot = (reader->slot + 1U) % FLASH_LOG_SLOT_COUNT;
+        reader->remaining--;
+
+        if (FlashLog_IsValid(page))
+        {
+            SampleCodec_BeginRead(&reader->codec, (SampleCodecMode_t)page->mode, page->base_ms,
+                                  page->payload, page->length);
+            reader->inPage = true;
+        }
+    }
+}
+
+bool FlashLog_IsDumping(void)
+{
+    return s_dumping;
+}
+
+bool FlashLog_IsErasing(void)
+{
+    return (s_eraseState == FLASH_LOG_ERASE_BUSY);
+}
+
+bool FlashLog_EraseAll(void)
+{
+    if (!s_ready || (s_eraseState != FLASH_LOG_ERASE_IDLE))
+    {
+        return false;
+    }
+
+    FLASH_EraseInitTypeDef erase =
+    {
+        .TypeErase    = FLASH_TYPEERASE_SECTORS,
+        .Sector       = FLASH_LOG_FIRST_SECTOR,
+        .NbSectors    = FLASH_LOG_SECTOR_COUNT,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3
+    };
+    uint32_t failedSector = 0U;
+
+    (void)HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &failedSector);
+    (void)HAL_FLASH_Lock();
+
+    s_buildActive      = false;
+    s_queueCount       = 0U;
+    s_dumping          = false;
+    s_writeSlot        = 0U;
+    s_dirtySectors     = 0U;
+    s_stats.pagesUsed  = 0U;
+
+    if (status != HAL_OK)
+    {
+        s_dirtySectors = (1UL << FLASH_LOG_SECTOR_COUNT) - 1U;
+        s_stats.errors++;
+        return false;
+    }
+
+    s_stats.erases += FLASH_LOG_SECTOR_COUNT;
+    return true;
+}
+
+void FlashLog_GetStats(FlashLogStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats             = s_stats;
+        stats->pagesQueued = s_queueCount;
+    }
+}
+
+/**
+ * @brief HAL flash interrupt callback: an IT erase step has finished.
+ *
+ * @param ReturnValue Erased sector, or 0xFFFFFFFF once all are done.
+ */
+void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+    if ((s_eraseState == FLASH_LOG_ERASE_BUSY) && (ReturnValue == 0xFFFFFFFFU))
+    {
+        s_eraseState = FLASH_LOG_ERASE_DONE;
+    }
+}
+
+/**
+ * @brief HAL flash interrupt callback: an IT operation failed.
+ *
+ * @param ReturnValue Failing sector or address.
+ */
+void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+    (void)ReturnValue;
+
+    if (s_eraseState == FLASH_LOG_ERASE_BUSY)
+    {
+        s_eraseState = FLASH_LOG_ERASE_FAILED;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool FlashLog_IsValid(const FlashLogPage_t *page)
+{
+    return (page->magic == FLASH_LOG_MAGIC) &&
+           (page->length <= FLASH_LOG_PAYLOAD_SIZE) &&
+           (page->crc == Crc32_Compute(page, FLASH_LOG_PAGE_SIZE - 4U));
+}
+
+static bool FlashLog_IsBlank(const void *data, size_t len)
+{
+    const uint32_t *word = (const uint32_t *)data;
+
+    for (size_t i = 0U; i < (len / 4U); ++i)
+    {
+        if (word[i] != FLASH_LOG_ERASED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void FlashLog_Seal(void)
+{
+    s_buildActive = false;
+
+    if (s_codec.count == 0U)
+    {
+        return;
+    }
+
+    if (s_queueCount >= FLASH_LOG_QUEUE_PAGES)
+    {
+        s_stats.pagesDropped++;
+        return;
+    }
+
+    FlashLogPage_t *page = &s_queue[(s_queueHead + s_queueCount) % FLASH_LOG_QUEUE_PAGES];
+
+    s_build.magic  = FLASH_LOG_MAGIC;
+    s_build.seq    = s_nextSeq++;
+    s_build.mode   = (uint8_t)s_codec.mode;
+    s_build.count  = (uint8_t)s_codec.count;
+    s_build.length = (uint16_t)s_codec.length;
+    memset(&s_build.payload[s_codec.length], 0xFF, FLASH_LOG_PAYLOAD_SIZE - s_codec.length);
+    s_build.crc    = Crc32_Compute(&s_build, FLASH_LOG_PAGE_SIZE - 4U);
+
+    *page = s_build;
+    s_queueCount++;
+}
+
+static void FlashLog_StartErase(uint32_t sector)
+{
+    FLASH_EraseInitTypeDef erase =
+    {
+        .TypeErase    = FLASH_TYPEERASE_SECTORS,
+        .Sector       = FLASH_LOG_FIRST_SECTOR + sector,
+        .NbSectors    = 1U,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3
+    };
+
+    s_erasePages = 0U;
+    for (uint32_t i = 0U; i < FLASH_LOG_SLOTS_PER_SECTOR; ++i)
+    {
+        if (FlashLog_Slot((sector * FLASH_LOG_SLOTS_PER_SECTOR) + i)->magic == FLASH_LOG_MAGIC)
+        {
+            s_erasePages++;
+        }
+    }
+
+    (void)HAL_FLASH_Unlock();
+    s_eraseState = FLASH_LOG_ERASE_BUSY;
+
+    if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK)
+    {
+        s_eraseState = FLASH_LOG_ERASE_FAILED;
+    }
+}
+
+static void FlashLog_CompleteErase(void)
+{
+    FlashLogEraseState_t state = s_eraseState;
+    if (state == FLASH_LOG_ERASE_BUSY)
+    {
+        return;
+    }
+
+    (void)HAL_FLASH_Lock();
+    s_eraseState = FLASH_LOG_ERASE_IDLE;
+
+    uint32_t sector = FlashLog_SectorOf(s_writeSlot);
+
+    if (state == FLASH_LOG_ERASE_FAILED)
+    {
+        /* Skip the sector rather than retry it forever. */
+        s_stats.errors++;
+        s_writeSlot = ((sector + 1U) % FLASH_LOG_SECTOR_COUNT) * FLASH_LOG_SLOTS_PER_SECTOR;
+        return;
+    }
+
+    s_dirtySectors    &= ~(1UL << sector);
+    s_stats.pagesUsed -= s_erasePages;
+    s_stats.erases++;
+}
+
+static void FlashLog_WriteQueued(void)
+{
+    uint32_t              sector = FlashLog_SectorOf(s_writeSlot);
+    const FlashLogPage_t *slot   = FlashLog_Slot(s_writeSlot);
+
+    if (((s_writeSlot % FLASH_LOG_SLOTS_PER_SECTOR) == 0U) &&
+        ((slot->magic != FLASH_LOG_ERASED) || ((s_dirtySectors & (1UL << sector)) != 0U)))
+    {
+        FlashLog_StartErase(sector);
+        return;
+    }
+
+    if (!FlashLog_IsBlank(slot, FLASH_LOG_PAGE_SIZE))
+    {
+        /* Left over from an interrupted write: not programmable. */
+        s_writeSlot = (s_writeSlot + 1U) % FLASH_LOG_SLOT_COUNT;
+        return;
+    }
+
+    const uint32_t *words   = (const uint32_t *)&s_queue[s_queueHead];
+    uint32_t        address = (uint32_t)(uintptr_t)slot;
+    bool            ok      = true;
+
+    (void)HAL_FLASH_Unlock();
+    for (uint32_t i = 0U; ok && (i < (FLASH_LOG_PAGE_SIZE / 4U)); ++i)
+    {
+        ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + (4U * i), words[i]) == HAL_OK);
+    }
+    (void)HAL_FLASH_Lock();
+
+    if (ok)
+    {
+        s_stats.pagesWritten++;
+        s_stats.pagesUsed++;
+        s_stats.newestSeq = s_queue[s_queueHead].seq;
+        s_queueHead       = (s_queueHead + 1U) % FLASH_LOG_QUEUE_PAGES;
+        s_queueCount--;
+    }
+    else
+    {
+        s_stats.errors++;
+    }
+
+    s_writeSlot = (s_writeSlot + 1U) % FLASH_LOG_SLOT_COUNT;
+}
+
+static void FlashLog_ServiceDump(void)
+{
+    while (s_dumpRemaining > 0U)
+    {
+        const FlashLogPage_t *page = FlashLog_Slot(s_dumpSlot);
+
+        if (FlashLog_IsValid(page))
+        {
+            if (!Telemetry_SendBatch((SampleCodecMode_t)page->mode, page->base_ms, page->count,
+                                     page->payload, page->length))
+            {
+                return; /* TX ring full: continue on the next service. */
+            }
+        }
+
+        s_dumpSlot = (s_dumpSlot + 1U) % FLASH_LOG_SLOT_COUNT;
+        s_dumpRemaining--;
+    }
+
+    s_dumping = false;
+    LOG_INFO("FlashLog: dump complete");
+}
@@ -0,0 +1,227 @@
+/**
+ * @file flash_log.h
+ * @brief Append-only sample log in on-chip flash.
+ *
+ * Samples are retained when no host is connected. Sector 3 of the
+ * STM32F446 (16 KB, the FLASHLOG region of the linker script; the sectors
+ * above hold the two firmware image slots, fw_update.h) forms a ring of
+ * fixed-size pages:
+ *
+ *     magic:u32 seq:u32 base_ms:u32 mode:u8 count:u8 length:u16
+ *     payload[length] (sample_codec.h batch) ... crc:u32
+ *
+ * Samples are encoded into a page in RAM; a full page (or one older than
+ * @ref FLASH_LOG_MAX_PAGE_AGE_MS) is sealed into a small RAM queue and
+ * programmed by FlashLog_Service(). When the ring reaches a sector that
+ * still holds old pages, that sector is erased with the interrupt-driven
+ * HAL erase while new pages wait in the queue. With the one log sector,
+ * that erase drops the whole log: it holds the last 64 pages. Pages also
+ * wait while a firmware update erases its slot.
+ *
+ * The page sequence number grows across resets, so the newest page and
+ * the write position are found by scanning page headers at start-up. Page
+ * timestamps are HAL ticks and restart at every reset.
+ *
+ * Note: the F446 has a single flash bank, so instruction fetches stall
+ * while a page is programmed (~1 ms) or a sector is erased (1-2 s). Only
+ * code and data in RAM, and DMA, keep running during an erase.
+ *
+ * @ingroup common
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sample_ring.h"
+#include "sample_codec.h"
+
+/**
+ * @defgroup flash_log Flash Log
+ * @brief Wear-leveled ring of compressed sample pages in on-chip flash.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Size of one log page in bytes (a multiple of 4). */
+#define FLASH_LOG_PAGE_SIZE          (256U)
+
+/** @brief Sealed pages buffered in RAM while flash is busy. */
+#define FLASH_LOG_QUEUE_PAGES        (4U)
+
+/**
+ * @brief Longest time samples stay in the RAM page before it is sealed (ms).
+ *
+ * Bounds the data lost on a reset at low sample rates.
+ */
+#ifndef FLASH_LOG_MAX_PAGE_AGE_MS
+#define FLASH_LOG_MAX_PAGE_AGE_MS    (300000U)
+#endif
+
+/**
+ * @brief Flash log counters.
+ */
+typedef struct
+{
+    uint32_t pagesTotal;   /**< Page slots in the log region.                 */
+    uint32_t pagesUsed;    /**< Slots holding a valid page.                   */
+    uint32_t pagesQueued;  /**< Sealed pages waiting to be programmed.        */
+    uint32_t pagesWritten; /**< Pages programmed since start-up.              */
+    uint32_t pagesDropped; /**< Pages lost because the RAM queue was full.    */
+    uint32_t samples;      /**< Samples added since start-up.                 */
+    uint32_t erases;       /**< Sectors erased since start-up.                */
+    uint32_t errors;       /**< Failed program or erase operations.           */
+    uint32_t newestSeq;    /**< Sequence number of the newest page (0: none). */
+} FlashLogStats_t;
+
+/**
+ * @brief Sequential reader of the stored samples; see FlashLog_BeginRead().
+ */
+typedef struct
+{
+    uint32_t            slot;      /**< Slot of the page being read.     */
+    uint32_t            remaining; /**< Slots not yet visited.           */
+    bool                inPage;    /**< @ref codec holds an open page.   */
+    SampleCodecReader_t codec;     /**< Decoder of the current page.     */
+} FlashLogReader_t;
+
+/**
+ * @brief Locate the write position by scanning the log region.
+ *
+ * Sectors holding anything other than log pages are scheduled for erase
+ * before they are used. Logging starts disabled.
+ *
+ * @return None.
+ */
+void FlashLog_Init(void);
+
+/**
+ * @brief Turn sample logging on or off.
+ *
+ * The RAM page is sealed when logging is turned off.
+ *
+ * @param enable true to log samples.
+ *
+ * @return None.
+ */
+void FlashLog_SetEnabled(bool enable);
+
+/**
+ * @brief Whether sample logging is on.
+ *
+ * @return true if FlashLog_AddSample() stores samples.
+ */
+bool FlashLog_IsEnabled(void);
+
+/**
+ * @brief Add a sample to the RAM page.
+ *
+ * Must be called from thread mode.
+ *
+ * @param sample Sample to store.
+ *
+ * @return false if logging is disabled or @p sample is NULL.
+ */
+bool FlashLog_AddSample(const SensorSample_t *sample);
+
+/**
+ * @brief Seal the RAM page so it is written on the next service.
+ *
+ * @return None.
+ */
+void FlashLog_Flush(void);
+
+/**
+ * @brief Background work: program queued pages, erase sectors, dump.
+ *
+ * Programs at most one page per call. Call periodically from a task.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void FlashLog_Service(uint32_t now_ms);
+
+/**
+ * @brief Start streaming all stored pages, oldest first.
+ *
+ * Each page is sent as one telemetry frame (telemetry.h) as fast as the
+ * UART TX ring drains; decode with tools/telemetry_decode.py. Programming
+ * and erasing are held off until the dump ends.
+ *
+ * @return Number of slots that will be scanned, 0 if a dump is running.
+ */
+uint32_t FlashLog_StartDump(void);
+
+/**
+ * @brief Start reading the stored samples, oldest page first.
+ *
+ * Reads what is programmed now; pages still in the RAM queue are not
+ * seen. Pages programmed while reading may or may not be, so turn
+ * logging off first for a repeatable read.
+ *
+ * @param[out] reader Reader state.
+ *
+ * @return None.
+ */
+void FlashLog_BeginRead(FlashLogReader_t *reader);
+
+/**
+ * @brief Decode the next stored sample.
+ *
+ * Each page's CRC is checked when the reader reaches it; invalid and
+ * blank slots are skipped.
+ *
+ * @param reader      Reader state.
+ * @param[out] record Receives the sample.
+ *
+ * @return false once every slot has been read.
+ */
+bool FlashLog_Read(FlashLogReader_t *reader, SampleCodecRecord_t *record);
+
+/**
+ * @brief Whether a dump is in progress.
+ *
+ * @return true while pages are being streamed.
+ */
+bool FlashLog_IsDumping(void);
+
+/**
+ * @brief Whether a background sector erase is running.
+ *
+ * Other flash writers (config_store.c) must wait while this is true.
+ *
+ * @return true between the erase start and its completion interrupt.
+ */
+bool FlashLog_IsErasing(void);
+
+/**
+ * @brief Erase the whole log (blocking, several seconds).
+ *
+ * Pending RAM pages are discarded.
+ *
+ * @return true if every sector was erased.
+ */
+bool FlashLog_EraseAll(void);
+
+/**
+ * @brief Snapshot the flash log counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void FlashLog_GetStats(FlashLogStats_t *stats);
+
+/** @} */ /* end of flash_log group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_LOG_H */
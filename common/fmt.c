@@ -0,0 +1,488 @@
+/**
+ * @file fmt.c
+ * @brief Small reentrant printf-style formatter implementation.
+ *
+ * Each conversion is rendered right-to-left into a small stack buffer and
+ * then emitted with its sign/prefix, zero padding and width. Integers up
+ * to 32 bits use 32-bit division only; 64-bit arguments take a separate,
+ * slower path. All state lives on the caller's stack.
+ *
+ * @ingroup fmt
+ */
+
+#include "fmt.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Left-justify within the field width ('-'). */
+#define FMT_FLAG_LEFT    (1U << 0)
+/** @brief Pad with zeros instead of spaces ('0'). */
+#define FMT_FLAG_ZERO    (1U << 1)
+/** @brief Always print a sign ('+'). */
+#define FMT_FLAG_PLUS    (1U << 2)
+/** @brief Print a space in place of a '+' sign (' '). */
+#define FMT_FLAG_SPACE   (1U << 3)
+
+/** @brief Largest %f precision. */
+#define FMT_MAX_FLOAT_PRECISION   (9U)
+
+/** @brief Default %f precision. */
+#define FMT_DEFAULT_FLOAT_PRECISION   (6U)
+
+/** @brief Digits of the widest conversion (a 64-bit octal would need more). */
+#define FMT_DIGIT_BUFFER_SIZE   (24U)
+
+/**
+ * @brief Output sink with snprintf() truncation rules.
+ */
+typedef struct
+{
+    char  *buf;  /**< Destination.                           */
+    size_t size; /**< Destination size.                      */
+    size_t len;  /**< Characters produced (may exceed size). */
+} FmtOut_t;
+
+/**
+ * @brief Conversion specification.
+ */
+typedef struct
+{
+    uint32_t flags;     /**< FMT_FLAG_* bits.                  */
+    int32_t  width;     /**< Minimum field width.              */
+    int32_t  precision; /**< Precision, or -1 when not given.  */
+} FmtSpec_t;
+
+/** @brief Powers of ten for the %f fraction. */
+static const uint32_t s_pow10[FMT_MAX_FLOAT_PRECISION + 1U] =
+{
+    1U, 10U, 100U, 1000U, 10000U, 100000U, 1000000U, 10000000U, 100000000U, 1000000000U
+};
+
+/**
+ * @brief Append one character.
+ */
+static inline void Fmt_Put(FmtOut_t *out, char c)
+{
+    if ((out->len + 1U) < out->size)
+    {
+        out->buf[out->len] = c;
+    }
+    out->len++;
+}
+
+/**
+ * @brief Append @p count copies of @p c.
+ */
+static void Fmt_Repeat(FmtOut_t *out, char c, int32_t count);
+
+/**
+ * @brief Emit a field: sign/prefix, precision zeros, body, width padding.
+ */
+static void Fmt_Field(FmtOut_t *out, const FmtSpec_t *spec,
+                      const char *prefix, uint32_t prefixLen,
+                      const char *body, uint32_t bodyLen, uint32_t zeros);
+
+/**
+ * @brief Render an unsigned value right-aligned at @p end.
+ *
+ * @return First digit.
+ */
+static char *Fmt_Digits(char *end, uint64_t value, uint32_t base, bool upper);
+
+/**
+ * @brief Emit an integer conversion.
+ */
+static void Fmt_Integer(FmtOut_t *out, const FmtSpec_t *spec, uint64_t magnitude,
+                        bool negative, uint32_t base, bool upper, bool isSigned);
+
+/**
+ * @brief Emit a %f conversion.
+ */
+static void Fmt_Fixed(FmtOut_t *out, const FmtSpec_t *spec, float value);
+
+/* ------------------------------------------------------------------------- */
+
+int Fmt_VFormat(char *buf, size_t size, const char *fmt, va_list args)
+{
+    FmtOut_t out = { buf, size, 0U };
+
+    while (*fmt != '\0')
+    {
+        if (*fmt != '%')
+        {
+            Fmt_Put(&out, *fmt++);
+            continue;
+        }
+
+        const char *start = fmt++;
+        FmtSpec_t   spec  = { 0U, 0, -1 };
+
+        /* Flags. */
+        for (;; ++fmt)
+        {
+            if (*fmt == '-')      { spec.flags |= FMT_FLAG_LEFT;  }
+            else if (*fmt == '0') { spec.flags |= FMT_FLAG_ZERO;  }
+            else if (*fmt == '+') { spec.flags |= FMT_FLAG_PLUS;  }
+            else if (*fmt == ' ') { spec.flags |= FMT_FLAG_SPACE; }
+            else                  { break; }
+        }
+
+        /* Width. */
+        if (*fmt == '*')
+        {
+            spec.width = (int32_t)va_arg(args, int);
+            if (spec.width < 0)
+            {
+                spec.flags |= FMT_FLAG_LEFT;
+                spec.width  = -spec.width;
+            }
+            fmt++;
+        }
+        else
+        {
+            while ((*fmt >= '0') && (*fmt <= '9'))
+            {
+                spec.width = (spec.width * 10) + (*fmt++ - '0');
+            }
+        }
+
+        /* Precision. */
+        if (*fmt == '.')
+        {
+            fmt++;
+            spec.precision = 0;
+            if (*fmt == '*')
+            {
+                spec.precision = (int32_t)va_arg(args, int);
+                fmt++;
+            }
+            else
+            {
+                while ((*fmt >= '0') && (*fmt <= '9'))
+                {
+                    spec.precision = (spec.precision * 10) + (*fmt++ - '0');
+                }
+            }
+        }
+
+        /* Length modifier: remember the argument size class. */
+        char length = '\0';
+        if ((*fmt == 'h') || (*fmt == 'l'))
+        {
+            length = *fmt++;
+            if (*fmt == length)
+            {
+                length = (length == 'l') ? 'L' : 'H';
+                fmt++;
+            }
+        }
+        else if ((*fmt == 'z') || (*fmt == 't') || (*fmt == 'j'))
+        {
+            length = *fmt++;
+        }
+
+        char conv = *fmt;
+        if (conv == '\0')
+        {
+            /* Truncated specification: copy it as text. */
+            while (start < fmt)
+            {
+                Fmt_Put(&out, *start++);
+            }
+            break;
+        }
+        fmt++;
+
+        switch (conv)
+        {
+            case 'd':
+            case 'i':
+            {
+                int64_t v;
+                switch (length)
+                {
+                    case 'L': v = (int64_t)va_arg(args, long long);   break;
+                    case 'l': v = (int64_t)va_arg(args, long);        break;
+                    case 'z': v = (int64_t)va_arg(args, size_t);      break;
+                    case 't': v = (int64_t)va_arg(args, ptrdiff_t);   break;
+                    case 'j': v = (int64_t)va_arg(args, intmax_t);    break;
+                    case 'h': v = (int64_t)(short)va_arg(args, int);  break;
+                    case 'H': v = (int64_t)(signed char)va_arg(args, int); break;
+                    default:  v = (int64_t)va_arg(args, int);         break;
+                }
+                uint64_t magnitude = (v < 0) ? (0U - (uint64_t)v) : (uint64_t)v;
+                Fmt_Integer(&out, &spec, magnitude, (v < 0), 10U, false, true);
+                break;
+            }
+
+            case 'u':
+            case 'x':
+            case 'X':
+            {
+                uint64_t v;
+                switch (length)
+                {
+                    case 'L': v = (uint64_t)va_arg(args, unsigned long long); break;
+                    case 'l': v = (uint64_t)va_arg(args, unsigned long);      break;
+                    case 'z': v = (uint64_t)va_arg(args, size_t);             break;
+                    case 't': v = (uint64_t)va_arg(args, ptrdiff_t);          break;
+                    case 'j': v = (uint64_t)va_arg(args, uintmax_t);          break;
+                    case 'h': v = (uint64_t)(unsigned short)va_arg(args, unsigned int); break;
+                    case 'H': v = (uint64_t)(unsigned char)va_arg(args, unsigned int);  break;
+                    default:  v = (uint64_t)va_arg(args, unsigned int);       break;
+                }
+                Fmt_Integer(&out, &spec, v, false, (conv == 'u') ? 10U : 16U,
+                            (conv == 'X'), false);
+                break;
+            }
+
+            case 'p':
+            {
+                uintptr_t v = (uintptr_t)va_arg(args, void *);
+                char      digits[FMT_DIGIT_BUFFER_SIZE];
+                char     *end   = &digits[sizeof(digits)];
+                char     *first = Fmt_Digits(end, (uint64_t)v, 16U, false);
+                spec.flags &= ~FMT_FLAG_ZERO;
+                Fmt_Field(&out, &spec, "0x", 2U, first, (uint32_t)(end - first), 0U);
+                break;
+            }
+
+            case 'c':
+            {
+                char c = (char)va_arg(args, int);
+                spec.flags &= ~FMT_FLAG_ZERO;
+                Fmt_Field(&out, &spec, "", 0U, &c, 1U, 0U);
+                break;
+            }
+
+            case 's':
+            {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL)
+                {
+                    str = "(null)";
+                }
+
+                uint32_t n = 0U;
+                while ((str[n] != '\0') &&
+                       ((spec.precision < 0) || (n < (uint32_t)spec.precision)))
+                {
+                    n++;
+                }
+
+                spec.flags &= ~FMT_FLAG_ZERO;
+                Fmt_Field(&out, &spec, "", 0U, str, n, 0U);
+                break;
+            }
+
+            case 'f':
+            case 'F':
+                Fmt_Fixed(&out, &spec, (float)va_arg(args, double));
+                break;
+
+            case '%':
+                Fmt_Put(&out, '%');
+                break;
+
+            default:
+                /* Unsupported conversion: copy the specification as text. */
+                while (start < fmt)
+                {
+                    Fmt_Put(&out, *start++);
+                }
+                break;
+        }
+    }
+
+    if (out.size != 0U)
+    {
+        out.buf[(out.len < out.size) ? out.len : (out.size - 1U)] = '\0';
+    }
+
+    return (int)out.len;
+}
+
+int Fmt_Format(char *buf, size_t size, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = Fmt_VFormat(buf, size, fmt, args);
+    va_end(args);
+
+    return len;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void Fmt_Repeat(FmtOut_t *out, char c, int32_t count)
+{
+    while (count-- > 0)
+    {
+        Fmt_Put(out, c);
+    }
+}
+
+static void Fmt_Field(FmtOut_t *out, const FmtSpec_t *spec,
+                      const char *prefix, uint32_t prefixLen,
+                      const char *body, uint32_t bodyLen, uint32_t zeros)
+{
+    int32_t pad = spec->width - (int32_t)(prefixLen + zeros + bodyLen);
+
+    if ((spec->flags & (FMT_FLAG_LEFT | FMT_FLAG_ZERO)) == 0U)
+    {
+        Fmt_Repeat(out, ' ', pad);
+    }
+
+    for (uint32_t i = 0U; i < prefixLen; ++i)
+    {
+        Fmt_Put(out, prefix[i]);
+    }
+
+    if ((spec->flags & (FMT_FLAG_LEFT | FMT_FLAG_ZERO)) == FMT_FLAG_ZERO)
+    {
+        Fmt_Repeat(out, '0', pad);
+    }
+
+    Fmt_Repeat(out, '0', (int32_t)zeros);
+
+    for (uint32_t i = 0U; i < bodyLen; ++i)
+    {
+        Fmt_Put(out, body[i]);
+    }
+
+    if ((spec->flags & FMT_FLAG_LEFT) != 0U)
+    {
+        Fmt_Repeat(out, ' ', pad);
+    }
+}
+
+static char *Fmt_Digits(char *end, uint64_t value, uint32_t base, bool upper)
+{
+    const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char       *p      = end;
+
+    /* 64-bit division is a library call on Cortex-M: use it only when needed. */
+    while (value > UINT32_MAX)
+    {
+        *--p   = digits[value % base];
+        value /= base;
+    }
+
+    uint32_t v32 = (uint32_t)value;
+    do
+    {
+        *--p = digits[v32 % base];
+        v32 /= base;
+    } while (v32 != 0U);
+
+    return p;
+}
+
+static void Fmt_Integer(FmtOut_t *out, const FmtSpec_t *spec, uint64_t magnitude,
+                        bool negative, uint32_t base, bool upper, bool isSigned)
+{
+    char     digits[FMT_DIGIT_BUFFER_SIZE];
+    char    *end   = &digits[sizeof(digits)];
+    char    *first = end;
+    char     sign  = '\0';
+    FmtSpec_t field = *spec;
+
+    if ((spec->precision != 0) || (magnitude != 0U))
+    {
+        first = Fmt_Digits(end, magnitude, base, upper);
+    }
+
+    uint32_t count = (uint32_t)(end - first);
+    uint32_t zeros = 0U;
+
+    /* A precision sets the minimum digit count and disables '0' padding. */
+    if (spec->precision >= 0)
+    {
+        field.flags &= ~FMT_FLAG_ZERO;
+        if ((uint32_t)spec->precision > count)
+        {
+            zeros = (uint32_t)spec->precision - count;
+        }
+    }
+
+    if (negative)
+    {
+        sign = '-';
+    }
+    else if (isSigned && ((spec->flags & FMT_FLAG_PLUS) != 0U))
+    {
+        sign = '+';
+    }
+    else if (isSigned && ((spec->flags & FMT_FLAG_SPACE) != 0U))
+    {
+        sign = ' ';
+    }
+
+    Fmt_Field(out, &field, &sign, (sign != '\0') ? 1U : 0U, first, count, zeros);
+}
+
+static void Fmt_Fixed(FmtOut_t *out, const FmtSpec_t *spec, float value)
+{
+    FmtSpec_t field = *spec;
+    char      sign  = '\0';
+
+    if (value < 0.0f)
+    {
+        sign  = '-';
+        value = -value;
+    }
+    else if ((spec->flags & FMT_FLAG_PLUS) != 0U)
+    {
+        sign = '+';
+    }
+    else if ((spec->flags & FMT_FLAG_SPACE) != 0U)
+    {
+        sign = ' ';
+    }
+
+    /* Written so that NaN fails the range test too. */
+    if (!(value < 4294967296.0f))
+    {
+        const char *text = (value != value) ? "nan" : ((value > 3.4e38f) ? "inf" : "ovf");
+        field.flags &= ~FMT_FLAG_ZERO;
+        Fmt_Field(out, &field, &sign, (sign != '\0') ? 1U : 0U, text, 3U, 0U);
+        return;
+    }
+
+    uint32_t precision = (spec->precision < 0) ? FMT_DEFAULT_FLOAT_PRECISION
+                                               : (uint32_t)spec->precision;
+    if (precision > FMT_MAX_FLOAT_PRECISION)
+    {
+        precision = FMT_MAX_FLOAT_PRECISION;
+    }
+
+    uint32_t whole  = (uint32_t)value;
+    uint32_t scale  = s_pow10[precision];
+    uint32_t scaled = (uint32_t)(((value - (float)whole) * (float)scale) + 0.5f);
+
+    if (scaled >= scale)
+    {
+        scaled -= scale;
+        whole++;
+    }
+
+    /* Fraction digits (zero-padded to the precision), point, whole part. */
+    char  digits[FMT_DIGIT_BUFFER_SIZE];
+    char *end = &digits[sizeof(digits)];
+    char *p   = end;
+
+    for (uint32_t i = 0U; i < precision; ++i)
+    {
+        *--p    = (char)('0' + (scaled % 10U));
+        scaled /= 10U;
+    }
+    if (precision > 0U)
+    {
+        *--p = '.';
+    }
+    p = Fmt_Digits(p, whole, 10U, false);
+
+    Fmt_Field(out, &field, &sign, (sign != '\0') ? 1U : 0U, p, (uint32_t)(end - p), 0U);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file fmt.h
+ * @brief Small reentrant printf-style formatter.
+ *
+ * Covers the conversions the firmware uses, without newlib's vfprintf
+ * and its floating-point (dtoa) support:
+ *
+ * - Conversions: %d %i %u %x %X %c %s %p %% and fixed-point %f / %F
+ * - Flags: '-', '0', '+', ' '; width and precision as digits or '*'
+ * - Length modifiers: h, hh, l, ll, z, t, j
+ *
+ * %f takes the usual double argument but computes in single precision
+ * with the FPU: at most 9 decimals (default 6), and magnitudes of 2^32
+ * or more print as "ovf". Unknown conversions are copied to the output
+ * unchanged and consume no argument.
+ *
+ * The functions keep no state and can be called from any context.
+ *
+ * @ingroup common
+ */
+
+#ifndef FMT_H
+#define FMT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdarg.h>
+#include <stddef.h>
+
+/**
+ * @defgroup fmt Formatter
+ * @brief Integer-only printf subset with fixed-point float output.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Format into a buffer (vsnprintf() semantics).
+ *
+ * @param buf  Destination, NUL-terminated unless @p size is 0.
+ * @param size Size of @p buf in bytes.
+ * @param fmt  Format string.
+ * @param args Arguments.
+ *
+ * @return Length the complete output would have, excluding the NUL.
+ */
+int Fmt_VFormat(char *buf, size_t size, const char *fmt, va_list args);
+
+/**
+ * @brief Format into a buffer (snprintf() semantics).
+ *
+ * @param buf  Destination, NUL-terminated unless @p size is 0.
+ * @param size Size of @p buf in bytes.
+ * @param fmt  Format string.
+ *
+ * @return Length the complete output would have, excluding the NUL.
+ */
+int Fmt_Format(char *buf, size_t size, const char *fmt, ...);
+
+/** @} */ /* end of fmt group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FMT_H */
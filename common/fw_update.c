@@ -0,0 +1,641 @@
+/**
+ * @file fw_update.c
+ * @brief Firmware update implementation.
+ *
+ * `fw begin` starts the interrupt-driven erase of the sectors the image
+ * needs in the inactive slot, one sector at a time; FwUpdate_Service()
+ * waits for each one (FLASH busy flag), checks it reads blank and starts
+ * the next. The FLASH interrupt callbacks belong to the flash log, which
+ * ignores erases it did not start, and the flash log and the config store
+ * hold back while the busy flag is set.
+ *
+ * Once the slot is blank the CLI input handler collects bytes up to each
+ * 0x00, the frame is decoded in place and checked, and a chunk at the
+ * expected offset is programmed word by word and read back. Everything
+ * runs in thread mode: the handler from CLI_Process(), the timeout and the
+ * erase steps from the FlashLog task.
+ *
+ * `fw swap` programs the header of the verified image (magic last, so a
+ * reset in between leaves no valid header) and resets once the reply has
+ * gone out.
+ *
+ * @ingroup fw_update
+ */
+
+#include "fw_update.h"
+#include "app_config.h"
+#include "cobs.h"
+#include "crc32.h"
+#include "cli.h"
+#include "log.h"
+#include "uart_tx.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+_Static_assert(sizeof(FwUpdateHeader_t) <= FW_UPDATE_HEADER_SIZE, "slot header size");
+_Static_assert((FW_UPDATE_CHUNK_SIZE % 4U) == 0U, "chunks are programmed in words");
+
+/** @brief Frame header: type and offset. */
+#define FW_UPDATE_FRAME_HEADER   (5U)
+
+/** @brief Largest frame before stuffing: header, chunk, CRC. */
+#define FW_UPDATE_RAW_SIZE       (FW_UPDATE_FRAME_HEADER + FW_UPDATE_CHUNK_SIZE + 4U)
+
+/** @brief Sectors of a slot. */
+#define FW_UPDATE_SLOT_SECTORS   (2U)
+
+/** @brief Longest wait for the swap reply to go out before the reset (ms). */
+#define FW_UPDATE_SWAP_DRAIN_MS  (500U)
+
+/**
+ * @brief One flash sector of a slot.
+ */
+typedef struct
+{
+    uint32_t sector;  /**< FLASH_SECTOR_x.   */
+    uint32_t base;    /**< First address.    */
+    uint32_t size;    /**< Bytes.            */
+} FwUpdateSector_t;
+
+/**
+ * @brief Transfer state.
+ */
+typedef enum
+{
+    FW_UPDATE_STATE_IDLE = 0U, /**< No transfer since start-up.             */
+    FW_UPDATE_STATE_ERASING,   /**< Erasing the inactive slot.              */
+    FW_UPDATE_STATE_RECEIVING, /**< Taking chunks.                          */
+    FW_UPDATE_STATE_VERIFIED,  /**< Complete and matching; `fw swap` next.  */
+    FW_UPDATE_STATE_SWAPPING,  /**< Header written, reset pending.          */
+    FW_UPDATE_STATE_FAILED     /**< Ended without a verified image.         */
+} FwUpdateState_t;
+
+/** @brief Sectors of each slot, in address order. */
+static const FwUpdateSector_t s_sectors[FW_UPDATE_SLOT_COUNT][FW_UPDATE_SLOT_SECTORS] =
+{
+    { { FLASH_SECTOR_4, FW_UPDATE_SLOT_A_BASE,  64U * 1024U }, { FLASH_SECTOR_5, 0x08020000U, 128U * 1024U } },
+    { { FLASH_SECTOR_6, FW_UPDATE_SLOT_B_BASE, 128U * 1024U }, { FLASH_SECTOR_7, 0x08060000U, 128U * 1024U } },
+};
+
+/** @brief Slot the bootloader started, and its sequence number (0 without header). */
+static FwUpdateSlot_t s_active    = FW_UPDATE_SLOT_A;
+static uint32_t       s_activeSeq = 0U;
+
+/** @brief Transfer state and the reason of the last failure. */
+static FwUpdateState_t s_state  = FW_UPDATE_STATE_IDLE;
+static const char     *s_reason = "";
+
+/** @brief Announced image size and CRC. */
+static uint32_t s_size = 0U;
+static uint32_t s_crc  = 0U;
+
+/** @brief Image offset of the next chunk. */
+static uint32_t s_offset = 0U;
+
+/** @brief Slot sectors the image needs, and the one being erased. */
+static uint32_t s_eraseCount = 0U;
+static uint32_t s_eraseIndex = 0U;
+
+/** @brief Tick of `fw begin`, of the last frame and of the swap request. */
+static uint32_t s_begin_ms = 0U;
+static uint32_t s_frame_ms = 0U;
+static uint32_t s_swap_ms  = 0U;
+
+/** @brief Frames taken, and those answered with another offset. */
+static uint32_t s_frames  = 0U;
+static uint32_t s_resends = 0U;
+
+/** @brief The running image's confirmation is done (or not needed). */
+static bool s_confirmed = true;
+
+/** @brief Received frame, still stuffed, and whether it overflowed. */
+static uint8_t  s_rxFrame[COBS_MAX_ENCODED_SIZE(FW_UPDATE_RAW_SIZE)];
+static uint32_t s_rxLen      = 0U;
+static bool     s_rxOverflow = false;
+
+/**
+ * @brief Slot that is not running.
+ */
+static inline FwUpdateSlot_t FwUpdate_Inactive(void)
+{
+    return (s_active == FW_UPDATE_SLOT_A) ? FW_UPDATE_SLOT_B : FW_UPDATE_SLOT_A;
+}
+
+/**
+ * @brief Whether a flash operation (any erase) is running.
+ */
+static inline bool FwUpdate_FlashBusy(void)
+{
+    return (__HAL_FLASH_GET_FLAG(FLASH_FLAG_BSY) != 0U);
+}
+
+/**
+ * @brief Handle the `fw` CLI command.
+ */
+static void FwUpdate_CmdFw(uint32_t argc, char *argv[]);
+
+/**
+ * @brief `fw begin <size> <crc>`: check the image and start the erase.
+ */
+static void FwUpdate_Begin(uint32_t size, uint32_t crc);
+
+/**
+ * @brief `fw swap`: write the header of the verified image and reset.
+ */
+static void FwUpdate_Swap(void);
+
+/**
+ * @brief Start the erase of sector @ref s_eraseIndex of the inactive slot.
+ */
+static void FwUpdate_StartErase(void);
+
+/**
+ * @brief Check the finished sector and start the next, or take chunks.
+ */
+static void FwUpdate_ServiceErase(uint32_t now_ms);
+
+/**
+ * @brief CLI input handler during the transfer: collect frames.
+ */
+static void FwUpdate_OnInput(uint8_t ch);
+
+/**
+ * @brief Check and program one received frame, and answer it.
+ */
+static void FwUpdate_OnFrame(void);
+
+/**
+ * @brief End the transfer and give the console back to the command line.
+ */
+static void FwUpdate_End(FwUpdateState_t state, const char *reason);
+
+/**
+ * @brief Program @p len bytes (a multiple of 4) and read them back.
+ */
+static bool FwUpdate_Program(uint32_t address, const void *data, uint32_t len);
+
+/**
+ * @brief Whether @p len bytes at @p address are all erased.
+ */
+static bool FwUpdate_IsBlank(uint32_t address, uint32_t len);
+
+/**
+ * @brief Read a little-endian 32-bit field.
+ */
+static uint32_t FwUpdate_GetLe32(const uint8_t *p);
+
+/**
+ * @brief One-word state of a slot for the `fw` listing.
+ */
+static const char *FwUpdate_SlotState(const FwUpdateHeader_t *header);
+
+/* ------------------------------------------------------------------------- */
+
+void FwUpdate_Init(void)
+{
+    bool found = false;
+
+    s_state     = FW_UPDATE_STATE_IDLE;
+    s_reason    = "";
+    s_rxLen     = 0U;
+    s_active    = FW_UPDATE_SLOT_A;
+    s_activeSeq = 0U;
+
+    /* The bootloader's choice: the highest valid sequence, else slot A. */
+    for (uint32_t slot = 0U; slot < FW_UPDATE_SLOT_COUNT; ++slot)
+    {
+        const FwUpdateHeader_t *header = FwUpdate_Header((FwUpdateSlot_t)slot);
+
+        if (FwUpdate_HeaderValid(header) &&
+            (!found || ((int32_t)(header->seq - s_activeSeq) > 0)))
+        {
+            s_active    = (FwUpdateSlot_t)slot;
+            s_activeSeq = header->seq;
+            found       = true;
+        }
+    }
+
+    s_confirmed = !found || (FwUpdate_Header(s_active)->confirmed != FW_UPDATE_ERASED);
+
+    /* The slot erase completes in the FLASH interrupt, like a log erase. */
+    HAL_NVIC_SetPriority(FLASH_IRQn, IRQ_PRIO_FLASH, 0U);
+    HAL_NVIC_EnableIRQ(FLASH_IRQn);
+
+    (void)CLI_RegisterCommand("fw", FwUpdate_CmdFw,
+                              "[begin <size> <crc> | swap] - Firmware update into the other slot");
+
+    LOG_INFO("FwUpdate: running slot %c (seq %lu%s)", (s_active == FW_UPDATE_SLOT_A) ? 'A' : 'B',
+             (unsigned long)s_activeSeq, s_confirmed ? "" : ", on trial");
+}
+
+void FwUpdate_Service(uint32_t now_ms)
+{
+    switch (s_state)
+    {
+        case FW_UPDATE_STATE_ERASING:
+            FwUpdate_ServiceErase(now_ms);
+            break;
+
+        case FW_UPDATE_STATE_RECEIVING:
+            if ((now_ms - s_frame_ms) >= FW_UPDATE_RX_TIMEOUT_MS)
+            {
+                FwUpdate_End(FW_UPDATE_STATE_FAILED, "timeout");
+            }
+            break;
+
+        case FW_UPDATE_STATE_SWAPPING:
+            if (UartTx_IsIdle() || ((now_ms - s_swap_ms) >= FW_UPDATE_SWAP_DRAIN_MS))
+            {
+                NVIC_SystemReset();
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    /* A new image that stayed up this long keeps its slot. */
+    if (!s_confirmed && (now_ms >= FW_UPDATE_CONFIRM_MS) && !FwUpdate_FlashBusy())
+    {
+        const uint32_t mark = FW_UPDATE_MARK;
+
+        s_confirmed = true;
+        if (FwUpdate_Program((uint32_t)(uintptr_t)&FwUpdate_Header(s_active)->confirmed, &mark, 4U))
+        {
+            LOG_INFO("FwUpdate: image in slot %c confirmed",
+                     (s_active == FW_UPDATE_SLOT_A) ? 'A' : 'B');
+        }
+        else
+        {
+            LOG_ERROR("FwUpdate: confirming slot %c failed",
+                      (s_active == FW_UPDATE_SLOT_A) ? 'A' : 'B');
+        }
+    }
+}
+
+bool FwUpdate_IsIdle(void)
+{
+    return (s_state != FW_UPDATE_STATE_ERASING) && (s_state != FW_UPDATE_STATE_RECEIVING) &&
+           (s_state != FW_UPDATE_STATE_SWAPPING);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void FwUpdate_CmdFw(uint32_t argc, char *argv[])
+{
+    if ((argc == 4U) && (strcmp(argv[1], "begin") == 0))
+    {
+        FwUpdate_Begin((uint32_t)strtoul(argv[2], NULL, 0), (uint32_t)strtoul(argv[3], NULL, 0));
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "swap") == 0))
+    {
+        FwUpdate_Swap();
+        return;
+    }
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: fw [begin <size> <crc> | swap]\r\n");
+        return;
+    }
+
+    CLI_Print("\r\nFirmware: running slot %c, seq %lu\r\n",
+              (s_active == FW_UPDATE_SLOT_A) ? 'A' : 'B', (unsigned long)s_activeSeq);
+
+    for (uint32_t slot = 0U; slot < FW_UPDATE_SLOT_COUNT; ++slot)
+    {
+        const FwUpdateHeader_t *header = FwUpdate_Header((FwUpdateSlot_t)slot);
+
+        if (header->magic == FW_UPDATE_MAGIC)
+        {
+            CLI_Print("  %c %c  seq %-5lu %7lu bytes  crc 0x%08lx  %s\r\n",
+                      (slot == (uint32_t)s_active) ? '*' : ' ', (slot == 0U) ? 'A' : 'B',
+                      (unsigned long)header->seq, (unsigned long)header->size,
+                      (unsigned long)header->crc, FwUpdate_SlotState(header));
+        }
+        else
+        {
+            CLI_Print("  %c %c  %s\r\n", (slot == (uint32_t)s_active) ? '*' : ' ',
+                      (slot == 0U) ? 'A' : 'B',
+                      (slot == (uint32_t)s_active) ? "no header (factory image)" : "no image");
+        }
+    }
+
+    switch (s_state)
+    {
+        case FW_UPDATE_STATE_ERASING:
+            CLI_Print("Transfer: erasing sector %lu/%lu\r\n",
+                      (unsigned long)(s_eraseIndex + 1U), (unsigned long)s_eraseCount);
+            break;
+        case FW_UPDATE_STATE_RECEIVING:
+            CLI_Print("Transfer: %lu/%lu bytes, %lu frames, %lu resent\r\n",
+                      (unsigned long)s_offset, (unsigned long)s_size,
+                      (unsigned long)s_frames, (unsigned long)s_resends);
+            break;
+        case FW_UPDATE_STATE_VERIFIED:
+            CLI_Print("Transfer: %lu bytes verified in %lu ms ('fw swap' starts them)\r\n",
+                      (unsigned long)s_size, (unsigned long)(s_frame_ms - s_begin_ms));
+            break;
+        case FW_UPDATE_STATE_SWAPPING:
+            CLI_Print("Transfer: resetting into slot %c\r\n",
+                      (FwUpdate_Inactive() == FW_UPDATE_SLOT_A) ? 'A' : 'B');
+            break;
+        case FW_UPDATE_STATE_FAILED:
+            CLI_Print("Transfer: failed (%s) at %lu/%lu bytes\r\n", s_reason,
+                      (unsigned long)s_offset, (unsigned long)s_size);
+            break;
+        default:
+            CLI_Print("Transfer: none\r\n");
+            break;
+    }
+}
+
+static void FwUpdate_Begin(uint32_t size, uint32_t crc)
+{
+    if (!FwUpdate_IsIdle())
+    {
+        CLI_Print("\r\nA transfer is already running.\r\n");
+        return;
+    }
+
+    if ((size == 0U) || (size > FW_UPDATE_IMAGE_MAX) || ((size % 4U) != 0U))
+    {
+        CLI_PrintError("\r\nImage size must be a multiple of 4 up to %lu bytes.\r\n",
+                       (unsigned long)FW_UPDATE_IMAGE_MAX);
+        return;
+    }
+
+    if (FwUpdate_FlashBusy())
+    {
+        CLI_PrintError("\r\nFlash busy (sector erase running), try again.\r\n");
+        return;
+    }
+
+    const FwUpdateSector_t *sectors = s_sectors[FwUpdate_Inactive()];
+    uint32_t                end     = FW_UPDATE_HEADER_SIZE + size;
+
+    s_size       = size;
+    s_crc        = crc;
+    s_offset     = 0U;
+    s_frames     = 0U;
+    s_resends    = 0U;
+    s_eraseIndex = 0U;
+    s_eraseCount = (end > sectors[0].size) ? 2U : 1U;
+    s_begin_ms   = HAL_GetTick();
+    s_state      = FW_UPDATE_STATE_ERASING;
+
+    CLI_Print("\r\nErasing slot %c (%lu sector(s)) for %lu bytes...\r\n",
+              (FwUpdate_Inactive() == FW_UPDATE_SLOT_A) ? 'A' : 'B',
+              (unsigned long)s_eraseCount, (unsigned long)size);
+    FwUpdate_StartErase();
+}
+
+static void FwUpdate_Swap(void)
+{
+    if (s_state != FW_UPDATE_STATE_VERIFIED)
+    {
+        CLI_Print("\r\nNo verified image to start.\r\n");
+        return;
+    }
+
+    FwUpdateSlot_t          slot   = FwUpdate_Inactive();
+    const FwUpdateHeader_t *header = FwUpdate_Header(slot);
+    const uint32_t          fields[3] = { s_activeSeq + 1U, s_size, s_crc };
+    const uint32_t          magic  = FW_UPDATE_MAGIC;
+
+    if (FwUpdate_FlashBusy() ||
+        !FwUpdate_Program((uint32_t)(uintptr_t)&header->seq, fields, sizeof(fields)) ||
+        !FwUpdate_Program((uint32_t)(uintptr_t)&header->magic, &magic, sizeof(magic)))
+    {
+        CLI_PrintError("\r\nWriting the slot header failed.\r\n");
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "header");
+        return;
+    }
+
+    LOG_INFO("FwUpdate: slot %c seq %lu, resetting", (slot == FW_UPDATE_SLOT_A) ? 'A' : 'B',
+             (unsigned long)(s_activeSeq + 1U));
+    CLI_Print("\r\nStarting slot %c.\r\n", (slot == FW_UPDATE_SLOT_A) ? 'A' : 'B');
+
+    s_swap_ms = HAL_GetTick();
+    s_state   = FW_UPDATE_STATE_SWAPPING;
+}
+
+static void FwUpdate_StartErase(void)
+{
+    FLASH_EraseInitTypeDef erase =
+    {
+        .TypeErase    = FLASH_TYPEERASE_SECTORS,
+        .Sector       = s_sectors[FwUpdate_Inactive()][s_eraseIndex].sector,
+        .NbSectors    = 1U,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3
+    };
+
+    (void)HAL_FLASH_Unlock();
+    if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK)
+    {
+        (void)HAL_FLASH_Lock();
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "erase");
+    }
+}
+
+static void FwUpdate_ServiceErase(uint32_t now_ms)
+{
+    if (FwUpdate_FlashBusy())
+    {
+        return;
+    }
+
+    (void)HAL_FLASH_Lock();
+
+    const FwUpdateSector_t *sector = &s_sectors[FwUpdate_Inactive()][s_eraseIndex];
+
+    if (!FwUpdate_IsBlank(sector->base, sector->size))
+    {
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "erase");
+        return;
+    }
+
+    s_eraseIndex++;
+    if (s_eraseIndex < s_eraseCount)
+    {
+        FwUpdate_StartErase();
+        return;
+    }
+
+    s_rxLen      = 0U;
+    s_rxOverflow = false;
+    s_frame_ms   = now_ms;
+    s_state      = FW_UPDATE_STATE_RECEIVING;
+    CLI_SetInputHandler(FwUpdate_OnInput);
+
+    LOG_INFO("FwUpdate: slot %c erased in %lu ms", (FwUpdate_Inactive() == FW_UPDATE_SLOT_A) ? 'A' : 'B',
+             (unsigned long)(now_ms - s_begin_ms));
+    CLI_Print("\r\n#fw,ready,chunk=%u\r\n", (unsigned)FW_UPDATE_CHUNK_SIZE);
+}
+
+static void FwUpdate_OnInput(uint8_t ch)
+{
+    if (ch == 0x00U)
+    {
+        if ((s_rxLen != 0U) && !s_rxOverflow)
+        {
+            FwUpdate_OnFrame();
+        }
+        s_rxLen      = 0U;
+        s_rxOverflow = false;
+    }
+    else if (s_rxLen < sizeof(s_rxFrame))
+    {
+        s_rxFrame[s_rxLen++] = ch;
+    }
+    else
+    {
+        s_rxOverflow = true;
+    }
+}
+
+static void FwUpdate_OnFrame(void)
+{
+    size_t len = Cobs_Decode(s_rxFrame, s_rxLen, s_rxFrame, sizeof(s_rxFrame));
+
+    s_frame_ms = HAL_GetTick();
+    s_frames++;
+
+    if ((len < (FW_UPDATE_FRAME_HEADER + 4U)) ||
+        (Crc32_Compute(s_rxFrame, len - 4U) != FwUpdate_GetLe32(&s_rxFrame[len - 4U])))
+    {
+        s_resends++;
+        CLI_Print("#fw,next,offset=%lu\r\n", (unsigned long)s_offset);
+        return;
+    }
+
+    if (s_rxFrame[0] == FW_UPDATE_FRAME_ABORT)
+    {
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "aborted");
+        return;
+    }
+
+    uint32_t offset = FwUpdate_GetLe32(&s_rxFrame[1]);
+    uint32_t count  = (uint32_t)len - FW_UPDATE_FRAME_HEADER - 4U;
+
+    /* Out of order, odd-sized or past the end: ask for the expected offset.
+     * So does a chunk arriving while the flash log erases its sector. */
+    if ((s_rxFrame[0] != FW_UPDATE_FRAME_CHUNK) || (offset != s_offset) || (count == 0U) ||
+        ((count % 4U) != 0U) || (count > (s_size - s_offset)) || FwUpdate_FlashBusy())
+    {
+        s_resends++;
+        CLI_Print("#fw,next,offset=%lu\r\n", (unsigned long)s_offset);
+        return;
+    }
+
+    uint32_t address = FwUpdate_SlotBase(FwUpdate_Inactive()) + FW_UPDATE_HEADER_SIZE + offset;
+
+    if (!FwUpdate_Program(address, &s_rxFrame[FW_UPDATE_FRAME_HEADER], count))
+    {
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "program");
+        return;
+    }
+
+    s_offset += count;
+    if (s_offset < s_size)
+    {
+        CLI_Print("#fw,next,offset=%lu\r\n", (unsigned long)s_offset);
+        return;
+    }
+
+    const void *image = (const void *)(uintptr_t)(FwUpdate_SlotBase(FwUpdate_Inactive()) +
+                                                  FW_UPDATE_HEADER_SIZE);
+
+    if (Crc32_Compute(image, s_size) != s_crc)
+    {
+        CLI_Print("#fw,done,crc=bad\r\n");
+        FwUpdate_End(FW_UPDATE_STATE_FAILED, "crc");
+        return;
+    }
+
+    CLI_Print("#fw,done,crc=ok\r\n");
+    FwUpdate_End(FW_UPDATE_STATE_VERIFIED, "");
+}
+
+static void FwUpdate_End(FwUpdateState_t state, const char *reason)
+{
+    bool receiving = (s_state == FW_UPDATE_STATE_RECEIVING);
+
+    s_state  = state;
+    s_reason = reason;
+
+    if (receiving)
+    {
+        CLI_SetInputHandler(NULL);
+        CLI_OnExternalOutput();
+    }
+
+    if (state == FW_UPDATE_STATE_FAILED)
+    {
+        LOG_WARN("FwUpdate: transfer failed (%s) at %lu/%lu bytes", reason,
+                 (unsigned long)s_offset, (unsigned long)s_size);
+        CLI_Print("#fw,error,reason=%s\r\n", reason);
+    }
+    else
+    {
+        LOG_INFO("FwUpdate: %lu bytes verified in %lu ms", (unsigned long)s_size,
+                 (unsigned long)(s_frame_ms - s_begin_ms));
+    }
+}
+
+static bool FwUpdate_Program(uint32_t address, const void *data, uint32_t len)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    bool           ok    = true;
+
+    (void)HAL_FLASH_Unlock();
+    for (uint32_t i = 0U; ok && (i < len); i += 4U)
+    {
+        uint32_t word;
+        memcpy(&word, &bytes[i], sizeof(word));
+        ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + i, word) == HAL_OK);
+    }
+    (void)HAL_FLASH_Lock();
+
+    return ok && (memcmp((const void *)(uintptr_t)address, data, len) == 0);
+}
+
+static bool FwUpdate_IsBlank(uint32_t address, uint32_t len)
+{
+    const uint32_t *word = (const uint32_t *)(uintptr_t)address;
+
+    for (uint32_t i = 0U; i < (len / 4U); ++i)
+    {
+        if (word[i] != FW_UPDATE_ERASED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint32_t FwUpdate_GetLe32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const char *FwUpdate_SlotState(const FwUpdateHeader_t *header)
+{
+    if (header->rejected != FW_UPDATE_ERASED)
+    {
+        return "rejected";
+    }
+    if (header->confirmed != FW_UPDATE_ERASED)
+    {
+        return "confirmed";
+    }
+    return (header->trial != FW_UPDATE_ERASED) ? "on trial" : "not started yet";
+}
@@ -0,0 +1,201 @@
+/**
+ * @file fw_update.h
+ * @brief Firmware update: A/B image slots, a transfer over the console
+ *        into the inactive one, verification and the swap.
+ *
+ * The flash holds a bootloader and two image slots (STM32F446RETX_FLASH.ld):
+ *
+ *     0x08000000  sector 0      bootloader (boot/boot_main.c)
+ *     0x08004000  sectors 1-2   runtime configuration (config_store.h)
+ *     0x0800C000  sector 3      flash sample log (flash_log.h)
+ *     0x08010000  sectors 4-5   slot A: header, image (192 KB)
+ *     0x08040000  sectors 6-7   slot B: header, image (192 KB used)
+ *
+ * An image is linked for its slot (tools/build_firmware.sh, FW_SLOT=A or
+ * B) with its vector table @ref FW_UPDATE_HEADER_SIZE bytes into it. The
+ * slot header in front of it is written by the firmware, never by the
+ * linker, and each of its words is programmed once:
+ *
+ *     seq size crc   the image: boot order, length, CRC-32/MPEG-2
+ *     magic          @ref FW_UPDATE_MAGIC, programmed after the three above
+ *     trial          programmed by the bootloader when it first starts the
+ *                    image
+ *     confirmed      programmed by the image after @ref FW_UPDATE_CONFIRM_MS
+ *                    of uptime
+ *     rejected       programmed by the bootloader when a trial failed or the
+ *                    image does not match its CRC
+ *
+ * The bootloader starts the valid, not rejected image with the highest
+ * sequence number; a slot A image flashed without a header (ST-LINK) counts
+ * as sequence 0. Finding an image tried but not confirmed, it rejects it
+ * and starts the other one, so an image that does not stay up for
+ * @ref FW_UPDATE_CONFIRM_MS rolls back on its own.
+ *
+ * Transfer, with the COBS framing of the telemetry link (telemetry.h),
+ * over the console UART or the USB CDC console (tools/fw_send.py):
+ *
+ *     fw begin <size> <crc>    erases the inactive slot, then answers
+ *                              #fw,ready,chunk=<bytes> and takes frames
+ *     host:  0x30 CHUNK  type:u8 offset:u32 data[<= chunk] crc:u32
+ *            0x31 ABORT  type:u8 offset:u32 crc:u32
+ *     hub:   #fw,next,offset=<n>      after every frame: the offset it wants
+ *            #fw,done,crc=<ok|bad>    after the last chunk
+ *     fw swap                  writes the header and resets into the image
+ *
+ * Chunks are programmed in order as they arrive, one per frame (about a
+ * millisecond of flash stall for 256 bytes), while sampling continues; a
+ * chunk with a wrong CRC or offset is answered with the offset wanted, and
+ * the sender repeats from there. The slot erase (a few seconds) stalls
+ * instruction fetches sector by sector, like a flash log erase; the ADC
+ * scan and UART DMA keep running through it. Frames that stop for
+ * @ref FW_UPDATE_RX_TIMEOUT_MS end the transfer and return the console to
+ * the command line.
+ *
+ * @ingroup common
+ */
+
+#ifndef FW_UPDATE_H
+#define FW_UPDATE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup fw_update Firmware Update
+ * @brief A/B image slots, console transfer, verification and rollback.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Start of slot A (sectors 4-5) and slot B (sectors 6-7). */
+#define FW_UPDATE_SLOT_A_BASE    (0x08010000U)
+#define FW_UPDATE_SLOT_B_BASE    (0x08040000U)
+
+/** @brief Usable size of a slot, header included (slot A's two sectors). */
+#define FW_UPDATE_SLOT_SIZE      (192U * 1024U)
+
+/** @brief Header space in front of the vector table (VTOR alignment). */
+#define FW_UPDATE_HEADER_SIZE    (0x200U)
+
+/** @brief Largest image. */
+#define FW_UPDATE_IMAGE_MAX      (FW_UPDATE_SLOT_SIZE - FW_UPDATE_HEADER_SIZE)
+
+/** @brief Header magic ("FWI1"). */
+#define FW_UPDATE_MAGIC          (0x31495746U)
+
+/** @brief Value of a programmed trial, confirmed or rejected word. */
+#define FW_UPDATE_MARK           (0x00000000U)
+
+/** @brief Content of an erased flash word. */
+#define FW_UPDATE_ERASED         (0xFFFFFFFFU)
+
+/** @brief Largest data part of a CHUNK frame. */
+#define FW_UPDATE_CHUNK_SIZE     (256U)
+
+/** @brief Frame type bytes of the transfer. */
+#define FW_UPDATE_FRAME_CHUNK    (0x30U)
+#define FW_UPDATE_FRAME_ABORT    (0x31U)
+
+/**
+ * @brief Image slots.
+ */
+typedef enum
+{
+    FW_UPDATE_SLOT_A = 0U,
+    FW_UPDATE_SLOT_B,
+    FW_UPDATE_SLOT_COUNT
+} FwUpdateSlot_t;
+
+/**
+ * @brief Slot header, at the start of the slot.
+ */
+typedef struct
+{
+    uint32_t seq;       /**< Boot order: the highest valid one starts.     */
+    uint32_t size;      /**< Image bytes after the header (multiple of 4). */
+    uint32_t crc;       /**< CRC-32/MPEG-2 of the image.                   */
+    uint32_t magic;     /**< @ref FW_UPDATE_MAGIC once the above are set.  */
+    uint32_t trial;     /**< @ref FW_UPDATE_MARK: started by the bootloader. */
+    uint32_t confirmed; /**< @ref FW_UPDATE_MARK: the image stayed up.     */
+    uint32_t rejected;  /**< @ref FW_UPDATE_MARK: not to be started again. */
+} FwUpdateHeader_t;
+
+/**
+ * @brief Start address of a slot.
+ *
+ * @param slot Slot.
+ *
+ * @return Address of its header.
+ */
+static inline uint32_t FwUpdate_SlotBase(FwUpdateSlot_t slot)
+{
+    return (slot == FW_UPDATE_SLOT_A) ? FW_UPDATE_SLOT_A_BASE : FW_UPDATE_SLOT_B_BASE;
+}
+
+/**
+ * @brief Header of a slot, as stored in flash.
+ *
+ * @param slot Slot.
+ *
+ * @return The header (words still erased where not programmed).
+ */
+static inline const FwUpdateHeader_t *FwUpdate_Header(FwUpdateSlot_t slot)
+{
+    return (const FwUpdateHeader_t *)(uintptr_t)FwUpdate_SlotBase(slot);
+}
+
+/**
+ * @brief Whether a header describes an image that may be started.
+ *
+ * The image CRC is not checked here: the bootloader does that before it
+ * starts the image.
+ *
+ * @param header Slot header.
+ *
+ * @return true if it is complete, not rejected and the size fits.
+ */
+static inline bool FwUpdate_HeaderValid(const FwUpdateHeader_t *header)
+{
+    return (header->magic == FW_UPDATE_MAGIC) && (header->rejected == FW_UPDATE_ERASED) &&
+           (header->size != 0U) && (header->size <= FW_UPDATE_IMAGE_MAX) &&
+           ((header->size % 4U) == 0U);
+}
+
+/**
+ * @brief Find the running slot and register the `fw` command.
+ *
+ * The running slot is the one the bootloader picks, found with the same
+ * rule from the headers. Call after CLI_Init().
+ *
+ * @return None.
+ */
+void FwUpdate_Init(void);
+
+/**
+ * @brief Background work: the slot erase, the receive timeout and the
+ *        confirmation of a new image.
+ *
+ * @param now_ms Current HAL tick.
+ *
+ * @return None.
+ */
+void FwUpdate_Service(uint32_t now_ms);
+
+/**
+ * @brief Whether no transfer is in progress.
+ *
+ * @return false from `fw begin` until the transfer ends.
+ */
+bool FwUpdate_IsIdle(void);
+
+/** @} */ /* end of fw_update group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FW_UPDATE_H */
@@ -0,0 +1,320 @@
+/**
+ * @file hil_probe.c
+ * @brief HIL test mode: probe pins, latency figures and the `hil` command.
+ *
+ * HilProbe_Mark() is called from every pipeline context (the sample
+ * producers, the log task, the CLI and the UART completion interrupt), so
+ * the pin toggle and the small state machine that follows one sample
+ * through the pipeline run with interrupts masked.
+ *
+ * @ingroup hil_probe
+ */
+
+#include "hil_probe.h"
+
+#if (HIL_PROBE_ENABLE != 0)
+
+#include "cli.h"
+#include "metrics.h"
+#include "periph_power.h"
+#include "sensor_farm.h"
+#include "time_base.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Latency stages: X(name, label).
+ */
+#define HIL_PROBE_STAGES(X)                    \
+    X(SAMPLE_FRAME, "sample_frame")            \
+    X(SAMPLE_WIRE,  "sample_wire")             \
+    X(CLI,          "cli")
+
+/**
+ * @brief Latency stage identifiers.
+ */
+typedef enum
+{
+#define HIL_PROBE_STAGE_ENUM(name, label) HIL_STAGE_##name,
+    HIL_PROBE_STAGES(HIL_PROBE_STAGE_ENUM)
+#undef HIL_PROBE_STAGE_ENUM
+    HIL_STAGE_COUNT
+} HilProbeStage_t;
+
+/**
+ * @brief Progress of the sample being followed.
+ */
+typedef enum
+{
+    HIL_TRACK_IDLE = 0U,        /**< Waiting for the next sample.     */
+    HIL_TRACK_FRAME,            /**< Sample accepted, frame pending.  */
+    HIL_TRACK_WIRE              /**< Frame queued, transfer pending.  */
+} HilProbeTrack_t;
+
+/**
+ * @brief Figures of one stage, in microseconds.
+ */
+typedef struct
+{
+    uint32_t count;             /**< Measurements.          */
+    uint32_t min_us;            /**< Shortest.              */
+    uint32_t max_us;            /**< Longest.               */
+    uint64_t sum_us;            /**< Sum, for the average.  */
+} HilProbeStat_t;
+
+/** @brief Stage labels of the report. */
+static const char *const s_stageNames[HIL_STAGE_COUNT] =
+{
+#define HIL_PROBE_STAGE_NAME(name, label) label,
+    HIL_PROBE_STAGES(HIL_PROBE_STAGE_NAME)
+#undef HIL_PROBE_STAGE_NAME
+};
+
+/** @brief GPIOC pin mask of each probe point. */
+static const uint16_t s_pinMasks[HIL_PROBE_COUNT] =
+{
+#define HIL_PROBE_POINT_MASK(name, pin) (uint16_t)(1U << (pin)),
+    HIL_PROBE_POINTS(HIL_PROBE_POINT_MASK)
+#undef HIL_PROBE_POINT_MASK
+};
+
+/** @brief Counters printed in the report header. */
+static const MetricId_t s_reportMetrics[] =
+{
+    METRIC_UPTIME_MS, METRIC_RING_PUSHED, METRIC_RING_OVERRUNS, METRIC_RING_HIGH_WATER,
+    METRIC_TELEM_FRAMES, METRIC_TELEM_RECORDS, METRIC_TELEM_DROPPED, METRIC_UART_DROP_TELEM
+};
+
+/** @brief Figures since boot or `hil reset`. */
+static HilProbeStat_t s_stats[HIL_STAGE_COUNT];
+
+/** @brief Where the followed sample is. */
+static HilProbeTrack_t s_track = HIL_TRACK_IDLE;
+
+/** @brief Time the followed sample was accepted. */
+static uint32_t s_sampleStart_us = 0U;
+
+/** @brief Time the current command line was received. */
+static uint32_t s_cliStart_us = 0U;
+
+/**
+ * @brief Add one measurement to a stage.
+ */
+static void HilProbe_Add(HilProbeStage_t stage, uint32_t us);
+
+/**
+ * @brief Clear the figures and restart following samples.
+ */
+static void HilProbe_Reset(void);
+
+/**
+ * @brief Print the CSV report.
+ */
+static void HilProbe_Report(void);
+
+/**
+ * @brief CLI "hil [reset | ping | load <n> <period_ms>]" handler.
+ */
+static void HilProbe_CmdHil(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void HilProbe_Init(void)
+{
+    uint32_t pins = 0U;
+
+    for (uint32_t i = 0U; i < (uint32_t)HIL_PROBE_COUNT; ++i)
+    {
+        pins |= s_pinMasks[i];
+    }
+
+    /* Held for good: a test build need not save the port clock. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOC);
+    GPIOC->BSRR = pins << 16;
+    for (uint32_t pin = 0U; pin < 16U; ++pin)
+    {
+        if ((pins & (1UL << pin)) != 0U)
+        {
+            GPIOC->MODER   = (GPIOC->MODER & ~(3UL << (2U * pin))) | (1UL << (2U * pin));
+            GPIOC->OSPEEDR |= 3UL << (2U * pin);
+        }
+    }
+    GPIOC->OTYPER &= ~pins;
+
+    HilProbe_Reset();
+
+    (void)CLI_RegisterCommand("hil", HilProbe_CmdHil,
+                              "[reset | ping | load <n> <period_ms>] - HIL test figures");
+}
+
+void HilProbe_Mark(HilProbePoint_t point)
+{
+    if ((uint32_t)point >= (uint32_t)HIL_PROBE_COUNT)
+    {
+        return;
+    }
+
+    uint32_t now     = Time_NowUs32();
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    GPIOC->ODR ^= s_pinMasks[point];
+
+    switch (point)
+    {
+        case HIL_PROBE_SAMPLE:
+            if (s_track == HIL_TRACK_IDLE)
+            {
+                s_sampleStart_us = now;
+                s_track          = HIL_TRACK_FRAME;
+            }
+            break;
+
+        case HIL_PROBE_FRAME:
+            if (s_track == HIL_TRACK_FRAME)
+            {
+                HilProbe_Add(HIL_STAGE_SAMPLE_FRAME, now - s_sampleStart_us);
+                s_track = HIL_TRACK_WIRE;
+            }
+            break;
+
+        case HIL_PROBE_FRAME_DROP:
+            /* The frame never reaches the wire: follow the next sample. */
+            if (s_track == HIL_TRACK_WIRE)
+            {
+                s_track = HIL_TRACK_IDLE;
+            }
+            break;
+
+        case HIL_PROBE_TX:
+            if (s_track == HIL_TRACK_WIRE)
+            {
+                HilProbe_Add(HIL_STAGE_SAMPLE_WIRE, now - s_sampleStart_us);
+                s_track = HIL_TRACK_IDLE;
+            }
+            break;
+
+        case HIL_PROBE_CLI_BEGIN:
+            s_cliStart_us = now;
+            break;
+
+        case HIL_PROBE_CLI_END:
+            HilProbe_Add(HIL_STAGE_CLI, now - s_cliStart_us);
+            break;
+
+        default:
+            break;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void HilProbe_Add(HilProbeStage_t stage, uint32_t us)
+{
+    HilProbeStat_t *stat = &s_stats[stage];
+
+    if ((stat->count == 0U) || (us < stat->min_us))
+    {
+        stat->min_us = us;
+    }
+    if (us > stat->max_us)
+    {
+        stat->max_us = us;
+    }
+    stat->sum_us += us;
+    stat->count++;
+}
+
+static void HilProbe_Reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    memset(s_stats, 0, sizeof(s_stats));
+    s_track = HIL_TRACK_IDLE;
+
+    __set_PRIMASK(primask);
+}
+
+static void HilProbe_Report(void)
+{
+    HilProbeStat_t stats[HIL_STAGE_COUNT];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(stats, s_stats, sizeof(stats));
+    __set_PRIMASK(primask);
+
+    CLI_Print("\r\n#hil,v1");
+    for (uint32_t i = 0U; i < (sizeof(s_reportMetrics) / sizeof(s_reportMetrics[0])); ++i)
+    {
+        CLI_Print(",%s=%lu", Metrics_GetName(s_reportMetrics[i]),
+                  (unsigned long)Metrics_Get(s_reportMetrics[i]));
+    }
+    CLI_Print(",farm=%lu\r\n", (unsigned long)SensorFarm_GetCount());
+
+    for (uint32_t i = 0U; i < (uint32_t)HIL_STAGE_COUNT; ++i)
+    {
+        const HilProbeStat_t *stat = &stats[i];
+        uint32_t              avg  = (stat->count != 0U) ? (uint32_t)(stat->sum_us / stat->count) : 0U;
+
+        CLI_Print("hil,%s,%lu,%lu,%lu,%lu\r\n", s_stageNames[i], (unsigned long)stat->count,
+                  (unsigned long)stat->min_us, (unsigned long)avg, (unsigned long)stat->max_us);
+    }
+
+    CLI_Print("#hil,end\r\n");
+}
+
+static void HilProbe_CmdHil(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "reset") == 0))
+    {
+        HilProbe_Reset();
+        CLI_Print("\r\n#hil,reset\r\n");
+    }
+    else if ((argc == 2U) && (strcmp(argv[1], "ping") == 0))
+    {
+        CLI_Print("\r\n#hil,pong,tick_ms=%lu\r\n", (unsigned long)HAL_GetTick());
+    }
+    else if ((argc == 4U) && (strcmp(argv[1], "load") == 0))
+    {
+        uint32_t count     = (uint32_t)strtoul(argv[2], NULL, 10);
+        uint32_t period_ms = (uint32_t)strtoul(argv[3], NULL, 10);
+
+        if (period_ms == 0U)
+        {
+            CLI_PrintError("\r\nPeriod must be at least 1 ms.\r\n");
+            return;
+        }
+
+        for (uint32_t i = 0U; i < SENSOR_FARM_MAX_CHANNELS; ++i)
+        {
+            SensorFarmChannelConfig_t config;
+
+            if (SensorFarm_GetChannelConfig(i, &config))
+            {
+                config.period_ms = period_ms;
+                (void)SensorFarm_ConfigureChannel(i, &config);
+            }
+        }
+
+        count = SensorFarm_SetCount(count);
+        CLI_Print("\r\n#hil,load,farm=%lu,period_ms=%lu\r\n",
+                  (unsigned long)count, (unsigned long)period_ms);
+    }
+    else if (argc == 1U)
+    {
+        HilProbe_Report();
+    }
+    else
+    {
+        CLI_PrintError("\r\nUsage: hil [reset | ping | load <n> <period_ms>]\r\n");
+    }
+}
+
+#endif /* HIL_PROBE_ENABLE */
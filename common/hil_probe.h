@@ -0,0 +1,124 @@
+/**
+ * @file hil_probe.h
+ * @brief Hardware-in-the-loop test mode: GPIO probes at the pipeline
+ *        points and the latencies between them, for tools/hil_run.py.
+ *
+ * Each probe point toggles its pin on GPIOC, so a logic analyzer on the
+ * probe pins and the telemetry TX line sees every edge of the pipeline:
+ *
+ *     PC0  sample accepted into the sample ring (App_AcceptSample())
+ *     PC1  sample frame handed to the UART (Telemetry_Flush()); a frame
+ *          the UART refused toggles the pin a second time
+ *     PC2  UART transfer started (console UART or telemetry UART)
+ *     PC3  CLI command executing (high from line received to handler done)
+ *
+ * The same points are timed with Time_NowUs32() for a figure without an
+ * analyzer. The first sample accepted after the previous measurement ended
+ * is followed to the next sample frame (@c sample_frame) and to the first
+ * transfer started after that frame was queued (@c sample_wire). With the
+ * UART idle that transfer carries the frame; with other output queued
+ * ahead it may be one that carries earlier bytes, so @c sample_wire is a
+ * lower bound under load and the analyzer trace is the reference. @c cli
+ * is the execution time of each command line.
+ *
+ * The `hil` command prints the figures as CSV, in the form of the
+ * benchmark suite (app_bench.h):
+ *
+ *     #hil,v1,uptime_ms=12000,ring_pushed=4410,ring_overruns=0,...
+ *     hil,<stage>,<count>,<min_us>,<avg_us>,<max_us>
+ *     ...
+ *     #hil,end
+ *
+ * `hil load <n> <period_ms>` runs n farm channels at one period, the
+ * synthetic load the host script ramps. `hil ping` answers with the tick,
+ * for the host's round-trip and clock offset measurement.
+ *
+ * Build with -DHIL_PROBE_ENABLE=1 (`make -C sim hil` for the simulation).
+ * When 0 (the default) every HIL_PROBE_* macro expands to nothing,
+ * arguments are not evaluated and hil_probe.c is empty.
+ *
+ * @ingroup common
+ */
+
+#ifndef HIL_PROBE_H
+#define HIL_PROBE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @defgroup hil_probe HIL Test Mode
+ * @brief Probe pins and pipeline latencies for the HIL harness.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Build the test mode in (1) or compile every probe point out (0). */
+#ifndef HIL_PROBE_ENABLE
+#define HIL_PROBE_ENABLE          (0)
+#endif
+
+/**
+ * @brief Probe points: X(name, GPIOC pin).
+ */
+#define HIL_PROBE_POINTS(X)   \
+    X(SAMPLE,     0U)         \
+    X(FRAME,      1U)         \
+    X(FRAME_DROP, 1U)         \
+    X(TX,         2U)         \
+    X(CLI_BEGIN,  3U)         \
+    X(CLI_END,    3U)
+
+/**
+ * @brief Probe point identifiers.
+ */
+typedef enum
+{
+#define HIL_PROBE_POINT_ENUM(name, pin) HIL_PROBE_##name,
+    HIL_PROBE_POINTS(HIL_PROBE_POINT_ENUM)
+#undef HIL_PROBE_POINT_ENUM
+    HIL_PROBE_COUNT
+} HilProbePoint_t;
+
+#if (HIL_PROBE_ENABLE != 0)
+
+/**
+ * @brief Configure the probe pins and register the `hil` command.
+ *
+ * Call once after CLI_Init() and SensorFarm_Init().
+ *
+ * @return None.
+ */
+void HilProbe_Init(void);
+
+/**
+ * @brief Record that the pipeline reached @p point.
+ *
+ * Toggles the point's pin and updates the latency figures. Safe from any
+ * context; interrupts are masked for a few instructions.
+ *
+ * @param point Probe point.
+ *
+ * @return None.
+ */
+void HilProbe_Mark(HilProbePoint_t point);
+
+/** @brief Probe point @p point (a HilProbePoint_t name without prefix). */
+#define HIL_PROBE_MARK(point)      HilProbe_Mark(HIL_PROBE_##point)
+
+#else /* HIL_PROBE_ENABLE == 0 */
+
+#define HIL_PROBE_MARK(point)      ((void)0)
+
+#endif /* HIL_PROBE_ENABLE */
+
+/** @} */ /* end of hil_probe group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HIL_PROBE_H */
@@ -0,0 +1,560 @@
+/**
+ * @file i2c_bus.c
+ * @brief I2C bus manager: descriptor queue, burst coalescing, completion.
+ *
+ * The queue is an intrusive singly linked list through the descriptors.
+ * It is changed only with interrupts masked or from the completion
+ * interrupt. Only one transaction (a single descriptor, or a group of
+ * merged reads) is on the wire at a time. Its descriptors are detached
+ * from the queue while it runs.
+ *
+ * On completion the next transaction is started before the finished one
+ * is handed back, so the bus stays busy while the callbacks run. A merged
+ * read goes through s_burst[] and alternates between the two buffers, so
+ * the copy-out of one burst never overlaps the DMA into the next.
+ *
+ * @ingroup i2c_bus
+ */
+
+#include "i2c_bus.h"
+#include "i2c_bus_hw.h"
+#include "app_coroutine.h"
+#include "cli.h"
+#include "app_config.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Longest transfer the "i2c" command accepts (bytes). */
+#define I2C_BUS_CLI_MAX   (16U)
+
+/** @brief Waiting descriptors, oldest first. */
+static I2cBusXfer_t *s_head = NULL;
+static I2cBusXfer_t *s_tail = NULL;
+
+/** @brief Descriptors of the transaction on the wire (NULL when idle). */
+static I2cBusXfer_t *s_active = NULL;
+
+/** @brief Transaction handed to the port. */
+static I2cBusHwXfer_t s_hw;
+
+/** @brief A start failed; only I2cBus_Service() tries again. */
+static bool s_stalled = false;
+
+/** @brief Tick at which the active transaction started. */
+static uint32_t s_activeStart_ms = 0U;
+
+/** @brief Bounce buffers for merged reads, used alternately. */
+static uint8_t s_burst[2][I2C_BUS_BURST_MAX];
+
+/** @brief Bounce buffer the next merged read uses. */
+static uint32_t s_burstNext = 0U;
+
+/** @brief Counters reported by I2cBus_GetStats(). */
+static I2cBusStats_t s_stats;
+
+/** @brief Descriptors and buffer of the "i2c" command. */
+static I2cBusXfer_t s_cliXfer[I2C_BUS_CLI_MAX];
+static uint8_t      s_cliData[I2C_BUS_CLI_MAX];
+
+/**
+ * @brief Test transfer of the "i2c" command, kept across the coroutine's
+ *        waits.
+ */
+static struct
+{
+    uint32_t address;      /**< Device address.                     */
+    uint32_t reg;          /**< First register.                     */
+    uint32_t count;        /**< Data bytes.                         */
+    uint32_t descriptors;  /**< Descriptors submitted.              */
+    uint32_t transactions; /**< Transaction count at the submit.    */
+    bool     write;        /**< Write rather than read.             */
+} s_cliRun;
+
+/**
+ * @brief Start the transaction at the head of the queue, if the bus is
+ *        free. Interrupts must be masked.
+ */
+static void I2cBus_StartNext(void);
+
+/**
+ * @brief Number of queued descriptors from the head that can be merged
+ *        into one burst read, and their total length.
+ */
+static uint32_t I2cBus_Group(uint16_t *length);
+
+/**
+ * @brief Hand a finished group back to its owners and run the callbacks.
+ *
+ * @param group  First descriptor; the group is linked through next.
+ * @param burst  Bounce buffer the group read into, or NULL.
+ * @param result Outcome.
+ */
+static void I2cBus_Finish(I2cBusXfer_t *group, const uint8_t *burst, I2cBusResult_t result);
+
+/**
+ * @brief Coroutine of the "i2c" command: submit its descriptors, wait for
+ *        their completion and print the result.
+ */
+static AppCoResult_t I2cBus_CliRun(AppCoroutine_t *co);
+
+/**
+ * @brief Completion callback of the "i2c" command's descriptors.
+ */
+static void I2cBus_CliDone(I2cBusXfer_t *xfer);
+
+/** @brief Runs the "i2c" command's transfer. */
+static AppCoroutine_t s_cliCoroutine =
+{
+    .name     = "i2c",
+    .function = I2cBus_CliRun
+};
+
+/**
+ * @brief Parse an unsigned number (decimal or 0x hex) no larger than @p max.
+ */
+static bool I2cBus_ParseU32(const char *text, uint32_t max, uint32_t *value);
+
+/**
+ * @brief CLI "i2c" handler.
+ */
+static void I2cBus_CmdI2c(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void I2cBus_Init(void)
+{
+    s_head      = NULL;
+    s_tail      = NULL;
+    s_active    = NULL;
+    s_stalled   = false;
+    s_burstNext = 0U;
+    s_stats     = (I2cBusStats_t){0};
+
+    I2cBusHw_Init();
+
+    (void)CLI_RegisterCommand("i2c", I2cBus_CmdI2c,
+                              "[read|write|burst ...] - I2C bus stats and test transfers");
+}
+
+bool I2cBus_Submit(I2cBusXfer_t *xfer)
+{
+    if ((xfer == NULL) || (xfer->data == NULL) || (xfer->length == 0U) || (xfer->address > 0x7FU))
+    {
+        return false;
+    }
+
+    bool accepted = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((xfer->state == I2C_BUS_XFER_QUEUED) || (xfer->state == I2C_BUS_XFER_ACTIVE))
+    {
+        s_stats.rejected++;
+    }
+    else
+    {
+        xfer->next   = NULL;
+        xfer->state  = I2C_BUS_XFER_QUEUED;
+        xfer->result = I2C_BUS_OK;
+
+        if (s_tail != NULL)
+        {
+            s_tail->next = xfer;
+        }
+        else
+        {
+            s_head = xfer;
+        }
+        s_tail = xfer;
+
+        s_stats.submitted++;
+        s_stats.queued++;
+        if (s_stats.queued > s_stats.queueHigh)
+        {
+            s_stats.queueHigh = s_stats.queued;
+        }
+
+        I2cBus_StartNext();
+        accepted = true;
+    }
+
+    __set_PRIMASK(primask);
+
+    return accepted;
+}
+
+void I2cBus_OnHwDone(I2cBusResult_t result)
+{
+    I2cBusXfer_t  *group = s_active;
+    const uint8_t *burst = (s_hw.data == group->data) ? NULL : s_hw.data;
+
+    switch (result)
+    {
+        case I2C_BUS_OK:
+            s_stats.bytes += s_hw.length;
+            break;
+        case I2C_BUS_NACK:
+            s_stats.nacks++;
+            break;
+        default:
+            s_stats.errors++;
+            break;
+    }
+
+    /* Keep the bus busy: the next transaction runs during the copy-out
+     * and the callbacks, using the other bounce buffer.
+     */
+    s_active = NULL;
+    I2cBus_StartNext();
+
+    I2cBus_Finish(group, burst, result);
+
+    if ((s_active == NULL) && (s_head == NULL))
+    {
+        I2cBusHw_Release();
+    }
+}
+
+void I2cBus_Service(uint32_t now_ms)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((s_active != NULL) && ((now_ms - s_activeStart_ms) > I2C_BUS_TIMEOUT_MS))
+    {
+        I2cBusXfer_t  *group = s_active;
+        const uint8_t *burst = (s_hw.data == group->data) ? NULL : s_hw.data;
+
+        I2cBusHw_Abort();
+        s_stats.timeouts++;
+        s_active = NULL;
+
+        I2cBus_StartNext();
+        I2cBus_Finish(group, burst, I2C_BUS_TIMEOUT);
+    }
+    else if ((s_active == NULL) && (s_head != NULL))
+    {
+        /* A start that failed earlier (bus held busy): free the bus and
+         * try again.
+         */
+        if (s_stalled)
+        {
+            I2cBusHw_Recover();
+            s_stats.recoveries++;
+            s_stalled = false;
+        }
+        I2cBus_StartNext();
+    }
+
+    if ((s_active == NULL) && (s_head == NULL))
+    {
+        I2cBusHw_Release();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+bool I2cBus_IsIdle(void)
+{
+    return (s_active == NULL) && (s_head == NULL);
+}
+
+void I2cBus_GetStats(I2cBusStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_stats;
+    __set_PRIMASK(primask);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void I2cBus_StartNext(void)
+{
+    if ((s_active != NULL) || (s_head == NULL) || s_stalled)
+    {
+        return;
+    }
+
+    uint16_t      length = 0U;
+    uint32_t      count  = I2cBus_Group(&length);
+    I2cBusXfer_t *first  = s_head;
+    I2cBusXfer_t *last   = first;
+
+    for (uint32_t i = 1U; i < count; ++i)
+    {
+        last = last->next;
+    }
+
+    /* Detach the group: the queue keeps only what is still waiting. */
+    s_head     = last->next;
+    last->next = NULL;
+    if (s_head == NULL)
+    {
+        s_tail = NULL;
+    }
+
+    for (I2cBusXfer_t *x = first; x != NULL; x = x->next)
+    {
+        x->state = I2C_BUS_XFER_ACTIVE;
+    }
+
+    s_hw.address = first->address;
+    s_hw.reg     = first->reg;
+    s_hw.hasReg  = (first->flags & I2C_BUS_XFER_NO_REG) == 0U;
+    s_hw.read    = (first->flags & I2C_BUS_XFER_READ) != 0U;
+    s_hw.length  = length;
+
+    if (count > 1U)
+    {
+        s_hw.data   = s_burst[s_burstNext];
+        s_burstNext ^= 1U;
+    }
+    else
+    {
+        s_hw.data = first->data;
+    }
+
+    s_active         = first;
+    s_activeStart_ms = HAL_GetTick();
+    s_stats.transactions++;
+    s_stats.coalesced += count - 1U;
+
+    if (!I2cBusHw_Start(&s_hw))
+    {
+        /* Bus held busy: fail this group; the rest (including anything
+         * the callbacks resubmit) waits for I2cBus_Service().
+         */
+        s_active  = NULL;
+        s_stalled = true;
+        s_stats.errors++;
+        I2cBus_Finish(first, NULL, I2C_BUS_ERROR);
+    }
+}
+
+static uint32_t I2cBus_Group(uint16_t *length)
+{
+    const I2cBusXfer_t *first = s_head;
+    const uint8_t       burst = I2C_BUS_XFER_READ | I2C_BUS_XFER_AUTOINC;
+    uint32_t            count = 1U;
+    uint32_t            total = first->length;
+
+    if (((first->flags & (burst | I2C_BUS_XFER_NO_REG)) == burst) && (total <= I2C_BUS_BURST_MAX))
+    {
+        for (const I2cBusXfer_t *x = first->next; x != NULL; x = x->next)
+        {
+            bool joins = (x->address == first->address) &&
+                         ((x->flags & (burst | I2C_BUS_XFER_NO_REG)) == burst) &&
+                         ((uint32_t)x->reg == ((uint32_t)first->reg + total)) &&
+                         ((total + x->length) <= I2C_BUS_BURST_MAX);
+            if (!joins)
+            {
+                break;
+            }
+
+            total += x->length;
+            count++;
+        }
+    }
+
+    *length = (uint16_t)total;
+    return count;
+}
+
+static void I2cBus_Finish(I2cBusXfer_t *group, const uint8_t *burst, I2cBusResult_t result)
+{
+    uint32_t offset = 0U;
+
+    while (group != NULL)
+    {
+        I2cBusXfer_t *x = group;
+        group = x->next;
+
+        if ((burst != NULL) && (result == I2C_BUS_OK))
+        {
+            (void)memcpy(x->data, &burst[offset], x->length);
+        }
+        offset += x->length;
+
+        x->next   = NULL;
+        x->result = result;
+        s_stats.queued--;
+
+        /* From here the descriptor is the driver's again. */
+        __DMB();
+        x->state = I2C_BUS_XFER_DONE;
+
+        if (x->done != NULL)
+        {
+            x->done(x);
+        }
+    }
+}
+
+static AppCoResult_t I2cBus_CliRun(AppCoroutine_t *co)
+{
+    static const char *const s_results[] = { "ok", "NACK", "bus error", "timeout" };
+
+    APP_CO_BEGIN(co);
+
+    /* Queue them all at once, as drivers sampling together would. */
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        s_cliRun.transactions = s_stats.transactions;
+        for (uint32_t i = 0U; i < s_cliRun.descriptors; ++i)
+        {
+            (void)I2cBus_Submit(&s_cliXfer[i]);
+        }
+        __set_PRIMASK(primask);
+    }
+
+    /* The descriptors finish in queue order. Each transaction ends within
+     * I2C_BUS_TIMEOUT_MS, by completing or by being aborted here.
+     */
+    while (s_cliXfer[s_cliRun.descriptors - 1U].state != I2C_BUS_XFER_DONE)
+    {
+        APP_CO_WAIT_SIGNAL(co, I2C_BUS_TIMEOUT_MS);
+        I2cBus_Service(HAL_GetTick());
+    }
+
+    {
+        I2cBusResult_t result = I2C_BUS_OK;
+        for (uint32_t i = 0U; i < s_cliRun.descriptors; ++i)
+        {
+            if (s_cliXfer[i].result != I2C_BUS_OK)
+            {
+                result = s_cliXfer[i].result;
+            }
+        }
+
+        CLI_Print("\r\n0x%02lx @0x%02lx: %s", (unsigned long)s_cliRun.address,
+                  (unsigned long)s_cliRun.reg, s_results[result]);
+        if (!s_cliRun.write && (result == I2C_BUS_OK))
+        {
+            CLI_Print(",");
+            for (uint32_t i = 0U; i < s_cliRun.count; ++i)
+            {
+                CLI_Print(" %02x", (unsigned)s_cliData[i]);
+            }
+        }
+        CLI_Print(" (%lu descriptor(s), %lu transaction(s))\r\n",
+                  (unsigned long)s_cliRun.descriptors,
+                  (unsigned long)(s_stats.transactions - s_cliRun.transactions));
+        CLI_OnExternalOutput();
+    }
+
+    APP_CO_END(co);
+}
+
+static void I2cBus_CliDone(I2cBusXfer_t *xfer)
+{
+    AppCoroutine_Signal((AppCoroutine_t *)xfer->context);
+}
+
+static bool I2cBus_ParseU32(const char *text, uint32_t max, uint32_t *value)
+{
+    char         *end = NULL;
+    unsigned long v   = strtoul(text, &end, 0);
+
+    if ((end == text) || (*end != '\0') || (v > max))
+    {
+        return false;
+    }
+
+    *value = (uint32_t)v;
+    return true;
+}
+
+static void I2cBus_CmdI2c(uint32_t argc, char *argv[])
+{
+    if (argc == 1U)
+    {
+        I2cBusStats_t stats;
+        I2cBus_GetStats(&stats);
+
+        CLI_Print("\r\nI2C bus (%s, %lu Hz)\r\n", I2cBus_IsIdle() ? "idle" : "busy",
+                  (unsigned long)I2C_BUS_SPEED_HZ);
+        CLI_Print("  Submitted %lu, rejected %lu, queued %lu (max %lu)\r\n",
+                  (unsigned long)stats.submitted, (unsigned long)stats.rejected,
+                  (unsigned long)stats.queued, (unsigned long)stats.queueHigh);
+        CLI_Print("  Transactions %lu, reads merged %lu, bytes %lu\r\n",
+                  (unsigned long)stats.transactions, (unsigned long)stats.coalesced,
+                  (unsigned long)stats.bytes);
+        CLI_Print("  NACKs %lu, errors %lu, timeouts %lu, recoveries %lu\r\n",
+                  (unsigned long)stats.nacks, (unsigned long)stats.errors,
+                  (unsigned long)stats.timeouts, (unsigned long)stats.recoveries);
+        return;
+    }
+
+    /* The descriptors and the buffer belong to the transfer still running. */
+    if (AppCoroutine_IsRunning(&s_cliCoroutine))
+    {
+        CLI_Print("\r\nI2C test transfer still running\r\n");
+        return;
+    }
+
+    uint32_t address = 0U;
+    uint32_t reg     = 0U;
+    uint32_t count   = 0U;
+    bool     write   = (strcmp(argv[1], "write") == 0);
+    bool     burst   = (strcmp(argv[1], "burst") == 0);
+    bool     ok      = (argc >= 4U) && (write || burst || (strcmp(argv[1], "read") == 0)) &&
+                       I2cBus_ParseU32(argv[2], 0x7FU, &address) &&
+                       I2cBus_ParseU32(argv[3], 0xFFU, &reg);
+
+    if (ok && write)
+    {
+        count = argc - 4U;
+        ok    = (count >= 1U) && (count <= I2C_BUS_CLI_MAX);
+        for (uint32_t i = 0U; ok && (i < count); ++i)
+        {
+            uint32_t byte = 0U;
+            ok = I2cBus_ParseU32(argv[4U + i], 0xFFU, &byte);
+            s_cliData[i] = (uint8_t)byte;
+        }
+    }
+    else if (ok)
+    {
+        ok = (argc == 5U) && I2cBus_ParseU32(argv[4], I2C_BUS_CLI_MAX, &count) && (count >= 1U);
+    }
+
+    if (!ok)
+    {
+        CLI_PrintError("\r\nUsage: i2c [read <addr> <reg> <n> | burst <addr> <reg> <n> |"
+                       " write <addr> <reg> <byte>...]\r\n");
+        return;
+    }
+
+    /* "burst" reads one byte per descriptor, which the bus merges. */
+    uint32_t descriptors = burst ? count : 1U;
+    for (uint32_t i = 0U; i < descriptors; ++i)
+    {
+        I2cBusXfer_t *x = &s_cliXfer[i];
+
+        x->address = (uint8_t)address;
+        x->reg     = (uint8_t)(reg + i);
+        x->flags   = write ? 0U : (I2C_BUS_XFER_READ | I2C_BUS_XFER_AUTOINC);
+        x->length  = (uint16_t)(burst ? 1U : count);
+        x->data    = &s_cliData[burst ? i : 0U];
+        x->done    = I2cBus_CliDone;
+        x->context = &s_cliCoroutine;
+    }
+
+    /* The result is printed by the coroutine once the bus is done. */
+    s_cliRun.address     = address;
+    s_cliRun.reg         = reg;
+    s_cliRun.count       = count;
+    s_cliRun.descriptors = descriptors;
+    s_cliRun.write       = write;
+    (void)AppCoroutine_Start(&s_cliCoroutine);
+}
@@ -0,0 +1,193 @@
+/**
+ * @file i2c_bus.h
+ * @brief Shared I2C bus: queued DMA transactions with completion callbacks.
+ *
+ * Drivers do not call a blocking HAL read. They fill in an
+ * @ref I2cBusXfer_t descriptor and submit it, and the bus runs the queue
+ * back-to-back: each completion interrupt starts the next transaction
+ * before it calls the finished transaction's callback.
+ *
+ * Ownership is explicit and needs no allocation. A descriptor belongs to
+ * its driver while its state is IDLE or DONE. From I2cBus_Submit()
+ * until its callback runs it belongs to the bus, and the driver must not
+ * touch it or its buffer. Submitting a descriptor the bus still owns is
+ * rejected.
+ *
+ * Reads that are queued back to back, from the same device and from
+ * consecutive registers (flag @ref I2C_BUS_XFER_AUTOINC), are merged
+ * into one burst read. The burst goes through one of two bounce buffers.
+ * The next transaction fills the other buffer while the finished one is
+ * copied out to its descriptors.
+ *
+ * The hardware side (i2c_bus_hw.c: I2C1 on PB8/PB9, DMA1 Stream0/7) is a
+ * separate port, so that the host simulation can replace it.
+ *
+ * @ingroup common
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup i2c_bus I2C Bus Manager
+ * @brief Transaction queue shared by the I2C sensor drivers.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Largest burst a run of coalesced reads may add up to (bytes). */
+#define I2C_BUS_BURST_MAX        (32U)
+
+/**
+ * @name Transfer flags
+ * @{
+ */
+/** @brief Read from the device (otherwise write). */
+#define I2C_BUS_XFER_READ        (1U << 0)
+/** @brief No register address phase: raw read or write. */
+#define I2C_BUS_XFER_NO_REG      (1U << 1)
+/** @brief The device auto-increments its register pointer, so adjacent
+ *         reads may be merged into a burst. */
+#define I2C_BUS_XFER_AUTOINC     (1U << 2)
+/** @} */
+
+/**
+ * @brief Who owns a descriptor.
+ */
+typedef enum
+{
+    I2C_BUS_XFER_IDLE = 0U, /**< Owned by the driver, never submitted. */
+    I2C_BUS_XFER_QUEUED,    /**< Owned by the bus, waiting.            */
+    I2C_BUS_XFER_ACTIVE,    /**< Owned by the bus, on the wire.        */
+    I2C_BUS_XFER_DONE       /**< Back with the driver; see result.     */
+} I2cBusXferState_t;
+
+/**
+ * @brief Outcome of a transaction.
+ */
+typedef enum
+{
+    I2C_BUS_OK = 0U,     /**< Transferred.                                */
+    I2C_BUS_NACK,        /**< Address or data not acknowledged.           */
+    I2C_BUS_ERROR,       /**< Bus error, arbitration lost or DMA error.   */
+    I2C_BUS_TIMEOUT      /**< Not finished within @ref I2C_BUS_TIMEOUT_MS. */
+} I2cBusResult_t;
+
+struct I2cBusXfer;
+
+/**
+ * @brief Completion callback.
+ *
+ * Runs from the completion interrupt, or with interrupts masked when
+ * I2cBus_Service() aborts a transaction. May submit descriptors,
+ * including this one.
+ *
+ * @param xfer The finished descriptor (state DONE, result set).
+ */
+typedef void (*I2cBusCallback_t)(struct I2cBusXfer *xfer);
+
+/**
+ * @brief One transaction: an optional register address write, then
+ *        @c length data bytes read or written.
+ *
+ * Descriptors and buffers live in the driver's static storage.
+ */
+typedef struct I2cBusXfer
+{
+    /* Set by the owner before I2cBus_Submit() */
+    uint8_t           address;  /**< 7-bit device address.                 */
+    uint8_t           reg;      /**< Register address (unless NO_REG).     */
+    uint8_t           flags;    /**< I2C_BUS_XFER_* flags.                 */
+    uint16_t          length;   /**< Data bytes (1 to 65535).              */
+    uint8_t          *data;     /**< Data buffer.                          */
+    I2cBusCallback_t  done;     /**< Completion callback (may be NULL).    */
+    void             *context;  /**< For the callback.                     */
+
+    /* Managed by the bus */
+    struct I2cBusXfer          *next;   /**< Queue link.                   */
+    volatile I2cBusXferState_t  state;  /**< Owner, see above.             */
+    I2cBusResult_t              result; /**< Valid once DONE.              */
+} I2cBusXfer_t;
+
+/**
+ * @brief Bus counters.
+ */
+typedef struct
+{
+    uint32_t submitted;    /**< Descriptors accepted.                        */
+    uint32_t rejected;     /**< Submits of a descriptor the bus still owned. */
+    uint32_t transactions; /**< Transactions on the wire.                    */
+    uint32_t coalesced;    /**< Reads merged into another transaction.       */
+    uint32_t bytes;        /**< Data bytes transferred.                      */
+    uint32_t nacks;        /**< Transactions ending in NACK.                 */
+    uint32_t errors;       /**< Bus and DMA errors.                          */
+    uint32_t timeouts;     /**< Transactions aborted by I2cBus_Service().    */
+    uint32_t recoveries;   /**< Stuck buses clocked free.                    */
+    uint32_t queued;       /**< Descriptors waiting or active now.           */
+    uint32_t queueHigh;    /**< Largest queued count seen.                   */
+} I2cBusStats_t;
+
+/**
+ * @brief Configure the bus pins and interrupts and register the "i2c"
+ *        CLI command.
+ *
+ * @return None.
+ */
+void I2cBus_Init(void);
+
+/**
+ * @brief Queue a transaction.
+ *
+ * Safe from any context. The bus owns @p xfer until its callback runs.
+ *
+ * @param xfer Descriptor in static storage.
+ *
+ * @return false if @p xfer is invalid or still owned by the bus.
+ */
+bool I2cBus_Submit(I2cBusXfer_t *xfer);
+
+/**
+ * @brief Abort a transaction stuck for longer than @ref I2C_BUS_TIMEOUT_MS.
+ *
+ * Call periodically from task context. The stuck transaction completes
+ * with @ref I2C_BUS_TIMEOUT, the controller is reset, and the queue goes
+ * on.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void I2cBus_Service(uint32_t now_ms);
+
+/**
+ * @brief Whether no transaction is queued or on the wire.
+ *
+ * The power manager does not enter STOP while the bus is busy.
+ *
+ * @return true if the bus is idle.
+ */
+bool I2cBus_IsIdle(void);
+
+/**
+ * @brief Get the bus counters.
+ *
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void I2cBus_GetStats(I2cBusStats_t *stats);
+
+/** @} */ /* end of i2c_bus group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_BUS_H */
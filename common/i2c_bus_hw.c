@@ -0,0 +1,481 @@
+/**
+ * @file i2c_bus_hw.c
+ * @brief I2C1 master port of the bus manager (PB8 SCL, PB9 SDA, DMA1).
+ *
+ * The address and register phases run from the event interrupt (SB, ADDR,
+ * BTF); the data phase is DMA: DMA1 Stream0 channel 1 receives, Stream7
+ * channel 1 transmits. For reads of two bytes or more, LAST makes the
+ * controller NACK the final byte and STOP is set from the DMA transfer
+ * complete interrupt. A one-byte read skips the DMA (ACK cleared before
+ * ADDR is released, STOP, then RXNE).
+ *
+ * Registers are accessed directly; the HAL I2C driver is not part of this
+ * project.
+ *
+ * @ingroup i2c_bus
+ */
+
+#include "i2c_bus_hw.h"
+#include "periph_power.h"
+#include "time_base.h"
+#include "app_config.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Polls of CR1.STOP / SR2.BUSY before a start gives up. */
+#define I2C_BUS_HW_BUSY_POLLS   (1000U)
+
+/** @brief SCL pulses that clock out any byte a slave is stuck in. */
+#define I2C_BUS_HW_RECOVER_PULSES (9U)
+
+/** @brief Half an SCL period of a recovery pulse (10 kHz, us). */
+#define I2C_BUS_HW_RECOVER_HALF_US (50U)
+
+/** @brief SR1 error flags (all rc_w0). */
+#define I2C_BUS_HW_SR1_ERRORS   (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_AF | I2C_SR1_OVR | I2C_SR1_TIMEOUT)
+
+/**
+ * @brief Where the transaction in progress is.
+ */
+typedef enum
+{
+    I2C_BUS_HW_IDLE = 0U,  /**< No transaction.                         */
+    I2C_BUS_HW_ADDR_W,     /**< START sent, address+W next.             */
+    I2C_BUS_HW_REG,        /**< Register byte sent, waiting for BTF.    */
+    I2C_BUS_HW_ADDR_R,     /**< (Repeated) START sent, address+R next.  */
+    I2C_BUS_HW_RX,         /**< DMA receiving.                          */
+    I2C_BUS_HW_RX1,        /**< Single byte, waiting for RXNE.          */
+    I2C_BUS_HW_TX,         /**< DMA transmitting.                       */
+    I2C_BUS_HW_TX_END      /**< DMA done, waiting for the last BTF.     */
+} I2cBusHwPhase_t;
+
+/** @brief Transaction in progress. */
+static const I2cBusHwXfer_t *s_xfer = NULL;
+
+/** @brief Phase of the transaction in progress. */
+static volatile I2cBusHwPhase_t s_phase = I2C_BUS_HW_IDLE;
+
+/** @brief Clocks taken by the first start after a release. */
+static bool s_clocked = false;
+
+/** @brief APB1 clock the bit timing was computed for (0: not configured). */
+static uint32_t s_pclk = 0U;
+
+/**
+ * @brief Reset I2C1 and program the bit timing for the current APB1 clock.
+ */
+static void I2cBusHw_Configure(void);
+
+/**
+ * @brief Program and enable the DMA stream of the data phase.
+ */
+static void I2cBusHw_StartDma(void);
+
+/**
+ * @brief Stop both streams and the controller interrupts.
+ */
+static void I2cBusHw_Quiesce(void);
+
+/**
+ * @brief End the transaction and report @p result to the bus manager.
+ */
+static void I2cBusHw_Complete(I2cBusResult_t result);
+
+/**
+ * @brief Drive PB8 (SCL) or PB9 (SDA) low, or let it float high.
+ */
+static void I2cBusHw_Drive(uint32_t pin, bool low);
+
+/**
+ * @brief Wait half a recovery pulse.
+ */
+static void I2cBusHw_HalfBit(void);
+
+/* ------------------------------------------------------------------------- */
+
+void I2cBusHw_Init(void)
+{
+    /* PB8/PB9: AF4, open drain, internal pull-ups (external ones are
+     * still needed at 400 kHz). The GPIO clock is only needed for this.
+     */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+    GPIOB->MODER   = (GPIOB->MODER & ~(GPIO_MODER_MODER8 | GPIO_MODER_MODER9)) |
+                     GPIO_MODER_MODER8_1 | GPIO_MODER_MODER9_1;
+    GPIOB->OTYPER |= GPIO_OTYPER_OT8 | GPIO_OTYPER_OT9;
+    GPIOB->OSPEEDR |= GPIO_OSPEEDR_OSPEED8 | GPIO_OSPEEDR_OSPEED9;
+    GPIOB->PUPDR   = (GPIOB->PUPDR & ~(GPIO_PUPDR_PUPD8 | GPIO_PUPDR_PUPD9)) |
+                     GPIO_PUPDR_PUPD8_0 | GPIO_PUPDR_PUPD9_0;
+    GPIOB->AFR[1]  = (GPIOB->AFR[1] & ~0xFFU) | 0x44U;
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+
+    s_phase   = I2C_BUS_HW_IDLE;
+    s_clocked = false;
+    s_pclk    = 0U;
+
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, IRQ_PRIO_I2C_EV, 0U);
+    HAL_NVIC_SetPriority(I2C1_ER_IRQn, IRQ_PRIO_I2C_ER, 0U);
+    HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, IRQ_PRIO_I2C_DMA_RX, 0U);
+    HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, IRQ_PRIO_I2C_DMA_TX, 0U);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+    HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream7_IRQn);
+}
+
+bool I2cBusHw_Start(const I2cBusHwXfer_t *xfer)
+{
+    if (!s_clocked)
+    {
+        /* The pins keep the GPIO clock only while the bus is in use. */
+        PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+        PeriphPower_Acquire(PERIPH_POWER_DMA1);
+        PeriphPower_Acquire(PERIPH_POWER_I2C1);
+        s_clocked = true;
+    }
+
+    /* The STOP of the previous transaction may still be on the wire. */
+    uint32_t polls = 0U;
+    while (((I2C1->CR1 & I2C_CR1_STOP) != 0U) && (polls < I2C_BUS_HW_BUSY_POLLS))
+    {
+        polls++;
+    }
+
+    if (s_pclk != HAL_RCC_GetPCLK1Freq())
+    {
+        I2cBusHw_Configure();
+    }
+
+    while (((I2C1->SR2 & I2C_SR2_BUSY) != 0U) && (polls < I2C_BUS_HW_BUSY_POLLS))
+    {
+        polls++;
+    }
+    if ((I2C1->SR2 & I2C_SR2_BUSY) != 0U)
+    {
+        /* A slave holding SDA low: reset the controller for the retry. */
+        s_pclk = 0U;
+        return false;
+    }
+
+    s_xfer  = xfer;
+    s_phase = (xfer->hasReg || !xfer->read) ? I2C_BUS_HW_ADDR_W : I2C_BUS_HW_ADDR_R;
+
+    I2C1->CR2 = (I2C1->CR2 & ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN)) |
+                I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+    I2C1->CR1 |= I2C_CR1_ACK | I2C_CR1_START;
+
+    return true;
+}
+
+void I2cBusHw_Abort(void)
+{
+    I2cBusHw_Quiesce();
+    I2C1->CR1 |= I2C_CR1_STOP;
+
+    s_pclk  = 0U;
+    s_phase = I2C_BUS_HW_IDLE;
+    s_xfer  = NULL;
+}
+
+void I2cBusHw_Recover(void)
+{
+    PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+    PeriphPower_Acquire(PERIPH_POWER_I2C1);
+
+    /* The controller lets go of the pins; they become open-drain outputs. */
+    I2C1->CR1 = 0U;
+    GPIOB->ODR  |= GPIO_ODR_OD8 | GPIO_ODR_OD9;
+    GPIOB->MODER = (GPIOB->MODER & ~(GPIO_MODER_MODER8 | GPIO_MODER_MODER9)) |
+                   GPIO_MODER_MODER8_0 | GPIO_MODER_MODER9_0;
+
+    for (uint32_t i = 0U; (i < I2C_BUS_HW_RECOVER_PULSES) && ((GPIOB->IDR & GPIO_IDR_ID9) == 0U); ++i)
+    {
+        I2cBusHw_Drive(8U, true);
+        I2cBusHw_HalfBit();
+        I2cBusHw_Drive(8U, false);
+        I2cBusHw_HalfBit();
+    }
+
+    /* STOP: SDA rises while SCL is high. */
+    I2cBusHw_Drive(9U, true);
+    I2cBusHw_HalfBit();
+    I2cBusHw_Drive(8U, false);
+    I2cBusHw_HalfBit();
+    I2cBusHw_Drive(9U, false);
+    I2cBusHw_HalfBit();
+
+    GPIOB->MODER = (GPIOB->MODER & ~(GPIO_MODER_MODER8 | GPIO_MODER_MODER9)) |
+                   GPIO_MODER_MODER8_1 | GPIO_MODER_MODER9_1;
+
+    PeriphPower_Release(PERIPH_POWER_I2C1);
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+
+    s_pclk  = 0U;
+    s_phase = I2C_BUS_HW_IDLE;
+    s_xfer  = NULL;
+}
+
+void I2cBusHw_Release(void)
+{
+    if (!s_clocked)
+    {
+        return;
+    }
+
+    PeriphPower_Release(PERIPH_POWER_I2C1);
+    PeriphPower_Release(PERIPH_POWER_DMA1);
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+    s_clocked = false;
+}
+
+void I2cBusHw_EvIrqHandler(void)
+{
+    uint32_t sr1 = I2C1->SR1;
+
+    if (s_phase == I2C_BUS_HW_IDLE)
+    {
+        I2C1->CR2 &= ~(I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+        return;
+    }
+
+    if ((sr1 & I2C_SR1_SB) != 0U)
+    {
+        uint8_t rw = (s_phase == I2C_BUS_HW_ADDR_R) ? 1U : 0U;
+        I2C1->DR = ((uint32_t)s_xfer->address << 1) | rw;
+    }
+    else if ((sr1 & I2C_SR1_ADDR) != 0U)
+    {
+        if (s_phase == I2C_BUS_HW_ADDR_W)
+        {
+            (void)I2C1->SR2;
+
+            if (s_xfer->hasReg)
+            {
+                I2C1->DR = s_xfer->reg;
+                s_phase  = I2C_BUS_HW_REG;
+            }
+            else
+            {
+                s_phase = I2C_BUS_HW_TX;
+                I2cBusHw_StartDma();
+            }
+        }
+        else if (s_xfer->length == 1U)
+        {
+            /* NACK and STOP must be set up before ADDR is released. */
+            I2C1->CR1 &= ~I2C_CR1_ACK;
+            (void)I2C1->SR2;
+            I2C1->CR1 |= I2C_CR1_STOP;
+            I2C1->CR2 |= I2C_CR2_ITBUFEN;
+            s_phase = I2C_BUS_HW_RX1;
+        }
+        else
+        {
+            s_phase = I2C_BUS_HW_RX;
+            I2cBusHw_StartDma();
+            (void)I2C1->SR2;
+        }
+    }
+    else if (((sr1 & I2C_SR1_RXNE) != 0U) && (s_phase == I2C_BUS_HW_RX1))
+    {
+        s_xfer->data[0] = (uint8_t)I2C1->DR;
+        I2cBusHw_Complete(I2C_BUS_OK);
+    }
+    else if ((sr1 & I2C_SR1_BTF) != 0U)
+    {
+        if (s_phase == I2C_BUS_HW_REG)
+        {
+            if (s_xfer->read)
+            {
+                s_phase = I2C_BUS_HW_ADDR_R;
+                I2C1->CR1 |= I2C_CR1_START;
+            }
+            else
+            {
+                s_phase = I2C_BUS_HW_TX;
+                I2cBusHw_StartDma();
+            }
+        }
+        else if (s_phase == I2C_BUS_HW_TX_END)
+        {
+            I2C1->CR1 |= I2C_CR1_STOP;
+            I2cBusHw_Complete(I2C_BUS_OK);
+        }
+        else
+        {
+            /* BTF while DMA feeds DR: nothing to do. */
+        }
+    }
+    else
+    {
+        /* Event already handled (e.g. BTF cleared by the DMA). */
+    }
+}
+
+void I2cBusHw_ErIrqHandler(void)
+{
+    uint32_t sr1 = I2C1->SR1;
+
+    I2C1->SR1 = (uint32_t)~(sr1 & I2C_BUS_HW_SR1_ERRORS);
+
+    if (s_phase == I2C_BUS_HW_IDLE)
+    {
+        return;
+    }
+
+    if ((sr1 & I2C_SR1_AF) != 0U)
+    {
+        I2C1->CR1 |= I2C_CR1_STOP;
+        I2cBusHw_Complete(I2C_BUS_NACK);
+    }
+    else
+    {
+        /* Bus error or lost arbitration: start over from a reset. */
+        s_pclk = 0U;
+        I2cBusHw_Complete(I2C_BUS_ERROR);
+    }
+}
+
+void I2cBusHw_DmaRxIrqHandler(void)
+{
+    uint32_t lisr = DMA1->LISR;
+
+    DMA1->LIFCR = DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+
+    if (s_phase != I2C_BUS_HW_RX)
+    {
+        return;
+    }
+
+    if ((lisr & DMA_LISR_TEIF0) != 0U)
+    {
+        I2C1->CR1 |= I2C_CR1_STOP;
+        s_pclk = 0U;
+        I2cBusHw_Complete(I2C_BUS_ERROR);
+    }
+    else if ((lisr & DMA_LISR_TCIF0) != 0U)
+    {
+        I2C1->CR1 |= I2C_CR1_STOP;
+        I2cBusHw_Complete(I2C_BUS_OK);
+    }
+    else
+    {
+        /* Not enabled. */
+    }
+}
+
+void I2cBusHw_DmaTxIrqHandler(void)
+{
+    uint32_t hisr = DMA1->HISR;
+
+    DMA1->HIFCR = DMA_HIFCR_CTCIF7 | DMA_HIFCR_CHTIF7 | DMA_HIFCR_CTEIF7 |
+                  DMA_HIFCR_CDMEIF7 | DMA_HIFCR_CFEIF7;
+
+    if (s_phase != I2C_BUS_HW_TX)
+    {
+        return;
+    }
+
+    if ((hisr & DMA_HISR_TEIF7) != 0U)
+    {
+        I2C1->CR1 |= I2C_CR1_STOP;
+        s_pclk = 0U;
+        I2cBusHw_Complete(I2C_BUS_ERROR);
+    }
+    else if ((hisr & DMA_HISR_TCIF7) != 0U)
+    {
+        /* The last byte is still shifting out: STOP goes at its BTF. */
+        DMA1_Stream7->CR &= ~DMA_SxCR_EN;
+        I2C1->CR2        &= ~I2C_CR2_DMAEN;
+        s_phase           = I2C_BUS_HW_TX_END;
+    }
+    else
+    {
+        /* Not enabled. */
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void I2cBusHw_Configure(void)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t mhz  = pclk / 1000000U;
+    uint32_t ccr;
+    uint32_t trise;
+
+    I2C1->CR1 = I2C_CR1_SWRST;
+    I2C1->CR1 = 0U;
+
+    if (I2C_BUS_SPEED_HZ > 100000U)
+    {
+        /* Fast mode, Tlow/Thigh = 2: 300 ns maximum rise time. */
+        ccr   = I2C_CCR_FS | (pclk / (3U * I2C_BUS_SPEED_HZ));
+        trise = ((mhz * 300U) / 1000U) + 1U;
+    }
+    else
+    {
+        /* Standard mode: 1000 ns maximum rise time, CCR at least 4. */
+        ccr   = pclk / (2U * I2C_BUS_SPEED_HZ);
+        ccr   = (ccr < 4U) ? 4U : ccr;
+        trise = mhz + 1U;
+    }
+
+    I2C1->CR2   = mhz & I2C_CR2_FREQ;
+    I2C1->CCR   = ccr;
+    I2C1->TRISE = trise;
+    I2C1->CR1   = I2C_CR1_PE;
+
+    s_pclk = pclk;
+}
+
+static void I2cBusHw_StartDma(void)
+{
+    const bool          rx     = (s_phase == I2C_BUS_HW_RX);
+    DMA_Stream_TypeDef *stream = rx ? DMA1_Stream0 : DMA1_Stream7;
+
+    stream->CR   = 0U;
+    stream->PAR  = (uint32_t)(uintptr_t)&I2C1->DR;
+    stream->M0AR = (uint32_t)(uintptr_t)s_xfer->data;
+    stream->NDTR = s_xfer->length;
+    stream->FCR  = 0U;
+    stream->CR   = DMA_SxCR_CHSEL_0 | DMA_SxCR_PL_0 | DMA_SxCR_MINC |
+                   (rx ? 0U : DMA_SxCR_DIR_0) | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    stream->CR  |= DMA_SxCR_EN;
+
+    I2C1->CR2 |= I2C_CR2_DMAEN | (rx ? I2C_CR2_LAST : 0U);
+}
+
+static void I2cBusHw_Quiesce(void)
+{
+    DMA1_Stream0->CR &= ~DMA_SxCR_EN;
+    DMA1_Stream7->CR &= ~DMA_SxCR_EN;
+    I2C1->CR2        &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+}
+
+static void I2cBusHw_Complete(I2cBusResult_t result)
+{
+    I2cBusHw_Quiesce();
+
+    s_phase = I2C_BUS_HW_IDLE;
+    s_xfer  = NULL;
+
+    /* May start the next transaction straight away. */
+    I2cBus_OnHwDone(result);
+}
+
+static void I2cBusHw_Drive(uint32_t pin, bool low)
+{
+    GPIOB->BSRR = low ? (1UL << (pin + 16U)) : (1UL << pin);
+}
+
+static void I2cBusHw_HalfBit(void)
+{
+    uint32_t start = Time_NowUs32();
+
+    while ((Time_NowUs32() - start) < I2C_BUS_HW_RECOVER_HALF_US)
+    {
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * @file i2c_bus_hw.h
+ * @brief Hardware port of the I2C bus manager (one transaction at a time).
+ *
+ * i2c_bus.c owns the queue and calls into this port. The port runs a
+ * single transaction at a time and reports the end of it through
+ * I2cBus_OnHwDone(). i2c_bus_hw.c drives I2C1 and DMA1 at register level
+ * (the HAL I2C module is not part of this project). The host simulation
+ * has its own port with a simulated device.
+ *
+ * @ingroup i2c_bus
+ */
+
+#ifndef I2C_BUS_HW_H
+#define I2C_BUS_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c_bus.h"
+
+/**
+ * @brief One transaction as the port sees it.
+ */
+typedef struct
+{
+    uint8_t  address; /**< 7-bit device address.             */
+    uint8_t  reg;     /**< Register address, if hasReg.      */
+    bool     hasReg;  /**< Write reg before the data phase.  */
+    bool     read;    /**< Data phase direction.             */
+    uint8_t *data;    /**< DMA buffer.                       */
+    uint16_t length;  /**< Data bytes (at least 1).          */
+} I2cBusHwXfer_t;
+
+/**
+ * @brief Configure the pins and the interrupt priorities.
+ *
+ * @return None.
+ */
+void I2cBusHw_Init(void);
+
+/**
+ * @brief Start a transaction.
+ *
+ * Called with interrupts masked or from the completion interrupt. The
+ * first start after I2cBusHw_Release() takes the clocks and programs the
+ * bit timing for the current APB1 clock.
+ *
+ * @param xfer Transaction; must stay valid until I2cBus_OnHwDone().
+ *
+ * @return false if the controller could not start (bus stuck busy). In
+ *         that case I2cBus_OnHwDone() is not called.
+ */
+bool I2cBusHw_Start(const I2cBusHwXfer_t *xfer);
+
+/**
+ * @brief Stop the transaction in progress and reset the controller.
+ *
+ * I2cBus_OnHwDone() is not called for the aborted transaction.
+ *
+ * @return None.
+ */
+void I2cBusHw_Abort(void);
+
+/**
+ * @brief Free a bus that a slave holds busy.
+ *
+ * A slave reset mid-byte can keep SDA low for ever. SCL is clocked by hand
+ * until SDA is released (at most nine pulses), then a STOP is sent and the
+ * controller is reconfigured at the next start. Call with interrupts
+ * masked and no transaction in progress.
+ *
+ * @return None.
+ */
+void I2cBusHw_Recover(void);
+
+/**
+ * @brief The queue is empty: release the clocks.
+ *
+ * @return None.
+ */
+void I2cBusHw_Release(void);
+
+/**
+ * @brief I2C1 event interrupt handler.
+ *
+ * @return None.
+ */
+void I2cBusHw_EvIrqHandler(void);
+
+/**
+ * @brief I2C1 error interrupt handler.
+ *
+ * @return None.
+ */
+void I2cBusHw_ErIrqHandler(void);
+
+/**
+ * @brief DMA1 Stream0 (I2C1 RX) interrupt handler.
+ *
+ * @return None.
+ */
+void I2cBusHw_DmaRxIrqHandler(void);
+
+/**
+ * @brief DMA1 Stream7 (I2C1 TX) interrupt handler.
+ *
+ * @return None.
+ */
+void I2cBusHw_DmaTxIrqHandler(void);
+
+/**
+ * @brief End of the transaction started by I2cBusHw_Start(), from
+ *        interrupt context. Implemented by i2c_bus.c.
+ *
+ * @param result Outcome.
+ *
+ * @return None.
+ */
+void I2cBus_OnHwDone(I2cBusResult_t result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_BUS_HW_H */
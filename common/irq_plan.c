@@ -0,0 +1,233 @@
+/**
+ * @file irq_plan.c
+ * @brief Interrupt priority plan, latency figures and the `irq` command.
+ *
+ * The figures of a source are written only by its own handler, which
+ * never preempts itself, so the handlers need no masking; the command
+ * masks interrupts to copy or clear them.
+ *
+ * @ingroup irq_plan
+ */
+
+#include "irq_plan.h"
+#include "app_config.h"
+#include "cli.h"
+#include "periph_power.h"
+#include "sensor_sync.h"
+#include "time_base.h"
+#include <string.h>
+
+/** @brief Age clock of sources timed in core cycles (SysTick). */
+#define IRQ_PLAN_AGE_CYCLES   (1U)
+
+#define IRQ_PLAN_CHECK(name, irqn, prio, label)                                   \
+    _Static_assert((prio) < (1U << __NVIC_PRIO_BITS), #name " priority out of range"); \
+    _Static_assert(((prio) + APP_PREEMPT_LEVELS) <= APP_PREEMPT_PRIORITY,          \
+                   #name " must stay above the scheduler's preemption levels");
+IRQ_PLAN_LIST(IRQ_PLAN_CHECK)
+#undef IRQ_PLAN_CHECK
+
+_Static_assert((IRQ_PRIO_SYNC_TIMER == 0) && (IRQ_PRIO_ADC_DMA == 0),
+               "nothing may preempt or hold off the acquisition interrupts");
+
+/**
+ * @brief One source of the plan.
+ */
+typedef struct
+{
+    IRQn_Type   irqn;           /**< NVIC line.                 */
+    uint8_t     priority;       /**< Planned preemption priority. */
+    const char *label;          /**< Name in `irq` output.      */
+} IrqPlanEntry_t;
+
+/** @brief The plan, indexed by IrqPlanSource_t. */
+static const IrqPlanEntry_t s_plan[IRQ_PLAN_COUNT] =
+{
+#define IRQ_PLAN_ENTRY(name, irqn, prio, label) { (irqn), (uint8_t)(prio), (label) },
+    IRQ_PLAN_LIST(IRQ_PLAN_ENTRY)
+#undef IRQ_PLAN_ENTRY
+};
+
+#if (IRQ_LATENCY_ENABLE != 0)
+
+IrqPlanStats_t    g_irqPlanStats[IRQ_PLAN_COUNT];
+volatile uint32_t g_irqPlanPinSource = (uint32_t)IRQ_PLAN_SYNC_TIMER;
+
+/**
+ * @brief Clock of the event age of each source; 0 where there is none.
+ */
+static const uint32_t s_ageHz[IRQ_PLAN_COUNT] =
+{
+    [IRQ_PLAN_SYNC_TIMER] = SENSOR_SYNC_TIMER_HZ,
+    [IRQ_PLAN_TIME_BASE]  = TIME_BASE_HZ,
+    [IRQ_PLAN_SYSTICK]    = IRQ_PLAN_AGE_CYCLES
+};
+
+/**
+ * @brief Print @p ticks of a @p hz clock as microseconds with one decimal.
+ */
+static void IrqPlan_PrintUs(uint64_t ticks, uint32_t hz);
+
+#endif /* IRQ_LATENCY_ENABLE */
+
+/**
+ * @brief Print the plan and, when built in, the latency figures.
+ */
+static void IrqPlan_Report(void);
+
+/**
+ * @brief CLI "irq [reset | pin <source>|off]" handler.
+ */
+static void IrqPlan_CmdIrq(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void IrqPlan_Init(void)
+{
+    HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+
+    for (uint32_t i = 0U; i < (uint32_t)IRQ_PLAN_COUNT; ++i)
+    {
+        if (s_plan[i].irqn == SysTick_IRQn)
+        {
+            /* Through the HAL, which restores it on every clock change. */
+            (void)HAL_InitTick(s_plan[i].priority);
+        }
+        else
+        {
+            HAL_NVIC_SetPriority(s_plan[i].irqn, s_plan[i].priority, 0U);
+        }
+    }
+
+#if (IRQ_LATENCY_ENABLE != 0)
+    memset(g_irqPlanStats, 0, sizeof(g_irqPlanStats));
+
+    /* Held for good: a test build need not save the port clock. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOC);
+    GPIOC->BSRR    = 1UL << (IRQ_LATENCY_PIN + 16U);
+    GPIOC->MODER   = (GPIOC->MODER & ~(3UL << (2U * IRQ_LATENCY_PIN))) | (1UL << (2U * IRQ_LATENCY_PIN));
+    GPIOC->OSPEEDR |= 3UL << (2U * IRQ_LATENCY_PIN);
+    GPIOC->OTYPER &= ~(1UL << IRQ_LATENCY_PIN);
+#endif
+
+    (void)CLI_RegisterCommand("irq", IrqPlan_CmdIrq,
+                              "[reset | pin <source>|off] - Interrupt priorities and latency");
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void IrqPlan_Report(void)
+{
+#if (IRQ_LATENCY_ENABLE != 0)
+    IrqPlanStats_t stats[IRQ_PLAN_COUNT];
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    memcpy(stats, g_irqPlanStats, sizeof(stats));
+    __set_PRIMASK(primask);
+
+    CLI_Print("\r\nIRQ plan (preemption priority; times in us)\r\n");
+    CLI_Print("  source          irq plan nvic   runs lat avg lat max run max\r\n");
+#else
+    CLI_Print("\r\nIRQ plan (preemption priority)\r\n");
+    CLI_Print("  source          irq plan nvic\r\n");
+#endif
+
+    for (uint32_t i = 0U; i < (uint32_t)IRQ_PLAN_COUNT; ++i)
+    {
+        const IrqPlanEntry_t *entry = &s_plan[i];
+
+        CLI_Print("  %-14s %4d %4u %4lu", entry->label, (int)entry->irqn, (unsigned)entry->priority,
+                  (unsigned long)NVIC_GetPriority(entry->irqn));
+
+#if (IRQ_LATENCY_ENABLE != 0)
+        uint32_t hz = (s_ageHz[i] == IRQ_PLAN_AGE_CYCLES) ? SystemCoreClock : s_ageHz[i];
+
+        CLI_Print(" %6lu", (unsigned long)stats[i].runs);
+        if ((hz != 0U) && (stats[i].runs != 0U))
+        {
+            IrqPlan_PrintUs(stats[i].ageSum / stats[i].runs, hz);
+            IrqPlan_PrintUs(stats[i].ageMax, hz);
+        }
+        else
+        {
+            CLI_Print("       -       -");
+        }
+        IrqPlan_PrintUs(stats[i].runMax, SystemCoreClock);
+#endif
+        CLI_Print("\r\n");
+    }
+
+#if (IRQ_LATENCY_ENABLE != 0)
+    CLI_Print("  Probe pin PC%u: %s\r\n", (unsigned)IRQ_LATENCY_PIN,
+              (g_irqPlanPinSource < (uint32_t)IRQ_PLAN_COUNT) ? s_plan[g_irqPlanPinSource].label : "off");
+#endif
+}
+
+static void IrqPlan_CmdIrq(uint32_t argc, char *argv[])
+{
+    if (argc == 1U)
+    {
+        IrqPlan_Report();
+        return;
+    }
+
+#if (IRQ_LATENCY_ENABLE != 0)
+    if ((argc == 2U) && (strcmp(argv[1], "reset") == 0))
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        memset(g_irqPlanStats, 0, sizeof(g_irqPlanStats));
+        __set_PRIMASK(primask);
+
+        CLI_Print("\r\nIRQ figures cleared\r\n");
+        return;
+    }
+
+    if ((argc == 3U) && (strcmp(argv[1], "pin") == 0))
+    {
+        uint32_t source = (uint32_t)IRQ_PLAN_COUNT;
+
+        for (uint32_t i = 0U; i < (uint32_t)IRQ_PLAN_COUNT; ++i)
+        {
+            if (strcmp(argv[2], s_plan[i].label) == 0)
+            {
+                source = i;
+            }
+        }
+
+        if ((source == (uint32_t)IRQ_PLAN_COUNT) && (strcmp(argv[2], "off") != 0))
+        {
+            CLI_PrintError("\r\nUnknown source '%s'\r\n", argv[2]);
+            return;
+        }
+
+        /* Dropped first, so a handler running now cannot leave it high. */
+        g_irqPlanPinSource = (uint32_t)IRQ_PLAN_COUNT;
+        GPIOC->BSRR        = 1UL << (IRQ_LATENCY_PIN + 16U);
+        g_irqPlanPinSource = source;
+
+        CLI_Print("\r\nProbe pin PC%u: %s\r\n", (unsigned)IRQ_LATENCY_PIN,
+                  (source < (uint32_t)IRQ_PLAN_COUNT) ? s_plan[source].label : "off");
+        return;
+    }
+
+    CLI_PrintError("\r\nUsage: irq [reset | pin <source>|off]\r\n");
+#else
+    (void)argv;
+    CLI_PrintError("\r\nUsage: irq (latency figures need IRQ_LATENCY_ENABLE=1)\r\n");
+#endif
+}
+
+#if (IRQ_LATENCY_ENABLE != 0)
+
+static void IrqPlan_PrintUs(uint64_t ticks, uint32_t hz)
+{
+    uint64_t tenths = (ticks * 10000000ULL) / hz;
+
+    CLI_Print(" %5lu.%lu", (unsigned long)(tenths / 10U), (unsigned long)(tenths % 10U));
+}
+
+#endif /* IRQ_LATENCY_ENABLE */
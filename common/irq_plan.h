@@ -0,0 +1,249 @@
+/**
+ * @file irq_plan.h
+ * @brief NVIC priority plan of every interrupt, and the ISR latency
+ *        instrumentation that checks it.
+ *
+ * All driver interrupts take their preemption priority from
+ * @ref IRQ_PLAN_LIST (NVIC_PRIORITYGROUP_4: four preemption bits, no
+ * subpriority; a lower number preempts a higher one). The order follows
+ * what a late handler costs:
+ *
+ *     0  acquisition: the sync timer (TIM3) and the ADC scan DMA. A late
+ *        trigger skews every member's timestamp; nothing may hold it off.
+ *     1  time base overflow (TIM5), read by every timestamp
+ *     2  sensor buses: I2C1 and SPI2 with their DMA streams
+ *     3  serial links: console, telemetry and uplink UARTs and DMA
+ *     4  USB device
+ *     5  SysTick (HAL tick and watchdog supervision)
+ *     6  slow events: flash, button, UART wake-up, RTC wake-up
+ *
+ * The scheduler's preemption levels (APP_PREEMPT_PRIORITY, 14 and 15) run
+ * below all of them. With the BASEPRI lock strategy (stm32_lock.h,
+ * strategy 6, threshold 1) only priority 0 keeps running during a locked
+ * C library call, so the acquisition handlers must not allocate or format
+ * floats.
+ *
+ * Drivers set their own interrupts with the IRQ_PRIO_* constants;
+ * IrqPlan_Init() applies the whole table once after the CubeMX init code,
+ * which keeps its generated defaults. `irq` lists the plan, with the
+ * priority read back from the NVIC.
+ *
+ * Built with -DIRQ_LATENCY_ENABLE=1, every handler in stm32f4xx_it.c is
+ * stamped with DWT->CYCCNT at entry and exit (IRQ_LATENCY_ENTER() and
+ * IRQ_LATENCY_EXIT()), and `irq` adds per source: runs, longest handler
+ * run (which is also how long it held off everything below it) and, for
+ * the sources whose hardware tells the age of the event at entry, the
+ * average and worst entry latency:
+ *
+ *     SysTick     cycles since the counter reached 0 (LOAD - VAL + 1)
+ *     TIM3, TIM5  CNT ticks since the update event (TIM3 counts at
+ *                 10 kHz: it shows a trigger starved by 100 us or more)
+ *
+ * For the others (DMA, UART, EXTI) no event time is available; the probe
+ * pin (@ref IRQ_LATENCY_PIN on GPIOC) is high while the handler selected
+ * with `irq pin <source>` runs, so a scope on the event signal and the pin
+ * shows the latency. The figures are in cycles and ticks of the clock at
+ * the time; `irq reset` after a clock profile change.
+ *
+ * When IRQ_LATENCY_ENABLE is 0 (the default) both macros expand to
+ * nothing.
+ *
+ * @ingroup common
+ */
+
+#ifndef IRQ_PLAN_H
+#define IRQ_PLAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "stm32f4xx_hal.h"
+
+/**
+ * @defgroup irq_plan Interrupt Priority Plan
+ * @brief Central NVIC priorities and per-source ISR latency.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Build the latency instrumentation in (1) or leave it out (0). */
+#ifndef IRQ_LATENCY_ENABLE
+#define IRQ_LATENCY_ENABLE        (0)
+#endif
+
+/** @brief GPIOC pin of the latency probe (PC0 to PC3 are the HIL probes). */
+#ifndef IRQ_LATENCY_PIN
+#define IRQ_LATENCY_PIN           (4U)
+#endif
+
+/**
+ * @brief Interrupt sources: X(name, IRQn, preemption priority, label).
+ */
+#define IRQ_PLAN_LIST(X)                                                 \
+    X(SYNC_TIMER,     TIM3_IRQn,          0U, "sync_timer")              \
+    X(ADC_DMA,        DMA2_Stream0_IRQn,  0U, "adc_dma")                 \
+    X(TIME_BASE,      TIM5_IRQn,          1U, "time_base")               \
+    X(I2C_EV,         I2C1_EV_IRQn,       2U, "i2c_ev")                  \
+    X(I2C_ER,         I2C1_ER_IRQn,       2U, "i2c_er")                  \
+    X(I2C_DMA_RX,     DMA1_Stream0_IRQn,  2U, "i2c_dma_rx")              \
+    X(I2C_DMA_TX,     DMA1_Stream7_IRQn,  2U, "i2c_dma_tx")              \
+    X(SPI_DMA_RX,     DMA1_Stream3_IRQn,  2U, "spi_dma_rx")              \
+    X(SPI_DMA_TX,     DMA1_Stream4_IRQn,  2U, "spi_dma_tx")              \
+    X(CONSOLE_UART,   USART2_IRQn,        3U, "console_uart")            \
+    X(CONSOLE_DMA_RX, DMA1_Stream5_IRQn,  3U, "console_dma_rx")          \
+    X(CONSOLE_DMA_TX, DMA1_Stream6_IRQn,  3U, "console_dma_tx")          \
+    X(TELEM_UART,     USART1_IRQn,        3U, "telem_uart")              \
+    X(TELEM_DMA_TX,   DMA2_Stream7_IRQn,  3U, "telem_dma_tx")            \
+    X(UPLINK_UART,    USART6_IRQn,        3U, "uplink_uart")             \
+    X(UPLINK_DMA_TX,  DMA2_Stream6_IRQn,  3U, "uplink_dma_tx")           \
+    X(UPLINK_DMA_RX,  DMA2_Stream1_IRQn,  3U, "uplink_dma_rx")           \
+    X(USB,            OTG_FS_IRQn,        4U, "usb")                     \
+    X(SYSTICK,        SysTick_IRQn,       5U, "systick")                 \
+    X(FLASH,          FLASH_IRQn,         6U, "flash")                   \
+    X(BUTTON,         EXTI15_10_IRQn,     6U, "button")                  \
+    X(UART_WAKE,      EXTI3_IRQn,         6U, "uart_wake")               \
+    X(RTC_WAKEUP,     RTC_WKUP_IRQn,      6U, "rtc_wakeup")
+
+/**
+ * @brief Interrupt source identifiers.
+ */
+typedef enum
+{
+#define IRQ_PLAN_SOURCE_ENUM(name, irqn, prio, label) IRQ_PLAN_##name,
+    IRQ_PLAN_LIST(IRQ_PLAN_SOURCE_ENUM)
+#undef IRQ_PLAN_SOURCE_ENUM
+    IRQ_PLAN_COUNT
+} IrqPlanSource_t;
+
+/**
+ * @brief Preemption priority of each source: IRQ_PRIO_<name>.
+ */
+enum
+{
+#define IRQ_PLAN_PRIO_ENUM(name, irqn, prio, label) IRQ_PRIO_##name = (prio),
+    IRQ_PLAN_LIST(IRQ_PLAN_PRIO_ENUM)
+#undef IRQ_PLAN_PRIO_ENUM
+};
+
+/**
+ * @brief Set the priority grouping and every priority of the plan, and
+ *        register the `irq` command.
+ *
+ * Call once after CLI_Init(). Interrupts enabled later must use the
+ * IRQ_PRIO_* constants; the RTOS backend moves SysTick to the kernel's
+ * priority afterwards.
+ *
+ * @return None.
+ */
+void IrqPlan_Init(void);
+
+#if (IRQ_LATENCY_ENABLE != 0)
+
+/**
+ * @brief Figures of one source, written only by its own handler.
+ */
+typedef struct
+{
+    uint32_t runs;              /**< Handler entries.                      */
+    uint32_t ageMax;            /**< Worst event age at entry.             */
+    uint64_t ageSum;            /**< Sum of the ages, for the average.     */
+    uint32_t runMax;            /**< Longest entry to exit (cycles).       */
+} IrqPlanStats_t;
+
+/** @brief Figures per source; updated by IrqPlan_Enter() and IrqPlan_Exit(). */
+extern IrqPlanStats_t g_irqPlanStats[IRQ_PLAN_COUNT];
+
+/** @brief Source whose handler drives the probe pin. */
+extern volatile uint32_t g_irqPlanPinSource;
+
+/**
+ * @brief Handler entry: count it, record the event age and raise the
+ *        probe pin if @p source is selected.
+ *
+ * @param source Interrupt source.
+ * @param age    Age of the event in the source's clock, or 0.
+ *
+ * @return Entry time for IrqPlan_Exit() (CYCCNT).
+ */
+static inline uint32_t IrqPlan_Enter(IrqPlanSource_t source, uint32_t age)
+{
+    uint32_t        entry = DWT->CYCCNT;
+    IrqPlanStats_t *stats = &g_irqPlanStats[source];
+
+    if ((uint32_t)source == g_irqPlanPinSource)
+    {
+        GPIOC->BSRR = 1UL << IRQ_LATENCY_PIN;
+    }
+
+    stats->runs++;
+    stats->ageSum += age;
+    if (age > stats->ageMax)
+    {
+        stats->ageMax = age;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Handler exit: record the run time and drop the probe pin.
+ *
+ * @param source Interrupt source.
+ * @param entry  Return value of IrqPlan_Enter().
+ *
+ * @return None.
+ */
+static inline void IrqPlan_Exit(IrqPlanSource_t source, uint32_t entry)
+{
+    uint32_t run = DWT->CYCCNT - entry;
+
+    if (run > g_irqPlanStats[source].runMax)
+    {
+        g_irqPlanStats[source].runMax = run;
+    }
+
+    if ((uint32_t)source == g_irqPlanPinSource)
+    {
+        GPIOC->BSRR = 1UL << (IRQ_LATENCY_PIN + 16U);
+    }
+}
+
+/**
+ * @brief Cycles since SysTick reached 0.
+ *
+ * The counter reloads one cycle after 0 and counts LOAD down from there;
+ * a read of 0 is the reload pending.
+ *
+ * @return Event age of the SysTick handler.
+ */
+static inline uint32_t IrqPlan_SysTickAge(void)
+{
+    uint32_t load = SysTick->LOAD;
+
+    return (load - SysTick->VAL + 1U) % (load + 1U);
+}
+
+/** @brief First statement of the handler of @p name (IRQ_PLAN_LIST). */
+#define IRQ_LATENCY_ENTER(name)          const uint32_t irqEntry = IrqPlan_Enter(IRQ_PLAN_##name, 0U)
+/** @brief The same, with the event age read from the hardware. */
+#define IRQ_LATENCY_ENTER_AGE(name, age) const uint32_t irqEntry = IrqPlan_Enter(IRQ_PLAN_##name, (age))
+/** @brief Last statement of the handler of @p name. */
+#define IRQ_LATENCY_EXIT(name)           IrqPlan_Exit(IRQ_PLAN_##name, irqEntry)
+
+#else /* IRQ_LATENCY_ENABLE == 0 */
+
+#define IRQ_LATENCY_ENTER(name)          ((void)0)
+#define IRQ_LATENCY_ENTER_AGE(name, age) ((void)0)
+#define IRQ_LATENCY_EXIT(name)           ((void)0)
+
+#endif /* IRQ_LATENCY_ENABLE */
+
+/** @} */ /* end of irq_plan group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IRQ_PLAN_H */
@@ -2,24 +2,55 @@
  * @file log.c
  * @brief Logging implementation for Smart Sensor Hub.
  *
- * Provides formatted UART logging with timestamps and source metadata.
+ * Provides formatted logging with timestamps and source metadata to an
+ * output @ref Stream_t, normally the log writer of the shared UART TX
+ * ring (see @ref uart_tx), which sends by DMA in the background, so
+ * callers never wait for the UART.
+ *
+ * Log_Print() may be called from thread mode, interrupt handlers and
+ * several RTOS threads at once without a lock. Each caller formats into a
+ * staging buffer it claims for the duration of the call (thread-mode and
+ * interrupt callers draw from separate sets, see
+ * @ref LOG_THREAD_STAGING_BUFFERS), and hands the finished line to the
+ * stream with one Stream_Write(); on the TX ring that claims its span
+ * atomically and ranks below CLI and telemetry output. The
+ * filter settings are read through the single-byte @ref g_logThreshold,
+ * so a concurrent Log_SetLevel() is seen either before or after.
+ *
+ * Call sites at @ref LOG_RATE_MIN_LEVEL and above are tracked in a small
+ * open-addressed table keyed by the call-site address (the return
+ * address of Log_Print(), or the ID string in binary mode). A message
+ * identical to the site's previous one is collapsed, other messages
+ * spend a token of the site's bucket; what is held back is reported as
+ * one "last message repeated N times" line, prepended to the site's next
+ * printed line or sent by Log_Service().
+ *
+ * Deferred and over-budget lines, and lines the stream has no room for
+ * (a CLI response may have claimed the ring, UartTx_SetCliBusy()), are
+ * copied, each behind a 2-byte length, into one byte ring in RAM. Any
+ * context appends with interrupts masked; only thread mode takes lines
+ * out (Log_SetMode(), Log_Service()), one caller at a time, and hands each
+ * to the stream in place with Stream_WriteSegments(). While the ring
+ * holds lines, new DEBUG and INFO lines queue behind them, so they keep
+ * their order.
  *
  * @ingroup logging
  */
 
 #include "log.h"
+#include "crash_log.h"
+#include "metrics.h"
+#include "fmt.h"
 #include <stdarg.h>
-#include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
 
 /**
- * @brief UART handle used for log output.
+ * @brief Stream the log is written to.
  *
- * This handle is set in Log_Init() and used internally by
- * Log_Print() to send data over serial.
+ * Set in Log_Init(); NULL until then, which keeps every level filtered.
  */
-static UART_HandleTypeDef *s_logUart = NULL;
+static const Stream_t *s_out = NULL;
 
 /**
  * @brief Current minimum log level.
@@ -33,24 +64,346 @@ static LogLevel_t s_minLevel = LOG_LEVEL_INFO;
  */
 static bool s_enabled = false;
 
+/** @brief Threshold value that filters every message. */
+#define LOG_THRESHOLD_OFF        (0xFFU)
+
+volatile uint8_t g_logThreshold = LOG_THRESHOLD_OFF;
+
+/** @brief Power mode of the last Log_SetMode(). */
+static uint32_t s_mode = 0U;
+
+/** @brief Level override per power mode, valid where s_modeOverride is set. */
+static uint8_t s_modeLevel[LOG_MAX_MODES];
+
+/** @brief Power modes with a level override (bit per mode). */
+static uint32_t s_modeOverride = 0U;
+
+/** @brief Lowest level let through whatever the other settings. */
+static uint8_t s_floorLevel = (uint8_t)LOG_LEVEL_DEBUG;
+
+/** @brief Power modes that defer DEBUG and INFO lines (bit per mode). */
+static uint32_t s_deferModes = 0U;
+
+/** @brief The current mode defers. */
+static volatile bool s_deferring = false;
+
+/** @brief Byte budget per second (0: none). */
+static uint32_t s_budget = 0U;
+
+/**
+ * @brief Bytes the budget still allows; a line may overdraw it, so a
+ *        budget below one line still lets lines through on average.
+ */
+static int32_t s_budgetTokens = 0;
+
+/** @brief Time the budget was last topped up. */
+static uint32_t s_budgetRefill_ms = 0U;
+
+/** @brief Lines that found the budget spent. */
+static volatile uint32_t s_overBudgetLines = 0U;
+
+#if (LOG_DEFER_ENABLE != 0)
+
+_Static_assert((LOG_DEFER_SIZE & (LOG_DEFER_SIZE - 1U)) == 0U,
+               "LOG_DEFER_SIZE must be a power of two");
+
+/** @brief Deferred lines, each behind its 16-bit length. */
+static uint8_t s_defer[LOG_DEFER_SIZE];
+
+/** @brief Oldest deferred byte (free-running). */
+static volatile uint32_t s_deferHead = 0U;
+
+/** @brief Next free byte (free-running). */
+static volatile uint32_t s_deferTail = 0U;
+
+/** @brief A caller is taking lines out. */
+static bool s_deferSending = false;
+
+/** @brief Lines put in the buffer since startup. */
+static volatile uint32_t s_deferredLines = 0U;
+
+#endif /* LOG_DEFER_ENABLE */
+
+/**
+ * @brief Where a finished line went.
+ */
+typedef enum
+{
+    LOG_WRITE_DROPPED = 0U, /**< Neither ring had room.     */
+    LOG_WRITE_SENT,         /**< Queued in the TX ring.     */
+    LOG_WRITE_DEFERRED      /**< Kept in the RAM buffer.    */
+} LogWrite_t;
+
+/**
+ * @brief Recompute @ref g_logThreshold from the enable flag and level.
+ */
+static void Log_UpdateThreshold(void);
+
 /**
- * @brief Maximum length of a single log line (excluding prefix).
+ * @brief Send a finished line, or keep it in RAM if the mode or the budget
+ *        says so.
+ */
+static LogWrite_t Log_Write(LogLevel_t level, const void *data, size_t len);
+
+/**
+ * @brief Spend @p len bytes of the budget; ERROR lines always pass.
+ *
+ * @return false if the budget is spent.
+ */
+static bool Log_TakeBudget(LogLevel_t level, size_t len);
+
+/**
+ * @brief Count one line over the budget; safe from any context.
+ */
+static void Log_CountOverBudget(void);
+
+/**
+ * @brief Copy a line into the RAM buffer.
+ *
+ * @return false if it does not fit (or without @ref LOG_DEFER_ENABLE).
+ */
+static bool Log_Defer(const void *data, size_t len);
+
+/**
+ * @brief Report held-back lines of quiet call sites (rate limiter).
+ */
+static void Log_ServiceReports(void);
+
+/**
+ * @brief Send lines from the RAM buffer while the TX ring and the budget
+ *        take them. Thread mode only.
+ *
+ * @param paced false to ignore the budget (Log_Flush()).
+ *
+ * @return true if a line was sent.
+ */
+static bool Log_SendDeferred(bool paced);
+
+/**
+ * @brief Maximum length of a single log message (excluding prefix).
  */
 #define LOG_MAX_MESSAGE_LENGTH   (256U)
 
+/**
+ * @brief Maximum length of the "[timestamp][level][file:line][func] " prefix.
+ */
+#define LOG_MAX_PREFIX_LENGTH    (96U)
+
+/**
+ * @brief Number of log lines dropped (TX ring full or no staging buffer).
+ */
+static volatile uint32_t s_droppedLines = 0U;
+
+/**
+ * @brief Space in front of the line in a staging buffer for a repeat report.
+ */
+#define LOG_REPORT_HEADROOM      (LOG_MAX_PREFIX_LENGTH + 64U)
+
+/** @brief Size of one staging buffer: report, prefix, message and "\r\n". */
+#define LOG_STAGING_SIZE         (LOG_REPORT_HEADROOM + LOG_MAX_PREFIX_LENGTH + \
+                                  LOG_MAX_MESSAGE_LENGTH + 2U)
+
+/** @brief Total number of staging buffers. */
+#define LOG_STAGING_COUNT        (LOG_THREAD_STAGING_BUFFERS + LOG_ISR_STAGING_BUFFERS)
+
+_Static_assert(LOG_STAGING_COUNT <= 32U, "staging buffers are tracked in one 32-bit mask");
+
+/**
+ * @brief Staging buffers; thread-mode ones first, then interrupt ones.
+ */
+static char s_staging[LOG_STAGING_COUNT][LOG_STAGING_SIZE];
+
+/**
+ * @brief Staging buffers in use (bit per buffer).
+ */
+static volatile uint32_t s_stagingBusy = 0U;
+
+/**
+ * @brief Claim a free staging buffer for the calling context.
+ *
+ * Interrupt handlers only use the interrupt set, so they always find one
+ * unless @ref LOG_ISR_STAGING_BUFFERS handlers are nested.
+ *
+ * @return Buffer index, or -1 if every buffer of the context is busy.
+ */
+static int32_t Log_ClaimStaging(void);
+
+/**
+ * @brief Return a buffer claimed with Log_ClaimStaging().
+ */
+static void Log_ReleaseStaging(int32_t slot);
+
+/**
+ * @brief Count one dropped line; safe from any context.
+ */
+static void Log_CountDrop(void);
+
+/**
+ * @brief Write the "[timestamp][level][file:line][func] " prefix.
+ *
+ * Cut at LOG_MAX_PREFIX_LENGTH - 1 characters.
+ *
+ * @return Position after the prefix.
+ */
+static char *Log_PutPrefix(char *dst, LogLevel_t level, const char *file, uint32_t line,
+                           const char *func, uint32_t timestamp_ms);
+
+/**
+ * @brief What a call site held back since its last printed line.
+ */
+typedef struct
+{
+    const char *file;           /**< File, or the ID string in binary mode. */
+    const char *func;           /**< Function (text mode).                  */
+    uint32_t    line;           /**< Line (text mode).                      */
+    uint16_t    repeats;        /**< Identical messages collapsed.          */
+    uint16_t    limited;        /**< Other messages over the rate limit.    */
+    uint8_t     level;          /**< Level of the site.                     */
+} LogReport_t;
+
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+
+_Static_assert((LOG_RATE_SITES & (LOG_RATE_SITES - 1U)) == 0U,
+               "LOG_RATE_SITES must be a power of two");
+
+/** @brief Table slots probed for a call site. */
+#define LOG_RATE_PROBES          (4U)
+
+/**
+ * @brief Rate and repeat state of one call site.
+ */
+typedef struct
+{
+    uintptr_t   site;           /**< Call-site address; 0 when free.        */
+    uint32_t    hash;           /**< Hash of the site's last message.       */
+    uint32_t    refill_ms;      /**< Time the bucket was last topped up.    */
+    uint32_t    lastUse_ms;     /**< Time of the site's last call.          */
+    uint32_t    pending_ms;     /**< Time the first held-back line came in. */
+    uint8_t     tokens;         /**< Lines the site may still print.        */
+    LogReport_t report;         /**< Held back since the last print.        */
+} LogSite_t;
+
+/**
+ * @brief Call-site table.
+ */
+static LogSite_t s_sites[LOG_RATE_SITES];
+
+/**
+ * @brief Rate limiting and repeat collapsing active (`log limit`).
+ */
+static volatile bool s_rateLimit = true;
+
+/**
+ * @brief Lines collapsed or rate-limited since startup.
+ */
+static volatile uint32_t s_heldLines = 0U;
+
+/**
+ * @brief Decide whether a site's line is printed.
+ *
+ * @param site       Call-site key.
+ * @param msg        Formatted message (text) or raw arguments (binary).
+ * @param len        Bytes at @p msg.
+ * @param[in,out] report Site description in; what to report before the
+ *                   line out (counts 0 when nothing is pending).
+ *
+ * @return true to print the line, false if it was held back.
+ */
+static bool Log_RateCheck(uintptr_t site, const void *msg, size_t len, LogReport_t *report);
+
+/**
+ * @brief Find or claim the table entry of @p site; interrupts masked.
+ */
+static LogSite_t *Log_FindSite(uintptr_t site, uint32_t now_ms);
+
+/**
+ * @brief Format a repeat report as a complete text line.
+ *
+ * @return Length written (at most LOG_REPORT_HEADROOM).
+ */
+static size_t Log_FormatReport(char *dst, const LogReport_t *report, uint32_t timestamp_ms);
+
+/**
+ * @brief Send a repeat report as a binary record (sites of Log_PrintBinary()).
+ */
+static void Log_BinaryReport(const LogReport_t *report);
+
+#endif /* LOG_RATE_LIMIT_ENABLE */
+
+/**
+ * @brief Maximum size of one binary log record, including framing.
+ */
+#define LOG_BINARY_MAX_RECORD    (64U)
+
+/**
+ * @brief Maximum number of characters copied for a %s argument.
+ */
+#define LOG_BINARY_MAX_STRING    (32U)
+
+/**
+ * @brief Append raw bytes to a binary record under construction.
+ *
+ * Leaves one byte free at the end for the XOR check byte.
+ *
+ * @param record Record buffer of LOG_BINARY_MAX_RECORD bytes.
+ * @param pos    In/out write position.
+ * @param data   Bytes to append.
+ * @param len    Number of bytes.
+ * @return true if the bytes fit, false otherwise.
+ */
+static bool Log_BinaryPut(uint8_t *record, size_t *pos, const void *data, size_t len)
+{
+    if ((*pos + len) > (LOG_BINARY_MAX_RECORD - 1U))
+    {
+        return false;
+    }
+
+    memcpy(&record[*pos], data, len);
+    *pos += len;
+    return true;
+}
+
+/**
+ * @brief Copy a NUL-terminated string, stopping at @p end.
+ *
+ * @return Position after the last character written.
+ */
+static inline char *Log_PutString(char *dst, const char *end, const char *str);
+
+/**
+ * @brief Write @p value in decimal, zero-padded to @p minDigits.
+ *
+ * Replaces "%0*lu" in the prefix; digits that do not fit before @p end
+ * are cut from the right.
+ *
+ * @return Position after the last character written.
+ */
+static char *Log_PutDecimal(char *dst, const char *end, uint32_t value, uint32_t minDigits);
+
 /**
  * @brief Converts a LogLevel_t to a short string tag.
  *
  * @param level Logging level.
  * @return Pointer to a static string.
  */
-static const char *Log_LevelToString(LogLevel_t level);
+static inline const char *Log_LevelToString(LogLevel_t level);
 
 /* ------------------------------------------------------------------------- */
 
-void Log_Init(UART_HandleTypeDef *huart)
+void Log_Init(const Stream_t *out)
 {
-    s_logUart = huart;
+    s_out = out;
+    Log_UpdateThreshold();
+
+    Metrics_Publish(METRIC_LOG_DROPPED, &s_droppedLines);
+    Metrics_Publish(METRIC_LOG_OVER_BUDGET, &s_overBudgetLines);
+#if (LOG_DEFER_ENABLE != 0)
+    Metrics_Publish(METRIC_LOG_DEFERRED, &s_deferredLines);
+    Metrics_PublishGauge(METRIC_LOG_DEFER_BYTES, Log_GetDeferredBytes);
+#endif
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+    Metrics_Publish(METRIC_LOG_HELD, &s_heldLines);
+#endif
 }
 
 /**
@@ -72,110 +425,1035 @@ void Log_Print(LogLevel_t level,
                const char *fmt,
                ...)
 {
-    /* If logging is not initialized, do nothing. */
-    if (s_logUart == NULL)
+    /* Initialized, enabled and minimum level in one byte (see Log_Init()). */
+    if ((uint8_t)level < g_logThreshold)
     {
         return;
     }
 
-    /* Apply global filters: enabled flag and min log level. */
-    if ((!s_enabled) || (level < s_minLevel))
+    int32_t slot = Log_ClaimStaging();
+    if (slot < 0)
     {
+        Log_CountDrop();
         return;
     }
 
-    /* 🔴 THIS IS THE CRITICAL FILTER 🔴 */
-     if ((s_logUart == NULL) || (!s_enabled) || (level < s_minLevel))
-     {
-         return;
-     }
-
-    char buffer[LOG_MAX_MESSAGE_LENGTH];
-    char logPrefix[96];
+    /* The line starts after room for a repeat report (see below). */
+    char *buffer = &s_staging[slot][LOG_REPORT_HEADROOM];
 
     /* Obtain system tick count for basic timestamping. */
     uint32_t timestamp_ms = HAL_GetTick();
 
-    /* Compose a short prefix with timestamp, level, file, line, and function. */
-    (void)snprintf(logPrefix,
-                   sizeof(logPrefix),
-                   "[%08lu ms][%s][%s:%lu][%s] ",
-                   (unsigned long)timestamp_ms,
-                   Log_LevelToString(level),
-                   file,
-                   (unsigned long)line,
-                   func);
+    char  *p   = Log_PutPrefix(buffer, level, file, line, func, timestamp_ms);
+    size_t len = (size_t)(p - buffer);
 
     /* Format the main log message using the variable arguments. */
     va_list args;
     va_start(args, fmt);
-    int msgLen = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    int msgLen = Fmt_VFormat(p, LOG_MAX_MESSAGE_LENGTH, fmt, args);
     va_end(args);
 
     if (msgLen < 0)
     {
+        Log_ReleaseStaging(slot);
+        return;
+    }
+
+    if ((size_t)msgLen >= LOG_MAX_MESSAGE_LENGTH)
+    {
+        /* Account for truncation by the formatter. */
+        msgLen = (int)(LOG_MAX_MESSAGE_LENGTH - 1U);
+    }
+
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+    LogReport_t report = { .file = file, .func = func, .line = line, .level = (uint8_t)level };
+    if (!Log_RateCheck((uintptr_t)__builtin_return_address(0), p, (size_t)msgLen, &report))
+    {
+        Log_ReleaseStaging(slot);
         return;
     }
+#endif
+
+    CrashLog_RecordLog((uint8_t)level, false, p, (size_t)msgLen);
+
+    len += (size_t)msgLen;
+    buffer[len++] = '\r';
+    buffer[len++] = '\n';
 
-    /* Move to column 0, then print prefix and message. */
-    const char cr = '\r';
-    (void)HAL_UART_Transmit(s_logUart,
-                            (uint8_t *)&cr,
-                            1U,
-                            HAL_MAX_DELAY);
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+    /* What the site held back goes out just before it, in the same write. */
+    if ((report.repeats != 0U) || (report.limited != 0U))
+    {
+        char  *head = s_staging[slot];
+        size_t rlen = Log_FormatReport(head, &report, timestamp_ms);
 
-    /* Transmit prefix, then message, then newline. */
-    (void)HAL_UART_Transmit(s_logUart,
-                            (uint8_t *)logPrefix,
-                            (uint16_t)strlen(logPrefix),
-                            HAL_MAX_DELAY);
+        memmove(buffer - rlen, head, rlen);
+        buffer -= rlen;
+        len    += rlen;
+    }
+#endif
 
-    (void)HAL_UART_Transmit(s_logUart,
-                            (uint8_t *)buffer,
-                            (uint16_t)strlen(buffer),
-                            HAL_MAX_DELAY);
+    LogWrite_t written = Log_Write(level, buffer, len);
+    Log_ReleaseStaging(slot);
 
-    const char newline[] = "\r\n";
-    (void)HAL_UART_Transmit(s_logUart,
-                            (uint8_t *)newline,
-                            (uint16_t)strlen(newline),
-                            HAL_MAX_DELAY);
+    if (written == LOG_WRITE_DROPPED)
+    {
+        Log_CountDrop();
+    }
+    if (written != LOG_WRITE_SENT)
+    {
+        return;
+    }
 
-    /* Notify any interested module (e.g., CLI) that new output occurred. */
-    CLI_OnExternalOutput();
+    /* Notify any interested module (e.g., CLI) that new output occurred.
+     * The CLI's line editor belongs to thread mode, so not from handlers.
+     */
+    if (__get_IPSR() == 0U)
+    {
+        CLI_OnExternalOutput();
+    }
 }
 
-/**
- * @brief Map a log level to a compact string tag.
- */
-static const char *Log_LevelToString(LogLevel_t level)
+void Log_PrintBinary(LogLevel_t level, const char *id, ...)
 {
-    switch (level)
+    if (((uint8_t)level < g_logThreshold) || (id == NULL))
     {
-        case LOG_LEVEL_DEBUG: return "DBG";
-        case LOG_LEVEL_INFO:  return "INF";
-        case LOG_LEVEL_WARN:  return "WRN";
-        case LOG_LEVEL_ERROR: return "ERR";
-        default:              return "UNK";
+        return;
+    }
+
+    uint8_t record[LOG_BINARY_MAX_RECORD];
+    size_t  pos = 2U; /* SYNC and LEN are filled in last. */
+
+    uint32_t timestamp_ms = HAL_GetTick();
+    uint32_t idAddr       = (uint32_t)(uintptr_t)id;
+
+    memcpy(&record[pos], &timestamp_ms, sizeof(timestamp_ms));
+    pos += sizeof(timestamp_ms);
+    record[pos++] = (uint8_t)level;
+    memcpy(&record[pos], &idAddr, sizeof(idAddr));
+    pos += sizeof(idAddr);
+
+    /* Walk the format only to learn the argument types; no formatting. */
+    va_list args;
+    va_start(args, id);
+
+    bool overflow = false;
+    for (const char *p = id; (*p != '\0') && !overflow; ++p)
+    {
+        if (*p != '%')
+        {
+            continue;
+        }
+
+        p++;
+        if (*p == '%')
+        {
+            continue;
+        }
+
+        /* Flags, width and precision; '*' consumes an int argument. */
+        while ((*p != '\0') && (strchr("-+ #0123456789.*", *p) != NULL))
+        {
+            if (*p == '*')
+            {
+                int32_t v = (int32_t)va_arg(args, int);
+                overflow = !Log_BinaryPut(record, &pos, &v, sizeof(v));
+            }
+            p++;
+        }
+
+        /* Length modifiers. */
+        uint32_t longCount = 0U;
+        while ((*p == 'l') || (*p == 'h') || (*p == 'z') || (*p == 't') || (*p == 'j'))
+        {
+            if (*p == 'l')
+            {
+                longCount++;
+            }
+            p++;
+        }
+
+        switch (*p)
+        {
+            case 'd': case 'i': case 'u': case 'x': case 'X':
+            case 'o': case 'c': case 'p':
+                if (longCount >= 2U)
+                {
+                    uint64_t v = va_arg(args, unsigned long long);
+                    overflow = !Log_BinaryPut(record, &pos, &v, sizeof(v));
+                }
+                else
+                {
+                    /* int and long are both 32 bits on Cortex-M. */
+                    uint32_t v = (uint32_t)va_arg(args, unsigned int);
+                    overflow = !Log_BinaryPut(record, &pos, &v, sizeof(v));
+                }
+                break;
+
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+            {
+                float v = (float)va_arg(args, double);
+                overflow = !Log_BinaryPut(record, &pos, &v, sizeof(v));
+                break;
+            }
+
+            case 's':
+            {
+                const char *str = va_arg(args, const char *);
+                if (str == NULL)
+                {
+                    str = "(null)";
+                }
+                size_t n = strnlen(str, LOG_BINARY_MAX_STRING);
+                uint8_t n8 = (uint8_t)n;
+                overflow = !Log_BinaryPut(record, &pos, &n8, 1U) ||
+                           !Log_BinaryPut(record, &pos, str, n);
+                break;
+            }
+
+            case '\0':
+                p--; /* Let the loop terminate on the NUL. */
+                break;
+
+            default:
+                /* Unknown conversion: no argument consumed. */
+                break;
+        }
+    }
+
+    va_end(args);
+
+    if (overflow)
+    {
+        /* Arguments did not fit: keep the header so the host still sees
+         * the call site, and drop the truncated arguments.
+         */
+        pos = 2U + sizeof(timestamp_ms) + 1U + sizeof(idAddr);
+    }
+
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+    size_t      argsAt = 2U + sizeof(timestamp_ms) + 1U + sizeof(idAddr);
+    LogReport_t report = { .file = id, .func = NULL, .line = 0U, .level = (uint8_t)level };
+    if (!Log_RateCheck((uintptr_t)id, &record[argsAt], pos - argsAt, &report))
+    {
+        return;
+    }
+
+    if ((report.repeats != 0U) || (report.limited != 0U))
+    {
+        Log_BinaryReport(&report);
+    }
+#endif
+
+    /* The crash trace keeps the format address and arguments. */
+    size_t payload = 2U + sizeof(timestamp_ms) + 1U;
+    CrashLog_RecordLog((uint8_t)level, true, &record[payload], pos - payload);
+
+    uint8_t check = 0U;
+    for (size_t i = 2U; i < pos; ++i)
+    {
+        check ^= record[i];
+    }
+
+    record[0]     = LOG_BINARY_SYNC;
+    record[1]     = (uint8_t)(pos - 2U);
+    record[pos++] = check;
+
+    LogWrite_t written = Log_Write(level, record, pos);
+
+    if (written == LOG_WRITE_DROPPED)
+    {
+        Log_CountDrop();
+    }
+    if ((written == LOG_WRITE_SENT) && (__get_IPSR() == 0U))
+    {
+        CLI_OnExternalOutput();
     }
 }
 
-void Log_SetLevel(LogLevel_t level)
+void Log_Flush(void)
 {
-    s_minLevel = level;
+    if (s_out == NULL)
+    {
+        return;
+    }
+
+    /* The TX ring may not take the whole buffer at once. */
+    do
+    {
+        Stream_Flush(s_out);
+    } while (Log_SendDeferred(false));
+
+    Stream_Flush(s_out);
 }
 
-LogLevel_t Log_GetLevel(void)
+uint32_t Log_GetDroppedCount(void)
 {
-    return s_minLevel;
+    return s_droppedLines;
 }
 
-void Log_Enable(bool enable)
+void Log_SetMode(uint32_t mode)
 {
-    s_enabled = enable;
+    if (mode >= LOG_MAX_MODES)
+    {
+        return;
+    }
+
+    s_mode      = mode;
+    s_deferring = (LOG_DEFER_ENABLE != 0) && ((s_deferModes & (1UL << mode)) != 0U);
+    Log_UpdateThreshold();
+
+    if (!s_deferring && Log_SendDeferred(true))
+    {
+        CLI_OnExternalOutput();
+    }
 }
 
-bool Log_IsEnabled(void)
+void Log_SetModeLevel(uint32_t mode, uint8_t level)
 {
-    return s_enabled;
+    if (mode >= LOG_MAX_MODES)
+    {
+        return;
+    }
+
+    if (level == LOG_MODE_LEVEL_DEFAULT)
+    {
+        s_modeOverride &= ~(1UL << mode);
+    }
+    else
+    {
+        s_modeLevel[mode] = level;
+        s_modeOverride   |= 1UL << mode;
+    }
+    Log_UpdateThreshold();
 }
+
+void Log_SetFloor(LogLevel_t level)
+{
+    s_floorLevel = (uint8_t)level;
+    Log_UpdateThreshold();
+}
+
+LogLevel_t Log_GetFloor(void)
+{
+    return (LogLevel_t)s_floorLevel;
+}
+
+uint8_t Log_GetModeLevel(uint32_t mode)
+{
+    if ((mode >= LOG_MAX_MODES) || ((s_modeOverride & (1UL << mode)) == 0U))
+    {
+        return LOG_MODE_LEVEL_DEFAULT;
+    }
+
+    return s_modeLevel[mode];
+}
+
+void Log_SetModeDefer(uint32_t mode, bool defer)
+{
+    if (mode >= LOG_MAX_MODES)
+    {
+        return;
+    }
+
+    if (defer)
+    {
+        s_deferModes |= 1UL << mode;
+    }
+    else
+    {
+        s_deferModes &= ~(1UL << mode);
+    }
+
+    if (mode == s_mode)
+    {
+        Log_SetMode(mode);
+    }
+}
+
+bool Log_GetModeDefer(uint32_t mode)
+{
+    return (mode < LOG_MAX_MODES) && ((s_deferModes & (1UL << mode)) != 0U);
+}
+
+void Log_SetBudget(uint32_t bytesPerSecond)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_budget          = bytesPerSecond;
+    s_budgetTokens    = (int32_t)bytesPerSecond;
+    s_budgetRefill_ms = HAL_GetTick();
+
+    __set_PRIMASK(primask);
+}
+
+uint32_t Log_GetBudget(void)
+{
+    return s_budget;
+}
+
+uint32_t Log_GetDeferredBytes(void)
+{
+#if (LOG_DEFER_ENABLE != 0)
+    return s_deferTail - s_deferHead;
+#else
+    return 0U;
+#endif
+}
+
+void Log_Service(void)
+{
+#if (LOG_DEFER_ENABLE != 0)
+    /* A deferring mode only sends when the buffer is about to overflow. */
+    if ((!s_deferring || (Log_GetDeferredBytes() >= ((LOG_DEFER_SIZE * 3U) / 4U))) &&
+        Log_SendDeferred(true))
+    {
+        CLI_OnExternalOutput();
+    }
+#endif
+
+    Log_ServiceReports();
+}
+
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+
+static void Log_ServiceReports(void)
+{
+    uint32_t now_ms = HAL_GetTick();
+
+    for (uint32_t i = 0U; i < LOG_RATE_SITES; ++i)
+    {
+        LogSite_t  *entry = &s_sites[i];
+        LogReport_t report;
+        bool        due   = false;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        if ((entry->site != 0U) &&
+            ((entry->report.repeats != 0U) || (entry->report.limited != 0U)) &&
+            ((now_ms - entry->pending_ms) >= LOG_REPEAT_REPORT_MS))
+        {
+            report                = entry->report;
+            entry->report.repeats = 0U;
+            entry->report.limited = 0U;
+            due                   = true;
+        }
+
+        __set_PRIMASK(primask);
+
+        if (!due)
+        {
+            continue;
+        }
+
+        /* Binary sites have no function name. */
+        if (report.func == NULL)
+        {
+            Log_BinaryReport(&report);
+            continue;
+        }
+
+        int32_t slot = Log_ClaimStaging();
+        if (slot < 0)
+        {
+            Log_CountDrop();
+            continue;
+        }
+
+        size_t len = Log_FormatReport(s_staging[slot], &report, now_ms);
+        if (!Stream_Write(s_out, s_staging[slot], len))
+        {
+            Log_CountDrop();
+        }
+        Log_ReleaseStaging(slot);
+    }
+}
+
+void Log_SetRateLimit(bool enable)
+{
+    s_rateLimit = enable;
+}
+
+bool Log_IsRateLimited(void)
+{
+    return s_rateLimit;
+}
+
+uint32_t Log_GetHeldCount(void)
+{
+    return s_heldLines;
+}
+
+#else /* LOG_RATE_LIMIT_ENABLE == 0 */
+
+static void Log_ServiceReports(void)
+{
+}
+
+void Log_SetRateLimit(bool enable)
+{
+    (void)enable;
+}
+
+bool Log_IsRateLimited(void)
+{
+    return false;
+}
+
+uint32_t Log_GetHeldCount(void)
+{
+    return 0U;
+}
+
+#endif /* LOG_RATE_LIMIT_ENABLE */
+
+/**
+ * @brief Map a log level to a compact string tag.
+ */
+static inline const char *Log_LevelToString(LogLevel_t level)
+{
+    switch (level)
+    {
+        case LOG_LEVEL_DEBUG: return "DBG";
+        case LOG_LEVEL_INFO:  return "INF";
+        case LOG_LEVEL_WARN:  return "WRN";
+        case LOG_LEVEL_ERROR: return "ERR";
+        default:              return "UNK";
+    }
+}
+
+void Log_SetLevel(LogLevel_t level)
+{
+    s_minLevel = level;
+    Log_UpdateThreshold();
+}
+
+LogLevel_t Log_GetLevel(void)
+{
+    return s_minLevel;
+}
+
+void Log_Enable(bool enable)
+{
+    s_enabled = enable;
+    Log_UpdateThreshold();
+}
+
+bool Log_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+static void Log_UpdateThreshold(void)
+{
+    uint8_t level = (uint8_t)s_minLevel;
+
+    if ((s_modeOverride & (1UL << s_mode)) != 0U)
+    {
+        level = s_modeLevel[s_mode];
+    }
+
+    if (level < s_floorLevel)
+    {
+        level = s_floorLevel;
+    }
+
+    g_logThreshold = ((s_out != NULL) && s_enabled) ? level : LOG_THRESHOLD_OFF;
+}
+
+static LogWrite_t Log_Write(LogLevel_t level, const void *data, size_t len)
+{
+    /* Behind lines already waiting, so the log keeps its order; a line the
+     * stream has no room for now waits as well instead of being dropped.
+     */
+    bool hold = (((uint8_t)level <= (uint8_t)LOG_DEFER_MAX_LEVEL) &&
+                 (s_deferring || (Log_GetDeferredBytes() != 0U))) ||
+                (Stream_GetWritable(s_out) < len);
+
+    if (!hold && !Log_TakeBudget(level, len))
+    {
+        Log_CountOverBudget();
+        hold = true;
+    }
+
+    if (hold)
+    {
+        return Log_Defer(data, len) ? LOG_WRITE_DEFERRED : LOG_WRITE_DROPPED;
+    }
+
+    return Stream_Write(s_out, data, len) ? LOG_WRITE_SENT : LOG_WRITE_DROPPED;
+}
+
+static void Log_CountOverBudget(void)
+{
+    uint32_t count;
+    do
+    {
+        count = __LDREXW(&s_overBudgetLines);
+    } while (__STREXW(count + 1U, &s_overBudgetLines) != 0U);
+}
+
+static bool Log_TakeBudget(LogLevel_t level, size_t len)
+{
+    if (s_budget == 0U)
+    {
+        return true;
+    }
+
+    bool     taken   = true;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now_ms  = HAL_GetTick();
+    uint32_t elapsed = now_ms - s_budgetRefill_ms;
+    uint32_t refill  = (elapsed >= 1000U) ? s_budget
+                                          : (uint32_t)(((uint64_t)elapsed * s_budget) / 1000U);
+
+    /* Only whole bytes move the refill time, so slow budgets still fill. */
+    if (refill != 0U)
+    {
+        int64_t tokens = (int64_t)s_budgetTokens + refill;
+
+        s_budgetTokens    = (tokens > (int64_t)s_budget) ? (int32_t)s_budget : (int32_t)tokens;
+        s_budgetRefill_ms = now_ms;
+    }
+
+    if ((s_budgetTokens > 0) || (level == LOG_LEVEL_ERROR))
+    {
+        s_budgetTokens -= (int32_t)len;
+    }
+    else
+    {
+        taken = false;
+    }
+
+    __set_PRIMASK(primask);
+    return taken;
+}
+
+static int32_t Log_ClaimStaging(void)
+{
+    uint32_t first = 0U;
+    uint32_t count = LOG_THREAD_STAGING_BUFFERS;
+
+    if (__get_IPSR() != 0U)
+    {
+        first = LOG_THREAD_STAGING_BUFFERS;
+        count = LOG_ISR_STAGING_BUFFERS;
+    }
+
+    for (;;)
+    {
+        uint32_t busy = __LDREXW(&s_stagingBusy);
+        uint32_t slot = first;
+
+        while ((slot < (first + count)) && ((busy & (1UL << slot)) != 0U))
+        {
+            slot++;
+        }
+
+        if (slot == (first + count))
+        {
+            __CLREX();
+            return -1;
+        }
+
+        /* Retried if another context claimed or released in between. */
+        if (__STREXW(busy | (1UL << slot), &s_stagingBusy) == 0U)
+        {
+            __DMB();
+            return (int32_t)slot;
+        }
+    }
+}
+
+static void Log_ReleaseStaging(int32_t slot)
+{
+    __DMB();
+
+    uint32_t busy;
+    do
+    {
+        busy = __LDREXW(&s_stagingBusy);
+    } while (__STREXW(busy & ~(1UL << (uint32_t)slot), &s_stagingBusy) != 0U);
+}
+
+static void Log_CountDrop(void)
+{
+    uint32_t count;
+    do
+    {
+        count = __LDREXW(&s_droppedLines);
+    } while (__STREXW(count + 1U, &s_droppedLines) != 0U);
+}
+
+static char *Log_PutPrefix(char *dst, LogLevel_t level, const char *file, uint32_t line,
+                           const char *func, uint32_t timestamp_ms)
+{
+    /* Start at column 0, then a short prefix with timestamp, level, file,
+     * line, and function.
+     */
+    const char *end = &dst[LOG_MAX_PREFIX_LENGTH - 1U];
+    char       *p   = dst;
+
+    p = Log_PutString(p, end, "\r[");
+    p = Log_PutDecimal(p, end, timestamp_ms, 8U);
+    p = Log_PutString(p, end, " ms][");
+    p = Log_PutString(p, end, Log_LevelToString(level));
+    p = Log_PutString(p, end, "][");
+    p = Log_PutString(p, end, file);
+    p = Log_PutString(p, end, ":");
+    p = Log_PutDecimal(p, end, line, 1U);
+    p = Log_PutString(p, end, "][");
+    p = Log_PutString(p, end, func);
+    p = Log_PutString(p, end, "] ");
+
+    return p;
+}
+
+#if (LOG_RATE_LIMIT_ENABLE != 0)
+
+static bool Log_RateCheck(uintptr_t site, const void *msg, size_t len, LogReport_t *report)
+{
+    if (((LogLevel_t)report->level < LOG_RATE_MIN_LEVEL) || !s_rateLimit)
+    {
+        report->repeats = 0U;
+        report->limited = 0U;
+        return true;
+    }
+
+    /* FNV-1a over the message; only equality with the last one matters. */
+    const uint8_t *bytes = (const uint8_t *)msg;
+    uint32_t       hash  = 2166136261UL;
+    for (size_t i = 0U; i < len; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619UL;
+    }
+    hash |= 1U; /* 0 marks "no message yet". */
+
+    uint32_t now_ms = HAL_GetTick();
+    bool     print  = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    LogSite_t *entry = Log_FindSite(site, now_ms);
+
+    /* Top the bucket up by one token per LOG_RATE_INTERVAL_MS. */
+    uint32_t add = (now_ms - entry->refill_ms) / LOG_RATE_INTERVAL_MS;
+    if ((entry->tokens + add) >= LOG_RATE_BURST)
+    {
+        entry->tokens    = LOG_RATE_BURST;
+        entry->refill_ms = now_ms;
+    }
+    else
+    {
+        entry->tokens    += (uint8_t)add;
+        entry->refill_ms += add * LOG_RATE_INTERVAL_MS;
+    }
+
+    bool recent = ((now_ms - entry->lastUse_ms) < LOG_REPEAT_REPORT_MS);
+    bool held   = (entry->report.repeats != 0U) || (entry->report.limited != 0U);
+    entry->lastUse_ms = now_ms;
+
+    if (recent && (hash == entry->hash))
+    {
+        if (entry->report.repeats < UINT16_MAX)
+        {
+            entry->report.repeats++;
+        }
+    }
+    else if (entry->tokens == 0U)
+    {
+        if (entry->report.limited < UINT16_MAX)
+        {
+            entry->report.limited++;
+        }
+        entry->hash = hash;
+    }
+    else
+    {
+        entry->tokens--;
+        entry->hash = hash;
+        print       = true;
+
+        report->repeats       = entry->report.repeats;
+        report->limited       = entry->report.limited;
+        entry->report.repeats = 0U;
+        entry->report.limited = 0U;
+    }
+
+    if (!print)
+    {
+        if (!held)
+        {
+            entry->pending_ms = now_ms;
+        }
+        s_heldLines++;
+    }
+
+    __set_PRIMASK(primask);
+
+    return print;
+}
+
+static LogSite_t *Log_FindSite(uintptr_t site, uint32_t now_ms)
+{
+    /* Fibonacci hashing spreads the (aligned) code addresses. */
+    uint32_t   index  = ((uint32_t)site * 2654435761UL) >> 16;
+    LogSite_t *victim = NULL;
+
+    for (uint32_t probe = 0U; probe < LOG_RATE_PROBES; ++probe)
+    {
+        LogSite_t *entry = &s_sites[(index + probe) & (LOG_RATE_SITES - 1U)];
+
+        if (entry->site == site)
+        {
+            return entry;
+        }
+
+        /* Prefer a free slot, then the site that was quiet the longest. */
+        if ((victim == NULL) ||
+            ((victim->site != 0U) &&
+             ((entry->site == 0U) ||
+              ((now_ms - entry->lastUse_ms) > (now_ms - victim->lastUse_ms)))))
+        {
+            victim = entry;
+        }
+    }
+
+    /* An evicted site's held-back lines stay counted in s_heldLines. */
+    victim->site           = site;
+    victim->hash           = 0U;
+    victim->tokens         = LOG_RATE_BURST;
+    victim->refill_ms      = now_ms;
+    victim->lastUse_ms     = now_ms;
+    victim->pending_ms     = now_ms;
+    victim->report.repeats = 0U;
+    victim->report.limited = 0U;
+
+    return victim;
+}
+
+static size_t Log_FormatReport(char *dst, const LogReport_t *report, uint32_t timestamp_ms)
+{
+    char  *p   = Log_PutPrefix(dst, (LogLevel_t)report->level, report->file, report->line,
+                               report->func, timestamp_ms);
+    size_t len = (size_t)(p - dst);
+    size_t cap = LOG_REPORT_HEADROOM - len - 2U;
+    int    n   = 0;
+
+    if (report->repeats != 0U)
+    {
+        n = Fmt_Format(p, cap, "last message repeated %u times%s",
+                       (unsigned int)report->repeats,
+                       (report->limited != 0U) ? ", " : "");
+    }
+    if ((n >= 0) && ((size_t)n < cap) && (report->limited != 0U))
+    {
+        int m = Fmt_Format(&p[n], cap - (size_t)n, "%u lines rate-limited",
+                           (unsigned int)report->limited);
+        n = (m < 0) ? n : (n + m);
+    }
+    if ((n < 0) || ((size_t)n >= cap))
+    {
+        n = (n < 0) ? 0 : (int)(cap - 1U);
+    }
+
+    len += (size_t)n;
+    dst[len++] = '\r';
+    dst[len++] = '\n';
+
+    return len;
+}
+
+static void Log_BinaryReport(const LogReport_t *report)
+{
+    static const char s_reportId[] __attribute__((section(".rodata.log_fmt"))) =
+        "log.c:0:%s: last message repeated %u times, %u lines rate-limited";
+
+    uint8_t  record[LOG_BINARY_MAX_RECORD];
+    size_t   pos          = 2U;
+    uint32_t timestamp_ms = HAL_GetTick();
+    uint32_t idAddr       = (uint32_t)(uintptr_t)s_reportId;
+    uint32_t repeats      = report->repeats;
+    uint32_t limited      = report->limited;
+
+    memcpy(&record[pos], &timestamp_ms, sizeof(timestamp_ms));
+    pos += sizeof(timestamp_ms);
+    record[pos++] = report->level;
+    memcpy(&record[pos], &idAddr, sizeof(idAddr));
+    pos += sizeof(idAddr);
+
+    /* Name the site by the "file:line" of its ID, without the path. */
+    const char *name = report->file;
+    for (const char *c = report->file; (*c != '\0') && (*c != ':'); ++c)
+    {
+        if ((*c == '/') || (*c == '\\'))
+        {
+            name = c + 1;
+        }
+    }
+
+    uint8_t n8 = (uint8_t)strnlen(name, LOG_BINARY_MAX_STRING);
+    (void)Log_BinaryPut(record, &pos, &n8, 1U);
+    (void)Log_BinaryPut(record, &pos, name, n8);
+    (void)Log_BinaryPut(record, &pos, &repeats, sizeof(repeats));
+    (void)Log_BinaryPut(record, &pos, &limited, sizeof(limited));
+
+    uint8_t check = 0U;
+    for (size_t i = 2U; i < pos; ++i)
+    {
+        check ^= record[i];
+    }
+
+    record[0]     = LOG_BINARY_SYNC;
+    record[1]     = (uint8_t)(pos - 2U);
+    record[pos++] = check;
+
+    if (!Stream_Write(s_out, record, pos))
+    {
+        Log_CountDrop();
+    }
+}
+
+#endif /* LOG_RATE_LIMIT_ENABLE */
+
+static inline char *Log_PutString(char *dst, const char *end, const char *str)
+{
+    while ((dst < end) && (*str != '\0'))
+    {
+        *dst++ = *str++;
+    }
+
+    return dst;
+}
+
+static char *Log_PutDecimal(char *dst, const char *end, uint32_t value, uint32_t minDigits)
+{
+    char     digits[10];
+    uint32_t count = 0U;
+
+    do
+    {
+        digits[count++] = (char)('0' + (value % 10U));
+        value /= 10U;
+    } while (value != 0U);
+
+    while ((count < minDigits) && (count < sizeof(digits)))
+    {
+        digits[count++] = '0';
+    }
+
+    while ((dst < end) && (count > 0U))
+    {
+        *dst++ = digits[--count];
+    }
+
+    return dst;
+}
+
+#if (LOG_DEFER_ENABLE != 0)
+
+static bool Log_Defer(const void *data, size_t len)
+{
+    const uint8_t *src   = data;
+    uint16_t       len16 = (uint16_t)len;
+    bool           kept  = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((len + sizeof(len16)) <= (LOG_DEFER_SIZE - (s_deferTail - s_deferHead)))
+    {
+        uint32_t tail = s_deferTail;
+
+        s_defer[tail & (LOG_DEFER_SIZE - 1U)]        = (uint8_t)len16;
+        s_defer[(tail + 1U) & (LOG_DEFER_SIZE - 1U)] = (uint8_t)(len16 >> 8);
+        tail += sizeof(len16);
+
+        uint32_t at    = tail & (LOG_DEFER_SIZE - 1U);
+        size_t   first = ((LOG_DEFER_SIZE - at) < len) ? (LOG_DEFER_SIZE - at) : len;
+
+        memcpy(&s_defer[at], src, first);
+        memcpy(s_defer, &src[first], len - first);
+
+        s_deferTail = tail + (uint32_t)len;
+        s_deferredLines++;
+        kept = true;
+    }
+
+    __set_PRIMASK(primask);
+    return kept;
+}
+
+static bool Log_SendDeferred(bool paced)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool busy = s_deferSending;
+    s_deferSending = true;
+    __set_PRIMASK(primask);
+
+    if (busy)
+    {
+        return false;
+    }
+
+    bool sent = false;
+
+    /* Appends only move the tail, so the head side is ours. */
+    while (s_deferHead != s_deferTail)
+    {
+        uint32_t head = s_deferHead;
+        size_t   len  = (size_t)s_defer[head & (LOG_DEFER_SIZE - 1U)] |
+                        ((size_t)s_defer[(head + 1U) & (LOG_DEFER_SIZE - 1U)] << 8);
+
+        /* A failed write would count as a drop: wait for room instead. */
+        if ((Stream_GetWritable(s_out) < len) ||
+            (paced && !Log_TakeBudget(LOG_LEVEL_DEBUG, len)))
+        {
+            break;
+        }
+
+        uint32_t at    = (head + 2U) & (LOG_DEFER_SIZE - 1U);
+        size_t   first = ((LOG_DEFER_SIZE - at) < len) ? (LOG_DEFER_SIZE - at) : len;
+
+        const StreamSegment_t line[] =
+        {
+            { &s_defer[at], first,       false },
+            { s_defer,      len - first, false },
+        };
+
+        if (!Stream_WriteSegments(s_out, line, (first < len) ? 2U : 1U))
+        {
+            /* TX ring full: the rest goes on the next call. */
+            break;
+        }
+
+        s_deferHead = head + 2U + (uint32_t)len;
+        sent        = true;
+    }
+
+    s_deferSending = false;
+    return sent;
+}
+
+#else /* LOG_DEFER_ENABLE == 0 */
+
+static bool Log_Defer(const void *data, size_t len)
+{
+    (void)data;
+    (void)len;
+    return false;
+}
+
+static bool Log_SendDeferred(bool paced)
+{
+    (void)paced;
+    return false;
+}
+
+#endif /* LOG_DEFER_ENABLE */
@@ -2,11 +2,24 @@
  * @file log.h
  * @brief Simple logging interface for the Smart Sensor Hub project.
  *
- * This module provides formatted log output over UART, including
+ * This module provides formatted log output to a stream (stream.h),
+ * normally the console UART, including
  * optional metadata such as timestamp, file name, line number,
  * and function name. It is intended to make code flow traceable
  * during development and debugging.
  *
+ * Output is non-blocking: each line is queued on the stream, for the
+ * console into the UART TX ring drained by DMA. If it does not fit, the
+ * line waits in the RAM buffer described below, and only if that is full
+ * too is it dropped and counted (see Log_GetDroppedCount()).
+ *
+ * The filter follows the power mode (Log_SetMode()): a mode may override
+ * the minimum level, and in a deferring mode DEBUG and INFO lines are
+ * kept in RAM instead of waking the UART, then sent in one burst once a
+ * mode that does not defer is entered. A byte budget (Log_SetBudget())
+ * caps the log output per second; lines over it wait in the same RAM
+ * buffer.
+ *
  * @ingroup logging
  */
 
@@ -19,6 +32,7 @@ extern "C" {
 
 #include "stdint.h"
 #include "stm32f4xx_hal.h"
+#include "stream.h"
 #include <stdbool.h>
 
 /**
@@ -28,6 +42,143 @@ extern "C" {
  * @{
  */
 
+/**
+ * @brief Select the deferred binary log format at build time.
+ *
+ * When set to 1, the LOG_* macros emit compact binary records instead of
+ * formatted text. Each call site's "file:line:format" string is placed in
+ * flash and identified on the wire by its address; the host tool
+ * tools/log_decode.py resolves that address from the ELF file and renders
+ * the text. Formatting, file and function names never touch the UART.
+ */
+#ifndef LOG_BINARY_MODE
+#define LOG_BINARY_MODE   (0)
+#endif
+
+/**
+ * @brief Lowest log level compiled into the image.
+ *
+ * Call sites below this level expand to dead code: no call, no argument
+ * evaluation and (from -O1) no format strings in flash. Numeric values
+ * follow @ref LogLevel_t: 0=DEBUG, 1=INFO, 2=WARN, 3=ERROR, 4=none.
+ */
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL   (0)
+#endif
+
+/**
+ * @brief Staging buffers for Log_Print() calls from thread mode.
+ *
+ * A bare-metal build has a single thread. With the FreeRTOS lock
+ * strategies (STM32_THREAD_SAFE_STRATEGY 4 or 5, see stm32_lock.h)
+ * every thread that may be inside Log_Print() at the same moment needs
+ * one. Each buffer is about 350 bytes of static RAM.
+ */
+#ifndef LOG_THREAD_STAGING_BUFFERS
+#if defined(STM32_THREAD_SAFE_STRATEGY) && \
+    ((STM32_THREAD_SAFE_STRATEGY == 4) || (STM32_THREAD_SAFE_STRATEGY == 5))
+#define LOG_THREAD_STAGING_BUFFERS   (4U)
+#else
+#define LOG_THREAD_STAGING_BUFFERS   (1U)
+#endif
+#endif
+
+/**
+ * @brief Staging buffers for Log_Print() calls from interrupt handlers.
+ *
+ * One per interrupt nesting level that logs: the drivers share one
+ * priority, and a fault or the RTOS event bridge can nest on top.
+ */
+#ifndef LOG_ISR_STAGING_BUFFERS
+#define LOG_ISR_STAGING_BUFFERS      (2U)
+#endif
+
+/**
+ * @brief Build the per-call-site rate limiter and repeat collapsing.
+ *
+ * Costs a table of @ref LOG_RATE_SITES entries (about 40 bytes each) and
+ * one hash over the formatted message per line at
+ * @ref LOG_RATE_MIN_LEVEL or above.
+ */
+#ifndef LOG_RATE_LIMIT_ENABLE
+#define LOG_RATE_LIMIT_ENABLE        (1)
+#endif
+
+/**
+ * @brief Lowest level that is rate limited and collapsed.
+ *
+ * WARN and ERROR are what a failing device repeats every cycle; INFO and
+ * DEBUG are verbosity the user asked for and pass unchanged.
+ */
+#ifndef LOG_RATE_MIN_LEVEL
+#define LOG_RATE_MIN_LEVEL           (LOG_LEVEL_WARN)
+#endif
+
+/** @brief Call sites tracked at once (power of two). */
+#ifndef LOG_RATE_SITES
+#define LOG_RATE_SITES               (16U)
+#endif
+
+/** @brief Lines a call site may print in a burst (bucket size). */
+#ifndef LOG_RATE_BURST
+#define LOG_RATE_BURST               (5U)
+#endif
+
+/** @brief One more line per call site every this many milliseconds. */
+#ifndef LOG_RATE_INTERVAL_MS
+#define LOG_RATE_INTERVAL_MS         (1000U)
+#endif
+
+/**
+ * @brief Held-back lines of a quiet call site are reported after this long.
+ *
+ * Also the longest gap over which an identical message still counts as
+ * a repeat.
+ */
+#ifndef LOG_REPEAT_REPORT_MS
+#define LOG_REPEAT_REPORT_MS         (10000U)
+#endif
+
+/**
+ * @brief Build the RAM buffer for deferred and over-budget lines.
+ *
+ * Without it those lines are dropped.
+ */
+#ifndef LOG_DEFER_ENABLE
+#define LOG_DEFER_ENABLE             (1)
+#endif
+
+/** @brief Size of the deferred-line buffer (bytes, power of two). */
+#ifndef LOG_DEFER_SIZE
+#define LOG_DEFER_SIZE               (2048U)
+#endif
+
+/**
+ * @brief Highest level a deferring power mode holds back.
+ *
+ * WARN and ERROR still go out at once.
+ */
+#ifndef LOG_DEFER_MAX_LEVEL
+#define LOG_DEFER_MAX_LEVEL          (LOG_LEVEL_INFO)
+#endif
+
+/** @brief Power modes the per-mode settings are kept for. */
+#define LOG_MAX_MODES                (4U)
+
+/** @brief Log_SetModeLevel() value: use the level of Log_SetLevel(). */
+#define LOG_MODE_LEVEL_DEFAULT       (0xFFU)
+
+/** @brief Log_SetModeLevel() value: no task logging in the mode. */
+#define LOG_MODE_LEVEL_OFF           (0xFEU)
+
+/**
+ * @brief Start-of-record marker for binary log records.
+ *
+ * ASCII "record separator": never produced by CLI text, so the host can
+ * split binary records from interleaved console output.
+ */
+#define LOG_BINARY_SYNC   (0x1EU)
+
 /**
  * @enum LogLevel_t
  * @brief Logging severity levels.
@@ -40,17 +191,29 @@ typedef enum
     LOG_LEVEL_ERROR        /**< Errors that require attention. */
 } LogLevel_t;
 
+/**
+ * @brief Runtime filter threshold used by the LOG_* macros.
+ *
+ * Combines the enabled flag and the minimum level into one byte so that a
+ * filtered-out call costs a single compare-and-branch at the call site:
+ * equals the minimum level while logging is enabled, and 0xFF while it is
+ * disabled or not yet initialized. Maintained by log.c only; read it
+ * through the macros.
+ */
+extern volatile uint8_t g_logThreshold;
+
 /**
  * @brief Initializes the logging module.
  *
- * This function must be called once at startup, after the UART
- * peripheral used for logging has been initialized.
+ * This function must be called once at startup, after the transport of
+ * @p out (e.g. the UART TX ring, UartTx_Init()) has been initialized.
  *
- * @param huart Pointer to the UART handle for log output.
+ * @param out Stream for log output, normally
+ *            UartTx_GetStream(UART_TX_STREAM_LOG).
  *
  * @return None.
  */
-void Log_Init(UART_HandleTypeDef *huart);
+void Log_Init(const Stream_t *out);
 
 void Log_SetLevel(LogLevel_t level);
 LogLevel_t Log_GetLevel(void);
@@ -79,8 +242,8 @@ LogLevel_t Log_GetLevel(void);
 /**
  * @brief Enable or disable logging globally.
  *
- * When disabled, Log_Print() returns immediately without writing
- * anything to the UART. CLI output is not affected by this flag.
+ * When disabled, Log_Print() returns immediately without queuing
+ * anything for the UART. CLI output is not affected by this flag.
  *
  * @param enable true to enable logging, false to disable.
  *
@@ -102,6 +265,10 @@ bool Log_IsEnabled(void);
  * LOG_* macros. It attaches timestamp and source location
  * information to each message.
  *
+ * Safe from thread mode, interrupt handlers and several threads at once;
+ * no call waits for another. A line is dropped and counted when the TX
+ * ring is full or every staging buffer of the calling context is in use.
+ *
  * @param level   Logging level (e.g. LOG_LEVEL_INFO).
  * @param file    Source file name (__FILE__).
  * @param line    Line number in source file (__LINE__).
@@ -118,6 +285,185 @@ void Log_Print(LogLevel_t level,
                const char *fmt,
                ...);
 
+/**
+ * @brief Emits a binary log record (deferred formatting).
+ *
+ * Used by the LOG_* macros when @ref LOG_BINARY_MODE is 1. The format
+ * string is only scanned for conversion specifiers, so the arguments can
+ * be copied raw into the record:
+ * - integer conversions (%d %u %x %c ...): 4 bytes (8 for %ll)
+ * - floating point (%f %e %g): 4-byte IEEE-754 float
+ * - %s: 1 length byte followed by up to 32 characters
+ *
+ * Record layout (little endian):
+ * @code
+ * SYNC(0x1E) LEN | ts_ms:u32 level:u8 id:u32 args... | XOR
+ * @endcode
+ * where LEN counts the bytes between LEN and XOR, and XOR is the XOR of
+ * those bytes.
+ *
+ * @param level Logging level.
+ * @param id    "file:line:format" string in flash; its address is the ID.
+ * @param ...   Arguments for the format string.
+ *
+ * Safe from any context like Log_Print(); the record is built on the
+ * caller's stack.
+ *
+ * @return None.
+ */
+void Log_PrintBinary(LogLevel_t level, const char *id, ...);
+
+/**
+ * @brief Block until all queued log output has been transmitted.
+ *
+ * Log_Print() only queues lines for background DMA transmission. Call
+ * this before a reset or from the fault path (interrupts may be
+ * disabled) to make sure the last lines actually reach the UART.
+ *
+ * @return None.
+ */
+void Log_Flush(void);
+
+/**
+ * @brief Get the number of log lines dropped (TX ring full or no staging
+ *        buffer free).
+ *
+ * @return Dropped line count since startup.
+ */
+uint32_t Log_GetDroppedCount(void);
+
+/**
+ * @brief Report lines held back by call sites that have gone quiet.
+ *
+ * A site's collapsed repeats and rate-limited lines are normally reported
+ * in front of its next printed line; this sends the report once they are
+ * @ref LOG_REPEAT_REPORT_MS old instead. Also sends deferred lines as
+ * the mode and the budget allow. Call periodically from thread mode.
+ *
+ * @return None.
+ */
+void Log_Service(void);
+
+/**
+ * @brief Apply the settings of power mode @p mode.
+ *
+ * Called by the application on every mode change. Entering a mode that
+ * does not defer sends the lines kept in RAM.
+ *
+ * @param mode Power mode (PowerMode_t), below @ref LOG_MAX_MODES.
+ *
+ * @return None.
+ */
+void Log_SetMode(uint32_t mode);
+
+/**
+ * @brief Override the minimum level in power mode @p mode.
+ *
+ * @param mode  Power mode (PowerMode_t).
+ * @param level LogLevel_t, @ref LOG_MODE_LEVEL_OFF, or
+ *              @ref LOG_MODE_LEVEL_DEFAULT to follow Log_SetLevel().
+ *
+ * @return None.
+ */
+void Log_SetModeLevel(uint32_t mode, uint8_t level);
+
+/**
+ * @brief Level override of power mode @p mode.
+ *
+ * @return As set by Log_SetModeLevel(); @ref LOG_MODE_LEVEL_DEFAULT if none.
+ */
+uint8_t Log_GetModeLevel(uint32_t mode);
+
+/**
+ * @brief Raise the minimum level above the global and per-mode settings.
+ *
+ * Used by the load-shedding policy to drop DEBUG lines at the call site
+ * while output cannot keep up; the settings themselves are kept.
+ *
+ * @param level Lowest level let through; LOG_LEVEL_DEBUG for no floor.
+ *
+ * @return None.
+ */
+void Log_SetFloor(LogLevel_t level);
+
+/**
+ * @brief Level set by Log_SetFloor().
+ *
+ * @return The floor; LOG_LEVEL_DEBUG if none.
+ */
+LogLevel_t Log_GetFloor(void);
+
+/**
+ * @brief Hold DEBUG and INFO lines in RAM while in power mode @p mode.
+ *
+ * They are sent once a mode that does not defer is entered, or from
+ * Log_Service() when the buffer is three quarters full.
+ *
+ * @param mode  Power mode (PowerMode_t).
+ * @param defer true to defer (no effect if @ref LOG_DEFER_ENABLE is 0).
+ *
+ * @return None.
+ */
+void Log_SetModeDefer(uint32_t mode, bool defer);
+
+/**
+ * @brief Query whether power mode @p mode defers lines.
+ *
+ * @return true if set with Log_SetModeDefer().
+ */
+bool Log_GetModeDefer(uint32_t mode);
+
+/**
+ * @brief Cap the task log output.
+ *
+ * A token bucket of one second's worth: lines below ERROR that find it
+ * empty wait in the RAM buffer (dropped if it is full) and go out as the
+ * budget refills.
+ *
+ * @param bytesPerSecond Budget; 0 for no limit (the default).
+ *
+ * @return None.
+ */
+void Log_SetBudget(uint32_t bytesPerSecond);
+
+/**
+ * @brief Current byte budget.
+ *
+ * @return Bytes per second, 0 if unlimited.
+ */
+uint32_t Log_GetBudget(void);
+
+/**
+ * @brief Bytes of lines waiting in the RAM buffer.
+ *
+ * @return Bytes held, including two bytes of length per line.
+ */
+uint32_t Log_GetDeferredBytes(void);
+
+/**
+ * @brief Turn rate limiting and repeat collapsing on or off at run time.
+ *
+ * @param enable true to limit (the default), false to print every line.
+ *
+ * @return None.
+ */
+void Log_SetRateLimit(bool enable);
+
+/**
+ * @brief Query whether rate limiting is active.
+ *
+ * @return true if lines are limited; always false when
+ *         @ref LOG_RATE_LIMIT_ENABLE is 0.
+ */
+bool Log_IsRateLimited(void);
+
+/**
+ * @brief Get the number of lines collapsed or rate-limited.
+ *
+ * @return Held-back line count since startup.
+ */
+uint32_t Log_GetHeldCount(void);
+
 /**
  * @brief Hook called after each log line is printed.
  *
@@ -127,11 +473,89 @@ void Log_Print(LogLevel_t level,
  */
 void CLI_OnExternalOutput(void);
 
+/** @cond INTERNAL */
+#define LOG_STRINGIFY_(x)  #x
+#define LOG_STRINGIFY(x)   LOG_STRINGIFY_(x)
+/** @endcond */
+
+#if (LOG_BINARY_MODE != 0)
+
+/**
+ * @brief Emit a binary record with a per-call-site ID.
+ *
+ * The ID string lives in its own .rodata.log_fmt input section so the
+ * host decoder can find it by address in the ELF file. @p fmt must be a
+ * string literal.
+ */
+#define LOG_EMIT(level, fmt, ...)                                              \
+    do                                                                         \
+    {                                                                          \
+        static const char s_logId[] __attribute__((section(".rodata.log_fmt"))) = \
+            __FILE__ ":" LOG_STRINGIFY(__LINE__) ":" fmt;                      \
+        Log_PrintBinary((level), s_logId, ##__VA_ARGS__);                      \
+    } while (0)
+
+#else
+
+/** @brief Emit a formatted text line with automatic metadata. */
+#define LOG_EMIT(level, fmt, ...) \
+    Log_Print((level), __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+
+#endif /* LOG_BINARY_MODE */
+
+/**
+ * @brief Emit only if @p level passes the runtime threshold.
+ *
+ * Arguments are not evaluated when the message is filtered.
+ */
+#define LOG_EMIT_IF(level, fmt, ...)                                          \
+    do                                                                        \
+    {                                                                         \
+        if ((uint8_t)(level) >= g_logThreshold)                               \
+        {                                                                     \
+            LOG_EMIT((level), fmt, ##__VA_ARGS__);                            \
+        }                                                                     \
+    } while (0)
+
+/**
+ * @brief Compiled-out call site.
+ *
+ * Keeps the format and arguments type-checked (and variables "used") but
+ * generates no code.
+ */
+#define LOG_EMIT_NONE(level, fmt, ...)                                        \
+    do                                                                        \
+    {                                                                         \
+        if (0)                                                                \
+        {                                                                     \
+            Log_Print((level), __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+        }                                                                     \
+    } while (0)
+
 /* Convenience macros for logging with automatic metadata. */
-#define LOG_DEBUG(fmt, ...)  Log_Print(LOG_LEVEL_DEBUG, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define LOG_INFO(fmt, ...)   Log_Print(LOG_LEVEL_INFO,  __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define LOG_WARN(fmt, ...)   Log_Print(LOG_LEVEL_WARN,  __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
-#define LOG_ERROR(fmt, ...)  Log_Print(LOG_LEVEL_ERROR, __FILE__, __LINE__, __func__, fmt, ##__VA_ARGS__)
+#if (LOG_COMPILE_LEVEL <= 0)
+#define LOG_DEBUG(fmt, ...)  LOG_EMIT_IF(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(fmt, ...)  LOG_EMIT_NONE(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#endif
+
+#if (LOG_COMPILE_LEVEL <= 1)
+#define LOG_INFO(fmt, ...)   LOG_EMIT_IF(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOG_INFO(fmt, ...)   LOG_EMIT_NONE(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#endif
+
+#if (LOG_COMPILE_LEVEL <= 2)
+#define LOG_WARN(fmt, ...)   LOG_EMIT_IF(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOG_WARN(fmt, ...)   LOG_EMIT_NONE(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#endif
+
+#if (LOG_COMPILE_LEVEL <= 3)
+#define LOG_ERROR(fmt, ...)  LOG_EMIT_IF(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(fmt, ...)  LOG_EMIT_NONE(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#endif
 
 /** @} */ /* end of logging group */
 
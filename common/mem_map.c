@@ -0,0 +1,106 @@
+/**
+ * @file mem_map.c
+ * @brief RAM usage map and stack painting implementation.
+ *
+ * Section bounds are read from the linker script symbols. The heap end is
+ * obtained with _sbrk(0), so sysmem.c stays untouched. If the heap grows
+ * after painting, the scan starts at the new heap end so heap data is not
+ * mistaken for stack.
+ *
+ * @ingroup mem_map
+ */
+
+#include "mem_map.h"
+#include "stm32f4xx.h"
+#include <stddef.h>
+
+/* Linker script symbols (STM32F446RETX_FLASH.ld / _RAM.ld). */
+extern uint32_t _sramfunc;
+extern uint32_t _eramfunc;
+extern uint32_t _sdata;
+extern uint32_t _edata;
+extern uint32_t _sbss;
+extern uint32_t _ebss;
+extern uint32_t _end;
+extern uint32_t _estack;
+extern uint32_t _Min_Heap_Size;
+extern uint32_t _Min_Stack_Size;
+
+/* sysmem.c */
+extern void *_sbrk(ptrdiff_t incr);
+
+/**
+ * @brief Lowest painted word, or NULL before MemMap_PaintStack().
+ */
+static uint32_t *s_paintBottom = NULL;
+
+/**
+ * @brief Current heap end rounded up to a word.
+ */
+static uint32_t *MemMap_HeapEnd(void);
+
+/* ------------------------------------------------------------------------- */
+
+void MemMap_PaintStack(void)
+{
+    uint32_t *bottom = MemMap_HeapEnd();
+    uint32_t *top    = (uint32_t *)(uintptr_t)__get_MSP();
+
+    for (uint32_t *p = bottom; p < top; ++p)
+    {
+        *p = MEM_MAP_STACK_PAINT;
+    }
+
+    s_paintBottom = bottom;
+}
+
+void MemMap_GetUsage(MemMapUsage_t *usage)
+{
+    uintptr_t estack  = (uintptr_t)&_estack;
+    uintptr_t msp     = (uintptr_t)__get_MSP();
+    uint32_t *heapEnd = MemMap_HeapEnd();
+
+    usage->ramTotal      = (uint32_t)(estack - (uintptr_t)&_sramfunc);
+    usage->ramfuncBytes  = (uint32_t)((uintptr_t)&_eramfunc - (uintptr_t)&_sramfunc);
+    usage->dataBytes     = (uint32_t)((uintptr_t)&_edata - (uintptr_t)&_sdata);
+    usage->bssBytes      = (uint32_t)((uintptr_t)&_ebss - (uintptr_t)&_sbss);
+    usage->heapBytes     = (uint32_t)((uintptr_t)heapEnd - (uintptr_t)&_end);
+    usage->heapReserved  = (uint32_t)(uintptr_t)&_Min_Heap_Size;
+    usage->stackReserved = (uint32_t)(uintptr_t)&_Min_Stack_Size;
+    usage->stackCurrent  = (uint32_t)(estack - msp);
+    usage->painted       = (s_paintBottom != NULL);
+    usage->collided      = false;
+
+    if (!usage->painted)
+    {
+        usage->stackPeak = usage->stackCurrent;
+        usage->freeBytes = (uint32_t)(msp - (uintptr_t)heapEnd);
+        return;
+    }
+
+    uint32_t *p = (heapEnd > s_paintBottom) ? heapEnd : s_paintBottom;
+
+    if (*p != MEM_MAP_STACK_PAINT)
+    {
+        usage->collided = true;
+    }
+
+    while (((uintptr_t)p < msp) && (*p == MEM_MAP_STACK_PAINT))
+    {
+        ++p;
+    }
+
+    usage->stackPeak = (uint32_t)(estack - (uintptr_t)p);
+    usage->freeBytes = (uint32_t)((uintptr_t)p - (uintptr_t)heapEnd);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t *MemMap_HeapEnd(void)
+{
+    uintptr_t end = (uintptr_t)_sbrk(0);
+
+    return (uint32_t *)((end + 3U) & ~(uintptr_t)3U);
+}
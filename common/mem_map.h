@@ -0,0 +1,85 @@
+/**
+ * @file mem_map.h
+ * @brief RAM usage map and stack high-water mark.
+ *
+ * The RAM layout comes from the linker script:
+ *
+ *     .data | .bss | heap (_sbrk) ->   free   <- MSP stack | _estack
+ *
+ * MemMap_PaintStack() fills the free space between the heap end and the
+ * current stack pointer with a known pattern once, at start-up. Later the
+ * lowest overwritten word marks the deepest stack use so far, which
+ * MemMap_GetUsage() finds by scanning up from the heap end.
+ *
+ * @ingroup common
+ */
+
+#ifndef MEM_MAP_H
+#define MEM_MAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup mem_map Memory Map
+ * @brief Section sizes, heap use and stack painting.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Word written over unused stack by MemMap_PaintStack(). */
+#define MEM_MAP_STACK_PAINT   (0xC5C5C5C5UL)
+
+/**
+ * @brief RAM usage snapshot (all sizes in bytes).
+ */
+typedef struct
+{
+    uint32_t ramTotal;      /**< RAM region size (_estack - _sramfunc).       */
+    uint32_t ramfuncBytes;  /**< Code copied to SRAM (.ramfunc).              */
+    uint32_t dataBytes;     /**< Initialized data (.data).                    */
+    uint32_t bssBytes;      /**< Zero-initialized data (.bss).                */
+    uint32_t heapBytes;     /**< Heap handed out by _sbrk() so far.           */
+    uint32_t heapReserved;  /**< _Min_Heap_Size from the linker script.       */
+    uint32_t stackReserved; /**< _Min_Stack_Size from the linker script.      */
+    uint32_t stackCurrent;  /**< Stack in use now (_estack - MSP).            */
+    uint32_t stackPeak;     /**< Deepest stack use seen since painting.       */
+    uint32_t freeBytes;     /**< Never-touched RAM between heap and stack.    */
+    bool     painted;       /**< MemMap_PaintStack() has run.                 */
+    bool     collided;      /**< The stack reached the heap end.              */
+} MemMapUsage_t;
+
+/**
+ * @brief Paint the unused stack area.
+ *
+ * Call once, as early as possible in main() and before interrupts are
+ * enabled. Everything below the caller's stack frame down to the heap end
+ * is overwritten.
+ *
+ * @return None.
+ */
+void MemMap_PaintStack(void);
+
+/**
+ * @brief Build a RAM usage snapshot.
+ *
+ * Scans the painted area for the stack high-water mark, which takes in
+ * the order of 100 us per 10 KB of free RAM. Call from thread mode.
+ *
+ * @param[out] usage Receives the snapshot.
+ *
+ * @return None.
+ */
+void MemMap_GetUsage(MemMapUsage_t *usage);
+
+/** @} */ /* end of mem_map group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_MAP_H */
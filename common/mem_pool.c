@@ -0,0 +1,323 @@
+/**
+ * @file mem_pool.c
+ * @brief Fixed-block memory pool implementation.
+ *
+ * Each class owns a static, 8-byte aligned storage array. Free blocks are
+ * chained through their first word. A block's class is found from its
+ * address (one range check per class), so MemPool_Free() needs no header
+ * in front of the block and every byte of a block is usable.
+ *
+ * @ingroup mem_pool
+ */
+
+#include "mem_pool.h"
+#include "stm32_lock.h"
+#include <string.h>
+
+#if (MEM_POOL_NEWLIB_HOOKS != 0)
+#include <errno.h>
+#include <reent.h>
+#endif
+
+/**
+ * @brief Runtime state of one size class.
+ */
+typedef struct
+{
+    uint8_t       *storage;  /**< First block.                */
+    void          *freeList; /**< First free block (or NULL). */
+    MemPoolStats_t stats;    /**< Counters and geometry.      */
+} MemPool_t;
+
+/** @brief Storage array of one class. */
+#define MEM_POOL_STORAGE(name, size, count)                                   \
+    static uint8_t s_storage##name[(size) * (count)] __attribute__((aligned(8)));
+MEM_POOL_CLASSES(MEM_POOL_STORAGE)
+#undef MEM_POOL_STORAGE
+
+/** @brief Initializer of one class. */
+#define MEM_POOL_ENTRY(cls, size, count)                                      \
+    { .storage = s_storage##cls, .freeList = NULL,                            \
+      .stats = { .name = #cls, .blockSize = (size), .blocks = (count) } },
+
+/**
+ * @brief All size classes, smallest first.
+ */
+static MemPool_t s_pools[MEM_POOL_CLASS_COUNT] =
+{
+    MEM_POOL_CLASSES(MEM_POOL_ENTRY)
+};
+#undef MEM_POOL_ENTRY
+
+/** @brief Compile-time check that every block size keeps 8-byte alignment. */
+#define MEM_POOL_CHECK_ALIGN(name, size, count)                               \
+    _Static_assert(((size) % 8U) == 0U, "MEM_POOL " #name " size must be a multiple of 8");
+MEM_POOL_CLASSES(MEM_POOL_CHECK_ALIGN)
+#undef MEM_POOL_CHECK_ALIGN
+
+/**
+ * @brief Lock shared by all pools (stm32_lock.h strategy).
+ */
+static LockingData_t s_lock = LOCKING_DATA_INIT;
+
+/**
+ * @brief Whether the free lists have been built.
+ */
+static bool s_initialized = false;
+
+/**
+ * @brief Build every free list. Called with the lock held.
+ */
+static void MemPool_InitLocked(void);
+
+/**
+ * @brief Class owning @p ptr, or NULL.
+ */
+static MemPool_t *MemPool_Owner(const void *ptr);
+
+/* ------------------------------------------------------------------------- */
+
+void *MemPool_Alloc(size_t size)
+{
+    void *block = NULL;
+
+    if (size == 0U)
+    {
+        size = 1U;
+    }
+
+    stm32_lock_acquire(&s_lock);
+
+    if (!s_initialized)
+    {
+        MemPool_InitLocked();
+    }
+
+    MemPool_t *bestFit = NULL;
+
+    for (uint32_t i = 0U; i < MEM_POOL_CLASS_COUNT; ++i)
+    {
+        MemPool_t *pool = &s_pools[i];
+        if (pool->stats.blockSize < size)
+        {
+            continue;
+        }
+
+        if (bestFit == NULL)
+        {
+            bestFit = pool;
+        }
+
+        if (pool->freeList != NULL)
+        {
+            block          = pool->freeList;
+            pool->freeList = *(void **)block;
+
+            pool->stats.allocs++;
+            pool->stats.inUse++;
+            if (pool->stats.inUse > pool->stats.highWater)
+            {
+                pool->stats.highWater = pool->stats.inUse;
+            }
+
+            if (pool != bestFit)
+            {
+                bestFit->stats.spills++;
+            }
+            break;
+        }
+    }
+
+    if ((block == NULL) && (bestFit != NULL))
+    {
+        bestFit->stats.failures++;
+    }
+
+    stm32_lock_release(&s_lock);
+
+    return block;
+}
+
+void MemPool_Free(void *ptr)
+{
+    MemPool_t *pool = MemPool_Owner(ptr);
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    stm32_lock_acquire(&s_lock);
+    *(void **)ptr  = pool->freeList;
+    pool->freeList = ptr;
+    pool->stats.inUse--;
+    stm32_lock_release(&s_lock);
+}
+
+size_t MemPool_GetBlockSize(const void *ptr)
+{
+    const MemPool_t *pool = MemPool_Owner(ptr);
+
+    return (pool != NULL) ? pool->stats.blockSize : 0U;
+}
+
+bool MemPool_GetStats(MemPoolClass_t cls, MemPoolStats_t *stats)
+{
+    if ((cls >= MEM_POOL_CLASS_COUNT) || (stats == NULL))
+    {
+        return false;
+    }
+
+    stm32_lock_acquire(&s_lock);
+    *stats = s_pools[cls].stats;
+    stm32_lock_release(&s_lock);
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* newlib allocator hooks                                                    */
+/* ------------------------------------------------------------------------- */
+
+#if (MEM_POOL_NEWLIB_HOOKS != 0)
+
+/**
+ * @brief newlib malloc(): served from the pools.
+ */
+void *_malloc_r(struct _reent *reent, size_t size)
+{
+    void *ptr = MemPool_Alloc(size);
+    if (ptr == NULL)
+    {
+        reent->_errno = ENOMEM;
+    }
+    return ptr;
+}
+
+/**
+ * @brief newlib free().
+ */
+void _free_r(struct _reent *reent, void *ptr)
+{
+    (void)reent;
+    MemPool_Free(ptr);
+}
+
+/**
+ * @brief newlib calloc().
+ */
+void *_calloc_r(struct _reent *reent, size_t count, size_t size)
+{
+    if ((size != 0U) && (count > (SIZE_MAX / size)))
+    {
+        reent->_errno = ENOMEM;
+        return NULL;
+    }
+
+    void *ptr = _malloc_r(reent, count * size);
+    if (ptr != NULL)
+    {
+        (void)memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+/**
+ * @brief newlib realloc(): in place while the block is large enough.
+ */
+void *_realloc_r(struct _reent *reent, void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return _malloc_r(reent, size);
+    }
+
+    if (size == 0U)
+    {
+        MemPool_Free(ptr);
+        return NULL;
+    }
+
+    size_t current = MemPool_GetBlockSize(ptr);
+    if (size <= current)
+    {
+        return ptr;
+    }
+
+    void *grown = _malloc_r(reent, size);
+    if (grown != NULL)
+    {
+        (void)memcpy(grown, ptr, current);
+        MemPool_Free(ptr);
+    }
+    return grown;
+}
+
+/**
+ * @brief newlib memalign(): only malloc() alignment (8) is available.
+ */
+void *_memalign_r(struct _reent *reent, size_t align, size_t size)
+{
+    if (align > 8U)
+    {
+        reent->_errno = ENOMEM;
+        return NULL;
+    }
+    return _malloc_r(reent, size);
+}
+
+/**
+ * @brief newlib malloc_usable_size().
+ */
+size_t _malloc_usable_size_r(struct _reent *reent, void *ptr)
+{
+    (void)reent;
+    return MemPool_GetBlockSize(ptr);
+}
+
+#endif /* MEM_POOL_NEWLIB_HOOKS */
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void MemPool_InitLocked(void)
+{
+    for (uint32_t i = 0U; i < MEM_POOL_CLASS_COUNT; ++i)
+    {
+        MemPool_t *pool = &s_pools[i];
+
+        pool->freeList = NULL;
+        for (uint32_t b = pool->stats.blocks; b > 0U; --b)
+        {
+            void *block = &pool->storage[(b - 1U) * pool->stats.blockSize];
+
+            *(void **)block = pool->freeList;
+            pool->freeList  = block;
+        }
+    }
+
+    s_initialized = true;
+}
+
+static MemPool_t *MemPool_Owner(const void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return NULL;
+    }
+
+    for (uint32_t i = 0U; i < MEM_POOL_CLASS_COUNT; ++i)
+    {
+        MemPool_t     *pool   = &s_pools[i];
+        const uint8_t *p      = (const uint8_t *)ptr;
+        size_t         length = (size_t)pool->stats.blockSize * pool->stats.blocks;
+
+        if ((p >= pool->storage) && (p < (pool->storage + length)))
+        {
+            size_t offset = (size_t)(p - pool->storage);
+            return ((offset % pool->stats.blockSize) == 0U) ? pool : NULL;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file mem_pool.h
+ * @brief Fixed-block memory pools.
+ *
+ * A small set of size classes, each a static array of equal blocks kept
+ * on a free list, so allocation and release are O(1) and cannot
+ * fragment. The classes are sized for the firmware's own buffers (log
+ * records, sample batches, telemetry frames) and for the occasional
+ * newlib allocation (float formatting, stdio buffers).
+ *
+ * When @ref MEM_POOL_NEWLIB_HOOKS is enabled the newlib reentrant
+ * allocator entry points (_malloc_r() and friends) are served from the
+ * pools, so malloc()/free() never touch the _sbrk() heap. Pool access is
+ * serialized with the stm32_lock.h strategy used by newlib_lock_glue.c
+ * (STM32_THREAD_SAFE_STRATEGY), which with the default strategy 2 makes
+ * the pools usable from interrupts. With strategy 6 (BASEPRI) only
+ * interrupts at or below STM32_LOCK_BASEPRI_PRIORITY may use them.
+ *
+ * @ingroup common
+ */
+
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @defgroup mem_pool Memory Pools
+ * @brief O(1) fixed-block allocation with per-pool statistics.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Size classes: X(name, block size in bytes, block count).
+ *
+ * Ordered by block size; each size must be a multiple of 8 so every block
+ * meets malloc() alignment.
+ * - SMALL:  newlib internals (dtoa bigints, small objects)
+ * - RECORD: one formatted log record or CLI line
+ * - BATCH:  a sample block or a flash log page
+ * - FRAME:  an encoded telemetry frame
+ * - LARGE:  stdio buffers (BUFSIZ)
+ */
+#define MEM_POOL_CLASSES(X)       \
+    X(SMALL,    32U, 32U)          \
+    X(RECORD,  128U, 16U)          \
+    X(BATCH,   256U,  8U)          \
+    X(FRAME,   512U,  4U)          \
+    X(LARGE,  1024U,  2U)
+
+/** @brief Size class identifiers. */
+typedef enum
+{
+#define MEM_POOL_CLASS_ENUM(name, size, count)   MEM_POOL_##name,
+    MEM_POOL_CLASSES(MEM_POOL_CLASS_ENUM)
+#undef MEM_POOL_CLASS_ENUM
+    MEM_POOL_CLASS_COUNT /**< Number of size classes. */
+} MemPoolClass_t;
+
+/**
+ * @brief Serve newlib malloc()/free() from the pools (1) or leave the
+ *        _sbrk() heap allocator in place (0).
+ */
+#ifndef MEM_POOL_NEWLIB_HOOKS
+#define MEM_POOL_NEWLIB_HOOKS   (1)
+#endif
+
+/**
+ * @brief Usage of one size class.
+ */
+typedef struct
+{
+    const char *name;      /**< Class name.                                   */
+    uint32_t    blockSize; /**< Bytes per block.                              */
+    uint32_t    blocks;    /**< Blocks in the class.                          */
+    uint32_t    inUse;     /**< Blocks currently allocated.                   */
+    uint32_t    highWater; /**< Largest inUse seen.                           */
+    uint32_t    allocs;    /**< Successful allocations from this class.       */
+    uint32_t    spills;    /**< Best-fit requests served by a larger class.   */
+    uint32_t    failures;  /**< Best-fit requests that found no block at all. */
+} MemPoolStats_t;
+
+/**
+ * @brief Allocate a block of at least @p size bytes.
+ *
+ * Uses the smallest class that fits, or the next larger class with a
+ * free block. The pools initialize themselves on first use, so this may
+ * be called before main() (e.g. by newlib).
+ *
+ * @param size Requested size in bytes.
+ *
+ * @return 8-byte aligned block, or NULL if no class can serve @p size.
+ */
+void *MemPool_Alloc(size_t size);
+
+/**
+ * @brief Return a block to its pool.
+ *
+ * @param ptr Block from MemPool_Alloc(), or NULL (ignored). Pointers that
+ *            do not belong to a pool are ignored.
+ *
+ * @return None.
+ */
+void MemPool_Free(void *ptr);
+
+/**
+ * @brief Usable size of an allocated block.
+ *
+ * @param ptr Block from MemPool_Alloc().
+ *
+ * @return Block size in bytes, or 0 if @p ptr is not a pool block.
+ */
+size_t MemPool_GetBlockSize(const void *ptr);
+
+/**
+ * @brief Snapshot the usage of a size class.
+ *
+ * @param cls        Size class.
+ * @param[out] stats Receives the usage.
+ *
+ * @return false if @p cls is out of range.
+ */
+bool MemPool_GetStats(MemPoolClass_t cls, MemPoolStats_t *stats);
+
+/** @} */ /* end of mem_pool group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_POOL_H */
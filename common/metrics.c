@@ -0,0 +1,218 @@
+/**
+ * @file metrics.c
+ * @brief Metrics registry: published sources, snapshot and telemetry.
+ *
+ * Slots are resolved in a fixed order: a gauge function if one was
+ * published, else the published counter, else the value stored with
+ * Metrics_Set(). Publishing only writes one pointer, so a slot may be
+ * published while another context takes a snapshot.
+ *
+ * @ingroup metrics
+ */
+
+#include "metrics.h"
+#include "telemetry.h"
+#include <stddef.h>
+#include <string.h>
+
+/** @brief Size of one series record (series:u8 id:u8 value:u32). */
+#define METRICS_SERIES_RECORD_SIZE   (6U)
+
+_Static_assert(((uint32_t)METRIC_COUNT * 4U) <= TELEMETRY_MAX_PAYLOAD,
+               "metrics record does not fit one telemetry frame");
+
+/** @brief Published counters (NULL: none). */
+static const volatile uint32_t *volatile s_source[METRIC_COUNT];
+
+/** @brief Published gauges (NULL: none). */
+static volatile MetricsGaugeFn_t s_gauge[METRIC_COUNT];
+
+/** @brief Values stored with Metrics_Set(). */
+static volatile uint32_t s_value[METRIC_COUNT];
+
+/** @brief Names, indexed by MetricId_t. */
+static const char *const s_names[METRIC_COUNT] =
+{
+#define METRICS_NAME(id, name)   [METRIC_##id] = #name,
+    METRICS_LIST(METRICS_NAME)
+#undef METRICS_NAME
+};
+
+/** @brief Records of the export frame being filled. */
+static uint8_t s_payload[TELEMETRY_MAX_PAYLOAD];
+
+/** @brief Bytes used in @ref s_payload. */
+static size_t s_payloadLen = 0U;
+
+/** @brief Records in @ref s_payload. */
+static uint32_t s_payloadCount = 0U;
+
+/** @brief Frame type of @ref s_payload (0: empty). */
+static uint8_t s_payloadType = 0U;
+
+/** @brief Base time of the export in progress. */
+static uint32_t s_export_ms = 0U;
+
+/**
+ * @brief Read one slot; @p id must be valid.
+ */
+static uint32_t Metrics_Read(uint32_t id);
+
+/**
+ * @brief Make room for a @p len byte record of frame @p type, sending the
+ *        buffered frame if it has another type or is full.
+ */
+static uint8_t *Metrics_Reserve(uint8_t type, size_t len);
+
+/**
+ * @brief Send the buffered export frame, if any; it is dropped if the TX
+ *        ring is full (counted by the telemetry statistics).
+ */
+static void Metrics_FlushFrame(void);
+
+/* ------------------------------------------------------------------------- */
+
+void Metrics_Publish(MetricId_t id, const volatile uint32_t *source)
+{
+    if ((uint32_t)id < (uint32_t)METRIC_COUNT)
+    {
+        s_source[id] = source;
+    }
+}
+
+void Metrics_PublishGauge(MetricId_t id, MetricsGaugeFn_t gauge)
+{
+    if ((uint32_t)id < (uint32_t)METRIC_COUNT)
+    {
+        s_gauge[id] = gauge;
+    }
+}
+
+void Metrics_Set(MetricId_t id, uint32_t value)
+{
+    if ((uint32_t)id < (uint32_t)METRIC_COUNT)
+    {
+        s_value[id] = value;
+    }
+}
+
+uint32_t Metrics_Get(MetricId_t id)
+{
+    return ((uint32_t)id < (uint32_t)METRIC_COUNT) ? Metrics_Read((uint32_t)id) : 0U;
+}
+
+void Metrics_Snapshot(uint32_t values[METRIC_COUNT])
+{
+    if (values == NULL)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0U; i < (uint32_t)METRIC_COUNT; ++i)
+    {
+        values[i] = Metrics_Read(i);
+    }
+}
+
+const char *Metrics_GetName(MetricId_t id)
+{
+    return ((uint32_t)id < (uint32_t)METRIC_COUNT) ? s_names[id] : "?";
+}
+
+bool Metrics_BeginExport(uint32_t now_ms)
+{
+    static uint32_t s_values[METRIC_COUNT];
+    static uint8_t  s_record[METRIC_COUNT * sizeof(uint32_t)];
+
+    s_payloadLen   = 0U;
+    s_payloadCount = 0U;
+    s_payloadType  = 0U;
+    s_export_ms    = now_ms;
+
+    Metrics_Snapshot(s_values);
+
+    for (uint32_t i = 0U; i < (uint32_t)METRIC_COUNT; ++i)
+    {
+        for (uint32_t b = 0U; b < 4U; ++b)
+        {
+            s_record[(4U * i) + b] = (uint8_t)(s_values[i] >> (8U * b));
+        }
+    }
+
+    return Telemetry_SendFrame(METRICS_FRAME_TYPE, METRIC_COUNT, now_ms,
+                               s_record, sizeof(s_record));
+}
+
+void Metrics_AddLabel(MetricsLabel_t kind, uint8_t id, const char *name)
+{
+    const char *text  = (name != NULL) ? name : "";
+    size_t      chars = strnlen(text, METRICS_LABEL_CHARS);
+    uint8_t    *dst   = Metrics_Reserve(METRICS_LABEL_FRAME_TYPE, 3U + chars);
+
+    dst[0] = (uint8_t)kind;
+    dst[1] = id;
+    dst[2] = (uint8_t)chars;
+    memcpy(&dst[3], text, chars);
+}
+
+void Metrics_AddSeries(MetricsSeries_t series, uint8_t id, uint32_t value)
+{
+    uint8_t *dst = Metrics_Reserve(METRICS_SERIES_FRAME_TYPE, METRICS_SERIES_RECORD_SIZE);
+
+    dst[0] = (uint8_t)series;
+    dst[1] = id;
+    for (uint32_t b = 0U; b < 4U; ++b)
+    {
+        dst[2U + b] = (uint8_t)(value >> (8U * b));
+    }
+}
+
+void Metrics_EndExport(void)
+{
+    Metrics_FlushFrame();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t Metrics_Read(uint32_t id)
+{
+    MetricsGaugeFn_t         gauge  = s_gauge[id];
+    const volatile uint32_t *source = s_source[id];
+
+    if (gauge != NULL)
+    {
+        return gauge();
+    }
+
+    return (source != NULL) ? *source : s_value[id];
+}
+
+static uint8_t *Metrics_Reserve(uint8_t type, size_t len)
+{
+    if ((s_payloadType != type) || ((s_payloadLen + len) > sizeof(s_payload)))
+    {
+        Metrics_FlushFrame();
+        s_payloadType = type;
+    }
+
+    uint8_t *dst = &s_payload[s_payloadLen];
+
+    s_payloadLen += len;
+    s_payloadCount++;
+    return dst;
+}
+
+static void Metrics_FlushFrame(void)
+{
+    if (s_payloadCount > 0U)
+    {
+        (void)Telemetry_SendFrame(s_payloadType, s_payloadCount, s_export_ms,
+                                  s_payload, s_payloadLen);
+    }
+
+    s_payloadLen   = 0U;
+    s_payloadCount = 0U;
+    s_payloadType  = 0U;
+}
@@ -0,0 +1,324 @@
+/**
+ * @file metrics.h
+ * @brief Central registry of system counters.
+ *
+ * Every module keeps its counters where they are updated and publishes
+ * them here once, at initialization: a slot either points at the
+ * module's own 32-bit counter, calls a gauge function for a value that
+ * is derived on demand (time since the last activity), or holds a value
+ * the module stores with Metrics_Set() when it changes (the sample
+ * period of the current power mode). Readers take a snapshot of all
+ * slots in one pass; each slot is a single aligned 32-bit load, so no
+ * lock is taken and no writer is held up.
+ *
+ * The `status` command and the periodic metrics telemetry frame are both
+ * rendered from the snapshot, so adding a metric costs one entry in
+ * @ref METRICS_LIST and one publish call.
+ *
+ * A telemetry export is the snapshot frame followed by labelled series
+ * for things that come in variable numbers (tasks, sensors, power
+ * modes): the exporter names each label once per export with
+ * Metrics_AddLabel() and adds one value per series and label with
+ * Metrics_AddSeries(); records are packed into as many frames as needed.
+ *
+ * @ingroup common
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup metrics Metrics Registry
+ * @brief Published counters, rendered by `status` and telemetry.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Telemetry frame type of the metrics record.
+ *
+ * The frame has one record of METRIC_COUNT little-endian u32 values in
+ * @ref MetricId_t order; the frame count field is the number of values.
+ */
+#define METRICS_FRAME_TYPE    (0x07U)
+
+/**
+ * @brief Telemetry frame type of labelled series values.
+ *
+ * Records are `series:u8 id:u8 value:u32`; @c id refers to a label of the
+ * kind the series is reported for (see @ref METRICS_SERIES_LIST).
+ */
+#define METRICS_SERIES_FRAME_TYPE   (0x08U)
+
+/**
+ * @brief Telemetry frame type of label names.
+ *
+ * Records are `kind:u8 id:u8 len:u8 char*len`, as in the trace names
+ * frame; @c kind is a @ref MetricsLabel_t.
+ */
+#define METRICS_LABEL_FRAME_TYPE    (0x09U)
+
+/** @brief Longest label name sent; longer names are cut. */
+#define METRICS_LABEL_CHARS         (16U)
+
+/** @brief Set in task label ids of event tasks. */
+#define METRICS_EVENT_TASK_ID       (0x80U)
+
+/**
+ * @brief Metrics: X(id, name).
+ *
+ * @c name is the key used by the telemetry decoder. Append new metrics at
+ * the end so decoders of older frames keep their indices.
+ */
+#define METRICS_LIST(X)                         \
+    X(UPTIME_MS,          uptime_ms)            \
+    X(CLOCK_HZ,           clock_hz)             \
+    X(SAMPLE_PERIOD_MS,   sample_period_ms)     \
+    X(LOG_DROPPED,        log_dropped)          \
+    X(LOG_HELD,           log_held)             \
+    X(UART_DROP_CLI,      uart_drop_cli)        \
+    X(UART_DROP_TELEM,    uart_drop_telemetry)  \
+    X(UART_DROP_LOG,      uart_drop_log)        \
+    X(USB_TX_BYTES,       usb_tx_bytes)         \
+    X(USB_RX_BYTES,       usb_rx_bytes)         \
+    X(USB_TX_TO_UART,     usb_tx_to_uart)       \
+    X(RING_COUNT,         ring_count)           \
+    X(RING_CAPACITY,      ring_capacity)        \
+    X(RING_HIGH_WATER,    ring_high_water)      \
+    X(RING_PUSHED,        ring_pushed)          \
+    X(RING_OVERRUNS,      ring_overruns)        \
+    X(TELEM_FRAMES,       telem_frames)         \
+    X(TELEM_RECORDS,      telem_records)        \
+    X(TELEM_BYTES,        telem_bytes)          \
+    X(TELEM_DROPPED,      telem_dropped)        \
+    X(IDLE_ENTRIES,       idle_entries)         \
+    X(TICKLESS_ENTRIES,   tickless_entries)     \
+    X(EARLY_WAKEUPS,      early_wakeups)        \
+    X(SLEEP_MS,           sleep_ms)             \
+    X(STOP_ENTRIES,       stop_entries)         \
+    X(STOP_MS,            stop_ms)              \
+    X(WAKE_SOURCE,        wake_source)          \
+    X(WAKE_LATENCY_US,    wake_latency_us)      \
+    X(WAKE_LATENCY_MAX_US, wake_latency_max_us) \
+    X(UART_WAKES,         uart_wakes)           \
+    X(WAKE_DROPS,         wake_drops)           \
+    X(CONSOLE_HOLD_MS,    console_hold_ms)      \
+    X(INACTIVE_MS,        inactive_ms)          \
+    X(AUTO_STEP_DOWNS,    auto_step_downs)      \
+    X(AUTO_WAKEUPS,       auto_wakeups)         \
+    X(WDG_TIMEOUT_MS,     watchdog_timeout_ms)  \
+    X(WDG_WITHHELD,       watchdog_withheld)    \
+    X(BOOT_FIRST_SAMPLE_US, boot_first_sample_us) \
+    X(BOOT_READY_US,      boot_ready_us)        \
+    X(BOOT_RESUME,        boot_resume)          \
+    X(STANDBY_WAKEUPS,    standby_wakeups)      \
+    X(STANDBY_REPLAYED,   standby_replayed)     \
+    X(WORK_POSTED,        work_posted)          \
+    X(WORK_DROPPED,       work_dropped)         \
+    X(WORK_DEPTH_MAX,     work_depth_max)       \
+    X(WORK_LATENCY_MAX_US, work_latency_max_us) \
+    X(SENSOR_RETRIES,     sensor_retries)       \
+    X(SENSOR_QUARANTINES, sensor_quarantines)   \
+    X(SENSORS_QUARANTINED, sensors_quarantined) \
+    X(LOG_DEFERRED,       log_deferred)         \
+    X(LOG_DEFER_BYTES,    log_defer_bytes)      \
+    X(LOG_OVER_BUDGET,    log_over_budget)      \
+    X(CPU_LOAD,           cpu_load_permille)    \
+    X(CPU_LOAD_AVG,       cpu_load_avg_permille) \
+    X(CPU_LOAD_PEAK,      cpu_load_peak_permille) \
+    X(POWER_TRANSITIONS,  power_transitions)    \
+    X(POWER_TRANSITION_MAX_US, power_transition_max_us) \
+    X(STOP_OVERHEAD_US,   stop_overhead_us)     \
+    X(STOP_BREAK_EVEN_MS, stop_break_even_ms)   \
+    X(STOP_SKIPPED,       stop_skipped)         \
+    X(STOP_MAIN_ENTRIES,  stop_main_entries)    \
+    X(STOP_MAIN_BREAK_EVEN_MS, stop_main_break_even_ms) \
+    X(SPECTRUM_WINDOWS,   spectrum_windows)     \
+    X(SPECTRUM_MAX_US,    spectrum_max_us)      \
+    X(SHED_LEVEL,         shed_level)           \
+    X(SHED_PRESSURE_PCT,  shed_pressure_pct)    \
+    X(SHED_ESCALATIONS,   shed_escalations)     \
+    X(SHED_DECIMATED,     shed_decimated)       \
+    X(SHED_AGGREGATED,    shed_aggregated)      \
+    X(SELFTEST_RESULT,    selftest_result)
+
+/**
+ * @brief Labelled series: X(id, name, label kind).
+ *
+ * Task ids are the index in the task list, with
+ * @ref METRICS_EVENT_TASK_ID set for event tasks; sensor ids are the sensor IDs; mode ids are PowerMode_t and
+ * state ids PowerEnergyState_t. Append new series at the end.
+ */
+#define METRICS_SERIES_LIST(X)                                    \
+    X(TASK_RUNS,            task_runs,              TASK)         \
+    X(TASK_MAX_RUN_US,      task_max_run_us,        TASK)         \
+    X(TASK_MAX_LATE_US,     task_max_late_us,       TASK)         \
+    X(TASK_OVERRUNS,        task_overruns,          TASK)         \
+    X(TASK_BUDGET_OVERRUNS, task_budget_overruns,   TASK)         \
+    X(SENSOR_READS,         sensor_reads,           SENSOR)       \
+    X(SENSOR_ERRORS,        sensor_errors,          SENSOR)       \
+    X(MODE_TIME_MS,         power_mode_time_ms,     MODE)         \
+    X(MODE_CHARGE_UAH,      power_mode_charge_uah,  MODE)         \
+    X(STATE_TIME_MS,        power_state_time_ms,    STATE)        \
+    X(SENSOR_HEALTH,        sensor_health,          SENSOR)       \
+    X(SENSOR_RECOVERIES,    sensor_recoveries,      SENSOR)       \
+    X(TASK_LOAD,            task_load_permille,     TASK)
+
+/**
+ * @brief Kinds of label.
+ */
+typedef enum
+{
+    METRICS_LABEL_TASK = 0U, /**< Scheduler task (named).       */
+    METRICS_LABEL_SENSOR,    /**< Registered sensor (named).    */
+    METRICS_LABEL_MODE,      /**< Power mode (fixed names).     */
+    METRICS_LABEL_STATE      /**< Core state (fixed names).     */
+} MetricsLabel_t;
+
+/**
+ * @brief Series identifiers.
+ */
+typedef enum
+{
+#define METRICS_SERIES_ENUM(id, name, kind)   METRICS_SERIES_##id,
+    METRICS_SERIES_LIST(METRICS_SERIES_ENUM)
+#undef METRICS_SERIES_ENUM
+    METRICS_SERIES_COUNT
+} MetricsSeries_t;
+
+/**
+ * @brief Metric identifiers.
+ */
+typedef enum
+{
+#define METRICS_ENUM(id, name)   METRIC_##id,
+    METRICS_LIST(METRICS_ENUM)
+#undef METRICS_ENUM
+    METRIC_COUNT
+} MetricId_t;
+
+/**
+ * @brief Gauge: computes a metric when a snapshot is taken.
+ *
+ * Called from the reader's context; must be short and must not block.
+ */
+typedef uint32_t (*MetricsGaugeFn_t)(void);
+
+/**
+ * @brief Point a slot at a counter owned by the publishing module.
+ *
+ * The counter must be a naturally aligned uint32_t that outlives the
+ * registry (a static); it is read as is on every snapshot.
+ *
+ * @param id     Metric.
+ * @param source Counter.
+ *
+ * @return None.
+ */
+void Metrics_Publish(MetricId_t id, const volatile uint32_t *source);
+
+/**
+ * @brief Compute a slot with a gauge function on every snapshot.
+ *
+ * @param id    Metric.
+ * @param gauge Function returning the value.
+ *
+ * @return None.
+ */
+void Metrics_PublishGauge(MetricId_t id, MetricsGaugeFn_t gauge);
+
+/**
+ * @brief Store the value of a slot that has no published source.
+ *
+ * A single 32-bit store; safe from any context.
+ *
+ * @param id    Metric.
+ * @param value New value.
+ *
+ * @return None.
+ */
+void Metrics_Set(MetricId_t id, uint32_t value);
+
+/**
+ * @brief Read one metric.
+ *
+ * @param id Metric.
+ *
+ * @return Current value, or 0 for an invalid @p id.
+ */
+uint32_t Metrics_Get(MetricId_t id);
+
+/**
+ * @brief Read every metric in one pass.
+ *
+ * @param values Array of @ref METRIC_COUNT values, indexed by MetricId_t.
+ *
+ * @return None.
+ */
+void Metrics_Snapshot(uint32_t values[METRIC_COUNT]);
+
+/**
+ * @brief Name of a metric (the @ref METRICS_LIST key).
+ *
+ * @param id Metric.
+ *
+ * @return Name, or "?".
+ */
+const char *Metrics_GetName(MetricId_t id);
+
+/**
+ * @brief Start a telemetry export: send the snapshot as one
+ *        @ref METRICS_FRAME_TYPE frame.
+ *
+ * Labels and series added until Metrics_EndExport() carry @p now_ms as
+ * their frame base time.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return false if the frame was dropped (TX ring full).
+ */
+bool Metrics_BeginExport(uint32_t now_ms);
+
+/**
+ * @brief Add the name of a label to the export.
+ *
+ * @param kind Label kind.
+ * @param id   Label id.
+ * @param name Name; cut to @ref METRICS_LABEL_CHARS.
+ *
+ * @return None.
+ */
+void Metrics_AddLabel(MetricsLabel_t kind, uint8_t id, const char *name);
+
+/**
+ * @brief Add one series value to the export.
+ *
+ * @param series Series.
+ * @param id     Label id.
+ * @param value  Value.
+ *
+ * @return None.
+ */
+void Metrics_AddSeries(MetricsSeries_t series, uint8_t id, uint32_t value);
+
+/**
+ * @brief Send the records still buffered by the export.
+ *
+ * @return None.
+ */
+void Metrics_EndExport(void);
+
+/** @} */ /* end of metrics group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_H */
@@ -0,0 +1,68 @@
+/**
+ * @file ramfunc.h
+ * @brief Attribute for functions executed from SRAM.
+ *
+ * At 180 MHz the flash needs 5 wait states. The ART accelerator hides
+ * most of them for straight-line code, but branchy code such as the
+ * scheduler pass and short, frequent ISRs still miss its cache. Functions
+ * marked @ref RAMFUNC are linked into the `.ramfunc` section, which
+ * startup_stm32f446retx.s copies from flash to SRAM before main(), and
+ * run there with no wait states.
+ *
+ * SRAM code is out of Thumb branch range of flash (and the other way
+ * round), so RAMFUNC also makes calls to the function long calls; calls
+ * from it into flash go through linker veneers. Keep RAMFUNC functions
+ * small and self-contained.
+ *
+ * Build with -DRAMFUNC_ENABLE=0 to keep everything in flash, e.g. to
+ * compare both placements with the benchmark suite (app_bench.h).
+ *
+ * @ingroup common
+ */
+
+#ifndef RAMFUNC_H
+#define RAMFUNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup ramfunc SRAM Code Placement
+ * @brief Place hot functions in the `.ramfunc` section.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Set to 0 to link RAMFUNC functions into flash like any other.
+ *
+ * Defaults to 1 on ARM targets and to 0 elsewhere (host simulation).
+ */
+#ifndef RAMFUNC_ENABLE
+#if defined(__arm__)
+#define RAMFUNC_ENABLE      (1)
+#else
+#define RAMFUNC_ENABLE      (0)
+#endif
+#endif
+
+/**
+ * @brief Function attribute: run this function from SRAM.
+ *
+ * `noinline` keeps the body in `.ramfunc`; inlined copies would run from
+ * the caller's section instead.
+ */
+#if (RAMFUNC_ENABLE != 0)
+#define RAMFUNC             __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define RAMFUNC
+#endif
+
+/** @} */ /* end of ramfunc group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RAMFUNC_H */
@@ -0,0 +1,1770 @@
+/**
+ * @file sample_archive.c
+ * @brief Sample archive implementation.
+ *
+ * The coroutine runs one operation at a time: SampleArchive_NextOp()
+ * picks it and builds the SPI frame, the coroutine runs the frame and, for
+ * a program or an erase, polls the status register until the device is
+ * done, and SampleArchive_OpDone() applies the result. Everything the
+ * operations share lives in statics, since coroutine locals do not
+ * survive a wait.
+ *
+ * Mounting reads the header of block 0 of every segment (16 segments per
+ * frame). The segment after the newest one is written next, with a boot
+ * number one above the newest block's; the time spans of the segments
+ * already written in its group are read back from their block headers,
+ * so the group's index block can still be written when the group ends.
+ *
+ * A block that fails to program costs its position and is written again
+ * at the next one; the burst stops and resumes on the next trigger. A
+ * reset loses the blocks in RAM, and a block interrupted by it fails its
+ * CRC and is skipped by queries.
+ *
+ * @ingroup sample_archive
+ */
+
+#include "sample_archive.h"
+#include "app_config.h"
+#include "app_coroutine.h"
+#include "app_task_manager.h"
+#include "sample_codec.h"
+#include "spi_bus.h"
+#include "telemetry.h"
+#include "crc32.h"
+#include "cli.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+#include <float.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert((SAMPLE_ARCHIVE_INDEX_SEGMENTS & (SAMPLE_ARCHIVE_INDEX_SEGMENTS - 1U)) == 0U,
+               "SAMPLE_ARCHIVE_INDEX_SEGMENTS must be a power of two");
+_Static_assert(SAMPLE_ARCHIVE_INDEX_SEGMENTS >= 1U, "SAMPLE_ARCHIVE_INDEX_SEGMENTS out of range");
+_Static_assert((SAMPLE_ARCHIVE_BURST_BLOCKS >= 1U) &&
+               (SAMPLE_ARCHIVE_BURST_BLOCKS <= SAMPLE_ARCHIVE_QUEUE_BLOCKS),
+               "SAMPLE_ARCHIVE_BURST_BLOCKS out of range");
+
+/** @brief Bytes in one segment. */
+#define SAMPLE_ARCHIVE_SEGMENT_SIZE (SAMPLE_ARCHIVE_BLOCK_SIZE * SAMPLE_ARCHIVE_SEGMENT_BLOCKS)
+
+/** @brief Header and CRC bytes of a block. */
+#define SAMPLE_ARCHIVE_OVERHEAD     (42U)
+
+/** @brief Payload bytes of a block. */
+#define SAMPLE_ARCHIVE_PAYLOAD_SIZE (SAMPLE_ARCHIVE_BLOCK_SIZE - SAMPLE_ARCHIVE_OVERHEAD)
+
+/** @brief Data block magic ("ARC1"). */
+#define SAMPLE_ARCHIVE_MAGIC_DATA   (0x31435241U)
+
+/** @brief Index block magic ("ARX1"). */
+#define SAMPLE_ARCHIVE_MAGIC_INDEX  (0x31585241U)
+
+/** @brief Header bytes read by the mount scans and queries (magic to count). */
+#define SAMPLE_ARCHIVE_HEADER_SIZE  (38U)
+
+/** @brief Headers read per mount frame. */
+#define SAMPLE_ARCHIVE_SCAN_BATCH   (16U)
+
+/** @brief Status polls of a page program, a sector erase and a chip erase (ms). */
+#define SAMPLE_ARCHIVE_PROGRAM_POLL_MS (1U)
+#define SAMPLE_ARCHIVE_ERASE_POLL_MS   (10U)
+#define SAMPLE_ARCHIVE_CHIP_POLL_MS    (250U)
+
+/** @brief Retry of a query block the UART TX ring had no room for (ms). */
+#define SAMPLE_ARCHIVE_RETRY_MS     (10U)
+
+/** @brief Serial NOR commands (W25Qxx and most others). */
+#define NOR_CMD_WRITE_ENABLE  (0x06U)
+#define NOR_CMD_READ_STATUS   (0x05U)
+#define NOR_CMD_READ          (0x03U)
+#define NOR_CMD_PAGE_PROGRAM  (0x02U)
+#define NOR_CMD_SECTOR_ERASE  (0x20U)
+#define NOR_CMD_CHIP_ERASE    (0xC7U)
+#define NOR_CMD_JEDEC_ID      (0x9FU)
+#define NOR_CMD_POWER_DOWN    (0xB9U)
+#define NOR_CMD_RELEASE       (0xABU)
+
+/** @brief Status register: program or erase in progress. */
+#define NOR_STATUS_BUSY       (0x01U)
+
+/**
+ * @brief Block layout, identical in RAM and on the device.
+ */
+typedef struct
+{
+    uint32_t magic;                                /**< Data or index magic.      */
+    uint32_t seq;                                  /**< Block sequence number.    */
+    uint32_t base_ms;                              /**< Batch base timestamp.     */
+    uint32_t first_ms;                             /**< Earliest sample tick.     */
+    uint32_t last_ms;                              /**< Latest sample tick.       */
+    uint32_t sensors;                              /**< Bit (ID % 32) per sensor. */
+    float    min;                                  /**< Smallest value.           */
+    float    max;                                  /**< Largest value.            */
+    uint16_t boot;                                 /**< Mount that wrote it.      */
+    uint16_t length;                               /**< Payload bytes used.       */
+    uint8_t  mode;                                 /**< SampleCodecMode_t.        */
+    uint8_t  count;                                /**< Samples or index entries. */
+    uint8_t  payload[SAMPLE_ARCHIVE_PAYLOAD_SIZE]; /**< 0xFF padded.              */
+    uint32_t crc;                                  /**< CRC-32 of all bytes above. */
+} SampleArchiveBlock_t;
+
+_Static_assert(sizeof(SampleArchiveBlock_t) == SAMPLE_ARCHIVE_BLOCK_SIZE, "archive block layout");
+
+/**
+ * @brief A block with the command bytes in front, so one DMA segment
+ *        sends or receives both.
+ */
+typedef struct
+{
+    uint8_t              command[4]; /**< Opcode and 24-bit address.  */
+    SampleArchiveBlock_t block;      /**< Page data.                  */
+} SampleArchiveSlot_t;
+
+/**
+ * @brief Summary of a segment (index entry) or of one block (query).
+ */
+typedef struct
+{
+    uint32_t first_ms; /**< Earliest sample tick.                     */
+    uint32_t last_ms;  /**< Latest sample tick.                       */
+    uint32_t sensors;  /**< Bit (ID % 32) per sensor.                 */
+    float    min;      /**< Smallest value.                           */
+    float    max;      /**< Largest value.                            */
+    uint16_t boot;     /**< Boot of its blocks.                       */
+    uint8_t  blocks;   /**< Data blocks; 0 if unused.                 */
+    uint8_t  reserved; /**< 0xFF.                                     */
+} SampleArchiveEntry_t;
+
+_Static_assert((SAMPLE_ARCHIVE_INDEX_SEGMENTS * sizeof(SampleArchiveEntry_t)) <= SAMPLE_ARCHIVE_PAYLOAD_SIZE,
+               "archive index does not fit in a block");
+
+/**
+ * @brief Progress of the archive.
+ */
+typedef enum
+{
+    SAMPLE_ARCHIVE_PHASE_WAKE = 0U, /**< Release from deep power-down.  */
+    SAMPLE_ARCHIVE_PHASE_ID,        /**< Read the JEDEC ID.             */
+    SAMPLE_ARCHIVE_PHASE_SCAN,      /**< Find the newest segment.       */
+    SAMPLE_ARCHIVE_PHASE_REBUILD,   /**< Rebuild the group's index.     */
+    SAMPLE_ARCHIVE_PHASE_IDLE,      /**< Mounted.                       */
+    SAMPLE_ARCHIVE_PHASE_ABSENT     /**< No device; the coroutine ends. */
+} SampleArchivePhase_t;
+
+/**
+ * @brief Operation of the frame in flight.
+ */
+typedef enum
+{
+    SAMPLE_ARCHIVE_OP_NONE = 0U,     /**< Nothing.                           */
+    SAMPLE_ARCHIVE_OP_RELEASE,       /**< Leave deep power-down.             */
+    SAMPLE_ARCHIVE_OP_ID,            /**< JEDEC ID.                          */
+    SAMPLE_ARCHIVE_OP_SCAN,          /**< Segment headers (mount).           */
+    SAMPLE_ARCHIVE_OP_REBUILD,       /**< Block headers of one segment.      */
+    SAMPLE_ARCHIVE_OP_ERASE_SECTOR,  /**< Erase the write segment.           */
+    SAMPLE_ARCHIVE_OP_PROGRAM_INDEX, /**< Program the group index block.     */
+    SAMPLE_ARCHIVE_OP_PROGRAM,       /**< Program the oldest queued block.   */
+    SAMPLE_ARCHIVE_OP_POWER_DOWN,    /**< Enter deep power-down.             */
+    SAMPLE_ARCHIVE_OP_ERASE_CHIP,    /**< Erase everything.                  */
+    SAMPLE_ARCHIVE_OP_QUERY_INDEX,   /**< Read a group index block.          */
+    SAMPLE_ARCHIVE_OP_QUERY_HEADERS, /**< Read the block headers of a segment. */
+    SAMPLE_ARCHIVE_OP_QUERY_BLOCK    /**< Read a data block for a query.     */
+} SampleArchiveOp_t;
+
+/**
+ * @brief Step of a query.
+ */
+typedef enum
+{
+    SAMPLE_ARCHIVE_QUERY_GROUP = 0U, /**< Load the index of the next group.  */
+    SAMPLE_ARCHIVE_QUERY_SEGMENTS,   /**< Pick the next matching segment.    */
+    SAMPLE_ARCHIVE_QUERY_BLOCKS,     /**< Pick the next matching block.      */
+    SAMPLE_ARCHIVE_QUERY_FLUSH       /**< Send the last batch and finish.    */
+} SampleArchiveQueryStage_t;
+
+/**
+ * @brief State of a `query`.
+ */
+typedef struct
+{
+    bool                      active;     /**< Query running.                           */
+    bool                      send;       /**< @ref s_out waits for the UART ring.      */
+    bool                      decoding;   /**< @ref s_reader holds a matching block.    */
+    bool                      held;       /**< @ref s_record waits for the next batch.  */
+    bool                      last;       /**< Walking the current group (RAM index).   */
+    SampleArchiveQueryStage_t stage;      /**< Step.                                    */
+    uint32_t                  from_ms;    /**< Range start (tick).                      */
+    uint32_t                  to_ms;      /**< Range end (tick).                        */
+    uint16_t                  boot;       /**< Boot selected.                           */
+    int32_t                   sensorId;   /**< Sensor selected, or -1 for all.          */
+    float                     min;        /**< Smallest value selected.                 */
+    float                     max;        /**< Largest value selected.                  */
+    uint32_t                  group;      /**< Group walked.                            */
+    uint32_t                  groupsLeft; /**< Indexed groups still to walk.            */
+    uint32_t                  entry;      /**< Segment of the group.                    */
+    uint32_t                  block;      /**< Block of the segment.                    */
+    uint32_t                  blocks;     /**< Blocks decoded.                          */
+    uint32_t                  skipped;    /**< Blocks skipped by their header summary.  */
+    uint32_t                  samples;    /**< Samples sent.                            */
+    uint32_t                  batches;    /**< Telemetry frames sent.                   */
+    uint32_t                  reads;      /**< Transfers.                               */
+} SampleArchiveQuery_t;
+
+/** @brief The NOR flash on the SPI bus. */
+static const SpiBusDevice_t s_device =
+{
+    (uint16_t)(1U << SAMPLE_ARCHIVE_CS_PIN), 0U, SAMPLE_ARCHIVE_SPI_HZ
+};
+
+/** @brief Frame in flight and its segments. */
+static SpiBusFrame_t   s_frame;
+static SpiBusSegment_t s_segments[SAMPLE_ARCHIVE_SCAN_BATCH];
+
+/** @brief Short commands: write enable, then the erase or status bytes. */
+static const uint8_t s_writeEnable[1] = { NOR_CMD_WRITE_ENABLE };
+static uint8_t       s_cmdTx[4];
+static uint8_t       s_cmdRx[4];
+
+/** @brief Header reads of the mount scans. */
+static uint8_t s_probeTx[SAMPLE_ARCHIVE_SCAN_BATCH][4U + SAMPLE_ARCHIVE_HEADER_SIZE];
+static uint8_t s_probeRx[SAMPLE_ARCHIVE_SCAN_BATCH][4U + SAMPLE_ARCHIVE_HEADER_SIZE];
+
+/** @brief Block reads: the command and 0xFF out, the block in. */
+static SampleArchiveSlot_t s_readTx;
+static SampleArchiveSlot_t s_read;
+
+/** @brief Index block being programmed. */
+static SampleArchiveSlot_t s_index;
+
+/** @brief Block under construction. */
+static SampleArchiveBlock_t s_build;
+
+/** @brief Encoder writing into @ref s_build. */
+static SampleCodec_t s_codec;
+
+/** @brief Whether @ref s_build holds samples. */
+static bool s_buildActive = false;
+
+/** @brief Tick of the first sample in @ref s_build. */
+static uint32_t s_buildStart_ms = 0U;
+
+/** @brief Sealed blocks waiting to be programmed. */
+static SampleArchiveSlot_t s_queue[SAMPLE_ARCHIVE_QUEUE_BLOCKS];
+
+/** @brief Index of the oldest queued block and number queued. */
+static uint32_t          s_queueHead  = 0U;
+static volatile uint32_t s_queueCount = 0U;
+
+/** @brief Samples wait in RAM, the oldest added at @ref s_oldest_ms. */
+static bool     s_pending   = false;
+static uint32_t s_oldest_ms = 0U;
+
+/** @brief Index entries of the group being written. */
+static SampleArchiveEntry_t s_entries[SAMPLE_ARCHIVE_INDEX_SEGMENTS];
+
+/** @brief Group @ref s_entries describe. */
+static uint32_t s_entriesGroup = 0U;
+
+/** @brief Index entries of the group a query walks. */
+static SampleArchiveEntry_t s_queryEntries[SAMPLE_ARCHIVE_INDEX_SEGMENTS];
+
+/** @brief Block summaries of the segment a query reads. */
+static SampleArchiveEntry_t s_queryBlocks[SAMPLE_ARCHIVE_SEGMENT_BLOCKS];
+
+/** @brief Running query. */
+static SampleArchiveQuery_t s_query;
+
+/** @brief Decoder of the block being filtered, and the record it gave last. */
+static SampleCodecReader_t s_reader;
+static SampleCodecRecord_t s_record;
+
+/** @brief Batch of matching samples being built, and whether it is open. */
+static SampleCodec_t s_out;
+static uint8_t       s_outPayload[TELEMETRY_MAX_PAYLOAD];
+static bool          s_outActive = false;
+
+/** @brief Mount progress. */
+static SampleArchivePhase_t s_phase = SAMPLE_ARCHIVE_PHASE_WAKE;
+
+/** @brief Operation in flight and its status poll interval (0: none). */
+static SampleArchiveOp_t s_op     = SAMPLE_ARCHIVE_OP_NONE;
+static uint32_t          s_pollMs = 0U;
+
+/** @brief Device out of deep power-down. */
+static bool s_awake = false;
+
+/** @brief Next segment the mount scan reads, and the newest found. */
+static uint32_t s_scanSegment  = 0U;
+static uint32_t s_newestSegment = 0U;
+static bool     s_newestFound  = false;
+static uint16_t s_newestBoot   = 0U;
+
+/** @brief Segment the index rebuild reads, and its last. */
+static uint32_t s_rebuildSegment = 0U;
+static uint32_t s_rebuildEnd     = 0U;
+
+/** @brief The write segment has been erased. */
+static bool s_segmentReady = false;
+
+/** @brief Sequence number of the next block programmed. */
+static uint32_t s_nextSeq = 1U;
+
+/** @brief Writing queued blocks until the queue is empty. */
+static bool s_bursting = false;
+
+/** @brief Requests from task context, served by the coroutine. */
+static volatile bool s_flushRequest = false;
+static volatile bool s_eraseRequest = false;
+
+/** @brief Archiving on/off. */
+static bool s_enabled = false;
+
+/** @brief Counters. */
+static SampleArchiveStats_t s_stats = {0};
+
+/**
+ * @brief The archive coroutine.
+ */
+static AppCoResult_t SampleArchive_Run(AppCoroutine_t *co);
+
+/**
+ * @brief Frame callback: resume the coroutine.
+ */
+static void SampleArchive_OnFrame(SpiBusFrame_t *frame);
+
+/**
+ * @brief Pick the next operation and submit its frame.
+ *
+ * @return false if there is nothing to do now.
+ */
+static bool SampleArchive_NextOp(void);
+
+/**
+ * @brief Pick the next operation of a mounted archive.
+ */
+static bool SampleArchive_NextIdleOp(void);
+
+/**
+ * @brief Pick the next read of the running query.
+ */
+static bool SampleArchive_NextQueryOp(void);
+
+/**
+ * @brief Apply the result of the finished operation.
+ */
+static void SampleArchive_OpDone(bool ok);
+
+/**
+ * @brief Apply a finished mount scan or index rebuild frame.
+ */
+static void SampleArchive_MountDone(void);
+
+/**
+ * @brief Apply a programmed data block.
+ */
+static void SampleArchive_ProgramDone(void);
+
+/**
+ * @brief Apply the block headers of a query segment.
+ */
+static void SampleArchive_QueryHeadersDone(void);
+
+/**
+ * @brief Start filtering a read query block.
+ */
+static void SampleArchive_QueryBlockDone(void);
+
+/**
+ * @brief Move the matching samples of the block to @ref s_out until the
+ *        block ends or the batch is full.
+ */
+static void SampleArchive_QueryDecode(void);
+
+/**
+ * @brief Send @ref s_out; false if the UART ring is full.
+ */
+static bool SampleArchive_QuerySend(void);
+
+/**
+ * @brief Whether every sample summarised by @p entry is before the range.
+ */
+static bool SampleArchive_QueryBefore(const SampleArchiveEntry_t *entry);
+
+/**
+ * @brief Whether @p entry may hold a matching sample.
+ */
+static bool SampleArchive_QueryMatches(const SampleArchiveEntry_t *entry);
+
+/**
+ * @brief Binary search: first of @p entries[lo..count) not before the range.
+ */
+static uint32_t SampleArchive_QuerySearch(const SampleArchiveEntry_t *entries, uint32_t lo, uint32_t count);
+
+/**
+ * @brief End the query and print its summary.
+ */
+static void SampleArchive_QueryEnd(void);
+
+/**
+ * @brief Milliseconds the idle coroutine waits for (0: only a signal).
+ */
+static uint32_t SampleArchive_WaitMs(void);
+
+/**
+ * @brief Submit a status register read.
+ */
+static void SampleArchive_StartStatusRead(void);
+
+/**
+ * @brief Submit the first @p count entries of @ref s_segments.
+ */
+static void SampleArchive_Submit(uint32_t count, uint32_t poll_ms);
+
+/**
+ * @brief Fill segment @p index of the frame.
+ */
+static void SampleArchive_Segment(uint32_t index, const uint8_t *tx, uint8_t *rx, uint16_t length);
+
+/**
+ * @brief Write an opcode and a 24-bit address to @p command.
+ */
+static void SampleArchive_Command(uint8_t *command, uint8_t opcode, uint32_t address);
+
+/**
+ * @brief Device address of @p block in @p segment.
+ */
+static uint32_t SampleArchive_Address(uint32_t segment, uint32_t block);
+
+/**
+ * @brief Read the header of @ref s_probeRx entry @p index into @p header.
+ */
+static void SampleArchive_ParseHeader(uint32_t index, SampleArchiveBlock_t *header);
+
+/**
+ * @brief Whether @p block is complete and intact.
+ */
+static bool SampleArchive_IsValid(const SampleArchiveBlock_t *block, uint32_t magic);
+
+/**
+ * @brief Add the time span of @p block to @p entry.
+ */
+static void SampleArchive_Extend(SampleArchiveEntry_t *entry, const SampleArchiveBlock_t *block);
+
+/**
+ * @brief Clear @p entries (no segment used).
+ */
+static void SampleArchive_ClearEntries(SampleArchiveEntry_t *entries);
+
+/**
+ * @brief Move the RAM block to the program queue.
+ */
+static void SampleArchive_Seal(void);
+
+/**
+ * @brief CLI "archive" handler.
+ */
+static void SampleArchive_CmdArchive(uint32_t argc, char *argv[]);
+
+/**
+ * @brief CLI "query" handler.
+ */
+static void SampleArchive_CmdQuery(uint32_t argc, char *argv[]);
+
+/** @brief Runs all device I/O. */
+static AppCoroutine_t s_coroutine =
+{
+    .name     = "archive",
+    .function = SampleArchive_Run
+};
+
+/* ------------------------------------------------------------------------- */
+
+void SampleArchive_Init(void)
+{
+    s_buildActive  = false;
+    s_queueHead    = 0U;
+    s_queueCount   = 0U;
+    s_pending      = false;
+    s_phase        = SAMPLE_ARCHIVE_PHASE_WAKE;
+    s_op           = SAMPLE_ARCHIVE_OP_NONE;
+    s_awake        = false;
+    s_segmentReady = false;
+    s_nextSeq      = 1U;
+    s_bursting     = false;
+    s_flushRequest = false;
+    s_eraseRequest = false;
+    s_query        = (SampleArchiveQuery_t){0};
+    s_outActive    = false;
+    s_stats        = (SampleArchiveStats_t){0};
+    s_enabled      = (SAMPLE_ARCHIVE_ENABLE_DEFAULT != 0);
+    SampleArchive_ClearEntries(s_entries);
+
+    memset(&s_readTx, 0xFF, sizeof(s_readTx));
+    memset(s_probeTx, 0xFF, sizeof(s_probeTx));
+
+    SpiBus_InitDevice(&s_device);
+    (void)AppCoroutine_Start(&s_coroutine);
+
+    (void)CLI_RegisterCommand("archive", SampleArchive_CmdArchive,
+                              "[on|off|flush|erase] - SPI flash sample archive");
+    (void)CLI_RegisterCommand("query", SampleArchive_CmdQuery,
+                              "<id|all> <from_ms> <to_ms> [min <v>] [max <v>] [boot <n>] - Stream archived samples");
+}
+
+void SampleArchive_SetEnabled(bool enable)
+{
+    if (!enable)
+    {
+        SampleArchive_Flush();
+    }
+
+    s_enabled = enable;
+}
+
+bool SampleArchive_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+bool SampleArchive_AddSample(const SensorSample_t *sample)
+{
+    if (!s_enabled || (sample == NULL) || (s_phase == SAMPLE_ARCHIVE_PHASE_ABSENT))
+    {
+        return false;
+    }
+
+    if (!s_buildActive)
+    {
+        SampleCodec_Begin(&s_codec, SAMPLE_CODEC_DELTA, sample->timestamp,
+                          s_build.payload, sizeof(s_build.payload));
+        s_build.base_ms  = sample->timestamp;
+        s_build.first_ms = sample->timestamp;
+        s_build.last_ms  = sample->timestamp;
+        s_build.sensors  = 0U;
+        s_build.min      = SensorData_GetFloat(sample, 0U);
+        s_build.max      = s_build.min;
+        s_buildStart_ms  = HAL_GetTick();
+        s_buildActive    = true;
+
+        if (!s_pending)
+        {
+            s_oldest_ms = s_buildStart_ms;
+            s_pending   = true;
+        }
+    }
+
+    if (!SampleCodec_Add(&s_codec, sample))
+    {
+        SampleArchive_Seal();
+        return SampleArchive_AddSample(sample);
+    }
+
+    /* Sensors report in their own order: keep the span, not the ends. */
+    if ((int32_t)(sample->timestamp - s_build.first_ms) < 0)
+    {
+        s_build.first_ms = sample->timestamp;
+    }
+    if ((int32_t)(sample->timestamp - s_build.last_ms) > 0)
+    {
+        s_build.last_ms = sample->timestamp;
+    }
+
+    float value = SensorData_GetFloat(sample, 0U);
+    s_build.sensors |= 1UL << (sample->sensorId % 32U);
+    if (value < s_build.min)
+    {
+        s_build.min = value;
+    }
+    if (value > s_build.max)
+    {
+        s_build.max = value;
+    }
+
+    s_stats.samples++;
+
+    if (s_codec.count >= 0xFFU)
+    {
+        SampleArchive_Seal();
+    }
+
+    return true;
+}
+
+void SampleArchive_Flush(void)
+{
+    if (s_buildActive)
+    {
+        SampleArchive_Seal();
+    }
+
+    if (s_queueCount > 0U)
+    {
+        s_flushRequest = true;
+        AppCoroutine_Signal(&s_coroutine);
+    }
+}
+
+bool SampleArchive_IsIdle(void)
+{
+    if (s_phase == SAMPLE_ARCHIVE_PHASE_ABSENT)
+    {
+        return true;
+    }
+
+    return !s_buildActive && (s_queueCount == 0U) && !s_awake;
+}
+
+void SampleArchive_GetStats(SampleArchiveStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    *stats              = s_stats;
+    stats->blocksQueued = s_queueCount;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Internal Helper Functions                                                 */
+/* ------------------------------------------------------------------------- */
+
+static AppCoResult_t SampleArchive_Run(AppCoroutine_t *co)
+{
+    APP_CO_BEGIN(co);
+
+    for (;;)
+    {
+        if (!SampleArchive_NextOp())
+        {
+            if (s_phase == SAMPLE_ARCHIVE_PHASE_ABSENT)
+            {
+                APP_CO_EXIT(co);
+            }
+            APP_CO_WAIT_SIGNAL(co, SampleArchive_WaitMs());
+            continue;
+        }
+
+        /* The bus aborts a frame that does not finish in time. */
+        while (s_frame.state != SPI_BUS_FRAME_DONE)
+        {
+            APP_CO_WAIT_SIGNAL(co, SPI_BUS_TIMEOUT_MS);
+            SpiBus_Service(HAL_GetTick());
+        }
+
+        /* Programs and erases: poll the status register until done. */
+        while ((s_frame.result == SPI_BUS_OK) && (s_pollMs != 0U))
+        {
+            APP_CO_DELAY(co, s_pollMs);
+            SampleArchive_StartStatusRead();
+            while (s_frame.state != SPI_BUS_FRAME_DONE)
+            {
+                APP_CO_WAIT_SIGNAL(co, SPI_BUS_TIMEOUT_MS);
+                SpiBus_Service(HAL_GetTick());
+            }
+            if ((s_frame.result == SPI_BUS_OK) && ((s_cmdRx[1] & NOR_STATUS_BUSY) == 0U))
+            {
+                s_pollMs = 0U;
+            }
+        }
+
+        SampleArchive_OpDone(s_frame.result == SPI_BUS_OK);
+    }
+
+    APP_CO_END(co);
+}
+
+static void SampleArchive_OnFrame(SpiBusFrame_t *frame)
+{
+    (void)frame;
+
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+static bool SampleArchive_NextOp(void)
+{
+    s_op     = SAMPLE_ARCHIVE_OP_NONE;
+    s_pollMs = 0U;
+
+    switch (s_phase)
+    {
+    case SAMPLE_ARCHIVE_PHASE_WAKE:
+        s_cmdTx[0] = NOR_CMD_RELEASE;
+        SampleArchive_Segment(0U, s_cmdTx, NULL, 1U);
+        s_op = SAMPLE_ARCHIVE_OP_RELEASE;
+        SampleArchive_Submit(1U, 0U);
+        return true;
+
+    case SAMPLE_ARCHIVE_PHASE_ID:
+        memset(s_cmdTx, 0xFF, sizeof(s_cmdTx));
+        s_cmdTx[0] = NOR_CMD_JEDEC_ID;
+        SampleArchive_Segment(0U, s_cmdTx, s_cmdRx, 4U);
+        s_op = SAMPLE_ARCHIVE_OP_ID;
+        SampleArchive_Submit(1U, 0U);
+        return true;
+
+    case SAMPLE_ARCHIVE_PHASE_SCAN:
+    {
+        uint32_t count = s_stats.segments - s_scanSegment;
+        if (count > SAMPLE_ARCHIVE_SCAN_BATCH)
+        {
+            count = SAMPLE_ARCHIVE_SCAN_BATCH;
+        }
+        for (uint32_t i = 0U; i < count; ++i)
+        {
+            SampleArchive_Command(s_probeTx[i], NOR_CMD_READ,
+                                  SampleArchive_Address(s_scanSegment + i, 0U));
+            SampleArchive_Segment(i, s_probeTx[i], s_probeRx[i], (uint16_t)sizeof(s_probeTx[i]));
+        }
+        s_op = SAMPLE_ARCHIVE_OP_SCAN;
+        SampleArchive_Submit(count, 0U);
+        return true;
+    }
+
+    case SAMPLE_ARCHIVE_PHASE_REBUILD:
+        for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_SEGMENT_BLOCKS; ++i)
+        {
+            SampleArchive_Command(s_probeTx[i], NOR_CMD_READ,
+                                  SampleArchive_Address(s_rebuildSegment, i));
+            SampleArchive_Segment(i, s_probeTx[i], s_probeRx[i], (uint16_t)sizeof(s_probeTx[i]));
+        }
+        s_op = SAMPLE_ARCHIVE_OP_REBUILD;
+        SampleArchive_Submit(SAMPLE_ARCHIVE_SEGMENT_BLOCKS, 0U);
+        return true;
+
+    case SAMPLE_ARCHIVE_PHASE_IDLE:
+        return SampleArchive_NextIdleOp();
+
+    default:
+        return false;
+    }
+}
+
+static bool SampleArchive_NextIdleOp(void)
+{
+    /* Bound the time a sample waits in RAM. */
+    if (s_pending && ((HAL_GetTick() - s_oldest_ms) >= SAMPLE_ARCHIVE_MAX_AGE_MS))
+    {
+        if (s_buildActive)
+        {
+            SampleArchive_Seal();
+        }
+        s_flushRequest = true;
+    }
+
+    bool erase = s_eraseRequest;
+    bool write = (s_queueCount > 0U) &&
+                 (s_bursting || s_flushRequest || (s_queueCount >= SAMPLE_ARCHIVE_BURST_BLOCKS));
+    bool query = s_query.active;
+
+    if (s_queueCount == 0U)
+    {
+        s_flushRequest = false;
+    }
+
+    if ((erase || write || query) && !s_awake)
+    {
+        s_cmdTx[0] = NOR_CMD_RELEASE;
+        SampleArchive_Segment(0U, s_cmdTx, NULL, 1U);
+        s_op = SAMPLE_ARCHIVE_OP_RELEASE;
+        SampleArchive_Submit(1U, 0U);
+        return true;
+    }
+
+    if (erase)
+    {
+        /* Whatever is queued belongs to the data being erased. */
+        uint32_t key = AppTaskManager_Lock();
+        s_queueCount = 0U;
+        AppTaskManager_Unlock(key);
+        s_bursting = false;
+
+        s_cmdTx[0] = NOR_CMD_CHIP_ERASE;
+        SampleArchive_Segment(0U, s_writeEnable, NULL, 1U);
+        SampleArchive_Segment(1U, s_cmdTx, NULL, 1U);
+        s_op = SAMPLE_ARCHIVE_OP_ERASE_CHIP;
+        SampleArchive_Submit(2U, SAMPLE_ARCHIVE_CHIP_POLL_MS);
+        return true;
+    }
+
+    if (write)
+    {
+        if (!s_bursting)
+        {
+            s_bursting = true;
+            s_stats.bursts++;
+        }
+
+        uint32_t segment = s_stats.writeSegment;
+
+        if (!s_segmentReady)
+        {
+            SampleArchive_Command(s_cmdTx, NOR_CMD_SECTOR_ERASE, SampleArchive_Address(segment, 0U));
+            SampleArchive_Segment(0U, s_writeEnable, NULL, 1U);
+            SampleArchive_Segment(1U, s_cmdTx, NULL, 4U);
+            s_op = SAMPLE_ARCHIVE_OP_ERASE_SECTOR;
+            SampleArchive_Submit(2U, SAMPLE_ARCHIVE_ERASE_POLL_MS);
+            return true;
+        }
+
+        /* The first block of a group indexes the group before it. */
+        uint32_t group = segment / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+        if ((s_stats.writeBlock == 0U) && ((segment % SAMPLE_ARCHIVE_INDEX_SEGMENTS) == 0U) &&
+            (s_entriesGroup != group))
+        {
+            SampleArchiveBlock_t *index = &s_index.block;
+            bool                  used  = false;
+
+            memset(index, 0xFF, sizeof(*index));
+            for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_INDEX_SEGMENTS; ++i)
+            {
+                const SampleArchiveEntry_t *entry = &s_entries[i];
+                if (entry->blocks == 0U)
+                {
+                    continue;
+                }
+                if (!used || ((int32_t)(entry->first_ms - index->first_ms) < 0))
+                {
+                    index->first_ms = entry->first_ms;
+                }
+                if (!used || ((int32_t)(entry->last_ms - index->last_ms) > 0))
+                {
+                    index->last_ms = entry->last_ms;
+                }
+                used = true;
+            }
+
+            if (!used)
+            {
+                /* Nothing to index: the group starts with data. */
+                SampleArchive_ClearEntries(s_entries);
+                s_entriesGroup = group;
+            }
+            else
+            {
+                index->magic  = SAMPLE_ARCHIVE_MAGIC_INDEX;
+                index->seq    = s_nextSeq;
+                index->boot   = (uint16_t)s_stats.boot;
+                index->length = (uint16_t)sizeof(s_entries);
+                index->mode   = 0U;
+                index->count  = (uint8_t)SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+                memcpy(index->payload, s_entries, sizeof(s_entries));
+                index->crc    = Crc32_Compute(index, offsetof(SampleArchiveBlock_t, crc));
+
+                SampleArchive_Command(s_index.command, NOR_CMD_PAGE_PROGRAM,
+                                      SampleArchive_Address(segment, 0U));
+                SampleArchive_Segment(0U, s_writeEnable, NULL, 1U);
+                SampleArchive_Segment(1U, s_index.command, NULL, (uint16_t)sizeof(s_index));
+                s_op = SAMPLE_ARCHIVE_OP_PROGRAM_INDEX;
+                SampleArchive_Submit(2U, SAMPLE_ARCHIVE_PROGRAM_POLL_MS);
+                return true;
+            }
+        }
+
+        /* Sequence, boot and CRC are known only now: the block may have
+         * been sealed before the mount finished.
+         */
+        SampleArchiveSlot_t *slot = &s_queue[s_queueHead];
+        slot->block.seq  = s_nextSeq;
+        slot->block.boot = (uint16_t)s_stats.boot;
+        slot->block.crc  = Crc32_Compute(&slot->block, offsetof(SampleArchiveBlock_t, crc));
+
+        SampleArchive_Command(slot->command, NOR_CMD_PAGE_PROGRAM,
+                              SampleArchive_Address(segment, s_stats.writeBlock));
+        SampleArchive_Segment(0U, s_writeEnable, NULL, 1U);
+        SampleArchive_Segment(1U, slot->command, NULL, (uint16_t)sizeof(*slot));
+        s_op = SAMPLE_ARCHIVE_OP_PROGRAM;
+        SampleArchive_Submit(2U, SAMPLE_ARCHIVE_PROGRAM_POLL_MS);
+        return true;
+    }
+
+    if (query && SampleArchive_NextQueryOp())
+    {
+        return true;
+    }
+
+    if (s_awake && !s_query.active)
+    {
+        s_cmdTx[0] = NOR_CMD_POWER_DOWN;
+        SampleArchive_Segment(0U, s_cmdTx, NULL, 1U);
+        s_op = SAMPLE_ARCHIVE_OP_POWER_DOWN;
+        SampleArchive_Submit(1U, 0U);
+        return true;
+    }
+
+    return false;
+}
+
+static bool SampleArchive_NextQueryOp(void)
+{
+    uint32_t groups = s_stats.segments / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+
+    while (s_query.active)
+    {
+        if (s_query.send && !SampleArchive_QuerySend())
+        {
+            return false;
+        }
+
+        if (s_query.decoding)
+        {
+            SampleArchive_QueryDecode();
+            continue;
+        }
+
+        switch (s_query.stage)
+        {
+        case SAMPLE_ARCHIVE_QUERY_GROUP:
+            if (s_query.groupsLeft == 0U)
+            {
+                /* The current group's index is not written yet. */
+                memcpy(s_queryEntries, s_entries, sizeof(s_entries));
+                s_query.group = s_entriesGroup;
+                s_query.last  = true;
+                s_query.entry = SampleArchive_QuerySearch(s_queryEntries, 0U, SAMPLE_ARCHIVE_INDEX_SEGMENTS);
+                s_query.stage = SAMPLE_ARCHIVE_QUERY_SEGMENTS;
+                break;
+            }
+            {
+                /* The index of a group is in the first block of the next one. */
+                uint32_t next = ((s_query.group + 1U) % groups) * SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+                SampleArchive_Command(s_readTx.command, NOR_CMD_READ, SampleArchive_Address(next, 0U));
+                SampleArchive_Segment(0U, s_readTx.command, s_read.command, (uint16_t)sizeof(s_read));
+                s_op = SAMPLE_ARCHIVE_OP_QUERY_INDEX;
+                SampleArchive_Submit(1U, 0U);
+            }
+            return true;
+
+        case SAMPLE_ARCHIVE_QUERY_SEGMENTS:
+            while ((s_query.entry < SAMPLE_ARCHIVE_INDEX_SEGMENTS) &&
+                   !SampleArchive_QueryMatches(&s_queryEntries[s_query.entry]))
+            {
+                s_query.entry++;
+            }
+            if (s_query.entry >= SAMPLE_ARCHIVE_INDEX_SEGMENTS)
+            {
+                if (s_query.last)
+                {
+                    s_query.stage = SAMPLE_ARCHIVE_QUERY_FLUSH;
+                }
+                else
+                {
+                    s_query.group = (s_query.group + 1U) % groups;
+                    s_query.groupsLeft--;
+                    s_query.stage = SAMPLE_ARCHIVE_QUERY_GROUP;
+                }
+                break;
+            }
+            {
+                /* The block headers are the per-block index: one frame. */
+                uint32_t segment = (s_query.group * SAMPLE_ARCHIVE_INDEX_SEGMENTS) + s_query.entry;
+                for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_SEGMENT_BLOCKS; ++i)
+                {
+                    SampleArchive_Command(s_probeTx[i], NOR_CMD_READ, SampleArchive_Address(segment, i));
+                    SampleArchive_Segment(i, s_probeTx[i], s_probeRx[i], (uint16_t)sizeof(s_probeTx[i]));
+                }
+                s_op = SAMPLE_ARCHIVE_OP_QUERY_HEADERS;
+                SampleArchive_Submit(SAMPLE_ARCHIVE_SEGMENT_BLOCKS, 0U);
+            }
+            return true;
+
+        case SAMPLE_ARCHIVE_QUERY_BLOCKS:
+            while ((s_query.block < SAMPLE_ARCHIVE_SEGMENT_BLOCKS) &&
+                   !SampleArchive_QueryMatches(&s_queryBlocks[s_query.block]))
+            {
+                if (s_queryBlocks[s_query.block].blocks != 0U)
+                {
+                    s_query.skipped++;
+                }
+                s_query.block++;
+            }
+            if (s_query.block >= SAMPLE_ARCHIVE_SEGMENT_BLOCKS)
+            {
+                s_query.entry++;
+                s_query.stage = SAMPLE_ARCHIVE_QUERY_SEGMENTS;
+                break;
+            }
+            {
+                uint32_t segment = (s_query.group * SAMPLE_ARCHIVE_INDEX_SEGMENTS) + s_query.entry;
+                SampleArchive_Command(s_readTx.command, NOR_CMD_READ,
+                                      SampleArchive_Address(segment, s_query.block));
+                SampleArchive_Segment(0U, s_readTx.command, s_read.command, (uint16_t)sizeof(s_read));
+                s_op = SAMPLE_ARCHIVE_OP_QUERY_BLOCK;
+                SampleArchive_Submit(1U, 0U);
+            }
+            return true;
+
+        default:
+            if (s_outActive)
+            {
+                s_query.send = true;
+                break;
+            }
+            SampleArchive_QueryEnd();
+            return false;
+        }
+    }
+
+    return false;
+}
+
+static void SampleArchive_OpDone(bool ok)
+{
+    SampleArchiveOp_t op = s_op;
+    s_op = SAMPLE_ARCHIVE_OP_NONE;
+
+    if (!ok)
+    {
+        s_stats.errors++;
+
+        switch (op)
+        {
+        case SAMPLE_ARCHIVE_OP_RELEASE:
+        case SAMPLE_ARCHIVE_OP_ID:
+        case SAMPLE_ARCHIVE_OP_SCAN:
+        case SAMPLE_ARCHIVE_OP_REBUILD:
+            if (s_phase != SAMPLE_ARCHIVE_PHASE_IDLE)
+            {
+                LOG_ERROR("SampleArchive: SPI transfer failed while mounting");
+                s_phase = SAMPLE_ARCHIVE_PHASE_ABSENT;
+            }
+            break;
+
+        case SAMPLE_ARCHIVE_OP_PROGRAM:
+        case SAMPLE_ARCHIVE_OP_PROGRAM_INDEX:
+            /* The page may be half programmed: skip it. */
+            if (++s_stats.writeBlock >= SAMPLE_ARCHIVE_SEGMENT_BLOCKS)
+            {
+                s_stats.writeSegment = (s_stats.writeSegment + 1U) % s_stats.segments;
+                s_stats.writeBlock   = 0U;
+                s_segmentReady       = false;
+            }
+            if (op == SAMPLE_ARCHIVE_OP_PROGRAM_INDEX)
+            {
+                SampleArchive_ClearEntries(s_entries);
+                s_entriesGroup = s_stats.writeSegment / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+            }
+            s_bursting     = false;
+            s_flushRequest = false;
+            break;
+
+        case SAMPLE_ARCHIVE_OP_ERASE_SECTOR:
+        case SAMPLE_ARCHIVE_OP_ERASE_CHIP:
+            s_bursting     = false;
+            s_flushRequest = false;
+            s_eraseRequest = false;
+            break;
+
+        case SAMPLE_ARCHIVE_OP_QUERY_INDEX:
+        case SAMPLE_ARCHIVE_OP_QUERY_HEADERS:
+        case SAMPLE_ARCHIVE_OP_QUERY_BLOCK:
+            CLI_Print("\r\nQuery aborted: SPI transfer failed\r\n");
+            CLI_OnExternalOutput();
+            s_query.active = false;
+            s_outActive    = false;
+            break;
+
+        default:
+            break;
+        }
+        return;
+    }
+
+    switch (op)
+    {
+    case SAMPLE_ARCHIVE_OP_RELEASE:
+        s_awake = true;
+        if (s_phase == SAMPLE_ARCHIVE_PHASE_WAKE)
+        {
+            s_phase = SAMPLE_ARCHIVE_PHASE_ID;
+        }
+        break;
+
+    case SAMPLE_ARCHIVE_OP_ID:
+    {
+        uint8_t capacity = s_cmdRx[3];
+
+        s_stats.jedecId = ((uint32_t)s_cmdRx[1] << 16) | ((uint32_t)s_cmdRx[2] << 8) | capacity;
+
+        /* 2^capacity bytes, 128 KB to 16 MB (24-bit addresses); a floating
+         * MISO reads all zeros or all ones.
+         */
+        if ((s_cmdRx[1] == 0x00U) || (s_cmdRx[1] == 0xFFU) ||
+            (capacity < 17U) || (capacity > 24U))
+        {
+            LOG_WARN("SampleArchive: no SPI flash found (JEDEC ID 0x%06lX)",
+                     (unsigned long)s_stats.jedecId);
+            s_phase = SAMPLE_ARCHIVE_PHASE_ABSENT;
+            break;
+        }
+
+        s_stats.present  = true;
+        s_stats.segments = (1UL << capacity) / SAMPLE_ARCHIVE_SEGMENT_SIZE;
+        s_scanSegment    = 0U;
+        s_newestFound    = false;
+        s_phase          = SAMPLE_ARCHIVE_PHASE_SCAN;
+        break;
+    }
+
+    case SAMPLE_ARCHIVE_OP_SCAN:
+    case SAMPLE_ARCHIVE_OP_REBUILD:
+        SampleArchive_MountDone();
+        break;
+
+    case SAMPLE_ARCHIVE_OP_ERASE_SECTOR:
+        s_segmentReady = true;
+        s_stats.erases++;
+        break;
+
+    case SAMPLE_ARCHIVE_OP_PROGRAM_INDEX:
+        s_stats.indexWritten++;
+        s_stats.newestSeq = s_nextSeq++;
+        s_stats.writeBlock++;
+        SampleArchive_ClearEntries(s_entries);
+        s_entriesGroup = s_stats.writeSegment / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+        break;
+
+    case SAMPLE_ARCHIVE_OP_PROGRAM:
+        SampleArchive_ProgramDone();
+        break;
+
+    case SAMPLE_ARCHIVE_OP_POWER_DOWN:
+        s_awake = false;
+        break;
+
+    case SAMPLE_ARCHIVE_OP_ERASE_CHIP:
+        s_eraseRequest        = false;
+        s_stats.writeSegment  = 0U;
+        s_stats.writeBlock    = 0U;
+        s_stats.segmentsUsed  = 0U;
+        s_segmentReady        = true;
+        s_entriesGroup        = 0U;
+        SampleArchive_ClearEntries(s_entries);
+        s_stats.erases++;
+        CLI_Print("\r\nArchive erased\r\n");
+        CLI_OnExternalOutput();
+        break;
+
+    case SAMPLE_ARCHIVE_OP_QUERY_INDEX:
+        s_query.reads++;
+        if (SampleArchive_IsValid(&s_read.block, SAMPLE_ARCHIVE_MAGIC_INDEX))
+        {
+            memcpy(s_queryEntries, s_read.block.payload, sizeof(s_queryEntries));
+        }
+        else
+        {
+            /* Not indexed (never written, or overwritten): skip the group. */
+            SampleArchive_ClearEntries(s_queryEntries);
+        }
+        s_query.entry = SampleArchive_QuerySearch(s_queryEntries, 0U, SAMPLE_ARCHIVE_INDEX_SEGMENTS);
+        s_query.stage = SAMPLE_ARCHIVE_QUERY_SEGMENTS;
+        break;
+
+    case SAMPLE_ARCHIVE_OP_QUERY_HEADERS:
+        SampleArchive_QueryHeadersDone();
+        break;
+
+    case SAMPLE_ARCHIVE_OP_QUERY_BLOCK:
+        SampleArchive_QueryBlockDone();
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void SampleArchive_MountDone(void)
+{
+    SampleArchiveBlock_t header;
+
+    if (s_phase == SAMPLE_ARCHIVE_PHASE_SCAN)
+    {
+        uint32_t count = s_frame.count;
+
+        for (uint32_t i = 0U; i < count; ++i)
+        {
+            SampleArchive_ParseHeader(i, &header);
+            if ((header.magic != SAMPLE_ARCHIVE_MAGIC_DATA) && (header.magic != SAMPLE_ARCHIVE_MAGIC_INDEX))
+            {
+                continue;
+            }
+
+            s_stats.segmentsUsed++;
+            if (!s_newestFound || ((int32_t)(header.seq - s_stats.newestSeq) > 0))
+            {
+                s_newestFound     = true;
+                s_newestSegment   = s_scanSegment + i;
+                s_newestBoot      = header.boot;
+                s_stats.newestSeq = header.seq;
+            }
+        }
+
+        s_scanSegment += count;
+        if (s_scanSegment < s_stats.segments)
+        {
+            return;
+        }
+
+        s_stats.writeBlock = 0U;
+        s_segmentReady     = false;
+        SampleArchive_ClearEntries(s_entries);
+
+        if (!s_newestFound)
+        {
+            s_stats.writeSegment = 0U;
+            s_stats.boot         = 1U;
+            s_entriesGroup       = 0U;
+            s_phase              = SAMPLE_ARCHIVE_PHASE_IDLE;
+        }
+        else
+        {
+            /* Block 0 of the newest segment is the oldest block in it: the
+             * newest block is somewhere in that segment, so this boot starts
+             * in the one after it.
+             */
+            uint32_t last = s_newestSegment;
+
+            s_stats.writeSegment = (last + 1U) % s_stats.segments;
+            s_stats.boot         = (uint16_t)(s_newestBoot + 1U);
+            s_entriesGroup       = last / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+            s_rebuildSegment     = s_entriesGroup * SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+            s_rebuildEnd         = last;
+            s_phase              = SAMPLE_ARCHIVE_PHASE_REBUILD;
+            return;
+        }
+    }
+    else
+    {
+        SampleArchiveEntry_t *entry = &s_entries[s_rebuildSegment % SAMPLE_ARCHIVE_INDEX_SEGMENTS];
+
+        for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_SEGMENT_BLOCKS; ++i)
+        {
+            SampleArchive_ParseHeader(i, &header);
+            if (header.magic != SAMPLE_ARCHIVE_MAGIC_DATA)
+            {
+                continue;
+            }
+            if ((int32_t)(header.seq - s_stats.newestSeq) > 0)
+            {
+                s_stats.newestSeq = header.seq;
+            }
+            SampleArchive_Extend(entry, &header);
+        }
+
+        if (s_rebuildSegment != s_rebuildEnd)
+        {
+            s_rebuildSegment++;
+            return;
+        }
+        s_phase = SAMPLE_ARCHIVE_PHASE_IDLE;
+    }
+
+    s_nextSeq       = s_stats.newestSeq + 1U;
+    s_stats.mounted = true;
+
+    LOG_INFO("SampleArchive: %lu/%lu segments used, boot %lu, writing segment %lu",
+             (unsigned long)s_stats.segmentsUsed, (unsigned long)s_stats.segments,
+             (unsigned long)s_stats.boot, (unsigned long)s_stats.writeSegment);
+}
+
+static void SampleArchive_ProgramDone(void)
+{
+    SampleArchiveSlot_t *slot = &s_queue[s_queueHead];
+
+    SampleArchive_Extend(&s_entries[s_stats.writeSegment % SAMPLE_ARCHIVE_INDEX_SEGMENTS], &slot->block);
+    s_stats.newestSeq = s_nextSeq++;
+    s_stats.blocksWritten++;
+
+    uint32_t key = AppTaskManager_Lock();
+    s_queueHead = (s_queueHead + 1U) % SAMPLE_ARCHIVE_QUEUE_BLOCKS;
+    s_queueCount--;
+    AppTaskManager_Unlock(key);
+
+    if (++s_stats.writeBlock >= SAMPLE_ARCHIVE_SEGMENT_BLOCKS)
+    {
+        s_stats.writeSegment = (s_stats.writeSegment + 1U) % s_stats.segments;
+        s_stats.writeBlock   = 0U;
+        s_segmentReady       = false;
+    }
+
+    if (s_queueCount == 0U)
+    {
+        s_bursting     = false;
+        s_flushRequest = false;
+
+        /* Samples added during the burst are the oldest now. */
+        s_pending   = s_buildActive;
+        s_oldest_ms = s_buildStart_ms;
+    }
+}
+
+static void SampleArchive_QueryHeadersDone(void)
+{
+    SampleArchiveBlock_t header;
+    uint32_t             first = 0U;
+
+    s_query.reads++;
+    SampleArchive_ClearEntries(s_queryBlocks);
+
+    for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_SEGMENT_BLOCKS; ++i)
+    {
+        SampleArchive_ParseHeader(i, &header);
+        if (header.magic == SAMPLE_ARCHIVE_MAGIC_DATA)
+        {
+            SampleArchive_Extend(&s_queryBlocks[i], &header);
+        }
+        else if ((i == first) && (header.magic == SAMPLE_ARCHIVE_MAGIC_INDEX))
+        {
+            /* The group's index block comes before its data. */
+            first = i + 1U;
+        }
+    }
+
+    s_query.block = SampleArchive_QuerySearch(s_queryBlocks, first, SAMPLE_ARCHIVE_SEGMENT_BLOCKS);
+    s_query.stage = SAMPLE_ARCHIVE_QUERY_BLOCKS;
+}
+
+static void SampleArchive_QueryBlockDone(void)
+{
+    const SampleArchiveBlock_t *block = &s_read.block;
+
+    s_query.reads++;
+    s_query.block++;
+
+    /* The header was checked already; this adds the CRC. */
+    if (SampleArchive_IsValid(block, SAMPLE_ARCHIVE_MAGIC_DATA) && (block->boot == s_query.boot))
+    {
+        SampleCodec_BeginRead(&s_reader, (SampleCodecMode_t)block->mode, block->base_ms,
+                              block->payload, block->length);
+        s_query.blocks++;
+        s_query.decoding = true;
+        s_query.held     = false;
+    }
+}
+
+static void SampleArchive_QueryDecode(void)
+{
+    while (!s_query.send)
+    {
+        if (!s_query.held)
+        {
+            if (!SampleCodec_Read(&s_reader, &s_record))
+            {
+                s_query.decoding = false;
+                return;
+            }
+
+            if (((s_query.sensorId >= 0) && (s_record.sensorId != (uint32_t)s_query.sensorId)) ||
+                ((int32_t)(s_record.timestamp - s_query.from_ms) < 0) ||
+                ((int32_t)(s_record.timestamp - s_query.to_ms) > 0) ||
+                (s_record.value < s_query.min) || (s_record.value > s_query.max))
+            {
+                continue;
+            }
+            s_query.held = true;
+        }
+
+        /* Delta mode keeps 0.01: an S32 channel at 10^-2 holds it exactly. */
+        SensorSample_t sample = { .sensorId = s_record.sensorId };
+        SensorData_Init(&sample, SENSOR_FORMAT_S32, 1U, -2);
+        SensorData_SetFloat(&sample, 0U, s_record.value);
+        sample.timestamp = s_record.timestamp;
+
+        if (!s_outActive)
+        {
+            SampleCodec_Begin(&s_out, SAMPLE_CODEC_DELTA, sample.timestamp, s_outPayload, sizeof(s_outPayload));
+            s_outActive = true;
+        }
+
+        if (!SampleCodec_Add(&s_out, &sample))
+        {
+            if (s_out.count == 0U)
+            {
+                /* Does not fit even an empty batch: drop it. */
+                s_query.held = false;
+                s_outActive  = false;
+                continue;
+            }
+            /* Full: send it, then retry the record in a new batch. */
+            s_query.send = true;
+            continue;
+        }
+
+        s_query.held = false;
+        if (s_out.count >= 0xFFU)
+        {
+            s_query.send = true;
+        }
+    }
+}
+
+static bool SampleArchive_QuerySend(void)
+{
+    if (s_outActive && (s_out.count != 0U))
+    {
+        if (!Telemetry_SendBatch(SAMPLE_CODEC_DELTA, s_out.base_ms, s_out.count, s_outPayload, s_out.length))
+        {
+            return false;
+        }
+        s_query.batches++;
+        s_query.samples += s_out.count;
+    }
+
+    s_query.send = false;
+    s_outActive  = false;
+    return true;
+}
+
+static bool SampleArchive_QueryBefore(const SampleArchiveEntry_t *entry)
+{
+    return (entry->blocks != 0U) &&
+           ((entry->boot < s_query.boot) ||
+            ((entry->boot == s_query.boot) && ((int32_t)(entry->last_ms - s_query.from_ms) < 0)));
+}
+
+static bool SampleArchive_QueryMatches(const SampleArchiveEntry_t *entry)
+{
+    return (entry->blocks != 0U) && (entry->boot == s_query.boot) &&
+           ((int32_t)(entry->first_ms - s_query.to_ms) <= 0) &&
+           ((int32_t)(entry->last_ms - s_query.from_ms) >= 0) &&
+           ((s_query.sensorId < 0) || ((entry->sensors & (1UL << ((uint32_t)s_query.sensorId % 32U))) != 0U)) &&
+           !(entry->max < s_query.min) && !(entry->min > s_query.max);
+}
+
+static uint32_t SampleArchive_QuerySearch(const SampleArchiveEntry_t *entries, uint32_t lo, uint32_t count)
+{
+    /* Segments and blocks are written in order, so within a group or a
+     * segment "before the range" holds for a prefix: older boots, then
+     * blocks of this boot whose newest sample is older than from_ms.
+     */
+    uint32_t hi = count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + ((hi - lo) / 2U);
+        if (SampleArchive_QueryBefore(&entries[mid]))
+        {
+            lo = mid + 1U;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static void SampleArchive_QueryEnd(void)
+{
+    s_query.active = false;
+
+    CLI_Print("\r\nQuery boot %lu, %lu..%lu ms: %lu sample(s) in %lu frame(s); "
+              "%lu block(s) decoded, %lu skipped, %lu read(s)\r\n",
+              (unsigned long)s_query.boot, (unsigned long)s_query.from_ms,
+              (unsigned long)s_query.to_ms, (unsigned long)s_query.samples,
+              (unsigned long)s_query.batches, (unsigned long)s_query.blocks,
+              (unsigned long)s_query.skipped, (unsigned long)s_query.reads);
+    CLI_OnExternalOutput();
+}
+
+static uint32_t SampleArchive_WaitMs(void)
+{
+    if (s_query.active && s_query.send)
+    {
+        return SAMPLE_ARCHIVE_RETRY_MS;
+    }
+
+    if (!s_pending || (s_phase != SAMPLE_ARCHIVE_PHASE_IDLE))
+    {
+        return 0U;
+    }
+
+    uint32_t age_ms = HAL_GetTick() - s_oldest_ms;
+    return (age_ms >= SAMPLE_ARCHIVE_MAX_AGE_MS) ? 1U : (SAMPLE_ARCHIVE_MAX_AGE_MS - age_ms);
+}
+
+static void SampleArchive_StartStatusRead(void)
+{
+    s_cmdTx[0] = NOR_CMD_READ_STATUS;
+    s_cmdTx[1] = 0xFFU;
+    SampleArchive_Segment(0U, s_cmdTx, s_cmdRx, 2U);
+    SampleArchive_Submit(1U, s_pollMs);
+}
+
+static void SampleArchive_Submit(uint32_t count, uint32_t poll_ms)
+{
+    s_frame.segments = s_segments;
+    s_frame.count    = (uint8_t)count;
+    s_frame.done     = SampleArchive_OnFrame;
+    s_frame.context  = NULL;
+    s_pollMs         = poll_ms;
+
+    /* Only one frame is ever in flight, so the bus never rejects it. */
+    (void)SpiBus_Submit(&s_frame);
+}
+
+static void SampleArchive_Segment(uint32_t index, const uint8_t *tx, uint8_t *rx, uint16_t length)
+{
+    s_segments[index].device = &s_device;
+    s_segments[index].tx     = tx;
+    s_segments[index].rx     = rx;
+    s_segments[index].length = length;
+}
+
+static void SampleArchive_Command(uint8_t *command, uint8_t opcode, uint32_t address)
+{
+    command[0] = opcode;
+    command[1] = (uint8_t)(address >> 16);
+    command[2] = (uint8_t)(address >> 8);
+    command[3] = (uint8_t)address;
+}
+
+static uint32_t SampleArchive_Address(uint32_t segment, uint32_t block)
+{
+    return (segment * SAMPLE_ARCHIVE_SEGMENT_SIZE) + (block * SAMPLE_ARCHIVE_BLOCK_SIZE);
+}
+
+static void SampleArchive_ParseHeader(uint32_t index, SampleArchiveBlock_t *header)
+{
+    memcpy(header, &s_probeRx[index][4], SAMPLE_ARCHIVE_HEADER_SIZE);
+}
+
+static bool SampleArchive_IsValid(const SampleArchiveBlock_t *block, uint32_t magic)
+{
+    return (block->magic == magic) && (block->length <= sizeof(block->payload)) &&
+           (block->crc == Crc32_Compute(block, offsetof(SampleArchiveBlock_t, crc)));
+}
+
+static void SampleArchive_Extend(SampleArchiveEntry_t *entry, const SampleArchiveBlock_t *block)
+{
+    if (entry->blocks == 0U)
+    {
+        entry->first_ms = block->first_ms;
+        entry->last_ms  = block->last_ms;
+        entry->min      = block->min;
+        entry->max      = block->max;
+        entry->boot     = block->boot;
+    }
+    else
+    {
+        if ((int32_t)(block->first_ms - entry->first_ms) < 0)
+        {
+            entry->first_ms = block->first_ms;
+        }
+        if ((int32_t)(block->last_ms - entry->last_ms) > 0)
+        {
+            entry->last_ms = block->last_ms;
+        }
+        if (block->min < entry->min)
+        {
+            entry->min = block->min;
+        }
+        if (block->max > entry->max)
+        {
+            entry->max = block->max;
+        }
+    }
+    entry->sensors |= block->sensors;
+    entry->blocks++;
+}
+
+static void SampleArchive_ClearEntries(SampleArchiveEntry_t *entries)
+{
+    memset(entries, 0, SAMPLE_ARCHIVE_INDEX_SEGMENTS * sizeof(SampleArchiveEntry_t));
+    for (uint32_t i = 0U; i < SAMPLE_ARCHIVE_INDEX_SEGMENTS; ++i)
+    {
+        entries[i].reserved = 0xFFU;
+    }
+}
+
+static void SampleArchive_Seal(void)
+{
+    s_buildActive = false;
+
+    if (s_codec.count == 0U)
+    {
+        return;
+    }
+
+    if (s_queueCount >= SAMPLE_ARCHIVE_QUEUE_BLOCKS)
+    {
+        s_stats.blocksDropped++;
+        return;
+    }
+
+    s_build.magic  = SAMPLE_ARCHIVE_MAGIC_DATA;
+    s_build.mode   = (uint8_t)SAMPLE_CODEC_DELTA;
+    s_build.count  = (uint8_t)s_codec.count;
+    s_build.length = (uint16_t)s_codec.length;
+    memset(&s_build.payload[s_codec.length], 0xFF, sizeof(s_build.payload) - s_codec.length);
+
+    /* The coroutine may run between the two under the RTOS backend. */
+    uint32_t key = AppTaskManager_Lock();
+    s_queue[(s_queueHead + s_queueCount) % SAMPLE_ARCHIVE_QUEUE_BLOCKS].block = s_build;
+    s_queueCount++;
+    AppTaskManager_Unlock(key);
+
+    if (s_queueCount >= SAMPLE_ARCHIVE_BURST_BLOCKS)
+    {
+        AppCoroutine_Signal(&s_coroutine);
+    }
+}
+
+static void SampleArchive_CmdArchive(uint32_t argc, char *argv[])
+{
+    if (argc < 2U)
+    {
+        SampleArchiveStats_t stats;
+        SampleArchive_GetStats(&stats);
+
+        CLI_Print("\r\nArchive: %s, %s", s_enabled ? "on" : "off",
+                  !stats.present ? ((s_phase == SAMPLE_ARCHIVE_PHASE_ABSENT) ? "no device" : "probing") :
+                  (stats.mounted ? "mounted" : "mounting"));
+        if (stats.present)
+        {
+            CLI_Print(", JEDEC 0x%06lX, %lu KB\r\n", (unsigned long)stats.jedecId,
+                      (unsigned long)((stats.segments * SAMPLE_ARCHIVE_SEGMENT_SIZE) / 1024U));
+            CLI_Print("  Boot %lu, segment %lu block %lu, %lu segment(s) used at mount, newest seq %lu\r\n",
+                      (unsigned long)stats.boot, (unsigned long)stats.writeSegment,
+                      (unsigned long)stats.writeBlock, (unsigned long)stats.segmentsUsed,
+                      (unsigned long)stats.newestSeq);
+        }
+        else
+        {
+            CLI_Print("\r\n");
+        }
+        CLI_Print("  Samples %lu, blocks %lu written, %lu queued, %lu dropped, %lu index\r\n",
+                  (unsigned long)stats.samples, (unsigned long)stats.blocksWritten,
+                  (unsigned long)stats.blocksQueued, (unsigned long)stats.blocksDropped,
+                  (unsigned long)stats.indexWritten);
+        CLI_Print("  Bursts %lu, erases %lu, errors %lu, device %s\r\n",
+                  (unsigned long)stats.bursts, (unsigned long)stats.erases,
+                  (unsigned long)stats.errors, s_awake ? "awake" : "powered down");
+        return;
+    }
+
+    if (strcmp(argv[1], "on") == 0)
+    {
+        SampleArchive_SetEnabled(true);
+        CLI_Print("\r\nArchive on\r\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "off") == 0)
+    {
+        SampleArchive_SetEnabled(false);
+        CLI_Print("\r\nArchive off\r\n");
+        return;
+    }
+
+    if ((s_phase != SAMPLE_ARCHIVE_PHASE_IDLE) || s_query.active || s_eraseRequest)
+    {
+        CLI_PrintError("\r\nArchive busy or not mounted\r\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "flush") == 0)
+    {
+        SampleArchive_Flush();
+        CLI_Print("\r\nArchive: %lu block(s) to write\r\n", (unsigned long)s_queueCount);
+        return;
+    }
+
+    if (strcmp(argv[1], "erase") == 0)
+    {
+        /* The coroutine drops the queue; the RAM block goes now. */
+        s_buildActive  = false;
+        s_pending      = false;
+        s_eraseRequest = true;
+        AppCoroutine_Signal(&s_coroutine);
+        CLI_Print("\r\nErasing archive...\r\n");
+        return;
+    }
+
+    CLI_PrintError("\r\nUsage: archive [on|off|flush|erase]\r\n");
+}
+
+static void SampleArchive_CmdQuery(uint32_t argc, char *argv[])
+{
+    char         *end  = NULL;
+    long          id   = -1L;
+    unsigned long from = 0UL;
+    unsigned long to   = 0UL;
+    unsigned long boot = s_stats.boot;
+    float         min  = -FLT_MAX;
+    float         max  = FLT_MAX;
+    bool          ok   = (argc >= 4U) && ((argc % 2U) == 0U);
+
+    if (ok && (strcmp(argv[1], "all") != 0))
+    {
+        id = (long)strtoul(argv[1], &end, 10);
+        ok = (*end == '\0') && (id <= 0xFFL);
+    }
+    if (ok)
+    {
+        from = strtoul(argv[2], &end, 10);
+        ok   = (*end == '\0');
+    }
+    if (ok)
+    {
+        to = strtoul(argv[3], &end, 10);
+        ok = (*end == '\0') && (from <= to);
+    }
+
+    for (uint32_t i = 4U; ok && (i < argc); i += 2U)
+    {
+        if (strcmp(argv[i], "min") == 0)
+        {
+            min = strtof(argv[i + 1U], &end);
+        }
+        else if (strcmp(argv[i], "max") == 0)
+        {
+            max = strtof(argv[i + 1U], &end);
+        }
+        else if (strcmp(argv[i], "boot") == 0)
+        {
+            boot = strtoul(argv[i + 1U], &end, 10);
+            ok   = (boot <= 0xFFFFUL);
+        }
+        else
+        {
+            ok = false;
+        }
+        ok = ok && (end != argv[i + 1U]) && (*end == '\0');
+    }
+
+    if (!ok)
+    {
+        CLI_PrintError("\r\nUsage: query <id|all> <from_ms> <to_ms> [min <v>] [max <v>] [boot <n>]\r\n");
+        return;
+    }
+
+    if ((s_phase != SAMPLE_ARCHIVE_PHASE_IDLE) || s_query.active || s_eraseRequest)
+    {
+        CLI_PrintError("\r\nArchive busy or not mounted\r\n");
+        return;
+    }
+
+    /* Flush first, so the range includes what is still in RAM. */
+    SampleArchive_Flush();
+
+    uint32_t groups = s_stats.segments / SAMPLE_ARCHIVE_INDEX_SEGMENTS;
+
+    s_query            = (SampleArchiveQuery_t){0};
+    s_query.from_ms    = (uint32_t)from;
+    s_query.to_ms      = (uint32_t)to;
+    s_query.boot       = (uint16_t)boot;
+    s_query.sensorId   = (int32_t)id;
+    s_query.min        = min;
+    s_query.max        = max;
+    s_query.group      = (s_entriesGroup + 1U) % groups;
+    s_query.groupsLeft = groups - 1U;
+    s_query.stage      = SAMPLE_ARCHIVE_QUERY_GROUP;
+    s_query.active     = true;
+    s_outActive        = false;
+    AppCoroutine_Signal(&s_coroutine);
+    CLI_Print("\r\nSearching archive...\r\n");
+}
@@ -0,0 +1,171 @@
+/**
+ * @file sample_archive.h
+ * @brief Append-only sample archive on an external SPI NOR flash.
+ *
+ * The on-chip flash log (flash_log.h) holds 16 KB; the archive keeps the
+ * reported samples on a serial NOR flash (W25Qxx or compatible, 128 KB to
+ * 16 MB, size read from the JEDEC ID) on the SPI bus (spi_bus.h), chip
+ * select @ref SAMPLE_ARCHIVE_CS_PIN on GPIOB. There is no file system:
+ * the device is one log of fixed-size blocks, written in order and
+ * overwritten a lap later.
+ *
+ * - A block is one 256-byte program page:
+ *
+ *       magic:u32 seq:u32 base_ms:u32 first_ms:u32 last_ms:u32
+ *       sensors:u32 min:f32 max:f32 boot:u16 length:u16 mode:u8 count:u8
+ *       payload[214] crc:u32
+ *
+ *   A data block carries a sample_codec.h batch, like a flash log page;
+ *   its header summarises it: time span, a bit per sensor (ID % 32) and
+ *   the value range.
+ * - A segment is one 4 KB erase sector of 16 blocks. Every boot starts a
+ *   new segment, so all blocks of a segment have the same @c boot (the
+ *   number of mounts, kept in the blocks themselves).
+ * - Every @ref SAMPLE_ARCHIVE_INDEX_SEGMENTS segments form a group. Block
+ *   0 of the first segment of each group is an index block for the
+ *   group before it: per segment the merged block summaries, boot and
+ *   block count.
+ *
+ * The `query` command reads one index block per group, binary searches it
+ * for the first segment not before the range, reads the 16 block headers
+ * of each segment whose summary matches (the per-block index) and then
+ * only the blocks that can hold a match. Matching samples are decoded,
+ * filtered and streamed as telemetry batches.
+ *
+ * Samples are encoded into a block in RAM; sealed blocks wait in a RAM
+ * queue and are written in bursts of @ref SAMPLE_ARCHIVE_BURST_BLOCKS,
+ * each block one DMA page program, so the device is woken from deep
+ * power-down once per burst instead of once per sample. A burst also
+ * starts once the oldest unwritten sample is
+ * @ref SAMPLE_ARCHIVE_MAX_AGE_MS old, or on SampleArchive_Flush().
+ *
+ * All device I/O runs in one coroutine (app_coroutine.h): mounting at
+ * boot (the newest block is found from the segment headers), bursts,
+ * sector erases and queries. Block timestamps are HAL ticks, which
+ * restart at every reset; queries select a boot for that reason.
+ *
+ * @ingroup common
+ */
+
+#ifndef SAMPLE_ARCHIVE_H
+#define SAMPLE_ARCHIVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sample_ring.h"
+
+/**
+ * @defgroup sample_archive Sample Archive
+ * @brief Log-structured sample blocks on an external SPI NOR flash.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Size of one block: the NOR program page. */
+#define SAMPLE_ARCHIVE_BLOCK_SIZE      (256U)
+
+/** @brief Blocks per segment (one 4 KB erase sector). */
+#define SAMPLE_ARCHIVE_SEGMENT_BLOCKS  (16U)
+
+/** @brief Sealed blocks buffered in RAM. */
+#define SAMPLE_ARCHIVE_QUEUE_BLOCKS    (8U)
+
+/**
+ * @brief Archive counters.
+ */
+typedef struct
+{
+    bool     present;       /**< A NOR flash answered the JEDEC ID.           */
+    bool     mounted;       /**< Write position found; blocks are written.    */
+    uint32_t jedecId;       /**< Manufacturer, type and capacity bytes.       */
+    uint32_t segments;      /**< Segments on the device.                      */
+    uint32_t segmentsUsed;  /**< Segments holding blocks at mount.            */
+    uint32_t writeSegment;  /**< Segment being written.                       */
+    uint32_t writeBlock;    /**< Next block in it.                            */
+    uint32_t boot;          /**< Boot number of the blocks written now.       */
+    uint32_t newestSeq;     /**< Sequence number of the newest block.         */
+    uint32_t blocksWritten; /**< Data blocks programmed since start-up.       */
+    uint32_t blocksQueued;  /**< Sealed blocks waiting in RAM.                */
+    uint32_t blocksDropped; /**< Blocks lost because the RAM queue was full.  */
+    uint32_t indexWritten;  /**< Index blocks programmed since start-up.      */
+    uint32_t samples;       /**< Samples added since start-up.                */
+    uint32_t bursts;        /**< Device wake-ups that wrote blocks.           */
+    uint32_t erases;        /**< Sector erases since start-up.                */
+    uint32_t errors;        /**< Failed transfers.                            */
+} SampleArchiveStats_t;
+
+/**
+ * @brief Configure the chip select, start the archive coroutine and
+ *        register the "archive" and "query" CLI commands.
+ *
+ * Call after SpiBus_Init() and AppCoroutine_Init(). Mounting runs in the
+ * background; samples added meanwhile wait in the RAM queue.
+ *
+ * @return None.
+ */
+void SampleArchive_Init(void);
+
+/**
+ * @brief Turn archiving on or off.
+ *
+ * Turning it off seals the RAM block, so it is still written.
+ *
+ * @param enable true to archive samples.
+ *
+ * @return None.
+ */
+void SampleArchive_SetEnabled(bool enable);
+
+/**
+ * @brief Whether archiving is on.
+ *
+ * @return true if SampleArchive_AddSample() stores samples.
+ */
+bool SampleArchive_IsEnabled(void);
+
+/**
+ * @brief Add a sample to the RAM block.
+ *
+ * Task context only.
+ *
+ * @param sample Sample to store.
+ *
+ * @return false if archiving is off, no device was found or @p sample
+ *         is NULL.
+ */
+bool SampleArchive_AddSample(const SensorSample_t *sample);
+
+/**
+ * @brief Seal the RAM block and write everything queued now.
+ *
+ * @return None.
+ */
+void SampleArchive_Flush(void);
+
+/**
+ * @brief Whether nothing waits in RAM and the device is not in use.
+ *
+ * @return true once every added sample has been written.
+ */
+bool SampleArchive_IsIdle(void);
+
+/**
+ * @brief Snapshot the archive counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void SampleArchive_GetStats(SampleArchiveStats_t *stats);
+
+/** @} */ /* end of sample_archive group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_ARCHIVE_H */
@@ -0,0 +1,361 @@
+/**
+ * @file sample_codec.c
+ * @brief Delta/varint batch encoder and decoder implementation.
+ *
+ * Each record is first assembled in a small scratch buffer so that a
+ * sample which cannot be encoded leaves the batch untouched. Stream
+ * lookup is a linear scan: batches hold a handful of sensors.
+ *
+ * @ingroup sample_codec
+ */
+
+#include "sample_codec.h"
+#include <string.h>
+
+/** @brief Largest delta-of-delta or scaled value kept exact in a tag. */
+#define SAMPLE_CODEC_FIELD_LIMIT   (1L << 30)
+
+/**
+ * @brief Map a signed value to unsigned so small magnitudes stay small.
+ */
+static inline uint32_t SampleCodec_ZigZag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Inverse of SampleCodec_ZigZag().
+ */
+static inline int32_t SampleCodec_UnZigZag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1U);
+}
+
+/**
+ * @brief Write an unsigned LEB128 varint.
+ *
+ * @return Bytes written (1..5).
+ */
+static size_t SampleCodec_PutVarint(uint8_t *dst, uint32_t value);
+
+/**
+ * @brief Write a float XOR field.
+ *
+ * @return Bytes written (1..5).
+ */
+static size_t SampleCodec_PutXor(uint8_t *dst, uint32_t x);
+
+/**
+ * @brief Read an unsigned LEB128 varint at the reader position.
+ *
+ * @return false if the batch ends inside it or it exceeds 32 bits.
+ */
+static bool SampleCodec_GetVarint(SampleCodecReader_t *reader, uint32_t *value);
+
+/**
+ * @brief Scale and round a value for delta mode, saturating.
+ */
+static int32_t SampleCodec_Quantize(float value);
+
+/**
+ * @brief Find the history of @p id, or NULL.
+ */
+static SampleCodecStream_t *SampleCodec_FindStream(SampleCodec_t *codec, uint8_t id);
+
+/* ------------------------------------------------------------------------- */
+
+void SampleCodec_Begin(SampleCodec_t *codec, SampleCodecMode_t mode, uint32_t base_ms,
+                       uint8_t *buf, size_t capacity)
+{
+    codec->buf         = buf;
+    codec->capacity    = capacity;
+    codec->length      = 0U;
+    codec->count       = 0U;
+    codec->base_ms     = base_ms;
+    codec->mode        = mode;
+    codec->lastId      = 0U;
+    codec->streamCount = 0U;
+}
+
+bool SampleCodec_Add(SampleCodec_t *codec, const SensorSample_t *sample)
+{
+    if ((codec->capacity - codec->length) < SAMPLE_CODEC_MAX_RECORD_SIZE)
+    {
+        return false;
+    }
+
+    SampleCodecStream_t *stream = SampleCodec_FindStream(codec, sample->sensorId);
+    uint32_t             ts     = sample->timestamp;
+    int64_t              tsField;
+    int32_t              dt     = 0;
+
+    if (stream == NULL)
+    {
+        if (codec->streamCount >= SAMPLE_CODEC_MAX_STREAMS)
+        {
+            return false;
+        }
+        tsField = (int32_t)(ts - codec->base_ms);
+    }
+    else
+    {
+        dt      = (int32_t)(ts - stream->lastTs);
+        tsField = (int64_t)dt - stream->lastDt;
+    }
+
+    if ((tsField >= SAMPLE_CODEC_FIELD_LIMIT) || (tsField <= -SAMPLE_CODEC_FIELD_LIMIT))
+    {
+        return false;
+    }
+
+    uint8_t  record[SAMPLE_CODEC_MAX_RECORD_SIZE];
+    bool     newId = (codec->count == 0U) || (sample->sensorId != codec->lastId);
+    uint32_t tag   = (SampleCodec_ZigZag((int32_t)tsField) << 1) | (newId ? 1U : 0U);
+    size_t   len   = SampleCodec_PutVarint(record, tag);
+
+    if (newId)
+    {
+        record[len++] = sample->sensorId;
+    }
+
+    uint32_t value;
+    uint32_t previous = (stream != NULL) ? stream->lastValue : 0U;
+
+    float    x        = SensorData_GetFloat(sample, 0U);
+
+    if (codec->mode == SAMPLE_CODEC_XOR)
+    {
+        memcpy(&value, &x, sizeof(value));
+        len += SampleCodec_PutXor(&record[len], value ^ previous);
+    }
+    else
+    {
+        int32_t q = SampleCodec_Quantize(x);
+        value = (uint32_t)q;
+        len  += SampleCodec_PutVarint(&record[len], SampleCodec_ZigZag(q - (int32_t)previous));
+    }
+
+    if (stream == NULL)
+    {
+        stream     = &codec->streams[codec->streamCount++];
+        stream->id = sample->sensorId;
+    }
+
+    stream->lastTs    = ts;
+    stream->lastDt    = dt;
+    stream->lastValue = value;
+
+    memcpy(&codec->buf[codec->length], record, len);
+    codec->length += len;
+    codec->count++;
+    codec->lastId = sample->sensorId;
+
+    return true;
+}
+
+void SampleCodec_BeginRead(SampleCodecReader_t *reader, SampleCodecMode_t mode, uint32_t base_ms,
+                           const uint8_t *buf, size_t length)
+{
+    reader->buf         = buf;
+    reader->length      = length;
+    reader->offset      = 0U;
+    reader->base_ms     = base_ms;
+    reader->mode        = mode;
+    reader->lastId      = 0U;
+    reader->streamCount = 0U;
+}
+
+bool SampleCodec_Read(SampleCodecReader_t *reader, SampleCodecRecord_t *record)
+{
+    uint32_t tag = 0U;
+
+    if ((reader->offset >= reader->length) || !SampleCodec_GetVarint(reader, &tag))
+    {
+        return false;
+    }
+
+    uint8_t id = reader->lastId;
+    if ((tag & 1U) != 0U)
+    {
+        if (reader->offset >= reader->length)
+        {
+            return false;
+        }
+        id = reader->buf[reader->offset++];
+    }
+    else if (reader->streamCount == 0U)
+    {
+        /* The first record always carries the ID. */
+        return false;
+    }
+
+    SampleCodecStream_t *stream  = NULL;
+    int32_t              tsField = SampleCodec_UnZigZag(tag >> 1);
+
+    for (uint32_t i = 0U; i < reader->streamCount; ++i)
+    {
+        if (reader->streams[i].id == id)
+        {
+            stream = &reader->streams[i];
+            break;
+        }
+    }
+
+    if (stream == NULL)
+    {
+        if (reader->streamCount >= SAMPLE_CODEC_MAX_STREAMS)
+        {
+            return false;
+        }
+        stream            = &reader->streams[reader->streamCount++];
+        stream->id        = id;
+        stream->lastTs    = reader->base_ms + (uint32_t)tsField;
+        stream->lastDt    = 0;
+        stream->lastValue = 0U;
+    }
+    else
+    {
+        stream->lastDt += tsField;
+        stream->lastTs += (uint32_t)stream->lastDt;
+    }
+
+    if (reader->mode == SAMPLE_CODEC_XOR)
+    {
+        if (reader->offset >= reader->length)
+        {
+            return false;
+        }
+
+        uint8_t  control  = reader->buf[reader->offset++];
+        uint32_t count    = control & 0x0FU;
+        uint32_t trailing = control >> 4;
+        uint32_t x        = 0U;
+
+        if (((count + trailing) > 4U) || ((reader->length - reader->offset) < count))
+        {
+            return false;
+        }
+        for (uint32_t i = 0U; i < count; ++i)
+        {
+            x |= (uint32_t)reader->buf[reader->offset++] << (8U * (trailing + i));
+        }
+
+        stream->lastValue ^= x;
+        memcpy(&record->value, &stream->lastValue, sizeof(record->value));
+    }
+    else
+    {
+        uint32_t delta = 0U;
+
+        if (!SampleCodec_GetVarint(reader, &delta))
+        {
+            return false;
+        }
+
+        stream->lastValue = (uint32_t)((int32_t)stream->lastValue + SampleCodec_UnZigZag(delta));
+        record->value     = (float)(int32_t)stream->lastValue / (float)SAMPLE_CODEC_DELTA_SCALE;
+    }
+
+    reader->lastId    = id;
+    record->sensorId  = id;
+    record->timestamp = stream->lastTs;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static size_t SampleCodec_PutVarint(uint8_t *dst, uint32_t value)
+{
+    size_t len = 0U;
+
+    while (value >= 0x80U)
+    {
+        dst[len++] = (uint8_t)(value | 0x80U);
+        value >>= 7;
+    }
+    dst[len++] = (uint8_t)value;
+
+    return len;
+}
+
+static size_t SampleCodec_PutXor(uint8_t *dst, uint32_t x)
+{
+    if (x == 0U)
+    {
+        dst[0] = 0x00U;
+        return 1U;
+    }
+
+    uint32_t trailing = 0U;
+    while ((x & 0xFFU) == 0U)
+    {
+        x >>= 8;
+        trailing++;
+    }
+
+    uint32_t count = 0U;
+    while (x != 0U)
+    {
+        dst[1U + count] = (uint8_t)x;
+        x >>= 8;
+        count++;
+    }
+
+    dst[0] = (uint8_t)((trailing << 4) | count);
+    return 1U + count;
+}
+
+static bool SampleCodec_GetVarint(SampleCodecReader_t *reader, uint32_t *value)
+{
+    uint32_t result = 0U;
+
+    for (uint32_t shift = 0U; shift < 35U; shift += 7U)
+    {
+        if (reader->offset >= reader->length)
+        {
+            return false;
+        }
+
+        uint8_t byte = reader->buf[reader->offset++];
+        result |= (uint32_t)(byte & 0x7FU) << shift;
+        if ((byte & 0x80U) == 0U)
+        {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int32_t SampleCodec_Quantize(float value)
+{
+    float scaled = value * (float)SAMPLE_CODEC_DELTA_SCALE;
+
+    /* Written so that NaN saturates too. */
+    if (!(scaled < (float)SAMPLE_CODEC_FIELD_LIMIT))
+    {
+        return (int32_t)SAMPLE_CODEC_FIELD_LIMIT - 1;
+    }
+    if (scaled <= -(float)SAMPLE_CODEC_FIELD_LIMIT)
+    {
+        return -(int32_t)SAMPLE_CODEC_FIELD_LIMIT + 1;
+    }
+
+    return (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+}
+
+static SampleCodecStream_t *SampleCodec_FindStream(SampleCodec_t *codec, uint8_t id)
+{
+    for (uint32_t i = 0U; i < codec->streamCount; ++i)
+    {
+        if (codec->streams[i].id == id)
+        {
+            return &codec->streams[i];
+        }
+    }
+
+    return NULL;
+}
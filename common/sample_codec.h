@@ -0,0 +1,190 @@
+/**
+ * @file sample_codec.h
+ * @brief Delta/varint batch encoder and decoder for sensor samples.
+ *
+ * Consecutive samples of one sensor are highly redundant: timestamps
+ * advance by the sampling period and values change slowly. The encoder
+ * keeps, per sensor, the previous timestamp, interval and value of the
+ * batch and stores only what changed:
+ *
+ *     record = tag:varint [id:u8] value
+ *     tag    = (zigzag(ts_field) << 1) | id_present
+ *
+ * - id_present is set on the first record and whenever the sensor ID
+ *   differs from the previous record.
+ * - ts_field is the timestamp relative to the batch base for the first
+ *   sample of a sensor, and the change of interval (delta-of-delta)
+ *   afterwards, so a steady period encodes as 0.
+ * - value, @ref SAMPLE_CODEC_DELTA: zigzag varint of the change of the
+ *   value in units of 1/@ref SAMPLE_CODEC_DELTA_SCALE (the first sample
+ *   of a sensor is relative to 0).
+ * - value, @ref SAMPLE_CODEC_XOR (lossless): the float bits XOR the
+ *   previous bits, as a control byte (trailing zero bytes << 4 | byte
+ *   count) followed by the significant bytes; 0x00 if unchanged.
+ *
+ * The value is the sample's first channel (SensorData_GetFloat()); the
+ * other channels and the quality bits are not stored.
+ *
+ * Varints are unsigned LEB128. A batch is self-contained: it can be
+ * decoded on its own given its base timestamp and mode, which callers
+ * store in their own header (telemetry frames, flash log pages). A
+ * steadily sampled, slowly changing sensor costs two bytes per sample.
+ * SampleCodec_Read() decodes a batch record by record, for stored batches
+ * that are filtered before they are sent (sample_archive.h).
+ *
+ * @ingroup common
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+
+/**
+ * @defgroup sample_codec Sample Codec
+ * @brief Compact, self-contained encoding of sample batches.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Distinct sensors per batch. */
+#define SAMPLE_CODEC_MAX_STREAMS      (16U)
+
+/** @brief Delta mode resolution: stored value = value * SAMPLE_CODEC_DELTA_SCALE. */
+#define SAMPLE_CODEC_DELTA_SCALE      (100)
+
+/** @brief Largest encoded record: 5-byte tag, ID, 5-byte value. */
+#define SAMPLE_CODEC_MAX_RECORD_SIZE  (11U)
+
+/**
+ * @brief Value encoding.
+ */
+typedef enum
+{
+    SAMPLE_CODEC_DELTA = 0U, /**< Scaled integer deltas, 0.01 resolution.  */
+    SAMPLE_CODEC_XOR         /**< Float XOR with the previous value, exact. */
+} SampleCodecMode_t;
+
+/**
+ * @brief Per-sensor history within a batch.
+ */
+typedef struct
+{
+    uint8_t  id;        /**< Sensor ID.                                  */
+    uint32_t lastTs;    /**< Previous timestamp (ms).                    */
+    int32_t  lastDt;    /**< Previous interval (ms).                     */
+    uint32_t lastValue; /**< Previous scaled value or float bits.        */
+} SampleCodecStream_t;
+
+/**
+ * @brief Batch encoder state.
+ *
+ * @ref length and @ref count may be read by the caller; everything else
+ * is private to the codec.
+ */
+typedef struct
+{
+    uint8_t            *buf;         /**< Output buffer.                     */
+    size_t              capacity;    /**< Size of @ref buf.                  */
+    size_t              length;      /**< Bytes encoded so far.              */
+    uint32_t            count;       /**< Samples encoded so far.            */
+    uint32_t            base_ms;     /**< Batch base timestamp.              */
+    SampleCodecMode_t   mode;        /**< Value encoding.                    */
+    uint8_t             lastId;      /**< Sensor of the previous record.     */
+    uint32_t            streamCount; /**< Entries used in @ref streams.      */
+    SampleCodecStream_t streams[SAMPLE_CODEC_MAX_STREAMS]; /**< Histories.   */
+} SampleCodec_t;
+
+/**
+ * @brief Batch decoder state; private to the codec.
+ */
+typedef struct
+{
+    const uint8_t      *buf;         /**< Encoded batch.                     */
+    size_t              length;      /**< Size of @ref buf.                  */
+    size_t              offset;      /**< Next record.                       */
+    uint32_t            base_ms;     /**< Batch base timestamp.              */
+    SampleCodecMode_t   mode;        /**< Value encoding.                    */
+    uint8_t             lastId;      /**< Sensor of the previous record.     */
+    uint32_t            streamCount; /**< Entries used in @ref streams.      */
+    SampleCodecStream_t streams[SAMPLE_CODEC_MAX_STREAMS]; /**< Histories.   */
+} SampleCodecReader_t;
+
+/**
+ * @brief One decoded record.
+ */
+typedef struct
+{
+    uint8_t  sensorId;  /**< Sensor ID.                                      */
+    uint32_t timestamp; /**< Sample timestamp (ms).                          */
+    float    value;     /**< First channel (0.01 resolution in delta mode).  */
+} SampleCodecRecord_t;
+
+/**
+ * @brief Start a new batch.
+ *
+ * @param codec    Encoder state.
+ * @param mode     Value encoding.
+ * @param base_ms  Base timestamp (usually that of the first sample).
+ * @param buf      Output buffer.
+ * @param capacity Size of @p buf.
+ *
+ * @return None.
+ */
+void SampleCodec_Begin(SampleCodec_t *codec, SampleCodecMode_t mode, uint32_t base_ms,
+                       uint8_t *buf, size_t capacity);
+
+/**
+ * @brief Append a sample to the batch.
+ *
+ * Fails without writing anything if fewer than
+ * @ref SAMPLE_CODEC_MAX_RECORD_SIZE bytes are left, if the sample is from
+ * a new sensor and @ref SAMPLE_CODEC_MAX_STREAMS are already in use, or
+ * if its timestamp is more than 2^30 ms away from the batch history. The
+ * caller then closes the batch and starts a new one.
+ *
+ * @param codec  Encoder state.
+ * @param sample Sample to encode.
+ *
+ * @return true if the sample was encoded.
+ */
+bool SampleCodec_Add(SampleCodec_t *codec, const SensorSample_t *sample);
+
+/**
+ * @brief Start decoding a batch.
+ *
+ * @param reader  Decoder state.
+ * @param mode    Value encoding of the batch.
+ * @param base_ms Base timestamp of the batch.
+ * @param buf     Encoded batch.
+ * @param length  Size of @p buf.
+ *
+ * @return None.
+ */
+void SampleCodec_BeginRead(SampleCodecReader_t *reader, SampleCodecMode_t mode, uint32_t base_ms,
+                           const uint8_t *buf, size_t length);
+
+/**
+ * @brief Decode the next record of the batch.
+ *
+ * @param reader Decoder state.
+ * @param record Receives the record.
+ *
+ * @return false at the end of the batch or at a malformed record.
+ */
+bool SampleCodec_Read(SampleCodecReader_t *reader, SampleCodecRecord_t *record);
+
+/** @} */ /* end of sample_codec group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_CODEC_H */
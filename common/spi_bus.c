@@ -0,0 +1,412 @@
+/**
+ * @file spi_bus.c
+ * @brief SPI bus manager: frame queue and segment chaining.
+ *
+ * The queue is an intrusive singly linked list through the frames, changed
+ * only with interrupts masked or from the DMA completion interrupt. One
+ * frame is on the wire at a time. Its segments are started one after the
+ * other from SpiBus_OnHwDone(): the next chip-select window opens before
+ * any bookkeeping, and the next frame starts before the finished frame's
+ * callback runs, so the bus stays busy while drivers consume their data.
+ *
+ * @ingroup spi_bus
+ */
+
+#include "spi_bus.h"
+#include "spi_bus_hw.h"
+#include "cli.h"
+#include "cycle_counter.h"
+#include "time_base.h"
+#include "app_config.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Devices of the "spi test" frame. */
+#define SPI_BUS_TEST_DEVICES   (4U)
+
+/** @brief Bytes per test segment: a read command and three 16-bit axes. */
+#define SPI_BUS_TEST_LENGTH    (7U)
+
+/** @brief Duration of "spi test" (ms). */
+#define SPI_BUS_TEST_MS        (100U)
+
+/** @brief Aggregate rate the CPU cost is projected to by "spi test". */
+#define SPI_BUS_TEST_SPS       (10000U)
+
+/** @brief Waiting frames, oldest first. */
+static SpiBusFrame_t *s_head = NULL;
+static SpiBusFrame_t *s_tail = NULL;
+
+/** @brief Frame on the wire (NULL when idle). */
+static SpiBusFrame_t *s_active = NULL;
+
+/** @brief Segment of the active frame on the wire. */
+static uint32_t s_segment = 0U;
+
+/** @brief Start of the active frame (tick and time base). */
+static uint32_t s_frameStart_ms = 0U;
+static uint32_t s_frameStart_us = 0U;
+
+/** @brief Counters reported by SpiBus_GetStats(). */
+static SpiBusStats_t s_stats;
+
+/** @brief Chip selects of the "spi test" devices (free GPIOB pins). */
+static const SpiBusDevice_t s_testDevice[SPI_BUS_TEST_DEVICES] =
+{
+    { GPIO_PIN_12, 3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_1,  3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_2,  3U, SPI_BUS_TEST_HZ },
+    { GPIO_PIN_10, 3U, SPI_BUS_TEST_HZ }
+};
+
+/** @brief Test command: burst read from register 0x28 (read bit set). */
+static const uint8_t s_testTx[SPI_BUS_TEST_LENGTH] = { 0xA8U, 0U, 0U, 0U, 0U, 0U, 0U };
+
+/** @brief Test receive buffers, one per device. */
+static uint8_t s_testRx[SPI_BUS_TEST_DEVICES][SPI_BUS_TEST_LENGTH];
+
+/** @brief Test frame and its segments. */
+static SpiBusSegment_t s_testSegment[SPI_BUS_TEST_DEVICES];
+static SpiBusFrame_t   s_testFrame;
+
+/** @brief Test frames are resubmitted from the callback while set. */
+static volatile bool s_testRunning = false;
+
+/**
+ * @brief Start the frame at the head of the queue, if the bus is free.
+ *        Interrupts must be masked.
+ */
+static void SpiBus_StartNext(void);
+
+/**
+ * @brief Hand a finished frame back to its owner and run the callback.
+ */
+static void SpiBus_Finish(SpiBusFrame_t *frame, SpiBusResult_t result);
+
+/**
+ * @brief Test frame callback: resubmit while the test runs.
+ */
+static void SpiBus_TestDone(SpiBusFrame_t *frame);
+
+/**
+ * @brief CLI "spi" handler.
+ */
+static void SpiBus_CmdSpi(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void SpiBus_Init(void)
+{
+    s_head   = NULL;
+    s_tail   = NULL;
+    s_active = NULL;
+    s_stats  = (SpiBusStats_t){0};
+
+    SpiBusHw_Init();
+
+    for (uint32_t i = 0U; i < SPI_BUS_TEST_DEVICES; ++i)
+    {
+        SpiBus_InitDevice(&s_testDevice[i]);
+    }
+
+    (void)CLI_RegisterCommand("spi", SpiBus_CmdSpi, "[test [n]] - SPI bus stats and throughput test");
+}
+
+void SpiBus_InitDevice(const SpiBusDevice_t *device)
+{
+    if (device != NULL)
+    {
+        SpiBusHw_InitCs(device->csPin);
+    }
+}
+
+bool SpiBus_Submit(SpiBusFrame_t *frame)
+{
+    if ((frame == NULL) || (frame->segments == NULL) || (frame->count == 0U))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0U; i < frame->count; ++i)
+    {
+        if ((frame->segments[i].device == NULL) || (frame->segments[i].length == 0U))
+        {
+            return false;
+        }
+    }
+
+    bool accepted = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((frame->state == SPI_BUS_FRAME_QUEUED) || (frame->state == SPI_BUS_FRAME_ACTIVE))
+    {
+        s_stats.rejected++;
+    }
+    else
+    {
+        frame->next   = NULL;
+        frame->state  = SPI_BUS_FRAME_QUEUED;
+        frame->result = SPI_BUS_OK;
+
+        if (s_tail != NULL)
+        {
+            s_tail->next = frame;
+        }
+        else
+        {
+            s_head = frame;
+        }
+        s_tail = frame;
+
+        s_stats.submitted++;
+        s_stats.queued++;
+        if (s_stats.queued > s_stats.queueHigh)
+        {
+            s_stats.queueHigh = s_stats.queued;
+        }
+
+        SpiBus_StartNext();
+        accepted = true;
+    }
+
+    __set_PRIMASK(primask);
+
+    return accepted;
+}
+
+void SpiBus_OnHwDone(SpiBusResult_t result)
+{
+    uint32_t       entry  = CycleCounter_Now();
+    SpiBusFrame_t *frame  = s_active;
+    uint32_t       length = frame->segments[s_segment].length;
+
+    if (result == SPI_BUS_OK)
+    {
+        s_segment++;
+        if (s_segment < frame->count)
+        {
+            /* Open the next chip-select window before anything else. */
+            SpiBusHw_Start(&frame->segments[s_segment]);
+        }
+        s_stats.segments++;
+        s_stats.bytes += length;
+    }
+
+    if ((result != SPI_BUS_OK) || (s_segment >= frame->count))
+    {
+        uint32_t span = Time_NowUs32() - s_frameStart_us;
+
+        s_stats.lastFrame_us = span;
+        if (span > s_stats.maxFrame_us)
+        {
+            s_stats.maxFrame_us = span;
+        }
+        if (result != SPI_BUS_OK)
+        {
+            s_stats.errors++;
+        }
+
+        s_active = NULL;
+        SpiBus_StartNext();
+        SpiBus_Finish(frame, result);
+
+        if ((s_active == NULL) && (s_head == NULL))
+        {
+            SpiBusHw_Release();
+        }
+    }
+
+    s_stats.isrCycles += CycleCounter_Now() - entry;
+}
+
+void SpiBus_Service(uint32_t now_ms)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if ((s_active != NULL) && ((now_ms - s_frameStart_ms) > SPI_BUS_TIMEOUT_MS))
+    {
+        SpiBusFrame_t *frame = s_active;
+
+        SpiBusHw_Abort();
+        s_stats.timeouts++;
+        s_active = NULL;
+
+        SpiBus_StartNext();
+        SpiBus_Finish(frame, SPI_BUS_TIMEOUT);
+    }
+
+    if ((s_active == NULL) && (s_head == NULL))
+    {
+        SpiBusHw_Release();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+bool SpiBus_IsIdle(void)
+{
+    return (s_active == NULL) && (s_head == NULL);
+}
+
+void SpiBus_GetStats(SpiBusStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_stats;
+    __set_PRIMASK(primask);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void SpiBus_StartNext(void)
+{
+    if ((s_active != NULL) || (s_head == NULL))
+    {
+        return;
+    }
+
+    SpiBusFrame_t *frame = s_head;
+
+    s_head = frame->next;
+    if (s_head == NULL)
+    {
+        s_tail = NULL;
+    }
+    frame->next  = NULL;
+    frame->state = SPI_BUS_FRAME_ACTIVE;
+
+    s_active        = frame;
+    s_segment       = 0U;
+    s_frameStart_ms = HAL_GetTick();
+    s_frameStart_us = Time_NowUs32();
+
+    SpiBusHw_Start(&frame->segments[0]);
+}
+
+static void SpiBus_Finish(SpiBusFrame_t *frame, SpiBusResult_t result)
+{
+    frame->result = result;
+    s_stats.queued--;
+    s_stats.frames++;
+
+    /* From here the frame is the driver's again. */
+    __DMB();
+    frame->state = SPI_BUS_FRAME_DONE;
+
+    if (frame->done != NULL)
+    {
+        frame->done(frame);
+    }
+}
+
+static void SpiBus_TestDone(SpiBusFrame_t *frame)
+{
+    if (s_testRunning && (frame->result == SPI_BUS_OK))
+    {
+        (void)SpiBus_Submit(frame);
+    }
+}
+
+static void SpiBus_CmdSpi(uint32_t argc, char *argv[])
+{
+    if ((argc >= 2U) && (strcmp(argv[1], "test") == 0))
+    {
+        char         *end     = NULL;
+        unsigned long devices = (argc == 3U) ? strtoul(argv[2], &end, 10) : SPI_BUS_TEST_DEVICES;
+
+        if ((argc > 3U) || ((argc == 3U) && ((end == argv[2]) || (*end != '\0'))) ||
+            (devices == 0UL) || (devices > SPI_BUS_TEST_DEVICES))
+        {
+            CLI_PrintError("\r\nUsage: spi test [1-%u]\r\n", (unsigned)SPI_BUS_TEST_DEVICES);
+            return;
+        }
+        if ((s_testFrame.state == SPI_BUS_FRAME_QUEUED) || (s_testFrame.state == SPI_BUS_FRAME_ACTIVE))
+        {
+            CLI_Print("\r\nTest frame still on the bus\r\n");
+            return;
+        }
+
+        for (uint32_t i = 0U; i < devices; ++i)
+        {
+            s_testSegment[i] = (SpiBusSegment_t){ &s_testDevice[i], s_testTx, s_testRx[i], SPI_BUS_TEST_LENGTH };
+        }
+        s_testFrame.segments = s_testSegment;
+        s_testFrame.count    = (uint8_t)devices;
+        s_testFrame.done     = SpiBus_TestDone;
+        s_testFrame.context  = NULL;
+
+        SpiBusStats_t before;
+        SpiBus_GetStats(&before);
+
+        /* Frames back to back for a fixed time: the highest rate the bus
+         * reaches, and the interrupt cost of every sample.
+         */
+        s_testRunning = true;
+        uint32_t start = HAL_GetTick();
+        (void)SpiBus_Submit(&s_testFrame);
+        while ((HAL_GetTick() - start) < SPI_BUS_TEST_MS)
+        {
+            SpiBus_Service(HAL_GetTick());
+        }
+        s_testRunning = false;
+        while (s_testFrame.state != SPI_BUS_FRAME_DONE)
+        {
+            SpiBus_Service(HAL_GetTick());
+        }
+
+        SpiBusStats_t after;
+        SpiBus_GetStats(&after);
+
+        uint32_t samples   = after.segments - before.segments;
+        uint32_t cycles    = after.isrCycles - before.isrCycles;
+        float    perSample = (samples > 0U) ? ((float)cycles / (float)samples) : 0.0f;
+        float    clock     = (float)SystemCoreClock;
+        float    rate      = ((float)samples * 1000.0f) / (float)SPI_BUS_TEST_MS;
+
+        CLI_Print("\r\nSPI test: %lu device(s), %lu frames, %lu samples/s\r\n",
+                  devices, (unsigned long)(after.frames - before.frames), (unsigned long)rate);
+        CLI_Print("  Frame time %lu us (max %lu us), errors %lu\r\n",
+                  (unsigned long)after.lastFrame_us, (unsigned long)after.maxFrame_us,
+                  (unsigned long)(after.errors - before.errors));
+        CLI_Print("  Interrupt cost %.0f cycles/sample: %.1f %% CPU at this rate, %.2f %% at %u samples/s\r\n",
+                  (double)perSample,
+                  (double)((perSample * rate * 100.0f) / clock),
+                  (double)((perSample * (float)SPI_BUS_TEST_SPS * 100.0f) / clock),
+                  (unsigned)SPI_BUS_TEST_SPS);
+        CLI_Print("  Device 0 last read: %02x %02x %02x %02x %02x %02x\r\n",
+                  (unsigned)s_testRx[0][1], (unsigned)s_testRx[0][2], (unsigned)s_testRx[0][3],
+                  (unsigned)s_testRx[0][4], (unsigned)s_testRx[0][5], (unsigned)s_testRx[0][6]);
+        return;
+    }
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: spi [test [n]]\r\n");
+        return;
+    }
+
+    SpiBusStats_t stats;
+    SpiBus_GetStats(&stats);
+
+    CLI_Print("\r\nSPI bus (%s)\r\n", SpiBus_IsIdle() ? "idle" : "busy");
+    CLI_Print("  Frames submitted %lu, done %lu, rejected %lu, queued %lu (max %lu)\r\n",
+              (unsigned long)stats.submitted, (unsigned long)stats.frames,
+              (unsigned long)stats.rejected, (unsigned long)stats.queued,
+              (unsigned long)stats.queueHigh);
+    CLI_Print("  Segments %lu, bytes %lu, errors %lu, timeouts %lu\r\n",
+              (unsigned long)stats.segments, (unsigned long)stats.bytes,
+              (unsigned long)stats.errors, (unsigned long)stats.timeouts);
+    CLI_Print("  Frame time last %lu us, max %lu us\r\n",
+              (unsigned long)stats.lastFrame_us, (unsigned long)stats.maxFrame_us);
+}
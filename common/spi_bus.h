@@ -0,0 +1,197 @@
+/**
+ * @file spi_bus.h
+ * @brief Shared SPI bus: acquisition frames chained over full-duplex DMA.
+ *
+ * High-rate sensors sit on one SPI bus, each with its own chip select.
+ * A driver describes what it transfers in one acquisition as a
+ * @ref SpiBusFrame_t: a list of segments, each one chip-select window
+ * with a device, a TX and an RX buffer. Several devices sampled together
+ * go into one frame. The bus runs the segments back to back: the DMA
+ * completion interrupt raises the chip select of one segment and starts
+ * the next one, so the gap between devices is one interrupt entry, and
+ * the driver gets one callback per frame.
+ *
+ * Ownership follows the same rule as the I2C bus (i2c_bus.h): a frame
+ * belongs to the bus from SpiBus_Submit() until its callback runs, and
+ * a frame still owned by the bus is rejected. Frames, segments and
+ * buffers live in the drivers' static storage.
+ *
+ * The hardware side (spi_bus_hw.c: SPI2 on PB13/PB14/PB15, DMA1
+ * Stream3/4, chip selects on GPIOB) is a separate port, so that the
+ * host simulation can replace it.
+ *
+ * @ingroup common
+ */
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup spi_bus SPI Bus Manager
+ * @brief Frame queue shared by the SPI sensor drivers.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief A device on the bus.
+ */
+typedef struct
+{
+    uint16_t csPin;  /**< Chip select: a GPIOB pin mask (GPIO_PIN_x), active low. */
+    uint8_t  mode;   /**< SPI mode 0-3 (CPOL << 1 | CPHA).                        */
+    uint32_t maxHz;  /**< Highest SCK frequency the device accepts.               */
+} SpiBusDevice_t;
+
+/**
+ * @brief One chip-select window: @c length bytes out and in at once.
+ */
+typedef struct
+{
+    const SpiBusDevice_t *device; /**< Device selected.                      */
+    const uint8_t        *tx;     /**< Bytes sent, or NULL to send 0xFF.     */
+    uint8_t              *rx;     /**< Bytes received, or NULL to drop them. */
+    uint16_t              length; /**< Bytes (1 to 65535).                   */
+} SpiBusSegment_t;
+
+/**
+ * @brief Who owns a frame.
+ */
+typedef enum
+{
+    SPI_BUS_FRAME_IDLE = 0U, /**< Owned by the driver, never submitted. */
+    SPI_BUS_FRAME_QUEUED,    /**< Owned by the bus, waiting.            */
+    SPI_BUS_FRAME_ACTIVE,    /**< Owned by the bus, on the wire.        */
+    SPI_BUS_FRAME_DONE       /**< Back with the driver; see result.     */
+} SpiBusFrameState_t;
+
+/**
+ * @brief Outcome of a frame.
+ */
+typedef enum
+{
+    SPI_BUS_OK = 0U,  /**< All segments transferred.                      */
+    SPI_BUS_ERROR,    /**< DMA error; later segments were not run.        */
+    SPI_BUS_TIMEOUT   /**< Not finished within @ref SPI_BUS_TIMEOUT_MS.   */
+} SpiBusResult_t;
+
+struct SpiBusFrame;
+
+/**
+ * @brief Frame callback.
+ *
+ * Runs from the DMA interrupt, or with interrupts masked when
+ * SpiBus_Service() aborts a frame. May submit frames, including this one.
+ *
+ * @param frame The finished frame (state DONE, result set).
+ */
+typedef void (*SpiBusCallback_t)(struct SpiBusFrame *frame);
+
+/**
+ * @brief One acquisition: segments run back to back.
+ */
+typedef struct SpiBusFrame
+{
+    /* Set by the owner before SpiBus_Submit() */
+    const SpiBusSegment_t *segments; /**< Segments, in order.               */
+    uint8_t                count;    /**< Number of segments (at least 1).  */
+    SpiBusCallback_t       done;     /**< Frame callback (may be NULL).     */
+    void                  *context;  /**< For the callback.                 */
+
+    /* Managed by the bus */
+    struct SpiBusFrame          *next;    /**< Queue link.                  */
+    volatile SpiBusFrameState_t  state;   /**< Owner, see above.            */
+    SpiBusResult_t               result;  /**< Valid once DONE.             */
+} SpiBusFrame_t;
+
+/**
+ * @brief Bus counters.
+ */
+typedef struct
+{
+    uint32_t submitted;    /**< Frames accepted.                              */
+    uint32_t rejected;     /**< Submits of a frame the bus still owned.       */
+    uint32_t frames;       /**< Frames completed.                             */
+    uint32_t segments;     /**< Segments transferred.                         */
+    uint32_t bytes;        /**< Bytes transferred (each way).                 */
+    uint32_t errors;       /**< Frames ending in a DMA error.                 */
+    uint32_t timeouts;     /**< Frames aborted by SpiBus_Service().           */
+    uint32_t queued;       /**< Frames waiting or active now.                 */
+    uint32_t queueHigh;    /**< Largest queued count seen.                    */
+    uint32_t isrCycles;    /**< CPU cycles in the completion interrupt.       */
+    uint32_t lastFrame_us; /**< First segment start to last segment end.      */
+    uint32_t maxFrame_us;  /**< Longest frame seen.                           */
+} SpiBusStats_t;
+
+/**
+ * @brief Configure the bus pins and interrupts and register the "spi"
+ *        CLI command.
+ *
+ * @return None.
+ */
+void SpiBus_Init(void);
+
+/**
+ * @brief Configure a device's chip select pin (output, deselected).
+ *
+ * @param device Device in static storage.
+ *
+ * @return None.
+ */
+void SpiBus_InitDevice(const SpiBusDevice_t *device);
+
+/**
+ * @brief Queue a frame.
+ *
+ * Safe from any context. The bus owns @p frame, its segments and their
+ * buffers until its callback runs.
+ *
+ * @param frame Frame in static storage.
+ *
+ * @return false if @p frame is invalid or still owned by the bus.
+ */
+bool SpiBus_Submit(SpiBusFrame_t *frame);
+
+/**
+ * @brief Abort a frame stuck for longer than @ref SPI_BUS_TIMEOUT_MS.
+ *
+ * Call periodically from task context.
+ *
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void SpiBus_Service(uint32_t now_ms);
+
+/**
+ * @brief Whether no frame is queued or on the wire.
+ *
+ * The power manager does not enter STOP while the bus is busy.
+ *
+ * @return true if the bus is idle.
+ */
+bool SpiBus_IsIdle(void);
+
+/**
+ * @brief Get the bus counters.
+ *
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void SpiBus_GetStats(SpiBusStats_t *stats);
+
+/** @} */ /* end of spi_bus group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPI_BUS_H */
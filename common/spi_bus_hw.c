@@ -0,0 +1,236 @@
+/**
+ * @file spi_bus_hw.c
+ * @brief SPI2 master port of the SPI bus manager (PB13 SCK, PB14 MISO,
+ *        PB15 MOSI, DMA1 Stream3/4, chip selects on GPIOB).
+ *
+ * Every segment is one full-duplex DMA transfer: Stream3 channel 0
+ * receives, Stream4 channel 0 transmits the same number of bytes. RX
+ * finishes last, so its transfer complete interrupt ends the segment:
+ * the chip select is raised there and the bus manager starts the next
+ * segment in the same interrupt. A missing TX buffer sends 0xFF and a
+ * missing RX buffer is discarded, both without memory increment.
+ *
+ * CR1 (mode and baud rate divider) is only rewritten when the next
+ * device needs a different setting, which also needs SPE cleared.
+ * Registers are accessed directly; the HAL SPI driver is not part of this
+ * project.
+ *
+ * @ingroup spi_bus
+ */
+
+#include "spi_bus_hw.h"
+#include "periph_power.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief DMA stream flags of Stream3 (LISR) and Stream4 (HISR). */
+#define SPI_BUS_HW_RX_FLAGS   (DMA_LIFCR_CTCIF3 | DMA_LIFCR_CHTIF3 | DMA_LIFCR_CTEIF3 | \
+                               DMA_LIFCR_CDMEIF3 | DMA_LIFCR_CFEIF3)
+#define SPI_BUS_HW_TX_FLAGS   (DMA_HIFCR_CTCIF4 | DMA_HIFCR_CHTIF4 | DMA_HIFCR_CTEIF4 | \
+                               DMA_HIFCR_CDMEIF4 | DMA_HIFCR_CFEIF4)
+
+/** @brief Segment in progress. */
+static const SpiBusSegment_t *s_segment = NULL;
+
+/** @brief Clocks taken by the first start after a release. */
+static bool s_clocked = false;
+
+/** @brief CR1 of the last device (0: not configured since the release). */
+static uint32_t s_cr1 = 0U;
+
+/** @brief Source of the 0xFF sent when a segment has no TX buffer. */
+static const uint8_t s_txFill = 0xFFU;
+
+/** @brief Sink for a segment without RX buffer. */
+static uint8_t s_rxSink;
+
+/**
+ * @brief CR1 value (without SPE) for @p device at the current APB1 clock.
+ */
+static uint32_t SpiBusHw_Cr1For(const SpiBusDevice_t *device);
+
+/* ------------------------------------------------------------------------- */
+
+void SpiBusHw_Init(void)
+{
+    /* PB13/PB14/PB15: AF5, push-pull, very high speed. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+    GPIOB->MODER   = (GPIOB->MODER & ~(GPIO_MODER_MODER13 | GPIO_MODER_MODER14 | GPIO_MODER_MODER15)) |
+                     GPIO_MODER_MODER13_1 | GPIO_MODER_MODER14_1 | GPIO_MODER_MODER15_1;
+    GPIOB->OTYPER &= ~(GPIO_OTYPER_OT13 | GPIO_OTYPER_OT14 | GPIO_OTYPER_OT15);
+    GPIOB->OSPEEDR |= GPIO_OSPEEDR_OSPEED13 | GPIO_OSPEEDR_OSPEED14 | GPIO_OSPEEDR_OSPEED15;
+    GPIOB->AFR[1]  = (GPIOB->AFR[1] & ~0xFFF00000U) | 0x55500000U;
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+
+    s_segment = NULL;
+    s_clocked = false;
+    s_cr1     = 0U;
+
+    HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, IRQ_PRIO_SPI_DMA_RX, 0U);
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, IRQ_PRIO_SPI_DMA_TX, 0U);
+    HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+}
+
+void SpiBusHw_InitCs(uint16_t pin)
+{
+    uint32_t mode = 0U;
+    uint32_t mask = 0U;
+
+    for (uint32_t n = 0U; n < 16U; ++n)
+    {
+        if ((pin & (1U << n)) != 0U)
+        {
+            mode |= 1UL << (2U * n);
+            mask |= 3UL << (2U * n);
+        }
+    }
+
+    /* Deselected before the pin becomes an output. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+    GPIOB->BSRR    = pin;
+    GPIOB->OTYPER &= ~(uint32_t)pin;
+    GPIOB->OSPEEDR |= mask;
+    GPIOB->MODER   = (GPIOB->MODER & ~mask) | mode;
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+}
+
+void SpiBusHw_Start(const SpiBusSegment_t *segment)
+{
+    if (!s_clocked)
+    {
+        PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+        PeriphPower_Acquire(PERIPH_POWER_DMA1);
+        PeriphPower_Acquire(PERIPH_POWER_SPI2);
+        s_clocked = true;
+        s_cr1     = 0U;
+    }
+
+    uint32_t cr1 = SpiBusHw_Cr1For(segment->device);
+    if (cr1 != s_cr1)
+    {
+        SPI2->CR1 = cr1;
+        SPI2->CR1 = cr1 | SPI_CR1_SPE;
+        s_cr1     = cr1;
+    }
+
+    s_segment = segment;
+    GPIOB->BSRR = (uint32_t)segment->device->csPin << 16;
+
+    DMA1->LIFCR = SPI_BUS_HW_RX_FLAGS;
+    DMA1->HIFCR = SPI_BUS_HW_TX_FLAGS;
+
+    DMA1_Stream3->PAR  = (uint32_t)(uintptr_t)&SPI2->DR;
+    DMA1_Stream3->M0AR = (uint32_t)(uintptr_t)((segment->rx != NULL) ? segment->rx : &s_rxSink);
+    DMA1_Stream3->NDTR = segment->length;
+    DMA1_Stream3->CR   = DMA_SxCR_PL_1 | DMA_SxCR_TCIE | DMA_SxCR_TEIE |
+                         ((segment->rx != NULL) ? DMA_SxCR_MINC : 0U) | DMA_SxCR_EN;
+
+    DMA1_Stream4->PAR  = (uint32_t)(uintptr_t)&SPI2->DR;
+    DMA1_Stream4->M0AR = (uint32_t)(uintptr_t)((segment->tx != NULL) ? segment->tx : &s_txFill);
+    DMA1_Stream4->NDTR = segment->length;
+    DMA1_Stream4->CR   = DMA_SxCR_PL_1 | DMA_SxCR_DIR_0 | DMA_SxCR_TEIE |
+                         ((segment->tx != NULL) ? DMA_SxCR_MINC : 0U) | DMA_SxCR_EN;
+
+    /* RX request first, so no received byte is missed. */
+    SPI2->CR2 = SPI_CR2_RXDMAEN;
+    SPI2->CR2 = SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN;
+}
+
+void SpiBusHw_Abort(void)
+{
+    DMA1_Stream3->CR &= ~DMA_SxCR_EN;
+    DMA1_Stream4->CR &= ~DMA_SxCR_EN;
+    SPI2->CR2 = 0U;
+    SPI2->CR1 = 0U;
+
+    if (s_segment != NULL)
+    {
+        GPIOB->BSRR = s_segment->device->csPin;
+    }
+    s_segment = NULL;
+    s_cr1     = 0U;
+}
+
+void SpiBusHw_Release(void)
+{
+    if (!s_clocked)
+    {
+        return;
+    }
+
+    SPI2->CR1 = 0U;
+    s_cr1     = 0U;
+
+    PeriphPower_Release(PERIPH_POWER_SPI2);
+    PeriphPower_Release(PERIPH_POWER_DMA1);
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+    s_clocked = false;
+}
+
+void SpiBusHw_DmaRxIrqHandler(void)
+{
+    uint32_t lisr = DMA1->LISR;
+    DMA1->LIFCR = SPI_BUS_HW_RX_FLAGS;
+
+    const SpiBusSegment_t *segment = s_segment;
+    if ((segment == NULL) || ((lisr & (DMA_LISR_TCIF3 | DMA_LISR_TEIF3)) == 0U))
+    {
+        return;
+    }
+
+    /* The last byte is in: every SCK edge of the segment is done. */
+    SPI2->CR2   = 0U;
+    GPIOB->BSRR = segment->device->csPin;
+    s_segment   = NULL;
+
+    if ((lisr & DMA_LISR_TEIF3) != 0U)
+    {
+        DMA1_Stream4->CR &= ~DMA_SxCR_EN;
+        SpiBus_OnHwDone(SPI_BUS_ERROR);
+    }
+    else
+    {
+        SpiBus_OnHwDone(SPI_BUS_OK);
+    }
+}
+
+void SpiBusHw_DmaTxIrqHandler(void)
+{
+    uint32_t hisr = DMA1->HISR;
+    DMA1->HIFCR = SPI_BUS_HW_TX_FLAGS;
+
+    const SpiBusSegment_t *segment = s_segment;
+    if ((segment == NULL) || ((hisr & DMA_HISR_TEIF4) == 0U))
+    {
+        return;
+    }
+
+    DMA1_Stream3->CR &= ~DMA_SxCR_EN;
+    SPI2->CR2   = 0U;
+    GPIOB->BSRR = segment->device->csPin;
+    s_segment   = NULL;
+
+    SpiBus_OnHwDone(SPI_BUS_ERROR);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t SpiBusHw_Cr1For(const SpiBusDevice_t *device)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t br   = 0U;
+
+    /* SCK = PCLK1 / 2^(BR + 1): the fastest setting the device accepts. */
+    while ((br < 7U) && ((pclk >> (br + 1U)) > device->maxHz))
+    {
+        br++;
+    }
+
+    return SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI |
+           (br << SPI_CR1_BR_Pos) |
+           (((device->mode & 2U) != 0U) ? SPI_CR1_CPOL : 0U) |
+           (((device->mode & 1U) != 0U) ? SPI_CR1_CPHA : 0U);
+}
@@ -0,0 +1,97 @@
+/**
+ * @file spi_bus_hw.h
+ * @brief Hardware port of the SPI bus manager (one segment at a time).
+ *
+ * spi_bus.c owns the frame queue and the chaining; the port runs one
+ * chip-select window at a time and reports its end through
+ * SpiBus_OnHwDone(), with the chip select already released. spi_bus_hw.c
+ * drives SPI2 and DMA1 at register level (the HAL SPI module is not part
+ * of this project). The host simulation has its own port.
+ *
+ * @ingroup spi_bus
+ */
+
+#ifndef SPI_BUS_HW_H
+#define SPI_BUS_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spi_bus.h"
+
+/**
+ * @brief Configure the bus pins and the interrupt priorities.
+ *
+ * @return None.
+ */
+void SpiBusHw_Init(void);
+
+/**
+ * @brief Make @p pin a deselected chip select output.
+ *
+ * @param pin GPIOB pin mask.
+ *
+ * @return None.
+ */
+void SpiBusHw_InitCs(uint16_t pin);
+
+/**
+ * @brief Select the segment's device and start the DMA transfer.
+ *
+ * Called with interrupts masked or from the completion interrupt. The
+ * first start after SpiBusHw_Release() takes the clocks.
+ *
+ * @param segment Segment; must stay valid until SpiBus_OnHwDone().
+ *
+ * @return None.
+ */
+void SpiBusHw_Start(const SpiBusSegment_t *segment);
+
+/**
+ * @brief Stop the transfer in progress and deselect the device.
+ *
+ * SpiBus_OnHwDone() is not called for the aborted segment.
+ *
+ * @return None.
+ */
+void SpiBusHw_Abort(void);
+
+/**
+ * @brief The queue is empty: release the clocks.
+ *
+ * @return None.
+ */
+void SpiBusHw_Release(void);
+
+/**
+ * @brief DMA1 Stream3 (SPI2 RX) interrupt handler: end of a segment.
+ *
+ * @return None.
+ */
+void SpiBusHw_DmaRxIrqHandler(void);
+
+/**
+ * @brief DMA1 Stream4 (SPI2 TX) interrupt handler: transfer errors.
+ *
+ * @return None.
+ */
+void SpiBusHw_DmaTxIrqHandler(void);
+
+/**
+ * @brief End of the segment started by SpiBusHw_Start(), from interrupt
+ *        context. Implemented by spi_bus.c.
+ *
+ * @param result Outcome.
+ *
+ * @return None.
+ */
+void SpiBus_OnHwDone(SpiBusResult_t result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SPI_BUS_HW_H */
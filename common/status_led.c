@@ -0,0 +1,199 @@
+/**
+ * @file status_led.c
+ * @brief Status LED implementation.
+ *
+ * TIM8 counts at @ref STATUS_LED_TIMER_HZ; ARR sets the blink period and
+ * CCR1 the on time (PWM mode 1: OC1REF is high while CNT < CCR1). Only
+ * the complementary output is enabled, and with CC1E clear OC1N follows
+ * OC1REF directly. As an advanced timer, TIM8 drives its outputs only
+ * with MOE set in BDTR.
+ *
+ * Registers are accessed directly; the HAL TIM driver is not part of
+ * this project.
+ *
+ * @ingroup status_led
+ */
+
+#include "status_led.h"
+#include "periph_power.h"
+#include "main.h"
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief One blink pattern; a period of 0 is off.
+ */
+typedef struct
+{
+    uint16_t period_ms; /**< Blink period.           */
+    uint16_t on_ms;     /**< LED on at its start.    */
+} StatusLedPattern_t;
+
+/** @brief Pattern per power mode. */
+static const StatusLedPattern_t s_modePatterns[POWER_MODE_COUNT] =
+{
+    [POWER_MODE_ACTIVE] = { 1000U, 500U  },
+    [POWER_MODE_IDLE]   = { 2000U, 1000U },
+    [POWER_MODE_SLEEP]  = { 5000U, 100U  },
+    [POWER_MODE_STOP]   = { 0U,    0U    }
+};
+
+/** @brief Patterns of @ref STATUS_LED_FAULT_SENSOR and @ref STATUS_LED_FAULT_CRASH. */
+static const StatusLedPattern_t s_sensorFault = { 500U, 100U };
+static const StatusLedPattern_t s_crashFault  = { 200U, 100U };
+
+/** @brief Pattern on the LED, NULL before StatusLed_Init(). */
+static const StatusLedPattern_t *s_pattern = NULL;
+
+/** @brief The TIM8 clock is referenced (the LED blinks). */
+static bool s_clockHeld = false;
+
+/**
+ * @brief Load the TIM8 prescaler for the current APB2 clock.
+ */
+static void StatusLed_SetPrescaler(void);
+
+/**
+ * @brief Program a pattern; takes or releases the TIM8 clock.
+ */
+static void StatusLed_Apply(const StatusLedPattern_t *pattern);
+
+/* ------------------------------------------------------------------------- */
+
+void StatusLed_Init(void)
+{
+    GPIO_InitTypeDef gpio = {0};
+
+    PeriphPower_Acquire(PERIPH_POWER_TIM8);
+    s_clockHeld = true;
+
+    TIM8->CR1   = TIM_CR1_ARPE;
+    TIM8->CCMR1 = TIM_CCMR1_OC1M_2 | TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1PE;
+    TIM8->CCER  = TIM_CCER_CC1NE;
+    TIM8->BDTR  = TIM_BDTR_MOE;
+    StatusLed_SetPrescaler();
+
+    /* LD2 is the timer's from here on; main.c left it low as a GPIO. */
+    gpio.Pin       = LD2_Pin;
+    gpio.Mode      = GPIO_MODE_AF_PP;
+    gpio.Pull      = GPIO_NOPULL;
+    gpio.Speed     = GPIO_SPEED_FREQ_LOW;
+    gpio.Alternate = GPIO_AF3_TIM8;
+    HAL_GPIO_Init(LD2_GPIO_Port, &gpio);
+
+    StatusLed_Apply(&s_modePatterns[POWER_MODE_ACTIVE]);
+}
+
+void StatusLed_Update(PowerMode_t mode, uint32_t faults)
+{
+    const StatusLedPattern_t *pattern = &s_modePatterns[POWER_MODE_ACTIVE];
+
+    if (mode < POWER_MODE_COUNT)
+    {
+        pattern = &s_modePatterns[mode];
+    }
+
+    if (pattern->period_ms != 0U)
+    {
+        if ((faults & STATUS_LED_FAULT_CRASH) != 0U)
+        {
+            pattern = &s_crashFault;
+        }
+        else if ((faults & STATUS_LED_FAULT_SENSOR) != 0U)
+        {
+            pattern = &s_sensorFault;
+        }
+    }
+
+    if ((s_pattern != NULL) && (pattern != s_pattern))
+    {
+        StatusLed_Apply(pattern);
+    }
+}
+
+void StatusLed_OnClockChange(void)
+{
+    if (s_clockHeld)
+    {
+        /* The new prescaler is loaded at the update event the pattern
+         * restarts with.
+         */
+        StatusLed_SetPrescaler();
+        TIM8->EGR = TIM_EGR_UG;
+    }
+}
+
+uint32_t StatusLed_GetStopBudgetMs(void)
+{
+    if (!s_clockHeld)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t count = TIM8->CNT;
+    if (count < TIM8->CCR1)
+    {
+        return 0U;
+    }
+
+    return ((TIM8->ARR + 1U) - count) / (STATUS_LED_TIMER_HZ / 1000U);
+}
+
+void StatusLed_OnStopExit(uint32_t slept_ms)
+{
+    if (!s_clockHeld)
+    {
+        return;
+    }
+
+    uint32_t period = TIM8->ARR + 1U;
+    uint32_t ticks  = (slept_ms % period) * (STATUS_LED_TIMER_HZ / 1000U);
+
+    TIM8->CNT = (TIM8->CNT + ticks) % period;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void StatusLed_SetPrescaler(void)
+{
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    uint32_t timer = ((RCC->CFGR & RCC_CFGR_PPRE2) == RCC_CFGR_PPRE2_DIV1) ? pclk2 : (2U * pclk2);
+
+    TIM8->PSC = (timer / STATUS_LED_TIMER_HZ) - 1U;
+}
+
+static void StatusLed_Apply(const StatusLedPattern_t *pattern)
+{
+    s_pattern = pattern;
+
+    if (pattern->period_ms == 0U)
+    {
+        /* OC1REF stays low with CCR1 at 0; then the clock may stop. */
+        TIM8->CCR1 = 0U;
+        TIM8->EGR  = TIM_EGR_UG;
+        TIM8->CR1 &= ~TIM_CR1_CEN;
+
+        if (s_clockHeld)
+        {
+            PeriphPower_Release(PERIPH_POWER_TIM8);
+            s_clockHeld = false;
+        }
+        return;
+    }
+
+    if (!s_clockHeld)
+    {
+        PeriphPower_Acquire(PERIPH_POWER_TIM8);
+        s_clockHeld = true;
+        StatusLed_SetPrescaler();
+    }
+
+    /* Start the new pattern now, with the LED on, not at the end of the
+     * old period (up to 5 s).
+     */
+    TIM8->ARR  = ((uint32_t)pattern->period_ms * (STATUS_LED_TIMER_HZ / 1000U)) - 1U;
+    TIM8->CCR1 = (uint32_t)pattern->on_ms * (STATUS_LED_TIMER_HZ / 1000U);
+    TIM8->EGR  = TIM_EGR_UG;
+    TIM8->CR1 |= TIM_CR1_CEN;
+}
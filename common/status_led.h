@@ -0,0 +1,114 @@
+/**
+ * @file status_led.h
+ * @brief Status LED (LD2) blinked by timer PWM, without CPU involvement.
+ *
+ * LD2 on PA5 is driven by TIM8 channel 1N (AF3) in PWM mode: the period
+ * and the on time of the blink are two timer registers, so the LED keeps
+ * blinking in RUN and SLEEP without an interrupt, a task or a scheduler
+ * wake-up. (TIM2 channel 1, the other timer on PA5, paces the ADC scan.)
+ *
+ * The pattern shows the power mode, or a fault, which takes precedence:
+ *
+ *     ACTIVE   1 Hz, half on                 (the old heartbeat)
+ *     IDLE     0.5 Hz, half on
+ *     SLEEP    100 ms flash every 5 s
+ *     STOP     off (all timers are halted in STOP)
+ *     sensor   100 ms flash every 500 ms     a sensor is quarantined
+ *     crash    5 Hz, half on                 a crash trace is held
+ *
+ * StatusLed_Update() only writes the timer when the pattern changes. The
+ * prescaler follows the clock profile (StatusLed_OnClockChange()).
+ *
+ * TIM8 halts in STOP. The idle governor therefore only enters STOP
+ * between flashes and for no longer than the time to the next one
+ * (StatusLed_GetStopBudgetMs()), and the counter is moved on by the time
+ * spent in STOP afterwards (StatusLed_OnStopExit()), so the rhythm holds.
+ *
+ * @ingroup common
+ */
+
+#ifndef STATUS_LED_H
+#define STATUS_LED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "power_manager.h"
+
+/**
+ * @defgroup status_led Status LED
+ * @brief Power mode and fault blink patterns on LD2 by TIM8 PWM.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief TIM8 counter frequency (10 kHz: 6.5 s still fits the 16-bit ARR). */
+#define STATUS_LED_TIMER_HZ     (10000U)
+
+/**
+ * @brief Faults shown instead of the power mode, in StatusLed_Update().
+ */
+#define STATUS_LED_FAULT_SENSOR (1UL << 0)  /**< A sensor is quarantined. */
+#define STATUS_LED_FAULT_CRASH  (1UL << 1)  /**< A crash trace is held.   */
+
+/**
+ * @brief Switch PA5 to TIM8 and start the ACTIVE pattern.
+ *
+ * Call once after the system clock and the GPIO are configured.
+ *
+ * @return None.
+ */
+void StatusLed_Init(void);
+
+/**
+ * @brief Show the pattern of a power mode, or of the highest fault.
+ *
+ * Cheap when nothing changed; called on every power manager pass. In
+ * STOP the LED is off whatever the faults. The timer clock is released
+ * while the LED is off.
+ *
+ * @param mode   Current power mode.
+ * @param faults STATUS_LED_FAULT_* bits.
+ *
+ * @return None.
+ */
+void StatusLed_Update(PowerMode_t mode, uint32_t faults);
+
+/**
+ * @brief Reload the prescaler after the APB2 clock changed.
+ *
+ * Called by ClockProfile_Apply().
+ *
+ * @return None.
+ */
+void StatusLed_OnClockChange(void);
+
+/**
+ * @brief Longest STOP (ms) that keeps the blink pattern.
+ *
+ * @return 0 while the LED is on, the time until it turns on again, or
+ *         UINT32_MAX while it is off for good.
+ */
+uint32_t StatusLed_GetStopBudgetMs(void);
+
+/**
+ * @brief Move the pattern on by the time TIM8 was halted in STOP.
+ *
+ * Called by the power manager after the wake, with interrupts masked.
+ *
+ * @param slept_ms Time spent in STOP.
+ *
+ * @return None.
+ */
+void StatusLed_OnStopExit(uint32_t slept_ms);
+
+/** @} */ /* end of status_led group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STATUS_LED_H */
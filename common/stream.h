@@ -0,0 +1,281 @@
+/**
+ * @file stream.h
+ * @brief Byte stream interface shared by the output transports.
+ *
+ * The logger, the CLI and the telemetry encoder write to a @ref Stream_t
+ * instead of a particular UART: a transport provides one
+ * @ref StreamIF_t (function pointers, like SensorIF_t for sensors) and
+ * hands out a Stream_t per channel. Every operation is non-blocking
+ * except flush:
+ *
+ *     write          queue bytes, all or nothing
+ *     writeSegments  queue several pieces as one write (optional)
+ *     reserve/commit claim contiguous space, fill it in place, publish
+ *                    it (optional; zero-copy encoders)
+ *     read           take received bytes (optional)
+ *     flush          wait until everything queued has left (optional)
+ *     writable       bytes a write could queue now
+ *     notify         call a hook once that many bytes are writable
+ *                    (optional; writers that wait for room)
+ *
+ * Optional members may be NULL; the Stream_*() wrappers below then fall
+ * back (segments through reserve/commit) or do nothing. Transports:
+ *
+ *     UartTx_GetStream()        console TX ring (UART DMA, or USB CDC
+ *                               while a host has the port open), one
+ *                               stream per writer priority
+ *     TelemetryUart_GetStream() dedicated telemetry UART
+ *
+ * Console input stays interrupt-driven (the UART RX DMA and USB CDC push
+ * bytes into the CLI), so neither of these has @c read.
+ *
+ * @ingroup common
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @defgroup stream Stream
+ * @brief Transport-independent, non-blocking byte output.
+ * @ingroup common
+ * @{
+ */
+
+typedef struct Stream_s Stream_t;
+
+/**
+ * @brief One piece of a segmented write.
+ */
+typedef struct
+{
+    const void *data;   /**< Bytes to send.                                     */
+    size_t      len;    /**< Number of bytes.                                   */
+    bool        byRef;  /**< Send from @c data itself; it must stay unchanged   */
+                        /**< until sent (constant data in flash). A transport   */
+                        /**< without references copies it.                      */
+} StreamSegment_t;
+
+/**
+ * @brief Space claimed by a reserve, filled in place and then committed.
+ */
+typedef struct
+{
+    uint8_t *data; /**< Start of the contiguous space.     */
+    size_t   len;  /**< Bytes reserved.                    */
+    uint32_t pos;  /**< Transport's position of the space. */
+} StreamSpan_t;
+
+/**
+ * @brief Queue @p len bytes, all or nothing.
+ *
+ * @return false (and counted by the transport) if they do not fit.
+ */
+typedef bool (*StreamWriteFn_t)(const Stream_t *stream, const void *data, size_t len);
+
+/**
+ * @brief Queue @p count pieces as one write that no other write splits.
+ *
+ * @return false if the pieces do not fit together.
+ */
+typedef bool (*StreamWriteSegmentsFn_t)(const Stream_t *stream, const StreamSegment_t *segments,
+                                        size_t count);
+
+/**
+ * @brief Claim @p len contiguous bytes.
+ *
+ * Failing is not a drop: the caller falls back to a write.
+ *
+ * @return false if that much contiguous space is not free.
+ */
+typedef bool (*StreamReserveFn_t)(const Stream_t *stream, size_t len, StreamSpan_t *span);
+
+/**
+ * @brief Publish the first @p used bytes of a reserved span.
+ *
+ * Every reserve must be committed, @p used 0 to cancel it. The rest is
+ * given back, or never sent if a later reserve or write already follows
+ * it.
+ */
+typedef void (*StreamCommitFn_t)(const Stream_t *stream, const StreamSpan_t *span, size_t used);
+
+/**
+ * @brief Take up to @p max received bytes.
+ *
+ * @return Bytes copied, 0 if none are waiting.
+ */
+typedef size_t (*StreamReadFn_t)(const Stream_t *stream, void *data, size_t max);
+
+/**
+ * @brief Block until everything queued has been sent.
+ */
+typedef void (*StreamFlushFn_t)(const Stream_t *stream);
+
+/**
+ * @brief Bytes a write could queue right now.
+ */
+typedef size_t (*StreamWritableFn_t)(const Stream_t *stream);
+
+/**
+ * @brief Called once a stream has the room asked for; may run in an
+ *        interrupt handler and must be short.
+ */
+typedef void (*StreamSpaceHook_t)(void);
+
+/**
+ * @brief Call @p hook once @p len bytes are writable.
+ *
+ * One request per stream, a new one replaces it. If the room is already
+ * there, the hook is called before this returns.
+ *
+ * @return false if the request was not taken.
+ */
+typedef bool (*StreamNotifyFn_t)(const Stream_t *stream, size_t len, StreamSpaceHook_t hook);
+
+/**
+ * @brief Stream interface API (function pointers), one per transport.
+ */
+typedef struct
+{
+    StreamWriteFn_t         write;         /**< Queue bytes, all or nothing.      */
+    StreamWriteSegmentsFn_t writeSegments; /**< Optional: segmented write.        */
+    StreamReserveFn_t       reserve;       /**< Optional: claim space in place.   */
+    StreamCommitFn_t        commit;        /**< Required with @c reserve.         */
+    StreamReadFn_t          read;          /**< Optional: received bytes.         */
+    StreamFlushFn_t         flush;         /**< Optional: drain (blocking).       */
+    StreamWritableFn_t      writable;      /**< Space a write could use now.      */
+    StreamNotifyFn_t        notify;        /**< Optional: hook once there is room. */
+} StreamIF_t;
+
+/**
+ * @brief A channel of a transport.
+ */
+struct Stream_s
+{
+    const StreamIF_t *iface; /**< Transport implementation.                  */
+    uint32_t          unit;  /**< Channel within the transport (its choice). */
+};
+
+/**
+ * @brief Queue bytes on @p stream, all or nothing.
+ */
+static inline bool Stream_Write(const Stream_t *stream, const void *data, size_t len)
+{
+    return stream->iface->write(stream, data, len);
+}
+
+/**
+ * @brief Claim @p len contiguous bytes of @p stream.
+ *
+ * @return false if the transport has no reserve or not enough
+ *         contiguous space; write instead.
+ */
+static inline bool Stream_Reserve(const Stream_t *stream, size_t len, StreamSpan_t *span)
+{
+    return (stream->iface->reserve != NULL) && stream->iface->reserve(stream, len, span);
+}
+
+/**
+ * @brief Publish the first @p used bytes of a span from Stream_Reserve().
+ */
+static inline void Stream_Commit(const Stream_t *stream, const StreamSpan_t *span, size_t used)
+{
+    stream->iface->commit(stream, span, used);
+}
+
+/**
+ * @brief Queue several pieces as one write.
+ *
+ * Without a segmented write of its own, the transport gets the pieces
+ * copied into one reserved span, or, for a single piece, one write.
+ *
+ * @return false if the pieces were dropped.
+ */
+static inline bool Stream_WriteSegments(const Stream_t *stream, const StreamSegment_t *segments,
+                                        size_t count)
+{
+    if (stream->iface->writeSegments != NULL)
+    {
+        return stream->iface->writeSegments(stream, segments, count);
+    }
+    if (count == 1U)
+    {
+        return stream->iface->write(stream, segments[0].data, segments[0].len);
+    }
+
+    size_t       total = 0U;
+    StreamSpan_t span;
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        total += segments[i].len;
+    }
+    if (!Stream_Reserve(stream, total, &span))
+    {
+        return false;
+    }
+
+    size_t pos = 0U;
+    for (size_t i = 0U; i < count; ++i)
+    {
+        memcpy(&span.data[pos], segments[i].data, segments[i].len);
+        pos += segments[i].len;
+    }
+    Stream_Commit(stream, &span, total);
+    return true;
+}
+
+/**
+ * @brief Take up to @p max received bytes (0 without a read).
+ */
+static inline size_t Stream_Read(const Stream_t *stream, void *data, size_t max)
+{
+    return (stream->iface->read != NULL) ? stream->iface->read(stream, data, max) : 0U;
+}
+
+/**
+ * @brief Block until everything queued on @p stream has been sent.
+ */
+static inline void Stream_Flush(const Stream_t *stream)
+{
+    if (stream->iface->flush != NULL)
+    {
+        stream->iface->flush(stream);
+    }
+}
+
+/**
+ * @brief Bytes a write to @p stream could queue right now.
+ */
+static inline size_t Stream_GetWritable(const Stream_t *stream)
+{
+    return stream->iface->writable(stream);
+}
+
+/**
+ * @brief Have @p hook called once @p len bytes of @p stream are writable.
+ *
+ * @return false if the transport cannot notify; poll
+ *         Stream_GetWritable() instead.
+ */
+static inline bool Stream_NotifyWritable(const Stream_t *stream, size_t len, StreamSpaceHook_t hook)
+{
+    return (stream->iface->notify != NULL) && stream->iface->notify(stream, len, hook);
+}
+
+/** @} */ /* end of stream group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_H */
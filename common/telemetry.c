@@ -0,0 +1,437 @@
+/**
+ * @file telemetry.c
+ * @brief COBS-framed binary sample telemetry implementation.
+ *
+ * Records are packed straight into a raw frame buffer. On flush the CRC
+ * is appended, the frame is COBS encoded between two 0x00 delimiters
+ * and handed to the output stream (the telemetry writer of the console
+ * TX ring, or the dedicated telemetry UART) all or nothing, so a frame
+ * is never interleaved with a log line. Where the stream can reserve
+ * contiguous space the frame is encoded straight into it; otherwise it
+ * is encoded into @ref s_wire and written.
+ *
+ * @ingroup telemetry
+ */
+
+#include "telemetry.h"
+#include "cobs.h"
+#include "crc32.h"
+#include "sample_codec.h"
+#include "metrics.h"
+#include "hil_probe.h"
+#include <string.h>
+
+/** @brief Frame header size: type, count, base timestamp. */
+#define TELEMETRY_HEADER_SIZE   (6U)
+
+/** @brief Raw frame capacity including the CRC. */
+#define TELEMETRY_RAW_SIZE      (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD + 4U)
+
+/** @brief Wire frame capacity: delimiters plus worst-case COBS output. */
+#define TELEMETRY_WIRE_SIZE     (COBS_MAX_ENCODED_SIZE(TELEMETRY_RAW_SIZE) + 2U)
+
+/**
+ * @brief Frame under construction.
+ */
+static uint8_t s_raw[TELEMETRY_RAW_SIZE];
+
+/**
+ * @brief Encoded frame.
+ */
+static uint8_t s_wire[TELEMETRY_WIRE_SIZE];
+
+/**
+ * @brief Output stream (NULL: frames are dropped).
+ */
+static const Stream_t *s_out = NULL;
+
+/**
+ * @brief Bytes used in @ref s_raw.
+ */
+static size_t s_rawLen = 0U;
+
+/**
+ * @brief Records in the pending frame.
+ */
+static uint32_t s_recordCount = 0U;
+
+/**
+ * @brief Timestamp of the first record in the pending frame.
+ */
+static uint32_t s_base_ms = 0U;
+
+/**
+ * @brief Batch encoder for the compressed formats.
+ */
+static SampleCodec_t s_codec;
+
+/**
+ * @brief Telemetry on/off.
+ */
+static bool s_enabled = false;
+
+/**
+ * @brief Record value encoding.
+ */
+static TelemetryFormat_t s_format = TELEMETRY_FORMAT_F32;
+
+/**
+ * @brief Counters.
+ */
+static TelemetryStats_t s_stats = {0};
+
+/**
+ * @brief Store a little-endian value of @p size bytes.
+ */
+static void Telemetry_PutLe(uint8_t *dst, uint32_t value, uint32_t size);
+
+/**
+ * @brief Whether the current format uses the batch encoder.
+ */
+static inline bool Telemetry_IsCompressed(void)
+{
+    return (s_format == TELEMETRY_FORMAT_DELTA) || (s_format == TELEMETRY_FORMAT_XOR);
+}
+
+/**
+ * @brief Start a new frame with @p base_ms as its base timestamp.
+ */
+static void Telemetry_BeginFrame(uint32_t base_ms);
+
+/**
+ * @brief Add a sample to the pending batch (compressed formats).
+ */
+static void Telemetry_AddCompressed(const SensorSample_t *sample);
+
+/**
+ * @brief CRC, COBS-encode and queue the @p len raw bytes in @ref s_raw.
+ *
+ * @return Bytes on the wire, or 0 if the TX ring was full.
+ */
+static size_t Telemetry_Send(size_t len);
+
+/**
+ * @brief Free space for frames on the telemetry output.
+ */
+static size_t Telemetry_TxFree(void);
+
+/* ------------------------------------------------------------------------- */
+
+void Telemetry_Init(const Stream_t *out)
+{
+    s_out         = out;
+    s_rawLen      = 0U;
+    s_recordCount = 0U;
+    s_enabled     = false;
+    s_format      = TELEMETRY_FORMAT_F32;
+    s_stats       = (TelemetryStats_t){0};
+
+    Metrics_Publish(METRIC_TELEM_FRAMES, &s_stats.frames);
+    Metrics_Publish(METRIC_TELEM_RECORDS, &s_stats.records);
+    Metrics_Publish(METRIC_TELEM_BYTES, &s_stats.bytes);
+    Metrics_Publish(METRIC_TELEM_DROPPED, &s_stats.droppedFrames);
+}
+
+void Telemetry_SetEnabled(bool enable)
+{
+    if (!enable)
+    {
+        Telemetry_Flush();
+    }
+
+    s_enabled = enable;
+}
+
+bool Telemetry_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+void Telemetry_SetFormat(TelemetryFormat_t format)
+{
+    Telemetry_Flush();
+    s_format = format;
+}
+
+TelemetryFormat_t Telemetry_GetFormat(void)
+{
+    return s_format;
+}
+
+const char *Telemetry_GetFormatName(TelemetryFormat_t format)
+{
+    static const char *const s_names[] = { "f32", "i16", "delta", "xor", "raw" };
+
+    if ((uint32_t)format >= (sizeof(s_names) / sizeof(s_names[0])))
+    {
+        return "?";
+    }
+
+    return s_names[format];
+}
+
+bool Telemetry_AddSample(const SensorSample_t *sample)
+{
+    if (!s_enabled || (sample == NULL))
+    {
+        return false;
+    }
+
+    if (Telemetry_IsCompressed())
+    {
+        Telemetry_AddCompressed(sample);
+        return true;
+    }
+
+    uint32_t channels = SensorData_GetChannels(sample);
+    uint32_t width    = (SensorData_GetFormat(sample) == SENSOR_FORMAT_S32) ? 4U : 2U;
+    size_t   size     = (s_format == TELEMETRY_FORMAT_RAW) ? (6U + (channels * width)) :
+                        ((s_format == TELEMETRY_FORMAT_I16) ? 5U : 7U);
+
+    uint32_t dt = sample->timestamp - s_base_ms;
+    if ((s_recordCount > 0U) &&
+        ((dt > 0xFFFFU) || ((s_rawLen + size) > (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_PAYLOAD))))
+    {
+        Telemetry_Flush();
+    }
+
+    if (s_recordCount == 0U)
+    {
+        Telemetry_BeginFrame(sample->timestamp);
+        dt = 0U;
+    }
+
+    uint8_t *rec = &s_raw[s_rawLen];
+    rec[0] = sample->sensorId;
+    Telemetry_PutLe(&rec[1], dt, 2U);
+
+    if (s_format == TELEMETRY_FORMAT_RAW)
+    {
+        rec[3] = sample->layout;
+        rec[4] = sample->quality;
+        rec[5] = (uint8_t)sample->scaleExp;
+        for (uint32_t c = 0U; c < channels; ++c)
+        {
+            Telemetry_PutLe(&rec[6U + (c * width)], (uint32_t)SensorData_GetRaw(sample, c), width);
+        }
+    }
+    else if (s_format == TELEMETRY_FORMAT_I16)
+    {
+        float   scaled = SensorData_GetFloat(sample, 0U) * (float)TELEMETRY_I16_SCALE;
+        int32_t raw    = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+
+        if (raw > INT16_MAX)
+        {
+            raw = INT16_MAX;
+        }
+        else if (raw < INT16_MIN)
+        {
+            raw = INT16_MIN;
+        }
+
+        Telemetry_PutLe(&rec[3], (uint32_t)raw, 2U);
+    }
+    else
+    {
+        float    value = SensorData_GetFloat(sample, 0U);
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        Telemetry_PutLe(&rec[3], bits, 4U);
+    }
+    s_rawLen += size;
+
+    s_recordCount++;
+    s_raw[1] = (uint8_t)s_recordCount;
+
+    if (s_recordCount >= TELEMETRY_MAX_RECORDS)
+    {
+        Telemetry_Flush();
+    }
+
+    return true;
+}
+
+void Telemetry_Flush(void)
+{
+    if (s_recordCount == 0U)
+    {
+        return;
+    }
+
+    if (Telemetry_IsCompressed())
+    {
+        s_rawLen = TELEMETRY_HEADER_SIZE + s_codec.length;
+    }
+
+    /* Marked before the write, which may start the transfer itself. */
+    HIL_PROBE_MARK(FRAME);
+
+    size_t len = Telemetry_Send(s_rawLen);
+    if (len > 0U)
+    {
+        s_stats.frames++;
+        s_stats.records += s_recordCount;
+        s_stats.bytes   += (uint32_t)len;
+    }
+    else
+    {
+        HIL_PROBE_MARK(FRAME_DROP);
+        s_stats.droppedFrames++;
+    }
+
+    s_recordCount = 0U;
+    s_rawLen      = 0U;
+}
+
+bool Telemetry_SendBatch(SampleCodecMode_t mode, uint32_t base_ms, uint32_t count,
+                         const uint8_t *payload, size_t len)
+{
+    uint8_t type = (mode == SAMPLE_CODEC_XOR) ? TELEMETRY_FRAME_SAMPLES_XOR : TELEMETRY_FRAME_SAMPLES_DELTA;
+
+    if (!Telemetry_SendFrame(type, count, base_ms, payload, len))
+    {
+        return false;
+    }
+
+    s_stats.records += count;
+    return true;
+}
+
+bool Telemetry_SendFrame(uint8_t type, uint32_t count, uint32_t base_ms,
+                         const uint8_t *payload, size_t len)
+{
+    if ((payload == NULL) || (count > 0xFFU) || (len > TELEMETRY_MAX_PAYLOAD))
+    {
+        return false;
+    }
+
+    Telemetry_Flush();
+
+    /* Only queue what fits, so a replay never shows up as dropped output. */
+    if (Telemetry_TxFree() < COBS_MAX_ENCODED_SIZE(TELEMETRY_HEADER_SIZE + len + 4U) + 2U)
+    {
+        return false;
+    }
+
+    s_raw[0] = type;
+    s_raw[1] = (uint8_t)count;
+    Telemetry_PutLe(&s_raw[2], base_ms, 4U);
+    memcpy(&s_raw[TELEMETRY_HEADER_SIZE], payload, len);
+
+    size_t wire = Telemetry_Send(TELEMETRY_HEADER_SIZE + len);
+    if (wire == 0U)
+    {
+        return false;
+    }
+
+    s_stats.frames++;
+    s_stats.bytes += (uint32_t)wire;
+    return true;
+}
+
+void Telemetry_GetStats(TelemetryStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = s_stats;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void Telemetry_PutLe(uint8_t *dst, uint32_t value, uint32_t size)
+{
+    for (uint32_t i = 0U; i < size; ++i)
+    {
+        dst[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+static void Telemetry_BeginFrame(uint32_t base_ms)
+{
+    static const uint8_t s_frameTypes[] =
+    {
+        [TELEMETRY_FORMAT_F32]   = TELEMETRY_FRAME_SAMPLES_F32,
+        [TELEMETRY_FORMAT_I16]   = TELEMETRY_FRAME_SAMPLES_I16,
+        [TELEMETRY_FORMAT_DELTA] = TELEMETRY_FRAME_SAMPLES_DELTA,
+        [TELEMETRY_FORMAT_XOR]   = TELEMETRY_FRAME_SAMPLES_XOR,
+        [TELEMETRY_FORMAT_RAW]   = TELEMETRY_FRAME_SAMPLES_RAW
+    };
+
+    s_base_ms = base_ms;
+    s_raw[0]  = s_frameTypes[s_format];
+    s_raw[1]  = 0U;
+    Telemetry_PutLe(&s_raw[2], s_base_ms, 4U);
+    s_rawLen  = TELEMETRY_HEADER_SIZE;
+
+    if (Telemetry_IsCompressed())
+    {
+        SampleCodec_Begin(&s_codec,
+                          (s_format == TELEMETRY_FORMAT_XOR) ? SAMPLE_CODEC_XOR : SAMPLE_CODEC_DELTA,
+                          base_ms, &s_raw[TELEMETRY_HEADER_SIZE],
+                          TELEMETRY_RAW_SIZE - TELEMETRY_HEADER_SIZE - 4U);
+    }
+}
+
+static void Telemetry_AddCompressed(const SensorSample_t *sample)
+{
+    if (s_recordCount == 0U)
+    {
+        Telemetry_BeginFrame(sample->timestamp);
+    }
+
+    if (!SampleCodec_Add(&s_codec, sample))
+    {
+        /* Batch full (bytes, streams or time range): always fits a new one. */
+        Telemetry_Flush();
+        Telemetry_BeginFrame(sample->timestamp);
+        (void)SampleCodec_Add(&s_codec, sample);
+    }
+
+    s_recordCount++;
+    s_raw[1] = (uint8_t)s_recordCount;
+
+    if (s_recordCount >= TELEMETRY_MAX_RECORDS)
+    {
+        Telemetry_Flush();
+    }
+}
+
+static size_t Telemetry_Send(size_t len)
+{
+    Telemetry_PutLe(&s_raw[len], Crc32_Compute(s_raw, len), 4U);
+
+    if (s_out == NULL)
+    {
+        return 0U;
+    }
+
+    StreamSpan_t span;
+    uint8_t     *out     = s_wire;
+    bool         inPlace = Stream_Reserve(s_out, COBS_MAX_ENCODED_SIZE(len + 4U) + 2U, &span);
+
+    if (inPlace)
+    {
+        out = span.data;
+    }
+
+    size_t wire = Cobs_Encode(s_raw, len + 4U, &out[1]);
+    out[0]         = 0x00U;
+    out[wire + 1U] = 0x00U;
+    wire += 2U;
+
+    if (inPlace)
+    {
+        Stream_Commit(s_out, &span, wire);
+        return wire;
+    }
+
+    return Stream_Write(s_out, s_wire, wire) ? wire : 0U;
+}
+
+static size_t Telemetry_TxFree(void)
+{
+    return (s_out != NULL) ? Stream_GetWritable(s_out) : 0U;
+}
@@ -0,0 +1,233 @@
+/**
+ * @file telemetry.h
+ * @brief Binary sample telemetry over the console UART.
+ *
+ * Samples are packed into fixed-size records, grouped into frames and
+ * sent through the UART TX ring alongside the CLI and log text:
+ *
+ *     0x00 | COBS( type:u8 count:u8 base_ms:u32 record*count crc:u32 ) | 0x00
+ *
+ * All fields are little-endian. A record is
+ *     id:u8 dt_ms:u16 value
+ * where dt_ms is relative to base_ms and value is a float32
+ * (@ref TELEMETRY_FORMAT_F32) or an int16 in units of
+ * 1/@ref TELEMETRY_I16_SCALE (@ref TELEMETRY_FORMAT_I16), both from the
+ * sample's first channel. @ref TELEMETRY_FORMAT_RAW sends the whole
+ * sample instead:
+ *     id:u8 dt_ms:u16 layout:u8 quality:u8 scale_exp:i8 channel*n
+ * with the fields of SensorData_t and n int16 or int32 channels (ten
+ * bytes for a single int16 channel, twelve more for three int32 axes).
+ * The CRC is CRC-32/MPEG-2 over type..last record.
+ *
+ * The compressed formats (@ref TELEMETRY_FORMAT_DELTA and
+ * @ref TELEMETRY_FORMAT_XOR) keep the same header and CRC but replace the
+ * fixed records with a sample_codec.h batch, typically two bytes per
+ * sample.
+ *
+ * Other modules send their own frame types through the same channel with
+ * Telemetry_SendFrame() (e.g. the event trace, trace.h).
+ *
+ * Text never contains 0x00, so the host splits the stream on 0x00 and
+ * treats anything that does not decode to a valid frame as text
+ * (tools/telemetry_decode.py).
+ *
+ * @ingroup common
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+#include "sample_codec.h"
+#include "stream.h"
+
+/**
+ * @defgroup telemetry Telemetry
+ * @brief COBS-framed binary sample stream.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Records per frame. */
+#define TELEMETRY_MAX_RECORDS   (32U)
+
+/** @brief Largest payload of one frame (between the header and the CRC). */
+#define TELEMETRY_MAX_PAYLOAD   (TELEMETRY_MAX_RECORDS * SAMPLE_CODEC_MAX_RECORD_SIZE)
+
+/** @brief int16 record resolution: value = raw / TELEMETRY_I16_SCALE. */
+#define TELEMETRY_I16_SCALE     (100)
+
+/** @brief Frame type byte: float32 sample records. */
+#define TELEMETRY_FRAME_SAMPLES_F32   (0x01U)
+
+/** @brief Frame type byte: int16 sample records. */
+#define TELEMETRY_FRAME_SAMPLES_I16   (0x02U)
+
+/** @brief Frame type byte: delta-encoded batch (@ref SAMPLE_CODEC_DELTA). */
+#define TELEMETRY_FRAME_SAMPLES_DELTA (0x03U)
+
+/** @brief Frame type byte: XOR-encoded batch (@ref SAMPLE_CODEC_XOR). */
+#define TELEMETRY_FRAME_SAMPLES_XOR   (0x04U)
+
+/** @brief Frame type byte: raw multi-channel sample records. */
+#define TELEMETRY_FRAME_SAMPLES_RAW   (0x05U)
+
+/**
+ * @brief Value encoding of sample records.
+ */
+typedef enum
+{
+    TELEMETRY_FORMAT_F32 = 0U, /**< 7-byte records, full float precision.  */
+    TELEMETRY_FORMAT_I16,      /**< 5-byte records, 0.01 resolution.       */
+    TELEMETRY_FORMAT_DELTA,    /**< Delta/varint batch, 0.01 resolution.   */
+    TELEMETRY_FORMAT_XOR,      /**< Delta/XOR batch, full float precision. */
+    TELEMETRY_FORMAT_RAW       /**< All channels and quality, as sampled.   */
+} TelemetryFormat_t;
+
+/**
+ * @brief Telemetry counters.
+ */
+typedef struct
+{
+    uint32_t frames;        /**< Frames queued for transmission.           */
+    uint32_t records;       /**< Samples sent.                             */
+    uint32_t bytes;         /**< Bytes on the wire, framing included.      */
+    uint32_t droppedFrames; /**< Frames lost because the TX ring was full. */
+} TelemetryStats_t;
+
+/**
+ * @brief Reset telemetry state; telemetry starts disabled.
+ *
+ * @param out Stream the frames are written to: the telemetry writer of
+ *            the console TX ring (UartTx_GetStream()) or the dedicated
+ *            telemetry UART (TelemetryUart_GetStream()).
+ *
+ * @return None.
+ */
+void Telemetry_Init(const Stream_t *out);
+
+/**
+ * @brief Turn the binary sample stream on or off.
+ *
+ * Pending records are flushed when telemetry is turned off.
+ *
+ * @param enable true to send telemetry frames.
+ *
+ * @return None.
+ */
+void Telemetry_SetEnabled(bool enable);
+
+/**
+ * @brief Whether telemetry is enabled.
+ *
+ * @return true if samples are sent as telemetry frames.
+ */
+bool Telemetry_IsEnabled(void);
+
+/**
+ * @brief Select the record value encoding (flushes pending records).
+ *
+ * @param format New encoding.
+ *
+ * @return None.
+ */
+void Telemetry_SetFormat(TelemetryFormat_t format);
+
+/**
+ * @brief Current record value encoding.
+ *
+ * @return Active format.
+ */
+TelemetryFormat_t Telemetry_GetFormat(void);
+
+/**
+ * @brief Short name of a format.
+ *
+ * @param format Format to describe.
+ *
+ * @return Static string such as "f32", or "?" for invalid values.
+ */
+const char *Telemetry_GetFormatName(TelemetryFormat_t format);
+
+/**
+ * @brief Add a sample to the pending frame.
+ *
+ * The frame is sent automatically when it is full, or first if the
+ * sample's timestamp does not fit the frame's 16-bit time offset (or,
+ * in the compressed formats, the sample cannot be added to the batch).
+ * Must be called from thread mode.
+ *
+ * @param sample Sample to send.
+ *
+ * @return false if telemetry is disabled or @p sample is NULL.
+ */
+bool Telemetry_AddSample(const SensorSample_t *sample);
+
+/**
+ * @brief Send the pending frame, if any.
+ *
+ * @return None.
+ */
+void Telemetry_Flush(void);
+
+/**
+ * @brief Send an already encoded sample batch as one frame.
+ *
+ * Used to replay stored batches (e.g. the flash log). The pending frame
+ * is flushed first. Works whether or not live telemetry is enabled.
+ * Nothing is queued if the UART TX ring cannot take the whole frame right
+ * now, so the caller can simply retry later.
+ *
+ * @param mode    Encoding of @p payload.
+ * @param base_ms Batch base timestamp.
+ * @param count   Number of samples in the batch (at most 255).
+ * @param payload Encoded batch (sample_codec.h).
+ * @param len     Size of @p payload.
+ *
+ * @return true if the frame was queued.
+ */
+bool Telemetry_SendBatch(SampleCodecMode_t mode, uint32_t base_ms, uint32_t count,
+                         const uint8_t *payload, size_t len);
+
+/**
+ * @brief Send one frame with an arbitrary type and payload.
+ *
+ * The pending sample frame is flushed first. Like Telemetry_SendBatch(),
+ * nothing is queued unless the whole frame fits the UART TX ring, and it
+ * works whether or not live telemetry is enabled. Counts towards the
+ * frames and bytes counters only.
+ *
+ * @param type    Frame type byte.
+ * @param count   Count byte of the header (at most 255).
+ * @param base_ms Header timestamp.
+ * @param payload Frame payload.
+ * @param len     Size of @p payload, at most @ref TELEMETRY_MAX_PAYLOAD.
+ *
+ * @return true if the frame was queued.
+ */
+bool Telemetry_SendFrame(uint8_t type, uint32_t count, uint32_t base_ms,
+                         const uint8_t *payload, size_t len);
+
+/**
+ * @brief Snapshot the telemetry counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void Telemetry_GetStats(TelemetryStats_t *stats);
+
+/** @} */ /* end of telemetry group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,325 @@
+/**
+ * @file telemetry_uart.c
+ * @brief Telemetry UART transmit ring implementation.
+ *
+ * A smaller relative of uart_tx.c: one producer (the telemetry frame
+ * writer, task context) and the DMA completion interrupt. Free-running
+ * indices; the writer copies behind @c s_head and then publishes it, the
+ * completion path advances @c s_tail and starts the next contiguous chunk.
+ * Only the publish and the "start DMA if idle" decision run with
+ * interrupts masked. With a single producer a reserved span is always
+ * the newest, so a commit simply publishes the bytes it used.
+ *
+ * @ingroup telemetry_uart
+ */
+
+#include "telemetry_uart.h"
+#include "hil_probe.h"
+#include <string.h>
+
+#if ((TELEMETRY_UART_BUFFER_SIZE & (TELEMETRY_UART_BUFFER_SIZE - 1U)) != 0U)
+#error "TELEMETRY_UART_BUFFER_SIZE must be a power of two"
+#endif
+
+/** @brief Index mask for the ring. */
+#define TELEMETRY_UART_INDEX_MASK   (TELEMETRY_UART_BUFFER_SIZE - 1U)
+
+/**
+ * @brief UART handle (NULL: port not active).
+ */
+static UART_HandleTypeDef *s_uart = NULL;
+
+/**
+ * @brief Transmit ring storage.
+ */
+static uint8_t s_buffer[TELEMETRY_UART_BUFFER_SIZE];
+
+/**
+ * @brief Free-running index up to which bytes are queued.
+ */
+static volatile uint32_t s_head = 0U;
+
+/**
+ * @brief Free-running read index (owned by the DMA completion path).
+ */
+static volatile uint32_t s_tail = 0U;
+
+/**
+ * @brief Length of the chunk handed to DMA (0 when idle).
+ */
+static volatile uint32_t s_dmaLen = 0U;
+
+/**
+ * @brief Bytes rejected because the ring was full.
+ */
+static uint32_t s_droppedBytes = 0U;
+
+/**
+ * @brief Start a DMA transfer for the next contiguous chunk if idle.
+ *
+ * Must be called with interrupts masked or from the completion ISR.
+ */
+static void TelemetryUart_StartNextChunk(void);
+
+/**
+ * @brief APB2 clock (USART1 is on APB2).
+ */
+static uint32_t TelemetryUart_GetPclk(void);
+
+/**
+ * @brief Hand @p len bytes written behind @c s_head to the DMA.
+ */
+static void TelemetryUart_Publish(uint32_t len);
+
+/* Stream_t adapters. */
+static bool   TelemetryUart_StreamWrite(const Stream_t *stream, const void *data, size_t len);
+static bool   TelemetryUart_StreamReserve(const Stream_t *stream, size_t len, StreamSpan_t *span);
+static void   TelemetryUart_StreamCommit(const Stream_t *stream, const StreamSpan_t *span, size_t used);
+static size_t TelemetryUart_StreamWritable(const Stream_t *stream);
+
+/** @brief Stream interface of the port (waiting is left to the caller). */
+static const StreamIF_t s_streamIF =
+{
+    .write         = TelemetryUart_StreamWrite,
+    .writeSegments = NULL,
+    .reserve       = TelemetryUart_StreamReserve,
+    .commit        = TelemetryUart_StreamCommit,
+    .read          = NULL,
+    .flush         = NULL,
+    .writable      = TelemetryUart_StreamWritable,
+    .notify        = NULL
+};
+
+/** @brief The port's only stream. */
+static const Stream_t s_stream = { &s_streamIF, 0U };
+
+/* ------------------------------------------------------------------------- */
+
+void TelemetryUart_Init(UART_HandleTypeDef *huart)
+{
+    s_uart         = huart;
+    s_head         = 0U;
+    s_tail         = 0U;
+    s_dmaLen       = 0U;
+    s_droppedBytes = 0U;
+}
+
+bool TelemetryUart_IsActive(void)
+{
+    return s_uart != NULL;
+}
+
+bool TelemetryUart_Write(const void *data, size_t len)
+{
+    if ((s_uart == NULL) || (data == NULL))
+    {
+        return false;
+    }
+
+    if (len > TelemetryUart_GetFree())
+    {
+        s_droppedBytes += (uint32_t)len;
+        return false;
+    }
+
+    uint32_t offset = s_head & TELEMETRY_UART_INDEX_MASK;
+    size_t   first  = TELEMETRY_UART_BUFFER_SIZE - offset;
+    if (first > len)
+    {
+        first = len;
+    }
+    memcpy(&s_buffer[offset], data, first);
+    memcpy(&s_buffer[0], (const uint8_t *)data + first, len - first);
+
+    TelemetryUart_Publish((uint32_t)len);
+
+    return true;
+}
+
+bool TelemetryUart_Reserve(size_t len, StreamSpan_t *span)
+{
+    uint32_t offset = s_head & TELEMETRY_UART_INDEX_MASK;
+
+    if ((s_uart == NULL) || (span == NULL) || (len == 0U) || (len > TelemetryUart_GetFree()) ||
+        (len > (TELEMETRY_UART_BUFFER_SIZE - offset)))
+    {
+        return false;
+    }
+
+    span->data = &s_buffer[offset];
+    span->len  = len;
+    span->pos  = s_head;
+    return true;
+}
+
+void TelemetryUart_Commit(const StreamSpan_t *span, size_t used)
+{
+    if ((span == NULL) || (span->pos != s_head) || (used == 0U))
+    {
+        return;
+    }
+
+    TelemetryUart_Publish((uint32_t)((used < span->len) ? used : span->len));
+}
+
+const Stream_t *TelemetryUart_GetStream(void)
+{
+    return &s_stream;
+}
+
+size_t TelemetryUart_GetFree(void)
+{
+    return (s_uart != NULL) ? (size_t)(TELEMETRY_UART_BUFFER_SIZE - (s_head - s_tail)) : 0U;
+}
+
+bool TelemetryUart_IsIdle(void)
+{
+    if (s_uart == NULL)
+    {
+        return true;
+    }
+
+    return (s_head == s_tail) && (__HAL_UART_GET_FLAG(s_uart, UART_FLAG_TC) != 0U);
+}
+
+bool TelemetryUart_SetBaudRate(uint32_t baud)
+{
+    if ((s_uart == NULL) || (baud == 0U))
+    {
+        return false;
+    }
+
+    /* The divider's mantissa must be at least 1. */
+    uint32_t pclk = TelemetryUart_GetPclk();
+    if (((uint64_t)baud * 16U) > pclk)
+    {
+        return false;
+    }
+
+    uint32_t brr    = UART_BRR_SAMPLING16(pclk, baud);
+    uint32_t actual = (brr != 0U) ? ((pclk + (brr / 2U)) / brr) : 0U;
+    uint32_t error  = (actual > baud) ? (actual - baud) : (baud - actual);
+
+    if ((actual == 0U) || (((uint64_t)error * 1000U) > ((uint64_t)baud * CONSOLE_BAUD_TOLERANCE_PPT)))
+    {
+        return false;
+    }
+
+    while (!TelemetryUart_IsIdle())
+    {
+    }
+
+    s_uart->Init.BaudRate = baud;
+    s_uart->Instance->BRR = brr;
+    return true;
+}
+
+uint32_t TelemetryUart_GetBaudRate(void)
+{
+    return (s_uart != NULL) ? s_uart->Init.BaudRate : 0U;
+}
+
+uint32_t TelemetryUart_GetActualBaud(void)
+{
+    if (s_uart == NULL)
+    {
+        return 0U;
+    }
+
+    uint32_t brr = s_uart->Instance->BRR;
+
+    return (brr != 0U) ? ((TelemetryUart_GetPclk() + (brr / 2U)) / brr) : 0U;
+}
+
+void TelemetryUart_UpdateBaudRate(void)
+{
+    if (s_uart != NULL)
+    {
+        s_uart->Instance->BRR = UART_BRR_SAMPLING16(TelemetryUart_GetPclk(), s_uart->Init.BaudRate);
+    }
+}
+
+uint32_t TelemetryUart_GetDroppedBytes(void)
+{
+    return s_droppedBytes;
+}
+
+void TelemetryUart_OnTxComplete(UART_HandleTypeDef *huart)
+{
+    if ((huart != s_uart) || (s_dmaLen == 0U))
+    {
+        return;
+    }
+
+    s_tail  += s_dmaLen;
+    s_dmaLen = 0U;
+    TelemetryUart_StartNextChunk();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void TelemetryUart_Publish(uint32_t len)
+{
+    /* Publish the data before the new head becomes visible to the ISR. */
+    __DMB();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    s_head += len;
+    TelemetryUart_StartNextChunk();
+    __set_PRIMASK(primask);
+}
+
+static bool TelemetryUart_StreamWrite(const Stream_t *stream, const void *data, size_t len)
+{
+    (void)stream;
+    return TelemetryUart_Write(data, len);
+}
+
+static bool TelemetryUart_StreamReserve(const Stream_t *stream, size_t len, StreamSpan_t *span)
+{
+    (void)stream;
+    return TelemetryUart_Reserve(len, span);
+}
+
+static void TelemetryUart_StreamCommit(const Stream_t *stream, const StreamSpan_t *span, size_t used)
+{
+    (void)stream;
+    TelemetryUart_Commit(span, used);
+}
+
+static size_t TelemetryUart_StreamWritable(const Stream_t *stream)
+{
+    (void)stream;
+    return TelemetryUart_GetFree();
+}
+
+static void TelemetryUart_StartNextChunk(void)
+{
+    uint32_t used = s_head - s_tail;
+
+    if ((s_dmaLen != 0U) || (used == 0U))
+    {
+        return;
+    }
+
+    uint32_t offset = s_tail & TELEMETRY_UART_INDEX_MASK;
+    uint32_t chunk  = TELEMETRY_UART_BUFFER_SIZE - offset;
+    if (chunk > used)
+    {
+        chunk = used;
+    }
+
+    if (HAL_UART_Transmit_DMA(s_uart, &s_buffer[offset], (uint16_t)chunk) == HAL_OK)
+    {
+        HIL_PROBE_MARK(TX);
+        s_dmaLen = chunk;
+    }
+}
+
+static uint32_t TelemetryUart_GetPclk(void)
+{
+    return HAL_RCC_GetPCLK2Freq();
+}
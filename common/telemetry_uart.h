@@ -0,0 +1,185 @@
+/**
+ * @file telemetry_uart.h
+ * @brief Dedicated telemetry UART: its own transmit ring and DMA stream.
+ *
+ * With @ref TELEMETRY_UART_ENABLE the binary telemetry frames (telemetry.h,
+ * the flash log `dump` and archive `query` replies) leave on USART1 (PA9,
+ * DMA2 Stream7) instead of sharing the console TX ring (uart_tx.h) with the
+ * CLI and the log. A long replay then no longer delays command responses,
+ * and each link runs at its own rate: the telemetry UART sits on APB2 and
+ * reaches several Mbaud, while the console stays at what the ST-LINK bridge
+ * handles.
+ *
+ * Only frames are written here, from task context, one at a time: a write
+ * is copied into the ring whole or not at all, and each DMA completion
+ * chains the next contiguous chunk. TelemetryUart_GetStream() offers the
+ * port as a @ref Stream_t, with reserve/commit so frames can be encoded
+ * straight into the ring.
+ *
+ * Without @ref TELEMETRY_UART_ENABLE, TelemetryUart_Init() is never called,
+ * TelemetryUart_IsActive() is false and the other functions do nothing.
+ *
+ * @ingroup common
+ */
+
+#ifndef TELEMETRY_UART_H
+#define TELEMETRY_UART_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "stm32f4xx_hal.h"
+#include "app_config.h"
+#include "stream.h"
+
+/**
+ * @defgroup telemetry_uart Telemetry UART
+ * @brief Second UART carrying only the binary telemetry.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Size of the transmit ring in bytes.
+ *
+ * Must be a power of two. Holds several full telemetry frames, so a replay
+ * loop can queue ahead of the DMA.
+ */
+#define TELEMETRY_UART_BUFFER_SIZE   (2048U)
+
+/**
+ * @brief Start the transmit ring on an initialised UART.
+ *
+ * The handle must be linked to a TX DMA stream (HAL_UART_MspInit()).
+ *
+ * @param huart Telemetry UART handle.
+ *
+ * @return None.
+ */
+void TelemetryUart_Init(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Whether telemetry goes to the dedicated UART.
+ *
+ * @return true once TelemetryUart_Init() has run.
+ */
+bool TelemetryUart_IsActive(void);
+
+/**
+ * @brief Queue @p len bytes, all or nothing.
+ *
+ * Task context only.
+ *
+ * @param data Bytes to send.
+ * @param len  Number of bytes.
+ *
+ * @return false (bytes counted as dropped) if the ring lacks the space.
+ */
+bool TelemetryUart_Write(const void *data, size_t len);
+
+/**
+ * @brief Claim @p len contiguous ring bytes to fill in place.
+ *
+ * Task context only, like TelemetryUart_Write(); commit before the next
+ * write. Fails without counting a drop when the space is short or wraps.
+ *
+ * @param len        Bytes to claim.
+ * @param[out] span  Receives the space.
+ *
+ * @return false if not claimed (or the port is not active).
+ */
+bool TelemetryUart_Reserve(size_t len, StreamSpan_t *span);
+
+/**
+ * @brief Send the first @p used bytes of a span from TelemetryUart_Reserve().
+ *
+ * @param span Space from TelemetryUart_Reserve().
+ * @param used Bytes filled in, 0 to cancel.
+ *
+ * @return None.
+ */
+void TelemetryUart_Commit(const StreamSpan_t *span, size_t used);
+
+/**
+ * @brief The port as a @ref Stream_t (no read, no flush).
+ *
+ * @return The port's stream.
+ */
+const Stream_t *TelemetryUart_GetStream(void);
+
+/**
+ * @brief Free ring space.
+ *
+ * @return Bytes a TelemetryUart_Write() may queue now.
+ */
+size_t TelemetryUart_GetFree(void);
+
+/**
+ * @brief Whether everything queued has left the UART.
+ *
+ * @return true if the ring is empty and the last byte is sent (or the
+ *         port is not active).
+ */
+bool TelemetryUart_IsIdle(void);
+
+/**
+ * @brief Change the baud rate (16x oversampling).
+ *
+ * Waits for queued bytes to leave first. Refused if the APB2 clock cannot
+ * produce @p baud within @ref CONSOLE_BAUD_TOLERANCE_PPT.
+ *
+ * @param baud New rate.
+ *
+ * @return true if applied.
+ */
+bool TelemetryUart_SetBaudRate(uint32_t baud);
+
+/**
+ * @brief Rate set by TelemetryUart_SetBaudRate().
+ *
+ * @return Baud, 0 if the port is not active.
+ */
+uint32_t TelemetryUart_GetBaudRate(void);
+
+/**
+ * @brief Rate the divider gives at the current clock.
+ *
+ * @return Baud, 0 if the port is not active.
+ */
+uint32_t TelemetryUart_GetActualBaud(void);
+
+/**
+ * @brief Reprogram the divider for the current clock (after a clock
+ *        profile change).
+ *
+ * @return None.
+ */
+void TelemetryUart_UpdateBaudRate(void);
+
+/**
+ * @brief Bytes rejected because the ring was full.
+ *
+ * @return Byte count since start-up.
+ */
+uint32_t TelemetryUart_GetDroppedBytes(void);
+
+/**
+ * @brief DMA transmit complete (from HAL_UART_TxCpltCallback()).
+ *
+ * @param huart UART that completed; other UARTs are ignored.
+ *
+ * @return None.
+ */
+void TelemetryUart_OnTxComplete(UART_HandleTypeDef *huart);
+
+/** @} */ /* end of telemetry_uart group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_UART_H */
@@ -0,0 +1,150 @@
+/**
+ * @file time_base.c
+ * @brief Free-running microsecond time base implementation.
+ *
+ * Time = epoch + overflows * 2^32 + TIM5->CNT. The epoch absorbs
+ * prescaler changes (the counter restarts from 0) and STOP-mode time.
+ * An overflow whose interrupt has not been serviced yet (caller running
+ * with interrupts masked or at higher priority) is detected from the
+ * pending UIF flag.
+ *
+ * Registers are accessed directly; the HAL TIM driver is not part of
+ * this project.
+ *
+ * @ingroup time_base
+ */
+
+#include "time_base.h"
+#include "periph_power.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief Time at which the counter last restarted from 0.
+ */
+static volatile uint64_t s_epochUs = 0U;
+
+/**
+ * @brief Low word of @ref s_epochUs, for Time_NowUs32().
+ */
+static volatile uint32_t s_epochLow = 0U;
+
+/**
+ * @brief Counter overflows since the epoch.
+ */
+static volatile uint32_t s_overflows = 0U;
+
+/**
+ * @brief TIM5 kernel clock: PCLK1, doubled when APB1 is divided.
+ */
+static uint32_t Time_GetTimerClock(void);
+
+/**
+ * @brief Load the prescaler for the current clock and restart the counter.
+ */
+static void Time_Restart(void);
+
+/* ------------------------------------------------------------------------- */
+
+void Time_Init(void)
+{
+    /* Held for good: the time base never stops. */
+    PeriphPower_Acquire(PERIPH_POWER_TIM5);
+
+    TIM5->CR1  = TIM_CR1_URS;      /* Only overflows raise the update interrupt. */
+    TIM5->ARR  = 0xFFFFFFFFU;
+    TIM5->DIER = TIM_DIER_UIE;
+
+    s_epochUs   = 0U;
+    s_epochLow  = 0U;
+    s_overflows = 0U;
+    Time_Restart();
+
+    TIM5->CR1 |= TIM_CR1_CEN;
+
+    HAL_NVIC_SetPriority(TIM5_IRQn, IRQ_PRIO_TIME_BASE, 0U);
+    HAL_NVIC_EnableIRQ(TIM5_IRQn);
+}
+
+uint64_t Time_NowUs(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t count     = TIM5->CNT;
+    uint32_t overflows = s_overflows;
+
+    /* Wrapped, interrupt not taken yet: the count read is past the wrap
+     * if it is small.
+     */
+    if (((TIM5->SR & TIM_SR_UIF) != 0U) && (count < 0x80000000U))
+    {
+        overflows++;
+    }
+
+    uint64_t now = s_epochUs + ((uint64_t)overflows << 32) + count;
+
+    __set_PRIMASK(primask);
+    return now;
+}
+
+uint32_t Time_NowUs32(void)
+{
+    return s_epochLow + TIM5->CNT;
+}
+
+void Time_OnClockChange(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint64_t now = Time_NowUs();
+    s_epochUs   = now;
+    s_epochLow  = (uint32_t)now;
+    s_overflows = 0U;
+    Time_Restart();
+
+    __set_PRIMASK(primask);
+}
+
+void Time_AddUs(uint64_t us)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_epochUs  += us;
+    s_epochLow  = (uint32_t)s_epochUs;
+
+    __set_PRIMASK(primask);
+}
+
+void Time_IrqHandler(void)
+{
+    if ((TIM5->SR & TIM_SR_UIF) != 0U)
+    {
+        TIM5->SR = (uint32_t)~TIM_SR_UIF;
+        s_overflows++;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t Time_GetTimerClock(void)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    return ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) ? pclk1 : (2U * pclk1);
+}
+
+static void Time_Restart(void)
+{
+    TIM5->PSC = (Time_GetTimerClock() / TIME_BASE_HZ) - 1U;
+
+    /* UG loads the prescaler and clears the counter; URS keeps it from
+     * counting as an overflow.
+     */
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->SR  = (uint32_t)~TIM_SR_UIF;
+}
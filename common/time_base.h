@@ -0,0 +1,91 @@
+/**
+ * @file time_base.h
+ * @brief Free-running microsecond time base.
+ *
+ * TIM5 (32-bit, APB1) counts at 1 MHz and its update interrupt extends
+ * the count to 64 bits, so Time_NowUs() does not wrap in practice. The
+ * 32-bit variant Time_NowUs32() is a single register read plus an add;
+ * it wraps every ~71.6 minutes, so use it for intervals and compare with
+ * signed differences, like HAL ticks.
+ *
+ * The prescaler follows the clock profile (Time_OnClockChange()) and the
+ * time spent in STOP, where the timer is halted, is added back by the
+ * power manager (Time_AddUs()).
+ *
+ * @ingroup common
+ */
+
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @defgroup time_base Time Base
+ * @brief 1 MHz monotonic clock on TIM5.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Counter frequency. */
+#define TIME_BASE_HZ   (1000000U)
+
+/**
+ * @brief Start TIM5 at 1 MHz and enable its overflow interrupt.
+ *
+ * Call once after the system clock is configured.
+ *
+ * @return None.
+ */
+void Time_Init(void);
+
+/**
+ * @brief Microseconds since Time_Init(); safe from any context.
+ *
+ * @return 64-bit time in us.
+ */
+uint64_t Time_NowUs(void);
+
+/**
+ * @brief Low 32 bits of Time_NowUs(), without the overflow bookkeeping.
+ *
+ * @return Time in us modulo 2^32.
+ */
+uint32_t Time_NowUs32(void);
+
+/**
+ * @brief Recompute the prescaler after the APB1 clock changed.
+ *
+ * The time is carried over; the switch itself costs at most a few us.
+ *
+ * @return None.
+ */
+void Time_OnClockChange(void);
+
+/**
+ * @brief Add time that passed while the timer was stopped (STOP mode).
+ *
+ * @param us Microseconds to add.
+ *
+ * @return None.
+ */
+void Time_AddUs(uint64_t us);
+
+/**
+ * @brief TIM5 update interrupt handler; call from TIM5_IRQHandler().
+ *
+ * @return None.
+ */
+void Time_IrqHandler(void);
+
+/** @} */ /* end of time_base group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_BASE_H */
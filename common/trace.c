@@ -0,0 +1,341 @@
+/**
+ * @file trace.c
+ * @brief Event trace recorder: ring, names table, telemetry drain and CLI.
+ *
+ * Trace_Record() (trace.h) is the producer. Trace_Service() is the only
+ * consumer: it copies up to @ref TRACE_FRAME_EVENTS events behind
+ * g_traceTail into a frame and advances the tail only once the frame has
+ * been queued, so a full UART TX ring delays events but never loses them.
+ *
+ * @ingroup trace
+ */
+
+#include "trace.h"
+
+#if (TRACE_ENABLE != 0)
+
+#include "telemetry.h"
+#include "cli.h"
+#include <string.h>
+
+_Static_assert((TRACE_RING_EVENTS & (TRACE_RING_EVENTS - 1U)) == 0U,
+               "TRACE_RING_EVENTS must be a power of two");
+_Static_assert((8U + (TRACE_FRAME_EVENTS * sizeof(TraceEvent_t))) <= TELEMETRY_MAX_PAYLOAD,
+               "trace frame exceeds the telemetry payload");
+
+TraceEvent_t      g_traceRing[TRACE_RING_EVENTS];
+volatile uint32_t g_traceHead       = 0U;
+volatile uint32_t g_traceTail       = 0U;
+volatile uint32_t g_traceDropped    = 0U;
+volatile uint32_t g_traceCategories = 0U;
+
+/**
+ * @brief One entry of the names table.
+ */
+typedef struct
+{
+    const char *name;           /**< Registered string.        */
+    uint8_t     kind;           /**< @ref TraceNameKind_t.      */
+    uint8_t     id;             /**< Task or sensor id.        */
+} TraceName_t;
+
+/**
+ * @brief Names sent at the start of a trace.
+ */
+static TraceName_t s_names[TRACE_MAX_NAMES];
+
+/**
+ * @brief Entries used in @ref s_names.
+ */
+static uint32_t s_nameCount = 0U;
+
+/**
+ * @brief First name not yet sent; @ref s_nameCount once all are out.
+ */
+static uint32_t s_nameNext = 0U;
+
+/**
+ * @brief Frame payload under construction.
+ */
+static uint8_t s_payload[TELEMETRY_MAX_PAYLOAD];
+
+/**
+ * @brief Frames sent since Trace_Start().
+ */
+static uint32_t s_frames = 0U;
+
+/**
+ * @brief Send the names from @ref s_nameNext on.
+ *
+ * @return true once every name has been sent.
+ */
+static bool Trace_SendNames(void);
+
+/**
+ * @brief Send up to TRACE_FRAME_EVENTS pending events.
+ *
+ * @return true if a frame was queued.
+ */
+static bool Trace_SendEvents(void);
+
+/**
+ * @brief Store a little-endian 32-bit value.
+ */
+static void Trace_PutLe32(uint8_t *dst, uint32_t value);
+
+/**
+ * @brief CLI "trace [on [task|isr|sensor|power|all]... | off]" handler.
+ */
+static void Trace_CmdTrace(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void Trace_Init(void)
+{
+    g_traceCategories = 0U;
+    g_traceHead       = 0U;
+    g_traceTail       = 0U;
+    g_traceDropped    = 0U;
+    s_nameCount       = 0U;
+    s_nameNext        = 0U;
+    s_frames          = 0U;
+
+    (void)CLI_RegisterCommand("trace", Trace_CmdTrace,
+                              "[on [task|isr|sensor|power|all]... | off] - Event trace");
+}
+
+void Trace_RegisterName(TraceNameKind_t kind, uint32_t id, const char *name)
+{
+    uint32_t slot = s_nameCount;
+
+    for (uint32_t i = 0U; i < s_nameCount; ++i)
+    {
+        if ((s_names[i].kind == (uint8_t)kind) && (s_names[i].id == (uint8_t)id))
+        {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot >= TRACE_MAX_NAMES)
+    {
+        return;
+    }
+
+    s_names[slot] = (TraceName_t){ .name = name, .kind = (uint8_t)kind, .id = (uint8_t)id };
+    if (slot == s_nameCount)
+    {
+        s_nameCount++;
+    }
+
+    /* Registered while tracing: resend the table. */
+    if (g_traceCategories != 0U)
+    {
+        s_nameNext = 0U;
+    }
+}
+
+void Trace_Start(uint32_t categories)
+{
+    g_traceCategories = 0U;
+
+    /* Nothing records while the categories are 0, so no masking needed. */
+    g_traceHead    = 0U;
+    g_traceTail    = 0U;
+    g_traceDropped = 0U;
+    s_nameNext     = 0U;
+    s_frames       = 0U;
+
+    g_traceCategories = categories & TRACE_CAT_ALL;
+    TRACE_CLOCK();
+}
+
+void Trace_Stop(void)
+{
+    g_traceCategories = 0U;
+}
+
+void Trace_Service(void)
+{
+    if (!Trace_SendNames())
+    {
+        return;
+    }
+
+    while ((g_traceHead != g_traceTail) && Trace_SendEvents())
+    {
+    }
+}
+
+void Trace_GetStats(TraceStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t head = g_traceHead;
+
+    stats->recorded   = head;
+    stats->dropped    = g_traceDropped;
+    stats->pending    = head - g_traceTail;
+    stats->frames     = s_frames;
+    stats->categories = g_traceCategories;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool Trace_SendNames(void)
+{
+    while (s_nameNext < s_nameCount)
+    {
+        uint32_t first = s_nameNext;
+        uint32_t next  = first;
+        size_t   len   = 0U;
+
+        while (next < s_nameCount)
+        {
+            const char *name  = (s_names[next].name != NULL) ? s_names[next].name : "";
+            size_t      chars = strnlen(name, TRACE_NAME_CHARS);
+
+            if ((len + 3U + chars) > sizeof(s_payload))
+            {
+                break;
+            }
+
+            s_payload[len]      = s_names[next].kind;
+            s_payload[len + 1U] = s_names[next].id;
+            s_payload[len + 2U] = (uint8_t)chars;
+            memcpy(&s_payload[len + 3U], name, chars);
+            len += 3U + chars;
+            next++;
+        }
+
+        if (!Telemetry_SendFrame(TRACE_FRAME_NAMES_TYPE, next - first, HAL_GetTick(),
+                                 s_payload, len))
+        {
+            return false;
+        }
+
+        s_frames++;
+        s_nameNext = next;
+    }
+
+    return true;
+}
+
+static bool Trace_SendEvents(void)
+{
+    uint32_t tail  = g_traceTail;
+    uint32_t count = g_traceHead - tail;
+
+    if (count > TRACE_FRAME_EVENTS)
+    {
+        count = TRACE_FRAME_EVENTS;
+    }
+
+    Trace_PutLe32(&s_payload[0], SystemCoreClock);
+    Trace_PutLe32(&s_payload[4], g_traceDropped);
+
+    uint8_t *dst = &s_payload[8];
+    for (uint32_t i = 0U; i < count; ++i)
+    {
+        const TraceEvent_t *ev = &g_traceRing[(tail + i) & (TRACE_RING_EVENTS - 1U)];
+        Trace_PutLe32(&dst[0], ev->cycles);
+        Trace_PutLe32(&dst[4], ev->word);
+        dst += sizeof(TraceEvent_t);
+    }
+
+    if (!Telemetry_SendFrame(TRACE_FRAME_EVENTS_TYPE, count, HAL_GetTick(),
+                             s_payload, 8U + (count * sizeof(TraceEvent_t))))
+    {
+        return false;
+    }
+
+    /* The producer only reads the tail, so a plain store releases the slots. */
+    g_traceTail = tail + count;
+    s_frames++;
+    return true;
+}
+
+static void Trace_PutLe32(uint8_t *dst, uint32_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+    dst[2] = (uint8_t)(value >> 16);
+    dst[3] = (uint8_t)(value >> 24);
+}
+
+static void Trace_CmdTrace(uint32_t argc, char *argv[])
+{
+    static const struct
+    {
+        const char *name;
+        uint32_t    bits;
+    } s_categories[] =
+    {
+        { "task",   TRACE_CAT_TASK   },
+        { "isr",    TRACE_CAT_ISR    },
+        { "sensor", TRACE_CAT_SENSOR },
+        { "power",  TRACE_CAT_POWER  },
+        { "all",    TRACE_CAT_ALL    }
+    };
+
+    if ((argc >= 2U) && (strcmp(argv[1], "on") == 0))
+    {
+        uint32_t categories = (argc == 2U) ?
+                              (TRACE_CAT_TASK | TRACE_CAT_SENSOR | TRACE_CAT_POWER) : 0U;
+
+        for (uint32_t a = 2U; a < argc; ++a)
+        {
+            uint32_t bits = 0U;
+            for (uint32_t c = 0U; c < (sizeof(s_categories) / sizeof(s_categories[0])); ++c)
+            {
+                if (strcmp(argv[a], s_categories[c].name) == 0)
+                {
+                    bits = s_categories[c].bits;
+                }
+            }
+
+            if (bits == 0U)
+            {
+                CLI_PrintError("\r\nUnknown category '%s'.\r\n", argv[a]);
+                return;
+            }
+            categories |= bits;
+        }
+
+        Trace_Start(categories);
+    }
+    else if ((argc == 2U) && (strcmp(argv[1], "off") == 0))
+    {
+        Trace_Stop();
+    }
+    else if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: trace [on [task|isr|sensor|power|all]... | off]\r\n");
+        return;
+    }
+
+    TraceStats_t stats;
+    Trace_GetStats(&stats);
+
+    CLI_Print("\r\nTrace: %s", (stats.categories != 0U) ? "ON (" : "OFF");
+    for (uint32_t c = 0U; c < 4U; ++c)
+    {
+        if ((stats.categories & s_categories[c].bits) != 0U)
+        {
+            CLI_Print(" %s", s_categories[c].name);
+        }
+    }
+    CLI_Print("%s\r\n", (stats.categories != 0U) ? " )" : "");
+    CLI_Print("  Events: %lu recorded, %lu dropped, %lu pending; %lu frames\r\n",
+              (unsigned long)stats.recorded,
+              (unsigned long)stats.dropped,
+              (unsigned long)stats.pending,
+              (unsigned long)stats.frames);
+}
+
+#endif /* TRACE_ENABLE */
@@ -0,0 +1,302 @@
+/**
+ * @file trace.h
+ * @brief Event trace recorder: task, ISR, sensor and power events stamped
+ *        with CYCCNT, streamed as telemetry frames.
+ *
+ * Each event is 8 bytes (cycle count plus a type/data word) stored in a
+ * RAM ring by an inline recorder that masks interrupts for a handful of
+ * instructions. Trace_Service() moves recorded events into binary
+ * telemetry frames on the console UART; tools/trace_to_perfetto.py turns
+ * a capture of them into Chrome trace JSON for ui.perfetto.dev or
+ * chrome://tracing.
+ *
+ * Events are only recorded while `trace on` is active, and only for the
+ * selected categories. A full ring drops new events and counts them;
+ * nothing recorded is ever overwritten, so each gap is visible in the
+ * timeline. ISR tracing alone produces 8 KB/s from SysTick, more than the
+ * 115200 baud console can carry next to anything else, so it is not part
+ * of the default selection.
+ *
+ * Frames (see telemetry.h for the framing):
+ *
+ *     type 0x10 events: clock_hz:u32 dropped:u32 { cycles:u32 word:u32 }*count
+ *     type 0x11 names:  { kind:u8 id:u8 len:u8 char*len }*count
+ *
+ * word is type:u8 | data:u24 << 8 (@ref TraceEventType_t). CYCCNT stops
+ * in sleep and STOP, so the idle events carry the microsecond time base
+ * instead, which keeps counting.
+ *
+ * Build with -DTRACE_ENABLE=1. When 0 (the default) every TRACE_* macro
+ * expands to nothing, arguments are not evaluated and trace.c is empty.
+ *
+ * @ingroup common
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32f4xx_hal.h"
+#include "time_base.h"
+
+/**
+ * @defgroup trace Event Trace
+ * @brief CYCCNT-stamped timeline of tasks, interrupts, sensors and power.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Build the recorder in (1) or compile every trace point out (0). */
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE              (0)
+#endif
+
+/** @brief Ring capacity in events (power of two, 8 bytes each). */
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS         (256U)
+#endif
+
+/** @brief Events per telemetry frame. */
+#define TRACE_FRAME_EVENTS        (32U)
+
+/** @brief Names kept for the names frame (tasks and sensors). */
+#define TRACE_MAX_NAMES           (48U)
+
+/** @brief Characters of a name sent to the host. */
+#define TRACE_NAME_CHARS          (16U)
+
+/** @brief Frame type byte: trace events. */
+#define TRACE_FRAME_EVENTS_TYPE   (0x10U)
+
+/** @brief Frame type byte: id to name table. */
+#define TRACE_FRAME_NAMES_TYPE    (0x11U)
+
+/**
+ * @name Categories
+ * @brief Bits of the `trace on` selection.
+ * @{
+ */
+#define TRACE_CAT_TASK            (1UL << 0)  /**< Task and event task runs.   */
+#define TRACE_CAT_ISR             (1UL << 1)  /**< Interrupt handlers.         */
+#define TRACE_CAT_SENSOR          (1UL << 2)  /**< Sensor reads.               */
+#define TRACE_CAT_POWER           (1UL << 3)  /**< Mode changes, idle, STOP.   */
+#define TRACE_CAT_ALL             (0x0FUL)    /**< Every category.             */
+/** @} */
+
+/**
+ * @brief Event types (low byte of the event word).
+ */
+typedef enum
+{
+    TRACE_EV_TASK_BEGIN = 1U,   /**< data: task id.                         */
+    TRACE_EV_TASK_END,          /**< data: task id.                         */
+    TRACE_EV_ISR_ENTER,         /**< data: exception number (IPSR).         */
+    TRACE_EV_ISR_EXIT,          /**< data: exception number.                */
+    TRACE_EV_SENSOR_START,      /**< data: sensor id.                       */
+    TRACE_EV_SENSOR_DONE,       /**< data: sensor id | ok << 8.             */
+    TRACE_EV_POWER_MODE,        /**< data: new PowerMode_t.                 */
+    TRACE_EV_IDLE_BEGIN,        /**< data: Time_NowUs32() & 0xFFFFFF.       */
+    TRACE_EV_IDLE_END,          /**< data: Time_NowUs32() & 0xFFFFFF.       */
+    TRACE_EV_STOP_ENTER,        /**< data: 0.                               */
+    TRACE_EV_STOP_EXIT,         /**< data: 0.                               */
+    TRACE_EV_CLOCK              /**< data: core clock in kHz from here on.  */
+} TraceEventType_t;
+
+/**
+ * @brief What a registered name refers to.
+ */
+typedef enum
+{
+    TRACE_NAME_TASK = 0U,       /**< Task id of TRACE_EV_TASK_*.           */
+    TRACE_NAME_SENSOR           /**< Sensor id of TRACE_EV_SENSOR_*.       */
+} TraceNameKind_t;
+
+/**
+ * @brief One recorded event.
+ */
+typedef struct
+{
+    uint32_t cycles;            /**< DWT->CYCCNT when recorded.               */
+    uint32_t word;              /**< type | data << 8.                        */
+} TraceEvent_t;
+
+/**
+ * @brief Recorder counters.
+ */
+typedef struct
+{
+    uint32_t recorded;          /**< Events stored since `trace on`.          */
+    uint32_t dropped;           /**< Events lost because the ring was full.   */
+    uint32_t pending;           /**< Events waiting to be sent.               */
+    uint32_t frames;            /**< Event and name frames sent.              */
+    uint32_t categories;        /**< Active TRACE_CAT_* selection.            */
+} TraceStats_t;
+
+#if (TRACE_ENABLE != 0)
+
+/** @brief Event ring; written by Trace_Record(), drained by Trace_Service(). */
+extern TraceEvent_t g_traceRing[TRACE_RING_EVENTS];
+
+/** @brief Free-running write index (events recorded). */
+extern volatile uint32_t g_traceHead;
+
+/** @brief Free-running read index (events sent). */
+extern volatile uint32_t g_traceTail;
+
+/** @brief Events lost to a full ring since `trace on`. */
+extern volatile uint32_t g_traceDropped;
+
+/** @brief Active categories; 0 while tracing is off. */
+extern volatile uint32_t g_traceCategories;
+
+/**
+ * @brief Record one event if @p category is selected.
+ *
+ * Safe from thread mode and any interrupt priority.
+ *
+ * @param category TRACE_CAT_* bit of the event.
+ * @param type     Event type.
+ * @param data     Event data; only the low 24 bits are kept.
+ *
+ * @return None.
+ */
+static inline void Trace_Record(uint32_t category, TraceEventType_t type, uint32_t data)
+{
+    if ((g_traceCategories & category) == 0U)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t head = g_traceHead;
+    if ((head - g_traceTail) < TRACE_RING_EVENTS)
+    {
+        TraceEvent_t *ev = &g_traceRing[head & (TRACE_RING_EVENTS - 1U)];
+        ev->cycles  = DWT->CYCCNT;
+        ev->word    = (uint32_t)type | (data << 8);
+        g_traceHead = head + 1U;
+    }
+    else
+    {
+        g_traceDropped++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Register the CLI command; tracing starts off.
+ *
+ * Call before any task or sensor is registered so their names are kept.
+ *
+ * @return None.
+ */
+void Trace_Init(void);
+
+/**
+ * @brief Name an id for the host; replaces an earlier name of the same id.
+ *
+ * @param kind What @p id refers to.
+ * @param id   Task or sensor id.
+ * @param name Static string; only the pointer is kept.
+ *
+ * @return None.
+ */
+void Trace_RegisterName(TraceNameKind_t kind, uint32_t id, const char *name);
+
+/**
+ * @brief Clear the ring and start recording @p categories.
+ *
+ * The names frame is sent again before the first events.
+ *
+ * @param categories TRACE_CAT_* bits.
+ *
+ * @return None.
+ */
+void Trace_Start(uint32_t categories);
+
+/**
+ * @brief Stop recording; events already recorded are still sent.
+ *
+ * @return None.
+ */
+void Trace_Stop(void);
+
+/**
+ * @brief Send pending names and events while the UART TX ring has room.
+ *
+ * Call periodically from thread mode (see TRACE_SERVICE_PERIOD_MS).
+ *
+ * @return None.
+ */
+void Trace_Service(void);
+
+/**
+ * @brief Snapshot the recorder counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void Trace_GetStats(TraceStats_t *stats);
+
+/** @brief A task (id) starts running. */
+#define TRACE_TASK_BEGIN(id)      Trace_Record(TRACE_CAT_TASK, TRACE_EV_TASK_BEGIN, (id))
+/** @brief The task (id) returned. */
+#define TRACE_TASK_END(id)        Trace_Record(TRACE_CAT_TASK, TRACE_EV_TASK_END, (id))
+/** @brief First statement of an interrupt handler. */
+#define TRACE_ISR_ENTER()         Trace_Record(TRACE_CAT_ISR, TRACE_EV_ISR_ENTER, __get_IPSR())
+/** @brief Last statement of an interrupt handler. */
+#define TRACE_ISR_EXIT()          Trace_Record(TRACE_CAT_ISR, TRACE_EV_ISR_EXIT, __get_IPSR())
+/** @brief A read of sensor (id) is started. */
+#define TRACE_SENSOR_START(id)    Trace_Record(TRACE_CAT_SENSOR, TRACE_EV_SENSOR_START, (id))
+/** @brief The read of sensor (id) completed or failed. */
+#define TRACE_SENSOR_DONE(id, ok) Trace_Record(TRACE_CAT_SENSOR, TRACE_EV_SENSOR_DONE, \
+                                               (uint32_t)(id) | ((ok) ? 0x100U : 0U))
+/** @brief The power mode changed to (mode). */
+#define TRACE_POWER_MODE(mode)    Trace_Record(TRACE_CAT_POWER, TRACE_EV_POWER_MODE, (uint32_t)(mode))
+/** @brief The core is about to sleep. */
+#define TRACE_IDLE_BEGIN()        Trace_Record(TRACE_CAT_POWER, TRACE_EV_IDLE_BEGIN, Time_NowUs32())
+/** @brief The core woke up. */
+#define TRACE_IDLE_END()          Trace_Record(TRACE_CAT_POWER, TRACE_EV_IDLE_END, Time_NowUs32())
+/** @brief Entering STOP (inside an idle period). */
+#define TRACE_STOP_ENTER()        Trace_Record(TRACE_CAT_POWER, TRACE_EV_STOP_ENTER, 0U)
+/** @brief Clocks restored after STOP. */
+#define TRACE_STOP_EXIT()         Trace_Record(TRACE_CAT_POWER, TRACE_EV_STOP_EXIT, 0U)
+/** @brief The core clock changed; recorded in every category. */
+#define TRACE_CLOCK()             Trace_Record(TRACE_CAT_ALL, TRACE_EV_CLOCK, SystemCoreClock / 1000U)
+/** @brief Name an id for the host (see Trace_RegisterName()). */
+#define TRACE_NAME(kind, id, name) Trace_RegisterName((kind), (id), (name))
+
+#else /* TRACE_ENABLE == 0 */
+
+#define TRACE_TASK_BEGIN(id)       ((void)0)
+#define TRACE_TASK_END(id)         ((void)0)
+#define TRACE_ISR_ENTER()          ((void)0)
+#define TRACE_ISR_EXIT()           ((void)0)
+#define TRACE_SENSOR_START(id)     ((void)0)
+#define TRACE_SENSOR_DONE(id, ok)  ((void)0)
+#define TRACE_POWER_MODE(mode)     ((void)0)
+#define TRACE_IDLE_BEGIN()         ((void)0)
+#define TRACE_IDLE_END()           ((void)0)
+#define TRACE_STOP_ENTER()         ((void)0)
+#define TRACE_STOP_EXIT()          ((void)0)
+#define TRACE_CLOCK()              ((void)0)
+#define TRACE_NAME(kind, id, name) ((void)0)
+
+#endif /* TRACE_ENABLE */
+
+/** @} */ /* end of trace group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
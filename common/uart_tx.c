@@ -0,0 +1,1105 @@
+/**
+ * @file uart_tx.c
+ * @brief DMA-driven UART transmit ring implementation.
+ *
+ * The ring uses free-running indices. A producer claims space by
+ * advancing @c s_claim and counting itself in @c s_writers, copies its
+ * bytes with interrupts enabled, and leaves again; the last producer out
+ * moves @c s_head up to @c s_claim, which hands every finished write to
+ * the DMA at once. Writers from thread mode, any interrupt priority or
+ * several RTOS threads can therefore interleave without ever splitting
+ * each other's bytes, and nobody waits for anybody. The DMA completion
+ * interrupt only advances @c s_tail.
+ *
+ * The claim, the publish and the "start DMA if idle" decision are each a
+ * few instructions with interrupts masked; the copy is not. The claim
+ * also applies the stream priority: the free space a write may take is
+ * reduced by the reserve of the streams ranked above it, and while a CLI
+ * response is pending by the larger CLI reserve.
+ *
+ * By-reference segments do not occupy the ring. Each is queued with the
+ * ring index it belongs at; the DMA chain stops ring chunks at that index,
+ * sends the reference from its own storage once the tail reaches it, and
+ * then carries on with the ring. References are queued in the same masked
+ * section as the claim, so they are ordered like the ring bytes.
+ *
+ * @ingroup uart_tx
+ */
+
+#include "uart_tx.h"
+#include "usb_cdc.h"
+#include "telemetry_uart.h"
+#include "metrics.h"
+#include "hil_probe.h"
+#include <string.h>
+
+#if ((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1U)) != 0U)
+#error "UART_TX_BUFFER_SIZE must be a power of two"
+#endif
+
+#if ((UART_TX_RESERVE_CLI + UART_TX_RESERVE_TELEMETRY) >= UART_TX_BUFFER_SIZE)
+#error "UART_TX_RESERVE_* leave no room for log output"
+#endif
+
+#if ((UART_TX_RESERVE_CLI_BUSY < UART_TX_RESERVE_CLI) || \
+     ((UART_TX_RESERVE_CLI_BUSY + UART_TX_RESERVE_TELEMETRY) >= UART_TX_BUFFER_SIZE))
+#error "UART_TX_RESERVE_CLI_BUSY must lie between UART_TX_RESERVE_CLI and the ring size"
+#endif
+
+#if ((UART_TX_REF_SLOTS & (UART_TX_REF_SLOTS - 1U)) != 0U)
+#error "UART_TX_REF_SLOTS must be a power of two"
+#endif
+
+/** @brief Index mask for the ring buffer. */
+#define UART_TX_INDEX_MASK   (UART_TX_BUFFER_SIZE - 1U)
+
+/**
+ * @brief UART handle used for transmission.
+ */
+static UART_HandleTypeDef *s_txUart = NULL;
+
+/**
+ * @brief Transmit ring storage.
+ */
+static uint8_t s_txBuffer[UART_TX_BUFFER_SIZE];
+
+/**
+ * @brief Free-running index up to which bytes are handed to the DMA.
+ */
+static volatile uint32_t s_head = 0U;
+
+/**
+ * @brief Free-running index up to which space is claimed by producers.
+ */
+static volatile uint32_t s_claim = 0U;
+
+/**
+ * @brief Producers between claiming space and finishing their copy.
+ */
+static volatile uint32_t s_writers = 0U;
+
+/**
+ * @brief Free-running read index (owned by the DMA completion path).
+ */
+static volatile uint32_t s_tail = 0U;
+
+/**
+ * @brief Length of the chunk currently handed to DMA (0 when idle).
+ */
+static volatile uint32_t s_dmaLen = 0U;
+
+/**
+ * @brief Number of bytes rejected because the ring was full.
+ */
+static volatile uint32_t s_droppedBytes = 0U;
+
+/**
+ * @brief Bytes rejected per stream.
+ */
+static volatile uint32_t s_streamDropped[UART_TX_STREAM_COUNT];
+
+/**
+ * @brief Ring bytes each stream must leave free for the streams above it.
+ */
+static const uint32_t s_streamReserve[UART_TX_STREAM_COUNT] =
+{
+    0U,
+    UART_TX_RESERVE_CLI,
+    UART_TX_RESERVE_CLI + UART_TX_RESERVE_TELEMETRY,
+};
+
+/**
+ * @brief Transmission held by UartTx_Hold().
+ */
+static volatile bool s_hold = false;
+
+/**
+ * @brief Hook per stream waiting for room (UartTx_NotifyFree()).
+ */
+static volatile StreamSpaceHook_t s_spaceHook[UART_TX_STREAM_COUNT];
+
+/**
+ * @brief Free bytes each @c s_spaceHook waits for.
+ */
+static uint32_t s_spaceWanted[UART_TX_STREAM_COUNT];
+
+/**
+ * @brief A CLI response is pending: the lower streams leave
+ *        @ref UART_TX_RESERVE_CLI_BUSY (UartTx_SetCliBusy()).
+ */
+static volatile bool s_cliBusy = false;
+
+/**
+ * @brief What a reference queue entry stands for.
+ */
+typedef enum
+{
+    UART_TX_REF_DATA = 0U, /**< By-reference segment, sent from @c data.       */
+    UART_TX_REF_OPEN,      /**< Reservation not committed yet (@c at its end). */
+    UART_TX_REF_SKIP       /**< Unused end of a committed reservation.         */
+} UartTxRefKind_t;
+
+/**
+ * @brief A by-reference segment waiting for its place in the stream, or
+ *        ring bytes the DMA chain steps over.
+ *
+ * Each reservation queues an entry when it claims its space, so entries
+ * stay in stream order; its commit turns it into a skip of the span's
+ * unused end (or removes it when the end could be given back).
+ */
+typedef struct
+{
+    const uint8_t *data;  /**< Source (stays valid until sent).     */
+    uint32_t       at;    /**< Ring index the segment is sent at.   */
+    uint16_t       len;   /**< Bytes.                               */
+    uint8_t        kind;  /**< @ref UartTxRefKind_t.                */
+} UartTxRef_t;
+
+/**
+ * @brief Queued references, oldest at @c s_refTail.
+ */
+static UartTxRef_t s_refs[UART_TX_REF_SLOTS];
+
+/**
+ * @brief Free-running reference write index (advanced with interrupts masked).
+ */
+static volatile uint32_t s_refHead = 0U;
+
+/**
+ * @brief Free-running reference read index (owned by the DMA completion path).
+ */
+static volatile uint32_t s_refTail = 0U;
+
+/**
+ * @brief Bytes of the queued references.
+ */
+static volatile uint32_t s_refBytes = 0U;
+
+/**
+ * @brief The transfer in flight is the oldest reference, not ring bytes.
+ */
+static volatile bool s_dmaRef = false;
+
+/**
+ * @brief The transfer in flight is a USB bulk transfer, not UART DMA.
+ */
+static volatile bool s_dmaUsb = false;
+
+/**
+ * @brief Start a DMA transfer for the next contiguous chunk if idle.
+ *
+ * Must be called with interrupts masked or from the completion ISR.
+ */
+static void UartTx_StartNextChunk(void);
+
+/**
+ * @brief Leave the writers after a copy: the last one out publishes
+ *        everything claimed and starts the DMA.
+ */
+static void UartTx_Publish(void);
+
+/* Stream_t adapters: the stream's unit is the UartTxStream_t. */
+static bool   UartTx_StreamWrite(const Stream_t *stream, const void *data, size_t len);
+static bool   UartTx_StreamWriteSegments(const Stream_t *stream, const StreamSegment_t *segments,
+                                         size_t count);
+static bool   UartTx_StreamReserve(const Stream_t *stream, size_t len, StreamSpan_t *span);
+static void   UartTx_StreamCommit(const Stream_t *stream, const StreamSpan_t *span, size_t used);
+static void   UartTx_StreamFlush(const Stream_t *stream);
+static size_t UartTx_StreamWritable(const Stream_t *stream);
+static bool   UartTx_StreamNotify(const Stream_t *stream, size_t len, StreamSpaceHook_t hook);
+
+/** @brief Stream interface of the ring. */
+static const StreamIF_t s_streamIF =
+{
+    .write         = UartTx_StreamWrite,
+    .writeSegments = UartTx_StreamWriteSegments,
+    .reserve       = UartTx_StreamReserve,
+    .commit        = UartTx_StreamCommit,
+    .read          = NULL,
+    .flush         = UartTx_StreamFlush,
+    .writable      = UartTx_StreamWritable,
+    .notify        = UartTx_StreamNotify
+};
+
+/** @brief One stream per writer. */
+static const Stream_t s_streams[UART_TX_STREAM_COUNT] =
+{
+    { &s_streamIF, (uint32_t)UART_TX_STREAM_CLI },
+    { &s_streamIF, (uint32_t)UART_TX_STREAM_TELEMETRY },
+    { &s_streamIF, (uint32_t)UART_TX_STREAM_LOG },
+};
+
+/**
+ * @brief Ring bytes a write of @p stream must leave free.
+ */
+static inline uint32_t UartTx_ReserveOf(UartTxStream_t stream)
+{
+    return s_streamReserve[stream] +
+           ((s_cliBusy && (stream != UART_TX_STREAM_CLI)) ?
+            (UART_TX_RESERVE_CLI_BUSY - UART_TX_RESERVE_CLI) : 0U);
+}
+
+/**
+ * @brief Whether a segment is sent by reference (other conditions aside).
+ */
+static inline bool UartTx_IsRef(const StreamSegment_t *segment)
+{
+    return segment->byRef && (segment->len >= UART_TX_REF_MIN) && (segment->len <= 0xFFFFU);
+}
+
+/**
+ * @brief Whether the oldest queued reference is next in the stream.
+ */
+static inline bool UartTx_RefIsNext(void)
+{
+    return (s_refHead != s_refTail) &&
+           (s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)].at == s_tail) &&
+           (s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)].kind == (uint8_t)UART_TX_REF_DATA);
+}
+
+/**
+ * @brief Step the tail over the skips that are next and published.
+ *
+ * Must be called with interrupts masked or from the completion ISR,
+ * with no transfer in flight.
+ */
+static void UartTx_StepOverSkips(void);
+
+/**
+ * @brief Hand a block to USB if the port is open, otherwise to UART DMA.
+ */
+static bool UartTx_StartTransfer(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Release (or, if unsent, keep) the transfer that just ended and
+ *        chain the next one.
+ */
+static void UartTx_TransferDone(bool sent);
+
+/**
+ * @brief Limit a ring chunk so it ends at the next queued reference.
+ */
+static uint32_t UartTx_ChunkLimit(uint32_t chunk);
+
+/**
+ * @brief Call (and clear) the space hooks whose room is free now.
+ *
+ * Called from the completion ISR after the tail moved.
+ */
+static void UartTx_NotifySpace(void);
+
+/**
+ * @brief Bus clock of the UART for a given AHB clock.
+ */
+static uint32_t UartTx_GetPclk(uint32_t hclk);
+
+/**
+ * @brief Rate a BRR value gives at @p pclk (0 for BRR 0).
+ */
+static uint32_t UartTx_BrrBaud(uint32_t pclk, uint32_t brr, bool over8);
+
+/**
+ * @brief Copy @p len bytes into the ring at free-running index @p pos.
+ */
+static void UartTx_CopyIn(uint32_t pos, const void *data, size_t len);
+
+/* ------------------------------------------------------------------------- */
+
+void UartTx_Init(UART_HandleTypeDef *huart)
+{
+    s_txUart       = huart;
+    s_head         = 0U;
+    s_claim        = 0U;
+    s_writers      = 0U;
+    s_tail         = 0U;
+    s_dmaLen       = 0U;
+    s_droppedBytes = 0U;
+    s_hold         = false;
+    s_refHead      = 0U;
+    s_refTail      = 0U;
+    s_refBytes     = 0U;
+    s_dmaRef       = false;
+    s_dmaUsb       = false;
+
+    for (uint32_t i = 0U; i < (uint32_t)UART_TX_STREAM_COUNT; ++i)
+    {
+        s_streamDropped[i] = 0U;
+        s_spaceHook[i]     = NULL;
+    }
+
+    Metrics_Publish(METRIC_UART_DROP_CLI, &s_streamDropped[UART_TX_STREAM_CLI]);
+    Metrics_Publish(METRIC_UART_DROP_TELEM, &s_streamDropped[UART_TX_STREAM_TELEMETRY]);
+    Metrics_Publish(METRIC_UART_DROP_LOG, &s_streamDropped[UART_TX_STREAM_LOG]);
+}
+
+bool UartTx_Write(const void *data, size_t len)
+{
+    return UartTx_WriteStream(UART_TX_STREAM_CLI, data, len);
+}
+
+bool UartTx_WriteStream(UartTxStream_t stream, const void *data, size_t len)
+{
+    const StreamSegment_t segment = { data, len, false };
+
+    return UartTx_WriteSegments(stream, &segment, 1U);
+}
+
+bool UartTx_WriteSegments(UartTxStream_t stream, const StreamSegment_t *segments, size_t count)
+{
+    if ((s_txUart == NULL) || (segments == NULL) || ((uint32_t)stream >= (uint32_t)UART_TX_STREAM_COUNT))
+    {
+        return false;
+    }
+
+    size_t total    = 0U;
+    size_t refTotal = 0U;
+    uint32_t refs   = 0U;
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        if ((segments[i].data == NULL) && (segments[i].len != 0U))
+        {
+            return false;
+        }
+
+        total += segments[i].len;
+        if (UartTx_IsRef(&segments[i]))
+        {
+            refTotal += segments[i].len;
+            refs++;
+        }
+    }
+
+    if (total == 0U)
+    {
+        return true;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* Without room for every reference, all of them are copied. */
+    bool     useRefs = (refs <= (UART_TX_REF_SLOTS - (s_refHead - s_refTail)));
+    size_t   copyLen = useRefs ? (total - refTotal) : total;
+    uint32_t start   = s_claim;
+
+    if ((copyLen + UartTx_ReserveOf(stream)) > (UART_TX_BUFFER_SIZE - (start - s_tail)))
+    {
+        s_droppedBytes += (uint32_t)total;
+        s_streamDropped[stream] += (uint32_t)total;
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    s_claim = start + (uint32_t)copyLen;
+    s_writers++;
+
+    if (useRefs && (refs != 0U))
+    {
+        uint32_t pos = start;
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            if (!UartTx_IsRef(&segments[i]))
+            {
+                pos += (uint32_t)segments[i].len;
+                continue;
+            }
+
+            UartTxRef_t *ref = &s_refs[s_refHead & (UART_TX_REF_SLOTS - 1U)];
+            ref->data = (const uint8_t *)segments[i].data;
+            ref->at   = pos;
+            ref->len  = (uint16_t)segments[i].len;
+            ref->kind = (uint8_t)UART_TX_REF_DATA;
+            s_refHead++;
+            s_refBytes += (uint32_t)segments[i].len;
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    uint32_t pos = start;
+    for (size_t i = 0U; i < count; ++i)
+    {
+        if ((segments[i].len == 0U) || (useRefs && UartTx_IsRef(&segments[i])))
+        {
+            continue;
+        }
+
+        UartTx_CopyIn(pos, segments[i].data, segments[i].len);
+        pos += (uint32_t)segments[i].len;
+    }
+
+    UartTx_Publish();
+
+    return true;
+}
+
+bool UartTx_Reserve(UartTxStream_t stream, size_t len, StreamSpan_t *span)
+{
+    if ((s_txUart == NULL) || (span == NULL) || (len == 0U) ||
+        ((uint32_t)stream >= (uint32_t)UART_TX_STREAM_COUNT))
+    {
+        return false;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t start  = s_claim;
+    uint32_t offset = start & UART_TX_INDEX_MASK;
+
+    if (((len + UartTx_ReserveOf(stream)) > (UART_TX_BUFFER_SIZE - (start - s_tail))) ||
+        (len > (UART_TX_BUFFER_SIZE - offset)) ||
+        ((s_refHead - s_refTail) >= UART_TX_REF_SLOTS))
+    {
+        __set_PRIMASK(primask);
+        return false;
+    }
+
+    s_claim = start + (uint32_t)len;
+    s_writers++;
+
+    /* Queued now, so that it keeps its place among the references. */
+    UartTxRef_t *skip = &s_refs[s_refHead & (UART_TX_REF_SLOTS - 1U)];
+    skip->data = NULL;
+    skip->at   = s_claim;
+    skip->len  = 0U;
+    skip->kind = (uint8_t)UART_TX_REF_OPEN;
+    s_refHead++;
+
+    __set_PRIMASK(primask);
+
+    span->data = &s_txBuffer[offset];
+    span->len  = len;
+    span->pos  = start;
+    return true;
+}
+
+void UartTx_Commit(const StreamSpan_t *span, size_t used)
+{
+    if ((span == NULL) || (span->data == NULL))
+    {
+        return;
+    }
+
+    if (used > span->len)
+    {
+        used = span->len;
+    }
+
+    uint32_t end     = span->pos + (uint32_t)span->len;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    UartTxRef_t *skip = NULL;
+    for (uint32_t i = s_refTail; i != s_refHead; ++i)
+    {
+        UartTxRef_t *ref = &s_refs[i & (UART_TX_REF_SLOTS - 1U)];
+
+        if ((ref->kind == (uint8_t)UART_TX_REF_OPEN) && (ref->at == end))
+        {
+            skip = ref;
+            break;
+        }
+    }
+
+    if ((skip != NULL) && (s_claim == end) &&
+        (skip == &s_refs[(s_refHead - 1U) & (UART_TX_REF_SLOTS - 1U)]))
+    {
+        /* Newest claim and newest entry: the rest is given back. */
+        s_claim = span->pos + (uint32_t)used;
+        s_refHead--;
+    }
+    else if (skip != NULL)
+    {
+        /* Claims follow it: the DMA chain steps over the rest. */
+        skip->at   = span->pos + (uint32_t)used;
+        skip->len  = (uint16_t)(span->len - used);
+        skip->kind = (uint8_t)UART_TX_REF_SKIP;
+    }
+
+    __set_PRIMASK(primask);
+
+    UartTx_Publish();
+}
+
+const Stream_t *UartTx_GetStream(UartTxStream_t stream)
+{
+    if ((uint32_t)stream >= (uint32_t)UART_TX_STREAM_COUNT)
+    {
+        stream = UART_TX_STREAM_LOG;
+    }
+
+    return &s_streams[stream];
+}
+
+bool UartTx_NotifyFree(UartTxStream_t stream, size_t len, StreamSpaceHook_t hook)
+{
+    if (((uint32_t)stream >= (uint32_t)UART_TX_STREAM_COUNT) ||
+        (len > (UART_TX_BUFFER_SIZE - s_streamReserve[stream])))
+    {
+        return false;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    bool now = (hook != NULL) && (UartTx_GetFree(stream) >= len);
+
+    s_spaceWanted[stream] = (uint32_t)len;
+    s_spaceHook[stream]   = now ? NULL : hook;
+
+    __set_PRIMASK(primask);
+
+    if (now)
+    {
+        hook();
+    }
+    return true;
+}
+
+void UartTx_Flush(void)
+{
+    if (s_txUart == NULL)
+    {
+        return;
+    }
+
+    bool irqUsable = (__get_PRIMASK() == 0U) && (__get_IPSR() == 0U);
+
+    s_hold = false;
+
+    if (irqUsable)
+    {
+        /* Normal context: the completion interrupt drains the ring. Re-kick
+         * in case a previous start attempt found the UART busy.
+         */
+        while ((s_head != s_tail) || UartTx_RefIsNext())
+        {
+            __disable_irq();
+            UartTx_StartNextChunk();
+            __enable_irq();
+        }
+        return;
+    }
+
+    /* Fault path: stop DMA, account for what already went out, and send
+     * the remainder by polling. HAL_MAX_DELAY avoids any tick dependency.
+     */
+    if (s_dmaLen != 0U)
+    {
+        uint32_t sent = 0U;
+
+        if (s_dmaUsb)
+        {
+            /* What the host already took is unknown: resend it all. */
+            UsbCdc_AbortTx();
+            s_dmaUsb = false;
+        }
+        else
+        {
+            sent = s_dmaLen - __HAL_DMA_GET_COUNTER(s_txUart->hdmatx);
+            (void)HAL_UART_AbortTransmit(s_txUart);
+        }
+
+        if (s_dmaRef)
+        {
+            /* Keep the unsent part of the reference. */
+            UartTxRef_t *ref = &s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)];
+            ref->data  += sent;
+            ref->len    = (uint16_t)(ref->len - sent);
+            s_refBytes -= sent;
+            s_dmaRef    = false;
+        }
+        else
+        {
+            s_tail += sent;
+        }
+        s_dmaLen = 0U;
+    }
+
+    while ((s_head != s_tail) || (s_refHead != s_refTail))
+    {
+        UartTx_StepOverSkips();
+
+        if (s_refHead != s_refTail)
+        {
+            UartTxRef_t *ref = &s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)];
+
+            if ((ref->at == s_tail) && (ref->kind == (uint8_t)UART_TX_REF_DATA))
+            {
+                (void)HAL_UART_Transmit(s_txUart,
+                                        (uint8_t *)(uintptr_t)ref->data,
+                                        ref->len,
+                                        HAL_MAX_DELAY);
+                s_refBytes -= ref->len;
+                s_refTail++;
+                continue;
+            }
+        }
+
+        if (s_head == s_tail)
+        {
+            /* The next reference belongs to a write still being copied. */
+            break;
+        }
+
+        uint32_t offset = s_tail & UART_TX_INDEX_MASK;
+        uint32_t chunk  = UartTx_ChunkLimit(s_head - s_tail);
+        if (chunk > (UART_TX_BUFFER_SIZE - offset))
+        {
+            chunk = UART_TX_BUFFER_SIZE - offset;
+        }
+
+        (void)HAL_UART_Transmit(s_txUart,
+                                &s_txBuffer[offset],
+                                (uint16_t)chunk,
+                                HAL_MAX_DELAY);
+        s_tail += chunk;
+    }
+}
+
+void UartTx_Hold(bool hold)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_hold = hold;
+    if (!hold)
+    {
+        UartTx_StartNextChunk();
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void UartTx_SetCliBusy(bool busy)
+{
+    s_cliBusy = busy;
+}
+
+void UartTx_DiscardPending(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_head  = s_tail + (s_dmaRef ? 0U : s_dmaLen);
+    s_claim = s_head;
+
+    /* Only a reference already in flight is kept. */
+    s_refHead  = s_refTail + (s_dmaRef ? 1U : 0U);
+    s_refBytes = s_dmaRef ? s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)].len : 0U;
+
+    __set_PRIMASK(primask);
+}
+
+size_t UartTx_GetPending(void)
+{
+    return (size_t)(s_head - s_tail) + s_refBytes;
+}
+
+size_t UartTx_GetFree(UartTxStream_t stream)
+{
+    if ((uint32_t)stream >= (uint32_t)UART_TX_STREAM_COUNT)
+    {
+        return 0U;
+    }
+
+    uint32_t space   = UART_TX_BUFFER_SIZE - (s_claim - s_tail);
+    uint32_t reserve = UartTx_ReserveOf(stream);
+
+    return (space > reserve) ? (size_t)(space - reserve) : 0U;
+}
+
+bool UartTx_IsIdle(void)
+{
+    if (s_txUart == NULL)
+    {
+        return true;
+    }
+
+    return (s_head == s_tail) && (s_refHead == s_refTail) &&
+           (__HAL_UART_GET_FLAG(s_txUart, UART_FLAG_TC) != 0U);
+}
+
+bool UartTx_SetBaudRate(uint32_t baud, bool over8)
+{
+    if ((s_txUart == NULL) || (baud == 0U))
+    {
+        return false;
+    }
+
+    uint32_t pclk   = UartTx_GetPclk(HAL_RCC_GetHCLKFreq());
+    uint32_t actual = 0U;
+
+    /* The divider's mantissa must be at least 1. */
+    if (((uint64_t)baud * (over8 ? 8U : 16U)) <= pclk)
+    {
+        actual = UartTx_BrrBaud(pclk,
+                                over8 ? UART_BRR_SAMPLING8(pclk, baud) : UART_BRR_SAMPLING16(pclk, baud),
+                                over8);
+    }
+
+    uint32_t error = (actual > baud) ? (actual - baud) : (baud - actual);
+
+    if ((actual == 0U) || (((uint64_t)error * 1000U) > ((uint64_t)baud * CONSOLE_BAUD_TOLERANCE_PPT)))
+    {
+        return false;
+    }
+
+    UartTx_Flush();
+    while (!UartTx_IsIdle())
+    {
+    }
+
+    USART_TypeDef *uart    = s_txUart->Instance;
+    uint32_t       primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* OVER8 may only change with the USART disabled; reception resumes
+     * into the same DMA stream once it is enabled again.
+     */
+    uart->CR1 &= ~USART_CR1_UE;
+    s_txUart->Init.BaudRate     = baud;
+    s_txUart->Init.OverSampling = over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    if (over8)
+    {
+        uart->CR1 |= USART_CR1_OVER8;
+    }
+    else
+    {
+        uart->CR1 &= ~USART_CR1_OVER8;
+    }
+    UartTx_SetBaudClock(HAL_RCC_GetHCLKFreq());
+    uart->CR1 |= USART_CR1_UE;
+
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+uint32_t UartTx_GetBaudRate(bool *over8)
+{
+    if (s_txUart == NULL)
+    {
+        return 0U;
+    }
+
+    if (over8 != NULL)
+    {
+        *over8 = (s_txUart->Init.OverSampling == UART_OVERSAMPLING_8);
+    }
+
+    return s_txUart->Init.BaudRate;
+}
+
+uint32_t UartTx_GetActualBaud(void)
+{
+    if (s_txUart == NULL)
+    {
+        return 0U;
+    }
+
+    return UartTx_BrrBaud(UartTx_GetPclk(HAL_RCC_GetHCLKFreq()),
+                          s_txUart->Instance->BRR,
+                          (s_txUart->Instance->CR1 & USART_CR1_OVER8) != 0U);
+}
+
+void UartTx_UpdateBaudRate(void)
+{
+    UartTx_SetBaudClock(HAL_RCC_GetHCLKFreq());
+}
+
+void UartTx_SetBaudClock(uint32_t hclk)
+{
+    if (s_txUart == NULL)
+    {
+        return;
+    }
+
+    USART_TypeDef *uart = s_txUart->Instance;
+    uint32_t       pclk = UartTx_GetPclk(hclk);
+
+    if (s_txUart->Init.OverSampling == UART_OVERSAMPLING_8)
+    {
+        uart->BRR = UART_BRR_SAMPLING8(pclk, s_txUart->Init.BaudRate);
+    }
+    else
+    {
+        uart->BRR = UART_BRR_SAMPLING16(pclk, s_txUart->Init.BaudRate);
+    }
+}
+
+uint32_t UartTx_GetDroppedBytes(void)
+{
+    return s_droppedBytes;
+}
+
+uint32_t UartTx_GetStreamDroppedBytes(UartTxStream_t stream)
+{
+    return ((uint32_t)stream < (uint32_t)UART_TX_STREAM_COUNT) ? s_streamDropped[stream] : 0U;
+}
+
+void UartTx_OnTxComplete(UART_HandleTypeDef *huart)
+{
+    if ((huart != s_txUart) || (s_dmaLen == 0U) || s_dmaUsb)
+    {
+        return;
+    }
+
+    UartTx_TransferDone(true);
+}
+
+void UartTx_OnUsbTxComplete(bool sent)
+{
+    if ((s_dmaLen == 0U) || !s_dmaUsb)
+    {
+        return;
+    }
+
+    s_dmaUsb = false;
+    UartTx_TransferDone(sent);
+}
+
+/**
+ * @brief Route HAL transmit-complete events to the TX ring (and to the
+ *        telemetry UART's).
+ *
+ * Overrides the weak HAL callback.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    UartTx_OnTxComplete(huart);
+    TelemetryUart_OnTxComplete(huart);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void UartTx_Publish(void)
+{
+    /* Publish the data before the new head becomes visible to the ISR. */
+    __DMB();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* A writer that interrupted this copy has left its bytes behind ours;
+     * the last one out publishes everything claimed so far.
+     */
+    s_writers--;
+    if (s_writers == 0U)
+    {
+        s_head = s_claim;
+    }
+    UartTx_StartNextChunk();
+
+    __set_PRIMASK(primask);
+}
+
+static bool UartTx_StreamWrite(const Stream_t *stream, const void *data, size_t len)
+{
+    return UartTx_WriteStream((UartTxStream_t)stream->unit, data, len);
+}
+
+static bool UartTx_StreamWriteSegments(const Stream_t *stream, const StreamSegment_t *segments,
+                                       size_t count)
+{
+    return UartTx_WriteSegments((UartTxStream_t)stream->unit, segments, count);
+}
+
+static bool UartTx_StreamReserve(const Stream_t *stream, size_t len, StreamSpan_t *span)
+{
+    return UartTx_Reserve((UartTxStream_t)stream->unit, len, span);
+}
+
+static void UartTx_StreamCommit(const Stream_t *stream, const StreamSpan_t *span, size_t used)
+{
+    (void)stream;
+    UartTx_Commit(span, used);
+}
+
+static void UartTx_StreamFlush(const Stream_t *stream)
+{
+    (void)stream;
+    UartTx_Flush();
+}
+
+static size_t UartTx_StreamWritable(const Stream_t *stream)
+{
+    return UartTx_GetFree((UartTxStream_t)stream->unit);
+}
+
+static bool UartTx_StreamNotify(const Stream_t *stream, size_t len, StreamSpaceHook_t hook)
+{
+    return UartTx_NotifyFree((UartTxStream_t)stream->unit, len, hook);
+}
+
+static void UartTx_StartNextChunk(void)
+{
+    if ((s_dmaLen != 0U) || s_hold)
+    {
+        return;
+    }
+
+    UartTx_StepOverSkips();
+
+    uint32_t tail = s_tail;
+
+    if (UartTx_RefIsNext())
+    {
+        /* The reference is next in the stream: send it from where it lives. */
+        const UartTxRef_t *ref = &s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)];
+
+        if (UartTx_StartTransfer(ref->data, ref->len))
+        {
+            s_dmaRef = true;
+            s_dmaLen = ref->len;
+        }
+        return;
+    }
+
+    uint32_t used = s_head - tail;
+    if (used == 0U)
+    {
+        return;
+    }
+
+    /* DMA needs a contiguous block: stop at the end of storage, and at the
+     * next reference.
+     */
+    uint32_t offset = tail & UART_TX_INDEX_MASK;
+    uint32_t chunk  = UART_TX_BUFFER_SIZE - offset;
+    if (chunk > used)
+    {
+        chunk = used;
+    }
+    chunk = UartTx_ChunkLimit(chunk);
+
+    if (UartTx_StartTransfer(&s_txBuffer[offset], chunk))
+    {
+        s_dmaLen = chunk;
+    }
+}
+
+static bool UartTx_StartTransfer(const uint8_t *data, uint32_t len)
+{
+    if (UsbCdc_IsOpen() && UsbCdc_StartTx(data, len))
+    {
+        HIL_PROBE_MARK(TX);
+        s_dmaUsb = true;
+        return true;
+    }
+
+    if (HAL_UART_Transmit_DMA(s_txUart, (uint8_t *)(uintptr_t)data, (uint16_t)len) != HAL_OK)
+    {
+        return false;
+    }
+
+    HIL_PROBE_MARK(TX);
+    return true;
+}
+
+static void UartTx_TransferDone(bool sent)
+{
+    if (sent)
+    {
+        if (s_dmaRef)
+        {
+            s_refBytes -= s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)].len;
+            s_refTail++;
+        }
+        else
+        {
+            s_tail += s_dmaLen;
+        }
+    }
+    s_dmaRef = false;
+    s_dmaLen = 0U;
+
+    UartTx_StartNextChunk();
+    UartTx_NotifySpace();
+}
+
+static uint32_t UartTx_ChunkLimit(uint32_t chunk)
+{
+    if (s_refHead != s_refTail)
+    {
+        uint32_t toRef = s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)].at - s_tail;
+
+        if (chunk > toRef)
+        {
+            chunk = toRef;
+        }
+    }
+
+    return chunk;
+}
+
+static void UartTx_NotifySpace(void)
+{
+    for (uint32_t i = 0U; i < (uint32_t)UART_TX_STREAM_COUNT; ++i)
+    {
+        StreamSpaceHook_t hook = s_spaceHook[i];
+
+        if ((hook != NULL) && (UartTx_GetFree((UartTxStream_t)i) >= s_spaceWanted[i]))
+        {
+            s_spaceHook[i] = NULL;
+            hook();
+        }
+    }
+}
+
+static void UartTx_StepOverSkips(void)
+{
+    while (s_refHead != s_refTail)
+    {
+        const UartTxRef_t *ref = &s_refs[s_refTail & (UART_TX_REF_SLOTS - 1U)];
+
+        /* A skip is only stepped over once its bytes are published. */
+        if ((ref->kind != (uint8_t)UART_TX_REF_SKIP) || (ref->at != s_tail) ||
+            ((s_head - s_tail) < ref->len))
+        {
+            return;
+        }
+
+        s_tail += ref->len;
+        s_refTail++;
+    }
+}
+
+static void UartTx_CopyIn(uint32_t pos, const void *data, size_t len)
+{
+    uint32_t offset = pos & UART_TX_INDEX_MASK;
+    size_t   first  = UART_TX_BUFFER_SIZE - offset;
+
+    if (first > len)
+    {
+        first = len;
+    }
+
+    memcpy(&s_txBuffer[offset], data, first);
+    memcpy(&s_txBuffer[0], (const uint8_t *)data + first, len - first);
+}
+
+static uint32_t UartTx_GetPclk(uint32_t hclk)
+{
+    USART_TypeDef *uart = s_txUart->Instance;
+
+    return ((uart == USART1) || (uart == USART6)) ?
+        (hclk >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos]) :
+        (hclk >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos]);
+}
+
+static uint32_t UartTx_BrrBaud(uint32_t pclk, uint32_t brr, bool over8)
+{
+    /* BRR is the divider in 16ths (OVER8: 8ths, the fraction in bits 2:0). */
+    if (over8)
+    {
+        brr = ((brr >> 4) << 3) | (brr & 0x7U);
+    }
+
+    return (brr != 0U) ? ((pclk + (brr / 2U)) / brr) : 0U;
+}
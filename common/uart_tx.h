@@ -0,0 +1,402 @@
+/**
+ * @file uart_tx.h
+ * @brief Non-blocking, DMA-driven UART transmit path.
+ *
+ * This module owns a single transmit ring buffer for the console UART.
+ * Producers (logging, CLI, telemetry) copy bytes into the ring from any
+ * context and return immediately; the ring is drained in the background by UART TX DMA,
+ * with each DMA completion interrupt chaining the next transfer.
+ *
+ * Writers are ranked by stream (@ref UartTxStream_t): a lower-priority
+ * write must leave the reserve of the streams above it free, so a burst
+ * of log lines cannot take the space a CLI response or a telemetry frame
+ * needs. Each write is queued whole and never interleaves with another,
+ * which keeps records and lines intact on the shared UART.
+ *
+ * While a USB host has the CDC console open (usb_cdc.h), the ring drains
+ * over USB instead, through the same chain. With the dedicated telemetry
+ * UART (telemetry_uart.h) the telemetry stream carries nothing.
+ *
+ * Each writer is also available as a @ref Stream_t (UartTx_GetStream()),
+ * which is what the logger, the CLI and telemetry write to.
+ *
+ * @ingroup common
+ */
+
+#ifndef UART_TX_H
+#define UART_TX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "stm32f4xx_hal.h"
+#include "app_config.h"
+#include "stream.h"
+
+/**
+ * @defgroup uart_tx UART Transmit Ring
+ * @brief Background UART transmission through a ring buffer and DMA.
+ * @ingroup common
+ * @{
+ */
+
+/**
+ * @brief Size of the transmit ring buffer in bytes.
+ *
+ * Must be a power of two. At 115200 baud this holds roughly 180 ms of
+ * output, which comfortably absorbs bursts such as the CLI help text.
+ */
+#define UART_TX_BUFFER_SIZE   (2048U)
+
+/**
+ * @brief Number of by-reference segments that can be queued.
+ *
+ * Must be a power of two. Each queued reference is sent as its own DMA
+ * transfer straight from its source (flash), in its place in the byte
+ * stream. Open reservations (UartTx_Reserve()) hold a slot too.
+ */
+#define UART_TX_REF_SLOTS     (16U)
+
+/**
+ * @brief Shortest segment worth sending by reference.
+ *
+ * A DMA transfer costs about as much to set up as copying a few dozen
+ * bytes, so shorter by-reference segments are copied instead.
+ */
+#define UART_TX_REF_MIN       (24U)
+
+/**
+ * @brief Ring bytes that telemetry and log writes leave for CLI output.
+ */
+#define UART_TX_RESERVE_CLI        (256U)
+
+/**
+ * @brief Further ring bytes that log writes leave for telemetry.
+ */
+#define UART_TX_RESERVE_TELEMETRY  (256U)
+
+/**
+ * @brief Ring bytes telemetry and log writes leave for CLI output while a
+ *        command response is pending (UartTx_SetCliBusy()).
+ *
+ * Sized for the longest regular response (`power`, `tasks`: about 1.5 KB).
+ */
+#define UART_TX_RESERVE_CLI_BUSY   (1536U)
+
+/**
+ * @brief Writers of the shared UART, highest priority first.
+ */
+typedef enum
+{
+    UART_TX_STREAM_CLI = 0U,   /**< Command responses and the prompt. */
+    UART_TX_STREAM_TELEMETRY,  /**< Binary telemetry frames.          */
+    UART_TX_STREAM_LOG,        /**< Log lines and records.            */
+    UART_TX_STREAM_COUNT       /**< Number of streams.                */
+} UartTxStream_t;
+
+/**
+ * @brief Initialize the transmit ring for a UART.
+ *
+ * The UART handle must already be initialized and linked to a TX DMA
+ * stream (see HAL_UART_MspInit()).
+ *
+ * @param huart Pointer to the UART handle used for output.
+ *
+ * @return None.
+ */
+void UartTx_Init(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Queue bytes for transmission as CLI output.
+ *
+ * Same as UartTx_WriteStream() on @ref UART_TX_STREAM_CLI.
+ *
+ * @param data Pointer to the bytes to send.
+ * @param len  Number of bytes to send.
+ *
+ * @return true if the bytes were queued, false if they were dropped.
+ */
+bool UartTx_Write(const void *data, size_t len);
+
+/**
+ * @brief Queue bytes for transmission on behalf of a stream.
+ *
+ * The write is all-or-nothing: if the ring does not have room for the
+ * complete buffer, less the reserve of the higher-priority streams,
+ * nothing is queued and the stream's drop counter is increased. This
+ * keeps log lines, frames and CLI responses from being truncated.
+ *
+ * Safe from thread mode, any interrupt and several threads at once: each
+ * call claims its own span of the ring, so concurrent writes never mix.
+ * Nothing blocks; bytes become visible to the DMA once every write that
+ * had claimed space has finished copying.
+ *
+ * @param stream Writer.
+ * @param data   Pointer to the bytes to send.
+ * @param len    Number of bytes to send.
+ *
+ * @return true if the bytes were queued, false if they were dropped.
+ */
+bool UartTx_WriteStream(UartTxStream_t stream, const void *data, size_t len);
+
+/**
+ * @brief Queue several pieces as one write, some of them by reference.
+ *
+ * Copied segments go into the ring; by-reference segments are queued as
+ * pointers and sent by DMA directly from their source at their place in
+ * the stream, so long constant text (help strings) costs neither a copy
+ * nor ring space. All-or-nothing and as safe to call from any context as
+ * UartTx_WriteStream(); another writer's bytes never land between the
+ * segments. References shorter than @ref UART_TX_REF_MIN, or that find
+ * the reference queue full, are copied.
+ *
+ * @param stream   Writer.
+ * @param segments Pieces in output order.
+ * @param count    Number of pieces.
+ *
+ * @return true if everything was queued, false if it was dropped.
+ */
+bool UartTx_WriteSegments(UartTxStream_t stream, const StreamSegment_t *segments, size_t count);
+
+/**
+ * @brief Claim @p len contiguous ring bytes to fill in place.
+ *
+ * The space is taken like a write of @p stream (its reserve rules
+ * apply) but not sent before UartTx_Commit(). Writes of other contexts
+ * may go on meanwhile and queue behind it. The claim holds one of the
+ * @ref UART_TX_REF_SLOTS until committed. Fails without counting a drop
+ * when the free space is short, wraps around the end of the ring, or no
+ * reference slot is free.
+ *
+ * @param stream     Writer.
+ * @param len        Bytes to claim.
+ * @param[out] span  Receives the space.
+ *
+ * @return false if not claimed.
+ */
+bool UartTx_Reserve(UartTxStream_t stream, size_t len, StreamSpan_t *span);
+
+/**
+ * @brief Send the first @p used bytes of a span from UartTx_Reserve().
+ *
+ * The rest is given back when no claim followed the span; otherwise the
+ * DMA chain steps over it, so it is never sent.
+ *
+ * @param span Space from UartTx_Reserve().
+ * @param used Bytes filled in, 0 to cancel.
+ *
+ * @return None.
+ */
+void UartTx_Commit(const StreamSpan_t *span, size_t used);
+
+/**
+ * @brief The ring as a @ref Stream_t for one writer.
+ *
+ * @param stream Writer.
+ *
+ * @return The writer's stream (@ref UART_TX_STREAM_LOG if invalid).
+ */
+const Stream_t *UartTx_GetStream(UartTxStream_t stream);
+
+/**
+ * @brief Call @p hook once @p len bytes are free for @p stream.
+ *
+ * One request per stream; a new one replaces the last. The hook runs
+ * from the DMA completion interrupt once enough has been sent, or before
+ * this returns if the room is already there. It is the stream's
+ * @c notify (Stream_NotifyWritable()).
+ *
+ * @param stream Writer.
+ * @param len    Free bytes (as UartTx_GetFree()) to wait for.
+ * @param hook   Function to call, or NULL to cancel the request.
+ *
+ * @return false if @p stream is invalid or @p len can never be free.
+ */
+bool UartTx_NotifyFree(UartTxStream_t stream, size_t len, StreamSpaceHook_t hook);
+
+/**
+ * @brief Block until all queued bytes have been sent.
+ *
+ * Safe to call with interrupts disabled or from an exception handler:
+ * in that case the in-flight DMA transfer is stopped and the remaining
+ * bytes are sent by polling the UART. Releases a UartTx_Hold().
+ *
+ * @return None.
+ */
+void UartTx_Flush(void);
+
+/**
+ * @brief Hold queued bytes in the ring instead of starting DMA.
+ *
+ * Writes still succeed while the ring has room. Releasing the hold
+ * starts transmission; UartTx_Flush() releases it as well. Used by the
+ * benchmark suite together with UartTx_DiscardPending() to time output
+ * paths without sending anything.
+ *
+ * @param hold true to hold, false to resume transmission.
+ *
+ * @return None.
+ */
+void UartTx_Hold(bool hold);
+
+/**
+ * @brief Give CLI output precedence while a command response is pending.
+ *
+ * While set, telemetry and log writes leave @ref UART_TX_RESERVE_CLI_BUSY
+ * ring bytes free instead of @ref UART_TX_RESERVE_CLI, so a flood of
+ * either cannot crowd out the response: the logger holds back the lines
+ * that do not fit, telemetry frames that do not fit are dropped. Safe to
+ * call from any context.
+ *
+ * @param busy true while a response is pending.
+ *
+ * @return None.
+ */
+void UartTx_SetCliBusy(bool busy);
+
+/**
+ * @brief Drop every queued byte not yet handed to DMA.
+ *
+ * The chunk already in flight still completes. Dropped bytes are not
+ * counted in UartTx_GetDroppedBytes(). Must not be called while another
+ * context may be inside UartTx_Write().
+ *
+ * @return None.
+ */
+void UartTx_DiscardPending(void);
+
+/**
+ * @brief Number of bytes currently waiting in the ring.
+ *
+ * @return Pending byte count (including the in-flight DMA chunk).
+ */
+size_t UartTx_GetPending(void);
+
+/**
+ * @brief Ring bytes a write of @p stream could use right now.
+ *
+ * @param stream Writer.
+ *
+ * @return Free bytes less the reserve of the higher-priority streams.
+ */
+size_t UartTx_GetFree(UartTxStream_t stream);
+
+/**
+ * @brief Check whether the UART has finished sending everything.
+ *
+ * True only when the ring is empty and the last byte has left the shift
+ * register, i.e. when the UART clock can safely be stopped.
+ *
+ * @return true if nothing is queued or in flight.
+ */
+bool UartTx_IsIdle(void);
+
+/**
+ * @brief Change the baud rate and oversampling.
+ *
+ * Waits until everything queued has been sent, then reprograms the
+ * USART. The setting is kept in the UART handle, so later clock profile
+ * changes (UartTx_UpdateBaudRate()) recompute the divider for it.
+ * Oversampling by 8 doubles the highest rate (PCLK / 8 instead of
+ * PCLK / 16) at the cost of noise margin on the receiver.
+ *
+ * @param baud  Baud rate.
+ * @param over8 true to oversample by 8, false by 16.
+ *
+ * @return false if the rate cannot be reached within
+ *         @ref CONSOLE_BAUD_TOLERANCE_PPT at the current clock; the
+ *         setting is unchanged then.
+ */
+bool UartTx_SetBaudRate(uint32_t baud, bool over8);
+
+/**
+ * @brief Configured baud rate and oversampling.
+ *
+ * @param[out] over8 Receives true for oversampling by 8 (may be NULL).
+ *
+ * @return Rate in baud (0 before UartTx_Init()).
+ */
+uint32_t UartTx_GetBaudRate(bool *over8);
+
+/**
+ * @brief Baud rate the current divider actually produces.
+ *
+ * @return Rate in baud (0 before UartTx_Init()).
+ */
+uint32_t UartTx_GetActualBaud(void);
+
+/**
+ * @brief Reprogram the baud rate divider after a bus clock change.
+ *
+ * Recomputes BRR for the configured baud rate from the current APB clock.
+ * The caller must ensure the transmitter is idle (see UartTx_IsIdle()); a
+ * character being received at that moment may be corrupted.
+ *
+ * @return None.
+ */
+void UartTx_UpdateBaudRate(void);
+
+/**
+ * @brief Reprogram the baud rate divider for a given AHB clock.
+ *
+ * As UartTx_UpdateBaudRate(), with HCLK given instead of taken from
+ * SystemCoreClock; the APB prescaler is read from RCC. Used to prepare
+ * the receiver for the clock the MCU wakes from STOP with.
+ *
+ * @param hclk AHB clock in Hz.
+ *
+ * @return None.
+ */
+void UartTx_SetBaudClock(uint32_t hclk);
+
+/**
+ * @brief Total number of bytes rejected because the ring was full.
+ *
+ * @return Dropped byte count since initialization.
+ */
+uint32_t UartTx_GetDroppedBytes(void);
+
+/**
+ * @brief Number of bytes of one stream rejected because the ring was full.
+ *
+ * @param stream Writer.
+ *
+ * @return Dropped byte count since initialization (0 for an invalid stream).
+ */
+uint32_t UartTx_GetStreamDroppedBytes(UartTxStream_t stream);
+
+/**
+ * @brief Transmit-complete hook for the UART HAL callback.
+ *
+ * Called from HAL_UART_TxCpltCallback() in interrupt context. Releases
+ * the finished chunk and starts the next DMA transfer, if any.
+ *
+ * @param huart UART handle that completed a transfer.
+ *
+ * @return None.
+ */
+void UartTx_OnTxComplete(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Completion hook for a chunk sent over the USB CDC console.
+ *
+ * Called by usb_cdc.c in interrupt context. A chunk that was not sent
+ * stays in the ring and goes out next, on the UART if the port closed.
+ *
+ * @param sent true if the host took the whole chunk.
+ *
+ * @return None.
+ */
+void UartTx_OnUsbTxComplete(bool sent);
+
+/** @} */ /* end of uart_tx group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_TX_H */
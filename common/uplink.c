@@ -0,0 +1,723 @@
+/**
+ * @file uplink.c
+ * @brief Network uplink implementation.
+ *
+ * Samples are encoded into the RAM batch; a sealed batch gets the next
+ * sequence number and waits in a ring of @ref UPLINK_QUEUE_BATCHES until
+ * the back end acknowledges it. The uplink coroutine runs the bursts: it
+ * waits for a trigger, switches the modem on, repeats HELLO until the
+ * modem answers, sends every held batch back to back and waits for the
+ * acknowledgements, then switches the modem off again. Everything the
+ * steps share lives in statics, since coroutine locals do not survive a
+ * wait.
+ *
+ * The receive path runs in the port's interrupts: bytes are collected up
+ * to the next 0x00, the frame is decoded in place, and a valid ACK is
+ * stored for the coroutine and signals it. Only the newest
+ * acknowledgement matters, as they are cumulative.
+ *
+ * A burst that gets no answer, or that runs out of retries, leaves the
+ * batches queued; the size trigger then waits for the next scheduled
+ * burst, so an unreachable network does not keep the radio on.
+ *
+ * @ingroup uplink
+ */
+
+#include "uplink.h"
+#include "uplink_hw.h"
+#include "app_config.h"
+#include "app_coroutine.h"
+#include "app_task_manager.h"
+#include "sample_codec.h"
+#include "telemetry.h"
+#include "cobs.h"
+#include "crc32.h"
+#include "cli.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+#include <string.h>
+
+_Static_assert((UPLINK_BURST_BATCHES >= 1U) && (UPLINK_BURST_BATCHES <= UPLINK_QUEUE_BATCHES),
+               "UPLINK_BURST_BATCHES out of range");
+
+/** @brief Frame header: type and sequence number. */
+#define UPLINK_HEADER_SIZE   (5U)
+
+/** @brief Telemetry header inside a BATCH frame: type, count and base_ms. */
+#define UPLINK_BATCH_HEADER  (6U)
+
+/** @brief Largest frame before stuffing: header, batch, CRC. */
+#define UPLINK_RAW_SIZE      (UPLINK_HEADER_SIZE + UPLINK_BATCH_HEADER + UPLINK_BATCH_PAYLOAD + 4U)
+
+/** @brief Largest frame on the wire, with both delimiters. */
+#define UPLINK_WIRE_SIZE     (COBS_MAX_ENCODED_SIZE(UPLINK_RAW_SIZE) + 2U)
+
+/** @brief Longest received frame kept; longer ones are discarded. */
+#define UPLINK_RX_MAX        (16U)
+
+/** @brief HELLO repeat interval while the modem does not answer (ms). */
+#define UPLINK_HELLO_RETRY_MS (500U)
+
+/**
+ * @brief One batch of encoded samples.
+ */
+typedef struct
+{
+    uint32_t seq;                           /**< Batch number.            */
+    uint32_t base_ms;                       /**< Codec base timestamp.    */
+    uint16_t length;                        /**< Payload bytes used.      */
+    uint8_t  count;                         /**< Samples in the payload.  */
+    uint8_t  payload[UPLINK_BATCH_PAYLOAD]; /**< sample_codec.h batch.    */
+} UplinkBatch_t;
+
+/** @brief Batch being filled, its encoder and whether it is open. */
+static UplinkBatch_t s_build;
+static SampleCodec_t s_codec;
+static bool          s_buildActive = false;
+
+/** @brief Sealed batches, oldest (lowest number) at @ref s_queueHead. */
+static UplinkBatch_t s_queue[UPLINK_QUEUE_BATCHES];
+static uint32_t      s_queueHead  = 0U;
+static uint32_t      s_queueCount = 0U;
+
+/** @brief Number of the next batch sealed. */
+static uint32_t s_nextSeq = 1U;
+
+/** @brief Next batch a burst sends. */
+static uint32_t s_sendSeq = 1U;
+
+/** @brief Frame being built and its stuffed form (read by the TX DMA). */
+static uint8_t s_raw[UPLINK_RAW_SIZE];
+static uint8_t s_wire[UPLINK_WIRE_SIZE];
+
+/** @brief Frame being received (interrupt context). */
+static uint8_t  s_rxFrame[UPLINK_RX_MAX];
+static uint32_t s_rxLen      = 0U;
+static bool     s_rxOverflow = false;
+
+/** @brief Newest acknowledgement, and whether the coroutine has seen it. */
+static volatile uint32_t s_ackSeq   = 0U;
+static volatile bool     s_ackFresh = false;
+
+/** @brief Burst state. */
+static UplinkRadio_t s_radio        = UPLINK_RADIO_OFF;
+static uint32_t      s_lastBurst_ms = 0U;  /**< End of the last burst.           */
+static uint32_t      s_radioOn_ms   = 0U;  /**< Start of this burst.             */
+static uint32_t      s_phase_ms     = 0U;  /**< Start of the join or ack wait.   */
+static uint32_t      s_hello_ms     = 0U;  /**< Last HELLO sent.                 */
+static bool          s_helloSent    = false;
+static uint32_t      s_tries        = 0U;  /**< Ack timeouts in a row.          */
+static bool          s_failed       = false; /**< Last burst left batches behind. */
+
+/** @brief Requests and settings. */
+static bool     s_enabled      = false;
+static bool     s_flushRequest = false;
+static uint32_t s_interval_ms  = UPLINK_INTERVAL_MS;
+
+/** @brief Counters. */
+static UplinkStats_t s_stats;
+
+/**
+ * @brief Coroutine: the bursts.
+ */
+static AppCoResult_t Uplink_Run(AppCoroutine_t *co);
+
+/**
+ * @brief Whether a burst should start now.
+ */
+static bool Uplink_BurstDue(void);
+
+/**
+ * @brief Time to wait for a trigger (ms, 0 = until signalled).
+ */
+static uint32_t Uplink_WaitMs(void);
+
+/**
+ * @brief Seal the RAM batch and switch the modem on.
+ */
+static void Uplink_BeginBurst(void);
+
+/**
+ * @brief Switch the modem off and account the burst.
+ */
+static void Uplink_EndBurst(void);
+
+/**
+ * @brief Send a HELLO if the last one is @ref UPLINK_HELLO_RETRY_MS old.
+ */
+static void Uplink_SendHello(void);
+
+/**
+ * @brief Whether a held batch has not been sent in this round.
+ */
+static bool Uplink_Pending(void);
+
+/**
+ * @brief Send batch @ref s_sendSeq; false if the UART is still busy.
+ */
+static bool Uplink_SendBatch(void);
+
+/**
+ * @brief Time left of the acknowledgement wait (ms, at least 1).
+ */
+static uint32_t Uplink_AckWaitLeft(void);
+
+/**
+ * @brief Apply the newest acknowledgement; true if it freed batches.
+ */
+static bool Uplink_TakeAck(void);
+
+/**
+ * @brief Add the CRC to @p len bytes of @ref s_raw, stuff and send them.
+ */
+static bool Uplink_Transmit(size_t len);
+
+/**
+ * @brief Store @p value little-endian.
+ */
+static void Uplink_PutLe(uint8_t *dst, uint32_t value, uint32_t size);
+
+/**
+ * @brief Read a little-endian value.
+ */
+static uint32_t Uplink_GetLe(const uint8_t *src, uint32_t size);
+
+/**
+ * @brief Check and apply the frame in @ref s_rxFrame (interrupt context).
+ */
+static void Uplink_OnFrame(void);
+
+/**
+ * @brief Queue the RAM batch.
+ */
+static void Uplink_Seal(void);
+
+/**
+ * @brief CLI "uplink" handler.
+ */
+static void Uplink_CmdUplink(uint32_t argc, char *argv[]);
+
+/** @brief Runs the bursts. */
+static AppCoroutine_t s_coroutine =
+{
+    .name     = "uplink",
+    .function = Uplink_Run
+};
+
+/* ------------------------------------------------------------------------- */
+
+void Uplink_Init(void)
+{
+    s_buildActive  = false;
+    s_queueHead    = 0U;
+    s_queueCount   = 0U;
+    s_nextSeq      = 1U;
+    s_sendSeq      = 1U;
+    s_rxLen        = 0U;
+    s_rxOverflow   = false;
+    s_ackFresh     = false;
+    s_radio        = UPLINK_RADIO_OFF;
+    s_failed       = false;
+    s_flushRequest = false;
+    s_interval_ms  = UPLINK_INTERVAL_MS;
+    s_stats        = (UplinkStats_t){0};
+    s_enabled      = (UPLINK_ENABLE_DEFAULT != 0);
+
+    UplinkHw_Init();
+    (void)AppCoroutine_Start(&s_coroutine);
+
+    (void)CLI_RegisterCommand("uplink", Uplink_CmdUplink,
+                              "[on|off|flush] - Modem uplink bursts");
+}
+
+void Uplink_SetEnabled(bool enable)
+{
+    if (!enable && s_buildActive)
+    {
+        Uplink_Seal();
+    }
+
+    s_enabled = enable;
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+bool Uplink_IsEnabled(void)
+{
+    return s_enabled;
+}
+
+bool Uplink_AddSample(const SensorSample_t *sample)
+{
+    if (!s_enabled || (sample == NULL))
+    {
+        return false;
+    }
+
+    if (!s_buildActive)
+    {
+        SampleCodec_Begin(&s_codec, SAMPLE_CODEC_DELTA, sample->timestamp,
+                          s_build.payload, sizeof(s_build.payload));
+        s_build.base_ms = sample->timestamp;
+        s_buildActive   = true;
+
+        /* Starts the interval timer of an idle coroutine. */
+        AppCoroutine_Signal(&s_coroutine);
+    }
+
+    if (!SampleCodec_Add(&s_codec, sample))
+    {
+        if (s_codec.count == 0U)
+        {
+            /* Does not fit even an empty batch. */
+            s_buildActive = false;
+            return false;
+        }
+        Uplink_Seal();
+        return Uplink_AddSample(sample);
+    }
+
+    s_stats.samples++;
+
+    if (s_codec.count >= 0xFFU)
+    {
+        Uplink_Seal();
+    }
+
+    return true;
+}
+
+void Uplink_Flush(void)
+{
+    if (s_buildActive)
+    {
+        Uplink_Seal();
+    }
+
+    s_flushRequest = true;
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+void Uplink_OnPowerMode(PowerMode_t mode)
+{
+    s_interval_ms = ((mode == POWER_MODE_SLEEP) || (mode == POWER_MODE_STOP)) ?
+                    UPLINK_LOW_POWER_INTERVAL_MS : UPLINK_INTERVAL_MS;
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+bool Uplink_IsIdle(void)
+{
+    return s_radio == UPLINK_RADIO_OFF;
+}
+
+void Uplink_GetStats(UplinkStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    *stats               = s_stats;
+    stats->radio         = s_radio;
+    stats->interval_ms   = s_interval_ms;
+    stats->batchesQueued = s_queueCount;
+    stats->nextSeq       = s_nextSeq;
+}
+
+void Uplink_OnHwRx(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0U; i < len; ++i)
+    {
+        if (data[i] == 0x00U)
+        {
+            if ((s_rxLen != 0U) && !s_rxOverflow)
+            {
+                Uplink_OnFrame();
+            }
+            s_rxLen      = 0U;
+            s_rxOverflow = false;
+        }
+        else if (s_rxLen < UPLINK_RX_MAX)
+        {
+            s_rxFrame[s_rxLen++] = data[i];
+        }
+        else
+        {
+            s_rxOverflow = true;
+        }
+    }
+}
+
+void Uplink_OnHwTxDone(void)
+{
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Internal Helper Functions                                                 */
+/* ------------------------------------------------------------------------- */
+
+static AppCoResult_t Uplink_Run(AppCoroutine_t *co)
+{
+    APP_CO_BEGIN(co);
+
+    s_lastBurst_ms = HAL_GetTick();
+
+    for (;;)
+    {
+        while (!Uplink_BurstDue())
+        {
+            APP_CO_WAIT_SIGNAL(co, Uplink_WaitMs());
+        }
+
+        Uplink_BeginBurst();
+
+        /* Join: the modem answers HELLO once it is on its network. */
+        while ((s_radio == UPLINK_RADIO_JOINING) &&
+               ((HAL_GetTick() - s_phase_ms) < UPLINK_JOIN_TIMEOUT_MS))
+        {
+            Uplink_SendHello();
+            APP_CO_WAIT_SIGNAL(co, UPLINK_HELLO_RETRY_MS);
+            (void)Uplink_TakeAck();
+        }
+
+        /* Send: held batches back to back, then wait for the acks. */
+        s_tries    = 0U;
+        s_phase_ms = HAL_GetTick();
+        while ((s_radio == UPLINK_RADIO_ONLINE) && (s_queueCount > 0U) &&
+               (s_tries <= UPLINK_RETRIES))
+        {
+            if (Uplink_Pending())
+            {
+                if (!Uplink_SendBatch())
+                {
+                    APP_CO_WAIT_SIGNAL(co, UPLINK_ACK_TIMEOUT_MS);
+                }
+                s_phase_ms = HAL_GetTick();
+            }
+            else
+            {
+                APP_CO_WAIT_SIGNAL(co, Uplink_AckWaitLeft());
+            }
+
+            if (Uplink_TakeAck())
+            {
+                s_tries    = 0U;
+                s_phase_ms = HAL_GetTick();
+            }
+            else if (!Uplink_Pending() && ((HAL_GetTick() - s_phase_ms) >= UPLINK_ACK_TIMEOUT_MS))
+            {
+                /* go-back-N from the oldest unacknowledged batch. */
+                s_tries++;
+                s_sendSeq  = s_queue[s_queueHead].seq;
+                s_phase_ms = HAL_GetTick();
+                if (s_tries <= UPLINK_RETRIES)
+                {
+                    s_stats.resends++;
+                }
+            }
+        }
+
+        /* Let the last frame leave before the supply goes. */
+        APP_CO_WAIT_UNTIL(co, !UplinkHw_IsSending(), 1U);
+        Uplink_EndBurst();
+    }
+
+    APP_CO_END(co);
+}
+
+static bool Uplink_BurstDue(void)
+{
+    if (!s_enabled || ((s_queueCount == 0U) && !s_buildActive))
+    {
+        s_flushRequest = false;
+        return false;
+    }
+
+    return s_flushRequest ||
+           (!s_failed && (s_queueCount >= UPLINK_BURST_BATCHES)) ||
+           ((HAL_GetTick() - s_lastBurst_ms) >= s_interval_ms);
+}
+
+static uint32_t Uplink_WaitMs(void)
+{
+    /* Nothing to send: opening or sealing a batch signals. */
+    if (!s_enabled || ((s_queueCount == 0U) && !s_buildActive))
+    {
+        return 0U;
+    }
+
+    uint32_t elapsed = HAL_GetTick() - s_lastBurst_ms;
+
+    return (elapsed < s_interval_ms) ? (s_interval_ms - elapsed) : 1U;
+}
+
+static void Uplink_BeginBurst(void)
+{
+    if (s_buildActive)
+    {
+        Uplink_Seal();
+    }
+
+    s_flushRequest = false;
+    s_ackFresh     = false;
+    s_helloSent    = false;
+    s_sendSeq      = (s_queueCount > 0U) ? s_queue[s_queueHead].seq : s_nextSeq;
+    s_radioOn_ms   = HAL_GetTick();
+    s_phase_ms     = s_radioOn_ms;
+    s_radio        = UPLINK_RADIO_JOINING;
+    s_stats.bursts++;
+
+    UplinkHw_PowerOn();
+}
+
+static void Uplink_EndBurst(void)
+{
+    uint32_t now = HAL_GetTick();
+
+    if (s_radio == UPLINK_RADIO_JOINING)
+    {
+        s_stats.joinFailures++;
+        LOG_WARN("Uplink: no answer from the modem, %lu batch(es) held",
+                 (unsigned long)s_queueCount);
+    }
+
+    UplinkHw_PowerOff();
+    s_radio               = UPLINK_RADIO_OFF;
+    s_failed              = (s_queueCount > 0U);
+    s_lastBurst_ms        = now;
+    s_stats.lastBurst_ms  = now - s_radioOn_ms;
+    s_stats.radioOn_ms   += s_stats.lastBurst_ms;
+}
+
+static void Uplink_SendHello(void)
+{
+    if (s_helloSent && ((HAL_GetTick() - s_hello_ms) < UPLINK_HELLO_RETRY_MS))
+    {
+        return;
+    }
+
+    uint32_t oldest = (s_queueCount > 0U) ? s_queue[s_queueHead].seq : s_nextSeq;
+
+    s_raw[0] = UPLINK_FRAME_HELLO;
+    Uplink_PutLe(&s_raw[1], oldest, 4U);
+    Uplink_PutLe(&s_raw[UPLINK_HEADER_SIZE], s_nextSeq, 4U);
+
+    if (Uplink_Transmit(UPLINK_HEADER_SIZE + 4U))
+    {
+        s_helloSent = true;
+        s_hello_ms  = HAL_GetTick();
+    }
+}
+
+static bool Uplink_Pending(void)
+{
+    return (s_queueCount > 0U) && ((s_sendSeq - s_queue[s_queueHead].seq) < s_queueCount);
+}
+
+static bool Uplink_SendBatch(void)
+{
+    uint32_t             index = (s_queueHead + (s_sendSeq - s_queue[s_queueHead].seq)) % UPLINK_QUEUE_BATCHES;
+    const UplinkBatch_t *batch = &s_queue[index];
+
+    if (UplinkHw_IsSending())
+    {
+        return false;
+    }
+
+    s_raw[0] = UPLINK_FRAME_BATCH;
+    Uplink_PutLe(&s_raw[1], batch->seq, 4U);
+    s_raw[UPLINK_HEADER_SIZE]      = TELEMETRY_FRAME_SAMPLES_DELTA;
+    s_raw[UPLINK_HEADER_SIZE + 1U] = batch->count;
+    Uplink_PutLe(&s_raw[UPLINK_HEADER_SIZE + 2U], batch->base_ms, 4U);
+    memcpy(&s_raw[UPLINK_HEADER_SIZE + UPLINK_BATCH_HEADER], batch->payload, batch->length);
+
+    if (!Uplink_Transmit(UPLINK_HEADER_SIZE + UPLINK_BATCH_HEADER + batch->length))
+    {
+        return false;
+    }
+
+    s_sendSeq++;
+    s_stats.batchesSent++;
+    return true;
+}
+
+static uint32_t Uplink_AckWaitLeft(void)
+{
+    uint32_t elapsed = HAL_GetTick() - s_phase_ms;
+
+    return (elapsed < UPLINK_ACK_TIMEOUT_MS) ? (UPLINK_ACK_TIMEOUT_MS - elapsed) : 1U;
+}
+
+static bool Uplink_TakeAck(void)
+{
+    if (!s_ackFresh)
+    {
+        return false;
+    }
+
+    s_ackFresh = false;
+    uint32_t ack = s_ackSeq;
+
+    if (s_radio == UPLINK_RADIO_JOINING)
+    {
+        s_radio = UPLINK_RADIO_ONLINE;
+        LOG_INFO("Uplink: modem online after %lu ms, resuming at batch %lu",
+                 (unsigned long)(HAL_GetTick() - s_radioOn_ms), (unsigned long)ack);
+    }
+
+    bool freed = false;
+
+    /* Seal() may run between the two under the RTOS backend. */
+    uint32_t key = AppTaskManager_Lock();
+    while ((s_queueCount > 0U) && ((int32_t)(ack - s_queue[s_queueHead].seq) > 0))
+    {
+        s_queueHead = (s_queueHead + 1U) % UPLINK_QUEUE_BATCHES;
+        s_queueCount--;
+        s_stats.batchesAcked++;
+        freed = true;
+    }
+    AppTaskManager_Unlock(key);
+
+    uint32_t oldest = (s_queueCount > 0U) ? s_queue[s_queueHead].seq : s_nextSeq;
+    if ((int32_t)(s_sendSeq - oldest) < 0)
+    {
+        s_sendSeq = oldest;
+    }
+
+    return freed;
+}
+
+static bool Uplink_Transmit(size_t len)
+{
+    if (UplinkHw_IsSending())
+    {
+        return false;
+    }
+
+    Uplink_PutLe(&s_raw[len], Crc32_Compute(s_raw, len), 4U);
+
+    size_t wire = Cobs_Encode(s_raw, len + 4U, &s_wire[1]);
+    s_wire[0]         = 0x00U;
+    s_wire[wire + 1U] = 0x00U;
+    wire += 2U;
+
+    if (!UplinkHw_Send(s_wire, wire))
+    {
+        return false;
+    }
+
+    s_stats.bytes += (uint32_t)wire;
+    return true;
+}
+
+static void Uplink_PutLe(uint8_t *dst, uint32_t value, uint32_t size)
+{
+    for (uint32_t i = 0U; i < size; ++i)
+    {
+        dst[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+static uint32_t Uplink_GetLe(const uint8_t *src, uint32_t size)
+{
+    uint32_t value = 0U;
+
+    for (uint32_t i = 0U; i < size; ++i)
+    {
+        value |= (uint32_t)src[i] << (8U * i);
+    }
+
+    return value;
+}
+
+static void Uplink_OnFrame(void)
+{
+    size_t len = Cobs_Decode(s_rxFrame, s_rxLen, s_rxFrame, sizeof(s_rxFrame));
+
+    if ((len != (UPLINK_HEADER_SIZE + 4U)) || (s_rxFrame[0] != UPLINK_FRAME_ACK) ||
+        (Crc32_Compute(s_rxFrame, UPLINK_HEADER_SIZE) != Uplink_GetLe(&s_rxFrame[UPLINK_HEADER_SIZE], 4U)))
+    {
+        return;
+    }
+
+    s_ackSeq   = Uplink_GetLe(&s_rxFrame[1], 4U);
+    s_ackFresh = true;
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+static void Uplink_Seal(void)
+{
+    s_buildActive = false;
+
+    if (s_codec.count == 0U)
+    {
+        return;
+    }
+
+    if (s_queueCount >= UPLINK_QUEUE_BATCHES)
+    {
+        /* Keep the oldest: a gap is easier to spot than a hole. */
+        s_stats.batchesDropped++;
+        return;
+    }
+
+    s_build.seq    = s_nextSeq++;
+    s_build.count  = (uint8_t)s_codec.count;
+    s_build.length = (uint16_t)s_codec.length;
+
+    /* The coroutine may run between the two under the RTOS backend. */
+    uint32_t key = AppTaskManager_Lock();
+    s_queue[(s_queueHead + s_queueCount) % UPLINK_QUEUE_BATCHES] = s_build;
+    s_queueCount++;
+    AppTaskManager_Unlock(key);
+
+    AppCoroutine_Signal(&s_coroutine);
+}
+
+static void Uplink_CmdUplink(uint32_t argc, char *argv[])
+{
+    static const char *const s_radioNames[] = { "off", "joining", "online" };
+
+    if (argc < 2U)
+    {
+        UplinkStats_t stats;
+        Uplink_GetStats(&stats);
+
+        CLI_Print("\r\nUplink: %s, radio %s, burst every %lu ms or at %lu batch(es)\r\n",
+                  s_enabled ? "on" : "off", s_radioNames[stats.radio],
+                  (unsigned long)stats.interval_ms, (unsigned long)UPLINK_BURST_BATCHES);
+        CLI_Print("  Samples %lu, batches %lu queued, %lu sent, %lu acked, %lu dropped, next seq %lu\r\n",
+                  (unsigned long)stats.samples, (unsigned long)stats.batchesQueued,
+                  (unsigned long)stats.batchesSent, (unsigned long)stats.batchesAcked,
+                  (unsigned long)stats.batchesDropped, (unsigned long)stats.nextSeq);
+        CLI_Print("  Bursts %lu, join failures %lu, resends %lu, %lu bytes, radio on %lu ms (last %lu ms)\r\n",
+                  (unsigned long)stats.bursts, (unsigned long)stats.joinFailures,
+                  (unsigned long)stats.resends, (unsigned long)stats.bytes,
+                  (unsigned long)stats.radioOn_ms, (unsigned long)stats.lastBurst_ms);
+        return;
+    }
+
+    if (strcmp(argv[1], "on") == 0)
+    {
+        Uplink_SetEnabled(true);
+        CLI_Print("\r\nUplink on\r\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "off") == 0)
+    {
+        Uplink_SetEnabled(false);
+        CLI_Print("\r\nUplink off\r\n");
+        return;
+    }
+
+    if (strcmp(argv[1], "flush") == 0)
+    {
+        Uplink_Flush();
+        CLI_Print("\r\nUplink: burst requested, %lu batch(es) held\r\n", (unsigned long)s_queueCount);
+        return;
+    }
+
+    CLI_PrintError("\r\nUsage: uplink [on|off|flush]\r\n");
+}
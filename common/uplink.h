@@ -0,0 +1,185 @@
+/**
+ * @file uplink.h
+ * @brief Network uplink: compressed sample batches sent to a modem in bursts.
+ *
+ * A Wi-Fi or cellular modem on a second UART (uplink_hw.h) forwards data
+ * to the back end. Its radio draws far more than the MCU, and per-sample
+ * text would keep it on almost all the time, so the uplink encodes the
+ * reported samples into sample_codec.h batches in RAM, like the flash log,
+ * and switches the modem on only to send them in one burst:
+ *
+ * - every @ref UPLINK_INTERVAL_MS (@ref UPLINK_LOW_POWER_INTERVAL_MS in
+ *   SLEEP and STOP; the power manager reports mode changes), or
+ * - as soon as @ref UPLINK_BURST_BATCHES batches are waiting, or
+ * - on Uplink_Flush() (`uplink flush`).
+ *
+ * The link protocol uses the telemetry framing (telemetry.h): frames are
+ * COBS-stuffed between 0x00 delimiters and end with a CRC-32/MPEG-2, all
+ * fields little-endian.
+ *
+ *     hub:   type:u8 seq:u32 body crc:u32
+ *            0x20 HELLO  seq = oldest batch held, body next:u32 (newest + 1)
+ *            0x21 BATCH  seq = batch number, body = a telemetry
+ *                        TELEMETRY_FRAME_SAMPLES_DELTA frame without its CRC:
+ *                        type:u8 count:u8 base_ms:u32 payload
+ *     modem: 0xA0 ACK    seq = next batch number the back end expects
+ *
+ * The acknowledgement is cumulative. After switching the modem on the hub
+ * repeats HELLO until the modem has joined its network and answers; the
+ * answer gives the resume point, so batches the back end already has
+ * (a burst cut short after the data got through) are dropped without
+ * being sent again. Batches are then sent back to back and stay in RAM
+ * until acknowledged; missing acknowledgements restart the burst from the
+ * oldest unacknowledged batch (go-back-N), at most @ref UPLINK_RETRIES
+ * times, and what is left waits for the next burst. A back end that sees a
+ * HELLO range not containing its expected number (the hub was reset)
+ * resumes at the range start.
+ *
+ * While the modem is on, the power manager does not enter STOP (the UART
+ * needs its clocks) and STANDBY waits for the burst to end.
+ *
+ * @ingroup common
+ */
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sample_ring.h"
+#include "power_manager.h"
+
+/**
+ * @defgroup uplink Network Uplink
+ * @brief Batched, acknowledged sample upload over a modem UART.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Batches held in RAM until acknowledged. */
+#define UPLINK_QUEUE_BATCHES   (8U)
+
+/** @brief Encoded samples per batch (bytes). */
+#define UPLINK_BATCH_PAYLOAD   (224U)
+
+/** @brief Frame type bytes of the link protocol. */
+#define UPLINK_FRAME_HELLO     (0x20U)
+#define UPLINK_FRAME_BATCH     (0x21U)
+#define UPLINK_FRAME_ACK       (0xA0U)
+
+/**
+ * @brief Modem power state.
+ */
+typedef enum
+{
+    UPLINK_RADIO_OFF = 0U,   /**< Supply switched off.                   */
+    UPLINK_RADIO_JOINING,    /**< On, waiting for the modem to answer.   */
+    UPLINK_RADIO_ONLINE      /**< On and answering; batches being sent.  */
+} UplinkRadio_t;
+
+/**
+ * @brief Uplink counters.
+ */
+typedef struct
+{
+    UplinkRadio_t radio;          /**< Modem power state now.                     */
+    uint32_t      interval_ms;    /**< Burst interval of the current power mode.  */
+    uint32_t      samples;        /**< Samples added since start-up.              */
+    uint32_t      batchesQueued;  /**< Batches waiting in RAM (sealed).           */
+    uint32_t      batchesSent;    /**< Batch frames sent, resends included.       */
+    uint32_t      batchesAcked;   /**< Batches acknowledged.                      */
+    uint32_t      batchesDropped; /**< Batches lost because the queue was full.   */
+    uint32_t      nextSeq;        /**< Number of the next batch sealed.           */
+    uint32_t      bursts;         /**< Times the modem was switched on.           */
+    uint32_t      joinFailures;   /**< Bursts without an answer from the modem.   */
+    uint32_t      resends;        /**< go-back-N restarts after an ack timeout.   */
+    uint32_t      bytes;          /**< Bytes sent on the modem UART.              */
+    uint32_t      radioOn_ms;     /**< Total time the modem was on.               */
+    uint32_t      lastBurst_ms;   /**< Length of the last burst.                  */
+} UplinkStats_t;
+
+/**
+ * @brief Set up the port, start the uplink coroutine and register the
+ *        "uplink" CLI command.
+ *
+ * Call after AppCoroutine_Init().
+ *
+ * @return None.
+ */
+void Uplink_Init(void);
+
+/**
+ * @brief Turn the uplink on or off.
+ *
+ * Turning it off seals the RAM batch; queued batches wait until it is
+ * turned on again. A burst in progress finishes.
+ *
+ * @param enable true to collect and send samples.
+ *
+ * @return None.
+ */
+void Uplink_SetEnabled(bool enable);
+
+/**
+ * @brief Whether the uplink is on.
+ *
+ * @return true if Uplink_AddSample() collects samples.
+ */
+bool Uplink_IsEnabled(void);
+
+/**
+ * @brief Add a sample to the RAM batch.
+ *
+ * Task context only.
+ *
+ * @param sample Sample to send.
+ *
+ * @return false if the uplink is off or @p sample is NULL.
+ */
+bool Uplink_AddSample(const SensorSample_t *sample);
+
+/**
+ * @brief Seal the RAM batch and start a burst now.
+ *
+ * @return None.
+ */
+void Uplink_Flush(void);
+
+/**
+ * @brief Select the burst interval of a power mode.
+ *
+ * Called by PowerManager_Update() on every mode change.
+ *
+ * @param mode Power mode being entered.
+ *
+ * @return None.
+ */
+void Uplink_OnPowerMode(PowerMode_t mode);
+
+/**
+ * @brief Whether the modem is off.
+ *
+ * @return true between bursts.
+ */
+bool Uplink_IsIdle(void);
+
+/**
+ * @brief Snapshot the uplink counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void Uplink_GetStats(UplinkStats_t *stats);
+
+/** @} */ /* end of uplink group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_H */
@@ -0,0 +1,240 @@
+/**
+ * @file uplink_hw.c
+ * @brief USART6 port of the network uplink (PC6 TX, PC7 RX, DMA2
+ *        Stream6/Stream1, modem supply switch on GPIOC).
+ *
+ * Transmission is one DMA transfer per UplinkHw_Send() on Stream6 channel
+ * 5; its transfer complete interrupt ends the send. Reception runs for as
+ * long as the modem is on: Stream1 channel 5 fills a circular ring, and
+ * the idle line interrupt and the half/full ring interrupts hand the new
+ * bytes to uplink.c, so short replies arrive one character time after
+ * the line goes quiet and long ones never overrun the ring.
+ *
+ * The clocks (USART6, DMA2, GPIOC) are only taken while the modem is on,
+ * so the port costs nothing between bursts. Registers are accessed
+ * directly, like the other bus ports.
+ *
+ * @ingroup uplink
+ */
+
+#include "uplink_hw.h"
+#include "app_config.h"
+#include "periph_power.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Size of the receive ring (bytes). */
+#define UPLINK_HW_RX_SIZE    (64U)
+
+/** @brief DMA stream flags of Stream1 (LISR) and Stream6 (HISR). */
+#define UPLINK_HW_RX_FLAGS   (DMA_LIFCR_CTCIF1 | DMA_LIFCR_CHTIF1 | DMA_LIFCR_CTEIF1 | \
+                              DMA_LIFCR_CDMEIF1 | DMA_LIFCR_CFEIF1)
+#define UPLINK_HW_TX_FLAGS   (DMA_HIFCR_CTCIF6 | DMA_HIFCR_CHTIF6 | DMA_HIFCR_CTEIF6 | \
+                              DMA_HIFCR_CDMEIF6 | DMA_HIFCR_CFEIF6)
+
+/** @brief DMA request channel of USART6 on both streams. */
+#define UPLINK_HW_DMA_CHANNEL (5UL << DMA_SxCR_CHSEL_Pos)
+
+/** @brief Supply switch pin mask. */
+#define UPLINK_HW_POWER_MASK  (1UL << UPLINK_POWER_PIN)
+
+/** @brief Receive ring and the position handed up last. */
+static uint8_t  s_rxRing[UPLINK_HW_RX_SIZE];
+static uint32_t s_rxPos = 0U;
+
+/** @brief Modem powered and clocks taken. */
+static bool s_powered = false;
+
+/** @brief Send in progress. */
+static volatile bool s_sending = false;
+
+/**
+ * @brief Hand the bytes the RX stream wrote since the last call to uplink.c.
+ */
+static void UplinkHw_Drain(void);
+
+/**
+ * @brief BRR value for @ref UPLINK_BAUD at the current APB2 clock.
+ */
+static uint32_t UplinkHw_Brr(void);
+
+/* ------------------------------------------------------------------------- */
+
+void UplinkHw_Init(void)
+{
+    /* Supply switch: push-pull output, low (modem off). PC6/PC7: AF8. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOC);
+    GPIOC->BSRR    = UPLINK_HW_POWER_MASK << 16;
+    GPIOC->OTYPER &= ~(UPLINK_HW_POWER_MASK | GPIO_OTYPER_OT6);
+    GPIOC->MODER   = (GPIOC->MODER & ~((3UL << (2U * UPLINK_POWER_PIN)) |
+                                       GPIO_MODER_MODER6 | GPIO_MODER_MODER7)) |
+                     (1UL << (2U * UPLINK_POWER_PIN)) | GPIO_MODER_MODER6_1 | GPIO_MODER_MODER7_1;
+    GPIOC->PUPDR   = (GPIOC->PUPDR & ~GPIO_PUPDR_PUPD7) | GPIO_PUPDR_PUPD7_0;
+    GPIOC->AFR[0]  = (GPIOC->AFR[0] & ~0xFF000000U) | 0x88000000U;
+    PeriphPower_Release(PERIPH_POWER_GPIOC);
+
+    s_powered = false;
+    s_sending = false;
+
+    HAL_NVIC_SetPriority(USART6_IRQn, IRQ_PRIO_UPLINK_UART, 0U);
+    HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, IRQ_PRIO_UPLINK_DMA_TX, 0U);
+    HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, IRQ_PRIO_UPLINK_DMA_RX, 0U);
+    HAL_NVIC_EnableIRQ(USART6_IRQn);
+    HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+    HAL_NVIC_EnableIRQ(DMA2_Stream1_IRQn);
+}
+
+void UplinkHw_PowerOn(void)
+{
+    if (s_powered)
+    {
+        return;
+    }
+
+    PeriphPower_Acquire(PERIPH_POWER_GPIOC);
+    PeriphPower_Acquire(PERIPH_POWER_DMA2);
+    PeriphPower_Acquire(PERIPH_POWER_USART6);
+    s_powered = true;
+    s_sending = false;
+    s_rxPos   = 0U;
+
+    USART6->CR1 = 0U;
+    USART6->BRR = UplinkHw_Brr();
+    USART6->CR3 = USART_CR3_DMAT | USART_CR3_DMAR;
+
+    DMA2->LIFCR        = UPLINK_HW_RX_FLAGS;
+    DMA2_Stream1->PAR  = (uint32_t)(uintptr_t)&USART6->DR;
+    DMA2_Stream1->M0AR = (uint32_t)(uintptr_t)s_rxRing;
+    DMA2_Stream1->NDTR = UPLINK_HW_RX_SIZE;
+    DMA2_Stream1->CR   = UPLINK_HW_DMA_CHANNEL | DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                         DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_EN;
+
+    USART6->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE | USART_CR1_IDLEIE;
+    GPIOC->BSRR = UPLINK_HW_POWER_MASK;
+}
+
+void UplinkHw_PowerOff(void)
+{
+    if (!s_powered)
+    {
+        return;
+    }
+
+    GPIOC->BSRR = UPLINK_HW_POWER_MASK << 16;
+    DMA2_Stream6->CR &= ~DMA_SxCR_EN;
+    DMA2_Stream1->CR &= ~DMA_SxCR_EN;
+    USART6->CR1 = 0U;
+    USART6->CR3 = 0U;
+    DMA2->LIFCR = UPLINK_HW_RX_FLAGS;
+    DMA2->HIFCR = UPLINK_HW_TX_FLAGS;
+    s_sending   = false;
+
+    PeriphPower_Release(PERIPH_POWER_USART6);
+    PeriphPower_Release(PERIPH_POWER_DMA2);
+    PeriphPower_Release(PERIPH_POWER_GPIOC);
+    s_powered = false;
+}
+
+bool UplinkHw_Send(const uint8_t *data, size_t len)
+{
+    if (!s_powered || s_sending || (data == NULL) || (len == 0U) || (len > 0xFFFFU))
+    {
+        return false;
+    }
+
+    s_sending = true;
+    USART6->SR = ~(uint32_t)USART_SR_TC;
+
+    DMA2->HIFCR        = UPLINK_HW_TX_FLAGS;
+    DMA2_Stream6->PAR  = (uint32_t)(uintptr_t)&USART6->DR;
+    DMA2_Stream6->M0AR = (uint32_t)(uintptr_t)data;
+    DMA2_Stream6->NDTR = (uint32_t)len;
+    DMA2_Stream6->CR   = UPLINK_HW_DMA_CHANNEL | DMA_SxCR_MINC | DMA_SxCR_DIR_0 |
+                         DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_EN;
+    return true;
+}
+
+bool UplinkHw_IsSending(void)
+{
+    return s_sending;
+}
+
+void UplinkHw_OnClockChange(void)
+{
+    if (s_powered)
+    {
+        USART6->BRR = UplinkHw_Brr();
+    }
+}
+
+void UplinkHw_UartIrqHandler(void)
+{
+    uint32_t sr = USART6->SR;
+
+    if ((sr & (USART_SR_IDLE | USART_SR_ORE)) != 0U)
+    {
+        /* SR then DR clears IDLE and ORE. */
+        (void)USART6->DR;
+    }
+
+    if (s_powered)
+    {
+        UplinkHw_Drain();
+    }
+}
+
+void UplinkHw_DmaTxIrqHandler(void)
+{
+    uint32_t hisr = DMA2->HISR;
+    DMA2->HIFCR = UPLINK_HW_TX_FLAGS;
+
+    if (!s_sending || ((hisr & (DMA_HISR_TCIF6 | DMA_HISR_TEIF6)) == 0U))
+    {
+        return;
+    }
+
+    /* A failed transfer loses the frame; the protocol's ack timeout resends it. */
+    s_sending = false;
+    Uplink_OnHwTxDone();
+}
+
+void UplinkHw_DmaRxIrqHandler(void)
+{
+    DMA2->LIFCR = UPLINK_HW_RX_FLAGS;
+
+    if (s_powered)
+    {
+        UplinkHw_Drain();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void UplinkHw_Drain(void)
+{
+    uint32_t pos = (UPLINK_HW_RX_SIZE - DMA2_Stream1->NDTR) % UPLINK_HW_RX_SIZE;
+
+    if (pos == s_rxPos)
+    {
+        return;
+    }
+
+    if (pos < s_rxPos)
+    {
+        Uplink_OnHwRx(&s_rxRing[s_rxPos], UPLINK_HW_RX_SIZE - s_rxPos);
+        s_rxPos = 0U;
+    }
+
+    if (pos > s_rxPos)
+    {
+        Uplink_OnHwRx(&s_rxRing[s_rxPos], pos - s_rxPos);
+    }
+    s_rxPos = pos;
+}
+
+static uint32_t UplinkHw_Brr(void)
+{
+    return UART_BRR_SAMPLING16(HAL_RCC_GetPCLK2Freq(), UPLINK_BAUD);
+}
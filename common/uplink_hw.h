@@ -0,0 +1,118 @@
+/**
+ * @file uplink_hw.h
+ * @brief Hardware port of the network uplink (modem UART and power switch).
+ *
+ * uplink.c owns the protocol and the burst schedule; the port powers the
+ * modem, sends one buffer at a time and hands received bytes up as they
+ * arrive. uplink_hw.c drives USART6 (PC6 TX, PC7 RX on the morpho
+ * header), DMA2 Stream6/Stream1 and the modem supply switch on GPIOC at
+ * register level. The host simulation has its own port with a modem
+ * model behind it.
+ *
+ * @ingroup uplink
+ */
+
+#ifndef UPLINK_HW_H
+#define UPLINK_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Make the supply switch a low (modem off) output and set the
+ *        interrupt priorities.
+ *
+ * @return None.
+ */
+void UplinkHw_Init(void);
+
+/**
+ * @brief Switch the modem on: take the clocks, start the receiver and
+ *        raise the supply switch.
+ *
+ * @return None.
+ */
+void UplinkHw_PowerOn(void);
+
+/**
+ * @brief Switch the modem off: cut its supply, stop the UART and release
+ *        the clocks. A transmission in progress is dropped.
+ *
+ * @return None.
+ */
+void UplinkHw_PowerOff(void);
+
+/**
+ * @brief Start sending @p len bytes by DMA.
+ *
+ * @param data Bytes; must stay unchanged until Uplink_OnHwTxDone().
+ * @param len  Number of bytes (1..65535).
+ *
+ * @return false if the modem is off or a transmission is in progress.
+ */
+bool UplinkHw_Send(const uint8_t *data, size_t len);
+
+/**
+ * @brief Whether a transmission is in progress.
+ *
+ * @return true until the last byte of UplinkHw_Send() has left.
+ */
+bool UplinkHw_IsSending(void);
+
+/**
+ * @brief Reprogram the baud rate divider after a clock profile change.
+ *
+ * @return None.
+ */
+void UplinkHw_OnClockChange(void);
+
+/**
+ * @brief USART6 interrupt handler: idle line (received bytes).
+ *
+ * @return None.
+ */
+void UplinkHw_UartIrqHandler(void);
+
+/**
+ * @brief DMA2 Stream6 (USART6 TX) interrupt handler: end of a send.
+ *
+ * @return None.
+ */
+void UplinkHw_DmaTxIrqHandler(void);
+
+/**
+ * @brief DMA2 Stream1 (USART6 RX) interrupt handler: half and full
+ *        receive ring.
+ *
+ * @return None.
+ */
+void UplinkHw_DmaRxIrqHandler(void);
+
+/**
+ * @brief Bytes received, from interrupt context. Implemented by uplink.c.
+ *
+ * @param data Bytes; valid during the call only.
+ * @param len  Number of bytes.
+ *
+ * @return None.
+ */
+void Uplink_OnHwRx(const uint8_t *data, size_t len);
+
+/**
+ * @brief End of the send started by UplinkHw_Send(), from interrupt
+ *        context. Implemented by uplink.c.
+ *
+ * @return None.
+ */
+void Uplink_OnHwTxDone(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLINK_HW_H */
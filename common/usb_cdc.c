@@ -0,0 +1,717 @@
+/**
+ * @file usb_cdc.c
+ * @brief USB CDC-ACM device: descriptors, control requests, data endpoints.
+ *
+ * Everything here runs in the OTG FS interrupt, called by the hardware
+ * port (usb_cdc_hw.h), except UsbCdc_StartTx(), which uart_tx.c calls with
+ * interrupts masked. Endpoint 0 is a small stage machine: a request with
+ * data IN sends it and then expects a zero-length status OUT; a request
+ * with data OUT (SET_LINE_CODING) receives it and answers with a
+ * zero-length status IN; anything else answers with the status IN at
+ * once, or stalls.
+ *
+ * The device has two interfaces, communication (notification endpoint,
+ * never used) and data (bulk IN/OUT), as the CDC ACM class requires;
+ * hosts load their standard driver for it. The line coding the host sets
+ * is stored and reported back only: the bytes just move over USB.
+ *
+ * @ingroup usb_cdc
+ */
+
+#include "usb_cdc.h"
+#include "usb_cdc_hw.h"
+#include "uart_tx.h"
+#include "cli.h"
+#include "log.h"
+#include "metrics.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/** @brief Standard request codes (bRequest). */
+#define USB_REQ_GET_STATUS          (0x00U)
+#define USB_REQ_CLEAR_FEATURE       (0x01U)
+#define USB_REQ_SET_FEATURE         (0x03U)
+#define USB_REQ_SET_ADDRESS         (0x05U)
+#define USB_REQ_GET_DESCRIPTOR      (0x06U)
+#define USB_REQ_GET_CONFIGURATION   (0x08U)
+#define USB_REQ_SET_CONFIGURATION   (0x09U)
+#define USB_REQ_GET_INTERFACE       (0x0AU)
+#define USB_REQ_SET_INTERFACE       (0x0BU)
+
+/** @brief CDC class request codes. */
+#define USB_CDC_REQ_SET_LINE_CODING        (0x20U)
+#define USB_CDC_REQ_GET_LINE_CODING        (0x21U)
+#define USB_CDC_REQ_SET_CONTROL_LINE_STATE (0x22U)
+#define USB_CDC_REQ_SEND_BREAK             (0x23U)
+
+/** @brief bmRequestType fields. */
+#define USB_REQ_TYPE_MASK           (0x60U)
+#define USB_REQ_TYPE_STANDARD       (0x00U)
+#define USB_REQ_TYPE_CLASS          (0x20U)
+#define USB_REQ_RECIPIENT_MASK      (0x1FU)
+#define USB_REQ_RECIPIENT_DEVICE    (0x00U)
+#define USB_REQ_RECIPIENT_INTERFACE (0x01U)
+#define USB_REQ_RECIPIENT_ENDPOINT  (0x02U)
+
+/** @brief Descriptor types. */
+#define USB_DESC_DEVICE             (0x01U)
+#define USB_DESC_CONFIGURATION      (0x02U)
+#define USB_DESC_STRING             (0x03U)
+
+/** @brief Feature selector ENDPOINT_HALT. */
+#define USB_FEATURE_ENDPOINT_HALT   (0x00U)
+
+/** @brief Size of the line coding structure. */
+#define USB_CDC_LINE_CODING_SIZE    (7U)
+
+/** @brief Little-endian 16-bit descriptor field. */
+#define USB_U16(v)                  (uint8_t)((v) & 0xFFU), (uint8_t)(((v) >> 8) & 0xFFU)
+
+/** @brief Total length of the configuration descriptor. */
+#define USB_CDC_CONFIG_DESC_SIZE    (67U)
+
+/**
+ * @brief Where a control transfer is.
+ */
+typedef enum
+{
+    USB_CDC_EP0_IDLE = 0U,    /**< Waiting for SETUP.                 */
+    USB_CDC_EP0_DATA_IN,      /**< Sending the data stage.            */
+    USB_CDC_EP0_DATA_OUT,     /**< Receiving the data stage.          */
+    USB_CDC_EP0_STATUS_IN,    /**< Sending the zero-length status.    */
+    USB_CDC_EP0_STATUS_OUT    /**< Waiting for the host's status.     */
+} UsbCdcEp0Stage_t;
+
+/** @brief Device descriptor. */
+static const uint8_t s_deviceDesc[18] =
+{
+    18U, USB_DESC_DEVICE, USB_U16(0x0200U),
+    0x02U, 0x00U, 0x00U,                  /* class from the device: CDC */
+    USB_CDC_PACKET_SIZE,
+    USB_U16(USB_CDC_VID), USB_U16(USB_CDC_PID), USB_U16(0x0200U),
+    1U, 2U, 3U,                           /* manufacturer, product, serial */
+    1U
+};
+
+/** @brief Configuration descriptor with both interfaces and their endpoints. */
+static const uint8_t s_configDesc[USB_CDC_CONFIG_DESC_SIZE] =
+{
+    9U, USB_DESC_CONFIGURATION, USB_U16(USB_CDC_CONFIG_DESC_SIZE), 2U, 1U, 0U,
+    0x80U, 50U,                           /* bus powered, 100 mA */
+
+    /* Communication interface: ACM, with the header, call management,
+     * ACM (line coding and control line state supported) and union
+     * functional descriptors.
+     */
+    9U, 0x04U, 0U, 0U, 1U, 0x02U, 0x02U, 0x01U, 0U,
+    5U, 0x24U, 0x00U, USB_U16(0x0110U),
+    5U, 0x24U, 0x01U, 0x00U, 1U,
+    4U, 0x24U, 0x02U, 0x02U,
+    5U, 0x24U, 0x06U, 0U, 1U,
+    7U, 0x05U, USB_CDC_EP_NOTIFY, USB_CDC_HW_EP_INTERRUPT, USB_U16(USB_CDC_NOTIFY_SIZE), 16U,
+
+    /* Data interface. */
+    9U, 0x04U, 1U, 0U, 2U, 0x0AU, 0x00U, 0x00U, 0U,
+    7U, 0x05U, USB_CDC_EP_DATA_OUT, USB_CDC_HW_EP_BULK, USB_U16(USB_CDC_PACKET_SIZE), 0U,
+    7U, 0x05U, USB_CDC_EP_DATA_IN, USB_CDC_HW_EP_BULK, USB_U16(USB_CDC_PACKET_SIZE), 0U
+};
+
+/** @brief String descriptor 0: US English. */
+static const uint8_t s_langDesc[4] = { 4U, USB_DESC_STRING, USB_U16(0x0409U) };
+
+/** @brief Strings 1 and 2 (ASCII; sent as UTF-16). */
+static const char *const s_strings[2] =
+{
+    "STMicroelectronics",
+    "Smart Sensor Hub"
+};
+
+/** @brief Serial number: the 96-bit device UID in hex, built at init. */
+static char s_serial[25];
+
+/** @brief Device state. */
+static volatile UsbCdcState_t s_state = USB_CDC_DETACHED;
+
+/** @brief Bus suspended. */
+static volatile bool s_suspended = false;
+
+/** @brief DTR from SET_CONTROL_LINE_STATE. */
+static volatile bool s_dtr = false;
+
+/** @brief A transfer timed out; cleared by host input or a new DTR. */
+static volatile bool s_stalled = false;
+
+/** @brief The 48 MHz clock runs. */
+static bool s_clocked = false;
+
+/** @brief A bulk IN transfer is in progress. */
+static volatile bool s_txBusy = false;
+
+/** @brief The transfer still owes the host a zero-length packet. */
+static volatile bool s_txZlp = false;
+
+/** @brief Length of the transfer in progress. */
+static uint32_t s_txLen = 0U;
+
+/** @brief Frames since the transfer in progress started. */
+static uint32_t s_txFrames = 0U;
+
+/** @brief Alternating bulk OUT buffers. */
+static uint8_t s_rxBuffers[2][USB_CDC_PACKET_SIZE];
+
+/** @brief Buffer the OUT endpoint is armed with. */
+static uint32_t s_rxIndex = 0U;
+
+/** @brief Stage of the control transfer in progress. */
+static UsbCdcEp0Stage_t s_ep0Stage = USB_CDC_EP0_IDLE;
+
+/** @brief Request whose data stage is being received. */
+static uint8_t s_ep0Request = 0U;
+
+/** @brief The data IN stage needs a closing zero-length packet. */
+static bool s_ep0Zlp = false;
+
+/** @brief Endpoint 0 data (replies and received data stages). */
+static uint8_t s_ep0Buffer[USB_CDC_PACKET_SIZE];
+
+/** @brief Line coding: 115200 baud, 1 stop bit, no parity, 8 data bits. */
+static uint8_t s_lineCoding[USB_CDC_LINE_CODING_SIZE] = { 0x00U, 0xC2U, 0x01U, 0x00U, 0U, 0U, 8U };
+
+/** @brief Counters. */
+static UsbCdcStats_t s_stats;
+
+/** @brief Names of @ref UsbCdcState_t. */
+static const char *const s_stateNames[USB_CDC_STATE_COUNT] =
+{
+    "detached", "default", "addressed", "configured"
+};
+
+/**
+ * @brief Handle a standard request; false to stall.
+ */
+static bool UsbCdc_StandardRequest(const uint8_t *setup);
+
+/**
+ * @brief Handle a CDC class request; false to stall.
+ */
+static bool UsbCdc_ClassRequest(const uint8_t *setup);
+
+/**
+ * @brief Answer GET_DESCRIPTOR; false if there is no such descriptor.
+ */
+static bool UsbCdc_SendDescriptor(uint16_t value, uint16_t length);
+
+/**
+ * @brief Send a data IN stage of at most @p length bytes.
+ */
+static void UsbCdc_Ep0Send(const uint8_t *data, uint32_t len, uint16_t length);
+
+/**
+ * @brief Send the status IN stage of a request without data.
+ */
+static void UsbCdc_Ep0Ack(void);
+
+/**
+ * @brief Activate (true) or deactivate the data and notification endpoints.
+ */
+static void UsbCdc_Configure(bool configured);
+
+/**
+ * @brief Drop the bulk IN transfer in progress, if any, and report it done.
+ */
+static void UsbCdc_DropTx(void);
+
+/**
+ * @brief Release the ring after the transfer in progress ended.
+ */
+static void UsbCdc_TxDone(bool sent);
+
+/* ------------------------------------------------------------------------- */
+
+void UsbCdc_Init(void)
+{
+    if (USB_CDC_ENABLE == 0)
+    {
+        return;
+    }
+
+    static const char hex[] = "0123456789ABCDEF";
+    const uint8_t    *uid   = (const uint8_t *)UID_BASE;
+
+    for (uint32_t i = 0U; i < 12U; ++i)
+    {
+        s_serial[2U * i]        = hex[uid[i] >> 4];
+        s_serial[(2U * i) + 1U] = hex[uid[i] & 0x0FU];
+    }
+    s_serial[24] = '\0';
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    Metrics_Publish(METRIC_USB_TX_BYTES, &s_stats.txBytes);
+    Metrics_Publish(METRIC_USB_RX_BYTES, &s_stats.rxBytes);
+    Metrics_Publish(METRIC_USB_TX_TO_UART, &s_stats.txDropped);
+
+    s_state     = USB_CDC_DETACHED;
+    s_suspended = false;
+    s_dtr       = false;
+    s_stalled   = false;
+    s_txBusy    = false;
+    s_ep0Stage  = USB_CDC_EP0_IDLE;
+
+    s_clocked = UsbCdcHw_Init();
+    if (!s_clocked)
+    {
+        LOG_WARN("UsbCdc: no 48 MHz clock (HSE or PLLSAI did not start), USB off");
+    }
+}
+
+bool UsbCdc_IsOpen(void)
+{
+    return (s_state == USB_CDC_CONFIGURED) && s_dtr && !s_suspended && !s_stalled;
+}
+
+bool UsbCdc_IsActive(void)
+{
+    return (s_state != USB_CDC_DETACHED) && !s_suspended;
+}
+
+bool UsbCdc_IsClocked(void)
+{
+    return s_clocked;
+}
+
+bool UsbCdc_StartTx(const uint8_t *data, uint32_t len)
+{
+    if (!UsbCdc_IsOpen() || s_txBusy || (len == 0U))
+    {
+        return false;
+    }
+
+    s_txBusy   = true;
+    s_txZlp    = ((len % USB_CDC_PACKET_SIZE) == 0U);
+    s_txLen    = len;
+    s_txFrames = 0U;
+
+    UsbCdcHw_EnableFrames(true);
+    UsbCdcHw_Transmit(USB_CDC_EP_DATA_IN, data, len);
+
+    return true;
+}
+
+void UsbCdc_AbortTx(void)
+{
+    if (s_txBusy)
+    {
+        UsbCdcHw_AbortTransmit(USB_CDC_EP_DATA_IN);
+        UsbCdcHw_EnableFrames(false);
+        s_txBusy = false;
+    }
+}
+
+void UsbCdc_OnClockChange(void)
+{
+    if (s_clocked)
+    {
+        UsbCdcHw_OnClockChange();
+    }
+}
+
+void UsbCdc_GetStats(UsbCdcStats_t *stats)
+{
+    *stats           = s_stats;
+    stats->state     = s_state;
+    stats->suspended = s_suspended;
+    stats->dtr       = s_dtr;
+    stats->stalled   = s_stalled;
+    stats->lineBaud  = (uint32_t)s_lineCoding[0] | ((uint32_t)s_lineCoding[1] << 8) |
+                       ((uint32_t)s_lineCoding[2] << 16) | ((uint32_t)s_lineCoding[3] << 24);
+}
+
+const char *UsbCdc_StateName(UsbCdcState_t state)
+{
+    return ((uint32_t)state < (uint32_t)USB_CDC_STATE_COUNT) ? s_stateNames[state] : "?";
+}
+
+void UsbCdc_OnHwReset(void)
+{
+    UsbCdc_DropTx();
+
+    s_state     = USB_CDC_DEFAULT;
+    s_suspended = false;
+    s_dtr       = false;
+    s_stalled   = false;
+    s_ep0Stage  = USB_CDC_EP0_IDLE;
+    s_stats.resets++;
+}
+
+void UsbCdc_OnHwSuspend(bool suspended)
+{
+    s_suspended = suspended;
+
+    if (suspended)
+    {
+        UsbCdc_DropTx();
+    }
+}
+
+void UsbCdc_OnHwSetup(const uint8_t *setup)
+{
+    bool handled = false;
+
+    s_ep0Stage = USB_CDC_EP0_IDLE;
+    s_ep0Zlp   = false;
+
+    switch (setup[0] & USB_REQ_TYPE_MASK)
+    {
+        case USB_REQ_TYPE_STANDARD:
+            handled = UsbCdc_StandardRequest(setup);
+            break;
+
+        case USB_REQ_TYPE_CLASS:
+            handled = UsbCdc_ClassRequest(setup);
+            break;
+
+        default:
+            break;
+    }
+
+    if (!handled)
+    {
+        UsbCdcHw_Stall(USB_CDC_HW_EP_IN);
+        UsbCdcHw_Stall(0x00U);
+    }
+}
+
+void UsbCdc_OnHwOut(uint8_t ep, uint32_t len)
+{
+    if (ep == USB_CDC_EP_DATA_OUT)
+    {
+        /* Re-arm with the other buffer first, then hand the bytes on. */
+        uint8_t *data = s_rxBuffers[s_rxIndex];
+
+        s_rxIndex ^= 1U;
+        UsbCdcHw_Receive(USB_CDC_EP_DATA_OUT, s_rxBuffers[s_rxIndex], USB_CDC_PACKET_SIZE);
+
+        s_stalled        = false;
+        s_stats.rxBytes += len;
+        CLI_Receive(data, len);
+        return;
+    }
+
+    if (ep != 0x00U)
+    {
+        return;
+    }
+
+    if (s_ep0Stage == USB_CDC_EP0_DATA_OUT)
+    {
+        if ((s_ep0Request == USB_CDC_REQ_SET_LINE_CODING) && (len >= USB_CDC_LINE_CODING_SIZE))
+        {
+            memcpy(s_lineCoding, s_ep0Buffer, USB_CDC_LINE_CODING_SIZE);
+        }
+        UsbCdc_Ep0Ack();
+    }
+    else if (s_ep0Stage == USB_CDC_EP0_STATUS_OUT)
+    {
+        s_ep0Stage = USB_CDC_EP0_IDLE;
+    }
+}
+
+void UsbCdc_OnHwIn(uint8_t ep)
+{
+    if (ep == USB_CDC_EP_DATA_IN)
+    {
+        if (!s_txBusy)
+        {
+            return;
+        }
+
+        /* A transfer ending on a full packet is closed by a ZLP, or the
+         * host would wait for more.
+         */
+        if (s_txZlp)
+        {
+            s_txZlp = false;
+            UsbCdcHw_Transmit(USB_CDC_EP_DATA_IN, NULL, 0U);
+            return;
+        }
+
+        UsbCdc_TxDone(true);
+        return;
+    }
+
+    if (ep != USB_CDC_HW_EP_IN)
+    {
+        return;
+    }
+
+    if (s_ep0Stage == USB_CDC_EP0_DATA_IN)
+    {
+        if (s_ep0Zlp)
+        {
+            s_ep0Zlp = false;
+            UsbCdcHw_Transmit(USB_CDC_HW_EP_IN, NULL, 0U);
+            return;
+        }
+
+        s_ep0Stage = USB_CDC_EP0_STATUS_OUT;
+        UsbCdcHw_Receive(0x00U, NULL, 0U);
+    }
+    else if (s_ep0Stage == USB_CDC_EP0_STATUS_IN)
+    {
+        s_ep0Stage = USB_CDC_EP0_IDLE;
+    }
+}
+
+void UsbCdc_OnHwFrame(void)
+{
+    if (s_txBusy && (++s_txFrames >= USB_CDC_TX_TIMEOUT_MS))
+    {
+        s_stalled = true;
+        UsbCdc_DropTx();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool UsbCdc_StandardRequest(const uint8_t *setup)
+{
+    uint8_t  recipient = setup[0] & USB_REQ_RECIPIENT_MASK;
+    uint16_t value     = (uint16_t)(setup[2] | ((uint16_t)setup[3] << 8));
+    uint16_t index     = (uint16_t)(setup[4] | ((uint16_t)setup[5] << 8));
+    uint16_t length    = (uint16_t)(setup[6] | ((uint16_t)setup[7] << 8));
+
+    switch (setup[1])
+    {
+        case USB_REQ_GET_STATUS:
+            /* Bus powered, no remote wakeup, no endpoint halted. */
+            s_ep0Buffer[0] = 0U;
+            s_ep0Buffer[1] = 0U;
+            UsbCdc_Ep0Send(s_ep0Buffer, 2U, length);
+            return true;
+
+        case USB_REQ_CLEAR_FEATURE:
+        case USB_REQ_SET_FEATURE:
+            if ((recipient == USB_REQ_RECIPIENT_ENDPOINT) && (value == USB_FEATURE_ENDPOINT_HALT) &&
+                ((index & 0x7FU) != 0U))
+            {
+                if (setup[1] == USB_REQ_SET_FEATURE)
+                {
+                    UsbCdcHw_Stall((uint8_t)index);
+                }
+                else
+                {
+                    UsbCdcHw_ClearStall((uint8_t)index);
+                }
+            }
+            UsbCdc_Ep0Ack();
+            return true;
+
+        case USB_REQ_SET_ADDRESS:
+            /* The OTG core takes the address before the status stage. */
+            UsbCdcHw_SetAddress((uint8_t)(value & 0x7FU));
+            s_state = (value != 0U) ? USB_CDC_ADDRESSED : USB_CDC_DEFAULT;
+            UsbCdc_Ep0Ack();
+            return true;
+
+        case USB_REQ_GET_DESCRIPTOR:
+            return UsbCdc_SendDescriptor(value, length);
+
+        case USB_REQ_GET_CONFIGURATION:
+            s_ep0Buffer[0] = (s_state == USB_CDC_CONFIGURED) ? 1U : 0U;
+            UsbCdc_Ep0Send(s_ep0Buffer, 1U, length);
+            return true;
+
+        case USB_REQ_SET_CONFIGURATION:
+            if ((value > 1U) || (s_state == USB_CDC_DEFAULT))
+            {
+                return false;
+            }
+            UsbCdc_Configure(value == 1U);
+            UsbCdc_Ep0Ack();
+            return true;
+
+        case USB_REQ_GET_INTERFACE:
+            s_ep0Buffer[0] = 0U;
+            UsbCdc_Ep0Send(s_ep0Buffer, 1U, length);
+            return true;
+
+        case USB_REQ_SET_INTERFACE:
+            if (value != 0U)
+            {
+                return false;
+            }
+            UsbCdc_Ep0Ack();
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool UsbCdc_ClassRequest(const uint8_t *setup)
+{
+    uint16_t value  = (uint16_t)(setup[2] | ((uint16_t)setup[3] << 8));
+    uint16_t length = (uint16_t)(setup[6] | ((uint16_t)setup[7] << 8));
+
+    if ((setup[0] & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_INTERFACE)
+    {
+        return false;
+    }
+
+    switch (setup[1])
+    {
+        case USB_CDC_REQ_SET_LINE_CODING:
+            if (length > sizeof(s_ep0Buffer))
+            {
+                return false;
+            }
+            s_ep0Request = setup[1];
+            s_ep0Stage   = USB_CDC_EP0_DATA_OUT;
+            UsbCdcHw_Receive(0x00U, s_ep0Buffer, length);
+            return true;
+
+        case USB_CDC_REQ_GET_LINE_CODING:
+            UsbCdc_Ep0Send(s_lineCoding, USB_CDC_LINE_CODING_SIZE, length);
+            return true;
+
+        case USB_CDC_REQ_SET_CONTROL_LINE_STATE:
+        {
+            bool dtr = ((value & 0x1U) != 0U);
+
+            /* Opening the port gives a timed-out host another chance. */
+            if (dtr && !s_dtr)
+            {
+                s_stalled = false;
+            }
+            s_dtr = dtr;
+            if (!dtr)
+            {
+                UsbCdc_DropTx();
+            }
+            UsbCdc_Ep0Ack();
+            return true;
+        }
+
+        case USB_CDC_REQ_SEND_BREAK:
+            UsbCdc_Ep0Ack();
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static bool UsbCdc_SendDescriptor(uint16_t value, uint16_t length)
+{
+    uint8_t type  = (uint8_t)(value >> 8);
+    uint8_t index = (uint8_t)(value & 0xFFU);
+
+    if (type == USB_DESC_DEVICE)
+    {
+        UsbCdc_Ep0Send(s_deviceDesc, sizeof(s_deviceDesc), length);
+        return true;
+    }
+
+    if (type == USB_DESC_CONFIGURATION)
+    {
+        UsbCdc_Ep0Send(s_configDesc, sizeof(s_configDesc), length);
+        return true;
+    }
+
+    if ((type != USB_DESC_STRING) || (index > 3U))
+    {
+        /* Full-speed only: no device qualifier either. */
+        return false;
+    }
+
+    if (index == 0U)
+    {
+        UsbCdc_Ep0Send(s_langDesc, sizeof(s_langDesc), length);
+        return true;
+    }
+
+    /* ASCII to UTF-16LE; every string fits one packet. */
+    const char *text = (index == 3U) ? s_serial : s_strings[index - 1U];
+    uint32_t    size = 2U;
+
+    while ((*text != '\0') && ((size + 2U) <= sizeof(s_ep0Buffer)))
+    {
+        s_ep0Buffer[size++] = (uint8_t)*text++;
+        s_ep0Buffer[size++] = 0U;
+    }
+    s_ep0Buffer[0] = (uint8_t)size;
+    s_ep0Buffer[1] = USB_DESC_STRING;
+
+    UsbCdc_Ep0Send(s_ep0Buffer, size, length);
+    return true;
+}
+
+static void UsbCdc_Ep0Send(const uint8_t *data, uint32_t len, uint16_t length)
+{
+    if (len > length)
+    {
+        len = length;
+    }
+
+    /* A reply shorter than asked for that ends on a full packet needs a
+     * ZLP to end the data stage.
+     */
+    s_ep0Zlp   = (len != 0U) && (len < length) && ((len % USB_CDC_PACKET_SIZE) == 0U);
+    s_ep0Stage = USB_CDC_EP0_DATA_IN;
+    UsbCdcHw_Transmit(USB_CDC_HW_EP_IN, data, len);
+}
+
+static void UsbCdc_Ep0Ack(void)
+{
+    s_ep0Stage = USB_CDC_EP0_STATUS_IN;
+    UsbCdcHw_Transmit(USB_CDC_HW_EP_IN, NULL, 0U);
+}
+
+static void UsbCdc_Configure(bool configured)
+{
+    if (s_state == USB_CDC_CONFIGURED)
+    {
+        UsbCdc_DropTx();
+        UsbCdcHw_CloseEndpoint(USB_CDC_EP_DATA_IN);
+        UsbCdcHw_CloseEndpoint(USB_CDC_EP_DATA_OUT);
+        UsbCdcHw_CloseEndpoint(USB_CDC_EP_NOTIFY);
+        s_state = USB_CDC_ADDRESSED;
+    }
+
+    if (configured)
+    {
+        UsbCdcHw_OpenEndpoint(USB_CDC_EP_DATA_IN, USB_CDC_HW_EP_BULK, USB_CDC_PACKET_SIZE);
+        UsbCdcHw_OpenEndpoint(USB_CDC_EP_DATA_OUT, USB_CDC_HW_EP_BULK, USB_CDC_PACKET_SIZE);
+        UsbCdcHw_OpenEndpoint(USB_CDC_EP_NOTIFY, USB_CDC_HW_EP_INTERRUPT, USB_CDC_NOTIFY_SIZE);
+
+        s_rxIndex = 0U;
+        UsbCdcHw_Receive(USB_CDC_EP_DATA_OUT, s_rxBuffers[0], USB_CDC_PACKET_SIZE);
+        s_state = USB_CDC_CONFIGURED;
+    }
+}
+
+static void UsbCdc_DropTx(void)
+{
+    if (s_txBusy)
+    {
+        UsbCdcHw_AbortTransmit(USB_CDC_EP_DATA_IN);
+        s_stats.txDropped++;
+        UsbCdc_TxDone(false);
+    }
+}
+
+static void UsbCdc_TxDone(bool sent)
+{
+    s_txBusy = false;
+    s_txZlp  = false;
+    UsbCdcHw_EnableFrames(false);
+
+    if (sent)
+    {
+        s_stats.txBytes += s_txLen;
+    }
+
+    UartTx_OnUsbTxComplete(sent);
+}
@@ -0,0 +1,184 @@
+/**
+ * @file usb_cdc.h
+ * @brief USB CDC-ACM device: a second console transport next to the UART.
+ *
+ * The board enumerates as a virtual COM port on USB OTG FS. The transmit
+ * ring of uart_tx.c stays the single output path: while a host has the
+ * port open (configured, DTR set, bus not suspended), the ring's chunks
+ * and by-reference segments are sent as bulk IN transfers instead of UART
+ * DMA transfers, with the same stream priorities and the same
+ * all-or-nothing writes. Otherwise everything goes out on the UART as
+ * before. Bytes the host sends are fed to the CLI receive ring, like UART
+ * input.
+ *
+ * Full speed moves up to 19 bulk packets of 64 bytes per 1 ms frame, about
+ * 1.2 MB/s, which a 2 KiB chunk per transfer keeps busy. The bulk IN
+ * FIFO holds eight packets, so the core sends back to back while the
+ * interrupt refills it; OUT packets land in two alternating buffers, so
+ * the endpoint is re-armed before the bytes are handed on.
+ *
+ * A bulk IN transfer the host does not take within
+ * @ref USB_CDC_TX_TIMEOUT_MS is dropped and its bytes are resent on the
+ * UART, where output stays until the host sends something or reopens the
+ * port, so a terminal that stopped reading cannot stall the console
+ * (UartTx_Flush() waits for transfers in flight).
+ *
+ * Built in only with @ref USB_CDC_ENABLE; otherwise every function is a
+ * no-op and the port reports itself closed.
+ *
+ * @ingroup common
+ */
+
+#ifndef USB_CDC_H
+#define USB_CDC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_config.h"
+
+/**
+ * @defgroup usb_cdc USB CDC Console
+ * @brief Virtual COM port on USB OTG FS.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Packet size of endpoint 0 and the bulk data endpoints. */
+#define USB_CDC_PACKET_SIZE     (64U)
+
+/** @brief Bulk IN (device to host) endpoint. */
+#define USB_CDC_EP_DATA_IN      (0x81U)
+
+/** @brief Bulk OUT (host to device) endpoint. */
+#define USB_CDC_EP_DATA_OUT     (0x01U)
+
+/** @brief Interrupt IN endpoint for serial state notifications (unused). */
+#define USB_CDC_EP_NOTIFY       (0x82U)
+
+/** @brief Packet size of the notification endpoint. */
+#define USB_CDC_NOTIFY_SIZE     (8U)
+
+/**
+ * @brief Device state as seen from the bus.
+ */
+typedef enum
+{
+    USB_CDC_DETACHED = 0U,  /**< No bus reset seen (no host, or disabled). */
+    USB_CDC_DEFAULT,        /**< Reset, address 0.                         */
+    USB_CDC_ADDRESSED,      /**< Address assigned, not configured.         */
+    USB_CDC_CONFIGURED,     /**< Endpoints active.                         */
+    USB_CDC_STATE_COUNT     /**< Number of states (not a valid state).     */
+} UsbCdcState_t;
+
+/**
+ * @brief Port state and counters, for the "status" command.
+ */
+typedef struct
+{
+    UsbCdcState_t state;      /**< Device state.                              */
+    bool          suspended;  /**< Bus suspended (also after unplugging).     */
+    bool          dtr;        /**< Host has the port open.                    */
+    bool          stalled;    /**< Last transfer timed out; output on UART.   */
+    uint32_t      lineBaud;   /**< Rate the host set (informational only).    */
+    uint32_t      txBytes;    /**< Bytes taken by the host.                   */
+    uint32_t      rxBytes;    /**< Bytes received.                            */
+    uint32_t      txDropped;  /**< Transfers moved to the UART (timeout, close). */
+    uint32_t      resets;     /**< Bus resets.                                */
+} UsbCdcStats_t;
+
+/**
+ * @brief Start the USB device and connect to the bus.
+ *
+ * Call after CLI_Init() and before the clock profile is first changed.
+ * Does nothing when @ref USB_CDC_ENABLE is 0.
+ *
+ * @return None.
+ */
+void UsbCdc_Init(void);
+
+/**
+ * @brief Whether console output goes to USB.
+ *
+ * @return true while a host has the port open and reads from it.
+ */
+bool UsbCdc_IsOpen(void);
+
+/**
+ * @brief Whether a USB session is in progress (the bus is not suspended).
+ *
+ * STOP would stop the USB clock, so the power manager waits for this to
+ * clear.
+ *
+ * @return true between a bus reset and the next suspend.
+ */
+bool UsbCdc_IsActive(void);
+
+/**
+ * @brief Whether the USB 48 MHz clock (PLLSAI from HSE) is running.
+ *
+ * The clock profiles then keep HSE on and use it as the PLL input, since
+ * PLLSAI shares the PLL source with the main PLL.
+ *
+ * @return true after a successful UsbCdc_Init().
+ */
+bool UsbCdc_IsClocked(void);
+
+/**
+ * @brief Send a chunk of console output as one bulk IN transfer.
+ *
+ * Called by uart_tx.c with interrupts masked. Completion is reported
+ * through UartTx_OnUsbTxComplete(), also when the transfer is dropped.
+ *
+ * @param data Bytes; must stay valid until completion.
+ * @param len  Number of bytes.
+ *
+ * @return false if the port is not open or a transfer is in progress.
+ */
+bool UsbCdc_StartTx(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Stop the transfer in progress without reporting it.
+ *
+ * For the fault path of UartTx_Flush(), which resends the chunk on the
+ * UART.
+ *
+ * @return None.
+ */
+void UsbCdc_AbortTx(void);
+
+/**
+ * @brief Adapt the USB core to a new HCLK (clock profile change).
+ *
+ * @return None.
+ */
+void UsbCdc_OnClockChange(void);
+
+/**
+ * @brief Copy the port state and counters.
+ *
+ * @param[out] stats Receives the state.
+ *
+ * @return None.
+ */
+void UsbCdc_GetStats(UsbCdcStats_t *stats);
+
+/**
+ * @brief Name of a device state ("detached", "default", ...).
+ *
+ * @param state @ref UsbCdcState_t.
+ *
+ * @return Name, or "?".
+ */
+const char *UsbCdc_StateName(UsbCdcState_t state);
+
+/** @} */ /* end of usb_cdc group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_CDC_H */
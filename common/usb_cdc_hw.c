@@ -0,0 +1,826 @@
+/**
+ * @file usb_cdc_hw.c
+ * @brief USB OTG FS device port of the CDC console (PA11 D-, PA12 D+).
+ *
+ * The core runs in device mode on its embedded full-speed PHY, without
+ * VBUS sensing (PA9 is not wired on the Nucleo), in slave mode: the CPU
+ * moves every packet through the FIFOs. Received packets are popped from
+ * the shared RX FIFO in the RXFLVL interrupt; IN packets are pushed from
+ * the TXFE interrupt whenever the endpoint's TX FIFO has room for one.
+ * FIFO RAM (320 words) is split as:
+ *
+ * | FIFO      | Words | Packets of 64 bytes |
+ * |-----------|-------|---------------------|
+ * | RX        | 128   | shared by all OUT   |
+ * | EP0 TX    | 16    | 1                   |
+ * | EP1 TX    | 128   | 8 (bulk data)       |
+ * | EP2 TX    | 16    | 1 (notifications)   |
+ *
+ * The deep bulk FIFO lets the core answer back-to-back IN tokens within a
+ * frame while the interrupt tops it up, which is what reaches the
+ * full-speed bulk rate. A transfer longer than one hardware transfer
+ * (1023 packets, one packet on EP0) is sent as several.
+ *
+ * 48 MHz comes from PLLSAI P: HSE 8 MHz / 8 * 192 / 4. HSI is not
+ * accurate enough for USB (±0.25 % needed).
+ *
+ * Registers are accessed directly; the HAL PCD driver is not part of this
+ * project.
+ *
+ * @ingroup usb_cdc
+ */
+
+#include "usb_cdc_hw.h"
+#include "periph_power.h"
+#include "app_config.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/** @brief Endpoints of the F446 OTG FS core. */
+#define USB_CDC_HW_EP_COUNT       (6U)
+
+/** @brief Endpoints this port keeps transfer state for (0..2). */
+#define USB_CDC_HW_EP_USED        (3U)
+
+/** @brief FIFO sizes and offsets in 32-bit words. */
+#define USB_CDC_HW_RX_FIFO_WORDS  (128U)
+#define USB_CDC_HW_TX0_WORDS      (16U)
+#define USB_CDC_HW_TX1_WORDS      (128U)
+#define USB_CDC_HW_TX2_WORDS      (16U)
+
+/** @brief Packets per hardware transfer on the non-control endpoints. */
+#define USB_CDC_HW_MAX_PACKETS    (1023U)
+
+/** @brief Polls of a core status bit before giving up. */
+#define USB_CDC_HW_POLLS          (100000U)
+
+/** @brief Oscillator and PLL start-up limit. */
+#define USB_CDC_HW_START_MS       (100U)
+
+/** @brief Time the core needs to switch into device mode. */
+#define USB_CDC_HW_MODE_MS        (25U)
+
+/** @brief All interrupt flags of DIEPINTx / DOEPINTx. */
+#define USB_CDC_HW_EPINT_ALL      (0xFB7FU)
+
+/** @brief GRXSTSP packet status values. */
+#define USB_CDC_HW_PKT_OUT_DATA   (2U)
+#define USB_CDC_HW_PKT_SETUP_DATA (6U)
+
+/** @brief Register blocks of OTG FS. */
+#define USB_CDC_HW_CORE           USB_OTG_FS
+#define USB_CDC_HW_DEVICE         ((USB_OTG_DeviceTypeDef *)(USB_OTG_FS_PERIPH_BASE + USB_OTG_DEVICE_BASE))
+#define USB_CDC_HW_IN(n)          ((USB_OTG_INEndpointTypeDef *)(USB_OTG_FS_PERIPH_BASE + \
+                                   USB_OTG_IN_ENDPOINT_BASE + ((n) * USB_OTG_EP_REG_SIZE)))
+#define USB_CDC_HW_OUT(n)         ((USB_OTG_OUTEndpointTypeDef *)(USB_OTG_FS_PERIPH_BASE + \
+                                   USB_OTG_OUT_ENDPOINT_BASE + ((n) * USB_OTG_EP_REG_SIZE)))
+#define USB_CDC_HW_FIFO(n)        (*(volatile uint32_t *)(USB_OTG_FS_PERIPH_BASE + \
+                                   USB_OTG_FIFO_BASE + ((n) * USB_OTG_FIFO_SIZE)))
+#define USB_CDC_HW_PCGCCTL        (*(volatile uint32_t *)(USB_OTG_FS_PERIPH_BASE + USB_OTG_PCGCCTL_BASE))
+
+/**
+ * @brief IN endpoint transfer state.
+ */
+typedef struct
+{
+    const uint8_t *data;      /**< Next byte to push into the FIFO.          */
+    uint32_t       fifoLeft;  /**< Bytes of this hardware transfer not pushed. */
+    uint32_t       after;     /**< Bytes left for later hardware transfers.  */
+    uint16_t       maxPacket; /**< Packet size.                              */
+} UsbCdcHwIn_t;
+
+/**
+ * @brief OUT endpoint transfer state.
+ */
+typedef struct
+{
+    uint8_t  *buffer;    /**< Receive buffer.       */
+    uint32_t  size;      /**< Buffer size.          */
+    uint32_t  count;     /**< Bytes received.       */
+    uint16_t  maxPacket; /**< Packet size.          */
+} UsbCdcHwOut_t;
+
+/**
+ * @brief HCLK lower bounds and the turnaround time (TRDT) they need.
+ */
+typedef struct
+{
+    uint32_t minHclk;  /**< Lowest HCLK of the row (Hz). */
+    uint32_t trdt;     /**< GUSBCFG.TRDT.                */
+} UsbCdcHwTrdt_t;
+
+/** @brief TRDT by HCLK (reference manual, full speed), fastest first. */
+static const UsbCdcHwTrdt_t s_trdt[] =
+{
+    { 32000000U, 0x6U }, { 27500000U, 0x7U }, { 24000000U, 0x8U }, { 21800000U, 0x9U },
+    { 20000000U, 0xAU }, { 18500000U, 0xBU }, { 17200000U, 0xCU }, { 16000000U, 0xDU },
+    { 15000000U, 0xEU }, { 0U,        0xFU }
+};
+
+/** @brief IN endpoint state. */
+static UsbCdcHwIn_t s_in[USB_CDC_HW_EP_USED];
+
+/** @brief OUT endpoint state. */
+static UsbCdcHwOut_t s_out[USB_CDC_HW_EP_USED];
+
+/** @brief Last SETUP packet. */
+static uint32_t s_setup[2];
+
+/**
+ * @brief Start HSE and PLLSAI and select PLLSAI P as the 48 MHz clock.
+ */
+static bool UsbCdcHw_StartClock(void);
+
+/**
+ * @brief Wait for @p mask in @p reg to read as @p set (bounded).
+ */
+static bool UsbCdcHw_Wait(volatile uint32_t *reg, uint32_t mask, bool set);
+
+/**
+ * @brief Flush TX FIFO @p num (0x10: all of them).
+ */
+static void UsbCdcHw_FlushTx(uint32_t num);
+
+/**
+ * @brief Program the next hardware transfer of IN endpoint @p n.
+ */
+static void UsbCdcHw_StartIn(uint32_t n);
+
+/**
+ * @brief Push whole packets into the TX FIFO of IN endpoint @p n.
+ */
+static void UsbCdcHw_FillFifo(uint32_t n);
+
+/**
+ * @brief Arm endpoint 0 for the next SETUP packets.
+ */
+static void UsbCdcHw_Ep0OutStart(void);
+
+/**
+ * @brief Bus reset: endpoints back to their reset state.
+ */
+static void UsbCdcHw_OnReset(void);
+
+/**
+ * @brief Pop one RX FIFO entry.
+ */
+static void UsbCdcHw_OnRxFifo(void);
+
+/**
+ * @brief Service the interrupts of every IN endpoint.
+ */
+static void UsbCdcHw_OnInEndpoints(void);
+
+/**
+ * @brief Service the interrupts of every OUT endpoint.
+ */
+static void UsbCdcHw_OnOutEndpoints(void);
+
+/* ------------------------------------------------------------------------- */
+
+bool UsbCdcHw_Init(void)
+{
+    USB_OTG_GlobalTypeDef *core = USB_CDC_HW_CORE;
+    USB_OTG_DeviceTypeDef *dev  = USB_CDC_HW_DEVICE;
+
+    if (!UsbCdcHw_StartClock())
+    {
+        return false;
+    }
+
+    /* PA11/PA12: AF10, very high speed. GPIOA stays clocked (LD2). */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOA);
+    GPIOA->MODER   = (GPIOA->MODER & ~(GPIO_MODER_MODER11 | GPIO_MODER_MODER12)) |
+                     GPIO_MODER_MODER11_1 | GPIO_MODER_MODER12_1;
+    GPIOA->OSPEEDR |= GPIO_OSPEEDR_OSPEED11 | GPIO_OSPEEDR_OSPEED12;
+    GPIOA->AFR[1]  = (GPIOA->AFR[1] & ~0x000FF000U) | 0x000AA000U;
+
+    PeriphPower_Acquire(PERIPH_POWER_OTGFS);
+
+    /* Core reset, transceiver on, B-session forced valid (no VBUS pin). */
+    core->GUSBCFG |= USB_OTG_GUSBCFG_PHYSEL;
+    (void)UsbCdcHw_Wait(&core->GRSTCTL, USB_OTG_GRSTCTL_AHBIDL, true);
+    core->GRSTCTL |= USB_OTG_GRSTCTL_CSRST;
+    (void)UsbCdcHw_Wait(&core->GRSTCTL, USB_OTG_GRSTCTL_CSRST, false);
+
+    core->GCCFG    = USB_OTG_GCCFG_PWRDWN;
+    core->GOTGCTL |= USB_OTG_GOTGCTL_BVALOEN | USB_OTG_GOTGCTL_BVALOVAL;
+    core->GUSBCFG  = (core->GUSBCFG & ~USB_OTG_GUSBCFG_FHMOD) | USB_OTG_GUSBCFG_FDMOD;
+    HAL_Delay(USB_CDC_HW_MODE_MS);
+
+    /* Full speed, disconnected until configured. */
+    USB_CDC_HW_PCGCCTL = 0U;
+    dev->DCTL |= USB_OTG_DCTL_SDIS;
+    dev->DCFG |= USB_OTG_DCFG_DSPD;
+
+    core->GRXFSIZ             = USB_CDC_HW_RX_FIFO_WORDS;
+    core->DIEPTXF0_HNPTXFSIZ  = (USB_CDC_HW_TX0_WORDS << 16) | USB_CDC_HW_RX_FIFO_WORDS;
+    core->DIEPTXF[0]          = (USB_CDC_HW_TX1_WORDS << 16) |
+                                (USB_CDC_HW_RX_FIFO_WORDS + USB_CDC_HW_TX0_WORDS);
+    core->DIEPTXF[1]          = (USB_CDC_HW_TX2_WORDS << 16) |
+                                (USB_CDC_HW_RX_FIFO_WORDS + USB_CDC_HW_TX0_WORDS + USB_CDC_HW_TX1_WORDS);
+    UsbCdcHw_FlushTx(0x10U);
+    core->GRSTCTL = USB_OTG_GRSTCTL_RXFFLSH;
+    (void)UsbCdcHw_Wait(&core->GRSTCTL, USB_OTG_GRSTCTL_RXFFLSH, false);
+
+    dev->DIEPMSK    = 0U;
+    dev->DOEPMSK    = 0U;
+    dev->DAINTMSK   = 0U;
+    dev->DIEPEMPMSK = 0U;
+    for (uint32_t n = 0U; n < USB_CDC_HW_EP_COUNT; ++n)
+    {
+        USB_CDC_HW_IN(n)->DIEPCTL  = 0U;
+        USB_CDC_HW_IN(n)->DIEPTSIZ = 0U;
+        USB_CDC_HW_IN(n)->DIEPINT  = USB_CDC_HW_EPINT_ALL;
+        USB_CDC_HW_OUT(n)->DOEPCTL  = 0U;
+        USB_CDC_HW_OUT(n)->DOEPTSIZ = 0U;
+        USB_CDC_HW_OUT(n)->DOEPINT  = USB_CDC_HW_EPINT_ALL;
+    }
+    memset(s_in, 0, sizeof(s_in));
+    memset(s_out, 0, sizeof(s_out));
+
+    UsbCdcHw_OnClockChange();
+
+    core->GINTSTS = 0xFFFFFFFFU;
+    core->GINTMSK = USB_OTG_GINTMSK_USBRST | USB_OTG_GINTMSK_ENUMDNEM |
+                    USB_OTG_GINTMSK_USBSUSPM | USB_OTG_GINTMSK_WUIM |
+                    USB_OTG_GINTMSK_RXFLVLM | USB_OTG_GINTMSK_IEPINT | USB_OTG_GINTMSK_OEPINT;
+    core->GAHBCFG |= USB_OTG_GAHBCFG_GINT;
+
+    HAL_NVIC_SetPriority(OTG_FS_IRQn, IRQ_PRIO_USB, 0U);
+    HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+
+    /* D+ pull-up on: the host sees the device. */
+    dev->DCTL &= ~USB_OTG_DCTL_SDIS;
+
+    return true;
+}
+
+void UsbCdcHw_SetAddress(uint8_t address)
+{
+    USB_OTG_DeviceTypeDef *dev = USB_CDC_HW_DEVICE;
+
+    dev->DCFG = (dev->DCFG & ~USB_OTG_DCFG_DAD) | ((uint32_t)address << USB_OTG_DCFG_DAD_Pos);
+}
+
+void UsbCdcHw_OpenEndpoint(uint8_t ep, uint8_t type, uint16_t maxPacket)
+{
+    USB_OTG_DeviceTypeDef *dev = USB_CDC_HW_DEVICE;
+    uint32_t               n   = ep & 0x7FU;
+
+    if ((n == 0U) || (n >= USB_CDC_HW_EP_USED))
+    {
+        return;
+    }
+
+    if ((ep & USB_CDC_HW_EP_IN) != 0U)
+    {
+        s_in[n].maxPacket = maxPacket;
+        s_in[n].fifoLeft  = 0U;
+        s_in[n].after     = 0U;
+        USB_CDC_HW_IN(n)->DIEPCTL = maxPacket | ((uint32_t)type << USB_OTG_DIEPCTL_EPTYP_Pos) |
+                                    (n << USB_OTG_DIEPCTL_TXFNUM_Pos) |
+                                    USB_OTG_DIEPCTL_SD0PID_SEVNFRM | USB_OTG_DIEPCTL_USBAEP;
+        dev->DAINTMSK |= (1UL << n);
+    }
+    else
+    {
+        s_out[n].maxPacket = maxPacket;
+        USB_CDC_HW_OUT(n)->DOEPCTL = maxPacket | ((uint32_t)type << USB_OTG_DOEPCTL_EPTYP_Pos) |
+                                     USB_OTG_DOEPCTL_SD0PID_SEVNFRM | USB_OTG_DOEPCTL_USBAEP;
+        dev->DAINTMSK |= (1UL << (16U + n));
+    }
+}
+
+void UsbCdcHw_CloseEndpoint(uint8_t ep)
+{
+    USB_OTG_DeviceTypeDef *dev = USB_CDC_HW_DEVICE;
+    uint32_t               n   = ep & 0x7FU;
+
+    if ((n == 0U) || (n >= USB_CDC_HW_EP_USED))
+    {
+        return;
+    }
+
+    if ((ep & USB_CDC_HW_EP_IN) != 0U)
+    {
+        UsbCdcHw_AbortTransmit(ep);
+        dev->DAINTMSK &= ~(1UL << n);
+        USB_CDC_HW_IN(n)->DIEPCTL &= ~USB_OTG_DIEPCTL_USBAEP;
+    }
+    else
+    {
+        USB_OTG_OUTEndpointTypeDef *out = USB_CDC_HW_OUT(n);
+
+        if ((out->DOEPCTL & USB_OTG_DOEPCTL_EPENA) != 0U)
+        {
+            out->DOEPCTL |= USB_OTG_DOEPCTL_SNAK | USB_OTG_DOEPCTL_EPDIS;
+            (void)UsbCdcHw_Wait(&out->DOEPINT, USB_OTG_DOEPINT_EPDISD, true);
+            out->DOEPINT = USB_OTG_DOEPINT_EPDISD;
+        }
+        dev->DAINTMSK &= ~(1UL << (16U + n));
+        out->DOEPCTL  &= ~USB_OTG_DOEPCTL_USBAEP;
+        s_out[n].buffer = NULL;
+    }
+}
+
+void UsbCdcHw_Transmit(uint8_t ep, const uint8_t *data, uint32_t len)
+{
+    uint32_t n = ep & 0x7FU;
+
+    if (n >= USB_CDC_HW_EP_USED)
+    {
+        return;
+    }
+
+    if (n == 0U)
+    {
+        s_in[0].maxPacket = USB_CDC_HW_TX0_WORDS * 4U;
+    }
+
+    s_in[n].data  = data;
+    s_in[n].after = len;
+    UsbCdcHw_StartIn(n);
+}
+
+void UsbCdcHw_AbortTransmit(uint8_t ep)
+{
+    USB_OTG_DeviceTypeDef     *dev = USB_CDC_HW_DEVICE;
+    uint32_t                   n   = ep & 0x7FU;
+    USB_OTG_INEndpointTypeDef *in  = USB_CDC_HW_IN(n);
+
+    if (n >= USB_CDC_HW_EP_USED)
+    {
+        return;
+    }
+
+    dev->DIEPEMPMSK &= ~(1UL << n);
+    s_in[n].fifoLeft = 0U;
+    s_in[n].after    = 0U;
+
+    if ((in->DIEPCTL & USB_OTG_DIEPCTL_EPENA) != 0U)
+    {
+        /* NAK first, then disable; the toggle is kept. */
+        in->DIEPCTL |= USB_OTG_DIEPCTL_SNAK;
+        (void)UsbCdcHw_Wait(&in->DIEPINT, USB_OTG_DIEPINT_INEPNE, true);
+        in->DIEPCTL |= USB_OTG_DIEPCTL_EPDIS;
+        (void)UsbCdcHw_Wait(&in->DIEPINT, USB_OTG_DIEPINT_EPDISD, true);
+        in->DIEPINT = USB_OTG_DIEPINT_EPDISD | USB_OTG_DIEPINT_INEPNE | USB_OTG_DIEPINT_XFRC;
+    }
+
+    UsbCdcHw_FlushTx(n);
+}
+
+void UsbCdcHw_Receive(uint8_t ep, uint8_t *buffer, uint32_t len)
+{
+    uint32_t n = ep & 0x7FU;
+
+    if (n >= USB_CDC_HW_EP_USED)
+    {
+        return;
+    }
+
+    USB_OTG_OUTEndpointTypeDef *out = USB_CDC_HW_OUT(n);
+
+    s_out[n].buffer = buffer;
+    s_out[n].size   = len;
+    s_out[n].count  = 0U;
+
+    if (n == 0U)
+    {
+        /* One packet at a time; SETUP packets stay accepted. */
+        s_out[0].maxPacket = USB_CDC_HW_TX0_WORDS * 4U;
+        out->DOEPTSIZ = (3UL << USB_OTG_DOEPTSIZ_STUPCNT_Pos) | (1UL << USB_OTG_DOEPTSIZ_PKTCNT_Pos) |
+                        s_out[0].maxPacket;
+    }
+    else
+    {
+        uint32_t mps     = s_out[n].maxPacket;
+        uint32_t packets = (len == 0U) ? 1U : ((len + mps - 1U) / mps);
+
+        out->DOEPTSIZ = (packets << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | (packets * mps);
+    }
+
+    out->DOEPCTL |= USB_OTG_DOEPCTL_CNAK | USB_OTG_DOEPCTL_EPENA;
+}
+
+void UsbCdcHw_Stall(uint8_t ep)
+{
+    uint32_t n = ep & 0x7FU;
+
+    if ((ep & USB_CDC_HW_EP_IN) != 0U)
+    {
+        USB_OTG_INEndpointTypeDef *in = USB_CDC_HW_IN(n);
+
+        if (((in->DIEPCTL & USB_OTG_DIEPCTL_EPENA) == 0U) && (n != 0U))
+        {
+            in->DIEPCTL &= ~USB_OTG_DIEPCTL_EPDIS;
+        }
+        in->DIEPCTL |= USB_OTG_DIEPCTL_STALL;
+    }
+    else
+    {
+        USB_OTG_OUTEndpointTypeDef *out = USB_CDC_HW_OUT(n);
+
+        if (((out->DOEPCTL & USB_OTG_DOEPCTL_EPENA) == 0U) && (n != 0U))
+        {
+            out->DOEPCTL &= ~USB_OTG_DOEPCTL_EPDIS;
+        }
+        out->DOEPCTL |= USB_OTG_DOEPCTL_STALL;
+    }
+
+    if (n == 0U)
+    {
+        UsbCdcHw_Ep0OutStart();
+    }
+}
+
+void UsbCdcHw_ClearStall(uint8_t ep)
+{
+    uint32_t n = ep & 0x7FU;
+
+    if ((ep & USB_CDC_HW_EP_IN) != 0U)
+    {
+        USB_CDC_HW_IN(n)->DIEPCTL = (USB_CDC_HW_IN(n)->DIEPCTL & ~USB_OTG_DIEPCTL_STALL) |
+                                    USB_OTG_DIEPCTL_SD0PID_SEVNFRM;
+    }
+    else
+    {
+        USB_CDC_HW_OUT(n)->DOEPCTL = (USB_CDC_HW_OUT(n)->DOEPCTL & ~USB_OTG_DOEPCTL_STALL) |
+                                     USB_OTG_DOEPCTL_SD0PID_SEVNFRM;
+    }
+}
+
+void UsbCdcHw_EnableFrames(bool enable)
+{
+    USB_OTG_GlobalTypeDef *core    = USB_CDC_HW_CORE;
+    uint32_t               primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (enable)
+    {
+        core->GINTSTS  = USB_OTG_GINTSTS_SOF;
+        core->GINTMSK |= USB_OTG_GINTMSK_SOFM;
+    }
+    else
+    {
+        core->GINTMSK &= ~USB_OTG_GINTMSK_SOFM;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void UsbCdcHw_OnClockChange(void)
+{
+    USB_OTG_GlobalTypeDef *core = USB_CDC_HW_CORE;
+    uint32_t               hclk = HAL_RCC_GetHCLKFreq();
+    uint32_t               i    = 0U;
+
+    while (hclk < s_trdt[i].minHclk)
+    {
+        i++;
+    }
+
+    core->GUSBCFG = (core->GUSBCFG & ~USB_OTG_GUSBCFG_TRDT) | (s_trdt[i].trdt << USB_OTG_GUSBCFG_TRDT_Pos);
+}
+
+void UsbCdcHw_IrqHandler(void)
+{
+    USB_OTG_GlobalTypeDef *core    = USB_CDC_HW_CORE;
+    USB_OTG_DeviceTypeDef *dev     = USB_CDC_HW_DEVICE;
+    uint32_t               pending = core->GINTSTS & core->GINTMSK;
+
+    if ((pending & USB_OTG_GINTSTS_USBRST) != 0U)
+    {
+        core->GINTSTS = USB_OTG_GINTSTS_USBRST;
+        UsbCdcHw_OnReset();
+    }
+
+    if ((pending & USB_OTG_GINTSTS_ENUMDNE) != 0U)
+    {
+        /* EP0 packets of 64 bytes; the only speed is full speed. */
+        core->GINTSTS = USB_OTG_GINTSTS_ENUMDNE;
+        USB_CDC_HW_IN(0U)->DIEPCTL &= ~USB_OTG_DIEPCTL_MPSIZ;
+        dev->DCTL |= USB_OTG_DCTL_CGINAK;
+        UsbCdcHw_OnClockChange();
+    }
+
+    while ((core->GINTSTS & core->GINTMSK & USB_OTG_GINTSTS_RXFLVL) != 0U)
+    {
+        UsbCdcHw_OnRxFifo();
+    }
+
+    if ((pending & USB_OTG_GINTSTS_OEPINT) != 0U)
+    {
+        UsbCdcHw_OnOutEndpoints();
+    }
+
+    if ((pending & USB_OTG_GINTSTS_IEPINT) != 0U)
+    {
+        UsbCdcHw_OnInEndpoints();
+    }
+
+    if ((pending & USB_OTG_GINTSTS_SOF) != 0U)
+    {
+        core->GINTSTS = USB_OTG_GINTSTS_SOF;
+        UsbCdc_OnHwFrame();
+    }
+
+    if ((pending & USB_OTG_GINTSTS_USBSUSP) != 0U)
+    {
+        core->GINTSTS = USB_OTG_GINTSTS_USBSUSP;
+        UsbCdc_OnHwSuspend(true);
+    }
+
+    if ((pending & USB_OTG_GINTSTS_WKUINT) != 0U)
+    {
+        core->GINTSTS = USB_OTG_GINTSTS_WKUINT;
+        UsbCdc_OnHwSuspend(false);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool UsbCdcHw_StartClock(void)
+{
+    /* PLLSAI shares the PLL source bit with the main PLL, which may only
+     * change while that PLL is off (it is at boot, in LOW_POWER).
+     */
+    if (((RCC->CR & RCC_CR_PLLON) != 0U) && ((RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) == RCC_PLLCFGR_PLLSRC_HSI))
+    {
+        return false;
+    }
+
+    /* Nucleo-64: 8 MHz from the ST-LINK MCO on OSC_IN. */
+    RCC->CR |= RCC_CR_HSEBYP;
+    RCC->CR |= RCC_CR_HSEON;
+
+    uint32_t start = HAL_GetTick();
+    while ((RCC->CR & RCC_CR_HSERDY) == 0U)
+    {
+        if ((HAL_GetTick() - start) > USB_CDC_HW_START_MS)
+        {
+            RCC->CR &= ~(RCC_CR_HSEON | RCC_CR_HSEBYP);
+            return false;
+        }
+    }
+
+    RCC->PLLCFGR    |= RCC_PLLCFGR_PLLSRC_HSE;
+    RCC->PLLSAICFGR  = (RCC->PLLSAICFGR &
+                        ~(RCC_PLLSAICFGR_PLLSAIM | RCC_PLLSAICFGR_PLLSAIN | RCC_PLLSAICFGR_PLLSAIP)) |
+                       ((HSE_VALUE / 1000000U) << RCC_PLLSAICFGR_PLLSAIM_Pos) |
+                       (192U << RCC_PLLSAICFGR_PLLSAIN_Pos) |
+                       (1U << RCC_PLLSAICFGR_PLLSAIP_Pos);
+    RCC->CR |= RCC_CR_PLLSAION;
+
+    start = HAL_GetTick();
+    while ((RCC->CR & RCC_CR_PLLSAIRDY) == 0U)
+    {
+        if ((HAL_GetTick() - start) > USB_CDC_HW_START_MS)
+        {
+            RCC->CR &= ~RCC_CR_PLLSAION;
+            return false;
+        }
+    }
+
+    RCC->DCKCFGR2 |= RCC_DCKCFGR2_CK48MSEL;
+
+    return true;
+}
+
+static bool UsbCdcHw_Wait(volatile uint32_t *reg, uint32_t mask, bool set)
+{
+    for (uint32_t polls = 0U; polls < USB_CDC_HW_POLLS; ++polls)
+    {
+        if (((*reg & mask) != 0U) == set)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void UsbCdcHw_FlushTx(uint32_t num)
+{
+    USB_OTG_GlobalTypeDef *core = USB_CDC_HW_CORE;
+
+    core->GRSTCTL = USB_OTG_GRSTCTL_TXFFLSH | (num << USB_OTG_GRSTCTL_TXFNUM_Pos);
+    (void)UsbCdcHw_Wait(&core->GRSTCTL, USB_OTG_GRSTCTL_TXFFLSH, false);
+}
+
+static void UsbCdcHw_StartIn(uint32_t n)
+{
+    USB_OTG_DeviceTypeDef     *dev   = USB_CDC_HW_DEVICE;
+    USB_OTG_INEndpointTypeDef *in    = USB_CDC_HW_IN(n);
+    uint32_t                   mps   = s_in[n].maxPacket;
+    uint32_t                   limit = (n == 0U) ? mps : (USB_CDC_HW_MAX_PACKETS * mps);
+    uint32_t                   piece = s_in[n].after;
+
+    if (piece > limit)
+    {
+        piece = limit;
+    }
+    s_in[n].after   -= piece;
+    s_in[n].fifoLeft = piece;
+
+    uint32_t packets = (piece == 0U) ? 1U : ((piece + mps - 1U) / mps);
+
+    in->DIEPTSIZ = (packets << USB_OTG_DIEPTSIZ_PKTCNT_Pos) | piece;
+    in->DIEPCTL |= USB_OTG_DIEPCTL_CNAK | USB_OTG_DIEPCTL_EPENA;
+
+    if (piece != 0U)
+    {
+        dev->DIEPEMPMSK |= (1UL << n);
+    }
+}
+
+static void UsbCdcHw_FillFifo(uint32_t n)
+{
+    USB_OTG_DeviceTypeDef *dev = USB_CDC_HW_DEVICE;
+    UsbCdcHwIn_t          *ep  = &s_in[n];
+
+    while (ep->fifoLeft != 0U)
+    {
+        uint32_t len   = (ep->fifoLeft < ep->maxPacket) ? ep->fifoLeft : ep->maxPacket;
+        uint32_t words = (len + 3U) / 4U;
+
+        if ((USB_CDC_HW_IN(n)->DTXFSTS & USB_OTG_DTXFSTS_INEPTFSAV) < words)
+        {
+            return;
+        }
+
+        for (uint32_t i = 0U; i < words; ++i)
+        {
+            uint32_t word  = 0U;
+            uint32_t bytes = ((len - (4U * i)) < 4U) ? (len - (4U * i)) : 4U;
+
+            memcpy(&word, &ep->data[4U * i], bytes);
+            USB_CDC_HW_FIFO(n) = word;
+        }
+
+        ep->data     += len;
+        ep->fifoLeft -= len;
+    }
+
+    dev->DIEPEMPMSK &= ~(1UL << n);
+}
+
+static void UsbCdcHw_Ep0OutStart(void)
+{
+    USB_CDC_HW_OUT(0U)->DOEPTSIZ = (3UL << USB_OTG_DOEPTSIZ_STUPCNT_Pos) |
+                                   (1UL << USB_OTG_DOEPTSIZ_PKTCNT_Pos) | (3U * 8U);
+}
+
+static void UsbCdcHw_OnReset(void)
+{
+    USB_OTG_DeviceTypeDef *dev = USB_CDC_HW_DEVICE;
+
+    dev->DCTL &= ~USB_OTG_DCTL_RWUSIG;
+    UsbCdcHw_FlushTx(0x10U);
+
+    for (uint32_t n = 0U; n < USB_CDC_HW_EP_COUNT; ++n)
+    {
+        USB_CDC_HW_IN(n)->DIEPINT   = USB_CDC_HW_EPINT_ALL;
+        USB_CDC_HW_IN(n)->DIEPCTL  &= ~USB_OTG_DIEPCTL_STALL;
+        USB_CDC_HW_OUT(n)->DOEPINT  = USB_CDC_HW_EPINT_ALL;
+        USB_CDC_HW_OUT(n)->DOEPCTL &= ~USB_OTG_DOEPCTL_STALL;
+        USB_CDC_HW_OUT(n)->DOEPCTL |= USB_OTG_DOEPCTL_SNAK;
+        if (n != 0U)
+        {
+            USB_CDC_HW_IN(n)->DIEPCTL  &= ~USB_OTG_DIEPCTL_USBAEP;
+            USB_CDC_HW_OUT(n)->DOEPCTL &= ~USB_OTG_DOEPCTL_USBAEP;
+        }
+    }
+    memset(s_in, 0, sizeof(s_in));
+    memset(s_out, 0, sizeof(s_out));
+
+    dev->DAINTMSK   = (1UL << 16) | 1UL;
+    dev->DOEPMSK    = USB_OTG_DOEPMSK_STUPM | USB_OTG_DOEPMSK_XFRCM;
+    dev->DIEPMSK    = USB_OTG_DIEPMSK_XFRCM | USB_OTG_DIEPMSK_TOM;
+    dev->DIEPEMPMSK = 0U;
+    dev->DCFG      &= ~USB_OTG_DCFG_DAD;
+
+    UsbCdcHw_Ep0OutStart();
+    UsbCdc_OnHwReset();
+}
+
+static void UsbCdcHw_OnRxFifo(void)
+{
+    USB_OTG_GlobalTypeDef *core = USB_CDC_HW_CORE;
+
+    core->GINTMSK &= ~USB_OTG_GINTMSK_RXFLVLM;
+
+    uint32_t status = core->GRXSTSP;
+    uint32_t n      = status & USB_OTG_GRXSTSP_EPNUM;
+    uint32_t count  = (status & USB_OTG_GRXSTSP_BCNT) >> USB_OTG_GRXSTSP_BCNT_Pos;
+    uint32_t kind   = (status & USB_OTG_GRXSTSP_PKTSTS) >> USB_OTG_GRXSTSP_PKTSTS_Pos;
+    uint32_t words  = (count + 3U) / 4U;
+
+    if ((kind == USB_CDC_HW_PKT_SETUP_DATA) && (n == 0U) && (words == 2U))
+    {
+        s_setup[0] = USB_CDC_HW_FIFO(0U);
+        s_setup[1] = USB_CDC_HW_FIFO(0U);
+    }
+    else
+    {
+        /* OUT data into the armed buffer; whatever does not fit is read
+         * and dropped, so the FIFO stays in step.
+         */
+        UsbCdcHwOut_t *ep = (n < USB_CDC_HW_EP_USED) ? &s_out[n] : NULL;
+
+        for (uint32_t i = 0U; i < words; ++i)
+        {
+            uint32_t word  = USB_CDC_HW_FIFO(0U);
+            uint32_t bytes = ((count - (4U * i)) < 4U) ? (count - (4U * i)) : 4U;
+
+            if ((kind == USB_CDC_HW_PKT_OUT_DATA) && (ep != NULL) && (ep->buffer != NULL) &&
+                ((ep->count + bytes) <= ep->size))
+            {
+                memcpy(&ep->buffer[ep->count], &word, bytes);
+                ep->count += bytes;
+            }
+        }
+    }
+
+    core->GINTMSK |= USB_OTG_GINTMSK_RXFLVLM;
+}
+
+static void UsbCdcHw_OnInEndpoints(void)
+{
+    USB_OTG_DeviceTypeDef *dev  = USB_CDC_HW_DEVICE;
+    uint32_t               bits = dev->DAINT & dev->DAINTMSK & 0xFFFFU;
+
+    for (uint32_t n = 0U; (n < USB_CDC_HW_EP_USED) && (bits != 0U); ++n)
+    {
+        if ((bits & (1UL << n)) == 0U)
+        {
+            continue;
+        }
+
+        USB_OTG_INEndpointTypeDef *in      = USB_CDC_HW_IN(n);
+        uint32_t                   fifoEmp = ((dev->DIEPEMPMSK >> n) & 1U) << 7;
+        uint32_t                   flags   = in->DIEPINT & (dev->DIEPMSK | fifoEmp);
+
+        if ((flags & USB_OTG_DIEPINT_TOC) != 0U)
+        {
+            in->DIEPINT = USB_OTG_DIEPINT_TOC;
+        }
+
+        if ((flags & USB_OTG_DIEPINT_XFRC) != 0U)
+        {
+            in->DIEPINT      = USB_OTG_DIEPINT_XFRC;
+            dev->DIEPEMPMSK &= ~(1UL << n);
+
+            if (s_in[n].after != 0U)
+            {
+                UsbCdcHw_StartIn(n);
+            }
+            else
+            {
+                UsbCdc_OnHwIn((uint8_t)(n | USB_CDC_HW_EP_IN));
+            }
+        }
+
+        if ((flags & USB_OTG_DIEPINT_TXFE) != 0U)
+        {
+            UsbCdcHw_FillFifo(n);
+        }
+    }
+}
+
+static void UsbCdcHw_OnOutEndpoints(void)
+{
+    USB_OTG_DeviceTypeDef *dev  = USB_CDC_HW_DEVICE;
+    uint32_t               bits = (dev->DAINT & dev->DAINTMSK) >> 16;
+
+    for (uint32_t n = 0U; (n < USB_CDC_HW_EP_USED) && (bits != 0U); ++n)
+    {
+        if ((bits & (1UL << n)) == 0U)
+        {
+            continue;
+        }
+
+        USB_OTG_OUTEndpointTypeDef *out   = USB_CDC_HW_OUT(n);
+        uint32_t                    flags = out->DOEPINT & dev->DOEPMSK;
+
+        if ((flags & USB_OTG_DOEPINT_XFRC) != 0U)
+        {
+            out->DOEPINT = USB_OTG_DOEPINT_XFRC;
+            UsbCdc_OnHwOut((uint8_t)n, s_out[n].count);
+        }
+
+        if ((flags & USB_OTG_DOEPINT_STUP) != 0U)
+        {
+            out->DOEPINT = USB_OTG_DOEPINT_STUP;
+            UsbCdcHw_Ep0OutStart();
+
+            uint8_t setup[8];
+            memcpy(setup, s_setup, sizeof(setup));
+            UsbCdc_OnHwSetup(setup);
+        }
+    }
+}
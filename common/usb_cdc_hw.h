@@ -0,0 +1,212 @@
+/**
+ * @file usb_cdc_hw.h
+ * @brief Hardware port of the USB CDC device (endpoint transfers).
+ *
+ * usb_cdc.c owns the descriptors and the control requests and calls into
+ * this port, which moves packets between memory and the endpoint FIFOs
+ * and reports bus events and finished transfers through the
+ * UsbCdc_OnHw*() callbacks, all from the OTG FS interrupt.
+ * usb_cdc_hw.c drives OTG FS at register level (the HAL PCD module and
+ * the ST USB device library are not part of this project). The host
+ * simulation has its own port with a simulated host.
+ *
+ * Endpoints are addressed as on the bus: bit 7 set for IN.
+ *
+ * @ingroup usb_cdc
+ */
+
+#ifndef USB_CDC_HW_H
+#define USB_CDC_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** @brief Direction bit of an endpoint address. */
+#define USB_CDC_HW_EP_IN        (0x80U)
+
+/** @brief Endpoint types (bmAttributes). */
+#define USB_CDC_HW_EP_BULK      (2U)
+#define USB_CDC_HW_EP_INTERRUPT (3U)
+
+/**
+ * @brief Start the 48 MHz clock, configure the pins and the core, and
+ *        connect to the bus (D+ pull-up).
+ *
+ * @return false if the USB clock could not be started; the core is then
+ *         left off.
+ */
+bool UsbCdcHw_Init(void);
+
+/**
+ * @brief Set the device address (SET_ADDRESS, before its status stage).
+ *
+ * @param address Address from the host.
+ *
+ * @return None.
+ */
+void UsbCdcHw_SetAddress(uint8_t address);
+
+/**
+ * @brief Activate a non-control endpoint (SET_CONFIGURATION).
+ *
+ * @param ep        Endpoint address.
+ * @param type      @ref USB_CDC_HW_EP_BULK or @ref USB_CDC_HW_EP_INTERRUPT.
+ * @param maxPacket Packet size.
+ *
+ * @return None.
+ */
+void UsbCdcHw_OpenEndpoint(uint8_t ep, uint8_t type, uint16_t maxPacket);
+
+/**
+ * @brief Deactivate an endpoint; a transfer in progress is dropped
+ *        without a callback.
+ *
+ * @param ep Endpoint address.
+ *
+ * @return None.
+ */
+void UsbCdcHw_CloseEndpoint(uint8_t ep);
+
+/**
+ * @brief Start an IN transfer.
+ *
+ * @p len may span many packets; the port splits it as the hardware
+ * requires and calls UsbCdc_OnHwIn() once the last packet was taken by
+ * the host. A length of 0 sends one zero-length packet.
+ *
+ * @param ep   IN endpoint address.
+ * @param data Bytes; must stay valid until UsbCdc_OnHwIn().
+ * @param len  Number of bytes.
+ *
+ * @return None.
+ */
+void UsbCdcHw_Transmit(uint8_t ep, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Drop the IN transfer in progress; UsbCdc_OnHwIn() is not called.
+ *
+ * The endpoint stays active and keeps its data toggle.
+ *
+ * @param ep IN endpoint address.
+ *
+ * @return None.
+ */
+void UsbCdcHw_AbortTransmit(uint8_t ep);
+
+/**
+ * @brief Arm an OUT endpoint for up to @p len bytes.
+ *
+ * The transfer ends with a short packet or when @p len bytes arrived;
+ * UsbCdc_OnHwOut() reports the count.
+ *
+ * @param ep     OUT endpoint address.
+ * @param buffer Receive buffer (may be NULL for @p len 0).
+ * @param len    Buffer size.
+ *
+ * @return None.
+ */
+void UsbCdcHw_Receive(uint8_t ep, uint8_t *buffer, uint32_t len);
+
+/**
+ * @brief Stall an endpoint (both directions of endpoint 0 until the next
+ *        SETUP).
+ *
+ * @param ep Endpoint address.
+ *
+ * @return None.
+ */
+void UsbCdcHw_Stall(uint8_t ep);
+
+/**
+ * @brief Clear a stall (CLEAR_FEATURE ENDPOINT_HALT); resets the data toggle.
+ *
+ * @param ep Endpoint address.
+ *
+ * @return None.
+ */
+void UsbCdcHw_ClearStall(uint8_t ep);
+
+/**
+ * @brief Enable or disable the start-of-frame callback (1 ms).
+ *
+ * @param enable true to call UsbCdc_OnHwFrame() every frame.
+ *
+ * @return None.
+ */
+void UsbCdcHw_EnableFrames(bool enable);
+
+/**
+ * @brief Adapt the core's AHB timing after an HCLK change.
+ *
+ * @return None.
+ */
+void UsbCdcHw_OnClockChange(void);
+
+/**
+ * @brief OTG FS global interrupt handler.
+ *
+ * @return None.
+ */
+void UsbCdcHw_IrqHandler(void);
+
+/**
+ * @brief Bus reset; every endpoint but 0 is closed. Implemented by usb_cdc.c.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwReset(void);
+
+/**
+ * @brief The host suspended or resumed the bus. Implemented by usb_cdc.c.
+ *
+ * @param suspended true on suspend, false on resume.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwSuspend(bool suspended);
+
+/**
+ * @brief SETUP packet on endpoint 0. Implemented by usb_cdc.c.
+ *
+ * @param setup The 8 bytes of the packet.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwSetup(const uint8_t *setup);
+
+/**
+ * @brief OUT transfer finished. Implemented by usb_cdc.c.
+ *
+ * @param ep  OUT endpoint address.
+ * @param len Bytes received.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwOut(uint8_t ep, uint32_t len);
+
+/**
+ * @brief IN transfer finished. Implemented by usb_cdc.c.
+ *
+ * @param ep IN endpoint address.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwIn(uint8_t ep);
+
+/**
+ * @brief Start of frame, while enabled by UsbCdcHw_EnableFrames().
+ *        Implemented by usb_cdc.c.
+ *
+ * @return None.
+ */
+void UsbCdc_OnHwFrame(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_CDC_HW_H */
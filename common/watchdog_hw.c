@@ -0,0 +1,91 @@
+/**
+ * @file watchdog_hw.c
+ * @brief Register-level IWDG start and refresh.
+ *
+ * Writing the start key also starts the LSI, so this works whether or
+ * not the RTC has been set up. The prescaler and reload registers are
+ * written in the LSI domain; their update takes a few LSI cycles, shown
+ * by the SR busy flags.
+ *
+ * @ingroup watchdog_hw
+ */
+
+#include "watchdog_hw.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Key register values. */
+#define WATCHDOG_HW_KEY_RELOAD    (0xAAAAU)
+#define WATCHDOG_HW_KEY_ACCESS    (0x5555U)
+#define WATCHDOG_HW_KEY_START     (0xCCCCU)
+
+/** @brief Largest reload value (12 bits). */
+#define WATCHDOG_HW_RELOAD_MAX    (0x0FFFU)
+
+/** @brief Largest prescaler setting (LSI/256). */
+#define WATCHDOG_HW_PR_MAX        (6U)
+
+/**
+ * @brief Poll limit for the prescaler/reload update.
+ *
+ * The update takes up to ~6 LSI cycles (~200 us); this bound is several
+ * ms even at 180 MHz.
+ */
+#define WATCHDOG_HW_WAIT_LOOPS    (200000U)
+
+/** @brief WatchdogHw_Start() has been called. */
+static bool s_running = false;
+
+/* ------------------------------------------------------------------------- */
+
+uint32_t WatchdogHw_Start(uint32_t timeout_ms)
+{
+    if (timeout_ms > WATCHDOG_HW_MAX_TIMEOUT_MS)
+    {
+        timeout_ms = WATCHDOG_HW_MAX_TIMEOUT_MS;
+    }
+    if (timeout_ms == 0U)
+    {
+        timeout_ms = 1U;
+    }
+
+    /* Counter ticks of the timeout at LSI/4, then halve per prescaler step. */
+    uint32_t ticks = (timeout_ms * (WATCHDOG_HW_LSI_HZ / 1000U)) / 4U;
+    uint32_t pr    = 0U;
+
+    while ((ticks > (WATCHDOG_HW_RELOAD_MAX + 1U)) && (pr < WATCHDOG_HW_PR_MAX))
+    {
+        ticks >>= 1U;
+        pr++;
+    }
+    if (ticks == 0U)
+    {
+        ticks = 1U;
+    }
+
+    /* Stop the counter while the core is halted by a debugger. */
+    DBGMCU->APB1FZ |= DBGMCU_APB1_FZ_DBG_IWDG_STOP;
+
+    IWDG->KR = WATCHDOG_HW_KEY_START;
+    IWDG->KR = WATCHDOG_HW_KEY_ACCESS;
+    IWDG->PR  = pr;
+    IWDG->RLR = ticks - 1U;
+
+    for (uint32_t i = 0U; (i < WATCHDOG_HW_WAIT_LOOPS) && (IWDG->SR != 0U); ++i)
+    {
+    }
+
+    IWDG->KR  = WATCHDOG_HW_KEY_RELOAD;
+    s_running = true;
+
+    return (ticks * (4UL << pr)) / (WATCHDOG_HW_LSI_HZ / 1000U);
+}
+
+void WatchdogHw_Refresh(void)
+{
+    IWDG->KR = WATCHDOG_HW_KEY_RELOAD;
+}
+
+bool WatchdogHw_IsRunning(void)
+{
+    return s_running;
+}
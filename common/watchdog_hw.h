@@ -0,0 +1,75 @@
+/**
+ * @file watchdog_hw.h
+ * @brief Hardware port of the independent watchdog (IWDG).
+ *
+ * The IWDG is clocked by the LSI and resets the MCU when its down-counter
+ * reaches zero. Once started it cannot be stopped, and on the F446 it
+ * keeps counting in STOP mode; it is frozen only while a debugger halts
+ * the core. watchdog_hw.c programs it at register level (the HAL IWDG
+ * module is not part of this project). The host simulation has its own
+ * port, which ends the run when the counter expires.
+ *
+ * Supervision (when to refresh) is the task manager's business; see
+ * AppTaskManager_StartWatchdog().
+ *
+ * @ingroup common
+ */
+
+#ifndef WATCHDOG_HW_H
+#define WATCHDOG_HW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup watchdog_hw Independent Watchdog
+ * @brief IWDG start and refresh.
+ * @ingroup common
+ * @{
+ */
+
+/** @brief Nominal LSI frequency in Hz (the RTC uses the same clock). */
+#define WATCHDOG_HW_LSI_HZ         (32000U)
+
+/** @brief Longest timeout: reload 4095 with LSI/256 (ms, nominal LSI). */
+#define WATCHDOG_HW_MAX_TIMEOUT_MS (32768U)
+
+/**
+ * @brief Start the watchdog with the shortest prescaler that reaches
+ *        @p timeout_ms.
+ *
+ * Calling it again while running only reprograms the timeout.
+ *
+ * @param timeout_ms Timeout, clamped to 1..@ref WATCHDOG_HW_MAX_TIMEOUT_MS.
+ *
+ * @return Programmed timeout in ms at the nominal LSI frequency.
+ */
+uint32_t WatchdogHw_Start(uint32_t timeout_ms);
+
+/**
+ * @brief Reload the down-counter.
+ *
+ * A single register write; safe from any context.
+ *
+ * @return None.
+ */
+void WatchdogHw_Refresh(void);
+
+/**
+ * @brief Whether WatchdogHw_Start() was called since reset.
+ *
+ * @return true if the watchdog is counting.
+ */
+bool WatchdogHw_IsRunning(void);
+
+/** @} */ /* end of watchdog_hw group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WATCHDOG_HW_H */
@@ -0,0 +1,257 @@
+/**
+ * @file clock_profile.c
+ * @brief Runtime clock profile switching.
+ *
+ * Switching sequence (every profile change):
+ * 1. Drain the console UART so no character is sent at the wrong baud rate.
+ * 2. Move SYSCLK to HSI, keeping the current flash latency.
+ * 3. Disable over-drive and the PLL (VOS may only change with the PLL off).
+ * 4. Set the regulator scale, start the oscillator and PLL for the target.
+ * 5. Enable over-drive if required, then switch SYSCLK with the target
+ *    latency (HAL_RCC_ClockConfig() orders latency and divider changes).
+ * 6. Stop HSE if it is no longer needed and update the UART divider.
+ *
+ * While the USB console runs, HSE stays on and feeds the PLL in every
+ * PLL profile: PLLSAI makes the 48 MHz USB clock from it and shares the
+ * PLL source selection with the main PLL.
+ *
+ * @ingroup clock_profile
+ */
+
+#include "clock_profile.h"
+#include "uart_tx.h"
+#include "telemetry_uart.h"
+#include "time_base.h"
+#include "sensor_adc.h"
+#include "sensor_sync.h"
+#include "status_led.h"
+#include "usb_cdc.h"
+#include "uplink_hw.h"
+#include "trace.h"
+#include "stm32f4xx_hal.h"
+
+/**
+ * @brief Static description of one clock tree.
+ */
+typedef struct
+{
+    const char *name;         /**< Short name for logs and the CLI.            */
+    bool        usePll;       /**< SYSCLK from PLL (true) or HSI (false).      */
+    bool        preferHse;    /**< PLL input from HSE, falling back to HSI.    */
+    uint32_t    pllN;         /**< PLL multiplier (VCO input is 1 MHz).        */
+    uint32_t    pllP;         /**< SYSCLK divider (RCC_PLLP_DIVx).             */
+    uint32_t    pllQ;         /**< 48 MHz domain divider.                      */
+    uint32_t    voltageScale; /**< PWR_REGULATOR_VOLTAGE_SCALEx.               */
+    bool        overDrive;    /**< Enable over-drive (needed above 168 MHz).   */
+    uint32_t    flashLatency; /**< FLASH_LATENCY_x for HCLK at 2.7-3.6 V.      */
+    uint32_t    apb1Divider;  /**< RCC_HCLK_DIVx for APB1 (max 45 MHz).        */
+    uint32_t    apb2Divider;  /**< RCC_HCLK_DIVx for APB2 (max 90 MHz).        */
+} ClockProfileConfig_t;
+
+/**
+ * @brief Profile table, indexed by @ref ClockProfile_t.
+ */
+static const ClockProfileConfig_t s_profiles[CLOCK_PROFILE_COUNT] =
+{
+    [CLOCK_PROFILE_LOW_POWER] =
+    {
+        .name = "LOW_POWER", .usePll = false, .preferHse = false,
+        .pllN = 0U, .pllP = 0U, .pllQ = 0U,
+        .voltageScale = PWR_REGULATOR_VOLTAGE_SCALE3, .overDrive = false,
+        .flashLatency = FLASH_LATENCY_0,
+        .apb1Divider = RCC_HCLK_DIV2, .apb2Divider = RCC_HCLK_DIV1
+    },
+    [CLOCK_PROFILE_BALANCED] =
+    {
+        /* 1 MHz * 336 / 4 = 84 MHz, 336 / 7 = 48 MHz. */
+        .name = "BALANCED", .usePll = true, .preferHse = false,
+        .pllN = 336U, .pllP = RCC_PLLP_DIV4, .pllQ = 7U,
+        .voltageScale = PWR_REGULATOR_VOLTAGE_SCALE3, .overDrive = false,
+        .flashLatency = FLASH_LATENCY_2,
+        .apb1Divider = RCC_HCLK_DIV2, .apb2Divider = RCC_HCLK_DIV1
+    },
+    [CLOCK_PROFILE_MAX] =
+    {
+        /* 1 MHz * 360 / 2 = 180 MHz. */
+        .name = "MAX", .usePll = true, .preferHse = true,
+        .pllN = 360U, .pllP = RCC_PLLP_DIV2, .pllQ = 8U,
+        .voltageScale = PWR_REGULATOR_VOLTAGE_SCALE1, .overDrive = true,
+        .flashLatency = FLASH_LATENCY_5,
+        .apb1Divider = RCC_HCLK_DIV4, .apb2Divider = RCC_HCLK_DIV2
+    }
+};
+
+/**
+ * @brief Profile currently applied (SystemClock_Config() boots LOW_POWER).
+ */
+static ClockProfile_t s_currentProfile = CLOCK_PROFILE_LOW_POWER;
+
+/**
+ * @brief Start the PLL for @p cfg from @p source (HSE or HSI).
+ *
+ * @return HAL status of the oscillator configuration.
+ */
+static HAL_StatusTypeDef ClockProfile_StartPll(const ClockProfileConfig_t *cfg, uint32_t source);
+
+/* ------------------------------------------------------------------------- */
+
+bool ClockProfile_Apply(ClockProfile_t profile)
+{
+    if (profile >= CLOCK_PROFILE_COUNT)
+    {
+        return false;
+    }
+
+    if (profile == s_currentProfile)
+    {
+        return true;
+    }
+
+    const ClockProfileConfig_t *cfg = &s_profiles[profile];
+    RCC_ClkInitTypeDef clk = {0};
+    RCC_OscInitTypeDef osc = {0};
+
+    /* 1. No output may be in flight while the baud clock changes. */
+    UartTx_Flush();
+    while (!UartTx_IsIdle() || !TelemetryUart_IsIdle())
+    {
+    }
+
+    /* 2. Run from HSI while the PLL is reprogrammed. */
+    clk.ClockType      = RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_HCLK |
+                         RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+    clk.SYSCLKSource   = RCC_SYSCLKSOURCE_HSI;
+    clk.AHBCLKDivider  = RCC_SYSCLK_DIV1;
+    clk.APB1CLKDivider = RCC_HCLK_DIV1;
+    clk.APB2CLKDivider = RCC_HCLK_DIV1;
+    if (HAL_RCC_ClockConfig(&clk, __HAL_FLASH_GET_LATENCY()) != HAL_OK)
+    {
+        return false;
+    }
+
+    /* 3. Over-drive and PLL off. */
+    if ((PWR->CR & PWR_CR_ODEN) != 0U)
+    {
+        (void)HAL_PWREx_DisableOverDrive();
+    }
+
+    osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+    osc.PLL.PLLState   = RCC_PLL_OFF;
+    if (HAL_RCC_OscConfig(&osc) != HAL_OK)
+    {
+        return false;
+    }
+
+    /* 4. Regulator scale, then oscillator and PLL. */
+    __HAL_RCC_PWR_CLK_ENABLE();
+    __HAL_PWR_VOLTAGESCALING_CONFIG(cfg->voltageScale);
+
+    bool usbClock  = UsbCdc_IsClocked();
+    bool hseNeeded = usbClock;
+    if (cfg->usePll)
+    {
+        HAL_StatusTypeDef status = HAL_ERROR;
+
+        if (cfg->preferHse || usbClock)
+        {
+            status    = ClockProfile_StartPll(cfg, RCC_PLLSOURCE_HSE);
+            hseNeeded = usbClock || (status == HAL_OK);
+        }
+
+        if (status != HAL_OK)
+        {
+            status = ClockProfile_StartPll(cfg, RCC_PLLSOURCE_HSI);
+        }
+
+        if (status != HAL_OK)
+        {
+            return false;
+        }
+
+        /* 5. Over-drive must be enabled before SYSCLK moves to the PLL. */
+        if (cfg->overDrive && (HAL_PWREx_EnableOverDrive() != HAL_OK))
+        {
+            return false;
+        }
+    }
+
+    clk.SYSCLKSource   = cfg->usePll ? RCC_SYSCLKSOURCE_PLLCLK : RCC_SYSCLKSOURCE_HSI;
+    clk.APB1CLKDivider = cfg->apb1Divider;
+    clk.APB2CLKDivider = cfg->apb2Divider;
+    if (HAL_RCC_ClockConfig(&clk, cfg->flashLatency) != HAL_OK)
+    {
+        return false;
+    }
+
+    /* 6. Release HSE if unused, make sure ART is on, fix the baud rate. */
+    if (!hseNeeded && ((RCC->CR & RCC_CR_HSEON) != 0U))
+    {
+        osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+        osc.HSEState       = RCC_HSE_OFF;
+        osc.PLL.PLLState   = RCC_PLL_NONE;
+        (void)HAL_RCC_OscConfig(&osc);
+    }
+
+    __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+    __HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+    __HAL_FLASH_DATA_CACHE_ENABLE();
+
+    UartTx_UpdateBaudRate();
+    TelemetryUart_UpdateBaudRate();
+    Time_OnClockChange();
+    SensorAdc_OnClockChange();
+    SensorSync_OnClockChange();
+    StatusLed_OnClockChange();
+    UsbCdc_OnClockChange();
+    UplinkHw_OnClockChange();
+    TRACE_CLOCK();
+
+    s_currentProfile = profile;
+    return true;
+}
+
+ClockProfile_t ClockProfile_GetCurrent(void)
+{
+    return s_currentProfile;
+}
+
+const char *ClockProfile_GetName(ClockProfile_t profile)
+{
+    if (profile >= CLOCK_PROFILE_COUNT)
+    {
+        return "?";
+    }
+
+    return s_profiles[profile].name;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static HAL_StatusTypeDef ClockProfile_StartPll(const ClockProfileConfig_t *cfg, uint32_t source)
+{
+    RCC_OscInitTypeDef osc = {0};
+
+    if (source == RCC_PLLSOURCE_HSE)
+    {
+        /* Nucleo-64: 8 MHz from the ST-LINK MCO on OSC_IN. */
+        osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+        osc.HSEState       = RCC_HSE_BYPASS;
+        osc.PLL.PLLM       = HSE_VALUE / 1000000U;
+    }
+    else
+    {
+        osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+        osc.PLL.PLLM       = HSI_VALUE / 1000000U;
+    }
+
+    osc.PLL.PLLState  = RCC_PLL_ON;
+    osc.PLL.PLLSource = source;
+    osc.PLL.PLLN      = cfg->pllN;
+    osc.PLL.PLLP      = cfg->pllP;
+    osc.PLL.PLLQ      = cfg->pllQ;
+    osc.PLL.PLLR      = 2U;
+
+    return HAL_RCC_OscConfig(&osc);
+}
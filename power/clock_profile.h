@@ -0,0 +1,85 @@
+/**
+ * @file clock_profile.h
+ * @brief Selectable system clock profiles.
+ *
+ * The board boots on the 16 MHz HSI configured by SystemClock_Config().
+ * This module switches between a small set of complete clock trees at
+ * runtime (oscillator, PLL, regulator scale, over-drive, flash latency
+ * and bus prescalers), and keeps the HAL tick and console UART baud rate
+ * correct across the switch.
+ *
+ * @ingroup power
+ */
+
+#ifndef CLOCK_PROFILE_H
+#define CLOCK_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup clock_profile Clock Profiles
+ * @brief Runtime selection of SYSCLK/PLL configurations.
+ * @ingroup power
+ * @{
+ */
+
+/**
+ * @brief Available clock profiles.
+ */
+typedef enum
+{
+    CLOCK_PROFILE_LOW_POWER = 0U, /**< HSI 16 MHz, no PLL, scale 3, 0 WS.          */
+    CLOCK_PROFILE_BALANCED,       /**< HSI + PLL 84 MHz, scale 3, 2 WS.            */
+    CLOCK_PROFILE_MAX,            /**< HSE (or HSI) + PLL 180 MHz, over-drive, 5 WS. */
+    CLOCK_PROFILE_COUNT           /**< Number of profiles (not a valid profile).   */
+} ClockProfile_t;
+
+/**
+ * @brief Switch the system clock to @p profile.
+ *
+ * Waits for the console UART to finish transmitting, moves SYSCLK to HSI
+ * while the PLL and regulator are reconfigured, then switches to the new
+ * tree. HAL_RCC_ClockConfig() updates SystemCoreClock and the SysTick
+ * reload; the UART baud rate divider is recomputed afterwards.
+ *
+ * The MAX profile uses the 8 MHz ST-LINK MCO on HSE bypass and falls back
+ * to HSI as PLL input if HSE does not start.
+ *
+ * Must be called from thread mode with interrupts enabled.
+ *
+ * @param profile Profile to apply.
+ *
+ * @return true on success; false if the profile is invalid or the RCC
+ *         rejected the configuration (the previous profile is kept running
+ *         from HSI in that case).
+ */
+bool ClockProfile_Apply(ClockProfile_t profile);
+
+/**
+ * @brief Get the profile currently in use.
+ *
+ * @return Active clock profile.
+ */
+ClockProfile_t ClockProfile_GetCurrent(void);
+
+/**
+ * @brief Get a short human-readable name for a profile.
+ *
+ * @param profile Profile to describe.
+ *
+ * @return Static string such as "MAX", or "?" for invalid values.
+ */
+const char *ClockProfile_GetName(ClockProfile_t profile);
+
+/** @} */ /* end of clock_profile group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_PROFILE_H */
@@ -0,0 +1,273 @@
+/**
+ * @file periph_power.c
+ * @brief Peripheral clock domains: use counts, gating and the CLI view.
+ *
+ * The RCC registers are the state: a domain is gated when its ENR bit is
+ * clear, whoever cleared or set it. HAL code that enables a clock by
+ * itself (e.g. HAL_GPIO_Init() and SYSCFG) therefore never leaves the use
+ * counts and the hardware out of step. On the F4 the LPENR bit of each
+ * peripheral sits at the same position as its ENR bit.
+ *
+ * @ingroup periph_power
+ */
+
+#include "periph_power.h"
+#include "cli.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/**
+ * @brief Static description of one clock domain.
+ */
+typedef struct
+{
+    const char        *name;       /**< Peripheral name.                      */
+    volatile uint32_t *enr;        /**< RCC clock enable register.            */
+    volatile uint32_t *lpenr;      /**< RCC SLEEP-mode clock enable register. */
+    uint32_t           bit;        /**< Enable bit in both registers.         */
+    bool               wakeNeeded; /**< Must keep running in SLEEP when used. */
+    bool               stopBlocks; /**< Referenced, keeps the MCU out of STOP. */
+} PeriphPowerDomain_t;
+
+/**
+ * @brief Runtime counters of one clock domain.
+ */
+typedef struct
+{
+    uint32_t refs;     /**< Current references.              */
+    uint32_t gates;    /**< Clock switched off.              */
+    uint32_t restores; /**< Gated clock switched back on.    */
+} PeriphPowerState_t;
+
+/**
+ * @brief Clock domains, indexed by @ref PeriphPowerId_t.
+ *
+ * DMA1, USART2 and TIM5 keep running in SLEEP: the console receives by
+ * DMA and the time base counts while the core waits. The ADC scan chain
+ * (TIM2, ADC1, DMA2) and the sync trigger (TIM3) do too while referenced,
+ * and so do OTG FS, which answers the host from WFI, and the modem and
+ * telemetry UARTs (USART6, USART1), and the status LED timer (TIM8),
+ * which blinks LD2 while the core sleeps. GPIOA keeps the UART pins and
+ * LD2 clocked. Everything else stops in WFI.
+ *
+ * STOP halts every clock. The ADC scan chain and the sync trigger would
+ * lose conversions or edges, so while they are referenced the idle
+ * governor does not choose STOP. The UARTs, the buses, USB (a host
+ * session) and the status LED are checked by their own idle tests
+ * instead, and the time base is corrected after the wake.
+ */
+static const PeriphPowerDomain_t s_domains[PERIPH_POWER_COUNT] =
+{
+    [PERIPH_POWER_GPIOA]   = { "GPIOA",   &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_GPIOAEN,   true,  false },
+    [PERIPH_POWER_GPIOB]   = { "GPIOB",   &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_GPIOBEN,   true,  false },
+    [PERIPH_POWER_GPIOC]   = { "GPIOC",   &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_GPIOCEN,   false, false },
+    [PERIPH_POWER_GPIOH]   = { "GPIOH",   &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_GPIOHEN,   false, false },
+    [PERIPH_POWER_DMA1]    = { "DMA1",    &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_DMA1EN,    true,  false },
+    [PERIPH_POWER_USART2]  = { "USART2",  &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_USART2EN,  true,  false },
+    [PERIPH_POWER_TIM5]    = { "TIM5",    &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_TIM5EN,    true,  false },
+    [PERIPH_POWER_SYSCFG]  = { "SYSCFG",  &RCC->APB2ENR, &RCC->APB2LPENR, RCC_APB2ENR_SYSCFGEN,  false, false },
+    [PERIPH_POWER_BKPSRAM] = { "BKPSRAM", &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_BKPSRAMEN, false, false },
+    [PERIPH_POWER_DMA2]    = { "DMA2",    &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_DMA2EN,    true,  false },
+    [PERIPH_POWER_TIM2]    = { "TIM2",    &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_TIM2EN,    true,  true  },
+    [PERIPH_POWER_ADC1]    = { "ADC1",    &RCC->APB2ENR, &RCC->APB2LPENR, RCC_APB2ENR_ADC1EN,    true,  true  },
+    [PERIPH_POWER_TIM3]    = { "TIM3",    &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_TIM3EN,    true,  true  },
+    [PERIPH_POWER_I2C1]    = { "I2C1",    &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_I2C1EN,    true,  false },
+    [PERIPH_POWER_SPI2]    = { "SPI2",    &RCC->APB1ENR, &RCC->APB1LPENR, RCC_APB1ENR_SPI2EN,    true,  false },
+    [PERIPH_POWER_OTGFS]   = { "OTGFS",   &RCC->AHB2ENR, &RCC->AHB2LPENR, RCC_AHB2ENR_OTGFSEN,   true,  false },
+    [PERIPH_POWER_USART6]  = { "USART6",  &RCC->APB2ENR, &RCC->APB2LPENR, RCC_APB2ENR_USART6EN,  true,  false },
+    [PERIPH_POWER_USART1]  = { "USART1",  &RCC->APB2ENR, &RCC->APB2LPENR, RCC_APB2ENR_USART1EN,  true,  false },
+    [PERIPH_POWER_CRC]     = { "CRC",     &RCC->AHB1ENR, &RCC->AHB1LPENR, RCC_AHB1ENR_CRCEN,     false, false },
+    [PERIPH_POWER_TIM8]    = { "TIM8",    &RCC->APB2ENR, &RCC->APB2LPENR, RCC_APB2ENR_TIM8EN,    true,  false }
+};
+
+/**
+ * @brief Use counts and counters; zero-initialized, so usable before init.
+ */
+static PeriphPowerState_t s_state[PERIPH_POWER_COUNT];
+
+/**
+ * @brief Set outside POWER_MODE_ACTIVE: unused clocks are gated.
+ */
+static bool s_gating = false;
+
+/**
+ * @brief Switch the clock of @p id off. Interrupts must be masked.
+ */
+static void PeriphPower_Gate(PeriphPowerId_t id);
+
+/**
+ * @brief Set the SLEEP-mode clock of @p id for the current policy.
+ *        Interrupts must be masked.
+ */
+static void PeriphPower_UpdateSleepClock(PeriphPowerId_t id);
+
+/**
+ * @brief CLI "periph" handler.
+ */
+static void PeriphPower_CmdPeriph(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void PeriphPower_Init(void)
+{
+    (void)CLI_RegisterCommand("periph", PeriphPower_CmdPeriph,
+                              "- Show peripheral clock domains and use counts");
+}
+
+void PeriphPower_Acquire(PeriphPowerId_t id)
+{
+    if (id >= PERIPH_POWER_COUNT)
+    {
+        return;
+    }
+
+    const PeriphPowerDomain_t *domain = &s_domains[id];
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_state[id].refs++;
+
+    if ((*domain->enr & domain->bit) == 0U)
+    {
+        *domain->enr |= domain->bit;
+        /* Read back: the clock needs two bus cycles before first access. */
+        (void)*domain->enr;
+        s_state[id].restores++;
+    }
+
+    PeriphPower_UpdateSleepClock(id);
+
+    __set_PRIMASK(primask);
+}
+
+void PeriphPower_Release(PeriphPowerId_t id)
+{
+    if (id >= PERIPH_POWER_COUNT)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (s_state[id].refs > 0U)
+    {
+        s_state[id].refs--;
+    }
+
+    if (s_gating && (s_state[id].refs == 0U))
+    {
+        PeriphPower_Gate(id);
+    }
+
+    PeriphPower_UpdateSleepClock(id);
+
+    __set_PRIMASK(primask);
+}
+
+void PeriphPower_ApplyMode(PowerMode_t mode)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_gating = (mode != POWER_MODE_ACTIVE);
+
+    for (uint32_t i = 0U; i < PERIPH_POWER_COUNT; ++i)
+    {
+        if (s_gating && (s_state[i].refs == 0U))
+        {
+            PeriphPower_Gate((PeriphPowerId_t)i);
+        }
+
+        PeriphPower_UpdateSleepClock((PeriphPowerId_t)i);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+bool PeriphPower_IsStopBlocked(void)
+{
+    for (uint32_t i = 0U; i < PERIPH_POWER_COUNT; ++i)
+    {
+        if (s_domains[i].stopBlocks && (s_state[i].refs > 0U))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PeriphPower_GetInfo(PeriphPowerId_t id, PeriphPowerInfo_t *info)
+{
+    if ((id >= PERIPH_POWER_COUNT) || (info == NULL))
+    {
+        return false;
+    }
+
+    const PeriphPowerDomain_t *domain = &s_domains[id];
+
+    info->name       = domain->name;
+    info->refs       = s_state[id].refs;
+    info->clockOn    = (*domain->enr & domain->bit) != 0U;
+    info->sleepClock = (*domain->lpenr & domain->bit) != 0U;
+    info->wakeNeeded = domain->wakeNeeded;
+    info->gates      = s_state[id].gates;
+    info->restores   = s_state[id].restores;
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void PeriphPower_Gate(PeriphPowerId_t id)
+{
+    const PeriphPowerDomain_t *domain = &s_domains[id];
+
+    if ((*domain->enr & domain->bit) != 0U)
+    {
+        *domain->enr &= ~domain->bit;
+        s_state[id].gates++;
+    }
+}
+
+static void PeriphPower_UpdateSleepClock(PeriphPowerId_t id)
+{
+    const PeriphPowerDomain_t *domain = &s_domains[id];
+
+    bool run = !s_gating || (domain->wakeNeeded && (s_state[id].refs > 0U));
+
+    if (run)
+    {
+        *domain->lpenr |= domain->bit;
+    }
+    else
+    {
+        *domain->lpenr &= ~domain->bit;
+    }
+}
+
+static void PeriphPower_CmdPeriph(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    CLI_Print("\r\nPeripheral clocks (gating %s):\r\n", s_gating ? "ON" : "OFF");
+    CLI_Print("  %-8s %5s %-5s %-5s %8s %8s\r\n",
+              "name", "refs", "clock", "sleep", "gates", "restores");
+
+    for (uint32_t i = 0U; i < PERIPH_POWER_COUNT; ++i)
+    {
+        PeriphPowerInfo_t info;
+        (void)PeriphPower_GetInfo((PeriphPowerId_t)i, &info);
+
+        CLI_Print("  %-8s %5lu %-5s %-5s %8lu %8lu\r\n",
+                  info.name,
+                  (unsigned long)info.refs,
+                  info.clockOn ? "on" : "off",
+                  info.sleepClock ? "on" : "off",
+                  (unsigned long)info.gates,
+                  (unsigned long)info.restores);
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * @file periph_power.h
+ * @brief Reference-counted peripheral clock gating tied to the power modes.
+ *
+ * Each peripheral clock the firmware enables is a domain here. Drivers
+ * take a reference with PeriphPower_Acquire() while they use a peripheral
+ * and drop it with PeriphPower_Release(); the power manager calls
+ * PeriphPower_ApplyMode() on every mode change.
+ *
+ * Outside POWER_MODE_ACTIVE:
+ * - domains without references have their clock switched off (RCC ENR),
+ *   and a domain whose last reference is released is switched off at once;
+ * - domains not flagged as needed in sleep have their SLEEP-mode clock
+ *   switched off (RCC LPENR), so it stops while the core waits in WFI.
+ *
+ * A gated clock is switched back on by the next PeriphPower_Acquire(), in
+ * any mode. Back in ACTIVE all SLEEP-mode clocks are enabled again, but
+ * gated domains stay off until they are used.
+ *
+ * EXTI edge detection does not need the GPIO or SYSCFG clocks, so the
+ * button and the UART RX wake line keep working with those gated.
+ *
+ * @ingroup power
+ */
+
+#ifndef PERIPH_POWER_H
+#define PERIPH_POWER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "power_manager.h"
+
+/**
+ * @defgroup periph_power Peripheral Clock Gating
+ * @brief Per-peripheral clock domains with use counts.
+ * @ingroup power
+ * @{
+ */
+
+/**
+ * @brief Peripheral clock domains of this board.
+ *
+ * Add a domain here, and its RCC bit in periph_power.c, when a driver
+ * for a new peripheral (I2C, SPI, another timer) is added.
+ */
+typedef enum
+{
+    PERIPH_POWER_GPIOA = 0U, /**< Console and telemetry UART pins, LD2. */
+    PERIPH_POWER_GPIOB,      /**< I2C1 and SPI2 pins, SPI chip selects. */
+    PERIPH_POWER_GPIOC,      /**< B1 (EXTI only), modem UART pins.      */
+    PERIPH_POWER_GPIOH,      /**< OSC_IN/OSC_OUT (no GPIO use).         */
+    PERIPH_POWER_DMA1,       /**< Console UART RX/TX streams.           */
+    PERIPH_POWER_USART2,     /**< Console UART.                         */
+    PERIPH_POWER_TIM5,       /**< Microsecond time base.                */
+    PERIPH_POWER_SYSCFG,     /**< EXTI line mapping (configuration only). */
+    PERIPH_POWER_BKPSRAM,    /**< Crash trace, STANDBY buffer.          */
+    PERIPH_POWER_DMA2,       /**< ADC scan, modem and telemetry UARTs.  */
+    PERIPH_POWER_TIM2,       /**< ADC scan trigger.                     */
+    PERIPH_POWER_ADC1,       /**< On-chip ADC sensors.                  */
+    PERIPH_POWER_TIM3,       /**< Sync group trigger.                   */
+    PERIPH_POWER_I2C1,       /**< Shared I2C bus.                       */
+    PERIPH_POWER_SPI2,       /**< Shared SPI bus.                       */
+    PERIPH_POWER_OTGFS,      /**< USB CDC console.                      */
+    PERIPH_POWER_USART6,     /**< Uplink modem UART.                    */
+    PERIPH_POWER_USART1,     /**< Telemetry UART.                       */
+    PERIPH_POWER_CRC,        /**< CRC unit (Crc32_Compute()).           */
+    PERIPH_POWER_TIM8,       /**< Status LED PWM (LD2).                 */
+    PERIPH_POWER_COUNT       /**< Number of domains (not a valid id).   */
+} PeriphPowerId_t;
+
+/**
+ * @brief State of one domain, for the "periph" command.
+ */
+typedef struct
+{
+    const char *name;       /**< Peripheral name.                           */
+    uint32_t    refs;       /**< Current references.                        */
+    bool        clockOn;    /**< Clock enabled (RCC ENR).                   */
+    bool        sleepClock; /**< Clock runs in SLEEP (RCC LPENR).           */
+    bool        wakeNeeded; /**< Kept clocked in SLEEP while referenced.    */
+    uint32_t    gates;      /**< Times the clock was switched off.          */
+    uint32_t    restores;   /**< Times a gated clock was switched back on.  */
+} PeriphPowerInfo_t;
+
+/**
+ * @brief Register the "periph" CLI command.
+ *
+ * Domains need no initialization: PeriphPower_Acquire() may be called
+ * before this, e.g. from the HAL MSP callbacks.
+ *
+ * @return None.
+ */
+void PeriphPower_Init(void);
+
+/**
+ * @brief Take a reference on a domain and make sure its clock is on.
+ *
+ * Safe from any context.
+ *
+ * @param id Domain.
+ *
+ * @return None.
+ */
+void PeriphPower_Acquire(PeriphPowerId_t id);
+
+/**
+ * @brief Drop a reference; gates the clock if it was the last one and
+ *        the system is not in POWER_MODE_ACTIVE.
+ *
+ * Safe from any context.
+ *
+ * @param id Domain.
+ *
+ * @return None.
+ */
+void PeriphPower_Release(PeriphPowerId_t id);
+
+/**
+ * @brief Apply the gating policy of a power mode.
+ *
+ * Called by PowerManager_Update() on each mode change.
+ *
+ * @param mode Power mode being entered.
+ *
+ * @return None.
+ */
+void PeriphPower_ApplyMode(PowerMode_t mode);
+
+/**
+ * @brief Check whether a peripheral that stops in STOP is in use.
+ *
+ * True while the ADC scan chain or the sync trigger holds a reference;
+ * the idle governor then keeps to SLEEP. Safe from any
+ * context.
+ *
+ * @return true if STOP must not be entered.
+ */
+bool PeriphPower_IsStopBlocked(void);
+
+/**
+ * @brief Get the state of a domain.
+ *
+ * @param id         Domain.
+ * @param[out] info  Destination. Must not be NULL.
+ *
+ * @return false if @p id is not a valid domain.
+ */
+bool PeriphPower_GetInfo(PeriphPowerId_t id, PeriphPowerInfo_t *info);
+
+/** @} */ /* end of periph_power group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PERIPH_POWER_H */
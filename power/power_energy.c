@@ -0,0 +1,616 @@
+/**
+ * @file power_energy.c
+ * @brief Energy accounting: interval bookkeeping, CLI and telemetry.
+ *
+ * One interval is open at any time, described by the power mode, clock
+ * profile, core clock and core state it started with. PowerEnergy_Enter()
+ * closes it into the bins and opens the next; the bins are only summed
+ * into mAh when they are reported.
+ *
+ * Energy telemetry frames (type @ref POWER_ENERGY_FRAME_TYPE) carry
+ * fixed-size records, one per bin:
+ *
+ *     kind:u8 id:u8 time_ms:u32 charge_uAh:u32
+ *
+ * @ingroup power_energy
+ */
+
+#include "power_energy.h"
+#include "app_config.h"
+#include "app_task_manager.h"
+#include "time_base.h"
+#include "telemetry.h"
+#include "cli.h"
+#include "fmt.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/** @brief Record kind: power mode (id = PowerMode_t). */
+#define POWER_ENERGY_KIND_MODE       (0U)
+
+/** @brief Record kind: running on a clock profile (id = ClockProfile_t). */
+#define POWER_ENERGY_KIND_RUN        (1U)
+
+/** @brief Record kind: SLEEP on a clock profile (id = ClockProfile_t). */
+#define POWER_ENERGY_KIND_SLEEP      (2U)
+
+/** @brief Record kind: STOP (id = 0). */
+#define POWER_ENERGY_KIND_STOP       (3U)
+
+/**
+ * @brief Record kind: task (id = the task's event trace id, in
+ *        registration order, event tasks after the periodic ones).
+ */
+#define POWER_ENERGY_KIND_TASK       (4U)
+
+/** @brief Size of one telemetry record. */
+#define POWER_ENERGY_RECORD_SIZE     (10U)
+
+/** @brief Run current per clock profile (uA). */
+static const uint32_t s_runUa[CLOCK_PROFILE_COUNT] =
+{
+    [CLOCK_PROFILE_LOW_POWER] = POWER_ENERGY_RUN_UA_LOW_POWER,
+    [CLOCK_PROFILE_BALANCED]  = POWER_ENERGY_RUN_UA_BALANCED,
+    [CLOCK_PROFILE_MAX]       = POWER_ENERGY_RUN_UA_MAX
+};
+
+/** @brief SLEEP current per clock profile (uA). */
+static const uint32_t s_sleepUa[CLOCK_PROFILE_COUNT] =
+{
+    [CLOCK_PROFILE_LOW_POWER] = POWER_ENERGY_SLEEP_UA_LOW_POWER,
+    [CLOCK_PROFILE_BALANCED]  = POWER_ENERGY_SLEEP_UA_BALANCED,
+    [CLOCK_PROFILE_MAX]       = POWER_ENERGY_SLEEP_UA_MAX
+};
+
+/** @brief Power mode names for the CLI tables. */
+static const char *const s_modeNames[POWER_MODE_COUNT] =
+{
+    "ACTIVE", "IDLE", "SLEEP", "STOP"
+};
+
+/** @brief Closed intervals. */
+static PowerEnergyTotals_t s_totals;
+
+/** @brief Start of the open interval (time base us). */
+static uint64_t s_start_us = 0U;
+
+/** @brief Power mode of the open interval. */
+static PowerMode_t s_mode = POWER_MODE_ACTIVE;
+
+/** @brief Clock profile of the open interval. */
+static ClockProfile_t s_profile = CLOCK_PROFILE_LOW_POWER;
+
+/** @brief Core state of the open interval. */
+static PowerEnergyState_t s_state = POWER_ENERGY_RUN;
+
+/** @brief Core clock of the open interval, in MHz. */
+static uint32_t s_clockMhz = 0U;
+
+/** @brief HAL tick of the last energy telemetry frame. */
+static uint32_t s_lastSent_ms = 0U;
+
+/**
+ * @brief Close the open interval into @p totals at @p now_us.
+ *
+ * Must be called with interrupts masked.
+ */
+static void PowerEnergy_Close(PowerEnergyTotals_t *totals, uint64_t now_us);
+
+/**
+ * @brief Add @p time_us at @p current_uA to a bin.
+ */
+static void PowerEnergy_AddBin(PowerEnergyBin_t *bin, uint64_t time_us, uint32_t current_uA);
+
+/**
+ * @brief Convert a charge to uAh.
+ */
+static uint32_t PowerEnergy_MicroAh(const PowerEnergyBin_t *bin);
+
+/**
+ * @brief Convert a charge to mAh, for printing.
+ */
+static float PowerEnergy_MilliAh(const PowerEnergyBin_t *bin);
+
+/**
+ * @brief Append one telemetry record; false if the payload is full.
+ */
+static bool PowerEnergy_PutRecord(uint8_t *payload, size_t *len, uint8_t kind, uint8_t id,
+                                  const PowerEnergyBin_t *bin);
+
+/**
+ * @brief Print one table row of the "power stats" output.
+ */
+static void PowerEnergy_PrintRow(const char *name, const PowerEnergyBin_t *bin,
+                                 const PowerEnergyBin_t *total);
+
+/**
+ * @brief Print one row of the "power trans" output, with its histogram.
+ */
+static void PowerEnergy_PrintTransition(const char *name, const PowerTransitionStats_t *stats);
+
+/**
+ * @brief Print the "power trans" output.
+ */
+static void PowerEnergy_PrintTransitions(void);
+
+/**
+ * @brief CLI "power [stats|trans|reset]" handler.
+ */
+static void PowerEnergy_CmdPower(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void PowerEnergy_Init(PowerMode_t mode)
+{
+    (void)memset(&s_totals, 0, sizeof(s_totals));
+
+    s_start_us    = Time_NowUs();
+    s_mode        = mode;
+    s_profile     = ClockProfile_GetCurrent();
+    s_state       = POWER_ENERGY_RUN;
+    s_clockMhz    = SystemCoreClock / 1000000U;
+    s_lastSent_ms = HAL_GetTick();
+
+    (void)CLI_RegisterCommand("power", PowerEnergy_CmdPower,
+                              "[stats|trans|reset] - Energy estimate per mode, clock and task;\n"
+                              "transition costs and idle state break-even");
+}
+
+void PowerEnergy_Enter(PowerMode_t mode, PowerEnergyState_t state)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    PowerEnergy_Close(&s_totals, Time_NowUs());
+
+    s_mode     = mode;
+    s_profile  = ClockProfile_GetCurrent();
+    s_state    = state;
+    s_clockMhz = SystemCoreClock / 1000000U;
+
+    __set_PRIMASK(primask);
+}
+
+void PowerEnergy_GetTotals(PowerEnergyTotals_t *totals)
+{
+    if (totals == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    /* Close the open interval into the copy only. */
+    uint64_t start_us = s_start_us;
+    *totals = s_totals;
+    PowerEnergy_Close(totals, Time_NowUs());
+    s_start_us = start_us;
+
+    __set_PRIMASK(primask);
+}
+
+void PowerEnergy_Reset(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    (void)memset(&s_totals, 0, sizeof(s_totals));
+    s_start_us = Time_NowUs();
+
+    __set_PRIMASK(primask);
+
+    /* The task shares are split by cycles counted from the same point. */
+    AppTaskManager_ResetStats();
+}
+
+uint32_t PowerEnergy_GetCurrentUa(PowerEnergyState_t state, ClockProfile_t profile)
+{
+    if (state == POWER_ENERGY_STOP)
+    {
+        return POWER_ENERGY_STOP_UA;
+    }
+
+    if (state == POWER_ENERGY_STOP_MAIN)
+    {
+        return POWER_ENERGY_STOP_MAIN_UA;
+    }
+
+    if ((uint32_t)profile >= CLOCK_PROFILE_COUNT)
+    {
+        return 0U;
+    }
+
+    return (state == POWER_ENERGY_RUN) ? s_runUa[profile] : s_sleepUa[profile];
+}
+
+void PowerEnergy_TaskShare(const PowerEnergyTotals_t *totals, uint64_t cycles,
+                           PowerEnergyBin_t *share)
+{
+    if ((totals == NULL) || (share == NULL))
+    {
+        return;
+    }
+
+    PowerEnergyBin_t run = { 0U, 0U };
+    for (uint32_t p = 0U; p < CLOCK_PROFILE_COUNT; ++p)
+    {
+        run.time_us     += totals->profileRun[p].time_us;
+        run.charge_uAus += totals->profileRun[p].charge_uAus;
+    }
+
+    if ((totals->runCycles == 0U) || (cycles == 0U))
+    {
+        share->time_us     = 0U;
+        share->charge_uAus = 0U;
+        return;
+    }
+
+    float fraction = (float)cycles / (float)totals->runCycles;
+    if (fraction > 1.0f)
+    {
+        fraction = 1.0f;
+    }
+
+    share->time_us     = (uint64_t)((float)run.time_us * fraction);
+    share->charge_uAus = (uint64_t)((float)run.charge_uAus * fraction);
+}
+
+void PowerEnergy_Service(uint32_t now_ms)
+{
+    if (!Telemetry_IsEnabled() || ((now_ms - s_lastSent_ms) < POWER_ENERGY_TELEMETRY_MS))
+    {
+        return;
+    }
+
+    static uint8_t s_payload[TELEMETRY_MAX_PAYLOAD];
+
+    PowerEnergyTotals_t totals;
+    PowerEnergyBin_t    share;
+    size_t              len = 0U;
+
+    PowerEnergy_GetTotals(&totals);
+
+    for (uint32_t m = 0U; m < POWER_MODE_COUNT; ++m)
+    {
+        (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_MODE, (uint8_t)m,
+                                    &totals.mode[m]);
+    }
+
+    for (uint32_t p = 0U; p < CLOCK_PROFILE_COUNT; ++p)
+    {
+        (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_RUN, (uint8_t)p,
+                                    &totals.profileRun[p]);
+        (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_SLEEP, (uint8_t)p,
+                                    &totals.profileSleep[p]);
+    }
+
+    (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_STOP, 0U, &totals.stop);
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        const AppTaskDescriptor_t *task = AppTaskManager_GetTask(i);
+
+        PowerEnergy_TaskShare(&totals, task->stats.totalCycles, &share);
+        (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_TASK, task->traceId,
+                                    &share);
+    }
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetEventTaskCount(); ++i)
+    {
+        const AppEventTask_t *task = AppTaskManager_GetEventTask(i);
+
+        PowerEnergy_TaskShare(&totals, task->stats.totalCycles, &share);
+        (void)PowerEnergy_PutRecord(s_payload, &len, POWER_ENERGY_KIND_TASK, task->traceId,
+                                    &share);
+    }
+
+    /* Retry on the next call if the TX ring is full. */
+    if (Telemetry_SendFrame(POWER_ENERGY_FRAME_TYPE, len / POWER_ENERGY_RECORD_SIZE, now_ms,
+                            s_payload, len))
+    {
+        s_lastSent_ms = now_ms;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void PowerEnergy_Close(PowerEnergyTotals_t *totals, uint64_t now_us)
+{
+    uint64_t time_us = now_us - s_start_us;
+    uint32_t current_uA;
+
+    switch (s_state)
+    {
+        case POWER_ENERGY_RUN:
+            current_uA = s_runUa[s_profile];
+            PowerEnergy_AddBin(&totals->profileRun[s_profile], time_us, current_uA);
+            totals->runCycles += time_us * s_clockMhz;
+            break;
+
+        case POWER_ENERGY_SLEEP:
+            current_uA = s_sleepUa[s_profile];
+            PowerEnergy_AddBin(&totals->profileSleep[s_profile], time_us, current_uA);
+            break;
+
+        case POWER_ENERGY_STOP_MAIN:
+            current_uA = POWER_ENERGY_STOP_MAIN_UA;
+            PowerEnergy_AddBin(&totals->stop, time_us, current_uA);
+            break;
+
+        case POWER_ENERGY_STOP:
+        default:
+            current_uA = POWER_ENERGY_STOP_UA;
+            PowerEnergy_AddBin(&totals->stop, time_us, current_uA);
+            break;
+    }
+
+    PowerEnergy_AddBin(&totals->mode[s_mode], time_us, current_uA);
+    PowerEnergy_AddBin(&totals->total, time_us, current_uA);
+
+    s_start_us = now_us;
+}
+
+static void PowerEnergy_AddBin(PowerEnergyBin_t *bin, uint64_t time_us, uint32_t current_uA)
+{
+    bin->time_us     += time_us;
+    bin->charge_uAus += time_us * current_uA;
+}
+
+static uint32_t PowerEnergy_MicroAh(const PowerEnergyBin_t *bin)
+{
+    return (uint32_t)(bin->charge_uAus / POWER_ENERGY_UAUS_PER_UAH);
+}
+
+static float PowerEnergy_MilliAh(const PowerEnergyBin_t *bin)
+{
+    return (float)bin->charge_uAus / ((float)POWER_ENERGY_UAUS_PER_UAH * 1000.0f);
+}
+
+static bool PowerEnergy_PutRecord(uint8_t *payload, size_t *len, uint8_t kind, uint8_t id,
+                                  const PowerEnergyBin_t *bin)
+{
+    if ((*len + POWER_ENERGY_RECORD_SIZE) > TELEMETRY_MAX_PAYLOAD)
+    {
+        return false;
+    }
+
+    uint32_t time_ms = (uint32_t)(bin->time_us / 1000U);
+    uint32_t charge  = PowerEnergy_MicroAh(bin);
+    uint8_t *dst     = &payload[*len];
+
+    dst[0] = kind;
+    dst[1] = id;
+    for (uint32_t b = 0U; b < 4U; ++b)
+    {
+        dst[2U + b] = (uint8_t)(time_ms >> (8U * b));
+        dst[6U + b] = (uint8_t)(charge >> (8U * b));
+    }
+
+    *len += POWER_ENERGY_RECORD_SIZE;
+    return true;
+}
+
+static void PowerEnergy_PrintRow(const char *name, const PowerEnergyBin_t *bin,
+                                 const PowerEnergyBin_t *total)
+{
+    float share = (total->charge_uAus > 0U) ?
+                  (100.0f * (float)bin->charge_uAus / (float)total->charge_uAus) : 0.0f;
+
+    CLI_Print("  %-20s %10.1f %10.3f %5.1f%%\r\n",
+              name,
+              (double)((float)bin->time_us / 1.0e6f),
+              (double)PowerEnergy_MilliAh(bin),
+              (double)share);
+}
+
+static void PowerEnergy_PrintTransition(const char *name, const PowerTransitionStats_t *stats)
+{
+    char     hist[96];
+    size_t   len = 0U;
+    uint32_t avg = (uint32_t)(stats->total_us / stats->count);
+
+    CLI_Print("  %-14s %6lu %7lu %7lu %7lu %7lu %8.2f\r\n",
+              name,
+              (unsigned long)stats->count,
+              (unsigned long)avg,
+              (unsigned long)stats->max_us,
+              (unsigned long)stats->clockMax_us,
+              (unsigned long)stats->otherMax_us,
+              (double)((float)stats->charge_uAus / ((float)POWER_ENERGY_UAUS_PER_UAH / 1000.0f) /
+                       (float)stats->count));
+
+    hist[0] = '\0';
+    for (uint32_t i = 0U; i < POWER_TRANSITION_BUCKETS; ++i)
+    {
+        if ((stats->hist[i] == 0U) || (len >= sizeof(hist)))
+        {
+            continue;
+        }
+
+        uint32_t low = (i == 0U) ? 0U : (1UL << (i + 3U));
+        if (i == (POWER_TRANSITION_BUCKETS - 1U))
+        {
+            len += (size_t)Fmt_Format(&hist[len], sizeof(hist) - len, " >=%lu:%lu",
+                                      (unsigned long)low, (unsigned long)stats->hist[i]);
+        }
+        else
+        {
+            len += (size_t)Fmt_Format(&hist[len], sizeof(hist) - len, " %lu-%lu:%lu",
+                                      (unsigned long)low,
+                                      (unsigned long)((1UL << (i + 4U)) - 1U),
+                                      (unsigned long)stats->hist[i]);
+        }
+    }
+    CLI_Print("  %-14s us%s\r\n", "", hist);
+}
+
+static void PowerEnergy_PrintTransitions(void)
+{
+    PowerTransitionStats_t stats;
+    char                   name[24];
+
+    CLI_Print("\r\nPower transitions:\r\n");
+    CLI_Print("  %-14s %6s %7s %7s %7s %7s %8s\r\n",
+              "from-to", "count", "avg_us", "max_us", "clk_us", "oth_us", "nAh");
+
+    for (uint32_t from = 0U; from < POWER_MODE_COUNT; ++from)
+    {
+        for (uint32_t to = 0U; to < POWER_MODE_COUNT; ++to)
+        {
+            if (!PowerManager_GetTransition((PowerMode_t)from, (PowerMode_t)to, &stats) ||
+                (stats.count == 0U))
+            {
+                continue;
+            }
+
+            (void)Fmt_Format(name, sizeof(name), "%s-%s", s_modeNames[from], s_modeNames[to]);
+            PowerEnergy_PrintTransition(name, &stats);
+        }
+    }
+
+    for (uint32_t i = (uint32_t)POWER_IDLE_STOP_MAIN; i < (uint32_t)POWER_IDLE_STANDBY; ++i)
+    {
+        PowerIdleStats_t idle;
+
+        if (PowerManager_GetIdleStats((PowerIdleState_t)i, &idle) && (idle.cost.count > 0U))
+        {
+            PowerEnergy_PrintTransition(PowerManager_GetIdleStateName((PowerIdleState_t)i),
+                                        &idle.cost);
+        }
+    }
+
+    PowerStats_t power;
+
+    PowerManager_GetStats(&power);
+    CLI_Print("\r\nIdle states (* estimated overhead, min STOP idle %lu ms):\r\n",
+              (unsigned long)POWER_STOP_MIN_IDLE_MS);
+    CLI_Print("  %-10s %8s %10s %12s %10s\r\n",
+              "state", "entries", "time_s", "overhead_us", "even_ms");
+
+    for (uint32_t i = 0U; i < (uint32_t)POWER_IDLE_STATE_COUNT; ++i)
+    {
+        PowerIdleStats_t idle;
+        char             even[12];
+
+        if (!PowerManager_GetIdleStats((PowerIdleState_t)i, &idle))
+        {
+            continue;
+        }
+
+        if (idle.breakEven_ms == UINT32_MAX)
+        {
+            (void)Fmt_Format(even, sizeof(even), "never");
+        }
+        else
+        {
+            (void)Fmt_Format(even, sizeof(even), "%lu", (unsigned long)idle.breakEven_ms);
+        }
+
+        CLI_Print("  %-10s %8lu %10.1f %11lu%c %10s\r\n",
+                  PowerManager_GetIdleStateName((PowerIdleState_t)i),
+                  (unsigned long)idle.entries,
+                  (double)((float)idle.time_us / 1.0e6f),
+                  (unsigned long)idle.overhead_us,
+                  (idle.measured || (i < (uint32_t)POWER_IDLE_STOP_MAIN)) ? ' ' : '*',
+                  even);
+    }
+
+    CLI_Print("  SLEEP chosen over a possible STOP: %lu\r\n", (unsigned long)power.stopSkipped);
+}
+
+static void PowerEnergy_CmdPower(uint32_t argc, char *argv[])
+{
+    if ((argc == 2U) && (strcmp(argv[1], "reset") == 0))
+    {
+        PowerEnergy_Reset();
+        PowerManager_ResetTransitions();
+        CLI_Print("\r\nEnergy, transition and task statistics cleared.\r\n");
+        return;
+    }
+
+    if ((argc == 2U) && (strcmp(argv[1], "trans") == 0))
+    {
+        PowerEnergy_PrintTransitions();
+        return;
+    }
+
+    if ((argc > 2U) || ((argc == 2U) && (strcmp(argv[1], "stats") != 0)))
+    {
+        CLI_PrintError("\r\nUsage: power [stats|trans|reset]\r\n");
+        return;
+    }
+
+    PowerEnergyTotals_t totals;
+    PowerEnergyBin_t    share;
+    PowerEnergyBin_t    tasks = { 0U, 0U };
+    PowerEnergyBin_t    run   = { 0U, 0U };
+    char                name[24];
+
+    PowerEnergy_GetTotals(&totals);
+
+    uint32_t avg_uA = (totals.total.time_us > 0U) ?
+                      (uint32_t)(totals.total.charge_uAus / totals.total.time_us) : 0U;
+
+    CLI_Print("\r\nEnergy (MCU model, %.1f s): %.3f mAh, average %lu uA\r\n",
+              (double)((float)totals.total.time_us / 1.0e6f),
+              (double)PowerEnergy_MilliAh(&totals.total),
+              (unsigned long)avg_uA);
+#if (POWER_ENERGY_BATTERY_MAH > 0U)
+    if (avg_uA > 0U)
+    {
+        CLI_Print("  Battery life at this rate: %.1f h (%lu mAh)\r\n",
+                  (double)((float)POWER_ENERGY_BATTERY_MAH * 1000.0f / (float)avg_uA),
+                  (unsigned long)POWER_ENERGY_BATTERY_MAH);
+    }
+#endif
+
+    CLI_Print("  %-20s %10s %10s %6s\r\n", "bin", "time_s", "mAh", "share");
+    for (uint32_t m = 0U; m < POWER_MODE_COUNT; ++m)
+    {
+        (void)Fmt_Format(name, sizeof(name), "mode %s", s_modeNames[m]);
+        PowerEnergy_PrintRow(name, &totals.mode[m], &totals.total);
+    }
+
+    for (uint32_t p = 0U; p < CLOCK_PROFILE_COUNT; ++p)
+    {
+        (void)Fmt_Format(name, sizeof(name), "run %s", ClockProfile_GetName((ClockProfile_t)p));
+        PowerEnergy_PrintRow(name, &totals.profileRun[p], &totals.total);
+        (void)Fmt_Format(name, sizeof(name), "wfi %s", ClockProfile_GetName((ClockProfile_t)p));
+        PowerEnergy_PrintRow(name, &totals.profileSleep[p], &totals.total);
+
+        run.time_us     += totals.profileRun[p].time_us;
+        run.charge_uAus += totals.profileRun[p].charge_uAus;
+    }
+    PowerEnergy_PrintRow("stop", &totals.stop, &totals.total);
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetTaskCount(); ++i)
+    {
+        const AppTaskDescriptor_t *task = AppTaskManager_GetTask(i);
+
+        PowerEnergy_TaskShare(&totals, task->stats.totalCycles, &share);
+        (void)Fmt_Format(name, sizeof(name), "task %s", task->name);
+        PowerEnergy_PrintRow(name, &share, &totals.total);
+        tasks.time_us     += share.time_us;
+        tasks.charge_uAus += share.charge_uAus;
+    }
+
+    for (uint32_t i = 0U; i < AppTaskManager_GetEventTaskCount(); ++i)
+    {
+        const AppEventTask_t *task = AppTaskManager_GetEventTask(i);
+
+        PowerEnergy_TaskShare(&totals, task->stats.totalCycles, &share);
+        (void)Fmt_Format(name, sizeof(name), "task %s", task->name);
+        PowerEnergy_PrintRow(name, &share, &totals.total);
+        tasks.time_us     += share.time_us;
+        tasks.charge_uAus += share.charge_uAus;
+    }
+
+    /* Run time no task accounts for: interrupts and the scheduler. */
+    run.time_us     = (run.time_us > tasks.time_us) ? (run.time_us - tasks.time_us) : 0U;
+    run.charge_uAus = (run.charge_uAus > tasks.charge_uAus) ?
+                      (run.charge_uAus - tasks.charge_uAus) : 0U;
+    PowerEnergy_PrintRow("other", &run, &totals.total);
+}
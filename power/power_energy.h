@@ -0,0 +1,163 @@
+/**
+ * @file power_energy.h
+ * @brief Charge estimate per power mode, clock profile and task.
+ *
+ * The power manager reports every change of power mode, clock profile and
+ * core state (running, SLEEP/WFI, STOP). Each interval between two changes
+ * is timed with the microsecond time base and weighted with the current
+ * configured for that state in app_config.h (POWER_ENERGY_*_UA), giving
+ * the charge drawn per mode and per clock profile.
+ *
+ * Tasks are charged their share of the run-time charge by DWT cycles: a
+ * task that used 10 % of the core cycles spent running is charged 10 % of
+ * the run charge. What no task accounts for (interrupts, the scheduler
+ * itself) is reported as "other".
+ *
+ * The figures describe the MCU only, with the accuracy of the configured
+ * currents; board loads (LEDs, debugger, sensors) are not included. With
+ * the FreeRTOS scheduler backend the kernel idles without
+ * PowerManager_IdleFor(), so all time is counted as run time.
+ *
+ * @ingroup power
+ */
+
+#ifndef POWER_ENERGY_H
+#define POWER_ENERGY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "power_manager.h"
+#include "clock_profile.h"
+
+/**
+ * @defgroup power_energy Energy Accounting
+ * @brief Time and charge bookkeeping for battery life estimates.
+ * @ingroup power
+ * @{
+ */
+
+/** @brief Telemetry frame type of the energy records. */
+#define POWER_ENERGY_FRAME_TYPE    (0x12U)
+
+/** @brief Charge unit conversion: uA x us per uAh. */
+#define POWER_ENERGY_UAUS_PER_UAH  (3600000000ULL)
+
+/**
+ * @brief Core state for the charge estimate.
+ */
+typedef enum
+{
+    POWER_ENERGY_RUN = 0U,  /**< Core executing.                 */
+    POWER_ENERGY_SLEEP,     /**< Core in SLEEP (WFI).            */
+    POWER_ENERGY_STOP,      /**< MCU in STOP (configured variant). */
+    POWER_ENERGY_STOP_MAIN, /**< MCU in STOP, main regulator.      */
+    POWER_ENERGY_STATE_COUNT
+} PowerEnergyState_t;
+
+/**
+ * @brief Time and charge of one accounting bin.
+ */
+typedef struct
+{
+    uint64_t time_us;     /**< Time spent in the bin.           */
+    uint64_t charge_uAus; /**< Charge drawn, in uA x us.         */
+} PowerEnergyBin_t;
+
+/**
+ * @brief Accumulated totals since PowerEnergy_Init() / PowerEnergy_Reset().
+ */
+typedef struct
+{
+    PowerEnergyBin_t mode[POWER_MODE_COUNT];              /**< Per power mode (all states). */
+    PowerEnergyBin_t profileRun[CLOCK_PROFILE_COUNT];     /**< Running, per clock profile.  */
+    PowerEnergyBin_t profileSleep[CLOCK_PROFILE_COUNT];   /**< SLEEP, per clock profile.    */
+    PowerEnergyBin_t stop;                                /**< STOP, both variants.         */
+    PowerEnergyBin_t total;                               /**< Everything.                  */
+    uint64_t         runCycles;                           /**< Core cycles while running.   */
+} PowerEnergyTotals_t;
+
+/**
+ * @brief Start accounting and register the "power" CLI command.
+ *
+ * Called by PowerManager_Init() once the initial clock profile is set.
+ *
+ * @param mode Initial power mode.
+ *
+ * @return None.
+ */
+void PowerEnergy_Init(PowerMode_t mode);
+
+/**
+ * @brief Close the current interval and start one in a new state.
+ *
+ * The clock profile and core clock are read when the interval starts, so
+ * call this after a clock profile change has been applied. Safe with
+ * interrupts masked.
+ *
+ * @param mode  Power mode from now on.
+ * @param state Core state from now on.
+ *
+ * @return None.
+ */
+void PowerEnergy_Enter(PowerMode_t mode, PowerEnergyState_t state);
+
+/**
+ * @brief Get the totals, including the interval in progress.
+ *
+ * @param[out] totals Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void PowerEnergy_GetTotals(PowerEnergyTotals_t *totals);
+
+/**
+ * @brief Clear the totals and the task cycle statistics they are split by.
+ *
+ * @return None.
+ */
+void PowerEnergy_Reset(void);
+
+/**
+ * @brief Supply current of the energy model for a core state.
+ *
+ * @param state   Core state.
+ * @param profile Clock profile (ignored for the STOP states).
+ *
+ * @return Configured current in uA.
+ */
+uint32_t PowerEnergy_GetCurrentUa(PowerEnergyState_t state, ClockProfile_t profile);
+
+/**
+ * @brief Estimate the share of the run charge used by a task.
+ *
+ * @param totals      Totals from PowerEnergy_GetTotals().
+ * @param cycles      Task cycles (AppTaskStats_t::totalCycles).
+ * @param[out] share  Estimated run time and charge of the task.
+ *
+ * @return None.
+ */
+void PowerEnergy_TaskShare(const PowerEnergyTotals_t *totals, uint64_t cycles,
+                           PowerEnergyBin_t *share);
+
+/**
+ * @brief Send the energy records as telemetry when they are due.
+ *
+ * Sends one @ref POWER_ENERGY_FRAME_TYPE frame every
+ * @ref POWER_ENERGY_TELEMETRY_MS while live telemetry is on.
+ *
+ * @param now_ms Current HAL tick.
+ *
+ * @return None.
+ */
+void PowerEnergy_Service(uint32_t now_ms);
+
+/** @} */ /* end of power_energy group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_ENERGY_H */
@@ -2,13 +2,53 @@
  * @file power_manager.c
  * @brief Implementation of the power management framework.
  *
- * Tracks current and requested power modes and logs transitions.
+ * Tracks current and requested power modes, logs transitions, runs the
+ * adaptive step-down policy, and implements idle between scheduler
+ * deadlines: tickless SLEEP, or STOP with RTC wakeup when the idle
+ * governor finds that it pays off for the idle period.
  *
  * @ingroup power
  */
 
 #include "power_manager.h"
+#include "power_rtc.h"
+#include "power_energy.h"
+#include "periph_power.h"
+#include "status_led.h"
+#include "clock_profile.h"
+#include "app_config.h"
+#include "uart_tx.h"
+#include "telemetry_uart.h"
+#include "i2c_bus.h"
+#include "spi_bus.h"
+#include "uplink.h"
+#include "usb_cdc.h"
+#include "watchdog_hw.h"
+#include "cli.h"
+#include "metrics.h"
+#include "cycle_counter.h"
+#include "time_base.h"
 #include "log.h"
+#include "trace.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/**
+ * @brief Clock tree state captured before STOP.
+ *
+ * STOP switches SYSCLK to HSI and turns off HSE, both PLLs and
+ * over-drive; everything else (PLL factors, prescalers, flash latency) is
+ * retained.
+ */
+typedef struct
+{
+    uint32_t sysclkSource; /**< RCC_CFGR_SW bits in use before STOP. */
+    bool     hseOn;        /**< HSE oscillator was running.          */
+    bool     pllOn;        /**< Main PLL was running.                */
+    bool     pllSaiOn;     /**< PLLSAI (USB clock) was running.      */
+    bool     overDrive;    /**< Over-drive mode was enabled.         */
+} PowerClockState_t;
 
 /**
  * @brief Current power mode.
@@ -21,12 +61,242 @@ static PowerMode_t s_currentMode = POWER_MODE_ACTIVE;
 static PowerMode_t s_requestedMode = POWER_MODE_ACTIVE;
 
 /**
- * @brief Number of update cycles spent idle.
+ * @brief Adaptive policy enabled (PowerManager_SetAutoPolicy()).
+ */
+static bool s_autoPolicy = false;
+
+/**
+ * @brief HAL tick of the last activity.
+ */
+static volatile uint32_t s_lastActivity_ms = 0U;
+
+/**
+ * @brief HAL tick of the last applied mode change.
+ */
+static uint32_t s_modeEntered_ms = 0U;
+
+/**
+ * @brief Set by activity that should bring the system back to ACTIVE.
+ */
+static volatile bool s_wakePending = false;
+
+/**
+ * @brief Out-of-deadband sensor samples in the current wake window.
+ */
+static uint32_t s_sensorChanges = 0U;
+
+/**
+ * @brief HAL tick at which the current sensor wake window started.
+ */
+static uint32_t s_sensorWindow_ms = 0U;
+
+/**
+ * @brief HAL tick of the last console input or UART wake.
+ */
+static volatile uint32_t s_console_ms = 0U;
+
+/**
+ * @brief Set while STOP is held off for the console.
+ */
+static volatile bool s_consoleHold = false;
+
+/**
+ * @brief Low-power statistics reported by PowerManager_GetStats().
+ */
+static PowerStats_t s_stats;
+
+/**
+ * @brief Set once the RTC is running, so STOP can be timed and measured.
+ */
+static bool s_rtcReady = false;
+
+/**
+ * @brief Wake sources currently armed for STOP (POWER_WAKE_SRC_* bits).
+ */
+static uint32_t s_wakeSources = 0U;
+
+/**
+ * @brief Measured cost of the mode changes, per (from, to) pair.
+ */
+static PowerTransitionStats_t s_transitions[POWER_MODE_COUNT][POWER_MODE_COUNT];
+
+/**
+ * @brief Measured entries and exits, per idle state (STOP states only).
+ */
+static PowerTransitionStats_t s_idleCost[POWER_IDLE_STATE_COUNT];
+
+/**
+ * @brief Idle periods spent in each idle state.
+ */
+static uint32_t s_idleEntries[POWER_IDLE_STATE_COUNT];
+
+/**
+ * @brief Time spent in each idle state (us).
+ */
+static uint64_t s_idleTime_us[POWER_IDLE_STATE_COUNT];
+
+/**
+ * @brief Idle state names, as printed by `power trans`.
+ */
+static const char *const s_idleNames[POWER_IDLE_STATE_COUNT] =
+{
+    "WFI", "SLEEP", "STOP_MAIN", "STOP_LP", "STANDBY"
+};
+
+/**
+ * @brief Mode changes applied since PowerManager_Init() (metrics).
+ */
+static uint32_t s_transitionCount = 0U;
+
+/**
+ * @brief Longest mode change since the statistics were cleared (metrics).
+ */
+static uint32_t s_transitionMax_us = 0U;
+
+/**
+ * @brief Enter STOP for up to @p maxIdle_ms and restore clocks on wake.
  *
- * This can later be used to trigger automatic transitions to lower
- * power modes after prolonged inactivity.
+ * Must be called with interrupts masked (PRIMASK set).
+ *
+ * @param maxIdle_ms Idle budget in ms.
+ * @param lowPower   Deep state: the configured regulator and flash
+ *                   power-down (POWER_IDLE_STOP_LP), instead of the main
+ *                   regulator with the flash on.
+ *
+ * @return Milliseconds spent in STOP (RTC measured).
+ */
+static uint32_t PowerManager_StopSleep(uint32_t maxIdle_ms, bool lowPower);
+
+/**
+ * @brief STOP states the next idle period may use.
+ *
+ * Must be called with interrupts masked (PRIMASK set).
+ *
+ * @param[in,out] stop_ms Idle budget; shortened to what the status LED
+ *                        pattern allows in STOP.
+ *
+ * @return POWER_IDLE_ALLOW() bits, 0 if STOP is not possible now.
+ */
+static uint32_t PowerManager_GetStopStates(uint32_t *stop_ms);
+
+/**
+ * @brief Current (uA) drawn while in an idle state.
+ */
+static uint64_t PowerManager_IdleCurrentUa(PowerIdleState_t state, ClockProfile_t profile);
+
+/**
+ * @brief Average entry and exit time and charge of an idle state.
+ *
+ * Measured once the state has been entered, estimated before.
+ *
+ * @param state            Idle state.
+ * @param profile          Clock profile the entry starts from.
+ * @param[out] time_us     Overhead time.
+ * @param[out] charge_uAus Overhead charge.
+ *
+ * @return true if measured.
+ */
+static bool PowerManager_GetIdleOverhead(PowerIdleState_t state, ClockProfile_t profile,
+                                         uint64_t *time_us, uint64_t *charge_uAus);
+
+/**
+ * @brief Capture the clock tree state before entering STOP.
+ */
+static void PowerManager_SaveClocks(PowerClockState_t *state);
+
+/**
+ * @brief Fast clock restore after STOP.
+ *
+ * Re-enables only what STOP turned off and switches SYSCLK back, instead
+ * of re-running the full SystemClock_Config().
+ */
+static void PowerManager_RestoreClocks(const PowerClockState_t *state);
+
+/**
+ * @brief Enable or disable the NVIC lines of the STOP wake sources.
+ *
+ * @param sources POWER_WAKE_SRC_* bits to arm.
+ */
+static void PowerManager_ApplyWakeSources(uint32_t sources);
+
+/**
+ * @brief Switch to the clock profile configured for @p mode.
+ *
+ * @param mode Power mode being entered.
+ */
+static void PowerManager_ApplyClockProfile(PowerMode_t mode);
+
+/**
+ * @brief Stretch SysTick over @p idleTicks ticks and sleep.
+ *
+ * Must be called with interrupts masked (PRIMASK set).
+ *
+ * @param idleTicks Number of ticks to sleep (>= 2).
+ *
+ * @return Number of whole ticks that elapsed.
+ */
+static uint32_t PowerManager_TicklessSleep(uint32_t idleTicks);
+
+/**
+ * @brief Adaptive policy step: request a wake-up or step-down, if due.
+ *
+ * Wakes to ACTIVE on pending activity. Otherwise steps down one mode once
+ * the inactivity time for it has passed and the current mode has been held
+ * for @ref POWER_AUTO_MIN_DWELL_MS. Leaves a pending manual request alone.
+ */
+static void PowerManager_RunPolicy(void);
+
+/**
+ * @brief Time left (ms) before STOP may be entered after console input.
+ *
+ * Clears the hold once it has expired.
+ *
+ * @param now_ms Current HAL tick.
+ *
+ * @return 0 if STOP is allowed.
+ */
+static uint32_t PowerManager_ConsoleHoldLeft(uint32_t now_ms);
+
+/**
+ * @brief Add one measured transition to @p stats.
+ *
+ * @param stats       Statistics of the transition kind.
+ * @param clock_us    Duration of the clock phase.
+ * @param other_us    Duration of the second phase.
+ * @param charge_uAus Charge drawn meanwhile.
+ */
+static void PowerManager_RecordTransition(PowerTransitionStats_t *stats, uint32_t clock_us,
+                                          uint32_t other_us, uint64_t charge_uAus);
+
+/**
+ * @brief Metrics gauge: time since the last activity (ms).
+ */
+static uint32_t PowerManager_GaugeInactive(void);
+
+/**
+ * @brief Metrics gauge: time before STOP may be entered again (ms).
+ */
+static uint32_t PowerManager_GaugeConsoleHold(void);
+
+/**
+ * @brief Metrics gauge: average overhead of the deep STOP state (us).
+ */
+static uint32_t PowerManager_GaugeStopOverhead(void);
+
+/**
+ * @brief Metrics gauge: break-even of the deep STOP state (ms).
+ */
+static uint32_t PowerManager_GaugeStopBreakEven(void);
+
+/**
+ * @brief Metrics gauge: break-even of STOP on the main regulator (ms).
  */
-static uint32_t s_idleCycles = 0U;
+static uint32_t PowerManager_GaugeStopMainBreakEven(void);
+
+/**
+ * @brief Publish the low-power statistics in the metrics registry.
+ */
+static void PowerManager_PublishMetrics(void);
 
 /* ------------------------------------------------------------------------- */
 
@@ -34,9 +304,56 @@ void PowerManager_Init(void)
 {
     s_currentMode   = POWER_MODE_ACTIVE;
     s_requestedMode = POWER_MODE_ACTIVE;
-    s_idleCycles    = 0U;
+    (void)memset(&s_stats, 0, sizeof(s_stats));
+    PowerManager_ResetTransitions();
+    s_transitionCount = 0U;
+    /* The tick does not start at 0 after a STANDBY duty cycle. */
+    s_lastActivity_ms = HAL_GetTick();
+    PowerManager_PublishMetrics();
+
+#ifdef DEBUG
+    /* Keep the debug port alive while the core sits in WFI or STOP. */
+    HAL_DBGMCU_EnableDBGSleepMode();
+    HAL_DBGMCU_EnableDBGStopMode();
+#endif
+
+    /* Cycle counter for wake latency measurement. */
+    CycleCounter_Init();
+
+    s_rtcReady = PowerRtc_Init();
+    if (!s_rtcReady)
+    {
+        LOG_WARN("PowerManager: RTC unavailable, STOP mode falls back to SLEEP");
+    }
+
+    /* USART2 RX pin (PA3) on EXTI line 3, falling edge = start bit.
+     * The line is only unmasked while in STOP.
+     */
+    PeriphPower_Acquire(PERIPH_POWER_SYSCFG);
+    SYSCFG->EXTICR[0] &= ~SYSCFG_EXTICR1_EXTI3;
+    PeriphPower_Release(PERIPH_POWER_SYSCFG);
+    EXTI->FTSR |= EXTI_FTSR_TR3;
+    EXTI->IMR  &= ~EXTI_IMR_MR3;
+    HAL_NVIC_SetPriority(EXTI3_IRQn, IRQ_PRIO_UART_WAKE, 0U);
+    HAL_NVIC_EnableIRQ(EXTI3_IRQn);
+
+    /* B1 is configured for falling-edge interrupts by MX_GPIO_Init(). */
+    HAL_NVIC_SetPriority(EXTI15_10_IRQn, IRQ_PRIO_BUTTON, 0U);
+    HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+
+    s_wakeSources = 0U;
+
+    PowerManager_ApplyClockProfile(POWER_MODE_ACTIVE);
+
+    PowerEnergy_Init(POWER_MODE_ACTIVE);
+    PeriphPower_Init();
+    PeriphPower_ApplyMode(POWER_MODE_ACTIVE);
+
+    PowerManager_SetAutoPolicy(POWER_AUTO_POLICY_DEFAULT != 0);
+    s_modeEntered_ms = HAL_GetTick();
 
-    LOG_INFO("PowerManager: initialized (mode = ACTIVE)");
+    LOG_INFO("PowerManager: initialized (mode = ACTIVE, policy = %s)",
+             s_autoPolicy ? "auto" : "manual");
 }
 
 void PowerManager_RequestMode(PowerMode_t mode)
@@ -48,6 +365,63 @@ void PowerManager_RequestMode(PowerMode_t mode)
     }
 }
 
+void PowerManager_SetAutoPolicy(bool enable)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    s_lastActivity_ms = HAL_GetTick();
+    s_wakePending     = false;
+    s_sensorChanges   = 0U;
+    s_autoPolicy      = enable;
+
+    __set_PRIMASK(primask);
+}
+
+bool PowerManager_IsAutoPolicy(void)
+{
+    return s_autoPolicy;
+}
+
+void PowerManager_NotifyActivity(PowerActivity_t source)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now_ms = HAL_GetTick();
+
+    /* Kept with the policy off as well, for the inactivity time in 'status'. */
+    s_lastActivity_ms = now_ms;
+
+    if (source == POWER_ACTIVITY_CLI)
+    {
+        s_console_ms  = now_ms;
+        s_consoleHold = true;
+    }
+
+    if (s_autoPolicy && (source != POWER_ACTIVITY_SENSOR))
+    {
+        s_wakePending = true;
+    }
+    else if (s_autoPolicy)
+    {
+        if ((s_sensorChanges == 0U) ||
+            ((now_ms - s_sensorWindow_ms) > POWER_AUTO_SENSOR_WAKE_WINDOW_MS))
+        {
+            s_sensorWindow_ms = now_ms;
+            s_sensorChanges   = 0U;
+        }
+
+        if (++s_sensorChanges >= POWER_AUTO_SENSOR_WAKE_COUNT)
+        {
+            s_sensorChanges = 0U;
+            s_wakePending   = true;
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
 PowerMode_t PowerManager_GetCurrentMode(void)
 {
     return s_currentMode;
@@ -55,10 +429,12 @@ PowerMode_t PowerManager_GetCurrentMode(void)
 
 void PowerManager_Update(void)
 {
-    /* In Phase 3, we limit ourselves to logging state transitions and
-     * maintaining a simple idea of "idle cycles". Later phases may use
-     * this function to actually enter STM32 low-power modes.
-     */
+    uint32_t now_ms = HAL_GetTick();
+
+    if (s_autoPolicy)
+    {
+        PowerManager_RunPolicy();
+    }
 
     if (s_requestedMode != s_currentMode)
     {
@@ -66,22 +442,852 @@ void PowerManager_Update(void)
                  (int)s_currentMode,
                  (int)s_requestedMode);
 
-        s_currentMode = s_requestedMode;
-        s_idleCycles  = 0U;
+        PowerMode_t from = s_currentMode;
+
+        s_currentMode    = s_requestedMode;
+        s_modeEntered_ms = now_ms;
+        s_sensorChanges  = 0U;
+
+        /* The time base follows the clock switch, so it can time across it. */
+        uint32_t start_us = Time_NowUs32();
+
+        TRACE_POWER_MODE(s_currentMode);
+        PowerManager_ApplyClockProfile(s_currentMode);
+        uint32_t clock_us = Time_NowUs32() - start_us;
+
+        PowerEnergy_Enter(s_currentMode, POWER_ENERGY_RUN);
+        PeriphPower_ApplyMode(s_currentMode);
+        Uplink_OnPowerMode(s_currentMode);
+        PowerManager_ApplyWakeSources((s_currentMode == POWER_MODE_STOP) ?
+                                      POWER_STOP_WAKE_SOURCES : 0U);
+        uint32_t other_us = (Time_NowUs32() - start_us) - clock_us;
+
+        /* Both phases end on the new clock profile; charge them at its rate. */
+        uint32_t run_uA = PowerEnergy_GetCurrentUa(POWER_ENERGY_RUN, ClockProfile_GetCurrent());
+        PowerManager_RecordTransition(&s_transitions[from][s_currentMode], clock_us, other_us,
+                                      (uint64_t)(clock_us + other_us) * run_uA);
+
+        s_transitionCount++;
+        if ((clock_us + other_us) > s_transitionMax_us)
+        {
+            s_transitionMax_us = clock_us + other_us;
+        }
+    }
+}
+
+uint32_t PowerManager_IdleFor(uint32_t maxIdle_ms)
+{
+    if (maxIdle_ms == 0U)
+    {
+        return 0U;
+    }
+
+    uint32_t slept = 0U;
+
+    /* Interrupts stay masked across the sleep so that the wake-up interrupt
+     * is only serviced after the tick count has been corrected. WFI still
+     * wakes on a pending interrupt while PRIMASK is set.
+     */
+    __disable_irq();
+    TRACE_IDLE_BEGIN();
+
+    uint32_t start_us = Time_NowUs32();
+
+    uint32_t         stop_ms = maxIdle_ms;
+    uint32_t         allowed = PowerManager_GetStopStates(&stop_ms);
+    PowerIdleState_t state   = PowerManager_SelectIdleState(stop_ms, allowed);
+
+    if ((state != POWER_IDLE_STOP_MAIN) && (state != POWER_IDLE_STOP_LP))
+    {
+        if (allowed != 0U)
+        {
+            s_stats.stopSkipped++;
+        }
+        state = (maxIdle_ms < 2U) ? POWER_IDLE_WFI : POWER_IDLE_SLEEP;
+    }
+
+    switch (state)
+    {
+    case POWER_IDLE_STOP_MAIN:
+        PowerEnergy_Enter(s_currentMode, POWER_ENERGY_STOP_MAIN);
+        slept = PowerManager_StopSleep(stop_ms, false);
+        break;
+
+    case POWER_IDLE_STOP_LP:
+        PowerEnergy_Enter(s_currentMode, POWER_ENERGY_STOP);
+        slept = PowerManager_StopSleep(stop_ms, true);
+        break;
+
+    case POWER_IDLE_WFI:
+        /* The next SysTick is the deadline; a plain WFI is enough. */
+        PowerEnergy_Enter(s_currentMode, POWER_ENERGY_SLEEP);
+        HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+        break;
+
+    default:
+        PowerEnergy_Enter(s_currentMode, POWER_ENERGY_SLEEP);
+        slept = PowerManager_TicklessSleep(maxIdle_ms);
+        s_stats.ticklessEntries++;
+        s_stats.sleepTime_ms += slept;
+        break;
+    }
+
+    /* After STOP this also picks up the restored clock profile. */
+    PowerEnergy_Enter(s_currentMode, POWER_ENERGY_RUN);
+    s_stats.idleEntries++;
+    s_idleEntries[state]++;
+    s_idleTime_us[state] += Time_NowUs32() - start_us;
+    TRACE_IDLE_END();
+    __enable_irq();
+
+    return slept;
+}
+
+void PowerManager_GetStats(PowerStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    __disable_irq();
+    *stats = s_stats;
+    stats->inactive_ms    = HAL_GetTick() - s_lastActivity_ms;
+    stats->consoleHold_ms = PowerManager_ConsoleHoldLeft(HAL_GetTick());
+    __enable_irq();
+}
+
+bool PowerManager_GetTransition(PowerMode_t from, PowerMode_t to, PowerTransitionStats_t *stats)
+{
+    if ((stats == NULL) || ((uint32_t)from >= POWER_MODE_COUNT) ||
+        ((uint32_t)to >= POWER_MODE_COUNT) || (from == to))
+    {
+        return false;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_transitions[from][to];
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+PowerIdleState_t PowerManager_SelectIdleState(uint32_t idle_ms, uint32_t allowed)
+{
+    if (idle_ms < 2U)
+    {
+        return POWER_IDLE_WFI;
+    }
+
+    ClockProfile_t   profile = ClockProfile_GetCurrent();
+    uint64_t         idle_us = (uint64_t)idle_ms * 1000U;
+    PowerIdleState_t best    = POWER_IDLE_SLEEP;
+    uint64_t         least   = idle_us * PowerManager_IdleCurrentUa(POWER_IDLE_SLEEP, profile);
+
+    for (uint32_t i = (uint32_t)POWER_IDLE_STOP_MAIN; i < (uint32_t)POWER_IDLE_STATE_COUNT; ++i)
+    {
+        PowerIdleState_t state = (PowerIdleState_t)i;
+        if ((allowed & POWER_IDLE_ALLOW(state)) == 0U)
+        {
+            continue;
+        }
+
+        uint64_t overhead_us;
+        uint64_t overhead_uAus;
+        (void)PowerManager_GetIdleOverhead(state, profile, &overhead_us, &overhead_uAus);
+        if (idle_us <= overhead_us)
+        {
+            continue;
+        }
+
+        /* The overhead, then the rest of the period at the state's current. */
+        uint64_t charge = overhead_uAus +
+                          ((idle_us - overhead_us) * PowerManager_IdleCurrentUa(state, profile));
+        if (charge < least)
+        {
+            best  = state;
+            least = charge;
+        }
+    }
+
+    return best;
+}
+
+bool PowerManager_GetIdleStats(PowerIdleState_t state, PowerIdleStats_t *stats)
+{
+    if ((stats == NULL) || ((uint32_t)state >= POWER_IDLE_STATE_COUNT))
+    {
+        return false;
+    }
+
+    ClockProfile_t profile = ClockProfile_GetCurrent();
+    uint64_t       overhead_us;
+    uint64_t       overhead_uAus;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats->entries  = s_idleEntries[state];
+    stats->time_us  = s_idleTime_us[state];
+    stats->cost     = s_idleCost[state];
+    stats->measured = PowerManager_GetIdleOverhead(state, profile, &overhead_us, &overhead_uAus);
+    __set_PRIMASK(primask);
+
+    stats->overhead_us  = (uint32_t)overhead_us;
+    stats->breakEven_ms = 0U;
+    if (state < POWER_IDLE_STOP_MAIN)
+    {
+        return true;
+    }
+
+    uint64_t sleep_uA = PowerManager_IdleCurrentUa(POWER_IDLE_SLEEP, profile);
+    uint64_t state_uA = PowerManager_IdleCurrentUa(state, profile);
+    if (sleep_uA <= state_uA)
+    {
+        stats->breakEven_ms = UINT32_MAX;
+        return true;
+    }
+
+    /* An idle period of g us costs Q + (g - t) x I against g x I_sleep in
+     * SLEEP, with t and Q the overhead time and charge: the state pays off
+     * from g = (Q - t x I) / (I_sleep - I), and never before t.
+     */
+    uint64_t floor_uAus  = overhead_us * state_uA;
+    uint64_t excess_uAus = (overhead_uAus > floor_uAus) ? (overhead_uAus - floor_uAus) : 0U;
+    uint64_t gap_us      = excess_uAus / (sleep_uA - state_uA);
+
+    if (gap_us < overhead_us)
+    {
+        gap_us = overhead_us;
+    }
+
+    /* Whole ms, at least 1: 0 is reserved for the states without overhead. */
+    stats->breakEven_ms = (gap_us > 1000U) ? (uint32_t)((gap_us + 999U) / 1000U) : 1U;
+
+    return true;
+}
+
+const char *PowerManager_GetIdleStateName(PowerIdleState_t state)
+{
+    return ((uint32_t)state < POWER_IDLE_STATE_COUNT) ? s_idleNames[state] : "?";
+}
+
+void PowerManager_ResetTransitions(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    (void)memset(s_transitions, 0, sizeof(s_transitions));
+    (void)memset(s_idleCost, 0, sizeof(s_idleCost));
+    (void)memset(s_idleEntries, 0, sizeof(s_idleEntries));
+    (void)memset(s_idleTime_us, 0, sizeof(s_idleTime_us));
+    s_transitionMax_us = 0U;
+
+    __set_PRIMASK(primask);
+}
+
+void PowerManager_UartWakeIrqHandler(void)
+{
+    /* The wake edge is consumed by PowerManager_StopSleep(); this only runs
+     * if the line fires before the mask is restored.
+     */
+    EXTI->PR = EXTI_PR_PR3;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t PowerManager_TicklessSleep(uint32_t idleTicks)
+{
+    /* SysTick runs from HCLK with LOAD = cycles per tick - 1. Reading it here
+     * keeps this code correct whatever the current core clock is.
+     */
+    uint32_t cyclesPerTick = SysTick->LOAD + 1U;
+    uint32_t maxTicks      = SysTick_LOAD_RELOAD_Msk / cyclesPerTick;
+
+    if (idleTicks > maxTicks)
+    {
+        idleTicks = maxTicks;
+    }
+
+    /* Stop the counter; keep the cycles left in the current tick. */
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+
+    if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0U)
+    {
+        /* The tick already expired: let the pending interrupt run. */
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        return 0U;
+    }
+
+    uint32_t remaining = SysTick->VAL;
+    uint32_t reload    = remaining + (cyclesPerTick * (idleTicks - 1U));
+
+    SysTick->LOAD = reload;
+    SysTick->VAL  = 0U;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    HAL_PWR_EnterSLEEPMode(PWR_MAINREGULATOR_ON, PWR_SLEEPENTRY_WFI);
+
+    /* Reading CTRL clears COUNTFLAG: read it once, and stop the counter
+     * with a plain write rather than a read-modify-write.
+     */
+    uint32_t ctrl = SysTick->CTRL;
+    SysTick->CTRL = ctrl & ~(SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_COUNTFLAG_Msk);
+
+    uint32_t elapsedTicks;
+    uint32_t compensation;
+
+    if ((ctrl & SysTick_CTRL_COUNTFLAG_Msk) != 0U)
+    {
+        /* The full period elapsed. The pending SysTick interrupt accounts
+         * for the final tick once interrupts are re-enabled.
+         */
+        elapsedTicks = idleTicks;
+        compensation = idleTicks - 1U;
+
+        SysTick->LOAD = cyclesPerTick - 1U;
+        SysTick->VAL  = 0U;
     }
     else
     {
-        /* No change requested; consider this an "idle" check-in. */
-        s_idleCycles++;
-        LOG_DEBUG("PowerManager: mode=%d, idleCycles=%lu",
-                  (int)s_currentMode,
-                  (unsigned long)s_idleCycles);
+        /* Woken early by another interrupt. Work out how many whole ticks
+         * passed and how far into the current tick we are.
+         */
+        uint32_t elapsedCycles = reload - SysTick->VAL;
+        uint32_t partial;
+
+        if (elapsedCycles < remaining)
+        {
+            elapsedTicks = 0U;
+            partial      = remaining - elapsedCycles;
+        }
+        else
+        {
+            elapsedCycles -= remaining;
+            elapsedTicks   = 1U + (elapsedCycles / cyclesPerTick);
+            partial        = cyclesPerTick - (elapsedCycles % cyclesPerTick);
+        }
+        compensation = elapsedTicks;
+
+        /* Finish the current tick, then fall back to the normal period: the
+         * new LOAD only takes effect at the next reload.
+         */
+        SysTick->LOAD = (partial > 1U) ? (partial - 1U) : 1U;
+        SysTick->VAL  = 0U;
+        SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+        SysTick->LOAD = cyclesPerTick - 1U;
+
+        s_stats.earlyWakeups++;
+    }
+
+    uwTick += compensation * (uint32_t)uwTickFreq;
+
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    return elapsedTicks;
+}
+
+static uint32_t PowerManager_StopSleep(uint32_t maxIdle_ms, bool lowPower)
+{
+    PowerClockState_t clocks;
+    uint32_t          start_ms    = PowerRtc_GetMs();
+    uint32_t          entryCycles = CycleCounter_Now();
+    uint32_t          entryMhz    = SystemCoreClock / 1000000U;
+    ClockProfile_t    profile     = ClockProfile_GetCurrent();
+    PowerIdleState_t  state       = lowPower ? POWER_IDLE_STOP_LP : POWER_IDLE_STOP_MAIN;
+
+    /* STOP mode wakes on its configured sources; an idle period of a run
+     * mode must end at its deadline, and on console or button input.
+     */
+    uint32_t wake = (s_currentMode == POWER_MODE_STOP) ? s_wakeSources :
+                    (POWER_WAKE_SRC_RTC | POWER_WAKE_SRC_UART | POWER_WAKE_SRC_BUTTON);
+
+    /* The IWDG keeps counting in STOP: never sleep past the idle budget,
+     * which the task manager keeps short of the next refresh.
+     */
+    if (((wake & POWER_WAKE_SRC_RTC) != 0U) || WatchdogHw_IsRunning())
+    {
+        PowerRtc_StartWakeup(maxIdle_ms);
+    }
+
+    if ((wake & POWER_WAKE_SRC_UART) != 0U)
+    {
+        EXTI->PR   = EXTI_PR_PR3;
+        EXTI->IMR |= EXTI_IMR_MR3;
     }
 
-    /* Future work (later phases):
-     * - If mode == POWER_MODE_SLEEP or POWER_MODE_STOP:
-     *     - Coordinate with main loop or RTOS to enter low-power.
-     *     - Configure wake-up sources (timers, GPIO, etc.).
-     * - Adjust sampling rates based on power mode.
+    TRACE_STOP_ENTER();
+
+    /* SysTick would only wake us again; the RTC measures the sleep. */
+    HAL_SuspendTick();
+    PowerManager_SaveClocks(&clocks);
+
+    /* STOP wakes on HSI with the bus prescalers unchanged: set the console
+     * divider for that, so bytes arriving during the restore are received.
      */
+    bool rebaud = ((wake & POWER_WAKE_SRC_UART) != 0U) &&
+                  (clocks.sysclkSource != RCC_CFGR_SW_HSI);
+    if (rebaud)
+    {
+        UartTx_SetBaudClock(HSI_VALUE >> AHBPrescTable[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos]);
+    }
+
+    uint32_t regulator = PWR_MAINREGULATOR_ON;
+    if (lowPower)
+    {
+#if (POWER_STOP_FLASH_POWER_DOWN != 0)
+        HAL_PWREx_EnableFlashPowerDown();
+#endif
+#if (POWER_STOP_LOW_POWER_REGULATOR != 0)
+        regulator = PWR_LOWPOWERREGULATOR_ON;
+#endif
+    }
+
+    uint32_t entry_us = (CycleCounter_Now() - entryCycles) / entryMhz;
+
+    HAL_PWR_EnterSTOPMode(regulator, PWR_STOPENTRY_WFI);
+
+    /* Running from HSI from here until the restore completes. */
+    uint32_t wakeCycles = CycleCounter_Now();
+    PowerManager_RestoreClocks(&clocks);
+    uint32_t latency_us = (CycleCounter_Now() - wakeCycles) / (HSI_VALUE / 1000000U);
+    if (rebaud)
+    {
+        UartTx_UpdateBaudRate();
+    }
+
+#if (POWER_STOP_FLASH_POWER_DOWN != 0)
+    if (lowPower)
+    {
+        HAL_PWREx_DisableFlashPowerDown();
+    }
+#endif
+
+    /* Record which armed source ended the sleep. */
+    uint32_t pending = EXTI->PR;
+    uint32_t source  = 0U;
+    if ((pending & EXTI_PR_PR22) != 0U)
+    {
+        source |= POWER_WAKE_SRC_RTC;
+    }
+    if ((pending & EXTI_PR_PR3) != 0U)
+    {
+        source |= POWER_WAKE_SRC_UART;
+    }
+    if ((pending & EXTI_PR_PR13) != 0U)
+    {
+        source |= POWER_WAKE_SRC_BUTTON;
+    }
+
+    EXTI->IMR &= ~EXTI_IMR_MR3;
+    EXTI->PR   = EXTI_PR_PR3;
+    HAL_NVIC_ClearPendingIRQ(EXTI3_IRQn);
+    PowerRtc_StopWakeup();
+
+    uint32_t slept_ms = PowerRtc_ElapsedMs(start_ms, PowerRtc_GetMs());
+    uwTick += slept_ms;
+    Time_AddUs((uint64_t)slept_ms * 1000U);
+    HAL_ResumeTick();
+    StatusLed_OnStopExit(slept_ms);
+    TRACE_STOP_EXIT();
+
+    if ((source & POWER_WAKE_SRC_UART) != 0U)
+    {
+        /* The operator is typing: stay out of STOP until they stop. */
+        s_console_ms  = HAL_GetTick();
+        s_consoleHold = true;
+        s_stats.uartWakes++;
+        CLI_OnUartWake();
+    }
+
+    s_stats.stopEntries++;
+    s_stats.stopTime_ms       += slept_ms;
+    s_stats.lastWakeSource     = source;
+    s_stats.lastWakeLatency_us = latency_us;
+    if (latency_us > s_stats.maxWakeLatency_us)
+    {
+        s_stats.maxWakeLatency_us = latency_us;
+    }
+
+    /* The preparation runs on the profile of STOP mode, the restore on HSI. */
+    uint64_t charge = ((uint64_t)entry_us * PowerEnergy_GetCurrentUa(POWER_ENERGY_RUN, profile)) +
+                      ((uint64_t)latency_us *
+                       PowerEnergy_GetCurrentUa(POWER_ENERGY_RUN, CLOCK_PROFILE_LOW_POWER));
+    PowerManager_RecordTransition(&s_idleCost[state], latency_us, entry_us, charge);
+
+    return slept_ms;
+}
+
+static uint32_t PowerManager_GetStopStates(uint32_t *stop_ms)
+{
+#if (POWER_IDLE_GOVERNOR != 0)
+    uint32_t states = POWER_IDLE_ALLOW(POWER_IDLE_STOP_MAIN) | POWER_IDLE_ALLOW(POWER_IDLE_STOP_LP);
+#else
+    uint32_t states = POWER_IDLE_ALLOW(POWER_IDLE_STOP_LP);
+
+    if (s_currentMode != POWER_MODE_STOP)
+    {
+        return 0U;
+    }
+#endif
+
+    if (!s_rtcReady ||
+        (*stop_ms < POWER_STOP_MIN_IDLE_MS) ||
+        (PowerManager_ConsoleHoldLeft(HAL_GetTick()) != 0U) ||
+        !UartTx_IsIdle() ||
+        !TelemetryUart_IsIdle() ||
+        !I2cBus_IsIdle() ||
+        !SpiBus_IsIdle() ||
+        !Uplink_IsIdle() ||
+        UsbCdc_IsActive() ||
+        PeriphPower_IsStopBlocked())
+    {
+        return 0U;
+    }
+
+    /* TIM8 halts in STOP: sleep only between flashes, up to the next one. */
+    uint32_t led_ms = StatusLed_GetStopBudgetMs();
+    if (led_ms < POWER_STOP_MIN_IDLE_MS)
+    {
+        return 0U;
+    }
+    if (led_ms < *stop_ms)
+    {
+        *stop_ms = led_ms;
+    }
+
+    return states;
+}
+
+static uint64_t PowerManager_IdleCurrentUa(PowerIdleState_t state, ClockProfile_t profile)
+{
+    switch (state)
+    {
+    case POWER_IDLE_STOP_MAIN:
+        return PowerEnergy_GetCurrentUa(POWER_ENERGY_STOP_MAIN, profile);
+    case POWER_IDLE_STOP_LP:
+        return PowerEnergy_GetCurrentUa(POWER_ENERGY_STOP, profile);
+    case POWER_IDLE_STANDBY:
+        return POWER_ENERGY_STANDBY_UA;
+    default:
+        return PowerEnergy_GetCurrentUa(POWER_ENERGY_SLEEP, profile);
+    }
+}
+
+static bool PowerManager_GetIdleOverhead(PowerIdleState_t state, ClockProfile_t profile,
+                                         uint64_t *time_us, uint64_t *charge_uAus)
+{
+    const PowerTransitionStats_t *cost = &s_idleCost[state];
+
+    if (cost->count > 0U)
+    {
+        *time_us     = cost->total_us / cost->count;
+        *charge_uAus = cost->charge_uAus / cost->count;
+        return true;
+    }
+
+    /* Not entered yet: the estimate, at the run current it is spent at.
+     * A STANDBY wakeup starts from reset, on HSI.
+     */
+    switch (state)
+    {
+    case POWER_IDLE_STOP_MAIN:
+        *time_us = POWER_IDLE_STOP_MAIN_US;
+        break;
+    case POWER_IDLE_STOP_LP:
+        *time_us = POWER_IDLE_STOP_LP_US;
+        break;
+    case POWER_IDLE_STANDBY:
+        *time_us = POWER_IDLE_STANDBY_US;
+        profile  = CLOCK_PROFILE_LOW_POWER;
+        break;
+    default:
+        *time_us = 0U;
+        break;
+    }
+    *charge_uAus = *time_us * PowerEnergy_GetCurrentUa(POWER_ENERGY_RUN, profile);
+
+    return false;
+}
+
+static void PowerManager_RecordTransition(PowerTransitionStats_t *stats, uint32_t clock_us,
+                                          uint32_t other_us, uint64_t charge_uAus)
+{
+    uint32_t time_us = clock_us + other_us;
+
+    stats->count++;
+    stats->last_us      = time_us;
+    stats->total_us    += time_us;
+    stats->charge_uAus += charge_uAus;
+    if (time_us > stats->max_us)
+    {
+        stats->max_us = time_us;
+    }
+    if (clock_us > stats->clockMax_us)
+    {
+        stats->clockMax_us = clock_us;
+    }
+    if (other_us > stats->otherMax_us)
+    {
+        stats->otherMax_us = other_us;
+    }
+
+    uint32_t bucket = 0U;
+    if (time_us >= 16U)
+    {
+        bucket = (31U - __CLZ(time_us)) - 3U;
+        if (bucket >= POWER_TRANSITION_BUCKETS)
+        {
+            bucket = POWER_TRANSITION_BUCKETS - 1U;
+        }
+    }
+    stats->hist[bucket]++;
+}
+
+static void PowerManager_SaveClocks(PowerClockState_t *state)
+{
+    state->sysclkSource = RCC->CFGR & RCC_CFGR_SW;
+    state->hseOn        = ((RCC->CR & RCC_CR_HSEON) != 0U);
+    state->pllOn        = ((RCC->CR & RCC_CR_PLLON) != 0U);
+    state->pllSaiOn     = ((RCC->CR & RCC_CR_PLLSAION) != 0U);
+    state->overDrive    = ((PWR->CR & PWR_CR_ODEN) != 0U);
+}
+
+static void PowerManager_RestoreClocks(const PowerClockState_t *state)
+{
+    if (state->hseOn)
+    {
+        RCC->CR |= RCC_CR_HSEON;
+        while ((RCC->CR & RCC_CR_HSERDY) == 0U)
+        {
+        }
+    }
+
+    if (state->pllOn)
+    {
+        RCC->CR |= RCC_CR_PLLON;
+        while ((RCC->CR & RCC_CR_PLLRDY) == 0U)
+        {
+        }
+    }
+
+    if (state->pllSaiOn)
+    {
+        RCC->CR |= RCC_CR_PLLSAION;
+        while ((RCC->CR & RCC_CR_PLLSAIRDY) == 0U)
+        {
+        }
+    }
+
+    if (state->overDrive)
+    {
+        PWR->CR |= PWR_CR_ODEN;
+        while ((PWR->CSR & PWR_CSR_ODRDY) == 0U)
+        {
+        }
+        PWR->CR |= PWR_CR_ODSWEN;
+        while ((PWR->CSR & PWR_CSR_ODSWRDY) == 0U)
+        {
+        }
+    }
+
+    if (state->sysclkSource != RCC_CFGR_SW_HSI)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | state->sysclkSource;
+        while ((RCC->CFGR & RCC_CFGR_SWS) != (state->sysclkSource << RCC_CFGR_SWS_Pos))
+        {
+        }
+    }
+}
+
+static void PowerManager_ApplyWakeSources(uint32_t sources)
+{
+    s_wakeSources = sources;
+
+    /* The button stays enabled outside STOP so its events are not lost;
+     * in STOP it only wakes the MCU if selected.
+     */
+    if ((sources == 0U) || ((sources & POWER_WAKE_SRC_BUTTON) != 0U))
+    {
+        HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+    }
+    else
+    {
+        HAL_NVIC_DisableIRQ(EXTI15_10_IRQn);
+    }
+
+    LOG_DEBUG("PowerManager: STOP wake sources = 0x%02lx", (unsigned long)sources);
+}
+
+static void PowerManager_ApplyClockProfile(PowerMode_t mode)
+{
+    ClockProfile_t profile;
+
+    switch (mode)
+    {
+        case POWER_MODE_ACTIVE:
+            profile = POWER_CLOCK_PROFILE_ACTIVE;
+            break;
+
+        case POWER_MODE_IDLE:
+            profile = POWER_CLOCK_PROFILE_IDLE;
+            break;
+
+        case POWER_MODE_SLEEP:
+            profile = POWER_CLOCK_PROFILE_SLEEP;
+            break;
+
+        case POWER_MODE_STOP:
+        default:
+            profile = POWER_CLOCK_PROFILE_STOP;
+            break;
+    }
+
+    if (profile == ClockProfile_GetCurrent())
+    {
+        return;
+    }
+
+    if (ClockProfile_Apply(profile))
+    {
+        LOG_INFO("PowerManager: clock profile %s (%lu MHz)",
+                 ClockProfile_GetName(profile),
+                 (unsigned long)(SystemCoreClock / 1000000U));
+    }
+    else
+    {
+        LOG_ERROR("PowerManager: failed to apply clock profile %s",
+                  ClockProfile_GetName(profile));
+    }
+}
+
+static void PowerManager_RunPolicy(void)
+{
+    /* Tick and activity time are read together, so the activity can never
+     * look newer than "now" under a preemptive scheduler.
+     */
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t now_ms   = HAL_GetTick();
+    uint32_t inactive = now_ms - s_lastActivity_ms;
+    bool     wake     = s_wakePending;
+    s_wakePending     = false;
+
+    __set_PRIMASK(primask);
+
+    if (s_requestedMode != s_currentMode)
+    {
+        return;
+    }
+
+    if (wake)
+    {
+        if (s_currentMode != POWER_MODE_ACTIVE)
+        {
+            s_requestedMode = POWER_MODE_ACTIVE;
+            s_stats.autoWakeups++;
+            LOG_INFO("PowerManager: activity, waking to ACTIVE");
+        }
+        return;
+    }
+
+    if ((now_ms - s_modeEntered_ms) < POWER_AUTO_MIN_DWELL_MS)
+    {
+        return;
+    }
+
+    if ((s_currentMode == POWER_MODE_ACTIVE) && (inactive >= POWER_AUTO_IDLE_AFTER_MS))
+    {
+        s_requestedMode = POWER_MODE_IDLE;
+    }
+    else if ((s_currentMode == POWER_MODE_IDLE) && (inactive >= POWER_AUTO_SLEEP_AFTER_MS))
+    {
+        s_requestedMode = POWER_MODE_SLEEP;
+    }
+    else
+    {
+        return;
+    }
+
+    s_stats.autoStepDowns++;
+    LOG_INFO("PowerManager: inactive for %lu ms, stepping down to %d",
+             (unsigned long)inactive, (int)s_requestedMode);
+}
+
+static uint32_t PowerManager_ConsoleHoldLeft(uint32_t now_ms)
+{
+    if (!s_consoleHold)
+    {
+        return 0U;
+    }
+
+    uint32_t held_ms = now_ms - s_console_ms;
+    if (held_ms >= POWER_CONSOLE_HOLD_MS)
+    {
+        s_consoleHold = false;
+        return 0U;
+    }
+
+    return POWER_CONSOLE_HOLD_MS - held_ms;
+}
+
+static uint32_t PowerManager_GaugeInactive(void)
+{
+    return HAL_GetTick() - s_lastActivity_ms;
+}
+
+static uint32_t PowerManager_GaugeConsoleHold(void)
+{
+    return PowerManager_ConsoleHoldLeft(HAL_GetTick());
+}
+
+static uint32_t PowerManager_GaugeStopOverhead(void)
+{
+    const PowerTransitionStats_t *cost = &s_idleCost[POWER_IDLE_STOP_LP];
+
+    return (cost->count > 0U) ? (uint32_t)(cost->total_us / cost->count) : 0U;
+}
+
+static uint32_t PowerManager_GaugeStopBreakEven(void)
+{
+    PowerIdleStats_t stats;
+
+    (void)PowerManager_GetIdleStats(POWER_IDLE_STOP_LP, &stats);
+    return stats.breakEven_ms;
+}
+
+static uint32_t PowerManager_GaugeStopMainBreakEven(void)
+{
+    PowerIdleStats_t stats;
+
+    (void)PowerManager_GetIdleStats(POWER_IDLE_STOP_MAIN, &stats);
+    return stats.breakEven_ms;
+}
+
+static void PowerManager_PublishMetrics(void)
+{
+    Metrics_Publish(METRIC_IDLE_ENTRIES, &s_stats.idleEntries);
+    Metrics_Publish(METRIC_TICKLESS_ENTRIES, &s_stats.ticklessEntries);
+    Metrics_Publish(METRIC_EARLY_WAKEUPS, &s_stats.earlyWakeups);
+    Metrics_Publish(METRIC_SLEEP_MS, &s_stats.sleepTime_ms);
+    Metrics_Publish(METRIC_STOP_ENTRIES, &s_stats.stopEntries);
+    Metrics_Publish(METRIC_STOP_MS, &s_stats.stopTime_ms);
+    Metrics_Publish(METRIC_WAKE_SOURCE, &s_stats.lastWakeSource);
+    Metrics_Publish(METRIC_WAKE_LATENCY_US, &s_stats.lastWakeLatency_us);
+    Metrics_Publish(METRIC_WAKE_LATENCY_MAX_US, &s_stats.maxWakeLatency_us);
+    Metrics_Publish(METRIC_UART_WAKES, &s_stats.uartWakes);
+    Metrics_Publish(METRIC_AUTO_STEP_DOWNS, &s_stats.autoStepDowns);
+    Metrics_Publish(METRIC_AUTO_WAKEUPS, &s_stats.autoWakeups);
+    Metrics_PublishGauge(METRIC_INACTIVE_MS, PowerManager_GaugeInactive);
+    Metrics_PublishGauge(METRIC_CONSOLE_HOLD_MS, PowerManager_GaugeConsoleHold);
+    Metrics_Publish(METRIC_POWER_TRANSITIONS, &s_transitionCount);
+    Metrics_Publish(METRIC_POWER_TRANSITION_MAX_US, &s_transitionMax_us);
+    Metrics_PublishGauge(METRIC_STOP_OVERHEAD_US, PowerManager_GaugeStopOverhead);
+    Metrics_PublishGauge(METRIC_STOP_BREAK_EVEN_MS, PowerManager_GaugeStopBreakEven);
+    Metrics_Publish(METRIC_STOP_SKIPPED, &s_stats.stopSkipped);
+    Metrics_Publish(METRIC_STOP_MAIN_ENTRIES, &s_idleEntries[POWER_IDLE_STOP_MAIN]);
+    Metrics_PublishGauge(METRIC_STOP_MAIN_BREAK_EVEN_MS, PowerManager_GaugeStopMainBreakEven);
 }
@@ -30,16 +30,122 @@ extern "C" {
  * @brief High-level power modes for the system.
  *
  * The enumeration is intentionally abstract and decoupled from specific
- * STM32 low-power modes. Later phases may map these to SLEEP/STOP/STANDBY.
+ * STM32 low-power modes. Between task deadlines the idle governor picks
+ * core SLEEP (WFI) or STM32 STOP per idle period (PowerIdleState_t);
+ * STOP idles in STM32 STOP mode whenever the period allows it.
  */
 typedef enum
 {
     POWER_MODE_ACTIVE = 0U,  /**< Full-speed operation, all tasks running. */
     POWER_MODE_IDLE,         /**< Reduced activity, only essential tasks.  */
     POWER_MODE_SLEEP,        /**< Light sleep; quick wake-up expected.     */
-    POWER_MODE_STOP          /**< Deeper low-power state (future use).     */
+    POWER_MODE_STOP,         /**< STM32 STOP between deadlines.            */
+    POWER_MODE_COUNT         /**< Number of modes (not a valid mode).      */
 } PowerMode_t;
 
+/**
+ * @brief Sources of activity for the adaptive power policy.
+ */
+typedef enum
+{
+    POWER_ACTIVITY_CLI = 0U, /**< CLI input received; wakes at once.      */
+    POWER_ACTIVITY_BUTTON,   /**< User button pressed; wakes at once.     */
+    POWER_ACTIVITY_SENSOR,   /**< Sensor value left its deadband.        */
+    POWER_ACTIVITY_ALARM     /**< Sensor alarm raised; wakes at once.     */
+} PowerActivity_t;
+
+/**
+ * @brief Cumulative low-power statistics.
+ *
+ * Updated by PowerManager_IdleFor(). All values count from
+ * PowerManager_Init().
+ */
+typedef struct
+{
+    uint32_t idleEntries;     /**< Number of times the core entered WFI.          */
+    uint32_t ticklessEntries; /**< Entries where SysTick was stretched (> 1 ms).  */
+    uint32_t earlyWakeups;    /**< Tickless sleeps cut short by an interrupt.     */
+    uint32_t sleepTime_ms;    /**< Total whole ticks spent asleep.                */
+    uint32_t stopEntries;     /**< Number of STOP-mode entries.                   */
+    uint32_t stopTime_ms;     /**< Total time spent in STOP (RTC measured).       */
+    uint32_t lastWakeSource;  /**< POWER_WAKE_SRC_* bits that ended the last STOP. */
+    uint32_t lastWakeLatency_us; /**< Clock restore time after the last STOP.     */
+    uint32_t maxWakeLatency_us;  /**< Worst clock restore time seen.              */
+    uint32_t autoStepDowns;   /**< Mode reductions made by the adaptive policy.   */
+    uint32_t autoWakeups;     /**< Returns to ACTIVE made by the adaptive policy. */
+    uint32_t inactive_ms;     /**< Time since the last activity.                  */
+    uint32_t uartWakes;       /**< STOP exits caused by UART RX.                  */
+    uint32_t consoleHold_ms;  /**< Time left before STOP may be entered again.    */
+    uint32_t stopSkipped;     /**< Idle periods where SLEEP beat a possible STOP. */
+} PowerStats_t;
+
+/**
+ * @brief Low-power states an idle period can be spent in, shallowest first.
+ *
+ * PowerManager_IdleFor() picks one for every idle period
+ * (PowerManager_SelectIdleState()). STANDBY is not entered per idle
+ * period: it is the duty cycle of power_standby.h, which the application
+ * starts when the selection picks it for the sample period.
+ */
+typedef enum
+{
+    POWER_IDLE_WFI = 0U,   /**< One WFI, up to the next tick.                     */
+    POWER_IDLE_SLEEP,      /**< Tickless SLEEP: WFI with SysTick stretched.       */
+    POWER_IDLE_STOP_MAIN,  /**< STOP on the main regulator, flash on.             */
+    POWER_IDLE_STOP_LP,    /**< STOP with @ref POWER_STOP_LOW_POWER_REGULATOR and
+                                @ref POWER_STOP_FLASH_POWER_DOWN.               */
+    POWER_IDLE_STANDBY,    /**< STANDBY duty cycle (power_standby.h).             */
+    POWER_IDLE_STATE_COUNT /**< Number of states (not a valid state).             */
+} PowerIdleState_t;
+
+/** @brief Bit of @p state in the @c allowed mask of PowerManager_SelectIdleState(). */
+#define POWER_IDLE_ALLOW(state)   (1UL << (uint32_t)(state))
+
+/**
+ * @brief Number of buckets in the transition time histograms.
+ *
+ * Bucket 0 counts transitions under 16 us; bucket i counts
+ * [2^(i+3), 2^(i+4)) us; the last bucket is open-ended (>= 4 ms).
+ */
+#define POWER_TRANSITION_BUCKETS  (10U)
+
+/**
+ * @brief Measured cost of one kind of power transition.
+ *
+ * For a mode change (PowerManager_GetTransition()) the first phase is the
+ * clock profile switch and the second the peripheral clock gating, uplink
+ * and wake source setup. For a STOP entry and exit
+ * (PowerIdleStats_t::cost) the first phase is the clock restore after
+ * the wake and the second the preparation before WFI. Times come from
+ * the time base and the DWT cycle counter; the charge applies the run
+ * current of the energy model (power_energy.h) to them.
+ */
+typedef struct
+{
+    uint32_t count;        /**< Transitions measured.                      */
+    uint32_t last_us;      /**< Duration of the last one.                  */
+    uint32_t max_us;       /**< Longest one.                               */
+    uint32_t clockMax_us;  /**< Longest first (clock) phase.               */
+    uint32_t otherMax_us;  /**< Longest second phase.                      */
+    uint64_t total_us;     /**< Sum of all durations, for the average.     */
+    uint64_t charge_uAus;  /**< Charge drawn during them, in uA x us.      */
+    uint32_t hist[POWER_TRANSITION_BUCKETS]; /**< Duration histogram.     */
+} PowerTransitionStats_t;
+
+/**
+ * @brief Use and cost of one idle state.
+ */
+typedef struct
+{
+    uint32_t entries;      /**< Idle periods spent in the state.                    */
+    uint64_t time_us;      /**< Time spent in them.                                 */
+    uint32_t overhead_us;  /**< Entry and exit time: measured average or estimate.  */
+    bool     measured;     /**< overhead_us is measured (cost.count > 0).           */
+    uint32_t breakEven_ms; /**< Shortest idle period for which it draws less than
+                                SLEEP; 0 for WFI and SLEEP, UINT32_MAX if never. */
+    PowerTransitionStats_t cost; /**< Measured entries and exits (STOP states).   */
+} PowerIdleStats_t;
+
 /**
  * @brief Initialize the power manager module.
  *
@@ -64,6 +170,43 @@ void PowerManager_Init(void);
  */
 void PowerManager_RequestMode(PowerMode_t mode);
 
+/**
+ * @brief Enable or disable the adaptive power policy.
+ *
+ * While enabled, PowerManager_Update() steps ACTIVE down to IDLE and IDLE
+ * down to SLEEP after the inactivity times in app_config.h, and returns
+ * to ACTIVE on activity (see PowerManager_NotifyActivity()). Enabling it
+ * restarts the inactivity timer.
+ *
+ * @param enable true to enable, false for manual mode control only.
+ *
+ * @return None.
+ */
+void PowerManager_SetAutoPolicy(bool enable);
+
+/**
+ * @brief Check whether the adaptive power policy is enabled.
+ *
+ * @return true if enabled.
+ */
+bool PowerManager_IsAutoPolicy(void);
+
+/**
+ * @brief Report activity to the adaptive power policy.
+ *
+ * Restarts the inactivity timer. CLI and button activity request ACTIVE
+ * immediately; sensor activity does so only after
+ * @ref POWER_AUTO_SENSOR_WAKE_COUNT changes within
+ * @ref POWER_AUTO_SENSOR_WAKE_WINDOW_MS. The mode change itself is applied
+ * by the next PowerManager_Update(). While the policy is off only the
+ * inactivity time (see PowerStats_t) is updated.
+ *
+ * @param source What was active.
+ *
+ * @return None.
+ */
+void PowerManager_NotifyActivity(PowerActivity_t source);
+
 /**
  * @brief Get the currently active power mode.
  *
@@ -79,13 +222,134 @@ PowerMode_t PowerManager_GetCurrentMode(void);
  * requests and policies and, if needed, triggers logging or future
  * low-power transitions.
  *
- * In Phase 3, it only logs state changes; actual low-power entry will
- * be implemented in later phases.
+ * Runs the adaptive policy when it is enabled, then applies pending mode
+ * changes, including the uplink burst interval (Uplink_OnPowerMode()). When entering POWER_MODE_STOP it arms
+ * the wake sources from @ref POWER_STOP_WAKE_SOURCES; the STOP entry
+ * itself happens in PowerManager_IdleFor() whenever the idle budget is
+ * long enough.
  *
  * @return None.
  */
 void PowerManager_Update(void);
 
+/**
+ * @brief Sleep the core until the next scheduler deadline (tickless idle).
+ *
+ * Called from the main loop when no task is due. For budgets of two ticks
+ * or more the SysTick reload is stretched to cover the whole idle period,
+ * so the core is not woken every millisecond; any other interrupt (UART,
+ * DMA, EXTI) still wakes it immediately. On wake the HAL tick is advanced
+ * by the number of whole ticks that elapsed and the normal 1 ms SysTick
+ * period is restored without losing the partial tick.
+ *
+ * In ACTIVE, IDLE and SLEEP the core enters SLEEP (WFI), so peripherals
+ * and DMA keep running. In STOP, and when the budget is at least
+ * @ref POWER_STOP_MIN_IDLE_MS, both UARTs have finished transmitting and
+ * no I2C transaction or SPI frame is queued and the uplink modem is off
+ * (uplink.h), the MCU enters STOP instead: the RTC wakeup timer is
+ * programmed for the deadline, clocks are restored on wake, and the HAL tick is
+ * advanced by the RTC-measured sleep time.
+ *
+ * Which of SLEEP, STOP on the main regulator and STOP on the low-power
+ * regulator with flash power-down is used is decided per idle period by
+ * PowerManager_SelectIdleState(), from the measured entry and exit cost
+ * of each. With @ref POWER_IDLE_GOVERNOR the STOP states are used in every
+ * power mode, whenever no peripheral that stops in STOP (ADC scan, sync
+ * timer, USB) is in use and the status LED is between flashes.
+ *
+ * For @ref POWER_CONSOLE_HOLD_MS after CLI input or a UART wake, SLEEP is
+ * used instead of STOP so that the console stays interactive. Bytes that
+ * arrive while the clocks are restored after a UART wake are received
+ * by DMA at the HSI baud divider and kept.
+ *
+ * @param maxIdle_ms Idle budget in ms, typically from
+ *                   AppTaskManager_GetTimeUntilNextDeadline().
+ *
+ * @return Number of whole ticks that elapsed while asleep.
+ */
+uint32_t PowerManager_IdleFor(uint32_t maxIdle_ms);
+
+/**
+ * @brief Get a snapshot of the low-power statistics.
+ *
+ * @param[out] stats Destination for the statistics. Must not be NULL.
+ *
+ * @return None.
+ */
+void PowerManager_GetStats(PowerStats_t *stats);
+
+/**
+ * @brief Get the measured cost of the mode changes from one mode to another.
+ *
+ * Every change applied by PowerManager_Update() is timed and added to the
+ * statistics of its (from, to) pair.
+ *
+ * @param from       Mode left.
+ * @param to         Mode entered.
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return false if @p from equals @p to or either is not a mode.
+ */
+bool PowerManager_GetTransition(PowerMode_t from, PowerMode_t to, PowerTransitionStats_t *stats);
+
+/**
+ * @brief Choose the idle state that draws the least charge over an idle period.
+ *
+ * The idle governor: for each allowed state the charge of an idle period
+ * of @p idle_ms is its entry and exit overhead plus the rest of the period
+ * at its current, with the currents of the energy model (power_energy.h)
+ * for the current clock profile. A state whose overhead does not fit in
+ * the period is not chosen. The overhead is the measured average once the
+ * state has been entered, and the estimate from app_config.h
+ * (POWER_IDLE_*_US) before.
+ *
+ * @param idle_ms Length of the idle period.
+ * @param allowed POWER_IDLE_ALLOW() bits of the states to choose from.
+ *
+ * @return Chosen state; POWER_IDLE_SLEEP (or POWER_IDLE_WFI under 2 ms)
+ *         if no allowed deeper state pays off.
+ */
+PowerIdleState_t PowerManager_SelectIdleState(uint32_t idle_ms, uint32_t allowed);
+
+/**
+ * @brief Get the use and cost of an idle state.
+ *
+ * @param state      Idle state.
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return false if @p state is not an idle state.
+ */
+bool PowerManager_GetIdleStats(PowerIdleState_t state, PowerIdleStats_t *stats);
+
+/**
+ * @brief Name of an idle state ("WFI", "SLEEP", "STOP_MAIN", ...).
+ *
+ * @param state Idle state.
+ *
+ * @return Name, or "?".
+ */
+const char *PowerManager_GetIdleStateName(PowerIdleState_t state);
+
+/**
+ * @brief Clear the transition, idle state and STOP cost statistics.
+ *
+ * The idle governor falls back to the estimates until the STOP states
+ * have been measured again.
+ *
+ * @return None.
+ */
+void PowerManager_ResetTransitions(void);
+
+/**
+ * @brief EXTI line 3 (USART2 RX wake) interrupt handler body.
+ *
+ * Called from EXTI3_IRQHandler(). The line is only unmasked while in
+ * STOP; this clears the pending flag if it fires after wake-up.
+ *
+ * @return None.
+ */
+void PowerManager_UartWakeIrqHandler(void);
+
 /** @} */ /* end of power group */
 
 #ifdef __cplusplus
@@ -0,0 +1,308 @@
+/**
+ * @file power_rtc.c
+ * @brief Register-level RTC setup, millisecond clock and wakeup timer.
+ *
+ * Clocking:
+ * - RTCCLK = LSI (~32 kHz)
+ * - Asynchronous prescaler /32  -> 1 kHz sub-second counter (SSR)
+ * - Synchronous prescaler /1000 -> 1 Hz calendar
+ * - Wakeup timer clocked at RTCCLK/16 (2 kHz), or at 1 Hz (ck_spre) for
+ *   the long STANDBY periods
+ *
+ * Shadow registers are bypassed (BYPSHAD) so the counters can be read
+ * immediately after leaving STOP without waiting for a resynchronization.
+ *
+ * @ingroup power_rtc
+ */
+
+#include "power_rtc.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Asynchronous prescaler value (divide by PREDIV_A + 1). */
+#define POWER_RTC_PREDIV_A        (31U)
+
+/** @brief Synchronous prescaler value (divide by PREDIV_S + 1). */
+#define POWER_RTC_PREDIV_S        (999U)
+
+/** @brief Wakeup timer ticks per millisecond (RTCCLK/16). */
+#define POWER_RTC_WUT_PER_MS      ((POWER_RTC_LSI_HZ / 16U) / 1000U)
+
+/** @brief Milliseconds in one RTC calendar day. */
+#define POWER_RTC_DAY_MS          (86400000UL)
+
+/**
+ * @brief Poll limit for oscillator and RTC handshakes.
+ *
+ * A loop count rather than a tick timeout, because the wakeup timer is
+ * programmed with interrupts masked and HAL_GetTick() does not advance.
+ * The handshakes take a few RTCCLK cycles (~100 us); this bound is
+ * several ms even at 180 MHz.
+ */
+#define POWER_RTC_WAIT_LOOPS      (200000U)
+
+/**
+ * @brief Remove RTC register write protection.
+ */
+static inline void PowerRtc_Unlock(void)
+{
+    RTC->WPR = 0xCAU;
+    RTC->WPR = 0x53U;
+}
+
+/**
+ * @brief Restore RTC register write protection.
+ */
+static inline void PowerRtc_Lock(void)
+{
+    RTC->WPR = 0xFFU;
+}
+
+/**
+ * @brief Clear RTC ISR flags without touching the INIT bit.
+ *
+ * @param flags ISR flags to clear.
+ */
+static inline void PowerRtc_ClearFlags(uint32_t flags)
+{
+    RTC->ISR = ~(flags | RTC_ISR_INIT) | (RTC->ISR & RTC_ISR_INIT);
+}
+
+/**
+ * @brief Wait until @p mask is set in @p reg, with a bounded poll.
+ *
+ * @return true if the bits were set before the poll limit.
+ */
+static bool PowerRtc_WaitSet(volatile uint32_t *reg, uint32_t mask);
+
+/**
+ * @brief Convert a two-digit BCD value to binary.
+ */
+static inline uint32_t PowerRtc_Bcd(uint32_t tens, uint32_t units)
+{
+    return (tens * 10U) + units;
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool PowerRtc_Init(void)
+{
+    /* LSI runs in every low-power mode except VBAT-only. */
+    RCC->CSR |= RCC_CSR_LSION;
+    if (!PowerRtc_WaitSet(&RCC->CSR, RCC_CSR_LSIRDY))
+    {
+        return false;
+    }
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    PWR->CR |= PWR_CR_DBP;
+
+    /* The RTC clock source can only be changed after a backup domain reset. */
+    uint32_t rtcsel = RCC->BDCR & RCC_BDCR_RTCSEL;
+    if ((rtcsel != 0U) && (rtcsel != RCC_BDCR_RTCSEL_1))
+    {
+        RCC->BDCR |= RCC_BDCR_BDRST;
+        RCC->BDCR &= ~RCC_BDCR_BDRST;
+    }
+
+    RCC->BDCR = (RCC->BDCR & ~RCC_BDCR_RTCSEL) | RCC_BDCR_RTCSEL_1 | RCC_BDCR_RTCEN;
+
+    uint32_t prer = (POWER_RTC_PREDIV_A << RTC_PRER_PREDIV_A_Pos) | POWER_RTC_PREDIV_S;
+    bool configured = ((RTC->ISR & RTC_ISR_INITS) != 0U) && (RTC->PRER == prer);
+
+    PowerRtc_Unlock();
+
+    if (!configured)
+    {
+        RTC->ISR |= RTC_ISR_INIT;
+        if (!PowerRtc_WaitSet(&RTC->ISR, RTC_ISR_INITF))
+        {
+            PowerRtc_Lock();
+            return false;
+        }
+
+        /* The two prescalers must be written separately, synchronous first. */
+        RTC->PRER = POWER_RTC_PREDIV_S;
+        RTC->PRER = prer;
+        RTC->TR   = 0U;
+        RTC->CR  &= ~RTC_CR_FMT;
+
+        RTC->ISR &= ~RTC_ISR_INIT;
+    }
+
+    RTC->CR |= RTC_CR_BYPSHAD;
+    PowerRtc_Lock();
+
+    /* Wakeup events reach the core through EXTI line 22. */
+    EXTI->RTSR |= EXTI_RTSR_TR22;
+    EXTI->IMR  |= EXTI_IMR_MR22;
+
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, IRQ_PRIO_RTC_WAKEUP, 0U);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+    return true;
+}
+
+uint32_t PowerRtc_GetMs(void)
+{
+    uint32_t ssr;
+    uint32_t tr;
+
+    /* With shadow registers bypassed, re-read until SSR is stable so that
+     * TR and SSR belong to the same second.
+     */
+    do
+    {
+        ssr = RTC->SSR;
+        tr  = RTC->TR;
+    } while (ssr != RTC->SSR);
+
+    uint32_t hours   = PowerRtc_Bcd((tr & RTC_TR_HT) >> RTC_TR_HT_Pos, (tr & RTC_TR_HU) >> RTC_TR_HU_Pos);
+    uint32_t minutes = PowerRtc_Bcd((tr & RTC_TR_MNT) >> RTC_TR_MNT_Pos, (tr & RTC_TR_MNU) >> RTC_TR_MNU_Pos);
+    uint32_t seconds = PowerRtc_Bcd((tr & RTC_TR_ST) >> RTC_TR_ST_Pos, (tr & RTC_TR_SU) >> RTC_TR_SU_Pos);
+
+    /* SSR counts down from PREDIV_S at 1 kHz. */
+    return (((hours * 3600U) + (minutes * 60U) + seconds) * 1000U) + (POWER_RTC_PREDIV_S - ssr);
+}
+
+uint32_t PowerRtc_ElapsedMs(uint32_t start_ms, uint32_t end_ms)
+{
+    if (end_ms >= start_ms)
+    {
+        return end_ms - start_ms;
+    }
+
+    return (uint32_t)(POWER_RTC_DAY_MS - start_ms) + end_ms;
+}
+
+void PowerRtc_StartWakeup(uint32_t delay_ms)
+{
+    if (delay_ms > POWER_RTC_MAX_WAKEUP_MS)
+    {
+        delay_ms = POWER_RTC_MAX_WAKEUP_MS;
+    }
+
+    uint32_t ticks = delay_ms * POWER_RTC_WUT_PER_MS;
+    if (ticks == 0U)
+    {
+        ticks = 1U;
+    }
+
+    PowerRtc_Unlock();
+
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    if (PowerRtc_WaitSet(&RTC->ISR, RTC_ISR_WUTWF))
+    {
+        /* WUCKSEL = 000: RTCCLK/16. */
+        RTC->WUTR = ticks - 1U;
+        RTC->CR   = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUTIE | RTC_CR_WUTE;
+    }
+
+    PowerRtc_ClearFlags(RTC_ISR_WUTF);
+    EXTI->PR = EXTI_PR_PR22;
+
+    PowerRtc_Lock();
+}
+
+void PowerRtc_StartWakeupSeconds(uint32_t delay_s)
+{
+    if (delay_s > POWER_RTC_MAX_WAKEUP_S)
+    {
+        delay_s = POWER_RTC_MAX_WAKEUP_S;
+    }
+    if (delay_s == 0U)
+    {
+        delay_s = 1U;
+    }
+
+    PowerRtc_Unlock();
+
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    if (PowerRtc_WaitSet(&RTC->ISR, RTC_ISR_WUTWF))
+    {
+        /* WUCKSEL = 10x: ck_spre, the 1 Hz calendar clock. */
+        RTC->WUTR = delay_s - 1U;
+        RTC->CR   = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUCKSEL_2 | RTC_CR_WUTIE | RTC_CR_WUTE;
+    }
+
+    PowerRtc_ClearFlags(RTC_ISR_WUTF);
+    EXTI->PR = EXTI_PR_PR22;
+
+    PowerRtc_Lock();
+}
+
+void PowerRtc_StopWakeup(void)
+{
+    PowerRtc_Unlock();
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    PowerRtc_ClearFlags(RTC_ISR_WUTF);
+    PowerRtc_Lock();
+
+    EXTI->PR = EXTI_PR_PR22;
+    HAL_NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+}
+
+void PowerRtc_SetButtonWake(bool enable)
+{
+    PowerRtc_Unlock();
+
+    /* TSE must be off while the edge is changed. */
+    RTC->CR &= ~(RTC_CR_TSE | RTC_CR_TSIE);
+    if (enable)
+    {
+        /* TSINSEL = 0: PC13. Falling edge: B1 pulls the pin low. */
+        RTC->TAFCR &= ~RTC_TAFCR_TSINSEL;
+        RTC->CR    |= RTC_CR_TSEDGE;
+        RTC->CR    |= RTC_CR_TSIE | RTC_CR_TSE;
+    }
+    PowerRtc_ClearFlags(RTC_ISR_TSF | RTC_ISR_TSOVF);
+
+    PowerRtc_Lock();
+}
+
+uint32_t PowerRtc_TakeWakeEvents(void)
+{
+    uint32_t isr    = RTC->ISR;
+    uint32_t events = 0U;
+
+    if ((isr & RTC_ISR_WUTF) != 0U)
+    {
+        events |= POWER_RTC_EVENT_TIMER;
+    }
+    if ((isr & RTC_ISR_TSF) != 0U)
+    {
+        events |= POWER_RTC_EVENT_BUTTON;
+    }
+
+    PowerRtc_ClearFlags(RTC_ISR_WUTF | RTC_ISR_TSF | RTC_ISR_TSOVF);
+    EXTI->PR = EXTI_PR_PR22;
+
+    return events;
+}
+
+void PowerRtc_WakeupIrqHandler(void)
+{
+    if ((RTC->ISR & RTC_ISR_WUTF) != 0U)
+    {
+        PowerRtc_ClearFlags(RTC_ISR_WUTF);
+    }
+
+    EXTI->PR = EXTI_PR_PR22;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool PowerRtc_WaitSet(volatile uint32_t *reg, uint32_t mask)
+{
+    for (uint32_t i = 0U; i < POWER_RTC_WAIT_LOOPS; ++i)
+    {
+        if ((*reg & mask) == mask)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
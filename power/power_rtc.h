@@ -0,0 +1,157 @@
+/**
+ * @file power_rtc.h
+ * @brief Minimal RTC driver for low-power timekeeping and wakeup.
+ *
+ * The RTC keeps counting in STOP mode when SysTick does not, so it is
+ * used both to wake the MCU after a programmed interval and to measure
+ * how long the MCU actually slept. The RTC runs from the LSI oscillator
+ * and is programmed at register level (the HAL RTC module is not part of
+ * this project).
+ *
+ * @ingroup power
+ */
+
+#ifndef POWER_RTC_H
+#define POWER_RTC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup power_rtc RTC Wakeup Timer
+ * @brief RTC millisecond clock and wakeup timer used by the power manager.
+ * @ingroup power
+ * @{
+ */
+
+/**
+ * @brief Nominal LSI frequency in Hz.
+ *
+ * The F446 LSI is specified at 32 kHz typical with a wide tolerance, so
+ * sleep durations measured with the RTC carry the same error (a few %).
+ */
+#define POWER_RTC_LSI_HZ          (32000U)
+
+/**
+ * @brief Longest interval the wakeup timer can be programmed for (ms).
+ *
+ * The 16-bit wakeup counter is clocked at LSI/16 (2 kHz).
+ */
+#define POWER_RTC_MAX_WAKEUP_MS   (32000U)
+
+/**
+ * @brief Longest interval of PowerRtc_StartWakeupSeconds() (s).
+ *
+ * The wakeup counter is clocked by the 1 Hz calendar clock (ck_spre).
+ */
+#define POWER_RTC_MAX_WAKEUP_S    (65536U)
+
+/** @brief PowerRtc_TakeWakeEvents(): the wakeup timer fired. */
+#define POWER_RTC_EVENT_TIMER     (1UL << 0)
+
+/** @brief PowerRtc_TakeWakeEvents(): B1 was pressed (time-stamp event). */
+#define POWER_RTC_EVENT_BUTTON    (1UL << 1)
+
+/**
+ * @brief Start the LSI and configure the RTC for a 1 kHz sub-second clock.
+ *
+ * The calendar is only reset if the RTC was not already configured with
+ * the expected prescalers, so time keeps running across warm resets.
+ *
+ * @return true on success, false if the LSI or RTC failed to start.
+ */
+bool PowerRtc_Init(void);
+
+/**
+ * @brief Current RTC time of day in milliseconds.
+ *
+ * Wraps at 24 h (86 400 000 ms); use PowerRtc_ElapsedMs() for intervals.
+ *
+ * @return Milliseconds since midnight of the RTC calendar.
+ */
+uint32_t PowerRtc_GetMs(void);
+
+/**
+ * @brief Milliseconds between two PowerRtc_GetMs() readings.
+ *
+ * @param start_ms Earlier reading.
+ * @param end_ms   Later reading.
+ *
+ * @return Elapsed time, accounting for a single midnight wrap.
+ */
+uint32_t PowerRtc_ElapsedMs(uint32_t start_ms, uint32_t end_ms);
+
+/**
+ * @brief Program the wakeup timer to fire once after @p delay_ms.
+ *
+ * @param delay_ms Delay in ms, clamped to @ref POWER_RTC_MAX_WAKEUP_MS.
+ *
+ * @return None.
+ */
+void PowerRtc_StartWakeup(uint32_t delay_ms);
+
+/**
+ * @brief Program the wakeup timer to fire every @p delay_s seconds.
+ *
+ * For STANDBY periods beyond @ref POWER_RTC_MAX_WAKEUP_MS, at 1 s
+ * resolution. The timer reloads itself until PowerRtc_StopWakeup().
+ *
+ * @param delay_s Period in s, 1 to @ref POWER_RTC_MAX_WAKEUP_S.
+ *
+ * @return None.
+ */
+void PowerRtc_StartWakeupSeconds(uint32_t delay_s);
+
+/**
+ * @brief Disable the wakeup timer and clear any pending wakeup event.
+ *
+ * @return None.
+ */
+void PowerRtc_StopWakeup(void);
+
+/**
+ * @brief Let a press of B1 wake the MCU from STANDBY.
+ *
+ * B1 is on PC13, the RTC time-stamp input (RTC_AF1): a falling edge
+ * raises a time-stamp event, which wakes the MCU from STANDBY. The pin
+ * belongs to the RTC while this is on, so the B1 EXTI interrupt does not
+ * fire; turn it off on the way back to a full boot. (The WKUP pins are
+ * no use on this board: PC13 idles high, and WKUP wakes on a rising
+ * edge.)
+ *
+ * @param enable true to arm the time-stamp wakeup, false to release PC13.
+ *
+ * @return None.
+ */
+void PowerRtc_SetButtonWake(bool enable);
+
+/**
+ * @brief Read and clear the RTC wakeup events.
+ *
+ * After a STANDBY wakeup, tells the wakeup timer from a button press.
+ *
+ * @return POWER_RTC_EVENT_* bits.
+ */
+uint32_t PowerRtc_TakeWakeEvents(void);
+
+/**
+ * @brief RTC wakeup interrupt handler body.
+ *
+ * Called from RTC_WKUP_IRQHandler(). Clears the wakeup flag and the
+ * associated EXTI line.
+ *
+ * @return None.
+ */
+void PowerRtc_WakeupIrqHandler(void);
+
+/** @} */ /* end of power_rtc group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_RTC_H */
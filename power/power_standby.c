@@ -0,0 +1,342 @@
+/**
+ * @file power_standby.c
+ * @brief STANDBY duty cycle state machine and its backup SRAM buffer.
+ *
+ * The state is one struct at the top of backup SRAM. A boot finds it in
+ * one of three states: not running (period 0), entry pending (set by
+ * PowerStandby_Start() before its reset), or running. Only the wakeup
+ * path writes it while running; the full boot ends the run before the
+ * application starts, so the rest of the firmware only reads the buffer
+ * through PowerStandby_Replay().
+ *
+ * @ingroup power_standby
+ */
+
+#include "power_standby.h"
+#include "power_rtc.h"
+#include "periph_power.h"
+#include "crash_log.h"
+#include "metrics.h"
+#include "log.h"
+#include "cli.h"
+#include "time_base.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief "STBY": the backup SRAM holds duty cycle state. */
+#define POWER_STANDBY_MAGIC       (0x59425453UL)
+
+/** @brief Layout version; bump when PowerStandbyRegion_t changes. */
+#define POWER_STANDBY_VERSION     (1UL)
+
+/** @brief Backup SRAM size. */
+#define POWER_STANDBY_BKPSRAM_SIZE (4096U)
+
+/** @brief Flag: enter STANDBY on the next boot (set before the reset). */
+#define POWER_STANDBY_FLAG_ENTER  (0x01U)
+
+/**
+ * @brief Poll limit for the backup regulator to become ready.
+ *
+ * A loop count: the wakeup path runs with interrupts masked. The
+ * regulator starts in well under a ms.
+ */
+#define POWER_STANDBY_WAIT_LOOPS  (200000U)
+
+/** @brief One buffered sample. */
+typedef struct
+{
+    uint32_t tick_ms;   /**< HAL tick of the sample (carried across STANDBY). */
+    int32_t  raw;       /**< Channel 0, in units of 10^scaleExp.             */
+} PowerStandbySample_t;
+
+/** @brief Backup SRAM layout. */
+typedef struct
+{
+    uint32_t             magic;      /**< POWER_STANDBY_MAGIC.                   */
+    uint32_t             version;    /**< POWER_STANDBY_VERSION.                 */
+    uint32_t             flags;      /**< POWER_STANDBY_FLAG_* bits.             */
+    uint32_t             period_s;   /**< Wakeup period; 0: not running.         */
+    uint32_t             tick_ms;    /**< HAL tick at rtc_ms.                    */
+    uint32_t             rtc_ms;     /**< RTC reading at the latest boot.        */
+    uint32_t             wakeups;    /**< Wakeups since the run started.         */
+    uint32_t             count;      /**< Samples buffered.                      */
+    uint8_t              sensorId;   /**< Sensor of the buffered samples.        */
+    uint8_t              format;     /**< SensorFormat_t of the samples.         */
+    int8_t               scaleExp;   /**< Scale of the samples.                  */
+    uint8_t              mode;       /**< PowerMode_t the run started in.        */
+    PowerStandbySample_t samples[POWER_STANDBY_SAMPLES];
+} PowerStandbyRegion_t;
+
+_Static_assert(sizeof(PowerStandbyRegion_t) <= POWER_STANDBY_BKPSRAM_BYTES,
+               "standby buffer exceeds its backup SRAM share");
+
+/** @brief The state, overlaid on the top of backup SRAM. */
+static PowerStandbyRegion_t *const s_region =
+    (PowerStandbyRegion_t *)(BKPSRAM_BASE + POWER_STANDBY_BKPSRAM_SIZE - POWER_STANDBY_BKPSRAM_BYTES);
+
+/** @brief Why this boot is a full boot. */
+static PowerStandbyBoot_t s_boot = POWER_STANDBY_BOOT_COLD;
+
+/** @brief Mode of the run that ended at this boot. */
+static PowerMode_t s_mode = POWER_MODE_ACTIVE;
+
+/** @brief Wakeups of the run that ended at this boot (metric). */
+static uint32_t s_wakeups = 0U;
+
+/** @brief Samples replayed on this boot (metric). */
+static uint32_t s_replayed = 0U;
+
+/** @brief Period of the run that ended at this boot. */
+static uint32_t s_period_s = 0U;
+
+/** @brief Names of PowerStandbyBoot_t values. */
+static const char *const s_bootNames[] =
+{
+    [POWER_STANDBY_BOOT_COLD]   = "cold",
+    [POWER_STANDBY_BOOT_FULL]   = "buffer full",
+    [POWER_STANDBY_BOOT_BUTTON] = "button",
+    [POWER_STANDBY_BOOT_RESET]  = "reset"
+};
+
+/**
+ * @brief Advance the HAL tick by the RTC time since the latest boot.
+ */
+static void PowerStandby_CarryTick(void);
+
+/**
+ * @brief Append @p data to the buffer.
+ */
+static void PowerStandby_Append(const SensorData_t *data);
+
+/**
+ * @brief Arm the wakeup sources and enter STANDBY.
+ */
+static void PowerStandby_Enter(void) __attribute__((noreturn));
+
+/**
+ * @brief "standby" command: show the duty cycle state or enter it.
+ */
+static void PowerStandby_Cmd(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+PowerStandbyBoot_t PowerStandby_Boot(PowerStandbySampleFn_t sample)
+{
+    __HAL_RCC_PWR_CLK_ENABLE();
+    PWR->CR |= PWR_CR_DBP;
+    /* Held for good, like the crash trace. */
+    PeriphPower_Acquire(PERIPH_POWER_BKPSRAM);
+
+    if ((s_region->magic != POWER_STANDBY_MAGIC) || (s_region->version != POWER_STANDBY_VERSION))
+    {
+        /* Power-up: backup SRAM holds noise. */
+        (void)memset(s_region, 0, sizeof(*s_region));
+        s_region->magic   = POWER_STANDBY_MAGIC;
+        s_region->version = POWER_STANDBY_VERSION;
+    }
+
+    if (s_region->period_s == 0U)
+    {
+        s_boot = POWER_STANDBY_BOOT_COLD;
+        return s_boot;
+    }
+
+    bool woke = ((PWR->CSR & PWR_CSR_SBF) != 0U);
+
+    (void)PowerRtc_Init();
+    PowerStandby_CarryTick();
+    uint32_t events = PowerRtc_TakeWakeEvents();
+
+    if ((s_region->flags & POWER_STANDBY_FLAG_ENTER) != 0U)
+    {
+        s_region->flags &= ~POWER_STANDBY_FLAG_ENTER;
+        PowerStandby_Enter();
+    }
+
+    if (!woke)
+    {
+        s_boot = POWER_STANDBY_BOOT_RESET;
+    }
+    else if ((events & POWER_RTC_EVENT_BUTTON) != 0U)
+    {
+        s_boot = POWER_STANDBY_BOOT_BUTTON;
+    }
+    else
+    {
+        SensorData_t data;
+
+        s_region->wakeups++;
+        if ((sample != NULL) && sample(&data))
+        {
+            PowerStandby_Append(&data);
+        }
+        if (s_region->count < POWER_STANDBY_SAMPLES)
+        {
+            PowerStandby_Enter();
+        }
+        s_boot = POWER_STANDBY_BOOT_FULL;
+    }
+
+    /* End of the run: PC13 back to EXTI, no more RTC wakeups. */
+    s_mode     = ((uint32_t)s_region->mode < (uint32_t)POWER_MODE_COUNT) ? (PowerMode_t)s_region->mode
+                                                                         : POWER_MODE_ACTIVE;
+    s_wakeups  = s_region->wakeups;
+    s_period_s = s_region->period_s;
+    s_region->period_s = 0U;
+    PowerRtc_SetButtonWake(false);
+    PowerRtc_StopWakeup();
+
+    return s_boot;
+}
+
+void PowerStandby_Init(void)
+{
+    Metrics_Publish(METRIC_STANDBY_WAKEUPS, &s_wakeups);
+    Metrics_Publish(METRIC_STANDBY_REPLAYED, &s_replayed);
+
+    (void)CLI_RegisterCommand("standby", PowerStandby_Cmd,
+                              "[<s>] - Show the STANDBY duty cycle / enter it now");
+}
+
+PowerStandbyBoot_t PowerStandby_GetBootReason(void)
+{
+    return s_boot;
+}
+
+PowerMode_t PowerStandby_GetMode(void)
+{
+    return s_mode;
+}
+
+uint32_t PowerStandby_Replay(PowerStandbyReplayFn_t fn)
+{
+    uint32_t count  = (s_region->count <= POWER_STANDBY_SAMPLES) ? s_region->count : 0U;
+    uint32_t now_ms = HAL_GetTick();
+    uint32_t now_us = Time_NowUs32();
+
+    for (uint32_t i = 0U; (i < count) && (fn != NULL); ++i)
+    {
+        const PowerStandbySample_t *rec  = &s_region->samples[i];
+        SensorData_t                data = { .sensorId = s_region->sensorId };
+
+        SensorData_Init(&data, (SensorFormat_t)s_region->format, 1U, s_region->scaleExp);
+        SensorData_SetRaw(&data, 0U, rec->raw);
+        data.timestamp    = rec->tick_ms;
+        data.timestamp_us = now_us - ((now_ms - rec->tick_ms) * 1000U);
+        fn(&data);
+    }
+
+    s_region->count = 0U;
+    s_replayed     += count;
+
+    return count;
+}
+
+void PowerStandby_Start(uint32_t period_ms, PowerMode_t mode)
+{
+    uint32_t period_s = (period_ms + 500U) / 1000U;
+
+    s_region->period_s = (period_s != 0U) ? period_s : 1U;
+    s_region->mode     = (uint8_t)mode;
+    s_region->wakeups  = 0U;
+    s_region->tick_ms  = HAL_GetTick();
+    s_region->rtc_ms   = PowerRtc_GetMs();
+    s_region->flags   |= POWER_STANDBY_FLAG_ENTER;
+
+    LOG_INFO("Standby: duty cycle every %lu s", (unsigned long)s_region->period_s);
+    Log_Flush();
+    CrashLog_PlannedReset();
+
+    NVIC_SystemReset();
+    while (1)
+    {
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void PowerStandby_CarryTick(void)
+{
+    uint32_t rtc_ms = PowerRtc_GetMs();
+
+    s_region->tick_ms += PowerRtc_ElapsedMs(s_region->rtc_ms, rtc_ms);
+    s_region->rtc_ms   = rtc_ms;
+
+    /* The few ms since HAL_Init() are inside the RTC interval already. */
+    uwTick = s_region->tick_ms;
+}
+
+static void PowerStandby_Append(const SensorData_t *data)
+{
+    if (s_region->count >= POWER_STANDBY_SAMPLES)
+    {
+        return;
+    }
+
+    if (s_region->count == 0U)
+    {
+        s_region->sensorId = data->sensorId;
+        s_region->format   = (uint8_t)SensorData_GetFormat(data);
+        s_region->scaleExp = data->scaleExp;
+    }
+
+    PowerStandbySample_t *rec = &s_region->samples[s_region->count];
+    rec->tick_ms = data->timestamp;
+    rec->raw     = SensorData_GetRaw(data, 0U);
+    s_region->count++;
+}
+
+static void PowerStandby_Enter(void)
+{
+    __disable_irq();
+
+    /* Without the backup regulator the buffer is lost in STANDBY. */
+    PWR->CSR |= PWR_CSR_BRE;
+    for (uint32_t i = 0U; (i < POWER_STANDBY_WAIT_LOOPS) && ((PWR->CSR & PWR_CSR_BRR) == 0U); ++i)
+    {
+    }
+
+    PowerRtc_StartWakeupSeconds(s_region->period_s);
+    PowerRtc_SetButtonWake(true);
+
+    /* A wakeup flag left set would end STANDBY at once. */
+    (void)PowerRtc_TakeWakeEvents();
+    PWR->CR  |= PWR_CR_CWUF | PWR_CR_CSBF;
+    RCC->CSR |= RCC_CSR_RMVF;
+
+    HAL_PWR_EnterSTANDBYMode();
+    while (1)
+    {
+    }
+}
+
+static void PowerStandby_Cmd(uint32_t argc, char *argv[])
+{
+    if (argc == 2U)
+    {
+        char         *end    = NULL;
+        unsigned long period = strtoul(argv[1], &end, 10);
+
+        if ((end == argv[1]) || (*end != '\0') || (period == 0UL) || (period > POWER_RTC_MAX_WAKEUP_S))
+        {
+            CLI_PrintError("\r\nUsage: standby [<s>] (1 to %lu)\r\n", (unsigned long)POWER_RTC_MAX_WAKEUP_S);
+            return;
+        }
+
+        CLI_Print("\r\nEntering STANDBY, sampling every %lu s; press B1 to return\r\n", period);
+        PowerStandby_Start((uint32_t)period * 1000U, PowerManager_GetCurrentMode());
+    }
+
+    CLI_Print("\r\nStandby duty cycle:\r\n");
+    CLI_Print("  This boot: %s", s_bootNames[s_boot]);
+    if (s_boot != POWER_STANDBY_BOOT_COLD)
+    {
+        CLI_Print(", after %lu wakeups every %lu s", (unsigned long)s_wakeups, (unsigned long)s_period_s);
+    }
+    CLI_Print("\r\n  Buffer: %lu/%u samples, %lu replayed on this boot\r\n",
+              (unsigned long)s_region->count, (unsigned)POWER_STANDBY_SAMPLES, (unsigned long)s_replayed);
+}
@@ -0,0 +1,157 @@
+/**
+ * @file power_standby.h
+ * @brief STANDBY duty cycling: sample, buffer in backup SRAM, sleep.
+ *
+ * At sample periods of @ref POWER_STANDBY_MIN_PERIOD_MS and more, even
+ * STOP between samples costs more than the samples. In the duty cycle
+ * the MCU spends the period in STANDBY, where only the RTC and the
+ * backup SRAM (on the backup regulator) are powered. Every RTC wakeup is
+ * a reset: main() runs up to the clock setup, PowerStandby_Boot() takes
+ * one sample through the application's callback, appends it to a buffer
+ * in backup SRAM and goes back to STANDBY. None of the console, the
+ * scheduler or the other sensors is started.
+ *
+ * A full boot only follows when the buffer is full, when B1 is pressed
+ * during STANDBY (the operator event), or after any other reset. Its
+ * App_MainInit() replays the buffered samples into the sample ring, so
+ * they reach telemetry and the flash log as if sampled live, and the
+ * application starts the next duty cycle once they are out.
+ *
+ * The HAL tick carries on across the duty cycle: each wakeup advances it
+ * by the RTC-measured time, as after STOP, so timestamps and uptime keep
+ * counting from the cold boot.
+ *
+ * The IWDG cannot be stopped once started and would reset the MCU out of
+ * STANDBY, so a full boot enters the duty cycle through a system reset
+ * (which stops the IWDG) and the wakeups never start it.
+ *
+ * The state lives in the top @ref POWER_STANDBY_BKPSRAM_BYTES of backup
+ * SRAM, after the crash trace. It survives STANDBY and resets but not a
+ * power cycle, which always gives a cold boot with duty cycling off.
+ *
+ * @ingroup power
+ */
+
+#ifndef POWER_STANDBY_H
+#define POWER_STANDBY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+#include "power_manager.h"
+
+/**
+ * @defgroup power_standby STANDBY Duty Cycle
+ * @brief Sample-and-sleep cycle in STANDBY with a backup SRAM buffer.
+ * @ingroup power
+ * @{
+ */
+
+/** @brief Backup SRAM reserved at its top for the duty cycle state. */
+#define POWER_STANDBY_BKPSRAM_BYTES   (400U)
+
+/** @brief Samples the buffer holds; the full boot follows the last one. */
+#define POWER_STANDBY_SAMPLES         (45U)
+
+/**
+ * @brief Why the boot that is running is a full boot.
+ */
+typedef enum
+{
+    POWER_STANDBY_BOOT_COLD = 0U, /**< No duty cycle was running.              */
+    POWER_STANDBY_BOOT_FULL,      /**< The sample buffer filled up.            */
+    POWER_STANDBY_BOOT_BUTTON,    /**< B1 was pressed in STANDBY.              */
+    POWER_STANDBY_BOOT_RESET      /**< Another reset ended the duty cycle.     */
+} PowerStandbyBoot_t;
+
+/**
+ * @brief Take one sample in a duty cycle wakeup.
+ *
+ * Runs with only the HAL, the clocks and the RTC set up, and without the
+ * watchdog: initialize the sensor, read it synchronously and set
+ * sensorId. Only channel 0 is buffered.
+ *
+ * @param[out] data Sample.
+ *
+ * @return false if no sample was taken.
+ */
+typedef bool (*PowerStandbySampleFn_t)(SensorData_t *data);
+
+/**
+ * @brief Receive one buffered sample on the full boot.
+ *
+ * @param data Sample, with its original timestamp.
+ */
+typedef void (*PowerStandbyReplayFn_t)(const SensorData_t *data);
+
+/**
+ * @brief Run the duty cycle wakeup, if this boot is one.
+ *
+ * Call from main() right after the clock setup, before the peripherals
+ * and the crash log. On a duty cycle wakeup that leaves room in the
+ * buffer, this does not return: the sample is stored and the MCU goes
+ * back to STANDBY. Otherwise it ends the duty cycle, releases the RTC
+ * wakeup sources and returns. Leaves the PWR standby flag for
+ * BootTime_DetectResume().
+ *
+ * @param sample Sampling callback.
+ *
+ * @return Why the full boot runs.
+ */
+PowerStandbyBoot_t PowerStandby_Boot(PowerStandbySampleFn_t sample);
+
+/**
+ * @brief Publish the metrics and register the "standby" CLI command.
+ *
+ * @return None.
+ */
+void PowerStandby_Init(void);
+
+/**
+ * @brief Result of PowerStandby_Boot().
+ *
+ * @return Why the full boot runs.
+ */
+PowerStandbyBoot_t PowerStandby_GetBootReason(void);
+
+/**
+ * @brief Power mode the last duty cycle was started in.
+ *
+ * @return Mode, or POWER_MODE_ACTIVE if there was none.
+ */
+PowerMode_t PowerStandby_GetMode(void);
+
+/**
+ * @brief Hand the buffered samples to @p fn, oldest first, and empty the
+ *        buffer.
+ *
+ * @param fn Receiver.
+ *
+ * @return Samples replayed.
+ */
+uint32_t PowerStandby_Replay(PowerStandbyReplayFn_t fn);
+
+/**
+ * @brief Enter the duty cycle: system reset, then STANDBY.
+ *
+ * Flushes the console and drops this boot's crash trace first: the reset
+ * is not a crash. Does not return.
+ *
+ * @param period_ms Sample period; rounded to whole seconds, at least 1 s.
+ * @param mode      Power mode to return to on a buffer-full boot.
+ *
+ * @return None.
+ */
+void PowerStandby_Start(uint32_t period_ms, PowerMode_t mode) __attribute__((noreturn));
+
+/** @} */ /* end of power_standby group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POWER_STANDBY_H */
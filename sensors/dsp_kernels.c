@@ -0,0 +1,561 @@
+/**
+ * @file dsp_kernels.c
+ * @brief Fixed-point and float block filter kernels.
+ *
+ * The dual-MAC kernels read two int16 values as one word. Word loads on
+ * the M4 may be unaligned (LDR, not LDRD/LDM), so the reads go through
+ * memcpy(), which the compiler turns into a single LDR; this is also how
+ * CMSIS-DSP reads q15 pairs. The FIR history is stored twice, at pos and
+ * pos + taps, so the window is always one contiguous run and the inner
+ * loop needs no wrap check.
+ *
+ * The real FFT of N points is a complex radix-2 FFT of N/2 points over
+ * the even/odd samples, followed by the split step that separates the
+ * two interleaved spectra, as in arm_rfft_fast_f32(). There is no libm,
+ * so the twiddle table is built once by rotating in double precision
+ * from cos and sin of the smallest angle.
+ *
+ * @ingroup dsp_kernels
+ */
+
+#include "dsp_kernels.h"
+#include "stm32f4xx.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+
+/** @brief acc + lo(x) * lo(y) + hi(x) * hi(y), 64-bit (SMLALD). */
+#define DSP_SMLALD(x, y, acc)   ((int64_t)__SMLALD((x), (y), (uint64_t)(acc)))
+
+/** @brief Low half of @p lo, low half of @p hi in the top (PKHBT). */
+#define DSP_PACK(lo, hi)        __PKHBT((uint32_t)(lo), (uint32_t)(hi), 16)
+
+/** @brief Saturate to int16 (SSAT). */
+#define DSP_SAT16(v)            ((int16_t)__SSAT((v), 16))
+
+#else
+
+#define DSP_SMLALD(x, y, acc)   Dsp_Smlald((x), (y), (acc))
+#define DSP_PACK(lo, hi)        ((((uint32_t)(lo)) & 0xFFFFU) | (((uint32_t)(hi)) << 16))
+#define DSP_SAT16(v)            Dsp_Sat16(v)
+
+/**
+ * @brief Portable SMLALD.
+ */
+static inline int64_t Dsp_Smlald(uint32_t x, uint32_t y, int64_t acc)
+{
+    return acc +
+           ((int64_t)(int16_t)(x & 0xFFFFU) * (int16_t)(y & 0xFFFFU)) +
+           ((int64_t)(int16_t)(x >> 16) * (int16_t)(y >> 16));
+}
+
+/**
+ * @brief Portable SSAT #16.
+ */
+static inline int16_t Dsp_Sat16(int32_t v)
+{
+    if (v > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+#endif
+
+/**
+ * @brief Two consecutive int16 values as one word (p[0] in the low half).
+ */
+static inline uint32_t Dsp_Read2(const int16_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/** @brief cos(2 pi t / 256) and sin(2 pi t / 256), seed of the twiddle table. */
+#define DSP_RFFT_SEED_COS   (0.99969881869620422)
+#define DSP_RFFT_SEED_SIN   (0.024541228522912288)
+
+_Static_assert(DSP_RFFT_MAX_POINTS == 256U, "twiddle seed is for 256 points");
+
+/**
+ * @brief cos and sin of 2 pi t / @ref DSP_RFFT_MAX_POINTS, interleaved,
+ *        for t < DSP_RFFT_MAX_POINTS / 2.
+ */
+static float s_rfftTwiddle[DSP_RFFT_MAX_POINTS];
+
+/**
+ * @brief Whether @ref s_rfftTwiddle is built.
+ */
+static bool s_rfftReady = false;
+
+/**
+ * @brief In-place complex radix-2 FFT of @p m interleaved points.
+ */
+static void Dsp_CfftF32(float *data, uint32_t m)
+{
+    for (uint32_t i = 1U, j = 0U; i < m; ++i)
+    {
+        uint32_t bit = m >> 1;
+
+        while ((j & bit) != 0U)
+        {
+            j  ^= bit;
+            bit >>= 1;
+        }
+        j ^= bit;
+
+        if (i < j)
+        {
+            float re = data[2U * i];
+            float im = data[(2U * i) + 1U];
+
+            data[2U * i]        = data[2U * j];
+            data[(2U * i) + 1U] = data[(2U * j) + 1U];
+            data[2U * j]        = re;
+            data[(2U * j) + 1U] = im;
+        }
+    }
+
+    for (uint32_t len = 2U; len <= m; len <<= 1)
+    {
+        uint32_t half = len >> 1;
+        uint32_t step = DSP_RFFT_MAX_POINTS / len;
+
+        for (uint32_t k = 0U; k < half; ++k)
+        {
+            /* W = exp(-j 2 pi k / len). */
+            float wr = s_rfftTwiddle[2U * k * step];
+            float wi = -s_rfftTwiddle[(2U * k * step) + 1U];
+
+            for (uint32_t i = k; i < m; i += len)
+            {
+                float *a  = &data[2U * i];
+                float *b  = &data[2U * (i + half)];
+                float  tr = (b[0] * wr) - (b[1] * wi);
+                float  ti = (b[0] * wi) + (b[1] * wr);
+
+                b[0]  = a[0] - tr;
+                b[1]  = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+
+void Dsp_AverageInitQ15(DspAverageQ15_t *avg, uint32_t window)
+{
+    if (window == 0U)
+    {
+        window = 1U;
+    }
+    else if (window > DSP_AVERAGE_MAX)
+    {
+        window = DSP_AVERAGE_MAX;
+    }
+
+    memset(avg, 0, sizeof(*avg));
+    avg->window = (uint8_t)window;
+}
+
+void Dsp_AverageQ15(DspAverageQ15_t *avg, const int16_t *in, int16_t *out, size_t count)
+{
+    int32_t sum = avg->sum;
+    uint8_t pos = avg->pos;
+    uint8_t n   = avg->count;
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        int16_t x = in[i];
+
+        if (n < avg->window)
+        {
+            n++;
+        }
+        else
+        {
+            sum -= avg->history[pos];
+        }
+
+        avg->history[pos] = x;
+        sum += x;
+        pos = (uint8_t)(((pos + 1U) == avg->window) ? 0U : (pos + 1U));
+
+        /* The integer sum is exact, so unlike the float stage no re-anchoring. */
+        int32_t half = (int32_t)n / 2;
+        out[i] = (int16_t)(((sum >= 0) ? (sum + half) : (sum - half)) / (int32_t)n);
+    }
+
+    avg->sum   = sum;
+    avg->pos   = pos;
+    avg->count = n;
+}
+
+void Dsp_LowpassInitQ15(DspLowpassQ15_t *lp, float alpha)
+{
+    int32_t q = (int32_t)((alpha * 32768.0f) + 0.5f);
+
+    if (q < 1)
+    {
+        q = 1;
+    }
+    else if (q > INT16_MAX)
+    {
+        q = INT16_MAX;
+    }
+
+    lp->state  = 0;
+    lp->alpha  = (int16_t)q;
+    lp->primed = false;
+}
+
+void Dsp_LowpassQ15(DspLowpassQ15_t *lp, const int16_t *in, int16_t *out, size_t count)
+{
+    if (count == 0U)
+    {
+        return;
+    }
+
+    int32_t y = lp->primed ? lp->state : ((int32_t)in[0] * 65536);
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        int64_t diff = ((int64_t)in[i] * 65536) - y;
+
+        /* y stays between the inputs, so neither line can overflow. */
+        y += (int32_t)((diff * lp->alpha) >> 15);
+        out[i] = (int16_t)((y + 0x8000) >> 16);
+    }
+
+    lp->state  = y;
+    lp->primed = true;
+}
+
+bool Dsp_FirDecimateInitQ15(DspFirDecimateQ15_t *fir, const int16_t *coeffs, uint16_t taps,
+                            uint8_t factor, int16_t *state)
+{
+    if ((fir == NULL) || (coeffs == NULL) || (state == NULL) || (taps == 0U) || (factor == 0U))
+    {
+        return false;
+    }
+
+    memset(state, 0, 2U * taps * sizeof(state[0]));
+    fir->coeffs = coeffs;
+    fir->state  = state;
+    fir->taps   = taps;
+    fir->pos    = 0U;
+    fir->factor = factor;
+    fir->phase  = 0U;
+
+    return true;
+}
+
+size_t Dsp_FirDecimateQ15(DspFirDecimateQ15_t *fir, const int16_t *in, int16_t *out, size_t count)
+{
+    const int16_t *coeffs = fir->coeffs;
+    int16_t       *state  = fir->state;
+    uint32_t       taps   = fir->taps;
+    uint32_t       pos    = fir->pos;
+    size_t         made   = 0U;
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        state[pos]        = in[i];
+        state[pos + taps] = in[i];
+        pos = ((pos + 1U) == taps) ? 0U : (pos + 1U);
+
+        if (++fir->phase < fir->factor)
+        {
+            continue;
+        }
+        fir->phase = 0U;
+
+        /* Window oldest first: state[pos .. pos + taps - 1]. */
+        const int16_t *window = &state[pos];
+        int64_t        acc    = 0;
+        uint32_t       k      = 0U;
+
+        for (; (k + 2U) <= taps; k += 2U)
+        {
+            acc = DSP_SMLALD(Dsp_Read2(&window[k]), Dsp_Read2(&coeffs[k]), acc);
+        }
+        if (k < taps)
+        {
+            acc += (int32_t)window[k] * coeffs[k];
+        }
+
+        out[made++] = DSP_SAT16((int32_t)(acc >> 15));
+    }
+
+    fir->pos = (uint16_t)pos;
+    return made;
+}
+
+bool Dsp_FirDecimateInitF32(DspFirDecimateF32_t *fir, const float *coeffs, uint16_t taps,
+                            uint8_t factor, float *state)
+{
+    if ((fir == NULL) || (coeffs == NULL) || (state == NULL) || (taps == 0U) || (factor == 0U))
+    {
+        return false;
+    }
+
+    memset(state, 0, 2U * taps * sizeof(state[0]));
+    fir->coeffs = coeffs;
+    fir->state  = state;
+    fir->taps   = taps;
+    fir->pos    = 0U;
+    fir->factor = factor;
+    fir->phase  = 0U;
+
+    return true;
+}
+
+size_t Dsp_FirDecimateF32(DspFirDecimateF32_t *fir, const float *in, float *out, size_t count)
+{
+    const float *coeffs = fir->coeffs;
+    float       *state  = fir->state;
+    uint32_t     taps   = fir->taps;
+    uint32_t     pos    = fir->pos;
+    size_t       made   = 0U;
+
+    for (size_t i = 0U; i < count; ++i)
+    {
+        state[pos]        = in[i];
+        state[pos + taps] = in[i];
+        pos = ((pos + 1U) == taps) ? 0U : (pos + 1U);
+
+        if (++fir->phase < fir->factor)
+        {
+            continue;
+        }
+        fir->phase = 0U;
+
+        const float *window = &state[pos];
+        float        acc    = 0.0f;
+
+        for (uint32_t k = 0U; k < taps; ++k)
+        {
+            acc += window[k] * coeffs[k];
+        }
+
+        out[made++] = acc;
+    }
+
+    fir->pos = (uint16_t)pos;
+    return made;
+}
+
+bool Dsp_BiquadInitQ15(DspBiquadQ15_t *bq, uint8_t stages, const int16_t *coeffs, uint8_t postShift)
+{
+    if ((bq == NULL) || (coeffs == NULL) || (stages == 0U) ||
+        (stages > DSP_BIQUAD_MAX_STAGES) || (postShift > 2U))
+    {
+        return false;
+    }
+
+    memset(bq, 0, sizeof(*bq));
+    bq->coeffs    = coeffs;
+    bq->stages    = stages;
+    bq->postShift = postShift;
+
+    return true;
+}
+
+void Dsp_BiquadQ15(DspBiquadQ15_t *bq, const int16_t *in, int16_t *out, size_t count)
+{
+    uint32_t       shift = 15U - bq->postShift;
+    const int16_t *src   = in;
+
+    for (uint32_t s = 0U; s < bq->stages; ++s)
+    {
+        const int16_t *c   = &bq->coeffs[6U * s];
+        int16_t       *st  = &bq->state[4U * s];
+        int32_t        b0  = c[0];
+        uint32_t       b12 = Dsp_Read2(&c[2]);
+        uint32_t       a12 = Dsp_Read2(&c[4]);
+        uint32_t       xs  = Dsp_Read2(&st[0]);  /* x[n-1] low, x[n-2] high */
+        uint32_t       ys  = Dsp_Read2(&st[2]);  /* y[n-1] low, y[n-2] high */
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            int32_t x   = src[i];
+            int64_t acc = (int64_t)b0 * x;
+
+            acc = DSP_SMLALD(xs, b12, acc);
+            acc = DSP_SMLALD(ys, a12, acc);
+
+            /* At most five q15 x q15 products: the shifted sum fits int32. */
+            int16_t y = DSP_SAT16((int32_t)(acc >> shift));
+
+            xs = DSP_PACK(x, xs);
+            ys = DSP_PACK(y, ys);
+            out[i] = y;
+        }
+
+        memcpy(&st[0], &xs, sizeof(xs));
+        memcpy(&st[2], &ys, sizeof(ys));
+        src = out;
+    }
+}
+
+bool Dsp_BiquadInitF32(DspBiquadF32_t *bq, uint8_t stages, const float *coeffs)
+{
+    if ((bq == NULL) || (coeffs == NULL) || (stages == 0U) || (stages > DSP_BIQUAD_MAX_STAGES))
+    {
+        return false;
+    }
+
+    memset(bq, 0, sizeof(*bq));
+    bq->coeffs = coeffs;
+    bq->stages = stages;
+
+    return true;
+}
+
+void Dsp_BiquadF32(DspBiquadF32_t *bq, const float *in, float *out, size_t count)
+{
+    const float *src = in;
+
+    for (uint32_t s = 0U; s < bq->stages; ++s)
+    {
+        const float *c  = &bq->coeffs[5U * s];
+        float       *st = &bq->state[4U * s];
+        float        x1 = st[0];
+        float        x2 = st[1];
+        float        y1 = st[2];
+        float        y2 = st[3];
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            float x = src[i];
+            float y = (c[0] * x) + (c[1] * x1) + (c[2] * x2) + (c[3] * y1) + (c[4] * y2);
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+            out[i] = y;
+        }
+
+        st[0] = x1;
+        st[1] = x2;
+        st[2] = y1;
+        st[3] = y2;
+        src = out;
+    }
+}
+
+bool Dsp_RfftInitF32(DspRfftF32_t *fft, uint16_t points)
+{
+    if ((fft == NULL) || (points < DSP_RFFT_MIN_POINTS) || (points > DSP_RFFT_MAX_POINTS) ||
+        ((points & (points - 1U)) != 0U))
+    {
+        return false;
+    }
+
+    if (!s_rfftReady)
+    {
+        double c = 1.0;
+        double s = 0.0;
+
+        for (uint32_t t = 0U; t < (DSP_RFFT_MAX_POINTS / 2U); ++t)
+        {
+            s_rfftTwiddle[2U * t]        = (float)c;
+            s_rfftTwiddle[(2U * t) + 1U] = (float)s;
+
+            double cn = (c * DSP_RFFT_SEED_COS) - (s * DSP_RFFT_SEED_SIN);
+            s = (s * DSP_RFFT_SEED_COS) + (c * DSP_RFFT_SEED_SIN);
+            c = cn;
+        }
+        s_rfftReady = true;
+    }
+
+    fft->points = points;
+    fft->stride = (uint16_t)(DSP_RFFT_MAX_POINTS / points);
+
+    return true;
+}
+
+void Dsp_RfftF32(const DspRfftF32_t *fft, float *data)
+{
+    uint32_t m = (uint32_t)fft->points / 2U;
+
+    /* Even samples as the real part, odd as the imaginary part. */
+    Dsp_CfftF32(data, m);
+
+    float r0 = data[0];
+    float i0 = data[1];
+    data[0] = r0 + i0;
+    data[1] = r0 - i0;
+
+    for (uint32_t k = 1U; k <= (m / 2U); ++k)
+    {
+        float *a = &data[2U * k];
+        float *b = &data[2U * (m - k)];
+
+        /* E = (Z[k] + conj(Z[m-k])) / 2, O = -j (Z[k] - conj(Z[m-k])) / 2. */
+        float er = 0.5f * (a[0] + b[0]);
+        float ei = 0.5f * (a[1] - b[1]);
+        float odr = 0.5f * (a[1] + b[1]);
+        float odi = 0.5f * (b[0] - a[0]);
+
+        /* X[k] = E + W^k O and X[m-k] = conj(E - W^k O), W = exp(-j 2 pi / N). */
+        uint32_t t  = 2U * k * fft->stride;
+        float    wr = s_rfftTwiddle[t];
+        float    wi = -s_rfftTwiddle[t + 1U];
+        float    pr = (wr * odr) - (wi * odi);
+        float    pi = (wr * odi) + (wi * odr);
+
+        a[0] = er + pr;
+        a[1] = ei + pi;
+        if (k != (m - k))
+        {
+            b[0] = er - pr;
+            b[1] = pi - ei;
+        }
+    }
+}
+
+void Dsp_WindowHannF32(const DspRfftF32_t *fft, float *data)
+{
+    const uint32_t half = DSP_RFFT_MAX_POINTS / 2U;
+
+    for (uint32_t i = 0U; i < fft->points; ++i)
+    {
+        /* cos over the full turn from the half-turn table: cos(x + pi) = -cos(x). */
+        uint32_t t = i * fft->stride;
+        float    c = (t < half) ? s_rfftTwiddle[2U * t] : -s_rfftTwiddle[2U * (t - half)];
+
+        data[i] *= 0.5f - (0.5f * c);
+    }
+}
+
+float Dsp_SqrtF32(float v)
+{
+    if (!(v > 0.0f))
+    {
+        return 0.0f;
+    }
+
+    /* Halving the exponent bits is within 6 %; three steps reach float precision. */
+    uint32_t bits;
+    float    r;
+    memcpy(&bits, &v, sizeof(bits));
+    bits = (bits >> 1) + 0x1FC00000U;
+    memcpy(&r, &bits, sizeof(r));
+
+    for (uint32_t i = 0U; i < 3U; ++i)
+    {
+        r = 0.5f * (r + (v / r));
+    }
+
+    return r;
+}
@@ -0,0 +1,320 @@
+/**
+ * @file dsp_kernels.h
+ * @brief Fixed-point (q15) block filter kernels with float counterparts.
+ *
+ * Kernels run on contiguous channel rows, such as the arrays of a
+ * @ref SampleBlock_t, and keep their history in caller-owned state
+ * structures so a block can be processed in pieces.
+ *
+ * The q15 FIR and biquad kernels use the Cortex-M4 dual 16-bit
+ * multiply-accumulate (SMLALD) on pairs of samples and coefficients read
+ * as one word, with 64-bit accumulation and a single saturation per
+ * output. On a core without the DSP extension (the host simulation) the
+ * same arithmetic is done in portable C, so results are bit-identical.
+ * The f32 kernels are the same filters in float, for comparison and for
+ * int32 data.
+ *
+ * Coefficient and state layouts follow CMSIS-DSP (FIR coefficients in
+ * time-reversed order; biquad feedback coefficients with the sign that
+ * is added, i.e. y = b0 x + b1 x1 + b2 x2 + a1 y1 + a2 y2), so
+ * coefficients designed for arm_fir_decimate_q15() or
+ * arm_biquad_cascade_df1_q15() can be used unchanged. The real FFT
+ * produces the packed spectrum of arm_rfft_fast_f32() (DC and Nyquist
+ * in the first two entries, then real/imaginary pairs).
+ *
+ * @ingroup sensors
+ */
+
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @defgroup dsp_kernels DSP Kernels
+ * @brief Moving average, low-pass, FIR decimation, biquad and FFT kernels.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Largest moving-average window. */
+#define DSP_AVERAGE_MAX   (16U)
+
+/** @brief Largest number of cascaded biquad stages. */
+#define DSP_BIQUAD_MAX_STAGES   (4U)
+
+/** @brief Shortest real FFT length. */
+#define DSP_RFFT_MIN_POINTS   (16U)
+
+/** @brief Longest real FFT length (size of the shared twiddle table). */
+#define DSP_RFFT_MAX_POINTS   (256U)
+
+/**
+ * @brief Moving average over int16 values (exact int32 running sum).
+ */
+typedef struct
+{
+    int16_t history[DSP_AVERAGE_MAX]; /**< Last values (ring).          */
+    int32_t sum;                      /**< Sum of the valid history.    */
+    uint8_t window;                   /**< Window length.               */
+    uint8_t count;                    /**< Valid history entries.       */
+    uint8_t pos;                      /**< Next history write index.    */
+} DspAverageQ15_t;
+
+/**
+ * @brief First-order low-pass y += alpha * (x - y) over int16 values.
+ */
+typedef struct
+{
+    int32_t state;   /**< Output, Q16 of the input units.  */
+    int16_t alpha;   /**< Smoothing factor, q15.            */
+    bool    primed;  /**< State seeded with a sample.       */
+} DspLowpassQ15_t;
+
+/**
+ * @brief q15 FIR filter with decimation.
+ */
+typedef struct
+{
+    const int16_t *coeffs;  /**< @ref taps coefficients, time-reversed.   */
+    int16_t       *state;   /**< 2 * @ref taps entries, caller-owned.      */
+    uint16_t       taps;    /**< Filter length.                            */
+    uint16_t       pos;     /**< Next state write index.                   */
+    uint8_t        factor;  /**< Decimation factor (1 = none).             */
+    uint8_t        phase;   /**< Inputs since the last output.             */
+} DspFirDecimateQ15_t;
+
+/**
+ * @brief Float FIR filter with decimation.
+ */
+typedef struct
+{
+    const float *coeffs;  /**< @ref taps coefficients, time-reversed. */
+    float       *state;   /**< 2 * @ref taps entries, caller-owned.    */
+    uint16_t     taps;    /**< Filter length.                          */
+    uint16_t     pos;     /**< Next state write index.                 */
+    uint8_t      factor;  /**< Decimation factor (1 = none).           */
+    uint8_t      phase;   /**< Inputs since the last output.           */
+} DspFirDecimateF32_t;
+
+/**
+ * @brief Cascade of q15 direct form I biquads.
+ *
+ * Six coefficients per stage, {b0, 0, b1, b2, a1, a2}, in q(15 - postShift)
+ * so that coefficients up to 2^postShift in magnitude fit.
+ */
+typedef struct
+{
+    const int16_t *coeffs;                        /**< 6 per stage.          */
+    int16_t        state[4U * DSP_BIQUAD_MAX_STAGES]; /**< x1, x2, y1, y2.   */
+    uint8_t        stages;                        /**< Cascaded stages.      */
+    uint8_t        postShift;                     /**< Coefficient headroom. */
+} DspBiquadQ15_t;
+
+/**
+ * @brief Cascade of float direct form I biquads.
+ *
+ * Five coefficients per stage, {b0, b1, b2, a1, a2}.
+ */
+typedef struct
+{
+    const float *coeffs;                          /**< 5 per stage.        */
+    float        state[4U * DSP_BIQUAD_MAX_STAGES]; /**< x1, x2, y1, y2.   */
+    uint8_t      stages;                          /**< Cascaded stages.    */
+} DspBiquadF32_t;
+
+/**
+ * @brief Float real FFT of one length.
+ *
+ * Holds no data: every length reads the one twiddle table (cos and sin
+ * for @ref DSP_RFFT_MAX_POINTS) at its own stride.
+ */
+typedef struct
+{
+    uint16_t points; /**< Transform length, a power of two. */
+    uint16_t stride; /**< Twiddle table step.               */
+} DspRfftF32_t;
+
+/**
+ * @brief Reset a moving average.
+ *
+ * @param avg    State.
+ * @param window Window length, 1..@ref DSP_AVERAGE_MAX (clamped).
+ *
+ * @return None.
+ */
+void Dsp_AverageInitQ15(DspAverageQ15_t *avg, uint32_t window);
+
+/**
+ * @brief Moving average of @p count values (rounded to nearest).
+ *
+ * Until the window has filled, the average is over the values seen so
+ * far. @p in and @p out may be the same array.
+ *
+ * @param avg   State.
+ * @param in    Input values.
+ * @param[out] out Output values.
+ * @param count Number of values.
+ *
+ * @return None.
+ */
+void Dsp_AverageQ15(DspAverageQ15_t *avg, const int16_t *in, int16_t *out, size_t count);
+
+/**
+ * @brief Reset a first-order low-pass.
+ *
+ * @param lp    State.
+ * @param alpha Smoothing factor in (0, 1).
+ *
+ * @return None.
+ */
+void Dsp_LowpassInitQ15(DspLowpassQ15_t *lp, float alpha);
+
+/**
+ * @brief First-order low-pass of @p count values; the first value ever
+ *        seen seeds the state. @p in and @p out may be the same array.
+ *
+ * @param lp    State.
+ * @param in    Input values.
+ * @param[out] out Output values.
+ * @param count Number of values.
+ *
+ * @return None.
+ */
+void Dsp_LowpassQ15(DspLowpassQ15_t *lp, const int16_t *in, int16_t *out, size_t count);
+
+/**
+ * @brief Set up a q15 FIR decimator and clear its history.
+ *
+ * @param fir    State.
+ * @param coeffs @p taps coefficients in time-reversed order (coeffs[0]
+ *               weighs the oldest sample of the window).
+ * @param taps   Filter length (at least 1).
+ * @param factor Decimation factor (at least 1).
+ * @param state  Buffer of 2 * @p taps entries.
+ *
+ * @return false if an argument is invalid.
+ */
+bool Dsp_FirDecimateInitQ15(DspFirDecimateQ15_t *fir, const int16_t *coeffs, uint16_t taps,
+                            uint8_t factor, int16_t *state);
+
+/**
+ * @brief Filter @p count inputs, producing one output per @p factor
+ *        inputs (the phase carries over between calls).
+ *
+ * @param fir   State.
+ * @param in    Input values.
+ * @param[out] out Room for (count / factor) + 1 outputs.
+ * @param count Number of inputs.
+ *
+ * @return Outputs written.
+ */
+size_t Dsp_FirDecimateQ15(DspFirDecimateQ15_t *fir, const int16_t *in, int16_t *out, size_t count);
+
+/**
+ * @brief Float version of Dsp_FirDecimateInitQ15().
+ */
+bool Dsp_FirDecimateInitF32(DspFirDecimateF32_t *fir, const float *coeffs, uint16_t taps,
+                            uint8_t factor, float *state);
+
+/**
+ * @brief Float version of Dsp_FirDecimateQ15().
+ */
+size_t Dsp_FirDecimateF32(DspFirDecimateF32_t *fir, const float *in, float *out, size_t count);
+
+/**
+ * @brief Set up a q15 biquad cascade and clear its history.
+ *
+ * @param bq        State.
+ * @param stages    Stages, 1..@ref DSP_BIQUAD_MAX_STAGES.
+ * @param coeffs    6 * @p stages coefficients, {b0, 0, b1, b2, a1, a2}.
+ * @param postShift Coefficient headroom in bits (0..2).
+ *
+ * @return false if an argument is invalid.
+ */
+bool Dsp_BiquadInitQ15(DspBiquadQ15_t *bq, uint8_t stages, const int16_t *coeffs, uint8_t postShift);
+
+/**
+ * @brief Run @p count values through the cascade. @p in and @p out may
+ *        be the same array.
+ *
+ * @param bq    State.
+ * @param in    Input values.
+ * @param[out] out Output values (saturated).
+ * @param count Number of values.
+ *
+ * @return None.
+ */
+void Dsp_BiquadQ15(DspBiquadQ15_t *bq, const int16_t *in, int16_t *out, size_t count);
+
+/**
+ * @brief Float version of Dsp_BiquadInitQ15() (5 coefficients per stage).
+ */
+bool Dsp_BiquadInitF32(DspBiquadF32_t *bq, uint8_t stages, const float *coeffs);
+
+/**
+ * @brief Float version of Dsp_BiquadQ15().
+ */
+void Dsp_BiquadF32(DspBiquadF32_t *bq, const float *in, float *out, size_t count);
+
+/**
+ * @brief Set up a real FFT (and build the twiddle table on first use).
+ *
+ * @param fft    State.
+ * @param points Transform length, a power of two from
+ *               @ref DSP_RFFT_MIN_POINTS to @ref DSP_RFFT_MAX_POINTS.
+ *
+ * @return false if @p points is not supported.
+ */
+bool Dsp_RfftInitF32(DspRfftF32_t *fft, uint16_t points);
+
+/**
+ * @brief Forward real FFT in place.
+ *
+ * The output is the packed half spectrum of arm_rfft_fast_f32():
+ * data[0] = X[0] and data[1] = X[N/2] (both real), then
+ * data[2k], data[2k + 1] = Re, Im of X[k] for 0 < k < N/2. The transform
+ * is not scaled.
+ *
+ * @param fft  State from Dsp_RfftInitF32().
+ * @param data fft->points values in, the spectrum out.
+ *
+ * @return None.
+ */
+void Dsp_RfftF32(const DspRfftF32_t *fft, float *data);
+
+/**
+ * @brief Multiply fft->points values by a periodic Hann window,
+ *        w[i] = 0.5 - 0.5 cos(2 pi i / N), taken from the twiddle table.
+ *
+ * The window's mean square is 3/8 and its mean (coherent gain) 1/2.
+ *
+ * @param fft  State from Dsp_RfftInitF32().
+ * @param data Values, windowed in place.
+ *
+ * @return None.
+ */
+void Dsp_WindowHannF32(const DspRfftF32_t *fft, float *data);
+
+/**
+ * @brief Square root of @p v (0 for v <= 0), without libm.
+ *
+ * @param v Value.
+ *
+ * @return sqrt(v) to float precision.
+ */
+float Dsp_SqrtF32(float v);
+
+/** @} */ /* end of dsp_kernels group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_KERNELS_H */
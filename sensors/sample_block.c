@@ -0,0 +1,172 @@
+/**
+ * @file sample_block.c
+ * @brief Struct-of-arrays sample block implementation.
+ *
+ * Gather and scatter are the only places that touch the interleaved
+ * layout; the conversions work row by row with the scale factor loaded
+ * once per block.
+ *
+ * @ingroup sample_block
+ */
+
+#include "sample_block.h"
+
+_Static_assert((SAMPLE_BLOCK_MAX % 2U) == 0U, "int16 rows must stay word-aligned");
+_Static_assert(SAMPLE_BLOCK_MAX <= 255U, "count is a uint8_t");
+
+/* ------------------------------------------------------------------------- */
+
+size_t SampleBlock_Gather(SampleBlock_t *block, const SensorSample_t *samples, size_t count)
+{
+    if ((block == NULL) || (samples == NULL) || (count == 0U))
+    {
+        return 0U;
+    }
+
+    const SensorSample_t *first    = &samples[0];
+    uint32_t              channels = SensorData_GetChannels(first);
+    bool                  s32      = (first->layout & SENSOR_LAYOUT_S32) != 0U;
+
+    block->sensorId  = first->sensorId;
+    block->layout    = first->layout;
+    block->scaleExp  = first->scaleExp;
+    block->base_ms   = first->timestamp;
+    block->base_us   = first->timestamp_us;
+    block->period_ms = 0U;
+
+    size_t n = 0U;
+    while ((n < count) && (n < SAMPLE_BLOCK_MAX))
+    {
+        const SensorSample_t *s = &samples[n];
+
+        if ((s->sensorId != first->sensorId) || (s->layout != first->layout) ||
+            (s->scaleExp != first->scaleExp))
+        {
+            break;
+        }
+
+        if (n == 1U)
+        {
+            block->period_ms = s->timestamp - samples[0].timestamp;
+        }
+        else if ((n > 1U) && ((s->timestamp - samples[n - 1U].timestamp) != block->period_ms))
+        {
+            break;
+        }
+
+        block->quality[n] = s->quality;
+        for (uint32_t c = 0U; c < channels; ++c)
+        {
+            if (s32)
+            {
+                block->raw.s32[c][n] = s->raw.s32[c];
+            }
+            else
+            {
+                block->raw.s16[c][n] = s->raw.s16[c];
+            }
+        }
+        n++;
+    }
+
+    block->count = (uint8_t)n;
+    return n;
+}
+
+void SampleBlock_Scatter(const SampleBlock_t *block, SensorSample_t *samples)
+{
+    if ((block == NULL) || (samples == NULL))
+    {
+        return;
+    }
+
+    uint32_t channels = (uint32_t)block->layout & SENSOR_LAYOUT_CHANNELS_MASK;
+    bool     s32      = !SampleBlock_IsS16(block);
+
+    for (uint32_t n = 0U; n < block->count; ++n)
+    {
+        SensorSample_t *s = &samples[n];
+
+        s->quality = block->quality[n];
+        for (uint32_t c = 0U; c < channels; ++c)
+        {
+            if (s32)
+            {
+                s->raw.s32[c] = block->raw.s32[c][n];
+            }
+            else
+            {
+                s->raw.s16[c] = block->raw.s16[c][n];
+            }
+        }
+    }
+}
+
+void SampleBlock_ToFloat(const SampleBlock_t *block, uint32_t channel, float *values)
+{
+    float scale = SensorData_Pow10(block->scaleExp);
+
+    if (SampleBlock_IsS16(block))
+    {
+        const int16_t *row = block->raw.s16[channel];
+        for (uint32_t n = 0U; n < block->count; ++n)
+        {
+            values[n] = (float)row[n] * scale;
+        }
+    }
+    else
+    {
+        const int32_t *row = block->raw.s32[channel];
+        for (uint32_t n = 0U; n < block->count; ++n)
+        {
+            values[n] = (float)row[n] * scale;
+        }
+    }
+}
+
+void SampleBlock_FromFloat(SampleBlock_t *block, uint32_t channel, const float *values)
+{
+    float   inverse = SensorData_Pow10(-(int32_t)block->scaleExp);
+    bool    s16     = SampleBlock_IsS16(block);
+    int32_t hi      = s16 ? INT16_MAX : INT32_MAX;
+    int32_t lo      = s16 ? INT16_MIN : INT32_MIN;
+
+    for (uint32_t n = 0U; n < block->count; ++n)
+    {
+        float   scaled = values[n] * inverse;
+        int32_t raw;
+
+        /* Written so that NaN saturates too. */
+        if (!(scaled < (float)hi))
+        {
+            raw = hi;
+        }
+        else if (scaled <= (float)lo)
+        {
+            raw = lo;
+        }
+        else
+        {
+            raw = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+        }
+
+        int32_t before = s16 ? (int32_t)block->raw.s16[channel][n] : block->raw.s32[channel][n];
+        if (raw != before)
+        {
+            block->quality[n] |= SENSOR_QUALITY_FILTERED;
+        }
+        if ((raw == hi) || (raw == lo))
+        {
+            block->quality[n] |= SENSOR_QUALITY_CLIPPED;
+        }
+
+        if (s16)
+        {
+            block->raw.s16[channel][n] = (int16_t)raw;
+        }
+        else
+        {
+            block->raw.s32[channel][n] = raw;
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/**
+ * @file sample_block.h
+ * @brief Struct-of-arrays batches of one sensor's samples for block DSP.
+ *
+ * The sample ring holds one SensorData_t per reading: channels and
+ * timestamps interleaved, which suits queueing but not block kernels.
+ * A @ref SampleBlock_t holds a run of samples of one sensor with each
+ * channel in its own contiguous, word-aligned array and the timestamps
+ * reduced to a base and a fixed period, so filter kernels can walk a
+ * channel with plain pointer increments (and, for int16 channels, load
+ * two samples per 32-bit access for the dual 16-bit MAC instructions).
+ *
+ * SampleBlock_Gather() takes the longest leading run of @p samples that
+ * shares sensor, layout, scale and sampling interval. SampleBlock_Scatter()
+ * writes the processed channels and quality bits back in place; the
+ * timestamps of the original samples are left alone.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SAMPLE_BLOCK_H
+#define SAMPLE_BLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+
+/**
+ * @defgroup sample_block Sample Blocks
+ * @brief Per-channel sample arrays with a base timestamp and period.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Samples per block (even, so int16 rows stay word-aligned). */
+#define SAMPLE_BLOCK_MAX   (32U)
+
+/**
+ * @brief A run of samples of one sensor, one array per channel.
+ */
+typedef struct
+{
+    uint8_t  sensorId;                 /**< Source sensor.                         */
+    uint8_t  layout;                   /**< SensorData_t layout of every sample.   */
+    int8_t   scaleExp;                 /**< Shared decimal scale.                  */
+    uint8_t  count;                    /**< Samples in the block.                  */
+    uint32_t base_ms;                  /**< Timestamp of sample 0 (ms).            */
+    uint32_t base_us;                  /**< Timestamp of sample 0 (us).            */
+    uint32_t period_ms;                /**< Interval between samples (0 if one).   */
+    uint8_t  quality[SAMPLE_BLOCK_MAX]; /**< Quality bits per sample.              */
+    union
+    {
+        int16_t s16[SENSOR_MAX_CHANNELS][SAMPLE_BLOCK_MAX]; /**< int16 channels. */
+        int32_t s32[SENSOR_MAX_CHANNELS][SAMPLE_BLOCK_MAX]; /**< int32 channels. */
+    } raw;                             /**< Channel arrays, oldest first.          */
+} SampleBlock_t;
+
+/**
+ * @brief Copy the leading run of @p samples into @p block.
+ *
+ * The run ends at the first sample from another sensor, with another
+ * layout or scale, at an interval (ms) different from the first one, or
+ * after @ref SAMPLE_BLOCK_MAX samples.
+ *
+ * @param[out] block   Destination.
+ * @param      samples Samples, oldest first.
+ * @param      count   Number of samples (at least 1).
+ *
+ * @return Samples taken (0 if @p count is 0).
+ */
+size_t SampleBlock_Gather(SampleBlock_t *block, const SensorSample_t *samples, size_t count);
+
+/**
+ * @brief Write the channels and quality bits of @p block back to the
+ *        samples it was gathered from.
+ *
+ * @param block   Block returned by SampleBlock_Gather().
+ * @param samples The same samples.
+ *
+ * @return None.
+ */
+void SampleBlock_Scatter(const SampleBlock_t *block, SensorSample_t *samples);
+
+/**
+ * @brief Convert one channel to engineering units.
+ *
+ * @param      block   Block.
+ * @param      channel Channel index.
+ * @param[out] values  At least block->count entries.
+ *
+ * @return None.
+ */
+void SampleBlock_ToFloat(const SampleBlock_t *block, uint32_t channel, float *values);
+
+/**
+ * @brief Store one channel from engineering units (rounded, saturated).
+ *
+ * Samples whose stored value changes get @ref SENSOR_QUALITY_FILTERED;
+ * saturated ones @ref SENSOR_QUALITY_CLIPPED.
+ *
+ * @param block   Block.
+ * @param channel Channel index.
+ * @param values  block->count values.
+ *
+ * @return None.
+ */
+void SampleBlock_FromFloat(SampleBlock_t *block, uint32_t channel, const float *values);
+
+/**
+ * @brief Whether the block's channels are int16 (q15 kernels apply).
+ */
+static inline bool SampleBlock_IsS16(const SampleBlock_t *block)
+{
+    return (block->layout & SENSOR_LAYOUT_S32) == 0U;
+}
+
+/** @} */ /* end of sample_block group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_BLOCK_H */
@@ -0,0 +1,377 @@
+/**
+ * @file sample_ring.c
+ * @brief Lock-free single-producer, multi-reader sample ring implementation.
+ *
+ * Classic free-running index scheme: the producer only writes @c s_head,
+ * each reader only writes its own @c tail, and all are 32-bit so every
+ * access is a single atomic load or store on Cortex-M4. A data memory
+ * barrier orders the slot access against the index update on each side,
+ * so the other side never sees an index covering a slot that is not yet
+ * written (producer) or not yet read (reader). The producer finds the
+ * slowest reader by walking the reader list at each push; the list only
+ * changes with interrupts masked.
+ *
+ * Broadcast readers are on a list of their own that the producer never
+ * walks. The producer rewrites the slot of index i once the head reaches
+ * i + SAMPLE_RING_SIZE, so such a reader checks the head again after
+ * reading: a slot it read is intact while the head stays below that.
+ *
+ * The statistics are owned by the producer as well (high-water mark and
+ * overruns are evaluated at push time), so no counter has two writers.
+ *
+ * @ingroup sample_ring
+ */
+
+#include "sample_ring.h"
+#include "metrics.h"
+#include "stm32f4xx_hal.h"
+
+#if ((SAMPLE_RING_SIZE & (SAMPLE_RING_SIZE - 1U)) != 0U)
+#error "SAMPLE_RING_SIZE must be a power of two"
+#endif
+
+/** @brief Index mask for the ring storage. */
+#define SAMPLE_RING_INDEX_MASK   (SAMPLE_RING_SIZE - 1U)
+
+/**
+ * @brief Ring storage.
+ */
+static SensorSample_t s_samples[SAMPLE_RING_SIZE];
+
+/**
+ * @brief Free-running write index (owned by the producer).
+ */
+static volatile uint32_t s_head = 0U;
+
+/**
+ * @brief Registered readers that hold the producer back.
+ */
+static SampleRingReader_t *volatile s_readers = NULL;
+
+/**
+ * @brief Registered broadcast readers.
+ */
+static SampleRingReader_t *volatile s_broadcast = NULL;
+
+/**
+ * @brief Highest occupancy observed after a push.
+ */
+static volatile uint32_t s_highWater = 0U;
+
+/**
+ * @brief Samples accepted.
+ */
+static volatile uint32_t s_pushed = 0U;
+
+/**
+ * @brief Samples dropped because the ring was full.
+ */
+static volatile uint32_t s_overruns = 0U;
+
+/**
+ * @brief Samples the slowest reader has not released, for a given head.
+ */
+static uint32_t SampleRing_Retained(uint32_t head);
+
+/**
+ * @brief Link a reader into a list at the current head.
+ */
+static void SampleRing_Link(SampleRingReader_t *volatile *list, SampleRingReader_t *reader,
+                            const char *name, bool broadcast);
+
+/**
+ * @brief Read index of a reader, moved past the slots a broadcast reader
+ *        was lapped on (counted as its overruns).
+ */
+static uint32_t SampleRing_CatchUp(SampleRingReader_t *reader);
+
+/**
+ * @brief Samples from @p tail on that the producer may have overwritten
+ *        since they were read (0 for readers that hold it back).
+ */
+static uint32_t SampleRing_Lapped(const SampleRingReader_t *reader, uint32_t tail,
+                                  uint32_t count);
+
+/* ------------------------------------------------------------------------- */
+
+void SampleRing_Init(void)
+{
+    s_head      = 0U;
+    s_readers   = NULL;
+    s_broadcast = NULL;
+    s_highWater = 0U;
+    s_pushed    = 0U;
+    s_overruns  = 0U;
+
+    Metrics_PublishGauge(METRIC_RING_COUNT, SampleRing_GetCount);
+    Metrics_Set(METRIC_RING_CAPACITY, SAMPLE_RING_SIZE);
+    Metrics_Publish(METRIC_RING_HIGH_WATER, &s_highWater);
+    Metrics_Publish(METRIC_RING_PUSHED, &s_pushed);
+    Metrics_Publish(METRIC_RING_OVERRUNS, &s_overruns);
+}
+
+void SampleRing_AddReader(SampleRingReader_t *reader, const char *name)
+{
+    SampleRing_Link(&s_readers, reader, name, false);
+}
+
+void SampleRing_AddBroadcastReader(SampleRingReader_t *reader, const char *name)
+{
+    SampleRing_Link(&s_broadcast, reader, name, true);
+}
+
+void SampleRing_RemoveReader(SampleRingReader_t *reader)
+{
+    if (reader == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    SampleRingReader_t *volatile *link = reader->broadcast ? &s_broadcast : &s_readers;
+    for (; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == reader)
+        {
+            *link = reader->next;
+            break;
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+bool SampleRing_Push(const SensorSample_t *sample)
+{
+    if (sample == NULL)
+    {
+        return false;
+    }
+
+    uint32_t head = s_head;
+    uint32_t used = SampleRing_Retained(head);
+
+    if (used >= SAMPLE_RING_SIZE)
+    {
+        s_overruns++;
+        return false;
+    }
+
+    s_samples[head & SAMPLE_RING_INDEX_MASK] = *sample;
+
+    /* Publish the slot before the consumer can see the new head. */
+    __DMB();
+    s_head = head + 1U;
+    s_pushed++;
+
+    if ((used + 1U) > s_highWater)
+    {
+        s_highWater = used + 1U;
+    }
+
+    return true;
+}
+
+bool SampleRing_Pop(SampleRingReader_t *reader, SensorSample_t *sample)
+{
+    if ((reader == NULL) || (sample == NULL))
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        uint32_t tail = SampleRing_CatchUp(reader);
+        if (tail == s_head)
+        {
+            return false;
+        }
+
+        /* Read the head before the slot it covers. */
+        __DMB();
+        *sample = s_samples[tail & SAMPLE_RING_INDEX_MASK];
+
+        /* Finish reading the slot before the producer may reuse it. */
+        __DMB();
+        reader->tail = tail + 1U;
+
+        if (SampleRing_Lapped(reader, tail, 1U) == 0U)
+        {
+            return true;
+        }
+        reader->overruns++;
+    }
+}
+
+uint32_t SampleRing_Claim(SampleRingReader_t *reader, const SensorSample_t **samples)
+{
+    if ((reader == NULL) || (samples == NULL))
+    {
+        return 0U;
+    }
+
+    uint32_t tail  = SampleRing_CatchUp(reader);
+    uint32_t count = s_head - tail;
+
+    *samples = NULL;
+    if (count == 0U)
+    {
+        return 0U;
+    }
+
+    /* Read the head before the slots it covers. */
+    __DMB();
+
+    uint32_t index = tail & SAMPLE_RING_INDEX_MASK;
+    if (count > (SAMPLE_RING_SIZE - index))
+    {
+        count = SAMPLE_RING_SIZE - index;
+    }
+
+    *samples = &s_samples[index];
+    return count;
+}
+
+bool SampleRing_Release(SampleRingReader_t *reader, uint32_t count)
+{
+    if (reader == NULL)
+    {
+        return false;
+    }
+
+    uint32_t tail    = reader->tail;
+    uint32_t pending = s_head - tail;
+
+    if (count > pending)
+    {
+        count = pending;
+    }
+
+    /* Finish reading the slots before the producer may reuse them. */
+    __DMB();
+    uint32_t lost = SampleRing_Lapped(reader, tail, count);
+
+    reader->tail      = tail + count;
+    reader->overruns += lost;
+
+    return (lost == 0U);
+}
+
+uint32_t SampleRing_GetPending(const SampleRingReader_t *reader)
+{
+    if (reader == NULL)
+    {
+        return 0U;
+    }
+
+    uint32_t pending = s_head - reader->tail;
+    return (pending > SAMPLE_RING_SIZE) ? SAMPLE_RING_SIZE : pending;
+}
+
+uint32_t SampleRing_GetCount(void)
+{
+    return SampleRing_Retained(s_head);
+}
+
+void SampleRing_GetStats(SampleRingStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->capacity  = SAMPLE_RING_SIZE;
+    stats->count     = SampleRing_GetCount();
+    stats->highWater = s_highWater;
+    stats->pushed    = s_pushed;
+    stats->overruns  = s_overruns;
+}
+
+void SampleRing_ResetHighWater(void)
+{
+    s_highWater = SampleRing_GetCount();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t SampleRing_Retained(uint32_t head)
+{
+    uint32_t used = 0U;
+
+    for (const SampleRingReader_t *reader = s_readers; reader != NULL; reader = reader->next)
+    {
+        /* A tail past the head passed in: released after it was read. */
+        uint32_t pending = head - reader->tail;
+        if ((pending <= SAMPLE_RING_SIZE) && (pending > used))
+        {
+            used = pending;
+        }
+    }
+
+    return used;
+}
+
+static void SampleRing_Link(SampleRingReader_t *volatile *list, SampleRingReader_t *reader,
+                            const char *name, bool broadcast)
+{
+    if (reader == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    reader->name      = name;
+    reader->tail      = s_head;
+    reader->overruns  = 0U;
+    reader->broadcast = broadcast;
+    reader->next      = *list;
+    *list             = reader;
+
+    __set_PRIMASK(primask);
+}
+
+static uint32_t SampleRing_CatchUp(SampleRingReader_t *reader)
+{
+    uint32_t tail = reader->tail;
+
+    if (reader->broadcast)
+    {
+        /* The slot of head - SIZE may be being rewritten: start after it. */
+        uint32_t behind = s_head - tail;
+        if (behind >= SAMPLE_RING_SIZE)
+        {
+            uint32_t skip = behind - (SAMPLE_RING_SIZE - 1U);
+
+            tail              += skip;
+            reader->overruns  += skip;
+            reader->tail       = tail;
+        }
+    }
+
+    return tail;
+}
+
+static uint32_t SampleRing_Lapped(const SampleRingReader_t *reader, uint32_t tail,
+                                  uint32_t count)
+{
+    if (!reader->broadcast)
+    {
+        return 0U;
+    }
+
+    /* Index tail + k is rewritten once the head reaches tail + k + SIZE. */
+    uint32_t behind = s_head - tail;
+    if (behind < SAMPLE_RING_SIZE)
+    {
+        return 0U;
+    }
+
+    uint32_t lost = behind - SAMPLE_RING_SIZE + 1U;
+    return (lost < count) ? lost : count;
+}
@@ -0,0 +1,239 @@
+/**
+ * @file sample_ring.h
+ * @brief Lock-free single-producer, multi-reader sensor sample ring.
+ *
+ * Decouples acquisition from processing: the sensor path pushes each
+ * reading into a statically allocated ring and consumers (logging,
+ * filtering, telemetry, storage) read at their own rate. The producer may
+ * run in an ISR or DMA completion callback and the readers in tasks, or
+ * the other way round, without any locking, provided there is exactly one
+ * producer.
+ *
+ * Every consumer registers a @ref SampleRingReader_t with its own read
+ * index, so all of them see every sample. A reader either copies samples
+ * out (SampleRing_Pop(), for consumers that modify them) or reads them in
+ * place: SampleRing_Claim() returns a span of ring slots that stay valid
+ * until SampleRing_Release() hands them back. A slot is reused only once
+ * every reader has released it, so the slowest reader sets what the ring
+ * retains and when it overruns.
+ *
+ * A broadcast reader (SampleRing_AddBroadcastReader()) does not hold the
+ * producer back: the producer never looks at it, so it costs nothing per
+ * push. Falling a whole ring behind, it skips to the oldest sample still
+ * intact and counts what it missed as its own overruns; a span it read
+ * in place while the producer lapped it is reported by the release.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+
+/**
+ * @defgroup sample_ring Sample Ring
+ * @brief SPSC ring of tagged sensor readings.
+ * @ingroup sensors
+ * @{
+ */
+
+/**
+ * @brief Number of samples the ring can hold.
+ *
+ * Must be a power of two. Sized for one full drain of a 32-entry sensor
+ * FIFO plus headroom for the other sensors.
+ */
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE   (64U)
+#endif
+
+/**
+ * @brief One queued reading.
+ *
+ * SensorData_t already carries the ID of its sensor and has no padding,
+ * so ring slots hold the samples unchanged (24 bytes, all channels of a
+ * multi-axis sensor included).
+ */
+typedef SensorData_t SensorSample_t;
+
+/**
+ * @brief A consumer of the ring; see SampleRing_AddReader().
+ *
+ * Kept by its owner in static storage; the ring links the registered
+ * readers.
+ */
+typedef struct SampleRingReader
+{
+    const char                       *name;      /**< For diagnostics.                   */
+    volatile uint32_t                 tail;      /**< Read index (owned by the reader).  */
+    uint32_t                          overruns;  /**< Samples a broadcast reader missed. */
+    bool                              broadcast; /**< Does not hold the producer back.   */
+    struct SampleRingReader *volatile next;      /**< Registration link.                 */
+} SampleRingReader_t;
+
+/**
+ * @brief Ring occupancy and loss counters.
+ */
+typedef struct
+{
+    uint32_t capacity;  /**< SAMPLE_RING_SIZE.                          */
+    uint32_t count;     /**< Samples retained for the slowest reader.   */
+    uint32_t highWater; /**< Largest count since initialization or      */
+                        /**< SampleRing_ResetHighWater().               */
+    uint32_t pushed;    /**< Samples accepted since initialization.     */
+    uint32_t overruns;  /**< Samples dropped because the ring was full. */
+} SampleRingStats_t;
+
+/**
+ * @brief Empty the ring, drop every reader and clear all counters.
+ *
+ * Must not race with a push or read.
+ *
+ * @return None.
+ */
+void SampleRing_Init(void);
+
+/**
+ * @brief Register a reader.
+ *
+ * It sees the samples pushed from now on. Safe while the producer runs.
+ *
+ * @param reader Reader storage (static; not registered yet).
+ * @param name   Name for diagnostics.
+ *
+ * @return None.
+ */
+void SampleRing_AddReader(SampleRingReader_t *reader, const char *name);
+
+/**
+ * @brief Register a broadcast reader: one that may lose samples rather
+ *        than make the producer drop them.
+ *
+ * It sees the samples pushed from now on, as long as it keeps within a
+ * ring of the producer. Safe while the producer runs.
+ *
+ * @param reader Reader storage (static; not registered yet).
+ * @param name   Name for diagnostics.
+ *
+ * @return None.
+ */
+void SampleRing_AddBroadcastReader(SampleRingReader_t *reader, const char *name);
+
+/**
+ * @brief Unregister a reader; the samples it still held are released.
+ *
+ * Nothing may be claimed by it any more. Safe while the producer runs.
+ *
+ * @param reader Registered reader.
+ *
+ * @return None.
+ */
+void SampleRing_RemoveReader(SampleRingReader_t *reader);
+
+/**
+ * @brief Queue a sample (producer side).
+ *
+ * When the slowest reader has not released a whole ring, the new sample
+ * is dropped and the overrun counter is increased; samples a reader has
+ * not released are never overwritten. With no reader registered nothing
+ * is retained.
+ *
+ * Safe to call from interrupt context.
+ *
+ * @param sample Sample to copy into the ring.
+ *
+ * @return true if queued, false if dropped.
+ */
+bool SampleRing_Push(const SensorSample_t *sample);
+
+/**
+ * @brief Copy out and release the reader's oldest sample.
+ *
+ * A broadcast reader never gets a sample the producer overwrote while it
+ * was copied; it gets the next intact one.
+ *
+ * @param reader      Registered reader.
+ * @param[out] sample Receives the sample.
+ *
+ * @return true if a sample was returned, false if the reader is up to date.
+ */
+bool SampleRing_Pop(SampleRingReader_t *reader, SensorSample_t *sample);
+
+/**
+ * @brief Borrow the reader's oldest samples in place.
+ *
+ * The span is the contiguous run of unread slots from the reader's index,
+ * so at the ring's end it stops where storage wraps: claim again after
+ * the release for the rest. The slots are not written until released.
+ * Claiming again without a release returns the same start.
+ *
+ * @param reader       Registered reader.
+ * @param[out] samples Receives the first sample of the span (NULL if none).
+ *
+ * @return Samples in the span (0 if the reader is up to date).
+ */
+uint32_t SampleRing_Claim(SampleRingReader_t *reader, const SensorSample_t **samples);
+
+/**
+ * @brief Hand back the first @p count samples of the reader's claim.
+ *
+ * @param reader Registered reader.
+ * @param count  Samples done with (at most the claimed span).
+ *
+ * @return true if they were intact while claimed; false if the producer
+ *         overwrote some of them (broadcast readers only; the lost ones
+ *         are counted in its overruns and what was read from them is
+ *         to be discarded).
+ */
+bool SampleRing_Release(SampleRingReader_t *reader, uint32_t count);
+
+/**
+ * @brief Number of samples the reader has not released.
+ *
+ * @param reader Registered reader.
+ *
+ * @return Sample count (a snapshot; the producer may push concurrently),
+ *         at most a ring.
+ */
+uint32_t SampleRing_GetPending(const SampleRingReader_t *reader);
+
+/**
+ * @brief Number of samples the ring retains: those the slowest reader
+ *        has not released.
+ *
+ * @return Sample count (a snapshot; either side may move concurrently).
+ */
+uint32_t SampleRing_GetCount(void);
+
+/**
+ * @brief Snapshot the occupancy and loss counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void SampleRing_GetStats(SampleRingStats_t *stats);
+
+/**
+ * @brief Restart the high-water mark from the current count.
+ *
+ * Call from the producer's context or with it locked out.
+ *
+ * @return None.
+ */
+void SampleRing_ResetHighWater(void);
+
+/** @} */ /* end of sample_ring group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_RING_H */
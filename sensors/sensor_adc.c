@@ -0,0 +1,676 @@
+/**
+ * @file sensor_adc.c
+ * @brief On-chip ADC sensors implementation.
+ *
+ * TIM2 TRGO (update) starts a regular scan of every channel; the ADC
+ * requests DMA after each conversion (DDS), and DMA2 stream 0 (channel 0)
+ * fills the circular buffer s_dmaBuffer[2][SENSOR_ADC_DMA_SCANS][CH]. The
+ * half-transfer and transfer-complete interrupts each accumulate one
+ * half. Registers are accessed directly; the HAL ADC and TIM drivers are
+ * not part of this project.
+ *
+ * The decimation ratio (scans per sample) follows the power mode; a
+ * window that is open when the ratio changes closes at the new ratio,
+ * and each frame records how many scans it summed. Timestamps are
+ * computed from the scan count since the start rather than read from the
+ * clocks in the interrupt, so consecutive samples are exactly one output
+ * period apart.
+ *
+ * The FIFO holds raw sums; conversion to physical units happens in the
+ * registry drain, in task context. @ref SensorIF_t functions take no
+ * context argument, so each channel has a readBatch() thunk.
+ *
+ * @ingroup sensor_adc
+ */
+
+#include "sensor_adc.h"
+#include "sensor_registry.h"
+#include "sensor_deadband.h"
+#include "periph_power.h"
+#include "time_base.h"
+#include "cli.h"
+#include "log.h"
+#include "app_config.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+
+_Static_assert(((SENSOR_ADC_OVERSAMPLE % SENSOR_ADC_DMA_SCANS) == 0U) &&
+               ((SENSOR_ADC_OVERSAMPLE_IDLE % SENSOR_ADC_DMA_SCANS) == 0U),
+               "SENSOR_ADC_OVERSAMPLE(_IDLE) must be a multiple of SENSOR_ADC_DMA_SCANS");
+_Static_assert(((SENSOR_ADC_OVERSAMPLE * 4095ULL) <= (0xFFFFFFFFU / 16U)) &&
+               ((SENSOR_ADC_OVERSAMPLE_IDLE * 4095ULL) <= (0xFFFFFFFFU / 16U)),
+               "SENSOR_ADC_OVERSAMPLE(_IDLE) too large for 32-bit sums");
+
+/**
+ * @name Factory calibration (system memory, DS10693 3.15 / 6.3.22)
+ * @brief Raw readings at VDDA = 3.3 V; TS_CAL1 at 30 °C, TS_CAL2 at 110 °C.
+ * @{
+ */
+#ifndef SENSOR_ADC_VREFINT_CAL_ADDR
+#define SENSOR_ADC_VREFINT_CAL_ADDR   (0x1FFF7A2AU)
+#endif
+#ifndef SENSOR_ADC_TS_CAL1_ADDR
+#define SENSOR_ADC_TS_CAL1_ADDR       (0x1FFF7A2CU)
+#endif
+#ifndef SENSOR_ADC_TS_CAL2_ADDR
+#define SENSOR_ADC_TS_CAL2_ADDR       (0x1FFF7A2EU)
+#endif
+/** @} */
+
+/** @brief VDDA at which the calibration words were taken (V). */
+#define SENSOR_ADC_CAL_VDDA          (3.3f)
+
+/** @brief Full scale of a 12-bit conversion. */
+#define SENSOR_ADC_FULL_SCALE        (4095.0f)
+
+/** @brief TIM2 counter frequency. */
+#define SENSOR_ADC_TIMER_HZ          (1000000U)
+
+/** @brief Scans per sample, indexed by @ref PowerMode_t (0: stopped). */
+static const uint32_t s_oversample[POWER_MODE_COUNT] =
+{
+    [POWER_MODE_ACTIVE] = SENSOR_ADC_OVERSAMPLE,
+    [POWER_MODE_IDLE]   = SENSOR_ADC_OVERSAMPLE_IDLE
+};
+
+/** @brief ADC channel numbers, indexed by @ref SensorAdcChannel_t. */
+static const uint8_t s_adcChannel[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = 17U,
+    [SENSOR_ADC_CH_TEMP]    = 18U,
+    [SENSOR_ADC_CH_A0]      = 0U,
+    [SENSOR_ADC_CH_A1]      = 1U
+};
+
+/**
+ * @brief Sample time codes (SMPRx), indexed by @ref SensorAdcChannel_t.
+ *
+ * The temperature sensor and Vrefint need at least 10 us: 480 cycles is
+ * 21 us at the fastest ADC clock (22.5 MHz). The pins get 144 cycles.
+ */
+static const uint8_t s_sampleTime[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = 7U,
+    [SENSOR_ADC_CH_TEMP]    = 7U,
+    [SENSOR_ADC_CH_A0]      = 6U,
+    [SENSOR_ADC_CH_A1]      = 6U
+};
+
+/** @brief Registry names, indexed by @ref SensorAdcChannel_t. */
+static const char *const s_names[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = "AdcVdda",
+    [SENSOR_ADC_CH_TEMP]    = "AdcTemp",
+    [SENSOR_ADC_CH_A0]      = "AdcA0",
+    [SENSOR_ADC_CH_A1]      = "AdcA1"
+};
+
+/**
+ * @brief Default deadbands (V, °C), so the channels report by exception.
+ */
+static const float s_deadband[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = 0.01f,
+    [SENSOR_ADC_CH_TEMP]    = 0.5f,
+    [SENSOR_ADC_CH_A0]      = 0.01f,
+    [SENSOR_ADC_CH_A1]      = 0.01f
+};
+
+/**
+ * @brief One oversampled sample of every channel.
+ */
+typedef struct
+{
+    uint32_t sum[SENSOR_ADC_CH_COUNT]; /**< Sum of @ref scans readings.            */
+    uint32_t scans;                    /**< Scans summed.                          */
+    uint32_t timestamp;                /**< Window midpoint (HAL tick).            */
+    uint32_t timestamp_us;             /**< Window midpoint (Time_NowUs32()).      */
+} SensorAdcFrame_t;
+
+/**
+ * @brief Circular DMA target: two halves of SENSOR_ADC_DMA_SCANS scans.
+ */
+static uint16_t s_dmaBuffer[2][SENSOR_ADC_DMA_SCANS][SENSOR_ADC_CH_COUNT];
+
+/** @brief Running sums of the current oversampling window. */
+static uint32_t s_accum[SENSOR_ADC_CH_COUNT];
+
+/** @brief Scans in the current oversampling window. */
+static uint32_t s_accumScans = 0U;
+
+/** @brief Scans per sample in the current power mode. */
+static volatile uint32_t s_decimation = SENSOR_ADC_OVERSAMPLE;
+
+/** @brief Scans since SensorAdc_Start(): the time base of the timestamps. */
+static uint64_t s_scanCount = 0U;
+
+/** @brief HAL tick and Time_NowUs32() at the first trigger after a start. */
+static uint32_t s_startMs = 0U;
+static uint32_t s_startUs = 0U;
+
+/** @brief Oversampled samples, shared by all channels. */
+static SensorAdcFrame_t s_fifo[SENSOR_ADC_FIFO_DEPTH];
+
+/** @brief Free-running FIFO write index (interrupt side). */
+static volatile uint32_t s_fifoHead = 0U;
+
+/** @brief Free-running FIFO read index of each channel (task side). */
+static uint32_t s_fifoTail[SENSOR_ADC_CH_COUNT];
+
+/** @brief Counters reported by SensorAdc_GetStats(). */
+static SensorAdcStats_t s_stats;
+
+/** @brief Registry records of the channels. */
+static SensorEntry_t s_entries[SENSOR_ADC_CH_COUNT];
+
+/** @brief Set by the DMA interrupt after a transfer error. */
+static volatile bool s_restart = false;
+
+/** @brief Set once SensorAdc_Init() has configured the hardware. */
+static bool s_initialized = false;
+
+/**
+ * @brief Shared readBatch() implementation.
+ */
+static size_t SensorAdc_ReadChannel(SensorAdcChannel_t channel, SensorData_t *out, size_t max);
+
+/** @brief Define the readBatch() thunk of channel @p ch. */
+#define SENSOR_ADC_DEFINE_READ(name, ch)                                \
+    static size_t SensorAdc_Read##name(SensorData_t *out, size_t max)  \
+    {                                                                   \
+        return SensorAdc_ReadChannel((ch), out, max);                   \
+    }
+
+SENSOR_ADC_DEFINE_READ(Vdda, SENSOR_ADC_CH_VREFINT)
+SENSOR_ADC_DEFINE_READ(Temp, SENSOR_ADC_CH_TEMP)
+SENSOR_ADC_DEFINE_READ(A0,   SENSOR_ADC_CH_A0)
+SENSOR_ADC_DEFINE_READ(A1,   SENSOR_ADC_CH_A1)
+
+/**
+ * @brief Sample scale of each channel: mV, 0.01 °C, mV, mV (int16).
+ */
+static const int8_t s_scaleExp[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = -3,
+    [SENSOR_ADC_CH_TEMP]    = -2,
+    [SENSOR_ADC_CH_A0]      = -3,
+    [SENSOR_ADC_CH_A1]      = -3
+};
+
+/**
+ * @brief One interface per channel.
+ */
+static const SensorIF_t s_channelIF[SENSOR_ADC_CH_COUNT] =
+{
+    [SENSOR_ADC_CH_VREFINT] = { .readBatch = SensorAdc_ReadVdda },
+    [SENSOR_ADC_CH_TEMP]    = { .readBatch = SensorAdc_ReadTemp },
+    [SENSOR_ADC_CH_A0]      = { .readBatch = SensorAdc_ReadA0 },
+    [SENSOR_ADC_CH_A1]      = { .readBatch = SensorAdc_ReadA1 }
+};
+
+/**
+ * @brief Take the clocks and start the timer, ADC and DMA.
+ */
+static void SensorAdc_Start(void);
+
+/**
+ * @brief Stop the timer, ADC and DMA and release their clocks.
+ */
+static void SensorAdc_Stop(void);
+
+/**
+ * @brief Load the TIM2 prescaler for the current APB1 clock.
+ */
+static void SensorAdc_SetTimerPrescaler(void);
+
+/**
+ * @brief Add one DMA half to the window; emit a FIFO frame when full.
+ */
+static void SensorAdc_Accumulate(const uint16_t (*half)[SENSOR_ADC_CH_COUNT]);
+
+/**
+ * @brief Convert a frame to the units of @p channel.
+ */
+static float SensorAdc_Convert(const SensorAdcFrame_t *frame, SensorAdcChannel_t channel);
+
+/**
+ * @brief CLI "adc" handler.
+ */
+static void SensorAdc_CmdAdc(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorAdc_Init(void)
+{
+    if (SENSOR_ADC_ENABLE == 0)
+    {
+        return;
+    }
+
+    /* PA0/PA1 analog; the GPIO clock is only needed for this write. */
+    PeriphPower_Acquire(PERIPH_POWER_GPIOA);
+    GPIOA->MODER |= GPIO_MODER_MODER0 | GPIO_MODER_MODER1;
+    GPIOA->PUPDR &= ~(GPIO_PUPDR_PUPDR0 | GPIO_PUPDR_PUPDR1);
+    PeriphPower_Release(PERIPH_POWER_GPIOA);
+
+    s_fifoHead   = 0U;
+    s_accumScans = 0U;
+    s_stats      = (SensorAdcStats_t){0};
+
+    for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+    {
+        s_fifoTail[i] = 0U;
+
+        s_entries[i]       = (SensorEntry_t){0};
+        s_entries[i].id    = (uint8_t)(SENSOR_ADC_FIRST_ID + i);
+        s_entries[i].name  = s_names[i];
+        s_entries[i].iface = &s_channelIF[i];
+        s_entries[i].period_ms[POWER_MODE_ACTIVE] = SENSOR_ADC_PERIOD_ACTIVE_MS;
+        s_entries[i].period_ms[POWER_MODE_IDLE]   = SENSOR_ADC_PERIOD_IDLE_MS;
+
+        if (SensorRegistry_Register(&s_entries[i]) != 0)
+        {
+            LOG_WARN("SensorAdc: cannot register %s", s_names[i]);
+        }
+
+        SensorDeadbandConfig_t deadband =
+        {
+            .deadband      = s_deadband[i],
+            .maxSilence_ms = SIMTEMP_MAX_SILENCE_MS
+        };
+        (void)SensorDeadband_Configure(s_entries[i].id, &deadband);
+    }
+
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, IRQ_PRIO_ADC_DMA, 0U);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+
+    (void)CLI_RegisterCommand("adc", SensorAdc_CmdAdc,
+                              "- Show ADC scan rate, counters and channel readings");
+
+    s_initialized = true;
+    LOG_INFO("SensorAdc: %lu channel(s), %lu Hz scan, %lux/%lux decimation",
+             (unsigned long)SENSOR_ADC_CH_COUNT,
+             (unsigned long)SENSOR_ADC_SCAN_HZ,
+             (unsigned long)SENSOR_ADC_OVERSAMPLE,
+             (unsigned long)SENSOR_ADC_OVERSAMPLE_IDLE);
+}
+
+void SensorAdc_ApplyMode(PowerMode_t mode)
+{
+    if (!s_initialized)
+    {
+        return;
+    }
+
+    bool wanted = (mode < POWER_MODE_COUNT) &&
+                  (s_entries[0].period_ms[mode] != 0U) &&
+                  (s_oversample[mode] != 0U);
+
+    if (wanted)
+    {
+        /* One word, read once per DMA half by the interrupt. */
+        s_decimation = s_oversample[mode];
+    }
+
+    if (s_stats.running && (s_restart || ((ADC1->SR & ADC_SR_OVR) != 0U)))
+    {
+        /* DMA fell behind and the ADC stopped requesting, or the stream
+         * disabled itself on an error: start over.
+         */
+        if (!s_restart)
+        {
+            s_stats.errors++;
+        }
+        s_restart = false;
+        SensorAdc_Stop();
+    }
+
+    if (wanted && !s_stats.running)
+    {
+        SensorAdc_Start();
+    }
+    else if (!wanted && s_stats.running)
+    {
+        SensorAdc_Stop();
+    }
+}
+
+void SensorAdc_OnClockChange(void)
+{
+    if (s_stats.running)
+    {
+        SensorAdc_SetTimerPrescaler();
+    }
+}
+
+void SensorAdc_DmaIrqHandler(void)
+{
+    uint32_t flags = DMA2->LISR;
+    DMA2->LIFCR = DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+
+    if ((flags & (DMA_LISR_TEIF0 | DMA_LISR_DMEIF0)) != 0U)
+    {
+        /* The stream disables itself; SensorAdc_ApplyMode() restarts it. */
+        s_stats.errors++;
+        s_restart = true;
+        return;
+    }
+
+    if ((flags & DMA_LISR_HTIF0) != 0U)
+    {
+        SensorAdc_Accumulate(s_dmaBuffer[0]);
+    }
+    if ((flags & DMA_LISR_TCIF0) != 0U)
+    {
+        SensorAdc_Accumulate(s_dmaBuffer[1]);
+    }
+}
+
+uint32_t SensorAdc_GetSamplePeriodUs(PowerMode_t mode)
+{
+    if ((mode >= POWER_MODE_COUNT) || (s_entries[0].period_ms[mode] == 0U))
+    {
+        return 0U;
+    }
+
+    return (uint32_t)(((uint64_t)s_oversample[mode] * 1000000U) / SENSOR_ADC_SCAN_HZ);
+}
+
+void SensorAdc_GetStats(SensorAdcStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = s_stats;
+    __set_PRIMASK(primask);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void SensorAdc_Start(void)
+{
+    PeriphPower_Acquire(PERIPH_POWER_DMA2);
+    PeriphPower_Acquire(PERIPH_POWER_ADC1);
+    PeriphPower_Acquire(PERIPH_POWER_TIM2);
+
+    /* Common: PCLK2 / 4 (at most 22.5 MHz), temperature sensor and Vrefint on. */
+    ADC->CCR = (ADC->CCR & ~(ADC_CCR_ADCPRE | ADC_CCR_VBATE)) |
+               ADC_CCR_ADCPRE_0 | ADC_CCR_TSVREFE;
+
+    ADC1->CR2 = 0U;
+    ADC1->SR  = 0U;
+    ADC1->CR1 = ADC_CR1_SCAN;
+
+    uint32_t smpr1 = 0U;
+    uint32_t smpr2 = 0U;
+    uint32_t sqr3  = 0U;
+    for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+    {
+        uint32_t ch = s_adcChannel[i];
+
+        if (ch >= 10U)
+        {
+            smpr1 |= (uint32_t)s_sampleTime[i] << (3U * (ch - 10U));
+        }
+        else
+        {
+            smpr2 |= (uint32_t)s_sampleTime[i] << (3U * ch);
+        }
+        sqr3 |= ch << (5U * i);
+    }
+    ADC1->SMPR1 = smpr1;
+    ADC1->SMPR2 = smpr2;
+    ADC1->SQR1  = (SENSOR_ADC_CH_COUNT - 1U) << ADC_SQR1_L_Pos;
+    ADC1->SQR2  = 0U;
+    ADC1->SQR3  = sqr3;
+
+    /* Circular, 16-bit, peripheral to memory, half/full/error interrupts. */
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while ((DMA2_Stream0->CR & DMA_SxCR_EN) != 0U)
+    {
+    }
+    DMA2->LIFCR = DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTCIF0 | DMA_LIFCR_CTEIF0 |
+                  DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+    DMA2_Stream0->PAR  = (uint32_t)(uintptr_t)&ADC1->DR;
+    DMA2_Stream0->M0AR = (uint32_t)(uintptr_t)s_dmaBuffer;
+    DMA2_Stream0->NDTR = sizeof(s_dmaBuffer) / sizeof(s_dmaBuffer[0][0][0]);
+    DMA2_Stream0->FCR  = 0U;
+    DMA2_Stream0->CR   = DMA_SxCR_PL_0 | DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 |
+                         DMA_SxCR_MINC | DMA_SxCR_CIRC |
+                         DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE | DMA_SxCR_DMEIE;
+    DMA2_Stream0->CR  |= DMA_SxCR_EN;
+
+    s_accumScans = 0U;
+    s_scanCount  = 0U;
+    for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+    {
+        s_accum[i] = 0U;
+    }
+
+    /* Rising edge of TIM2 TRGO (EXTSEL 0110) starts each scan. */
+    ADC1->CR2 = ADC_CR2_ADON | ADC_CR2_DMA | ADC_CR2_DDS |
+                ADC_CR2_EXTEN_0 | ADC_CR2_EXTSEL_1 | ADC_CR2_EXTSEL_2;
+
+    /* TRGO on update, one update per scan period. */
+    TIM2->CR1 = 0U;
+    TIM2->CR2 = TIM_CR2_MMS_1;
+    TIM2->ARR = (SENSOR_ADC_TIMER_HZ / SENSOR_ADC_SCAN_HZ) - 1U;
+    SensorAdc_SetTimerPrescaler();
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->SR  = 0U;
+
+    /* The first scan is triggered one period after the counter starts. */
+    s_startMs = HAL_GetTick() + (1000U / SENSOR_ADC_SCAN_HZ);
+    s_startUs = Time_NowUs32() + (1000000U / SENSOR_ADC_SCAN_HZ);
+    TIM2->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    s_stats.running = true;
+}
+
+static void SensorAdc_Stop(void)
+{
+    TIM2->CR1 = 0U;
+    ADC1->CR2 = 0U;
+
+    DMA2_Stream0->CR &= ~DMA_SxCR_EN;
+    while ((DMA2_Stream0->CR & DMA_SxCR_EN) != 0U)
+    {
+    }
+    ADC1->SR = 0U;
+
+    PeriphPower_Release(PERIPH_POWER_TIM2);
+    PeriphPower_Release(PERIPH_POWER_ADC1);
+    PeriphPower_Release(PERIPH_POWER_DMA2);
+
+    s_stats.running = false;
+}
+
+static void SensorAdc_SetTimerPrescaler(void)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    uint32_t timer = ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) ? pclk1 : (2U * pclk1);
+
+    /* Buffered: takes effect at the next update, so the scan rate does
+     * not jump mid-period.
+     */
+    TIM2->PSC = (timer / SENSOR_ADC_TIMER_HZ) - 1U;
+}
+
+static void SensorAdc_Accumulate(const uint16_t (*half)[SENSOR_ADC_CH_COUNT])
+{
+    for (uint32_t scan = 0U; scan < SENSOR_ADC_DMA_SCANS; ++scan)
+    {
+        for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+        {
+            s_accum[i] += half[scan][i];
+        }
+    }
+
+    s_stats.scans += SENSOR_ADC_DMA_SCANS;
+    s_accumScans  += SENSOR_ADC_DMA_SCANS;
+    s_scanCount   += SENSOR_ADC_DMA_SCANS;
+    if (s_accumScans < s_decimation)
+    {
+        return;
+    }
+
+    /* Stamp the middle of the window the sums cover, on the scan grid
+     * (scan n is triggered n scan periods after the first one), in half
+     * scan periods so that even windows land exactly.
+     */
+    uint64_t mid2 = (2U * s_scanCount) - s_accumScans - 1U;
+
+    SensorAdcFrame_t *frame = &s_fifo[s_fifoHead % SENSOR_ADC_FIFO_DEPTH];
+    for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+    {
+        frame->sum[i]    = s_accum[i];
+        s_stats.raw[i]   = (s_accum[i] * 16U) / s_accumScans;
+        s_accum[i]       = 0U;
+    }
+    frame->scans        = s_accumScans;
+    frame->timestamp    = s_startMs + (uint32_t)((mid2 * 1000U) / (2U * SENSOR_ADC_SCAN_HZ));
+    frame->timestamp_us = s_startUs + (uint32_t)((mid2 * 1000000U) / (2U * SENSOR_ADC_SCAN_HZ));
+
+    s_accumScans = 0U;
+    s_stats.samples++;
+
+    /* Publish the frame before the new head becomes visible to the task. */
+    __DMB();
+    s_fifoHead++;
+}
+
+static size_t SensorAdc_ReadChannel(SensorAdcChannel_t channel, SensorData_t *out, size_t max)
+{
+    if (out == NULL)
+    {
+        return 0U;
+    }
+
+    size_t count = 0U;
+    bool   gap   = false;
+
+    while (count < max)
+    {
+        SensorAdcFrame_t frame;
+        bool             have = false;
+
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        uint32_t head = s_fifoHead;
+        if ((head - s_fifoTail[channel]) > SENSOR_ADC_FIFO_DEPTH)
+        {
+            s_stats.fifoDrops += (head - s_fifoTail[channel]) - SENSOR_ADC_FIFO_DEPTH;
+            s_fifoTail[channel] = head - SENSOR_ADC_FIFO_DEPTH;
+            gap = true;
+        }
+        if (s_fifoTail[channel] != head)
+        {
+            frame = s_fifo[s_fifoTail[channel] % SENSOR_ADC_FIFO_DEPTH];
+            s_fifoTail[channel]++;
+            have = true;
+        }
+
+        __set_PRIMASK(primask);
+
+        if (!have)
+        {
+            break;
+        }
+
+        SensorData_Init(&out[count], SENSOR_FORMAT_S16, 1U, s_scaleExp[channel]);
+        SensorData_SetFloat(&out[count], 0U, SensorAdc_Convert(&frame, channel));
+        if (frame.sum[channel] >= (uint32_t)(SENSOR_ADC_FULL_SCALE * (float)frame.scans))
+        {
+            out[count].quality |= SENSOR_QUALITY_CLIPPED;
+        }
+        if (gap)
+        {
+            out[count].quality |= SENSOR_QUALITY_GAP;
+            gap = false;
+        }
+        out[count].timestamp    = frame.timestamp;
+        out[count].timestamp_us = frame.timestamp_us;
+        count++;
+    }
+
+    return count;
+}
+
+static float SensorAdc_Convert(const SensorAdcFrame_t *frame, SensorAdcChannel_t channel)
+{
+    const float oversample = (float)frame->scans;
+    uint16_t    vrefCal    = *(const volatile uint16_t *)SENSOR_ADC_VREFINT_CAL_ADDR;
+    float       vref       = (float)frame->sum[SENSOR_ADC_CH_VREFINT] / oversample;
+
+    /* VDDA from the reference: it reads vrefCal counts at 3.3 V. */
+    float vdda = (vref > 0.0f) ? ((SENSOR_ADC_CAL_VDDA * (float)vrefCal) / vref) : 0.0f;
+    float avg  = (float)frame->sum[channel] / oversample;
+
+    switch (channel)
+    {
+        case SENSOR_ADC_CH_VREFINT:
+            return vdda;
+
+        case SENSOR_ADC_CH_TEMP:
+        {
+            float cal1 = (float)*(const volatile uint16_t *)SENSOR_ADC_TS_CAL1_ADDR;
+            float cal2 = (float)*(const volatile uint16_t *)SENSOR_ADC_TS_CAL2_ADDR;
+
+            if (cal2 <= cal1)
+            {
+                return 0.0f;
+            }
+
+            /* Rescale to the 3.3 V the calibration was taken at. */
+            float ts = (avg * vdda) / SENSOR_ADC_CAL_VDDA;
+            return 30.0f + (((ts - cal1) * 80.0f) / (cal2 - cal1));
+        }
+
+        default:
+            return (avg * vdda) / SENSOR_ADC_FULL_SCALE;
+    }
+}
+
+static void SensorAdc_CmdAdc(uint32_t argc, char *argv[])
+{
+    (void)argc;
+    (void)argv;
+
+    SensorAdcStats_t stats;
+    SensorAdc_GetStats(&stats);
+
+    CLI_Print("\r\nADC (%s): %lu Hz scan, %lux decimation, %lu ms per sample\r\n",
+              stats.running ? "running" : "stopped",
+              (unsigned long)SENSOR_ADC_SCAN_HZ,
+              (unsigned long)s_decimation,
+              (unsigned long)((s_decimation * 1000U) / SENSOR_ADC_SCAN_HZ));
+    CLI_Print("  Output period: ACTIVE %lu us, IDLE %lu us, SLEEP/STOP off\r\n",
+              (unsigned long)SensorAdc_GetSamplePeriodUs(POWER_MODE_ACTIVE),
+              (unsigned long)SensorAdc_GetSamplePeriodUs(POWER_MODE_IDLE));
+    CLI_Print("  Scans %lu, samples %lu, FIFO drops %lu, errors %lu\r\n",
+              (unsigned long)stats.scans,
+              (unsigned long)stats.samples,
+              (unsigned long)stats.fifoDrops,
+              (unsigned long)stats.errors);
+    CLI_Print("  %3s %-8s %4s %10s %10s\r\n", "id", "name", "ch", "raw", "value");
+
+    for (uint32_t i = 0U; i < SENSOR_ADC_CH_COUNT; ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_Find(s_entries[i].id);
+
+        CLI_Print("  %3u %-8s %4u %10.2f %10.3f\r\n",
+                  (unsigned)s_entries[i].id,
+                  s_names[i],
+                  (unsigned)s_adcChannel[i],
+                  (double)((float)stats.raw[i] / 16.0f),
+                  (double)((entry != NULL) ? SensorData_GetFloat(&entry->last, 0U) : 0.0f));
+    }
+}
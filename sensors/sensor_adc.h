@@ -0,0 +1,168 @@
+/**
+ * @file sensor_adc.h
+ * @brief On-chip ADC sensors: timer-triggered DMA scan with oversampling.
+ *
+ * ADC1 scans the internal reference (Vrefint), the internal temperature
+ * sensor and the Arduino A0/A1 pins (PA0, PA1) on every TIM2 update, at
+ * @ref SENSOR_ADC_SCAN_HZ. DMA2 stream 0 writes the scans into a circular
+ * double buffer; each half-transfer interrupt adds one half to the running
+ * per-channel sums while the DMA fills the other half, so the CPU does no
+ * work per conversion and the sample instants have timer accuracy.
+ *
+ * The scan rate never changes. Every @ref SENSOR_ADC_OVERSAMPLE scans
+ * (@ref SENSOR_ADC_OVERSAMPLE_IDLE in IDLE) the sums become one sample
+ * per channel in a small FIFO, so the output rate follows the power mode
+ * while every conversion still contributes: the sum over the whole output
+ * period is a first-order CIC decimator, whose sinc response nulls every
+ * multiple of the output rate, so nothing aliases the way a slower read
+ * rate would. The STM32F446 ADC has no hardware oversampling; the sums are
+ * the software equivalent: averaging 4^n scans adds n bits to the 12-bit
+ * result when the input carries about one LSB of noise, and the FIFO
+ * keeps the full sums. Sample timestamps sit on the scan grid, exactly
+ * SensorAdc_GetSamplePeriodUs() apart.
+ *
+ * Each channel is an ordinary FIFO sensor in the sensor registry
+ * (readBatch()), so filters, deadbands, the sample ring and telemetry
+ * treat it like any other driver. Values are calibrated with the factory
+ * words in system memory: Vrefint gives VDDA, which scales the other
+ * channels.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_ADC_H
+#define SENSOR_ADC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "power_manager.h"
+
+/**
+ * @defgroup sensor_adc ADC Sensors
+ * @brief Internal temperature, VDDA and analog inputs from ADC1.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Registry ID of the first channel; channel n uses FIRST_ID + n. */
+#define SENSOR_ADC_FIRST_ID      (10U)
+
+/**
+ * @brief Scans per DMA half buffer.
+ *
+ * One interrupt every SENSOR_ADC_DMA_SCANS scans (16 ms at 1 kHz).
+ * @ref SENSOR_ADC_OVERSAMPLE and @ref SENSOR_ADC_OVERSAMPLE_IDLE must be
+ * multiples of this.
+ */
+#define SENSOR_ADC_DMA_SCANS     (16U)
+
+/**
+ * @brief Samples buffered per channel between two registry drains.
+ *
+ * Older samples are dropped (and counted) when a channel is not drained
+ * within FIFO_DEPTH samples.
+ */
+#define SENSOR_ADC_FIFO_DEPTH    (32U)
+
+/**
+ * @brief ADC channels, in scan order.
+ */
+typedef enum
+{
+    SENSOR_ADC_CH_VREFINT = 0U, /**< Vrefint (IN17), reported as VDDA in V. */
+    SENSOR_ADC_CH_TEMP,         /**< Temperature sensor (IN18), in °C.      */
+    SENSOR_ADC_CH_A0,           /**< PA0 (IN0), in V.                       */
+    SENSOR_ADC_CH_A1,           /**< PA1 (IN1), in V.                       */
+    SENSOR_ADC_CH_COUNT         /**< Number of channels (not a channel).    */
+} SensorAdcChannel_t;
+
+/**
+ * @brief Driver counters.
+ */
+typedef struct
+{
+    bool     running;      /**< Conversions are being triggered.            */
+    uint32_t scans;        /**< Scans completed since SensorAdc_Init().      */
+    uint32_t samples;      /**< Oversampled samples produced (per channel).  */
+    uint32_t fifoDrops;    /**< Samples lost because a FIFO was not drained. */
+    uint32_t errors;       /**< DMA errors and ADC overruns (restarted).     */
+    uint32_t raw[SENSOR_ADC_CH_COUNT]; /**< Last average, in 1/16 LSB.       */
+} SensorAdcStats_t;
+
+/**
+ * @brief Configure ADC1, TIM2 and DMA2, register the channels with the
+ *        sensor registry and the "adc" CLI command.
+ *
+ * Requires SensorRegistry_Init(). Conversions start with the first
+ * SensorAdc_ApplyMode() for a mode in which the channels are sampled.
+ * Does nothing when @ref SENSOR_ADC_ENABLE is 0.
+ *
+ * @return None.
+ */
+void SensorAdc_Init(void);
+
+/**
+ * @brief Run or stop the conversions for a power mode.
+ *
+ * Conversions run where @ref SENSOR_ADC_PERIOD_ACTIVE_MS /
+ * @ref SENSOR_ADC_PERIOD_IDLE_MS is not 0; in SLEEP and STOP the timer,
+ * ADC and DMA are stopped and their clocks released. Selects the mode's
+ * decimation ratio. Also restarts the scan after an ADC overrun. Cheap when nothing changes, so it can be
+ * called periodically.
+ *
+ * @param mode Current power mode.
+ *
+ * @return None.
+ */
+void SensorAdc_ApplyMode(PowerMode_t mode);
+
+/**
+ * @brief Output sample period of the channels in a power mode.
+ *
+ * The rate consumers can rely on: samples are this far apart for as long
+ * as the mode lasts (the first sample after a change may cover a longer
+ * window).
+ *
+ * @param mode Power mode.
+ *
+ * @return Period in microseconds, 0 if the channels are off in @p mode.
+ */
+uint32_t SensorAdc_GetSamplePeriodUs(PowerMode_t mode);
+
+/**
+ * @brief Recompute the trigger timer prescaler after the APB1 clock
+ *        changed.
+ *
+ * Called by the clock profile code next to Time_OnClockChange().
+ *
+ * @return None.
+ */
+void SensorAdc_OnClockChange(void);
+
+/**
+ * @brief DMA2 stream 0 interrupt handler: accumulate the finished half.
+ *
+ * @return None.
+ */
+void SensorAdc_DmaIrqHandler(void);
+
+/**
+ * @brief Get the driver counters.
+ *
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void SensorAdc_GetStats(SensorAdcStats_t *stats);
+
+/** @} */ /* end of sensor_adc group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_ADC_H */
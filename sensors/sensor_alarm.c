@@ -0,0 +1,296 @@
+/**
+ * @file sensor_alarm.c
+ * @brief Threshold and rate-of-change alarm implementation.
+ *
+ * Every rule reduces to "the compared value is above a limit", with the
+ * value negated for low limits and taken as the absolute per-second
+ * change for rate rules, so raising and clearing is a single pair of
+ * comparisons. The event queue is a single-producer single-consumer ring
+ * like the sample ring: the producer (acquisition) writes only the head,
+ * the consumer only the tail.
+ *
+ * @ingroup sensor_alarm
+ */
+
+#include "sensor_alarm.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+#if ((SENSOR_ALARM_QUEUE_SIZE & (SENSOR_ALARM_QUEUE_SIZE - 1U)) != 0U)
+#error "SENSOR_ALARM_QUEUE_SIZE must be a power of two"
+#endif
+
+/**
+ * @brief Running state of one rule.
+ */
+typedef struct
+{
+    bool     active;    /**< Alarm raised.                          */
+    bool     primed;    /**< lastValue / last_ms hold a sample.     */
+    float    lastValue; /**< Previous sample (rate rules).          */
+    uint32_t last_ms;   /**< Previous sample timestamp.             */
+    float    value;     /**< Last compared value.                   */
+    uint32_t raised;    /**< Times raised.                          */
+} SensorAlarmState_t;
+
+/**
+ * @brief Rules; kind @ref SENSOR_ALARM_NONE marks a free slot.
+ */
+static SensorAlarmRule_t s_rules[SENSOR_ALARM_MAX_RULES];
+
+/**
+ * @brief State of each rule.
+ */
+static SensorAlarmState_t s_state[SENSOR_ALARM_MAX_RULES];
+
+/**
+ * @brief Event queue storage.
+ */
+static SensorAlarmEvent_t s_events[SENSOR_ALARM_QUEUE_SIZE];
+
+/**
+ * @brief Free-running write index (owned by SensorAlarm_Evaluate()).
+ */
+static volatile uint32_t s_head = 0U;
+
+/**
+ * @brief Free-running read index (owned by SensorAlarm_PopEvent()).
+ */
+static volatile uint32_t s_tail = 0U;
+
+/**
+ * @brief Events dropped on a full queue.
+ */
+static volatile uint32_t s_dropped = 0U;
+
+/**
+ * @brief Names of @ref SensorAlarmKind_t.
+ */
+static const char *const s_kindNames[SENSOR_ALARM_KIND_COUNT] =
+{
+    "none", "high", "low", "rate"
+};
+
+/**
+ * @brief Check a rule's fields.
+ */
+static bool SensorAlarm_IsValid(const SensorAlarmRule_t *rule);
+
+/**
+ * @brief Queue a state change of rule @p index.
+ *
+ * @return false if the queue was full.
+ */
+static bool SensorAlarm_Queue(uint32_t index, bool raised, float value, uint32_t timestamp);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorAlarm_Init(void)
+{
+    memset(s_rules, 0, sizeof(s_rules));
+    memset(s_state, 0, sizeof(s_state));
+    s_head    = 0U;
+    s_tail    = 0U;
+    s_dropped = 0U;
+}
+
+bool SensorAlarm_SetRule(uint32_t index, const SensorAlarmRule_t *rule)
+{
+    if ((index >= SENSOR_ALARM_MAX_RULES) || (rule == NULL) ||
+        ((rule->kind != (uint8_t)SENSOR_ALARM_NONE) && !SensorAlarm_IsValid(rule)))
+    {
+        return false;
+    }
+
+    s_rules[index] = *rule;
+    memset(&s_state[index], 0, sizeof(s_state[index]));
+
+    return true;
+}
+
+int32_t SensorAlarm_AddRule(const SensorAlarmRule_t *rule)
+{
+    if ((rule == NULL) || !SensorAlarm_IsValid(rule))
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0U; i < SENSOR_ALARM_MAX_RULES; ++i)
+    {
+        if (s_rules[i].kind == (uint8_t)SENSOR_ALARM_NONE)
+        {
+            (void)SensorAlarm_SetRule(i, rule);
+            return (int32_t)i;
+        }
+    }
+
+    return -1;
+}
+
+bool SensorAlarm_GetRule(uint32_t index, SensorAlarmRule_t *rule, SensorAlarmStatus_t *status)
+{
+    if ((index >= SENSOR_ALARM_MAX_RULES) || (s_rules[index].kind == (uint8_t)SENSOR_ALARM_NONE))
+    {
+        return false;
+    }
+
+    if (rule != NULL)
+    {
+        *rule = s_rules[index];
+    }
+
+    if (status != NULL)
+    {
+        status->active = s_state[index].active;
+        status->raised = s_state[index].raised;
+        status->value  = s_state[index].value;
+    }
+
+    return true;
+}
+
+bool SensorAlarm_Evaluate(const SensorData_t *sample)
+{
+    if ((sample == NULL) || ((sample->quality & SENSOR_QUALITY_STALE) != 0U))
+    {
+        return false;
+    }
+
+    bool  queued = false;
+    float x      = SensorData_GetFloat(sample, 0U);
+
+    for (uint32_t i = 0U; i < SENSOR_ALARM_MAX_RULES; ++i)
+    {
+        const SensorAlarmRule_t *rule  = &s_rules[i];
+        SensorAlarmState_t      *state = &s_state[i];
+
+        if ((rule->kind == (uint8_t)SENSOR_ALARM_NONE) || (rule->sensorId != sample->sensorId))
+        {
+            continue;
+        }
+
+        /* Compared value and limit, oriented so that "above" raises. */
+        float value;
+        float limit = rule->threshold;
+
+        if (rule->kind == (uint8_t)SENSOR_ALARM_RATE)
+        {
+            uint32_t dt_ms  = sample->timestamp - state->last_ms;
+            float    dx     = x - state->lastValue;
+            bool     primed = state->primed;
+
+            state->primed    = true;
+            state->lastValue = x;
+            state->last_ms   = sample->timestamp;
+
+            /* Two samples are needed, and none of the same millisecond. */
+            if (!primed || (dt_ms == 0U))
+            {
+                continue;
+            }
+
+            value = ((dx < 0.0f) ? -dx : dx) * (1000.0f / (float)dt_ms);
+        }
+        else if (rule->kind == (uint8_t)SENSOR_ALARM_LOW)
+        {
+            value = -x;
+            limit = -limit;
+        }
+        else
+        {
+            value = x;
+        }
+
+        state->value = (rule->kind == (uint8_t)SENSOR_ALARM_RATE) ? value : x;
+
+        if (!state->active && (value > limit))
+        {
+            state->active = true;
+            state->raised++;
+            queued |= SensorAlarm_Queue(i, true, state->value, sample->timestamp);
+        }
+        else if (state->active && (value < (limit - rule->hysteresis)))
+        {
+            state->active = false;
+            queued |= SensorAlarm_Queue(i, false, state->value, sample->timestamp);
+        }
+    }
+
+    return queued;
+}
+
+bool SensorAlarm_PopEvent(SensorAlarmEvent_t *event)
+{
+    if (event == NULL)
+    {
+        return false;
+    }
+
+    uint32_t tail = s_tail;
+    if (tail == s_head)
+    {
+        return false;
+    }
+
+    /* Read the head before the slot it covers. */
+    __DMB();
+    *event = s_events[tail & (SENSOR_ALARM_QUEUE_SIZE - 1U)];
+
+    /* Finish reading the slot before the producer may reuse it. */
+    __DMB();
+    s_tail = tail + 1U;
+
+    return true;
+}
+
+uint32_t SensorAlarm_GetDroppedCount(void)
+{
+    return s_dropped;
+}
+
+const char *SensorAlarm_KindName(uint8_t kind)
+{
+    return (kind < (uint8_t)SENSOR_ALARM_KIND_COUNT) ? s_kindNames[kind] : s_kindNames[0];
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SensorAlarm_IsValid(const SensorAlarmRule_t *rule)
+{
+    /* Written so that NaN fails too. */
+    return (rule->kind > (uint8_t)SENSOR_ALARM_NONE) &&
+           (rule->kind < (uint8_t)SENSOR_ALARM_KIND_COUNT) &&
+           (rule->threshold == rule->threshold) &&
+           (rule->hysteresis >= 0.0f) &&
+           ((rule->kind != (uint8_t)SENSOR_ALARM_RATE) || (rule->threshold >= 0.0f));
+}
+
+static bool SensorAlarm_Queue(uint32_t index, bool raised, float value, uint32_t timestamp)
+{
+    uint32_t head = s_head;
+
+    if ((head - s_tail) >= SENSOR_ALARM_QUEUE_SIZE)
+    {
+        s_dropped++;
+        return false;
+    }
+
+    SensorAlarmEvent_t *event = &s_events[head & (SENSOR_ALARM_QUEUE_SIZE - 1U)];
+
+    event->rule      = (uint8_t)index;
+    event->sensorId  = s_rules[index].sensorId;
+    event->kind      = s_rules[index].kind;
+    event->raised    = raised;
+    event->wake      = s_rules[index].wake;
+    event->value     = value;
+    event->threshold = s_rules[index].threshold;
+    event->timestamp = timestamp;
+
+    /* Publish the slot before the consumer can see the new head. */
+    __DMB();
+    s_head = head + 1U;
+
+    return true;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file sensor_alarm.h
+ * @brief Threshold and rate-of-change alarms on the acquisition path.
+ *
+ * A small table of rules (high limit, low limit, or rate of change per
+ * second) is evaluated on every sample as it is acquired, before it
+ * enters the sample ring, so an alarm is raised within the sample period
+ * instead of after filtering and output. Each rule has a hysteresis band:
+ * an alarm above a high limit clears only once the value is back below
+ * limit - hysteresis (and the other way round for low limits), so a noisy
+ * value near the limit does not chatter.
+ *
+ * State changes are queued as @ref SensorAlarmEvent_t for a thread-mode
+ * consumer; SensorAlarm_Evaluate() itself only compares, so its cost is
+ * bounded by @ref SENSOR_ALARM_MAX_RULES per sample. Rules see channel 0
+ * of the raw (unfiltered) sample; stale samples are skipped.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_ALARM_H
+#define SENSOR_ALARM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+
+/**
+ * @defgroup sensor_alarm Sensor Alarms
+ * @brief Per-sensor limit and rate rules with hysteresis.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of alarm rules. */
+#define SENSOR_ALARM_MAX_RULES   (4U)
+
+/** @brief Alarm events that can wait for the consumer (a power of two). */
+#define SENSOR_ALARM_QUEUE_SIZE  (8U)
+
+/**
+ * @brief What a rule compares.
+ */
+typedef enum
+{
+    SENSOR_ALARM_NONE = 0U, /**< Rule slot unused.                         */
+    SENSOR_ALARM_HIGH,      /**< Value above the threshold.                */
+    SENSOR_ALARM_LOW,       /**< Value below the threshold.                */
+    SENSOR_ALARM_RATE,      /**< |change per second| above the threshold.  */
+    SENSOR_ALARM_KIND_COUNT /**< Number of kinds (not a valid kind).       */
+} SensorAlarmKind_t;
+
+/**
+ * @brief One alarm rule.
+ */
+typedef struct
+{
+    uint8_t sensorId;   /**< Registry ID.                                    */
+    uint8_t kind;       /**< @ref SensorAlarmKind_t.                         */
+    bool    wake;       /**< Raising the alarm forces POWER_MODE_ACTIVE.     */
+    float   threshold;  /**< Limit (sensor units, or units per second).      */
+    float   hysteresis; /**< Clear margin inside the limit (>= 0).           */
+} SensorAlarmRule_t;
+
+/**
+ * @brief State of one rule.
+ */
+typedef struct
+{
+    bool     active;  /**< Alarm currently raised.           */
+    uint32_t raised;  /**< Times raised since configured.    */
+    float    value;   /**< Last compared value.              */
+} SensorAlarmStatus_t;
+
+/**
+ * @brief Alarm raised or cleared.
+ */
+typedef struct
+{
+    uint8_t  rule;      /**< Rule index.                                */
+    uint8_t  sensorId;  /**< Sensor.                                    */
+    uint8_t  kind;      /**< @ref SensorAlarmKind_t.                    */
+    bool     raised;    /**< true: raised, false: cleared.              */
+    bool     wake;      /**< The rule's wake flag.                      */
+    float    value;     /**< Value that changed the state.              */
+    float    threshold; /**< The rule's threshold.                      */
+    uint32_t timestamp; /**< Sample timestamp.                          */
+} SensorAlarmEvent_t;
+
+/**
+ * @brief Remove all rules and queued events.
+ *
+ * @return None.
+ */
+void SensorAlarm_Init(void);
+
+/**
+ * @brief Set (or clear) a rule; its state starts over.
+ *
+ * @param index Rule index, below @ref SENSOR_ALARM_MAX_RULES.
+ * @param rule  Rule; kind @ref SENSOR_ALARM_NONE clears the slot.
+ *
+ * @return false if @p index or @p rule is invalid.
+ */
+bool SensorAlarm_SetRule(uint32_t index, const SensorAlarmRule_t *rule);
+
+/**
+ * @brief Put a rule in the first unused slot.
+ *
+ * @param rule Rule.
+ *
+ * @return Rule index, or -1 if @p rule is invalid or the table is full.
+ */
+int32_t SensorAlarm_AddRule(const SensorAlarmRule_t *rule);
+
+/**
+ * @brief Get a rule and its state.
+ *
+ * @param index       Rule index.
+ * @param[out] rule   Receives the rule (may be NULL).
+ * @param[out] status Receives the state (may be NULL).
+ *
+ * @return true if the slot holds a rule.
+ */
+bool SensorAlarm_GetRule(uint32_t index, SensorAlarmRule_t *rule, SensorAlarmStatus_t *status);
+
+/**
+ * @brief Run the rules of a sample's sensor.
+ *
+ * Must be called from the single context that produces samples.
+ *
+ * @param sample Newly acquired sample.
+ *
+ * @return true if an event was queued.
+ */
+bool SensorAlarm_Evaluate(const SensorData_t *sample);
+
+/**
+ * @brief Take the oldest queued event.
+ *
+ * @param[out] event Receives the event.
+ *
+ * @return false if no event is queued.
+ */
+bool SensorAlarm_PopEvent(SensorAlarmEvent_t *event);
+
+/**
+ * @brief Events lost because the queue was full.
+ *
+ * @return Dropped event count since SensorAlarm_Init().
+ */
+uint32_t SensorAlarm_GetDroppedCount(void);
+
+/**
+ * @brief Name of a rule kind ("high", "low", "rate").
+ *
+ * @param kind @ref SensorAlarmKind_t.
+ *
+ * @return Name, or "none".
+ */
+const char *SensorAlarm_KindName(uint8_t kind);
+
+/** @} */ /* end of sensor_alarm group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_ALARM_H */
@@ -0,0 +1,611 @@
+/**
+ * @file sensor_calib.c
+ * @brief Calibration stage implementation.
+ *
+ * A correction table holds the corrected raw value at each knot; a
+ * sample's segment is its distance from the first knot shifted right by
+ * the segment width (a power of two), so the lookup is a subtraction, a
+ * shift and one 32x32->64 multiply with no division. Readings outside
+ * the span are rare and take a float path, which cannot overflow however
+ * far out they are.
+ *
+ * Fits solve the normal equations in double precision with the readings
+ * centred and scaled to [-1, 1], and expand the result back into
+ * coefficients of the raw reading. They run from the CLI only. Like the
+ * rest of the firmware, none of this needs libm.
+ *
+ * @ingroup sensor_calib
+ */
+
+#include "sensor_calib.h"
+#include <math.h>
+#include <string.h>
+
+_Static_assert((SENSOR_CALIB_SEGMENTS & (SENSOR_CALIB_SEGMENTS - 1U)) == 0U,
+               "SENSOR_CALIB_SEGMENTS must be a power of two");
+_Static_assert(SENSOR_CALIB_MAX_POINTS <= 255U, "points is a uint8_t");
+
+/** @brief Table scale of a slot whose table is not built. */
+#define SENSOR_CALIB_NOT_BUILT   (INT16_MIN)
+
+/**
+ * @brief Calibration, correction table and reference points of one sensor.
+ */
+typedef struct
+{
+    bool                used;                                /**< Slot in use.                 */
+    uint8_t             sensorId;                            /**< Owner.                       */
+    SensorCalibConfig_t config;                              /**< Calibration.                 */
+    int16_t             tableExp;                            /**< Scale of the table, or not built. */
+    uint8_t             tableLayout;                         /**< SENSOR_LAYOUT_S32 bit of it. */
+    uint8_t             shift;                               /**< log2 of the segment width.   */
+    int32_t             x0;                                  /**< Raw value of knot 0.         */
+    float               inverseWidth;                        /**< 1 / segment width.           */
+    int32_t             knot[SENSOR_CALIB_SEGMENTS + 1U];    /**< Corrected raw value per knot. */
+    float               pointRaw[SENSOR_CALIB_MAX_POINTS];   /**< Reference readings.          */
+    float               pointRef[SENSOR_CALIB_MAX_POINTS];   /**< True values.                 */
+    SensorCalibStats_t  stats;                               /**< Counters.                    */
+} SensorCalibSlot_t;
+
+/**
+ * @brief Calibration slots.
+ */
+static SensorCalibSlot_t s_slots[SENSOR_CALIB_MAX_SENSORS];
+
+/**
+ * @brief Block being corrected by ProcessSamples() (static, as in the
+ *        filter stage).
+ */
+static SampleBlock_t s_block;
+
+/**
+ * @brief Find the slot of @p sensorId, or NULL.
+ */
+static SensorCalibSlot_t *SensorCalib_Find(uint8_t sensorId);
+
+/**
+ * @brief Whether @p config can be applied.
+ */
+static bool SensorCalib_IsValid(const SensorCalibConfig_t *config);
+
+/**
+ * @brief Evaluate the polynomial of @p config at @p x.
+ */
+static float SensorCalib_Eval(const SensorCalibConfig_t *config, float x);
+
+/**
+ * @brief Build the table of @p slot for the scale and layout of @p block.
+ */
+static void SensorCalib_Build(SensorCalibSlot_t *slot, const SampleBlock_t *block);
+
+/**
+ * @brief Corrected value of one raw reading (before saturation).
+ */
+static int64_t SensorCalib_Lookup(const SensorCalibSlot_t *slot, int32_t raw);
+
+/**
+ * @brief Round @p value to nearest, saturated to [@p lo, @p hi].
+ */
+static int64_t SensorCalib_Round(float value, int64_t lo, int64_t hi);
+
+/**
+ * @brief Magnitude of @p value (the firmware has no libm).
+ */
+static inline double SensorCalib_Abs(double value)
+{
+    return (value < 0.0) ? -value : value;
+}
+
+/* ------------------------------------------------------------------------- */
+
+void SensorCalib_Init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+}
+
+void SensorCalib_Identity(SensorCalibConfig_t *config)
+{
+    if (config != NULL)
+    {
+        memset(config, 0, sizeof(*config));
+        config->coeff[1] = 1.0f;
+    }
+}
+
+bool SensorCalib_Configure(uint8_t sensorId, const SensorCalibConfig_t *config)
+{
+    SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if (config == NULL)
+    {
+        if (slot != NULL)
+        {
+            slot->used = false;
+        }
+        return true;
+    }
+
+    if (slot == NULL)
+    {
+        for (uint32_t i = 0U; i < SENSOR_CALIB_MAX_SENSORS; ++i)
+        {
+            if (!s_slots[i].used)
+            {
+                slot = &s_slots[i];
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    return SensorCalib_ConfigureSlot((uint32_t)(slot - s_slots), sensorId, config);
+}
+
+bool SensorCalib_ConfigureSlot(uint32_t index, uint8_t sensorId, const SensorCalibConfig_t *config)
+{
+    if ((index >= SENSOR_CALIB_MAX_SENSORS) || ((config != NULL) && !SensorCalib_IsValid(config)))
+    {
+        return false;
+    }
+
+    SensorCalibSlot_t *slot = &s_slots[index];
+
+    if (config == NULL)
+    {
+        slot->used = false;
+        return true;
+    }
+
+    SensorCalibSlot_t *other = SensorCalib_Find(sensorId);
+    if ((other != NULL) && (other != slot))
+    {
+        other->used = false;
+    }
+
+    if (!slot->used || (slot->sensorId != sensorId) || (slot->config.channel != config->channel))
+    {
+        memset(slot, 0, sizeof(*slot));
+        slot->used     = true;
+        slot->sensorId = sensorId;
+    }
+
+    slot->config   = *config;
+    slot->tableExp = SENSOR_CALIB_NOT_BUILT;
+    return true;
+}
+
+bool SensorCalib_GetConfig(uint8_t sensorId, SensorCalibConfig_t *config)
+{
+    const SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if (config != NULL)
+    {
+        if (slot != NULL)
+        {
+            *config = slot->config;
+        }
+        else
+        {
+            SensorCalib_Identity(config);
+        }
+    }
+
+    return slot != NULL;
+}
+
+bool SensorCalib_GetSlot(uint32_t index, uint8_t *sensorId, SensorCalibConfig_t *config,
+                         SensorCalibStats_t *stats)
+{
+    if ((index >= SENSOR_CALIB_MAX_SENSORS) || !s_slots[index].used)
+    {
+        return false;
+    }
+
+    if (sensorId != NULL)
+    {
+        *sensorId = s_slots[index].sensorId;
+    }
+    if (config != NULL)
+    {
+        *config = s_slots[index].config;
+    }
+    if (stats != NULL)
+    {
+        *stats = s_slots[index].stats;
+    }
+    return true;
+}
+
+bool SensorCalib_AddPoint(uint8_t sensorId, float raw, float reference)
+{
+    SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if (slot == NULL)
+    {
+        SensorCalibConfig_t identity;
+
+        SensorCalib_Identity(&identity);
+        if (!SensorCalib_Configure(sensorId, &identity))
+        {
+            return false;
+        }
+        slot = SensorCalib_Find(sensorId);
+    }
+
+    if ((slot->stats.points >= SENSOR_CALIB_MAX_POINTS) || !isfinite(raw) || !isfinite(reference))
+    {
+        return false;
+    }
+
+    slot->pointRaw[slot->stats.points] = raw;
+    slot->pointRef[slot->stats.points] = reference;
+    slot->stats.points++;
+    return true;
+}
+
+bool SensorCalib_GetPoint(uint8_t sensorId, uint32_t index, float *raw, float *reference)
+{
+    const SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if ((slot == NULL) || (index >= slot->stats.points))
+    {
+        return false;
+    }
+
+    if (raw != NULL)
+    {
+        *raw = slot->pointRaw[index];
+    }
+    if (reference != NULL)
+    {
+        *reference = slot->pointRef[index];
+    }
+    return true;
+}
+
+void SensorCalib_ClearPoints(uint8_t sensorId)
+{
+    SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if (slot != NULL)
+    {
+        slot->stats.points = 0U;
+    }
+}
+
+bool SensorCalib_Fit(uint8_t sensorId, uint32_t degree)
+{
+    SensorCalibSlot_t *slot = SensorCalib_Find(sensorId);
+
+    if ((slot == NULL) || (degree == 0U) || (degree >= SENSOR_CALIB_TERMS) ||
+        (slot->stats.points <= degree))
+    {
+        return false;
+    }
+
+    uint32_t n     = slot->stats.points;
+    uint32_t terms = degree + 1U;
+    float    xMin  = slot->pointRaw[0];
+    float    xMax  = slot->pointRaw[0];
+
+    for (uint32_t i = 1U; i < n; ++i)
+    {
+        xMin = (slot->pointRaw[i] < xMin) ? slot->pointRaw[i] : xMin;
+        xMax = (slot->pointRaw[i] > xMax) ? slot->pointRaw[i] : xMax;
+    }
+
+    /* u = (x - centre) / scale keeps the powers in [-1, 1]. */
+    double centre = 0.5 * ((double)xMin + (double)xMax);
+    double scale  = 0.5 * ((double)xMax - (double)xMin);
+
+    if (scale <= 0.0)
+    {
+        return false;
+    }
+
+    /* Normal equations: m[j][k] = sum u^(j+k), m[j][terms] = sum y u^j. */
+    double m[SENSOR_CALIB_TERMS][SENSOR_CALIB_TERMS + 1U];
+    memset(m, 0, sizeof(m));
+
+    for (uint32_t i = 0U; i < n; ++i)
+    {
+        double u = ((double)slot->pointRaw[i] - centre) / scale;
+        double power[2U * SENSOR_CALIB_TERMS];
+
+        power[0] = 1.0;
+        for (uint32_t p = 1U; p < (2U * terms); ++p)
+        {
+            power[p] = power[p - 1U] * u;
+        }
+
+        for (uint32_t j = 0U; j < terms; ++j)
+        {
+            for (uint32_t k = 0U; k < terms; ++k)
+            {
+                m[j][k] += power[j + k];
+            }
+            m[j][terms] += (double)slot->pointRef[i] * power[j];
+        }
+    }
+
+    /* Gaussian elimination with partial pivoting. */
+    for (uint32_t col = 0U; col < terms; ++col)
+    {
+        uint32_t pivot = col;
+
+        for (uint32_t row = col + 1U; row < terms; ++row)
+        {
+            if (SensorCalib_Abs(m[row][col]) > SensorCalib_Abs(m[pivot][col]))
+            {
+                pivot = row;
+            }
+        }
+
+        /* The sums are of order n: a pivot this small is a singular system. */
+        if (SensorCalib_Abs(m[pivot][col]) < (1e-9 * (double)n))
+        {
+            return false;
+        }
+
+        if (pivot != col)
+        {
+            for (uint32_t k = col; k <= terms; ++k)
+            {
+                double t      = m[col][k];
+                m[col][k]     = m[pivot][k];
+                m[pivot][k]   = t;
+            }
+        }
+
+        for (uint32_t row = 0U; row < terms; ++row)
+        {
+            if (row != col)
+            {
+                double f = m[row][col] / m[col][col];
+
+                for (uint32_t k = col; k <= terms; ++k)
+                {
+                    m[row][k] -= f * m[col][k];
+                }
+            }
+        }
+    }
+
+    /* a_j u^j with u = (x - centre) / scale, expanded into powers of x. */
+    SensorCalibConfig_t config = slot->config;
+    double              coeff[SENSOR_CALIB_TERMS] = { 0.0 };
+
+    double              inverse = 1.0;
+
+    for (uint32_t j = 0U; j < terms; ++j)
+    {
+        double a        = (m[j][terms] / m[j][j]) * inverse;
+        double binomial = 1.0;
+        double shift    = 1.0;
+
+        for (uint32_t k = 0U; k <= j; ++k)
+        {
+            /* Term x^(j-k) of (x - centre)^j: C(j, k) * (-centre)^k. */
+            coeff[j - k] += a * binomial * shift;
+            binomial      = (binomial * (double)(j - k)) / (double)(k + 1U);
+            shift        *= -centre;
+        }
+        inverse /= scale;
+    }
+
+    for (uint32_t j = 0U; j < SENSOR_CALIB_TERMS; ++j)
+    {
+        config.coeff[j] = (float)coeff[j];
+    }
+
+    if ((degree >= 2U) && (config.lo == config.hi))
+    {
+        config.lo = xMin;
+        config.hi = xMax;
+    }
+
+    return SensorCalib_ConfigureSlot((uint32_t)(slot - s_slots), sensorId, &config);
+}
+
+void SensorCalib_ProcessBlock(SampleBlock_t *block)
+{
+    if (block == NULL)
+    {
+        return;
+    }
+
+    SensorCalibSlot_t *slot    = SensorCalib_Find(block->sensorId);
+    uint32_t           channel = (slot != NULL) ? slot->config.channel : 0U;
+
+    if ((slot == NULL) || (channel >= (block->layout & SENSOR_LAYOUT_CHANNELS_MASK)))
+    {
+        return;
+    }
+
+    uint8_t s32 = (uint8_t)(block->layout & SENSOR_LAYOUT_S32);
+    if ((slot->tableExp != (int16_t)block->scaleExp) || (slot->tableLayout != s32))
+    {
+        SensorCalib_Build(slot, block);
+    }
+
+    int64_t  hi      = (s32 != 0U) ? INT32_MAX : INT16_MAX;
+    int64_t  lo      = (s32 != 0U) ? INT32_MIN : INT16_MIN;
+    uint32_t clipped = 0U;
+
+    for (uint32_t n = 0U; n < block->count; ++n)
+    {
+        int32_t before = (s32 != 0U) ? block->raw.s32[channel][n] : (int32_t)block->raw.s16[channel][n];
+        int64_t after  = SensorCalib_Lookup(slot, before);
+
+        if ((after >= hi) || (after <= lo))
+        {
+            after = (after >= hi) ? hi : lo;
+            block->quality[n] |= SENSOR_QUALITY_CLIPPED;
+            clipped++;
+        }
+        if (after != before)
+        {
+            block->quality[n] |= SENSOR_QUALITY_CALIBRATED;
+        }
+
+        if (s32 != 0U)
+        {
+            block->raw.s32[channel][n] = (int32_t)after;
+        }
+        else
+        {
+            block->raw.s16[channel][n] = (int16_t)after;
+        }
+    }
+
+    slot->stats.corrected += block->count;
+    slot->stats.clipped   += clipped;
+}
+
+void SensorCalib_ProcessSamples(SensorSample_t *samples, size_t count)
+{
+    if (samples == NULL)
+    {
+        return;
+    }
+
+    size_t start = 0U;
+
+    while (start < count)
+    {
+        /* Uncalibrated sensors are skipped without a gather. */
+        if (SensorCalib_Find(samples[start].sensorId) == NULL)
+        {
+            start++;
+            continue;
+        }
+
+        size_t n = SampleBlock_Gather(&s_block, &samples[start], count - start);
+
+        SensorCalib_ProcessBlock(&s_block);
+        SampleBlock_Scatter(&s_block, &samples[start]);
+
+        start += n;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorCalibSlot_t *SensorCalib_Find(uint8_t sensorId)
+{
+    for (uint32_t i = 0U; i < SENSOR_CALIB_MAX_SENSORS; ++i)
+    {
+        if (s_slots[i].used && (s_slots[i].sensorId == sensorId))
+        {
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static bool SensorCalib_IsValid(const SensorCalibConfig_t *config)
+{
+    for (uint32_t j = 0U; j < SENSOR_CALIB_TERMS; ++j)
+    {
+        if (!isfinite(config->coeff[j]))
+        {
+            return false;
+        }
+    }
+
+    return (config->channel < SENSOR_MAX_CHANNELS) && isfinite(config->lo) &&
+           isfinite(config->hi) && (config->lo <= config->hi);
+}
+
+static float SensorCalib_Eval(const SensorCalibConfig_t *config, float x)
+{
+    float y = config->coeff[SENSOR_CALIB_TERMS - 1U];
+
+    for (uint32_t j = SENSOR_CALIB_TERMS - 1U; j > 0U; --j)
+    {
+        y = (y * x) + config->coeff[j - 1U];
+    }
+    return y;
+}
+
+static void SensorCalib_Build(SensorCalibSlot_t *slot, const SampleBlock_t *block)
+{
+    bool    s32   = (block->layout & SENSOR_LAYOUT_S32) != 0U;
+    int64_t tMin  = s32 ? INT32_MIN : INT16_MIN;
+    int64_t tMax  = s32 ? INT32_MAX : INT16_MAX;
+    float   toRaw = SensorData_Pow10(-(int32_t)block->scaleExp);
+    float   toEng = SensorData_Pow10((int32_t)block->scaleExp);
+    int64_t lo    = tMin;
+    int64_t hi    = tMax;
+
+    if (slot->config.lo != slot->config.hi)
+    {
+        /* Widened to whole raw units (by one at most). */
+        lo = SensorCalib_Round((slot->config.lo * toRaw) - 0.5f, tMin, tMax);
+        hi = SensorCalib_Round((slot->config.hi * toRaw) + 0.5f, tMin, tMax);
+    }
+
+    uint32_t shift = 0U;
+    while (((int64_t)SENSOR_CALIB_SEGMENTS << shift) < (hi - lo))
+    {
+        shift++;
+    }
+
+    slot->x0           = (int32_t)lo;
+    slot->shift        = (uint8_t)shift;
+    slot->inverseWidth = 1.0f / (float)(1UL << shift);
+
+    for (uint32_t k = 0U; k <= SENSOR_CALIB_SEGMENTS; ++k)
+    {
+        /* The last knot may lie past the type's range; only its value matters. */
+        float x = (float)(lo + ((int64_t)k << shift)) * toEng;
+
+        slot->knot[k] = (int32_t)SensorCalib_Round(SensorCalib_Eval(&slot->config, x) * toRaw,
+                                                   INT32_MIN, INT32_MAX);
+    }
+
+    slot->tableExp    = (int16_t)block->scaleExp;
+    slot->tableLayout = (uint8_t)(block->layout & SENSOR_LAYOUT_S32);
+    slot->stats.builds++;
+}
+
+static int64_t SensorCalib_Lookup(const SensorCalibSlot_t *slot, int32_t raw)
+{
+    int64_t rel   = (int64_t)raw - slot->x0;
+    int64_t index = rel >> slot->shift;
+
+    if ((index >= 0) && (index < (int64_t)SENSOR_CALIB_SEGMENTS))
+    {
+        int64_t y0 = slot->knot[index];
+        int64_t dy = (int64_t)slot->knot[index + 1] - y0;
+
+        return y0 + ((dy * (rel - (index << slot->shift))) >> slot->shift);
+    }
+
+    /* Outside the span: extrapolate the end segment in float. */
+    uint32_t first = (index < 0) ? 0U : (SENSOR_CALIB_SEGMENTS - 1U);
+    float    dx    = (float)(rel - ((int64_t)first << slot->shift));
+    float    slope = (float)((int64_t)slot->knot[first + 1U] - slot->knot[first]) * slot->inverseWidth;
+
+    return SensorCalib_Round((float)slot->knot[first] + (slope * dx), INT32_MIN, INT32_MAX);
+}
+
+static int64_t SensorCalib_Round(float value, int64_t lo, int64_t hi)
+{
+    /* Written so that NaN saturates too. */
+    if (!(value < (float)hi))
+    {
+        return hi;
+    }
+    if (value <= (float)lo)
+    {
+        return lo;
+    }
+    return (int64_t)((value >= 0.0f) ? (value + 0.5f) : (value - 0.5f));
+}
@@ -0,0 +1,236 @@
+/**
+ * @file sensor_calib.h
+ * @brief Per-sensor calibration stage with precomputed correction tables.
+ *
+ * Sits in front of the filter stage. A sensor's calibration is a
+ * polynomial in the raw reading (engineering units):
+ *
+ *     corrected = c0 + c1 * x + c2 * x^2 + c3 * x^3
+ *
+ * c0 and c1 are the offset and gain; c2 and c3 correct curvature. The
+ * polynomial is never evaluated per sample. It is sampled once at the
+ * @ref SENSOR_CALIB_SEGMENTS + 1 knots of a piecewise-linear table over
+ * the span of readings the sensor produces, in the raw integer units and
+ * scale of its samples, and every sample is corrected with one table
+ * lookup and one integer interpolation. A gain and offset correction is
+ * exact; a curved one is within the interpolation error of the segments.
+ * The table is rebuilt when the configuration changes or the samples come
+ * with another scale or layout. Readings outside the span are
+ * extrapolated from the end segments.
+ *
+ * Coefficients are set directly or fitted (least squares) to reference
+ * points: pairs of a raw reading and the true value, captured with the
+ * `calib` command. The application keeps the first
+ * @ref CONFIG_CALIB_SLOTS calibrations in the persistent configuration.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_CALIB_H
+#define SENSOR_CALIB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+#include "sample_block.h"
+
+/**
+ * @defgroup sensor_calib Sensor Calibration
+ * @brief Offset, gain and polynomial correction by lookup table.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of sensors that can have a calibration. */
+#define SENSOR_CALIB_MAX_SENSORS   (4U)
+
+/** @brief Segments of a correction table (a power of two). */
+#define SENSOR_CALIB_SEGMENTS      (32U)
+
+/** @brief Polynomial coefficients (c0 to c3). */
+#define SENSOR_CALIB_TERMS         (4U)
+
+/** @brief Reference points kept per sensor. */
+#define SENSOR_CALIB_MAX_POINTS    (8U)
+
+/**
+ * @brief Calibration of one sensor channel.
+ *
+ * A span with @c lo == @c hi covers the whole range of the sample type,
+ * which suits offset and gain; curved corrections want the span the
+ * sensor actually uses.
+ */
+typedef struct
+{
+    uint8_t channel;                   /**< Channel corrected.                  */
+    float   coeff[SENSOR_CALIB_TERMS]; /**< c0 + c1 x + c2 x^2 + c3 x^3.       */
+    float   lo;                        /**< Lowest raw reading of the span.     */
+    float   hi;                        /**< Highest raw reading of the span.    */
+} SensorCalibConfig_t;
+
+/**
+ * @brief Counters of one calibration.
+ */
+typedef struct
+{
+    uint32_t corrected;  /**< Samples corrected.                          */
+    uint32_t clipped;    /**< Of those, saturated at the sample type.     */
+    uint32_t builds;     /**< Table builds.                               */
+    uint8_t  points;     /**< Reference points captured.                  */
+} SensorCalibStats_t;
+
+/**
+ * @brief Remove all calibrations and reference points.
+ *
+ * @return None.
+ */
+void SensorCalib_Init(void);
+
+/**
+ * @brief Identity calibration of channel 0 (c1 = 1, full span).
+ *
+ * @param[out] config Receives the configuration.
+ *
+ * @return None.
+ */
+void SensorCalib_Identity(SensorCalibConfig_t *config);
+
+/**
+ * @brief Set (or replace) the calibration of a sensor.
+ *
+ * The sensor keeps its slot, or takes the first free one. Its reference
+ * points are kept unless the channel changes.
+ *
+ * @param sensorId Registry ID.
+ * @param config   Calibration, or NULL to remove it with its points.
+ *
+ * @return false if @p config is invalid or no slot is free.
+ */
+bool SensorCalib_Configure(uint8_t sensorId, const SensorCalibConfig_t *config);
+
+/**
+ * @brief Set or clear one slot, for the stored configuration.
+ *
+ * Another slot holding @p sensorId is cleared, so a sensor has one
+ * calibration at most.
+ *
+ * @param index    Slot index (< @ref SENSOR_CALIB_MAX_SENSORS).
+ * @param sensorId Registry ID.
+ * @param config   Calibration, or NULL to clear the slot.
+ *
+ * @return false if @p index or @p config is invalid.
+ */
+bool SensorCalib_ConfigureSlot(uint32_t index, uint8_t sensorId, const SensorCalibConfig_t *config);
+
+/**
+ * @brief Get the calibration of a sensor.
+ *
+ * @param sensorId    Registry ID.
+ * @param[out] config Receives the calibration (identity if none).
+ *
+ * @return true if the sensor has a calibration.
+ */
+bool SensorCalib_GetConfig(uint8_t sensorId, SensorCalibConfig_t *config);
+
+/**
+ * @brief Describe one slot.
+ *
+ * @param index         Slot index.
+ * @param[out] sensorId Receives the owner (may be NULL).
+ * @param[out] config   Receives the calibration (may be NULL).
+ * @param[out] stats    Receives the counters (may be NULL).
+ *
+ * @return false if @p index is out of range or the slot is free.
+ */
+bool SensorCalib_GetSlot(uint32_t index, uint8_t *sensorId, SensorCalibConfig_t *config,
+                         SensorCalibStats_t *stats);
+
+/**
+ * @brief Add a reference point.
+ *
+ * A sensor without a calibration gets the identity one, so points can be
+ * captured before anything is fitted.
+ *
+ * @param sensorId  Registry ID.
+ * @param raw       Uncorrected reading of the calibrated channel.
+ * @param reference True value at that reading.
+ *
+ * @return false if the points are full or no slot is free.
+ */
+bool SensorCalib_AddPoint(uint8_t sensorId, float raw, float reference);
+
+/**
+ * @brief Get one reference point.
+ *
+ * @param sensorId       Registry ID.
+ * @param index          Point index.
+ * @param[out] raw       Receives the raw reading.
+ * @param[out] reference Receives the true value.
+ *
+ * @return false if there is no such point.
+ */
+bool SensorCalib_GetPoint(uint8_t sensorId, uint32_t index, float *raw, float *reference);
+
+/**
+ * @brief Drop the reference points of a sensor (its calibration stays).
+ *
+ * @param sensorId Registry ID.
+ *
+ * @return None.
+ */
+void SensorCalib_ClearPoints(uint8_t sensorId);
+
+/**
+ * @brief Fit the coefficients to the reference points and rebuild the table.
+ *
+ * Least squares over the points; with degree + 1 points the polynomial
+ * runs through every one of them. A curved fit (degree 2 or 3) on a
+ * full-range calibration sets the span to the range of the points.
+ *
+ * @param sensorId Registry ID.
+ * @param degree   1 (offset and gain) to SENSOR_CALIB_TERMS - 1.
+ *
+ * @return false if there are too few points or they do not determine
+ *         the polynomial (e.g. repeated readings).
+ */
+bool SensorCalib_Fit(uint8_t sensorId, uint32_t degree);
+
+/**
+ * @brief Correct one block in place.
+ *
+ * Samples whose calibrated channel changed get
+ * @ref SENSOR_QUALITY_CALIBRATED, saturated ones
+ * @ref SENSOR_QUALITY_CLIPPED.
+ *
+ * @param block Block of one sensor.
+ *
+ * @return None.
+ */
+void SensorCalib_ProcessBlock(SampleBlock_t *block);
+
+/**
+ * @brief Correct a run of ring samples in place.
+ *
+ * Runs of consecutive samples of one calibrated sensor are gathered into
+ * a @ref SampleBlock_t and corrected as one block; other samples are not
+ * touched.
+ *
+ * @param samples Samples, oldest first.
+ * @param count   Number of samples.
+ *
+ * @return None.
+ */
+void SensorCalib_ProcessSamples(SensorSample_t *samples, size_t count);
+
+/** @} */ /* end of sensor_calib group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_CALIB_H */
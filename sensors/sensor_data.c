@@ -0,0 +1,120 @@
+/**
+ * @file sensor_data.c
+ * @brief Conversion helpers of the SensorData_t sample format.
+ *
+ * Scales are powers of ten, so conversion is one multiplication with a
+ * table entry; no powf() and no division on the sample path.
+ *
+ * @ingroup sensors
+ */
+
+#include "sensor_if.h"
+#include <string.h>
+
+_Static_assert(sizeof(SensorData_t) == (12U + (4U * SENSOR_MAX_CHANNELS)),
+               "SensorData_t must stay free of padding");
+_Static_assert(SENSOR_MAX_CHANNELS <= SENSOR_LAYOUT_CHANNELS_MASK,
+               "SENSOR_MAX_CHANNELS does not fit the layout byte");
+
+/** @brief Exponent range of the scale tables. */
+#define SENSOR_DATA_EXP_MAX   (9)
+
+/** @brief 10^n for n = -9..9. */
+static const float s_pow10[(2 * SENSOR_DATA_EXP_MAX) + 1] =
+{
+    1e-9f, 1e-8f, 1e-7f, 1e-6f, 1e-5f, 1e-4f, 1e-3f, 1e-2f, 1e-1f,
+    1e0f,
+    1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f
+};
+
+/* ------------------------------------------------------------------------- */
+
+void SensorData_Init(SensorData_t *data, SensorFormat_t format, uint32_t channels, int8_t scaleExp)
+{
+    uint8_t id = data->sensorId;
+
+    if (channels == 0U)
+    {
+        channels = 1U;
+    }
+    else if (channels > SENSOR_MAX_CHANNELS)
+    {
+        channels = SENSOR_MAX_CHANNELS;
+    }
+
+    memset(data, 0, sizeof(*data));
+    data->sensorId = id;
+    data->layout   = (uint8_t)(channels | ((format == SENSOR_FORMAT_S32) ? SENSOR_LAYOUT_S32 : 0U));
+    data->scaleExp = scaleExp;
+}
+
+void SensorData_SetRaw(SensorData_t *data, uint32_t channel, int32_t raw)
+{
+    if (channel >= SensorData_GetChannels(data))
+    {
+        return;
+    }
+
+    if ((data->layout & SENSOR_LAYOUT_S32) != 0U)
+    {
+        if ((raw == INT32_MAX) || (raw == INT32_MIN))
+        {
+            data->quality |= SENSOR_QUALITY_CLIPPED;
+        }
+        data->raw.s32[channel] = raw;
+        return;
+    }
+
+    if (raw >= INT16_MAX)
+    {
+        raw = INT16_MAX;
+        data->quality |= SENSOR_QUALITY_CLIPPED;
+    }
+    else if (raw <= INT16_MIN)
+    {
+        raw = INT16_MIN;
+        data->quality |= SENSOR_QUALITY_CLIPPED;
+    }
+    data->raw.s16[channel] = (int16_t)raw;
+}
+
+void SensorData_SetFloat(SensorData_t *data, uint32_t channel, float value)
+{
+    float scaled = value * SensorData_Pow10(-(int32_t)data->scaleExp);
+
+    /* Written so that NaN saturates too; SetRaw() narrows int16 further. */
+    int32_t raw;
+    if (!(scaled < 2147483520.0f))
+    {
+        raw = INT32_MAX;
+    }
+    else if (scaled <= -2147483520.0f)
+    {
+        raw = INT32_MIN;
+    }
+    else
+    {
+        raw = (int32_t)((scaled >= 0.0f) ? (scaled + 0.5f) : (scaled - 0.5f));
+    }
+
+    SensorData_SetRaw(data, channel, raw);
+}
+
+float SensorData_GetFloat(const SensorData_t *data, uint32_t channel)
+{
+    return (float)SensorData_GetRaw(data, channel) * SensorData_Pow10(data->scaleExp);
+}
+
+float SensorData_Pow10(int32_t exp)
+{
+    if (exp > SENSOR_DATA_EXP_MAX)
+    {
+        exp = SENSOR_DATA_EXP_MAX;
+    }
+    else if (exp < -SENSOR_DATA_EXP_MAX)
+    {
+        exp = -SENSOR_DATA_EXP_MAX;
+    }
+
+    return s_pow10[exp + SENSOR_DATA_EXP_MAX];
+}
@@ -0,0 +1,201 @@
+/**
+ * @file sensor_deadband.c
+ * @brief Report-by-exception gate implementation.
+ *
+ * A fixed table of slots keyed by sensor ID, like the filter stage. The
+ * max-silence timer runs on sample timestamps, so it also holds for
+ * back-dated FIFO batches.
+ *
+ * @ingroup sensor_deadband
+ */
+
+#include "sensor_deadband.h"
+#include <string.h>
+
+/**
+ * @brief Deadband state of one sensor.
+ */
+typedef struct
+{
+    bool                   used;                           /**< Slot in use.                  */
+    bool                   primed;                         /**< A sample has been reported.   */
+    uint8_t                sensorId;                       /**< Owner.                        */
+    SensorDeadbandConfig_t config;                         /**< Settings.                     */
+    float                  lastValue[SENSOR_MAX_CHANNELS]; /**< Last reported channels.       */
+    uint32_t               lastReport_ms;                  /**< Timestamp of the last report. */
+    SensorDeadbandStats_t  stats;                          /**< Counters.                     */
+} SensorDeadbandSlot_t;
+
+/**
+ * @brief Deadband slots.
+ */
+static SensorDeadbandSlot_t s_slots[SENSOR_DEADBAND_MAX_SENSORS];
+
+/**
+ * @brief Find the slot of @p sensorId, or NULL.
+ */
+static SensorDeadbandSlot_t *SensorDeadband_Find(uint8_t sensorId);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorDeadband_Init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+}
+
+bool SensorDeadband_Configure(uint8_t sensorId, const SensorDeadbandConfig_t *config)
+{
+    if ((config == NULL) || (config->deadband < 0.0f))
+    {
+        return false;
+    }
+
+    SensorDeadbandSlot_t *slot = SensorDeadband_Find(sensorId);
+
+    if ((config->deadband == 0.0f) && (config->maxSilence_ms == 0U))
+    {
+        if (slot != NULL)
+        {
+            slot->used = false;
+        }
+        return true;
+    }
+
+    if (slot == NULL)
+    {
+        for (uint32_t i = 0U; i < SENSOR_DEADBAND_MAX_SENSORS; ++i)
+        {
+            if (!s_slots[i].used)
+            {
+                slot = &s_slots[i];
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->used     = true;
+    slot->sensorId = sensorId;
+    slot->config   = *config;
+
+    return true;
+}
+
+bool SensorDeadband_Get(uint8_t sensorId, SensorDeadbandConfig_t *config,
+                        SensorDeadbandStats_t *stats)
+{
+    const SensorDeadbandSlot_t *slot = SensorDeadband_Find(sensorId);
+
+    if (config != NULL)
+    {
+        if (slot != NULL)
+        {
+            *config = slot->config;
+        }
+        else
+        {
+            memset(config, 0, sizeof(*config));
+        }
+    }
+
+    if (stats != NULL)
+    {
+        if (slot != NULL)
+        {
+            *stats = slot->stats;
+        }
+        else
+        {
+            memset(stats, 0, sizeof(*stats));
+        }
+    }
+
+    return (slot != NULL);
+}
+
+bool SensorDeadband_ShouldReport(uint8_t sensorId, const SensorData_t *data)
+{
+    return SensorDeadband_Check(sensorId, data) != SENSOR_DEADBAND_SUPPRESS;
+}
+
+SensorDeadbandResult_t SensorDeadband_Check(uint8_t sensorId, const SensorData_t *data)
+{
+    SensorDeadbandSlot_t *slot = SensorDeadband_Find(sensorId);
+    if ((slot == NULL) || (data == NULL))
+    {
+        return SENSOR_DEADBAND_UNGATED;
+    }
+
+    SensorDeadbandResult_t result = SENSOR_DEADBAND_UNGATED;
+
+    if (slot->primed)
+    {
+        /* A multi-axis sample counts as changed when any axis moved. */
+        float delta = 0.0f;
+        for (uint32_t c = 0U; c < SensorData_GetChannels(data); ++c)
+        {
+            float d = SensorData_GetFloat(data, c) - slot->lastValue[c];
+            if (d < 0.0f)
+            {
+                d = -d;
+            }
+            if (d > delta)
+            {
+                delta = d;
+            }
+        }
+
+        if (delta > slot->config.deadband)
+        {
+            result = SENSOR_DEADBAND_CHANGED;
+        }
+        else if ((slot->config.maxSilence_ms > 0U) &&
+                 ((data->timestamp - slot->lastReport_ms) >= slot->config.maxSilence_ms))
+        {
+            result = SENSOR_DEADBAND_SILENCE;
+        }
+        else
+        {
+            result = SENSOR_DEADBAND_SUPPRESS;
+        }
+    }
+
+    if (result != SENSOR_DEADBAND_SUPPRESS)
+    {
+        slot->primed        = true;
+        for (uint32_t c = 0U; c < SENSOR_MAX_CHANNELS; ++c)
+        {
+            slot->lastValue[c] = SensorData_GetFloat(data, c);
+        }
+        slot->lastReport_ms = data->timestamp;
+        slot->stats.reported++;
+    }
+    else
+    {
+        slot->stats.suppressed++;
+    }
+
+    return result;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorDeadbandSlot_t *SensorDeadband_Find(uint8_t sensorId)
+{
+    for (uint32_t i = 0U; i < SENSOR_DEADBAND_MAX_SENSORS; ++i)
+    {
+        if (s_slots[i].used && (s_slots[i].sensorId == sensorId))
+        {
+            return &s_slots[i];
+        }
+    }
+
+    return NULL;
+}
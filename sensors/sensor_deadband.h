@@ -0,0 +1,132 @@
+/**
+ * @file sensor_deadband.h
+ * @brief Report-by-exception (deadband) gate for sensor samples.
+ *
+ * After filtering, a sample is only passed on to the outputs (log,
+ * telemetry, storage) when its value differs from the last reported
+ * value by more than the sensor's deadband (on any channel of a
+ * multi-channel sample), or when the sensor has been silent for its
+ * maximum silence time. Slow-moving signals then produce a fraction of
+ * the output traffic while changes still go out immediately.
+ *
+ * Sensors without a configuration are always reported.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_DEADBAND_H
+#define SENSOR_DEADBAND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+
+/**
+ * @defgroup sensor_deadband Deadband Reporting
+ * @brief Change-of-value / max-silence sample gating.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of sensors that can have a deadband configuration. */
+#define SENSOR_DEADBAND_MAX_SENSORS   (8U)
+
+/**
+ * @brief Deadband settings of one sensor.
+ */
+typedef struct
+{
+    float    deadband;      /**< Minimum change to report (sensor units). */
+    uint32_t maxSilence_ms; /**< Report at least this often; 0 = never.   */
+} SensorDeadbandConfig_t;
+
+/**
+ * @brief Outcome of the deadband gate for one sample.
+ */
+typedef enum
+{
+    SENSOR_DEADBAND_SUPPRESS = 0U, /**< Inside the deadband; not reported.     */
+    SENSOR_DEADBAND_CHANGED,       /**< Moved by more than the deadband.       */
+    SENSOR_DEADBAND_SILENCE,       /**< Max-silence time elapsed.              */
+    SENSOR_DEADBAND_UNGATED        /**< First sample, or sensor not configured. */
+} SensorDeadbandResult_t;
+
+/**
+ * @brief Per-sensor gate counters.
+ */
+typedef struct
+{
+    uint32_t reported;   /**< Samples passed on. */
+    uint32_t suppressed; /**< Samples held back. */
+} SensorDeadbandStats_t;
+
+/**
+ * @brief Remove all deadband configurations.
+ *
+ * @return None.
+ */
+void SensorDeadband_Init(void);
+
+/**
+ * @brief Set (or replace) the deadband of a sensor.
+ *
+ * The next sample of the sensor is always reported. A deadband of 0 with
+ * no max-silence time removes the configuration.
+ *
+ * @param sensorId Registry ID.
+ * @param config   Settings.
+ *
+ * @return false if @p config is invalid or no slot is free.
+ */
+bool SensorDeadband_Configure(uint8_t sensorId, const SensorDeadbandConfig_t *config);
+
+/**
+ * @brief Get the deadband settings and counters of a sensor.
+ *
+ * @param sensorId    Registry ID.
+ * @param[out] config Receives the settings (may be NULL).
+ * @param[out] stats  Receives the counters (may be NULL).
+ *
+ * @return true if the sensor has a configuration.
+ */
+bool SensorDeadband_Get(uint8_t sensorId, SensorDeadbandConfig_t *config,
+                        SensorDeadbandStats_t *stats);
+
+/**
+ * @brief Decide whether a sample should be reported.
+ *
+ * Updates the sensor's last reported value and time when it returns true.
+ *
+ * @param sensorId Registry ID.
+ * @param data     Filtered sample.
+ *
+ * @return true to report the sample, false to suppress it.
+ */
+bool SensorDeadband_ShouldReport(uint8_t sensorId, const SensorData_t *data);
+
+/**
+ * @brief Run the gate on a sample and tell why it is (not) reported.
+ *
+ * Same as SensorDeadband_ShouldReport(), but tells a real change apart
+ * from a max-silence refresh, so callers can treat only changes as
+ * activity.
+ *
+ * @param sensorId Registry ID.
+ * @param data     Filtered sample.
+ *
+ * @return SENSOR_DEADBAND_SUPPRESS to suppress the sample, any other
+ *         value to report it.
+ */
+SensorDeadbandResult_t SensorDeadband_Check(uint8_t sensorId, const SensorData_t *data);
+
+/** @} */ /* end of sensor_deadband group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_DEADBAND_H */
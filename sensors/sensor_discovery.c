@@ -0,0 +1,631 @@
+/**
+ * @file sensor_discovery.c
+ * @brief Sensor discovery implementation.
+ *
+ * Each part has a slot with its bus objects: an I2C descriptor, or an SPI
+ * device, segment and frame, plus the transfer buffers. An I2C part uses
+ * its descriptor for the probe, the init write and later the reads, one
+ * at a time. The SPI parts are probed in one shared frame and started in
+ * another; each then reads through its own one-segment frame.
+ *
+ * Probe and init results are written by the bus callbacks (interrupt
+ * context) and only read in task context, one byte per part, so no
+ * masking is needed. @ref SensorIF_t functions take no context argument,
+ * so each part has startRead() and pollRead() thunks.
+ *
+ * @ingroup sensor_discovery
+ */
+
+#include "sensor_discovery.h"
+#include "sensor_registry.h"
+#include "sensor_adc.h"
+#include "sensor_replay.h"
+#include "i2c_bus.h"
+#include "spi_bus.h"
+#include "boot_time.h"
+#include "time_base.h"
+#include "cli.h"
+#include "log.h"
+#include "app_config.h"
+#include "stm32f4xx_hal.h"
+
+/** @brief Bus of a part (the @c bus column). */
+#define SENSOR_DISCOVERY_BUS_I2C     (0U)
+#define SENSOR_DISCOVERY_BUS_SPI     (1U)
+
+/** @brief Transfer buffer: a command byte and the output registers. */
+#define SENSOR_DISCOVERY_BUFFER      (1U + (2U * SENSOR_MAX_CHANNELS))
+
+/** @brief SPI read bit of the command byte. */
+#define SENSOR_DISCOVERY_SPI_READ    (0x80U)
+
+/** @brief SPI mode and clock of the parts (ST sensors: mode 3, 10 MHz). */
+#define SENSOR_DISCOVERY_SPI_MODE    (3U)
+#define SENSOR_DISCOVERY_SPI_HZ      (10000000U)
+
+#define SENSOR_DISCOVERY_CHECK(var, name, bus, address, idReg, idValue, initReg, initValue,  \
+                               dataReg, channels, sensitivity, scaleExp)                  \
+    _Static_assert(((channels) >= 1U) && ((channels) <= SENSOR_MAX_CHANNELS),             \
+                   #var " channel count out of range");                                   \
+    _Static_assert((SENSOR_DISCOVERY_BUS_##bus != SENSOR_DISCOVERY_BUS_SPI) ||            \
+                   (((address) < 16U) && ((address) != SAMPLE_ARCHIVE_CS_PIN)),           \
+                   #var " chip select must be a free GPIOB pin");
+SENSOR_DISCOVERY_PARTS(SENSOR_DISCOVERY_CHECK)
+#undef SENSOR_DISCOVERY_CHECK
+
+_Static_assert((SENSOR_DISCOVERY_FIRST_ID >= (SENSOR_ADC_FIRST_ID + SENSOR_ADC_CH_COUNT)) &&
+               ((SENSOR_DISCOVERY_FIRST_ID + SENSOR_DISCOVERY_PART_COUNT) <= SENSOR_REPLAY_ID),
+               "discovery IDs overlap the ADC or replay IDs");
+
+/**
+ * @brief One row of the table.
+ */
+typedef struct
+{
+    const char *name;        /**< Part name.                                */
+    uint8_t     bus;         /**< SENSOR_DISCOVERY_BUS_*.                   */
+    uint8_t     address;     /**< 7-bit I2C address or GPIOB pin.           */
+    uint8_t     idReg;       /**< Identification register.                  */
+    uint8_t     idValue;     /**< Its expected value.                       */
+    uint8_t     initReg;     /**< Register written to start the part.       */
+    uint8_t     initValue;   /**< Value written.                            */
+    uint8_t     dataReg;     /**< First output register (burst form).       */
+    uint8_t     channels;    /**< Output axes.                              */
+    float       sensitivity; /**< Units of 10^scaleExp per LSB.             */
+    int8_t      scaleExp;    /**< Sample scale.                             */
+} SensorDiscoveryPartInfo_t;
+
+/**
+ * @brief Runtime state of one part.
+ */
+typedef struct
+{
+    volatile uint8_t state;       /**< SensorDiscoveryState_t.               */
+    uint8_t          idRead;      /**< Identification read (if answered).    */
+    uint32_t         answer_us;   /**< Probe finished, from the start.       */
+    uint32_t         ready_us;    /**< Init write finished, from the start.  */
+    uint32_t         read_ms;     /**< Tick of the read in flight.           */
+    uint32_t         read_us;     /**< Same instant in us.                   */
+    I2cBusXfer_t     xfer;        /**< I2C: probe, init and reads.           */
+    SpiBusDevice_t   device;      /**< SPI: chip select.                     */
+    SpiBusSegment_t  segment;     /**< SPI: read segment.                    */
+    SpiBusFrame_t    frame;       /**< SPI: read frame.                      */
+    uint8_t          tx[SENSOR_DISCOVERY_BUFFER]; /**< SPI command bytes.    */
+    uint8_t          rx[SENSOR_DISCOVERY_BUFFER]; /**< Received bytes.       */
+    SensorEntry_t    entry;       /**< Registry entry once found.            */
+} SensorDiscoverySlot_t;
+
+/** @brief The known parts, indexed by SensorDiscoveryPart_t. */
+static const SensorDiscoveryPartInfo_t s_parts[SENSOR_DISCOVERY_PART_COUNT] =
+{
+#define SENSOR_DISCOVERY_PART_INFO(var, name, bus, address, idReg, idValue, initReg, initValue, \
+                                   dataReg, channels, sensitivity, scaleExp)               \
+    { (name), SENSOR_DISCOVERY_BUS_##bus, (address), (idReg), (idValue), (initReg),         \
+      (initValue), (dataReg), (channels), (sensitivity), (scaleExp) },
+    SENSOR_DISCOVERY_PARTS(SENSOR_DISCOVERY_PART_INFO)
+#undef SENSOR_DISCOVERY_PART_INFO
+};
+
+/** @brief Per-part state. */
+static SensorDiscoverySlot_t s_slots[SENSOR_DISCOVERY_PART_COUNT];
+
+/** @brief Shared SPI probe and init frames and their segments. */
+static SpiBusFrame_t   s_spiProbe;
+static SpiBusFrame_t   s_spiInit;
+static SpiBusSegment_t s_spiProbeSegment[SENSOR_DISCOVERY_PART_COUNT];
+static SpiBusSegment_t s_spiInitSegment[SENSOR_DISCOVERY_PART_COUNT];
+
+/** @brief Part of each segment of the shared frames. */
+static uint8_t s_spiProbePart[SENSOR_DISCOVERY_PART_COUNT];
+static uint8_t s_spiInitPart[SENSOR_DISCOVERY_PART_COUNT];
+
+/** @brief Time base value at SensorDiscovery_Start(). */
+static uint32_t s_start_us = 0U;
+
+/** @brief Probes were queued; the report is still to come. */
+static bool s_started = false;
+static bool s_reported = false;
+
+/** @brief Whole discovery, start to the last init write (us). */
+static uint32_t s_total_us = 0U;
+
+/**
+ * @brief Shared startRead() implementation.
+ */
+static bool SensorDiscovery_StartRead(uint32_t part);
+
+/**
+ * @brief Shared pollRead() implementation.
+ */
+static SensorReadStatus_t SensorDiscovery_PollRead(uint32_t part, SensorData_t *outData);
+
+/** @brief Define the startRead() and pollRead() thunks of part @p var. */
+#define SENSOR_DISCOVERY_DEFINE_READ(var, ...)                                              \
+    static bool SensorDiscovery_Start_##var(void)                                           \
+    {                                                                                       \
+        return SensorDiscovery_StartRead(SENSOR_DISCOVERY_PART_##var);                      \
+    }                                                                                       \
+    static SensorReadStatus_t SensorDiscovery_Poll_##var(SensorData_t *outData)              \
+    {                                                                                       \
+        return SensorDiscovery_PollRead(SENSOR_DISCOVERY_PART_##var, outData);              \
+    }
+SENSOR_DISCOVERY_PARTS(SENSOR_DISCOVERY_DEFINE_READ)
+#undef SENSOR_DISCOVERY_DEFINE_READ
+
+/**
+ * @brief One interface per part.
+ */
+static const SensorIF_t s_partIF[SENSOR_DISCOVERY_PART_COUNT] =
+{
+#define SENSOR_DISCOVERY_PART_IF(var, ...)                                                  \
+    [SENSOR_DISCOVERY_PART_##var] = { .startRead = SensorDiscovery_Start_##var,             \
+                                      .pollRead  = SensorDiscovery_Poll_##var },
+    SENSOR_DISCOVERY_PARTS(SENSOR_DISCOVERY_PART_IF)
+#undef SENSOR_DISCOVERY_PART_IF
+};
+
+/**
+ * @brief Classify an answered probe: FOUND path, mismatch or absent.
+ *
+ * @return true if the identification matches.
+ */
+static bool SensorDiscovery_Identify(uint32_t part, bool answered, uint8_t idRead);
+
+/**
+ * @brief I2C probe callback: start the part or record the outcome.
+ */
+static void SensorDiscovery_OnI2cProbe(I2cBusXfer_t *xfer);
+
+/**
+ * @brief I2C init write callback.
+ */
+static void SensorDiscovery_OnI2cInit(I2cBusXfer_t *xfer);
+
+/**
+ * @brief SPI probe frame callback: start every identified part in one frame.
+ */
+static void SensorDiscovery_OnSpiProbe(SpiBusFrame_t *frame);
+
+/**
+ * @brief SPI init frame callback.
+ */
+static void SensorDiscovery_OnSpiInit(SpiBusFrame_t *frame);
+
+/**
+ * @brief Register the parts found with the sensor registry.
+ */
+static void SensorDiscovery_RegisterFound(void);
+
+/**
+ * @brief Print the report.
+ */
+static void SensorDiscovery_Report(void);
+
+/**
+ * @brief CLI "discover" handler.
+ */
+static void SensorDiscovery_CmdDiscover(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorDiscovery_Start(void)
+{
+    if ((SENSOR_DISCOVERY_ENABLE == 0) || s_started)
+    {
+        return;
+    }
+
+    uint32_t spiCount = 0U;
+
+    s_start_us = Time_NowUs32();
+    s_started  = true;
+    s_reported = false;
+
+    /* Known from the start; it reports progress until the results exist. */
+    (void)CLI_RegisterCommand("discover", SensorDiscovery_CmdDiscover,
+                              "- Show the sensor discovery report");
+
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        const SensorDiscoveryPartInfo_t *info = &s_parts[i];
+        SensorDiscoverySlot_t           *slot = &s_slots[i];
+
+        *slot       = (SensorDiscoverySlot_t){0};
+        slot->state = (uint8_t)SENSOR_DISCOVERY_PROBING;
+
+        if (info->bus == SENSOR_DISCOVERY_BUS_I2C)
+        {
+            slot->xfer.address = info->address;
+            slot->xfer.reg     = info->idReg;
+            slot->xfer.flags   = I2C_BUS_XFER_READ;
+            slot->xfer.length  = 1U;
+            slot->xfer.data    = slot->rx;
+            slot->xfer.done    = SensorDiscovery_OnI2cProbe;
+            slot->xfer.context = slot;
+
+            if (!I2cBus_Submit(&slot->xfer))
+            {
+                slot->state = (uint8_t)SENSOR_DISCOVERY_FAILED;
+            }
+        }
+        else
+        {
+            slot->device = (SpiBusDevice_t){ (uint16_t)(1U << info->address), SENSOR_DISCOVERY_SPI_MODE,
+                                             SENSOR_DISCOVERY_SPI_HZ };
+            SpiBus_InitDevice(&slot->device);
+
+            slot->tx[0] = (uint8_t)(SENSOR_DISCOVERY_SPI_READ | info->idReg);
+            slot->tx[1] = 0U;
+            s_spiProbeSegment[spiCount] = (SpiBusSegment_t){ &slot->device, slot->tx, slot->rx, 2U };
+            s_spiProbePart[spiCount]    = (uint8_t)i;
+            spiCount++;
+        }
+    }
+
+    if (spiCount != 0U)
+    {
+        s_spiProbe = (SpiBusFrame_t){ .segments = s_spiProbeSegment, .count = (uint8_t)spiCount,
+                                      .done = SensorDiscovery_OnSpiProbe };
+        if (!SpiBus_Submit(&s_spiProbe))
+        {
+            for (uint32_t s = 0U; s < spiCount; ++s)
+            {
+                s_slots[s_spiProbePart[s]].state = (uint8_t)SENSOR_DISCOVERY_FAILED;
+            }
+        }
+    }
+}
+
+bool SensorDiscovery_Service(void)
+{
+    if (!s_started || s_reported)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        uint8_t state = s_slots[i].state;
+
+        if ((state == (uint8_t)SENSOR_DISCOVERY_PROBING) || (state == (uint8_t)SENSOR_DISCOVERY_STARTING))
+        {
+            return true;
+        }
+    }
+
+    s_reported = true;
+    s_total_us = 0U;
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        uint32_t end_us = (s_slots[i].ready_us != 0U) ? s_slots[i].ready_us : s_slots[i].answer_us;
+        if (end_us > s_total_us)
+        {
+            s_total_us = end_us;
+        }
+    }
+
+    SensorDiscovery_RegisterFound();
+    BootTime_Mark(BOOT_PHASE_DISCOVERY);
+
+    uint32_t found = 0U;
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        const SensorDiscoveryPartInfo_t *info = &s_parts[i];
+        const SensorDiscoverySlot_t     *slot = &s_slots[i];
+
+        switch ((SensorDiscoveryState_t)slot->state)
+        {
+            case SENSOR_DISCOVERY_FOUND:
+                found++;
+                LOG_INFO("SensorDiscovery: %s on %s 0x%02x found, sensor %u", info->name,
+                         (info->bus == SENSOR_DISCOVERY_BUS_I2C) ? "I2C" : "SPI CS",
+                         (unsigned)info->address, (unsigned)slot->entry.id);
+                break;
+            case SENSOR_DISCOVERY_MISMATCH:
+                LOG_WARN("SensorDiscovery: %s on %s 0x%02x: ID 0x%02x, expected 0x%02x", info->name,
+                         (info->bus == SENSOR_DISCOVERY_BUS_I2C) ? "I2C" : "SPI CS",
+                         (unsigned)info->address, (unsigned)slot->idRead, (unsigned)info->idValue);
+                break;
+            case SENSOR_DISCOVERY_FAILED:
+                LOG_WARN("SensorDiscovery: %s on %s 0x%02x failed to start", info->name,
+                         (info->bus == SENSOR_DISCOVERY_BUS_I2C) ? "I2C" : "SPI CS",
+                         (unsigned)info->address);
+                break;
+            default:
+                break;
+        }
+    }
+
+    LOG_INFO("SensorDiscovery: %lu of %lu part(s) found in %lu us", (unsigned long)found,
+             (unsigned long)SENSOR_DISCOVERY_PART_COUNT, (unsigned long)s_total_us);
+
+    return false;
+}
+
+SensorDiscoveryState_t SensorDiscovery_GetState(uint32_t part)
+{
+    if (!s_started || (part >= SENSOR_DISCOVERY_PART_COUNT))
+    {
+        return SENSOR_DISCOVERY_ABSENT;
+    }
+
+    return (SensorDiscoveryState_t)s_slots[part].state;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SensorDiscovery_Identify(uint32_t part, bool answered, uint8_t idRead)
+{
+    SensorDiscoverySlot_t *slot = &s_slots[part];
+
+    slot->answer_us = Time_NowUs32() - s_start_us;
+    slot->idRead    = idRead;
+
+    if (answered && (idRead == s_parts[part].idValue))
+    {
+        slot->state = (uint8_t)SENSOR_DISCOVERY_STARTING;
+        return true;
+    }
+
+    /* An SPI line with nothing on it reads all zeros or all ones. */
+    bool floating = (s_parts[part].bus == SENSOR_DISCOVERY_BUS_SPI) && ((idRead == 0x00U) || (idRead == 0xFFU));
+
+    slot->state = (uint8_t)((answered && !floating) ? SENSOR_DISCOVERY_MISMATCH : SENSOR_DISCOVERY_ABSENT);
+    return false;
+}
+
+static void SensorDiscovery_OnI2cProbe(I2cBusXfer_t *xfer)
+{
+    SensorDiscoverySlot_t *slot = (SensorDiscoverySlot_t *)xfer->context;
+    uint32_t               part = (uint32_t)(slot - s_slots);
+
+    if (!SensorDiscovery_Identify(part, (xfer->result == I2C_BUS_OK), slot->rx[0]))
+    {
+        return;
+    }
+
+    slot->rx[0]       = s_parts[part].initValue;
+    slot->xfer.reg    = s_parts[part].initReg;
+    slot->xfer.flags  = 0U;
+    slot->xfer.done   = SensorDiscovery_OnI2cInit;
+
+    if (!I2cBus_Submit(&slot->xfer))
+    {
+        slot->state = (uint8_t)SENSOR_DISCOVERY_FAILED;
+    }
+}
+
+static void SensorDiscovery_OnI2cInit(I2cBusXfer_t *xfer)
+{
+    SensorDiscoverySlot_t *slot = (SensorDiscoverySlot_t *)xfer->context;
+
+    slot->ready_us = Time_NowUs32() - s_start_us;
+    slot->state    = (uint8_t)((xfer->result == I2C_BUS_OK) ? SENSOR_DISCOVERY_FOUND : SENSOR_DISCOVERY_FAILED);
+}
+
+static void SensorDiscovery_OnSpiProbe(SpiBusFrame_t *frame)
+{
+    uint32_t initCount = 0U;
+
+    for (uint32_t s = 0U; s < frame->count; ++s)
+    {
+        uint32_t               part = s_spiProbePart[s];
+        SensorDiscoverySlot_t *slot = &s_slots[part];
+
+        if (SensorDiscovery_Identify(part, (frame->result == SPI_BUS_OK), slot->rx[1]))
+        {
+            slot->tx[0] = s_parts[part].initReg;
+            slot->tx[1] = s_parts[part].initValue;
+            s_spiInitSegment[initCount] = (SpiBusSegment_t){ &slot->device, slot->tx, NULL, 2U };
+            s_spiInitPart[initCount]    = (uint8_t)part;
+            initCount++;
+        }
+    }
+
+    if (initCount == 0U)
+    {
+        return;
+    }
+
+    s_spiInit = (SpiBusFrame_t){ .segments = s_spiInitSegment, .count = (uint8_t)initCount,
+                                 .done = SensorDiscovery_OnSpiInit };
+    if (!SpiBus_Submit(&s_spiInit))
+    {
+        for (uint32_t s = 0U; s < initCount; ++s)
+        {
+            s_slots[s_spiInitPart[s]].state = (uint8_t)SENSOR_DISCOVERY_FAILED;
+        }
+    }
+}
+
+static void SensorDiscovery_OnSpiInit(SpiBusFrame_t *frame)
+{
+    uint32_t ready_us = Time_NowUs32() - s_start_us;
+
+    for (uint32_t s = 0U; s < frame->count; ++s)
+    {
+        SensorDiscoverySlot_t *slot = &s_slots[s_spiInitPart[s]];
+
+        slot->ready_us = ready_us;
+        slot->state    = (uint8_t)((frame->result == SPI_BUS_OK) ? SENSOR_DISCOVERY_FOUND : SENSOR_DISCOVERY_FAILED);
+    }
+}
+
+static void SensorDiscovery_RegisterFound(void)
+{
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        const SensorDiscoveryPartInfo_t *info = &s_parts[i];
+        SensorDiscoverySlot_t           *slot = &s_slots[i];
+
+        if (slot->state != (uint8_t)SENSOR_DISCOVERY_FOUND)
+        {
+            continue;
+        }
+
+        if (info->bus == SENSOR_DISCOVERY_BUS_I2C)
+        {
+            slot->xfer.reg    = info->dataReg;
+            slot->xfer.flags  = I2C_BUS_XFER_READ | I2C_BUS_XFER_AUTOINC;
+            slot->xfer.length = (uint16_t)(2U * info->channels);
+            slot->xfer.data   = &slot->rx[1];
+            slot->xfer.done   = NULL;
+        }
+        else
+        {
+            slot->tx[0]   = (uint8_t)(SENSOR_DISCOVERY_SPI_READ | info->dataReg);
+            slot->segment = (SpiBusSegment_t){ &slot->device, slot->tx, slot->rx,
+                                               (uint16_t)(1U + (2U * info->channels)) };
+            slot->frame   = (SpiBusFrame_t){ .segments = &slot->segment, .count = 1U };
+        }
+
+        slot->entry       = (SensorEntry_t){0};
+        slot->entry.id    = (uint8_t)(SENSOR_DISCOVERY_FIRST_ID + i);
+        slot->entry.name  = info->name;
+        slot->entry.iface = &s_partIF[i];
+        slot->entry.period_ms[POWER_MODE_ACTIVE] = SENSOR_DISCOVERY_PERIOD_ACTIVE_MS;
+        slot->entry.period_ms[POWER_MODE_IDLE]   = SENSOR_DISCOVERY_PERIOD_IDLE_MS;
+
+        if (SensorRegistry_Register(&slot->entry) != 0)
+        {
+            slot->state = (uint8_t)SENSOR_DISCOVERY_FAILED;
+        }
+    }
+}
+
+static bool SensorDiscovery_StartRead(uint32_t part)
+{
+    SensorDiscoverySlot_t *slot = &s_slots[part];
+
+    slot->read_ms = HAL_GetTick();
+    slot->read_us = Time_NowUs32();
+
+    return (s_parts[part].bus == SENSOR_DISCOVERY_BUS_I2C) ? I2cBus_Submit(&slot->xfer)
+                                                           : SpiBus_Submit(&slot->frame);
+}
+
+static SensorReadStatus_t SensorDiscovery_PollRead(uint32_t part, SensorData_t *outData)
+{
+    const SensorDiscoveryPartInfo_t *info = &s_parts[part];
+    const SensorDiscoverySlot_t     *slot = &s_slots[part];
+
+    if (info->bus == SENSOR_DISCOVERY_BUS_I2C)
+    {
+        if (slot->xfer.state != I2C_BUS_XFER_DONE)
+        {
+            return SENSOR_READ_BUSY;
+        }
+        if (slot->xfer.result != I2C_BUS_OK)
+        {
+            return SENSOR_READ_ERROR;
+        }
+    }
+    else
+    {
+        if (slot->frame.state != SPI_BUS_FRAME_DONE)
+        {
+            return SENSOR_READ_BUSY;
+        }
+        if (slot->frame.result != SPI_BUS_OK)
+        {
+            return SENSOR_READ_ERROR;
+        }
+    }
+
+    /* Both buses leave the output registers at rx[1]. */
+    SensorData_Init(outData, SENSOR_FORMAT_S16, info->channels, info->scaleExp);
+    outData->timestamp    = slot->read_ms;
+    outData->timestamp_us = slot->read_us;
+
+    for (uint32_t ch = 0U; ch < info->channels; ++ch)
+    {
+        int16_t raw = (int16_t)((uint16_t)slot->rx[1U + (2U * ch)] |
+                                ((uint16_t)slot->rx[2U + (2U * ch)] << 8));
+
+        SensorData_SetFloat(outData, ch, (float)raw * info->sensitivity);
+    }
+
+    return SENSOR_READ_DONE;
+}
+
+static void SensorDiscovery_Report(void)
+{
+    static const char *const s_stateNames[] =
+    {
+        [SENSOR_DISCOVERY_PROBING]  = "probing",
+        [SENSOR_DISCOVERY_ABSENT]   = "absent",
+        [SENSOR_DISCOVERY_MISMATCH] = "wrong ID",
+        [SENSOR_DISCOVERY_STARTING] = "starting",
+        [SENSOR_DISCOVERY_FAILED]   = "failed",
+        [SENSOR_DISCOVERY_FOUND]    = "found"
+    };
+
+    CLI_Print("\r\nSensor discovery (%lu us, buses in parallel)\r\n", (unsigned long)s_total_us);
+    CLI_Print("  part     bus addr  id   state     answer_us  ready_us  sensor\r\n");
+
+    for (uint32_t i = 0U; i < SENSOR_DISCOVERY_PART_COUNT; ++i)
+    {
+        const SensorDiscoveryPartInfo_t *info  = &s_parts[i];
+        const SensorDiscoverySlot_t     *slot  = &s_slots[i];
+        SensorDiscoveryState_t           state = (SensorDiscoveryState_t)slot->state;
+
+        if (info->bus == SENSOR_DISCOVERY_BUS_I2C)
+        {
+            CLI_Print("  %-8s I2C 0x%02x", info->name, (unsigned)info->address);
+        }
+        else
+        {
+            CLI_Print("  %-8s SPI PB%-2u", info->name, (unsigned)info->address);
+        }
+
+        if (state == SENSOR_DISCOVERY_ABSENT)
+        {
+            CLI_Print("  --   ");
+        }
+        else
+        {
+            CLI_Print("  0x%02x ", (unsigned)slot->idRead);
+        }
+
+        CLI_Print("%-9s %9lu", s_stateNames[state], (unsigned long)slot->answer_us);
+
+        if (slot->ready_us != 0U)
+        {
+            CLI_Print(" %9lu", (unsigned long)slot->ready_us);
+        }
+        else
+        {
+            CLI_Print("         -");
+        }
+
+        if (state == SENSOR_DISCOVERY_FOUND)
+        {
+            CLI_Print("  %u\r\n", (unsigned)slot->entry.id);
+        }
+        else
+        {
+            CLI_Print("  -\r\n");
+        }
+    }
+}
+
+static void SensorDiscovery_CmdDiscover(uint32_t argc, char *argv[])
+{
+    (void)argv;
+
+    if (argc != 1U)
+    {
+        CLI_PrintError("\r\nUsage: discover\r\n");
+        return;
+    }
+
+    if (!s_reported)
+    {
+        CLI_Print("\r\nSensor discovery in progress.\r\n");
+        return;
+    }
+
+    SensorDiscovery_Report();
+}
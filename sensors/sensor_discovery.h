@@ -0,0 +1,133 @@
+/**
+ * @file sensor_discovery.h
+ * @brief Sensor discovery at boot: every known part probed at once on the
+ *        I2C and SPI buses, and only the ones that answer registered.
+ *
+ * The parts a board may carry are listed in @ref SENSOR_DISCOVERY_PARTS,
+ * each with its bus, address or chip select, identification register and
+ * the value it must read. SensorDiscovery_Start() queues the probes of all
+ * of them in one go: one read descriptor per I2C part and one SPI frame
+ * with a segment per SPI part. The two buses run in parallel, and an
+ * absent I2C part costs one address phase (NACK), not a driver timeout.
+ * A part whose identification matches gets its init write (power-up
+ * register) from the probe's completion callback, so the init sequences
+ * also overlap across the buses; an identification that does not match
+ * leaves the part alone.
+ *
+ * SensorDiscovery_Service(), called by the sampling task, registers the
+ * parts that finished their init once every probe is done: each is an
+ * asynchronous registry sensor (startRead() / pollRead()) that reads its
+ * axis registers in one burst. It then logs the report, marks
+ * @ref BOOT_PHASE_DISCOVERY and registers the `discover` command, which
+ * prints the report again.
+ *
+ * A part's channels are its little-endian int16 output registers times
+ * its sensitivity, in the units of its scale (e.g. mg for 10^0). The
+ * registry IDs are @ref SENSOR_DISCOVERY_FIRST_ID + the table index.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_DISCOVERY_H
+#define SENSOR_DISCOVERY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup sensor_discovery Sensor Discovery
+ * @brief Concurrent bus probing and registration of the parts found.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Registry ID of part 0; part n uses FIRST_ID + n. */
+#define SENSOR_DISCOVERY_FIRST_ID    (20U)
+
+/**
+ * @brief Known parts: X(var, name, bus, address, idReg, idValue, initReg,
+ *        initValue, dataReg, channels, sensitivity, scaleExp).
+ *
+ * - @c bus, @c address: I2C and a 7-bit address, or SPI and a GPIOB chip
+ *   select pin number
+ * - @c idReg, @c idValue: identification register and its value
+ * - @c initReg, @c initValue: register written to start the part
+ * - @c dataReg: first output register as the part's burst read wants it
+ *   (auto-increment bit included; the SPI read bit is added)
+ * - @c sensitivity: units of 10^scaleExp per output LSB
+ *
+ * The chip selects avoid the SPI bus pins, the sample archive (PB6) and
+ * the `spi test` devices (PB1, PB2, PB10, PB12).
+ */
+#define SENSOR_DISCOVERY_PARTS(X)                                                          \
+    X(imu,    "LSM6DSR", SPI, 4U,    0x0FU, 0x6BU, 0x10U, 0x40U, 0x28U, 3U, 0.061f,  0)    \
+    X(accel,  "LIS3DH",  I2C, 0x18U, 0x0FU, 0x33U, 0x20U, 0x57U, 0xA8U, 3U, 0.0625f, 0)    \
+    X(mag,    "LIS2MDL", I2C, 0x1EU, 0x4FU, 0x40U, 0x60U, 0x00U, 0x68U, 3U, 1.5f,    0)    \
+    X(accel2, "LIS3DH",  SPI, 5U,    0x0FU, 0x33U, 0x20U, 0x57U, 0x68U, 3U, 0.0625f, 0)
+
+/**
+ * @brief Part identifiers (table index).
+ */
+typedef enum
+{
+#define SENSOR_DISCOVERY_PART_ENUM(var, ...) SENSOR_DISCOVERY_PART_##var,
+    SENSOR_DISCOVERY_PARTS(SENSOR_DISCOVERY_PART_ENUM)
+#undef SENSOR_DISCOVERY_PART_ENUM
+    SENSOR_DISCOVERY_PART_COUNT
+} SensorDiscoveryPart_t;
+
+/**
+ * @brief Outcome of one part.
+ */
+typedef enum
+{
+    SENSOR_DISCOVERY_PROBING = 0U, /**< Identification read in flight.       */
+    SENSOR_DISCOVERY_ABSENT,       /**< No answer (NACK, error, timeout).    */
+    SENSOR_DISCOVERY_MISMATCH,     /**< Answered with another identification. */
+    SENSOR_DISCOVERY_STARTING,     /**< Identified; init write in flight.    */
+    SENSOR_DISCOVERY_FAILED,       /**< Init write or registration failed.   */
+    SENSOR_DISCOVERY_FOUND         /**< Registered.                          */
+} SensorDiscoveryState_t;
+
+/**
+ * @brief Probe the known parts: queue every identification read at once.
+ *
+ * Call once the buses are initialized (I2cBus_Init(), SpiBus_Init()).
+ * Does nothing when @ref SENSOR_DISCOVERY_ENABLE is 0.
+ *
+ * @return None.
+ */
+void SensorDiscovery_Start(void);
+
+/**
+ * @brief Register the parts found once every probe has finished, and
+ *        report.
+ *
+ * Call from the sampling task after the bus services.
+ *
+ * @return true while probes or init writes are still in flight (poll
+ *         again soon).
+ */
+bool SensorDiscovery_Service(void);
+
+/**
+ * @brief Outcome of one part.
+ *
+ * @param part Table index.
+ *
+ * @return Its state (@ref SENSOR_DISCOVERY_ABSENT if out of range or not
+ *         probed).
+ */
+SensorDiscoveryState_t SensorDiscovery_GetState(uint32_t part);
+
+/** @} */ /* end of sensor_discovery group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_DISCOVERY_H */
@@ -0,0 +1,304 @@
+/**
+ * @file sensor_farm.c
+ * @brief Synthetic sensor farm implementation.
+ *
+ * @ref SensorIF_t functions take no context argument, so every channel
+ * gets its own small read() thunk, generated from SENSOR_FARM_CHANNELS(),
+ * that forwards to the shared implementation with the channel index.
+ *
+ * @ingroup sensor_farm
+ */
+
+#include "sensor_farm.h"
+#include "sensor_registry.h"
+#include "time_base.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+#include "fmt.h"
+
+/** @brief Default sampling period of channel 0 in ACTIVE mode (ms). */
+#define SENSOR_FARM_BASE_PERIOD_MS   (50U)
+
+/** @brief IDLE-mode sampling period relative to ACTIVE. */
+#define SENSOR_FARM_IDLE_FACTOR      (4U)
+
+/** @brief Length of a channel name including the terminator ("Farm23"). */
+#define SENSOR_FARM_NAME_LEN         (8U)
+
+/**
+ * @brief Channel list for the per-channel thunks and interfaces.
+ *
+ * Must have exactly SENSOR_FARM_MAX_CHANNELS entries.
+ */
+#define SENSOR_FARM_CHANNELS(X) \
+    X(0)  X(1)  X(2)  X(3)  X(4)  X(5)  X(6)  X(7)  \
+    X(8)  X(9)  X(10) X(11) X(12) X(13) X(14) X(15) \
+    X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23)
+
+/**
+ * @brief Shared read implementation.
+ */
+static bool SensorFarm_ReadChannel(uint32_t index, SensorData_t *outData);
+
+/** @brief Define the read() thunk of channel @p n. */
+#define SENSOR_FARM_DEFINE_READ(n)                          \
+    static bool SensorFarm_Read##n(SensorData_t *outData)   \
+    {                                                       \
+        return SensorFarm_ReadChannel((n), outData);        \
+    }
+
+SENSOR_FARM_CHANNELS(SENSOR_FARM_DEFINE_READ)
+
+/** @brief Interface initializer of channel @p n. */
+#define SENSOR_FARM_IF_ENTRY(n)   { .init = NULL, .read = SensorFarm_Read##n },
+
+/**
+ * @brief One interface per channel.
+ */
+static const SensorIF_t s_channelIF[] =
+{
+    SENSOR_FARM_CHANNELS(SENSOR_FARM_IF_ENTRY)
+};
+
+_Static_assert((sizeof(s_channelIF) / sizeof(s_channelIF[0])) == SENSOR_FARM_MAX_CHANNELS,
+               "SENSOR_FARM_CHANNELS must list SENSOR_FARM_MAX_CHANNELS channels");
+
+/**
+ * @brief Registry records of all channels.
+ */
+static SensorEntry_t s_entries[SENSOR_FARM_MAX_CHANNELS];
+
+/**
+ * @brief Channel names ("Farm00" ...).
+ */
+static char s_names[SENSOR_FARM_MAX_CHANNELS][SENSOR_FARM_NAME_LEN];
+
+/**
+ * @brief Channel configurations.
+ */
+static SensorFarmChannelConfig_t s_configs[SENSOR_FARM_MAX_CHANNELS];
+
+/**
+ * @brief Waveform generators.
+ */
+static SimWave_t s_waves[SENSOR_FARM_MAX_CHANNELS];
+
+/**
+ * @brief Tick at which each channel was activated (waveform time zero).
+ */
+static uint32_t s_start_ms[SENSOR_FARM_MAX_CHANNELS];
+
+/**
+ * @brief Number of active (registered) channels.
+ */
+static uint32_t s_activeCount = 0U;
+
+/**
+ * @brief Fault injection settings.
+ */
+static SensorFarmFaults_t s_faults = {0};
+
+/**
+ * @brief Counters.
+ */
+static SensorFarmStats_t s_stats = {0};
+
+/**
+ * @brief xorshift32 state for fault injection decisions.
+ */
+static uint32_t s_faultRng = 0x6D2B79F5U;
+
+/**
+ * @brief Copy a channel configuration into its registry entry and generator.
+ */
+static void SensorFarm_ApplyConfig(uint32_t index);
+
+/**
+ * @brief Whether a fault with probability @p permille fires now.
+ */
+static bool SensorFarm_Chance(uint32_t permille);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorFarm_Init(void)
+{
+    s_activeCount = 0U;
+    s_stats       = (SensorFarmStats_t){0};
+
+    for (uint32_t i = 0U; i < SENSOR_FARM_MAX_CHANNELS; ++i)
+    {
+        SimWaveShape_t shape = (SimWaveShape_t)(i % (uint32_t)SIM_WAVE_COUNT);
+
+        s_configs[i].wave.shape     = shape;
+        s_configs[i].wave.offset    = (int32_t)(i * 1000U);
+        s_configs[i].wave.amplitude = 5000;
+        s_configs[i].wave.period_ms = 2000U + (i * 250U);
+        s_configs[i].wave.noise     = (shape == SIM_WAVE_NOISE) ? 2000 : 100;
+        s_configs[i].period_ms      = SENSOR_FARM_BASE_PERIOD_MS * (1U + (i % 4U));
+
+        (void)Fmt_Format(s_names[i], sizeof(s_names[i]), "Farm%02lu", (unsigned long)i);
+
+        s_entries[i]       = (SensorEntry_t){0};
+        s_entries[i].id    = (uint8_t)(SENSOR_FARM_FIRST_ID + i);
+        s_entries[i].name  = s_names[i];
+        s_entries[i].iface = &s_channelIF[i];
+
+        SensorFarm_ApplyConfig(i);
+    }
+}
+
+uint32_t SensorFarm_SetCount(uint32_t count)
+{
+    if (count > SENSOR_FARM_MAX_CHANNELS)
+    {
+        count = SENSOR_FARM_MAX_CHANNELS;
+    }
+
+    while (s_activeCount > count)
+    {
+        s_activeCount--;
+        (void)SensorRegistry_Unregister(s_entries[s_activeCount].id);
+    }
+
+    while (s_activeCount < count)
+    {
+        uint32_t index = s_activeCount;
+
+        s_start_ms[index] = HAL_GetTick();
+        if (SensorRegistry_Register(&s_entries[index]) != 0)
+        {
+            break;
+        }
+        s_activeCount++;
+    }
+
+    LOG_INFO("SensorFarm: %lu channel(s) active", (unsigned long)s_activeCount);
+    return s_activeCount;
+}
+
+uint32_t SensorFarm_GetCount(void)
+{
+    return s_activeCount;
+}
+
+bool SensorFarm_ConfigureChannel(uint32_t index, const SensorFarmChannelConfig_t *config)
+{
+    if ((index >= SENSOR_FARM_MAX_CHANNELS) || (config == NULL) ||
+        (config->wave.shape >= SIM_WAVE_COUNT))
+    {
+        return false;
+    }
+
+    s_configs[index] = *config;
+    SensorFarm_ApplyConfig(index);
+    return true;
+}
+
+bool SensorFarm_GetChannelConfig(uint32_t index, SensorFarmChannelConfig_t *config)
+{
+    if ((index >= SENSOR_FARM_MAX_CHANNELS) || (config == NULL))
+    {
+        return false;
+    }
+
+    *config = s_configs[index];
+    return true;
+}
+
+void SensorFarm_SetFaults(const SensorFarmFaults_t *faults)
+{
+    if (faults == NULL)
+    {
+        return;
+    }
+
+    s_faults = *faults;
+    if (s_faults.failPermille > 1000U)
+    {
+        s_faults.failPermille = 1000U;
+    }
+    if (s_faults.spikePermille > 1000U)
+    {
+        s_faults.spikePermille = 1000U;
+    }
+}
+
+void SensorFarm_GetFaults(SensorFarmFaults_t *faults)
+{
+    if (faults != NULL)
+    {
+        *faults = s_faults;
+    }
+}
+
+void SensorFarm_GetStats(SensorFarmStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats = s_stats;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SensorFarm_ReadChannel(uint32_t index, SensorData_t *outData)
+{
+    if (outData == NULL)
+    {
+        return false;
+    }
+
+    s_stats.reads++;
+
+    if (SensorFarm_Chance(s_faults.spikePermille))
+    {
+        /* Models a bus that stalls (clock stretching, arbitration loss). */
+        uint64_t start = Time_NowUs();
+
+        while ((Time_NowUs() - start) < s_faults.spike_us)
+        {
+        }
+        s_stats.injectedSpikes++;
+    }
+
+    if (SensorFarm_Chance(s_faults.failPermille))
+    {
+        s_stats.injectedFails++;
+        return false;
+    }
+
+    uint32_t now_ms = HAL_GetTick();
+
+    /* The waveform is in milli-units already: stored as is. */
+    SensorData_Init(outData, SENSOR_FORMAT_S32, 1U, -3);
+    SensorData_SetRaw(outData, 0U, SimWave_Sample(&s_waves[index], now_ms - s_start_ms[index]));
+    outData->timestamp    = now_ms;
+    outData->timestamp_us = Time_NowUs32();
+
+    return true;
+}
+
+static void SensorFarm_ApplyConfig(uint32_t index)
+{
+    const SensorFarmChannelConfig_t *cfg   = &s_configs[index];
+    SensorEntry_t                   *entry = &s_entries[index];
+
+    SimWave_Init(&s_waves[index], &cfg->wave, 0x9E3779B9U * (index + 1U));
+
+    entry->period_ms[POWER_MODE_ACTIVE] = cfg->period_ms;
+    entry->period_ms[POWER_MODE_IDLE]   = cfg->period_ms * SENSOR_FARM_IDLE_FACTOR;
+    entry->period_ms[POWER_MODE_SLEEP]  = 0U;
+    entry->period_ms[POWER_MODE_STOP]   = 0U;
+}
+
+static bool SensorFarm_Chance(uint32_t permille)
+{
+    if (permille == 0U)
+    {
+        return false;
+    }
+
+    return (SimWave_Random(&s_faultRng) % 1000U) < permille;
+}
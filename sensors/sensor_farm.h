@@ -0,0 +1,158 @@
+/**
+ * @file sensor_farm.h
+ * @brief Synthetic sensor farm for scheduler and pipeline load testing.
+ *
+ * Provides up to @ref SENSOR_FARM_MAX_CHANNELS virtual sensors, each with
+ * its own waveform (see sim_wave.h), sampling period and fault injection.
+ * Active channels are ordinary @ref SensorIF_t sensors in the sensor
+ * registry, so they exercise exactly the same path as real drivers. The
+ * number of active channels can be changed at runtime (`farm <n>` CLI
+ * command).
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_FARM_H
+#define SENSOR_FARM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sim_wave.h"
+
+/**
+ * @defgroup sensor_farm Sensor Farm
+ * @brief Runtime-scalable set of simulated sensors.
+ * @ingroup sensors
+ * @{
+ */
+
+/**
+ * @brief Number of farm channels (fixed by the per-channel read thunks).
+ */
+#define SENSOR_FARM_MAX_CHANNELS   (24U)
+
+/**
+ * @brief Registry ID of channel 0; channel n uses FIRST_ID + n.
+ */
+#define SENSOR_FARM_FIRST_ID       (100U)
+
+/**
+ * @brief Per-channel configuration.
+ */
+typedef struct
+{
+    SimWaveConfig_t wave;      /**< Signal shape and parameters (milli-units). */
+    uint32_t        period_ms; /**< Sampling period in ACTIVE (x4 in IDLE,
+                                    disabled in SLEEP and STOP).              */
+} SensorFarmChannelConfig_t;
+
+/**
+ * @brief Fault injection settings, shared by all channels.
+ */
+typedef struct
+{
+    uint32_t failPermille;  /**< Chance (per 1000 reads) that read() fails.   */
+    uint32_t spikePermille; /**< Chance (per 1000 reads) of a latency spike.  */
+    uint32_t spike_us;      /**< Busy-wait length of a latency spike.         */
+} SensorFarmFaults_t;
+
+/**
+ * @brief Farm counters.
+ */
+typedef struct
+{
+    uint32_t reads;          /**< read() calls on farm channels.     */
+    uint32_t injectedFails;  /**< Reads failed on purpose.           */
+    uint32_t injectedSpikes; /**< Latency spikes inserted.           */
+} SensorFarmStats_t;
+
+/**
+ * @brief Load the default configuration for every channel.
+ *
+ * No channel is registered; call SensorFarm_SetCount() afterwards.
+ * Requires SensorRegistry_Init() to have run.
+ *
+ * @return None.
+ */
+void SensorFarm_Init(void);
+
+/**
+ * @brief Change the number of active channels.
+ *
+ * Channels 0..count-1 are registered (in order) and the rest are removed
+ * from the registry. A newly activated channel restarts its waveform.
+ *
+ * @param count Requested number of channels.
+ *
+ * @return Number of channels active afterwards (less than @p count if it
+ *         exceeds SENSOR_FARM_MAX_CHANNELS or the registry is full).
+ */
+uint32_t SensorFarm_SetCount(uint32_t count);
+
+/**
+ * @brief Number of active channels.
+ *
+ * @return Active channel count.
+ */
+uint32_t SensorFarm_GetCount(void);
+
+/**
+ * @brief Replace the configuration of one channel.
+ *
+ * Takes effect immediately, also for an active channel.
+ *
+ * @param index  Channel index.
+ * @param config New configuration.
+ *
+ * @return false if @p index or @p config is invalid.
+ */
+bool SensorFarm_ConfigureChannel(uint32_t index, const SensorFarmChannelConfig_t *config);
+
+/**
+ * @brief Read the configuration of one channel.
+ *
+ * @param index       Channel index.
+ * @param[out] config Receives the configuration.
+ *
+ * @return false if @p index is invalid.
+ */
+bool SensorFarm_GetChannelConfig(uint32_t index, SensorFarmChannelConfig_t *config);
+
+/**
+ * @brief Set the fault injection rates.
+ *
+ * @param faults New settings (permille values are clamped to 1000).
+ *
+ * @return None.
+ */
+void SensorFarm_SetFaults(const SensorFarmFaults_t *faults);
+
+/**
+ * @brief Read the fault injection rates.
+ *
+ * @param[out] faults Receives the settings.
+ *
+ * @return None.
+ */
+void SensorFarm_GetFaults(SensorFarmFaults_t *faults);
+
+/**
+ * @brief Snapshot the farm counters.
+ *
+ * @param[out] stats Receives the counters.
+ *
+ * @return None.
+ */
+void SensorFarm_GetStats(SensorFarmStats_t *stats);
+
+/** @} */ /* end of sensor_farm group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_FARM_H */
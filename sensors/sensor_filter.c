@@ -0,0 +1,344 @@
+/**
+ * @file sensor_filter.c
+ * @brief Streaming median / moving-average / IIR filter implementation.
+ *
+ * State lives in a small fixed table of slots keyed by sensor ID. The
+ * moving average keeps a running float sum; to stop rounding errors from
+ * accumulating the sum is recomputed from the window each time the write
+ * index wraps, which keeps the cost O(1) amortized.
+ *
+ * ProcessSamples() moves ring samples through a @ref SampleBlock_t, so
+ * the stages see channel 0 of a run as one contiguous array. int16 blocks
+ * without a median stage are filtered in raw units by the q15 kernels
+ * (dsp_kernels.c); everything else is converted to float and back.
+ *
+ * CMSIS-DSP is not part of this tree; the float stages are plain C and
+ * the q15 kernels use the M4 DSP instructions directly.
+ *
+ * @ingroup sensor_filter
+ */
+
+#include "sensor_filter.h"
+#include "sample_block.h"
+#include "dsp_kernels.h"
+#include <string.h>
+
+_Static_assert(SENSOR_FILTER_AVERAGE_MAX <= DSP_AVERAGE_MAX, "q15 average window too small");
+
+/**
+ * @brief Filter configuration and history of one sensor.
+ */
+typedef struct
+{
+    bool                 used;                               /**< Slot in use.              */
+    uint8_t              sensorId;                           /**< Owner.                    */
+    SensorFilterConfig_t config;                             /**< Chain.                    */
+    float                median[SENSOR_FILTER_MEDIAN_MAX];   /**< Median history (ring).    */
+    uint8_t              medianCount;                        /**< Valid median entries.     */
+    uint8_t              medianPos;                          /**< Next median write index.  */
+    float                average[SENSOR_FILTER_AVERAGE_MAX]; /**< Average history (ring).   */
+    float                averageSum;                         /**< Running sum of history.   */
+    uint8_t              averageCount;                       /**< Valid average entries.    */
+    uint8_t              averagePos;                         /**< Next average write index. */
+    float                iirState;                           /**< IIR output.               */
+    bool                 iirPrimed;                          /**< IIR seeded with a sample. */
+    DspAverageQ15_t      averageQ15;                         /**< Fixed-point average.      */
+    DspLowpassQ15_t      iirQ15;                             /**< Fixed-point IIR.          */
+} SensorFilterSlot_t;
+
+/**
+ * @brief Filter slots.
+ */
+static SensorFilterSlot_t s_slots[SENSOR_FILTER_MAX_SENSORS];
+
+/**
+ * @brief Block being filtered by ProcessSamples() (static: too big for
+ *        the main loop stack to carry for every caller).
+ */
+static SampleBlock_t s_block;
+
+/**
+ * @brief Find the slot of @p sensorId, or NULL.
+ */
+static SensorFilterSlot_t *SensorFilter_Find(uint8_t sensorId);
+
+/**
+ * @brief Median stage.
+ */
+static float SensorFilter_Median(SensorFilterSlot_t *slot, float x);
+
+/**
+ * @brief Moving-average stage.
+ */
+static float SensorFilter_Average(SensorFilterSlot_t *slot, float x);
+
+/**
+ * @brief Average and IIR stages on channel 0 of an int16 block, in raw
+ *        units with the q15 kernels.
+ */
+static void SensorFilter_ProcessFixed(SensorFilterSlot_t *slot, SampleBlock_t *block);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorFilter_Init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+}
+
+bool SensorFilter_Configure(uint8_t sensorId, const SensorFilterConfig_t *config)
+{
+    if ((config == NULL) ||
+        (config->medianWindow > SENSOR_FILTER_MEDIAN_MAX) ||
+        ((config->medianWindow > 1U) && ((config->medianWindow % 2U) == 0U)) ||
+        (config->averageWindow > SENSOR_FILTER_AVERAGE_MAX) ||
+        (config->iirAlpha < 0.0f) || (config->iirAlpha >= 1.0f))
+    {
+        return false;
+    }
+
+    SensorFilterSlot_t *slot = SensorFilter_Find(sensorId);
+    bool enabled = (config->medianWindow > 1U) || (config->averageWindow > 1U) ||
+                   (config->iirAlpha > 0.0f);
+
+    if (!enabled)
+    {
+        if (slot != NULL)
+        {
+            slot->used = false;
+        }
+        return true;
+    }
+
+    if (slot == NULL)
+    {
+        for (uint32_t i = 0U; i < SENSOR_FILTER_MAX_SENSORS; ++i)
+        {
+            if (!s_slots[i].used)
+            {
+                slot = &s_slots[i];
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->used     = true;
+    slot->sensorId = sensorId;
+    slot->config   = *config;
+    Dsp_AverageInitQ15(&slot->averageQ15, config->averageWindow);
+    if (config->iirAlpha > 0.0f)
+    {
+        Dsp_LowpassInitQ15(&slot->iirQ15, config->iirAlpha);
+    }
+
+    return true;
+}
+
+bool SensorFilter_GetConfig(uint8_t sensorId, SensorFilterConfig_t *config)
+{
+    const SensorFilterSlot_t *slot = SensorFilter_Find(sensorId);
+
+    if (config != NULL)
+    {
+        if (slot != NULL)
+        {
+            *config = slot->config;
+        }
+        else
+        {
+            memset(config, 0, sizeof(*config));
+        }
+    }
+
+    return (slot != NULL);
+}
+
+void SensorFilter_ProcessBlock(uint8_t sensorId, float *values, size_t count)
+{
+    SensorFilterSlot_t *slot = SensorFilter_Find(sensorId);
+    if ((slot == NULL) || (values == NULL) || (count == 0U))
+    {
+        return;
+    }
+
+    const SensorFilterConfig_t *cfg = &slot->config;
+
+    if (cfg->medianWindow > 1U)
+    {
+        for (size_t i = 0U; i < count; ++i)
+        {
+            values[i] = SensorFilter_Median(slot, values[i]);
+        }
+    }
+
+    if (cfg->averageWindow > 1U)
+    {
+        for (size_t i = 0U; i < count; ++i)
+        {
+            values[i] = SensorFilter_Average(slot, values[i]);
+        }
+    }
+
+    if (cfg->iirAlpha > 0.0f)
+    {
+        float y     = slot->iirPrimed ? slot->iirState : values[0];
+        float alpha = cfg->iirAlpha;
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            y += alpha * (values[i] - y);
+            values[i] = y;
+        }
+
+        slot->iirState  = y;
+        slot->iirPrimed = true;
+    }
+}
+
+void SensorFilter_ProcessSamples(SensorSample_t *samples, size_t count)
+{
+    if (samples == NULL)
+    {
+        return;
+    }
+
+    float  values[SAMPLE_BLOCK_MAX];
+    size_t start = 0U;
+
+    while (start < count)
+    {
+        size_t              n    = SampleBlock_Gather(&s_block, &samples[start], count - start);
+        SensorFilterSlot_t *slot = SensorFilter_Find(s_block.sensorId);
+
+        if (slot == NULL)
+        {
+            start += n;
+            continue;
+        }
+
+        if (SampleBlock_IsS16(&s_block) && (slot->config.medianWindow <= 1U))
+        {
+            SensorFilter_ProcessFixed(slot, &s_block);
+        }
+        else
+        {
+            SampleBlock_ToFloat(&s_block, 0U, values);
+            SensorFilter_ProcessBlock(s_block.sensorId, values, n);
+            SampleBlock_FromFloat(&s_block, 0U, values);
+        }
+        SampleBlock_Scatter(&s_block, &samples[start]);
+
+        start += n;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorFilterSlot_t *SensorFilter_Find(uint8_t sensorId)
+{
+    for (uint32_t i = 0U; i < SENSOR_FILTER_MAX_SENSORS; ++i)
+    {
+        if (s_slots[i].used && (s_slots[i].sensorId == sensorId))
+        {
+            return &s_slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+static float SensorFilter_Median(SensorFilterSlot_t *slot, float x)
+{
+    uint8_t window = slot->config.medianWindow;
+
+    slot->median[slot->medianPos] = x;
+    slot->medianPos = (uint8_t)((slot->medianPos + 1U) % window);
+    if (slot->medianCount < window)
+    {
+        slot->medianCount++;
+    }
+
+    /* Insertion sort of a copy; the window is at most 7 entries. */
+    float   sorted[SENSOR_FILTER_MEDIAN_MAX];
+    uint8_t n = slot->medianCount;
+
+    for (uint8_t i = 0U; i < n; ++i)
+    {
+        float   v = slot->median[i];
+        uint8_t j = i;
+
+        while ((j > 0U) && (sorted[j - 1U] > v))
+        {
+            sorted[j] = sorted[j - 1U];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[n / 2U];
+}
+
+static float SensorFilter_Average(SensorFilterSlot_t *slot, float x)
+{
+    uint8_t window = slot->config.averageWindow;
+
+    if (slot->averageCount < window)
+    {
+        slot->averageCount++;
+    }
+    else
+    {
+        slot->averageSum -= slot->average[slot->averagePos];
+    }
+
+    slot->average[slot->averagePos] = x;
+    slot->averageSum += x;
+    slot->averagePos  = (uint8_t)((slot->averagePos + 1U) % window);
+
+    if (slot->averagePos == 0U)
+    {
+        /* Re-anchor the running sum once per window to cancel drift. */
+        float sum = 0.0f;
+        for (uint8_t i = 0U; i < slot->averageCount; ++i)
+        {
+            sum += slot->average[i];
+        }
+        slot->averageSum = sum;
+    }
+
+    return slot->averageSum / (float)slot->averageCount;
+}
+
+static void SensorFilter_ProcessFixed(SensorFilterSlot_t *slot, SampleBlock_t *block)
+{
+    int16_t *row = block->raw.s16[0];
+    int16_t  out[SAMPLE_BLOCK_MAX];
+
+    memcpy(out, row, block->count * sizeof(out[0]));
+
+    if (slot->config.averageWindow > 1U)
+    {
+        Dsp_AverageQ15(&slot->averageQ15, out, out, block->count);
+    }
+
+    if (slot->config.iirAlpha > 0.0f)
+    {
+        Dsp_LowpassQ15(&slot->iirQ15, out, out, block->count);
+    }
+
+    for (uint32_t n = 0U; n < block->count; ++n)
+    {
+        if (out[n] != row[n])
+        {
+            block->quality[n] |= SENSOR_QUALITY_FILTERED;
+            row[n] = out[n];
+        }
+    }
+}
@@ -0,0 +1,124 @@
+/**
+ * @file sensor_filter.h
+ * @brief Per-sensor streaming filter stage for the sample pipeline.
+ *
+ * Sits between the sample ring and the consumers. Every sensor can have
+ * up to three stages, always applied in this order:
+ * 1. Median filter (spike rejection), odd window up to
+ *    @ref SENSOR_FILTER_MEDIAN_MAX.
+ * 2. Moving average with an O(1) running sum, window up to
+ *    @ref SENSOR_FILTER_AVERAGE_MAX.
+ * 3. First-order IIR low-pass, y += alpha * (x - y).
+ *
+ * Filters work on blocks: a run of samples from one sensor is processed
+ * in a single call. Sensors without a configuration pass through. Ring
+ * samples are filtered on their first channel, in engineering units.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+
+/**
+ * @defgroup sensor_filter Sensor Filters
+ * @brief Median / moving-average / IIR filtering of sensor samples.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of sensors that can have a filter configuration. */
+#define SENSOR_FILTER_MAX_SENSORS   (8U)
+
+/** @brief Largest median window (odd). */
+#define SENSOR_FILTER_MEDIAN_MAX    (7U)
+
+/** @brief Largest moving-average window. */
+#define SENSOR_FILTER_AVERAGE_MAX   (16U)
+
+/**
+ * @brief Filter chain of one sensor. A zero field disables that stage.
+ */
+typedef struct
+{
+    uint8_t medianWindow;  /**< 0/1 = off, otherwise odd, <= MEDIAN_MAX.  */
+    uint8_t averageWindow; /**< 0/1 = off, otherwise <= AVERAGE_MAX.      */
+    float   iirAlpha;      /**< 0 = off, otherwise in (0, 1).             */
+} SensorFilterConfig_t;
+
+/**
+ * @brief Remove all filter configurations.
+ *
+ * @return None.
+ */
+void SensorFilter_Init(void);
+
+/**
+ * @brief Set (or replace) the filter chain of a sensor.
+ *
+ * The filter history is cleared. A configuration with every stage off
+ * removes the sensor's entry.
+ *
+ * @param sensorId Registry ID.
+ * @param config   Filter chain.
+ *
+ * @return false if @p config is invalid or no slot is free.
+ */
+bool SensorFilter_Configure(uint8_t sensorId, const SensorFilterConfig_t *config);
+
+/**
+ * @brief Get the filter chain of a sensor.
+ *
+ * @param sensorId    Registry ID.
+ * @param[out] config Receives the chain (all stages off if none).
+ *
+ * @return true if the sensor has a configuration.
+ */
+bool SensorFilter_GetConfig(uint8_t sensorId, SensorFilterConfig_t *config);
+
+/**
+ * @brief Filter a block of values from one sensor in place.
+ *
+ * @param sensorId Registry ID.
+ * @param values   Values, oldest first.
+ * @param count    Number of values.
+ *
+ * @return None.
+ */
+void SensorFilter_ProcessBlock(uint8_t sensorId, float *values, size_t count);
+
+/**
+ * @brief Filter a block of ring samples in place.
+ *
+ * Consecutive samples from the same sensor at a steady interval (e.g. one
+ * FIFO drain) are gathered into a @ref SampleBlock_t and channel 0 is
+ * handed to SensorFilter_ProcessBlock() as one run. int16 samples of a
+ * chain without median stage are filtered in raw units by fixed-point
+ * kernels instead, with their own history (a sensor's samples always take
+ * the same path). The result is stored
+ * back at the sample's scale, and a sample whose channel 0 changed gets
+ * @ref SENSOR_QUALITY_FILTERED.
+ *
+ * @param samples Samples, oldest first.
+ * @param count   Number of samples.
+ *
+ * @return None.
+ */
+void SensorFilter_ProcessSamples(SensorSample_t *samples, size_t count);
+
+/** @} */ /* end of sensor_filter group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_FILTER_H */
@@ -15,6 +15,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @defgroup sensors Sensor Abstraction
@@ -24,18 +25,159 @@
  */
 
 /**
- * @brief Structured sensor measurement data.
+ * @brief Most channels one measurement carries (e.g. the three axes of an
+ *        accelerometer).
+ */
+#ifndef SENSOR_MAX_CHANNELS
+#define SENSOR_MAX_CHANNELS   (3U)
+#endif
+
+/** @name Layout byte of SensorData_t
+ * @{
+ */
+#define SENSOR_LAYOUT_CHANNELS_MASK  (0x0FU) /**< Channel count (1 to SENSOR_MAX_CHANNELS). */
+#define SENSOR_LAYOUT_S32            (0x10U) /**< Channels are int32 (else int16).          */
+/** @} */
+
+/** @name Quality bits of SensorData_t
+ * @{
+ */
+#define SENSOR_QUALITY_CLIPPED   (0x01U) /**< A channel is at the end of its range.          */
+#define SENSOR_QUALITY_GAP       (0x02U) /**< Samples before this one were lost (overflow).  */
+#define SENSOR_QUALITY_FILTERED  (0x04U) /**< Changed by the filter stage.                   */
+#define SENSOR_QUALITY_STALE     (0x08U) /**< Not a new measurement (held or repeated).      */
+#define SENSOR_QUALITY_CALIBRATED (0x10U) /**< Corrected by the calibration stage.          */
+/** @} */
+
+/**
+ * @brief Channel storage type.
+ */
+typedef enum
+{
+    SENSOR_FORMAT_S16 = 0U, /**< int16 channels. */
+    SENSOR_FORMAT_S32       /**< int32 channels. */
+} SensorFormat_t;
+
+/**
+ * @brief One measurement: up to @ref SENSOR_MAX_CHANNELS integer channels
+ *        with a decimal scale, quality bits and the sensor it came from.
  *
- * For Phase 2, this represents a single scalar value (e.g. temperature).
- * Future phases may extend this with additional fields such as status
- * flags, error codes, or multi-dimensional measurements.
+ * A channel's value in engineering units is raw * 10^scaleExp; every
+ * sample of a sensor uses the same format and scale (e.g. int16 at
+ * 10^-2 for a temperature in 0.01 degC). A multi-axis sensor delivers
+ * all axes in one sample. The layout is 24 bytes without padding, so the
+ * sample ring stores samples as they are (SensorSample_t) and the
+ * telemetry encoder copies the used channels only.
+ *
+ * Drivers fill a sample with SensorData_Init() and SensorData_SetRaw()
+ * or SensorData_SetFloat(); float consumers read it back with
+ * SensorData_GetFloat(). sensorId is set by the sensor registry.
  */
 typedef struct
 {
-    float    value;     /**< Sensor reading (e.g. temperature in °C). */
-    uint32_t timestamp; /**< Timestamp in milliseconds (HAL_GetTick). */
+    uint8_t  sensorId;     /**< Registry ID of the source sensor.            */
+    uint8_t  layout;       /**< Channel count | @ref SENSOR_LAYOUT_S32.        */
+    uint8_t  quality;      /**< SENSOR_QUALITY_* bits.                       */
+    int8_t   scaleExp;     /**< Decimal exponent: value = raw * 10^scaleExp.  */
+    uint32_t timestamp;    /**< Timestamp in milliseconds (HAL_GetTick).     */
+    uint32_t timestamp_us; /**< Same instant in us (Time_NowUs32()).         */
+    union
+    {
+        int16_t s16[SENSOR_MAX_CHANNELS]; /**< SENSOR_FORMAT_S16 channels. */
+        int32_t s32[SENSOR_MAX_CHANNELS]; /**< SENSOR_FORMAT_S32 channels. */
+    } raw;                 /**< Channel values, in units of 10^scaleExp.     */
 } SensorData_t;
 
+/**
+ * @brief Number of channels in @p data.
+ */
+static inline uint32_t SensorData_GetChannels(const SensorData_t *data)
+{
+    return (uint32_t)data->layout & SENSOR_LAYOUT_CHANNELS_MASK;
+}
+
+/**
+ * @brief Storage type of @p data's channels.
+ */
+static inline SensorFormat_t SensorData_GetFormat(const SensorData_t *data)
+{
+    return ((data->layout & SENSOR_LAYOUT_S32) != 0U) ? SENSOR_FORMAT_S32 : SENSOR_FORMAT_S16;
+}
+
+/**
+ * @brief Raw value of @p channel (0 if out of range).
+ */
+static inline int32_t SensorData_GetRaw(const SensorData_t *data, uint32_t channel)
+{
+    if (channel >= SensorData_GetChannels(data))
+    {
+        return 0;
+    }
+
+    return ((data->layout & SENSOR_LAYOUT_S32) != 0U) ? data->raw.s32[channel]
+                                                     : (int32_t)data->raw.s16[channel];
+}
+
+/**
+ * @brief Clear a sample and set its layout and scale.
+ *
+ * Timestamps, quality and channels are zeroed; sensorId is left for the
+ * registry.
+ *
+ * @param[out] data     Sample to prepare.
+ * @param      format   Channel storage type.
+ * @param      channels Channel count, 1 to @ref SENSOR_MAX_CHANNELS
+ *                      (clamped).
+ * @param      scaleExp Decimal exponent of the raw values, -9 to 9.
+ *
+ * @return None.
+ */
+void SensorData_Init(SensorData_t *data, SensorFormat_t format, uint32_t channels, int8_t scaleExp);
+
+/**
+ * @brief Store a raw value, saturating int16 channels.
+ *
+ * A saturated value sets @ref SENSOR_QUALITY_CLIPPED.
+ *
+ * @param data    Sample.
+ * @param channel Channel index (ignored if out of range).
+ * @param raw     Value in units of 10^scaleExp.
+ *
+ * @return None.
+ */
+void SensorData_SetRaw(SensorData_t *data, uint32_t channel, int32_t raw);
+
+/**
+ * @brief Store a value in engineering units, rounded to the sample's
+ *        scale and saturated like SensorData_SetRaw().
+ *
+ * @param data    Sample.
+ * @param channel Channel index (ignored if out of range).
+ * @param value   Value (NaN saturates).
+ *
+ * @return None.
+ */
+void SensorData_SetFloat(SensorData_t *data, uint32_t channel, float value);
+
+/**
+ * @brief Value of @p channel in engineering units.
+ *
+ * @param data    Sample.
+ * @param channel Channel index.
+ *
+ * @return raw * 10^scaleExp, or 0 if @p channel is out of range.
+ */
+float SensorData_GetFloat(const SensorData_t *data, uint32_t channel);
+
+/**
+ * @brief Power of ten for scale conversions.
+ *
+ * @param exp Exponent, clamped to -9..9.
+ *
+ * @return 10^exp.
+ */
+float SensorData_Pow10(int32_t exp);
+
 /**
  * @brief Function pointer type for sensor initialization.
  *
@@ -52,25 +194,81 @@ typedef bool (*SensorInitFn_t)(void);
  */
 typedef bool (*SensorReadFn_t)(SensorData_t *outData);
 
+/**
+ * @brief Result of polling an asynchronous read.
+ */
+typedef enum
+{
+    SENSOR_READ_BUSY = 0U, /**< Transfer/conversion still in progress.  */
+    SENSOR_READ_DONE,      /**< Measurement delivered to the caller.    */
+    SENSOR_READ_ERROR      /**< Transfer failed; no measurement.        */
+} SensorReadStatus_t;
+
+/**
+ * @brief Function pointer type for starting an asynchronous read.
+ *
+ * Starts the bus transfer or conversion (typically interrupt- or
+ * DMA-driven) and returns immediately.
+ *
+ * @return true if the read was started, false otherwise.
+ */
+typedef bool (*SensorStartReadFn_t)(void);
+
+/**
+ * @brief Function pointer type for completing an asynchronous read.
+ *
+ * Called repeatedly after a successful start until it returns something
+ * other than @ref SENSOR_READ_BUSY. Must not block.
+ *
+ * @param[out] outData Filled with the measurement when
+ *                     @ref SENSOR_READ_DONE is returned.
+ * @return Current state of the read.
+ */
+typedef SensorReadStatus_t (*SensorPollReadFn_t)(SensorData_t *outData);
+
+/**
+ * @brief Function pointer type for draining a sensor's hardware FIFO.
+ *
+ * Copies up to @p max buffered measurements, oldest first, each with the
+ * timestamp at which it was taken. Must not block.
+ *
+ * @param[out] out Array of at least @p max entries.
+ * @param      max Capacity of @p out.
+ * @return Number of measurements written (0 if the FIFO is empty).
+ */
+typedef size_t (*SensorReadBatchFn_t)(SensorData_t *out, size_t max);
+
 /**
  * @brief Sensor interface API (function pointers).
  *
  * Any specific sensor implementation (simulated or hardware-backed)
  * must provide an instance of this structure so that the application
  * can invoke the sensor in a generic way.
+ *
+ * A driver provides the blocking @c read, the non-blocking
+ * @c startRead / @c pollRead pair, or both. When the pair is present the
+ * sensor registry uses it, so the cooperative loop keeps running while a
+ * bus transaction is in flight.
+ *
+ * Sensors with an on-chip FIFO also provide @c readBatch. The registry
+ * then drains the FIFO on every service instead of reading one sample, so
+ * the sensor's registry period becomes the FIFO watermark interval.
  */
 typedef struct
 {
-    SensorInitFn_t init; /**< Initialize the sensor module. */
-    SensorReadFn_t read; /**< Read a single measurement.    */
+    SensorInitFn_t      init;      /**< Initialize the sensor module.                 */
+    SensorReadFn_t      read;      /**< Read a single measurement (blocking).         */
+    SensorStartReadFn_t startRead; /**< Optional: start a non-blocking read.          */
+    SensorPollReadFn_t  pollRead;  /**< Optional: complete a non-blocking read.       */
+    SensorReadBatchFn_t readBatch; /**< Optional: drain buffered (FIFO) samples.      */
 } SensorIF_t;
 
 /**
  * @brief Obtain the currently active sensor interface.
  *
- * In Phase 2, this returns a handle to the simulated temperature
- * sensor implementation. Later phases may route this to real I2C/SPI
- * sensor drivers or select between multiple sensors at runtime.
+ * Returns the simulated temperature sensor implementation. Applications
+ * with several sensors register each interface with the sensor registry
+ * (see sensor_registry.h) instead of calling drivers directly.
  *
  * @return Pointer to a constant SensorIF_t interface instance.
  */
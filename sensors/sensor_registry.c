@@ -0,0 +1,694 @@
+/**
+ * @file sensor_registry.c
+ * @brief Sensor registry implementation.
+ *
+ * The registry holds pointers to caller-owned entries in registration
+ * order. On each service pass the due sensors are collected, sorted by
+ * deadline (insertion sort; the list is short) and read in that order.
+ * Deadlines use wrap-safe signed tick differences.
+ *
+ * Asynchronous drivers: a due sensor is started and marked pending; the
+ * following passes poll it until it completes, fails or times out. A
+ * pending sensor is not started again until it resolves.
+ *
+ * FIFO drivers take precedence over both read styles: a due sensor with
+ * readBatch() is drained in chunks of SENSOR_REGISTRY_BATCH_MAX.
+ *
+ * Retries and quarantine only change the interval a deadline is taken
+ * from: @c retry_ms stands in for the period while it is set, and every
+ * read style (service, direct, asynchronous) finds the sensor due through
+ * the same SensorRegistry_Deadline().
+ *
+ * Each read is bracketed by TRACE_SENSOR_START/DONE (trace.h); for an
+ * asynchronous driver the span runs from startRead() until the poll that
+ * resolves it.
+ *
+ * @ingroup sensor_registry
+ */
+
+#include "sensor_registry.h"
+#include "app_task_manager.h"
+#include "stm32f4xx_hal.h"
+#include "log.h"
+#include "trace.h"
+#include "metrics.h"
+
+/**
+ * @brief Registered sensors, in registration order.
+ */
+static SensorEntry_t *s_sensors[SENSOR_REGISTRY_MAX_SENSORS] = {0};
+
+/**
+ * @brief Number of registered sensors.
+ */
+static uint32_t s_sensorCount = 0U;
+
+/**
+ * @brief Called when a deadline may have moved earlier.
+ */
+static SensorScheduleHook_t s_scheduleHook = NULL;
+
+/** @brief Reads retried ahead of or after the period (metrics). */
+static uint32_t s_retries = 0U;
+
+/** @brief Sensors put in quarantine (metrics). */
+static uint32_t s_quarantines = 0U;
+
+/**
+ * @brief Interval from the last read attempt to the next one in @p mode.
+ */
+static inline uint32_t SensorRegistry_Interval(const SensorEntry_t *entry, PowerMode_t mode)
+{
+    return (entry->retry_ms != 0U) ? entry->retry_ms : entry->period_ms[mode];
+}
+
+/**
+ * @brief Absolute tick at which @p entry is next due in @p mode.
+ */
+static inline uint32_t SensorRegistry_Deadline(const SensorEntry_t *entry, PowerMode_t mode)
+{
+    return entry->lastSample_ms + SensorRegistry_Interval(entry, mode);
+}
+
+/**
+ * @brief Wrap-safe "a is earlier than b" for tick values.
+ */
+static inline bool SensorRegistry_IsBefore(uint32_t a, uint32_t b)
+{
+    return ((int32_t)(a - b) < 0);
+}
+
+/**
+ * @brief Whether @p entry takes part in scheduling in @p mode.
+ */
+static inline bool SensorRegistry_IsActive(const SensorEntry_t *entry, PowerMode_t mode)
+{
+    return entry->ready && !entry->synced && (entry->period_ms[mode] > 0U);
+}
+
+/**
+ * @brief Move the deadline of a due sensor past @p now_ms.
+ *
+ * The next deadline follows this one, not the (late) service time, so the
+ * sampling phase does not drift. Deadlines missed entirely are skipped
+ * rather than sampled back-to-back.
+ */
+static inline void SensorRegistry_Advance(SensorEntry_t *entry, PowerMode_t mode, uint32_t now_ms)
+{
+    uint32_t period   = SensorRegistry_Interval(entry, mode);
+    uint32_t deadline = SensorRegistry_Deadline(entry, mode);
+
+    entry->lastSample_ms = deadline + (((now_ms - deadline) / period) * period);
+}
+
+/**
+ * @brief Tell the sampling task that a deadline may have moved earlier.
+ */
+static inline void SensorRegistry_NotifySchedule(void)
+{
+    if (s_scheduleHook != NULL)
+    {
+        s_scheduleHook();
+    }
+}
+
+/**
+ * @brief Whether the driver provides the non-blocking read pair.
+ */
+static inline bool SensorRegistry_IsAsync(const SensorEntry_t *entry)
+{
+    return (entry->iface->startRead != NULL) && (entry->iface->pollRead != NULL);
+}
+
+/**
+ * @brief Whether the driver implements at least one way of reading.
+ */
+static inline bool SensorRegistry_CanRead(const SensorIF_t *iface)
+{
+    return (iface->read != NULL) || (iface->readBatch != NULL) ||
+           ((iface->startRead != NULL) && (iface->pollRead != NULL));
+}
+
+/**
+ * @brief Gauge: sensors in quarantine now.
+ */
+static uint32_t SensorRegistry_CountQuarantined(void);
+
+/**
+ * @brief Registered entry with ID @p id, or NULL.
+ */
+static SensorEntry_t *SensorRegistry_Lookup(uint8_t id);
+
+/**
+ * @brief Record a successful reading and notify the consumer.
+ */
+static void SensorRegistry_Deliver(SensorEntry_t *entry, const SensorData_t *data,
+                                   SensorSampleCallback_t onSample);
+
+/**
+ * @brief Record a failed read.
+ */
+static void SensorRegistry_Fail(SensorEntry_t *entry, const char *reason);
+
+/**
+ * @brief Drain a FIFO sensor and deliver every sample.
+ */
+static void SensorRegistry_DrainBatch(SensorEntry_t *entry, SensorSampleCallback_t onSample);
+
+/**
+ * @brief Poll all pending asynchronous reads.
+ *
+ * @return Number of reads that completed or failed.
+ */
+static uint32_t SensorRegistry_PollPending(uint32_t now_ms, SensorSampleCallback_t onSample);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorRegistry_Init(void)
+{
+    for (uint32_t i = 0U; i < SENSOR_REGISTRY_MAX_SENSORS; ++i)
+    {
+        s_sensors[i] = NULL;
+    }
+    s_sensorCount = 0U;
+    s_retries     = 0U;
+    s_quarantines = 0U;
+
+    Metrics_Publish(METRIC_SENSOR_RETRIES, &s_retries);
+    Metrics_Publish(METRIC_SENSOR_QUARANTINES, &s_quarantines);
+    Metrics_PublishGauge(METRIC_SENSORS_QUARANTINED, SensorRegistry_CountQuarantined);
+}
+
+int SensorRegistry_Register(SensorEntry_t *entry)
+{
+    if ((entry == NULL) || (entry->iface == NULL) || !SensorRegistry_CanRead(entry->iface))
+    {
+        LOG_ERROR("SensorRegistry: invalid sensor entry");
+        return -1;
+    }
+
+    if (s_sensorCount >= SENSOR_REGISTRY_MAX_SENSORS)
+    {
+        LOG_WARN("SensorRegistry: full, cannot register '%s'", entry->name);
+        return -2;
+    }
+
+    if (SensorRegistry_Find(entry->id) != NULL)
+    {
+        LOG_ERROR("SensorRegistry: duplicate sensor ID %u ('%s')",
+                  (unsigned)entry->id, entry->name);
+        return -3;
+    }
+
+    entry->ready         = (entry->iface->init == NULL) || entry->iface->init();
+    entry->pending       = false;
+    entry->synced        = false;
+    entry->lastSample_ms = HAL_GetTick();
+    entry->readCount     = 0U;
+    entry->errorCount    = 0U;
+    entry->retry_ms      = 0U;
+    entry->health        = (uint16_t)SENSOR_REGISTRY_HEALTH_MAX;
+    entry->failStreak    = 0U;
+    entry->quarantined   = false;
+    entry->recoveries    = 0U;
+
+    /* The sync drain looks entries up from a preemption level. */
+    uint32_t key = AppTaskManager_Lock();
+    s_sensors[s_sensorCount] = entry;
+    s_sensorCount++;
+    AppTaskManager_Unlock(key);
+    TRACE_NAME(TRACE_NAME_SENSOR, entry->id, entry->name);
+
+    if (!entry->ready)
+    {
+        LOG_ERROR("SensorRegistry: '%s' (id %u) failed to initialize",
+                  entry->name, (unsigned)entry->id);
+        return -4;
+    }
+
+    LOG_INFO("SensorRegistry: registered '%s' (id %u)", entry->name, (unsigned)entry->id);
+    SensorRegistry_NotifySchedule();
+    return 0;
+}
+
+bool SensorRegistry_Unregister(uint8_t id)
+{
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        if (s_sensors[i]->id != id)
+        {
+            continue;
+        }
+
+        uint32_t key = AppTaskManager_Lock();
+        for (uint32_t j = i + 1U; j < s_sensorCount; ++j)
+        {
+            s_sensors[j - 1U] = s_sensors[j];
+        }
+
+        s_sensorCount--;
+        s_sensors[s_sensorCount] = NULL;
+        AppTaskManager_Unlock(key);
+        return true;
+    }
+
+    return false;
+}
+
+bool SensorRegistry_SetDueNow(uint8_t id, PowerMode_t mode, uint32_t now_ms)
+{
+    SensorEntry_t *entry = SensorRegistry_Lookup(id);
+
+    if ((entry == NULL) || (mode >= POWER_MODE_COUNT))
+    {
+        return false;
+    }
+
+    entry->lastSample_ms = now_ms - SensorRegistry_Interval(entry, mode);
+    SensorRegistry_NotifySchedule();
+    return true;
+}
+
+void SensorRegistry_ChangeMode(PowerMode_t from, PowerMode_t to, uint32_t now_ms)
+{
+    if ((from >= POWER_MODE_COUNT) || (to >= POWER_MODE_COUNT))
+    {
+        return;
+    }
+
+    bool moved = false;
+
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        SensorEntry_t *entry = s_sensors[i];
+        if (entry->period_ms[from] == entry->period_ms[to])
+        {
+            continue;
+        }
+
+        /* The last read of a sensor that was off is arbitrarily old; past
+         * half the tick range its deadline would compare as the future.
+         */
+        if (entry->period_ms[from] == 0U)
+        {
+            entry->lastSample_ms = now_ms - SensorRegistry_Interval(entry, to);
+        }
+        moved = true;
+    }
+
+    if (moved)
+    {
+        SensorRegistry_NotifySchedule();
+    }
+}
+
+void SensorRegistry_SetScheduleHook(SensorScheduleHook_t hook)
+{
+    s_scheduleHook = hook;
+}
+
+uint32_t SensorRegistry_Service(PowerMode_t mode, uint32_t now_ms, SensorSampleCallback_t onSample)
+{
+    if (mode >= POWER_MODE_COUNT)
+    {
+        return 0U;
+    }
+
+    uint32_t handled = SensorRegistry_PollPending(now_ms, onSample);
+
+    /* Collect due sensors, ordered by deadline. */
+    SensorEntry_t *due[SENSOR_REGISTRY_MAX_SENSORS];
+    uint32_t       dueCount = 0U;
+
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        SensorEntry_t *entry = s_sensors[i];
+        if (!SensorRegistry_IsActive(entry, mode) || entry->pending || entry->direct)
+        {
+            continue;
+        }
+
+        uint32_t deadline = SensorRegistry_Deadline(entry, mode);
+        if (SensorRegistry_IsBefore(now_ms, deadline))
+        {
+            continue;
+        }
+
+        uint32_t pos = dueCount;
+        while ((pos > 0U) &&
+               SensorRegistry_IsBefore(deadline, SensorRegistry_Deadline(due[pos - 1U], mode)))
+        {
+            due[pos] = due[pos - 1U];
+            pos--;
+        }
+        due[pos] = entry;
+        dueCount++;
+    }
+
+    for (uint32_t i = 0U; i < dueCount; ++i)
+    {
+        SensorEntry_t *entry = due[i];
+        SensorData_t   data;
+
+        SensorRegistry_Advance(entry, mode, now_ms);
+
+        TRACE_SENSOR_START(entry->id);
+
+        if (entry->iface->readBatch != NULL)
+        {
+            SensorRegistry_DrainBatch(entry, onSample);
+            TRACE_SENSOR_DONE(entry->id, true);
+        }
+        else if (SensorRegistry_IsAsync(entry))
+        {
+            if (entry->iface->startRead())
+            {
+                entry->pending         = true;
+                entry->pendingSince_ms = now_ms;
+            }
+            else
+            {
+                TRACE_SENSOR_DONE(entry->id, false);
+                SensorRegistry_Fail(entry, "start failed");
+            }
+        }
+        else if (entry->iface->read(&data))
+        {
+            TRACE_SENSOR_DONE(entry->id, true);
+            SensorRegistry_Deliver(entry, &data, onSample);
+        }
+        else
+        {
+            TRACE_SENSOR_DONE(entry->id, false);
+            SensorRegistry_Fail(entry, "read failed");
+        }
+    }
+
+    return handled + dueCount;
+}
+
+bool SensorRegistry_TakeDue(SensorEntry_t *entry, PowerMode_t mode, uint32_t now_ms)
+{
+    if ((mode >= POWER_MODE_COUNT) || !SensorRegistry_IsActive(entry, mode) || entry->pending ||
+        SensorRegistry_IsBefore(now_ms, SensorRegistry_Deadline(entry, mode)))
+    {
+        return false;
+    }
+
+    SensorRegistry_Advance(entry, mode, now_ms);
+    return true;
+}
+
+const SensorData_t *SensorRegistry_Record(SensorEntry_t *entry, const SensorData_t *data)
+{
+    if (data == NULL)
+    {
+        SensorRegistry_Fail(entry, "read failed");
+        return NULL;
+    }
+
+    SensorRegistry_Deliver(entry, data, NULL);
+    return &entry->last;
+}
+
+bool SensorRegistry_HasPendingReads(void)
+{
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        if (s_sensors[i]->pending)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t SensorRegistry_GetTimeUntilNextDue(PowerMode_t mode, uint32_t now_ms)
+{
+    if (mode >= POWER_MODE_COUNT)
+    {
+        return SENSOR_REGISTRY_NO_DEADLINE;
+    }
+
+    uint32_t minWait = SENSOR_REGISTRY_NO_DEADLINE;
+
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        const SensorEntry_t *entry = s_sensors[i];
+        if (!SensorRegistry_IsActive(entry, mode))
+        {
+            continue;
+        }
+
+        uint32_t deadline = SensorRegistry_Deadline(entry, mode);
+        uint32_t wait = SensorRegistry_IsBefore(now_ms, deadline) ? (deadline - now_ms) : 0U;
+        if (wait < minWait)
+        {
+            minWait = wait;
+        }
+    }
+
+    return minWait;
+}
+
+bool SensorRegistry_SetSynced(uint8_t id, bool synced)
+{
+    SensorEntry_t *entry = SensorRegistry_Lookup(id);
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    entry->synced = synced;
+    if (!synced)
+    {
+        SensorRegistry_NotifySchedule();
+    }
+    return true;
+}
+
+bool SensorRegistry_SetCritical(uint8_t id, bool critical)
+{
+    SensorEntry_t *entry = SensorRegistry_Lookup(id);
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    entry->critical = critical;
+    return true;
+}
+
+bool SensorRegistry_Report(uint8_t id, const SensorData_t *data, SensorSampleCallback_t onSample)
+{
+    SensorEntry_t *entry = SensorRegistry_Lookup(id);
+
+    if (entry == NULL)
+    {
+        return false;
+    }
+
+    if (data != NULL)
+    {
+        SensorRegistry_Deliver(entry, data, onSample);
+    }
+    else
+    {
+        SensorRegistry_Fail(entry, "sync read failed");
+    }
+
+    return true;
+}
+
+uint32_t SensorRegistry_GetCount(void)
+{
+    return s_sensorCount;
+}
+
+const SensorEntry_t *SensorRegistry_GetByIndex(uint32_t index)
+{
+    if (index >= s_sensorCount)
+    {
+        return NULL;
+    }
+
+    return s_sensors[index];
+}
+
+const SensorEntry_t *SensorRegistry_Find(uint8_t id)
+{
+    return SensorRegistry_Lookup(id);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorEntry_t *SensorRegistry_Lookup(uint8_t id)
+{
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        if (s_sensors[i]->id == id)
+        {
+            return s_sensors[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void SensorRegistry_Deliver(SensorEntry_t *entry, const SensorData_t *data,
+                                   SensorSampleCallback_t onSample)
+{
+    entry->readCount++;
+    entry->health += (uint16_t)((SENSOR_REGISTRY_HEALTH_MAX - entry->health + 7U) / 8U);
+    if (entry->quarantined)
+    {
+        LOG_INFO("SensorRegistry: '%s' answers again, back in service", entry->name);
+    }
+    entry->failStreak  = 0U;
+    entry->retry_ms    = 0U;
+    entry->quarantined = false;
+
+    entry->last = *data;
+    if (!entry->keepIds)
+    {
+        entry->last.sensorId = entry->id;
+    }
+
+    if (onSample != NULL)
+    {
+        onSample(entry, &entry->last);
+    }
+}
+
+static void SensorRegistry_Fail(SensorEntry_t *entry, const char *reason)
+{
+    entry->errorCount++;
+    entry->health -= (uint16_t)((entry->health + 7U) / 8U);
+    if (entry->failStreak < UINT8_MAX)
+    {
+        entry->failStreak++;
+    }
+
+    if (entry->quarantined)
+    {
+        /* A probe failed: stay out for another probe interval. */
+        return;
+    }
+
+    if (entry->failStreak >= SENSOR_REGISTRY_QUARANTINE_ERRORS)
+    {
+        entry->quarantined = true;
+        entry->retry_ms    = SENSOR_REGISTRY_PROBE_MS;
+        s_quarantines++;
+        LOG_WARN("SensorRegistry: '%s' failed %u times in a row (%s), quarantined",
+                 entry->name, (unsigned)entry->failStreak, reason);
+        return;
+    }
+
+    if ((entry->failStreak == SENSOR_REGISTRY_RECOVER_ERRORS) && (entry->iface->init != NULL))
+    {
+        /* The device may have reset and lost its configuration. */
+        (void)entry->iface->init();
+        entry->recoveries++;
+    }
+
+    uint32_t backoff = SENSOR_REGISTRY_RETRY_MS << (entry->failStreak - 1U);
+
+    entry->retry_ms = (backoff < SENSOR_REGISTRY_BACKOFF_MAX_MS) ? backoff : SENSOR_REGISTRY_BACKOFF_MAX_MS;
+    s_retries++;
+
+    if (entry->failStreak == 1U)
+    {
+        LOG_WARN("SensorRegistry: %s for '%s', retry in %lu ms",
+                 reason, entry->name, (unsigned long)entry->retry_ms);
+    }
+}
+
+static void SensorRegistry_DrainBatch(SensorEntry_t *entry, SensorSampleCallback_t onSample)
+{
+    SensorData_t batch[SENSOR_REGISTRY_BATCH_MAX];
+
+    for (uint32_t chunk = 0U; chunk < SENSOR_REGISTRY_BATCH_CHUNKS; ++chunk)
+    {
+        size_t count = entry->iface->readBatch(batch, SENSOR_REGISTRY_BATCH_MAX);
+        if (count > SENSOR_REGISTRY_BATCH_MAX)
+        {
+            SensorRegistry_Fail(entry, "bad batch size");
+            return;
+        }
+
+        for (size_t i = 0U; i < count; ++i)
+        {
+            SensorRegistry_Deliver(entry, &batch[i], onSample);
+        }
+
+        if (count < SENSOR_REGISTRY_BATCH_MAX)
+        {
+            return;
+        }
+    }
+}
+
+static uint32_t SensorRegistry_PollPending(uint32_t now_ms, SensorSampleCallback_t onSample)
+{
+    uint32_t handled = 0U;
+
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        SensorEntry_t *entry = s_sensors[i];
+        if (!entry->pending)
+        {
+            continue;
+        }
+
+        SensorData_t       data;
+        SensorReadStatus_t status = entry->iface->pollRead(&data);
+
+        if (status == SENSOR_READ_BUSY)
+        {
+            if ((now_ms - entry->pendingSince_ms) <= SENSOR_REGISTRY_ASYNC_TIMEOUT_MS)
+            {
+                continue;
+            }
+            entry->pending = false;
+            TRACE_SENSOR_DONE(entry->id, false);
+            SensorRegistry_Fail(entry, "read timed out");
+        }
+        else if (status == SENSOR_READ_DONE)
+        {
+            entry->pending = false;
+            TRACE_SENSOR_DONE(entry->id, true);
+            SensorRegistry_Deliver(entry, &data, onSample);
+        }
+        else
+        {
+            entry->pending = false;
+            TRACE_SENSOR_DONE(entry->id, false);
+            SensorRegistry_Fail(entry, "read failed");
+        }
+
+        handled++;
+    }
+
+    return handled;
+}
+
+static uint32_t SensorRegistry_CountQuarantined(void)
+{
+    uint32_t count = 0U;
+
+    for (uint32_t i = 0U; i < s_sensorCount; ++i)
+    {
+        if (s_sensors[i]->quarantined)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
@@ -0,0 +1,386 @@
+/**
+ * @file sensor_registry.h
+ * @brief Registry of all sensors serviced by the Smart Sensor Hub.
+ *
+ * Sensors are described by caller-owned @ref SensorEntry_t records that
+ * pair a @ref SensorIF_t implementation with an ID, a name and a sampling
+ * period for every power mode. A single sampling task services all
+ * registered sensors: each call to SensorRegistry_Service() reads every
+ * sensor that is due, earliest deadline first.
+ *
+ * Sensors that implement the non-blocking startRead/pollRead pair are
+ * started when due and polled on later passes, so a slow bus transfer
+ * does not stall the cooperative loop. Sensors with a readBatch() entry
+ * point have their FIFO drained on each service, so their period is the
+ * FIFO watermark interval rather than the sample interval.
+ *
+ * Sensors marked @c direct are scheduled the same way but read by the
+ * application's own dispatch, generated from the board sensor table
+ * (app_sensors.h): it asks SensorRegistry_TakeDue() whether the sensor is
+ * due, calls the driver by name and hands the result to
+ * SensorRegistry_Record(), so the hot path has no indirect calls.
+ *
+ * A failed read is retried after @ref SENSOR_REGISTRY_RETRY_MS, doubling
+ * with each further failure in a row up to @ref SENSOR_REGISTRY_BACKOFF_MAX_MS,
+ * so a glitch costs one sample interval at most and a flaky sensor does
+ * not hold the bus with back-to-back retries. After
+ * @ref SENSOR_REGISTRY_RECOVER_ERRORS failures in a row the driver's init()
+ * runs again (the sensor may have lost its configuration in a brown-out);
+ * after @ref SENSOR_REGISTRY_QUARANTINE_ERRORS the sensor is quarantined
+ * and only probed every @ref SENSOR_REGISTRY_PROBE_MS until a read
+ * succeeds. Each entry keeps a health score, the success ratio of its
+ * recent reads; it is exported as a labelled metrics series.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+#include "power_manager.h"
+
+/**
+ * @defgroup sensor_registry Sensor Registry
+ * @brief Multi-sensor registration and deadline-ordered servicing.
+ * @ingroup sensors
+ * @{
+ */
+
+/**
+ * @brief Maximum number of sensors that can be registered.
+ *
+ * Room for the on-board sensors plus a full synthetic sensor farm
+ * (see sensor_farm.h).
+ */
+#define SENSOR_REGISTRY_MAX_SENSORS   (32U)
+
+/**
+ * @brief Returned by SensorRegistry_GetTimeUntilNextDue() when no sensor
+ *        is enabled in the given power mode.
+ */
+#define SENSOR_REGISTRY_NO_DEADLINE   (0xFFFFFFFFU)
+
+/**
+ * @brief Longest time an asynchronous read may stay pending (ms).
+ *
+ * A read still busy after this is counted as an error and abandoned.
+ */
+#define SENSOR_REGISTRY_ASYNC_TIMEOUT_MS   (50U)
+
+/**
+ * @brief First retry of a failed read, after the failed attempt (ms).
+ */
+#define SENSOR_REGISTRY_RETRY_MS           (10U)
+
+/**
+ * @brief Longest retry back-off (ms).
+ */
+#define SENSOR_REGISTRY_BACKOFF_MAX_MS     (5000U)
+
+/**
+ * @brief Failures in a row after which the driver is initialized again.
+ */
+#define SENSOR_REGISTRY_RECOVER_ERRORS     (3U)
+
+/**
+ * @brief Failures in a row after which the sensor is quarantined.
+ */
+#define SENSOR_REGISTRY_QUARANTINE_ERRORS  (8U)
+
+/**
+ * @brief Interval of the probe reads of a quarantined sensor (ms).
+ */
+#define SENSOR_REGISTRY_PROBE_MS           (30000U)
+
+/**
+ * @brief Health score of a sensor whose recent reads all succeeded.
+ *
+ * Each read moves the score 1/8 of the way to this (success) or to 0.
+ */
+#define SENSOR_REGISTRY_HEALTH_MAX         (1000U)
+
+/**
+ * @brief Samples fetched per readBatch() call.
+ */
+#define SENSOR_REGISTRY_BATCH_MAX          (32U)
+
+/**
+ * @brief Maximum readBatch() calls per service of one sensor.
+ *
+ * Bounds the time spent draining a FIFO that refills as fast as it is read.
+ */
+#define SENSOR_REGISTRY_BATCH_CHUNKS       (4U)
+
+/**
+ * @brief Registration record for one sensor.
+ *
+ * The configuration fields are filled in by the application; the runtime
+ * fields are managed by the registry and should be zero-initialized.
+ * Entries must remain valid for the lifetime of the application.
+ */
+typedef struct
+{
+    /* Configuration */
+    uint8_t           id;                          /**< Unique sensor ID.                     */
+    const char       *name;                        /**< Human-readable name.                  */
+    const SensorIF_t *iface;                       /**< Driver implementation.                */
+    uint32_t          period_ms[POWER_MODE_COUNT]; /**< Period per power mode; 0 = disabled.  */
+    bool              direct;                      /**< Read by the caller, not by Service(). */
+    bool              keepIds;                     /**< Samples keep the driver's sensorId.   */
+    bool              critical;                    /**< Never decimated by load shedding.     */
+
+    /* Runtime (managed by the registry) */
+    bool         ready;           /**< init() succeeded.                       */
+    bool         pending;         /**< Asynchronous read in progress.          */
+    bool         synced;          /**< Read by the sync group, not scheduled.  */
+    uint32_t     pendingSince_ms; /**< Tick at which the pending read started. */
+    uint32_t     lastSample_ms;   /**< Deadline of the last read attempt.      */
+    uint32_t     readCount;       /**< Measurements delivered.                 */
+    uint32_t     errorCount;      /**< Failed reads.                           */
+    uint32_t     retry_ms;        /**< Retry delay in place of the period, 0.  */
+    uint16_t     health;          /**< 0 to SENSOR_REGISTRY_HEALTH_MAX.        */
+    uint8_t      failStreak;      /**< Failed reads in a row.                  */
+    bool         quarantined;     /**< Given up on: probe reads only.          */
+    uint32_t     recoveries;      /**< init() runs after failures in a row.    */
+    SensorData_t last;            /**< Most recent successful reading.         */
+} SensorEntry_t;
+
+/**
+ * @brief Callback invoked for every successful sensor reading.
+ *
+ * @param entry Sensor that produced the reading.
+ * @param data  The reading, with sensorId set to the entry's ID (unless
+ *              the entry has @c keepIds).
+ */
+typedef void (*SensorSampleCallback_t)(const SensorEntry_t *entry, const SensorData_t *data);
+
+/**
+ * @brief Called when a sensor may have become due earlier than before.
+ *
+ * The sampling task sleeps until the next deadline it was told about;
+ * this hook is how it hears of an earlier one.
+ */
+typedef void (*SensorScheduleHook_t)(void);
+
+/**
+ * @brief Reset the registry.
+ *
+ * @return None.
+ */
+void SensorRegistry_Init(void);
+
+/**
+ * @brief Register a sensor and run its init() function.
+ *
+ * A sensor whose init() fails is still registered (so it is reported)
+ * but is never read.
+ *
+ * @param entry Sensor record in static storage.
+ *
+ * @return 0 on success, -1 if @p entry or its interface is invalid,
+ *         -2 if the registry is full, -3 if the ID is already in use,
+ *         -4 if the sensor failed to initialize.
+ */
+int SensorRegistry_Register(SensorEntry_t *entry);
+
+/**
+ * @brief Remove a sensor from the registry.
+ *
+ * The remaining sensors keep their relative order. Must not be called
+ * from a sample callback.
+ *
+ * @param id ID of the sensor to remove.
+ *
+ * @return true if the sensor was registered and has been removed.
+ */
+bool SensorRegistry_Unregister(uint8_t id);
+
+/**
+ * @brief Make a sensor due at once instead of one period after registration.
+ *
+ * Its deadlines then follow from @p now_ms. Used at boot, where the first
+ * sample should not wait a full period.
+ *
+ * @param id     Sensor ID.
+ * @param mode   Power mode whose period places the current deadline.
+ * @param now_ms Current tick.
+ *
+ * @return true if the sensor is registered.
+ */
+bool SensorRegistry_SetDueNow(uint8_t id, PowerMode_t mode, uint32_t now_ms);
+
+/**
+ * @brief Move the deadlines for a power mode change, once.
+ *
+ * A sensor with the same period in both modes keeps its deadline. One
+ * that was not sampled in @p from is due at once; any other sensor keeps
+ * its phase, so its next deadline is one new period after its last read.
+ * Calls the schedule hook if any deadline moved.
+ *
+ * @param from   Mode the deadlines were set for.
+ * @param to     New mode.
+ * @param now_ms Current tick.
+ *
+ * @return None.
+ */
+void SensorRegistry_ChangeMode(PowerMode_t from, PowerMode_t to, uint32_t now_ms);
+
+/**
+ * @brief Install the schedule hook.
+ *
+ * Called from SensorRegistry_Register(), SensorRegistry_SetDueNow(),
+ * SensorRegistry_ChangeMode() and when a synced sensor is handed back.
+ *
+ * @param hook Hook (may be NULL).
+ *
+ * @return None.
+ */
+void SensorRegistry_SetScheduleHook(SensorScheduleHook_t hook);
+
+/**
+ * @brief Read every sensor that is due in @p mode.
+ *
+ * First polls every pending asynchronous read, then services each due
+ * sensor, earliest deadline first: FIFO sensors are drained, asynchronous
+ * sensors are started and blocking sensors are read. Sensors whose period
+ * is 0 in @p mode are skipped.
+ *
+ * @param mode     Current power mode, selects each sensor's period.
+ * @param now_ms   Current tick.
+ * @param onSample Called for each successful reading, once per sample of a
+ *                 batch (may be NULL).
+ *
+ * @return Number of reads started or completed in this pass.
+ */
+uint32_t SensorRegistry_Service(PowerMode_t mode, uint32_t now_ms, SensorSampleCallback_t onSample);
+
+/**
+ * @brief Claim the current deadline of a sensor the caller reads itself.
+ *
+ * For @c direct entries: if the sensor is due in @p mode (ready, not
+ * synced, not pending, period not 0), its next deadline is set as
+ * SensorRegistry_Service() would and the caller must read it now.
+ *
+ * @param entry  Registered sensor.
+ * @param mode   Current power mode.
+ * @param now_ms Current tick.
+ *
+ * @return true if the sensor is due.
+ */
+bool SensorRegistry_TakeDue(SensorEntry_t *entry, PowerMode_t mode, uint32_t now_ms);
+
+/**
+ * @brief Record the outcome of a read the caller made.
+ *
+ * Counts the reading (or the failure) and keeps it as the sensor's last
+ * reading, with sensorId set. The caller passes the returned reading on.
+ *
+ * @param entry Registered sensor.
+ * @param data  The reading, or NULL if the read failed.
+ *
+ * @return The stored reading, or NULL for a failure.
+ */
+const SensorData_t *SensorRegistry_Record(SensorEntry_t *entry, const SensorData_t *data);
+
+/**
+ * @brief Time until the next sensor becomes due in @p mode.
+ *
+ * @param mode   Current power mode.
+ * @param now_ms Current tick.
+ *
+ * @return Milliseconds until the next read (0 if one is due), or
+ *         @ref SENSOR_REGISTRY_NO_DEADLINE if no sensor is enabled.
+ */
+uint32_t SensorRegistry_GetTimeUntilNextDue(PowerMode_t mode, uint32_t now_ms);
+
+/**
+ * @brief Whether any asynchronous read is still in progress.
+ *
+ * The sampling task uses this to come back soon and poll for completion.
+ *
+ * @return true if at least one read is pending.
+ */
+bool SensorRegistry_HasPendingReads(void);
+
+/**
+ * @brief Hand a sensor to or take it back from an external acquisition
+ *        engine (see sensor_sync.h).
+ *
+ * A synced sensor is not scheduled by SensorRegistry_Service() and does
+ * not count for SensorRegistry_GetTimeUntilNextDue(); its readings come
+ * in through SensorRegistry_Report().
+ *
+ * @param id     Sensor ID.
+ * @param synced true to stop scheduling the sensor, false to resume.
+ *
+ * @return false if no such sensor is registered.
+ */
+bool SensorRegistry_SetSynced(uint8_t id, bool synced);
+
+/**
+ * @brief Mark a sensor critical or not.
+ *
+ * The samples of a critical sensor are never decimated or aggregated by
+ * the load-shedding policy (see app_load_shed.h).
+ *
+ * @param id       Sensor ID.
+ * @param critical New setting.
+ *
+ * @return false if no such sensor is registered.
+ */
+bool SensorRegistry_SetCritical(uint8_t id, bool critical);
+
+/**
+ * @brief Record a reading taken outside the registry.
+ *
+ * Updates the counters and last reading of the sensor as a scheduled read
+ * would, and passes a successful reading to @p onSample. Task context
+ * only, like SensorRegistry_Service().
+ *
+ * @param id       Sensor ID.
+ * @param data     The reading, or NULL if the read failed.
+ * @param onSample Sample callback (may be NULL).
+ *
+ * @return false if no such sensor is registered.
+ */
+bool SensorRegistry_Report(uint8_t id, const SensorData_t *data, SensorSampleCallback_t onSample);
+
+/**
+ * @brief Number of registered sensors.
+ *
+ * @return Sensor count.
+ */
+uint32_t SensorRegistry_GetCount(void);
+
+/**
+ * @brief Access a registered sensor by index (registration order).
+ *
+ * @param index Index in the range [0, SensorRegistry_GetCount()).
+ *
+ * @return Sensor entry, or NULL if @p index is out of range.
+ */
+const SensorEntry_t *SensorRegistry_GetByIndex(uint32_t index);
+
+/**
+ * @brief Look up a registered sensor by ID.
+ *
+ * @param id Sensor ID.
+ *
+ * @return Sensor entry, or NULL if no sensor has this ID.
+ */
+const SensorEntry_t *SensorRegistry_Find(uint8_t id);
+
+/** @} */ /* end of sensor_registry group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_REGISTRY_H */
@@ -0,0 +1,343 @@
+/**
+ * @file sensor_replay.c
+ * @brief Replay sensor implementation.
+ *
+ * The link queue is written by the CLI and read by the sampling task,
+ * both from the main loop, so it needs no locking.
+ *
+ * @ingroup sensor_replay
+ */
+
+#include "sensor_replay.h"
+#include "sensor_registry.h"
+#include "sample_ring.h"
+#include "flash_log.h"
+#include "time_base.h"
+#include "log.h"
+#include "stm32f4xx_hal.h"
+
+_Static_assert((SENSOR_REPLAY_LINK_DEPTH & (SENSOR_REPLAY_LINK_DEPTH - 1U)) == 0U,
+               "SENSOR_REPLAY_LINK_DEPTH must be a power of two");
+
+/** @brief A step back in recorded time by more than this is a reset (ms). */
+#define SENSOR_REPLAY_RESET_MS      (10000U)
+
+/** @brief Decimal exponent of samples rebuilt from float records. */
+#define SENSOR_REPLAY_FLOAT_SCALE   (-3)
+
+/**
+ * @brief readBatch() of the replay sensor.
+ */
+static size_t SensorReplay_ReadBatch(SensorData_t *out, size_t max);
+
+/** @brief Interface of the replay sensor. */
+static const SensorIF_t s_replayIF = { .init = NULL, .readBatch = SensorReplay_ReadBatch };
+
+/** @brief Registry record of the replay sensor. */
+static SensorEntry_t s_entry;
+
+/** @brief State and counters. */
+static SensorReplayStats_t s_stats = {0};
+
+/** @brief Reader of a flash replay. */
+static FlashLogReader_t s_flashReader;
+
+/** @brief Samples pushed over the link. */
+static SensorData_t s_link[SENSOR_REPLAY_LINK_DEPTH];
+
+/** @brief Next link sample to deliver (free-running). */
+static uint32_t s_linkHead = 0U;
+
+/** @brief Next free link entry (free-running). */
+static uint32_t s_linkTail = 0U;
+
+/** @brief `replay end` was received. */
+static bool s_linkEnded = false;
+
+/** @brief Next sample, already read from the source but not yet due. */
+static SensorData_t s_next;
+
+/** @brief @ref s_next holds a sample. */
+static bool s_haveNext = false;
+
+/** @brief Nothing has been read from the source yet. */
+static bool s_first = true;
+
+/** @brief Recorded time of the start of the replay, or of the last reset (ms). */
+static uint32_t s_recBase_ms = 0U;
+
+/** @brief Latest recorded time read since then (ms). */
+static uint32_t s_recHigh_ms = 0U;
+
+/** @brief Replayed time of @ref s_recBase_ms (ms). */
+static uint32_t s_atBase_ms = 0U;
+
+/**
+ * @brief Read the next sample from the source, with its recorded timestamp.
+ */
+static bool SensorReplay_Fetch(SensorData_t *data);
+
+/**
+ * @brief Move a fetched sample onto the replay's time line.
+ */
+static void SensorReplay_Retime(SensorData_t *data, uint32_t now_ms);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorReplay_Init(void)
+{
+    s_entry       = (SensorEntry_t){0};
+    s_entry.id    = (uint8_t)SENSOR_REPLAY_ID;
+    s_entry.name  = "Replay";
+    s_entry.iface = &s_replayIF;
+
+    s_entry.period_ms[POWER_MODE_ACTIVE] = SENSOR_REPLAY_PERIOD_MS;
+    s_entry.period_ms[POWER_MODE_IDLE]   = SENSOR_REPLAY_PERIOD_MS;
+    s_entry.period_ms[POWER_MODE_SLEEP]  = 0U;
+    s_entry.period_ms[POWER_MODE_STOP]   = 0U;
+    s_entry.keepIds                      = true;
+
+    s_stats = (SensorReplayStats_t){0};
+}
+
+bool SensorReplay_Start(SensorReplaySource_t source, SensorReplayPace_t pace)
+{
+    SensorReplay_Stop();
+
+    switch (source)
+    {
+        case SENSOR_REPLAY_FLASH:
+            if (FlashLog_IsEnabled())
+            {
+                return false;
+            }
+            FlashLog_BeginRead(&s_flashReader);
+            break;
+
+        case SENSOR_REPLAY_FILE:
+            if (!SensorReplay_FileOpen())
+            {
+                return false;
+            }
+            break;
+
+        case SENSOR_REPLAY_LINK:
+            s_linkHead  = 0U;
+            s_linkTail  = 0U;
+            s_linkEnded = false;
+            break;
+
+        default:
+            return false;
+    }
+
+    uint32_t now_ms = HAL_GetTick();
+
+    s_stats          = (SensorReplayStats_t){0};
+    s_stats.source   = source;
+    s_stats.pace     = pace;
+    s_stats.start_ms = now_ms;
+    s_stats.end_ms   = now_ms;
+    s_haveNext       = false;
+    s_first          = true;
+
+    if (SensorRegistry_Register(&s_entry) != 0)
+    {
+        return false;
+    }
+
+    (void)SensorRegistry_SetDueNow(s_entry.id, POWER_MODE_ACTIVE, now_ms);
+    s_stats.active = true;
+
+    LOG_INFO("SensorReplay: started");
+    return true;
+}
+
+void SensorReplay_Stop(void)
+{
+    if (s_stats.active)
+    {
+        (void)SensorRegistry_Unregister(s_entry.id);
+        s_stats.active = false;
+    }
+
+    s_linkHead = s_linkTail;
+    s_haveNext = false;
+}
+
+bool SensorReplay_Push(const SensorData_t *data)
+{
+    if ((data == NULL) || !s_stats.active || (s_stats.source != SENSOR_REPLAY_LINK) ||
+        s_linkEnded || (SensorReplay_GetLinkFree() == 0U))
+    {
+        return false;
+    }
+
+    s_link[s_linkTail & (SENSOR_REPLAY_LINK_DEPTH - 1U)] = *data;
+    s_linkTail++;
+    return true;
+}
+
+void SensorReplay_EndPush(void)
+{
+    s_linkEnded = true;
+}
+
+uint32_t SensorReplay_GetLinkFree(void)
+{
+    return SENSOR_REPLAY_LINK_DEPTH - (s_linkTail - s_linkHead);
+}
+
+void SensorReplay_GetStats(SensorReplayStats_t *stats)
+{
+    if (stats != NULL)
+    {
+        *stats        = s_stats;
+        stats->queued = s_linkTail - s_linkHead;
+    }
+}
+
+__attribute__((weak)) bool SensorReplay_FileOpen(void)
+{
+    return false;
+}
+
+__attribute__((weak)) bool SensorReplay_FileRead(SensorData_t *data)
+{
+    (void)data;
+    return false;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static size_t SensorReplay_ReadBatch(SensorData_t *out, size_t max)
+{
+    if (!s_stats.active || s_stats.done)
+    {
+        return 0U;
+    }
+
+    uint32_t now_ms = HAL_GetTick();
+    size_t   limit  = max;
+
+    if (s_stats.pace == SENSOR_REPLAY_FAST)
+    {
+        /* Never more than the ring takes, so a fast replay loses nothing. */
+        uint32_t room = SAMPLE_RING_SIZE - SampleRing_GetCount();
+
+        if (room < limit)
+        {
+            limit = room;
+        }
+    }
+
+    size_t count = 0U;
+
+    while (count < limit)
+    {
+        if (!s_haveNext)
+        {
+            if (!SensorReplay_Fetch(&s_next))
+            {
+                /* A link replay waits for more until `replay end`. */
+                if ((s_stats.source != SENSOR_REPLAY_LINK) || s_linkEnded)
+                {
+                    s_stats.done = true;
+                    LOG_INFO("SensorReplay: done, %lu sample(s)", (unsigned long)s_stats.samples);
+                }
+                break;
+            }
+            SensorReplay_Retime(&s_next, now_ms);
+            s_haveNext = true;
+        }
+
+        if ((s_stats.pace == SENSOR_REPLAY_TIMED) && ((int32_t)(s_next.timestamp - now_ms) > 0))
+        {
+            break;
+        }
+
+        out[count] = s_next;
+        count++;
+        s_haveNext = false;
+    }
+
+    if (count != 0U)
+    {
+        s_stats.samples += (uint32_t)count;
+        s_stats.end_ms   = now_ms;
+    }
+
+    return count;
+}
+
+static bool SensorReplay_Fetch(SensorData_t *data)
+{
+    switch (s_stats.source)
+    {
+        case SENSOR_REPLAY_FLASH:
+        {
+            SampleCodecRecord_t record;
+
+            if (!FlashLog_Read(&s_flashReader, &record))
+            {
+                return false;
+            }
+            SensorData_Init(data, SENSOR_FORMAT_S32, 1U, SENSOR_REPLAY_FLOAT_SCALE);
+            SensorData_SetFloat(data, 0U, record.value);
+            data->sensorId  = record.sensorId;
+            data->timestamp = record.timestamp;
+            return true;
+        }
+
+        case SENSOR_REPLAY_FILE:
+            return SensorReplay_FileRead(data);
+
+        case SENSOR_REPLAY_LINK:
+            if (s_linkHead == s_linkTail)
+            {
+                return false;
+            }
+            *data = s_link[s_linkHead & (SENSOR_REPLAY_LINK_DEPTH - 1U)];
+            s_linkHead++;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static void SensorReplay_Retime(SensorData_t *data, uint32_t now_ms)
+{
+    uint32_t rec_ms = data->timestamp;
+
+    if (s_first)
+    {
+        s_recBase_ms = rec_ms;
+        s_recHigh_ms = rec_ms;
+        s_atBase_ms  = now_ms;
+        s_first      = false;
+    }
+    else if ((int32_t)(s_recHigh_ms - rec_ms) > (int32_t)SENSOR_REPLAY_RESET_MS)
+    {
+        /* A reset in the recording: carry on from its latest sample. */
+        s_atBase_ms += s_recHigh_ms - s_recBase_ms;
+        s_recBase_ms = rec_ms;
+        s_recHigh_ms = rec_ms;
+    }
+    else if ((int32_t)(rec_ms - s_recHigh_ms) > 0)
+    {
+        s_recHigh_ms = rec_ms;
+    }
+    else
+    {
+        /* Earlier than the latest: sensors are not flushed in time order. */
+    }
+
+    uint32_t at_ms = s_atBase_ms + (rec_ms - s_recBase_ms);
+
+    data->sensorId     = (uint8_t)(data->sensorId | SENSOR_REPLAY_ID_FLAG);
+    data->timestamp    = at_ms;
+    data->timestamp_us = Time_NowUs32() + ((at_ms - now_ms) * 1000U);
+}
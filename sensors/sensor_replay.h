@@ -0,0 +1,187 @@
+/**
+ * @file sensor_replay.h
+ * @brief Replay sensor: recorded samples streamed back through the pipeline.
+ *
+ * A replay is one @ref SensorIF_t batch sensor in the sensor registry
+ * whose readBatch() takes the next recorded samples from a source:
+ *
+ * - @ref SENSOR_REPLAY_FLASH: the flash sample log (flash_log.h), oldest
+ *   page first, as recorded in the field with `flashlog on`
+ * - @ref SENSOR_REPLAY_FILE: a file on the host (the simulation's -P
+ *   option: a telemetry capture, any mix of text and sample frames)
+ * - @ref SENSOR_REPLAY_LINK: samples sent over the console by
+ *   tools/replay_send.py, `replay push` lines with flow control
+ *
+ * Replayed samples go through the ring, filters, deadband, statistics and
+ * outputs like live ones. They keep their recorded sensor ID with
+ * @ref SENSOR_REPLAY_ID_FLAG set, so they are told apart from the live
+ * sensor of the same ID and have filters of their own (`filter 128 ...`
+ * for recorded sensor 0).
+ *
+ * Timestamps keep the recorded spacing from the start of the replay; a
+ * step back in the recording (a reset) continues without a gap. With
+ * @ref SENSOR_REPLAY_TIMED a sample is delivered when its timestamp is
+ * due. With @ref SENSOR_REPLAY_FAST every service delivers as many as the
+ * sample ring has room for, so nothing is lost to an overrun and a run
+ * over the same input gives the same output; the timestamps then run
+ * ahead of the clock.
+ *
+ * File and link records carry the value of one channel; raw frames (type
+ * 0x05) and the flash log keep their layout and quality only as far as
+ * the source stores them (the flash log holds the first channel).
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_REPLAY_H
+#define SENSOR_REPLAY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_if.h"
+
+/**
+ * @defgroup sensor_replay Replay Sensor
+ * @brief Recorded sample streams through the live pipeline.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Registry ID of the replay sensor itself. */
+#define SENSOR_REPLAY_ID           (90U)
+
+/** @brief Set in the sensor ID of every replayed sample. */
+#define SENSOR_REPLAY_ID_FLAG      (0x80U)
+
+/** @brief Service period of the replay sensor in ACTIVE and IDLE (ms). */
+#define SENSOR_REPLAY_PERIOD_MS    (10U)
+
+/** @brief Samples queued from the link (power of two). */
+#define SENSOR_REPLAY_LINK_DEPTH   (32U)
+
+/**
+ * @brief Where the samples come from.
+ */
+typedef enum
+{
+    SENSOR_REPLAY_FLASH = 0U,  /**< Flash sample log.              */
+    SENSOR_REPLAY_FILE,        /**< Host file (simulation only).   */
+    SENSOR_REPLAY_LINK,        /**< `replay push` over the console. */
+    SENSOR_REPLAY_SOURCE_COUNT
+} SensorReplaySource_t;
+
+/**
+ * @brief Delivery timing.
+ */
+typedef enum
+{
+    SENSOR_REPLAY_TIMED = 0U,  /**< At the recorded spacing.          */
+    SENSOR_REPLAY_FAST         /**< As fast as the sample ring takes. */
+} SensorReplayPace_t;
+
+/**
+ * @brief Replay state and counters.
+ */
+typedef struct
+{
+    bool                 active;   /**< A replay is registered.               */
+    bool                 done;     /**< The source has ended.                 */
+    SensorReplaySource_t source;   /**< Source of the current replay.         */
+    SensorReplayPace_t   pace;     /**< Timing of the current replay.         */
+    uint32_t             samples;  /**< Samples delivered.                    */
+    uint32_t             start_ms; /**< Tick at the start.                    */
+    uint32_t             end_ms;   /**< Tick of the last delivery.            */
+    uint32_t             queued;   /**< Link samples waiting.                 */
+} SensorReplayStats_t;
+
+/**
+ * @brief Reset the replay state. Call after SensorRegistry_Init().
+ *
+ * @return None.
+ */
+void SensorReplay_Init(void);
+
+/**
+ * @brief Register the replay sensor and start reading @p source.
+ *
+ * A running replay is stopped first.
+ *
+ * @param source Sample source.
+ * @param pace   Delivery timing.
+ *
+ * @return false if the source cannot be opened: no file in this build,
+ *         or the flash log is still logging (it would record the replay),
+ *         or the registry is full.
+ */
+bool SensorReplay_Start(SensorReplaySource_t source, SensorReplayPace_t pace);
+
+/**
+ * @brief Unregister the replay sensor; queued link samples are dropped.
+ *
+ * @return None.
+ */
+void SensorReplay_Stop(void);
+
+/**
+ * @brief Queue one sample of a @ref SENSOR_REPLAY_LINK replay.
+ *
+ * @param data Sample with its recorded sensor ID and timestamp.
+ *
+ * @return false if no link replay is running or the queue is full.
+ */
+bool SensorReplay_Push(const SensorData_t *data);
+
+/**
+ * @brief Mark the end of a link replay; it is done once the queue drains.
+ *
+ * @return None.
+ */
+void SensorReplay_EndPush(void);
+
+/**
+ * @brief Free entries of the link queue.
+ *
+ * @return Samples SensorReplay_Push() still accepts.
+ */
+uint32_t SensorReplay_GetLinkFree(void);
+
+/**
+ * @brief Snapshot the replay state.
+ *
+ * @param[out] stats Receives the state.
+ *
+ * @return None.
+ */
+void SensorReplay_GetStats(SensorReplayStats_t *stats);
+
+/**
+ * @brief Open the host file of a @ref SENSOR_REPLAY_FILE replay.
+ *
+ * Weak in sensor_replay.c (no file: false); the simulation provides it.
+ *
+ * @return true if a file is there to be read from its start.
+ */
+bool SensorReplay_FileOpen(void);
+
+/**
+ * @brief Next sample of the host file.
+ *
+ * Weak in sensor_replay.c; the simulation provides it.
+ *
+ * @param[out] data Sample with its recorded sensor ID and timestamp.
+ *
+ * @return false at the end of the file.
+ */
+bool SensorReplay_FileRead(SensorData_t *data);
+
+/** @} */ /* end of sensor_replay group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_REPLAY_H */
@@ -6,21 +6,96 @@
  * It generates a smooth, time-varying signal based on a sine wave to
  * emulate realistic sensor behavior without requiring actual hardware.
  *
+ * The signal comes from the fixed-point generator in sim_wave.c (sine
+ * table, integer phase accumulator, optional noise). Building with
+ * SENSOR_SIM_TEMP_USE_LIBM=1 restores the original sinf() computation.
+ *
  * @ingroup sensors
  */
 
 #include "sensor_sim_temp.h"
+#include "time_base.h"
 #include "stm32f4xx_hal.h"
+
+#if (SENSOR_SIM_TEMP_USE_LIBM != 0)
 #include <math.h>
+#endif
 
 /**
  * @brief Internal state storing the simulation start time.
  */
 static uint32_t s_simStartTime_ms = 0U;
 
+/**
+ * @brief Default waveform: 25 °C ± 3 °C, 2*pi*2000 ms period, no noise.
+ */
+static const SimWaveConfig_t s_defaultWave =
+{
+    .offset    = 25000,
+    .amplitude = 3000,
+    .period_ms = 12566U,
+    .noise     = 0
+};
+
+/**
+ * @brief Waveform generator.
+ */
+static SimWave_t s_wave;
+
+/**
+ * @brief Set once a waveform has been applied (default or configured).
+ */
+static bool s_waveConfigured = false;
+
+/**
+ * @brief Simulated conversion time of an asynchronous read (ms).
+ *
+ * Roughly what a real digital temperature sensor needs per conversion.
+ */
+#define SENSOR_SIM_TEMP_CONVERSION_MS   (5U)
+
+/**
+ * @brief Sample scale: int16 in 0.01 °C.
+ */
+#define SENSOR_SIM_TEMP_SCALE_EXP       (-2)
+
+/**
+ * @brief Tick at which the pending asynchronous read was started.
+ */
+static uint32_t s_readStart_ms = 0U;
+
+/**
+ * @brief Time base value (us) at the start of the pending read.
+ */
+static uint32_t s_readStart_us = 0U;
+
+/**
+ * @brief True while an asynchronous read is in progress.
+ */
+static bool s_readPending = false;
+
+/**
+ * @brief Output data rate of the simulated FIFO (ms per sample).
+ */
+#define SENSOR_SIM_TEMP_ODR_MS          (1000U)
+
+/**
+ * @brief Depth of the simulated FIFO (samples).
+ *
+ * Older samples are lost if the FIFO is not drained within
+ * depth * ODR ms (32 s), like a FIFO in stream mode.
+ */
+#define SENSOR_SIM_TEMP_FIFO_DEPTH      (32U)
+
+/**
+ * @brief Time of the oldest sample not yet drained from the simulated FIFO.
+ */
+static uint32_t s_fifoNext_ms = 0U;
+
 /* Forward declarations of implementation functions. */
-static bool SensorSimTemp_Init(void);
-static bool SensorSimTemp_Read(SensorData_t *outData);
+static bool SensorSimTemp_StartRead(void);
+static SensorReadStatus_t SensorSimTemp_PollRead(SensorData_t *outData);
+static float SensorSimTemp_Sample(uint32_t now_ms);
 
 /**
  * @brief Static instance of the simulated sensor interface.
@@ -31,12 +106,15 @@ static bool SensorSimTemp_Read(SensorData_t *outData);
  */
 static const SensorIF_t s_simTempIF =
 {
-    .init = SensorSimTemp_Init,
-    .read = SensorSimTemp_Read
+    .init      = SensorSimTemp_Init,
+    .read      = SensorSimTemp_Read,
+    .startRead = SensorSimTemp_StartRead,
+    .pollRead  = SensorSimTemp_PollRead,
+    .readBatch = SensorSimTemp_ReadBatch
 };
 
 /* ------------------------------------------------------------------------- */
-/*                      Public Interface (Sensor_GetInterface)               */
+/*                      Public Interface                                     */
 /* ------------------------------------------------------------------------- */
 
 const SensorIF_t *Sensor_GetInterface(void)
@@ -44,58 +122,185 @@ const SensorIF_t *Sensor_GetInterface(void)
     return &s_simTempIF;
 }
 
+const SensorIF_t *SensorSimTemp_GetInterface(void)
+{
+    return &s_simTempIF;
+}
+
+void SensorSimTemp_Configure(const SimWaveConfig_t *config)
+{
+    SimWave_Init(&s_wave, (config != NULL) ? config : &s_defaultWave, s_wave.rng);
+    s_waveConfigured = true;
+}
+
+void SensorSimTemp_GetConfig(SimWaveConfig_t *config)
+{
+    if (config != NULL)
+    {
+        *config = s_wave.config;
+    }
+}
+
+void SensorSimTemp_SetStartTime(uint32_t start_ms)
+{
+    s_simStartTime_ms = start_ms;
+}
+
+bool SensorSimTemp_Init(void)
+{
+    s_simStartTime_ms = HAL_GetTick();
+    if (!s_waveConfigured)
+    {
+        SimWave_Init(&s_wave, &s_defaultWave, s_simStartTime_ms);
+        s_waveConfigured = true;
+    }
+    /* The first conversion is ready at power-up, so a drain right after
+     * boot already has a sample (see SensorRegistry_SetDueNow()).
+     */
+    s_fifoNext_ms     = s_simStartTime_ms;
+    s_readPending     = false;
+    return true;
+}
+
+bool SensorSimTemp_Read(SensorData_t *outData)
+{
+    if (outData == NULL)
+    {
+        return false;
+    }
+
+    uint32_t now_ms = HAL_GetTick();
+
+    SensorData_Init(outData, SENSOR_FORMAT_S16, 1U, SENSOR_SIM_TEMP_SCALE_EXP);
+    SensorData_SetFloat(outData, 0U, SensorSimTemp_Sample(now_ms));
+    outData->timestamp    = now_ms;
+    outData->timestamp_us = Time_NowUs32();
+
+    return true;
+}
+
+size_t SensorSimTemp_ReadBatch(SensorData_t *out, size_t max)
+{
+    if (out == NULL)
+    {
+        return 0U;
+    }
+
+    uint32_t now_ms = HAL_GetTick();
+    uint32_t now_us = Time_NowUs32();
+    uint32_t oldest = now_ms - ((SENSOR_SIM_TEMP_FIFO_DEPTH - 1U) * SENSOR_SIM_TEMP_ODR_MS);
+
+    /* Overflow: only the newest FIFO_DEPTH samples are still buffered. */
+    bool gap = false;
+    while ((int32_t)(s_fifoNext_ms - oldest) < 0)
+    {
+        s_fifoNext_ms += SENSOR_SIM_TEMP_ODR_MS;
+        gap = true;
+    }
+
+    size_t count = 0U;
+    while ((count < max) && ((int32_t)(now_ms - s_fifoNext_ms) >= 0))
+    {
+        SensorData_Init(&out[count], SENSOR_FORMAT_S16, 1U, SENSOR_SIM_TEMP_SCALE_EXP);
+        SensorData_SetFloat(&out[count], 0U, SensorSimTemp_Sample(s_fifoNext_ms));
+        if (gap && (count == 0U))
+        {
+            out[count].quality |= SENSOR_QUALITY_GAP;
+        }
+        out[count].timestamp    = s_fifoNext_ms;
+        out[count].timestamp_us = now_us - ((now_ms - s_fifoNext_ms) * 1000U);
+        count++;
+
+        s_fifoNext_ms += SENSOR_SIM_TEMP_ODR_MS;
+    }
+
+    return count;
+}
+
 /* ------------------------------------------------------------------------- */
 /*                      Static Implementation Functions                      */
 /* ------------------------------------------------------------------------- */
 
 /**
- * @brief Initialize the simulated temperature sensor.
+ * @brief Start a simulated asynchronous conversion.
  *
- * This function records the current system tick as the reference time
- * for the simulation. All subsequent readings are based on the time
- * elapsed since this point.
+ * Reference implementation of the non-blocking read pair: the result
+ * becomes available @ref SENSOR_SIM_TEMP_CONVERSION_MS later, like a real
+ * sensor's conversion time, and is timestamped at the start of the read.
  *
- * @return true if initialization completed successfully.
+ * @return false if a read is already in progress.
  */
-static bool SensorSimTemp_Init(void)
+static bool SensorSimTemp_StartRead(void)
 {
-    s_simStartTime_ms = HAL_GetTick();
+    if (s_readPending)
+    {
+        return false;
+    }
+
+    s_readStart_ms = HAL_GetTick();
+    s_readStart_us = Time_NowUs32();
+    s_readPending  = true;
+
     return true;
 }
 
 /**
- * @brief Generate a simulated temperature reading.
+ * @brief Complete a simulated asynchronous conversion.
  *
- * The simulated temperature follows a simple sine wave over time:
- *   T(t) = 25.0°C + 3.0°C * sin( t / 2000 ms )
+ * @param[out] outData Filled with the measurement once done.
  *
- * This provides a smoothly varying signal around room temperature that
- * can be used to verify end-to-end data flow, logging, and visualization.
- *
- * @param[out] outData Pointer to a SensorData_t structure that will be
- *                     populated with the simulated measurement.
- *
- * @return true if the reading was generated successfully; false if the
- *         output pointer was NULL.
+ * @return SENSOR_READ_BUSY until the conversion time has elapsed, then
+ *         SENSOR_READ_DONE; SENSOR_READ_ERROR if no read was started or
+ *         @p outData is NULL.
  */
-static bool SensorSimTemp_Read(SensorData_t *outData)
+static SensorReadStatus_t SensorSimTemp_PollRead(SensorData_t *outData)
 {
-    if (outData == NULL)
+    if (!s_readPending || (outData == NULL))
     {
-        return false;
+        return SENSOR_READ_ERROR;
     }
 
-    uint32_t now_ms     = HAL_GetTick();
-    uint32_t elapsed_ms = now_ms - s_simStartTime_ms;
+    if ((HAL_GetTick() - s_readStart_ms) < SENSOR_SIM_TEMP_CONVERSION_MS)
+    {
+        return SENSOR_READ_BUSY;
+    }
 
-    /* Convert elapsed time to radians for the sine function. */
-    float phase = (float)elapsed_ms / 2000.0f;
+    s_readPending = false;
 
-    /* Base temperature = 25°C, amplitude = ±3°C. */
-    float tempC = 25.0f + 3.0f * sinf(phase);
+    SensorData_Init(outData, SENSOR_FORMAT_S16, 1U, SENSOR_SIM_TEMP_SCALE_EXP);
+    SensorData_SetFloat(outData, 0U, SensorSimTemp_Sample(s_readStart_ms));
+    outData->timestamp    = s_readStart_ms;
+    outData->timestamp_us = s_readStart_us;
 
-    outData->value     = tempC;
-    outData->timestamp = now_ms;
+    return SENSOR_READ_DONE;
+}
 
-    return true;
+
+/**
+ * @brief Simulated temperature at a given time.
+ *
+ * @param now_ms Sample time (HAL ticks).
+ *
+ * @return Temperature in °C.
+ */
+static float SensorSimTemp_Sample(uint32_t now_ms)
+{
+    uint32_t elapsed_ms = now_ms - s_simStartTime_ms;
+
+#if (SENSOR_SIM_TEMP_USE_LIBM != 0)
+    /* Reference path for comparison; the noise term is not applied. */
+    const SimWaveConfig_t *cfg = &s_wave.config;
+    float value = (float)cfg->offset;
+
+    if (cfg->period_ms != 0U)
+    {
+        /* Convert elapsed time to radians for the sine function. */
+        float phase = (6.2831853f * (float)(elapsed_ms % cfg->period_ms)) / (float)cfg->period_ms;
+        value += (float)cfg->amplitude * sinf(phase);
+    }
+
+    return value / 1000.0f;
+#else
+    return (float)SimWave_Sample(&s_wave, elapsed_ms) / 1000.0f;
+#endif
 }
@@ -4,7 +4,8 @@
  *
  * The implementation of this interface is provided in
  * sensor_sim_temp.c and is exposed to the application via
- * Sensor_GetInterface() declared in sensor_if.h.
+ * Sensor_GetInterface() declared in sensor_if.h. The entry points the
+ * board sensor table (app_sensors.h) calls directly are public as well.
  *
  * @ingroup sensors
  */
@@ -13,14 +14,99 @@
 #define SENSOR_SIM_TEMP_H
 
 #include "sensor_if.h"
+#include "sim_wave.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* No extra API for now; the application uses Sensor_GetInterface()
- * from sensor_if.h to access this implementation.
+/**
+ * @brief Use libm sinf() instead of the fixed-point sine table.
+ *
+ * Off by default: the table path avoids the libm call per sample and
+ * keeps newlib's math library out of the image.
+ */
+#ifndef SENSOR_SIM_TEMP_USE_LIBM
+#define SENSOR_SIM_TEMP_USE_LIBM   (0)
+#endif
+
+/**
+ * @brief The sensor's generic interface (same as Sensor_GetInterface()).
+ *
+ * @return Interface with init, read, startRead/pollRead and readBatch.
+ */
+const SensorIF_t *SensorSimTemp_GetInterface(void);
+
+/**
+ * @brief Initialize the sensor: the waveform phase starts at the current
+ *        tick and the simulated FIFO is emptied.
+ *
+ * @return true.
+ */
+bool SensorSimTemp_Init(void);
+
+/**
+ * @brief Take one reading now (blocking read of the SensorIF_t API).
+ *
+ * By default the temperature follows 25 °C + 3 °C * sin(t / 2000 ms);
+ * SensorSimTemp_Configure() changes the waveform.
+ *
+ * @param[out] outData Reading, int16 in 0.01 °C.
+ *
+ * @return false if @p outData is NULL.
+ */
+bool SensorSimTemp_Read(SensorData_t *outData);
+
+/**
+ * @brief Drain the simulated FIFO (readBatch of the SensorIF_t API).
+ *
+ * The sensor produces one sample per second whether or not anyone reads
+ * it; this returns the samples produced since the previous drain, oldest
+ * first, each with its own timestamp. Samples that overflowed the 32-deep
+ * FIFO are skipped and the first one after them is flagged
+ * @ref SENSOR_QUALITY_GAP.
+ *
+ * @param[out] out Destination array.
+ * @param      max Capacity of @p out.
+ *
+ * @return Number of samples written.
+ */
+size_t SensorSimTemp_ReadBatch(SensorData_t *out, size_t max);
+
+/**
+ * @brief Change the simulated waveform.
+ *
+ * Values are in milli-degrees C. Takes effect on the next sample; the
+ * phase reference stays at the time of init().
+ *
+ * @param config New waveform, or NULL to restore the default
+ *               (25 °C ± 3 °C, ~12.6 s period, no noise).
+ *
+ * @return None.
+ */
+void SensorSimTemp_Configure(const SimWaveConfig_t *config);
+
+/**
+ * @brief Read the active waveform parameters.
+ *
+ * @param[out] config Receives the parameters.
+ *
+ * @return None.
+ */
+void SensorSimTemp_GetConfig(SimWaveConfig_t *config);
+
+/**
+ * @brief Move the phase reference of the waveform.
+ *
+ * init() sets it to the current tick. The STANDBY duty cycle carries the
+ * HAL tick across wakeups and sets it to 0 after init(), so the signal
+ * continues instead of restarting at every wakeup.
+ *
+ * @param start_ms HAL tick the waveform starts at.
+ *
+ * @return None.
  */
+void SensorSimTemp_SetStartTime(uint32_t start_ms);
 
 #ifdef __cplusplus
 }
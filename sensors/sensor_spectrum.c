@@ -0,0 +1,423 @@
+/**
+ * @file sensor_spectrum.c
+ * @brief Spectral feature stage implementation.
+ *
+ * State lives in a small fixed table of slots keyed by sensor ID, like
+ * the filter and statistics stages. Each slot holds the samples of its
+ * open window in engineering units; the transform runs on a shared work
+ * buffer, so the window is free to refill while nothing else is kept.
+ *
+ * Bin powers are one-sided (doubled, except DC and Nyquist) and divided
+ * by the Hann window's mean square (3/8), so that summed over the bins
+ * they give the mean square of the detrended samples. A sine's amplitude
+ * is 2 |X[k]| / sum(w) = 4 |X[k]| / N with the Hann coherent gain of 1/2.
+ *
+ * @ingroup sensor_spectrum
+ */
+
+#include "sensor_spectrum.h"
+#include "sample_block.h"
+#include "dsp_kernels.h"
+#include "cycle_counter.h"
+#include "metrics.h"
+#include <string.h>
+
+_Static_assert(SENSOR_SPECTRUM_MAX_BANDS <= (DSP_RFFT_MIN_POINTS / 2U), "every band needs a bin");
+
+/**
+ * @brief Configuration, open window and counters of one sensor.
+ */
+typedef struct
+{
+    bool                   used;                         /**< Slot in use.              */
+    uint8_t                sensorId;                     /**< Owner.                    */
+    SensorSpectrumConfig_t config;                       /**< Settings.                 */
+    DspRfftF32_t           fft;                          /**< Transform of the length.  */
+    uint8_t                quality;                      /**< OR of sample quality.     */
+    int8_t                 scaleExp;                     /**< Scale of the samples.     */
+    uint16_t               fill;                         /**< Samples in the window.    */
+    uint32_t               first_ms;                     /**< First sample (ms).        */
+    uint32_t               first_us;                     /**< First sample (us).        */
+    uint32_t               last_us;                      /**< Latest sample (us).       */
+    float                  window[DSP_RFFT_MAX_POINTS];  /**< Samples, oldest first.    */
+    SensorSpectrumStats_t  stats;                        /**< Counters.                 */
+} SensorSpectrumSlot_t;
+
+/**
+ * @brief Spectrum slots.
+ */
+static SensorSpectrumSlot_t s_slots[SENSOR_SPECTRUM_MAX_SENSORS];
+
+/**
+ * @brief Block the samples are gathered into.
+ */
+static SampleBlock_t s_block;
+
+/**
+ * @brief Transform buffer shared by all slots.
+ */
+static float s_work[DSP_RFFT_MAX_POINTS];
+
+/**
+ * @brief Windows transformed (spectrum_windows metric).
+ */
+static uint32_t s_windows = 0U;
+
+/**
+ * @brief Longest window compute time in us (spectrum_max_us metric).
+ */
+static uint32_t s_maxUs = 0U;
+
+/**
+ * @brief Find the slot of @p sensorId, or NULL.
+ */
+static SensorSpectrumSlot_t *SensorSpectrum_Find(uint8_t sensorId);
+
+/**
+ * @brief Append one sample to the window of @p slot, restarting the
+ *        window first if the sample does not continue it.
+ */
+static void SensorSpectrum_Add(SensorSpectrumSlot_t *slot, float x, uint8_t quality,
+                               uint32_t ts_ms, uint32_t ts_us);
+
+/**
+ * @brief Transform the full window of @p slot, report it and start over.
+ */
+static void SensorSpectrum_Close(SensorSpectrumSlot_t *slot, SensorSpectrumCallback_t onSummary);
+
+/**
+ * @brief Store @p value little-endian.
+ */
+static void SensorSpectrum_PutLe(uint8_t *dst, uint32_t value);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorSpectrum_Init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+    s_windows = 0U;
+    s_maxUs   = 0U;
+
+    Metrics_Publish(METRIC_SPECTRUM_WINDOWS, &s_windows);
+    Metrics_Publish(METRIC_SPECTRUM_MAX_US, &s_maxUs);
+}
+
+bool SensorSpectrum_Configure(uint8_t sensorId, const SensorSpectrumConfig_t *config)
+{
+    if (config == NULL)
+    {
+        return false;
+    }
+
+    SensorSpectrumSlot_t *slot = SensorSpectrum_Find(sensorId);
+
+    if (config->points == 0U)
+    {
+        if (slot != NULL)
+        {
+            slot->used = false;
+        }
+        return true;
+    }
+
+    DspRfftF32_t fft;
+    if (!Dsp_RfftInitF32(&fft, config->points) ||
+        (config->bands == 0U) || (config->bands > SENSOR_SPECTRUM_MAX_BANDS))
+    {
+        return false;
+    }
+
+    if (slot == NULL)
+    {
+        for (uint32_t i = 0U; i < SENSOR_SPECTRUM_MAX_SENSORS; ++i)
+        {
+            if (!s_slots[i].used)
+            {
+                slot = &s_slots[i];
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->used     = true;
+    slot->sensorId = sensorId;
+    slot->config   = *config;
+    slot->fft      = fft;
+
+    return true;
+}
+
+bool SensorSpectrum_Get(uint8_t sensorId, SensorSpectrumConfig_t *config, SensorSpectrumStats_t *stats)
+{
+    const SensorSpectrumSlot_t *slot = SensorSpectrum_Find(sensorId);
+
+    if (config != NULL)
+    {
+        if (slot != NULL)
+        {
+            *config = slot->config;
+        }
+        else
+        {
+            memset(config, 0, sizeof(*config));
+        }
+    }
+
+    if (stats != NULL)
+    {
+        if (slot != NULL)
+        {
+            *stats         = slot->stats;
+            stats->samples = slot->fill;
+        }
+        else
+        {
+            memset(stats, 0, sizeof(*stats));
+        }
+    }
+
+    return (slot != NULL);
+}
+
+bool SensorSpectrum_IsConfigured(uint8_t sensorId)
+{
+    return (SensorSpectrum_Find(sensorId) != NULL);
+}
+
+void SensorSpectrum_ProcessSamples(const SensorSample_t *samples, size_t count,
+                                   SensorSpectrumCallback_t onSummary)
+{
+    if (samples == NULL)
+    {
+        return;
+    }
+
+    float  values[SAMPLE_BLOCK_MAX];
+    size_t start = 0U;
+
+    while (start < count)
+    {
+        size_t                n    = SampleBlock_Gather(&s_block, &samples[start], count - start);
+        SensorSpectrumSlot_t *slot = SensorSpectrum_Find(s_block.sensorId);
+
+        if (slot != NULL)
+        {
+            if ((slot->fill != 0U) && (s_block.scaleExp != slot->scaleExp))
+            {
+                slot->fill = 0U;
+                slot->stats.restarts++;
+            }
+            slot->scaleExp = s_block.scaleExp;
+
+            SampleBlock_ToFloat(&s_block, 0U, values);
+
+            for (size_t i = 0U; i < n; ++i)
+            {
+                const SensorSample_t *s = &samples[start + i];
+
+                SensorSpectrum_Add(slot, values[i], s_block.quality[i], s->timestamp, s->timestamp_us);
+                if (slot->fill == slot->config.points)
+                {
+                    SensorSpectrum_Close(slot, onSummary);
+                }
+            }
+        }
+
+        start += n;
+    }
+}
+
+size_t SensorSpectrum_Encode(const SensorSpectrumSummary_t *summary, uint8_t *out)
+{
+    const float head[3] = { summary->rms, summary->peakHz, summary->peak };
+    uint32_t    bits;
+
+    out[0] = summary->sensorId;
+    out[1] = summary->quality;
+    out[2] = summary->bands;
+    out[3] = (uint8_t)summary->points;
+    out[4] = (uint8_t)(summary->points >> 8);
+    SensorSpectrum_PutLe(&out[5], summary->period_us);
+    SensorSpectrum_PutLe(&out[9], summary->cycles);
+
+    for (uint32_t v = 0U; v < 3U; ++v)
+    {
+        memcpy(&bits, &head[v], sizeof(bits));
+        SensorSpectrum_PutLe(&out[13U + (4U * v)], bits);
+    }
+
+    for (uint32_t b = 0U; b < summary->bands; ++b)
+    {
+        memcpy(&bits, &summary->band[b], sizeof(bits));
+        SensorSpectrum_PutLe(&out[25U + (4U * b)], bits);
+    }
+
+    return SENSOR_SPECTRUM_RECORD_SIZE(summary->bands);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorSpectrumSlot_t *SensorSpectrum_Find(uint8_t sensorId)
+{
+    for (uint32_t i = 0U; i < SENSOR_SPECTRUM_MAX_SENSORS; ++i)
+    {
+        if (s_slots[i].used && (s_slots[i].sensorId == sensorId))
+        {
+            return &s_slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void SensorSpectrum_Add(SensorSpectrumSlot_t *slot, float x, uint8_t quality,
+                               uint32_t ts_ms, uint32_t ts_us)
+{
+    if (slot->fill != 0U)
+    {
+        uint32_t dt = ts_us - slot->last_us;
+        bool     gap;
+
+        if (slot->fill == 1U)
+        {
+            gap = (dt == 0U) || (dt > 0x7FFFFFFFU);
+        }
+        else
+        {
+            uint32_t period = (slot->last_us - slot->first_us) / (slot->fill - 1U);
+            uint32_t diff   = (dt > period) ? (dt - period) : (period - dt);
+
+            gap = (diff > (period / 2U));
+        }
+
+        if (gap)
+        {
+            slot->fill = 0U;
+            slot->stats.restarts++;
+        }
+    }
+
+    if (slot->fill == 0U)
+    {
+        slot->quality  = 0U;
+        slot->first_ms = ts_ms;
+        slot->first_us = ts_us;
+    }
+
+    slot->window[slot->fill] = x;
+    slot->fill++;
+    slot->quality |= quality;
+    slot->last_us  = ts_us;
+}
+
+static void SensorSpectrum_Close(SensorSpectrumSlot_t *slot, SensorSpectrumCallback_t onSummary)
+{
+    uint32_t t0    = CycleCounter_Now();
+    uint32_t n     = slot->config.points;
+    uint32_t half  = n / 2U;
+    uint32_t bands = slot->config.bands;
+    float    mean  = 0.0f;
+    float    ms    = 0.0f;
+
+    SensorSpectrumSummary_t summary =
+    {
+        .sensorId  = slot->sensorId,
+        .quality   = slot->quality,
+        .bands     = (uint8_t)bands,
+        .scaleExp  = slot->scaleExp,
+        .points    = (uint16_t)n,
+        .start_ms  = slot->first_ms
+    };
+
+    for (uint32_t i = 0U; i < n; ++i)
+    {
+        mean += slot->window[i];
+    }
+    mean /= (float)n;
+
+    for (uint32_t i = 0U; i < n; ++i)
+    {
+        float d = slot->window[i] - mean;
+
+        s_work[i] = d;
+        ms       += d * d;
+    }
+    summary.rms = Dsp_SqrtF32(ms / (float)n);
+
+    Dsp_WindowHannF32(&slot->fft, s_work);
+    Dsp_RfftF32(&slot->fft, s_work);
+
+    /* One-sided power over the window's mean square: 2 / (N^2 * 3/8). */
+    float    scale = 16.0f / (3.0f * (float)n * (float)n);
+    float    peakP = 0.0f;
+    uint32_t peakK = 1U;
+
+    for (uint32_t k = 1U; k <= half; ++k)
+    {
+        float p;
+
+        if (k == half)
+        {
+            p = 0.5f * scale * s_work[1] * s_work[1];
+        }
+        else
+        {
+            p = scale * ((s_work[2U * k] * s_work[2U * k]) + (s_work[(2U * k) + 1U] * s_work[(2U * k) + 1U]));
+        }
+
+        if (p > peakP)
+        {
+            peakP = p;
+            peakK = k;
+        }
+
+        /* Bins 1..N/2 split into equal bands. */
+        summary.band[((k - 1U) * bands) / half] += p;
+    }
+
+    float period_us   = (float)(slot->last_us - slot->first_us) / (float)(n - 1U);
+    summary.period_us = (uint32_t)(period_us + 0.5f);
+    summary.peakHz    = (period_us > 0.0f) ? ((float)peakK * 1.0e6f / ((float)n * period_us)) : 0.0f;
+
+    /* |X| = sqrt(p / scale) (doubled bins), amplitude 4 |X| / N. */
+    float bin    = (peakK == half) ? (2.0f * peakP) : peakP;
+    summary.peak = 4.0f * Dsp_SqrtF32(bin / scale) / (float)n;
+
+    uint32_t cycles = CycleCounter_Now() - t0;
+    uint32_t us     = CycleCounter_ToUs(cycles);
+
+    summary.cycles         = cycles;
+    slot->stats.lastCycles = cycles;
+    if (cycles > slot->stats.maxCycles)
+    {
+        slot->stats.maxCycles = cycles;
+    }
+    if (us > s_maxUs)
+    {
+        s_maxUs = us;
+    }
+    slot->stats.windows++;
+    s_windows++;
+    slot->fill = 0U;
+
+    if (onSummary != NULL)
+    {
+        onSummary(&summary);
+    }
+}
+
+static void SensorSpectrum_PutLe(uint8_t *dst, uint32_t value)
+{
+    for (uint32_t b = 0U; b < 4U; ++b)
+    {
+        dst[b] = (uint8_t)(value >> (8U * b));
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * @file sensor_spectrum.h
+ * @brief Spectral features (RMS, peak, band energies) per window of samples.
+ *
+ * For a configured sensor, filtered samples of channel 0 are collected
+ * into windows of a fixed number of points instead of going to the
+ * outputs. Each full window is detrended (mean removed), Hann-windowed
+ * and transformed with Dsp_RfftF32(), and one
+ * @ref SensorSpectrumSummary_t replaces it: a 256-point window of 16-bit
+ * samples (512 bytes of raw data, more as records) becomes one record of
+ * a few dozen bytes.
+ *
+ * Per window:
+ *
+ *     rms      AC RMS of the samples (the mean is removed first)
+ *     peak     frequency and amplitude of the strongest bin above DC
+ *     bands    mean square per band of equal width from DC to Nyquist,
+ *              so the bands add up to about rms^2 (Parseval)
+ *
+ * The sample rate is measured from the timestamps (us) of the window.
+ * A window is restarted on a gap (an interval more than half a sample
+ * period away from the window's mean), so the spectrum never spans a
+ * dropout. The CPU time of every window, in cycles, goes into the
+ * summary, the counters and the spectrum_max_us metric.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_SPECTRUM_H
+#define SENSOR_SPECTRUM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sample_ring.h"
+
+/**
+ * @defgroup sensor_spectrum Sensor Spectrum
+ * @brief Per-window spectral features of sensor samples.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of sensors that can have a spectrum configuration. */
+#define SENSOR_SPECTRUM_MAX_SENSORS   (2U)
+
+/** @brief Largest number of bands per window. */
+#define SENSOR_SPECTRUM_MAX_BANDS     (8U)
+
+/** @brief Telemetry frame type of spectrum records. */
+#define SENSOR_SPECTRUM_FRAME_TYPE    (0x0AU)
+
+/**
+ * @brief Encoded size of a record with @p bands bands:
+ *        id:u8 quality:u8 bands:u8 points:u16 period_us:u32 cycles:u32
+ *        rms:f32 peak_hz:f32 peak:f32 band:f32 * bands
+ */
+#define SENSOR_SPECTRUM_RECORD_SIZE(bands)   (25U + (4U * (bands)))
+
+/** @brief Largest encoded record. */
+#define SENSOR_SPECTRUM_RECORD_MAX   SENSOR_SPECTRUM_RECORD_SIZE(SENSOR_SPECTRUM_MAX_BANDS)
+
+/**
+ * @brief Spectrum settings of one sensor.
+ */
+typedef struct
+{
+    uint16_t points; /**< Window length (power of two, 16..256); 0 removes. */
+    uint8_t  bands;  /**< Bands, 1..@ref SENSOR_SPECTRUM_MAX_BANDS.        */
+} SensorSpectrumConfig_t;
+
+/**
+ * @brief Features of one window.
+ */
+typedef struct
+{
+    uint8_t  sensorId;   /**< Sensor.                                        */
+    uint8_t  quality;    /**< OR of the quality bits of every sample.        */
+    uint8_t  bands;      /**< Entries in @ref band.                          */
+    int8_t   scaleExp;   /**< Scale of the sensor's samples.                 */
+    uint16_t points;     /**< Samples in the window.                         */
+    uint32_t start_ms;   /**< Timestamp of the first sample.                 */
+    uint32_t period_us;  /**< Mean sample interval.                          */
+    uint32_t cycles;     /**< CPU cycles spent on the window.                */
+    float    rms;        /**< AC RMS, in engineering units.                  */
+    float    peakHz;     /**< Frequency of the strongest bin above DC.       */
+    float    peak;       /**< Amplitude of a sine at @ref peakHz.            */
+    float    band[SENSOR_SPECTRUM_MAX_BANDS]; /**< Mean square per band.     */
+} SensorSpectrumSummary_t;
+
+/**
+ * @brief Called for every closed window.
+ *
+ * @param summary The window's features.
+ */
+typedef void (*SensorSpectrumCallback_t)(const SensorSpectrumSummary_t *summary);
+
+/**
+ * @brief Per-sensor counters.
+ */
+typedef struct
+{
+    uint32_t windows;    /**< Summaries emitted.                      */
+    uint32_t samples;    /**< Samples in the open window.             */
+    uint32_t restarts;   /**< Windows discarded on a gap.             */
+    uint32_t lastCycles; /**< CPU cycles of the last window.          */
+    uint32_t maxCycles;  /**< Most CPU cycles of one window.          */
+} SensorSpectrumStats_t;
+
+/**
+ * @brief Remove all spectrum configurations and publish the metrics.
+ *
+ * @return None.
+ */
+void SensorSpectrum_Init(void);
+
+/**
+ * @brief Set (or replace) the spectrum window of a sensor.
+ *
+ * The open window is discarded. A length of 0 removes the configuration.
+ *
+ * @param sensorId Registry ID.
+ * @param config   Settings.
+ *
+ * @return false if @p config is invalid or no slot is free.
+ */
+bool SensorSpectrum_Configure(uint8_t sensorId, const SensorSpectrumConfig_t *config);
+
+/**
+ * @brief Get the settings and counters of a sensor.
+ *
+ * @param sensorId    Registry ID.
+ * @param[out] config Receives the settings (may be NULL).
+ * @param[out] stats  Receives the counters (may be NULL).
+ *
+ * @return true if the sensor has a configuration.
+ */
+bool SensorSpectrum_Get(uint8_t sensorId, SensorSpectrumConfig_t *config, SensorSpectrumStats_t *stats);
+
+/**
+ * @brief Whether samples of @p sensorId go into spectrum windows.
+ *
+ * Such samples are not output on their own.
+ *
+ * @param sensorId Registry ID.
+ *
+ * @return true if the sensor has a configuration.
+ */
+bool SensorSpectrum_IsConfigured(uint8_t sensorId);
+
+/**
+ * @brief Add filtered samples to the windows of their sensors.
+ *
+ * Samples are taken in struct-of-arrays blocks (SampleBlock_Gather());
+ * every window that fills is transformed and reported through
+ * @p onSummary before the call returns.
+ *
+ * @param samples   Samples, oldest first; not modified.
+ * @param count     Number of samples.
+ * @param onSummary Receives closed windows (may be NULL).
+ *
+ * @return None.
+ */
+void SensorSpectrum_ProcessSamples(const SensorSample_t *samples, size_t count,
+                                   SensorSpectrumCallback_t onSummary);
+
+/**
+ * @brief Encode a summary as a @ref SENSOR_SPECTRUM_FRAME_TYPE record.
+ *
+ * @param summary Summary.
+ * @param[out] out @ref SENSOR_SPECTRUM_RECORD_MAX bytes, little-endian.
+ *
+ * @return SENSOR_SPECTRUM_RECORD_SIZE(summary->bands).
+ */
+size_t SensorSpectrum_Encode(const SensorSpectrumSummary_t *summary, uint8_t *out);
+
+/** @} */ /* end of sensor_spectrum group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_SPECTRUM_H */
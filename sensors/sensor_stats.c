@@ -0,0 +1,448 @@
+/**
+ * @file sensor_stats.c
+ * @brief Windowed statistics implementation.
+ *
+ * State lives in a small fixed table of slots keyed by sensor ID, like
+ * the filter and deadband stages. Each slot holds the running Welford
+ * terms and the five P² markers (heights, positions and desired
+ * positions). P² is poor while the markers are still close together, so
+ * the first @ref SENSOR_STATS_EXACT_SAMPLES samples are kept sorted,
+ * which gives an exact percentile for windows that small, and the
+ * markers start from that buffer at its percentile ranks.
+ *
+ * The firmware does not link libm, so the standard deviation uses
+ * Dsp_SqrtF32() instead of sqrtf().
+ *
+ * @ingroup sensor_stats
+ */
+
+#include "sensor_stats.h"
+#include "dsp_kernels.h"
+#include <string.h>
+
+/** @brief Markers of the P² estimator. */
+#define SENSOR_STATS_P2_MARKERS   (5U)
+
+/** @brief Samples per window kept for an exact percentile before P² takes over. */
+#define SENSOR_STATS_EXACT_SAMPLES   (16U)
+
+/**
+ * @brief Configuration, open window and counters of one sensor.
+ */
+typedef struct
+{
+    bool                used;                          /**< Slot in use.              */
+    uint8_t             sensorId;                      /**< Owner.                    */
+    SensorStatsConfig_t config;                        /**< Settings.                 */
+    bool                open;                          /**< A window has samples.     */
+    uint8_t             quality;                       /**< OR of sample quality.     */
+    int8_t              scaleExp;                      /**< Scale of the samples.     */
+    uint32_t            start_ms;                      /**< Start of the open window. */
+    uint32_t            count;                         /**< Samples in the window.    */
+    float               min;                           /**< Smallest value.           */
+    float               max;                           /**< Largest value.            */
+    float               mean;                          /**< Welford mean.             */
+    float               m2;                            /**< Welford sum of squares.   */
+    float               sorted[SENSOR_STATS_EXACT_SAMPLES]; /**< First samples, sorted. */
+    float               q[SENSOR_STATS_P2_MARKERS];    /**< P² marker heights.        */
+    float               np[SENSOR_STATS_P2_MARKERS];   /**< P² desired positions.     */
+    int32_t             n[SENSOR_STATS_P2_MARKERS];    /**< P² marker positions.      */
+    uint32_t            windows;                       /**< Summaries emitted.        */
+} SensorStatsSlot_t;
+
+/**
+ * @brief Statistics slots.
+ */
+static SensorStatsSlot_t s_slots[SENSOR_STATS_MAX_SENSORS];
+
+/**
+ * @brief Find the slot of @p sensorId, or NULL.
+ */
+static SensorStatsSlot_t *SensorStats_Find(uint8_t sensorId);
+
+/**
+ * @brief Report the open window of @p slot and start over.
+ */
+static void SensorStats_Close(SensorStatsSlot_t *slot, SensorStatsCallback_t onSummary);
+
+/**
+ * @brief Start the P² markers from the full sorted buffer of @p slot.
+ */
+static void SensorStats_P2Start(SensorStatsSlot_t *slot, float p);
+
+/**
+ * @brief Feed one value to the percentile estimator of @p slot (count
+ *        already includes it).
+ */
+static void SensorStats_P2Add(SensorStatsSlot_t *slot, float x);
+
+/**
+ * @brief Current percentile estimate of @p slot.
+ */
+static float SensorStats_P2Value(const SensorStatsSlot_t *slot);
+
+/**
+ * @brief Store @p value little-endian.
+ */
+static void SensorStats_PutLe(uint8_t *dst, uint32_t value);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorStats_Init(void)
+{
+    memset(s_slots, 0, sizeof(s_slots));
+}
+
+bool SensorStats_Configure(uint8_t sensorId, const SensorStatsConfig_t *config)
+{
+    if ((config == NULL) || (config->percentile > 99U) || (config->window_ms > 0x7FFFFFFFU))
+    {
+        return false;
+    }
+
+    SensorStatsSlot_t *slot = SensorStats_Find(sensorId);
+
+    if (config->window_ms == 0U)
+    {
+        if (slot != NULL)
+        {
+            slot->used = false;
+        }
+        return true;
+    }
+
+    if (slot == NULL)
+    {
+        for (uint32_t i = 0U; i < SENSOR_STATS_MAX_SENSORS; ++i)
+        {
+            if (!s_slots[i].used)
+            {
+                slot = &s_slots[i];
+                break;
+            }
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->used     = true;
+    slot->sensorId = sensorId;
+    slot->config   = *config;
+
+    return true;
+}
+
+bool SensorStats_Get(uint8_t sensorId, SensorStatsConfig_t *config, SensorStatsStats_t *stats)
+{
+    const SensorStatsSlot_t *slot = SensorStats_Find(sensorId);
+
+    if (config != NULL)
+    {
+        if (slot != NULL)
+        {
+            *config = slot->config;
+        }
+        else
+        {
+            memset(config, 0, sizeof(*config));
+        }
+    }
+
+    if (stats != NULL)
+    {
+        stats->windows = (slot != NULL) ? slot->windows : 0U;
+        stats->samples = ((slot != NULL) && slot->open) ? slot->count : 0U;
+    }
+
+    return (slot != NULL);
+}
+
+bool SensorStats_Add(const SensorData_t *sample, SensorStatsCallback_t onSummary)
+{
+    if (sample == NULL)
+    {
+        return false;
+    }
+
+    SensorStatsSlot_t *slot = SensorStats_Find(sample->sensorId);
+    if (slot == NULL)
+    {
+        return false;
+    }
+
+    uint32_t window = slot->config.window_ms;
+    uint32_t ts     = sample->timestamp;
+
+    /* A late sample (before the window start) still counts in the open one. */
+    if (slot->open && ((int32_t)(ts - slot->start_ms) >= (int32_t)window))
+    {
+        SensorStats_Close(slot, onSummary);
+    }
+
+    float x = SensorData_GetFloat(sample, 0U);
+
+    if (!slot->open)
+    {
+        slot->open     = true;
+        slot->start_ms = ts - (ts % window);
+        slot->scaleExp = sample->scaleExp;
+        slot->quality  = 0U;
+        slot->count    = 0U;
+        slot->min      = x;
+        slot->max      = x;
+        slot->mean     = 0.0f;
+        slot->m2       = 0.0f;
+    }
+
+    slot->count++;
+    slot->quality |= sample->quality;
+    if (x < slot->min)
+    {
+        slot->min = x;
+    }
+    if (x > slot->max)
+    {
+        slot->max = x;
+    }
+
+    float delta = x - slot->mean;
+    slot->mean += delta / (float)slot->count;
+    slot->m2   += delta * (x - slot->mean);
+
+    if (slot->config.percentile != 0U)
+    {
+        SensorStats_P2Add(slot, x);
+    }
+
+    return true;
+}
+
+void SensorStats_Service(uint32_t now_ms, SensorStatsCallback_t onSummary)
+{
+    for (uint32_t i = 0U; i < SENSOR_STATS_MAX_SENSORS; ++i)
+    {
+        SensorStatsSlot_t *slot = &s_slots[i];
+
+        if (slot->used && slot->open)
+        {
+            uint32_t window = slot->config.window_ms;
+
+            if ((int32_t)(now_ms - slot->start_ms) >= (int32_t)(2U * window))
+            {
+                SensorStats_Close(slot, onSummary);
+            }
+        }
+    }
+}
+
+size_t SensorStats_Encode(const SensorStatsSummary_t *summary, uint8_t *out)
+{
+    const float values[5] =
+    {
+        summary->min, summary->max, summary->mean, summary->stddev, summary->pctValue
+    };
+
+    out[0] = summary->sensorId;
+    out[1] = summary->quality;
+    out[2] = summary->percentile;
+    SensorStats_PutLe(&out[3], summary->count);
+    SensorStats_PutLe(&out[7], summary->window_ms);
+
+    for (uint32_t v = 0U; v < 5U; ++v)
+    {
+        uint32_t bits;
+        memcpy(&bits, &values[v], sizeof(bits));
+        SensorStats_PutLe(&out[11U + (4U * v)], bits);
+    }
+
+    return SENSOR_STATS_RECORD_SIZE;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static SensorStatsSlot_t *SensorStats_Find(uint8_t sensorId)
+{
+    for (uint32_t i = 0U; i < SENSOR_STATS_MAX_SENSORS; ++i)
+    {
+        if (s_slots[i].used && (s_slots[i].sensorId == sensorId))
+        {
+            return &s_slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void SensorStats_Close(SensorStatsSlot_t *slot, SensorStatsCallback_t onSummary)
+{
+    SensorStatsSummary_t summary =
+    {
+        .sensorId   = slot->sensorId,
+        .quality    = slot->quality,
+        .percentile = slot->config.percentile,
+        .scaleExp   = slot->scaleExp,
+        .start_ms   = slot->start_ms,
+        .window_ms  = slot->config.window_ms,
+        .count      = slot->count,
+        .min        = slot->min,
+        .max        = slot->max,
+        .mean       = slot->mean,
+        .stddev     = (slot->count > 1U) ? Dsp_SqrtF32(slot->m2 / (float)(slot->count - 1U)) : 0.0f,
+        .pctValue   = (slot->config.percentile != 0U) ? SensorStats_P2Value(slot) : 0.0f
+    };
+
+    slot->open = false;
+    slot->windows++;
+
+    if (onSummary != NULL)
+    {
+        onSummary(&summary);
+    }
+}
+
+static void SensorStats_P2Start(SensorStatsSlot_t *slot, float p)
+{
+    const float frac[SENSOR_STATS_P2_MARKERS] = { 0.0f, p / 2.0f, p, (1.0f + p) / 2.0f, 1.0f };
+    const float last = (float)(SENSOR_STATS_EXACT_SAMPLES - 1U);
+    int32_t    *n    = slot->n;
+
+    for (uint32_t i = 0U; i < SENSOR_STATS_P2_MARKERS; ++i)
+    {
+        slot->np[i] = frac[i] * last;
+        n[i]        = (int32_t)(slot->np[i] + 0.5f);
+    }
+
+    /* Markers need distinct positions: leave room for the others at both
+       ends, then push apart upwards (which stays within that room). */
+    for (uint32_t i = 0U; i < SENSOR_STATS_P2_MARKERS; ++i)
+    {
+        int32_t lo = (int32_t)i;
+        int32_t hi = (int32_t)(SENSOR_STATS_EXACT_SAMPLES - SENSOR_STATS_P2_MARKERS + i);
+
+        n[i] = (n[i] < lo) ? lo : ((n[i] > hi) ? hi : n[i]);
+        if ((i > 0U) && (n[i] <= n[i - 1U]))
+        {
+            n[i] = n[i - 1U] + 1;
+        }
+    }
+
+    for (uint32_t i = 0U; i < SENSOR_STATS_P2_MARKERS; ++i)
+    {
+        slot->q[i] = slot->sorted[n[i]];
+    }
+}
+
+static void SensorStats_P2Add(SensorStatsSlot_t *slot, float x)
+{
+    float   *q = slot->q;
+    int32_t *n = slot->n;
+    float    p = (float)slot->config.percentile / 100.0f;
+
+    if (slot->count <= SENSOR_STATS_EXACT_SAMPLES)
+    {
+        /* Insertion into the exact buffer. */
+        uint32_t j = slot->count - 1U;
+        while ((j > 0U) && (slot->sorted[j - 1U] > x))
+        {
+            slot->sorted[j] = slot->sorted[j - 1U];
+            j--;
+        }
+        slot->sorted[j] = x;
+        return;
+    }
+
+    if (slot->count == (SENSOR_STATS_EXACT_SAMPLES + 1U))
+    {
+        SensorStats_P2Start(slot, p);
+    }
+
+    /* Cell of x; the extreme markers follow the min and max. */
+    uint32_t k;
+    if (x < q[0])
+    {
+        q[0] = x;
+        k    = 0U;
+    }
+    else if (x >= q[4])
+    {
+        q[4] = (x > q[4]) ? x : q[4];
+        k    = 3U;
+    }
+    else
+    {
+        k = 0U;
+        while (x >= q[k + 1U])
+        {
+            k++;
+        }
+    }
+
+    for (uint32_t i = k + 1U; i < SENSOR_STATS_P2_MARKERS; ++i)
+    {
+        n[i]++;
+    }
+
+    const float dn[SENSOR_STATS_P2_MARKERS] = { 0.0f, p / 2.0f, p, (1.0f + p) / 2.0f, 1.0f };
+    for (uint32_t i = 0U; i < SENSOR_STATS_P2_MARKERS; ++i)
+    {
+        slot->np[i] += dn[i];
+    }
+
+    /* Move the middle markers towards their desired positions. */
+    for (uint32_t i = 1U; i < (SENSOR_STATS_P2_MARKERS - 1U); ++i)
+    {
+        float d = slot->np[i] - (float)n[i];
+
+        if (((d >= 1.0f) && ((n[i + 1U] - n[i]) > 1)) ||
+            ((d <= -1.0f) && ((n[i - 1U] - n[i]) < -1)))
+        {
+            int32_t s  = (d >= 0.0f) ? 1 : -1;
+            float   fs = (float)s;
+
+            /* Piecewise-parabolic prediction. */
+            float qp = q[i] + ((fs / (float)(n[i + 1U] - n[i - 1U])) *
+                       ((((float)(n[i] - n[i - 1U]) + fs) * (q[i + 1U] - q[i]) /
+                         (float)(n[i + 1U] - n[i])) +
+                        (((float)(n[i + 1U] - n[i]) - fs) * (q[i] - q[i - 1U]) /
+                         (float)(n[i] - n[i - 1U]))));
+
+            if ((q[i - 1U] < qp) && (qp < q[i + 1U]))
+            {
+                q[i] = qp;
+            }
+            else
+            {
+                /* Linear fallback keeps the markers ordered. */
+                uint32_t j = (s > 0) ? (i + 1U) : (i - 1U);
+                q[i] += fs * (q[j] - q[i]) / (float)(n[j] - n[i]);
+            }
+            n[i] += s;
+        }
+    }
+}
+
+static float SensorStats_P2Value(const SensorStatsSlot_t *slot)
+{
+    if (slot->count > SENSOR_STATS_EXACT_SAMPLES)
+    {
+        return slot->q[2];
+    }
+
+    /* Nearest rank over the sorted samples. */
+    uint32_t rank = ((slot->config.percentile * slot->count) + 99U) / 100U;
+    return slot->sorted[(rank > 0U) ? (rank - 1U) : 0U];
+}
+
+static void SensorStats_PutLe(uint8_t *dst, uint32_t value)
+{
+    for (uint32_t b = 0U; b < 4U; ++b)
+    {
+        dst[b] = (uint8_t)(value >> (8U * b));
+    }
+}
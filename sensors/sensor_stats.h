@@ -0,0 +1,170 @@
+/**
+ * @file sensor_stats.h
+ * @brief Windowed statistics (min/max/mean/stddev/percentile) per sensor.
+ *
+ * For a configured sensor, every filtered sample goes into the current
+ * window instead of the outputs, and one @ref SensorStatsSummary_t per
+ * window replaces them: at 1 Hz a one-minute window turns 60 records into
+ * one. Mean and variance use Welford's update (one pass, no sum of
+ * squares to cancel), and the optional percentile is tracked with the P²
+ * estimator (Jain & Chlamtac), five markers and no sample storage.
+ *
+ * Windows are aligned to multiples of the window length on the sample
+ * timestamps, so windows of different sensors line up. A window closes on
+ * the first sample at or beyond its end, or from SensorStats_Service()
+ * one window length after its end if the sensor stopped delivering.
+ * Statistics are over channel 0, in engineering units.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_STATS_H
+#define SENSOR_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sensor_if.h"
+
+/**
+ * @defgroup sensor_stats Sensor Statistics
+ * @brief Per-window summaries of sensor samples.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief Number of sensors that can have a statistics configuration. */
+#define SENSOR_STATS_MAX_SENSORS   (8U)
+
+/** @brief Telemetry frame type of summary records. */
+#define SENSOR_STATS_FRAME_TYPE    (0x06U)
+
+/**
+ * @brief Encoded size of one summary record:
+ *        id:u8 quality:u8 pct:u8 count:u32 window_ms:u32
+ *        min:f32 max:f32 mean:f32 stddev:f32 pctValue:f32
+ */
+#define SENSOR_STATS_RECORD_SIZE   (31U)
+
+/**
+ * @brief Statistics settings of one sensor.
+ */
+typedef struct
+{
+    uint32_t window_ms;  /**< Window length; 0 removes the configuration. */
+    uint8_t  percentile; /**< Percentile to estimate (1..99), 0 = none.   */
+} SensorStatsConfig_t;
+
+/**
+ * @brief Summary of one window.
+ */
+typedef struct
+{
+    uint8_t  sensorId;   /**< Sensor.                                        */
+    uint8_t  quality;    /**< OR of the quality bits of every sample.        */
+    uint8_t  percentile; /**< Percentile in @ref pctValue (0: none).         */
+    int8_t   scaleExp;   /**< Scale of the sensor's samples.                 */
+    uint32_t start_ms;   /**< Window start (sample timestamp clock).         */
+    uint32_t window_ms;  /**< Window length.                                 */
+    uint32_t count;      /**< Samples in the window (at least 1).            */
+    float    min;        /**< Smallest value.                                */
+    float    max;        /**< Largest value.                                 */
+    float    mean;       /**< Mean.                                          */
+    float    stddev;     /**< Sample standard deviation (0 for one sample).  */
+    float    pctValue;   /**< Estimated percentile (exact to 16 samples).  */
+} SensorStatsSummary_t;
+
+/**
+ * @brief Called for every closed window.
+ *
+ * @param summary The window's summary.
+ */
+typedef void (*SensorStatsCallback_t)(const SensorStatsSummary_t *summary);
+
+/**
+ * @brief Per-sensor counters.
+ */
+typedef struct
+{
+    uint32_t windows; /**< Summaries emitted.                */
+    uint32_t samples; /**< Samples in the open window.       */
+} SensorStatsStats_t;
+
+/**
+ * @brief Remove all statistics configurations.
+ *
+ * @return None.
+ */
+void SensorStats_Init(void);
+
+/**
+ * @brief Set (or replace) the window of a sensor.
+ *
+ * The open window is discarded. A window of 0 removes the configuration.
+ *
+ * @param sensorId Registry ID.
+ * @param config   Settings.
+ *
+ * @return false if @p config is invalid or no slot is free.
+ */
+bool SensorStats_Configure(uint8_t sensorId, const SensorStatsConfig_t *config);
+
+/**
+ * @brief Get the settings and counters of a sensor.
+ *
+ * @param sensorId    Registry ID.
+ * @param[out] config Receives the settings (may be NULL).
+ * @param[out] stats  Receives the counters (may be NULL).
+ *
+ * @return true if the sensor has a configuration.
+ */
+bool SensorStats_Get(uint8_t sensorId, SensorStatsConfig_t *config, SensorStatsStats_t *stats);
+
+/**
+ * @brief Add a filtered sample to its sensor's window.
+ *
+ * Closes the open window first (reporting it through @p onSummary) if
+ * the sample lies at or beyond its end.
+ *
+ * @param sample    Sample.
+ * @param onSummary Receives closed windows (may be NULL).
+ *
+ * @return true if the sensor is aggregated, i.e. the sample should not be
+ *         output on its own.
+ */
+bool SensorStats_Add(const SensorData_t *sample, SensorStatsCallback_t onSummary);
+
+/**
+ * @brief Close windows of sensors that stopped delivering samples.
+ *
+ * A window is closed once @p now_ms is a full window length past its
+ * end, which leaves time for FIFO sensors to deliver late samples.
+ *
+ * @param now_ms    Current time on the sample timestamp clock.
+ * @param onSummary Receives closed windows (may be NULL).
+ *
+ * @return None.
+ */
+void SensorStats_Service(uint32_t now_ms, SensorStatsCallback_t onSummary);
+
+/**
+ * @brief Encode a summary as a @ref SENSOR_STATS_FRAME_TYPE record.
+ *
+ * @param summary Summary.
+ * @param[out] out @ref SENSOR_STATS_RECORD_SIZE bytes, little-endian.
+ *
+ * @return @ref SENSOR_STATS_RECORD_SIZE.
+ */
+size_t SensorStats_Encode(const SensorStatsSummary_t *summary, uint8_t *out);
+
+/** @} */ /* end of sensor_stats group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_STATS_H */
@@ -0,0 +1,445 @@
+/**
+ * @file sensor_sync.c
+ * @brief Synchronous acquisition group implementation.
+ *
+ * TIM3 counts at SENSOR_SYNC_TIMER_HZ and raises an update interrupt at
+ * the group rate. The interrupt takes the trigger time, reads the members
+ * and queues a frame; SensorSync_Drain() hands the frames to the registry
+ * in task context. The frame FIFO has one producer (the interrupt) and
+ * one consumer (the drain), like the sample ring, so it needs no lock.
+ * Registers are accessed directly; the HAL TIM driver is not part of this
+ * project.
+ *
+ * @ingroup sensor_sync
+ */
+
+#include "sensor_sync.h"
+#include "periph_power.h"
+#include "time_base.h"
+#include "cli.h"
+#include "log.h"
+#include "app_config.h"
+#include "irq_plan.h"
+#include "stm32f4xx_hal.h"
+#include <stdlib.h>
+#include <string.h>
+
+_Static_assert(SENSOR_SYNC_MAX_MEMBERS <= 8U, "okMask holds one bit per member");
+
+/**
+ * @brief One trigger: a reading of every member at the same instant.
+ */
+typedef struct
+{
+    uint32_t     timestamp;                      /**< Trigger time (HAL tick).       */
+    uint32_t     timestamp_us;                   /**< Trigger time (Time_NowUs32()). */
+    uint8_t      count;                          /**< Members read.                  */
+    uint8_t      okMask;                         /**< Bit n: read n succeeded.       */
+    uint8_t      id[SENSOR_SYNC_MAX_MEMBERS];    /**< Member IDs at the trigger.     */
+    SensorData_t data[SENSOR_SYNC_MAX_MEMBERS];  /**< Readings, all channels.        */
+} SensorSyncFrame_t;
+
+/** @brief Member IDs; changed with interrupts masked. */
+static uint8_t s_memberId[SENSOR_SYNC_MAX_MEMBERS];
+
+/** @brief Member drivers, read from the interrupt. */
+static const SensorIF_t *s_memberIF[SENSOR_SYNC_MAX_MEMBERS];
+
+/** @brief Number of members. */
+static uint32_t s_memberCount = 0U;
+
+/** @brief Frame FIFO. */
+static SensorSyncFrame_t s_frames[SENSOR_SYNC_FRAME_DEPTH];
+
+/** @brief Free-running write index (interrupt side). */
+static volatile uint32_t s_frameHead = 0U;
+
+/** @brief Free-running read index (task side). */
+static volatile uint32_t s_frameTail = 0U;
+
+/** @brief Hook run after a frame was queued. */
+static SensorSyncHook_t s_hook = NULL;
+
+/** @brief Counters reported by SensorSync_GetStats(). */
+static SensorSyncStats_t s_stats;
+
+/**
+ * @brief Frame rate of a power mode, 0 if the group does not run in it.
+ */
+static uint32_t SensorSync_RateFor(PowerMode_t mode);
+
+/**
+ * @brief Take the TIM3 clock and start the trigger at @p rate_hz.
+ */
+static void SensorSync_Start(uint32_t rate_hz);
+
+/**
+ * @brief Stop the trigger and release the TIM3 clock.
+ */
+static void SensorSync_Stop(void);
+
+/**
+ * @brief Load the TIM3 prescaler for the current APB1 clock.
+ */
+static void SensorSync_SetPrescaler(void);
+
+/**
+ * @brief Remove the member at @p index. Interrupts must be masked.
+ */
+static void SensorSync_RemoveAt(uint32_t index);
+
+/**
+ * @brief CLI "sync" handler.
+ */
+static void SensorSync_CmdSync(uint32_t argc, char *argv[]);
+
+/* ------------------------------------------------------------------------- */
+
+void SensorSync_Init(void)
+{
+    s_memberCount = 0U;
+    s_frameHead   = 0U;
+    s_frameTail   = 0U;
+    s_stats       = (SensorSyncStats_t){0};
+
+    HAL_NVIC_SetPriority(TIM3_IRQn, IRQ_PRIO_SYNC_TIMER, 0U);
+    HAL_NVIC_EnableIRQ(TIM3_IRQn);
+
+    (void)CLI_RegisterCommand("sync", SensorSync_CmdSync,
+                              "[add|del <id>] - Synchronous sensor group");
+}
+
+void SensorSync_SetFrameHook(SensorSyncHook_t hook)
+{
+    s_hook = hook;
+}
+
+int SensorSync_Add(uint8_t id)
+{
+    const SensorEntry_t *entry = SensorRegistry_Find(id);
+
+    if ((entry == NULL) || !entry->ready || (entry->iface->read == NULL))
+    {
+        return -1;
+    }
+
+    int result = 0;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint32_t i = 0U; i < s_memberCount; ++i)
+    {
+        if (s_memberId[i] == id)
+        {
+            result = -3;
+        }
+    }
+
+    if ((result == 0) && (s_memberCount >= SENSOR_SYNC_MAX_MEMBERS))
+    {
+        result = -2;
+    }
+
+    if (result == 0)
+    {
+        s_memberId[s_memberCount] = id;
+        s_memberIF[s_memberCount] = entry->iface;
+        s_memberCount++;
+    }
+
+    __set_PRIMASK(primask);
+
+    if (result == 0)
+    {
+        (void)SensorRegistry_SetSynced(id, true);
+        SensorSync_ApplyMode(PowerManager_GetCurrentMode());
+        LOG_INFO("SensorSync: added '%s' (%lu member(s))", entry->name, (unsigned long)s_memberCount);
+    }
+
+    return result;
+}
+
+bool SensorSync_Remove(uint8_t id)
+{
+    bool found = false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint32_t i = 0U; i < s_memberCount; ++i)
+    {
+        if (s_memberId[i] == id)
+        {
+            SensorSync_RemoveAt(i);
+            found = true;
+            break;
+        }
+    }
+
+    __set_PRIMASK(primask);
+
+    if (found)
+    {
+        (void)SensorRegistry_SetSynced(id, false);
+        SensorSync_ApplyMode(PowerManager_GetCurrentMode());
+    }
+
+    return found;
+}
+
+void SensorSync_ApplyMode(PowerMode_t mode)
+{
+    uint32_t rate = SensorSync_RateFor(mode);
+
+    if (rate == s_stats.rate_hz)
+    {
+        return;
+    }
+
+    if (s_stats.running)
+    {
+        SensorSync_Stop();
+    }
+    if (rate != 0U)
+    {
+        SensorSync_Start(rate);
+    }
+
+    s_stats.rate_hz = rate;
+}
+
+void SensorSync_OnClockChange(void)
+{
+    if (s_stats.running)
+    {
+        SensorSync_SetPrescaler();
+    }
+}
+
+void SensorSync_TimerIrqHandler(void)
+{
+    /* Trigger instant first: everything below is the members' read time. */
+    uint32_t trigger_us = Time_NowUs32();
+    uint32_t trigger_ms = HAL_GetTick();
+
+    TIM3->SR = (uint32_t)~TIM_SR_UIF;
+
+    uint32_t head = s_frameHead;
+    if ((head - s_frameTail) >= SENSOR_SYNC_FRAME_DEPTH)
+    {
+        s_stats.drops++;
+        return;
+    }
+
+    SensorSyncFrame_t *frame = &s_frames[head % SENSOR_SYNC_FRAME_DEPTH];
+    frame->timestamp    = trigger_ms;
+    frame->timestamp_us = trigger_us;
+    frame->count        = (uint8_t)s_memberCount;
+    frame->okMask       = 0U;
+
+    for (uint32_t i = 0U; i < s_memberCount; ++i)
+    {
+        frame->id[i] = s_memberId[i];
+        if (s_memberIF[i]->read(&frame->data[i]))
+        {
+            frame->okMask |= (uint8_t)(1U << i);
+        }
+    }
+
+    uint32_t span = Time_NowUs32() - trigger_us;
+    s_stats.lastSpan_us = span;
+    if (span > s_stats.maxSpan_us)
+    {
+        s_stats.maxSpan_us = span;
+    }
+    s_stats.frames++;
+
+    /* Publish the frame before the drain can see the new head. */
+    __DMB();
+    s_frameHead = head + 1U;
+
+    if (s_hook != NULL)
+    {
+        s_hook();
+    }
+}
+
+uint32_t SensorSync_Drain(SensorSampleCallback_t onSample)
+{
+    uint32_t delivered = 0U;
+
+    while (s_frameTail != s_frameHead)
+    {
+        SensorSyncFrame_t frame = s_frames[s_frameTail % SENSOR_SYNC_FRAME_DEPTH];
+
+        /* The slot is copied before the interrupt may reuse it. */
+        __DMB();
+        s_frameTail = s_frameTail + 1U;
+
+        for (uint32_t i = 0U; i < frame.count; ++i)
+        {
+            SensorData_t *data = &frame.data[i];
+            bool          ok   = (frame.okMask & (1U << i)) != 0U;
+
+            data->timestamp    = frame.timestamp;
+            data->timestamp_us = frame.timestamp_us;
+
+            if (!ok)
+            {
+                s_stats.readErrors++;
+            }
+
+            if (!SensorRegistry_Report(frame.id[i], ok ? data : NULL, onSample))
+            {
+                /* Unregistered while in the group (e.g. "farm <n>"). */
+                (void)SensorSync_Remove(frame.id[i]);
+            }
+        }
+
+        delivered++;
+    }
+
+    return delivered;
+}
+
+void SensorSync_GetStats(SensorSyncStats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats             = s_stats;
+    stats->memberCount = s_memberCount;
+    (void)memcpy(stats->members, s_memberId, sizeof(stats->members));
+    __set_PRIMASK(primask);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t SensorSync_RateFor(PowerMode_t mode)
+{
+    if (s_memberCount == 0U)
+    {
+        return 0U;
+    }
+
+    switch (mode)
+    {
+        case POWER_MODE_ACTIVE:
+            return SENSOR_SYNC_HZ_ACTIVE;
+        case POWER_MODE_IDLE:
+            return SENSOR_SYNC_HZ_IDLE;
+        default:
+            return 0U;
+    }
+}
+
+static void SensorSync_Start(uint32_t rate_hz)
+{
+    PeriphPower_Acquire(PERIPH_POWER_TIM3);
+
+    TIM3->CR1  = 0U;
+    TIM3->ARR  = (SENSOR_SYNC_TIMER_HZ / rate_hz) - 1U;
+    SensorSync_SetPrescaler();
+    TIM3->EGR  = TIM_EGR_UG;
+    TIM3->SR   = 0U;
+    TIM3->DIER = TIM_DIER_UIE;
+    TIM3->CR1  = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    s_stats.running = true;
+}
+
+static void SensorSync_Stop(void)
+{
+    TIM3->CR1  = 0U;
+    TIM3->DIER = 0U;
+    TIM3->SR   = 0U;
+    HAL_NVIC_ClearPendingIRQ(TIM3_IRQn);
+
+    PeriphPower_Release(PERIPH_POWER_TIM3);
+
+    s_stats.running = false;
+}
+
+static void SensorSync_SetPrescaler(void)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    uint32_t timer = ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) ? pclk1 : (2U * pclk1);
+
+    TIM3->PSC = (timer / SENSOR_SYNC_TIMER_HZ) - 1U;
+}
+
+static void SensorSync_RemoveAt(uint32_t index)
+{
+    for (uint32_t i = index + 1U; i < s_memberCount; ++i)
+    {
+        s_memberId[i - 1U] = s_memberId[i];
+        s_memberIF[i - 1U] = s_memberIF[i];
+    }
+    s_memberCount--;
+}
+
+static void SensorSync_CmdSync(uint32_t argc, char *argv[])
+{
+    if (argc > 1U)
+    {
+        char         *end = NULL;
+        unsigned long id  = (argc == 3U) ? strtoul(argv[2], &end, 10) : 0UL;
+        bool          ok  = (argc == 3U) && (end != argv[2]) && (*end == '\0') && (id <= 0xFFUL);
+
+        if (ok && (strcmp(argv[1], "add") == 0))
+        {
+            int rc = SensorSync_Add((uint8_t)id);
+            if (rc != 0)
+            {
+                CLI_PrintError("\r\nCannot add sensor %lu (%s)\r\n", id,
+                               (rc == -1) ? "no blocking read" : ((rc == -2) ? "group full" : "already a member"));
+                return;
+            }
+        }
+        else if (ok && (strcmp(argv[1], "del") == 0))
+        {
+            if (!SensorSync_Remove((uint8_t)id))
+            {
+                CLI_PrintError("\r\nSensor %lu is not in the group\r\n", id);
+                return;
+            }
+        }
+        else
+        {
+            CLI_PrintError("\r\nUsage: sync [add <id> | del <id>]\r\n");
+            return;
+        }
+    }
+
+    SensorSyncStats_t stats;
+    SensorSync_GetStats(&stats);
+
+    CLI_Print("\r\nSync group (%s): %lu member(s), %lu Hz\r\n",
+              stats.running ? "running" : "stopped",
+              (unsigned long)stats.memberCount,
+              (unsigned long)stats.rate_hz);
+    CLI_Print("  Frames %lu, drops %lu, read errors %lu\r\n",
+              (unsigned long)stats.frames,
+              (unsigned long)stats.drops,
+              (unsigned long)stats.readErrors);
+    CLI_Print("  Read span after trigger: last %lu us, max %lu us\r\n",
+              (unsigned long)stats.lastSpan_us,
+              (unsigned long)stats.maxSpan_us);
+
+    for (uint32_t i = 0U; i < stats.memberCount; ++i)
+    {
+        const SensorEntry_t *entry = SensorRegistry_Find(stats.members[i]);
+
+        CLI_Print("  %3u %-12s %10.2f\r\n",
+                  (unsigned)stats.members[i],
+                  (entry != NULL) ? entry->name : "?",
+                  (double)((entry != NULL) ? SensorData_GetFloat(&entry->last, 0U) : 0.0f));
+    }
+}
@@ -0,0 +1,170 @@
+/**
+ * @file sensor_sync.h
+ * @brief Timer-triggered synchronous acquisition of a group of sensors.
+ *
+ * Sensors read by the sampling task are timestamped whenever that task
+ * gets to them, so their readings are skewed by scheduler load and by
+ * the reads before them. A sync group instead reads all of its members
+ * from the TIM3 update interrupt: the trigger instant is taken once and
+ * every member's reading in that pass carries it, so the channels of one
+ * frame are aligned to the trigger whatever the main loop is doing.
+ *
+ * Members are registry sensors with a blocking read(); the registry stops
+ * scheduling them while they are in the group. The interrupt only fills
+ * a small frame FIFO and posts an event; the frames are delivered through
+ * the registry, one sample per member with the frame timestamp, from
+ * task context, so the sample ring keeps a single producer.
+ *
+ * The members are read one after the other, so each frame also records
+ * how long the reads took after the trigger (the residual skew). A
+ * driver whose read() only latches a value converted at the trigger
+ * (e.g. a sensor started by the same timer) has none.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SENSOR_SYNC_H
+#define SENSOR_SYNC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sensor_registry.h"
+#include "power_manager.h"
+
+/**
+ * @defgroup sensor_sync Synchronous Acquisition
+ * @brief Sensor group sampled at one hardware-timed instant.
+ * @ingroup sensors
+ * @{
+ */
+
+/** @brief TIM3 counter frequency (10 kHz: 1 Hz still fits the 16-bit ARR). */
+#define SENSOR_SYNC_TIMER_HZ      (10000U)
+
+/** @brief Maximum number of sensors in the group. */
+#define SENSOR_SYNC_MAX_MEMBERS   (8U)
+
+/** @brief Frames buffered between the interrupt and the drain. */
+#define SENSOR_SYNC_FRAME_DEPTH   (8U)
+
+/**
+ * @brief Hook called from the timer interrupt after a frame was queued.
+ */
+typedef void (*SensorSyncHook_t)(void);
+
+/**
+ * @brief Group state and counters.
+ */
+typedef struct
+{
+    bool     running;        /**< Trigger timer running.                      */
+    uint32_t rate_hz;        /**< Frame rate in the current mode (0 = off).   */
+    uint32_t memberCount;    /**< Sensors in the group.                       */
+    uint8_t  members[SENSOR_SYNC_MAX_MEMBERS]; /**< Member IDs.               */
+    uint32_t frames;         /**< Frames captured.                            */
+    uint32_t drops;          /**< Frames lost because the FIFO was full.      */
+    uint32_t readErrors;     /**< Member reads that failed.                   */
+    uint32_t lastSpan_us;    /**< Trigger to last read done, latest frame.    */
+    uint32_t maxSpan_us;     /**< Largest span seen.                          */
+} SensorSyncStats_t;
+
+/**
+ * @brief Reset the group and register the "sync" CLI command.
+ *
+ * @return None.
+ */
+void SensorSync_Init(void);
+
+/**
+ * @brief Set the hook run from the interrupt when a frame is ready.
+ *
+ * @param hook Hook, or NULL for none.
+ *
+ * @return None.
+ */
+void SensorSync_SetFrameHook(SensorSyncHook_t hook);
+
+/**
+ * @brief Add a registry sensor to the group.
+ *
+ * The sensor must be ready and have a blocking read(); it is no longer
+ * scheduled by the registry, and only its read() is used (in interrupt
+ * context), even if it also has a FIFO or asynchronous interface.
+ *
+ * @param id Registry ID.
+ *
+ * @return 0 on success, -1 if there is no such sensor or it cannot be
+ *         read synchronously, -2 if the group is full, -3 if it is
+ *         already a member.
+ */
+int SensorSync_Add(uint8_t id);
+
+/**
+ * @brief Remove a sensor from the group and hand it back to the registry.
+ *
+ * @param id Registry ID.
+ *
+ * @return true if it was a member.
+ */
+bool SensorSync_Remove(uint8_t id);
+
+/**
+ * @brief Start or stop the trigger timer for a power mode.
+ *
+ * The frame rate is @ref SENSOR_SYNC_HZ_ACTIVE or @ref SENSOR_SYNC_HZ_IDLE;
+ * the timer is stopped in SLEEP and STOP and while the group is empty.
+ * Cheap when nothing changes, so it can be called periodically.
+ *
+ * @param mode Current power mode.
+ *
+ * @return None.
+ */
+void SensorSync_ApplyMode(PowerMode_t mode);
+
+/**
+ * @brief Recompute the timer prescaler after the APB1 clock changed.
+ *
+ * @return None.
+ */
+void SensorSync_OnClockChange(void);
+
+/**
+ * @brief TIM3 update interrupt: read every member and queue a frame.
+ *
+ * @return None.
+ */
+void SensorSync_TimerIrqHandler(void);
+
+/**
+ * @brief Deliver the queued frames through the registry.
+ *
+ * Each member reading becomes one sample for @p onSample, stamped with
+ * the frame's trigger time. Members removed from the registry since the
+ * frame was taken are dropped from the group.
+ *
+ * @param onSample Sample callback (may be NULL).
+ *
+ * @return Number of frames delivered.
+ */
+uint32_t SensorSync_Drain(SensorSampleCallback_t onSample);
+
+/**
+ * @brief Get the group state and counters.
+ *
+ * @param[out] stats Destination. Must not be NULL.
+ *
+ * @return None.
+ */
+void SensorSync_GetStats(SensorSyncStats_t *stats);
+
+/** @} */ /* end of sensor_sync group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SENSOR_SYNC_H */
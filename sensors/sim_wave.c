@@ -0,0 +1,193 @@
+/**
+ * @file sim_wave.c
+ * @brief Fixed-point waveform generator implementation.
+ *
+ * Phase is a free-running 32-bit angle: the top 8 bits index the sine
+ * table, the next 16 bits interpolate between neighbouring entries. The
+ * phase of a sample is elapsed_ms * phaseStep, which wraps naturally, so
+ * the generator is stateless apart from the noise seed and samples may be
+ * requested for any timestamp (e.g. back-dated FIFO entries).
+ *
+ * Bursts: every cycle whose index hashes to 0 mod SIM_WAVE_BURST_ODDS
+ * carries a pulse of +amplitude during its first 1/8 of a period. The
+ * decision depends only on the cycle index, so it is repeatable.
+ *
+ * @ingroup sim_wave
+ */
+
+#include "sim_wave.h"
+#include <stddef.h>
+
+/** @brief Seed used when the caller passes 0 (xorshift must not be 0). */
+#define SIM_WAVE_DEFAULT_SEED   (0x2545F491U)
+
+/** @brief One in this many cycles of a BURST wave carries a pulse. */
+#define SIM_WAVE_BURST_ODDS     (4U)
+
+/** @brief A burst pulse lasts 1/SIM_WAVE_BURST_FRACTION of a cycle. */
+#define SIM_WAVE_BURST_FRACTION (8U)
+
+/**
+ * @brief Shape names, indexed by @ref SimWaveShape_t.
+ */
+static const char *const s_shapeNames[SIM_WAVE_COUNT] =
+{
+    [SIM_WAVE_SINE]  = "sine",
+    [SIM_WAVE_RAMP]  = "ramp",
+    [SIM_WAVE_STEP]  = "step",
+    [SIM_WAVE_NOISE] = "noise",
+    [SIM_WAVE_BURST] = "burst"
+};
+
+/**
+ * @brief Shape term in Q15 (-32767 .. 32767) for one sample.
+ */
+static int32_t SimWave_ShapeQ15(const SimWave_t *wave, uint32_t elapsed_ms);
+
+/**
+ * @brief One full sine cycle in Q15, plus a guard entry for interpolation.
+ */
+static const int16_t s_sinTable[257] =
+{
+         0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+      6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+     12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+     18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+     23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+     27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+     30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+     32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+     32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+     32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+     30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+     27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+     23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+     18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+     12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+      6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+         0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+     -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+     -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+         0
+};
+
+/* ------------------------------------------------------------------------- */
+
+void SimWave_Init(SimWave_t *wave, const SimWaveConfig_t *config, uint32_t seed)
+{
+    if ((wave == NULL) || (config == NULL))
+    {
+        return;
+    }
+
+    wave->config    = *config;
+    wave->phaseStep = (config->period_ms == 0U)
+                      ? 0U
+                      : (uint32_t)(0x100000000ULL / config->period_ms);
+    wave->rng       = (seed != 0U) ? seed : SIM_WAVE_DEFAULT_SEED;
+}
+
+int32_t SimWave_Sample(SimWave_t *wave, uint32_t elapsed_ms)
+{
+    int32_t value = wave->config.offset;
+
+    if (wave->phaseStep != 0U)
+    {
+        int32_t s = SimWave_ShapeQ15(wave, elapsed_ms);
+        value += (int32_t)(((int64_t)wave->config.amplitude * s) >> 15);
+    }
+
+    if (wave->config.noise > 0)
+    {
+        /* Uniform in [-noise, +noise] without a division. */
+        uint32_t span = (2U * (uint32_t)wave->config.noise) + 1U;
+        uint32_t r    = SimWave_Random(&wave->rng);
+        value += (int32_t)(((uint64_t)r * span) >> 32) - wave->config.noise;
+    }
+
+    return value;
+}
+
+int32_t SimWave_SinQ15(uint32_t phase)
+{
+    uint32_t index = phase >> 24;
+    int32_t  frac  = (int32_t)((phase >> 8) & 0xFFFFU);
+    int32_t  a     = s_sinTable[index];
+    int32_t  b     = s_sinTable[index + 1U];
+
+    return a + (((b - a) * frac) >> 16);
+}
+
+uint32_t SimWave_Random(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    *state = x;
+    return x;
+}
+
+const char *SimWave_GetShapeName(SimWaveShape_t shape)
+{
+    if (shape >= SIM_WAVE_COUNT)
+    {
+        return "?";
+    }
+
+    return s_shapeNames[shape];
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static int32_t SimWave_ShapeQ15(const SimWave_t *wave, uint32_t elapsed_ms)
+{
+    uint32_t phase = elapsed_ms * wave->phaseStep;
+
+    switch (wave->config.shape)
+    {
+        case SIM_WAVE_RAMP:
+            return (int32_t)(phase >> 16) - 32768;
+
+        case SIM_WAVE_STEP:
+            return (phase < 0x80000000U) ? 32767 : -32767;
+
+        case SIM_WAVE_NOISE:
+            return 0;
+
+        case SIM_WAVE_BURST:
+        {
+            uint32_t cycle = elapsed_ms / wave->config.period_ms;
+            uint32_t pos   = elapsed_ms - (cycle * wave->config.period_ms);
+            uint32_t hash  = (cycle + 1U) * 0x9E3779B1U;
+
+            if ((pos < (wave->config.period_ms / SIM_WAVE_BURST_FRACTION)) &&
+                (((hash >> 16) % SIM_WAVE_BURST_ODDS) == 0U))
+            {
+                return 32767;
+            }
+            return 0;
+        }
+
+        case SIM_WAVE_SINE:
+        default:
+            return SimWave_SinQ15(phase);
+    }
+}
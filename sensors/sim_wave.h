@@ -0,0 +1,120 @@
+/**
+ * @file sim_wave.h
+ * @brief Fixed-point waveform generator for simulated sensors.
+ *
+ * Produces signal values in integer milli-units (e.g. milli-degrees C)
+ * from a 32-bit phase accumulator and a 256-entry Q15 sine table with
+ * linear interpolation. Ramp, step, pure-noise and bursty shapes use the
+ * same phase. No libm call and no floating point is involved,
+ * so a simulated sensor costs a few dozen cycles per sample and many can
+ * run side by side as a load generator.
+ *
+ * @ingroup sensors
+ */
+
+#ifndef SIM_WAVE_H
+#define SIM_WAVE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @defgroup sim_wave Simulated Waveforms
+ * @brief Table-driven signal generation for simulated sensors.
+ * @ingroup sensors
+ * @{
+ */
+
+/**
+ * @brief Waveform shape.
+ */
+typedef enum
+{
+    SIM_WAVE_SINE = 0U, /**< offset + amplitude * sin.                       */
+    SIM_WAVE_RAMP,      /**< Sawtooth from -amplitude to +amplitude.         */
+    SIM_WAVE_STEP,      /**< Square wave, +amplitude then -amplitude.        */
+    SIM_WAVE_NOISE,     /**< offset plus noise only.                         */
+    SIM_WAVE_BURST,     /**< offset, with +amplitude pulses in random cycles. */
+    SIM_WAVE_COUNT      /**< Number of shapes (not a valid shape).           */
+} SimWaveShape_t;
+
+/**
+ * @brief Waveform parameters (all values in milli-units).
+ */
+typedef struct
+{
+    SimWaveShape_t shape; /**< Signal shape (default SIM_WAVE_SINE).        */
+    int32_t        offset;    /**< Mean value, e.g. 25000 for 25.000 °C.    */
+    int32_t        amplitude; /**< Peak deviation from @c offset.           */
+    uint32_t       period_ms; /**< Period of one cycle; 0 = constant.       */
+    int32_t        noise;     /**< Peak uniform noise per sample; 0 = off.  */
+} SimWaveConfig_t;
+
+/**
+ * @brief Generator state.
+ */
+typedef struct
+{
+    SimWaveConfig_t config;    /**< Active parameters.                        */
+    uint32_t        phaseStep; /**< Phase increment per ms (2^32 / period).   */
+    uint32_t        rng;       /**< xorshift32 state for the noise term.      */
+} SimWave_t;
+
+/**
+ * @brief Initialize a generator.
+ *
+ * @param wave   Generator to initialize.
+ * @param config Waveform parameters (copied).
+ * @param seed   Noise seed; 0 is replaced by a fixed non-zero value.
+ *
+ * @return None.
+ */
+void SimWave_Init(SimWave_t *wave, const SimWaveConfig_t *config, uint32_t seed);
+
+/**
+ * @brief Signal value at a given time.
+ *
+ * @param wave       Generator.
+ * @param elapsed_ms Time since the start of the waveform.
+ *
+ * @return Value in milli-units.
+ */
+int32_t SimWave_Sample(SimWave_t *wave, uint32_t elapsed_ms);
+
+/**
+ * @brief Q15 sine of a 32-bit phase (0 .. 2^32 maps to 0 .. 2*pi).
+ *
+ * @param phase Phase angle.
+ *
+ * @return sin(phase) scaled to [-32767, 32767].
+ */
+int32_t SimWave_SinQ15(uint32_t phase);
+
+/**
+ * @brief Short name of a shape for logs and the CLI.
+ *
+ * @param shape Shape to describe.
+ *
+ * @return Static string such as "sine", or "?" for invalid values.
+ */
+const char *SimWave_GetShapeName(SimWaveShape_t shape);
+
+/**
+ * @brief Next pseudo-random value from an xorshift32 state.
+ *
+ * @param state Generator state (must be non-zero).
+ *
+ * @return 32-bit pseudo-random value.
+ */
+uint32_t SimWave_Random(uint32_t *state);
+
+/** @} */ /* end of sim_wave group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_WAVE_H */
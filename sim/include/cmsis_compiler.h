@@ -0,0 +1,18 @@
+/**
+ * @file cmsis_compiler.h
+ * @brief Host replacement for the CMSIS compiler abstraction header.
+ *
+ * Core/ThreadSafe/stm32_lock.h includes <cmsis_compiler.h> directly for
+ * __get_PRIMASK() and friends. On the host those intrinsics are provided
+ * by the core_cm4.h wrapper, so this file pulls in the device header
+ * (and through it that wrapper) instead of cmsis_gcc.h.
+ *
+ * @ingroup sim
+ */
+
+#ifndef SIM_CMSIS_COMPILER_H
+#define SIM_CMSIS_COMPILER_H
+
+#include <stm32f4xx.h>
+
+#endif /* SIM_CMSIS_COMPILER_H */
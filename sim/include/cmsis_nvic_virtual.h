@@ -0,0 +1,76 @@
+/**
+ * @file cmsis_nvic_virtual.h
+ * @brief Host NVIC and core peripheral hooks, included by core_cm4.h.
+ *
+ * The sim build defines CMSIS_NVIC_VIRTUAL, so core_cm4.h includes this
+ * file right after declaring the core register blocks and before its
+ * inline functions. The core peripheral macros are redirected to the
+ * simulated register blocks here, so those inline functions (for
+ * example SysTick_Config()) already use them, and the NVIC API is routed
+ * to the simulated interrupt controller in sim_core.c. SysTick goes
+ * through an accessor, so the model sees its register accesses (COUNTFLAG
+ * clears on read, a VAL write restarts the counter), and DWT accesses
+ * count toward busy-wait detection like HAL_GetTick().
+ *
+ * @ingroup sim
+ */
+
+#ifndef SIM_CMSIS_NVIC_VIRTUAL_H
+#define SIM_CMSIS_NVIC_VIRTUAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Simulated core register blocks (sim_core.c). */
+extern SCB_Type       g_simScb;
+extern SysTick_Type   g_simSysTick;
+extern NVIC_Type      g_simNvic;
+extern DWT_Type       g_simDwt;
+extern CoreDebug_Type g_simCoreDebug;
+
+SysTick_Type *SimCore_SysTickAccess(void);
+DWT_Type     *SimCore_DwtAccess(void);
+
+#undef  SCB
+#define SCB            (&g_simScb)
+#undef  SysTick
+#define SysTick        (SimCore_SysTickAccess())
+#undef  NVIC
+#define NVIC           (&g_simNvic)
+#undef  DWT
+#define DWT            (SimCore_DwtAccess())
+#undef  CoreDebug
+#define CoreDebug      (&g_simCoreDebug)
+
+void     SimCore_NvicSetPriorityGrouping(uint32_t group);
+uint32_t SimCore_NvicGetPriorityGrouping(void);
+void     SimCore_NvicEnableIrq(IRQn_Type irq);
+uint32_t SimCore_NvicGetEnableIrq(IRQn_Type irq);
+void     SimCore_NvicDisableIrq(IRQn_Type irq);
+uint32_t SimCore_NvicGetPendingIrq(IRQn_Type irq);
+void     SimCore_NvicSetPendingIrq(IRQn_Type irq);
+void     SimCore_NvicClearPendingIrq(IRQn_Type irq);
+uint32_t SimCore_NvicGetActive(IRQn_Type irq);
+void     SimCore_NvicSetPriority(IRQn_Type irq, uint32_t priority);
+uint32_t SimCore_NvicGetPriority(IRQn_Type irq);
+void     SimCore_NvicSystemReset(void) __attribute__((__noreturn__));
+
+#define NVIC_SetPriorityGrouping    SimCore_NvicSetPriorityGrouping
+#define NVIC_GetPriorityGrouping    SimCore_NvicGetPriorityGrouping
+#define NVIC_EnableIRQ              SimCore_NvicEnableIrq
+#define NVIC_GetEnableIRQ           SimCore_NvicGetEnableIrq
+#define NVIC_DisableIRQ             SimCore_NvicDisableIrq
+#define NVIC_GetPendingIRQ          SimCore_NvicGetPendingIrq
+#define NVIC_SetPendingIRQ          SimCore_NvicSetPendingIrq
+#define NVIC_ClearPendingIRQ        SimCore_NvicClearPendingIrq
+#define NVIC_GetActive              SimCore_NvicGetActive
+#define NVIC_SetPriority            SimCore_NvicSetPriority
+#define NVIC_GetPriority            SimCore_NvicGetPriority
+#define NVIC_SystemReset            SimCore_NvicSystemReset
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CMSIS_NVIC_VIRTUAL_H */
@@ -0,0 +1,155 @@
+/**
+ * @file core_cm4.h
+ * @brief Host wrapper around the CMSIS Cortex-M4 core header.
+ *
+ * Found before Drivers/CMSIS/Include on the sim include path. It provides
+ * the compiler abstraction in place of cmsis_gcc.h (whose intrinsics are
+ * ARM assembly) and then includes the real core_cm4.h for the register
+ * types and bit definitions. The core intrinsics the firmware uses
+ * (PRIMASK, BASEPRI, IPSR, MSP, WFI, barriers) call into the simulated
+ * core in sim_core.c, so masking interrupts and sleeping behave as on the
+ * MCU.
+ *
+ * @ingroup sim
+ */
+
+#ifndef SIM_CORE_CM4_H
+#define SIM_CORE_CM4_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef __ASM
+#define __ASM                     __asm
+#endif
+#ifndef __INLINE
+#define __INLINE                  inline
+#endif
+#ifndef __STATIC_INLINE
+#define __STATIC_INLINE           static inline
+#endif
+#ifndef __STATIC_FORCEINLINE
+#define __STATIC_FORCEINLINE      __attribute__((always_inline)) static inline
+#endif
+#ifndef __NO_RETURN
+#define __NO_RETURN               __attribute__((__noreturn__))
+#endif
+#ifndef __USED
+#define __USED                    __attribute__((used))
+#endif
+#ifndef __WEAK
+#define __WEAK                    __attribute__((weak))
+#endif
+#ifndef __PACKED
+#define __PACKED                  __attribute__((packed, aligned(1)))
+#endif
+#ifndef __PACKED_STRUCT
+#define __PACKED_STRUCT           struct __attribute__((packed, aligned(1)))
+#endif
+#ifndef __PACKED_UNION
+#define __PACKED_UNION            union __attribute__((packed, aligned(1)))
+#endif
+#ifndef __ALIGNED
+#define __ALIGNED(x)              __attribute__((aligned(x)))
+#endif
+#ifndef __RESTRICT
+#define __RESTRICT                __restrict
+#endif
+#ifndef __COMPILER_BARRIER
+#define __COMPILER_BARRIER()      __asm volatile("" ::: "memory")
+#endif
+
+/* ------------------------------------------------------------------------- */
+/*                         Simulated core intrinsics                         */
+/* ------------------------------------------------------------------------- */
+
+/** @brief Set PRIMASK; pending interrupts run when it is cleared. */
+void     SimCore_SetPrimask(uint32_t primask);
+
+/** @brief Current PRIMASK. */
+uint32_t SimCore_GetPrimask(void);
+
+/** @brief Set BASEPRI; pending interrupts it no longer masks run. */
+void     SimCore_SetBasepri(uint32_t basepri);
+
+/** @brief Raise BASEPRI to @p basepri unless it already masks more. */
+void     SimCore_SetBasepriMax(uint32_t basepri);
+
+/** @brief Current BASEPRI. */
+uint32_t SimCore_GetBasepri(void);
+
+/** @brief Exception number being serviced (0 in thread mode). */
+uint32_t SimCore_GetIpsr(void);
+
+/** @brief Top of the simulated main stack. */
+uint32_t SimCore_GetMsp(void);
+
+/** @brief Wait for interrupt: advance virtual time to the next wake event. */
+void     SimCore_WaitForInterrupt(void);
+
+#define __enable_irq()            SimCore_SetPrimask(0U)
+#define __disable_irq()           SimCore_SetPrimask(1U)
+#define __get_PRIMASK()           SimCore_GetPrimask()
+#define __set_PRIMASK(x)          SimCore_SetPrimask(x)
+#define __get_BASEPRI()           SimCore_GetBasepri()
+#define __set_BASEPRI(x)          SimCore_SetBasepri(x)
+#define __set_BASEPRI_MAX(x)      SimCore_SetBasepriMax(x)
+#define __get_IPSR()              SimCore_GetIpsr()
+#define __get_MSP()               SimCore_GetMsp()
+#define __WFI()                   SimCore_WaitForInterrupt()
+#define __WFE()                   SimCore_WaitForInterrupt()
+#define __SEV()                   ((void)0)
+#define __NOP()                   ((void)0)
+#define __BKPT(value)             ((void)(value))
+#define __ISB()                   __COMPILER_BARRIER()
+#define __DSB()                   __sync_synchronize()
+#define __DMB()                   __sync_synchronize()
+#define __CLZ(x)                  ((uint8_t)(((x) == 0U) ? 32U : (uint32_t)__builtin_clz(x)))
+#define __RBIT(x)                 SimCore_Rbit(x)
+#define __REV(x)                  __builtin_bswap32(x)
+#define __REV16(x)                ((uint32_t)((((x) & 0xFF00FF00U) >> 8) | (((x) & 0x00FF00FFU) << 8)))
+
+/* Exclusive accesses always succeed: the simulated core has one thread
+ * and interrupts only run inside core hooks (PRIMASK, WFI, NVIC calls,
+ * HAL_GetTick()), never between an LDREX and its STREX.
+ */
+#define __LDREXW(ptr)             (*(volatile uint32_t *)(ptr))
+#define __LDREXH(ptr)             (*(volatile uint16_t *)(ptr))
+#define __LDREXB(ptr)             (*(volatile uint8_t *)(ptr))
+#define __STREXW(value, ptr)      ((*(volatile uint32_t *)(ptr) = (value)), 0U)
+#define __STREXH(value, ptr)      ((*(volatile uint16_t *)(ptr) = (value)), 0U)
+#define __STREXB(value, ptr)      ((*(volatile uint8_t *)(ptr) = (value)), 0U)
+#define __CLREX()                 ((void)0)
+
+/**
+ * @brief Reverse the bit order of a word.
+ */
+static inline uint32_t SimCore_Rbit(uint32_t value)
+{
+    uint32_t result = 0U;
+
+    for (uint32_t i = 0U; i < 32U; ++i)
+    {
+        result = (result << 1) | (value & 1U);
+        value >>= 1;
+    }
+
+    return result;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/* Skip the real cmsis_compiler.h (it sits next to core_cm4.h, so the
+ * include search cannot be redirected); everything it would provide is
+ * defined above.
+ */
+#define __CMSIS_COMPILER_H
+
+#include_next "core_cm4.h"
+
+#endif /* SIM_CORE_CM4_H */
@@ -0,0 +1,102 @@
+/**
+ * @file stm32f4xx.h
+ * @brief Host wrapper around the CMSIS device header.
+ *
+ * Includes the real stm32f4xx.h (and with it the device header and the
+ * HAL headers, which only contribute types and macros in the sim build),
+ * then points the peripherals the firmware touches at simulated register
+ * blocks in sim_hw.c. Peripherals that are not remapped keep their MCU
+ * addresses; they may be compared but must not be dereferenced.
+ *
+ * @ingroup sim
+ */
+
+#ifndef SIM_STM32F4XX_H
+#define SIM_STM32F4XX_H
+
+#include_next "stm32f4xx.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Simulated device register blocks (sim_hw.c). */
+extern RCC_TypeDef        g_simRcc;
+extern PWR_TypeDef        g_simPwr;
+extern FLASH_TypeDef      g_simFlash;
+extern EXTI_TypeDef       g_simExti;
+extern SYSCFG_TypeDef     g_simSyscfg;
+extern RTC_TypeDef        g_simRtc;
+extern TIM_TypeDef        g_simTim2;
+extern TIM_TypeDef        g_simTim3;
+extern TIM_TypeDef        g_simTim5;
+extern TIM_TypeDef        g_simTim8;
+extern USART_TypeDef      g_simUsart1;
+extern USART_TypeDef      g_simUsart2;
+extern DMA_Stream_TypeDef g_simDma1Stream5;
+extern DMA_Stream_TypeDef g_simDma1Stream6;
+extern DMA_TypeDef        g_simDma2;
+extern DMA_Stream_TypeDef g_simDma2Stream0;
+extern DMA_Stream_TypeDef g_simDma2Stream7;
+extern ADC_TypeDef        g_simAdc1;
+extern ADC_Common_TypeDef g_simAdcCommon;
+extern GPIO_TypeDef       g_simGpioA;
+extern GPIO_TypeDef       g_simGpioB;
+extern GPIO_TypeDef       g_simGpioC;
+extern GPIO_TypeDef       g_simGpioH;
+extern DBGMCU_TypeDef     g_simDbgmcu;
+
+#undef  RCC
+#define RCC            (&g_simRcc)
+#undef  PWR
+#define PWR            (&g_simPwr)
+#undef  FLASH
+#define FLASH          (&g_simFlash)
+#undef  EXTI
+#define EXTI           (&g_simExti)
+#undef  SYSCFG
+#define SYSCFG         (&g_simSyscfg)
+#undef  RTC
+#define RTC            (&g_simRtc)
+#undef  TIM2
+#define TIM2           (&g_simTim2)
+#undef  TIM3
+#define TIM3           (&g_simTim3)
+#undef  TIM5
+#define TIM5           (&g_simTim5)
+#undef  TIM8
+#define TIM8           (&g_simTim8)
+#undef  USART1
+#define USART1         (&g_simUsart1)
+#undef  USART2
+#define USART2         (&g_simUsart2)
+#undef  DMA1_Stream5
+#define DMA1_Stream5   (&g_simDma1Stream5)
+#undef  DMA1_Stream6
+#define DMA1_Stream6   (&g_simDma1Stream6)
+#undef  DMA2
+#define DMA2           (&g_simDma2)
+#undef  DMA2_Stream0
+#define DMA2_Stream0   (&g_simDma2Stream0)
+#undef  DMA2_Stream7
+#define DMA2_Stream7   (&g_simDma2Stream7)
+#undef  ADC1
+#define ADC1           (&g_simAdc1)
+#undef  ADC123_COMMON
+#define ADC123_COMMON  (&g_simAdcCommon)
+#undef  GPIOA
+#define GPIOA          (&g_simGpioA)
+#undef  GPIOB
+#define GPIOB          (&g_simGpioB)
+#undef  GPIOC
+#define GPIOC          (&g_simGpioC)
+#undef  GPIOH
+#define GPIOH          (&g_simGpioH)
+#undef  DBGMCU
+#define DBGMCU         (&g_simDbgmcu)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_STM32F4XX_H */
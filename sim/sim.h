@@ -0,0 +1,586 @@
+/**
+ * @file sim.h
+ * @brief Host simulation of the Nucleo-F446RE: internal interfaces.
+ *
+ * The sim build runs the unmodified firmware (Core/, app/, common/,
+ * sensors/, power/) as a host process. Only the hardware-facing pieces
+ * are replaced: the HAL calls (sim_hal.c), the CMSIS core intrinsics and
+ * the NVIC (sim_core.c), the register blocks the firmware touches
+ * directly (sim_hw.c), and the two drivers that depend on free-running
+ * hardware counters, time_base.c and power_rtc.c.
+ *
+ * Time is virtual. Firmware code runs in zero time; the clock only moves
+ * while the core waits for an interrupt (WFI in the idle path, or a busy
+ * wait detected by SimCore_SetPrimask()). Each wait jumps straight to the
+ * next event (SysTick, UART DMA, RTC wakeup, flash erase, input), which
+ * is why a run is thousands of times faster than real time. The UART is
+ * modelled at its baud rate: output goes to stdout, stdin is fed to the
+ * receiver one character time apart. With -u a USB host takes the
+ * console instead (sim_usb_cdc_hw.c). The telemetry UART, if built in,
+ * is modelled the same way and writes to the -T file. With -P the
+ * firmware's replay sensor reads samples back from a capture file.
+ *
+ * @ingroup sim
+ */
+
+#ifndef SIM_H
+#define SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "stm32f4xx_hal.h"
+
+/**
+ * @defgroup sim Host Simulation
+ * @brief Virtual-time host build of the firmware.
+ * @{
+ */
+
+/** @brief Time value meaning "no event scheduled". */
+#define SIM_NEVER                 (UINT64_MAX)
+
+/** @brief Nanoseconds per millisecond. */
+#define SIM_NS_PER_MS             (1000000ULL)
+
+/** @brief Most scheduled button presses (-b). */
+#define SIM_MAX_BUTTON_PRESSES    (16U)
+
+/**
+ * @brief Command line options.
+ */
+typedef struct
+{
+    uint64_t    duration_ns;    /**< Run time, or SIM_NEVER: until stdin ends.  */
+    bool        realtime;       /**< Pace virtual time to the wall clock.       */
+    bool        quiet;          /**< No summary on stderr at exit.              */
+    const char *flashImage;     /**< File backing the flash, or NULL (erased).  */
+    const char *backupImage;    /**< File backing BKPSRAM, or NULL (zeroed).    */
+    uint32_t    buttonCount;    /**< Entries used in buttonPress_ms.            */
+    uint32_t    buttonPress_ms[SIM_MAX_BUTTON_PRESSES]; /**< B1 press times.    */
+    bool        usbHost;        /**< Attach a USB host; console over USB CDC.   */
+    uint32_t    uplinkLoss;     /**< Uplink back end loses every n-th batch.    */
+    const char *telemetryOut;   /**< Telemetry UART output file, or NULL.       */
+    const char *replayFile;     /**< Capture for `replay file` (-P), or NULL.   */
+    uint32_t    resets;         /**< Resets so far; non-zero: a restart (-S).   */
+    uint32_t    standbys;       /**< Of those, wakeups from STANDBY.            */
+    uint64_t    start_ns;       /**< Virtual time of the restart.               */
+    uint64_t    wallStart_ns;   /**< CLOCK_MONOTONIC at the first start.        */
+    uint32_t    resetRcc;       /**< RCC_CSR after the restart.                 */
+    uint32_t    resetPwr;       /**< PWR_CSR bits kept or set by the reset.     */
+    uint32_t    resetRtcIsr;    /**< RTC_ISR flags that ended a STANDBY.        */
+} SimOptions_t;
+
+/**
+ * @brief Core statistics for the exit summary.
+ */
+typedef struct
+{
+    uint64_t wfiCount;    /**< WFI executions.                          */
+    uint64_t interrupts;  /**< Exception handlers run.                  */
+    uint64_t spinSteps;   /**< Time advances forced by busy waiting.    */
+    uint64_t stops;       /**< Completed deep-sleep (STOP) WFIs.        */
+    uint64_t stopNs;      /**< Virtual time spent in them.              */
+    uint64_t stopMaxNs;   /**< Longest of them.                         */
+} SimCoreStats_t;
+
+/**
+ * @brief Peripheral statistics for the exit summary.
+ */
+typedef struct
+{
+    uint64_t txBytes;     /**< Console bytes sent.                      */
+    uint64_t rxBytes;     /**< Console bytes received by the firmware.  */
+    uint64_t rxLost;      /**< Bytes lost (receiver off or in STOP).    */
+    uint32_t erases;      /**< Flash sectors erased.                    */
+    uint64_t adcScans;    /**< ADC1 regular sequences converted.        */
+    uint64_t telemBytes;  /**< Telemetry UART bytes sent.               */
+} SimHwStats_t;
+
+/**
+ * @brief Simulated USB host counters.
+ */
+typedef struct
+{
+    uint64_t txBytes;     /**< Bulk IN bytes taken by the host.         */
+    uint64_t rxBytes;     /**< Bulk OUT bytes sent by the host.         */
+    uint32_t controls;    /**< Control requests sent.                   */
+    uint32_t stalls;      /**< Control requests the device stalled.     */
+} SimUsbStats_t;
+
+/* ------------------------------------------------------------------------- */
+/* Simulated core (sim_core.c)                                               */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Reset the interrupt controller and core registers.
+ *
+ * @param opt Options (run time, pacing).
+ *
+ * @return None.
+ */
+void SimCore_Init(const SimOptions_t *opt);
+
+/**
+ * @brief Current virtual time.
+ *
+ * @return Nanoseconds since reset.
+ */
+uint64_t SimCore_NowNs(void);
+
+/**
+ * @brief Mark an interrupt pending; it runs as soon as it is unmasked.
+ *
+ * @param irq Interrupt or SysTick_IRQn.
+ *
+ * @return None.
+ */
+void SimCore_Pend(IRQn_Type irq);
+
+/**
+ * @brief Whether the core is waiting in STOP (SLEEPDEEP set).
+ *
+ * @return true while a deep-sleep WFI is in progress.
+ */
+bool SimCore_InDeepSleep(void);
+
+/**
+ * @brief Stop the run at @p end_ns if that is earlier than the current end.
+ *
+ * @param end_ns Virtual end time.
+ *
+ * @return None.
+ */
+void SimCore_SetEndNs(uint64_t end_ns);
+
+/**
+ * @brief Count one iteration of a possible busy wait.
+ *
+ * Called by the PRIMASK intrinsics, HAL_GetTick(), Time_NowUs() and
+ * DWT accesses (a loop on CYCCNT). After enough calls without a WFI, or once the host
+ * asked to stop, virtual time moves to the next event.
+ *
+ * @return None.
+ */
+void SimCore_Poll(void);
+
+/**
+ * @brief Spend STANDBY until a wakeup source fires, then reset.
+ *
+ * Only the RTC and B1 (RTC time stamp) can end it; console input in the
+ * meantime is lost. Ends the run instead if its end comes first.
+ *
+ * @return Does not return.
+ */
+void SimCore_Standby(void) __attribute__((__noreturn__));
+
+/**
+ * @brief Copy the core statistics.
+ *
+ * @return None.
+ */
+void SimCore_GetStats(SimCoreStats_t *stats);
+
+/* ------------------------------------------------------------------------- */
+/* Peripheral models (sim_hw.c)                                              */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Map flash and RAM at their MCU addresses and reset the registers.
+ *
+ * @param opt Options (flash image, button presses).
+ *
+ * @return false if the memory could not be mapped.
+ */
+bool SimHw_Init(const SimOptions_t *opt);
+
+/**
+ * @brief Apply register writes the firmware made since the last call.
+ *
+ * EXTI->PR is write-one-to-clear, which plain memory cannot model. The
+ * simulated register carries a marker bit (reserved on the MCU); a write
+ * replaces it, and the written bits are then cleared from the real pending
+ * state. Called from every core hook and HAL stub.
+ *
+ * @return None.
+ */
+void SimHw_Sync(void);
+
+/**
+ * @brief Copy the peripheral statistics.
+ *
+ * @return None.
+ */
+void SimHw_GetStats(SimHwStats_t *stats);
+
+/**
+ * @brief Power the peripherals down for STANDBY and find its end.
+ *
+ * Cancels every pending event but the RTC wakeup and the B1 presses.
+ *
+ * @param[out] rtcIsr RTC_ISR flags the wakeup sets (WUTF or TSF).
+ *
+ * @return Virtual time of the wakeup, or SIM_NEVER.
+ */
+uint64_t SimHw_EnterStandby(uint32_t *rtcIsr);
+
+/**
+ * @brief File a restarted process maps at @p address to keep its content.
+ *
+ * The -f or -B file if one was given; otherwise a memfd holding a copy
+ * of the memory, inherited across exec.
+ *
+ * @param address FLASH_BASE or BKPSRAM_BASE.
+ *
+ * @return Path, or NULL if no copy could be made.
+ */
+const char *SimHw_ImagePath(uintptr_t address);
+
+/**
+ * @brief Earliest pending peripheral event.
+ *
+ * @return Virtual time, or SIM_NEVER.
+ */
+uint64_t SimHw_NextEventNs(void);
+
+/**
+ * @brief Fire every peripheral event due at or before @p now_ns.
+ *
+ * @param now_ns Current virtual time.
+ *
+ * @return None.
+ */
+void SimHw_RunEvents(uint64_t now_ns);
+
+/**
+ * @brief Start a DMA transmission on the console UART.
+ *
+ * The bytes go to stdout at once; completion is signalled after the
+ * transfer time at the configured baud rate.
+ *
+ * @return None.
+ */
+void SimHw_UartStartTx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Send bytes on the console UART by polling (fault path).
+ *
+ * @return None.
+ */
+void SimHw_UartWriteBlocking(const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Cancel the DMA transmission in progress.
+ *
+ * @return None.
+ */
+void SimHw_UartAbortTx(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Start circular DMA reception into @p buffer.
+ *
+ * @return None.
+ */
+void SimHw_UartStartRx(UART_HandleTypeDef *huart, uint8_t *buffer, uint16_t size);
+
+/**
+ * @brief Queue host input for the console UART receiver.
+ *
+ * @param data  Bytes.
+ * @param len   Number of bytes.
+ * @param at_ns Time the first start bit goes out; not before now.
+ *
+ * @return Number of bytes queued (less than @p len when the queue is full).
+ */
+size_t SimHw_UartInject(const uint8_t *data, size_t len, uint64_t at_ns);
+
+/**
+ * @brief Free space in the receive queue.
+ *
+ * @return Bytes.
+ */
+size_t SimHw_UartInjectSpace(void);
+
+/**
+ * @brief Time at which the last queued input byte is received.
+ *
+ * @return Virtual time (0 if nothing was ever queued).
+ */
+uint64_t SimHw_UartLastRxNs(void);
+
+/**
+ * @brief Service the console UART interrupt (IDLE line).
+ *
+ * @return None.
+ */
+void SimHw_UartIrq(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Service a console UART DMA stream interrupt.
+ *
+ * @return None.
+ */
+void SimHw_UartDmaIrq(DMA_HandleTypeDef *hdma);
+
+/**
+ * @brief Flash address of the start of @p sector.
+ *
+ * @return Address, or 0 for an invalid sector.
+ */
+uint32_t SimHw_FlashSectorAddress(uint32_t sector);
+
+/**
+ * @brief Size of @p sector in bytes.
+ *
+ * @return Size, or 0 for an invalid sector.
+ */
+uint32_t SimHw_FlashSectorSize(uint32_t sector);
+
+/**
+ * @brief Start an interrupt-driven erase of @p count sectors.
+ *
+ * @return None.
+ */
+void SimHw_FlashStartEraseIt(uint32_t sector, uint32_t count);
+
+/**
+ * @brief Service the flash interrupt.
+ *
+ * @return None.
+ */
+void SimHw_FlashIrq(void);
+
+/**
+ * @brief Whether an interrupt-driven erase is in progress.
+ *
+ * @return true while sectors are still being erased.
+ */
+bool SimHw_FlashBusy(void);
+
+/**
+ * @brief Arm the periodic RTC wakeup timer.
+ *
+ * @param period_ns Time to the first and between further wakeup events.
+ *
+ * @return None.
+ */
+void SimHw_RtcStartWakeup(uint64_t period_ns);
+
+/**
+ * @brief Disarm the RTC wakeup timer.
+ *
+ * @return None.
+ */
+void SimHw_RtcStopWakeup(void);
+
+/**
+ * @brief Raise the I2C1 event interrupt after @p delay_ns (end of the
+ *        transaction the sim I2C port is running).
+ *
+ * @param delay_ns Transaction time on the wire.
+ *
+ * @return None.
+ */
+void SimHw_I2cStart(uint64_t delay_ns);
+
+/**
+ * @brief Cancel the pending I2C1 completion.
+ *
+ * @return None.
+ */
+void SimHw_I2cStop(void);
+
+/**
+ * @brief Raise the DMA1 Stream3 (SPI2 RX) interrupt after @p delay_ns
+ *        (end of the segment the sim SPI port is running).
+ *
+ * @param delay_ns Segment time on the wire.
+ *
+ * @return None.
+ */
+void SimHw_SpiStart(uint64_t delay_ns);
+
+/**
+ * @brief Cancel the pending SPI2 segment completion.
+ *
+ * @return None.
+ */
+void SimHw_SpiStop(void);
+
+/**
+ * @brief Raise the OTG FS interrupt at @p at_ns (next event of the
+ *        simulated USB host).
+ *
+ * @param at_ns Virtual time, or SIM_NEVER to cancel.
+ *
+ * @return None.
+ */
+void SimHw_UsbSchedule(uint64_t at_ns);
+
+/**
+ * @brief Raise the USART6 interrupt at @p at_ns (next event of the
+ *        simulated uplink modem).
+ *
+ * @param at_ns Virtual time, or SIM_NEVER to cancel.
+ *
+ * @return None.
+ */
+void SimHw_UplinkSchedule(uint64_t at_ns);
+
+/**
+ * @brief Reload the IWDG: the run ends with a watchdog reset after
+ *        @p timeout_ns unless it is reloaded again.
+ *
+ * @param timeout_ns Time until the counter reaches zero.
+ *
+ * @return None.
+ */
+void SimHw_WatchdogReload(uint64_t timeout_ns);
+
+/* ------------------------------------------------------------------------- */
+/* USB host (sim_usb_cdc_hw.c)                                               */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Reset the USB host model; attach the host if requested (-u).
+ *
+ * Call after SimHw_Init(). The host enumerates once the firmware
+ * connects the device.
+ *
+ * @param opt Options.
+ *
+ * @return None.
+ */
+void SimUsb_Init(const SimOptions_t *opt);
+
+/**
+ * @brief Queue host input to go out as bulk OUT packets.
+ *
+ * @param data  Bytes.
+ * @param len   Number of bytes.
+ * @param at_ns Earliest time the first packet may go.
+ *
+ * @return Bytes queued (limited by the queue space).
+ */
+size_t SimUsb_Inject(const uint8_t *data, size_t len, uint64_t at_ns);
+
+/**
+ * @brief Free space in the host input queue.
+ *
+ * @return Bytes.
+ */
+size_t SimUsb_InjectSpace(void);
+
+/**
+ * @brief Time the last queued input byte has been (or will be) sent.
+ *
+ * @return Virtual time.
+ */
+uint64_t SimUsb_LastRxNs(void);
+
+/**
+ * @brief Copy the USB host counters.
+ *
+ * @return None.
+ */
+void SimUsb_GetStats(SimUsbStats_t *stats);
+
+/* ------------------------------------------------------------------------- */
+/* Uplink modem (sim_uplink_hw.c)                                            */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Reset the modem and back end model, with the loss pattern of -l.
+ *
+ * Call before the firmware starts.
+ *
+ * @param opt Options.
+ *
+ * @return None.
+ */
+void SimUplink_Init(const SimOptions_t *opt);
+
+/* ------------------------------------------------------------------------- */
+/* Replay file (sim_replay.c)                                                */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Load the capture of -P for the replay sensor's file source.
+ *
+ * Call before the firmware starts. Without -P, `replay file` is refused.
+ *
+ * @param opt Options.
+ *
+ * @return None.
+ */
+void SimReplay_Init(const SimOptions_t *opt);
+
+/* ------------------------------------------------------------------------- */
+/* Host side (sim_main.c)                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Let the host catch up with virtual time @p target_ns.
+ *
+ * Reads stdin into the UART receiver. In real-time mode it sleeps until
+ * the wall clock reaches @p target_ns, returning early when input
+ * arrives.
+ *
+ * @param target_ns Next event time (SIM_NEVER: wait for input).
+ *
+ * @return Virtual time reached (at most @p target_ns).
+ */
+uint64_t SimHost_Wait(uint64_t target_ns);
+
+/**
+ * @brief Whether SIGINT or SIGTERM asked the run to end.
+ *
+ * SimHost_Wait() then exits; a busy wait reaches it at its next poll.
+ */
+bool SimHost_StopRequested(void);
+
+/**
+ * @brief Write console output.
+ *
+ * @return None.
+ */
+void SimHost_Output(const uint8_t *data, size_t len);
+
+/**
+ * @brief End the run: flush output, print the summary and exit.
+ *
+ * @param status Process exit status.
+ *
+ * @return Does not return.
+ */
+void SimHost_Exit(int status) __attribute__((__noreturn__));
+
+/**
+ * @brief Reset the MCU: restart the process at virtual time @p at_ns.
+ *
+ * The firmware is re-executed with the options in effect plus the
+ * restart state (-S). Flash and backup SRAM keep their content; RAM,
+ * registers and console input in flight do not.
+ *
+ * @param at_ns   Virtual time of the reset.
+ * @param rccCsr  RCC_CSR reset flags of the new boot.
+ * @param pwrCsr  PWR_CSR bits of the new boot (SBF, WUF, BRE, BRR).
+ * @param rtcIsr  RTC_ISR wakeup flags of the new boot.
+ * @param standby true for a wakeup from STANDBY.
+ *
+ * @return Does not return.
+ */
+void SimHost_Reset(uint64_t at_ns, uint32_t rccCsr, uint32_t pwrCsr, uint32_t rtcIsr, bool standby)
+    __attribute__((__noreturn__));
+
+/** @} */ /* end of sim group */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_H */
@@ -0,0 +1,828 @@
+/**
+ * @file sim_core.c
+ * @brief Simulated Cortex-M4 core: virtual clock, NVIC, SysTick and DWT.
+ *
+ * Exceptions are identified by their exception number (IRQn + 16), as in
+ * IPSR. An interrupt runs when it is pending, enabled, PRIMASK is clear
+ * and its group priority is higher than the one being serviced and than
+ * BASEPRI. That is checked whenever something can change the answer:
+ * PRIMASK cleared, BASEPRI lowered, an NVIC call, WFI, or a detected busy
+ * wait.
+ *
+ * SysTick is modelled from its registers rather than as a periodic
+ * event, so the tickless idle code (which stops the counter, reads VAL
+ * and reloads it with a long period) sees the same values as on the MCU.
+ * Cycles are derived from virtual time and SystemCoreClock.
+ *
+ * The firmware reaches SysTick through SimCore_SysTickAccess(), which
+ * hands out g_simSysTick as a window onto the model. What the firmware
+ * wrote there since the previous access is taken into the model first:
+ * a changed VAL is a write (VAL = 0, COUNTFLAG cleared, the next clock
+ * reloads LOAD without an exception), a changed LOAD or control bit a
+ * write to LOAD or CTRL. The register cannot be told from the pointer,
+ * so every access counts as a CTRL read and clears COUNTFLAG after
+ * showing it. On the MCU at least one counter clock passes between two
+ * accesses, so an enabled counter at 0 (after a VAL write or a wrap) is
+ * reloaded from LOAD as it is at the next access or advance of virtual
+ * time; that clock is charged to the next advance.
+ *
+ * @ingroup sim
+ */
+
+#include "sim.h"
+#include "stm32f4xx_it.h"
+#include <stdio.h>
+#include <string.h>
+
+/** @brief Exception numbers modelled (16 system + device interrupts). */
+#define SIM_CORE_EXCEPTIONS       (16U + 128U)
+
+/** @brief Exception number of SysTick. */
+#define SIM_CORE_SYSTICK_EXC      ((uint32_t)(SysTick_IRQn + 16))
+
+/**
+ * @brief Interrupt mask toggles, tick reads or DWT accesses without a
+ *        WFI before the core counts as busy waiting.
+ *
+ * Polling loops (draining the UART, waiting for a tick) would otherwise
+ * spin forever, because code runs in zero virtual time.
+ */
+#define SIM_CORE_SPIN_LIMIT       (10000U)
+
+/** @brief Nanoseconds per second. */
+#define SIM_CORE_NS_PER_S         (1000000000ULL)
+
+/** @brief Execution priority in thread mode (below every exception). */
+#define SIM_CORE_THREAD_PRIORITY  (0x100U)
+
+/** @brief Interrupt handler. */
+typedef void (*SimCoreHandler_t)(void);
+
+/* ------------------------------------------------------------------------- */
+/* Core register blocks (referenced by cmsis_nvic_virtual.h)                 */
+/* ------------------------------------------------------------------------- */
+
+SCB_Type       g_simScb;
+SysTick_Type   g_simSysTick;
+NVIC_Type      g_simNvic;
+DWT_Type       g_simDwt;
+CoreDebug_Type g_simCoreDebug;
+
+/**
+ * @brief Handlers of the exceptions the firmware uses.
+ *
+ * Keep in line with Core/Src/stm32f4xx_it.c.
+ */
+static const SimCoreHandler_t s_vectors[SIM_CORE_EXCEPTIONS] =
+{
+    [NonMaskableInt_IRQn   + 16] = NMI_Handler,
+    [3]                          = HardFault_Handler, /* no IRQn_Type entry */
+    [MemoryManagement_IRQn + 16] = MemManage_Handler,
+    [BusFault_IRQn         + 16] = BusFault_Handler,
+    [UsageFault_IRQn       + 16] = UsageFault_Handler,
+    [SVCall_IRQn           + 16] = SVC_Handler,
+    [DebugMonitor_IRQn     + 16] = DebugMon_Handler,
+    [PendSV_IRQn           + 16] = PendSV_Handler,
+    [SysTick_IRQn          + 16] = SysTick_Handler,
+    [DMA1_Stream5_IRQn     + 16] = DMA1_Stream5_IRQHandler,
+    [DMA1_Stream6_IRQn     + 16] = DMA1_Stream6_IRQHandler,
+    [USART2_IRQn           + 16] = USART2_IRQHandler,
+    [EXTI3_IRQn            + 16] = EXTI3_IRQHandler,
+    [EXTI15_10_IRQn        + 16] = EXTI15_10_IRQHandler,
+    [RTC_WKUP_IRQn         + 16] = RTC_WKUP_IRQHandler,
+    [FLASH_IRQn            + 16] = FLASH_IRQHandler,
+    [TIM3_IRQn             + 16] = TIM3_IRQHandler,
+    [TIM5_IRQn             + 16] = TIM5_IRQHandler,
+    [DMA2_Stream0_IRQn     + 16] = DMA2_Stream0_IRQHandler,
+    [DMA1_Stream0_IRQn     + 16] = DMA1_Stream0_IRQHandler,
+    [I2C1_EV_IRQn          + 16] = I2C1_EV_IRQHandler,
+    [I2C1_ER_IRQn          + 16] = I2C1_ER_IRQHandler,
+    [DMA1_Stream7_IRQn     + 16] = DMA1_Stream7_IRQHandler,
+    [DMA1_Stream3_IRQn     + 16] = DMA1_Stream3_IRQHandler,
+    [DMA1_Stream4_IRQn     + 16] = DMA1_Stream4_IRQHandler,
+    [OTG_FS_IRQn           + 16] = OTG_FS_IRQHandler,
+    [USART6_IRQn           + 16] = USART6_IRQHandler,
+    [USART1_IRQn           + 16] = USART1_IRQHandler,
+    [DMA2_Stream7_IRQn     + 16] = DMA2_Stream7_IRQHandler,
+    [FMPI2C1_EV_IRQn       + 16] = FMPI2C1_EV_IRQHandler,
+    [FMPI2C1_ER_IRQn       + 16] = FMPI2C1_ER_IRQHandler
+};
+
+/**
+ * @brief Virtual time since reset.
+ */
+static uint64_t s_now_ns = 0U;
+
+/**
+ * @brief Virtual time at which the run ends.
+ */
+static uint64_t s_end_ns = SIM_NEVER;
+
+/**
+ * @brief Fraction of a core cycle carried between advances (ns * Hz units).
+ */
+static uint64_t s_cycleFrac = 0U;
+
+/**
+ * @brief PRIMASK.
+ */
+static uint32_t s_primask = 0U;
+
+/**
+ * @brief BASEPRI (priority value in the implemented bits, 0 = no mask).
+ */
+static uint32_t s_basepri = 0U;
+
+/**
+ * @brief Exception being serviced (IPSR), 0 in thread mode.
+ */
+static uint32_t s_active = 0U;
+
+/**
+ * @brief Group priority of the exception being serviced.
+ */
+static uint32_t s_activePriority = SIM_CORE_THREAD_PRIORITY;
+
+/**
+ * @brief NVIC state per exception number.
+ */
+static bool    s_enabled[SIM_CORE_EXCEPTIONS];
+static bool    s_pending[SIM_CORE_EXCEPTIONS];
+static uint8_t s_priority[SIM_CORE_EXCEPTIONS];
+
+/**
+ * @brief PRIGROUP field of AIRCR.
+ */
+static uint32_t s_priorityGroup = 0U;
+
+/**
+ * @brief A deep-sleep (STOP) WFI is in progress.
+ */
+static bool s_deepSleep = false;
+
+/**
+ * @brief SysTick model; g_simSysTick is the firmware's window onto it.
+ */
+static SysTick_Type s_sysTick;
+
+/**
+ * @brief g_simSysTick as last handed out, to detect firmware writes.
+ */
+static SysTick_Type s_sysTickShown;
+
+/**
+ * @brief The counter was reloaded ahead of the clock that does it.
+ */
+static bool s_sysTickReloaded = false;
+
+/**
+ * @brief Busy-wait iterations since the last WFI.
+ */
+static uint32_t s_spinCount = 0U;
+
+/**
+ * @brief Run statistics.
+ */
+static SimCoreStats_t s_stats;
+
+/**
+ * @brief Exception number for @p irq, or SIM_CORE_EXCEPTIONS if invalid.
+ */
+static uint32_t SimCore_Exception(IRQn_Type irq);
+
+/**
+ * @brief Group (preemption) priority of exception @p exc.
+ */
+static uint32_t SimCore_GroupPriority(uint32_t exc);
+
+/**
+ * @brief Highest-priority exception that may preempt now, or 0.
+ *
+ * @param ignorePrimask Wake-up check for WFI, which ignores PRIMASK.
+ */
+static uint32_t SimCore_NextException(bool ignorePrimask);
+
+/**
+ * @brief Run every interrupt that may preempt the current context.
+ */
+static void SimCore_Dispatch(void);
+
+/**
+ * @brief Advance virtual time to the next event (or as far as the host
+ *        allows) and fire what is due.
+ */
+static void SimCore_Step(void);
+
+/**
+ * @brief Advance virtual time to @p t_ns, clocking SysTick and DWT.
+ */
+static void SimCore_AdvanceTo(uint64_t t_ns);
+
+/**
+ * @brief Take firmware writes to g_simSysTick into the model and show
+ *        the model's registers there again.
+ */
+static void SimCore_SysTickSync(void);
+
+/**
+ * @brief Virtual time of the next SysTick interrupt, or SIM_NEVER.
+ */
+static uint64_t SimCore_SysTickNextNs(void);
+
+/**
+ * @brief Clock SysTick by @p cycles.
+ */
+static void SimCore_SysTickRun(uint64_t cycles);
+
+/**
+ * @brief Mirror the SysTick pending state into ICSR.PENDSTSET.
+ */
+static void SimCore_UpdateIcsr(void);
+
+/* ------------------------------------------------------------------------- */
+
+void SimCore_Init(const SimOptions_t *opt)
+{
+    (void)memset(&g_simScb, 0, sizeof(g_simScb));
+    (void)memset(&g_simSysTick, 0, sizeof(g_simSysTick));
+    (void)memset(&s_sysTick, 0, sizeof(s_sysTick));
+    (void)memset(&s_sysTickShown, 0, sizeof(s_sysTickShown));
+    (void)memset(&g_simNvic, 0, sizeof(g_simNvic));
+    (void)memset(&g_simDwt, 0, sizeof(g_simDwt));
+    (void)memset(&g_simCoreDebug, 0, sizeof(g_simCoreDebug));
+    (void)memset(s_enabled, 0, sizeof(s_enabled));
+    (void)memset(s_pending, 0, sizeof(s_pending));
+    (void)memset(s_priority, 0, sizeof(s_priority));
+    (void)memset(&s_stats, 0, sizeof(s_stats));
+
+    /* System exceptions cannot be disabled in the NVIC. */
+    for (uint32_t exc = 1U; exc < 16U; ++exc)
+    {
+        s_enabled[exc] = true;
+    }
+
+    s_now_ns          = opt->start_ns;
+    s_end_ns          = opt->duration_ns;
+    s_cycleFrac       = 0U;
+    s_primask         = 0U;
+    s_active          = 0U;
+    s_activePriority  = SIM_CORE_THREAD_PRIORITY;
+    s_priorityGroup   = 0U;
+    s_basepri         = 0U;
+    s_deepSleep       = false;
+    s_sysTickReloaded = false;
+    s_spinCount       = 0U;
+}
+
+uint64_t SimCore_NowNs(void)
+{
+    return s_now_ns;
+}
+
+void SimCore_Pend(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if (exc < SIM_CORE_EXCEPTIONS)
+    {
+        s_pending[exc] = true;
+        SimCore_UpdateIcsr();
+    }
+}
+
+bool SimCore_InDeepSleep(void)
+{
+    return s_deepSleep;
+}
+
+void SimCore_SetEndNs(uint64_t end_ns)
+{
+    if (end_ns < s_end_ns)
+    {
+        s_end_ns = end_ns;
+    }
+}
+
+void SimCore_Poll(void)
+{
+    if ((++s_spinCount < SIM_CORE_SPIN_LIMIT) && !SimHost_StopRequested())
+    {
+        return;
+    }
+
+    /* Busy waiting: the loop can only end through an event. */
+    s_spinCount = 0U;
+    s_stats.spinSteps++;
+    SimCore_Step();
+    SimCore_Dispatch();
+}
+
+void SimCore_Standby(void)
+{
+    uint32_t rtcIsr = 0U;
+    uint64_t wake   = SimHw_EnterStandby(&rtcIsr);
+
+    /* Core, SysTick and DWT are off. */
+    s_deepSleep = true;
+
+    while (s_now_ns < wake)
+    {
+        uint64_t t = SimHost_Wait((wake < s_end_ns) ? wake : s_end_ns);
+        if (t > s_now_ns)
+        {
+            s_now_ns = t;
+        }
+        if (s_now_ns >= s_end_ns)
+        {
+            SimHost_Exit(0);
+        }
+    }
+
+    SimHost_Reset(s_now_ns, 0U, PWR_CSR_SBF | PWR_CSR_WUF | (PWR->CSR & (PWR_CSR_BRE | PWR_CSR_BRR)),
+                  rtcIsr, true);
+}
+
+void SimCore_GetStats(SimCoreStats_t *stats)
+{
+    *stats = s_stats;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Intrinsics (sim/include/core_cm4.h)                                       */
+/* ------------------------------------------------------------------------- */
+
+void SimCore_SetPrimask(uint32_t primask)
+{
+    SimHw_Sync();
+    s_primask = primask & 1U;
+
+    if (s_primask == 0U)
+    {
+        SimCore_Dispatch();
+        SimCore_Poll();
+    }
+}
+
+uint32_t SimCore_GetPrimask(void)
+{
+    return s_primask;
+}
+
+void SimCore_SetBasepri(uint32_t basepri)
+{
+    uint32_t old = s_basepri;
+
+    SimHw_Sync();
+    s_basepri = basepri & 0xFFU;
+
+    if ((s_basepri == 0U) || ((old != 0U) && (s_basepri > old)))
+    {
+        SimCore_Dispatch();
+    }
+}
+
+void SimCore_SetBasepriMax(uint32_t basepri)
+{
+    basepri &= 0xFFU;
+
+    if ((basepri != 0U) && ((s_basepri == 0U) || (basepri < s_basepri)))
+    {
+        s_basepri = basepri;
+    }
+}
+
+uint32_t SimCore_GetBasepri(void)
+{
+    return s_basepri;
+}
+
+uint32_t SimCore_GetIpsr(void)
+{
+    return s_active;
+}
+
+uint32_t SimCore_GetMsp(void)
+{
+    extern uint32_t _estack;
+
+    /* A fixed depth: host stack usage says nothing about the MCU's. */
+    return (uint32_t)(uintptr_t)&_estack - 256U;
+}
+
+void SimCore_WaitForInterrupt(void)
+{
+    SimHw_Sync();
+
+    uint64_t start = s_now_ns;
+
+    s_deepSleep = ((g_simScb.SCR & SCB_SCR_SLEEPDEEP_Msk) != 0U);
+    s_spinCount = 0U;
+    s_stats.wfiCount++;
+
+    while (SimCore_NextException(true) == 0U)
+    {
+        SimCore_Step();
+    }
+
+    if (s_deepSleep)
+    {
+        uint64_t window = s_now_ns - start;
+
+        s_stats.stops++;
+        s_stats.stopNs += window;
+        if (window > s_stats.stopMaxNs)
+        {
+            s_stats.stopMaxNs = window;
+        }
+    }
+
+    s_deepSleep = false;
+    SimCore_Dispatch();
+}
+
+/* ------------------------------------------------------------------------- */
+/* NVIC (sim/include/cmsis_nvic_virtual.h)                                   */
+/* ------------------------------------------------------------------------- */
+
+void SimCore_NvicSetPriorityGrouping(uint32_t group)
+{
+    s_priorityGroup = group & 0x07U;
+    g_simScb.AIRCR  = (g_simScb.AIRCR & ~SCB_AIRCR_PRIGROUP_Msk) |
+                      (s_priorityGroup << SCB_AIRCR_PRIGROUP_Pos);
+}
+
+uint32_t SimCore_NvicGetPriorityGrouping(void)
+{
+    return s_priorityGroup;
+}
+
+void SimCore_NvicEnableIrq(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if ((exc >= 16U) && (exc < SIM_CORE_EXCEPTIONS))
+    {
+        s_enabled[exc] = true;
+        SimHw_Sync();
+        SimCore_Dispatch();
+    }
+}
+
+uint32_t SimCore_NvicGetEnableIrq(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    return ((exc < SIM_CORE_EXCEPTIONS) && s_enabled[exc]) ? 1U : 0U;
+}
+
+void SimCore_NvicDisableIrq(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if ((exc >= 16U) && (exc < SIM_CORE_EXCEPTIONS))
+    {
+        s_enabled[exc] = false;
+    }
+}
+
+uint32_t SimCore_NvicGetPendingIrq(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    return ((exc < SIM_CORE_EXCEPTIONS) && s_pending[exc]) ? 1U : 0U;
+}
+
+void SimCore_NvicSetPendingIrq(IRQn_Type irq)
+{
+    SimCore_Pend(irq);
+    SimHw_Sync();
+    SimCore_Dispatch();
+}
+
+void SimCore_NvicClearPendingIrq(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if (exc < SIM_CORE_EXCEPTIONS)
+    {
+        s_pending[exc] = false;
+        SimCore_UpdateIcsr();
+    }
+    SimHw_Sync();
+}
+
+uint32_t SimCore_NvicGetActive(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    return ((exc != 0U) && (exc == s_active)) ? 1U : 0U;
+}
+
+void SimCore_NvicSetPriority(IRQn_Type irq, uint32_t priority)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if (exc < SIM_CORE_EXCEPTIONS)
+    {
+        s_priority[exc] = (uint8_t)((priority << (8U - __NVIC_PRIO_BITS)) & 0xFFU);
+    }
+}
+
+uint32_t SimCore_NvicGetPriority(IRQn_Type irq)
+{
+    uint32_t exc = SimCore_Exception(irq);
+    if (exc >= SIM_CORE_EXCEPTIONS)
+    {
+        return 0U;
+    }
+
+    return (uint32_t)s_priority[exc] >> (8U - __NVIC_PRIO_BITS);
+}
+
+void SimCore_NvicSystemReset(void)
+{
+    /* The backup domain (BRE and its ready flag) survives the reset. */
+    SimHost_Reset(s_now_ns, RCC_CSR_SFTRSTF | RCC_CSR_PINRSTF, PWR->CSR & (PWR_CSR_BRE | PWR_CSR_BRR),
+                  0U, false);
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t SimCore_Exception(IRQn_Type irq)
+{
+    int32_t exc = (int32_t)irq + 16;
+
+    if ((exc <= 0) || (exc >= (int32_t)SIM_CORE_EXCEPTIONS))
+    {
+        return SIM_CORE_EXCEPTIONS;
+    }
+
+    return (uint32_t)exc;
+}
+
+static uint32_t SimCore_GroupPriority(uint32_t exc)
+{
+    /* Fixed-priority faults outrank everything configurable. */
+    if (exc < (uint32_t)(MemoryManagement_IRQn + 16))
+    {
+        return 0U;
+    }
+
+    return 1U + ((uint32_t)s_priority[exc] >> (s_priorityGroup + 1U));
+}
+
+static uint32_t SimCore_NextException(bool ignorePrimask)
+{
+    if ((s_primask != 0U) && !ignorePrimask)
+    {
+        return 0U;
+    }
+
+    uint32_t best         = 0U;
+    uint32_t bestPriority = 0U;
+
+    for (uint32_t exc = 1U; exc < SIM_CORE_EXCEPTIONS; ++exc)
+    {
+        if (!s_pending[exc] || !s_enabled[exc])
+        {
+            continue;
+        }
+
+        /* Ties go to the lower number, like the NVIC. */
+        uint32_t priority = ((uint32_t)s_priority[exc] << 8) | exc;
+        if ((best == 0U) || (priority < bestPriority))
+        {
+            best         = exc;
+            bestPriority = priority;
+        }
+    }
+
+    /* BASEPRI also keeps a masked interrupt from ending a WFI. */
+    uint32_t ceiling = s_activePriority;
+    if (s_basepri != 0U)
+    {
+        uint32_t masked = 1U + (s_basepri >> (s_priorityGroup + 1U));
+        if (masked < ceiling)
+        {
+            ceiling = masked;
+        }
+    }
+
+    if ((best == 0U) || (SimCore_GroupPriority(best) >= ceiling))
+    {
+        return 0U;
+    }
+
+    return best;
+}
+
+static void SimCore_Dispatch(void)
+{
+    uint32_t exc;
+
+    while ((exc = SimCore_NextException(false)) != 0U)
+    {
+        SimCoreHandler_t handler = s_vectors[exc];
+        if (handler == NULL)
+        {
+            (void)fprintf(stderr, "sim: no handler for exception %lu\n", (unsigned long)exc);
+            SimHost_Exit(2);
+        }
+
+        uint32_t savedActive   = s_active;
+        uint32_t savedPriority = s_activePriority;
+
+        s_pending[exc] = false;
+        SimCore_UpdateIcsr();
+        s_active         = exc;
+        s_activePriority = SimCore_GroupPriority(exc);
+        s_stats.interrupts++;
+
+        handler();
+
+        s_active         = savedActive;
+        s_activePriority = savedPriority;
+    }
+}
+
+static void SimCore_Step(void)
+{
+    uint64_t next = SimCore_SysTickNextNs();
+    uint64_t hw   = SimHw_NextEventNs();
+
+    if (hw < next)
+    {
+        next = hw;
+    }
+    if (s_end_ns < next)
+    {
+        next = s_end_ns;
+    }
+
+    SimCore_AdvanceTo(SimHost_Wait(next));
+}
+
+static void SimCore_AdvanceTo(uint64_t t_ns)
+{
+    SimCore_SysTickSync();
+
+    if (t_ns > s_now_ns)
+    {
+        uint64_t delta = t_ns - s_now_ns;
+
+        /* The core clock and with it SysTick and DWT stop in STOP. */
+        if (!s_deepSleep && (SystemCoreClock != 0U))
+        {
+            unsigned __int128 total = ((unsigned __int128)delta * SystemCoreClock) + s_cycleFrac;
+            uint64_t cycles = (uint64_t)(total / SIM_CORE_NS_PER_S);
+            s_cycleFrac     = (uint64_t)(total % SIM_CORE_NS_PER_S);
+
+            SimCore_SysTickRun(cycles);
+
+            if (((g_simCoreDebug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) != 0U) &&
+                ((g_simDwt.CTRL & DWT_CTRL_CYCCNTENA_Msk) != 0U))
+            {
+                g_simDwt.CYCCNT += (uint32_t)cycles;
+            }
+        }
+
+        s_now_ns = t_ns;
+    }
+
+    SimHw_RunEvents(s_now_ns);
+
+    if (s_now_ns >= s_end_ns)
+    {
+        SimHost_Exit(0);
+    }
+}
+
+DWT_Type *SimCore_DwtAccess(void)
+{
+    /* CYCCNT only moves with virtual time: a loop on it is a busy wait. */
+    SimCore_Poll();
+
+    return &g_simDwt;
+}
+
+SysTick_Type *SimCore_SysTickAccess(void)
+{
+    SimCore_SysTickSync();
+
+    /* Shown once: this access may be the CTRL read that clears it. */
+    s_sysTick.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+
+    return &g_simSysTick;
+}
+
+static void SimCore_SysTickSync(void)
+{
+    const uint32_t ctrlMask = SysTick_CTRL_ENABLE_Msk |
+                              SysTick_CTRL_TICKINT_Msk |
+                              SysTick_CTRL_CLKSOURCE_Msk;
+
+    if (g_simSysTick.LOAD != s_sysTickShown.LOAD)
+    {
+        s_sysTick.LOAD = g_simSysTick.LOAD & SysTick_LOAD_RELOAD_Msk;
+    }
+    if (g_simSysTick.VAL != s_sysTickShown.VAL)
+    {
+        s_sysTick.VAL   = 0U;
+        s_sysTick.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    }
+    if (((g_simSysTick.CTRL ^ s_sysTickShown.CTRL) & ctrlMask) != 0U)
+    {
+        s_sysTick.CTRL = (s_sysTick.CTRL & ~ctrlMask) | (g_simSysTick.CTRL & ctrlMask);
+    }
+
+    /* The clock that reloads the counter has passed by now. */
+    if (((s_sysTick.CTRL & SysTick_CTRL_ENABLE_Msk) != 0U) &&
+        (s_sysTick.VAL == 0U) && (s_sysTick.LOAD != 0U))
+    {
+        s_sysTick.VAL     = s_sysTick.LOAD;
+        s_sysTickReloaded = true;
+    }
+
+    g_simSysTick.CTRL   = s_sysTick.CTRL;
+    g_simSysTick.LOAD   = s_sysTick.LOAD;
+    g_simSysTick.VAL    = s_sysTick.VAL;
+    s_sysTickShown.CTRL = s_sysTick.CTRL;
+    s_sysTickShown.LOAD = s_sysTick.LOAD;
+    s_sysTickShown.VAL  = s_sysTick.VAL;
+}
+
+static uint64_t SimCore_SysTickNextNs(void)
+{
+    SimCore_SysTickSync();
+
+    uint32_t ctrl = s_sysTick.CTRL;
+
+    if (s_deepSleep ||
+        (SystemCoreClock == 0U) ||
+        ((ctrl & SysTick_CTRL_ENABLE_Msk) == 0U) ||
+        ((ctrl & SysTick_CTRL_TICKINT_Msk) == 0U))
+    {
+        return SIM_NEVER;
+    }
+
+    uint32_t load = s_sysTick.LOAD & SysTick_LOAD_RELOAD_Msk;
+    uint32_t val  = s_sysTick.VAL & SysTick_VAL_CURRENT_Msk;
+
+    /* From VAL = 0 the counter first reloads, then counts LOAD down. */
+    uint64_t cycles = (val != 0U) ? val : ((uint64_t)load + 1U);
+    if (s_sysTickReloaded)
+    {
+        cycles++;
+    }
+
+    unsigned __int128 need = ((unsigned __int128)cycles * SIM_CORE_NS_PER_S);
+    need = (need > s_cycleFrac) ? (need - s_cycleFrac) : 0U;
+
+    return s_now_ns + (uint64_t)((need + SystemCoreClock - 1U) / SystemCoreClock);
+}
+
+static void SimCore_SysTickRun(uint64_t cycles)
+{
+    uint32_t ctrl = s_sysTick.CTRL;
+
+    if (((ctrl & SysTick_CTRL_ENABLE_Msk) == 0U) || (cycles == 0U))
+    {
+        return;
+    }
+
+    if (s_sysTickReloaded)
+    {
+        s_sysTickReloaded = false;
+        if (--cycles == 0U)
+        {
+            return;
+        }
+    }
+
+    uint64_t load   = (uint64_t)(s_sysTick.LOAD & SysTick_LOAD_RELOAD_Msk);
+    uint64_t val    = (uint64_t)(s_sysTick.VAL & SysTick_VAL_CURRENT_Msk);
+    uint64_t period = load + 1U;
+    uint64_t toZero = (val != 0U) ? val : period;
+
+    if (cycles < toZero)
+    {
+        s_sysTick.VAL = (uint32_t)(toZero - cycles);
+        return;
+    }
+
+    uint64_t into = (cycles - toZero) % period;
+    s_sysTick.VAL   = (into != 0U) ? (uint32_t)(period - into) : 0U;
+    s_sysTick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+
+    if ((ctrl & SysTick_CTRL_TICKINT_Msk) != 0U)
+    {
+        s_pending[SIM_CORE_SYSTICK_EXC] = true;
+        SimCore_UpdateIcsr();
+    }
+}
+
+static void SimCore_UpdateIcsr(void)
+{
+    if (s_pending[SIM_CORE_SYSTICK_EXC])
+    {
+        g_simScb.ICSR |= SCB_ICSR_PENDSTSET_Msk;
+    }
+    else
+    {
+        g_simScb.ICSR &= ~SCB_ICSR_PENDSTSET_Msk;
+    }
+}
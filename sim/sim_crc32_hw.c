@@ -0,0 +1,43 @@
+/**
+ * @file sim_crc32_hw.c
+ * @brief CRC unit port for the host simulation.
+ *
+ * Replaces common/crc32_hw.c. Register writes have no side effects in the
+ * simulation, so the unit is modelled here instead: each word is shifted
+ * through the polynomial bit by bit, MSB first, exactly as the hardware
+ * does. The byte order of the firmware's word feed is therefore checked
+ * against the table code on every run.
+ *
+ * @ingroup sim
+ */
+
+#include "crc32_hw.h"
+#include "crc32.h"
+#include "sim.h"
+#include <string.h>
+
+/** @brief CRC-32/MPEG-2 polynomial, as in the CRC unit. */
+#define SIM_CRC32_POLY   (0x04C11DB7U)
+
+/* ------------------------------------------------------------------------- */
+
+bool Crc32Hw_Compute(const void *data, size_t words, uint32_t *crc)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t       value = CRC32_INIT;
+
+    for (size_t i = 0U; i < words; ++i)
+    {
+        uint32_t word;
+
+        memcpy(&word, &bytes[4U * i], sizeof(word));
+        value ^= __REV(word);
+        for (uint32_t bit = 0U; bit < 32U; ++bit)
+        {
+            value = ((value & 0x80000000U) != 0U) ? ((value << 1) ^ SIM_CRC32_POLY) : (value << 1);
+        }
+    }
+
+    *crc = value;
+    return true;
+}
@@ -0,0 +1,765 @@
+/**
+ * @file sim_hal.c
+ * @brief HAL stubs for the host simulation.
+ *
+ * Implements the subset of the STM32F4 HAL the firmware calls, with the
+ * same return values and callback sequences, on top of the simulated
+ * core and peripherals. Register side effects the firmware relies on are
+ * kept consistent: clock switches update SWS and the ready bits, so
+ * SystemCoreClockUpdate() and the polling loops in the power code see
+ * what they expect.
+ *
+ * Weak callbacks are defined here so that the firmware's overrides link
+ * the same way as against the real HAL.
+ *
+ * @ingroup sim
+ */
+
+#include "sim.h"
+#include <string.h>
+
+/** @brief HAL tick counter and settings (stm32f4xx_hal.c). */
+__IO uint32_t        uwTick;
+uint32_t             uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+HAL_TickFreqTypeDef  uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+
+/**
+ * @brief Frequency of the PLL output selected by SW, from PLLCFGR.
+ */
+static uint32_t SimHal_PllFreq(void);
+
+/* ------------------------------------------------------------------------- */
+/* Core HAL (stm32f4xx_hal.c)                                                */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+    __HAL_FLASH_INSTRUCTION_CACHE_ENABLE();
+    __HAL_FLASH_DATA_CACHE_ENABLE();
+    __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+
+    HAL_NVIC_SetPriorityGrouping(NVIC_PRIORITYGROUP_4);
+    (void)HAL_InitTick(TICK_INT_PRIORITY);
+    HAL_MspInit();
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    if (SysTick_Config(SystemCoreClock / (1000U / (uint32_t)uwTickFreq)) != 0U)
+    {
+        return HAL_ERROR;
+    }
+
+    if (TickPriority >= (1UL << __NVIC_PRIO_BITS))
+    {
+        return HAL_ERROR;
+    }
+
+    HAL_NVIC_SetPriority(SysTick_IRQn, TickPriority, 0U);
+    uwTickPrio = TickPriority;
+
+    return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+    uwTick += (uint32_t)uwTickFreq;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    SimCore_Poll();
+    return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    uint32_t start = HAL_GetTick();
+    uint32_t wait  = Delay;
+
+    if (wait < HAL_MAX_DELAY)
+    {
+        wait += (uint32_t)uwTickFreq;
+    }
+
+    while ((HAL_GetTick() - start) < wait)
+    {
+    }
+}
+
+void HAL_SuspendTick(void)
+{
+    SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+}
+
+void HAL_ResumeTick(void)
+{
+    SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+}
+
+void HAL_DBGMCU_EnableDBGSleepMode(void)
+{
+    DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP;
+}
+
+void HAL_DBGMCU_EnableDBGStopMode(void)
+{
+    DBGMCU->CR |= DBGMCU_CR_DBG_STOP;
+}
+
+__weak void HAL_MspInit(void)
+{
+}
+
+/* ------------------------------------------------------------------------- */
+/* Cortex (stm32f4xx_hal_cortex.c)                                           */
+/* ------------------------------------------------------------------------- */
+
+void HAL_NVIC_SetPriorityGrouping(uint32_t PriorityGroup)
+{
+    NVIC_SetPriorityGrouping(PriorityGroup);
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+    NVIC_SetPriority(IRQn, NVIC_EncodePriority(NVIC_GetPriorityGrouping(), PreemptPriority, SubPriority));
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+    NVIC_EnableIRQ(IRQn);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+    NVIC_DisableIRQ(IRQn);
+}
+
+void HAL_NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+    NVIC_SetPendingIRQ(IRQn);
+}
+
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+    NVIC_ClearPendingIRQ(IRQn);
+}
+
+uint32_t HAL_NVIC_GetPendingIRQ(IRQn_Type IRQn)
+{
+    return NVIC_GetPendingIRQ(IRQn);
+}
+
+void HAL_NVIC_SystemReset(void)
+{
+    NVIC_SystemReset();
+}
+
+uint32_t HAL_SYSTICK_Config(uint32_t TicksNumb)
+{
+    return SysTick_Config(TicksNumb);
+}
+
+/* ------------------------------------------------------------------------- */
+/* RCC (stm32f4xx_hal_rcc.c)                                                 */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(const RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+    const RCC_OscInitTypeDef *osc = RCC_OscInitStruct;
+    uint32_t sws = RCC->CFGR & RCC_CFGR_SWS;
+
+    if (osc == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if ((osc->OscillatorType & RCC_OSCILLATORTYPE_HSE) != 0U)
+    {
+        /* HSE cannot be reconfigured while it clocks the system. */
+        bool hseInUse = (sws == RCC_CFGR_SWS_HSE) ||
+                        ((sws == RCC_CFGR_SWS_PLL) && ((RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) != 0U));
+        if (hseInUse)
+        {
+            if (osc->HSEState == RCC_HSE_OFF)
+            {
+                return HAL_ERROR;
+            }
+        }
+        else if (osc->HSEState == RCC_HSE_OFF)
+        {
+            RCC->CR &= ~(RCC_CR_HSEON | RCC_CR_HSEBYP | RCC_CR_HSERDY);
+        }
+        else
+        {
+            RCC->CR = (RCC->CR & ~RCC_CR_HSEBYP) | osc->HSEState | RCC_CR_HSERDY;
+        }
+    }
+
+    if (((osc->OscillatorType & RCC_OSCILLATORTYPE_HSI) != 0U) && (osc->HSIState == RCC_HSI_ON))
+    {
+        RCC->CR |= RCC_CR_HSION | RCC_CR_HSIRDY;
+    }
+
+    if ((osc->OscillatorType & RCC_OSCILLATORTYPE_LSI) != 0U)
+    {
+        if (osc->LSIState == RCC_LSI_ON)
+        {
+            RCC->CSR |= RCC_CSR_LSION | RCC_CSR_LSIRDY;
+        }
+        else
+        {
+            RCC->CSR &= ~(RCC_CSR_LSION | RCC_CSR_LSIRDY);
+        }
+    }
+
+    if (osc->PLL.PLLState != RCC_PLL_NONE)
+    {
+        /* The PLL cannot be touched while it is the system clock. */
+        if (sws == RCC_CFGR_SWS_PLL)
+        {
+            return HAL_ERROR;
+        }
+
+        if (osc->PLL.PLLState == RCC_PLL_ON)
+        {
+            if ((osc->PLL.PLLSource == RCC_PLLSOURCE_HSE) && ((RCC->CR & RCC_CR_HSERDY) == 0U))
+            {
+                return HAL_TIMEOUT;
+            }
+
+            RCC->PLLCFGR = osc->PLL.PLLSource |
+                           (osc->PLL.PLLM << RCC_PLLCFGR_PLLM_Pos) |
+                           (osc->PLL.PLLN << RCC_PLLCFGR_PLLN_Pos) |
+                           (((osc->PLL.PLLP >> 1U) - 1U) << RCC_PLLCFGR_PLLP_Pos) |
+                           (osc->PLL.PLLQ << RCC_PLLCFGR_PLLQ_Pos) |
+                           (osc->PLL.PLLR << RCC_PLLCFGR_PLLR_Pos);
+            RCC->CR |= RCC_CR_PLLON | RCC_CR_PLLRDY;
+        }
+        else
+        {
+            RCC->CR &= ~(RCC_CR_PLLON | RCC_CR_PLLRDY);
+        }
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(const RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+    const RCC_ClkInitTypeDef *clk = RCC_ClkInitStruct;
+
+    if (clk == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if ((clk->ClockType & RCC_CLOCKTYPE_SYSCLK) != 0U)
+    {
+        uint32_t ready = (clk->SYSCLKSource == RCC_SYSCLKSOURCE_HSE)    ? RCC_CR_HSERDY :
+                         (clk->SYSCLKSource == RCC_SYSCLKSOURCE_PLLCLK) ? RCC_CR_PLLRDY :
+                                                                          RCC_CR_HSIRDY;
+        if ((RCC->CR & ready) == 0U)
+        {
+            return HAL_ERROR;
+        }
+    }
+
+    FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | FLatency;
+
+    if ((clk->ClockType & RCC_CLOCKTYPE_HCLK) != 0U)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_HPRE) | clk->AHBCLKDivider;
+    }
+    if ((clk->ClockType & RCC_CLOCKTYPE_PCLK1) != 0U)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_PPRE1) | clk->APB1CLKDivider;
+    }
+    if ((clk->ClockType & RCC_CLOCKTYPE_PCLK2) != 0U)
+    {
+        RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_PPRE2) | (clk->APB2CLKDivider << 3U);
+    }
+    if ((clk->ClockType & RCC_CLOCKTYPE_SYSCLK) != 0U)
+    {
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW | RCC_CFGR_SWS)) |
+                    clk->SYSCLKSource | (clk->SYSCLKSource << RCC_CFGR_SWS_Pos);
+    }
+
+    SystemCoreClock = HAL_RCC_GetSysClockFreq() >> AHBPrescTable[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
+
+    return HAL_InitTick(uwTickPrio);
+}
+
+uint32_t HAL_RCC_GetSysClockFreq(void)
+{
+    switch (RCC->CFGR & RCC_CFGR_SWS)
+    {
+        case RCC_CFGR_SWS_HSE:
+            return HSE_VALUE;
+
+        case RCC_CFGR_SWS_PLL:
+            return SimHal_PllFreq();
+
+        case RCC_CFGR_SWS_HSI:
+        default:
+            return HSI_VALUE;
+    }
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+    return SystemCoreClock;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+    return HAL_RCC_GetHCLKFreq() >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+    return HAL_RCC_GetHCLKFreq() >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+/* ------------------------------------------------------------------------- */
+/* PWR (stm32f4xx_hal_pwr.c, stm32f4xx_hal_pwr_ex.c)                         */
+/* ------------------------------------------------------------------------- */
+
+void HAL_PWR_EnterSLEEPMode(uint32_t Regulator, uint8_t SLEEPEntry)
+{
+    (void)Regulator;
+    (void)SLEEPEntry;
+
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+    __WFI();
+}
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry)
+{
+    (void)STOPEntry;
+
+    PWR->CR = (PWR->CR & ~(PWR_CR_PDDS | PWR_CR_LPDS)) | Regulator;
+
+    /* The clock tree is left as it was: the firmware's restore path
+     * re-enables oscillators and polls ready bits, which plain memory
+     * would never set.
+     */
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __WFI();
+
+    /* Timers are halted until the core is out of STOP. */
+    SimHw_Sync();
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+}
+
+void HAL_PWR_EnterSTANDBYMode(void)
+{
+    PWR->CR  |= PWR_CR_PDDS;
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+
+    /* The wakeup is a reset: the process restarts (SimHost_Reset()). */
+    SimCore_Standby();
+}
+
+HAL_StatusTypeDef HAL_PWREx_EnableOverDrive(void)
+{
+    PWR->CR  |= PWR_CR_ODEN | PWR_CR_ODSWEN;
+    PWR->CSR |= PWR_CSR_ODRDY | PWR_CSR_ODSWRDY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_PWREx_DisableOverDrive(void)
+{
+    PWR->CR  &= ~(PWR_CR_ODEN | PWR_CR_ODSWEN);
+    PWR->CSR &= ~(PWR_CSR_ODRDY | PWR_CSR_ODSWRDY);
+    return HAL_OK;
+}
+
+void HAL_PWREx_EnableFlashPowerDown(void)
+{
+    PWR->CR |= PWR_CR_FPDS;
+}
+
+void HAL_PWREx_DisableFlashPowerDown(void)
+{
+    PWR->CR &= ~PWR_CR_FPDS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* FLASH (stm32f4xx_hal_flash.c, stm32f4xx_hal_flash_ex.c)                   */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    FLASH->CR &= ~FLASH_CR_LOCK;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    FLASH->CR |= FLASH_CR_LOCK;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    static const uint32_t sizes[] = { 1U, 2U, 4U, 8U };
+
+    SimHw_Sync();
+
+    if (((FLASH->CR & FLASH_CR_LOCK) != 0U) || (TypeProgram > FLASH_TYPEPROGRAM_DOUBLEWORD))
+    {
+        return HAL_ERROR;
+    }
+
+    /* The HAL would wait for the erase; a sector-sized stall is not
+     * worth modelling, the firmware never programs during one.
+     */
+    if (SimHw_FlashBusy())
+    {
+        return HAL_BUSY;
+    }
+
+    uint32_t size = sizes[TypeProgram];
+    if ((Address < FLASH_BASE) || ((Address + size - 1U) > FLASH_END))
+    {
+        return HAL_ERROR;
+    }
+
+    /* Programming can only clear bits. */
+    uint8_t *dst = (uint8_t *)(uintptr_t)Address;
+    for (uint32_t i = 0U; i < size; ++i)
+    {
+        dst[i] &= (uint8_t)(Data >> (8U * i));
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+    if (((FLASH->CR & FLASH_CR_LOCK) != 0U) || SimHw_FlashBusy())
+    {
+        return HAL_ERROR;
+    }
+
+    *SectorError = 0xFFFFFFFFU;
+
+    if (pEraseInit->TypeErase == FLASH_TYPEERASE_MASSERASE)
+    {
+        (void)memset((void *)(uintptr_t)FLASH_BASE, 0xFF, FLASH_END - FLASH_BASE + 1U);
+        return HAL_OK;
+    }
+
+    for (uint32_t s = pEraseInit->Sector; s < (pEraseInit->Sector + pEraseInit->NbSectors); ++s)
+    {
+        uint32_t address = SimHw_FlashSectorAddress(s);
+        if (address == 0U)
+        {
+            *SectorError = s;
+            return HAL_ERROR;
+        }
+
+        (void)memset((void *)(uintptr_t)address, 0xFF, SimHw_FlashSectorSize(s));
+    }
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase_IT(FLASH_EraseInitTypeDef *pEraseInit)
+{
+    if (((FLASH->CR & FLASH_CR_LOCK) != 0U) || SimHw_FlashBusy() ||
+        (pEraseInit->TypeErase != FLASH_TYPEERASE_SECTORS) ||
+        (pEraseInit->NbSectors == 0U) ||
+        (SimHw_FlashSectorAddress(pEraseInit->Sector + pEraseInit->NbSectors - 1U) == 0U))
+    {
+        return HAL_ERROR;
+    }
+
+    SimHw_FlashStartEraseIt(pEraseInit->Sector, pEraseInit->NbSectors);
+    return HAL_OK;
+}
+
+void HAL_FLASH_IRQHandler(void)
+{
+    SimHw_FlashIrq();
+}
+
+__weak void HAL_FLASH_EndOfOperationCallback(uint32_t ReturnValue)
+{
+    (void)ReturnValue;
+}
+
+__weak void HAL_FLASH_OperationErrorCallback(uint32_t ReturnValue)
+{
+    (void)ReturnValue;
+}
+
+/* ------------------------------------------------------------------------- */
+/* GPIO (stm32f4xx_hal_gpio.c)                                               */
+/* ------------------------------------------------------------------------- */
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    for (uint32_t pin = 0U; pin < 16U; ++pin)
+    {
+        uint32_t bit = 1UL << pin;
+        if ((GPIO_Init->Pin & bit) == 0U)
+        {
+            continue;
+        }
+
+        GPIOx->MODER = (GPIOx->MODER & ~(GPIO_MODER_MODER0 << (pin * 2U))) |
+                       ((GPIO_Init->Mode & GPIO_MODE) << (pin * 2U));
+        GPIOx->PUPDR = (GPIOx->PUPDR & ~(GPIO_PUPDR_PUPDR0 << (pin * 2U))) |
+                       (GPIO_Init->Pull << (pin * 2U));
+
+        if ((GPIO_Init->Mode & EXTI_MODE) != 0U)
+        {
+            EXTI->IMR  = ((GPIO_Init->Mode & EXTI_IT) != 0U) ? (EXTI->IMR | bit) : (EXTI->IMR & ~bit);
+            EXTI->RTSR = ((GPIO_Init->Mode & TRIGGER_RISING) != 0U) ? (EXTI->RTSR | bit) : (EXTI->RTSR & ~bit);
+            EXTI->FTSR = ((GPIO_Init->Mode & TRIGGER_FALLING) != 0U) ? (EXTI->FTSR | bit) : (EXTI->FTSR & ~bit);
+        }
+    }
+}
+
+void HAL_GPIO_DeInit(GPIO_TypeDef *GPIOx, uint32_t GPIO_Pin)
+{
+    for (uint32_t pin = 0U; pin < 16U; ++pin)
+    {
+        if ((GPIO_Pin & (1UL << pin)) != 0U)
+        {
+            GPIOx->MODER &= ~(GPIO_MODER_MODER0 << (pin * 2U));
+        }
+    }
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    return ((GPIOx->IDR & GPIO_Pin) != 0U) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState != GPIO_PIN_RESET)
+    {
+        GPIOx->ODR |= GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+    }
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    GPIOx->ODR ^= GPIO_Pin;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+    SimHw_Sync();
+
+    if (__HAL_GPIO_EXTI_GET_IT(GPIO_Pin) != 0U)
+    {
+        __HAL_GPIO_EXTI_CLEAR_IT(GPIO_Pin);
+        SimHw_Sync();
+        HAL_GPIO_EXTI_Callback(GPIO_Pin);
+    }
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    (void)GPIO_Pin;
+}
+
+/* ------------------------------------------------------------------------- */
+/* DMA (stm32f4xx_hal_dma.c)                                                 */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    if (hdma == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    hdma->State     = HAL_DMA_STATE_READY;
+    hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma)
+{
+    if (hdma == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    hdma->State = HAL_DMA_STATE_RESET;
+    return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    SimHw_UartDmaIrq(hdma);
+}
+
+/* ------------------------------------------------------------------------- */
+/* UART (stm32f4xx_hal_uart.c)                                               */
+/* ------------------------------------------------------------------------- */
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    if (huart == NULL)
+    {
+        return HAL_ERROR;
+    }
+
+    if (huart->gState == HAL_UART_STATE_RESET)
+    {
+        huart->Lock = HAL_UNLOCKED;
+        HAL_UART_MspInit(huart);
+    }
+
+    huart->Instance->CR1 = USART_CR1_UE | USART_CR1_TE | USART_CR1_RE;
+    /* USART1 and USART6 are on APB2. */
+    uint32_t pclk = ((huart->Instance == USART1) || (huart->Instance == USART6)) ?
+                    HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    huart->Instance->BRR = UART_BRR_SAMPLING16(pclk, huart->Init.BaudRate);
+
+    huart->ErrorCode   = HAL_UART_ERROR_NONE;
+    huart->gState      = HAL_UART_STATE_READY;
+    huart->RxState     = HAL_UART_STATE_READY;
+    huart->RxEventType = HAL_UART_RXEVENT_TC;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)Timeout;
+
+    if ((pData == NULL) || (Size == 0U))
+    {
+        return HAL_ERROR;
+    }
+
+    if (huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    SimHw_UartWriteBlocking(pData, Size);
+    huart->Instance->SR |= USART_SR_TXE | USART_SR_TC;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *pData, uint16_t Size)
+{
+    if ((pData == NULL) || (Size == 0U))
+    {
+        return HAL_ERROR;
+    }
+
+    if (huart->gState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->pTxBuffPtr  = pData;
+    huart->TxXferSize  = Size;
+    huart->TxXferCount = Size;
+    huart->gState      = HAL_UART_STATE_BUSY_TX;
+
+    SimHw_UartStartTx(huart, pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_AbortTransmit(UART_HandleTypeDef *huart)
+{
+    SimHw_UartAbortTx(huart);
+    huart->TxXferCount = 0U;
+    huart->gState      = HAL_UART_STATE_READY;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if ((pData == NULL) || (Size == 0U))
+    {
+        return HAL_ERROR;
+    }
+
+    if (huart->RxState != HAL_UART_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+
+    huart->ReceptionType = HAL_UART_RECEPTION_TOIDLE;
+    huart->RxEventType   = HAL_UART_RXEVENT_TC;
+    huart->pRxBuffPtr    = pData;
+    huart->RxXferSize    = Size;
+    huart->ErrorCode     = HAL_UART_ERROR_NONE;
+    huart->RxState       = HAL_UART_STATE_BUSY_RX;
+
+    SimHw_UartStartRx(huart, pData, Size);
+    return HAL_OK;
+}
+
+HAL_UART_RxEventTypeTypeDef HAL_UARTEx_GetRxEventType(UART_HandleTypeDef *huart)
+{
+    return huart->RxEventType;
+}
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+    SimHw_UartIrq(huart);
+}
+
+__weak void HAL_UART_MspInit(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UART_MspDeInit(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+}
+
+__weak void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    (void)huart;
+    (void)Size;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t SimHal_PllFreq(void)
+{
+    uint32_t pllcfgr = RCC->PLLCFGR;
+    uint32_t input   = ((pllcfgr & RCC_PLLCFGR_PLLSRC) != 0U) ? HSE_VALUE : HSI_VALUE;
+    uint32_t pllm    = (pllcfgr & RCC_PLLCFGR_PLLM) >> RCC_PLLCFGR_PLLM_Pos;
+    uint32_t plln    = (pllcfgr & RCC_PLLCFGR_PLLN) >> RCC_PLLCFGR_PLLN_Pos;
+    uint32_t pllp    = ((((pllcfgr & RCC_PLLCFGR_PLLP) >> RCC_PLLCFGR_PLLP_Pos) + 1U) * 2U);
+
+    if (pllm == 0U)
+    {
+        return 0U;
+    }
+
+    return (uint32_t)(((uint64_t)input * plln) / pllm) / pllp;
+}
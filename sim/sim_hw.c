@@ -0,0 +1,1391 @@
+/**
+ * @file sim_hw.c
+ * @brief Simulated peripherals: register blocks, console UART, EXTI lines,
+ *        RTC wakeup, flash, the ADC scan, TIM3, I2C1 and SPI2 completion,
+ *        the telemetry and uplink UARTs, the IWDG and the B1 button.
+ *
+ * Register blocks are plain memory with MCU reset values. The firmware
+ * reads and writes them directly; anything with side effects goes
+ * through the HAL stubs (sim_hal.c), which call into the models here.
+ *
+ * Timed behaviour is a small set of event slots, each holding the
+ * virtual time it is due. sim_core.c advances time to the earliest one
+ * and calls SimHw_RunEvents(), which fires it and pends the interrupt a
+ * real peripheral would raise.
+ *
+ * Flash and RAM are mapped at their MCU addresses, because the firmware
+ * reads flash contents and the linker-defined RAM bounds as pointers. So
+ * is the system memory page holding the ADC factory calibration.
+ *
+ * @ingroup sim
+ */
+
+#define _GNU_SOURCE
+#include "sim.h"
+#include "main.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** @brief Flash size (STM32F446RE). */
+#define SIM_HW_FLASH_SIZE         (FLASH_END - FLASH_BASE + 1U)
+
+/** @brief Number of flash sectors. */
+#define SIM_HW_FLASH_SECTORS      (8U)
+
+/** @brief SRAM1 + SRAM2. */
+#define SIM_HW_RAM_SIZE           (128U * 1024U)
+
+/** @brief Backup SRAM; mapped at BKPSRAM_BASE like the MCU. */
+#define SIM_HW_BKPSRAM_SIZE       (4U * 1024U)
+
+/** @brief System memory page with the ADC calibration words. */
+#define SIM_HW_SYSMEM_PAGE        (0x1FFF7000U)
+#define SIM_HW_SYSMEM_SIZE        (4U * 1024U)
+
+/** @brief ADC factory calibration words (typical values at VDDA = 3.3 V). */
+#define SIM_HW_VREFINT_CAL_ADDR   (0x1FFF7A2AU)
+#define SIM_HW_TS_CAL1_ADDR       (0x1FFF7A2CU)
+#define SIM_HW_TS_CAL2_ADDR       (0x1FFF7A2EU)
+#define SIM_HW_VREFINT_CAL        (1500U)
+#define SIM_HW_TS_CAL1            (897U)    /* 30 °C  */
+#define SIM_HW_TS_CAL2            (1145U)   /* 110 °C */
+
+/** @brief Simulated analog supply (V). */
+#define SIM_HW_VDDA               (3.3)
+
+/** @brief Host input buffered ahead of the UART receiver (bytes). */
+#define SIM_HW_RX_QUEUE_SIZE      (4096U)
+
+/** @brief Marker bit kept set in EXTI->PR (reserved on the F446). */
+#define SIM_HW_EXTI_PR_MARK       (1UL << 31)
+
+/** @brief How long a simulated B1 press holds the pin low. */
+#define SIM_HW_BUTTON_HOLD_NS     (100U * SIM_NS_PER_MS)
+
+/** @brief Bits per UART character (8N1). */
+#define SIM_HW_UART_FRAME_BITS    (10U)
+
+/** @brief RxEventCallback() sources latched for the RX DMA interrupt. */
+#define SIM_HW_RX_DMA_HALF        (1U << 0)
+#define SIM_HW_RX_DMA_FULL        (1U << 1)
+
+/**
+ * @brief Timed event slots.
+ */
+typedef enum
+{
+    SIM_HW_EVENT_UART_TX = 0U, /**< TX DMA transfer complete.         */
+    SIM_HW_EVENT_UART_RX,      /**< Next input byte received.         */
+    SIM_HW_EVENT_UART_IDLE,    /**< RX line idle after the last byte. */
+    SIM_HW_EVENT_TELEM_TX,     /**< Telemetry UART DMA complete.      */
+    SIM_HW_EVENT_FLASH,        /**< Sector erase complete.            */
+    SIM_HW_EVENT_RTC,          /**< RTC wakeup timer.                 */
+    SIM_HW_EVENT_BUTTON,       /**< B1 pressed or released.           */
+    SIM_HW_EVENT_ADC,          /**< TIM2 trigger: one ADC1 scan.      */
+    SIM_HW_EVENT_TIM3,         /**< TIM3 update.                      */
+    SIM_HW_EVENT_I2C,          /**< I2C1 transaction done.            */
+    SIM_HW_EVENT_SPI,          /**< SPI2 segment done.                */
+    SIM_HW_EVENT_USB,          /**< USB host event.                   */
+    SIM_HW_EVENT_UPLINK,       /**< Uplink modem event (USART6).      */
+    SIM_HW_EVENT_IWDG,         /**< Watchdog counter reached zero.    */
+    SIM_HW_EVENT_COUNT
+} SimHwEvent_t;
+
+/* ------------------------------------------------------------------------- */
+/* Device register blocks (referenced by sim/include/stm32f4xx.h)            */
+/* ------------------------------------------------------------------------- */
+
+RCC_TypeDef        g_simRcc;
+PWR_TypeDef        g_simPwr;
+FLASH_TypeDef      g_simFlash;
+EXTI_TypeDef       g_simExti;
+SYSCFG_TypeDef     g_simSyscfg;
+RTC_TypeDef        g_simRtc;
+TIM_TypeDef        g_simTim2;
+TIM_TypeDef        g_simTim3;
+TIM_TypeDef        g_simTim5;
+TIM_TypeDef        g_simTim8;
+USART_TypeDef      g_simUsart1;
+USART_TypeDef      g_simUsart2;
+DMA_Stream_TypeDef g_simDma1Stream5;
+DMA_Stream_TypeDef g_simDma1Stream6;
+DMA_TypeDef        g_simDma2;
+DMA_Stream_TypeDef g_simDma2Stream0;
+DMA_Stream_TypeDef g_simDma2Stream7;
+ADC_TypeDef        g_simAdc1;
+ADC_Common_TypeDef g_simAdcCommon;
+GPIO_TypeDef       g_simGpioA;
+GPIO_TypeDef       g_simGpioB;
+GPIO_TypeDef       g_simGpioC;
+GPIO_TypeDef       g_simGpioH;
+DBGMCU_TypeDef     g_simDbgmcu;
+
+/**
+ * @brief Sector sizes in KiB.
+ */
+static const uint32_t s_sectorKiB[SIM_HW_FLASH_SECTORS] = { 16U, 16U, 16U, 16U, 64U, 128U, 128U, 128U };
+
+/**
+ * @brief Erase time per sector in ms (datasheet typical at x32).
+ */
+static const uint32_t s_sectorErase_ms[SIM_HW_FLASH_SECTORS] = { 250U, 250U, 250U, 250U, 550U, 1000U, 1000U, 1000U };
+
+/**
+ * @brief Due time per event slot.
+ */
+static uint64_t s_due_ns[SIM_HW_EVENT_COUNT];
+
+/**
+ * @brief Real EXTI pending state behind the marked register.
+ */
+static uint32_t s_extiPending = 0U;
+
+/**
+ * @brief Console UART (set by the first transfer).
+ */
+static UART_HandleTypeDef *s_uart = NULL;
+
+/**
+ * @brief TX DMA transfer-complete flag.
+ */
+static bool s_txDmaDone = false;
+
+/**
+ * @brief Telemetry UART (USART1), its transfer-complete flag and the
+ *        -T file.
+ */
+static UART_HandleTypeDef *s_telemUart   = NULL;
+static bool                s_telemTxDone = false;
+static FILE               *s_telemFile   = NULL;
+
+/**
+ * @brief Circular RX DMA state.
+ */
+static uint8_t  *s_rxBuffer   = NULL;
+static uint16_t  s_rxSize     = 0U;
+static uint16_t  s_rxPos      = 0U;
+static bool      s_rxActive   = false;
+static uint32_t  s_rxDmaFlags = 0U;
+static bool      s_rxIdleFlag = false;
+
+/**
+ * @brief Host input not yet received.
+ */
+static uint8_t  s_rxQueue[SIM_HW_RX_QUEUE_SIZE];
+static uint32_t s_rxQueueHead = 0U;
+static uint32_t s_rxQueueTail = 0U;
+
+/**
+ * @brief Time the last byte was received.
+ */
+static uint64_t s_rxLast_ns = 0U;
+
+/**
+ * @brief The start bit of the byte in flight came while in STOP.
+ */
+static bool s_rxStartLost = false;
+
+/**
+ * @brief Interrupt-driven erase state.
+ */
+static bool     s_eraseActive    = false;
+static bool     s_eraseDone      = false;
+static uint32_t s_eraseSector    = 0U;
+static uint32_t s_eraseRemaining = 0U;
+
+/**
+ * @brief RTC wakeup period.
+ */
+static uint64_t s_rtcPeriod_ns = 0U;
+
+/**
+ * @brief Scheduled B1 presses (sorted) and replay position.
+ */
+static uint32_t s_buttonPress_ms[SIM_MAX_BUTTON_PRESSES];
+static uint32_t s_buttonCount = 0U;
+static uint32_t s_buttonNext  = 0U;
+static bool     s_buttonDown  = false;
+
+/**
+ * @brief ADC scan state: DMA2 stream 0 transfer size and position.
+ */
+static bool     s_adcRunning = false;
+static uint32_t s_adcSize    = 0U;
+static uint32_t s_adcPos     = 0U;
+static uint32_t s_adcNoise   = 1U;
+
+/**
+ * @brief TIM3 update interrupt scheduled.
+ */
+static bool s_tim3Running = false;
+
+/**
+ * @brief Time up to which the TIM8 counter has been advanced.
+ */
+static uint64_t s_tim8Last_ns = 0U;
+
+/**
+ * @brief Part of a TIM8 count not yet added to CNT (ns x timer Hz).
+ */
+static uint64_t s_tim8Frac = 0U;
+
+/**
+ * @brief Files backing flash and backup SRAM (-f, -B), or NULL.
+ */
+static const char *s_flashPath  = NULL;
+static const char *s_backupPath = NULL;
+
+/**
+ * @brief "/proc/self/fd/N" of the memfd copies made by SimHw_ImagePath().
+ */
+static char s_flashCopy[32];
+static char s_backupCopy[32];
+
+/**
+ * @brief Statistics.
+ */
+static SimHwStats_t s_stats;
+
+/**
+ * @brief Map @p size bytes at @p address, optionally backed by @p path.
+ */
+static bool SimHw_Map(uintptr_t address, size_t size, const char *path);
+
+/**
+ * @brief Duration of one UART character at the console baud rate.
+ */
+static uint64_t SimHw_UartCharNs(void);
+
+/**
+ * @brief Send a telemetry UART DMA transfer: to the -T file at once,
+ *        complete after its time on the wire.
+ */
+static void SimHw_TelemStartTx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+
+/**
+ * @brief Signal an edge on EXTI line @p line.
+ *
+ * Sets the pending bit if the edge is selected and pends @p irq if the
+ * line is unmasked.
+ */
+static void SimHw_ExtiEdge(uint32_t line, bool rising, IRQn_Type irq);
+
+/**
+ * @brief Start bit of the next input byte: EXTI line 3 edge, and note
+ *        whether the USART had a clock to see it.
+ */
+static void SimHw_UartStartBit(void);
+
+/**
+ * @brief Start or stop the ADC scan to follow TIM2, ADC1 and DMA2.
+ */
+static void SimHw_AdcSync(void);
+
+/**
+ * @brief Start or stop the TIM3 update interrupt to follow its registers.
+ */
+static void SimHw_Tim3Sync(void);
+
+/**
+ * @brief Advance the TIM8 counter (status LED) by the time elapsed.
+ *
+ * The counter is halted in STOP, as on the MCU.
+ */
+static void SimHw_Tim8Sync(void);
+
+/**
+ * @brief Time between two updates of APB1 timer @p tim.
+ */
+static uint64_t SimHw_TimerPeriodNs(const TIM_TypeDef *tim);
+
+/**
+ * @brief Triangle wave between -1 and 1 with period @p period_s.
+ */
+static double SimHw_Triangle(double period_s);
+
+/**
+ * @brief 12-bit reading of ADC channel @p channel at the current time.
+ */
+static uint16_t SimHw_AdcConvert(uint32_t channel);
+
+/**
+ * @brief Event handlers, one per @ref SimHwEvent_t.
+ */
+static void SimHw_OnUartTx(void);
+static void SimHw_OnUartRx(void);
+static void SimHw_OnUartIdle(void);
+static void SimHw_OnTelemTx(void);
+static void SimHw_OnFlash(void);
+static void SimHw_OnRtc(void);
+static void SimHw_OnButton(void);
+static void SimHw_OnAdc(void);
+static void SimHw_OnTim3(void);
+static void SimHw_OnI2c(void);
+static void SimHw_OnSpi(void);
+static void SimHw_OnUsb(void);
+static void SimHw_OnUplink(void);
+static void SimHw_OnIwdg(void);
+
+/**
+ * @brief Event dispatch table, indexed by @ref SimHwEvent_t.
+ */
+static void (*const s_eventHandlers[SIM_HW_EVENT_COUNT])(void) =
+{
+    [SIM_HW_EVENT_UART_TX]   = SimHw_OnUartTx,
+    [SIM_HW_EVENT_UART_RX]   = SimHw_OnUartRx,
+    [SIM_HW_EVENT_UART_IDLE] = SimHw_OnUartIdle,
+    [SIM_HW_EVENT_TELEM_TX]  = SimHw_OnTelemTx,
+    [SIM_HW_EVENT_FLASH]     = SimHw_OnFlash,
+    [SIM_HW_EVENT_RTC]       = SimHw_OnRtc,
+    [SIM_HW_EVENT_BUTTON]    = SimHw_OnButton,
+    [SIM_HW_EVENT_ADC]       = SimHw_OnAdc,
+    [SIM_HW_EVENT_TIM3]      = SimHw_OnTim3,
+    [SIM_HW_EVENT_I2C]       = SimHw_OnI2c,
+    [SIM_HW_EVENT_SPI]       = SimHw_OnSpi,
+    [SIM_HW_EVENT_USB]       = SimHw_OnUsb,
+    [SIM_HW_EVENT_UPLINK]    = SimHw_OnUplink,
+    [SIM_HW_EVENT_IWDG]      = SimHw_OnIwdg
+};
+
+/* ------------------------------------------------------------------------- */
+
+bool SimHw_Init(const SimOptions_t *opt)
+{
+    if (!SimHw_Map(FLASH_BASE, SIM_HW_FLASH_SIZE, opt->flashImage) ||
+        !SimHw_Map(SRAM1_BASE, SIM_HW_RAM_SIZE, NULL) ||
+        !SimHw_Map(BKPSRAM_BASE, SIM_HW_BKPSRAM_SIZE, opt->backupImage) ||
+        !SimHw_Map(SIM_HW_SYSMEM_PAGE, SIM_HW_SYSMEM_SIZE, NULL))
+    {
+        return false;
+    }
+    s_flashPath  = opt->flashImage;
+    s_backupPath = opt->backupImage;
+
+    /* A restart appends, so the file holds the whole run. */
+    if (opt->telemetryOut != NULL)
+    {
+        s_telemFile = fopen(opt->telemetryOut, (opt->resets != 0U) ? "ab" : "wb");
+        if (s_telemFile == NULL)
+        {
+            (void)fprintf(stderr, "sim: cannot open %s: %s\n", opt->telemetryOut, strerror(errno));
+            return false;
+        }
+    }
+
+    *(volatile uint16_t *)(uintptr_t)SIM_HW_VREFINT_CAL_ADDR = SIM_HW_VREFINT_CAL;
+    *(volatile uint16_t *)(uintptr_t)SIM_HW_TS_CAL1_ADDR = SIM_HW_TS_CAL1;
+    *(volatile uint16_t *)(uintptr_t)SIM_HW_TS_CAL2_ADDR = SIM_HW_TS_CAL2;
+
+    (void)memset((void *)(uintptr_t)SRAM1_BASE, 0, SIM_HW_RAM_SIZE);
+
+    /* Reset values (RM0390) where the firmware or the HAL stubs look. */
+    (void)memset(&g_simRcc, 0, sizeof(g_simRcc));
+    g_simRcc.CR      = RCC_CR_HSION | RCC_CR_HSIRDY | (0x10U << RCC_CR_HSITRIM_Pos);
+    g_simRcc.PLLCFGR = 0x24003010U;
+    g_simRcc.CSR     = (opt->resets != 0U) ? opt->resetRcc : 0x0E000000U;
+
+    (void)memset(&g_simPwr, 0, sizeof(g_simPwr));
+    g_simPwr.CR  = PWR_CR_VOS;
+    g_simPwr.CSR = PWR_CSR_VOSRDY | opt->resetPwr;
+
+    (void)memset(&g_simFlash, 0, sizeof(g_simFlash));
+    g_simFlash.CR = FLASH_CR_LOCK;
+
+    (void)memset(&g_simExti, 0, sizeof(g_simExti));
+    s_extiPending = 0U;
+    g_simExti.PR  = SIM_HW_EXTI_PR_MARK;
+
+    (void)memset(&g_simSyscfg, 0, sizeof(g_simSyscfg));
+    (void)memset(&g_simRtc, 0, sizeof(g_simRtc));
+    g_simRtc.ISR = RTC_ISR_ALRAWF | RTC_ISR_ALRBWF | RTC_ISR_WUTWF | opt->resetRtcIsr;
+
+    (void)memset(&g_simTim2, 0, sizeof(g_simTim2));
+    (void)memset(&g_simTim3, 0, sizeof(g_simTim3));
+    s_tim3Running = false;
+    (void)memset(&g_simTim5, 0, sizeof(g_simTim5));
+    (void)memset(&g_simTim8, 0, sizeof(g_simTim8));
+    s_tim8Last_ns = SimCore_NowNs();
+    s_tim8Frac    = 0U;
+    (void)memset(&g_simUsart1, 0, sizeof(g_simUsart1));
+    g_simUsart1.SR = USART_SR_TXE | USART_SR_TC;
+    (void)memset(&g_simUsart2, 0, sizeof(g_simUsart2));
+    g_simUsart2.SR = USART_SR_TXE | USART_SR_TC;
+
+    (void)memset(&g_simDma1Stream5, 0, sizeof(g_simDma1Stream5));
+    (void)memset(&g_simDma1Stream6, 0, sizeof(g_simDma1Stream6));
+    (void)memset(&g_simDma2, 0, sizeof(g_simDma2));
+    (void)memset(&g_simDma2Stream0, 0, sizeof(g_simDma2Stream0));
+    g_simDma2Stream0.FCR = DMA_SxFCR_FS_2 | DMA_SxFCR_FS_0;
+    (void)memset(&g_simDma2Stream7, 0, sizeof(g_simDma2Stream7));
+    g_simDma2Stream7.FCR = DMA_SxFCR_FS_2 | DMA_SxFCR_FS_0;
+    (void)memset(&g_simAdc1, 0, sizeof(g_simAdc1));
+    (void)memset(&g_simAdcCommon, 0, sizeof(g_simAdcCommon));
+    s_adcRunning = false;
+
+    (void)memset(&g_simGpioA, 0, sizeof(g_simGpioA));
+    (void)memset(&g_simGpioB, 0, sizeof(g_simGpioB));
+    (void)memset(&g_simGpioC, 0, sizeof(g_simGpioC));
+    (void)memset(&g_simGpioH, 0, sizeof(g_simGpioH));
+    g_simGpioA.MODER = 0xA8000000U;
+    g_simGpioB.MODER = 0x00000280U;
+    g_simGpioC.IDR   = B1_Pin;   /* B1 released: external pull-up. */
+
+    (void)memset(&g_simDbgmcu, 0, sizeof(g_simDbgmcu));
+    g_simDbgmcu.IDCODE = 0x10006421U;
+
+    for (uint32_t i = 0U; i < SIM_HW_EVENT_COUNT; ++i)
+    {
+        s_due_ns[i] = SIM_NEVER;
+    }
+
+    (void)memset(&s_stats, 0, sizeof(s_stats));
+
+    /* Replay button presses in time order. */
+    s_buttonCount = opt->buttonCount;
+    (void)memcpy(s_buttonPress_ms, opt->buttonPress_ms, sizeof(s_buttonPress_ms));
+    for (uint32_t i = 1U; i < s_buttonCount; ++i)
+    {
+        uint32_t t = s_buttonPress_ms[i];
+        uint32_t j = i;
+        while ((j > 0U) && (s_buttonPress_ms[j - 1U] > t))
+        {
+            s_buttonPress_ms[j] = s_buttonPress_ms[j - 1U];
+            --j;
+        }
+        s_buttonPress_ms[j] = t;
+    }
+
+    /* A restart has seen the presses up to its reset. */
+    s_buttonNext = 0U;
+    s_buttonDown = false;
+    while ((s_buttonNext < s_buttonCount) &&
+           (((uint64_t)s_buttonPress_ms[s_buttonNext] * SIM_NS_PER_MS) <= opt->start_ns) &&
+           (opt->resets != 0U))
+    {
+        s_buttonNext++;
+    }
+    if (s_buttonNext < s_buttonCount)
+    {
+        s_due_ns[SIM_HW_EVENT_BUTTON] = (uint64_t)s_buttonPress_ms[s_buttonNext] * SIM_NS_PER_MS;
+    }
+
+    return true;
+}
+
+void SimHw_Sync(void)
+{
+    uint32_t pr = g_simExti.PR;
+
+    if ((pr & SIM_HW_EXTI_PR_MARK) == 0U)
+    {
+        s_extiPending &= ~pr;
+    }
+
+    g_simExti.PR = s_extiPending | SIM_HW_EXTI_PR_MARK;
+
+    SimHw_AdcSync();
+    SimHw_Tim3Sync();
+    SimHw_Tim8Sync();
+}
+
+void SimHw_GetStats(SimHwStats_t *stats)
+{
+    *stats = s_stats;
+}
+
+uint64_t SimHw_EnterStandby(uint32_t *rtcIsr)
+{
+    uint64_t rtc    = s_due_ns[SIM_HW_EVENT_RTC];
+    uint64_t button = SIM_NEVER;
+
+    /* B1 ends STANDBY through the RTC time stamp on its falling edge. */
+    if (((g_simRtc.CR & RTC_CR_TSE) != 0U) && !s_buttonDown && (s_buttonNext < s_buttonCount))
+    {
+        button = (uint64_t)s_buttonPress_ms[s_buttonNext] * SIM_NS_PER_MS;
+    }
+
+    for (uint32_t i = 0U; i < SIM_HW_EVENT_COUNT; ++i)
+    {
+        s_due_ns[i] = SIM_NEVER;
+    }
+
+    *rtcIsr = 0U;
+    if ((rtc == SIM_NEVER) && (button == SIM_NEVER))
+    {
+        return SIM_NEVER;
+    }
+    if (button <= rtc)
+    {
+        *rtcIsr = RTC_ISR_TSF;
+        return button;
+    }
+
+    *rtcIsr = RTC_ISR_WUTF;
+    return rtc;
+}
+
+const char *SimHw_ImagePath(uintptr_t address)
+{
+    bool        flash = (address == FLASH_BASE);
+    const char *path  = flash ? s_flashPath : s_backupPath;
+    char       *copy  = flash ? s_flashCopy : s_backupCopy;
+    size_t      size  = flash ? SIM_HW_FLASH_SIZE : SIM_HW_BKPSRAM_SIZE;
+
+    if (path != NULL)
+    {
+        return path;
+    }
+    if (copy[0] != '\0')
+    {
+        return copy;
+    }
+
+    /* No CLOEXEC: the restarted process opens it through /proc. */
+    int fd = memfd_create(flash ? "hub_sim_flash" : "hub_sim_bkpsram", 0U);
+    if ((fd < 0) || (write(fd, (const void *)address, size) != (ssize_t)size))
+    {
+        (void)fprintf(stderr, "sim: cannot copy 0x%08lx: %s\n", (unsigned long)address, strerror(errno));
+        if (fd >= 0)
+        {
+            (void)close(fd);
+        }
+        return NULL;
+    }
+
+    (void)snprintf(copy, sizeof(s_flashCopy), "/proc/self/fd/%d", fd);
+    return copy;
+}
+
+uint64_t SimHw_NextEventNs(void)
+{
+    uint64_t next = SIM_NEVER;
+
+    for (uint32_t i = 0U; i < SIM_HW_EVENT_COUNT; ++i)
+    {
+        if (s_due_ns[i] < next)
+        {
+            next = s_due_ns[i];
+        }
+    }
+
+    return next;
+}
+
+void SimHw_RunEvents(uint64_t now_ns)
+{
+    SimHw_Sync();
+
+    for (;;)
+    {
+        uint32_t next = SIM_HW_EVENT_COUNT;
+
+        for (uint32_t i = 0U; i < SIM_HW_EVENT_COUNT; ++i)
+        {
+            if ((s_due_ns[i] <= now_ns) &&
+                ((next == SIM_HW_EVENT_COUNT) || (s_due_ns[i] < s_due_ns[next])))
+            {
+                next = i;
+            }
+        }
+
+        if (next == SIM_HW_EVENT_COUNT)
+        {
+            return;
+        }
+
+        s_due_ns[next] = SIM_NEVER;
+        s_eventHandlers[next]();
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Console UART (USART2, DMA1 streams 5 and 6)                               */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_UartStartTx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    if (huart->Instance == USART1)
+    {
+        SimHw_TelemStartTx(huart, data, size);
+        return;
+    }
+
+    s_uart = huart;
+
+    /* The bytes leave at once. NDTR reads 0 so a fault-path flush that
+     * aborts the transfer does not send them a second time.
+     */
+    SimHost_Output(data, size);
+    s_stats.txBytes += size;
+
+    huart->Instance->SR &= ~USART_SR_TC;
+    if (huart->hdmatx != NULL)
+    {
+        huart->hdmatx->Instance->NDTR = 0U;
+    }
+
+    s_txDmaDone = false;
+    s_due_ns[SIM_HW_EVENT_UART_TX] = SimCore_NowNs() + ((uint64_t)size * SimHw_UartCharNs());
+}
+
+void SimHw_UartWriteBlocking(const uint8_t *data, uint16_t size)
+{
+    SimHost_Output(data, size);
+    s_stats.txBytes += size;
+}
+
+void SimHw_UartAbortTx(UART_HandleTypeDef *huart)
+{
+    if (huart->Instance == USART1)
+    {
+        s_due_ns[SIM_HW_EVENT_TELEM_TX] = SIM_NEVER;
+        s_telemTxDone = false;
+        huart->Instance->SR |= USART_SR_TC;
+        return;
+    }
+
+    s_due_ns[SIM_HW_EVENT_UART_TX] = SIM_NEVER;
+    s_txDmaDone = false;
+    huart->Instance->SR |= USART_SR_TC;
+}
+
+void SimHw_UartStartRx(UART_HandleTypeDef *huart, uint8_t *buffer, uint16_t size)
+{
+    s_uart       = huart;
+    s_rxBuffer   = buffer;
+    s_rxSize     = size;
+    s_rxPos      = 0U;
+    s_rxDmaFlags = 0U;
+    s_rxIdleFlag = false;
+    s_rxActive   = (buffer != NULL) && (size != 0U);
+
+    if (huart->hdmarx != NULL)
+    {
+        huart->hdmarx->Instance->NDTR = size;
+    }
+}
+
+size_t SimHw_UartInject(const uint8_t *data, size_t len, uint64_t at_ns)
+{
+    size_t queued = 0U;
+
+    while ((queued < len) && ((s_rxQueueHead - s_rxQueueTail) < SIM_HW_RX_QUEUE_SIZE))
+    {
+        s_rxQueue[s_rxQueueHead % SIM_HW_RX_QUEUE_SIZE] = data[queued];
+        s_rxQueueHead++;
+        queued++;
+    }
+
+    if ((queued > 0U) && (s_due_ns[SIM_HW_EVENT_UART_RX] == SIM_NEVER))
+    {
+        uint64_t now = SimCore_NowNs();
+        s_due_ns[SIM_HW_EVENT_UART_RX] = ((at_ns > now) ? at_ns : now) + SimHw_UartCharNs();
+        SimHw_UartStartBit();
+    }
+
+    return queued;
+}
+
+size_t SimHw_UartInjectSpace(void)
+{
+    return SIM_HW_RX_QUEUE_SIZE - (s_rxQueueHead - s_rxQueueTail);
+}
+
+uint64_t SimHw_UartLastRxNs(void)
+{
+    uint32_t queued = s_rxQueueHead - s_rxQueueTail;
+
+    if (queued == 0U)
+    {
+        return s_rxLast_ns;
+    }
+
+    return s_due_ns[SIM_HW_EVENT_UART_RX] + ((uint64_t)(queued - 1U) * SimHw_UartCharNs());
+}
+
+void SimHw_UartIrq(UART_HandleTypeDef *huart)
+{
+    if (!s_rxIdleFlag)
+    {
+        return;
+    }
+
+    s_rxIdleFlag = false;
+
+    /* As the HAL: no event when the write position sits at the start. */
+    uint32_t remaining = huart->hdmarx->Instance->NDTR;
+    if ((huart->RxState == HAL_UART_STATE_BUSY_RX) &&
+        (remaining > 0U) && (remaining < huart->RxXferSize))
+    {
+        huart->RxEventType = HAL_UART_RXEVENT_IDLE;
+        HAL_UARTEx_RxEventCallback(huart, (uint16_t)(huart->RxXferSize - remaining));
+    }
+}
+
+void SimHw_UartDmaIrq(DMA_HandleTypeDef *hdma)
+{
+    UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+
+    if (huart == NULL)
+    {
+        return;
+    }
+
+    if (huart->Instance == USART1)
+    {
+        if ((hdma == huart->hdmatx) && s_telemTxDone)
+        {
+            s_telemTxDone = false;
+            huart->gState = HAL_UART_STATE_READY;
+            HAL_UART_TxCpltCallback(huart);
+        }
+        return;
+    }
+
+    if ((hdma == huart->hdmatx) && s_txDmaDone)
+    {
+        s_txDmaDone   = false;
+        huart->gState = HAL_UART_STATE_READY;
+        HAL_UART_TxCpltCallback(huart);
+    }
+    else if ((hdma == huart->hdmarx) && (s_rxDmaFlags != 0U))
+    {
+        uint32_t flags = s_rxDmaFlags;
+        s_rxDmaFlags = 0U;
+
+        if ((flags & SIM_HW_RX_DMA_HALF) != 0U)
+        {
+            huart->RxEventType = HAL_UART_RXEVENT_HT;
+            HAL_UARTEx_RxEventCallback(huart, (uint16_t)(huart->RxXferSize / 2U));
+        }
+        if ((flags & SIM_HW_RX_DMA_FULL) != 0U)
+        {
+            huart->RxEventType = HAL_UART_RXEVENT_TC;
+            HAL_UARTEx_RxEventCallback(huart, huart->RxXferSize);
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* Flash                                                                     */
+/* ------------------------------------------------------------------------- */
+
+uint32_t SimHw_FlashSectorAddress(uint32_t sector)
+{
+    if (sector >= SIM_HW_FLASH_SECTORS)
+    {
+        return 0U;
+    }
+
+    uint32_t address = FLASH_BASE;
+    for (uint32_t i = 0U; i < sector; ++i)
+    {
+        address += s_sectorKiB[i] * 1024U;
+    }
+
+    return address;
+}
+
+uint32_t SimHw_FlashSectorSize(uint32_t sector)
+{
+    return (sector < SIM_HW_FLASH_SECTORS) ? (s_sectorKiB[sector] * 1024U) : 0U;
+}
+
+void SimHw_FlashStartEraseIt(uint32_t sector, uint32_t count)
+{
+    s_eraseActive    = true;
+    s_eraseDone      = false;
+    s_eraseSector    = sector;
+    s_eraseRemaining = count;
+    g_simFlash.SR   |= FLASH_SR_BSY;
+
+    s_due_ns[SIM_HW_EVENT_FLASH] = SimCore_NowNs() +
+                                   ((uint64_t)s_sectorErase_ms[sector] * SIM_NS_PER_MS);
+}
+
+bool SimHw_FlashBusy(void)
+{
+    return s_eraseActive;
+}
+
+void SimHw_FlashIrq(void)
+{
+    if (!s_eraseDone)
+    {
+        return;
+    }
+
+    s_eraseDone    = false;
+    g_simFlash.SR &= ~FLASH_SR_EOP;
+    s_eraseRemaining--;
+
+    /* Same callback sequence as HAL_FLASH_IRQHandler(): each finished
+     * sector except the last, then 0xFFFFFFFF for the whole operation.
+     */
+    if (s_eraseRemaining != 0U)
+    {
+        uint32_t done = s_eraseSector;
+        s_eraseSector++;
+        s_due_ns[SIM_HW_EVENT_FLASH] = SimCore_NowNs() +
+                                       ((uint64_t)s_sectorErase_ms[s_eraseSector] * SIM_NS_PER_MS);
+        HAL_FLASH_EndOfOperationCallback(done);
+    }
+    else
+    {
+        s_eraseActive  = false;
+        g_simFlash.SR &= ~FLASH_SR_BSY;
+        HAL_FLASH_EndOfOperationCallback(0xFFFFFFFFU);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* RTC wakeup timer                                                          */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_RtcStartWakeup(uint64_t period_ns)
+{
+    s_rtcPeriod_ns = (period_ns != 0U) ? period_ns : 1U;
+    s_due_ns[SIM_HW_EVENT_RTC] = SimCore_NowNs() + s_rtcPeriod_ns;
+}
+
+void SimHw_RtcStopWakeup(void)
+{
+    s_due_ns[SIM_HW_EVENT_RTC] = SIM_NEVER;
+    g_simRtc.ISR &= ~RTC_ISR_WUTF;
+}
+
+/* ------------------------------------------------------------------------- */
+/* I2C1 (transactions are modelled by sim_i2c_bus_hw.c)                      */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_I2cStart(uint64_t delay_ns)
+{
+    s_due_ns[SIM_HW_EVENT_I2C] = SimCore_NowNs() + ((delay_ns != 0U) ? delay_ns : 1U);
+}
+
+void SimHw_I2cStop(void)
+{
+    s_due_ns[SIM_HW_EVENT_I2C] = SIM_NEVER;
+    HAL_NVIC_ClearPendingIRQ(I2C1_EV_IRQn);
+}
+
+/* ------------------------------------------------------------------------- */
+/* SPI2 (segments are modelled by sim_spi_bus_hw.c)                          */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_SpiStart(uint64_t delay_ns)
+{
+    s_due_ns[SIM_HW_EVENT_SPI] = SimCore_NowNs() + ((delay_ns != 0U) ? delay_ns : 1U);
+}
+
+void SimHw_SpiStop(void)
+{
+    s_due_ns[SIM_HW_EVENT_SPI] = SIM_NEVER;
+    HAL_NVIC_ClearPendingIRQ(DMA1_Stream3_IRQn);
+}
+
+/* ------------------------------------------------------------------------- */
+/* USB OTG FS (transfers are modelled by sim_usb_cdc_hw.c)                   */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_UsbSchedule(uint64_t at_ns)
+{
+    s_due_ns[SIM_HW_EVENT_USB] = at_ns;
+}
+
+/* ------------------------------------------------------------------------- */
+/* USART6 uplink modem (modelled by sim_uplink_hw.c)                         */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_UplinkSchedule(uint64_t at_ns)
+{
+    s_due_ns[SIM_HW_EVENT_UPLINK] = at_ns;
+}
+
+/* ------------------------------------------------------------------------- */
+/* IWDG (started and refreshed by sim_watchdog_hw.c)                         */
+/* ------------------------------------------------------------------------- */
+
+void SimHw_WatchdogReload(uint64_t timeout_ns)
+{
+    s_due_ns[SIM_HW_EVENT_IWDG] = SimCore_NowNs() + ((timeout_ns != 0U) ? timeout_ns : 1U);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ADC scan (TIM2 trigger, ADC1, DMA2 stream 0)                              */
+/* ------------------------------------------------------------------------- */
+
+/*
+ * Only the configuration sensor_adc.c uses is modelled: TIM2 update as
+ * TRGO, a regular sequence with DMA in circular mode, and the HT/TC
+ * interrupts. Each TIM2 update converts the whole sequence at once.
+ * DMA2->LIFCR clears LISR at the next scan.
+ */
+
+/**
+ * @brief Heap break for mem_map.c (Core/Src/sysmem.c is not built).
+ *
+ * malloc() uses the host C library, so the simulated heap stays empty and
+ * only the query form is supported.
+ */
+void *_sbrk(ptrdiff_t incr)
+{
+    extern uint32_t _sim_end;   /* _end as seen by mem_map.c */
+
+    if (incr != 0)
+    {
+        errno = ENOMEM;
+        return (void *)-1;
+    }
+    return &_sim_end;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SimHw_Map(uintptr_t address, size_t size, const char *path)
+{
+    int   fd    = -1;
+    int   flags = MAP_FIXED_NOREPLACE;
+    off_t old   = (off_t)size;
+
+    if (path != NULL)
+    {
+        struct stat st;
+
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if ((fd < 0) || (fstat(fd, &st) != 0) || (ftruncate(fd, (off_t)size) != 0))
+        {
+            (void)fprintf(stderr, "sim: cannot open image %s: %s\n", path, strerror(errno));
+            return false;
+        }
+
+        old    = (st.st_size < (off_t)size) ? st.st_size : (off_t)size;
+        flags |= MAP_SHARED;
+    }
+    else
+    {
+        old    = 0;
+        flags |= MAP_PRIVATE | MAP_ANONYMOUS;
+    }
+
+    void *p = mmap((void *)address, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (fd >= 0)
+    {
+        (void)close(fd);
+    }
+
+    if (p != (void *)address)
+    {
+        (void)fprintf(stderr, "sim: cannot map 0x%08lx: %s\n", (unsigned long)address, strerror(errno));
+        return false;
+    }
+
+    /* Whatever the image did not cover reads as erased flash. */
+    if (address == FLASH_BASE)
+    {
+        (void)memset((uint8_t *)p + old, 0xFF, size - (size_t)old);
+    }
+
+    return true;
+}
+
+static uint64_t SimHw_UartCharNs(void)
+{
+    uint32_t baud = ((s_uart != NULL) && (s_uart->Init.BaudRate != 0U)) ? s_uart->Init.BaudRate : 115200U;
+
+    return ((uint64_t)SIM_HW_UART_FRAME_BITS * 1000000000ULL) / baud;
+}
+
+static void SimHw_ExtiEdge(uint32_t line, bool rising, IRQn_Type irq)
+{
+    uint32_t bit      = 1UL << line;
+    uint32_t selected = rising ? g_simExti.RTSR : g_simExti.FTSR;
+
+    if ((selected & bit) == 0U)
+    {
+        return;
+    }
+
+    SimHw_Sync();
+    s_extiPending |= bit;
+    g_simExti.PR   = s_extiPending | SIM_HW_EXTI_PR_MARK;
+
+    if ((g_simExti.IMR & bit) != 0U)
+    {
+        SimCore_Pend(irq);
+    }
+}
+
+static void SimHw_OnUartTx(void)
+{
+    if (s_uart == NULL)
+    {
+        return;
+    }
+
+    s_uart->Instance->SR |= USART_SR_TXE | USART_SR_TC;
+    s_txDmaDone = true;
+    SimCore_Pend(DMA1_Stream6_IRQn);
+}
+
+static void SimHw_TelemStartTx(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    uint32_t baud = (huart->Init.BaudRate != 0U) ? huart->Init.BaudRate : 115200U;
+
+    if (s_telemFile != NULL)
+    {
+        (void)fwrite(data, 1U, size, s_telemFile);
+        (void)fflush(s_telemFile);
+    }
+    s_stats.telemBytes += size;
+
+    huart->Instance->SR &= ~USART_SR_TC;
+    if (huart->hdmatx != NULL)
+    {
+        huart->hdmatx->Instance->NDTR = 0U;
+    }
+
+    s_telemUart   = huart;
+    s_telemTxDone = false;
+    s_due_ns[SIM_HW_EVENT_TELEM_TX] = SimCore_NowNs() +
+        (((uint64_t)size * SIM_HW_UART_FRAME_BITS * 1000000000ULL) / baud);
+}
+
+static void SimHw_OnTelemTx(void)
+{
+    if (s_telemUart == NULL)
+    {
+        return;
+    }
+
+    s_telemUart->Instance->SR |= USART_SR_TXE | USART_SR_TC;
+    s_telemTxDone = true;
+    SimCore_Pend(DMA2_Stream7_IRQn);
+}
+
+static void SimHw_OnUartRx(void)
+{
+    if (s_rxQueueHead == s_rxQueueTail)
+    {
+        return;
+    }
+
+    uint8_t  ch  = s_rxQueue[s_rxQueueTail % SIM_HW_RX_QUEUE_SIZE];
+    uint64_t now = SimCore_NowNs();
+    s_rxQueueTail++;
+    s_rxLast_ns = now;
+
+    /* In STOP the USART has no clock; the character that wakes the MCU
+     * is lost, as on the board.
+     */
+    if (s_rxStartLost || !s_rxActive || (s_uart == NULL))
+    {
+        s_stats.rxLost++;
+    }
+    else
+    {
+        s_rxBuffer[s_rxPos++] = ch;
+        s_stats.rxBytes++;
+
+        if (s_rxPos == (s_rxSize / 2U))
+        {
+            s_rxDmaFlags |= SIM_HW_RX_DMA_HALF;
+            SimCore_Pend(DMA1_Stream5_IRQn);
+        }
+        if (s_rxPos >= s_rxSize)
+        {
+            s_rxPos       = 0U;
+            s_rxDmaFlags |= SIM_HW_RX_DMA_FULL;
+            SimCore_Pend(DMA1_Stream5_IRQn);
+        }
+
+        s_uart->hdmarx->Instance->NDTR = (uint32_t)(s_rxSize - s_rxPos);
+        s_due_ns[SIM_HW_EVENT_UART_IDLE] = now + SimHw_UartCharNs();
+    }
+
+    if (s_rxQueueHead != s_rxQueueTail)
+    {
+        s_due_ns[SIM_HW_EVENT_UART_RX] = now + SimHw_UartCharNs();
+        SimHw_UartStartBit();
+    }
+}
+
+static void SimHw_UartStartBit(void)
+{
+    /* PA3 doubles as EXTI line 3: the start bit is a falling edge. */
+    s_rxStartLost = SimCore_InDeepSleep();
+    SimHw_ExtiEdge(3U, false, EXTI3_IRQn);
+}
+
+static void SimHw_OnUartIdle(void)
+{
+    s_rxIdleFlag = true;
+    SimCore_Pend(USART2_IRQn);
+}
+
+static void SimHw_OnFlash(void)
+{
+    uint32_t address = SimHw_FlashSectorAddress(s_eraseSector);
+
+    if (address != 0U)
+    {
+        (void)memset((void *)(uintptr_t)address, 0xFF, SimHw_FlashSectorSize(s_eraseSector));
+        s_stats.erases++;
+    }
+
+    s_eraseDone    = true;
+    g_simFlash.SR |= FLASH_SR_EOP;
+    SimCore_Pend(FLASH_IRQn);
+}
+
+static void SimHw_OnRtc(void)
+{
+    g_simRtc.ISR |= RTC_ISR_WUTF;
+    SimHw_ExtiEdge(22U, true, RTC_WKUP_IRQn);
+
+    s_due_ns[SIM_HW_EVENT_RTC] = SimCore_NowNs() + s_rtcPeriod_ns;
+}
+
+static void SimHw_AdcSync(void)
+{
+    bool run = ((g_simTim2.CR1 & TIM_CR1_CEN) != 0U) &&
+               ((g_simTim2.CR2 & TIM_CR2_MMS) == TIM_CR2_MMS_1) &&
+               ((g_simAdc1.CR2 & (ADC_CR2_ADON | ADC_CR2_DMA)) == (ADC_CR2_ADON | ADC_CR2_DMA)) &&
+               ((g_simAdc1.CR2 & ADC_CR2_EXTEN) != 0U) &&
+               ((g_simDma2Stream0.CR & DMA_SxCR_EN) != 0U);
+
+    if (run && !s_adcRunning)
+    {
+        s_adcSize = g_simDma2Stream0.NDTR;
+        s_adcPos  = 0U;
+        s_due_ns[SIM_HW_EVENT_ADC] = SimCore_NowNs() + SimHw_TimerPeriodNs(&g_simTim2);
+    }
+    else if (!run)
+    {
+        s_due_ns[SIM_HW_EVENT_ADC] = SIM_NEVER;
+    }
+
+    s_adcRunning = run;
+}
+
+static void SimHw_Tim3Sync(void)
+{
+    bool run = ((g_simTim3.CR1 & TIM_CR1_CEN) != 0U) && ((g_simTim3.DIER & TIM_DIER_UIE) != 0U);
+
+    if (run && !s_tim3Running)
+    {
+        s_due_ns[SIM_HW_EVENT_TIM3] = SimCore_NowNs() + SimHw_TimerPeriodNs(&g_simTim3);
+    }
+    else if (!run)
+    {
+        s_due_ns[SIM_HW_EVENT_TIM3] = SIM_NEVER;
+    }
+
+    s_tim3Running = run;
+}
+
+static void SimHw_Tim8Sync(void)
+{
+    uint64_t now     = SimCore_NowNs();
+    uint64_t elapsed = now - s_tim8Last_ns;
+
+    s_tim8Last_ns = now;
+
+    if ((g_simTim8.EGR & TIM_EGR_UG) != 0U)
+    {
+        g_simTim8.EGR = 0U;
+        g_simTim8.CNT = 0U;
+        s_tim8Frac    = 0U;
+    }
+
+    if (((g_simTim8.CR1 & TIM_CR1_CEN) == 0U) || ((SCB->SCR & SCB_SCR_SLEEPDEEP_Msk) != 0U))
+    {
+        return;
+    }
+
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    uint32_t timer = ((g_simRcc.CFGR & RCC_CFGR_PPRE2) == RCC_CFGR_PPRE2_DIV1) ? pclk2 : (2U * pclk2);
+    uint64_t tick  = ((uint64_t)g_simTim8.PSC + 1U) * 1000000000ULL;
+
+    s_tim8Frac += elapsed * timer;
+    g_simTim8.CNT = (uint32_t)(((uint64_t)g_simTim8.CNT + (s_tim8Frac / tick)) %
+                               ((uint64_t)g_simTim8.ARR + 1U));
+    s_tim8Frac %= tick;
+}
+
+static uint64_t SimHw_TimerPeriodNs(const TIM_TypeDef *tim)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    uint32_t timer = ((g_simRcc.CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) ? pclk1 : (2U * pclk1);
+    uint64_t ticks = ((uint64_t)tim->PSC + 1U) * ((uint64_t)tim->ARR + 1U);
+
+    return (timer != 0U) ? ((ticks * 1000000000ULL) / timer) : SIM_NS_PER_MS;
+}
+
+static double SimHw_Triangle(double period_s)
+{
+    double phase = (double)SimCore_NowNs() / (period_s * 1e9);
+
+    phase -= (double)(uint64_t)phase;
+    return (phase < 0.5) ? ((4.0 * phase) - 1.0) : (3.0 - (4.0 * phase));
+}
+
+static uint16_t SimHw_AdcConvert(uint32_t channel)
+{
+    double v;
+
+    switch (channel)
+    {
+        case 17U:   /* Vrefint */
+            v = ((double)SIM_HW_VREFINT_CAL * 3.3) / 4095.0;
+            break;
+        case 18U:   /* Temperature: 32 °C, drifting by 2 °C over a minute */
+        {
+            double celsius = 32.0 + (2.0 * SimHw_Triangle(60.0));
+            double raw     = (double)SIM_HW_TS_CAL1 +
+                             (((celsius - 30.0) * (double)(SIM_HW_TS_CAL2 - SIM_HW_TS_CAL1)) / 80.0);
+            v = (raw * 3.3) / 4095.0;
+            break;
+        }
+        case 0U:    /* A0: 0.5 V triangle around mid-rail, 10 s period */
+            v = 1.65 + (0.5 * SimHw_Triangle(10.0));
+            break;
+        case 1U:    /* A1: steady 0.8 V */
+            v = 0.8;
+            break;
+        default:
+            v = 0.0;
+            break;
+    }
+
+    /* About one LSB of noise, as on the board, so oversampling has
+     * something to average.
+     */
+    s_adcNoise = (s_adcNoise * 1103515245U) + 12345U;
+    double noise = ((double)((s_adcNoise >> 16) & 0xFFFFU) / 65535.0) - 0.5;
+
+    double code = ((v * 4095.0) / SIM_HW_VDDA) + (noise * 2.0);
+    if (code < 0.0)
+    {
+        code = 0.0;
+    }
+    if (code > 4095.0)
+    {
+        code = 4095.0;
+    }
+
+    return (uint16_t)(code + 0.5);
+}
+
+static void SimHw_OnAdc(void)
+{
+    uint16_t *buffer = (uint16_t *)(uintptr_t)g_simDma2Stream0.M0AR;
+    uint32_t  length = ((g_simAdc1.SQR1 & ADC_SQR1_L) >> ADC_SQR1_L_Pos) + 1U;
+
+    g_simDma2.LISR  &= ~g_simDma2.LIFCR;
+    g_simDma2.LIFCR  = 0U;
+
+    for (uint32_t i = 0U; (i < length) && (s_adcSize != 0U); ++i)
+    {
+        uint32_t sqr     = (i < 6U) ? g_simAdc1.SQR3 : ((i < 12U) ? g_simAdc1.SQR2 : g_simAdc1.SQR1);
+        uint32_t channel = (sqr >> (5U * (i % 6U))) & 0x1FU;
+
+        buffer[s_adcPos++] = SimHw_AdcConvert(channel);
+        g_simAdc1.DR       = buffer[s_adcPos - 1U];
+
+        if (s_adcPos == (s_adcSize / 2U))
+        {
+            g_simDma2.LISR |= DMA_LISR_HTIF0;
+            if ((g_simDma2Stream0.CR & DMA_SxCR_HTIE) != 0U)
+            {
+                SimCore_Pend(DMA2_Stream0_IRQn);
+            }
+        }
+        if (s_adcPos >= s_adcSize)
+        {
+            s_adcPos        = 0U;
+            g_simDma2.LISR |= DMA_LISR_TCIF0;
+            if ((g_simDma2Stream0.CR & DMA_SxCR_TCIE) != 0U)
+            {
+                SimCore_Pend(DMA2_Stream0_IRQn);
+            }
+        }
+    }
+
+    g_simDma2Stream0.NDTR = s_adcSize - s_adcPos;
+    g_simAdc1.SR         |= ADC_SR_EOC | ADC_SR_STRT;
+    s_stats.adcScans++;
+
+    s_due_ns[SIM_HW_EVENT_ADC] = SimCore_NowNs() + SimHw_TimerPeriodNs(&g_simTim2);
+}
+
+static void SimHw_OnTim3(void)
+{
+    g_simTim3.SR |= TIM_SR_UIF;
+    SimCore_Pend(TIM3_IRQn);
+
+    s_due_ns[SIM_HW_EVENT_TIM3] = SimCore_NowNs() + SimHw_TimerPeriodNs(&g_simTim3);
+}
+
+static void SimHw_OnI2c(void)
+{
+    SimCore_Pend(I2C1_EV_IRQn);
+}
+
+static void SimHw_OnSpi(void)
+{
+    SimCore_Pend(DMA1_Stream3_IRQn);
+}
+
+static void SimHw_OnUsb(void)
+{
+    SimCore_Pend(OTG_FS_IRQn);
+}
+
+static void SimHw_OnUplink(void)
+{
+    SimCore_Pend(USART6_IRQn);
+}
+
+static void SimHw_OnIwdg(void)
+{
+    /* A restart would most likely hang the same way: end the run. */
+    (void)fprintf(stderr, "sim: watchdog reset, stopping\n");
+    SimHost_Exit(0);
+}
+
+static void SimHw_OnButton(void)
+{
+    uint64_t now = SimCore_NowNs();
+
+    if (!s_buttonDown)
+    {
+        s_buttonDown     = true;
+        g_simGpioC.IDR  &= ~(uint32_t)B1_Pin;
+        SimHw_ExtiEdge(13U, false, EXTI15_10_IRQn);
+        s_due_ns[SIM_HW_EVENT_BUTTON] = now + SIM_HW_BUTTON_HOLD_NS;
+        return;
+    }
+
+    s_buttonDown     = false;
+    g_simGpioC.IDR  |= B1_Pin;
+    SimHw_ExtiEdge(13U, true, EXTI15_10_IRQn);
+
+    /* Presses closer together than the hold time are merged. */
+    while ((++s_buttonNext < s_buttonCount) &&
+           (((uint64_t)s_buttonPress_ms[s_buttonNext] * SIM_NS_PER_MS) <= now))
+    {
+    }
+
+    if (s_buttonNext < s_buttonCount)
+    {
+        s_due_ns[SIM_HW_EVENT_BUTTON] = (uint64_t)s_buttonPress_ms[s_buttonNext] * SIM_NS_PER_MS;
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ * @file sim_i2c_bus_hw.c
+ * @brief I2C bus port for the host simulation, with a 24C02-style EEPROM.
+ *
+ * Replaces common/i2c_bus_hw.c, whose event state machine follows I2C1
+ * status flags that only hardware sets. Each transaction here completes
+ * in one step: its time on the wire (9 bit times per byte at
+ * I2C_BUS_SPEED_HZ, plus START/STOP) is scheduled as an I2C1 event
+ * interrupt, and the handler moves the data and reports the result. So
+ * the queue, coalescing and callbacks in i2c_bus.c run as on the board.
+ *
+ * The EEPROM at @ref SIM_I2C_EEPROM_ADDR has 256 bytes and an
+ * auto-incrementing address pointer; any other address NACKs.
+ *
+ * @ingroup sim
+ */
+
+#include "i2c_bus_hw.h"
+#include "periph_power.h"
+#include "app_config.h"
+#include "sim.h"
+#include "irq_plan.h"
+
+/** @brief 7-bit address of the simulated EEPROM. */
+#define SIM_I2C_EEPROM_ADDR   (0x50U)
+
+/** @brief EEPROM size (bytes). */
+#define SIM_I2C_EEPROM_SIZE   (256U)
+
+/** @brief EEPROM contents. */
+static uint8_t s_eeprom[SIM_I2C_EEPROM_SIZE];
+
+/** @brief EEPROM address pointer. */
+static uint8_t s_pointer = 0U;
+
+/** @brief Transaction in progress. */
+static const I2cBusHwXfer_t *s_xfer = NULL;
+
+/** @brief Clocks taken by the first start after a release. */
+static bool s_clocked = false;
+
+/* ------------------------------------------------------------------------- */
+
+void I2cBusHw_Init(void)
+{
+    for (uint32_t i = 0U; i < SIM_I2C_EEPROM_SIZE; ++i)
+    {
+        s_eeprom[i] = (uint8_t)i;
+    }
+    s_pointer = 0U;
+    s_xfer    = NULL;
+    s_clocked = false;
+
+    HAL_NVIC_SetPriority(I2C1_EV_IRQn, IRQ_PRIO_I2C_EV, 0U);
+    HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+}
+
+bool I2cBusHw_Start(const I2cBusHwXfer_t *xfer)
+{
+    if (!s_clocked)
+    {
+        PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+        PeriphPower_Acquire(PERIPH_POWER_DMA1);
+        PeriphPower_Acquire(PERIPH_POWER_I2C1);
+        s_clocked = true;
+    }
+
+    /* Address, optional register and repeated-start address, then data. */
+    uint32_t bytes = 1U + (uint32_t)xfer->length;
+    if (xfer->hasReg)
+    {
+        bytes += xfer->read ? 2U : 1U;
+    }
+
+    uint64_t bits = ((uint64_t)bytes * 9U) + 2U;
+
+    s_xfer = xfer;
+    SimHw_I2cStart((bits * 1000000000ULL) / I2C_BUS_SPEED_HZ);
+
+    return true;
+}
+
+void I2cBusHw_Abort(void)
+{
+    SimHw_I2cStop();
+    s_xfer = NULL;
+}
+
+void I2cBusHw_Recover(void)
+{
+    /* The simulated EEPROM never holds the bus. */
+    SimHw_I2cStop();
+    s_xfer = NULL;
+}
+
+void I2cBusHw_Release(void)
+{
+    if (!s_clocked)
+    {
+        return;
+    }
+
+    PeriphPower_Release(PERIPH_POWER_I2C1);
+    PeriphPower_Release(PERIPH_POWER_DMA1);
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+    s_clocked = false;
+}
+
+void I2cBusHw_EvIrqHandler(void)
+{
+    const I2cBusHwXfer_t *xfer = s_xfer;
+
+    if (xfer == NULL)
+    {
+        return;
+    }
+    s_xfer = NULL;
+
+    if (xfer->address != SIM_I2C_EEPROM_ADDR)
+    {
+        I2cBus_OnHwDone(I2C_BUS_NACK);
+        return;
+    }
+
+    if (xfer->hasReg)
+    {
+        s_pointer = xfer->reg;
+    }
+
+    for (uint32_t i = 0U; i < xfer->length; ++i)
+    {
+        if (xfer->read)
+        {
+            xfer->data[i] = s_eeprom[s_pointer];
+        }
+        else
+        {
+            s_eeprom[s_pointer] = xfer->data[i];
+        }
+        s_pointer++;
+    }
+
+    I2cBus_OnHwDone(I2C_BUS_OK);
+}
+
+void I2cBusHw_ErIrqHandler(void)
+{
+}
+
+void I2cBusHw_DmaRxIrqHandler(void)
+{
+}
+
+void I2cBusHw_DmaTxIrqHandler(void)
+{
+}
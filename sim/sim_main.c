@@ -0,0 +1,675 @@
+/**
+ * @file sim_main.c
+ * @brief Host simulation entry point: options, console I/O and exit summary.
+ *
+ * stdin feeds the console UART receiver and everything the firmware
+ * transmits goes to stdout unchanged (CR LF line endings included).
+ * Simulator messages go to stderr with a "sim: " prefix. With -u a
+ * simulated USB host opens the CDC console, and stdin goes to it instead
+ * of the UART; output from either transport goes to stdout.
+ *
+ * By default virtual time runs as fast as events can be processed; with
+ * -r it is paced to the wall clock, which is the mode an interactive
+ * terminal gets. Without -t the run ends one second (virtual) after the
+ * last input byte once stdin is closed, so piped command scripts finish
+ * on their own.
+ *
+ * A reset (NVIC_SystemReset(), a wakeup from STANDBY) re-executes the
+ * process with the same options and the restart state in -S: virtual
+ * time, wall time and the reset flags carry on, flash and backup SRAM
+ * are handed over as files (memfd copies unless -f and -B name one).
+ * The watchdog still ends the run, as a restart would hang again.
+ *
+ * @ingroup sim
+ */
+
+#include "sim.h"
+#include "app_bench.h"
+#include "app_config.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** @brief Virtual time allowed after the last input byte before exiting. */
+#define SIM_MAIN_GRACE_NS         (1000U * SIM_NS_PER_MS)
+
+/** @brief In fast mode, waits between stdin polls while input is queued. */
+#define SIM_MAIN_POLL_INTERVAL    (64U)
+
+/**
+ * @brief Firmware entry point: main() in Core/Src/main.c, renamed.
+ */
+extern int Sim_FirmwareMain(void);
+
+/**
+ * @brief Options in effect.
+ */
+static SimOptions_t s_options;
+
+/**
+ * @brief Program name (argv[0]), for the restart.
+ */
+static const char *s_program = NULL;
+
+/**
+ * @brief stdin reached end of file.
+ */
+static bool s_stdinEof = false;
+
+/**
+ * @brief Waits since stdin was last polled (fast mode).
+ */
+static uint32_t s_pollSkips = 0U;
+
+/**
+ * @brief Wall clock at reset.
+ */
+static struct timespec s_wallStart;
+
+/**
+ * @brief Set by SIGINT/SIGTERM; ends the run at the next wait.
+ */
+static volatile sig_atomic_t s_stopRequested = 0;
+
+/**
+ * @brief Parse the command line into @ref s_options.
+ *
+ * @return false if the usage text should be printed.
+ */
+static bool SimMain_ParseArgs(int argc, char **argv);
+
+/**
+ * @brief Print the usage text.
+ */
+static void SimMain_Usage(const char *prog);
+
+/**
+ * @brief Parse the restart state of -S.
+ *
+ * @return false if @p arg is malformed.
+ */
+static bool SimMain_ParseRestart(const char *arg);
+
+/**
+ * @brief Read pending stdin into the UART receiver.
+ *
+ * @param timeout_ms poll() timeout (-1: block until input or EOF).
+ *
+ * @return true if input was queued.
+ */
+static bool SimMain_ReadInput(int timeout_ms);
+
+/**
+ * @brief Queue input on the console transport in use (UART or USB).
+ */
+static size_t SimMain_Inject(const uint8_t *data, size_t len, uint64_t at_ns);
+
+/**
+ * @brief Free input queue space of the console transport.
+ */
+static size_t SimMain_InjectSpace(void);
+
+/**
+ * @brief Time the last queued input byte reaches the firmware.
+ */
+static uint64_t SimMain_LastRxNs(void);
+
+/**
+ * @brief Wall time since reset.
+ */
+static uint64_t SimMain_WallNs(void);
+
+/**
+ * @brief Signal handler for SIGINT and SIGTERM.
+ */
+static void SimMain_OnSignal(int sig);
+
+/* ------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    s_program = argv[0];
+    if (!SimMain_ParseArgs(argc, argv))
+    {
+        SimMain_Usage(argv[0]);
+        return 2;
+    }
+
+    (void)signal(SIGINT, SimMain_OnSignal);
+    (void)signal(SIGTERM, SimMain_OnSignal);
+    (void)signal(SIGPIPE, SIG_IGN);
+
+    SimCore_Init(&s_options);
+    if (!SimHw_Init(&s_options))
+    {
+        return 1;
+    }
+    SimUsb_Init(&s_options);
+    SimUplink_Init(&s_options);
+    SimReplay_Init(&s_options);
+
+    /* A restart keeps counting wall time from the first start. */
+    if (s_options.resets != 0U)
+    {
+        s_wallStart.tv_sec  = (time_t)(s_options.wallStart_ns / 1000000000ULL);
+        s_wallStart.tv_nsec = (long)(s_options.wallStart_ns % 1000000000ULL);
+    }
+    else
+    {
+        (void)clock_gettime(CLOCK_MONOTONIC, &s_wallStart);
+        s_options.wallStart_ns = ((uint64_t)s_wallStart.tv_sec * 1000000000ULL) + (uint64_t)s_wallStart.tv_nsec;
+    }
+
+    /* Reset: Reset_Handler calls SystemInit(), then main(). */
+    SystemInit();
+    (void)Sim_FirmwareMain();
+
+    SimHost_Exit(0);
+}
+
+uint64_t SimHost_Wait(uint64_t target_ns)
+{
+    uint64_t now = SimCore_NowNs();
+
+    if (s_stopRequested != 0)
+    {
+        SimHost_Exit(130);
+    }
+
+    if (!s_options.realtime)
+    {
+        bool starving = (SimMain_InjectSpace() > 0U) &&
+                        ((SimMain_LastRxNs() <= now) || (++s_pollSkips >= SIM_MAIN_POLL_INTERVAL));
+
+        if (!s_stdinEof && starving)
+        {
+            s_pollSkips = 0U;
+            (void)SimMain_ReadInput(0);
+        }
+
+        if (target_ns != SIM_NEVER)
+        {
+            return target_ns;
+        }
+
+        /* Nothing scheduled at all: only input can wake the core. */
+        (void)fflush(stdout);
+        while (!s_stdinEof)
+        {
+            if (SimMain_ReadInput(-1))
+            {
+                return SimCore_NowNs();
+            }
+        }
+
+        if (SimHw_NextEventNs() == SIM_NEVER)
+        {
+            (void)fprintf(stderr, "sim: no events left and stdin closed\n");
+            SimHost_Exit(0);
+        }
+        return SimCore_NowNs();
+    }
+
+    /* Real time: sleep until the event is due or input arrives. */
+    (void)fflush(stdout);
+
+    for (;;)
+    {
+        uint64_t wall = SimMain_WallNs();
+        if (wall < now)
+        {
+            wall = now;
+        }
+        if (wall >= target_ns)
+        {
+            return target_ns;
+        }
+
+        int timeout_ms = -1;
+        if (target_ns != SIM_NEVER)
+        {
+            uint64_t left_ms = ((target_ns - wall) + SIM_NS_PER_MS - 1U) / SIM_NS_PER_MS;
+            timeout_ms = (left_ms > 1000U) ? 1000 : (int)left_ms;
+        }
+
+        if (s_stdinEof)
+        {
+            if (target_ns == SIM_NEVER)
+            {
+                (void)fprintf(stderr, "sim: no events left and stdin closed\n");
+                SimHost_Exit(0);
+            }
+            (void)poll(NULL, 0, timeout_ms);
+        }
+        else if (SimMain_ReadInput(timeout_ms))
+        {
+            wall = SimMain_WallNs();
+            return (wall < target_ns) ? ((wall > now) ? wall : now) : target_ns;
+        }
+
+        if (s_stopRequested != 0)
+        {
+            SimHost_Exit(130);
+        }
+    }
+}
+
+bool SimHost_StopRequested(void)
+{
+    return s_stopRequested != 0;
+}
+
+void SimHost_Output(const uint8_t *data, size_t len)
+{
+    (void)fwrite(data, 1U, len, stdout);
+
+    if (s_options.realtime)
+    {
+        (void)fflush(stdout);
+    }
+}
+
+void SimHost_Exit(int status)
+{
+    (void)fflush(stdout);
+
+    if (!s_options.quiet)
+    {
+        SimCoreStats_t core;
+        SimHwStats_t   hw;
+        SimCore_GetStats(&core);
+        SimHw_GetStats(&hw);
+
+        double virt = (double)SimCore_NowNs() / 1e9;
+        double wall = (double)SimMain_WallNs() / 1e9;
+
+        (void)fprintf(stderr,
+                      "sim: %.3f s simulated in %.3f s (%.0fx real time), HAL tick %lu ms\n"
+                      "sim: %llu interrupts, %llu WFI, %llu busy-wait skips\n"
+                      "sim: %llu STOP windows, %llu ms in STOP, longest %llu ms\n"
+                      "sim: console tx %llu bytes, rx %llu bytes, %llu lost; %lu flash sectors erased; %llu ADC scans\n",
+                      virt, wall, (wall > 0.0) ? (virt / wall) : 0.0, (unsigned long)uwTick,
+                      (unsigned long long)core.interrupts,
+                      (unsigned long long)core.wfiCount,
+                      (unsigned long long)core.spinSteps,
+                      (unsigned long long)core.stops,
+                      (unsigned long long)(core.stopNs / 1000000U),
+                      (unsigned long long)(core.stopMaxNs / 1000000U),
+                      (unsigned long long)hw.txBytes,
+                      (unsigned long long)hw.rxBytes,
+                      (unsigned long long)hw.rxLost,
+                      (unsigned long)hw.erases,
+                      (unsigned long long)hw.adcScans);
+
+        if (s_options.resets != 0U)
+        {
+            (void)fprintf(stderr, "sim: %lu resets (%lu STANDBY wakeups); counters are since the last\n",
+                          (unsigned long)s_options.resets, (unsigned long)s_options.standbys);
+        }
+
+        if (TELEMETRY_UART_ENABLE != 0)
+        {
+            (void)fprintf(stderr, "sim: telemetry UART tx %llu bytes\n", (unsigned long long)hw.telemBytes);
+        }
+
+        if (s_options.usbHost)
+        {
+            SimUsbStats_t usb;
+            SimUsb_GetStats(&usb);
+            (void)fprintf(stderr,
+                          "sim: usb tx %llu bytes, rx %llu bytes; %lu control requests, %lu stalled\n",
+                          (unsigned long long)usb.txBytes,
+                          (unsigned long long)usb.rxBytes,
+                          (unsigned long)usb.controls,
+                          (unsigned long)usb.stalls);
+        }
+    }
+
+    exit(status);
+}
+
+void SimHost_Reset(uint64_t at_ns, uint32_t rccCsr, uint32_t pwrCsr, uint32_t rtcIsr, bool standby)
+{
+    const char *flash  = SimHw_ImagePath(FLASH_BASE);
+    const char *backup = SimHw_ImagePath(BKPSRAM_BASE);
+
+    if ((flash == NULL) || (backup == NULL))
+    {
+        SimHost_Exit(1);
+    }
+
+    (void)fflush(stdout);
+    if (!standby && !s_options.quiet)
+    {
+        (void)fprintf(stderr, "sim: system reset at %.3f s\n", (double)at_ns / 1e9);
+    }
+
+    /* The command line again, from the parsed options. */
+    char  duration[32];
+    char  loss[16];
+    char  state[128];
+    char  presses[SIM_MAX_BUTTON_PRESSES][16];
+    char *args[20U + (2U * SIM_MAX_BUTTON_PRESSES)];
+    int   n = 0;
+
+    args[n++] = (char *)s_program;
+    args[n++] = s_options.realtime ? "-r" : "-x";
+    if (s_options.duration_ns != SIM_NEVER)
+    {
+        (void)snprintf(duration, sizeof(duration), "%llu",
+                       (unsigned long long)(s_options.duration_ns / SIM_NS_PER_MS));
+        args[n++] = "-t";
+        args[n++] = duration;
+    }
+    if (s_options.quiet)
+    {
+        args[n++] = "-q";
+    }
+    if (s_options.usbHost)
+    {
+        args[n++] = "-u";
+    }
+    if (s_options.uplinkLoss != 0U)
+    {
+        (void)snprintf(loss, sizeof(loss), "%lu", (unsigned long)s_options.uplinkLoss);
+        args[n++] = "-l";
+        args[n++] = loss;
+    }
+    if (s_options.telemetryOut != NULL)
+    {
+        args[n++] = "-T";
+        args[n++] = (char *)s_options.telemetryOut;
+    }
+    if (s_options.replayFile != NULL)
+    {
+        args[n++] = "-P";
+        args[n++] = (char *)s_options.replayFile;
+    }
+    for (uint32_t i = 0U; i < s_options.buttonCount; ++i)
+    {
+        (void)snprintf(presses[i], sizeof(presses[i]), "%lu", (unsigned long)s_options.buttonPress_ms[i]);
+        args[n++] = "-b";
+        args[n++] = presses[i];
+    }
+    args[n++] = "-f";
+    args[n++] = (char *)flash;
+    args[n++] = "-B";
+    args[n++] = (char *)backup;
+
+    (void)snprintf(state, sizeof(state), "%lu:%lu:%llu:%llu:%lx:%lx:%lx",
+                   (unsigned long)(s_options.resets + 1U),
+                   (unsigned long)(s_options.standbys + (standby ? 1U : 0U)),
+                   (unsigned long long)at_ns, (unsigned long long)s_options.wallStart_ns,
+                   (unsigned long)rccCsr, (unsigned long)pwrCsr, (unsigned long)rtcIsr);
+    args[n++] = "-S";
+    args[n++] = state;
+    args[n]   = NULL;
+
+    (void)execv("/proc/self/exe", args);
+
+    (void)fprintf(stderr, "sim: cannot restart: %s\n", strerror(errno));
+    SimHost_Exit(1);
+}
+
+/**
+ * @brief Benchmark clock: host monotonic time in ns.
+ *
+ * Overrides the DWT default in app_bench.c; firmware code takes no
+ * simulated time, so CYCCNT would not move.
+ */
+uint32_t AppBench_ClockNow(void)
+{
+    return (uint32_t)SimMain_WallNs();
+}
+
+uint32_t AppBench_ClockHz(void)
+{
+    return 1000000000U;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SimMain_ParseArgs(int argc, char **argv)
+{
+    bool forceFast = false;
+    int  opt;
+
+    (void)memset(&s_options, 0, sizeof(s_options));
+    s_options.duration_ns = SIM_NEVER;
+    s_options.realtime    = (isatty(STDIN_FILENO) != 0);
+
+    while ((opt = getopt(argc, argv, "t:rxqf:B:b:ul:T:P:S:h")) != -1)
+    {
+        char *end = NULL;
+
+        switch (opt)
+        {
+            case 't':
+            {
+                unsigned long long ms = strtoull(optarg, &end, 10);
+                if ((end == optarg) || (*end != '\0'))
+                {
+                    return false;
+                }
+                s_options.duration_ns = (uint64_t)ms * SIM_NS_PER_MS;
+                break;
+            }
+
+            case 'r':
+                s_options.realtime = true;
+                break;
+
+            case 'x':
+                forceFast = true;
+                break;
+
+            case 'q':
+                s_options.quiet = true;
+                break;
+
+            case 'f':
+                s_options.flashImage = optarg;
+                break;
+
+            case 'B':
+                s_options.backupImage = optarg;
+                break;
+
+            case 'b':
+            {
+                unsigned long ms = strtoul(optarg, &end, 10);
+                if ((end == optarg) || (*end != '\0') ||
+                    (s_options.buttonCount >= SIM_MAX_BUTTON_PRESSES))
+                {
+                    return false;
+                }
+                s_options.buttonPress_ms[s_options.buttonCount++] = (uint32_t)ms;
+                break;
+            }
+
+            case 'u':
+                if (USB_CDC_ENABLE == 0)
+                {
+                    (void)fprintf(stderr, "sim: -u needs a build with USB_CDC_ENABLE=1\n");
+                    return false;
+                }
+                s_options.usbHost = true;
+                break;
+
+            case 'l':
+            {
+                unsigned long n = strtoul(optarg, &end, 10);
+                if ((end == optarg) || (*end != '\0') || (n == 0UL) || (n > 0xFFFFFFFFUL))
+                {
+                    return false;
+                }
+                s_options.uplinkLoss = (uint32_t)n;
+                break;
+            }
+
+            case 'T':
+                if (TELEMETRY_UART_ENABLE == 0)
+                {
+                    (void)fprintf(stderr, "sim: -T needs a build with TELEMETRY_UART_ENABLE=1\n");
+                    return false;
+                }
+                s_options.telemetryOut = optarg;
+                break;
+
+            case 'P':
+                s_options.replayFile = optarg;
+                break;
+
+            case 'S':
+                if (!SimMain_ParseRestart(optarg))
+                {
+                    return false;
+                }
+                break;
+
+            case 'h':
+            default:
+                return false;
+        }
+    }
+
+    if (forceFast)
+    {
+        s_options.realtime = false;
+    }
+
+    return (optind == argc);
+}
+
+static void SimMain_Usage(const char *prog)
+{
+    (void)fprintf(stderr,
+                  "usage: %s [-t ms] [-r | -x] [-q] [-u] [-l n] [-T telem.bin] [-P capture.bin] [-f flash.bin] [-B bkpsram.bin] [-b ms]...\n"
+                  "  -t ms     stop after ms of simulated time (default: 1 s after stdin ends)\n"
+                  "  -r        pace simulated time to the wall clock (default on a terminal)\n"
+                  "  -x        run as fast as possible (default otherwise)\n"
+                  "  -q        no summary on exit\n"
+                  "  -u        attach a USB host: the console runs over USB CDC\n"
+                  "  -l n      the uplink back end loses every n-th batch frame\n"
+                  "  -T file   write the telemetry UART output to file\n"
+                  "  -P file   capture the `replay file` command reads samples from\n"
+                  "  -f file   back the 512 KiB flash with file (created erased if missing)\n"
+                  "  -B file   back the 4 KiB backup SRAM with file (crash trace, standby buffer)\n"
+                  "  -b ms     press B1 at ms (repeatable, up to %u)\n"
+                  "A reset restarts the firmware with its flash and backup SRAM (-S is internal).\n",
+                  prog, (unsigned)SIM_MAX_BUTTON_PRESSES);
+}
+
+static bool SimMain_ParseRestart(const char *arg)
+{
+    unsigned long      resets   = 0UL;
+    unsigned long      standbys = 0UL;
+    unsigned long long start    = 0ULL;
+    unsigned long long wall     = 0ULL;
+    unsigned long      rcc      = 0UL;
+    unsigned long      pwr      = 0UL;
+    unsigned long      rtc      = 0UL;
+    int                used     = 0;
+
+    if ((sscanf(arg, "%lu:%lu:%llu:%llu:%lx:%lx:%lx%n", &resets, &standbys, &start, &wall,
+                &rcc, &pwr, &rtc, &used) != 7) || (arg[used] != '\0') || (resets == 0UL))
+    {
+        return false;
+    }
+
+    s_options.resets       = (uint32_t)resets;
+    s_options.standbys     = (uint32_t)standbys;
+    s_options.start_ns     = (uint64_t)start;
+    s_options.wallStart_ns = (uint64_t)wall;
+    s_options.resetRcc     = (uint32_t)rcc;
+    s_options.resetPwr     = (uint32_t)pwr;
+    s_options.resetRtcIsr  = (uint32_t)rtc;
+
+    return true;
+}
+
+static bool SimMain_ReadInput(int timeout_ms)
+{
+    struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+
+    int ready = poll(&pfd, 1U, timeout_ms);
+    if ((ready <= 0) || ((pfd.revents & (POLLIN | POLLHUP | POLLERR)) == 0))
+    {
+        return false;
+    }
+
+    uint8_t buffer[512];
+    size_t  space = SimMain_InjectSpace();
+    if (space == 0U)
+    {
+        return false;
+    }
+    if (space > sizeof(buffer))
+    {
+        space = sizeof(buffer);
+    }
+
+    ssize_t n = read(STDIN_FILENO, buffer, space);
+    if (n > 0)
+    {
+        /* In real time the input arrived at the wall clock time, which
+         * runs ahead of simulated time while the core sleeps.
+         */
+        uint64_t at = s_options.realtime ? SimMain_WallNs() : SimCore_NowNs();
+        (void)SimMain_Inject(buffer, (size_t)n, at);
+        return true;
+    }
+
+    if ((n == 0) || (errno != EINTR))
+    {
+        s_stdinEof = true;
+
+        if (s_options.duration_ns == SIM_NEVER)
+        {
+            uint64_t last = SimMain_LastRxNs();
+            uint64_t now  = SimCore_NowNs();
+            SimCore_SetEndNs(((last > now) ? last : now) + SIM_MAIN_GRACE_NS);
+        }
+    }
+
+    return false;
+}
+
+static size_t SimMain_Inject(const uint8_t *data, size_t len, uint64_t at_ns)
+{
+    return s_options.usbHost ? SimUsb_Inject(data, len, at_ns) : SimHw_UartInject(data, len, at_ns);
+}
+
+static size_t SimMain_InjectSpace(void)
+{
+    return s_options.usbHost ? SimUsb_InjectSpace() : SimHw_UartInjectSpace();
+}
+
+static uint64_t SimMain_LastRxNs(void)
+{
+    return s_options.usbHost ? SimUsb_LastRxNs() : SimHw_UartLastRxNs();
+}
+
+static uint64_t SimMain_WallNs(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    int64_t sec  = (int64_t)ts.tv_sec - (int64_t)s_wallStart.tv_sec;
+    int64_t nsec = (int64_t)ts.tv_nsec - (int64_t)s_wallStart.tv_nsec;
+
+    return (uint64_t)((sec * 1000000000LL) + nsec);
+}
+
+static void SimMain_OnSignal(int sig)
+{
+    (void)sig;
+    s_stopRequested = 1;
+}
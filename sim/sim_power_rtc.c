@@ -0,0 +1,128 @@
+/**
+ * @file sim_power_rtc.c
+ * @brief RTC millisecond clock and wakeup timer for the host simulation.
+ *
+ * Replaces power/power_rtc.c, which polls RTC handshake flags and reads
+ * calendar registers that only hardware updates. The clock is virtual
+ * time, so sleep durations measured with it are exact (the board's LSI
+ * is a few % off). Wakeups are raised through EXTI line 22 as on the MCU.
+ * The button wakeup only sets the time-stamp bits of the simulated RTC
+ * registers; sim_hw.c reads them to find the end of a STANDBY.
+ *
+ * @ingroup sim
+ */
+
+#include "power_rtc.h"
+#include "sim.h"
+#include "irq_plan.h"
+
+/** @brief Milliseconds in one RTC calendar day. */
+#define POWER_RTC_DAY_MS          (86400000UL)
+
+/* ------------------------------------------------------------------------- */
+
+bool PowerRtc_Init(void)
+{
+    EXTI->RTSR |= EXTI_RTSR_TR22;
+    EXTI->IMR  |= EXTI_IMR_MR22;
+
+    HAL_NVIC_SetPriority(RTC_WKUP_IRQn, IRQ_PRIO_RTC_WAKEUP, 0U);
+    HAL_NVIC_EnableIRQ(RTC_WKUP_IRQn);
+
+    return true;
+}
+
+uint32_t PowerRtc_GetMs(void)
+{
+    return (uint32_t)((SimCore_NowNs() / SIM_NS_PER_MS) % POWER_RTC_DAY_MS);
+}
+
+uint32_t PowerRtc_ElapsedMs(uint32_t start_ms, uint32_t end_ms)
+{
+    if (end_ms >= start_ms)
+    {
+        return end_ms - start_ms;
+    }
+
+    return (uint32_t)(POWER_RTC_DAY_MS - start_ms) + end_ms;
+}
+
+void PowerRtc_StartWakeup(uint32_t delay_ms)
+{
+    if (delay_ms > POWER_RTC_MAX_WAKEUP_MS)
+    {
+        delay_ms = POWER_RTC_MAX_WAKEUP_MS;
+    }
+    if (delay_ms == 0U)
+    {
+        delay_ms = 1U;
+    }
+
+    SimHw_RtcStopWakeup();
+    EXTI->PR = EXTI_PR_PR22;
+    SimHw_Sync();
+    SimHw_RtcStartWakeup((uint64_t)delay_ms * SIM_NS_PER_MS);
+}
+
+void PowerRtc_StartWakeupSeconds(uint32_t delay_s)
+{
+    if (delay_s > POWER_RTC_MAX_WAKEUP_S)
+    {
+        delay_s = POWER_RTC_MAX_WAKEUP_S;
+    }
+    if (delay_s == 0U)
+    {
+        delay_s = 1U;
+    }
+
+    SimHw_RtcStopWakeup();
+    EXTI->PR = EXTI_PR_PR22;
+    SimHw_Sync();
+    SimHw_RtcStartWakeup((uint64_t)delay_s * 1000U * SIM_NS_PER_MS);
+}
+
+void PowerRtc_StopWakeup(void)
+{
+    SimHw_RtcStopWakeup();
+
+    EXTI->PR = EXTI_PR_PR22;
+    HAL_NVIC_ClearPendingIRQ(RTC_WKUP_IRQn);
+}
+
+void PowerRtc_SetButtonWake(bool enable)
+{
+    RTC->CR &= ~(RTC_CR_TSE | RTC_CR_TSIE | RTC_CR_TSEDGE);
+    if (enable)
+    {
+        RTC->CR |= RTC_CR_TSEDGE | RTC_CR_TSIE | RTC_CR_TSE;
+    }
+    RTC->ISR &= ~(RTC_ISR_TSF | RTC_ISR_TSOVF);
+}
+
+uint32_t PowerRtc_TakeWakeEvents(void)
+{
+    uint32_t events = 0U;
+
+    if ((RTC->ISR & RTC_ISR_WUTF) != 0U)
+    {
+        events |= POWER_RTC_EVENT_TIMER;
+    }
+    if ((RTC->ISR & RTC_ISR_TSF) != 0U)
+    {
+        events |= POWER_RTC_EVENT_BUTTON;
+    }
+
+    RTC->ISR &= ~(RTC_ISR_WUTF | RTC_ISR_TSF | RTC_ISR_TSOVF);
+    EXTI->PR = EXTI_PR_PR22;
+    SimHw_Sync();
+
+    return events;
+}
+
+void PowerRtc_WakeupIrqHandler(void)
+{
+    RTC->ISR &= ~RTC_ISR_WUTF;
+
+    EXTI->PR = EXTI_PR_PR22;
+    SimHw_Sync();
+}
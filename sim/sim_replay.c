@@ -0,0 +1,304 @@
+/**
+ * @file sim_replay.c
+ * @brief Replay file of the host simulation (-P).
+ *
+ * Provides the file source of the replay sensor (sensor_replay.h). The
+ * file is a telemetry capture as the host tools save it: the console or
+ * telemetry UART output with text and COBS frames mixed. Frames are found
+ * the way tools/telemetry_decode.py finds them (between 0x00 delimiters,
+ * CRC checked), and sample frames of every format are read back; other
+ * frames and the text between them are skipped.
+ *
+ * The file is read into memory once at start-up, so every `replay file`
+ * starts from its beginning and reads it the same way.
+ *
+ * @ingroup sim
+ */
+
+#include "sensor_replay.h"
+#include "telemetry.h"
+#include "sample_codec.h"
+#include "cobs.h"
+#include "crc32.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** @brief Header of a telemetry frame: type, count, base_ms (bytes). */
+#define SIM_REPLAY_HEADER      (6U)
+
+/** @brief Largest decoded frame: header, payload and CRC. */
+#define SIM_REPLAY_FRAME_MAX   (SIM_REPLAY_HEADER + TELEMETRY_MAX_PAYLOAD + 4U)
+
+/** @brief Largest COBS-encoded frame between its delimiters. */
+#define SIM_REPLAY_WIRE_MAX    (COBS_MAX_ENCODED_SIZE(SIM_REPLAY_FRAME_MAX))
+
+/** @brief Header of a raw record: id, dt, layout, quality, scale (bytes). */
+#define SIM_REPLAY_RAW_HEADER  (6U)
+
+/** @brief File content, or NULL without -P. */
+static uint8_t *s_file = NULL;
+static size_t   s_fileLen = 0U;
+
+/** @brief Read position in the file. */
+static size_t s_pos = 0U;
+
+/** @brief Current frame: decoded bytes and length without the CRC. */
+static uint8_t s_frame[SIM_REPLAY_FRAME_MAX];
+static size_t  s_frameLen = 0U;
+
+/** @brief Records of the current frame not yet read. */
+static uint32_t s_left = 0U;
+
+/** @brief Read offset of the next F32, I16 or raw record. */
+static size_t s_offset = 0U;
+
+/** @brief Decoder of a delta or XOR frame. */
+static SampleCodecReader_t s_codec;
+
+/**
+ * @brief Find the next valid sample frame from @ref s_pos.
+ */
+static bool SimReplay_NextFrame(void);
+
+/**
+ * @brief Read the next record of the current frame.
+ */
+static bool SimReplay_ReadRecord(SensorData_t *data);
+
+/**
+ * @brief Read a little-endian integer of @p size bytes.
+ */
+static uint32_t SimReplay_GetLe(const uint8_t *src, size_t size);
+
+/* ------------------------------------------------------------------------- */
+
+void SimReplay_Init(const SimOptions_t *opt)
+{
+    if (opt->replayFile == NULL)
+    {
+        return;
+    }
+
+    FILE *file = fopen(opt->replayFile, "rb");
+    if (file == NULL)
+    {
+        (void)fprintf(stderr, "sim: cannot open %s\n", opt->replayFile);
+        return;
+    }
+
+    (void)fseek(file, 0L, SEEK_END);
+    long len = ftell(file);
+    (void)fseek(file, 0L, SEEK_SET);
+
+    if (len > 0L)
+    {
+        s_file = malloc((size_t)len);
+        if ((s_file != NULL) && (fread(s_file, 1U, (size_t)len, file) == (size_t)len))
+        {
+            s_fileLen = (size_t)len;
+        }
+    }
+    (void)fclose(file);
+}
+
+bool SensorReplay_FileOpen(void)
+{
+    s_pos  = 0U;
+    s_left = 0U;
+    return (s_fileLen != 0U);
+}
+
+bool SensorReplay_FileRead(SensorData_t *data)
+{
+    while ((s_left == 0U) || !SimReplay_ReadRecord(data))
+    {
+        if (!SimReplay_NextFrame())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static bool SimReplay_NextFrame(void)
+{
+    s_left = 0U;
+
+    while (s_pos < s_fileLen)
+    {
+        const uint8_t *start = memchr(&s_file[s_pos], 0, s_fileLen - s_pos);
+        if (start == NULL)
+        {
+            break;
+        }
+
+        size_t         open  = (size_t)(start - s_file);
+        const uint8_t *close = memchr(start + 1, 0, s_fileLen - open - 1U);
+        size_t         wire  = (close != NULL) ? (size_t)(close - start - 1) : 0U;
+        size_t         len   = 0U;
+
+        if ((wire != 0U) && (wire <= SIM_REPLAY_WIRE_MAX))
+        {
+            len = Cobs_Decode(start + 1, wire, s_frame, sizeof(s_frame));
+        }
+
+        if ((len < (SIM_REPLAY_HEADER + 4U)) ||
+            (Crc32_Compute(s_frame, len - 4U) != SimReplay_GetLe(&s_frame[len - 4U], 4U)))
+        {
+            /* Not a frame: a zero in the text, or a frame cut short. */
+            s_pos = open + 1U;
+            continue;
+        }
+
+        s_pos      = open + wire + 2U;
+        s_frameLen = len - 4U;
+        s_offset   = SIM_REPLAY_HEADER;
+
+        uint32_t count = s_frame[1];
+        uint32_t base  = SimReplay_GetLe(&s_frame[2], 4U);
+
+        switch (s_frame[0])
+        {
+            case TELEMETRY_FRAME_SAMPLES_F32:
+            case TELEMETRY_FRAME_SAMPLES_I16:
+            case TELEMETRY_FRAME_SAMPLES_RAW:
+                s_left = count;
+                break;
+
+            case TELEMETRY_FRAME_SAMPLES_DELTA:
+            case TELEMETRY_FRAME_SAMPLES_XOR:
+                SampleCodec_BeginRead(&s_codec,
+                                      (s_frame[0] == TELEMETRY_FRAME_SAMPLES_XOR) ? SAMPLE_CODEC_XOR
+                                                                                   : SAMPLE_CODEC_DELTA,
+                                      base, &s_frame[SIM_REPLAY_HEADER],
+                                      s_frameLen - SIM_REPLAY_HEADER);
+                s_left = count;
+                break;
+
+            default:
+                /* Energy, statistics, metrics, trace: no samples. */
+                break;
+        }
+
+        if (s_left != 0U)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool SimReplay_ReadRecord(SensorData_t *data)
+{
+    const uint8_t *rec  = &s_frame[s_offset];
+    size_t         left = s_frameLen - s_offset;
+    uint32_t       base = SimReplay_GetLe(&s_frame[2], 4U);
+
+    s_left--;
+
+    switch (s_frame[0])
+    {
+        case TELEMETRY_FRAME_SAMPLES_F32:
+        {
+            uint32_t bits = 0U;
+            float    value;
+
+            if (left < 7U)
+            {
+                break;
+            }
+            bits = SimReplay_GetLe(&rec[3], 4U);
+            (void)memcpy(&value, &bits, sizeof(value));
+
+            SensorData_Init(data, SENSOR_FORMAT_S32, 1U, -3);
+            SensorData_SetFloat(data, 0U, value);
+            data->sensorId  = rec[0];
+            data->timestamp = base + SimReplay_GetLe(&rec[1], 2U);
+            s_offset += 7U;
+            return true;
+        }
+
+        case TELEMETRY_FRAME_SAMPLES_I16:
+            if (left < 5U)
+            {
+                break;
+            }
+            /* Stored at the record's own resolution, 10^-2. */
+            SensorData_Init(data, SENSOR_FORMAT_S16, 1U, -2);
+            SensorData_SetRaw(data, 0U, (int16_t)SimReplay_GetLe(&rec[3], 2U));
+            data->sensorId  = rec[0];
+            data->timestamp = base + SimReplay_GetLe(&rec[1], 2U);
+            s_offset += 5U;
+            return true;
+
+        case TELEMETRY_FRAME_SAMPLES_RAW:
+        {
+            if (left < SIM_REPLAY_RAW_HEADER)
+            {
+                break;
+            }
+
+            uint32_t channels = (uint32_t)rec[3] & SENSOR_LAYOUT_CHANNELS_MASK;
+            bool     wide     = (rec[3] & SENSOR_LAYOUT_S32) != 0U;
+            size_t   size     = wide ? 4U : 2U;
+
+            if ((channels == 0U) || (channels > SENSOR_MAX_CHANNELS) ||
+                (left < (SIM_REPLAY_RAW_HEADER + (channels * size))))
+            {
+                break;
+            }
+
+            SensorData_Init(data, wide ? SENSOR_FORMAT_S32 : SENSOR_FORMAT_S16, channels, (int8_t)rec[5]);
+            for (uint32_t c = 0U; c < channels; ++c)
+            {
+                uint32_t raw = SimReplay_GetLe(&rec[SIM_REPLAY_RAW_HEADER + (c * size)], size);
+                SensorData_SetRaw(data, c, wide ? (int32_t)raw : (int32_t)(int16_t)raw);
+            }
+            data->sensorId  = rec[0];
+            data->quality   = rec[4];
+            data->timestamp = base + SimReplay_GetLe(&rec[1], 2U);
+            s_offset += SIM_REPLAY_RAW_HEADER + (channels * size);
+            return true;
+        }
+
+        default:
+        {
+            SampleCodecRecord_t record;
+
+            if (!SampleCodec_Read(&s_codec, &record))
+            {
+                break;
+            }
+            SensorData_Init(data, SENSOR_FORMAT_S32, 1U, -3);
+            SensorData_SetFloat(data, 0U, record.value);
+            data->sensorId  = record.sensorId;
+            data->timestamp = record.timestamp;
+            return true;
+        }
+    }
+
+    /* A record runs past the frame: drop the rest of it. */
+    s_left = 0U;
+    return false;
+}
+
+static uint32_t SimReplay_GetLe(const uint8_t *src, size_t size)
+{
+    uint32_t value = 0U;
+
+    for (size_t i = size; i > 0U; --i)
+    {
+        value = (value << 8) | src[i - 1U];
+    }
+
+    return value;
+}
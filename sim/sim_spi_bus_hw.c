@@ -0,0 +1,395 @@
+/**
+ * @file sim_spi_bus_hw.c
+ * @brief SPI bus port for the host simulation, with an IMU-style register
+ *        file behind every chip select.
+ *
+ * Replaces common/spi_bus_hw.c. Each segment completes in one step: its
+ * time on the wire (8 bit times per byte at the SCK the SPI2 divider
+ * would give the device) is scheduled as a DMA1 Stream3 interrupt, and
+ * the handler moves the data and reports the result. So the queue and
+ * the segment chaining in spi_bus.c run as on the board.
+ *
+ * Every device answers the usual IMU protocol: the first byte is the
+ * register address with bit 7 set for a read, and the address
+ * increments for each further byte. WHO_AM_I (0x0F) reads
+ * @ref SIM_SPI_WHO_AM_I; the three int16 axes at 0x28 change on every
+ * read that starts there. Writes go to the register file.
+ *
+ * The chip select of the sample archive (@ref SAMPLE_ARCHIVE_CS_PIN) has a
+ * 2 MB serial NOR flash instead (W25Q16: JEDEC ID EF 40 15), with read,
+ * page program, sector and chip erase, the status register busy bit for
+ * typical program and erase times, and deep power-down. Its contents live
+ * in a memfd that a reset (which re-executes the simulator) inherits, with
+ * the descriptor number in @ref SIM_NOR_FD_ENV, so they survive resets
+ * and STANDBY like the on-chip flash.
+ *
+ * @ingroup sim
+ */
+
+#define _GNU_SOURCE
+#include "spi_bus_hw.h"
+#include "app_config.h"
+#include "periph_power.h"
+#include "sim.h"
+#include "irq_plan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/** @brief Chip selects modelled (GPIOB has 16 pins). */
+#define SIM_SPI_DEVICES       (16U)
+
+/** @brief Registers per device. */
+#define SIM_SPI_REGS          (128U)
+
+/** @brief WHO_AM_I register and value. */
+#define SIM_SPI_REG_WHO_AM_I  (0x0FU)
+#define SIM_SPI_WHO_AM_I      (0x6BU)
+
+/** @brief First axis output register (X low byte). */
+#define SIM_SPI_REG_OUT       (0x28U)
+
+/** @brief Size of the NOR flash, its JEDEC ID and its program page. */
+#define SIM_NOR_SIZE          (2UL * 1024UL * 1024UL)
+#define SIM_NOR_JEDEC_ID      (0xEF4015UL)
+#define SIM_NOR_PAGE          (256U)
+
+/** @brief Environment variable handing the NOR memfd to the restarted process. */
+#define SIM_NOR_FD_ENV        "HUB_SIM_NOR_FD"
+
+/** @brief Typical program, sector erase and chip erase times (ns). */
+#define SIM_NOR_PROGRAM_NS    (600000ULL)
+#define SIM_NOR_SECTOR_NS     (45000000ULL)
+#define SIM_NOR_CHIP_NS       (2000000000ULL)
+
+/** @brief Register files, indexed by chip select pin number. */
+static uint8_t s_regs[SIM_SPI_DEVICES][SIM_SPI_REGS];
+
+/** @brief Output reads per device (drives the axis values). */
+static uint16_t s_samples[SIM_SPI_DEVICES];
+
+/** @brief NOR flash contents (NULL: no device answers). */
+static uint8_t *s_nor = NULL;
+
+/** @brief NOR write enable latch, deep power-down and end of the busy time. */
+static bool     s_norWel       = false;
+static bool     s_norAsleep    = true;
+static uint64_t s_norBusyEnd_ns = 0U;
+
+/** @brief Segment in progress. */
+static const SpiBusSegment_t *s_segment = NULL;
+
+/** @brief Clocks taken by the first start after a release. */
+static bool s_clocked = false;
+
+/**
+ * @brief Run @p segment against the device behind its chip select.
+ */
+static void SimSpi_Transfer(const SpiBusSegment_t *segment);
+
+/**
+ * @brief Run @p segment (one chip-select window) against the NOR flash.
+ */
+static void SimSpi_NorTransfer(const SpiBusSegment_t *segment);
+
+/**
+ * @brief Map the NOR contents: inherited from before the reset, or new
+ *        and erased.
+ */
+static void SimSpi_NorMap(void);
+
+/* ------------------------------------------------------------------------- */
+
+void SpiBusHw_Init(void)
+{
+    for (uint32_t d = 0U; d < SIM_SPI_DEVICES; ++d)
+    {
+        for (uint32_t r = 0U; r < SIM_SPI_REGS; ++r)
+        {
+            s_regs[d][r] = 0U;
+        }
+        s_regs[d][SIM_SPI_REG_WHO_AM_I] = SIM_SPI_WHO_AM_I;
+        s_samples[d] = 0U;
+    }
+    s_segment = NULL;
+    s_clocked = false;
+
+    if (s_nor == NULL)
+    {
+        SimSpi_NorMap();
+    }
+    s_norWel    = false;
+    s_norAsleep = true;
+
+    HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, IRQ_PRIO_SPI_DMA_RX, 0U);
+    HAL_NVIC_EnableIRQ(DMA1_Stream3_IRQn);
+}
+
+void SpiBusHw_InitCs(uint16_t pin)
+{
+    (void)pin;
+}
+
+void SpiBusHw_Start(const SpiBusSegment_t *segment)
+{
+    if (!s_clocked)
+    {
+        PeriphPower_Acquire(PERIPH_POWER_GPIOB);
+        PeriphPower_Acquire(PERIPH_POWER_DMA1);
+        PeriphPower_Acquire(PERIPH_POWER_SPI2);
+        s_clocked = true;
+    }
+
+    /* SCK = PCLK1 / 2^(BR + 1), as spi_bus_hw.c picks it. */
+    uint32_t sck = HAL_RCC_GetPCLK1Freq() / 2U;
+    while ((sck > segment->device->maxHz) && (sck > (HAL_RCC_GetPCLK1Freq() / 256U)))
+    {
+        sck /= 2U;
+    }
+
+    uint64_t bits = (uint64_t)segment->length * 8U;
+
+    s_segment = segment;
+    SimHw_SpiStart((bits * 1000000000ULL) / sck);
+}
+
+void SpiBusHw_Abort(void)
+{
+    SimHw_SpiStop();
+    s_segment = NULL;
+}
+
+void SpiBusHw_Release(void)
+{
+    if (!s_clocked)
+    {
+        return;
+    }
+
+    PeriphPower_Release(PERIPH_POWER_SPI2);
+    PeriphPower_Release(PERIPH_POWER_DMA1);
+    PeriphPower_Release(PERIPH_POWER_GPIOB);
+    s_clocked = false;
+}
+
+void SpiBusHw_DmaRxIrqHandler(void)
+{
+    const SpiBusSegment_t *segment = s_segment;
+
+    if (segment == NULL)
+    {
+        return;
+    }
+    s_segment = NULL;
+
+    SimSpi_Transfer(segment);
+    SpiBus_OnHwDone(SPI_BUS_OK);
+}
+
+void SpiBusHw_DmaTxIrqHandler(void)
+{
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void SimSpi_Transfer(const SpiBusSegment_t *segment)
+{
+    uint32_t dev = 0U;
+    while ((dev < (SIM_SPI_DEVICES - 1U)) && ((segment->device->csPin & (1U << dev)) == 0U))
+    {
+        dev++;
+    }
+
+    if ((dev == SAMPLE_ARCHIVE_CS_PIN) && (s_nor != NULL))
+    {
+        SimSpi_NorTransfer(segment);
+        return;
+    }
+
+    uint8_t *regs = s_regs[dev];
+    uint8_t  cmd  = (segment->tx != NULL) ? segment->tx[0] : 0xFFU;
+    bool     read = ((cmd & 0x80U) != 0U);
+    uint32_t reg  = cmd & 0x7FU;
+
+    if (read && (reg == SIM_SPI_REG_OUT))
+    {
+        /* New sample: X ramps, Y mirrors it, Z sits at 1 g (16384 LSB). */
+        uint16_t n = ++s_samples[dev];
+        int16_t  axis[3] = { (int16_t)n, (int16_t)(0U - n), 16384 };
+
+        for (uint32_t a = 0U; a < 3U; ++a)
+        {
+            regs[SIM_SPI_REG_OUT + (2U * a)]      = (uint8_t)((uint16_t)axis[a] & 0xFFU);
+            regs[SIM_SPI_REG_OUT + (2U * a) + 1U] = (uint8_t)((uint16_t)axis[a] >> 8);
+        }
+    }
+
+    if (segment->rx != NULL)
+    {
+        segment->rx[0] = 0xFFU;
+    }
+
+    for (uint32_t i = 1U; i < segment->length; ++i)
+    {
+        uint32_t r = (reg + i - 1U) % SIM_SPI_REGS;
+
+        if (read)
+        {
+            if (segment->rx != NULL)
+            {
+                segment->rx[i] = regs[r];
+            }
+        }
+        else if ((segment->tx != NULL) && (r != SIM_SPI_REG_WHO_AM_I))
+        {
+            regs[r] = segment->tx[i];
+        }
+    }
+}
+
+static void SimSpi_NorTransfer(const SpiBusSegment_t *segment)
+{
+    const uint8_t *tx   = segment->tx;
+    uint8_t       *rx   = segment->rx;
+    uint32_t       len  = segment->length;
+    uint8_t        cmd  = (tx != NULL) ? tx[0] : 0xFFU;
+    bool           busy = (SimCore_NowNs() < s_norBusyEnd_ns);
+    uint32_t       addr = 0U;
+
+    if (rx != NULL)
+    {
+        memset(rx, 0xFF, len);
+    }
+
+    if ((tx != NULL) && (len >= 4U))
+    {
+        addr = (((uint32_t)tx[1] << 16) | ((uint32_t)tx[2] << 8) | tx[3]) % SIM_NOR_SIZE;
+    }
+
+    /* Asleep, only the release is decoded; busy, only the status read. */
+    if (s_norAsleep)
+    {
+        if (cmd == 0xABU)
+        {
+            s_norAsleep = false;
+        }
+        return;
+    }
+    if (busy && (cmd != 0x05U))
+    {
+        return;
+    }
+
+    switch (cmd)
+    {
+    case 0x05U: /* Read status */
+        for (uint32_t i = 1U; (rx != NULL) && (i < len); ++i)
+        {
+            rx[i] = (uint8_t)((busy ? 0x01U : 0x00U) | (s_norWel ? 0x02U : 0x00U));
+        }
+        break;
+
+    case 0x06U: /* Write enable */
+        s_norWel = true;
+        break;
+
+    case 0x04U: /* Write disable */
+        s_norWel = false;
+        break;
+
+    case 0x9FU: /* JEDEC ID */
+        for (uint32_t i = 1U; (rx != NULL) && (i < len) && (i <= 3U); ++i)
+        {
+            rx[i] = (uint8_t)(SIM_NOR_JEDEC_ID >> (8U * (3U - i)));
+        }
+        break;
+
+    case 0xB9U: /* Deep power-down */
+        s_norAsleep = true;
+        break;
+
+    case 0xABU: /* Release from deep power-down */
+        break;
+
+    case 0x03U: /* Read */
+        for (uint32_t i = 4U; (rx != NULL) && (i < len); ++i)
+        {
+            rx[i] = s_nor[(addr + i - 4U) % SIM_NOR_SIZE];
+        }
+        break;
+
+    case 0x02U: /* Page program: bits only go to 0; the address wraps in the page */
+        if (s_norWel && (len > 4U))
+        {
+            uint32_t page = addr & ~(SIM_NOR_PAGE - 1U);
+            for (uint32_t i = 4U; i < len; ++i)
+            {
+                s_nor[page + ((addr + i - 4U) % SIM_NOR_PAGE)] &= tx[i];
+            }
+            s_norWel        = false;
+            s_norBusyEnd_ns = SimCore_NowNs() + SIM_NOR_PROGRAM_NS;
+        }
+        break;
+
+    case 0x20U: /* Sector erase (4 KB) */
+        if (s_norWel && (len >= 4U))
+        {
+            memset(&s_nor[addr & ~0xFFFUL], 0xFF, 0x1000U);
+            s_norWel        = false;
+            s_norBusyEnd_ns = SimCore_NowNs() + SIM_NOR_SECTOR_NS;
+        }
+        break;
+
+    case 0xC7U: /* Chip erase */
+    case 0x60U:
+        if (s_norWel)
+        {
+            memset(s_nor, 0xFF, SIM_NOR_SIZE);
+            s_norWel        = false;
+            s_norBusyEnd_ns = SimCore_NowNs() + SIM_NOR_CHIP_NS;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void SimSpi_NorMap(void)
+{
+    const char *env   = getenv(SIM_NOR_FD_ENV);
+    bool        fresh = (env == NULL);
+    int         fd    = fresh ? -1 : atoi(env);
+
+    if (fresh)
+    {
+        /* No CLOEXEC: the restarted process maps it again. */
+        char number[16];
+
+        fd = memfd_create("hub_sim_nor", 0U);
+        if ((fd < 0) || (ftruncate(fd, (off_t)SIM_NOR_SIZE) != 0))
+        {
+            (void)fprintf(stderr, "sim: no NOR flash image\n");
+            return;
+        }
+        (void)snprintf(number, sizeof(number), "%d", fd);
+        (void)setenv(SIM_NOR_FD_ENV, number, 1);
+    }
+
+    void *map = mmap(NULL, SIM_NOR_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        (void)fprintf(stderr, "sim: cannot map the NOR flash image\n");
+        return;
+    }
+
+    s_nor = (uint8_t *)map;
+    if (fresh)
+    {
+        memset(s_nor, 0xFF, SIM_NOR_SIZE);
+    }
+}
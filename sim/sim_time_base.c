@@ -0,0 +1,45 @@
+/**
+ * @file sim_time_base.c
+ * @brief Microsecond time base for the host simulation.
+ *
+ * Replaces common/time_base.c, whose TIM5 counter would need to advance
+ * with every register read. The time base reads virtual time directly;
+ * it keeps running in STOP, so nothing has to be added back after a
+ * sleep and clock changes need no compensation. Reads count toward
+ * busy-wait detection, as HAL_GetTick() does.
+ *
+ * @ingroup sim
+ */
+
+#include "time_base.h"
+#include "sim.h"
+
+/* ------------------------------------------------------------------------- */
+
+void Time_Init(void)
+{
+}
+
+uint64_t Time_NowUs(void)
+{
+    SimCore_Poll();
+    return SimCore_NowNs() / 1000U;
+}
+
+uint32_t Time_NowUs32(void)
+{
+    return (uint32_t)Time_NowUs();
+}
+
+void Time_OnClockChange(void)
+{
+}
+
+void Time_AddUs(uint64_t us)
+{
+    (void)us;
+}
+
+void Time_IrqHandler(void)
+{
+}
@@ -0,0 +1,313 @@
+/**
+ * @file sim_uplink_hw.c
+ * @brief Network uplink port for the host simulation, with a modem and a
+ *        back end behind the UART.
+ *
+ * Replaces common/uplink_hw.c. A send completes after its time on the
+ * wire at @ref UPLINK_BAUD (10 bit times per byte) as a USART6
+ * interrupt, and the handler passes the frames to the model and reports
+ * the end of the send. Replies come through the same interrupt, so
+ * uplink.c sees the same sequence of callbacks as on the board.
+ *
+ * The modem ignores everything until @ref SIM_UPLINK_ATTACH_NS after it
+ * was switched on (network join). The back end then follows uplink.h:
+ * it keeps the next batch number it expects across bursts, takes only
+ * that batch, answers HELLO at once and batches with a cumulative ACK
+ * @ref SIM_UPLINK_ACK_NS after the first one not yet acknowledged. With
+ * -l n it loses every n-th batch frame, to exercise the go-back-N resend.
+ *
+ * @ingroup sim
+ */
+
+#include "uplink_hw.h"
+#include "uplink.h"
+#include "app_config.h"
+#include "cobs.h"
+#include "crc32.h"
+#include "periph_power.h"
+#include "sim.h"
+#include "irq_plan.h"
+
+/** @brief Time from power-on until the modem answers (ns). */
+#define SIM_UPLINK_ATTACH_NS   (1500000000ULL)
+
+/** @brief Back end round trip for an acknowledgement (ns). */
+#define SIM_UPLINK_ACK_NS      (50000000ULL)
+
+/** @brief Largest decoded frame the model parses (bytes). */
+#define SIM_UPLINK_FRAME_MAX   (UPLINK_BATCH_PAYLOAD + 32U)
+
+/** @brief Header of a link frame: type and sequence number (bytes). */
+#define SIM_UPLINK_HEADER      (5U)
+
+/** @brief Every n-th batch frame is lost (-l), 0: none. */
+static uint32_t s_loss = 0U;
+
+/** @brief Batch frames seen, for the loss pattern. */
+static uint32_t s_batches = 0U;
+
+/** @brief Next batch number the back end expects (kept across bursts). */
+static uint32_t s_expected = 0U;
+
+/** @brief Modem powered, and the time it was switched on. */
+static bool     s_powered = false;
+static uint64_t s_onAt_ns = 0U;
+
+/** @brief Send in progress: buffer, length and end time. */
+static volatile bool  s_sending  = false;
+static const uint8_t *s_txData   = NULL;
+static size_t         s_txLen    = 0U;
+static uint64_t       s_txEnd_ns = SIM_NEVER;
+
+/** @brief Reply waiting to be received, and when. */
+static uint8_t  s_reply[2U * (SIM_UPLINK_HEADER + 4U) + 2U];
+static size_t   s_replyLen   = 0U;
+static uint64_t s_replyAt_ns = SIM_NEVER;
+
+/** @brief Decoded frame. */
+static uint8_t s_frame[SIM_UPLINK_FRAME_MAX];
+
+/**
+ * @brief Split the sent bytes at the delimiters and handle each frame.
+ */
+static void SimUplink_Receive(const uint8_t *data, size_t len);
+
+/**
+ * @brief Handle one decoded frame.
+ */
+static void SimUplink_OnFrame(size_t len);
+
+/**
+ * @brief Queue an ACK for @ref s_expected at @p at_ns (an earlier one
+ *        still waiting keeps its time and takes the new number).
+ */
+static void SimUplink_Ack(uint64_t at_ns);
+
+/**
+ * @brief Raise the USART6 interrupt at the next model event.
+ */
+static void SimUplink_Schedule(void);
+
+/**
+ * @brief Read a little-endian u32.
+ */
+static uint32_t SimUplink_GetU32(const uint8_t *src);
+
+/* ------------------------------------------------------------------------- */
+
+void SimUplink_Init(const SimOptions_t *opt)
+{
+    s_loss     = opt->uplinkLoss;
+    s_batches  = 0U;
+    s_expected = 0U;
+}
+
+void UplinkHw_Init(void)
+{
+    s_powered    = false;
+    s_sending    = false;
+    s_txEnd_ns   = SIM_NEVER;
+    s_replyLen   = 0U;
+    s_replyAt_ns = SIM_NEVER;
+    SimHw_UplinkSchedule(SIM_NEVER);
+
+    HAL_NVIC_SetPriority(USART6_IRQn, IRQ_PRIO_UPLINK_UART, 0U);
+    HAL_NVIC_EnableIRQ(USART6_IRQn);
+}
+
+void UplinkHw_PowerOn(void)
+{
+    if (s_powered)
+    {
+        return;
+    }
+
+    PeriphPower_Acquire(PERIPH_POWER_GPIOC);
+    PeriphPower_Acquire(PERIPH_POWER_DMA2);
+    PeriphPower_Acquire(PERIPH_POWER_USART6);
+    s_powered = true;
+    s_onAt_ns = SimCore_NowNs();
+}
+
+void UplinkHw_PowerOff(void)
+{
+    if (!s_powered)
+    {
+        return;
+    }
+
+    s_sending    = false;
+    s_txEnd_ns   = SIM_NEVER;
+    s_replyLen   = 0U;
+    s_replyAt_ns = SIM_NEVER;
+    SimUplink_Schedule();
+
+    PeriphPower_Release(PERIPH_POWER_USART6);
+    PeriphPower_Release(PERIPH_POWER_DMA2);
+    PeriphPower_Release(PERIPH_POWER_GPIOC);
+    s_powered = false;
+}
+
+bool UplinkHw_Send(const uint8_t *data, size_t len)
+{
+    if (!s_powered || s_sending || (data == NULL) || (len == 0U) || (len > 0xFFFFU))
+    {
+        return false;
+    }
+
+    s_sending  = true;
+    s_txData   = data;
+    s_txLen    = len;
+    s_txEnd_ns = SimCore_NowNs() + (((uint64_t)len * 10U * 1000000000ULL) / UPLINK_BAUD);
+    SimUplink_Schedule();
+    return true;
+}
+
+bool UplinkHw_IsSending(void)
+{
+    return s_sending;
+}
+
+void UplinkHw_OnClockChange(void)
+{
+}
+
+void UplinkHw_UartIrqHandler(void)
+{
+    uint64_t now = SimCore_NowNs();
+
+    if (s_sending && (now >= s_txEnd_ns))
+    {
+        s_sending  = false;
+        s_txEnd_ns = SIM_NEVER;
+        SimUplink_Receive(s_txData, s_txLen);
+        Uplink_OnHwTxDone();
+    }
+
+    if ((s_replyLen != 0U) && (now >= s_replyAt_ns))
+    {
+        size_t len = s_replyLen;
+        s_replyLen   = 0U;
+        s_replyAt_ns = SIM_NEVER;
+        Uplink_OnHwRx(s_reply, len);
+    }
+
+    SimUplink_Schedule();
+}
+
+void UplinkHw_DmaTxIrqHandler(void)
+{
+}
+
+void UplinkHw_DmaRxIrqHandler(void)
+{
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void SimUplink_Receive(const uint8_t *data, size_t len)
+{
+    /* Still joining the network: the modem drops what it gets. */
+    if (SimCore_NowNs() < (s_onAt_ns + SIM_UPLINK_ATTACH_NS))
+    {
+        return;
+    }
+
+    size_t start = 0U;
+
+    for (size_t i = 0U; i <= len; ++i)
+    {
+        if ((i < len) && (data[i] != 0x00U))
+        {
+            continue;
+        }
+
+        if ((i > start) && ((i - start) <= (SIM_UPLINK_FRAME_MAX + 2U)))
+        {
+            size_t frame = Cobs_Decode(&data[start], i - start, s_frame, sizeof(s_frame));
+            if ((frame > (SIM_UPLINK_HEADER + 4U)) &&
+                (Crc32_Compute(s_frame, frame - 4U) == SimUplink_GetU32(&s_frame[frame - 4U])))
+            {
+                SimUplink_OnFrame(frame - 4U);
+            }
+        }
+        start = i + 1U;
+    }
+}
+
+static void SimUplink_OnFrame(size_t len)
+{
+    uint32_t seq = SimUplink_GetU32(&s_frame[1]);
+
+    if ((s_frame[0] == UPLINK_FRAME_HELLO) && (len == (SIM_UPLINK_HEADER + 4U)))
+    {
+        uint32_t next = SimUplink_GetU32(&s_frame[SIM_UPLINK_HEADER]);
+
+        /* Outside the range the hub holds: it was reset, resume at its start. */
+        if ((uint32_t)(s_expected - seq) > (uint32_t)(next - seq))
+        {
+            s_expected = seq;
+        }
+        SimUplink_Ack(SimCore_NowNs());
+    }
+    else if (s_frame[0] == UPLINK_FRAME_BATCH)
+    {
+        s_batches++;
+        if ((s_loss != 0U) && ((s_batches % s_loss) == 0U))
+        {
+            return;
+        }
+
+        if (seq == s_expected)
+        {
+            s_expected++;
+        }
+        SimUplink_Ack(SimCore_NowNs() + SIM_UPLINK_ACK_NS);
+    }
+}
+
+static void SimUplink_Ack(uint64_t at_ns)
+{
+    uint8_t raw[SIM_UPLINK_HEADER + 4U];
+
+    raw[0] = UPLINK_FRAME_ACK;
+    for (uint32_t i = 0U; i < 4U; ++i)
+    {
+        raw[1U + i] = (uint8_t)(s_expected >> (8U * i));
+    }
+    uint32_t crc = Crc32_Compute(raw, SIM_UPLINK_HEADER);
+    for (uint32_t i = 0U; i < 4U; ++i)
+    {
+        raw[SIM_UPLINK_HEADER + i] = (uint8_t)(crc >> (8U * i));
+    }
+
+    size_t len = Cobs_Encode(raw, sizeof(raw), &s_reply[1]);
+    s_reply[0]        = 0x00U;
+    s_reply[len + 1U] = 0x00U;
+
+    if ((s_replyLen == 0U) || (at_ns < s_replyAt_ns))
+    {
+        s_replyAt_ns = at_ns;
+    }
+    s_replyLen = len + 2U;
+    SimUplink_Schedule();
+}
+
+static void SimUplink_Schedule(void)
+{
+    uint64_t at = s_sending ? s_txEnd_ns : SIM_NEVER;
+
+    if ((s_replyLen != 0U) && (s_replyAt_ns < at))
+    {
+        at = s_replyAt_ns;
+    }
+    SimHw_UplinkSchedule(at);
+}
+
+static uint32_t SimUplink_GetU32(const uint8_t *src)
+{
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) |
+           ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
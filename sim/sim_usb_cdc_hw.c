@@ -0,0 +1,563 @@
+/**
+ * @file sim_usb_cdc_hw.c
+ * @brief USB CDC port for the host simulation, with a simulated USB host.
+ *
+ * Replaces common/usb_cdc_hw.c, which moves packets through OTG FS FIFOs.
+ * Transfers here complete whole, at bus speed: a bulk IN transfer takes
+ * its length at @ref SIM_USB_BULK_BYTES_PER_S, a control stage or an OUT
+ * packet one frame. Each completion is scheduled as an OTG FS interrupt,
+ * and the handler calls the same UsbCdc_OnHw*() callbacks as the board
+ * port, so usb_cdc.c and the USB path of the TX ring run unmodified.
+ *
+ * With -u a host is attached: after the device connects it resets the
+ * bus and enumerates the device with the requests a desktop host sends
+ * (descriptors, address, configuration, line coding), then opens the port
+ * (DTR). Bulk IN data goes to stdout; stdin is sent as bulk OUT packets,
+ * one per frame. Without -u the bus stays idle and the console is the
+ * UART.
+ *
+ * @ingroup sim
+ */
+
+#include "usb_cdc_hw.h"
+#include "usb_cdc.h"
+#include "periph_power.h"
+#include "app_config.h"
+#include "sim.h"
+#include "irq_plan.h"
+#include <stdio.h>
+#include <string.h>
+
+/** @brief Bulk IN rate of a full-speed bus (19 packets per frame). */
+#define SIM_USB_BULK_BYTES_PER_S  (1216000ULL)
+
+/** @brief Frame time. */
+#define SIM_USB_FRAME_NS          (SIM_NS_PER_MS)
+
+/** @brief Connect debounce before the host resets the bus. */
+#define SIM_USB_ATTACH_NS         (100U * SIM_NS_PER_MS)
+
+/** @brief Host input buffered ahead of the OUT endpoint (bytes). */
+#define SIM_USB_RX_QUEUE_SIZE     (4096U)
+
+/** @brief Address the host assigns. */
+#define SIM_USB_ADDRESS           (7U)
+
+/**
+ * @brief Stage of the host's control transfer.
+ */
+typedef enum
+{
+    SIM_USB_CTRL_RESET = 0U,   /**< Bus reset due.                       */
+    SIM_USB_CTRL_SETUP,        /**< Next request due.                    */
+    SIM_USB_CTRL_DATA_IN,      /**< Waiting for the device's data.       */
+    SIM_USB_CTRL_DATA_OUT,     /**< Sending data once the device is armed. */
+    SIM_USB_CTRL_STATUS_OUT,   /**< Sending the zero-length status.      */
+    SIM_USB_CTRL_STATUS_IN,    /**< Waiting for the zero-length status.  */
+    SIM_USB_CTRL_IDLE          /**< Enumeration finished.                */
+} SimUsbCtrl_t;
+
+/**
+ * @brief One control request of the enumeration script.
+ */
+typedef struct
+{
+    uint8_t        setup[8];  /**< SETUP packet.                  */
+    const uint8_t *data;      /**< Data OUT stage, or NULL.       */
+} SimUsbRequest_t;
+
+/** @brief SET_LINE_CODING data: 115200 baud, 8N1. */
+static const uint8_t s_lineCoding[7] = { 0x00U, 0xC2U, 0x01U, 0x00U, 0U, 0U, 8U };
+
+/** @brief What a desktop host sends after the bus reset. */
+static const SimUsbRequest_t s_script[] =
+{
+    { { 0x80U, 0x06U, 0x00U, 0x01U, 0x00U, 0x00U, 64U, 0x00U }, NULL },  /* device, 64 */
+    { { 0x00U, 0x05U, SIM_USB_ADDRESS, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U }, NULL },
+    { { 0x80U, 0x06U, 0x00U, 0x01U, 0x00U, 0x00U, 18U, 0x00U }, NULL },  /* device    */
+    { { 0x80U, 0x06U, 0x00U, 0x06U, 0x00U, 0x00U, 10U, 0x00U }, NULL },  /* qualifier */
+    { { 0x80U, 0x06U, 0x00U, 0x02U, 0x00U, 0x00U, 9U, 0x00U }, NULL },   /* config, 9 */
+    { { 0x80U, 0x06U, 0x00U, 0x02U, 0x00U, 0x00U, 0xFFU, 0x00U }, NULL },
+    { { 0x80U, 0x06U, 0x00U, 0x03U, 0x00U, 0x00U, 0xFFU, 0x00U }, NULL }, /* languages */
+    { { 0x80U, 0x06U, 0x02U, 0x03U, 0x09U, 0x04U, 0xFFU, 0x00U }, NULL }, /* product  */
+    { { 0x80U, 0x06U, 0x03U, 0x03U, 0x09U, 0x04U, 0xFFU, 0x00U }, NULL }, /* serial   */
+    { { 0x00U, 0x09U, 0x01U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U }, NULL },
+    { { 0x21U, 0x20U, 0x00U, 0x00U, 0x00U, 0x00U, 7U, 0x00U }, s_lineCoding },
+    { { 0x21U, 0x22U, 0x03U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U }, NULL }, /* DTR, RTS */
+};
+
+/** @brief Number of requests in @ref s_script. */
+#define SIM_USB_SCRIPT_LENGTH     (sizeof(s_script) / sizeof(s_script[0]))
+
+/** @brief A host is attached (-u). */
+static bool s_hostAttached = false;
+
+/** @brief Device connected (D+ pull-up on). */
+static bool s_connected = false;
+
+/** @brief Control transfer stage. */
+static SimUsbCtrl_t s_ctrl = SIM_USB_CTRL_RESET;
+
+/** @brief Request of the script in progress. */
+static uint32_t s_request = 0U;
+
+/** @brief Time the next control stage is due. */
+static uint64_t s_ctrlDue = SIM_NEVER;
+
+/** @brief Transfer queued on EP0 IN. */
+static bool s_ep0InPending = false;
+
+/** @brief EP0 OUT armed: buffer and size. */
+static bool     s_ep0OutArmed = false;
+static uint8_t *s_ep0OutBuffer = NULL;
+static uint32_t s_ep0OutSize = 0U;
+
+/** @brief Bulk IN transfer in progress and when the host has taken it. */
+static const uint8_t *s_inData = NULL;
+static uint32_t       s_inLen = 0U;
+static uint64_t       s_inDue = SIM_NEVER;
+
+/** @brief Bulk OUT endpoint armed: buffer and size. */
+static uint8_t  *s_outBuffer = NULL;
+static uint32_t  s_outSize = 0U;
+
+/** @brief Time the next OUT packet may go. */
+static uint64_t s_outDue = SIM_NEVER;
+
+/** @brief Next start of frame while frames are enabled. */
+static uint64_t s_frameDue = SIM_NEVER;
+
+/** @brief Host input not yet sent. */
+static uint8_t  s_rxQueue[SIM_USB_RX_QUEUE_SIZE];
+static uint32_t s_rxQueueHead = 0U;
+static uint32_t s_rxQueueTail = 0U;
+
+/** @brief Earliest time the queued input may go, and when the last went. */
+static uint64_t s_rxAt_ns = 0U;
+static uint64_t s_rxLast_ns = 0U;
+
+/** @brief Counters. */
+static SimUsbStats_t s_stats;
+
+/**
+ * @brief Run the control stage that is due.
+ */
+static void SimUsb_ControlStep(void);
+
+/**
+ * @brief Send the next OUT packet if the endpoint is armed and input waits.
+ */
+static void SimUsb_SendOut(void);
+
+/**
+ * @brief A control request ended; the next one goes a frame later.
+ */
+static void SimUsb_NextRequest(void);
+
+/**
+ * @brief Schedule the OTG FS interrupt at the earliest pending host event.
+ */
+static void SimUsb_Reschedule(void);
+
+/* ------------------------------------------------------------------------- */
+
+void SimUsb_Init(const SimOptions_t *opt)
+{
+    s_hostAttached = opt->usbHost;
+    s_connected    = false;
+    s_ctrl         = SIM_USB_CTRL_RESET;
+    s_ctrlDue      = SIM_NEVER;
+    s_inDue        = SIM_NEVER;
+    s_outDue       = SIM_NEVER;
+    s_frameDue     = SIM_NEVER;
+    s_rxQueueHead  = 0U;
+    s_rxQueueTail  = 0U;
+    (void)memset(&s_stats, 0, sizeof(s_stats));
+}
+
+size_t SimUsb_Inject(const uint8_t *data, size_t len, uint64_t at_ns)
+{
+    size_t queued = 0U;
+
+    if (s_rxQueueHead == s_rxQueueTail)
+    {
+        s_rxAt_ns = at_ns;
+    }
+
+    while ((queued < len) && ((s_rxQueueHead - s_rxQueueTail) < SIM_USB_RX_QUEUE_SIZE))
+    {
+        s_rxQueue[s_rxQueueHead % SIM_USB_RX_QUEUE_SIZE] = data[queued];
+        s_rxQueueHead++;
+        queued++;
+    }
+
+    if ((queued > 0U) && (s_outBuffer != NULL) && (s_outDue == SIM_NEVER))
+    {
+        uint64_t now = SimCore_NowNs();
+        s_outDue = ((s_rxAt_ns > now) ? s_rxAt_ns : now) + SIM_USB_FRAME_NS;
+        SimUsb_Reschedule();
+    }
+
+    return queued;
+}
+
+size_t SimUsb_InjectSpace(void)
+{
+    return SIM_USB_RX_QUEUE_SIZE - (s_rxQueueHead - s_rxQueueTail);
+}
+
+uint64_t SimUsb_LastRxNs(void)
+{
+    uint32_t queued = s_rxQueueHead - s_rxQueueTail;
+
+    if (queued == 0U)
+    {
+        return s_rxLast_ns;
+    }
+
+    /* Not enumerated yet: at least a second to go. */
+    uint64_t first   = (s_outDue != SIM_NEVER) ? s_outDue : (SimCore_NowNs() + SIM_NS_PER_MS * 1000U);
+    uint64_t packets = (queued + USB_CDC_PACKET_SIZE - 1U) / USB_CDC_PACKET_SIZE;
+
+    return first + ((packets - 1U) * SIM_USB_FRAME_NS);
+}
+
+void SimUsb_GetStats(SimUsbStats_t *stats)
+{
+    *stats = s_stats;
+}
+
+bool UsbCdcHw_Init(void)
+{
+    /* As on the board: PLLSAI shares the PLL source with the main PLL. */
+    if (((RCC->CR & RCC_CR_PLLON) != 0U) && ((RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) == RCC_PLLCFGR_PLLSRC_HSI))
+    {
+        return false;
+    }
+
+    RCC->CR         |= RCC_CR_HSEBYP | RCC_CR_HSEON | RCC_CR_HSERDY;
+    RCC->PLLCFGR    |= RCC_PLLCFGR_PLLSRC_HSE;
+    RCC->CR         |= RCC_CR_PLLSAION | RCC_CR_PLLSAIRDY;
+    RCC->DCKCFGR2   |= RCC_DCKCFGR2_CK48MSEL;
+
+    PeriphPower_Acquire(PERIPH_POWER_GPIOA);
+    PeriphPower_Acquire(PERIPH_POWER_OTGFS);
+
+    HAL_NVIC_SetPriority(OTG_FS_IRQn, IRQ_PRIO_USB, 0U);
+    HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+
+    s_connected = true;
+    if (s_hostAttached)
+    {
+        s_ctrl    = SIM_USB_CTRL_RESET;
+        s_ctrlDue = SimCore_NowNs() + SIM_USB_ATTACH_NS;
+        SimUsb_Reschedule();
+    }
+
+    return true;
+}
+
+void UsbCdcHw_SetAddress(uint8_t address)
+{
+    (void)address;
+}
+
+void UsbCdcHw_OpenEndpoint(uint8_t ep, uint8_t type, uint16_t maxPacket)
+{
+    (void)ep;
+    (void)type;
+    (void)maxPacket;
+}
+
+void UsbCdcHw_CloseEndpoint(uint8_t ep)
+{
+    if (ep == USB_CDC_EP_DATA_IN)
+    {
+        UsbCdcHw_AbortTransmit(ep);
+    }
+    else if (ep == USB_CDC_EP_DATA_OUT)
+    {
+        s_outBuffer = NULL;
+        s_outDue    = SIM_NEVER;
+    }
+}
+
+void UsbCdcHw_Transmit(uint8_t ep, const uint8_t *data, uint32_t len)
+{
+    if (ep == USB_CDC_HW_EP_IN)
+    {
+        s_ep0InPending = true;
+        return;
+    }
+
+    if (ep == USB_CDC_EP_DATA_IN)
+    {
+        uint64_t ns = ((uint64_t)len * 1000000000ULL) / SIM_USB_BULK_BYTES_PER_S;
+
+        s_inData = data;
+        s_inLen  = len;
+        s_inDue  = SimCore_NowNs() + ((ns != 0U) ? ns : 1U);
+        SimUsb_Reschedule();
+    }
+}
+
+void UsbCdcHw_AbortTransmit(uint8_t ep)
+{
+    if (ep == USB_CDC_EP_DATA_IN)
+    {
+        s_inData = NULL;
+        s_inDue  = SIM_NEVER;
+    }
+}
+
+void UsbCdcHw_Receive(uint8_t ep, uint8_t *buffer, uint32_t len)
+{
+    if (ep == 0x00U)
+    {
+        s_ep0OutArmed  = true;
+        s_ep0OutBuffer = buffer;
+        s_ep0OutSize   = len;
+        return;
+    }
+
+    if (ep == USB_CDC_EP_DATA_OUT)
+    {
+        s_outBuffer = buffer;
+        s_outSize   = len;
+        if ((s_rxQueueHead != s_rxQueueTail) && (s_outDue == SIM_NEVER))
+        {
+            s_outDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            SimUsb_Reschedule();
+        }
+    }
+}
+
+void UsbCdcHw_Stall(uint8_t ep)
+{
+    /* usb_cdc.c stalls both directions of EP0 for one request. */
+    if ((ep == 0x00U) && (s_ctrl >= SIM_USB_CTRL_DATA_IN) && (s_ctrl <= SIM_USB_CTRL_STATUS_IN))
+    {
+        s_stats.stalls++;
+        SimUsb_NextRequest();
+    }
+}
+
+void UsbCdcHw_ClearStall(uint8_t ep)
+{
+    (void)ep;
+}
+
+void UsbCdcHw_EnableFrames(bool enable)
+{
+    s_frameDue = enable ? (SimCore_NowNs() + SIM_USB_FRAME_NS) : SIM_NEVER;
+    SimUsb_Reschedule();
+}
+
+void UsbCdcHw_OnClockChange(void)
+{
+}
+
+void UsbCdcHw_IrqHandler(void)
+{
+    uint64_t now = SimCore_NowNs();
+
+    if (s_ctrlDue <= now)
+    {
+        s_ctrlDue = SIM_NEVER;
+        SimUsb_ControlStep();
+    }
+
+    if (s_outDue <= now)
+    {
+        s_outDue = SIM_NEVER;
+        SimUsb_SendOut();
+    }
+
+    if (s_inDue <= now)
+    {
+        s_inDue = SIM_NEVER;
+        if (s_inData != NULL)
+        {
+            SimHost_Output(s_inData, s_inLen);
+        }
+        s_stats.txBytes += s_inLen;
+        s_inData = NULL;
+        UsbCdc_OnHwIn(USB_CDC_EP_DATA_IN);
+    }
+
+    if (s_frameDue <= now)
+    {
+        s_frameDue = now + SIM_USB_FRAME_NS;
+        UsbCdc_OnHwFrame();
+    }
+
+    SimUsb_Reschedule();
+}
+
+/* ------------------------------------------------------------------------- */
+/*                          Internal Helper Functions                        */
+/* ------------------------------------------------------------------------- */
+
+static void SimUsb_ControlStep(void)
+{
+    const SimUsbRequest_t *req = &s_script[s_request];
+
+    switch (s_ctrl)
+    {
+        case SIM_USB_CTRL_RESET:
+            s_request      = 0U;
+            s_ep0InPending = false;
+            s_ep0OutArmed  = false;
+            s_outBuffer    = NULL;
+            s_ctrl         = SIM_USB_CTRL_SETUP;
+            s_ctrlDue      = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            UsbCdc_OnHwReset();
+            break;
+
+        case SIM_USB_CTRL_SETUP:
+        {
+            uint16_t length = (uint16_t)(req->setup[6] | ((uint16_t)req->setup[7] << 8));
+
+            s_ep0InPending = false;
+            s_ep0OutArmed  = false;
+            s_stats.controls++;
+            if (length == 0U)
+            {
+                s_ctrl = SIM_USB_CTRL_STATUS_IN;
+            }
+            else
+            {
+                s_ctrl = ((req->setup[0] & 0x80U) != 0U) ? SIM_USB_CTRL_DATA_IN : SIM_USB_CTRL_DATA_OUT;
+            }
+            s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            UsbCdc_OnHwSetup(req->setup);
+            break;
+        }
+
+        case SIM_USB_CTRL_DATA_IN:
+            s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            if (s_ep0InPending)
+            {
+                s_ep0InPending = false;
+                s_ctrl         = SIM_USB_CTRL_STATUS_OUT;
+                UsbCdc_OnHwIn(USB_CDC_HW_EP_IN);
+            }
+            break;
+
+        case SIM_USB_CTRL_DATA_OUT:
+            s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            if (s_ep0OutArmed)
+            {
+                uint32_t len = req->setup[6];
+
+                if (len > s_ep0OutSize)
+                {
+                    len = s_ep0OutSize;
+                }
+                if ((s_ep0OutBuffer != NULL) && (req->data != NULL))
+                {
+                    (void)memcpy(s_ep0OutBuffer, req->data, len);
+                }
+                s_ep0OutArmed = false;
+                s_ctrl        = SIM_USB_CTRL_STATUS_IN;
+                UsbCdc_OnHwOut(0x00U, len);
+            }
+            break;
+
+        case SIM_USB_CTRL_STATUS_OUT:
+            s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            if (s_ep0InPending)
+            {
+                /* Closing zero-length packet of the data stage. */
+                s_ep0InPending = false;
+                UsbCdc_OnHwIn(USB_CDC_HW_EP_IN);
+            }
+            else if (s_ep0OutArmed)
+            {
+                s_ep0OutArmed = false;
+                SimUsb_NextRequest();
+                UsbCdc_OnHwOut(0x00U, 0U);
+            }
+            break;
+
+        case SIM_USB_CTRL_STATUS_IN:
+            s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+            if (s_ep0InPending)
+            {
+                s_ep0InPending = false;
+                SimUsb_NextRequest();
+                UsbCdc_OnHwIn(USB_CDC_HW_EP_IN);
+            }
+            break;
+
+        case SIM_USB_CTRL_IDLE:
+        default:
+            break;
+    }
+}
+
+static void SimUsb_SendOut(void)
+{
+    uint32_t queued = s_rxQueueHead - s_rxQueueTail;
+
+    if ((s_outBuffer == NULL) || (queued == 0U))
+    {
+        return;
+    }
+
+    uint32_t len = (queued < s_outSize) ? queued : s_outSize;
+    uint8_t *buffer = s_outBuffer;
+
+    for (uint32_t i = 0U; i < len; ++i)
+    {
+        buffer[i] = s_rxQueue[s_rxQueueTail % SIM_USB_RX_QUEUE_SIZE];
+        s_rxQueueTail++;
+    }
+    s_stats.rxBytes += len;
+    s_rxLast_ns      = SimCore_NowNs();
+
+    /* The device re-arms from the callback, which schedules the next
+     * packet a frame on.
+     */
+    s_outBuffer = NULL;
+    UsbCdc_OnHwOut(USB_CDC_EP_DATA_OUT, len);
+}
+
+static void SimUsb_NextRequest(void)
+{
+    s_request++;
+    if (s_request < SIM_USB_SCRIPT_LENGTH)
+    {
+        s_ctrl    = SIM_USB_CTRL_SETUP;
+        s_ctrlDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+        return;
+    }
+
+    /* Port open: input waiting since before enumeration may go now. */
+    s_ctrl    = SIM_USB_CTRL_IDLE;
+    s_ctrlDue = SIM_NEVER;
+    if ((s_outBuffer != NULL) && (s_rxQueueHead != s_rxQueueTail) && (s_outDue == SIM_NEVER))
+    {
+        s_outDue = SimCore_NowNs() + SIM_USB_FRAME_NS;
+    }
+}
+
+static void SimUsb_Reschedule(void)
+{
+    uint64_t next = s_ctrlDue;
+
+    if (s_outDue < next)
+    {
+        next = s_outDue;
+    }
+    if (s_inDue < next)
+    {
+        next = s_inDue;
+    }
+    if (s_frameDue < next)
+    {
+        next = s_frameDue;
+    }
+
+    SimHw_UsbSchedule(s_connected ? next : SIM_NEVER);
+}
@@ -0,0 +1,49 @@
+/**
+ * @file sim_watchdog_hw.c
+ * @brief Independent watchdog for the host simulation.
+ *
+ * Replaces common/watchdog_hw.c, whose key and status registers only
+ * hardware acts on. The counter is an event slot in virtual time, so it
+ * runs on through simulated STOP as on the F446; when it expires the run
+ * ends like a system reset. The model's LSI is exactly nominal.
+ *
+ * @ingroup sim
+ */
+
+#include "watchdog_hw.h"
+#include "sim.h"
+
+/** @brief Programmed timeout; 0 until started. */
+static uint64_t s_timeout_ns = 0U;
+
+/* ------------------------------------------------------------------------- */
+
+uint32_t WatchdogHw_Start(uint32_t timeout_ms)
+{
+    if (timeout_ms > WATCHDOG_HW_MAX_TIMEOUT_MS)
+    {
+        timeout_ms = WATCHDOG_HW_MAX_TIMEOUT_MS;
+    }
+    if (timeout_ms == 0U)
+    {
+        timeout_ms = 1U;
+    }
+
+    s_timeout_ns = (uint64_t)timeout_ms * SIM_NS_PER_MS;
+    SimHw_WatchdogReload(s_timeout_ns);
+
+    return timeout_ms;
+}
+
+void WatchdogHw_Refresh(void)
+{
+    if (s_timeout_ns != 0U)
+    {
+        SimHw_WatchdogReload(s_timeout_ns);
+    }
+}
+
+bool WatchdogHw_IsRunning(void)
+{
+    return (s_timeout_ns != 0U);
+}
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Compare two Smart Sensor Hub benchmark captures.
+
+A firmware built with APP_BENCH_ENABLE=1 (or `make -C sim bench`) prints:
+
+    #bench,v1,clock_hz=180000000,iterations=64,backend=heap,log=text,ramfunc=1,lock=2
+    bench,<case>,<iterations>,<min>,<avg>,<max>
+    ...
+    #bench,end
+
+Any other console output in the capture is ignored. Times are converted to
+nanoseconds with each capture's clock_hz, so captures taken at different
+core clocks can be compared.
+
+Usage:
+    bench_compare.py baseline.txt current.txt
+    bench_compare.py baseline.txt current.txt --metric avg --threshold 5
+
+Exits with status 1 if any case got slower by more than the threshold.
+"""
+
+import argparse
+import sys
+
+METRICS = ("min", "avg", "max")
+
+
+def load(path):
+    """Return (header dict, {case: {metric: ns}}) for one capture."""
+    header = {}
+    cases = {}
+
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for raw in f:
+            line = raw.strip()
+            if line.startswith("#bench,v"):
+                for field in line.split(",")[2:]:
+                    key, _, value = field.partition("=")
+                    header[key] = value
+            elif line.startswith("bench,"):
+                parts = line.split(",")
+                if len(parts) != 6:
+                    continue
+                try:
+                    values = [int(v) for v in parts[3:]]
+                except ValueError:
+                    continue
+                cases[parts[1]] = dict(zip(METRICS, values))
+
+    if "clock_hz" not in header:
+        raise ValueError("%s: no '#bench,v1,...' header found" % path)
+
+    scale = 1e9 / float(header["clock_hz"])
+    for case in cases.values():
+        for metric in METRICS:
+            case[metric] *= scale
+
+    return header, cases
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline", help="capture of the reference build")
+    parser.add_argument("current", help="capture of the build under test")
+    parser.add_argument("--metric", choices=METRICS, default="min",
+                        help="statistic to compare (default: min)")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="regression threshold in percent (default: 10)")
+    args = parser.parse_args()
+
+    try:
+        base_hdr, base = load(args.baseline)
+        cur_hdr, cur = load(args.current)
+    except (OSError, ValueError) as err:
+        print("bench_compare: %s" % err, file=sys.stderr)
+        return 2
+
+    for key in sorted(set(base_hdr) | set(cur_hdr)):
+        if base_hdr.get(key) != cur_hdr.get(key):
+            print("note: %s differs (%s -> %s)" % (key, base_hdr.get(key), cur_hdr.get(key)))
+
+    regressions = 0
+    print("%-24s %12s %12s %8s" % ("case", "base ns", "current ns", "change"))
+    for name in sorted(set(base) | set(cur)):
+        if name not in base or name not in cur:
+            print("%-24s %12s %12s %8s" % (name,
+                                           "-" if name not in base else "%.0f" % base[name][args.metric],
+                                           "-" if name not in cur else "%.0f" % cur[name][args.metric],
+                                           "new" if name not in base else "gone"))
+            continue
+
+        old = base[name][args.metric]
+        new = cur[name][args.metric]
+        change = ((new - old) * 100.0 / old) if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-24s %12.0f %12.0f %+7.1f%%%s" % (name, old, new, change, flag))
+
+    if regressions:
+        print("%d case(s) slower by more than %.1f%% (%s)" % (regressions, args.threshold, args.metric))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,145 @@
+#!/usr/bin/env bash
+#
+# Build the Smart Sensor Hub firmware image with arm-none-eabi-gcc.
+#
+# Usage:
+#   tools/build_firmware.sh [Debug|Release|MinSize] [--no-lto]
+#
+# Configurations:
+#   Debug    -O0 -g3, DEBUG defined (debugger stays attached in STOP), no LTO
+#   Release  -O2, LTO, DEBUG-level log call sites compiled out
+#   MinSize  -Os, LTO, DEBUG-level log call sites compiled out
+#
+# Every configuration compiles with -ffunction-sections -fdata-sections and
+# links with --gc-sections. --no-lto keeps the optimization level but links
+# the plain objects, which is what tools/size_report.py needs to attribute
+# code to modules (with LTO the map file only knows the ltrans partitions).
+#
+# Output goes to build/<config>[-nolto][-slotb]/: smart_sensor_hub.{elf,bin,map}
+# and the bootloader, hub_boot.{elf,bin} (boot/boot_main.c, sector 0). The
+# image is linked for slot A; FW_SLOT=B links it for slot B, as `fw begin`
+# wants it while slot A runs (common/fw_update.h, tools/fw_send.py).
+# Extra compiler flags can be passed in EXTRA_CFLAGS, and LOCK_STRATEGY=<n>
+# selects another newlib lock strategy (Core/ThreadSafe/stm32_lock.h).
+#
+# FREERTOS_DIR=<FreeRTOS-Kernel checkout> builds the RTOS scheduler backend
+# (APP_SCHEDULER_BACKEND=2) against that kernel with the newlib lock
+# strategy for FreeRTOS. The kernel is compiled without LTO so the port's
+# handlers, reached only from inline assembly, survive the link.
+
+set -euo pipefail
+
+CONFIG="${1:-Debug}"
+LTO=1
+if [ "${2:-}" = "--no-lto" ]; then
+    LTO=0
+fi
+
+case "$CONFIG" in
+    Debug)   OPT="-O0 -g3"; DEFS="-DDEBUG"; LTO=0 ;;
+    Release) OPT="-O2 -g";  DEFS="-DLOG_COMPILE_LEVEL=1" ;;
+    MinSize) OPT="-Os -g";  DEFS="-DLOG_COMPILE_LEVEL=1" ;;
+    *)
+        echo "usage: $0 [Debug|Release|MinSize] [--no-lto]" >&2
+        exit 2
+        ;;
+esac
+
+cd "$(dirname "$0")/.."
+
+CC="${CROSS_COMPILE:-arm-none-eabi-}gcc"
+OBJCOPY="${CROSS_COMPILE:-arm-none-eabi-}objcopy"
+SIZE="${CROSS_COMPILE:-arm-none-eabi-}size"
+
+OUT="build/$CONFIG"
+LTO_FLAGS=""
+if [ "$LTO" -eq 1 ]; then
+    LTO_FLAGS="-flto"
+elif [ "$CONFIG" != "Debug" ]; then
+    OUT="$OUT-nolto"
+fi
+
+ARCH="-mcpu=cortex-m4 -mthumb -mfpu=fpv4-sp-d16 -mfloat-abi=hard"
+
+SLOT_LDFLAGS=""
+case "${FW_SLOT:-A}" in
+    A) ;;
+    B) SLOT_LDFLAGS="-Wl,--defsym,FW_SLOT_B=1"; OUT="$OUT-slotb" ;;
+    *)
+        echo "FW_SLOT must be A or B" >&2
+        exit 2
+        ;;
+esac
+
+LOCKS="-DSTM32_THREAD_SAFE_STRATEGY=${LOCK_STRATEGY:-2}"
+if [ -n "${FREERTOS_DIR:-}" ]; then
+    LOCKS="-DSTM32_THREAD_SAFE_STRATEGY=4 -DAPP_SCHEDULER_BACKEND=2"
+fi
+
+CFLAGS="$ARCH -std=gnu11 $OPT $LTO_FLAGS -ffunction-sections -fdata-sections -Wall \
+-DUSE_HAL_DRIVER -DSTM32F446xx $LOCKS $DEFS ${EXTRA_CFLAGS:-}"
+
+INCLUDES="-ICore/Inc -ICore/ThreadSafe \
+-IDrivers/STM32F4xx_HAL_Driver/Inc \
+-IDrivers/STM32F4xx_HAL_Driver/Inc/Legacy \
+-IDrivers/CMSIS/Device/ST/STM32F4xx/Include \
+-IDrivers/CMSIS/Include \
+-Iapp -Icommon -Isensors -Ipower"
+
+if [ -n "${FREERTOS_DIR:-}" ]; then
+    INCLUDES="$INCLUDES -I$FREERTOS_DIR/include -I$FREERTOS_DIR/portable/GCC/ARM_CM4F"
+fi
+
+SRC_DIRS="Core/Src Core/ThreadSafe Drivers/STM32F4xx_HAL_Driver/Src app common sensors power"
+
+rm -rf "$OUT"
+mkdir -p "$OUT"
+
+OBJS=""
+for DIR in $SRC_DIRS; do
+    [ -d "$DIR" ] || continue
+    for SRC in $(find "$DIR" -maxdepth 1 -name '*.c' | sort); do
+        OBJ="$OUT/${SRC%.c}.o"
+        mkdir -p "$(dirname "$OBJ")"
+        echo "CC  $SRC"
+        $CC $CFLAGS $INCLUDES -c "$SRC" -o "$OBJ"
+        OBJS="$OBJS $OBJ"
+    done
+done
+
+if [ -n "${FREERTOS_DIR:-}" ]; then
+    for SRC in tasks.c list.c queue.c portable/GCC/ARM_CM4F/port.c; do
+        OBJ="$OUT/FreeRTOS/${SRC%.c}.o"
+        mkdir -p "$(dirname "$OBJ")"
+        echo "CC  $FREERTOS_DIR/$SRC"
+        $CC ${CFLAGS/$LTO_FLAGS/} $INCLUDES -c "$FREERTOS_DIR/$SRC" -o "$OBJ"
+        OBJS="$OBJS $OBJ"
+    done
+fi
+
+STARTUP="Core/Startup/startup_stm32f446retx.s"
+STARTUP_OBJ="$OUT/${STARTUP%.s}.o"
+mkdir -p "$(dirname "$STARTUP_OBJ")"
+echo "AS  $STARTUP"
+$CC $ARCH -g -x assembler-with-cpp -c "$STARTUP" -o "$STARTUP_OBJ"
+OBJS="$OBJS $STARTUP_OBJ"
+
+ELF="$OUT/smart_sensor_hub.elf"
+echo "LD  $ELF"
+$CC $ARCH $OPT $LTO_FLAGS $OBJS -o "$ELF" \
+    -T STM32F446RETX_FLASH.ld $SLOT_LDFLAGS --specs=nosys.specs --specs=nano.specs \
+    -Wl,-Map="$OUT/smart_sensor_hub.map" -Wl,--gc-sections -static \
+    -Wl,--start-group -lc -lm -Wl,--end-group
+
+$OBJCOPY -O binary "$ELF" "$OUT/smart_sensor_hub.bin"
+$SIZE "$ELF"
+
+BOOT_ELF="$OUT/hub_boot.elf"
+echo "LD  $BOOT_ELF"
+$CC $ARCH -Os -g -std=gnu11 -ffunction-sections -Wall -DSTM32F446xx \
+    -IDrivers/CMSIS/Device/ST/STM32F4xx/Include -IDrivers/CMSIS/Include -Icommon \
+    boot/boot_main.c -o "$BOOT_ELF" -T STM32F446RETX_BOOT.ld -nostdlib \
+    -Wl,-Map="$OUT/hub_boot.map" -Wl,--gc-sections
+
+$OBJCOPY -O binary "$BOOT_ELF" "$OUT/hub_boot.bin"
+$SIZE "$BOOT_ELF"
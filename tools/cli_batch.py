@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Run a CLI script on the Smart Sensor Hub in one go.
+
+The script (one command per line; blank lines and lines starting with '#'
+are skipped) goes over the console, UART or USB CDC, behind a `batch`
+command and is closed with `end`. The hub runs the lines back to back
+without prompt or echo and answers with the failed lines and one summary:
+
+    cli_batch.py provisioning.txt /dev/ttyACM0
+    cli_batch.py provisioning.txt --sim
+
+    #batch,fail,line=<n>,<message>
+    #batch,done,commands=<n>,failed=<n>,lost=<bytes>,us=<time>
+
+The exit status is 0 only if every command succeeded and no input was lost
+(lost counts script bytes the hub's receive ring could not take). Serial
+ports need pyserial.
+"""
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from hil_run import Link  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SIM_PATH = os.path.join(ROOT, "sim", "build", "hub_sim")
+LINE_MAX = 63  # CLI_MAX_LINE_LENGTH - 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("script", help="text file with one command per line")
+    parser.add_argument("port", nargs="?", help="serial port of the board")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--sim", nargs="?", const=SIM_PATH, metavar="PATH",
+                        help="run the simulation instead of a board (default: %(const)s)")
+    args = parser.parse_args()
+
+    if (args.port is None) == (args.sim is None):
+        parser.error("give a serial port or --sim")
+
+    with open(args.script) as f:
+        lines = f.read().splitlines()
+    for number, line in enumerate(lines, 1):
+        if len(line) > LINE_MAX:
+            sys.exit("%s:%d: longer than %d characters" % (args.script, number, LINE_MAX))
+        if line.strip().lower() == "end":
+            sys.exit("%s:%d: 'end' would close the script early" % (args.script, number))
+
+    link = Link(args.port, args.baud, args.sim)
+    try:
+        link.drain()
+        link._write(("batch\r" + "".join(line + "\r" for line in lines) + "end\r").encode())
+
+        failures = 0
+        while True:
+            _, line = link.expect("#batch,", timeout=30.0)
+            kind, _, rest = line.strip()[len("#batch,"):].partition(",")
+            if kind == "fail":
+                where, _, message = rest.partition(",")
+                number = int(where.partition("=")[2])
+                print("%s:%d: %s: %s" % (args.script, number, lines[number - 1].strip(), message))
+                failures += 1
+                continue
+
+            fields = dict(f.partition("=")[::2] for f in rest.split(","))
+            print("%s: %s commands in %.1f ms, %s failed, %s bytes lost" %
+                  (kind, fields["commands"], int(fields["us"]) / 1000.0,
+                   fields["failed"], fields["lost"]))
+            ok = (kind == "done") and (fields["failed"] == "0") and (fields["lost"] == "0")
+            sys.exit(0 if ok else 1)
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    main()
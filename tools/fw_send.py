@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""Send a firmware image to the Smart Sensor Hub and start it.
+
+The image (a .bin from tools/build_firmware.sh, linked for the slot that is
+not running: FW_SLOT=B when slot A runs, and the other way round) goes over
+the console, UART or USB CDC, into the inactive slot while the hub keeps
+sampling (fw_update.h):
+
+    fw_send.py build/Release-slotb/smart_sensor_hub.bin /dev/ttyACM0
+    fw_send.py image.bin --sim --no-swap
+
+`fw begin` erases the slot; then every chunk goes as one COBS frame and is
+acknowledged with the offset the hub wants next, so a damaged or lost
+frame is simply sent again. After the hub has verified the CRC of the
+whole image, `fw swap` writes the slot header and resets into the new
+image, and the script waits for it to report the slot it runs from.
+Serial ports need pyserial.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from hil_run import Link  # noqa: E402
+from hub_ingest import cobs_encode  # noqa: E402
+from telemetry_decode import crc32_mpeg2  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SIM_PATH = os.path.join(ROOT, "sim", "build", "hub_sim")
+FRAME_CHUNK = 0x30
+FRAME_ABORT = 0x31
+IMAGE_MAX = 192 * 1024 - 0x200  # FW_UPDATE_IMAGE_MAX
+
+
+def frame(ftype, offset, data=b""):
+    """One transfer frame with its delimiters."""
+    body = struct.pack("<BI", ftype, offset) + data
+    return b"\x00" + cobs_encode(body + struct.pack("<I", crc32_mpeg2(body))) + b"\x00"
+
+
+def reply(line):
+    """(kind, {field: value}) of a #fw line."""
+    fields = line.strip().split(",")
+    return fields[1], dict(f.partition("=")[::2] for f in fields[2:])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("image", help="firmware .bin linked for the inactive slot")
+    parser.add_argument("port", nargs="?", help="serial port of the board")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--sim", nargs="?", const=SIM_PATH, metavar="PATH",
+                        help="run the simulation instead of a board (default: %(const)s)")
+    parser.add_argument("--no-swap", action="store_true",
+                        help="leave the verified image for a later `fw swap`")
+    args = parser.parse_args()
+
+    if (args.port is None) == (args.sim is None):
+        parser.error("give a serial port or --sim")
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    image += b"\xff" * (-len(image) % 4)
+    if not image or len(image) > IMAGE_MAX:
+        sys.exit("%s: %d bytes, the slot takes 4 to %d" % (args.image, len(image), IMAGE_MAX))
+    crc = crc32_mpeg2(image)
+
+    link = Link(args.port, args.baud, args.sim)
+    try:
+        _, line = link.command("fw begin %d 0x%08x" % (len(image), crc), "#fw,", timeout=30.0)
+        kind, fields = reply(line)
+        if kind != "ready":
+            sys.exit("hub refused the transfer: %s" % line.strip())
+        chunk = int(fields["chunk"])
+
+        started = time.perf_counter()
+        offset, resends = 0, 0
+        while True:
+            link.drain()
+            link._write(frame(FRAME_CHUNK, offset, image[offset:offset + chunk]))
+            _, line = link.expect("#fw,", timeout=5.0)
+            kind, fields = reply(line)
+            if kind == "next":
+                wanted = int(fields["offset"])
+                resends += wanted == offset
+                offset = wanted
+            elif kind == "done":
+                if fields.get("crc") != "ok":
+                    sys.exit("image CRC mismatch on the hub")
+                break
+            else:
+                sys.exit("transfer failed: %s" % line.strip())
+
+        elapsed = time.perf_counter() - started
+        print("%d bytes in %.1f s (%.1f KB/s), %d frame(s) resent" %
+              (len(image), elapsed, len(image) / 1024.0 / elapsed, resends))
+
+        if args.no_swap:
+            return
+
+        link.command("fw swap", "Starting slot")
+        time.sleep(1.0)
+        _, line = link.command("fw", "Firmware:", timeout=10.0)
+        print(line.strip())
+    except (TimeoutError, KeyboardInterrupt):
+        link._write(frame(FRAME_ABORT, 0))
+        raise
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    main()
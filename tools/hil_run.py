@@ -0,0 +1,412 @@
+#!/usr/bin/env python3
+"""Hardware-in-the-loop latency and throughput run for the Smart Sensor Hub.
+
+Drives a firmware built with HIL_PROBE_ENABLE=1 (hil_probe.h) over its
+console, on the board or in the simulation (`make -C sim hil`), and writes
+one JSON report per run:
+
+    cli_rtt_ms       `hil ping` round trip seen by the host
+    steps            one per load step (`hil load <n> <period_ms>`):
+                     offered and delivered sample rate, firmware latencies
+                     (sample_frame, sample_wire, cli; see `hil`), host
+                     latency (sample timestamp to frame arrival, with the
+                     clock offset from the fastest ping), drop counters
+    max_sustained_rate
+                     highest delivered samples/s of a step without ring
+                     overruns or telemetry drops
+    summary          the figures --compare checks
+
+The load is ramped by doubling the farm channel count at --period until a
+step loses samples or the farm is exhausted. The report is labelled with
+the newest version heading of Docs/RELEASE_NOTES.md ("Unreleased" while
+work is pending) and `git describe`, so reports of successive versions can
+be kept side by side and compared:
+
+    hil_run.py --sim --report hil.json
+    hil_run.py /dev/ttyACM0 --report board.json --compare hil-v0.4.0.json
+
+With --compare, exits with status 1 if a summary figure got worse by more
+than --threshold percent. The probe pins (PC0-PC3, see hil_probe.h) on a
+logic analyzer next to the TX line give the same latencies without the
+host in the path; serial ports need pyserial.
+"""
+
+import argparse
+import json
+import os
+import queue
+import re
+import subprocess
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry_decode import (FRAME_SAMPLES_DELTA, FRAME_SAMPLES_F32,  # noqa: E402
+                              FRAME_SAMPLES_I16, FRAME_SAMPLES_RAW, FRAME_SAMPLES_XOR,
+                              parse_frame, split_frames)
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SIM_PATH = os.path.join(ROOT, "sim", "build", "hil", "hub_sim")
+RELEASE_NOTES = os.path.join(ROOT, "Docs", "RELEASE_NOTES.md")
+
+SAMPLE_FRAMES = (FRAME_SAMPLES_F32, FRAME_SAMPLES_I16, FRAME_SAMPLES_DELTA,
+                 FRAME_SAMPLES_XOR, FRAME_SAMPLES_RAW)
+# sensor_farm.h: SENSOR_FARM_MAX_CHANNELS, SENSOR_FARM_FIRST_ID. Host
+# latency is taken from farm samples only; board sensors may deliver
+# back-dated FIFO readings.
+FARM_CHANNELS = 24
+FARM_FIRST_ID = 100
+FARM_END_ID = FARM_FIRST_ID + FARM_CHANNELS
+MAX_WIRE_FRAME = 1024
+SYNC_PINGS = 5
+
+# summary key -> True if larger is better.
+SUMMARY_KEYS = {
+    "cli_rtt_avg_ms": False,
+    "cli_rtt_p95_ms": False,
+    "cli_exec_avg_us": False,
+    "sample_frame_avg_us": False,
+    "sample_wire_avg_us": False,
+    "sample_wire_max_us": False,
+    "host_latency_avg_ms": False,
+    "max_sustained_rate": True,
+}
+
+
+def stats(values):
+    """min/avg/p95/max of a list, or None if empty."""
+    if not values:
+        return None
+    ordered = sorted(values)
+    return {
+        "n": len(ordered),
+        "min": ordered[0],
+        "avg": sum(ordered) / len(ordered),
+        "p95": ordered[min(len(ordered) - 1, int(0.95 * len(ordered)))],
+        "max": ordered[-1],
+    }
+
+
+class Link:
+    """Console of the device: send lines, receive text lines and samples.
+
+    The receive thread splits the stream into frames and text; each line
+    and each sample frame is stamped with the host time of its arrival.
+    """
+
+    def __init__(self, port, baud, sim):
+        self.lines = queue.Queue()
+        self.samples = []
+        self.lock = threading.Lock()
+        self.proc = None
+        if sim:
+            self.proc = subprocess.Popen([sim, "-r", "-q"], stdin=subprocess.PIPE,
+                                         stdout=subprocess.PIPE, bufsize=0)
+            self._read = lambda: self.proc.stdout.read(4096)  # unbuffered: what is there
+            self._write = lambda data: (self.proc.stdin.write(data), self.proc.stdin.flush())
+        else:
+            import serial  # pyserial, only needed for a board
+            self.port = serial.Serial(port, baud, timeout=0.05)
+            self._read = lambda: self.port.read(max(1, self.port.in_waiting)) or None
+            self._write = self.port.write
+        self.arrival = 0.0
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+
+    def _chunks(self):
+        while True:
+            chunk = self._read()
+            if chunk is None:
+                continue
+            if not chunk:
+                return
+            self.arrival = time.perf_counter()
+            yield chunk
+
+    def _on_frame(self, frame):
+        # Timestamps of the farm's samples.
+        ftype, items = frame
+        if ftype in SAMPLE_FRAMES and items:
+            with self.lock:
+                self.samples.append((self.arrival, [item[0] for item in items
+                                                    if FARM_FIRST_ID <= item[1] < FARM_END_ID]))
+
+    def _run(self):
+        def parse(raw):
+            items = parse_frame(raw)
+            return None if items is None else (raw[0], items)
+
+        pending = ""
+        for chunk in split_frames(self._chunks(), self._on_frame, parse, MAX_WIRE_FRAME):
+            pending += chunk.decode("utf-8", "replace").replace("\r", "")
+            *done, pending = pending.split("\n")
+            for line in done:
+                self.lines.put((self.arrival, line))
+        self.lines.put((time.perf_counter(), None))
+
+    def send(self, line):
+        self._write((line + "\r").encode())
+
+    def expect(self, prefix, timeout=5.0):
+        """Return (host time, line) of the next line starting with prefix.
+
+        prefix may be a tuple of prefixes, as for str.startswith().
+        """
+        deadline = time.perf_counter() + timeout
+        while True:
+            left = deadline - time.perf_counter()
+            try:
+                at, line = self.lines.get(timeout=max(0.0, left))
+            except queue.Empty:
+                raise TimeoutError("no '%s' line from the device" % prefix) from None
+            if line is None:
+                raise EOFError("device output ended")
+            if line.startswith(prefix):
+                return at, line
+
+    def command(self, line, prefix, timeout=5.0):
+        self.drain()
+        self.send(line)
+        return self.expect(prefix, timeout)
+
+    def drain(self):
+        while True:
+            try:
+                self.lines.get_nowait()
+            except queue.Empty:
+                return
+
+    def take_samples(self):
+        with self.lock:
+            samples, self.samples = self.samples, []
+        return samples
+
+    def close(self):
+        if self.proc is not None:
+            self.proc.stdin.close()
+            self.proc.wait(timeout=10)
+        else:
+            self.port.close()
+
+
+def parse_fields(line):
+    """'#hil,v1,a=1,b=2' -> {'a': 1, 'b': 2}."""
+    fields = {}
+    for field in line.split(",")[2:]:
+        key, sep, value = field.partition("=")
+        if sep:
+            fields[key] = int(value) if value.isdigit() else value
+    return fields
+
+
+def read_report(link):
+    """Run `hil` and return (counters, {stage: {count, min, avg, max}})."""
+    _, header = link.command("hil", "#hil,v1")
+    counters = parse_fields(header)
+    stages = {}
+    while True:
+        _, line = link.expect(("hil,", "#hil,end"))
+        if line.startswith("#hil,end"):
+            return counters, stages
+        parts = line.split(",")
+        if parts[0] == "hil" and len(parts) == 6:
+            count, low, avg, high = (int(v) for v in parts[2:])
+            stages[parts[1]] = {"count": count, "min_us": low, "avg_us": avg, "max_us": high}
+
+
+def measure_rtt(link, count):
+    """Ping round trips in ms, and (host time, tick_ms) of the fastest one.
+
+    The device answers at about the middle of the fastest round trip, so
+    that pair maps the device tick onto the host clock.
+    """
+    rtts = []
+    best = None
+    for _ in range(count):
+        link.drain()
+        sent = time.perf_counter()
+        link.send("hil ping")
+        at, line = link.expect("#hil,pong")
+        rtt = at - sent
+        rtts.append(rtt * 1000.0)
+        if best is None or rtt < best[0]:
+            best = (rtt, ((sent + at) / 2.0, parse_fields(line).get("tick_ms", 0)))
+    return rtts, best[1]
+
+
+def run_step(link, channels, period_ms, seconds, pings):
+    link.command("hil load %u %u" % (channels, period_ms), "#hil,load")
+    time.sleep(0.5)  # let the new load settle before counting
+    before, _ = read_report(link)
+    link.command("hil reset", "#hil,reset")
+    _, sync0 = measure_rtt(link, pings)
+    link.take_samples()
+    time.sleep(seconds)
+    samples = link.take_samples()
+    _, sync1 = measure_rtt(link, pings)
+    after, stages = read_report(link)
+
+    # Device tick to host time through the syncs at both ends of the step:
+    # the two clocks need not run at the same rate.
+    rate = (sync1[0] - sync0[0]) / max(1e-3, (sync1[1] - sync0[1]) / 1000.0)
+    host_ms = []
+    for arrival, stamps in samples:
+        host_ms.extend((arrival - sync0[0] - (ts - sync0[1]) / 1000.0 * rate) * 1000.0
+                       for ts in stamps)
+
+    elapsed_ms = max(1, after["uptime_ms"] - before["uptime_ms"])
+    delta = {key: after[key] - before[key] for key in
+             ("ring_pushed", "ring_overruns", "telem_records", "telem_dropped", "uart_drop_telemetry")
+             if key in after and key in before}
+    step = {
+        "channels": after.get("farm", channels),
+        "period_ms": period_ms,
+        "offered_rate": after.get("farm", channels) * 1000.0 / period_ms,
+        "accepted_rate": delta.get("ring_pushed", 0) * 1000.0 / elapsed_ms,
+        "delivered_rate": delta.get("telem_records", 0) * 1000.0 / elapsed_ms,
+        "ring_high_water": after.get("ring_high_water"),
+        "counters": delta,
+        "latency_us": stages,
+        "host_latency_ms": stats(host_ms),
+        "clock_rate": rate,
+    }
+    step["sustained"] = (delta.get("ring_overruns", 0) == 0 and delta.get("telem_dropped", 0) == 0
+                         and delta.get("uart_drop_telemetry", 0) == 0)
+    return step
+
+
+def release_version():
+    try:
+        with open(RELEASE_NOTES, encoding="utf-8") as f:
+            for line in f:
+                match = re.match(r"## (\S+)", line)
+                if match:
+                    return match.group(1)
+    except OSError:
+        pass
+    return "unknown"
+
+
+def git_describe():
+    try:
+        return subprocess.check_output(["git", "-C", ROOT, "describe", "--always", "--dirty"],
+                                       stderr=subprocess.DEVNULL, text=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def summarize(report):
+    rtt = report["cli_rtt_ms"] or {}
+    first = report["steps"][0] if report["steps"] else {}
+    lat = first.get("latency_us", {})
+    host = first.get("host_latency_ms") or {}
+    summary = {
+        "cli_rtt_avg_ms": rtt.get("avg"),
+        "cli_rtt_p95_ms": rtt.get("p95"),
+        "cli_exec_avg_us": lat.get("cli", {}).get("avg_us"),
+        "sample_frame_avg_us": lat.get("sample_frame", {}).get("avg_us"),
+        "sample_wire_avg_us": lat.get("sample_wire", {}).get("avg_us"),
+        "sample_wire_max_us": lat.get("sample_wire", {}).get("max_us"),
+        "host_latency_avg_ms": host.get("avg"),
+        "max_sustained_rate": report["max_sustained_rate"],
+    }
+    return summary
+
+
+def compare(baseline, current, threshold):
+    """Print the summary side by side; return True if nothing regressed."""
+    ok = True
+    print("%-22s %12s %12s %8s" % ("figure", baseline.get("version", "?"),
+                                   current.get("version", "?"), "change"))
+    for key, higher_better in SUMMARY_KEYS.items():
+        old = baseline.get("summary", {}).get(key)
+        new = current["summary"].get(key)
+        if old is None or new is None:
+            print("%-22s %12s %12s" % (key, old, new))
+            continue
+        change = 0.0 if old == 0 else (new - old) * 100.0 / abs(old)
+        worse = -change if higher_better else change
+        flag = ""
+        if worse > threshold and abs(new - old) > 0.5:
+            flag = "  REGRESSED"
+            ok = False
+        print("%-22s %12.2f %12.2f %+7.1f%%%s" % (key, old, new, change, flag))
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("port", nargs="?", help="serial port of the board")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    parser.add_argument("--sim", nargs="?", const=SIM_PATH,
+                        help="run the simulation instead (default %s)" % os.path.relpath(SIM_PATH))
+    parser.add_argument("--report", default="hil_report.json", help="JSON report to write")
+    parser.add_argument("--compare", metavar="REPORT", help="baseline report to check against")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="regression threshold in percent (default 10)")
+    parser.add_argument("--label", help="version label (default: RELEASE_NOTES.md heading)")
+    parser.add_argument("--pings", type=int, default=50, help="CLI round trips to time")
+    parser.add_argument("--period", type=int, default=10, help="farm period per channel in ms")
+    parser.add_argument("--step", type=float, default=3.0, help="seconds per load step")
+    parser.add_argument("--max-channels", type=int, default=FARM_CHANNELS,
+                        help="largest farm channel count to try")
+    args = parser.parse_args()
+
+    if (args.port is None) == (args.sim is None):
+        parser.error("give a serial port or --sim")
+
+    link = Link(args.port, args.baud, args.sim)
+    try:
+        time.sleep(1.0)  # boot banner
+        link.command("pmode active", "Requested power mode")
+        link.command("telem on", "Telemetry:")
+
+        rtts, _ = measure_rtt(link, args.pings)
+
+        steps = []
+        channels = 1
+        while channels <= args.max_channels:
+            step = run_step(link, channels, args.period, args.step, SYNC_PINGS)
+            steps.append(step)
+            sys.stderr.write("hil: %2u channels, %7.1f samples/s offered, %7.1f delivered%s\n"
+                             % (step["channels"], step["offered_rate"], step["delivered_rate"],
+                                "" if step["sustained"] else ", LOSSES"))
+            if not step["sustained"] or channels == args.max_channels:
+                break
+            channels = min(channels * 2, args.max_channels)
+
+        link.command("hil load 0 %u" % args.period, "#hil,load")
+    finally:
+        link.close()
+
+    sustained = [s["delivered_rate"] for s in steps if s["sustained"]]
+    report = {
+        "format": "hil-report/1",
+        "version": args.label or release_version(),
+        "git": git_describe(),
+        "target": "sim" if args.sim else args.port,
+        "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "period_ms": args.period,
+        "cli_rtt_ms": stats(rtts),
+        "steps": steps,
+        "max_sustained_rate": max(sustained) if sustained else 0.0,
+        "limited_by": "farm" if steps and steps[-1]["sustained"] else "losses",
+    }
+    report["summary"] = summarize(report)
+
+    with open(args.report, "w", encoding="utf-8") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+    sys.stderr.write("hil: report written to %s\n" % args.report)
+
+    if args.compare:
+        with open(args.compare, encoding="utf-8") as f:
+            baseline = json.load(f)
+        if not compare(baseline, report, args.threshold):
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
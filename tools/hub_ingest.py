@@ -0,0 +1,377 @@
+#!/usr/bin/env python3
+"""Ingest everything the Smart Sensor Hub streams, at line rate.
+
+One pass over a capture or a live port (UART or USB CDC) splits the byte
+stream the way the firmware multiplexes it and sends each part to its own
+output:
+
+    sample frames 0x01-0x05   -> --csv / --parquet rows, --plot
+                                 timestamp_ms sensor_id channel value quality
+    0x06 summaries, 0x0A spectra, 0x07 metrics, 0x12 energy
+                              -> --events, one JSON object per record
+    every valid frame but samples (also 0x10/0x11 trace, 0x08/0x09 metrics
+    series and labels)        -> --frames, re-framed unchanged, for
+                                 trace_to_perfetto.py and metrics_export.py
+    everything else           -> stdout (or --text), with --elf binary log
+                                 records (LOG_BINARY_MODE=1) rendered as text
+
+Frames are recognised as in telemetry_decode.py (COBS between 0x00
+delimiters, CRC-32/MPEG-2), whose decoders are used unchanged.
+
+A reader thread drains the port into memory as fast as it delivers, so the
+OS receive buffer never overflows while the decoder or a sink falls behind;
+the status line on stderr shows how far behind (backlog). It also shows
+the drop counters of the latest metrics frame (telem_dropped,
+uart_drop_telemetry), which count what the firmware could not send.
+--raw keeps an exact copy of the input for a later replay.
+
+Parquet output needs pyarrow, --plot needs matplotlib, serial ports need
+pyserial.
+
+Usage:
+    hub_ingest.py capture.bin --csv samples.csv
+    hub_ingest.py /dev/ttyACM0 --elf firmware.elf --parquet run.parquet --plot
+    hub_ingest.py /dev/ttyUSB0 --baud 921600 --raw run.bin --frames trace.bin
+"""
+
+import argparse
+import collections
+import csv
+import json
+import os
+import queue
+import sys
+import threading
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry_decode import (FRAME_ENERGY, FRAME_METRICS, FRAME_SAMPLES_DELTA,  # noqa: E402
+                              FRAME_SAMPLES_F32, FRAME_SAMPLES_I16, FRAME_SAMPLES_RAW,
+                              FRAME_SAMPLES_XOR, FRAME_SPECTRUM, FRAME_STATS, parse_frame,
+                              split_frames)
+
+SAMPLE_FRAMES = (FRAME_SAMPLES_F32, FRAME_SAMPLES_I16, FRAME_SAMPLES_DELTA,
+                 FRAME_SAMPLES_XOR, FRAME_SAMPLES_RAW)
+EVENT_NAMES = {FRAME_STATS: "stats", FRAME_SPECTRUM: "spectrum", FRAME_METRICS: "metrics",
+               FRAME_ENERGY: "energy"}
+
+# Largest frame accepted: the biggest type (trace events) with margin.
+MAX_WIRE_FRAME = 1024
+READ_SIZE = 65536
+PARQUET_ROWS = 65536
+PLOT_POINTS = 2000
+
+
+def cobs_encode(data):
+    """COBS-encode one block (without delimiters)."""
+    out = bytearray()
+    for block in data.split(b"\x00"):
+        while len(block) >= 254:
+            out.append(0xFF)
+            out += block[:254]
+            block = block[254:]
+        out.append(len(block) + 1)
+        out += block
+    return bytes(out)
+
+
+class Reader(threading.Thread):
+    """Drain the source into a queue of chunks; None marks the end."""
+
+    def __init__(self, path, baud, raw_path):
+        super().__init__(daemon=True)
+        self.chunks = queue.Queue()
+        self.total = 0
+        self.raw = open(raw_path, "wb") if raw_path else None
+        self.stop = False
+        self.read = self._open(path, baud)
+
+    def _open(self, path, baud):
+        if path == "-":
+            stdin = sys.stdin.buffer
+            return lambda: stdin.read1(READ_SIZE)
+        if path.startswith("/dev/") or path.upper().startswith("COM"):
+            import serial  # pyserial, only needed for live capture
+            port = serial.Serial(path, baud, timeout=0.05)
+            try:
+                port.set_buffer_size(rx_size=1 << 20)  # Windows only
+            except AttributeError:
+                pass
+            # Empty on a timeout: not the end of a live source.
+            return lambda: port.read(max(1, port.in_waiting)) or None
+        f = open(path, "rb")
+        return lambda: f.read(READ_SIZE)
+
+    def run(self):
+        try:
+            while not self.stop:
+                chunk = self.read()
+                if chunk is None:
+                    continue
+                if not chunk:
+                    break
+                self.total += len(chunk)
+                if self.raw is not None:
+                    self.raw.write(chunk)
+                self.chunks.put(chunk)
+        finally:
+            if self.raw is not None:
+                self.raw.close()
+            self.chunks.put(None)
+
+    def stream(self):
+        while True:
+            chunk = self.chunks.get()
+            if chunk is None:
+                return
+            yield chunk
+
+
+class SampleSink:
+    """Sample rows to CSV and/or Parquet, and the recent window for --plot."""
+
+    COLUMNS = ("timestamp_ms", "sensor_id", "channel", "value", "quality")
+
+    def __init__(self, csv_path, parquet_path, plot_window_ms):
+        self.count = 0
+        self.csv_file = self.csv = None
+        if csv_path:
+            self.csv_file = open(csv_path, "a", newline="")
+            self.csv = csv.writer(self.csv_file)
+            if self.csv_file.tell() == 0:
+                self.csv.writerow(self.COLUMNS)
+
+        self.parquet = None
+        self.columns = None
+        if parquet_path:
+            import pyarrow  # only needed for Parquet output
+            import pyarrow.parquet
+            self.pa = pyarrow
+            self.schema = pyarrow.schema([("timestamp_ms", pyarrow.uint32()),
+                                          ("sensor_id", pyarrow.uint8()),
+                                          ("channel", pyarrow.uint8()),
+                                          ("value", pyarrow.float64()),
+                                          ("quality", pyarrow.int16())])
+            self.parquet = pyarrow.parquet.ParquetWriter(parquet_path, self.schema)
+            self.columns = tuple([] for _ in self.COLUMNS)
+
+        self.window_ms = plot_window_ms
+        self.recent = collections.defaultdict(collections.deque) if plot_window_ms else None
+        self.lock = threading.Lock()
+
+    def add(self, ftype, items):
+        """Add the records of one sample frame."""
+        if ftype == FRAME_SAMPLES_RAW:
+            rows = [(ts, sensor, ch, value, quality)
+                    for ts, sensor, values, quality in items
+                    for ch, value in enumerate(values)]
+        else:
+            rows = [(ts, sensor, 0, value, -1) for ts, sensor, value in items]
+        self.count += len(rows)
+
+        if self.csv is not None:
+            self.csv.writerows([(ts, sensor, ch, "%.6g" % value, "" if q < 0 else q)
+                                for ts, sensor, ch, value, q in rows])
+        if self.columns is not None:
+            for column, values in zip(self.columns, zip(*rows)):
+                column.extend(values)
+            if len(self.columns[0]) >= PARQUET_ROWS:
+                self._flush_parquet()
+        if self.recent is not None:
+            with self.lock:
+                for ts, sensor, ch, value, _ in rows:
+                    line = self.recent[(sensor, ch)]
+                    line.append((ts, value))
+                    while ts - line[0][0] > self.window_ms:
+                        line.popleft()
+
+    def _flush_parquet(self):
+        if not self.columns[0]:
+            return
+        quality = [None if q < 0 else q for q in self.columns[4]]
+        arrays = [self.pa.array(c, type=f.type)
+                  for c, f in zip(self.columns[:4] + (quality,), self.schema)]
+        self.parquet.write_table(self.pa.Table.from_arrays(arrays, schema=self.schema))
+        self.columns = tuple([] for _ in self.COLUMNS)
+
+    def flush(self):
+        if self.csv_file is not None:
+            self.csv_file.flush()
+
+    def close(self):
+        if self.csv_file is not None:
+            self.csv_file.close()
+        if self.parquet is not None:
+            self._flush_parquet()
+            self.parquet.close()
+
+
+class Ingest:
+    """Dispatch decoded frames to the sinks and keep the counters."""
+
+    def __init__(self, args):
+        self.samples = SampleSink(args.csv, args.parquet, args.window * 1000 if args.plot else 0)
+        self.events = open(args.events, "a") if args.events else None
+        self.frames_out = open(args.frames, "ab") if args.frames else None
+        self.frames = 0
+        self.device_drops = {}
+
+    def parse(self, raw):
+        items = parse_frame(raw)
+        return None if items is None else (raw[0], raw, items)
+
+    def on_frame(self, frame):
+        ftype, raw, items = frame
+        self.frames += 1
+        if ftype in SAMPLE_FRAMES:
+            self.samples.add(ftype, items)
+            return
+
+        if self.frames_out is not None:
+            self.frames_out.write(b"\x00" + cobs_encode(raw) + b"\x00")
+        if ftype == FRAME_METRICS:
+            values = items[0][1]
+            self.device_drops = {k: values[k] for k in ("telem_dropped", "uart_drop_telemetry")
+                                 if k in values}
+        if ftype in EVENT_NAMES and self.events is not None:
+            for item in items:
+                self.events.write(json.dumps(self._event(ftype, item)) + "\n")
+
+    @staticmethod
+    def _event(ftype, item):
+        record = {"type": EVENT_NAMES[ftype], "timestamp_ms": item[0]}
+        if ftype == FRAME_ENERGY:
+            record.update(name=item[1], time_ms=item[2], charge_uAh=item[3])
+        else:
+            record.update(item[1])
+        return record
+
+    def flush(self):
+        self.samples.flush()
+        for f in (self.events, self.frames_out):
+            if f is not None:
+                f.flush()
+
+    def close(self):
+        self.samples.close()
+        for f in (self.events, self.frames_out):
+            if f is not None:
+                f.close()
+
+
+def run_decoder(args, reader, ingest, out):
+    """Decode until the reader ends; print the status line every second."""
+    state = {"bytes": 0, "frames": 0, "samples": 0, "at": time.monotonic()}
+
+    def counted():
+        for chunk in reader.stream():
+            state["decoded"] = state.get("decoded", 0) + len(chunk)
+            yield chunk
+            now = time.monotonic()
+            if not args.no_status and now - state["at"] >= 1.0:
+                status(now)
+
+    def status(now):
+        dt = now - state["at"]
+        backlog = reader.total - state["decoded"]
+        drops = " ".join("%s %u" % kv for kv in ingest.device_drops.items())
+        sys.stderr.write("\ringest: %.2f MB/s, %u frames/s, %u samples/s, backlog %u KB%s   "
+                         % ((state["decoded"] - state["bytes"]) / dt / 1e6,
+                            (ingest.frames - state["frames"]) / dt,
+                            (ingest.samples.count - state["samples"]) / dt,
+                            backlog // 1024, (", device: " + drops) if drops else ""))
+        state.update(bytes=state["decoded"], frames=ingest.frames,
+                     samples=ingest.samples.count, at=now)
+        ingest.flush()
+
+    text = split_frames(counted(), ingest.on_frame, ingest.parse, MAX_WIRE_FRAME)
+    if args.elf:
+        import log_decode
+        log_decode.decode_stream(log_decode.ElfStrings(args.elf), text, out)
+    else:
+        for chunk in text:
+            out(chunk.decode("utf-8", "replace"))
+
+
+def run_plot(args, ingest, decoder):
+    """Show the last --window seconds of every sample channel until closed."""
+    import matplotlib.animation
+    import matplotlib.pyplot as plt
+
+    fig, ax = plt.subplots()
+    ax.set_xlabel("time (s)")
+    lines = {}
+
+    def update(_):
+        with ingest.samples.lock:
+            series = {key: list(points) for key, points in ingest.samples.recent.items()}
+        for key, points in sorted(series.items()):
+            step = max(1, len(points) // PLOT_POINTS)
+            points = points[::step]
+            if key not in lines:
+                label = "id %u" % key[0] + (".%u" % key[1] if key[1] else "")
+                lines[key], = ax.plot([], [], label=label)
+                ax.legend(loc="upper left", fontsize="small")
+            lines[key].set_data([p[0] / 1000.0 for p in points], [p[1] for p in points])
+        ax.relim()
+        ax.autoscale_view()
+        if not decoder.is_alive():
+            ax.set_title("input ended")
+        return list(lines.values())
+
+    _anim = matplotlib.animation.FuncAnimation(fig, update, interval=200, cache_frame_data=False)
+    plt.show()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("source", help="capture file, serial port, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate (UART only)")
+    parser.add_argument("--elf", help="firmware ELF, to decode binary log records")
+    parser.add_argument("--csv", help="append sample rows to this CSV file")
+    parser.add_argument("--parquet", help="write sample rows to this Parquet file")
+    parser.add_argument("--events", help="append summaries, metrics and energy records (JSON lines)")
+    parser.add_argument("--frames", help="append all valid frames but samples (trace, metrics)")
+    parser.add_argument("--text", help="write text and log output here instead of stdout")
+    parser.add_argument("--raw", help="write an exact copy of the input")
+    parser.add_argument("--plot", action="store_true", help="plot the samples live")
+    parser.add_argument("--window", type=float, default=30.0, help="plot window in seconds")
+    parser.add_argument("--no-status", action="store_true", help="no status line on stderr")
+    args = parser.parse_args()
+
+    text_file = open(args.text, "a") if args.text else sys.stdout
+    ingest = Ingest(args)
+    reader = Reader(args.source, args.baud, args.raw)
+    reader.start()
+
+    def out(text):
+        text_file.write(text)
+        if text_file is sys.stdout:
+            text_file.flush()
+
+    started = time.monotonic()
+    try:
+        if args.plot:
+            decoder = threading.Thread(target=run_decoder, args=(args, reader, ingest, out),
+                                       daemon=True)
+            decoder.start()
+            run_plot(args, ingest, decoder)
+        else:
+            run_decoder(args, reader, ingest, out)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        reader.stop = True
+        ingest.close()
+        if text_file is not sys.stdout:
+            text_file.close()
+
+    elapsed = max(time.monotonic() - started, 1e-6)
+    if not args.no_status:
+        sys.stderr.write("\ningest: %u bytes in %.2f s (%.2f MB/s), %u frames, %u samples\n"
+                         % (reader.total, elapsed, reader.total / elapsed / 1e6,
+                            ingest.frames, ingest.samples.count))
+
+
+if __name__ == "__main__":
+    main()
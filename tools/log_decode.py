@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+"""Decode deferred binary log records from the Smart Sensor Hub.
+
+When the firmware is built with LOG_BINARY_MODE=1, every LOG_* call emits a
+compact record instead of a text line:
+
+    0x1E LEN | ts_ms:u32 level:u8 id:u32 args... | XOR
+
+`id` is the flash address of a "file:line:format" string. This tool reads
+those strings from the firmware ELF file, decodes the raw arguments and
+prints the same text the firmware would have produced. Bytes outside records
+(CLI output, prompt redraws) are passed through unchanged.
+
+Usage:
+    log_decode.py firmware.elf capture.bin
+    log_decode.py firmware.elf /dev/ttyACM0 --baud 115200
+    cat capture.bin | log_decode.py firmware.elf -
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = 0x1E
+LEVELS = {0: "DBG", 1: "INF", 2: "WRN", 3: "ERR"}
+
+# One printf conversion: flags, width, precision, length, type.
+CONVERSION_RE = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t)?([diuxXocpfFeEgGs%])")
+
+
+class ElfStrings:
+    """Minimal ELF32 little-endian reader that resolves flash addresses."""
+
+    SHF_ALLOC = 0x2
+    SHT_NOBITS = 8
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4] != 1 or self.data[5] != 1:
+            raise ValueError("%s is not a little-endian ELF32 file" % path)
+
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+
+        self.sections = []
+        for i in range(shnum):
+            base = shoff + i * shentsize
+            (_name, sh_type, flags, addr, offset, size) = struct.unpack_from("<IIIIII", self.data, base)
+            if (flags & self.SHF_ALLOC) and sh_type != self.SHT_NOBITS and size > 0:
+                self.sections.append((addr, size, offset))
+
+    def string_at(self, address):
+        for addr, size, offset in self.sections:
+            if addr <= address < addr + size:
+                start = offset + (address - addr)
+                end = self.data.index(b"\x00", start)
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def split_id(id_string):
+    """Split "file:line:format" into its parts (the file may contain ':')."""
+    head, _, fmt = id_string.partition(":")
+    while True:
+        line, sep, rest = fmt.partition(":")
+        if sep and line.isdigit():
+            return head, int(line), rest
+        if not sep:
+            return head, 0, fmt
+        head = head + ":" + line
+        fmt = rest
+
+
+def render(fmt, payload):
+    """Render a C format string from raw little-endian argument bytes."""
+    out = []
+    pos = 0
+    last = 0
+
+    def take(n):
+        nonlocal pos
+        chunk = payload[pos:pos + n]
+        if len(chunk) != n:
+            raise ValueError("truncated arguments")
+        pos += n
+        return chunk
+
+    for m in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+
+        if conv == "%":
+            out.append("%")
+            continue
+
+        if width == "*":
+            width = str(struct.unpack("<i", take(4))[0])
+        if prec == "*":
+            prec = str(struct.unpack("<i", take(4))[0])
+
+        spec = "%" + flags + (width or "") + ("." + prec if prec is not None else "")
+
+        if conv == "s":
+            n = take(1)[0]
+            value = take(n).decode("utf-8", "replace")
+            out.append((spec + "s") % value)
+        elif conv in "fFeEgG":
+            value = struct.unpack("<f", take(4))[0]
+            out.append((spec + conv) % value)
+        else:
+            raw = take(8) if length == "ll" else take(4)
+            signed = conv in "di"
+            code = ("<q" if signed else "<Q") if len(raw) == 8 else ("<i" if signed else "<I")
+            value = struct.unpack(code, raw)[0]
+            if conv == "c":
+                out.append((spec + "c") % chr(value & 0xFF))
+            elif conv == "p":
+                out.append("0x%08x" % value)
+            else:
+                out.append((spec + ("d" if conv in "diu" else conv)) % value)
+
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode_stream(elf, stream, write):
+    """Decode records from a byte iterator, passing other bytes through."""
+    buf = bytearray()
+    for chunk in stream:
+        buf.extend(chunk)
+        while buf:
+            sync = buf.find(bytes([SYNC]))
+            if sync < 0:
+                write(buf.decode("utf-8", "replace"))
+                buf.clear()
+                break
+            if sync > 0:
+                write(buf[:sync].decode("utf-8", "replace"))
+                del buf[:sync]
+            if len(buf) < 2 or len(buf) < buf[1] + 3:
+                break  # wait for the rest of the record
+
+            length = buf[1]
+            body = bytes(buf[2:2 + length])
+            check = buf[2 + length]
+            x = 0
+            for b in body:
+                x ^= b
+            if length < 9 or x != check:
+                # Not a record (or corrupted): pass the marker byte through.
+                write(buf[:1].decode("ascii"))
+                del buf[:1]
+                continue
+            del buf[:length + 3]
+
+            ts, level, ident = struct.unpack_from("<IBI", body, 0)
+            id_string = elf.string_at(ident)
+            if id_string is None:
+                write("\r[%08u ms][%s][?][id=0x%08x]\r\n" % (ts, LEVELS.get(level, "UNK"), ident))
+                continue
+            file, line, fmt = split_id(id_string)
+            try:
+                msg = render(fmt, body[9:])
+            except (ValueError, struct.error):
+                msg = fmt + " <args truncated>"
+            write("\r[%08u ms][%s][%s:%u] %s\r\n" % (ts, LEVELS.get(level, "UNK"), file, line, msg))
+
+
+def open_source(path, baud):
+    if path == "-":
+        stdin = sys.stdin.buffer
+        return iter(lambda: stdin.read1(4096), b"")
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial, only needed for live capture
+        port = serial.Serial(path, baud, timeout=0.1)
+        return iter(lambda: port.read(4096) or b"", None)
+    f = open(path, "rb")
+    return iter(lambda: f.read(4096), b"")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("elf", help="firmware ELF file matching the running image")
+    parser.add_argument("source", help="capture file, serial port, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    args = parser.parse_args()
+
+    elf = ElfStrings(args.elf)
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    try:
+        decode_stream(elf, open_source(args.source, args.baud), write)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Convert Smart Sensor Hub metrics telemetry to OpenMetrics text.
+
+With telemetry on (`telem on`), the Metrics task exports a snapshot every
+`metrics_period` ms (see common/metrics.h) as telemetry frames mixed with
+CLI text and other frames on the console:
+
+    type 0x07 snapshot: value:u32 * count, in METRICS_LIST order
+    type 0x09 labels:   { kind:u8 id:u8 len:u8 char*len }*count
+    type 0x08 series:   { series:u8 id:u8 value:u32 }*count
+
+Every snapshot frame starts a new export. Once the next one arrives, the
+previous export is complete and is written as OpenMetrics text (the
+Prometheus exposition format): to stdout, or atomically to a file for the
+node_exporter textfile collector. Counters get a `_total` suffix; every
+sample carries a `device` label.
+
+Usage:
+    metrics_export.py capture.bin
+    metrics_export.py /dev/ttyACM0 --out /var/lib/node_exporter/hub.prom
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry_decode import (METRIC_NAMES, POWER_MODES, cobs_decode,  # noqa: E402
+                              crc32_mpeg2, open_source)
+
+FRAME_METRICS = 0x07
+FRAME_SERIES = 0x08
+FRAME_LABELS = 0x09
+
+LABEL_TASK, LABEL_SENSOR, LABEL_MODE, LABEL_STATE = 0, 1, 2, 3
+EVENT_TASK_ID = 0x80
+CORE_STATES = ("run", "sleep", "stop")
+
+# metrics.h METRICS_SERIES_LIST, in order: (name, label kind).
+SERIES = (
+    ("task_runs", LABEL_TASK),
+    ("task_max_run_us", LABEL_TASK),
+    ("task_max_late_us", LABEL_TASK),
+    ("task_overruns", LABEL_TASK),
+    ("task_budget_overruns", LABEL_TASK),
+    ("sensor_reads", LABEL_SENSOR),
+    ("sensor_errors", LABEL_SENSOR),
+    ("power_mode_time_ms", LABEL_MODE),
+    ("power_mode_charge_uah", LABEL_MODE),
+    ("power_state_time_ms", LABEL_STATE),
+    ("sensor_health", LABEL_SENSOR),
+    ("sensor_recoveries", LABEL_SENSOR),
+    ("task_load_permille", LABEL_TASK),
+)
+
+# Values that can go down; everything else is a counter since boot.
+GAUGES = {
+    "uptime_ms", "clock_hz", "sample_period_ms", "ring_count", "ring_capacity",
+    "ring_high_water", "wake_source", "wake_latency_us", "wake_latency_max_us",
+    "console_hold_ms", "inactive_ms", "task_max_run_us", "task_max_late_us",
+    "watchdog_timeout_ms", "boot_first_sample_us", "boot_ready_us", "boot_resume",
+    "standby_wakeups", "work_depth_max", "work_latency_max_us", "sensors_quarantined",
+    "sensor_health", "log_defer_bytes", "cpu_load_permille", "cpu_load_avg_permille",
+    "cpu_load_peak_permille", "task_load_permille", "power_transition_max_us",
+    "stop_overhead_us", "stop_break_even_ms", "stop_main_break_even_ms", "spectrum_max_us",
+    "shed_level", "shed_pressure_pct", "shed_aggregated", "selftest_result",
+}
+
+LABEL_KEYS = {LABEL_TASK: "task", LABEL_SENSOR: "sensor", LABEL_MODE: "mode",
+              LABEL_STATE: "state"}
+
+
+def read_frames(chunks):
+    """Yield (type, count, payload) for every valid telemetry frame."""
+    buf = bytearray()
+    for chunk in chunks:
+        buf.extend(chunk)
+        parts = buf.split(b"\x00")
+        buf = bytearray(parts.pop())
+        for part in parts:
+            raw = cobs_decode(bytes(part)) if part else None
+            if raw is None or len(raw) < 10:
+                continue
+            body = raw[:-4]
+            if crc32_mpeg2(body) != struct.unpack_from("<I", raw, len(raw) - 4)[0]:
+                continue
+            yield body[0], body[1], body[6:]
+
+
+class Export:
+    """One snapshot with its labels and series."""
+
+    def __init__(self, count, payload):
+        self.values = {}
+        if len(payload) == 4 * count:
+            for n, value in enumerate(struct.unpack("<%uI" % count, payload)):
+                name = METRIC_NAMES[n] if n < len(METRIC_NAMES) else "metric%u" % n
+                self.values[name] = value
+        self.names = {}
+        self.series = []
+
+    def on_labels(self, count, payload):
+        pos = 0
+        for _ in range(count):
+            if pos + 3 > len(payload):
+                return
+            kind, ident, n = payload[pos], payload[pos + 1], payload[pos + 2]
+            self.names[(kind, ident)] = payload[pos + 3:pos + 3 + n].decode("ascii", "replace")
+            pos += 3 + n
+
+    def on_series(self, count, payload):
+        if len(payload) != 6 * count:
+            return
+        for n in range(count):
+            self.series.append(struct.unpack_from("<BBI", payload, 6 * n))
+
+    def label(self, kind, ident):
+        if kind == LABEL_MODE:
+            return POWER_MODES[ident] if ident < len(POWER_MODES) else str(ident)
+        if kind == LABEL_STATE:
+            return CORE_STATES[ident] if ident < len(CORE_STATES) else str(ident)
+        return self.names.get((kind, ident), str(ident))
+
+
+def metric_family(name, prefix):
+    """Return (family name, sample name, type) of a metric."""
+    family = prefix + name
+    if name in GAUGES:
+        return family, family, "gauge"
+    return family, family + "_total", "counter"
+
+
+def escape(value):
+    return value.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n")
+
+
+def render(export, device, prefix):
+    """Return the OpenMetrics text of one export."""
+    dev = "device=\"%s\"" % escape(device)
+    lines = []
+    for name, value in export.values.items():
+        family, sample, kind = metric_family(name, prefix)
+        lines.append("# TYPE %s %s" % (family, kind))
+        lines.append("%s{%s} %u" % (sample, dev, value))
+
+    grouped = {}
+    for series, ident, value in export.series:
+        grouped.setdefault(series, []).append((ident, value))
+    for series in sorted(grouped):
+        if series >= len(SERIES):
+            continue
+        name, kind = SERIES[series]
+        family, sample, mtype = metric_family(name, prefix)
+        lines.append("# TYPE %s %s" % (family, mtype))
+        for ident, value in grouped[series]:
+            labels = "%s,%s=\"%s\"" % (dev, LABEL_KEYS[kind], escape(export.label(kind, ident)))
+            if kind == LABEL_TASK:
+                labels += ",event=\"%s\"" % ("1" if ident & EVENT_TASK_ID else "0")
+            lines.append("%s{%s} %u" % (sample, labels, value))
+
+    lines.append("# EOF")
+    return "\n".join(lines) + "\n"
+
+
+def write_out(text, path):
+    if path is None:
+        sys.stdout.write(text)
+        sys.stdout.flush()
+        return
+    tmp = path + ".tmp"
+    with open(tmp, "w") as f:
+        f.write(text)
+    os.replace(tmp, path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("source", help="capture file, serial port, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    parser.add_argument("--out", help="write the latest export to this file instead of stdout")
+    parser.add_argument("--device", default="hub", help="value of the device label")
+    parser.add_argument("--prefix", default="hub_", help="metric name prefix")
+    args = parser.parse_args()
+
+    export = None
+    try:
+        for ftype, count, payload in read_frames(open_source(args.source, args.baud)):
+            if ftype == FRAME_METRICS:
+                if export is not None:
+                    write_out(render(export, args.device, args.prefix), args.out)
+                export = Export(count, payload)
+            elif export is not None and ftype == FRAME_LABELS:
+                export.on_labels(count, payload)
+            elif export is not None and ftype == FRAME_SERIES:
+                export.on_series(count, payload)
+    except KeyboardInterrupt:
+        pass
+
+    # End of a capture file: the last export is complete as well.
+    if export is not None:
+        write_out(render(export, args.device, args.prefix), args.out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Stream recorded samples into the Smart Sensor Hub's replay sensor.
+
+Reads a telemetry capture (the console or telemetry UART output, text and
+frames mixed) or a CSV written by telemetry_decode.py --csv, and sends its
+samples as `replay push` lines to a `replay link` replay (sensor_replay.h),
+on the board or in the simulation:
+
+    replay_send.py capture.bin /dev/ttyACM0
+    replay_send.py samples.csv --fast --sim
+
+Two samples go per line, each acknowledged with the room left in the
+firmware's queue; the script sends only what fits, so nothing is lost
+however fast the replay drains. With --fast the firmware delivers as fast
+as its sample ring takes; otherwise at the recorded spacing. Timestamps
+are sent relative to the first sample to keep the lines short. Raw
+multi-channel records are sent with their first channel. Serial ports
+need pyserial.
+"""
+
+import argparse
+import csv
+import os
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from hil_run import Link  # noqa: E402
+from telemetry_decode import parse_frame, split_frames  # noqa: E402
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SIM_PATH = os.path.join(ROOT, "sim", "build", "hub_sim")
+PER_LINE = 2  # CLI_MAX_ARGS: "replay push" and two id/ms/value triples
+
+
+def read_samples(path):
+    """[(timestamp_ms, sensor_id, value), ...] of a capture or CSV file."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    if data.startswith(b"timestamp_ms"):
+        rows = csv.reader(data.decode().splitlines()[1:])
+        return [(int(row[0]), int(row[1]), float(row[2])) for row in rows if len(row) >= 3]
+
+    samples = []
+
+    def on_samples(items):
+        for item in items:
+            if len(item) == 3 and isinstance(item[1], int):
+                samples.append(item)
+            elif len(item) == 4 and isinstance(item[2], tuple) and item[2]:
+                samples.append((item[0], item[1], item[2][0]))
+
+    for _ in split_frames([data], on_samples, parse_frame):
+        pass
+    return samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="telemetry capture or CSV")
+    parser.add_argument("port", nargs="?", help="serial port of the board")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--sim", nargs="?", const=SIM_PATH, metavar="PATH",
+                        help="run the simulation instead of a board (default: %(const)s)")
+    parser.add_argument("--fast", action="store_true", help="replay as fast as the ring takes")
+    args = parser.parse_args()
+
+    if (args.port is None) == (args.sim is None):
+        parser.error("give a serial port or --sim")
+
+    samples = read_samples(args.input)
+    if not samples:
+        sys.exit("%s: no samples" % args.input)
+    base = samples[0][0]
+
+    link = Link(args.port, args.baud, args.sim)
+    try:
+        link.command("replay link" + (" fast" if args.fast else ""), "Replay:")
+
+        started = time.perf_counter()
+        pos = 0
+        while pos < len(samples):
+            batch = samples[pos:pos + PER_LINE]
+            fields = " ".join("%d %d %.7g" % (sid, (ts - base) & 0xFFFFFFFF, value)
+                              for ts, sid, value in batch)
+            _, ack = link.command("replay push " + fields, "#replay,ack")
+            reply = dict(f.partition("=")[::2] for f in ack.split(",")[2:])
+            pos += int(reply["n"])
+            if int(reply["free"]) < PER_LINE:
+                time.sleep(0.01)  # let the replay drain the queue
+
+        link.command("replay end", "Replay:")
+        while True:
+            _, status = link.command("replay", "Replay:")
+            _, line = link.expect("  Samples:")
+            if status.startswith("Replay: done"):
+                break
+            time.sleep(0.1)
+
+        print("%d samples sent in %.2f s; %s" % (len(samples), time.perf_counter() - started,
+                                                 line.strip()))
+    finally:
+        link.close()
+
+
+if __name__ == "__main__":
+    main()
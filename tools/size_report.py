@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Per-module flash/RAM size report from a GNU ld map file.
+
+Reads the "Linker script and memory map" part of the map written by
+tools/build_firmware.sh and adds up every input section that survived
+--gc-sections, grouped by the top-level source directory of the object
+it came from:
+
+    app, common, sensors, power   firmware layers
+    Core                          CubeMX startup, main, IRQs, newlib glue
+    Drivers                       STM32 HAL
+    libc, libgcc, ...             toolchain archives
+
+Flash is text + rodata + the initial values of data; RAM is data + bss.
+With LTO the map attributes code to ltrans partitions instead of source
+files, so run the report on a --no-lto build of the same configuration.
+
+Usage:
+    size_report.py build/Release-nolto/smart_sensor_hub.map
+    size_report.py a.map --csv
+"""
+
+import argparse
+import os
+import re
+import sys
+
+MODULES = ("app", "common", "sensors", "power", "Core", "Drivers", "sim")
+KINDS = ("text", "rodata", "data", "bss")
+
+OUTPUT_RE = re.compile(r"^(\.\S+)")
+INPUT_RE = re.compile(r"^ (\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$")
+CONT_RE = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$")
+FILL_RE = re.compile(r"^ \*fill\*\s+0x[0-9a-fA-F]+\s+0x([0-9a-fA-F]+)")
+
+
+def section_kind(output):
+    """Map an output section name to text/rodata/data/bss (None = not counted)."""
+    if output in (".isr_vector", ".text", ".init", ".fini", ".ARM", ".ARM.extab",
+                  ".preinit_array", ".init_array", ".fini_array"):
+        return "text"
+    if output.startswith(".text"):
+        return "text"
+    if output.startswith(".rodata"):
+        return "rodata"
+    # .ramfunc is loaded from flash into RAM exactly like .data
+    if output in (".data", ".ramfunc") or output.startswith(".data."):
+        return "data"
+    if output == ".bss" or output.startswith(".bss.") or output == ".tbss":
+        return "bss"
+    return None
+
+
+def module_of(path):
+    """Return the report row an object file path belongs to."""
+    archive = re.match(r"^(.*?\.a)\(", path)
+    if archive:
+        name = os.path.basename(archive.group(1))
+        name = re.sub(r"^lib", "", name[:-2])
+        return "lib" + name.split("_")[0]
+
+    if ".ltrans" in path:
+        return "(lto)"
+
+    parts = path.replace("\\", "/").split("/")
+    for part in parts:
+        if part in MODULES:
+            return part
+    return "(other)"
+
+
+def parse(path):
+    """Return {module: {kind: bytes}} for one map file."""
+    totals = {}
+    in_map = False
+    output = None
+    pending = None
+
+    def add(module, kind, size):
+        row = totals.setdefault(module, dict.fromkeys(KINDS, 0))
+        row[kind] += size
+
+    with open(path, "r", encoding="utf-8", errors="replace") as f:
+        for raw in f:
+            line = raw.rstrip("\n")
+
+            if not in_map:
+                if line.startswith("Linker script and memory map"):
+                    in_map = True
+                continue
+
+            if pending is not None:
+                m = CONT_RE.match(line)
+                pending_kind = pending
+                pending = None
+                if m:
+                    size = int(m.group(2), 16)
+                    if size:
+                        add(module_of(m.group(3)), pending_kind, size)
+                    continue
+
+            m = OUTPUT_RE.match(line)
+            if m:
+                output = m.group(1)
+                continue
+
+            kind = section_kind(output) if output else None
+            if kind is None:
+                continue
+
+            m = INPUT_RE.match(line)
+            if m:
+                if m.group(2) is None:
+                    pending = kind
+                else:
+                    size = int(m.group(3), 16)
+                    if size:
+                        add(module_of(m.group(4)), kind, size)
+                continue
+
+            m = FILL_RE.match(line)
+            if m:
+                add("(fill)", kind, int(m.group(1), 16))
+
+    return totals
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="GNU ld map file")
+    parser.add_argument("--csv", action="store_true", help="print CSV instead of a table")
+    args = parser.parse_args()
+
+    try:
+        totals = parse(args.map)
+    except OSError as err:
+        print("size_report: %s" % err, file=sys.stderr)
+        return 2
+
+    if not totals:
+        print("size_report: %s: no sections found" % args.map, file=sys.stderr)
+        return 2
+
+    def order(name):
+        return (MODULES.index(name) if name in MODULES else len(MODULES), name)
+
+    rows = []
+    for name in sorted(totals, key=order):
+        t = totals[name]
+        flash = t["text"] + t["rodata"] + t["data"]
+        ram = t["data"] + t["bss"]
+        rows.append((name, t["text"], t["rodata"], t["data"], t["bss"], flash, ram))
+
+    sums = tuple(sum(r[i] for r in rows) for i in range(1, 7))
+
+    if args.csv:
+        print("module,text,rodata,data,bss,flash,ram")
+        for r in rows:
+            print(",".join(str(v) for v in r))
+        print("total," + ",".join(str(v) for v in sums))
+        return 0
+
+    fmt = "%-10s %8s %8s %8s %8s %8s %8s %6s"
+    print(fmt % ("module", "text", "rodata", "data", "bss", "flash", "ram", "flash%"))
+    for r in rows:
+        share = (100.0 * r[5] / sums[4]) if sums[4] else 0.0
+        print(fmt % (r + ("%.1f" % share,)))
+    print(fmt % (("total",) + sums + ("",)))
+
+    if "(lto)" in totals:
+        print("note: LTO build; per-module figures need a --no-lto map", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,449 @@
+#!/usr/bin/env python3
+"""Decode binary sample telemetry from the Smart Sensor Hub.
+
+With telemetry enabled (`telem on`), samples leave the board as COBS-framed
+binary frames on the console UART, interleaved with CLI and log text:
+
+    0x00 | COBS( type:u8 count:u8 base_ms:u32 record*count crc:u32 ) | 0x00
+
+    type 0x01: record = id:u8 dt_ms:u16 value:f32
+    type 0x02: record = id:u8 dt_ms:u16 value:i16 (value / 100)
+
+    type 0x03: delta/varint batch, values in 1/100 units (sample_codec.h)
+    type 0x04: delta/XOR batch, exact float values (sample_codec.h)
+    type 0x05: record = id:u8 dt_ms:u16 layout:u8 quality:u8 scale_exp:i8
+               channel*n; n = layout & 0x0F channels, int32 if layout & 0x10
+               else int16, value = channel * 10^scale_exp (sensor_if.h)
+    type 0x06: window summary, record = id:u8 quality:u8 pct:u8 count:u32
+               window_ms:u32 min:f32 max:f32 mean:f32 stddev:f32 pct_value:f32
+               (sensor_stats.h; base_ms is the window start, pct 0 = none)
+    type 0x07: metrics, count u32 values in metrics.h METRICS_LIST order
+    type 0x0A: spectrum window, record = id:u8 quality:u8 bands:u8 points:u16
+               period_us:u32 cycles:u32 rms:f32 peak_hz:f32 peak:f32
+               band:f32*bands (sensor_spectrum.h; base_ms is the first
+               sample, bands split DC..Nyquist evenly, mean square each)
+    type 0x12: energy, record = kind:u8 id:u8 time_ms:u32 charge_uAh:u32
+               (power_energy.c; kind 0 mode, 1 run, 2 wfi, 3 stop, 4 task)
+
+All fields are little-endian; the CRC is CRC-32/MPEG-2 over type..records.
+Valid frames of other types (the event trace, see trace_to_perfetto.py;
+metrics series and labels, see metrics_export.py) are skipped.
+Decoded samples are printed as text lines (and optionally written to a CSV
+file); everything that is not a valid frame is passed through as text. With
+--elf, binary log records (LOG_BINARY_MODE=1) are decoded too.
+
+Usage:
+    telemetry_decode.py capture.bin
+    telemetry_decode.py /dev/ttyACM0 --baud 115200 --csv samples.csv
+    telemetry_decode.py /dev/ttyACM0 --elf firmware.elf
+"""
+
+import argparse
+import csv
+import os
+import struct
+import sys
+import zlib
+
+FRAME_SAMPLES_F32 = 0x01
+FRAME_SAMPLES_I16 = 0x02
+FRAME_SAMPLES_DELTA = 0x03
+FRAME_SAMPLES_XOR = 0x04
+FRAME_SAMPLES_RAW = 0x05
+FRAME_STATS = 0x06
+FRAME_METRICS = 0x07
+FRAME_SPECTRUM = 0x0A
+FRAME_ENERGY = 0x12
+I16_SCALE = 100.0
+DELTA_SCALE = 100.0
+
+ENERGY_KINDS = ("mode", "run", "wfi", "stop", "task")
+# metrics.h METRICS_LIST, in order; newer firmware may append more.
+METRIC_NAMES = (
+    "uptime_ms", "clock_hz", "sample_period_ms", "log_dropped", "log_held",
+    "uart_drop_cli", "uart_drop_telemetry", "uart_drop_log",
+    "usb_tx_bytes", "usb_rx_bytes", "usb_tx_to_uart",
+    "ring_count", "ring_capacity", "ring_high_water", "ring_pushed", "ring_overruns",
+    "telem_frames", "telem_records", "telem_bytes", "telem_dropped",
+    "idle_entries", "tickless_entries", "early_wakeups", "sleep_ms",
+    "stop_entries", "stop_ms", "wake_source", "wake_latency_us", "wake_latency_max_us",
+    "uart_wakes", "wake_drops", "console_hold_ms", "inactive_ms",
+    "auto_step_downs", "auto_wakeups", "watchdog_timeout_ms", "watchdog_withheld",
+    "boot_first_sample_us", "boot_ready_us", "boot_resume", "standby_wakeups",
+    "standby_replayed", "work_posted", "work_dropped", "work_depth_max",
+    "work_latency_max_us", "sensor_retries", "sensor_quarantines",
+    "sensors_quarantined", "log_deferred", "log_defer_bytes", "log_over_budget",
+    "cpu_load_permille", "cpu_load_avg_permille", "cpu_load_peak_permille",
+    "power_transitions", "power_transition_max_us", "stop_overhead_us",
+    "stop_break_even_ms", "stop_skipped", "stop_main_entries", "stop_main_break_even_ms",
+    "spectrum_windows", "spectrum_max_us", "shed_level", "shed_pressure_pct",
+    "shed_escalations", "shed_decimated", "shed_aggregated", "selftest_result",
+)
+POWER_MODES = ("ACTIVE", "IDLE", "SLEEP", "STOP")
+CLOCK_PROFILES = ("LOW_POWER", "BALANCED", "MAX")
+
+# Largest frame the firmware sends: 6-byte header, 32 x 11-byte records, CRC.
+MAX_WIRE_FRAME = 6 + 32 * 11 + 4 + 4
+
+# Each byte with its bits in reverse order.
+_BIT_REVERSE = bytes(int("{:08b}".format(b)[::-1], 2) for b in range(256))
+
+
+def crc32_mpeg2(data):
+    """CRC-32/MPEG-2 (poly 0x04C11DB7, init 0xFFFFFFFF, no reflection).
+
+    Same polynomial as zlib's CRC-32, which is the bit-reflected form: the
+    CRC of the bit-reversed bytes, bit-reversed, minus zlib's final XOR.
+    """
+    crc = zlib.crc32(bytes(data).translate(_BIT_REVERSE)) ^ 0xFFFFFFFF
+    return int.from_bytes(crc.to_bytes(4, "little").translate(_BIT_REVERSE), "big")
+
+
+def cobs_decode(data):
+    """Decode one COBS block (without delimiters); None if malformed."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def _varint(data, pos):
+    value = shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise ValueError("truncated varint")
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, pos
+
+
+def _unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def decode_batch(data, count, base, xor):
+    """Decode a sample_codec.h batch into [(timestamp_ms, sensor_id, value)]."""
+    streams = {}  # id -> [last_ts, last_dt, last_value]
+    samples = []
+    pos = 0
+    sensor = None
+    for _ in range(count):
+        tag, pos = _varint(data, pos)
+        if tag & 1:
+            sensor = data[pos]
+            pos += 1
+        if sensor is None:
+            raise ValueError("record without sensor id")
+        field = _unzigzag(tag >> 1)
+
+        st = streams.get(sensor)
+        if st is None:
+            ts, dt, prev = (base + field) & 0xFFFFFFFF, 0, 0
+        else:
+            dt = st[1] + field
+            ts, prev = (st[0] + dt) & 0xFFFFFFFF, st[2]
+
+        if xor:
+            ctrl = data[pos]
+            n, shift = ctrl & 0x0F, (ctrl >> 4) * 8
+            x = int.from_bytes(data[pos + 1:pos + 1 + n], "little") << shift
+            pos += 1 + n
+            bits = prev ^ x
+            value = struct.unpack("<f", struct.pack("<I", bits))[0]
+            stored = bits
+        else:
+            delta, pos = _varint(data, pos)
+            stored = prev + _unzigzag(delta)
+            value = stored / DELTA_SCALE
+
+        streams[sensor] = [ts, dt, stored]
+        samples.append((ts, sensor, value))
+
+    if pos != len(data):
+        raise ValueError("trailing bytes")
+    return samples
+
+
+def decode_raw(data, count, base):
+    """Decode raw records into [(timestamp_ms, sensor_id, (values...), quality)]."""
+    samples = []
+    pos = 0
+    for _ in range(count):
+        sensor, dt, layout, quality, exp = struct.unpack_from("<BHBBb", data, pos)
+        pos += 6
+        n, fmt = layout & 0x0F, ("<i" if layout & 0x10 else "<h")
+        size = struct.calcsize(fmt)
+        values = tuple(struct.unpack_from(fmt, data, pos + c * size)[0] * 10.0 ** exp
+                       for c in range(n))
+        pos += n * size
+        samples.append(((base + dt) & 0xFFFFFFFF, sensor, values, quality))
+
+    if pos != len(data):
+        raise ValueError("trailing bytes")
+    return samples
+
+
+def energy_name(kind, ident):
+    """Readable name of an energy record."""
+    names = {0: POWER_MODES, 1: CLOCK_PROFILES, 2: CLOCK_PROFILES}.get(kind, ())
+    label = names[ident] if ident < len(names) else str(ident)
+    kind_name = ENERGY_KINDS[kind] if kind < len(ENERGY_KINDS) else "kind%u" % kind
+    return kind_name if kind == 3 else "%s %s" % (kind_name, label)
+
+
+def decode_energy(body, count, base):
+    """Return energy records as [(timestamp_ms, name, time_ms, charge_uAh), ...]."""
+    if len(body) != 6 + count * 10:
+        raise ValueError("bad energy frame length")
+    records = []
+    for n in range(count):
+        kind, ident, time_ms, charge = struct.unpack_from("<BBII", body, 6 + n * 10)
+        records.append((base, energy_name(kind, ident), time_ms, charge))
+    return records
+
+
+def decode_stats(body, count, base):
+    """Return window summaries as [(timestamp_ms, {field: value}), ...]."""
+    if len(body) != 6 + count * 31:
+        raise ValueError("bad stats frame length")
+    records = []
+    for n in range(count):
+        fields = struct.unpack_from("<BBBIIfffff", body, 6 + n * 31)
+        records.append((base, dict(zip(("id", "quality", "pct", "count", "window_ms", "min",
+                                        "max", "mean", "stddev", "pct_value"), fields))))
+    return records
+
+
+def decode_spectrum(body, count, base):
+    """Return spectrum windows as [(timestamp_ms, {field: value}, "spectrum"), ...]."""
+    records, pos = [], 6
+    for _ in range(count):
+        fields = struct.unpack_from("<BBBHIIfff", body, pos)
+        record = dict(zip(("id", "quality", "bands", "points", "period_us", "cycles", "rms",
+                           "peak_hz", "peak"), fields))
+        record["band"] = struct.unpack_from("<%uf" % record["bands"], body, pos + 25)
+        records.append((base, record, "spectrum"))
+        pos += 25 + 4 * record["bands"]
+    if pos != len(body):
+        raise ValueError("bad spectrum frame length")
+    return records
+
+
+def decode_metrics(body, count, base):
+    """Return the metrics record as [(timestamp_ms, {name: value}, "metrics")]."""
+    if len(body) != 6 + count * 4:
+        raise ValueError("bad metrics frame length")
+    values = struct.unpack_from("<%uI" % count, body, 6)
+    names = [METRIC_NAMES[n] if n < len(METRIC_NAMES) else "metric%u" % n
+             for n in range(count)]
+    return [(base, dict(zip(names, values)), "metrics")]
+
+
+def parse_frame(raw):
+    """Return [(timestamp_ms, sensor_id, value), ...] or None if invalid.
+
+    Energy frames return [(timestamp_ms, name, time_ms, charge_uAh), ...],
+    raw frames [(timestamp_ms, sensor_id, (values...), quality), ...],
+    summary frames [(timestamp_ms, {field: value}), ...], spectrum frames
+    [(timestamp_ms, {field: value}, "spectrum"), ...] and metrics frames
+    [(timestamp_ms, {name: value}, "metrics")].
+    """
+    if raw is None or len(raw) < 10:
+        return None
+
+    body, crc = raw[:-4], struct.unpack_from("<I", raw, len(raw) - 4)[0]
+    if crc32_mpeg2(body) != crc:
+        return None
+
+    ftype, count, base = struct.unpack_from("<BBI", body, 0)
+    if ftype == FRAME_ENERGY:
+        try:
+            return decode_energy(body, count, base)
+        except (ValueError, struct.error):
+            return None
+    elif ftype == FRAME_STATS:
+        try:
+            return decode_stats(body, count, base)
+        except (ValueError, struct.error):
+            return None
+    elif ftype == FRAME_SPECTRUM:
+        try:
+            return decode_spectrum(body, count, base)
+        except (ValueError, struct.error):
+            return None
+    elif ftype == FRAME_METRICS:
+        try:
+            return decode_metrics(body, count, base)
+        except (ValueError, struct.error):
+            return None
+    elif ftype in (FRAME_SAMPLES_DELTA, FRAME_SAMPLES_XOR):
+        try:
+            return decode_batch(body[6:], count, base, ftype == FRAME_SAMPLES_XOR)
+        except (ValueError, IndexError):
+            return None
+    elif ftype == FRAME_SAMPLES_RAW:
+        try:
+            return decode_raw(body[6:], count, base)
+        except (ValueError, struct.error):
+            return None
+    elif ftype == FRAME_SAMPLES_F32:
+        fmt, size = "<BHf", 7
+    elif ftype == FRAME_SAMPLES_I16:
+        fmt, size = "<BHh", 5
+    else:
+        return []  # another frame type (e.g. the event trace): no samples
+
+    if len(body) != 6 + count * size:
+        return None
+
+    samples = []
+    for n in range(count):
+        sensor, dt, value = struct.unpack_from(fmt, body, 6 + n * size)
+        if ftype == FRAME_SAMPLES_I16:
+            value = value / I16_SCALE
+        samples.append(((base + dt) & 0xFFFFFFFF, sensor, value))
+    return samples
+
+
+def split_frames(stream, on_samples, parse=parse_frame, max_frame=MAX_WIRE_FRAME):
+    """Yield the non-telemetry bytes of a stream; report frames via callback.
+
+    parse(raw) turns a decoded frame into what on_samples() gets, or None
+    if it is not a valid frame.
+    """
+    buf = b""
+    for chunk in stream:
+        buf = buf + chunk if buf else chunk
+        pos, text = 0, 0
+        while True:
+            start = buf.find(b"\x00", pos)
+            if start < 0:
+                pos = len(buf)
+                break
+
+            end = buf.find(b"\x00", start + 1)
+            if end < 0:
+                if len(buf) - start > max_frame:
+                    # No closing delimiter in range: not a frame.
+                    pos = start + 1
+                    continue
+                pos = start
+                break  # wait for the rest of the frame
+
+            samples = parse(cobs_decode(buf[start + 1:end])) if end > start + 1 else None
+            if samples is None:
+                # Not a frame (e.g. a zero inside a binary log record).
+                pos = start + 1
+                continue
+
+            if start > text:
+                yield buf[text:start]
+            on_samples(samples)
+            pos = text = end + 1
+
+        if pos > text:
+            yield buf[text:pos]
+        buf = buf[pos:]
+
+    if buf:
+        yield buf
+
+
+def open_source(path, baud):
+    if path == "-":
+        stdin = sys.stdin.buffer
+        return iter(lambda: stdin.read1(4096), b"")
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial, only needed for live capture
+        port = serial.Serial(path, baud, timeout=0.1)
+        return iter(lambda: port.read(4096) or b"", None)
+    f = open(path, "rb")
+    return iter(lambda: f.read(4096), b"")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("source", help="capture file, serial port, or '-' for stdin")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    parser.add_argument("--csv", help="also append samples to this CSV file")
+    parser.add_argument("--elf", help="firmware ELF, to decode binary log records as well")
+    args = parser.parse_args()
+
+    def write(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    csv_writer = None
+    if args.csv:
+        csv_file = open(args.csv, "a", newline="")
+        csv_writer = csv.writer(csv_file)
+        if csv_file.tell() == 0:
+            csv_writer.writerow(["timestamp_ms", "sensor_id", "value"])
+
+    def on_samples(samples):
+        for item in samples:
+            if len(item) == 2:
+                ts, st = item
+                pct = " p%u=%.3f" % (st["pct"], st["pct_value"]) if st["pct"] else ""
+                write("\r[%08u ms][STA] id=%u window=%u ms n=%u min=%.3f max=%.3f mean=%.3f"
+                      " sd=%.4f%s quality=0x%02x\r\n"
+                      % (ts, st["id"], st["window_ms"], st["count"], st["min"], st["max"],
+                         st["mean"], st["stddev"], pct, st["quality"]))
+                continue
+            if len(item) == 3 and item[2] == "spectrum":
+                ts, sp, _ = item
+                write("\r[%08u ms][SPC] id=%u n=%u period=%u us rms=%.4f peak=%.3f Hz/%.4f"
+                      " bands=%s cycles=%u quality=0x%02x\r\n"
+                      % (ts, sp["id"], sp["points"], sp["period_us"], sp["rms"], sp["peak_hz"],
+                         sp["peak"], ",".join("%.4g" % b for b in sp["band"]), sp["cycles"],
+                         sp["quality"]))
+                continue
+            if len(item) == 3 and isinstance(item[1], dict):
+                ts, values, _ = item
+                write("\r[%08u ms][MET] %s\r\n"
+                      % (ts, " ".join("%s=%u" % kv for kv in values.items())))
+                continue
+            if len(item) == 4 and isinstance(item[1], str):
+                ts, name, time_ms, charge = item
+                write("\r[%08u ms][NRG] %-16s %10u ms %10u uAh\r\n" % (ts, name, time_ms, charge))
+                continue
+            if len(item) == 4:
+                ts, sensor, values, quality = item
+                write("\r[%08u ms][TLM] id=%u value=%s quality=0x%02x\r\n"
+                      % (ts, sensor, ",".join("%.3f" % v for v in values), quality))
+                if csv_writer is not None:
+                    csv_writer.writerow([ts, sensor] + ["%.6g" % v for v in values])
+                continue
+            ts, sensor, value = item
+            write("\r[%08u ms][TLM] id=%u value=%.3f\r\n" % (ts, sensor, value))
+            if csv_writer is not None:
+                csv_writer.writerow([ts, sensor, "%.6g" % value])
+        if csv_writer is not None:
+            csv_file.flush()
+
+    text = split_frames(open_source(args.source, args.baud), on_samples)
+
+    try:
+        if args.elf:
+            sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+            import log_decode
+            log_decode.decode_stream(log_decode.ElfStrings(args.elf), text, write)
+        else:
+            for chunk in text:
+                write(chunk.decode("utf-8", "replace"))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,241 @@
+#!/usr/bin/env python3
+"""Convert a Smart Sensor Hub event trace capture to Chrome trace JSON.
+
+With an image built with TRACE_ENABLE=1 and `trace on`, the firmware
+streams its event trace as telemetry frames (see common/trace.h) on the
+console UART, mixed with CLI text and other frames:
+
+    type 0x10 events: clock_hz:u32 dropped:u32 { cycles:u32 word:u32 }*count
+    type 0x11 names:  { kind:u8 id:u8 len:u8 char*len }*count
+
+This tool picks those frames out of a capture, rebuilds one timeline from
+the CYCCNT stamps and writes it in the Chrome trace event format, which
+ui.perfetto.dev and chrome://tracing open directly. Tasks, interrupts,
+each sensor and the power state get their own track.
+
+CYCCNT stops while the core sleeps, so idle periods take their length
+from the microsecond time base carried by the idle events. Stamps are
+unwrapped from event to event, which holds as long as no two consecutive
+events are more than 2^32 cycles (~24 s at 180 MHz) apart.
+
+Usage:
+    trace_to_perfetto.py capture.bin -o trace.json
+    trace_to_perfetto.py /dev/ttyACM0 -o trace.json   (stop with Ctrl-C)
+"""
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from telemetry_decode import cobs_decode, crc32_mpeg2, open_source  # noqa: E402
+
+FRAME_EVENTS = 0x10
+FRAME_NAMES = 0x11
+
+EV_TASK_BEGIN, EV_TASK_END = 1, 2
+EV_ISR_ENTER, EV_ISR_EXIT = 3, 4
+EV_SENSOR_START, EV_SENSOR_DONE = 5, 6
+EV_POWER_MODE = 7
+EV_IDLE_BEGIN, EV_IDLE_END = 8, 9
+EV_STOP_ENTER, EV_STOP_EXIT = 10, 11
+EV_CLOCK = 12
+
+NAME_TASK, NAME_SENSOR = 0, 1
+
+TID_TASKS, TID_ISR, TID_POWER, TID_SENSOR_BASE = 1, 2, 3, 100
+
+# Exception numbers of the handlers that carry trace points.
+EXCEPTIONS = {
+    15: "SysTick", 19: "RTC_WKUP", 20: "FLASH", 25: "EXTI3",
+    32: "DMA1_Stream5", 33: "DMA1_Stream6", 54: "USART2",
+    56: "EXTI15_10", 66: "TIM5",
+}
+
+POWER_MODES = ("ACTIVE", "IDLE", "SLEEP", "STOP")
+
+
+def read_frames(chunks):
+    """Yield (type, count, payload) for every valid telemetry frame."""
+    buf = bytearray()
+    for chunk in chunks:
+        buf.extend(chunk)
+        parts = buf.split(b"\x00")
+        buf = bytearray(parts.pop())
+        for part in parts:
+            raw = cobs_decode(bytes(part)) if part else None
+            if raw is None or len(raw) < 10:
+                continue
+            body = raw[:-4]
+            if crc32_mpeg2(body) != struct.unpack_from("<I", raw, len(raw) - 4)[0]:
+                continue
+            yield body[0], body[1], body[6:]
+
+
+class Timeline:
+    """Turns trace events into Chrome trace events."""
+
+    def __init__(self, pid=1):
+        self.pid = pid
+        self.out = []
+        self.names = {}
+        self.khz = None
+        self.cycles = None
+        self.t = 0.0
+        self.idle = None
+        self.depth = {}
+        self.dropped = 0
+        self.tracks = {}
+
+    def track(self, tid, name):
+        if tid not in self.tracks:
+            self.tracks[tid] = name
+            self.out.append({"ph": "M", "name": "thread_name", "pid": self.pid,
+                             "tid": tid, "args": {"name": name}})
+        return tid
+
+    def name(self, kind, ident, fallback):
+        return self.names.get((kind, ident), "%s %u" % (fallback, ident))
+
+    def begin(self, tid, name, args=None):
+        self.depth[tid] = self.depth.get(tid, 0) + 1
+        ev = {"ph": "B", "name": name, "pid": self.pid, "tid": tid, "ts": self.t}
+        if args:
+            ev["args"] = args
+        self.out.append(ev)
+
+    def end(self, tid, args=None):
+        # A capture can start inside a span; drop ends without a begin.
+        if self.depth.get(tid, 0) == 0:
+            return
+        self.depth[tid] -= 1
+        ev = {"ph": "E", "pid": self.pid, "tid": tid, "ts": self.t}
+        if args:
+            ev["args"] = args
+        self.out.append(ev)
+
+    def instant(self, tid, name, args=None):
+        ev = {"ph": "i", "s": "t", "name": name, "pid": self.pid, "tid": tid, "ts": self.t}
+        if args:
+            ev["args"] = args
+        self.out.append(ev)
+
+    def counter(self, name, value):
+        self.out.append({"ph": "C", "name": name, "pid": self.pid, "ts": self.t,
+                         "args": {name: value}})
+
+    def on_names(self, count, payload):
+        pos = 0
+        for _ in range(count):
+            if pos + 3 > len(payload):
+                return
+            kind, ident, n = payload[pos], payload[pos + 1], payload[pos + 2]
+            self.names[(kind, ident)] = payload[pos + 3:pos + 3 + n].decode("ascii", "replace")
+            pos += 3 + n
+
+    def on_events(self, count, payload):
+        if len(payload) != 8 + 8 * count:
+            return
+        clock_hz, dropped = struct.unpack_from("<II", payload, 0)
+        if self.khz is None:
+            self.khz = clock_hz / 1000.0
+        if dropped > self.dropped:
+            self.instant(self.track(TID_TASKS, "Tasks"), "trace dropped",
+                         {"events": dropped - self.dropped})
+        self.dropped = dropped
+
+        for n in range(count):
+            cycles, word = struct.unpack_from("<II", payload, 8 + 8 * n)
+            self.on_event(cycles, word & 0xFF, word >> 8)
+
+    def on_event(self, cycles, kind, data):
+        if self.cycles is not None and self.khz:
+            self.t += ((cycles - self.cycles) & 0xFFFFFFFF) * 1000.0 / self.khz
+        self.cycles = cycles
+
+        if kind == EV_TASK_BEGIN:
+            self.begin(self.track(TID_TASKS, "Tasks"), self.name(NAME_TASK, data, "task"))
+        elif kind == EV_TASK_END:
+            self.end(self.track(TID_TASKS, "Tasks"))
+        elif kind == EV_ISR_ENTER:
+            self.begin(self.track(TID_ISR, "Interrupts"),
+                       EXCEPTIONS.get(data, "IRQ %d" % (data - 16)))
+        elif kind == EV_ISR_EXIT:
+            self.end(self.track(TID_ISR, "Interrupts"))
+        elif kind == EV_SENSOR_START:
+            sensor = data & 0xFF
+            name = self.name(NAME_SENSOR, sensor, "sensor")
+            self.begin(self.track(TID_SENSOR_BASE + sensor, "Sensor " + name), "read")
+        elif kind == EV_SENSOR_DONE:
+            sensor = data & 0xFF
+            name = self.name(NAME_SENSOR, sensor, "sensor")
+            self.end(self.track(TID_SENSOR_BASE + sensor, "Sensor " + name),
+                     {"ok": bool(data & 0x100)})
+        elif kind == EV_POWER_MODE:
+            mode = POWER_MODES[data] if data < len(POWER_MODES) else str(data)
+            self.instant(self.track(TID_POWER, "Power"), "mode " + mode)
+            self.counter("power mode", data)
+        elif kind == EV_IDLE_BEGIN:
+            self.idle = (self.t, data)
+            self.begin(self.track(TID_POWER, "Power"), "idle")
+        elif kind == EV_IDLE_END:
+            if self.idle is not None:
+                slept = (data - self.idle[1]) & 0xFFFFFF
+                self.t = max(self.t, self.idle[0] + slept)
+                self.idle = None
+            self.end(self.track(TID_POWER, "Power"))
+        elif kind == EV_STOP_ENTER:
+            self.begin(self.track(TID_POWER, "Power"), "STOP")
+        elif kind == EV_STOP_EXIT:
+            self.end(self.track(TID_POWER, "Power"))
+        elif kind == EV_CLOCK:
+            self.khz = float(data)
+            self.counter("core clock MHz", data / 1000.0)
+
+    def close(self):
+        for tid, depth in self.depth.items():
+            for _ in range(depth):
+                self.out.append({"ph": "E", "pid": self.pid, "tid": tid, "ts": self.t})
+        self.out.insert(0, {"ph": "M", "name": "process_name", "pid": self.pid,
+                            "args": {"name": "smart-sensor-hub"}})
+        return {"traceEvents": self.out, "displayTimeUnit": "ns"}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("source", help="capture file, serial port, or '-' for stdin")
+    parser.add_argument("-o", "--output", default="-", help="JSON file (default stdout)")
+    parser.add_argument("--baud", type=int, default=115200, help="serial baud rate")
+    args = parser.parse_args()
+
+    timeline = Timeline()
+    frames = 0
+    try:
+        for ftype, count, payload in read_frames(open_source(args.source, args.baud)):
+            if ftype == FRAME_NAMES:
+                timeline.on_names(count, payload)
+            elif ftype == FRAME_EVENTS:
+                timeline.on_events(count, payload)
+            else:
+                continue
+            frames += 1
+    except KeyboardInterrupt:
+        pass
+
+    if frames == 0:
+        print("trace_to_perfetto: no trace frames found", file=sys.stderr)
+        return 1
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    json.dump(timeline.close(), out)
+    if out is not sys.stdout:
+        out.close()
+    print("trace_to_perfetto: %u frames, %u events dropped on the target"
+          % (frames, timeline.dropped), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())